@@ -0,0 +1,260 @@
+/// @file bench_cache_load.cpp
+/// @brief Load test of CacheDatabase under concurrent readers and writers
+///
+/// Worker threads run a write-heavy mix of put, get, exists and
+/// removeOlderThan on one database while a UI thread keeps reading, like the
+/// thumbnail workers filling the cache as the list scrolls. Per-operation
+/// latency percentiles and the wait on the connection lock show what the
+/// writer connection costs at each thread count. The cache_db/tuning
+/// scenarios repeat the load on fresh databases with one SqliteTuning
+/// setting changed, so mmap, page size and checkpointing are measured
+/// rather than guessed.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <latch>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "cache/cache_database.hpp"
+#include "corpus.hpp"
+
+namespace nive::bench {
+
+namespace {
+
+constexpr uint32_t kEntryWidth = 256;
+constexpr uint32_t kEntryHeight = 192;
+
+/// @brief Operations timed separately
+enum Op : size_t { kGet, kExists, kPut, kRemoveOlderThan, kUiGet, kOpCount };
+
+constexpr std::array<const char*, kOpCount> kOpNames = {"get", "exists", "put",
+                                                        "remove_older_than", "ui_get"};
+
+/// @brief Latencies of one thread, in microseconds
+using Latencies = std::array<std::vector<double>, kOpCount>;
+
+std::string preloaded_key(size_t index) {
+    return std::format("load_{:08}", index);
+}
+
+cache::ThumbnailEntry make_entry(std::string key, const std::vector<uint8_t>& pixels) {
+    cache::ThumbnailEntry entry;
+    entry.metadata.file_hash = key;
+    entry.metadata.source_path = std::format("C:\\load\\{}.jpg", key);
+    entry.metadata.width = kEntryWidth;
+    entry.metadata.height = kEntryHeight;
+    entry.metadata.original_width = 4000;
+    entry.metadata.original_height = 3000;
+    entry.metadata.cached_at = std::chrono::system_clock::now();
+    entry.metadata.source_mtime = entry.metadata.cached_at;
+    entry.metadata.data_size = pixels.size();
+    entry.data = pixels;
+    return entry;
+}
+
+/// @brief Time one call, appending its latency
+template <typename F>
+void timed(std::vector<double>& latencies, F&& call) {
+    auto start = std::chrono::steady_clock::now();
+    call();
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+            .count());
+}
+
+/// @brief Worker mix: half puts, the rest reads and an occasional expiry pass
+void run_worker(cache::CacheDatabase& database, size_t thread_index, size_t ops,
+                size_t preloaded, const std::vector<uint8_t>& pixels, Latencies& latencies) {
+    std::minstd_rand random(static_cast<uint32_t>(thread_index + 1));
+    // Nothing is this old, so the expiry pass scans without deleting
+    auto cutoff = std::chrono::system_clock::now() - std::chrono::hours(24 * 365);
+    for (size_t i = 0; i < ops; ++i) {
+        uint32_t roll = random() % 100;
+        auto key = preloaded_key(random() % preloaded);
+        if (roll < 50) {
+            // Half new keys, half replacing preloaded rows
+            auto entry = make_entry(roll % 2 ? std::format("w{}_{}", thread_index, i) : key,
+                                    pixels);
+            timed(latencies[kPut], [&] { (void)database.put(entry); });
+        } else if (roll < 75) {
+            timed(latencies[kGet], [&] { (void)database.get(key); });
+        } else if (roll < 99) {
+            timed(latencies[kExists], [&] { (void)database.exists(key); });
+        } else {
+            timed(latencies[kRemoveOlderThan], [&] { (void)database.removeOlderThan(cutoff); });
+        }
+    }
+}
+
+/// @brief Database fixture of one tuning variant
+struct LoadSetup {
+    size_t preloaded = 0;
+    size_t ops_per_thread = 0;
+    std::vector<uint8_t> pixels;
+};
+
+/// @brief Create an empty database with the given tuning and preload it
+std::unique_ptr<cache::CacheDatabase> open_preloaded(const std::filesystem::path& directory,
+                                                     const cache::SqliteTuning& tuning,
+                                                     const LoadSetup& setup) {
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);  // page_size only applies to a new file
+    std::filesystem::create_directories(directory, ec);
+    auto opened = cache::CacheDatabase::open(directory / "load.db", {},
+                                             cache::StorageBackend::Sqlite, tuning);
+    if (!opened) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < setup.preloaded; ++i) {
+        if (!(*opened)->put(make_entry(preloaded_key(i), setup.pixels))) {
+            return nullptr;
+        }
+    }
+    return std::move(*opened);
+}
+
+/// @brief Run the mixed load with a number of workers, reporting latencies and lock waits
+void measure_load(Harness& harness, const std::string& name, cache::CacheDatabase& database,
+                  size_t workers, const LoadSetup& setup) {
+    size_t ops_per_thread = setup.ops_per_thread;
+    size_t preloaded = setup.preloaded;
+    const auto& pixels = setup.pixels;
+    std::vector<Latencies> latencies(workers + 1);  // The last one is the UI thread
+
+    harness.measure(
+        name, workers * ops_per_thread,
+        [&] {
+            for (auto& thread_latencies : latencies) {
+                for (auto& op : thread_latencies) {
+                    op.clear();
+                }
+            }
+            database.resetLockStats();
+        },
+        [&] {
+            std::atomic<size_t> running{workers};
+            std::latch start(static_cast<std::ptrdiff_t>(workers + 1));
+            std::vector<std::jthread> pool;
+            pool.reserve(workers + 1);
+            for (size_t t = 0; t < workers; ++t) {
+                pool.emplace_back([&, t] {
+                    start.arrive_and_wait();
+                    run_worker(database, t, ops_per_thread, preloaded, pixels, latencies[t]);
+                    running.fetch_sub(1, std::memory_order_release);
+                });
+            }
+            pool.emplace_back([&] {
+                start.arrive_and_wait();
+                std::minstd_rand random(0x55490000);
+                while (running.load(std::memory_order_acquire) > 0) {
+                    auto key = preloaded_key(random() % preloaded);
+                    timed(latencies[workers][kUiGet], [&] { (void)database.get(key); });
+                }
+            });
+        });  // jthreads join here, inside the timing
+
+    std::vector<std::pair<std::string, double>> metrics;
+    for (size_t op = 0; op < kOpCount; ++op) {
+        std::vector<double> merged;
+        for (const auto& thread_latencies : latencies) {
+            merged.insert(merged.end(), thread_latencies[op].begin(),
+                          thread_latencies[op].end());
+        }
+        if (merged.empty()) {
+            continue;
+        }
+        std::ranges::sort(merged);
+        for (auto [label, p] : {std::pair{"p50", 0.5}, std::pair{"p90", 0.9},
+                                std::pair{"p99", 0.99}, std::pair{"p999", 0.999}}) {
+            metrics.emplace_back(std::format("{}_{}_us", kOpNames[op], label),
+                                 percentile(merged, p));
+        }
+        metrics.emplace_back(std::format("{}_max_us", kOpNames[op]), merged.back());
+    }
+
+    // Lock counters cover the last run, as do the latencies
+    auto lock = database.lockStats();
+    double acquisitions = static_cast<double>(std::max<uint64_t>(lock.acquisitions, 1));
+    metrics.emplace_back("lock_contended_pct",
+                         100.0 * static_cast<double>(lock.contended) / acquisitions);
+    metrics.emplace_back("lock_wait_total_ms", static_cast<double>(lock.wait_ns) / 1e6);
+    metrics.emplace_back("lock_wait_mean_us",
+                         static_cast<double>(lock.wait_ns) / 1e3 / acquisitions);
+    metrics.emplace_back("lock_wait_max_ms", static_cast<double>(lock.max_wait_ns) / 1e6);
+    harness.addMetrics(name, std::move(metrics));
+}
+
+/// @brief SQLite settings compared by the cache_db/tuning scenarios
+struct TuningVariant {
+    const char* name;
+    cache::SqliteTuning tuning;
+};
+
+const std::array<TuningVariant, 6> kTuningVariants = {{
+    {"default", {}},
+    {"no_mmap", {.mmap_size_bytes = 0}},
+    {"page4k", {.page_size = 4096}},
+    {"page64k", {.page_size = 65536}},
+    {"commit_checkpoint", {.background_checkpoint = false}},
+    {"no_checkpoint", {.wal_autocheckpoint_pages = 0}},
+}};
+
+}  // namespace
+
+void runCacheLoadScenarios(Harness& harness) {
+    const auto& options = harness.options();
+    if (!harness.wantsGroup("cache_db/")) {
+        return;
+    }
+    auto image = corpus::syntheticImage(kEntryWidth, kEntryHeight);
+    LoadSetup setup{.preloaded = options.full ? 20000u : 2000u,
+                    .ops_per_thread = options.full ? 2000u : 500u,
+                    .pixels = {image.data(), image.data() + image.sizeBytes()}};
+    auto root = options.work_dir / "cache_load";
+
+    if (harness.wantsGroup("cache_db/load/")) {
+        auto database = open_preloaded(root / "default", {}, setup);
+        if (!database) {
+            std::printf("cache_db: skipped, database could not be created\n");
+            return;
+        }
+        for (int threads : options.load_threads) {
+            auto name = std::format("cache_db/load/{}t", threads);
+            if (threads > 0 && harness.selected(name)) {
+                measure_load(harness, name, *database, static_cast<size_t>(threads), setup);
+            }
+        }
+    }
+
+    // Each variant at the highest thread count, on a fresh database of its own
+    if (!harness.wantsGroup("cache_db/tuning/") || options.load_threads.empty()) {
+        return;
+    }
+    int threads = std::ranges::max(options.load_threads);
+    for (const auto& variant : kTuningVariants) {
+        auto name = std::format("cache_db/tuning/{}/{}t", variant.name, threads);
+        if (threads <= 0 || !harness.selected(name)) {
+            continue;
+        }
+        auto database = open_preloaded(root / variant.name, variant.tuning, setup);
+        if (!database) {
+            std::printf("%s: skipped, database could not be created\n", name.c_str());
+            continue;
+        }
+        measure_load(harness, name, *database, static_cast<size_t>(threads), setup);
+    }
+}
+
+}  // namespace nive::bench
@@ -0,0 +1,270 @@
+/// @file bench_harness.cpp
+/// @brief Timing loop and JSON report implementation
+
+#include "bench_harness.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "version.h"
+
+namespace nive::bench {
+
+namespace {
+
+void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+[[nodiscard]] std::string_view unit_name(Unit unit) noexcept {
+    switch (unit) {
+    case Unit::Pixels:
+        return "pixels";
+    case Unit::Bytes:
+        return "bytes";
+    case Unit::Items:
+        break;
+    }
+    return "items";
+}
+
+/// @brief Throughput as printed: items/s, MP/s or MB/s
+[[nodiscard]] std::string format_rate(const Measurement& measurement) {
+    double rate = measurement.itemsPerSecond();
+    switch (measurement.unit) {
+    case Unit::Pixels:
+        return std::format("{:12.1f} MP/s", rate / 1e6);
+    case Unit::Bytes:
+        return std::format("{:12.1f} MB/s", rate / 1e6);
+    case Unit::Items:
+        break;
+    }
+    return std::format("{:12.1f} items/s", rate);
+}
+
+/// @brief Value of a budget's stat in a measurement
+[[nodiscard]] std::optional<double> stat_value(const Measurement& measurement,
+                                               const std::string& stat) {
+    if (stat == "min_ms") {
+        return measurement.minMs();
+    }
+    if (stat == "median_ms") {
+        return measurement.medianMs();
+    }
+    if (stat == "ms_per_item") {
+        return measurement.items ? measurement.medianMs() / static_cast<double>(measurement.items)
+                                 : 0.0;
+    }
+    auto it = std::ranges::find(measurement.metrics, stat,
+                                &std::pair<std::string, double>::first);
+    if (it == measurement.metrics.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+}  // namespace
+
+std::optional<std::vector<Budget>> loadBudgets(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::printf("Cannot read budgets from %s\n", path.string().c_str());
+        return std::nullopt;
+    }
+    std::vector<Budget> budgets;
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        if (auto comment = line.find('#'); comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        Budget budget;
+        std::string tolerance;
+        if (!(fields >> budget.name)) {
+            continue;  // Blank or comment only
+        }
+        std::string rest;
+        if (!(fields >> budget.stat >> budget.limit >> tolerance) || (fields >> rest) ||
+            !tolerance.ends_with('%')) {
+            std::printf("%s:%d: expected \"<measurement> <stat> <limit> <tolerance>%%\"\n",
+                        path.string().c_str(), number);
+            return std::nullopt;
+        }
+        budget.tolerance_pct = std::strtod(tolerance.c_str(), nullptr);
+        budgets.push_back(std::move(budget));
+    }
+    return budgets;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    auto index = static_cast<size_t>(p * static_cast<double>(sorted.size()));
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+double Measurement::minMs() const {
+    return runs_ms.empty() ? 0.0 : *std::ranges::min_element(runs_ms);
+}
+
+double Measurement::medianMs() const {
+    if (runs_ms.empty()) {
+        return 0.0;
+    }
+    auto sorted = runs_ms;
+    std::ranges::sort(sorted);
+    size_t mid = sorted.size() / 2;
+    return sorted.size() % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+double Measurement::meanMs() const {
+    if (runs_ms.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(runs_ms.begin(), runs_ms.end(), 0.0) /
+           static_cast<double>(runs_ms.size());
+}
+
+double Measurement::itemsPerSecond() const {
+    double median = medianMs();
+    return median > 0.0 ? static_cast<double>(items) * 1000.0 / median : 0.0;
+}
+
+Harness::Harness(Options options) : options_(std::move(options)) {
+    options_.repeat = std::max(options_.repeat, 1);
+}
+
+bool Harness::selected(const std::string& name) const {
+    return name.starts_with(options_.filter);
+}
+
+bool Harness::wantsGroup(const std::string& prefix) const {
+    return prefix.starts_with(options_.filter) || options_.filter.starts_with(prefix);
+}
+
+void Harness::measure(const std::string& name, uint64_t items, const std::function<void()>& setup,
+                      const std::function<void()>& body, Unit unit) {
+    if (!selected(name)) {
+        return;
+    }
+
+    Measurement measurement{.name = name, .items = items, .unit = unit};
+    for (int run = 0; run <= options_.repeat; ++run) {
+        if (setup) {
+            setup();
+        }
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+        if (run > 0) {  // Run 0 warms up
+            measurement.runs_ms.push_back(ms);
+        }
+    }
+
+    std::printf("%-44s %10.3f ms  %s\n", name.c_str(), measurement.medianMs(),
+                format_rate(measurement).c_str());
+    std::fflush(stdout);
+    results_.push_back(std::move(measurement));
+}
+
+void Harness::addMetrics(const std::string& name,
+                         std::vector<std::pair<std::string, double>> metrics) {
+    auto it = std::ranges::find(results_, name, &Measurement::name);
+    if (it == results_.end()) {
+        return;
+    }
+    for (const auto& [key, value] : metrics) {
+        std::printf("    %-40s %14.3f\n", key.c_str(), value);
+    }
+    std::fflush(stdout);
+    it->metrics.insert(it->metrics.end(), std::make_move_iterator(metrics.begin()),
+                       std::make_move_iterator(metrics.end()));
+}
+
+bool Harness::writeJson(const std::filesystem::path& path) const {
+    std::string json = "{\n  \"version\": ";
+    append_json_string(json, NIVE_VERSION_STRING);
+    json += ",\n  \"git\": ";
+    append_json_string(json, NIVE_GIT_HASH);
+    json += ",\n  \"timestamp\": ";
+    append_json_string(json, std::format("{:%FT%TZ}", std::chrono::floor<std::chrono::seconds>(
+                                                          std::chrono::system_clock::now())));
+    json += std::format(",\n  \"hardware_threads\": {},\n  \"repeat\": {},\n  \"full\": {},\n",
+                        std::thread::hardware_concurrency(), options_.repeat, options_.full);
+    json += "  \"results\": [";
+
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const auto& result = results_[i];
+        json += i == 0 ? "\n    {\"name\": " : ",\n    {\"name\": ";
+        append_json_string(json, result.name);
+        json += std::format(", \"items\": {}, \"unit\": ", result.items);
+        append_json_string(json, unit_name(result.unit));
+        json += ", \"runs_ms\": [";
+        for (size_t run = 0; run < result.runs_ms.size(); ++run) {
+            json += std::format("{}{:.3f}", run == 0 ? "" : ", ", result.runs_ms[run]);
+        }
+        json += std::format(
+            "], \"min_ms\": {:.3f}, \"median_ms\": {:.3f}, \"mean_ms\": {:.3f}, "
+            "\"items_per_second\": {:.1f}",
+            result.minMs(), result.medianMs(), result.meanMs(), result.itemsPerSecond());
+        if (!result.metrics.empty()) {
+            json += ", \"metrics\": {";
+            for (size_t m = 0; m < result.metrics.size(); ++m) {
+                json += m == 0 ? "" : ", ";
+                append_json_string(json, result.metrics[m].first);
+                json += std::format(": {:.3f}", result.metrics[m].second);
+            }
+            json += '}';
+        }
+        json += '}';
+    }
+    json += "\n  ]\n}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file && file.write(json.data(), static_cast<std::streamsize>(json.size()));
+}
+
+size_t Harness::checkBudgets(const std::vector<Budget>& budgets) const {
+    size_t failed = 0;
+    for (const auto& budget : budgets) {
+        if (!selected(budget.name)) {
+            continue;
+        }
+        auto label = std::format("{} {}", budget.name, budget.stat);
+        auto it = std::ranges::find(results_, budget.name, &Measurement::name);
+        auto value = it != results_.end() ? stat_value(*it, budget.stat) : std::nullopt;
+        if (!value) {
+            std::printf("FAIL %-52s not measured\n", label.c_str());
+            ++failed;
+            continue;
+        }
+        double ceiling = budget.limit * (1.0 + budget.tolerance_pct / 100.0);
+        bool ok = *value <= ceiling;
+        std::printf("%s %-52s %12.3f (budget %.3f, +%.0f%% = %.3f)\n", ok ? "ok  " : "FAIL",
+                    label.c_str(), *value, budget.limit, budget.tolerance_pct, ceiling);
+        failed += ok ? 0 : 1;
+    }
+    std::fflush(stdout);
+    return failed;
+}
+
+}  // namespace nive::bench
@@ -0,0 +1,129 @@
+/// @file bench_harness.hpp
+/// @brief Timing loop and JSON report for nive_bench
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nive::bench {
+
+/// @brief Command line options
+struct Options {
+    std::filesystem::path output = "nive_bench.json";
+    std::filesystem::path work_dir;      // Synthetic corpus and cache (default: %TEMP%\nive_bench)
+    std::filesystem::path extra_corpus;  // Real images added to the thumbnail scenario (optional)
+    int repeat = 5;                      // Timed runs per measurement, after one warm-up
+    bool full = false;                   // Larger corpora and entry counts
+    std::string filter;                  // Only measurements whose name starts with this
+    std::vector<int> load_threads = {1, 4, 16};  // Worker counts of the cache load test
+    std::filesystem::path budgets;       // Budget file checked after the run (optional)
+};
+
+/// @brief What the items of a measurement count
+///
+/// Pixels and bytes are reported as MP/s and MB/s (10^6 per second), so
+/// kernels are compared on throughput rather than call time.
+enum class Unit { Items, Pixels, Bytes };
+
+/// @brief Timings of one measurement
+struct Measurement {
+    std::string name;           // "scenario/variant", e.g. "sort/natural/100000"
+    uint64_t items = 0;         // Work items per run (files, entries, lookups, pixels, bytes)
+    Unit unit = Unit::Items;
+    std::vector<double> runs_ms;
+    std::vector<std::pair<std::string, double>> metrics;  // Extra values, e.g. "get_p99_us"
+
+    [[nodiscard]] double minMs() const;
+    [[nodiscard]] double medianMs() const;
+    [[nodiscard]] double meanMs() const;
+
+    /// @brief Items per second at the median run time
+    [[nodiscard]] double itemsPerSecond() const;
+};
+
+/// @brief Upper limit on one value of a measurement
+///
+/// stat is min_ms, median_ms, ms_per_item (median over items) or the name
+/// of a metric. The check passes while the value is within limit plus
+/// tolerance_pct percent; the band absorbs run-to-run noise on the
+/// reference machine.
+struct Budget {
+    std::string name;  // Measurement name
+    std::string stat;
+    double limit = 0.0;
+    double tolerance_pct = 0.0;
+};
+
+/// @brief Read a budget file
+///
+/// One budget per line, "<measurement> <stat> <limit> <tolerance>%"; text
+/// after '#' is a comment.
+/// @return Budgets, or nullopt (after printing the line) if a line is malformed
+[[nodiscard]] std::optional<std::vector<Budget>> loadBudgets(const std::filesystem::path& path);
+
+/// @brief Value at a percentile of samples sorted in ascending order (0 if empty)
+[[nodiscard]] double percentile(const std::vector<double>& sorted, double p);
+
+/// @brief Runs measurements and collects their results
+///
+/// Every measurement runs once untimed to warm up, then Options::repeat
+/// times. setup runs before each run, outside the timing, so a run can
+/// start from a known state (an emptied memory cache, an unsorted copy).
+class Harness {
+public:
+    explicit Harness(Options options);
+
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+    /// @brief Check if a measurement is selected by --filter
+    [[nodiscard]] bool selected(const std::string& name) const;
+
+    /// @brief Check if --filter may select a measurement under a name prefix
+    [[nodiscard]] bool wantsGroup(const std::string& prefix) const;
+
+    /// @brief Time body, printing a summary line
+    /// @param name Measurement name
+    /// @param items Work items one run of body processes
+    /// @param setup Untimed preparation before each run (may be empty)
+    /// @param body Timed work
+    /// @param unit What items counts
+    void measure(const std::string& name, uint64_t items, const std::function<void()>& setup,
+                 const std::function<void()>& body, Unit unit = Unit::Items);
+
+    /// @brief Attach extra values to a measurement taken earlier, printing them
+    /// @param name Measurement name (ignored if it was not measured)
+    /// @param metrics Name and value pairs; units belong in the names
+    void addMetrics(const std::string& name,
+                    std::vector<std::pair<std::string, double>> metrics);
+
+    /// @brief Write the collected results
+    /// @return false if the file could not be written
+    [[nodiscard]] bool writeJson(const std::filesystem::path& path) const;
+
+    /// @brief Check the results against budgets, printing each verdict
+    ///
+    /// Budgets of measurements --filter deselects are skipped; a selected
+    /// one that was not measured (skipped, renamed) fails.
+    /// @return Number of budgets exceeded or not measured
+    [[nodiscard]] size_t checkBudgets(const std::vector<Budget>& budgets) const;
+
+private:
+    Options options_;
+    std::vector<Measurement> results_;
+};
+
+/// @brief Run every scenario
+void runThumbnailScenarios(Harness& harness);
+void runCacheScenarios(Harness& harness);
+void runDirectoryScenarios(Harness& harness);
+void runArchiveScenarios(Harness& harness);
+void runKernelScenarios(Harness& harness);
+void runCacheLoadScenarios(Harness& harness);
+
+}  // namespace nive::bench
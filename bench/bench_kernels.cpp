@@ -0,0 +1,270 @@
+/// @file bench_kernels.cpp
+/// @brief Micro-benchmarks of the per-pixel and per-byte kernels
+///
+/// Throughput numbers for the choices that are otherwise guesses: the
+/// ScaleMode used for thumbnails and the viewer, the zstd level and JPEG
+/// quality of cached payloads, the pixel layout conversions plugins go
+/// through, and cache key hashing. Inputs are built in memory, so these
+/// measure the kernels alone, without file I/O or decoding.
+
+#include <array>
+#include <cstdio>
+#include <format>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "cache/payload_codec.hpp"
+#include "cache/thumbnail_data.hpp"
+#include "corpus.hpp"
+#include "image/image_scaler.hpp"
+#include "image/pixel_convert.hpp"
+
+namespace nive::bench {
+
+namespace {
+
+/// @brief Scaler input: a camera-sized frame
+constexpr uint32_t kSourceWidth = 4000;
+constexpr uint32_t kSourceHeight = 3000;
+
+/// @brief Encoded thumbnails per payload run, and their size
+constexpr size_t kPayloadCount = 64;
+constexpr uint32_t kPayloadWidth = 256;
+constexpr uint32_t kPayloadHeight = 192;
+
+struct NamedMode {
+    std::string_view name;
+    image::ScaleMode mode;
+};
+
+constexpr std::array<NamedMode, 8> kScaleModes = {{
+    {"nearest", image::ScaleMode::NearestNeighbor},
+    {"linear", image::ScaleMode::Linear},
+    {"cubic", image::ScaleMode::Cubic},
+    {"hq_cubic", image::ScaleMode::HighQualityCubic},
+    {"fant", image::ScaleMode::Fant},
+    {"box", image::ScaleMode::Box},
+    {"area", image::ScaleMode::Area},
+    {"lanczos", image::ScaleMode::Lanczos},
+}};
+
+constexpr std::array<int, 6> kZstdLevels = {1, 3, 6, 9, 12, 19};
+
+uint64_t pixels_of(const image::DecodedImage& image) {
+    return static_cast<uint64_t>(image.width()) * image.height();
+}
+
+/// @brief Source image of another layout, filled with reproducible values
+image::DecodedImage make_source(image::PixelFormat format) {
+    image::DecodedImage image(kSourceWidth, kSourceHeight, format);
+    std::minstd_rand noise(0x4B45524E);
+    size_t row_bytes = static_cast<size_t>(kSourceWidth) * image::bytesPerPixel(format);
+    for (uint32_t y = 0; y < kSourceHeight; ++y) {
+        uint8_t* row = image.row(y);
+        if (format == image::PixelFormat::RGBA16F) {
+            // Halves in [0.5, 1.0): no NaNs or denormals to skew the timing
+            auto* halves = reinterpret_cast<uint16_t*>(row);
+            for (size_t i = 0; i < row_bytes / 2; ++i) {
+                halves[i] = static_cast<uint16_t>(0x3800 | (noise() & 0x3FF));
+            }
+        } else {
+            for (size_t i = 0; i < row_bytes; ++i) {
+                row[i] = static_cast<uint8_t>(noise());
+            }
+        }
+    }
+    return image;
+}
+
+void run_scale(Harness& harness) {
+    if (!harness.wantsGroup("kernel/scale")) {
+        return;
+    }
+    auto source = corpus::syntheticImage(kSourceWidth, kSourceHeight);
+    auto size = std::format("{}x{}", kSourceWidth, kSourceHeight);
+
+    for (const auto& [name, mode] : kScaleModes) {
+        image::ScaleOptions options{.mode = mode};
+        bool ok = true;
+        harness.measure(
+            std::format("kernel/scale/{}/{}", name, size), pixels_of(source), {},
+            [&] { ok = image::scaleImage(source, 256, 256, options).has_value(); }, Unit::Pixels);
+        if (!ok) {
+            std::printf("kernel/scale/%.*s: scaling failed\n", static_cast<int>(name.size()),
+                        name.data());
+        }
+    }
+
+    // Viewer fit: halve a large frame across the pool
+    for (auto mode : {image::ScaleMode::Area, image::ScaleMode::Lanczos}) {
+        image::ScaleOptions options{.mode = mode, .fit = image::FitMode::Fill};
+        harness.measure(
+            std::format("kernel/scale_parallel/{}/{}",
+                        mode == image::ScaleMode::Area ? "area" : "lanczos", size),
+            pixels_of(source), {},
+            [&] {
+                (void)image::scaleImageParallel(source, kSourceWidth / 2, kSourceHeight / 2,
+                                                options);
+            },
+            Unit::Pixels);
+    }
+}
+
+/// @brief Encode and decode a batch of thumbnails with one codec setting
+void measure_payload(Harness& harness, const std::string& variant,
+                     const cache::PayloadOptions& options,
+                     const std::vector<image::DecodedImage>& thumbnails) {
+    auto encode_name = std::format("kernel/payload/encode/{}", variant);
+    auto decode_name = std::format("kernel/payload/decode/{}", variant);
+    if (!harness.selected(encode_name) && !harness.selected(decode_name)) {
+        return;
+    }
+
+    cache::PayloadCodec codec(options);
+    uint64_t raw_bytes = 0;
+    for (const auto& thumbnail : thumbnails) {
+        raw_bytes += thumbnail.sizeBytes();
+    }
+
+    std::vector<cache::EncodedPayload> payloads(thumbnails.size());
+    auto encode_all = [&] {
+        for (size_t i = 0; i < thumbnails.size(); ++i) {
+            const auto& thumbnail = thumbnails[i];
+            auto encoded = codec.encode({thumbnail.data(), thumbnail.sizeBytes()},
+                                        thumbnail.width(), thumbnail.height());
+            payloads[i] = encoded ? std::move(*encoded) : cache::EncodedPayload{};
+        }
+    };
+    harness.measure(encode_name, raw_bytes, {}, encode_all, Unit::Bytes);
+    if (payloads.front().data.empty()) {
+        encode_all();  // Decoding needs the payloads even when encoding was filtered out
+    }
+
+    uint64_t stored_bytes = 0;
+    for (const auto& payload : payloads) {
+        stored_bytes += payload.data.size();
+    }
+    size_t failed = 0;
+    harness.measure(
+        decode_name, raw_bytes, {},
+        [&] {
+            failed = 0;
+            for (size_t i = 0; i < payloads.size(); ++i) {
+                if (!codec.decode(payloads[i].format, payloads[i].data, thumbnails[i].width(),
+                                  thumbnails[i].height())) {
+                    ++failed;
+                }
+            }
+        },
+        Unit::Bytes);
+
+    std::printf("  %s: %.1f%% of raw size%s\n", variant.c_str(),
+                raw_bytes ? 100.0 * static_cast<double>(stored_bytes) /
+                                static_cast<double>(raw_bytes)
+                          : 0.0,
+                failed ? ", some payloads failed to decode" : "");
+}
+
+void run_payload(Harness& harness) {
+    if (!harness.wantsGroup("kernel/payload")) {
+        return;
+    }
+    std::vector<image::DecodedImage> thumbnails;
+    thumbnails.reserve(kPayloadCount);
+    for (size_t i = 0; i < kPayloadCount; ++i) {
+        thumbnails.push_back(corpus::syntheticImage(kPayloadWidth, kPayloadHeight, i));
+    }
+
+    for (int level : kZstdLevels) {
+        measure_payload(harness, std::format("zstd{}", level),
+                        {.compression_level = level, .jpeg_quality = 0}, thumbnails);
+    }
+    for (int quality : {75, 85, 95}) {
+        measure_payload(harness, std::format("jpeg{}", quality), {.jpeg_quality = quality},
+                        thumbnails);
+    }
+}
+
+void run_convert(Harness& harness) {
+    if (!harness.wantsGroup("kernel/convert")) {
+        return;
+    }
+    auto size = std::format("{}x{}", kSourceWidth, kSourceHeight);
+    image::DecodedImage target(kSourceWidth, kSourceHeight, image::PixelFormat::BGRA32);
+
+    // Row kernels, as the plugin bridge runs them (RGBA is the common plugin layout)
+    struct RowCase {
+        std::string_view name;
+        image::PixelFormat from;
+    };
+    for (const auto& row_case : {RowCase{"rgba_to_bgra", image::PixelFormat::RGBA32},
+                                 RowCase{"rgb_to_bgra", image::PixelFormat::RGB24},
+                                 RowCase{"gray_to_bgra", image::PixelFormat::Gray8}}) {
+        auto bench_name = std::format("kernel/convert/{}/{}", row_case.name, size);
+        if (!harness.selected(bench_name)) {
+            continue;
+        }
+        auto source = make_source(row_case.from);
+        harness.measure(
+            bench_name, pixels_of(source), {},
+            [&] {
+                (void)image::convertPixels(source.data(), source.stride(), row_case.from,
+                                           target.data(), target.stride(),
+                                           image::PixelFormat::BGRA32, kSourceWidth,
+                                           kSourceHeight);
+            },
+            Unit::Pixels);
+    }
+
+    // High-precision sources reduced to 8 bits for display
+    for (const auto& row_case : {RowCase{"rgba64_to_bgra", image::PixelFormat::RGBA64},
+                                 RowCase{"rgba16f_to_bgra", image::PixelFormat::RGBA16F}}) {
+        auto bench_name = std::format("kernel/convert/{}/{}", row_case.name, size);
+        if (!harness.selected(bench_name)) {
+            continue;
+        }
+        auto source = make_source(row_case.from);
+        harness.measure(
+            bench_name, pixels_of(source), {},
+            [&] { (void)image::convertPixelFormat(source, image::PixelFormat::BGRA32); },
+            Unit::Pixels);
+    }
+}
+
+void run_cache_key(Harness& harness) {
+    size_t count = harness.options().full ? 1000000 : 100000;
+    auto name = std::format("kernel/cache_key/{}", count);
+    if (!harness.selected(name)) {
+        return;
+    }
+    auto entries = corpus::syntheticEntries(count);
+    size_t empty = 0;
+    harness.measure(name, count, {}, [&] {
+        empty = 0;
+        for (const auto& entry : entries) {
+            empty += cache::generateCacheKey(entry).empty();
+        }
+    });
+    if (empty) {
+        std::printf("%s: %zu empty keys\n", name.c_str(), empty);
+    }
+}
+
+}  // namespace
+
+void runKernelScenarios(Harness& harness) {
+    if (!harness.wantsGroup("kernel/")) {
+        return;
+    }
+    run_scale(harness);
+    run_payload(harness);
+    run_convert(harness);
+    run_cache_key(harness);
+}
+
+}  // namespace nive::bench
@@ -0,0 +1,133 @@
+/// @file bench_main.cpp
+/// @brief nive_bench entry point: parse options, run scenarios, write JSON
+///
+/// Usage:
+///   nive_bench [--out <file>] [--work-dir <dir>] [--corpus <dir>]
+///              [--repeat <n>] [--full] [--filter <prefix>] [--threads <n,n,...>]
+///              [--budgets <file>]
+///
+/// --corpus adds real images (e.g. WebP and AVIF, which the synthetic corpus
+/// cannot encode) to the thumbnail scenario, grouped by extension. --filter
+/// runs only measurements whose name starts with the prefix, such as
+/// "thumbnail/jpeg", "sort/natural" or "kernel/" (the micro-benchmarks).
+/// --threads sets the worker counts of the cache database load test
+/// ("cache_db/load/<n>t"; default 1,4,16). --budgets checks the results
+/// against a budget file (bench/budgets) and exits with 3 if any is
+/// exceeded, which is how CTest runs the performance gates.
+
+#include <Windows.h>
+
+#include <objbase.h>
+
+#include <cstdio>
+#include <cwchar>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "util/logger.hpp"
+#include "util/string_utils.hpp"
+
+namespace {
+
+void print_usage() {
+    std::printf("Usage: nive_bench [--out <file>] [--work-dir <dir>] [--corpus <dir>]\n"
+                "                  [--repeat <n>] [--full] [--filter <prefix>]\n"
+                "                  [--threads <n,n,...>] [--budgets <file>]\n");
+}
+
+}  // namespace
+
+int wmain(int argc, wchar_t** argv) {
+    nive::bench::Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::wstring_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == L"--out" && has_value) {
+            options.output = argv[++i];
+        } else if (arg == L"--work-dir" && has_value) {
+            options.work_dir = argv[++i];
+        } else if (arg == L"--corpus" && has_value) {
+            options.extra_corpus = argv[++i];
+        } else if (arg == L"--repeat" && has_value) {
+            options.repeat = static_cast<int>(std::wcstol(argv[++i], nullptr, 10));
+        } else if (arg == L"--full") {
+            options.full = true;
+        } else if (arg == L"--filter" && has_value) {
+            options.filter = nive::wideToUtf8OrEmpty(argv[++i]);
+        } else if (arg == L"--budgets" && has_value) {
+            options.budgets = argv[++i];
+        } else if (arg == L"--threads" && has_value) {
+            options.load_threads.clear();
+            for (const wchar_t* p = argv[++i]; *p; ++p) {  // ++p skips the comma
+                wchar_t* end = nullptr;
+                long threads = std::wcstol(p, &end, 10);
+                if (end == p) {
+                    break;
+                }
+                options.load_threads.push_back(static_cast<int>(threads));
+                p = end;
+                if (*p != L',') {
+                    break;
+                }
+            }
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    std::vector<nive::bench::Budget> budgets;
+    if (!options.budgets.empty()) {
+        auto loaded = nive::bench::loadBudgets(options.budgets);
+        if (!loaded) {
+            return 2;
+        }
+        budgets = std::move(*loaded);
+    }
+    if (options.work_dir.empty()) {
+        std::error_code ec;
+        options.work_dir = std::filesystem::temp_directory_path(ec) / "nive_bench";
+    }
+
+    // Keep the decoders' and cache's own logging out of the timings
+    spdlog::set_level(spdlog::level::warn);
+
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::printf("COM initialization failed: 0x%08lX\n", static_cast<unsigned long>(hr));
+        return 1;
+    }
+
+    std::printf("nive_bench: work dir %s, %d runs per measurement%s\n",
+                nive::pathToUtf8(options.work_dir).c_str(), options.repeat,
+                options.full ? ", full corpus" : "");
+
+    int exit_code = 0;
+    {
+        nive::bench::Harness harness(options);
+        nive::bench::runThumbnailScenarios(harness);
+        nive::bench::runCacheScenarios(harness);
+        nive::bench::runDirectoryScenarios(harness);
+        nive::bench::runArchiveScenarios(harness);
+        nive::bench::runCacheLoadScenarios(harness);
+        nive::bench::runKernelScenarios(harness);
+
+        if (harness.writeJson(options.output)) {
+            std::printf("Results written to %s\n", nive::pathToUtf8(options.output).c_str());
+        } else {
+            std::printf("Failed to write %s\n", nive::pathToUtf8(options.output).c_str());
+            exit_code = 1;
+        }
+        if (!budgets.empty()) {
+            size_t failed = harness.checkBudgets(budgets);
+            std::printf("%zu of %zu budgets exceeded\n", failed, budgets.size());
+            exit_code = failed ? 3 : exit_code;
+        }
+    }
+
+    CoUninitialize();
+    return exit_code;
+}
@@ -0,0 +1,344 @@
+/// @file bench_scenarios.cpp
+/// @brief The measured scenarios: thumbnails, cache, directory listing, archives
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <latch>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "archive/archive_manager.hpp"
+#include "bench_harness.hpp"
+#include "cache/cache_manager.hpp"
+#include "corpus.hpp"
+#include "fs/directory.hpp"
+#include "thumbnail/thumbnail_generator.hpp"
+#include "util/string_utils.hpp"
+
+namespace nive::bench {
+
+namespace {
+
+using corpus::ImageFormat;
+using corpus::syntheticEntries;
+using corpus::writeEmptyFiles;
+using corpus::writeImages;
+
+constexpr uint32_t kThumbnailSize = 256;
+
+/// @brief Source image size and how many files of it one run generates
+struct CorpusSize {
+    uint32_t width;
+    uint32_t height;
+    size_t quick_count;
+    size_t full_count;
+};
+
+// Fewer files as they grow, so every size takes comparable time
+constexpr std::array kCorpusSizes = {
+    CorpusSize{640, 480, 32, 128},
+    CorpusSize{1920, 1080, 16, 64},
+    CorpusSize{4000, 3000, 4, 16},
+    CorpusSize{6000, 4000, 2, 8},  // 24 MP, the budgeted size
+    CorpusSize{8000, 6000, 0, 4},  // Full runs only
+};
+
+/// @brief Request every file's thumbnail and wait for all of them
+/// @return Number of requests that failed
+size_t generate_all(thumbnail::ThumbnailGenerator& generator,
+                    const std::vector<std::filesystem::path>& files) {
+    std::latch done(static_cast<std::ptrdiff_t>(files.size()));
+    std::atomic<size_t> failed{0};
+    for (const auto& file : files) {
+        (void)generator.request(
+            file,
+            [&done, &failed](thumbnail::ThumbnailResult result) {
+                if (!result.success()) {
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                }
+                done.count_down();
+            },
+            thumbnail::Priority::Normal, kThumbnailSize);
+    }
+    done.wait();
+    return failed.load();
+}
+
+void report_failures(const std::string& name, size_t failed) {
+    if (failed > 0) {
+        std::printf("%s: %zu thumbnails failed\n", name.c_str(), failed);
+    }
+}
+
+/// @brief Files under --corpus, grouped by lowercase extension
+std::map<std::string, std::vector<std::filesystem::path>>
+external_corpus(const std::filesystem::path& root) {
+    std::map<std::string, std::vector<std::filesystem::path>> groups;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(root, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        std::string extension = pathToUtf8(it->path().extension());
+        std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        if (extension.size() > 1) {
+            groups[extension.substr(1)].push_back(it->path());
+        }
+    }
+    return groups;
+}
+
+/// @brief Synthetic cache key source for the i-th cached thumbnail
+std::filesystem::path cache_source(size_t i) {
+    return std::format(L"C:\\bench\\cache\\IMG_{:06}.jpg", i);
+}
+
+cache::SourceStamp cache_stamp(size_t i) {
+    return {.mtime = std::chrono::system_clock::time_point(std::chrono::hours(480000)),
+            .size_bytes = 1024 * 1024 + i};
+}
+
+}  // namespace
+
+void runThumbnailScenarios(Harness& harness) {
+    const auto& options = harness.options();
+    thumbnail::ThumbnailGenerator generator;  // No cache: every request decodes
+    generator.start();
+
+    for (auto format : {ImageFormat::Jpeg, ImageFormat::Png}) {
+        for (const auto& size : kCorpusSizes) {
+            size_t count = options.full ? size.full_count : size.quick_count;
+            auto name = std::format("thumbnail/{}/{}x{}", to_string(format), size.width,
+                                    size.height);
+            if (count == 0 || !harness.selected(name)) {
+                continue;
+            }
+            auto files = writeImages(options.work_dir / "images" / to_string(format), format,
+                                     size.width, size.height, count);
+            if (!files) {
+                std::printf("%s: skipped, corpus could not be written\n", name.c_str());
+                continue;
+            }
+            size_t failed = 0;
+            harness.measure(name, files->size(), {},
+                            [&] { failed = generate_all(generator, *files); });
+            report_failures(name, failed);
+        }
+    }
+
+    // WebP, AVIF and anything else without a WIC encoder come from --corpus
+    if (!options.extra_corpus.empty()) {
+        for (const auto& [extension, files] : external_corpus(options.extra_corpus)) {
+            auto name = std::format("thumbnail/corpus/{}", extension);
+            size_t failed = 0;
+            harness.measure(name, files.size(), {},
+                            [&] { failed = generate_all(generator, files); });
+            report_failures(name, failed);
+        }
+    }
+}
+
+void runCacheScenarios(Harness& harness) {
+    const auto& options = harness.options();
+    size_t count = options.full ? 4000 : 1000;
+    if (!harness.wantsGroup("cache/")) {
+        return;
+    }
+    auto database = options.work_dir / "cache" / "bench.db";
+    std::error_code ec;
+    std::filesystem::remove_all(database.parent_path(), ec);  // Every run starts empty
+    std::filesystem::create_directories(database.parent_path(), ec);
+
+    image::DecodedImage thumbnail(kThumbnailSize, kThumbnailSize * 3 / 4,
+                                  image::PixelFormat::BGRA32);
+    for (uint32_t y = 0; y < thumbnail.height(); ++y) {
+        uint8_t* row = thumbnail.row(y);
+        for (uint32_t x = 0; x < thumbnail.width(); ++x) {
+            row[x * 4 + 0] = static_cast<uint8_t>(x);
+            row[x * 4 + 1] = static_cast<uint8_t>(y);
+            row[x * 4 + 2] = static_cast<uint8_t>(x ^ y);
+            row[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    cache::CacheConfig config;
+    config.database_path = database;
+    config.max_entries = count * 2;
+    config.max_size_bytes = 8ULL * 1024 * 1024 * 1024;
+    // Room for every entry, so the warm pass never evicts
+    config.memory_cache_bytes = static_cast<uint64_t>(thumbnail.pixels().size()) * count * 2;
+
+    {
+        auto manager = cache::CacheManager::create(config);
+        if (!manager) {
+            std::printf("cache: skipped, database could not be created\n");
+            return;
+        }
+        auto& cache = **manager;
+        auto put_all = [&] {
+            for (size_t i = 0; i < count; ++i) {
+                (void)cache.putThumbnail(cache_source(i), thumbnail, 4000, 3000, cache_stamp(i));
+            }
+        };
+        auto name = std::format("cache/put/{}", count);
+        if (harness.selected(name)) {
+            harness.measure(name, count, {}, put_all);
+        } else {
+            put_all();  // The lookups below still need the entries
+        }
+    }  // Closing commits the queued writes
+
+    auto manager = cache::CacheManager::create(config);
+    if (!manager) {
+        return;
+    }
+    auto& cache = **manager;
+    auto lookup_all = [&] {
+        for (size_t i = 0; i < count; ++i) {
+            (void)cache.getThumbnail(cache_source(i), cache_stamp(i));
+        }
+    };
+    // Cold: memory tier emptied, so every lookup reads and decodes the stored payload
+    // (the OS file cache stays warm)
+    harness.measure(std::format("cache/cold/{}", count), count, [&] { cache.clearMemoryCache(); },
+                    lookup_all);
+
+    // Warm: served from the memory tier; each lookup is timed for the tail percentiles
+    auto warm_name = std::format("cache/warm/{}", count);
+    std::vector<double> lookup_us;
+    lookup_us.reserve(count);
+    harness.measure(warm_name, count, [&] { lookup_us.clear(); }, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            (void)cache.getThumbnail(cache_source(i), cache_stamp(i));
+            lookup_us.push_back(std::chrono::duration<double, std::micro>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+        }
+    });
+    std::ranges::sort(lookup_us);
+    harness.addMetrics(warm_name, {{"lookup_p50_us", percentile(lookup_us, 0.5)},
+                                   {"lookup_p99_us", percentile(lookup_us, 0.99)}});
+}
+
+void runDirectoryScenarios(Harness& harness) {
+    const auto& options = harness.options();
+
+    std::vector<size_t> scan_counts = {10000};
+    if (options.full) {
+        scan_counts.push_back(100000);
+    }
+    for (size_t count : scan_counts) {
+        auto name = std::format("scan/{}", count);
+        if (!harness.selected(name)) {
+            continue;
+        }
+        auto directory = options.work_dir / std::format("dir_{}", count);
+        if (!writeEmptyFiles(directory, count)) {
+            std::printf("%s: skipped, files could not be created\n", name.c_str());
+            continue;
+        }
+        harness.measure(name, count, {}, [&] { (void)fs::scanDirectory(directory); });
+    }
+
+    // Opening a large folder end to end, in the default order; budgeted, so it runs
+    // in quick mode too
+    constexpr size_t kScanSortCount = 100000;
+    auto scan_sort_name = std::format("scan_sort/natural/{}", kScanSortCount);
+    if (harness.selected(scan_sort_name)) {
+        auto directory = options.work_dir / std::format("dir_{}", kScanSortCount);
+        if (writeEmptyFiles(directory, kScanSortCount)) {
+            harness.measure(scan_sort_name, kScanSortCount, {}, [&] {
+                (void)fs::scanDirectory(directory, {}, fs::SortOrder::Natural);
+            });
+        } else {
+            std::printf("%s: skipped, files could not be created\n", scan_sort_name.c_str());
+        }
+    }
+
+    // Sorts run on synthetic listings, up to sizes not worth creating on disk
+    std::vector<size_t> sort_counts = {10000, 100000};
+    if (options.full) {
+        sort_counts.push_back(1000000);
+    }
+    constexpr std::array kOrders = {
+        std::pair{fs::SortOrder::Natural, "natural"},
+        std::pair{fs::SortOrder::Name, "name"},
+        std::pair{fs::SortOrder::Size, "size"},
+        std::pair{fs::SortOrder::Modified, "modified"},
+    };
+    for (size_t count : sort_counts) {
+        if (!harness.wantsGroup("sort/")) {
+            break;
+        }
+        auto entries = syntheticEntries(count);
+        std::vector<fs::FileMetadata> work;
+        for (const auto& [order, order_name] : kOrders) {
+            // Fresh copies carry no sort keys, so natural order pays for building them
+            harness.measure(std::format("sort/{}/{}", order_name, count), count,
+                            [&] { work = entries; }, [&] { fs::sortEntries(work, order); });
+        }
+    }
+}
+
+void runArchiveScenarios(Harness& harness) {
+    const auto& options = harness.options();
+    size_t count = options.full ? 400 : 100;
+    if (!harness.wantsGroup("archive/")) {
+        return;
+    }
+
+    auto images = writeImages(options.work_dir / "archive_src", ImageFormat::Jpeg, 1920, 1080,
+                              count);
+    auto zip = options.work_dir / std::format("bench_{}.zip", count);
+    if (!images) {
+        std::printf("archive: skipped, entries could not be written\n");
+        return;
+    }
+    if (auto error = corpus::writeArchive(zip, *images, corpus::ArchiveKind::ZipStored)) {
+        std::printf("archive: skipped, %s\n", error->c_str());
+        return;
+    }
+
+    std::unique_ptr<archive::ArchiveManager> archives;
+    harness.measure(
+        std::format("archive/list/{}", count), count,
+        [&] { archives = std::make_unique<archive::ArchiveManager>(); },
+        [&] { (void)archives->getImageEntries(zip); });
+    if (!archives) {
+        archives = std::make_unique<archive::ArchiveManager>();
+    }
+
+    auto entries = archives->getImageEntries(zip);
+    if (!entries || entries->empty()) {
+        std::printf("archive: skipped, archive could not be listed\n");
+        return;
+    }
+    std::vector<std::wstring> paths;
+    for (const auto& entry : *entries) {
+        paths.push_back(entry.path);
+    }
+
+    harness.measure(std::format("archive/extract_each/{}", count), paths.size(), {}, [&] {
+        for (const auto& path : paths) {
+            (void)archives->extractToMemory(archive::VirtualPath(zip, path));
+        }
+    });
+    harness.measure(std::format("archive/extract_batch/{}", count), paths.size(), {}, [&] {
+        auto discard = [](const std::wstring&, std::vector<uint8_t>) { return true; };
+        (void)archives->extractBatch(zip, paths, discard);
+    });
+}
+
+}  // namespace nive::bench
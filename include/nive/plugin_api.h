@@ -6,6 +6,12 @@
 ///
 /// Plugins are loaded dynamically at runtime and must export the
 /// required functions with C linkage.
+///
+/// The host calls a plugin's decoding functions (decode, decode_ex,
+/// get_image_info, decode_into, decode_hinted, free_image) from one thread
+/// at a time, not always the same one, unless the plugin declares in
+/// NivePluginInfo::threading (API 1.6) that they may run concurrently.
+/// get_info and can_decode must be safe to call while a decode runs.
 
 #ifndef NIVE_PLUGIN_API_H
 #define NIVE_PLUGIN_API_H
@@ -19,7 +25,7 @@ extern "C" {
 
 // Plugin API version
 #define NIVE_PLUGIN_API_VERSION_MAJOR 1
-#define NIVE_PLUGIN_API_VERSION_MINOR 0
+#define NIVE_PLUGIN_API_VERSION_MINOR 6
 
 // Export macro for plugin functions
 #ifdef _WIN32
@@ -37,6 +43,11 @@ typedef enum NivePixelFormat {
     NIVE_PIXEL_FORMAT_RGBA8 = 0,  // 4 bytes per pixel, RGBA order
     NIVE_PIXEL_FORMAT_RGB8 = 1,   // 3 bytes per pixel, RGB order
     NIVE_PIXEL_FORMAT_GRAY8 = 2,  // 1 byte per pixel, grayscale
+    // Since API 1.1: high-precision output for 10/12/16-bit and HDR sources
+    NIVE_PIXEL_FORMAT_RGBA16 = 3,   // 8 bytes per pixel, RGBA order, native-endian uint16_t
+    NIVE_PIXEL_FORMAT_RGBA16F = 4,  // 8 bytes per pixel, RGBA order, half floats (linear scRGB)
+    // Since API 1.2: the host's native order, only requested through decode_into
+    NIVE_PIXEL_FORMAT_BGRA8 = 5,  // 4 bytes per pixel, BGRA order, straight alpha
 } NivePixelFormat;
 
 // Error codes
@@ -49,6 +60,13 @@ typedef enum NivePluginError {
     NIVE_PLUGIN_ERROR_IO = 5,
 } NivePluginError;
 
+// Threading capabilities (API 1.6), combined in NivePluginInfo::threading
+// The decoding functions may run on several threads at once
+#define NIVE_PLUGIN_THREADING_REENTRANT 0x1u
+// Reentrant as long as each thread has state of its own, which the plugin keeps
+// thread-locally; the host calls nive_plugin_thread_detach before such a thread ends
+#define NIVE_PLUGIN_THREADING_PER_THREAD_STATE 0x2u
+
 // Plugin information structure
 typedef struct NivePluginInfo {
     uint32_t api_version_major;
@@ -59,6 +77,9 @@ typedef struct NivePluginInfo {
     const char* description;
     const char** supported_extensions;  // NULL-terminated array
     size_t extension_count;
+    // Since API 1.6; read only from plugins reporting api_version_minor 6 or later
+    uint32_t threading;        // NIVE_PLUGIN_THREADING_* flags (0 = one call at a time)
+    uint32_t max_concurrency;  // Most concurrent decoding calls when threaded (0 = no limit)
 } NivePluginInfo;
 
 // Decoded image result
@@ -69,6 +90,51 @@ typedef struct NiveDecodedImage {
     NivePixelFormat format;
 } NiveDecodedImage;
 
+// Image header information (API 1.2); the host zero-fills it before the call
+typedef struct NiveImageInfo {
+    uint32_t width;
+    uint32_t height;
+    NivePixelFormat format;  // Format nive_plugin_decode would return
+    // Since API 1.4
+    uint32_t frame_count;  // Frames or pages (0 = unknown, treated as 1)
+    int has_alpha;         // 1 if the image has an alpha channel
+} NiveImageInfo;
+
+// Decode hints (API 1.3); zero fields mean "no hint"
+typedef struct NiveDecodeHints {
+    // Size the host will display at; the plugin may return a smaller image as
+    // long as it still covers target_width x target_height when fitted inside
+    uint32_t target_width;
+    uint32_t target_height;
+    // Part of the source the host needs (region_width 0 = whole image)
+    uint32_t region_x;
+    uint32_t region_y;
+    uint32_t region_width;
+    uint32_t region_height;
+    // Since API 1.5: threads this decode may use (0 = NiveHostInfo::decode_threads).
+    // Only present when the host reported API 1.5 or later to nive_plugin_init_ex.
+    uint32_t max_threads;
+} NiveDecodeHints;
+
+// Host information for nive_plugin_init_ex (API 1.5)
+typedef struct NiveHostInfo {
+    uint32_t api_version_major;  // Host API version, to tell which struct fields exist
+    uint32_t api_version_minor;
+    // Threads a decode may use unless its hints say otherwise (at least 1). Decoders
+    // may keep state per thread or reuse it between calls; calls come from any thread.
+    uint32_t decode_threads;
+} NiveHostInfo;
+
+// What a hinted decode returned (API 1.3)
+typedef struct NiveDecodeInfo {
+    uint32_t source_width;  // Full image size
+    uint32_t source_height;
+    uint32_t region_x;  // Source rectangle the output covers (whole image if not cropped)
+    uint32_t region_y;
+    uint32_t region_width;
+    uint32_t region_height;
+} NiveDecodeInfo;
+
 /// Required: Get plugin information
 /// @return Pointer to static plugin info structure
 typedef const NivePluginInfo* (*NivePluginGetInfoFn)(void);
@@ -87,6 +153,69 @@ typedef int (*NivePluginCanDecodeFn)(const char* extension);
 typedef NivePluginError (*NivePluginDecodeFn)(const uint8_t* data, size_t data_size,
                                               const char* extension, NiveDecodedImage* out_image);
 
+/// Optional (API 1.1): Decode image from memory buffer, with a preferred output format
+/// @param data Input image data
+/// @param data_size Size of input data in bytes
+/// @param extension File extension hint (may be NULL)
+/// @param preferred_format Format the host would like (RGBA16/RGBA16F when it can show them);
+///        a hint only, any format may be returned
+/// @param out_image Output image structure (filled on success)
+/// @return NIVE_PLUGIN_OK on success, error code on failure
+typedef NivePluginError (*NivePluginDecodeExFn)(const uint8_t* data, size_t data_size,
+                                                const char* extension,
+                                                NivePixelFormat preferred_format,
+                                                NiveDecodedImage* out_image);
+
+/// Optional (API 1.2): Read image dimensions and format by parsing headers only
+/// @param data Input image data
+/// @param data_size Size of input data in bytes
+/// @param extension File extension hint (may be NULL)
+/// @param out_info Output information (filled on success)
+/// @return NIVE_PLUGIN_OK on success, error code on failure
+typedef NivePluginError (*NivePluginGetImageInfoFn)(const uint8_t* data, size_t data_size,
+                                                    const char* extension,
+                                                    NiveImageInfo* out_info);
+
+/// Optional (API 1.2): Decode image into a buffer owned by the host
+/// @param data Input image data
+/// @param data_size Size of input data in bytes
+/// @param extension File extension hint (may be NULL)
+/// @param format Exact format to write (BGRA8 for most images)
+/// @param pixels Destination, at least stride * height bytes
+/// @param stride Destination row stride in bytes (may exceed width * bytes per pixel)
+/// @param width Width reported by nive_plugin_get_image_info
+/// @param height Height reported by nive_plugin_get_image_info
+/// @return NIVE_PLUGIN_OK on success, NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT if the
+///         plugin cannot write the format (the host then calls nive_plugin_decode)
+///
+/// Lets the host skip copying and swizzling the plugin's own buffer. Plugins
+/// export it together with nive_plugin_get_image_info, which the host also
+/// uses on its own (API 1.4) wherever it only needs metadata.
+typedef NivePluginError (*NivePluginDecodeIntoFn)(const uint8_t* data, size_t data_size,
+                                                  const char* extension, NivePixelFormat format,
+                                                  uint8_t* pixels, size_t stride, uint32_t width,
+                                                  uint32_t height);
+
+/// Optional (API 1.3): Decode image from memory buffer, honouring size and region hints
+/// @param data Input image data
+/// @param data_size Size of input data in bytes
+/// @param extension File extension hint (may be NULL)
+/// @param preferred_format Format hint, as for nive_plugin_decode_ex
+/// @param hints What the host needs; any hint may be ignored
+/// @param out_image Output image structure (filled on success, freed with nive_plugin_free_image)
+/// @param out_info Source size and the region out_image covers (filled on success)
+/// @return NIVE_PLUGIN_OK on success, error code on failure
+///
+/// For codecs that can decode at reduced resolution or only part of an image
+/// (DCT scaling, progressive passes, grid tiles). out_image may have any size
+/// between the hinted one and the full region.
+typedef NivePluginError (*NivePluginDecodeHintedFn)(const uint8_t* data, size_t data_size,
+                                                    const char* extension,
+                                                    NivePixelFormat preferred_format,
+                                                    const NiveDecodeHints* hints,
+                                                    NiveDecodedImage* out_image,
+                                                    NiveDecodeInfo* out_info);
+
 /// Required: Free decoded image data
 /// @param image Image to free (pixels will be freed, structure is not freed)
 typedef void (*NivePluginFreeImageFn)(NiveDecodedImage* image);
@@ -95,9 +224,21 @@ typedef void (*NivePluginFreeImageFn)(NiveDecodedImage* image);
 /// @return NIVE_PLUGIN_OK on success, error code on failure
 typedef NivePluginError (*NivePluginInitFn)(void);
 
+/// Optional (API 1.5): Initialize plugin with host information; replaces nive_plugin_init
+/// @param host Host version and thread budget (valid for the call only)
+/// @return NIVE_PLUGIN_OK on success, error code on failure
+typedef NivePluginError (*NivePluginInitExFn)(const NiveHostInfo* host);
+
 /// Optional: Shutdown plugin (called once on unload)
 typedef void (*NivePluginShutdownFn)(void);
 
+/// Optional (API 1.6): Release the calling thread's state
+///
+/// Called on a host decode thread before it ends, for plugins declaring
+/// NIVE_PLUGIN_THREADING_PER_THREAD_STATE, whether or not the thread ever
+/// decoded with the plugin. May run while other threads decode.
+typedef void (*NivePluginThreadDetachFn)(void);
+
 /// Optional: Check if plugin has a settings dialog
 /// @return 1 if plugin has settings, 0 if not
 typedef int (*NivePluginHasSettingsFn)(void);
@@ -112,8 +253,14 @@ typedef NivePluginError (*NivePluginShowSettingsFn)(void* parent_hwnd);
 #define NIVE_PLUGIN_CAN_DECODE_NAME "nive_plugin_can_decode"
 #define NIVE_PLUGIN_DECODE_NAME "nive_plugin_decode"
 #define NIVE_PLUGIN_FREE_IMAGE_NAME "nive_plugin_free_image"
+#define NIVE_PLUGIN_DECODE_EX_NAME "nive_plugin_decode_ex"
+#define NIVE_PLUGIN_GET_IMAGE_INFO_NAME "nive_plugin_get_image_info"
+#define NIVE_PLUGIN_DECODE_INTO_NAME "nive_plugin_decode_into"
+#define NIVE_PLUGIN_DECODE_HINTED_NAME "nive_plugin_decode_hinted"
 #define NIVE_PLUGIN_INIT_NAME "nive_plugin_init"
+#define NIVE_PLUGIN_INIT_EX_NAME "nive_plugin_init_ex"
 #define NIVE_PLUGIN_SHUTDOWN_NAME "nive_plugin_shutdown"
+#define NIVE_PLUGIN_THREAD_DETACH_NAME "nive_plugin_thread_detach"
 #define NIVE_PLUGIN_HAS_SETTINGS_NAME "nive_plugin_has_settings"
 #define NIVE_PLUGIN_SHOW_SETTINGS_NAME "nive_plugin_show_settings"
 
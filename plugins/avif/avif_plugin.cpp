@@ -4,6 +4,8 @@
 #include <avif/avif.h>
 #include <nive/plugin_api.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 
@@ -15,109 +17,306 @@ const NivePluginInfo kPluginInfo = {
     .api_version_major = NIVE_PLUGIN_API_VERSION_MAJOR,
     .api_version_minor = NIVE_PLUGIN_API_VERSION_MINOR,
     .name = "AVIF Decoder",
-    .version = "1.0.0",
+    .version = "1.6.0",
     .author = "yuinshielAs",
     .description = "AVIF image decoder powered by libavif",
     .supported_extensions = kExtensions,
     .extension_count = 1,
+    // Every call creates its own avifDecoder; nothing is shared between calls
+    .threading = NIVE_PLUGIN_THREADING_REENTRANT,
+    .max_concurrency = 0,
 };
 
-}  // namespace
+// Thread budget from nive_plugin_init_ex; hosts before API 1.5 get one thread
+std::atomic<uint32_t> g_decode_threads{1};
 
-extern "C" {
+// Whether NiveDecodeHints from this host carry max_threads
+std::atomic<bool> g_hints_have_threads{false};
 
-NIVE_PLUGIN_API const NivePluginInfo* nive_plugin_get_info(void) {
-    return &kPluginInfo;
+/// @brief Threads for a decode: the hint if the host sends one, else the host's budget
+int decode_threads(const NiveDecodeHints* hints) {
+    uint32_t threads = g_decode_threads.load(std::memory_order_relaxed);
+    if (hints && g_hints_have_threads.load(std::memory_order_relaxed) && hints->max_threads > 0) {
+        threads = hints->max_threads;
+    }
+    return static_cast<int>(std::clamp(threads, 1u, 64u));
 }
 
-NIVE_PLUGIN_API int nive_plugin_can_decode(const char* extension) {
-    if (!extension) {
-        return 0;
+/// @brief Owns an avifDecoder that has parsed the container
+struct ParsedAvif {
+    avifDecoder* decoder = nullptr;
+
+    ParsedAvif() = default;
+    ParsedAvif(const ParsedAvif&) = delete;
+    ParsedAvif& operator=(const ParsedAvif&) = delete;
+    ~ParsedAvif() {
+        if (decoder) {
+            avifDecoderDestroy(decoder);
+        }
     }
-    // Case-insensitive comparison for ".avif"
-    if (_stricmp(extension, ".avif") == 0) {
-        return 1;
+};
+
+/// @brief Create a decoder and parse the container (no pixels are decoded)
+/// @param threads Worker threads for the AV1 decoder (row and tile parallelism)
+NivePluginError parse_avif(const uint8_t* data, size_t data_size, int threads,
+                           ParsedAvif& parsed) {
+    if (!data || data_size == 0) {
+        return NIVE_PLUGIN_ERROR_INVALID_DATA;
     }
-    return 0;
+
+    parsed.decoder = avifDecoderCreate();
+    if (!parsed.decoder) {
+        return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+    }
+    parsed.decoder->maxThreads = threads;
+    parsed.decoder->strictFlags = AVIF_STRICT_DISABLED;
+
+    if (avifDecoderSetIOMemory(parsed.decoder, data, data_size) != AVIF_RESULT_OK ||
+        avifDecoderParse(parsed.decoder) != AVIF_RESULT_OK) {
+        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    }
+    return NIVE_PLUGIN_OK;
 }
 
-NIVE_PLUGIN_API NivePluginError nive_plugin_decode(const uint8_t* data, size_t data_size,
-                                                    const char* extension,
-                                                    NiveDecodedImage* out_image) {
-    (void)extension;
+/// @brief Owns an avifImage (a view or scaled copy of the decoded frame)
+struct ImageHolder {
+    avifImage* image = nullptr;
 
-    if (!data || data_size == 0 || !out_image) {
-        return NIVE_PLUGIN_ERROR_INVALID_DATA;
+    ImageHolder() = default;
+    ImageHolder(const ImageHolder&) = delete;
+    ImageHolder& operator=(const ImageHolder&) = delete;
+    ~ImageHolder() {
+        if (image) {
+            avifImageDestroy(image);
+        }
     }
+};
 
-    avifDecoder* decoder = avifDecoderCreate();
-    if (!decoder) {
-        return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+/// @brief Integer reduction that still covers the target box when fitted inside
+/// @return Divisor of the region size, 1 if no reduction is possible
+uint32_t reduction_factor(uint32_t width, uint32_t height, uint32_t target_width,
+                          uint32_t target_height) {
+    if (target_width == 0 || target_height == 0) {
+        return 1;
+    }
+    // The fitted size is set by the tighter axis
+    double fit = std::min(static_cast<double>(target_width) / width,
+                          static_cast<double>(target_height) / height);
+    if (fit >= 0.5) {
+        return 1;
+    }
+    return static_cast<uint32_t>(1.0 / fit);
+}
+
+/// @brief Decode the first image, as RGBA16 when asked for and the source has more than 8 bits
+/// @param hints Region and size to reduce to (may be NULL)
+/// @param out_info Source size and region of the output (may be NULL)
+///
+/// The AV1 frame is always decoded whole; the region is cropped and the size
+/// reduced (libyuv box filter) before the YUV to RGB conversion, which is where
+/// most of the remaining time and memory goes for large images.
+/// High-bit-depth output keeps the encoded values (PQ and HLG transfers are
+/// not linearised); the host converts them for display.
+NivePluginError decode_avif(const uint8_t* data, size_t data_size,
+                            NivePixelFormat preferred_format, const NiveDecodeHints* hints,
+                            NiveDecodedImage* out_image, NiveDecodeInfo* out_info) {
+    if (!out_image) {
+        return NIVE_PLUGIN_ERROR_INVALID_DATA;
     }
 
-    // Configure decoder
-    decoder->maxThreads = 1;
-    decoder->strictFlags = AVIF_STRICT_DISABLED;
+    ParsedAvif parsed;
+    NivePluginError error = parse_avif(data, data_size, decode_threads(hints), parsed);
+    if (error != NIVE_PLUGIN_OK) {
+        return error;
+    }
+    avifDecoder* decoder = parsed.decoder;
 
-    avifResult result = avifDecoderSetIOMemory(decoder, data, data_size);
+    avifResult result = avifDecoderNextImage(decoder);
     if (result != AVIF_RESULT_OK) {
-        avifDecoderDestroy(decoder);
         return NIVE_PLUGIN_ERROR_DECODE_FAILED;
     }
+    avifImage* image = decoder->image;
 
-    result = avifDecoderParse(decoder);
-    if (result != AVIF_RESULT_OK) {
-        avifDecoderDestroy(decoder);
-        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    // Crop to the region (a view, no copy); chroma planes need even offsets
+    avifCropRect rect = {0, 0, image->width, image->height};
+    if (hints && hints->region_width > 0 && hints->region_height > 0 &&
+        hints->region_x < image->width && hints->region_y < image->height) {
+        rect.x = hints->region_x & ~1u;
+        rect.y = hints->region_y & ~1u;
+        rect.width = std::min(hints->region_x + hints->region_width, image->width) - rect.x;
+        rect.height = std::min(hints->region_y + hints->region_height, image->height) - rect.y;
     }
+    uint32_t factor = hints ? reduction_factor(rect.width, rect.height, hints->target_width,
+                                               hints->target_height)
+                            : 1;
 
-    result = avifDecoderNextImage(decoder);
-    if (result != AVIF_RESULT_OK) {
-        avifDecoderDestroy(decoder);
-        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    ImageHolder view;
+    if (rect.width != image->width || rect.height != image->height || factor > 1) {
+        view.image = avifImageCreateEmpty();
+        if (!view.image) {
+            return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+        }
+        if (avifImageSetViewRect(view.image, image, &rect) != AVIF_RESULT_OK) {
+            return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+        }
+        if (factor > 1) {
+            uint32_t width = std::max(rect.width / factor, 1u);
+            uint32_t height = std::max(rect.height / factor, 1u);
+            if (avifImageScale(view.image, width, height, &decoder->diag) != AVIF_RESULT_OK) {
+                return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+            }
+        }
     }
+    avifImage* source = view.image ? view.image : image;
 
-    // Convert YUV to RGBA8
+    // Convert YUV to RGBA8, or RGBA16 for 10/12-bit sources when the host can use it,
+    // straight into the buffer handed out (caller frees via nive_plugin_free_image)
+    bool high_precision = preferred_format != NIVE_PIXEL_FORMAT_RGBA8 && source->depth > 8;
     avifRGBImage rgb;
-    avifRGBImageSetDefaults(&rgb, decoder->image);
-    rgb.depth = 8;
+    avifRGBImageSetDefaults(&rgb, source);
+    rgb.depth = high_precision ? 16 : 8;
     rgb.format = AVIF_RGB_FORMAT_RGBA;
+    rgb.maxThreads = decoder->maxThreads;
+    rgb.rowBytes = rgb.width * (high_precision ? 8 : 4);  // RGBA16 / RGBA8, as the host expects
 
-    avifRGBImageAllocatePixels(&rgb);
+    auto* pixels = static_cast<uint8_t*>(std::malloc(static_cast<size_t>(rgb.rowBytes) *
+                                                     rgb.height));
+    if (!pixels) {
+        return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+    }
+    rgb.pixels = pixels;
 
-    result = avifImageYUVToRGB(decoder->image, &rgb);
+    result = avifImageYUVToRGB(source, &rgb);
     if (result != AVIF_RESULT_OK) {
-        avifRGBImageFreePixels(&rgb);
-        avifDecoderDestroy(decoder);
+        std::free(pixels);
         return NIVE_PLUGIN_ERROR_DECODE_FAILED;
     }
 
-    // Copy pixels to output buffer (caller frees via nive_plugin_free_image)
-    size_t total_size = static_cast<size_t>(rgb.rowBytes) * rgb.height;
-    auto* pixels = static_cast<uint8_t*>(std::malloc(total_size));
+    out_image->pixels = pixels;
+    out_image->width = rgb.width;
+    out_image->height = rgb.height;
+    out_image->format = high_precision ? NIVE_PIXEL_FORMAT_RGBA16 : NIVE_PIXEL_FORMAT_RGBA8;
+    if (out_info) {
+        *out_info = {image->width, image->height, rect.x, rect.y, rect.width, rect.height};
+    }
+
+    return NIVE_PLUGIN_OK;
+}
+
+/// @brief Decode the first image straight into a host buffer (BGRA8 or RGBA16)
+NivePluginError decode_avif_into(const uint8_t* data, size_t data_size, NivePixelFormat format,
+                                 uint8_t* pixels, size_t stride, uint32_t width, uint32_t height) {
+    if (format != NIVE_PIXEL_FORMAT_BGRA8 && format != NIVE_PIXEL_FORMAT_RGBA16) {
+        return NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT;
+    }
     if (!pixels) {
-        avifRGBImageFreePixels(&rgb);
-        avifDecoderDestroy(decoder);
-        return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+        return NIVE_PLUGIN_ERROR_INVALID_DATA;
     }
 
-    // Copy row by row in case of padding
-    uint32_t row_bytes = rgb.width * 4;  // RGBA8 = 4 bytes per pixel
-    for (uint32_t y = 0; y < rgb.height; ++y) {
-        std::memcpy(pixels + y * row_bytes, rgb.pixels + y * rgb.rowBytes, row_bytes);
+    ParsedAvif parsed;
+    NivePluginError error = parse_avif(data, data_size, decode_threads(nullptr), parsed);
+    if (error != NIVE_PLUGIN_OK) {
+        return error;
+    }
+    if (avifDecoderNextImage(parsed.decoder) != AVIF_RESULT_OK) {
+        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    }
+    avifImage* image = parsed.decoder->image;
+    if (image->width != width || image->height != height) {
+        return NIVE_PLUGIN_ERROR_INVALID_DATA;
     }
 
-    out_image->pixels = pixels;
-    out_image->width = rgb.width;
-    out_image->height = rgb.height;
-    out_image->format = NIVE_PIXEL_FORMAT_RGBA8;
+    // libavif writes YUV to RGB conversion output straight into the host's rows
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, image);
+    bool high_precision = format == NIVE_PIXEL_FORMAT_RGBA16;
+    rgb.depth = high_precision ? 16 : 8;
+    rgb.format = high_precision ? AVIF_RGB_FORMAT_RGBA : AVIF_RGB_FORMAT_BGRA;
+    rgb.pixels = pixels;
+    rgb.rowBytes = static_cast<uint32_t>(stride);
+    rgb.maxThreads = parsed.decoder->maxThreads;
+
+    if (avifImageYUVToRGB(image, &rgb) != AVIF_RESULT_OK) {
+        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    }
+    return NIVE_PLUGIN_OK;
+}
+
+}  // namespace
 
-    avifRGBImageFreePixels(&rgb);
-    avifDecoderDestroy(decoder);
+extern "C" {
 
+NIVE_PLUGIN_API const NivePluginInfo* nive_plugin_get_info(void) {
+    return &kPluginInfo;
+}
+
+NIVE_PLUGIN_API int nive_plugin_can_decode(const char* extension) {
+    if (!extension) {
+        return 0;
+    }
+    // Case-insensitive comparison for ".avif"
+    if (_stricmp(extension, ".avif") == 0) {
+        return 1;
+    }
+    return 0;
+}
+
+NIVE_PLUGIN_API NivePluginError nive_plugin_decode(const uint8_t* data, size_t data_size,
+                                                    const char* extension,
+                                                    NiveDecodedImage* out_image) {
+    (void)extension;
+    return decode_avif(data, data_size, NIVE_PIXEL_FORMAT_RGBA8, nullptr, out_image, nullptr);
+}
+
+NIVE_PLUGIN_API NivePluginError nive_plugin_decode_ex(const uint8_t* data, size_t data_size,
+                                                       const char* extension,
+                                                       NivePixelFormat preferred_format,
+                                                       NiveDecodedImage* out_image) {
+    (void)extension;
+    return decode_avif(data, data_size, preferred_format, nullptr, out_image, nullptr);
+}
+
+NIVE_PLUGIN_API NivePluginError nive_plugin_get_image_info(const uint8_t* data, size_t data_size,
+                                                            const char* extension,
+                                                            NiveImageInfo* out_info) {
+    (void)extension;
+    if (!out_info) {
+        return NIVE_PLUGIN_ERROR_INVALID_DATA;
+    }
+
+    ParsedAvif parsed;
+    NivePluginError error = parse_avif(data, data_size, 1, parsed);
+    if (error != NIVE_PLUGIN_OK) {
+        return error;
+    }
+    out_info->width = parsed.decoder->image->width;
+    out_info->height = parsed.decoder->image->height;
+    out_info->format = parsed.decoder->image->depth > 8 ? NIVE_PIXEL_FORMAT_RGBA16
+                                                        : NIVE_PIXEL_FORMAT_RGBA8;
+    out_info->frame_count = static_cast<uint32_t>(std::max(parsed.decoder->imageCount, 1));
+    out_info->has_alpha = parsed.decoder->alphaPresent ? 1 : 0;
     return NIVE_PLUGIN_OK;
 }
 
+NIVE_PLUGIN_API NivePluginError nive_plugin_decode_into(const uint8_t* data, size_t data_size,
+                                                         const char* extension,
+                                                         NivePixelFormat format, uint8_t* pixels,
+                                                         size_t stride, uint32_t width,
+                                                         uint32_t height) {
+    (void)extension;
+    return decode_avif_into(data, data_size, format, pixels, stride, width, height);
+}
+
+NIVE_PLUGIN_API NivePluginError nive_plugin_decode_hinted(const uint8_t* data, size_t data_size,
+                                                           const char* extension,
+                                                           NivePixelFormat preferred_format,
+                                                           const NiveDecodeHints* hints,
+                                                           NiveDecodedImage* out_image,
+                                                           NiveDecodeInfo* out_info) {
+    (void)extension;
+    return decode_avif(data, data_size, preferred_format, hints, out_image, out_info);
+}
+
 NIVE_PLUGIN_API void nive_plugin_free_image(NiveDecodedImage* image) {
     if (image && image->pixels) {
         std::free(image->pixels);
@@ -125,6 +324,15 @@ NIVE_PLUGIN_API void nive_plugin_free_image(NiveDecodedImage* image) {
     }
 }
 
+NIVE_PLUGIN_API NivePluginError nive_plugin_init_ex(const NiveHostInfo* host) {
+    if (host) {
+        g_decode_threads.store(std::max(host->decode_threads, 1u), std::memory_order_relaxed);
+        g_hints_have_threads.store(host->api_version_major == 1 && host->api_version_minor >= 5,
+                                   std::memory_order_relaxed);
+    }
+    return NIVE_PLUGIN_OK;
+}
+
 NIVE_PLUGIN_API int nive_plugin_has_settings(void) {
     return 0;
 }
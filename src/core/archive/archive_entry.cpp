@@ -4,50 +4,45 @@
 #include "archive_entry.hpp"
 
 #include <algorithm>
-#include <array>
-#include <cwctype>
+
+#include "../util/extension_table.hpp"
 
 namespace nive::archive {
 
 namespace {
 
 // Supported archive extensions
-constexpr std::array<std::pair<std::wstring_view, ArchiveFormat>, 10> kArchiveFormats = {
-    {{L".zip", ArchiveFormat::Zip},
-     {L".7z", ArchiveFormat::SevenZip},
-     {L".rar", ArchiveFormat::Rar},
-     {L".lzh", ArchiveFormat::Lzh},
-     {L".lha", ArchiveFormat::Lzh},
-     {L".tar", ArchiveFormat::Tar},
-     {L".gz", ArchiveFormat::GZip},
-     {L".tgz", ArchiveFormat::GZip},
-     {L".cbz", ArchiveFormat::Cbz},
-     {L".cbr", ArchiveFormat::Cbr}}
-};
+constexpr auto kArchiveFormats = makeExtensionTable<ArchiveFormat>({
+    {"zip", ArchiveFormat::Zip},
+    {"7z", ArchiveFormat::SevenZip},
+    {"rar", ArchiveFormat::Rar},
+    {"lzh", ArchiveFormat::Lzh},
+    {"lha", ArchiveFormat::Lzh},
+    {"tar", ArchiveFormat::Tar},
+    {"gz", ArchiveFormat::GZip},
+    {"tgz", ArchiveFormat::GZip},
+    {"cbz", ArchiveFormat::Cbz},
+    {"cbr", ArchiveFormat::Cbr},
+});
 
 // Image extensions for archive content detection
-constexpr std::array<std::wstring_view, 10> kImageExtensions = {
-    L".jpg", L".jpeg", L".png", L".gif", L".bmp", L".tiff", L".tif", L".webp", L".avif", L".jxr"};
+constexpr auto kImageExtensions = makeExtensionSet(
+    {"jpg", "jpeg", "png", "gif", "bmp", "tiff", "tif", "webp", "avif", "jxr"});
 
-[[nodiscard]] std::wstring to_lower(std::wstring_view str) {
-    std::wstring result(str);
-    std::transform(result.begin(), result.end(), result.begin(),
-                   [](wchar_t c) { return static_cast<wchar_t>(::towlower(c)); });
-    return result;
+/// @brief Get the extension of an entry name, dot included; empty for dotfiles
+[[nodiscard]] std::wstring_view extension_of(std::wstring_view name) noexcept {
+    auto pos = name.find_last_of(L'.');
+    if (pos == std::wstring_view::npos || pos == 0) {
+        return {};
+    }
+    return name.substr(pos);
 }
 
 }  // namespace
 
 ArchiveFormat detect_format(const std::filesystem::path& path) noexcept {
-    auto ext = to_lower(path.extension().wstring());
-
-    for (const auto& [archive_ext, format] : kArchiveFormats) {
-        if (ext == archive_ext) {
-            return format;
-        }
-    }
-
-    return ArchiveFormat::Unknown;
+    const ArchiveFormat* format = kArchiveFormats.find(path.extension().native());
+    return format ? *format : ArchiveFormat::Unknown;
 }
 
 bool is_supported_archive(const std::filesystem::path& path) noexcept {
@@ -63,11 +58,7 @@ std::wstring ArchiveEntry::parent_path() const {
 }
 
 std::wstring ArchiveEntry::extension() const {
-    auto pos = name.find_last_of(L'.');
-    if (pos == std::wstring::npos || pos == 0) {
-        return L"";
-    }
-    return name.substr(pos);
+    return std::wstring(extension_of(name));
 }
 
 bool ArchiveEntry::is_image() const noexcept {
@@ -75,13 +66,7 @@ bool ArchiveEntry::is_image() const noexcept {
         return false;
     }
 
-    auto ext = to_lower(extension());
-    for (const auto& image_ext : kImageExtensions) {
-        if (ext == image_ext) {
-            return true;
-        }
-    }
-    return false;
+    return kImageExtensions.contains(extension_of(name));
 }
 
 const ArchiveEntry* ArchiveInfo::find_entry(std::wstring_view entry_path) const {
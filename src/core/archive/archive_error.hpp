@@ -21,6 +21,7 @@ enum class ArchiveError {
     OutOfMemory,
     DllNotFound,    // 7z.dll not found
     DllLoadFailed,  // Failed to load 7z.dll
+    Cancelled,      // Stopped by a callback
     InternalError
 };
 
@@ -49,6 +50,8 @@ enum class ArchiveError {
         return "7z.dll not found";
     case ArchiveError::DllLoadFailed:
         return "Failed to load 7z.dll";
+    case ArchiveError::Cancelled:
+        return "Cancelled";
     case ArchiveError::InternalError:
         return "Internal error";
     default:
@@ -0,0 +1,168 @@
+/// @file archive_listing.cpp
+/// @brief Archive listing encoding
+///
+/// Little-endian, fixed-width fields: a header (magic, version, archive
+/// flags, entry count), then per entry its flags, attributes, CRC, path
+/// length in UTF-16 units, sizes and modification time, followed by the
+/// path itself. Entry names and totals are derived on decode.
+
+#include "archive_listing.hpp"
+#include <Windows.h>
+
+#include <cstring>
+#include <string>
+
+namespace nive::archive {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4C41564E;  // "NVAL"
+constexpr uint32_t kVersion = 1;
+
+// Archive flags
+constexpr uint32_t kArchiveEncrypted = 1u << 0;
+constexpr uint32_t kArchiveSolid = 1u << 1;
+constexpr uint32_t kArchiveMultiVolume = 1u << 2;
+
+// Entry flags
+constexpr uint32_t kEntryDirectory = 1u << 0;
+constexpr uint32_t kEntryEncrypted = 1u << 1;
+
+template <typename T>
+void append(std::vector<uint8_t>& out, T value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/// @brief Bounds-checked reads from an encoded listing
+class Cursor {
+public:
+    explicit Cursor(std::span<const uint8_t> data) : data_(data) {}
+
+    template <typename T>
+    [[nodiscard]] bool read(T& value) {
+        if (data_.size() - offset_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+    [[nodiscard]] bool read(std::wstring& value, size_t length) {
+        if ((data_.size() - offset_) / sizeof(wchar_t) < length) {
+            return false;
+        }
+        value.resize(length);
+        std::memcpy(value.data(), data_.data() + offset_, length * sizeof(wchar_t));
+        offset_ += length * sizeof(wchar_t);
+        return true;
+    }
+
+    [[nodiscard]] size_t remaining() const noexcept { return data_.size() - offset_; }
+
+private:
+    std::span<const uint8_t> data_;
+    size_t offset_ = 0;
+};
+
+}  // namespace
+
+std::optional<ListingStamp> stampArchive(const std::filesystem::path& path) {
+    WIN32_FILE_ATTRIBUTE_DATA attrs{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attrs)) {
+        return std::nullopt;
+    }
+    ListingStamp stamp;
+    stamp.write_time = (static_cast<uint64_t>(attrs.ftLastWriteTime.dwHighDateTime) << 32) |
+                       attrs.ftLastWriteTime.dwLowDateTime;
+    stamp.size = (static_cast<uint64_t>(attrs.nFileSizeHigh) << 32) | attrs.nFileSizeLow;
+    return stamp;
+}
+
+std::vector<uint8_t> encodeListing(const ArchiveInfo& info) {
+    std::vector<uint8_t> out;
+    out.reserve(20 + info.entries.size() * 64);
+
+    uint32_t flags = (info.is_encrypted ? kArchiveEncrypted : 0) |
+                     (info.is_solid ? kArchiveSolid : 0) |
+                     (info.is_multi_volume ? kArchiveMultiVolume : 0);
+    append(out, kMagic);
+    append(out, kVersion);
+    append(out, flags);
+    append(out, static_cast<uint64_t>(info.entries.size()));
+
+    for (const auto& entry : info.entries) {
+        uint32_t entry_flags = (entry.is_directory ? kEntryDirectory : 0) |
+                               (entry.is_encrypted ? kEntryEncrypted : 0);
+        append(out, entry_flags);
+        append(out, entry.attributes);
+        append(out, entry.crc32);
+        append(out, static_cast<uint32_t>(entry.path.size()));
+        append(out, entry.compressed_size);
+        append(out, entry.uncompressed_size);
+        append(out, static_cast<int64_t>(entry.modified_time.time_since_epoch().count()));
+        const auto* path = reinterpret_cast<const uint8_t*>(entry.path.data());
+        out.insert(out.end(), path, path + entry.path.size() * sizeof(wchar_t));
+    }
+    return out;
+}
+
+std::optional<ArchiveInfo> decodeListing(std::span<const uint8_t> data,
+                                         const std::filesystem::path& path) {
+    Cursor cursor(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t flags = 0;
+    uint64_t count = 0;
+    if (!cursor.read(magic) || !cursor.read(version) || !cursor.read(flags) ||
+        !cursor.read(count) || magic != kMagic || version != kVersion) {
+        return std::nullopt;
+    }
+
+    ArchiveInfo info;
+    info.path = path;
+    info.format = detect_format(path);
+    info.is_encrypted = (flags & kArchiveEncrypted) != 0;
+    info.is_solid = (flags & kArchiveSolid) != 0;
+    info.is_multi_volume = (flags & kArchiveMultiVolume) != 0;
+
+    // Fixed part of an entry bounds the count a corrupt header can claim
+    constexpr size_t kEntryFixedSize = 4 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+    if (count > cursor.remaining() / kEntryFixedSize) {
+        return std::nullopt;
+    }
+    info.entries.reserve(static_cast<size_t>(count));
+
+    for (uint64_t i = 0; i < count; ++i) {
+        ArchiveEntry entry;
+        uint32_t entry_flags = 0;
+        uint32_t path_length = 0;
+        int64_t modified = 0;
+        if (!cursor.read(entry_flags) || !cursor.read(entry.attributes) ||
+            !cursor.read(entry.crc32) || !cursor.read(path_length) ||
+            !cursor.read(entry.compressed_size) || !cursor.read(entry.uncompressed_size) ||
+            !cursor.read(modified) || !cursor.read(entry.path, path_length)) {
+            return std::nullopt;
+        }
+        entry.is_directory = (entry_flags & kEntryDirectory) != 0;
+        entry.is_encrypted = (entry_flags & kEntryEncrypted) != 0;
+        entry.modified_time = std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(modified));
+
+        auto slash = entry.path.find_last_of(L"/\\");
+        entry.name = slash == std::wstring::npos ? entry.path : entry.path.substr(slash + 1);
+
+        if (entry.is_directory) {
+            ++info.directory_count;
+        } else {
+            ++info.file_count;
+            info.total_compressed_size += entry.compressed_size;
+            info.total_uncompressed_size += entry.uncompressed_size;
+        }
+        info.entries.push_back(std::move(entry));
+    }
+    return info;
+}
+
+}  // namespace nive::archive
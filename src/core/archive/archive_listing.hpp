@@ -0,0 +1,39 @@
+/// @file archive_listing.hpp
+/// @brief Binary form of an archive listing, for persisting it between sessions
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "archive_entry.hpp"
+
+namespace nive::archive {
+
+/// @brief State of an archive file a listing was read from
+struct ListingStamp {
+    uint64_t write_time = 0;  // Last write time (FILETIME ticks)
+    uint64_t size = 0;
+
+    bool operator==(const ListingStamp&) const = default;
+};
+
+/// @brief Get an archive file's current stamp
+/// @return Stamp, or nullopt if the file cannot be queried
+[[nodiscard]] std::optional<ListingStamp> stampArchive(const std::filesystem::path& path);
+
+/// @brief Encode an archive's info and entries
+[[nodiscard]] std::vector<uint8_t> encodeListing(const ArchiveInfo& info);
+
+/// @brief Decode a listing written by encodeListing
+/// @param data Encoded listing
+/// @param path Archive path to set in the result (not stored)
+/// @return Info with entries and totals, or nullopt if data is malformed or
+///         from another format version
+[[nodiscard]] std::optional<ArchiveInfo> decodeListing(std::span<const uint8_t> data,
+                                                       const std::filesystem::path& path);
+
+}  // namespace nive::archive
@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <random>
 
+#include "extract_pipeline.hpp"
+#include "zip_reader.hpp"
 #include "../fs/natural_sort.hpp"
 #include "../util/logger.hpp"
 #include "../util/string_utils.hpp"
@@ -34,9 +36,51 @@ namespace {
     return std::filesystem::current_path() / L"temp";
 }
 
+/// @brief Get where an entry goes below an extraction directory
+/// @return Relative path, or nullopt if the entry would escape the directory
+[[nodiscard]] std::optional<std::filesystem::path>
+extraction_target(const std::wstring& entry_path) {
+    auto relative = std::filesystem::path(entry_path).lexically_normal();
+    if (relative.empty() || relative.has_root_path() || *relative.begin() == L"..") {
+        return std::nullopt;
+    }
+    return relative;
+}
+
+/// @brief Extract one entry into the next file of a pipeline
+/// @return Success, or error (Cancelled if the pipeline stopped)
+[[nodiscard]] std::expected<void, ArchiveError>
+write_entry(const IArchiveReader& reader, const std::wstring& entry_path,
+            const std::filesystem::path& dest_path, uint64_t size, ExtractPipeline& pipeline) {
+    if (!pipeline.beginFile(dest_path, size)) {
+        return std::unexpected(ArchiveError::Cancelled);
+    }
+    auto extracted = reader.extractChunked(
+        entry_path, [&pipeline](std::span<const uint8_t> chunk) { return pipeline.write(chunk); });
+    if (!extracted) {
+        return extracted;
+    }
+    if (!pipeline.endFile()) {
+        return std::unexpected(ArchiveError::Cancelled);
+    }
+    return {};
+}
+
+/// @brief End a pipeline after write_entry() failed
+[[nodiscard]] std::expected<void, ArchiveError> stop_pipeline(ExtractPipeline& pipeline,
+                                                              ArchiveError error) {
+    // Cancelled means the pipeline stopped itself, and finish() tells why
+    if (error == ArchiveError::Cancelled) {
+        return pipeline.finish();
+    }
+    pipeline.abort();
+    return std::unexpected(error);
+}
+
 }  // namespace
 
-ArchiveManager::ArchiveManager(ArchiveManagerConfig config) : config_(std::move(config)) {
+ArchiveManager::ArchiveManager(ArchiveManagerConfig config)
+    : config_(std::move(config)) {
     if (config_.temp_dir.empty()) {
         config_.temp_dir = get_system_temp_dir();
     }
@@ -46,8 +90,15 @@ ArchiveManager::~ArchiveManager() {
     cleanupTempFiles();
 }
 
+bool ArchiveManager::sevenZipAvailable() const noexcept {
+    // Searching the install locations waits until the first archive is looked at
+    std::call_once(seven_zip_checked_,
+                   [this] { seven_zip_available_ = ArchiveReaderFactory::isAvailable(); });
+    return seven_zip_available_;
+}
+
 bool ArchiveManager::isAvailable() const noexcept {
-    return ArchiveReaderFactory::isAvailable();
+    return true;
 }
 
 std::optional<std::filesystem::path> ArchiveManager::getDllPath() const noexcept {
@@ -55,32 +106,27 @@ std::optional<std::filesystem::path> ArchiveManager::getDllPath() const noexcept
 }
 
 std::expected<ArchiveInfo, ArchiveError> ArchiveManager::open(const std::filesystem::path& path) {
-    std::lock_guard lock(mutex_);
-
-    auto reader_result = getReader(path);
-    if (!reader_result) {
-        LOG_ERROR("Failed to open archive: {} ({})", pathToUtf8(path),
-                  to_string(reader_result.error()));
-        return std::unexpected(reader_result.error());
+    auto info = load_info(path);
+    if (!info) {
+        LOG_ERROR("Failed to open archive: {} ({})", pathToUtf8(path), to_string(info.error()));
     }
-
-    return reader_result.value()->getInfo();
+    return info;
 }
 
 bool ArchiveManager::isArchive(const std::filesystem::path& path) const noexcept {
-    return is_supported_archive(path);
+    if (sevenZipAvailable()) {
+        return is_supported_archive(path);
+    }
+    return ZipReader::handles(path);
 }
 
 std::expected<std::vector<ArchiveEntry>, ArchiveError>
 ArchiveManager::listEntries(const std::filesystem::path& archive_path) {
-    std::lock_guard lock(mutex_);
-
-    auto reader_result = getReader(archive_path);
-    if (!reader_result) {
-        return std::unexpected(reader_result.error());
+    auto info = load_info(archive_path);
+    if (!info) {
+        return std::unexpected(info.error());
     }
-
-    return reader_result.value()->listEntries();
+    return std::move(info->entries);
 }
 
 std::expected<std::vector<ArchiveEntry>, ArchiveError>
@@ -113,14 +159,75 @@ ArchiveManager::extractToMemory(const VirtualPath& virtual_path) {
         return std::unexpected(ArchiveError::InternalError);
     }
 
-    std::lock_guard lock(mutex_);
+    auto reader = acquire(virtual_path.archive_path());
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
 
-    auto reader_result = getReader(virtual_path.archive_path());
-    if (!reader_result) {
-        return std::unexpected(reader_result.error());
+    return (*reader)->extractToMemory(virtual_path.internal_path());
+}
+
+std::expected<ArchiveCover, ArchiveError>
+ArchiveManager::extractCover(const std::filesystem::path& archive_path) {
+    auto info = load_info(archive_path);
+    if (!info) {
+        return std::unexpected(info.error());
+    }
+
+    // Encrypted entries would prompt for a password while a folder is browsed
+    const ArchiveEntry* cover = nullptr;
+    for (const auto& entry : info->entries) {
+        if (entry.is_directory || entry.is_encrypted || !entry.is_image()) {
+            continue;
+        }
+        if (!cover) {
+            cover = &entry;
+            if (info->is_solid) {
+                break;
+            }
+        } else if (fs::naturalCompare(entry.path, cover->path) < 0) {
+            cover = &entry;
+        }
+    }
+    if (!cover) {
+        return std::unexpected(ArchiveError::NotFound);
     }
 
-    return reader_result.value()->extractToMemory(virtual_path.internal_path());
+    auto reader = acquire(archive_path);
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+    auto data = (*reader)->extractToMemory(cover->path);
+    if (!data) {
+        return std::unexpected(data.error());
+    }
+    return ArchiveCover{.entry_path = cover->path, .data = std::move(*data)};
+}
+
+bool ArchiveManager::isSolid(const std::filesystem::path& archive_path) {
+    auto pool = pool_for(archive_path);
+    {
+        std::lock_guard lock(pool->mutex);
+        if (pool->solid) {
+            return *pool->solid;
+        }
+    }
+    auto reader = acquire(archive_path);
+    return reader && (*reader)->isSolid();
+}
+
+std::expected<size_t, ArchiveError>
+ArchiveManager::extractBatch(const std::filesystem::path& archive_path,
+                             const std::vector<std::wstring>& entry_paths,
+                             const ExtractItemCallback& on_item) {
+    auto reader = acquire(archive_path);
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+
+    // Scratch directory is private to this pass and removed by the reader
+    auto scratch_dir = config_.temp_dir / generate_temp_filename(L"");
+    return (*reader)->extractBatch(entry_paths, on_item, scratch_dir);
 }
 
 std::expected<std::filesystem::path, ArchiveError>
@@ -161,33 +268,70 @@ ArchiveManager::extractToFile(const VirtualPath& virtual_path,
         return std::unexpected(ArchiveError::InternalError);
     }
 
-    std::lock_guard lock(mutex_);
+    // Size from the listing (usually cached) for progress and to reserve the file
+    uint64_t size = 0;
+    if (auto info = load_info(virtual_path.archive_path())) {
+        auto it =
+            std::ranges::find(info->entries, virtual_path.internal_path(), &ArchiveEntry::path);
+        if (it != info->entries.end()) {
+            size = it->uncompressed_size;
+        }
+    }
 
-    auto reader_result = getReader(virtual_path.archive_path());
-    if (!reader_result) {
-        return std::unexpected(reader_result.error());
+    auto reader = acquire(virtual_path.archive_path());
+    if (!reader) {
+        return std::unexpected(reader.error());
     }
 
-    return reader_result.value()->extractToFile(virtual_path.internal_path(), dest_path, progress);
+    ExtractPipeline pipeline(size, std::move(progress));
+    auto written = write_entry(**reader, virtual_path.internal_path(), dest_path, size, pipeline);
+    if (!written) {
+        return stop_pipeline(pipeline, written.error());
+    }
+    return pipeline.finish();
 }
 
 std::expected<void, ArchiveError>
 ArchiveManager::extractAll(const std::filesystem::path& archive_path,
                            const std::filesystem::path& dest_dir,
                            ExtractProgressCallback progress) {
-    std::lock_guard lock(mutex_);
-
-    auto reader_result = getReader(archive_path);
-    if (!reader_result) {
-        return std::unexpected(reader_result.error());
+    auto info = load_info(archive_path);
+    if (!info) {
+        return std::unexpected(info.error());
+    }
+    auto reader = acquire(archive_path);
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+    if (info->is_solid) {
+        return (*reader)->extractAll(dest_dir, std::move(progress));
     }
 
-    return reader_result.value()->extractAll(dest_dir, progress);
+    std::error_code ec;
+    std::filesystem::create_directories(dest_dir, ec);
+
+    ExtractPipeline pipeline(info->total_uncompressed_size, std::move(progress));
+    for (const auto& entry : info->entries) {
+        auto relative = extraction_target(entry.path);
+        if (!relative) {
+            continue;
+        }
+        if (entry.is_directory) {
+            std::filesystem::create_directories(dest_dir / *relative, ec);
+            continue;
+        }
+        auto written = write_entry(**reader, entry.path, dest_dir / *relative,
+                                   entry.uncompressed_size, pipeline);
+        if (!written) {
+            return stop_pipeline(pipeline, written.error());
+        }
+    }
+    return pipeline.finish();
 }
 
 void ArchiveManager::clearCache() {
     std::lock_guard lock(mutex_);
-    cache_.clear();
+    pools_.clear();
 }
 
 void ArchiveManager::cleanupTempFiles() {
@@ -212,53 +356,203 @@ void ArchiveManager::setPasswordCallback(PasswordCallback callback) {
     config_.password_callback = std::move(callback);
 }
 
-std::expected<IArchiveReader*, ArchiveError>
-ArchiveManager::getReader(const std::filesystem::path& archive_path) {
-    // Check cache first
-    for (auto& cached : cache_) {
-        if (cached.path == archive_path && cached.reader && cached.reader->isOpen()) {
-            cached.last_access = std::chrono::steady_clock::now();
-            return cached.reader.get();
+ArchiveManager::ReaderLease::~ReaderLease() {
+    if (!reader_) {
+        return;
+    }
+    {
+        std::lock_guard lock(pool_->mutex);
+        pool_->idle.push_back(std::move(reader_));
+    }
+    pool_->returned.notify_one();
+}
+
+std::expected<ArchiveInfo, ArchiveError>
+ArchiveManager::load_info(const std::filesystem::path& archive_path) {
+    // A nested archive changes only with the file holding it
+    auto file = VirtualPath(archive_path).file_path();
+    auto stamp = stampArchive(file);
+    auto remember = [&](const ArchiveInfo& info) {
+        auto pool = pool_for(archive_path);
+        std::lock_guard lock(pool->mutex);
+        pool->solid = info.is_solid;
+    };
+
+    if (stamp && config_.load_listing) {
+        if (auto listing = config_.load_listing(archive_path, *stamp)) {
+            if (auto info = decodeListing(*listing, archive_path)) {
+                LOG_DEBUG("Archive listing of {} read from cache", pathToUtf8(archive_path));
+                remember(*info);
+                return std::move(*info);
+            }
         }
     }
 
-    // Create new reader
-    auto reader_result = ArchiveReaderFactory::create();
+    auto reader = acquire(archive_path);
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+    auto info = (*reader)->getInfo();
+    if (!info) {
+        return info;
+    }
+    remember(*info);
+
+    // Only a stamp taken before listing can vouch for it
+    if (stamp && config_.store_listing && stampArchive(file) == stamp) {
+        config_.store_listing(archive_path, *stamp, encodeListing(*info));
+    }
+    return info;
+}
+
+std::expected<ArchiveManager::ReaderLease, ArchiveError>
+ArchiveManager::acquire(const std::filesystem::path& archive_path) {
+    auto pool = pool_for(archive_path);
+
+    std::unique_lock lock(pool->mutex);
+    for (;;) {
+        if (!pool->idle.empty()) {
+            auto reader = std::move(pool->idle.back());
+            pool->idle.pop_back();
+            if (reader->isOpen()) {
+                return ReaderLease(pool, std::move(reader));
+            }
+            --pool->readers;
+            continue;
+        }
+
+        // Until the first reader has opened, others wait rather than ask for a password too
+        bool first_opening = !pool->opened && pool->readers > 0;
+        if (!first_opening && pool->readers < std::max<size_t>(config_.readers_per_archive, 1)) {
+            break;
+        }
+        pool->returned.wait(lock);
+    }
+
+    // Open another reader outside the pool lock
+    ++pool->readers;
+    std::optional<std::wstring> password = pool->password;
+    lock.unlock();
+
+    auto reader_result = open_reader(archive_path, password);
+
+    lock.lock();
     if (!reader_result) {
+        --pool->readers;
+        lock.unlock();
+        pool->returned.notify_all();
         return std::unexpected(reader_result.error());
     }
+    pool->opened = true;
+    pool->password = std::move(password);
+    lock.unlock();
+    pool->returned.notify_all();
 
-    auto reader = std::move(*reader_result);
+    return ReaderLease(std::move(pool), std::move(*reader_result));
+}
+
+std::shared_ptr<ArchiveManager::ReaderPool>
+ArchiveManager::pool_for(const std::filesystem::path& archive_path) {
+    std::lock_guard lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
 
-    // Open archive
-    auto open_result = openWithPasswordRetry(reader.get(), archive_path);
-    if (!open_result) {
-        return std::unexpected(open_result.error());
+    for (const auto& pool : pools_) {
+        if (pool->path == archive_path) {
+            pool->last_access = now;
+            return pool;
+        }
     }
 
-    // Add to cache
-    if (cache_.size() >= config_.max_cached_archives) {
-        // Evict oldest entry
-        auto oldest = std::min_element(cache_.begin(), cache_.end(),
-                                       [](const CachedReader& a, const CachedReader& b) {
-                                           return a.last_access < b.last_access;
+    if (pools_.size() >= config_.max_cached_archives && !pools_.empty()) {
+        // Evict oldest entry; its leased readers close when returned
+        auto oldest = std::min_element(pools_.begin(), pools_.end(),
+                                       [](const auto& a, const auto& b) {
+                                           return a->last_access < b->last_access;
                                        });
-        if (oldest != cache_.end()) {
-            LOG_DEBUG("Evicting cached archive reader: {}", pathToUtf8(oldest->path));
-            cache_.erase(oldest);
+        LOG_DEBUG("Evicting cached archive readers: {}", pathToUtf8((*oldest)->path));
+        pools_.erase(oldest);
+    }
+
+    auto pool = std::make_shared<ReaderPool>();
+    pool->path = archive_path;
+    pool->last_access = now;
+    pools_.push_back(pool);
+    return pool;
+}
+
+std::expected<std::shared_ptr<const std::vector<uint8_t>>, ArchiveError>
+ArchiveManager::nested_image(const std::filesystem::path& archive_path) {
+    auto pool = pool_for(archive_path);
+    {
+        std::lock_guard lock(pool->mutex);
+        if (pool->image) {
+            return pool->image;
         }
     }
 
-    cache_.push_back({std::move(reader), archive_path, std::chrono::steady_clock::now()});
+    // Through the container's own pool, so deeper nesting resolves level by level
+    auto data = extractToMemory(VirtualPath(archive_path).container());
+    if (!data) {
+        return std::unexpected(data.error());
+    }
+    auto image = std::make_shared<const std::vector<uint8_t>>(std::move(*data));
+    std::lock_guard lock(pool->mutex);
+    pool->image = image;
+    pool->image_charge.set(image->size());
+    return image;
+}
+
+std::expected<std::unique_ptr<IArchiveReader>, ArchiveError>
+ArchiveManager::open_reader(const std::filesystem::path& archive_path,
+                            std::optional<std::wstring>& password) {
+    std::shared_ptr<const std::vector<uint8_t>> image;
+    if (VirtualPath(archive_path).is_nested()) {
+        auto nested = nested_image(archive_path);
+        if (!nested) {
+            return std::unexpected(nested.error());
+        }
+        image = std::move(*nested);
+    }
 
-    return cache_.back().reader.get();
+    // A known password means an encrypted archive, which only 7z.dll reads
+    if (!password && ZipReader::handles(archive_path)) {
+        auto zip = std::make_unique<ZipReader>();
+        auto result = image ? zip->openFromMemory(image, archive_path) : zip->open(archive_path);
+        if (result) {
+            return zip;
+        }
+        LOG_DEBUG("Built-in ZIP reader declined {} ({}), trying 7z.dll", pathToUtf8(archive_path),
+                  to_string(result.error()));
+    }
+
+    auto reader = ArchiveReaderFactory::create();
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+    auto result = openWithPasswordRetry(reader->get(), archive_path, password, image);
+    if (!result) {
+        return std::unexpected(result.error());
+    }
+    return std::move(*reader);
 }
 
 std::expected<void, ArchiveError>
 ArchiveManager::openWithPasswordRetry(IArchiveReader* reader,
-                                      const std::filesystem::path& archive_path) {
+                                      const std::filesystem::path& archive_path,
+                                      std::optional<std::wstring>& password,
+                                      const std::shared_ptr<const std::vector<uint8_t>>& image) {
+    auto open = [&](const std::wstring& attempt) {
+        return image ? reader->openFromMemory(image, archive_path, attempt)
+                     : reader->open(archive_path, attempt);
+    };
+
+    // A password that opened another reader of this archive
+    if (password) {
+        return open(*password);
+    }
+
     // Try without password first
-    auto result = reader->open(archive_path);
+    auto result = open(L"");
     if (result) {
         return {};
     }
@@ -270,20 +564,26 @@ ArchiveManager::openWithPasswordRetry(IArchiveReader* reader,
     }
 
     // Request password
-    if (!config_.password_callback) {
+    PasswordCallback callback;
+    {
+        std::lock_guard lock(mutex_);
+        callback = config_.password_callback;
+    }
+    if (!callback) {
         return std::unexpected(ArchiveError::PasswordRequired);
     }
 
     // Retry with password (up to 3 attempts)
     for (int attempt = 0; attempt < 3; ++attempt) {
-        auto password = config_.password_callback(archive_path);
-        if (!password) {
+        auto entered = callback(archive_path);
+        if (!entered) {
             // User cancelled
             return std::unexpected(ArchiveError::PasswordRequired);
         }
 
-        result = reader->open(archive_path, *password);
+        result = open(*entered);
         if (result) {
+            password = std::move(entered);
             return {};
         }
 
@@ -3,16 +3,20 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <expected>
 #include <filesystem>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <unordered_map>
+#include <vector>
 
 #include "archive_entry.hpp"
 #include "archive_error.hpp"
+#include "archive_listing.hpp"
+#include "../util/memory_accounting.hpp"
 #include "archive_reader.hpp"
 #include "virtual_path.hpp"
 
@@ -24,22 +28,55 @@ namespace nive::archive {
 using PasswordCallback =
     std::function<std::optional<std::wstring>(const std::filesystem::path& archive_path)>;
 
+/// @brief Reads a persisted listing (see encodeListing) of an archive in a given state
+/// @return Listing, or nullopt if none was stored for this stamp
+using ListingLoader = std::function<std::optional<std::vector<uint8_t>>(
+    const std::filesystem::path& archive_path, const ListingStamp& stamp)>;
+
+/// @brief Persists a listing of an archive in a given state
+using ListingStorer =
+    std::function<void(const std::filesystem::path& archive_path, const ListingStamp& stamp,
+                       const std::vector<uint8_t>& listing)>;
+
+/// @brief First image of an archive, extracted for its cover thumbnail
+struct ArchiveCover {
+    std::wstring entry_path;  // Entry the cover was taken from
+    std::vector<uint8_t> data;
+};
+
 /// @brief Archive manager configuration
 struct ArchiveManagerConfig {
-    // Maximum number of cached archive readers
+    // Maximum number of archives with cached readers
     size_t max_cached_archives = 4;
 
+    // Readers per archive; each extracts independently, so this many threads
+    // can read one archive at a time
+    size_t readers_per_archive = 4;
+
     // Password callback for encrypted archives
     PasswordCallback password_callback = nullptr;
 
     // Temporary directory for extracted files
     std::filesystem::path temp_dir;
+
+    // Persistent listing store (optional); an unchanged archive is listed
+    // from it without opening a reader
+    ListingLoader load_listing = nullptr;
+    ListingStorer store_listing = nullptr;
 };
 
 /// @brief High-level archive manager
 ///
 /// Provides convenient access to archive contents with caching.
-/// Thread-safe for concurrent access.
+/// Thread-safe for concurrent access: each cached archive keeps a pool of
+/// open readers, and a call leases one for its duration, so thumbnail
+/// workers extract entries of the same archive in parallel. The manager's
+/// lock only guards the pool list.
+///
+/// Archive paths may name archives inside archives (see VirtualPath). Such
+/// an archive is extracted from its container once, kept in memory by its
+/// pool and read from there, and its listing is stored under the nested
+/// path, stamped with the outermost archive file.
 class ArchiveManager {
 public:
     /// @brief Create archive manager
@@ -52,6 +89,9 @@ public:
     ArchiveManager& operator=(const ArchiveManager&) = delete;
 
     /// @brief Check if archive support is available
+    ///
+    /// ZIP and CBZ are always readable by the built-in reader; other formats
+    /// need 7z.dll.
     [[nodiscard]] bool isAvailable() const noexcept;
 
     /// @brief Get path to 7z.dll
@@ -83,6 +123,36 @@ public:
     [[nodiscard]] std::expected<std::vector<uint8_t>, ArchiveError>
     extractToMemory(const VirtualPath& virtual_path);
 
+    /// @brief Extract the image shown as an archive's cover
+    /// @param archive_path Archive file path
+    /// @return Cover entry and its contents, or NotFound if the archive holds no
+    ///         unencrypted image
+    ///
+    /// Touches only the listing (the ZIP central directory, or the persisted
+    /// listing of an unchanged archive) and the one entry. The cover is the
+    /// first image in natural order; in a solid archive it is the first image
+    /// in stream order instead, so decompression stops as soon as it is out.
+    [[nodiscard]] std::expected<ArchiveCover, ArchiveError>
+    extractCover(const std::filesystem::path& archive_path);
+
+    /// @brief Check if an archive is solid
+    /// @param archive_path Archive file path
+    /// @return true if entries share compressed blocks (per-entry extraction is expensive)
+    [[nodiscard]] bool isSolid(const std::filesystem::path& archive_path);
+
+    /// @brief Extract a set of entries in a single pass
+    /// @param archive_path Archive file path
+    /// @param entry_paths Paths of entries inside the archive
+    /// @param on_item Called as each entry completes; return false to stop
+    /// @return Number of entries delivered or error
+    ///
+    /// For solid archives this decompresses the archive once, sequentially,
+    /// instead of once per entry. Holds one of the archive's readers for the
+    /// whole pass.
+    [[nodiscard]] std::expected<size_t, ArchiveError>
+    extractBatch(const std::filesystem::path& archive_path,
+                 const std::vector<std::wstring>& entry_paths, const ExtractItemCallback& on_item);
+
     /// @brief Extract a file from archive to temporary file
     /// @param virtual_path Virtual path
     /// @return Path to temporary file or error
@@ -95,8 +165,11 @@ public:
     /// @brief Extract a file from archive to specific location
     /// @param virtual_path Virtual path
     /// @param dest_path Destination path
-    /// @param progress Progress callback
-    /// @return Success or error
+    /// @param progress Progress callback (bytes written); return false to cancel
+    /// @return Success or error (Cancelled if progress returned false)
+    ///
+    /// Decompression and disk writes overlap through an ExtractPipeline; an
+    /// incomplete file is deleted.
     [[nodiscard]] std::expected<void, ArchiveError>
     extractToFile(const VirtualPath& virtual_path, const std::filesystem::path& dest_path,
                   ExtractProgressCallback progress = nullptr);
@@ -104,8 +177,12 @@ public:
     /// @brief Extract entire archive to directory
     /// @param archive_path Archive file path
     /// @param dest_dir Destination directory
-    /// @param progress Progress callback
-    /// @return Success or error
+    /// @param progress Progress callback (bytes written); return false to cancel
+    /// @return Success or error (Cancelled if progress returned false)
+    ///
+    /// Entries stream through an ExtractPipeline one after another. Solid
+    /// archives are instead extracted in one pass by the reader, since
+    /// extracting them entry by entry would decompress each block again.
     [[nodiscard]] std::expected<void, ArchiveError>
     extractAll(const std::filesystem::path& archive_path, const std::filesystem::path& dest_dir,
                ExtractProgressCallback progress = nullptr);
@@ -120,22 +197,77 @@ public:
     void setPasswordCallback(PasswordCallback callback);
 
 private:
-    /// @brief Get or create reader for archive
-    [[nodiscard]] std::expected<IArchiveReader*, ArchiveError>
-    getReader(const std::filesystem::path& archive_path);
+    /// @brief Open readers of one archive
+    struct ReaderPool {
+        std::filesystem::path path;
+        std::chrono::steady_clock::time_point last_access;  // Guarded by the manager's mutex_
 
-    /// @brief Try to open archive with password retry
-    [[nodiscard]] std::expected<void, ArchiveError>
-    openWithPasswordRetry(IArchiveReader* reader, const std::filesystem::path& archive_path);
+        std::mutex mutex;
+        std::condition_variable returned;
+        std::vector<std::unique_ptr<IArchiveReader>> idle;
+        size_t readers = 0;                   // Idle and leased
+        bool opened = false;                  // A reader opened (passwords are known)
+        std::optional<std::wstring> password; // Password that opened the archive
+        std::optional<bool> solid;            // Known once the archive has been listed
+        std::shared_ptr<const std::vector<uint8_t>> image;  // Contents, of nested archives
+        MemoryCharge image_charge{MemoryCategory::ArchiveBuffers};  // image, until evicted
+    };
 
-    struct CachedReader {
-        std::unique_ptr<IArchiveReader> reader;
-        std::filesystem::path path;
-        std::chrono::steady_clock::time_point last_access;
+    /// @brief A reader leased from a pool, returned when destroyed
+    class ReaderLease {
+    public:
+        ReaderLease(std::shared_ptr<ReaderPool> pool, std::unique_ptr<IArchiveReader> reader)
+            : pool_(std::move(pool)), reader_(std::move(reader)) {}
+        ~ReaderLease();
+
+        ReaderLease(ReaderLease&&) noexcept = default;
+        ReaderLease& operator=(ReaderLease&&) = delete;
+        ReaderLease(const ReaderLease&) = delete;
+        ReaderLease& operator=(const ReaderLease&) = delete;
+
+        [[nodiscard]] IArchiveReader* operator->() const noexcept { return reader_.get(); }
+        [[nodiscard]] IArchiveReader& operator*() const noexcept { return *reader_; }
+
+    private:
+        std::shared_ptr<ReaderPool> pool_;
+        std::unique_ptr<IArchiveReader> reader_;  // Null once moved from
     };
 
+    /// @brief Get an archive's info, from the listing store if it is unchanged
+    [[nodiscard]] std::expected<ArchiveInfo, ArchiveError>
+    load_info(const std::filesystem::path& archive_path);
+
+    /// @brief Lease a reader for an archive, opening one if the pool has none idle
+    [[nodiscard]] std::expected<ReaderLease, ArchiveError>
+    acquire(const std::filesystem::path& archive_path);
+
+    /// @brief Get the pool for an archive, creating it and evicting the oldest
+    [[nodiscard]] std::shared_ptr<ReaderPool> pool_for(const std::filesystem::path& archive_path);
+
+    /// @brief Get the contents of a nested archive, extracting it from its container once
+    [[nodiscard]] std::expected<std::shared_ptr<const std::vector<uint8_t>>, ArchiveError>
+    nested_image(const std::filesystem::path& archive_path);
+
+    /// @brief Open a reader, preferring the built-in ZIP reader over 7z.dll
+    /// @param password As for openWithPasswordRetry
+    [[nodiscard]] std::expected<std::unique_ptr<IArchiveReader>, ArchiveError>
+    open_reader(const std::filesystem::path& archive_path, std::optional<std::wstring>& password);
+
+    /// @brief Try to open archive with password retry
+    /// @param password In: password known to work; out: password that worked
+    /// @param image Contents to open instead of the file (nested archives), or null
+    [[nodiscard]] std::expected<void, ArchiveError>
+    openWithPasswordRetry(IArchiveReader* reader, const std::filesystem::path& archive_path,
+                          std::optional<std::wstring>& password,
+                          const std::shared_ptr<const std::vector<uint8_t>>& image);
+
     ArchiveManagerConfig config_;
-    std::vector<CachedReader> cache_;
+    /// @brief Check for 7z.dll, looking for it the first time only
+    [[nodiscard]] bool sevenZipAvailable() const noexcept;
+
+    mutable std::once_flag seven_zip_checked_;
+    mutable bool seven_zip_available_ = false;  // Set once seven_zip_checked_ ran
+    std::vector<std::shared_ptr<ReaderPool>> pools_;  // Evicted pools die with their last lease
     std::vector<std::filesystem::path> temp_files_;
     mutable std::mutex mutex_;
 };
@@ -16,6 +16,11 @@
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <type_traits>
+#include <unordered_map>
 
 #ifdef NIVE_HAS_BIT7Z
     #include <bit7z/bit7z.hpp>
@@ -83,6 +88,39 @@ std::wstring normalize_path_separators(std::wstring path) {
 
 #ifdef NIVE_HAS_BIT7Z
 
+/// @brief Stream buffer handing everything bit7z writes to an ExtractChunkCallback
+///
+/// Unbuffered: the decoder writes in blocks of its own, each passed on as is.
+class ChunkStreamBuf : public std::streambuf {
+public:
+    explicit ChunkStreamBuf(const ExtractChunkCallback& on_chunk) : on_chunk_(on_chunk) {}
+
+    /// @brief Check if the callback asked to stop
+    [[nodiscard]] bool stopped() const noexcept { return stopped_; }
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        if (stopped_ ||
+            !on_chunk_({reinterpret_cast<const uint8_t*>(data), static_cast<size_t>(count)})) {
+            stopped_ = true;
+            return 0;
+        }
+        return count;
+    }
+
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+private:
+    const ExtractChunkCallback& on_chunk_;
+    bool stopped_ = false;
+};
+
 /// @brief Archive reader implementation using bit7z
 class Bit7zReader : public IArchiveReader {
 public:
@@ -96,48 +134,51 @@ public:
         if (!std::filesystem::exists(path)) {
             return std::unexpected(ArchiveError::NotFound);
         }
+        return open_with(path, [&](const bit7z::Bit7zLibrary& lib) {
+            return std::make_unique<bit7z::BitArchiveReader>(lib, path.wstring(),
+                                                             bit7z::BitFormat::Auto, password);
+        });
+    }
 
-        auto dll_path = find_7z_dll();
-        if (!dll_path) {
-            return std::unexpected(ArchiveError::DllNotFound);
-        }
-
-        try {
-            lib_ = std::make_unique<bit7z::Bit7zLibrary>(dll_path->wstring());
-
-            if (!password.empty()) {
-                reader_ = std::make_unique<bit7z::BitArchiveReader>(
-                    *lib_, path.wstring(), bit7z::BitFormat::Auto, password);
-            } else {
-                reader_ = std::make_unique<bit7z::BitArchiveReader>(*lib_, path.wstring(),
-                                                                    bit7z::BitFormat::Auto);
-            }
-
-            archive_path_ = path;
-            return {};
+    std::expected<void, ArchiveError> openFromMemory(
+        std::shared_ptr<const std::vector<uint8_t>> data, const std::filesystem::path& path,
+        const std::wstring& password) override {
+        close();
 
-        } catch (const bit7z::BitException& e) {
-            // Map bit7z exceptions to our error types using error_condition
-            auto condition = e.code().default_error_condition();
-            if (condition == bit7z::BitFailureSource::WrongPassword) {
-                return std::unexpected(ArchiveError::WrongPassword);
-            }
-            if (condition == bit7z::BitFailureSource::DataError ||
-                condition == bit7z::BitFailureSource::CRCError) {
-                return std::unexpected(ArchiveError::CorruptedArchive);
-            }
+        if (!data) {
             return std::unexpected(ArchiveError::InternalError);
         }
+        // BitArchiveReader reads the buffer in place for as long as it lives
+        static_assert(std::is_same_v<bit7z::byte_t, uint8_t>);
+        memory_ = std::move(data);
+        auto result = open_with(path, [&](const bit7z::Bit7zLibrary& lib) {
+            return std::make_unique<bit7z::BitArchiveReader>(lib, *memory_,
+                                                             bit7z::BitFormat::Auto, password);
+        });
+        if (!result) {
+            memory_.reset();
+        }
+        return result;
     }
 
     void close() override {
         reader_.reset();
         lib_.reset();
+        memory_.reset();
         archive_path_.clear();
+        index_by_path_.clear();
     }
 
     bool isOpen() const noexcept override { return reader_ != nullptr; }
 
+    bool isSolid() const noexcept override {
+        try {
+            return reader_ && reader_->isSolid();
+        } catch (const bit7z::BitException&) {
+            return false;
+        }
+    }
+
     std::expected<ArchiveInfo, ArchiveError> getInfo() const override {
         if (!reader_) {
             return std::unexpected(ArchiveError::InternalError);
@@ -148,6 +189,7 @@ public:
             info.path = archive_path_;
             info.format = detect_format(archive_path_);
             info.is_encrypted = reader_->isEncrypted();
+            info.is_solid = reader_->isSolid();
 
             for (const auto& item : *reader_) {
                 ArchiveEntry entry;
@@ -193,54 +235,103 @@ public:
         }
 
         try {
-            // Find item index by path (normalize separators for comparison)
-            uint32_t found_index = UINT32_MAX;
-            for (const auto& item : *reader_) {
-                if (normalize_path_separators(item.path()) == entry_path) {
-                    found_index = item.index();
-                    break;
-                }
+            auto found_index = findIndex(entry_path);
+            if (!found_index) {
+                return std::unexpected(ArchiveError::NotFound);
             }
 
-            if (found_index == UINT32_MAX) {
-                return std::unexpected(ArchiveError::NotFound);
+            return extract_item(*found_index);
+
+        } catch (const bit7z::BitException&) {
+            return std::unexpected(ArchiveError::ExtractionFailed);
+        }
+    }
+
+    std::expected<size_t, ArchiveError>
+    extractBatch(const std::vector<std::wstring>& entry_paths, const ExtractItemCallback& on_item,
+                 const std::filesystem::path& scratch_dir) const override {
+        if (!reader_) {
+            return std::unexpected(ArchiveError::InternalError);
+        }
+
+        std::vector<uint32_t> indices;
+        indices.reserve(entry_paths.size());
+        for (const auto& entry_path : entry_paths) {
+            if (auto index = findIndex(entry_path)) {
+                indices.push_back(*index);
             }
+        }
+        // Archive order keeps the decompressor moving forward
+        std::sort(indices.begin(), indices.end());
 
-            bit7z::buffer_t buffer;
-            reader_->extractTo(buffer, found_index);
+        size_t delivered = 0;
 
-            // Convert bit7z::buffer_t to std::vector<uint8_t>
-            return std::vector<uint8_t>(buffer.begin(), buffer.end());
+        try {
+            if (!reader_->isSolid()) {
+                // Entries are independent; one extraction per entry costs nothing extra
+                for (uint32_t index : indices) {
+                    auto data = extract_item(index);
+                    ++delivered;
+                    if (!on_item(normalize_path_separators(reader_->itemAt(index).path()),
+                                 std::move(data))) {
+                        break;
+                    }
+                }
+                return delivered;
+            }
+
+            return extractSolidBatch(indices, on_item, scratch_dir);
 
         } catch (const bit7z::BitException&) {
+            reader_->setFileCallback(nullptr);
+            reader_->setProgressCallback(nullptr);
             return std::unexpected(ArchiveError::ExtractionFailed);
         }
     }
 
     std::expected<void, ArchiveError>
-    extractToFile(const std::wstring& entry_path, const std::filesystem::path& dest_path,
-                  ExtractProgressCallback progress) const override {
+    extractChunked(const std::wstring& entry_path,
+                   const ExtractChunkCallback& on_chunk) const override {
         if (!reader_) {
             return std::unexpected(ArchiveError::InternalError);
         }
 
+        ChunkStreamBuf buffer(on_chunk);
         try {
-            // Find item index by path (normalize separators for comparison)
-            uint32_t found_index = UINT32_MAX;
-            for (const auto& item : *reader_) {
-                if (normalize_path_separators(item.path()) == entry_path) {
-                    found_index = item.index();
-                    break;
-                }
+            auto found_index = findIndex(entry_path);
+            if (!found_index) {
+                return std::unexpected(ArchiveError::NotFound);
             }
 
-            if (found_index == UINT32_MAX) {
+            std::ostream stream(&buffer);
+            reader_->extractTo(stream, *found_index);
+            if (buffer.stopped()) {
+                return std::unexpected(ArchiveError::Cancelled);
+            }
+            return {};
+
+        } catch (const bit7z::BitException&) {
+            // A write refused by the stream surfaces as an exception
+            return std::unexpected(buffer.stopped() ? ArchiveError::Cancelled
+                                                    : ArchiveError::ExtractionFailed);
+        }
+    }
+
+    std::expected<void, ArchiveError>
+    extractToFile(const std::wstring& entry_path, const std::filesystem::path& dest_path,
+                  ExtractProgressCallback progress) const override {
+        if (!reader_) {
+            return std::unexpected(ArchiveError::InternalError);
+        }
+
+        try {
+            auto found_index = findIndex(entry_path);
+            if (!found_index) {
                 return std::unexpected(ArchiveError::NotFound);
             }
 
             // Extract to memory first, then write to file
-            bit7z::buffer_t buffer;
-            reader_->extractTo(buffer, found_index);
+            auto buffer = extract_item(*found_index);
 
             // Ensure destination directory exists
             std::error_code ec;
@@ -265,20 +356,30 @@ public:
             return std::unexpected(ArchiveError::InternalError);
         }
 
+        uint64_t total = 0;
+        bool cancelled = false;
         try {
             std::error_code ec;
             std::filesystem::create_directories(dest_dir, ec);
 
             if (progress) {
-                reader_->setProgressCallback(
-                    [&progress](uint64_t current) -> bool { return progress(current, current); });
+                reader_->setTotalCallback([&total](uint64_t value) { total = value; });
+                reader_->setProgressCallback([&](uint64_t current) -> bool {
+                    cancelled = !progress(current, std::max(total, current));
+                    return !cancelled;
+                });
             }
 
             reader_->extractTo(dest_dir.wstring());
+            reader_->setTotalCallback(nullptr);
+            reader_->setProgressCallback(nullptr);
             return {};
 
         } catch (const bit7z::BitException&) {
-            return std::unexpected(ArchiveError::ExtractionFailed);
+            reader_->setTotalCallback(nullptr);
+            reader_->setProgressCallback(nullptr);
+            return std::unexpected(cancelled ? ArchiveError::Cancelled
+                                             : ArchiveError::ExtractionFailed);
         }
     }
 
@@ -296,9 +397,143 @@ public:
     }
 
 private:
+    /// @brief Load 7z.dll and open a reader made by make_reader
+    template <typename MakeReader>
+    std::expected<void, ArchiveError> open_with(const std::filesystem::path& path,
+                                                MakeReader make_reader) {
+        auto dll_path = find_7z_dll();
+        if (!dll_path) {
+            return std::unexpected(ArchiveError::DllNotFound);
+        }
+
+        try {
+            lib_ = std::make_unique<bit7z::Bit7zLibrary>(dll_path->wstring());
+            reader_ = make_reader(*lib_);
+            archive_path_ = path;
+
+            // Index entries once so per-entry lookups are O(1)
+            index_by_path_.reserve(reader_->itemsCount());
+            for (const auto& item : *reader_) {
+                index_by_path_.emplace(normalize_path_separators(item.path()), item.index());
+            }
+            return {};
+
+        } catch (const bit7z::BitException& e) {
+            // Map bit7z exceptions to our error types using error_condition
+            auto condition = e.code().default_error_condition();
+            if (condition == bit7z::BitFailureSource::WrongPassword) {
+                return std::unexpected(ArchiveError::WrongPassword);
+            }
+            if (condition == bit7z::BitFailureSource::DataError ||
+                condition == bit7z::BitFailureSource::CRCError) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            return std::unexpected(ArchiveError::InternalError);
+        }
+    }
+
+    /// @brief Extract an entry straight into a buffer of its final size
+    ///
+    /// One allocation and no copy; extracting to a bit7z::buffer_t and
+    /// converting it would allocate twice and copy the whole entry.
+    [[nodiscard]] std::vector<uint8_t> extract_item(uint32_t index) const {
+        auto size = reader_->itemAt(index).size();
+        if (size == 0) {
+            // Empty, or a stream format that does not record the size up front
+            bit7z::buffer_t buffer;
+            reader_->extractTo(buffer, index);
+            return std::vector<uint8_t>(buffer.begin(), buffer.end());
+        }
+
+        std::vector<uint8_t> data(static_cast<size_t>(size));
+        reader_->extractTo(reinterpret_cast<bit7z::byte_t*>(data.data()), data.size(), index);
+        return data;
+    }
+
+    /// @brief Single-pass extraction of a solid archive through scratch_dir
+    ///
+    /// bit7z writes the selected entries to disk in one sequential pass; the
+    /// file callback announces each entry as it starts, at which point the
+    /// previous one is complete and can be handed to on_item and deleted.
+    [[nodiscard]] size_t extractSolidBatch(const std::vector<uint32_t>& indices,
+                                           const ExtractItemCallback& on_item,
+                                           const std::filesystem::path& scratch_dir) const {
+        std::error_code ec;
+        std::filesystem::create_directories(scratch_dir, ec);
+
+        size_t delivered = 0;
+        bool stopped = false;
+        std::optional<std::wstring> pending;  // Entry currently being written
+
+        auto deliver = [&](const std::wstring& entry_path) {
+            auto file_path = scratch_dir / entry_path;
+            std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+            if (file) {
+                auto size = static_cast<size_t>(file.tellg());
+                file.seekg(0, std::ios::beg);
+                std::vector<uint8_t> data(size);
+                if (file.read(reinterpret_cast<char*>(data.data()),
+                              static_cast<std::streamsize>(size))) {
+                    file.close();
+                    ++delivered;
+                    if (!on_item(entry_path, std::move(data))) {
+                        stopped = true;
+                    }
+                }
+            }
+            std::filesystem::remove(file_path, ec);
+        };
+
+        reader_->setFileCallback([&](const bit7z::tstring& item_path) {
+            if (pending && !stopped) {
+                deliver(*pending);
+            }
+            pending = normalize_path_separators(item_path);
+        });
+        // Returning false from the progress callback aborts the pass
+        reader_->setProgressCallback([&stopped](uint64_t) { return !stopped; });
+
+        try {
+            reader_->extractTo(scratch_dir.wstring(), indices);
+        } catch (const bit7z::BitException&) {
+            // An abort requested through the progress callback surfaces as an exception
+            if (!stopped) {
+                reader_->setFileCallback(nullptr);
+                reader_->setProgressCallback(nullptr);
+                std::filesystem::remove_all(scratch_dir, ec);
+                throw;
+            }
+        }
+
+        reader_->setFileCallback(nullptr);
+        reader_->setProgressCallback(nullptr);
+
+        if (pending && !stopped) {
+            deliver(*pending);
+        }
+
+        std::filesystem::remove_all(scratch_dir, ec);
+        return delivered;
+    }
+
+    /// @brief Look up an entry index by path (either separator style)
+    [[nodiscard]] std::optional<uint32_t> findIndex(const std::wstring& entry_path) const {
+        // Entry paths produced by this reader are already normalized, so the
+        // common case needs no temporary string
+        auto it = entry_path.find(L'\\') == std::wstring::npos
+                      ? index_by_path_.find(entry_path)
+                      : index_by_path_.find(normalize_path_separators(entry_path));
+        if (it == index_by_path_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::shared_ptr<const std::vector<uint8_t>> memory_;  // Contents, if opened from memory
     std::unique_ptr<bit7z::Bit7zLibrary> lib_;
     std::unique_ptr<bit7z::BitArchiveReader> reader_;
     std::filesystem::path archive_path_;
+    std::unordered_map<std::wstring, uint32_t> index_by_path_;  // Normalized path -> item index
 };
 
 #else  // !NIVE_HAS_BIT7Z
@@ -311,10 +546,18 @@ public:
         return std::unexpected(ArchiveError::DllNotFound);
     }
 
+    std::expected<void, ArchiveError> openFromMemory(std::shared_ptr<const std::vector<uint8_t>>,
+                                                     const std::filesystem::path&,
+                                                     const std::wstring&) override {
+        return std::unexpected(ArchiveError::DllNotFound);
+    }
+
     void close() override {}
 
     bool isOpen() const noexcept override { return false; }
 
+    bool isSolid() const noexcept override { return false; }
+
     std::expected<ArchiveInfo, ArchiveError> getInfo() const override {
         return std::unexpected(ArchiveError::DllNotFound);
     }
@@ -328,6 +571,17 @@ public:
         return std::unexpected(ArchiveError::DllNotFound);
     }
 
+    std::expected<size_t, ArchiveError> extractBatch(const std::vector<std::wstring>&,
+                                                     const ExtractItemCallback&,
+                                                     const std::filesystem::path&) const override {
+        return std::unexpected(ArchiveError::DllNotFound);
+    }
+
+    std::expected<void, ArchiveError> extractChunked(const std::wstring&,
+                                                     const ExtractChunkCallback&) const override {
+        return std::unexpected(ArchiveError::DllNotFound);
+    }
+
     std::expected<void, ArchiveError> extractToFile(const std::wstring&,
                                                     const std::filesystem::path&,
                                                     ExtractProgressCallback) const override {
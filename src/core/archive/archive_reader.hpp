@@ -21,6 +21,18 @@ namespace nive::archive {
 /// @return false to cancel
 using ExtractProgressCallback = std::function<bool(uint64_t current, uint64_t total)>;
 
+/// @brief Callback receiving one entry of a batch extraction
+/// @param entry_path Path of entry inside archive
+/// @param data Entry contents
+/// @return false to stop the batch
+using ExtractItemCallback =
+    std::function<bool(const std::wstring& entry_path, std::vector<uint8_t> data)>;
+
+/// @brief Callback receiving an entry's contents piece by piece, in order
+/// @param chunk Next part of the entry (valid only during the call)
+/// @return false to stop the extraction
+using ExtractChunkCallback = std::function<bool(std::span<const uint8_t> chunk)>;
+
 /// @brief Archive reader interface
 ///
 /// Abstract interface for reading archive contents.
@@ -36,12 +48,24 @@ public:
     [[nodiscard]] virtual std::expected<void, ArchiveError>
     open(const std::filesystem::path& path, const std::wstring& password = L"") = 0;
 
+    /// @brief Open an archive held in memory, such as one inside another archive
+    /// @param data Archive contents, kept alive by the reader while it is open
+    /// @param path Path reported by getInfo() and used to tell the format (need not exist)
+    /// @param password Optional password for encrypted archives
+    /// @return Success or error
+    [[nodiscard]] virtual std::expected<void, ArchiveError>
+    openFromMemory(std::shared_ptr<const std::vector<uint8_t>> data,
+                   const std::filesystem::path& path, const std::wstring& password = L"") = 0;
+
     /// @brief Close the archive
     virtual void close() = 0;
 
     /// @brief Check if archive is open
     [[nodiscard]] virtual bool isOpen() const noexcept = 0;
 
+    /// @brief Check if the archive is solid (entries share compressed blocks)
+    [[nodiscard]] virtual bool isSolid() const noexcept = 0;
+
     /// @brief Get archive information
     [[nodiscard]] virtual std::expected<ArchiveInfo, ArchiveError> getInfo() const = 0;
 
@@ -55,6 +79,28 @@ public:
     [[nodiscard]] virtual std::expected<std::vector<uint8_t>, ArchiveError>
     extractToMemory(const std::wstring& entry_path) const = 0;
 
+    /// @brief Extract several entries in one pass
+    /// @param entry_paths Paths of entries inside archive (unknown paths are skipped)
+    /// @param on_item Called as each entry completes, in archive order
+    /// @param scratch_dir Directory for intermediate files (solid archives only)
+    /// @return Number of entries delivered or error
+    ///
+    /// Solid archives are decompressed sequentially once instead of
+    /// re-decompressing the solid block for every entry.
+    [[nodiscard]] virtual std::expected<size_t, ArchiveError>
+    extractBatch(const std::vector<std::wstring>& entry_paths, const ExtractItemCallback& on_item,
+                 const std::filesystem::path& scratch_dir) const = 0;
+
+    /// @brief Extract a single entry, passing its contents on as they are decompressed
+    /// @param entry_path Path of entry inside archive
+    /// @param on_chunk Called with each part of the entry, in order
+    /// @return Success, or error (Cancelled if on_chunk returned false)
+    ///
+    /// The entry is never held in memory whole, so this suits writing large
+    /// entries to disk (see ExtractPipeline).
+    [[nodiscard]] virtual std::expected<void, ArchiveError>
+    extractChunked(const std::wstring& entry_path, const ExtractChunkCallback& on_chunk) const = 0;
+
     /// @brief Extract a single entry to file
     /// @param entry_path Path of entry inside archive
     /// @param dest_path Destination file path
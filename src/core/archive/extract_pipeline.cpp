@@ -0,0 +1,381 @@
+/// @file extract_pipeline.cpp
+/// @brief Extraction pipeline implementation
+///
+/// The writer thread is what keeps decompression going: writes that extend
+/// a file can complete synchronously on NTFS even when issued overlapped,
+/// and they then block only the writer, never the extracting thread.
+
+#include "extract_pipeline.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "../util/win32_utils.hpp"
+
+namespace nive::archive {
+
+namespace {
+
+constexpr size_t kChunkSize = 1024 * 1024;
+constexpr size_t kChunkCount = 8;   // At most this many chunks are allocated
+constexpr size_t kMaxInFlight = 4;  // Overlapped writes outstanding per file
+
+/// @brief Create a destination file for overlapped writes
+[[nodiscard]] HandleGuard open_file(const std::filesystem::path& path, uint64_t size_hint) {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    HandleGuard file(CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED |
+                                     FILE_FLAG_SEQUENTIAL_SCAN,
+                                 nullptr));
+    if (file && size_hint > 0) {
+        // Reserving the clusters up front keeps a large file in one piece
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size_hint);
+        SetFileInformationByHandle(file.get(), FileAllocationInfo, &allocation,
+                                   sizeof(allocation));
+    }
+    return file;
+}
+
+}  // namespace
+
+class ExtractPipeline::Impl {
+public:
+    Impl(uint64_t total_bytes, ExtractProgressCallback progress)
+        : total_bytes_(total_bytes), progress_(std::move(progress)), chunks_(kChunkCount) {
+        for (size_t i = 0; i < kChunkCount; ++i) {
+            free_.push_back(i);
+        }
+        for (auto& slot : slots_) {
+            slot.event = HandleGuard(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+        }
+        writer_ = std::jthread([this] { run(); });
+    }
+
+    ~Impl() { abort(); }
+
+    // Extracting thread
+
+    bool beginFile(const std::filesystem::path& path, uint64_t size_hint) {
+        return flush_chunk() && push({Op::Kind::Begin, path, size_hint});
+    }
+
+    bool write(std::span<const uint8_t> data) {
+        while (!data.empty()) {
+            if (!filling_) {
+                filling_ = acquire_chunk();
+                if (!filling_) {
+                    return false;
+                }
+                filled_ = 0;
+            }
+            size_t count = std::min(data.size(), kChunkSize - filled_);
+            std::memcpy(chunks_[*filling_].data() + filled_, data.data(), count);
+            filled_ += count;
+            data = data.subspan(count);
+            if (filled_ == kChunkSize && !flush_chunk()) {
+                return false;
+            }
+        }
+        return report_progress();
+    }
+
+    bool endFile() { return flush_chunk() && push({Op::Kind::End}) && report_progress(); }
+
+    std::expected<void, ArchiveError> finish() {
+        if (flush_chunk()) {
+            std::lock_guard lock(mutex_);
+            if (state_ == State::Running) {
+                state_ = State::Finishing;
+            }
+        }
+        cv_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+        if (error_) {
+            return std::unexpected(*error_);
+        }
+        if (progress_) {
+            progress_(written_.load(), total_bytes_);
+        }
+        return {};
+    }
+
+    void abort() {
+        {
+            std::lock_guard lock(mutex_);
+            if (state_ == State::Running) {
+                state_ = State::Aborted;
+                error_ = error_.value_or(ArchiveError::Cancelled);
+            }
+        }
+        cv_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+    }
+
+private:
+    struct Op {
+        enum class Kind { Begin, Data, End } kind = Kind::Data;
+        std::filesystem::path path;  // Begin
+        uint64_t size_hint = 0;      // Begin
+        size_t chunk = 0;            // Data
+        size_t length = 0;           // Data
+    };
+
+    /// @brief One overlapped write in flight
+    struct Slot {
+        OVERLAPPED overlapped{};
+        HandleGuard event;
+        size_t chunk = 0;
+        size_t length = 0;
+    };
+
+    enum class State { Running, Finishing, Aborted };
+
+    /// @brief Check if the run has stopped (mutex_ held)
+    [[nodiscard]] bool stopped() const noexcept {
+        return state_ == State::Aborted || error_.has_value();
+    }
+
+    bool push(Op op) {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopped()) {
+                return false;
+            }
+            ops_.push_back(std::move(op));
+        }
+        cv_.notify_all();
+        return true;
+    }
+
+    /// @brief Wait for a free chunk buffer
+    [[nodiscard]] std::optional<size_t> acquire_chunk() {
+        size_t chunk = 0;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return !free_.empty() || stopped(); });
+            if (stopped()) {
+                return std::nullopt;
+            }
+            chunk = free_.back();
+            free_.pop_back();
+        }
+        // Allocated on first use, so small files never touch most chunks
+        if (chunks_[chunk].empty()) {
+            chunks_[chunk].resize(kChunkSize);
+        }
+        return chunk;
+    }
+
+    /// @brief Queue the chunk being filled, if it holds anything
+    bool flush_chunk() {
+        if (!filling_ || filled_ == 0) {
+            std::lock_guard lock(mutex_);
+            return !stopped();
+        }
+        Op op{Op::Kind::Data};
+        op.chunk = *filling_;
+        op.length = filled_;
+        filling_.reset();
+        filled_ = 0;
+        return push(std::move(op));
+    }
+
+    bool report_progress() {
+        uint64_t written = written_.load();
+        if (!progress_ || written == reported_) {
+            return true;
+        }
+        reported_ = written;
+        if (progress_(written, total_bytes_)) {
+            return true;
+        }
+        fail(ArchiveError::Cancelled);
+        return false;
+    }
+
+    void fail(ArchiveError error) {
+        {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = error;
+            }
+        }
+        cv_.notify_all();
+    }
+
+    void release(size_t chunk) {
+        {
+            std::lock_guard lock(mutex_);
+            free_.push_back(chunk);
+        }
+        cv_.notify_all();
+    }
+
+    // Writer thread
+
+    void run() {
+        HandleGuard file;
+        std::filesystem::path file_path;
+        uint64_t offset = 0;
+
+        for (;;) {
+            Op op;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] {
+                    return !ops_.empty() || state_ != State::Running || error_.has_value();
+                });
+                if (stopped() || ops_.empty()) {
+                    break;
+                }
+                op = std::move(ops_.front());
+                ops_.pop_front();
+            }
+
+            switch (op.kind) {
+            case Op::Kind::Begin:
+                file = open_file(op.path, op.size_hint);
+                file_path = std::move(op.path);
+                offset = 0;
+                if (!file) {
+                    fail(ArchiveError::IoError);
+                }
+                break;
+            case Op::Kind::Data:
+                if (!file || !submit(file.get(), op.chunk, op.length, offset)) {
+                    fail(ArchiveError::IoError);
+                }
+                offset += op.length;
+                break;
+            case Op::Kind::End:
+                if (!drain(file.get())) {
+                    fail(ArchiveError::IoError);
+                    break;
+                }
+                file.close();
+                file_path.clear();
+                break;
+            }
+        }
+
+        // A file still open here was not completed
+        drain(file.get());
+        if (file) {
+            file.close();
+            DeleteFileW(file_path.c_str());
+        }
+    }
+
+    /// @brief Start an overlapped write of a chunk, first waiting for a slot
+    bool submit(HANDLE file, size_t chunk, size_t length, uint64_t offset) {
+        if (in_flight_ == kMaxInFlight && !complete_oldest(file)) {
+            release(chunk);
+            return false;
+        }
+        auto& slot = slots_[(head_ + in_flight_) % kMaxInFlight];
+        slot.overlapped = {};
+        slot.overlapped.Offset = static_cast<DWORD>(offset);
+        slot.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        slot.overlapped.hEvent = slot.event.get();
+        slot.chunk = chunk;
+        slot.length = length;
+        if (!WriteFile(file, chunks_[chunk].data(), static_cast<DWORD>(length), nullptr,
+                       &slot.overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            release(chunk);
+            return false;
+        }
+        ++in_flight_;
+        return true;
+    }
+
+    /// @brief Wait for the oldest write and recycle its chunk
+    bool complete_oldest(HANDLE file) {
+        auto& slot = slots_[head_];
+        head_ = (head_ + 1) % kMaxInFlight;
+        --in_flight_;
+        DWORD done = 0;
+        bool ok = GetOverlappedResult(file, &slot.overlapped, &done, TRUE) && done == slot.length;
+        if (ok) {
+            written_ += done;
+        }
+        release(slot.chunk);
+        return ok;
+    }
+
+    /// @brief Wait for every write in flight
+    bool drain(HANDLE file) {
+        bool ok = true;
+        while (in_flight_ > 0) {
+            ok = complete_oldest(file) && ok;
+        }
+        return ok;
+    }
+
+    const uint64_t total_bytes_;
+    ExtractProgressCallback progress_;
+    std::vector<std::vector<uint8_t>> chunks_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Op> ops_;        // Guarded by mutex_
+    std::vector<size_t> free_;  // Guarded by mutex_
+    State state_ = State::Running;       // Guarded by mutex_
+    std::optional<ArchiveError> error_;  // Guarded by mutex_
+    std::atomic<uint64_t> written_{0};
+
+    // Extracting thread only
+    std::optional<size_t> filling_;  // Chunk being filled by write()
+    size_t filled_ = 0;
+    uint64_t reported_ = 0;
+
+    // Writer thread only
+    std::array<Slot, kMaxInFlight> slots_;
+    size_t head_ = 0;  // Oldest slot in flight
+    size_t in_flight_ = 0;
+
+    std::jthread writer_;
+};
+
+ExtractPipeline::ExtractPipeline(uint64_t total_bytes, ExtractProgressCallback progress)
+    : impl_(std::make_unique<Impl>(total_bytes, std::move(progress))) {}
+
+ExtractPipeline::~ExtractPipeline() = default;
+
+bool ExtractPipeline::beginFile(const std::filesystem::path& path, uint64_t size_hint) {
+    return impl_->beginFile(path, size_hint);
+}
+
+bool ExtractPipeline::write(std::span<const uint8_t> data) {
+    return impl_->write(data);
+}
+
+bool ExtractPipeline::endFile() {
+    return impl_->endFile();
+}
+
+std::expected<void, ArchiveError> ExtractPipeline::finish() {
+    return impl_->finish();
+}
+
+void ExtractPipeline::abort() {
+    impl_->abort();
+}
+
+}  // namespace nive::archive
@@ -0,0 +1,69 @@
+/// @file extract_pipeline.hpp
+/// @brief Writes extracted files on a writer thread while the caller decompresses
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+#include "archive_error.hpp"
+#include "archive_reader.hpp"
+
+namespace nive::archive {
+
+/// @brief Bounded producer/consumer pipeline from a decompressor to the disk
+///
+/// The extracting thread adds each file with beginFile(), write() and
+/// endFile(). Data is copied into one of a fixed set of chunk buffers and
+/// queued, so write() blocks only while every chunk is queued or being
+/// written; memory stays bounded however large the files are. A writer
+/// thread keeps several overlapped WriteFile calls outstanding per file, so
+/// the disk has the next chunk while the decompressor produces the one
+/// after it.
+///
+/// Progress counts bytes on disk and is reported on the extracting thread;
+/// returning false from it cancels the run. A file left incomplete by an
+/// error or cancellation is deleted.
+class ExtractPipeline {
+public:
+    /// @param total_bytes Total size of the files to be written, passed to progress
+    /// @param progress Progress callback (optional)
+    ExtractPipeline(uint64_t total_bytes, ExtractProgressCallback progress);
+
+    /// @brief Stop the writer, as abort() unless finish() was called
+    ~ExtractPipeline();
+
+    ExtractPipeline(const ExtractPipeline&) = delete;
+    ExtractPipeline& operator=(const ExtractPipeline&) = delete;
+
+    /// @brief Start the next file, creating its parent directories
+    /// @param path Destination file path
+    /// @param size_hint Expected size, reserved on disk up front (0 if unknown)
+    /// @return false if the run has stopped (see finish())
+    [[nodiscard]] bool beginFile(const std::filesystem::path& path, uint64_t size_hint);
+
+    /// @brief Append data to the current file
+    /// @return false if the run has stopped (see finish())
+    [[nodiscard]] bool write(std::span<const uint8_t> data);
+
+    /// @brief Complete the current file
+    /// @return false if the run has stopped (see finish())
+    [[nodiscard]] bool endFile();
+
+    /// @brief Wait until everything queued is on disk
+    /// @return Success, IoError if a file could not be written, or Cancelled if
+    ///         progress returned false or abort() was called
+    [[nodiscard]] std::expected<void, ArchiveError> finish();
+
+    /// @brief Stop without writing what is still queued (e.g. the decompressor failed)
+    void abort();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::archive
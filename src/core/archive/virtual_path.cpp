@@ -14,6 +14,13 @@ VirtualPath::VirtualPath(const std::filesystem::path& path)
 VirtualPath::VirtualPath(const std::filesystem::path& archive_path,
                          const std::wstring& internal_path)
     : archive_path_(archive_path), internal_path_(internal_path) {
+    // Archives the internal path passes through belong to the archive path
+    auto nested = internal_path_.rfind(kVirtualPathSeparator);
+    if (nested != std::wstring::npos) {
+        archive_path_ = VirtualPath(archive_path, internal_path_.substr(0, nested)).to_string();
+        internal_path_.erase(0, nested + 1);
+    }
+
     // Normalize internal path separators to forward slash
     std::replace(internal_path_.begin(), internal_path_.end(), L'\\', L'/');
 
@@ -24,14 +31,14 @@ VirtualPath::VirtualPath(const std::filesystem::path& archive_path,
 }
 
 VirtualPath VirtualPath::parse(const std::wstring& path_string) {
-    auto sep_pos = path_string.find(kVirtualPathSeparator);
+    auto sep_pos = path_string.rfind(kVirtualPathSeparator);
 
     if (sep_pos == std::wstring::npos) {
         // Regular filesystem path
         return VirtualPath(std::filesystem::path(path_string));
     }
 
-    // Virtual path: archive|internal
+    // Virtual path: archive|internal, where the archive may be nested itself
     std::wstring archive_part = path_string.substr(0, sep_pos);
     std::wstring internal_part = path_string.substr(sep_pos + 1);
 
@@ -59,6 +66,16 @@ std::wstring VirtualPath::extension() const {
     return name.substr(pos);
 }
 
+std::filesystem::path VirtualPath::file_path() const {
+    const auto& path = archive_path_.native();
+    auto pos = path.find(kVirtualPathSeparator);
+    return pos == std::wstring::npos ? archive_path_ : std::filesystem::path(path.substr(0, pos));
+}
+
+VirtualPath VirtualPath::container() const {
+    return parse(archive_path_.native());
+}
+
 VirtualPath VirtualPath::parent_path() const {
     if (is_in_archive()) {
         auto pos = internal_path_.find_last_of(L"/\\");
@@ -69,6 +86,11 @@ VirtualPath VirtualPath::parent_path() const {
         return VirtualPath(archive_path_, internal_path_.substr(0, pos));
     }
 
+    // The root of a nested archive lies in the directory holding it
+    if (is_nested()) {
+        return container().parent_path();
+    }
+
     // Regular filesystem path
     auto parent = archive_path_.parent_path();
     if (parent.empty() || parent == archive_path_) {
@@ -4,6 +4,12 @@
 /// A virtual path represents a location that may be inside an archive.
 /// Format: "C:\path\to\archive.zip|internal/path/to/file.jpg"
 /// The pipe character '|' separates the archive path from the internal path.
+///
+/// Archives inside archives add a separator per level:
+/// "C:\comics.zip|vol1.cbz|page01.jpg". The archive path is then everything
+/// before the last separator ("C:\comics.zip|vol1.cbz"), which names the
+/// inner archive for ArchiveManager but is not a file on disk; file_path()
+/// is the outermost archive that is.
 
 #pragma once
 
@@ -26,6 +32,9 @@ public:
     explicit VirtualPath(const std::filesystem::path& path);
 
     /// @brief Construct from archive path and internal path
+    ///
+    /// Separators in internal_path move the archives it passes through into
+    /// the archive path, so every spelling of a nested path compares equal.
     VirtualPath(const std::filesystem::path& archive_path, const std::wstring& internal_path);
 
     /// @brief Parse virtual path string
@@ -39,6 +48,11 @@ public:
     /// @brief Check if path is a regular filesystem path
     [[nodiscard]] bool is_filesystem_path() const noexcept { return !is_in_archive(); }
 
+    /// @brief Check if the archive is itself inside an archive
+    [[nodiscard]] bool is_nested() const noexcept {
+        return archive_path_.native().find(kVirtualPathSeparator) != std::wstring::npos;
+    }
+
     /// @brief Check if path is empty
     [[nodiscard]] bool empty() const noexcept {
         return archive_path_.empty() && internal_path_.empty();
@@ -49,6 +63,13 @@ public:
         return archive_path_;
     }
 
+    /// @brief Get the file on disk: the outermost archive, or the path itself
+    [[nodiscard]] std::filesystem::path file_path() const;
+
+    /// @brief Get the archive as an entry of the archive holding it
+    /// @return Path of the inner archive for nested paths, else the archive path
+    [[nodiscard]] VirtualPath container() const;
+
     /// @brief Get the internal path within the archive
     /// @return Internal path, or empty if not in archive
     [[nodiscard]] const std::wstring& internal_path() const noexcept { return internal_path_; }
@@ -0,0 +1,752 @@
+/// @file zip_reader.cpp
+/// @brief Built-in ZIP reader implementation
+///
+/// Deflate data is inflated with libdeflate when it is available
+/// (NIVE_HAS_LIBDEFLATE), otherwise with zlib (NIVE_HAS_ZLIB). Without
+/// either, only archives whose entries are all stored are accepted.
+
+#include "zip_reader.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#ifdef NIVE_HAS_LIBDEFLATE
+    #include <libdeflate.h>
+#elif defined(NIVE_HAS_ZLIB)
+    #include <zlib.h>
+#endif
+
+#include "../fs/file_metadata.hpp"
+#include "../util/mapped_file.hpp"
+#include "../util/string_utils.hpp"
+
+namespace nive::archive {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034B50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014B50;
+constexpr uint32_t kEndSignature = 0x06054B50;
+constexpr uint32_t kZip64EndSignature = 0x06064B50;
+constexpr uint32_t kZip64LocatorSignature = 0x07064B50;
+
+constexpr size_t kLocalHeaderSize = 30;
+constexpr size_t kCentralHeaderSize = 46;
+constexpr size_t kEndSize = 22;
+constexpr size_t kZip64LocatorSize = 20;
+constexpr size_t kZip64EndSize = 56;
+constexpr size_t kMaxCommentSize = 0xFFFF;
+
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflate = 8;
+
+constexpr uint16_t kFlagEncrypted = 0x0001;
+constexpr uint16_t kFlagUtf8 = 0x0800;
+
+constexpr uint16_t kExtraZip64 = 0x0001;
+constexpr uint16_t kExtraNtfs = 0x000A;
+
+// Stored entries are passed to chunk callbacks in pieces of this size
+constexpr size_t kStoredChunkSize = 1024 * 1024;
+
+template <typename T>
+[[nodiscard]] T read_le(const uint8_t* p) noexcept {
+    T value;
+    std::memcpy(&value, p, sizeof(T));  // x86 and x64 are little-endian, like ZIP
+    return value;
+}
+
+[[nodiscard]] uint32_t crc32_of(const uint8_t* data, size_t size) noexcept {
+#ifdef NIVE_HAS_LIBDEFLATE
+    return libdeflate_crc32(0, data, size);
+#elif defined(NIVE_HAS_ZLIB)
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    while (size > 0) {
+        auto chunk = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+        crc = ::crc32(crc, data, chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return static_cast<uint32_t>(crc);
+#else
+    static const auto table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+#endif
+}
+
+/// @brief Raw deflate decompressor, reused across entries
+class Inflater {
+public:
+    Inflater() = default;
+    ~Inflater() {
+#ifdef NIVE_HAS_LIBDEFLATE
+        if (decompressor_) {
+            libdeflate_free_decompressor(decompressor_);
+        }
+#elif defined(NIVE_HAS_ZLIB)
+        if (initialized_) {
+            inflateEnd(&stream_);
+        }
+#endif
+    }
+
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    /// @brief Inflate a whole entry
+    /// @return true if the stream decoded to exactly out_size bytes
+    [[nodiscard]] bool inflate(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+#ifdef NIVE_HAS_LIBDEFLATE
+        if (!decompressor_ && !(decompressor_ = libdeflate_alloc_decompressor())) {
+            return false;
+        }
+        // No actual size out-parameter: anything but exactly out_size bytes fails
+        return libdeflate_deflate_decompress(decompressor_, in, in_size, out, out_size,
+                                             nullptr) == LIBDEFLATE_SUCCESS;
+#elif defined(NIVE_HAS_ZLIB)
+        if (!initialized_) {
+            if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK) {
+                return false;
+            }
+            initialized_ = true;
+        } else if (inflateReset(&stream_) != Z_OK) {
+            return false;
+        }
+
+        // zlib counts in uInt, so entries over 4 GiB are fed in pieces
+        constexpr size_t kMaxChunk = std::numeric_limits<uInt>::max();
+        stream_.next_in = const_cast<Bytef*>(in);
+        stream_.avail_in = 0;
+        stream_.next_out = out;
+        stream_.avail_out = 0;
+        for (;;) {
+            if (stream_.avail_in == 0 && in_size > 0) {
+                stream_.avail_in = static_cast<uInt>(std::min(in_size, kMaxChunk));
+                in_size -= stream_.avail_in;
+            }
+            if (stream_.avail_out == 0 && out_size > 0) {
+                stream_.avail_out = static_cast<uInt>(std::min(out_size, kMaxChunk));
+                out_size -= stream_.avail_out;
+            }
+            int status = ::inflate(&stream_, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                return out_size == 0 && stream_.avail_out == 0;
+            }
+            if (status != Z_OK) {
+                return false;  // Corrupt, truncated or longer than stated
+            }
+        }
+#else
+        (void)in;
+        (void)in_size;
+        (void)out;
+        (void)out_size;
+        return false;
+#endif
+    }
+
+private:
+#ifdef NIVE_HAS_LIBDEFLATE
+    libdeflate_decompressor* decompressor_ = nullptr;
+#elif defined(NIVE_HAS_ZLIB)
+    z_stream stream_{};
+    bool initialized_ = false;
+#endif
+};
+
+/// @brief Decode an entry name (UTF-8 if flagged, the OEM code page otherwise, as 7-Zip does)
+[[nodiscard]] std::wstring decode_name(const uint8_t* name, size_t size, bool utf8) {
+    std::string_view bytes(reinterpret_cast<const char*>(name), size);
+    if (utf8) {
+        return utf8ToWideOrEmpty(bytes);
+    }
+    int length = MultiByteToWideChar(CP_OEMCP, 0, bytes.data(), static_cast<int>(bytes.size()),
+                                     nullptr, 0);
+    std::wstring result(static_cast<size_t>(std::max(length, 0)), L'\0');
+    if (length > 0) {
+        MultiByteToWideChar(CP_OEMCP, 0, bytes.data(), static_cast<int>(bytes.size()),
+                            result.data(), length);
+    }
+    return result;
+}
+
+[[nodiscard]] std::chrono::system_clock::time_point dos_time_to_system_clock(uint16_t date,
+                                                                             uint16_t time) {
+    FILETIME local{};
+    FILETIME utc{};
+    if (!DosDateTimeToFileTime(date, time, &local) || !LocalFileTimeToFileTime(&local, &utc)) {
+        return {};
+    }
+    return fs::fileTimeToSystemClock((static_cast<uint64_t>(utc.dwHighDateTime) << 32) |
+                                     utc.dwLowDateTime);
+}
+
+}  // namespace
+
+class ZipReader::Impl {
+public:
+    /// @brief Entry with where to find its data
+    struct Item {
+        ArchiveEntry entry;
+        uint64_t header_offset = 0;  // Local file header
+        uint16_t method = kMethodStored;
+    };
+
+    std::expected<void, ArchiveError> open(const std::filesystem::path& path) {
+        close();
+
+        if (!std::filesystem::exists(path)) {
+            return std::unexpected(ArchiveError::NotFound);
+        }
+        file_ = MappedFile::open(path, MappedFile::Access::Random);
+        if (!file_) {
+            return std::unexpected(ArchiveError::IoError);
+        }
+        bytes_ = std::span<const uint8_t>(file_->data(), static_cast<size_t>(file_->size()));
+        return finish_open(path);
+    }
+
+    std::expected<void, ArchiveError> openFromMemory(
+        std::shared_ptr<const std::vector<uint8_t>> data, const std::filesystem::path& path) {
+        close();
+
+        if (!data) {
+            return std::unexpected(ArchiveError::InternalError);
+        }
+        memory_ = std::move(data);
+        bytes_ = *memory_;
+        return finish_open(path);
+    }
+
+    void close() {
+        file_.reset();
+        memory_.reset();
+        bytes_ = {};
+        path_.clear();
+        items_.clear();
+        index_by_path_.clear();
+    }
+
+    [[nodiscard]] bool isOpen() const noexcept { return bytes_.data() != nullptr; }
+
+    [[nodiscard]] const std::vector<Item>& items() const noexcept { return items_; }
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return path_; }
+
+    /// @brief Look up an entry by path (either separator style)
+    [[nodiscard]] const Item* find(const std::wstring& entry_path) const {
+        auto it = entry_path.find(L'\\') == std::wstring::npos
+                      ? index_by_path_.find(entry_path)
+                      : index_by_path_.find(normalize(entry_path));
+        return it == index_by_path_.end() ? nullptr : &items_[it->second];
+    }
+
+    /// @brief Decompress an entry and check its CRC
+    [[nodiscard]] std::expected<std::vector<uint8_t>, ArchiveError>
+    extract(const Item& item) const {
+        auto data = data_of(item);
+        if (!data) {
+            return std::unexpected(data.error());
+        }
+
+        std::vector<uint8_t> out;
+        try {
+            out.resize(static_cast<size_t>(item.entry.uncompressed_size));
+        } catch (const std::bad_alloc&) {
+            return std::unexpected(ArchiveError::OutOfMemory);
+        }
+
+        if (item.method == kMethodStored) {
+            std::memcpy(out.data(), data->data(), out.size());
+        } else if (!inflater_.inflate(data->data(), data->size(), out.data(), out.size())) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+
+        if (crc32_of(out.data(), out.size()) != item.entry.crc32) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+        return out;
+    }
+
+    /// @brief Pass an entry on in pieces, stored ones straight from the mapping
+    [[nodiscard]] std::expected<void, ArchiveError>
+    extractChunked(const Item& item, const ExtractChunkCallback& on_chunk) const {
+        if (item.method != kMethodStored) {
+            // Inflated whole: the inflater works on complete buffers
+            auto out = extract(item);
+            if (!out) {
+                return std::unexpected(out.error());
+            }
+            if (!on_chunk(*out)) {
+                return std::unexpected(ArchiveError::Cancelled);
+            }
+            return {};
+        }
+
+        auto data = data_of(item);
+        if (!data) {
+            return std::unexpected(data.error());
+        }
+        // Checked first, so a corrupt entry is never passed on
+        if (crc32_of(data->data(), data->size()) != item.entry.crc32) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+        for (size_t offset = 0; offset < data->size(); offset += kStoredChunkSize) {
+            size_t length = std::min(kStoredChunkSize, data->size() - offset);
+            if (!on_chunk(data->subspan(offset, length))) {
+                return std::unexpected(ArchiveError::Cancelled);
+            }
+        }
+        return {};
+    }
+
+private:
+    std::expected<void, ArchiveError> finish_open(const std::filesystem::path& path) {
+        auto result = parse();
+        if (!result) {
+            close();
+            return result;
+        }
+        path_ = path;
+        return {};
+    }
+
+    [[nodiscard]] static std::wstring normalize(std::wstring path) {
+        std::replace(path.begin(), path.end(), L'\\', L'/');
+        return path;
+    }
+
+    /// @brief Locate an entry's compressed bytes through its local header
+    ///
+    /// Done on extraction rather than on open, so listing a large archive
+    /// touches only the central directory pages.
+    [[nodiscard]] std::expected<std::span<const uint8_t>, ArchiveError>
+    data_of(const Item& item) const {
+        const uint8_t* base = bytes_.data();
+        uint64_t size = bytes_.size();
+        if (size < kLocalHeaderSize || item.header_offset > size - kLocalHeaderSize) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+        const uint8_t* header = base + item.header_offset;
+        if (read_le<uint32_t>(header) != kLocalHeaderSignature) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+        uint64_t start = item.header_offset + kLocalHeaderSize + read_le<uint16_t>(header + 26) +
+                         read_le<uint16_t>(header + 28);
+        uint64_t length = item.entry.compressed_size;
+        if (start > size || length > size - start) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+        return std::span<const uint8_t>(base + start, static_cast<size_t>(length));
+    }
+
+    /// @brief Read the end records and the central directory
+    [[nodiscard]] std::expected<void, ArchiveError> parse() {
+        const uint8_t* base = bytes_.data();
+        uint64_t size = bytes_.size();
+        if (size < kEndSize) {
+            return std::unexpected(ArchiveError::UnsupportedFormat);
+        }
+
+        // The end record is followed only by the archive comment
+        uint64_t lowest = size > kEndSize + kMaxCommentSize ? size - kEndSize - kMaxCommentSize : 0;
+        std::optional<uint64_t> end_offset;
+        for (uint64_t pos = size - kEndSize + 1; pos-- > lowest;) {
+            if (read_le<uint32_t>(base + pos) == kEndSignature &&
+                pos + kEndSize + read_le<uint16_t>(base + pos + 20) <= size) {
+                end_offset = pos;
+                break;
+            }
+        }
+        if (!end_offset) {
+            return std::unexpected(ArchiveError::UnsupportedFormat);
+        }
+
+        const uint8_t* end = base + *end_offset;
+        if (read_le<uint16_t>(end + 4) != 0 || read_le<uint16_t>(end + 6) != 0) {
+            return std::unexpected(ArchiveError::UnsupportedFormat);  // Split archive
+        }
+        uint64_t count = read_le<uint16_t>(end + 10);
+        uint64_t directory_size = read_le<uint32_t>(end + 12);
+        uint64_t directory_offset = read_le<uint32_t>(end + 16);
+
+        if (count == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF) {
+            if (*end_offset < kZip64LocatorSize) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            const uint8_t* locator = end - kZip64LocatorSize;
+            if (read_le<uint32_t>(locator) != kZip64LocatorSignature) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            if (read_le<uint32_t>(locator + 16) > 1) {
+                return std::unexpected(ArchiveError::UnsupportedFormat);
+            }
+            uint64_t zip64_offset = read_le<uint64_t>(locator + 8);
+            if (size < kZip64EndSize || zip64_offset > size - kZip64EndSize) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            const uint8_t* zip64 = base + zip64_offset;
+            if (read_le<uint32_t>(zip64) != kZip64EndSignature) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            if (read_le<uint32_t>(zip64 + 16) != 0 || read_le<uint32_t>(zip64 + 20) != 0) {
+                return std::unexpected(ArchiveError::UnsupportedFormat);
+            }
+            count = read_le<uint64_t>(zip64 + 32);
+            directory_size = read_le<uint64_t>(zip64 + 40);
+            directory_offset = read_le<uint64_t>(zip64 + 48);
+        }
+
+        // Also catches offsets shifted by data prepended to the archive
+        if (directory_offset > size || directory_size > size - directory_offset) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+
+        const uint8_t* p = base + directory_offset;
+        const uint8_t* directory_end = p + directory_size;
+        items_.reserve(static_cast<size_t>(std::min(count, directory_size / kCentralHeaderSize)));
+
+        for (uint64_t i = 0; i < count; ++i) {
+            auto remaining = static_cast<size_t>(directory_end - p);
+            if (remaining < kCentralHeaderSize ||
+                read_le<uint32_t>(p) != kCentralHeaderSignature) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+            size_t name_size = read_le<uint16_t>(p + 28);
+            size_t extra_size = read_le<uint16_t>(p + 30);
+            size_t record_size =
+                kCentralHeaderSize + name_size + extra_size + read_le<uint16_t>(p + 32);
+            if (remaining < record_size) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+
+            auto item = parse_item(p);
+            if (!item) {
+                return std::unexpected(item.error());
+            }
+            index_by_path_.emplace(item->entry.path, items_.size());
+            items_.push_back(std::move(*item));
+            p += record_size;
+        }
+        return {};
+    }
+
+    /// @brief Read one central directory record (bounds already checked)
+    [[nodiscard]] static std::expected<Item, ArchiveError> parse_item(const uint8_t* record) {
+        uint16_t flags = read_le<uint16_t>(record + 8);
+        uint16_t method = read_le<uint16_t>(record + 10);
+        if (flags & kFlagEncrypted) {
+            return std::unexpected(ArchiveError::UnsupportedFormat);
+        }
+
+        Item item;
+        item.method = method;
+        item.entry.crc32 = read_le<uint32_t>(record + 16);
+        item.entry.compressed_size = read_le<uint32_t>(record + 20);
+        item.entry.uncompressed_size = read_le<uint32_t>(record + 24);
+        item.entry.modified_time = dos_time_to_system_clock(read_le<uint16_t>(record + 14),
+                                                            read_le<uint16_t>(record + 12));
+        uint32_t disk = read_le<uint16_t>(record + 34);
+        item.header_offset = read_le<uint32_t>(record + 42);
+
+        size_t name_size = read_le<uint16_t>(record + 28);
+        size_t extra_size = read_le<uint16_t>(record + 30);
+        const uint8_t* name = record + kCentralHeaderSize;
+        const uint8_t* extra = name + name_size;
+
+        for (size_t pos = 0; pos + 4 <= extra_size;) {
+            uint16_t id = read_le<uint16_t>(extra + pos);
+            size_t length = read_le<uint16_t>(extra + pos + 2);
+            const uint8_t* field = extra + pos + 4;
+            if (length > extra_size - pos - 4) {
+                break;
+            }
+
+            if (id == kExtraZip64) {
+                // Present only for the fields saturated in the record, in this order
+                size_t offset = 0;
+                auto widen = [&](uint64_t& value, uint64_t saturated, size_t width) {
+                    if (value != saturated || offset + width > length) {
+                        return;
+                    }
+                    value = width == 8 ? read_le<uint64_t>(field + offset)
+                                       : read_le<uint32_t>(field + offset);
+                    offset += width;
+                };
+                uint64_t disk64 = disk;
+                widen(item.entry.uncompressed_size, 0xFFFFFFFF, 8);
+                widen(item.entry.compressed_size, 0xFFFFFFFF, 8);
+                widen(item.header_offset, 0xFFFFFFFF, 8);
+                widen(disk64, 0xFFFF, 4);
+                disk = static_cast<uint32_t>(disk64);
+            } else if (id == kExtraNtfs && length >= 32 && read_le<uint16_t>(field + 4) == 1 &&
+                       read_le<uint16_t>(field + 6) >= 24) {
+                // Attribute tag 1 starts with the UTC modification FILETIME
+                item.entry.modified_time = fs::fileTimeToSystemClock(read_le<uint64_t>(field + 8));
+            }
+            pos += 4 + length;
+        }
+
+        if (disk != 0) {
+            return std::unexpected(ArchiveError::UnsupportedFormat);
+        }
+
+        auto path = normalize(decode_name(name, name_size, (flags & kFlagUtf8) != 0));
+        item.entry.is_directory = !path.empty() && path.back() == L'/';
+        while (!path.empty() && path.back() == L'/') {
+            path.pop_back();
+        }
+        auto slash = path.find_last_of(L'/');
+        item.entry.name = slash == std::wstring::npos ? path : path.substr(slash + 1);
+        item.entry.path = std::move(path);
+
+        if (!item.entry.is_directory) {
+            bool readable =
+                method == kMethodStored || (method == kMethodDeflate && supportsDeflate());
+            if (!readable) {
+                return std::unexpected(ArchiveError::UnsupportedFormat);
+            }
+            if (method == kMethodStored &&
+                item.entry.compressed_size != item.entry.uncompressed_size) {
+                return std::unexpected(ArchiveError::CorruptedArchive);
+            }
+        }
+        return item;
+    }
+
+    std::optional<MappedFile> file_;                      // Archive opened from disk
+    std::shared_ptr<const std::vector<uint8_t>> memory_;  // Archive opened from memory
+    std::span<const uint8_t> bytes_;                      // Contents of either
+    std::filesystem::path path_;
+    std::vector<Item> items_;                               // Central directory order
+    std::unordered_map<std::wstring, size_t> index_by_path_;  // Normalized path -> items_ index
+    mutable Inflater inflater_;
+};
+
+ZipReader::ZipReader() : impl_(std::make_unique<Impl>()) {}
+
+ZipReader::~ZipReader() = default;
+
+bool ZipReader::handles(const std::filesystem::path& path) noexcept {
+    auto format = detect_format(path);
+    return format == ArchiveFormat::Zip || format == ArchiveFormat::Cbz;
+}
+
+bool ZipReader::supportsDeflate() noexcept {
+#if defined(NIVE_HAS_LIBDEFLATE) || defined(NIVE_HAS_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::expected<void, ArchiveError> ZipReader::open(const std::filesystem::path& path,
+                                                  const std::wstring&) {
+    return impl_->open(path);
+}
+
+std::expected<void, ArchiveError>
+ZipReader::openFromMemory(std::shared_ptr<const std::vector<uint8_t>> data,
+                          const std::filesystem::path& path, const std::wstring&) {
+    return impl_->openFromMemory(std::move(data), path);
+}
+
+void ZipReader::close() {
+    impl_->close();
+}
+
+bool ZipReader::isOpen() const noexcept {
+    return impl_->isOpen();
+}
+
+std::expected<ArchiveInfo, ArchiveError> ZipReader::getInfo() const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+
+    ArchiveInfo info;
+    info.path = impl_->path();
+    info.format = detect_format(info.path);
+    info.entries.reserve(impl_->items().size());
+    for (const auto& item : impl_->items()) {
+        const auto& entry = item.entry;
+        if (entry.is_directory) {
+            ++info.directory_count;
+        } else {
+            ++info.file_count;
+            info.total_compressed_size += entry.compressed_size;
+            info.total_uncompressed_size += entry.uncompressed_size;
+        }
+        info.entries.push_back(entry);
+    }
+    return info;
+}
+
+std::expected<std::vector<ArchiveEntry>, ArchiveError> ZipReader::listEntries() const {
+    auto info_result = getInfo();
+    if (!info_result) {
+        return std::unexpected(info_result.error());
+    }
+    return std::move(info_result->entries);
+}
+
+std::expected<std::vector<uint8_t>, ArchiveError>
+ZipReader::extractToMemory(const std::wstring& entry_path) const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+    const auto* item = impl_->find(entry_path);
+    if (!item) {
+        return std::unexpected(ArchiveError::NotFound);
+    }
+    return impl_->extract(*item);
+}
+
+std::expected<size_t, ArchiveError>
+ZipReader::extractBatch(const std::vector<std::wstring>& entry_paths,
+                        const ExtractItemCallback& on_item, const std::filesystem::path&) const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+
+    std::vector<const Impl::Item*> items;
+    items.reserve(entry_paths.size());
+    for (const auto& entry_path : entry_paths) {
+        if (const auto* item = impl_->find(entry_path)) {
+            items.push_back(item);
+        }
+    }
+    // File order keeps reads of the mapping moving forward
+    std::sort(items.begin(), items.end(),
+              [](const auto* a, const auto* b) { return a->header_offset < b->header_offset; });
+
+    size_t delivered = 0;
+    for (const auto* item : items) {
+        auto data = impl_->extract(*item);
+        if (!data) {
+            return std::unexpected(data.error());
+        }
+        ++delivered;
+        if (!on_item(item->entry.path, std::move(*data))) {
+            break;
+        }
+    }
+    return delivered;
+}
+
+std::expected<void, ArchiveError>
+ZipReader::extractChunked(const std::wstring& entry_path,
+                          const ExtractChunkCallback& on_chunk) const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+    const auto* item = impl_->find(entry_path);
+    if (!item) {
+        return std::unexpected(ArchiveError::NotFound);
+    }
+    return impl_->extractChunked(*item, on_chunk);
+}
+
+std::expected<void, ArchiveError> ZipReader::extractToFile(const std::wstring& entry_path,
+                                                           const std::filesystem::path& dest_path,
+                                                           ExtractProgressCallback) const {
+    auto data = extractToMemory(entry_path);
+    if (!data) {
+        return std::unexpected(data.error());
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dest_path.parent_path(), ec);
+
+    std::ofstream out_file(dest_path, std::ios::binary);
+    if (!out_file ||
+        !out_file.write(reinterpret_cast<const char*>(data->data()),
+                        static_cast<std::streamsize>(data->size()))) {
+        return std::unexpected(ArchiveError::IoError);
+    }
+    return {};
+}
+
+std::expected<void, ArchiveError> ZipReader::extractAll(const std::filesystem::path& dest_dir,
+                                                        ExtractProgressCallback progress) const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+
+    uint64_t total = 0;
+    for (const auto& item : impl_->items()) {
+        total += item.entry.uncompressed_size;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dest_dir, ec);
+
+    uint64_t current = 0;
+    for (const auto& item : impl_->items()) {
+        // Entries must not escape dest_dir
+        auto relative = std::filesystem::path(item.entry.path).lexically_normal();
+        if (relative.empty() || relative.has_root_path() || *relative.begin() == L"..") {
+            continue;
+        }
+        auto target = dest_dir / relative;
+
+        if (item.entry.is_directory) {
+            std::filesystem::create_directories(target, ec);
+            continue;
+        }
+
+        auto data = impl_->extract(item);
+        if (!data) {
+            return std::unexpected(ArchiveError::ExtractionFailed);
+        }
+        std::filesystem::create_directories(target.parent_path(), ec);
+        std::ofstream out_file(target, std::ios::binary);
+        if (!out_file ||
+            !out_file.write(reinterpret_cast<const char*>(data->data()),
+                            static_cast<std::streamsize>(data->size()))) {
+            return std::unexpected(ArchiveError::IoError);
+        }
+
+        current += item.entry.uncompressed_size;
+        if (progress && !progress(current, total)) {
+            return std::unexpected(ArchiveError::ExtractionFailed);
+        }
+    }
+    return {};
+}
+
+std::expected<void, ArchiveError> ZipReader::test() const {
+    if (!impl_->isOpen()) {
+        return std::unexpected(ArchiveError::InternalError);
+    }
+
+    for (const auto& item : impl_->items()) {
+        if (!item.entry.is_directory && !impl_->extract(item)) {
+            return std::unexpected(ArchiveError::CorruptedArchive);
+        }
+    }
+    return {};
+}
+
+}  // namespace nive::archive
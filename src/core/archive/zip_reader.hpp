@@ -0,0 +1,82 @@
+/// @file zip_reader.hpp
+/// @brief Built-in ZIP/CBZ reader over a memory-mapped file
+
+#pragma once
+
+#include <memory>
+
+#include "archive_reader.hpp"
+
+namespace nive::archive {
+
+/// @brief Reads ZIP archives without 7z.dll
+///
+/// The archive is mapped once (or read from memory, for archives inside
+/// other archives) and its central directory parsed on open;
+/// stored entries are copied straight out of the mapping and deflated ones
+/// inflated into their final buffer in one call. Only archives it can read
+/// completely are accepted: open() fails with UnsupportedFormat for
+/// encrypted or split archives and for compression methods other than
+/// stored and deflate, so the caller can fall back to Bit7zReader.
+///
+/// Like other readers, one thread uses an instance at a time.
+class ZipReader : public IArchiveReader {
+public:
+    ZipReader();
+    ~ZipReader() override;
+
+    // Non-copyable
+    ZipReader(const ZipReader&) = delete;
+    ZipReader& operator=(const ZipReader&) = delete;
+
+    /// @brief Check if an archive is worth trying with this reader (by extension)
+    [[nodiscard]] static bool handles(const std::filesystem::path& path) noexcept;
+
+    /// @brief Check if deflate entries can be read (a deflate library was compiled in)
+    [[nodiscard]] static bool supportsDeflate() noexcept;
+
+    [[nodiscard]] std::expected<void, ArchiveError>
+    open(const std::filesystem::path& path, const std::wstring& password = L"") override;
+
+    [[nodiscard]] std::expected<void, ArchiveError>
+    openFromMemory(std::shared_ptr<const std::vector<uint8_t>> data,
+                   const std::filesystem::path& path, const std::wstring& password = L"") override;
+
+    void close() override;
+
+    [[nodiscard]] bool isOpen() const noexcept override;
+
+    [[nodiscard]] bool isSolid() const noexcept override { return false; }
+
+    [[nodiscard]] std::expected<ArchiveInfo, ArchiveError> getInfo() const override;
+
+    [[nodiscard]] std::expected<std::vector<ArchiveEntry>, ArchiveError>
+    listEntries() const override;
+
+    [[nodiscard]] std::expected<std::vector<uint8_t>, ArchiveError>
+    extractToMemory(const std::wstring& entry_path) const override;
+
+    [[nodiscard]] std::expected<size_t, ArchiveError>
+    extractBatch(const std::vector<std::wstring>& entry_paths, const ExtractItemCallback& on_item,
+                 const std::filesystem::path& scratch_dir) const override;
+
+    [[nodiscard]] std::expected<void, ArchiveError>
+    extractChunked(const std::wstring& entry_path,
+                   const ExtractChunkCallback& on_chunk) const override;
+
+    [[nodiscard]] std::expected<void, ArchiveError>
+    extractToFile(const std::wstring& entry_path, const std::filesystem::path& dest_path,
+                  ExtractProgressCallback progress = nullptr) const override;
+
+    [[nodiscard]] std::expected<void, ArchiveError>
+    extractAll(const std::filesystem::path& dest_dir,
+               ExtractProgressCallback progress = nullptr) const override;
+
+    [[nodiscard]] std::expected<void, ArchiveError> test() const override;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::archive
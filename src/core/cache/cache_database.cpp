@@ -3,18 +3,32 @@
 
 #include "cache_database.hpp"
 
+#include <Windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <limits>
+#include <map>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <thread>
+#include <unordered_set>
+#include <utility>
 
 #include <sqlite3.h>
 
+#include "../archive/virtual_path.hpp"
+#include "../fs/io_scheduler.hpp"
+#include "../util/etw.hpp"
+#include "../util/execution_policy.hpp"
+#include "../util/instrumented_mutex.hpp"
 #include "../util/logger.hpp"
 #include "../util/string_utils.hpp"
-
-#ifdef NIVE_HAS_ZSTD
-    #include <zstd.h>
-#endif
+#include "../util/task_group.hpp"
+#include "pack_store.hpp"
 
 namespace nive::cache {
 
@@ -94,92 +108,393 @@ private:
 };
 
 // Schema version for cache invalidation
-constexpr int CURRENT_SCHEMA_VERSION = 2;  // v2: added zstd compression
+// v2: added zstd compression
+// v3: cache keys are 128-bit MurmurHash3 of path + mtime + size (was SHA256)
+// v4: payload_format column (raw / zstd / JPEG payloads)
+// v5: pixel payloads moved to thumbnail_payloads; thumbnails holds metadata only
+// v6: payloads keyed by payload_key, shared by rows with identical content
+// v7: perceptual_hash column (dHash of the thumbnail, for similar image search)
+// v8: accessed_at column (last read, for least-recently-used eviction)
+// v9: average_color column (placeholder colour shown before the thumbnail loads)
+constexpr int CURRENT_SCHEMA_VERSION = 9;
+
+// Write-behind batching: a batch is committed once it holds this many puts,
+// or when the oldest queued put has waited this long
+constexpr size_t kWriteBatchSize = 64;
+constexpr auto kWriteFlushInterval = std::chrono::milliseconds(100);
+
+// Reads are recorded in batches on the writer, like puts. A row read again
+// within kAccessResolution is not rewritten, so browsing one folder costs a
+// single update per thumbnail per hour; reads beyond kMaxPendingAccesses
+// before the writer catches up are dropped.
+constexpr size_t kAccessBatchSize = 256;
+constexpr size_t kMaxPendingAccesses = 8192;
+constexpr auto kAccessResolution = std::chrono::hours(1);
+
+// Eviction starts above a limit and continues down to this fraction of both,
+// so a full cache is not swept again after each few puts
+constexpr double kEvictionLowWater = 0.9;
+
+// Directory listing snapshots kept, most recently stored first
+constexpr int kMaxDirectoryListings = 256;
+
+// Producers block once this many puts are waiting to be written
+constexpr size_t kMaxPendingWrites = 512;
+
+// zstd dictionary training: rows sampled from the cache (bounded by count and
+// decoded bytes), and the resulting dictionary size (zstd's own default)
+constexpr int kDictionarySampleRows = 512;
+constexpr uint64_t kDictionarySampleBytes = 32 * 1024 * 1024;
+constexpr int kDictionaryMinSamples = 100;
+constexpr size_t kDictionaryMaxSize = 110 * 1024;
+
+// Incremental maintenance: rows examined (orphan sweep) or evicted (limits)
+// per batch. db_mutex_ is released between batches so reads interleave.
+constexpr int kMaintenanceBatchSize = 256;
+
+// Within an orphan batch, a directory holding at least this many entries is
+// listed once instead of checking each file (one round trip on a share)
+constexpr size_t kDirectoryListThreshold = 8;
+
+// Prefetched rows decompressed per parallel task
+constexpr size_t kDecodeGrain = 4;
+
+/// @brief Runs the calling thread at background CPU and I/O priority for a scope
+///
+/// Under EcoQoS too: maintenance is never urgent, so it need not wake a
+/// performance core or raise clocks.
+class BackgroundPriority {
+public:
+    BackgroundPriority()
+        : active_(SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0) {}
+    ~BackgroundPriority() {
+        if (active_) {
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
+    }
 
-#ifdef NIVE_HAS_ZSTD
-// zstd magic bytes: 0x28 0xB5 0x2F 0xFD
-constexpr uint8_t ZSTD_MAGIC[] = {0x28, 0xB5, 0x2F, 0xFD};
+    BackgroundPriority(const BackgroundPriority&) = delete;
+    BackgroundPriority& operator=(const BackgroundPriority&) = delete;
 
-bool is_zstd_compressed(const std::vector<uint8_t>& data) {
-    if (data.size() < 4)
-        return false;
-    return std::memcmp(data.data(), ZSTD_MAGIC, 4) == 0;
-}
+private:
+    bool active_;
+    ScopedEcoQoS eco_qos_;
+};
+
+/// @brief Progress of a batched orphan sweep
+struct OrphanSweep {
+    int64_t last_rowid = 0;
+    uint64_t removed = 0;
+};
+
+/// @brief Progress of a batched eviction down to the configured limits
+struct EvictionSweep {
+    uint64_t max_entries = 0;
+    uint64_t max_size_bytes = 0;
+    uint64_t removed = 0;
+    bool started = false;  // A limit was exceeded; now evicting down to the low-water mark
+};
 
-std::expected<std::vector<uint8_t>, CacheError> compress_data(const std::vector<uint8_t>& data,
-                                                              int level) {
-    if (level <= 0 || data.empty()) {
-        return data;  // No compression
+/// @brief Find the cache keys whose source files no longer exist
+/// @param rows (cache key, UTF-8 source path) pairs
+///
+/// Checks are grouped by directory: a missing directory settles all of its
+/// entries with one call, and a directory with many entries is listed once.
+/// A file absent from the listing is still confirmed with exists(), since the
+/// listing compares names ASCII case-insensitively only. Entries whose
+/// location cannot be queried (e.g. an offline share) are kept.
+std::vector<std::string>
+find_orphans(const std::vector<std::pair<std::string, std::string>>& rows) {
+    // directory -> file name -> cache keys (archive entries share their archive)
+    std::map<std::wstring, std::map<std::wstring, std::vector<const std::string*>>> groups;
+    for (const auto& [cache_key, source_path] : rows) {
+        auto source =
+            archive::VirtualPath::parse(utf8ToPath(source_path).wstring()).file_path();
+        groups[source.parent_path().wstring()][source.filename().wstring()].push_back(
+            &cache_key);
     }
 
-    size_t bound = ZSTD_compressBound(data.size());
-    std::vector<uint8_t> compressed(bound);
+    std::vector<std::string> orphans;
+    auto add_orphans = [&orphans](const std::vector<const std::string*>& keys) {
+        for (const auto* key : keys) {
+            orphans.push_back(*key);
+        }
+    };
+
+    for (const auto& [directory, files] : groups) {
+        std::error_code ec;
+        std::filesystem::path dir(directory);
+
+        // Checks on a share wait behind the thumbnails and scans being shown
+        auto io_slot = fs::IoScheduler::instance().acquire(dir, fs::IoPriority::Background);
+        if (!std::filesystem::exists(dir, ec)) {
+            if (!ec) {
+                for (const auto& [name, keys] : files) {
+                    add_orphans(keys);
+                }
+            }
+            continue;
+        }
 
-    size_t compressed_size =
-        ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), level);
+        std::unordered_set<std::wstring> listed;
+        bool have_listing = false;
+        if (files.size() >= kDirectoryListThreshold) {
+            std::filesystem::directory_iterator it(dir, ec);
+            for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                listed.insert(toLowercaseAscii(it->path().filename().wstring()));
+            }
+            have_listing = !ec;
+        }
 
-    if (ZSTD_isError(compressed_size)) {
-        LOG_ERROR("zstd compression failed: {}", ZSTD_getErrorName(compressed_size));
-        return std::unexpected(CacheError::CompressionError);
+        for (const auto& [name, keys] : files) {
+            if (have_listing && listed.contains(toLowercaseAscii(name))) {
+                continue;
+            }
+            if (!std::filesystem::exists(dir / name, ec) && !ec) {
+                add_orphans(keys);
+            }
+        }
     }
+    return orphans;
+}
 
-    compressed.resize(compressed_size);
-    return compressed;
+/// @brief Key of the payload a row references: its own key unless shared
+const std::string& payload_key_of(const ThumbnailMetadata& metadata) {
+    return metadata.content_hash.empty() ? metadata.file_hash : metadata.content_hash;
 }
 
-std::expected<std::vector<uint8_t>, CacheError> decompress_data(const std::vector<uint8_t>& data) {
-    if (data.empty() || !is_zstd_compressed(data)) {
-        return data;  // Not compressed or empty
-    }
+/// @brief A put waiting in the write-behind queue (payload already encoded)
+struct PendingWrite {
+    ThumbnailMetadata metadata;
+    PayloadFormat format = PayloadFormat::Raw;
+    std::vector<uint8_t> payload;
+};
+
+/// @brief An entry as read from storage, payload still encoded
+///
+/// The payload is either copied into entry.data (SQLite) or viewed in place
+/// in the mapped pack file (pack.data non-empty).
+struct StoredRow {
+    ThumbnailEntry entry;
+    PayloadFormat format = PayloadFormat::Raw;
+    PackBlob pack;
+};
+
+// Read statements (the reader connections prepare these)
+constexpr const char* kSelectEntrySql =
+    "SELECT t.source_path, t.file_hash, t.width, t.height, t.original_width, "
+    "t.original_height, t.source_mtime, t.cached_at, t.data_size, t.payload_key, "
+    "t.perceptual_hash, t.average_color, p.pixel_data, p.payload_format "
+    "FROM thumbnails t JOIN thumbnail_payloads p ON p.payload_key = t.payload_key "
+    "WHERE t.cache_key = ?;";
+constexpr const char* kSelectMetadataSql =
+    "SELECT source_path, file_hash, width, height, original_width, original_height, "
+    "source_mtime, cached_at, data_size, payload_key, perceptual_hash, average_color "
+    "FROM thumbnails WHERE cache_key = ?;";
+constexpr const char* kExistsSql = "SELECT COUNT(*) FROM thumbnails WHERE cache_key = ?;";
+constexpr const char* kCreatePrefetchKeysSql =
+    "CREATE TEMP TABLE IF NOT EXISTS prefetch_keys (cache_key TEXT NOT NULL);";
+constexpr const char* kPrefetchInsertSql =
+    "INSERT INTO temp.prefetch_keys (cache_key) VALUES (?);";
+// Bulk prefetch: staged keys joined against thumbnails, in staging order
+constexpr const char* kPrefetchEntriesSql =
+    "SELECT t.source_path, t.file_hash, t.width, t.height, t.original_width, "
+    "t.original_height, t.source_mtime, t.cached_at, t.data_size, t.payload_key, "
+    "t.perceptual_hash, t.average_color, p.pixel_data, p.payload_format "
+    "FROM temp.prefetch_keys k JOIN thumbnails t ON t.cache_key = k.cache_key "
+    "JOIN thumbnail_payloads p ON p.payload_key = t.payload_key "
+    "ORDER BY k.rowid;";
+constexpr const char* kPrefetchMetadataSql =
+    "SELECT t.source_path, t.file_hash, t.width, t.height, t.original_width, "
+    "t.original_height, t.source_mtime, t.cached_at, t.data_size, t.payload_key, "
+    "t.perceptual_hash, t.average_color "
+    "FROM temp.prefetch_keys k JOIN thumbnails t ON t.cache_key = k.cache_key "
+    "ORDER BY k.rowid;";
+
+// The WAL file is truncated back to this size once a checkpoint has reset it
+constexpr int64_t kWalSizeLimitBytes = 64 * 1024 * 1024;
+
+// Pages per online backup step (16 MB at the default page size), and pack
+// bytes per copy step; writes wait for one SQLite step at most
+constexpr int kCopyPagesPerStep = 1024;
+constexpr uint64_t kCopyPackBytesPerStep = 32ull * 1024 * 1024;
+
+/// @brief Run a pragma whose value comes from the configuration
+void set_pragma(sqlite3* db, std::string_view name, int64_t value) {
+    sqlite3_exec(db, std::format("PRAGMA {}={};", name, value).c_str(), nullptr, nullptr,
+                 nullptr);
+}
 
-    unsigned long long decompressed_size = ZSTD_getFrameContentSize(data.data(), data.size());
-    if (decompressed_size == ZSTD_CONTENTSIZE_ERROR ||
-        decompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
-        LOG_ERROR("zstd: cannot determine decompressed size");
-        return std::unexpected(CacheError::CompressionError);
+/// @brief Read-only connection with its own prepared statements
+///
+/// Under WAL any number of these read concurrently, each from its own
+/// snapshot, while the writer connection commits. A connection is used by
+/// one thread at a time: callers check one out of the Impl's pool per call.
+struct ReaderConnection {
+    sqlite3* db = nullptr;
+    SqliteStatement get;
+    SqliteStatement get_metadata;
+    SqliteStatement exists;
+    SqliteStatement prefetch_insert;
+    SqliteStatement prefetch_entries;
+    SqliteStatement prefetch_metadata;
+
+    ReaderConnection() = default;
+
+    ~ReaderConnection() {
+        get.finalize();
+        get_metadata.finalize();
+        exists.finalize();
+        prefetch_insert.finalize();
+        prefetch_entries.finalize();
+        prefetch_metadata.finalize();
+        if (db) {
+            sqlite3_close(db);
+        }
     }
 
-    std::vector<uint8_t> decompressed(static_cast<size_t>(decompressed_size));
+    ReaderConnection(const ReaderConnection&) = delete;
+    ReaderConnection& operator=(const ReaderConnection&) = delete;
+
+    /// @brief Open the database read-only and prepare the read statements
+    /// @param path_utf8 File path, or a URI when extra_flags has SQLITE_OPEN_URI
+    [[nodiscard]] static std::unique_ptr<ReaderConnection>
+    open(const std::string& path_utf8, const SqliteTuning& tuning, int extra_flags = 0) {
+        auto reader = std::make_unique<ReaderConnection>();
+        int rc = sqlite3_open_v2(path_utf8.c_str(), &reader->db,
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | extra_flags, nullptr);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("Failed to open cache reader connection: {}", sqlite3_errmsg(reader->db));
+            return nullptr;
+        }
+        sqlite3_busy_timeout(reader->db, static_cast<int>(tuning.busy_timeout_ms));
+        set_pragma(reader->db, "mmap_size", static_cast<int64_t>(tuning.mmap_size_bytes));
+        set_pragma(reader->db, "cache_size", -static_cast<int64_t>(tuning.reader_cache_size_kib));
+        sqlite3_exec(reader->db, "PRAGMA temp_store=MEMORY;", nullptr, nullptr, nullptr);
+        // The temp schema is per connection and writable even here
+        if (sqlite3_exec(reader->db, kCreatePrefetchKeysSql, nullptr, nullptr, nullptr) !=
+                SQLITE_OK ||
+            !reader->get.prepare(reader->db, kSelectEntrySql) ||
+            !reader->get_metadata.prepare(reader->db, kSelectMetadataSql) ||
+            !reader->exists.prepare(reader->db, kExistsSql) ||
+            !reader->prefetch_insert.prepare(reader->db, kPrefetchInsertSql) ||
+            !reader->prefetch_entries.prepare(reader->db, kPrefetchEntriesSql) ||
+            !reader->prefetch_metadata.prepare(reader->db, kPrefetchMetadataSql)) {
+            return nullptr;
+        }
+        return reader;
+    }
 
-    size_t result =
-        ZSTD_decompress(decompressed.data(), decompressed.size(), data.data(), data.size());
+    /// @brief End every statement, so an idle connection holds no snapshot
+    ///
+    /// An open read transaction would stop checkpoints from resetting the WAL.
+    void resetAll() {
+        get.reset();
+        get_metadata.reset();
+        exists.reset();
+        prefetch_insert.reset();
+        prefetch_entries.reset();
+        prefetch_metadata.reset();
+    }
+};
 
-    if (ZSTD_isError(result)) {
-        LOG_ERROR("zstd decompression failed: {}", ZSTD_getErrorName(result));
-        return std::unexpected(CacheError::CompressionError);
+/// @brief Stage keys in temp.prefetch_keys of a connection, in order
+[[nodiscard]] std::expected<void, CacheError>
+stage_keys(sqlite3* db, SqliteStatement& insert, const std::vector<std::string>& keys) {
+    // One transaction for all inserts
+    sqlite3_exec(db, "DELETE FROM temp.prefetch_keys;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    for (const auto& key : keys) {
+        insert.reset();
+        sqlite3_bind_text(insert, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        int rc = sqlite3_step(insert);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite prefetch insert error: {} - {}", rc, sqlite3_errmsg(db));
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
     }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    return {};
+}
 
-    decompressed.resize(result);
-    return decompressed;
+/// @brief URI opening a database immutable: no locks, no WAL, no journal
+///
+/// Locking over SMB is slow and unreliable, and a published snapshot never
+/// changes under its readers.
+[[nodiscard]] std::string immutable_uri(const std::filesystem::path& path) {
+    std::string utf8 = pathToUtf8(path);
+    std::ranges::replace(utf8, '\\', '/');
+    // A UNC path keeps its leading "//" after an empty authority
+    std::string uri = utf8.starts_with("//") ? "file://" : "file:";
+    for (char c : utf8) {
+        if (c == '%' || c == '?' || c == '#') {
+            uri += std::format("%{:02X}", static_cast<unsigned char>(c));
+        } else {
+            uri += c;
+        }
+    }
+    uri += "?immutable=1";
+    return uri;
 }
-#endif  // NIVE_HAS_ZSTD
 
 }  // namespace
 
 /// @brief SQLite cache database implementation
 class CacheDatabase::Impl {
 public:
-    Impl(std::filesystem::path db_path, int compression_level)
-        : db_path_(std::move(db_path)), compression_level_(compression_level), running_(true) {
+    Impl(std::filesystem::path db_path, PayloadOptions payload_options, StorageBackend backend,
+         SqliteTuning tuning, bool read_only = false)
+        : db_path_(std::move(db_path)), backend_(backend), tuning_(tuning),
+          codec_(payload_options), read_only_(read_only), running_(true) {
         // Start async worker thread
         worker_ = std::jthread([this](std::stop_token stop_token) { worker_thread(stop_token); });
+        writer_ = std::jthread([this] { writer_thread(); });
     }
 
     ~Impl() {
         running_ = false;
         cv_.notify_all();
 
+        checkpointer_.request_stop();
+        if (checkpointer_.joinable()) {
+            checkpointer_.join();
+        }
+
+        // Drain the write-behind queue while the statements are still valid
+        {
+            std::lock_guard lock(write_mutex_);
+            writer_stopping_ = true;
+        }
+        write_cv_.notify_all();
+        space_cv_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+
+        reader_pool_.clear();
+
         // Finalize all prepared statements before closing database
-        stmt_get_.finalize();
-        stmt_get_metadata_.finalize();
-        stmt_exists_.finalize();
         stmt_put_.finalize();
+        stmt_put_payload_.finalize();
+        stmt_put_shared_payload_.finalize();
+        stmt_payload_key_.finalize();
+        stmt_payload_refs_.finalize();
+        stmt_get_content_.finalize();
+        stmt_get_content_metadata_.finalize();
         stmt_remove_.finalize();
         stmt_remove_older_than_.finalize();
-        stmt_get_all_paths_.finalize();
+        stmt_orphan_batch_.finalize();
+        stmt_oldest_.finalize();
+        stmt_touch_.finalize();
+        stmt_select_by_source_.finalize();
         stmt_get_stats_.finalize();
         stmt_clear_.finalize();
         stmt_count_.finalize();
+        stmt_prefetch_insert_.finalize();
+
+        // The backup holds the connection open
+        cancelCopy();
 
         if (db_) {
             sqlite3_close(db_);
@@ -188,6 +503,9 @@ public:
     }
 
     [[nodiscard]] bool initialize() {
+        if (read_only_) {
+            return initialize_read_only();
+        }
         std::lock_guard lock(db_mutex_);
 
         // Ensure parent directory exists
@@ -205,208 +523,420 @@ public:
             return false;
         }
 
-        // Configure database
+        // Configure database. The page size only applies while the file is
+        // still empty (an existing cache keeps its own until it is rebuilt).
+        sqlite3_busy_timeout(db_, static_cast<int>(tuning_.busy_timeout_ms));
+        set_pragma(db_, "page_size", tuning_.page_size);
         sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
         sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
-        sqlite3_exec(db_, "PRAGMA cache_size=10000;", nullptr, nullptr, nullptr);
+        set_pragma(db_, "cache_size", -static_cast<int64_t>(tuning_.cache_size_kib));
+        set_pragma(db_, "mmap_size", static_cast<int64_t>(tuning_.mmap_size_bytes));
+        set_pragma(db_, "journal_size_limit", kWalSizeLimitBytes);
         sqlite3_exec(db_, "PRAGMA temp_store=MEMORY;", nullptr, nullptr, nullptr);
+        // INSERT OR REPLACE must fire the delete trigger, or a replaced row's
+        // shared payload would never be released
+        sqlite3_exec(db_, "PRAGMA recursive_triggers=ON;", nullptr, nullptr, nullptr);
 
         // Create tables
         if (!create_tables()) {
             return false;
         }
 
+        if (backend_ == StorageBackend::PackFile) {
+            auto pack = PackStore::open(db_path_.parent_path() / db_path_.stem());
+            if (!pack) {
+                return false;
+            }
+            pack_ = std::move(*pack);
+        }
+        if (!check_storage_backend()) {
+            return false;
+        }
+
         // Prepare statements
         if (!prepare_statements()) {
             return false;
         }
 
+        load_dictionaries();
+        configure_checkpoints();
+
         LOG_INFO("Cache database opened: {}", pathToUtf8(db_path_));
         return true;
     }
 
+    /// @brief Open an existing database for lookups only (see CacheDatabase::openReadOnly)
+    [[nodiscard]] bool initialize_read_only() {
+        std::lock_guard lock(db_mutex_);
+        int rc = sqlite3_open_v2(immutable_uri(db_path_).c_str(), &db_,
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | SQLITE_OPEN_NOMUTEX,
+                                 nullptr);
+        if (rc != SQLITE_OK) {
+            LOG_WARN("Failed to open shared cache {}: {}", pathToUtf8(db_path_),
+                     sqlite3_errmsg(db_));
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return false;
+        }
+
+        // Pack payloads live beside the database and would need a writable store
+        if (user_version() != static_cast<int>(StorageBackend::Sqlite)) {
+            LOG_WARN("Shared cache {} keeps its thumbnails in a pack file; not used",
+                     pathToUtf8(db_path_));
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return false;
+        }
+        sqlite3_exec(db_, "PRAGMA temp_store=MEMORY;", nullptr, nullptr, nullptr);
+
+        load_dictionaries();
+        LOG_INFO("Shared cache opened read-only: {}", pathToUtf8(db_path_));
+        return true;
+    }
+
     [[nodiscard]] bool isOpen() const noexcept { return db_ != nullptr; }
 
     [[nodiscard]] const std::filesystem::path& path() const noexcept { return db_path_; }
 
-    [[nodiscard]] std::expected<ThumbnailEntry, CacheError> get(const std::string& key) {
-        std::lock_guard lock(db_mutex_);
+    [[nodiscard]] LockStats lockStats() const noexcept { return db_mutex_.stats(); }
+
+    void resetLockStats() noexcept { db_mutex_.resetStats(); }
 
+    [[nodiscard]] std::expected<ThumbnailEntry, CacheError> get(const std::string& key) {
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-        stmt_get_.reset();
+        // Queued first: a put not committed yet is newer than any stored row,
+        // and one not found here is committed before the snapshot below
+        if (auto pending = find_pending(key)) {
+            if (auto decoded = decode_row(*pending); !decoded) {
+                return std::unexpected(decoded.error());
+            }
+            return std::move(pending->entry);
+        }
+
+        auto reader = acquire_reader();
+        if (!reader)
+            return std::unexpected(CacheError::DatabaseError);
+
+        // Pack payloads are not in SQLite; only the metadata row is queried
+        SqliteStatement& stmt = pack_ ? reader->get_metadata : reader->get;
+        stmt.reset();
 
         // Bind cache_key
-        sqlite3_bind_text(stmt_get_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
 
-        int rc = sqlite3_step(stmt_get_);
+        int rc = sqlite3_step(stmt);
         if (rc != SQLITE_ROW) {
             if (rc == SQLITE_DONE) {
                 return std::unexpected(CacheError::NotFound);
             }
-            LOG_ERROR("SQLite get error: {} - {}", rc, sqlite3_errmsg(db_));
+            LOG_ERROR("SQLite get error: {} - {}", rc, sqlite3_errmsg(reader->db));
             return std::unexpected(sqlite_to_cache_error(rc));
         }
 
-        ThumbnailEntry entry;
+        note_access(key);
 
-        // Read columns: source_path, file_hash, width, height, original_width, original_height,
-        //               source_mtime, cached_at, data_size, pixel_data
-        const char* source_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_, 0));
-        const char* file_hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_, 1));
+        if (pack_) {
+            // Decode straight from the mapped view
+            StoredRow row{.entry = {.metadata = read_metadata(stmt)}};
+            if (auto attached = attach_pack_payload(row); !attached) {
+                return std::unexpected(attached.error());
+            }
+            if (auto decoded = decode_row(row); !decoded) {
+                return std::unexpected(decoded.error());
+            }
+            return std::move(row.entry);
+        }
 
-        entry.metadata.source_path = source_path ? source_path : "";
-        entry.metadata.file_hash = file_hash ? file_hash : "";
-        entry.metadata.width = static_cast<uint32_t>(sqlite3_column_int(stmt_get_, 2));
-        entry.metadata.height = static_cast<uint32_t>(sqlite3_column_int(stmt_get_, 3));
-        entry.metadata.original_width = static_cast<uint32_t>(sqlite3_column_int(stmt_get_, 4));
-        entry.metadata.original_height = static_cast<uint32_t>(sqlite3_column_int(stmt_get_, 5));
+        // Decode straight from the column; the encoded blob is never copied
+        StoredRow row = read_entry_row(stmt, /*copy_payload=*/false);
+        const void* blob = sqlite3_column_blob(stmt, 12);
+        int blob_size = sqlite3_column_bytes(stmt, 12);
+        if (blob && blob_size > 0) {
+            auto pixels = codec_.decode(
+                row.format,
+                std::span(static_cast<const uint8_t*>(blob), static_cast<size_t>(blob_size)),
+                row.entry.metadata.width, row.entry.metadata.height);
+            if (!pixels) {
+                return std::unexpected(pixels.error());
+            }
+            row.entry.data = std::move(*pixels);
+        }
 
-        int64_t source_mtime = sqlite3_column_int64(stmt_get_, 6);
-        int64_t cached_at = sqlite3_column_int64(stmt_get_, 7);
-        entry.metadata.source_mtime = std::chrono::system_clock::time_point(
-            std::chrono::system_clock::duration(source_mtime));
-        entry.metadata.cached_at =
-            std::chrono::system_clock::time_point(std::chrono::system_clock::duration(cached_at));
+        return std::move(row.entry);
+    }
 
-        entry.metadata.data_size = static_cast<uint64_t>(sqlite3_column_int64(stmt_get_, 8));
+    [[nodiscard]] std::expected<std::vector<ThumbnailEntry>, CacheError>
+    getMany(const std::vector<std::string>& keys, uint64_t max_bytes) {
+        std::vector<ThumbnailEntry> entries;
+        if (keys.empty()) {
+            return entries;
+        }
 
-        // Read pixel data blob
-        const void* blob_data = sqlite3_column_blob(stmt_get_, 9);
-        int blob_size = sqlite3_column_bytes(stmt_get_, 9);
+        std::vector<StoredRow> rows;
 
-        if (blob_data && blob_size > 0) {
-            std::vector<uint8_t> raw_data(static_cast<size_t>(blob_size));
-            std::memcpy(raw_data.data(), blob_data, static_cast<size_t>(blob_size));
+        {
+            if (auto guard = ensureOpen(); !guard)
+                return std::unexpected(guard.error());
+
+            auto reader = acquire_reader();
+            if (!reader)
+                return std::unexpected(CacheError::DatabaseError);
+
+            if (auto staged = stage_keys(reader->db, reader->prefetch_insert, keys); !staged)
+                return std::unexpected(staged.error());
+
+            // Rows come back in key order, so a byte budget keeps the leading keys.
+            // With the pack backend only metadata is selected; payloads are views.
+            SqliteStatement& stmt = pack_ ? reader->prefetch_metadata : reader->prefetch_entries;
+            uint64_t total_bytes = 0;
+            stmt.reset();
+            int rc = SQLITE_ROW;
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                auto data_size = static_cast<uint64_t>(sqlite3_column_int64(stmt, 8));
+                if (max_bytes > 0 && total_bytes + data_size > max_bytes) {
+                    break;
+                }
+                if (pack_) {
+                    StoredRow row{.entry = {.metadata = read_metadata(stmt)}};
+                    if (!attach_pack_payload(row)) {
+                        continue;
+                    }
+                    rows.push_back(std::move(row));
+                } else {
+                    rows.push_back(read_entry_row(stmt));
+                }
+                total_bytes += data_size;
+            }
+            stmt.reset();
 
-#ifdef NIVE_HAS_ZSTD
-            // Decompress if data is zstd compressed
-            auto decompressed = decompress_data(raw_data);
-            if (!decompressed) {
-                return std::unexpected(decompressed.error());
+            if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+                LOG_ERROR("SQLite prefetch select error: {} - {}", rc,
+                          sqlite3_errmsg(reader->db));
+                return std::unexpected(sqlite_to_cache_error(rc));
             }
-            entry.data = std::move(*decompressed);
-#else
-            entry.data = std::move(raw_data);
-#endif
-        }
 
-        return entry;
+            sqlite3_exec(reader->db, "DELETE FROM temp.prefetch_keys;", nullptr, nullptr,
+                         nullptr);
+        }  // The reader goes back to the pool before decoding
+
+        // Decoding needs no database access; spread it across cores.
+        // Rows that fail to decode are emptied and dropped afterwards.
+        parallelFor(0, rows.size(), kDecodeGrain, [this, &rows](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                if (!decode_row(rows[i])) {
+                    rows[i].entry.data.clear();
+                }
+            }
+        });
+
+        entries.reserve(rows.size());
+        for (auto& row : rows) {
+            if (!row.entry.data.empty()) {
+                entries.push_back(std::move(row.entry));
+            }
+        }
+        note_access(entries);
+        return entries;
     }
 
     [[nodiscard]] std::expected<ThumbnailMetadata, CacheError> getMetadata(const std::string& key) {
-        std::lock_guard lock(db_mutex_);
-
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-        stmt_get_metadata_.reset();
-        sqlite3_bind_text(stmt_get_metadata_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        if (auto pending = find_pending_metadata(key)) {
+            return std::move(*pending);
+        }
+
+        auto reader = acquire_reader();
+        if (!reader)
+            return std::unexpected(CacheError::DatabaseError);
+
+        SqliteStatement& stmt = reader->get_metadata;
+        stmt.reset();
+        sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
 
-        int rc = sqlite3_step(stmt_get_metadata_);
+        int rc = sqlite3_step(stmt);
         if (rc != SQLITE_ROW) {
-            if (rc == SQLITE_DONE) {
-                return std::unexpected(CacheError::NotFound);
-            }
-            return std::unexpected(sqlite_to_cache_error(rc));
+            return std::unexpected(rc == SQLITE_DONE ? CacheError::NotFound
+                                                     : sqlite_to_cache_error(rc));
         }
 
-        ThumbnailMetadata metadata;
+        return read_metadata(stmt);
+    }
 
-        const char* source_path =
-            reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_metadata_, 0));
-        const char* file_hash =
-            reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_metadata_, 1));
+    [[nodiscard]] std::expected<std::vector<ThumbnailMetadata>, CacheError>
+    getMetadataMany(const std::vector<std::string>& keys) {
+        std::vector<ThumbnailMetadata> result;
+        if (keys.empty()) {
+            return result;
+        }
 
-        metadata.source_path = source_path ? source_path : "";
-        metadata.file_hash = file_hash ? file_hash : "";
-        metadata.width = static_cast<uint32_t>(sqlite3_column_int(stmt_get_metadata_, 2));
-        metadata.height = static_cast<uint32_t>(sqlite3_column_int(stmt_get_metadata_, 3));
-        metadata.original_width = static_cast<uint32_t>(sqlite3_column_int(stmt_get_metadata_, 4));
-        metadata.original_height = static_cast<uint32_t>(sqlite3_column_int(stmt_get_metadata_, 5));
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
 
-        int64_t source_mtime = sqlite3_column_int64(stmt_get_metadata_, 6);
-        int64_t cached_at = sqlite3_column_int64(stmt_get_metadata_, 7);
-        metadata.source_mtime = std::chrono::system_clock::time_point(
-            std::chrono::system_clock::duration(source_mtime));
-        metadata.cached_at =
-            std::chrono::system_clock::time_point(std::chrono::system_clock::duration(cached_at));
+        auto reader = acquire_reader();
+        if (!reader)
+            return std::unexpected(CacheError::DatabaseError);
 
-        metadata.data_size = static_cast<uint64_t>(sqlite3_column_int64(stmt_get_metadata_, 8));
+        if (auto staged = stage_keys(reader->db, reader->prefetch_insert, keys); !staged)
+            return std::unexpected(staged.error());
 
-        return metadata;
+        // Narrow table only; no payload page is touched
+        SqliteStatement& stmt = reader->prefetch_metadata;
+        stmt.reset();
+        int rc = SQLITE_ROW;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            result.push_back(read_metadata(stmt));
+        }
+        stmt.reset();
+
+        sqlite3_exec(reader->db, "DELETE FROM temp.prefetch_keys;", nullptr, nullptr, nullptr);
+
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite metadata select error: {} - {}", rc, sqlite3_errmsg(reader->db));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        return result;
     }
 
     [[nodiscard]] bool exists(const std::string& key) {
-        std::lock_guard lock(db_mutex_);
-
         if (!ensureOpen())
             return false;
 
-        stmt_exists_.reset();
-        sqlite3_bind_text(stmt_exists_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        if (find_pending_metadata(key)) {
+            return true;
+        }
+
+        auto reader = acquire_reader();
+        if (!reader)
+            return false;
+
+        reader->exists.reset();
+        sqlite3_bind_text(reader->exists, 1, key.c_str(), -1, SQLITE_TRANSIENT);
 
-        int rc = sqlite3_step(stmt_exists_);
-        if (rc == SQLITE_ROW) {
-            return sqlite3_column_int(stmt_exists_, 0) > 0;
+        int rc = sqlite3_step(reader->exists);
+        return rc == SQLITE_ROW && sqlite3_column_int(reader->exists, 0) > 0;
+    }
+
+    [[nodiscard]] std::expected<ThumbnailEntry, CacheError>
+    linkContent(const ThumbnailMetadata& metadata) {
+        if (metadata.content_hash.empty()) {
+            return std::unexpected(CacheError::NotFound);
+        }
+
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        SqliteStatement& stmt = pack_ ? stmt_get_content_metadata_ : stmt_get_content_;
+        stmt.reset();
+        sqlite3_bind_text(stmt, 1, metadata.content_hash.c_str(), -1, SQLITE_TRANSIENT);
+
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_ROW) {
+            return std::unexpected(rc == SQLITE_DONE ? CacheError::NotFound
+                                                     : sqlite_to_cache_error(rc));
+        }
+        StoredRow row = pack_ ? StoredRow{.entry = {.metadata = read_metadata(stmt)}}
+                              : read_entry_row(stmt);
+        stmt.reset();
+        if (pack_) {
+            if (auto attached = attach_pack_payload(row); !attached) {
+                return std::unexpected(attached.error());
+            }
+        }
+
+        // The new row takes the shared payload's dimensions
+        ThumbnailMetadata linked = metadata;
+        linked.width = row.entry.metadata.width;
+        linked.height = row.entry.metadata.height;
+        linked.original_width = row.entry.metadata.original_width;
+        linked.original_height = row.entry.metadata.original_height;
+        linked.data_size = row.entry.metadata.data_size;
+        linked.perceptual_hash = row.entry.metadata.perceptual_hash;
+        linked.average_color = row.entry.metadata.average_color;
+        if (auto inserted = insert_metadata(linked); !inserted) {
+            return std::unexpected(inserted.error());
+        }
+
+        if (auto decoded = decode_row(row); !decoded) {
+            return std::unexpected(decoded.error());
         }
-        return false;
+        row.entry.metadata = std::move(linked);
+        return std::move(row.entry);
     }
 
     [[nodiscard]] std::expected<void, CacheError> put(const ThumbnailEntry& entry) {
+        auto write = encode_write(entry);
+        if (!write) {
+            return std::unexpected(write.error());
+        }
+
         std::lock_guard lock(db_mutex_);
 
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-#ifdef NIVE_HAS_ZSTD
-        // Compress data if compression is enabled
-        auto compressed = compress_data(entry.data, compression_level_);
-        if (!compressed) {
-            return std::unexpected(compressed.error());
-        }
-        const auto& data_to_store = *compressed;
-#else
-        const auto& data_to_store = entry.data;
-#endif
+        // Metadata and payload rows are written together or not at all
+        sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+        auto inserted = insert_row(*write);
+        sqlite3_exec(db_, inserted ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+        return inserted;
+    }
 
-        stmt_put_.reset();
+    [[nodiscard]] std::expected<void, CacheError> putDeferred(const ThumbnailEntry& entry) {
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
 
-        // Bind parameters
-        // INSERT OR REPLACE INTO thumbnails (cache_key, source_path, file_hash, width, height,
-        //                                    original_width, original_height, source_mtime,
-        //                                    cached_at, data_size, pixel_data)
-        std::string source_path_str = pathToUtf8(entry.metadata.source_path);
+        // Compression runs on the calling thread, outside every lock
+        auto write = encode_write(entry);
+        if (!write) {
+            return std::unexpected(write.error());
+        }
 
-        sqlite3_bind_text(stmt_put_, 1, entry.metadata.file_hash.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt_put_, 2, source_path_str.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt_put_, 3, entry.metadata.file_hash.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(stmt_put_, 4, static_cast<int>(entry.metadata.width));
-        sqlite3_bind_int(stmt_put_, 5, static_cast<int>(entry.metadata.height));
-        sqlite3_bind_int(stmt_put_, 6, static_cast<int>(entry.metadata.original_width));
-        sqlite3_bind_int(stmt_put_, 7, static_cast<int>(entry.metadata.original_height));
-        sqlite3_bind_int64(stmt_put_, 8, entry.metadata.source_mtime.time_since_epoch().count());
-        sqlite3_bind_int64(stmt_put_, 9, entry.metadata.cached_at.time_since_epoch().count());
-        sqlite3_bind_int64(stmt_put_, 10, static_cast<sqlite3_int64>(entry.data.size()));
-        sqlite3_bind_blob(stmt_put_, 11, data_to_store.data(),
-                          static_cast<int>(data_to_store.size()), SQLITE_TRANSIENT);
+        std::unique_lock lock(write_mutex_);
 
-        int rc = sqlite3_step(stmt_put_);
-        if (rc != SQLITE_DONE) {
-            LOG_ERROR("SQLite put error: {} - {}", rc, sqlite3_errmsg(db_));
-            return std::unexpected(sqlite_to_cache_error(rc));
+        // Backpressure: wait for the writer when it falls too far behind
+        space_cv_.wait(lock, [this] {
+            return write_queue_.size() < kMaxPendingWrites || writer_stopping_;
+        });
+        if (writer_stopping_) {
+            return std::unexpected(CacheError::DatabaseError);
         }
 
+        write_queue_.push_back(std::move(*write));
+
+        // Wake the writer for the first put (starts the interval) or a full batch
+        if (write_queue_.size() == 1 || write_queue_.size() >= kWriteBatchSize) {
+            write_cv_.notify_one();
+        }
         return {};
     }
 
+    void flush() { flush_pending_writes(); }
+
     [[nodiscard]] std::expected<void, CacheError> remove(const std::string& key) {
         std::lock_guard lock(db_mutex_);
 
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
+        {
+            std::lock_guard write_lock(write_mutex_);
+            std::erase_if(write_queue_, [&key](const PendingWrite& write) {
+                return write.metadata.file_hash == key;
+            });
+        }
+        space_cv_.notify_all();
+
+        std::vector<std::string> payload_keys;
+        if (pack_) {
+            payload_keys = payload_keys_for({key});
+        }
+
         stmt_remove_.reset();
         sqlite3_bind_text(stmt_remove_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
 
@@ -414,6 +944,9 @@ public:
         if (rc != SQLITE_DONE) {
             return std::unexpected(sqlite_to_cache_error(rc));
         }
+        if (pack_) {
+            release_pack_payloads(payload_keys);
+        }
 
         return {};
     }
@@ -425,6 +958,22 @@ public:
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
+        // The pack has no cached_at; find the payloads before their rows are gone
+        std::vector<std::string> payload_keys;
+        if (pack_) {
+            SqliteStatement select;
+            if (select.prepare(db_, "SELECT DISTINCT payload_key FROM thumbnails "
+                                    "WHERE cached_at < ?;")) {
+                sqlite3_bind_int64(select, 1, older_than.time_since_epoch().count());
+                while (sqlite3_step(select) == SQLITE_ROW) {
+                    const char* key = reinterpret_cast<const char*>(sqlite3_column_text(select, 0));
+                    if (key) {
+                        payload_keys.emplace_back(key);
+                    }
+                }
+            }
+        }
+
         stmt_remove_older_than_.reset();
         sqlite3_bind_int64(stmt_remove_older_than_, 1, older_than.time_since_epoch().count());
 
@@ -432,45 +981,108 @@ public:
         if (rc != SQLITE_DONE) {
             return std::unexpected(sqlite_to_cache_error(rc));
         }
+        auto removed = static_cast<uint64_t>(sqlite3_changes(db_));
+
+        // Listings and capture info expire alike (not counted: they
+        // are not thumbnails)
+        for (const char* sql : {"DELETE FROM archive_listings WHERE cached_at < ?;",
+                                "DELETE FROM directory_listings WHERE cached_at < ?;",
+                                "DELETE FROM capture_info WHERE cached_at < ?;"}) {
+            SqliteStatement expired;
+            if (expired.prepare(db_, sql)) {
+                sqlite3_bind_int64(expired, 1, older_than.time_since_epoch().count());
+                (void)sqlite3_step(expired);
+            }
+        }
+
+        if (pack_) {
+            release_pack_payloads(payload_keys);
+        }
+        schedule_compaction();
 
-        return static_cast<uint64_t>(sqlite3_changes(db_));
+        return removed;
     }
 
     [[nodiscard]] std::expected<uint64_t, CacheError> removeOrphaned() {
+        OrphanSweep sweep;
+        while (true) {
+            auto more = sweep_orphans_batch(sweep);
+            if (!more) {
+                return std::unexpected(more.error());
+            }
+            if (!*more) {
+                return sweep.removed;
+            }
+        }
+    }
+
+    void removeOrphanedAsync(AsyncCallback<uint64_t> callback) {
+        auto sweep = std::make_shared<OrphanSweep>();
+        enqueue_idle_job([this, sweep]() { return sweep_orphans_batch(*sweep); },
+                         [sweep, callback = std::move(callback)](auto result) {
+                             if (!result) {
+                                 callback(std::unexpected(result.error()));
+                                 return;
+                             }
+                             callback(sweep->removed);
+                         });
+    }
+
+    [[nodiscard]] std::expected<uint64_t, CacheError> evictOldest(uint64_t max_entries,
+                                                                  uint64_t max_size_bytes) {
+        EvictionSweep sweep{max_entries, max_size_bytes};
+        while (true) {
+            auto more = evict_batch(sweep);
+            if (!more) {
+                return std::unexpected(more.error());
+            }
+            if (!*more) {
+                return sweep.removed;
+            }
+        }
+    }
+
+    void evictOldestAsync(uint64_t max_entries, uint64_t max_size_bytes,
+                          AsyncCallback<uint64_t> callback) {
+        auto sweep = std::make_shared<EvictionSweep>(EvictionSweep{max_entries, max_size_bytes});
+        enqueue_idle_job([this, sweep]() { return evict_batch(*sweep); },
+                         [sweep, callback = std::move(callback)](auto result) {
+                             if (!result) {
+                                 callback(std::unexpected(result.error()));
+                                 return;
+                             }
+                             callback(sweep->removed);
+                         });
+    }
+
+    [[nodiscard]] std::expected<std::vector<SourceHash>, CacheError> getPerceptualHashes() {
+        flush_pending_writes();
+
         std::lock_guard lock(db_mutex_);
 
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-        // First, get all source paths
-        std::vector<std::pair<std::string, std::string>>
-            entries_to_check;  // cache_key, source_path
-
-        stmt_get_all_paths_.reset();
-
-        while (sqlite3_step(stmt_get_all_paths_) == SQLITE_ROW) {
-            const char* cache_key =
-                reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_all_paths_, 0));
+        std::vector<SourceHash> hashes;
+        stmt_perceptual_hashes_.reset();
+        int rc = SQLITE_ROW;
+        while ((rc = sqlite3_step(stmt_perceptual_hashes_)) == SQLITE_ROW) {
             const char* source_path =
-                reinterpret_cast<const char*>(sqlite3_column_text(stmt_get_all_paths_, 1));
-            if (cache_key && source_path) {
-                entries_to_check.emplace_back(cache_key, source_path);
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt_perceptual_hashes_, 0));
+            if (!source_path) {
+                continue;
             }
+            hashes.push_back(
+                {.source_path = utf8ToPath(source_path),
+                 .hash = static_cast<uint64_t>(sqlite3_column_int64(stmt_perceptual_hashes_, 1))});
         }
+        stmt_perceptual_hashes_.reset();
 
-        // Check which files no longer exist and remove them
-        uint64_t count = 0;
-        for (const auto& [cache_key, source_path] : entries_to_check) {
-            if (!std::filesystem::exists(source_path)) {
-                stmt_remove_.reset();
-                sqlite3_bind_text(stmt_remove_, 1, cache_key.c_str(), -1, SQLITE_TRANSIENT);
-                if (sqlite3_step(stmt_remove_) == SQLITE_DONE) {
-                    ++count;
-                }
-            }
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite perceptual hash select error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
         }
-
-        return count;
+        return hashes;
     }
 
     [[nodiscard]] std::expected<CacheStats, CacheError> getStats() {
@@ -511,54 +1123,1499 @@ public:
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-        // First get the count
-        stmt_count_.reset();
+        // Queued puts would otherwise resurrect entries after the clear
+        {
+            std::lock_guard write_lock(write_mutex_);
+            write_queue_.clear();
+        }
+        space_cv_.notify_all();
+
+        // First get the count
+        stmt_count_.reset();
+        uint64_t count = 0;
+        if (sqlite3_step(stmt_count_) == SQLITE_ROW) {
+            count = static_cast<uint64_t>(sqlite3_column_int64(stmt_count_, 0));
+        }
+
+        // Then clear
+        stmt_clear_.reset();
+        int rc = sqlite3_step(stmt_clear_);
+        if (rc != SQLITE_DONE) {
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        rc = sqlite3_exec(db_,
+                          "DELETE FROM archive_listings; DELETE FROM directory_listings; "
+                          "DELETE FROM capture_info;",
+                          nullptr, nullptr, nullptr);
+        if (rc != SQLITE_OK) {
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        if (pack_) {
+            if (auto cleared = pack_->clear(); !cleared) {
+                return std::unexpected(cleared.error());
+            }
+        }
+
+        return count;
+    }
+
+    [[nodiscard]] std::expected<std::vector<uint8_t>, CacheError>
+    getArchiveListing(const std::string& archive_path, uint64_t write_time, uint64_t file_size) {
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_, "SELECT listing FROM archive_listings "
+                               "WHERE archive_path = ? AND write_time = ? AND file_size = ?;")) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        sqlite3_bind_text(stmt, 1, archive_path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(write_time));
+        sqlite3_bind_int64(stmt, 3, static_cast<int64_t>(file_size));
+
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_DONE) {
+            return std::unexpected(CacheError::NotFound);
+        }
+        if (rc != SQLITE_ROW) {
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+        int blob_size = sqlite3_column_bytes(stmt, 0);
+        if (!blob || blob_size <= 0) {
+            return std::vector<uint8_t>{};
+        }
+        return std::vector<uint8_t>(blob, blob + blob_size);
+    }
+
+    [[nodiscard]] std::expected<void, CacheError>
+    putArchiveListing(const std::string& archive_path, uint64_t write_time, uint64_t file_size,
+                      std::span<const uint8_t> listing) {
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_, "INSERT OR REPLACE INTO archive_listings "
+                               "(archive_path, write_time, file_size, listing, cached_at) "
+                               "VALUES (?, ?, ?, ?, ?);")) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        sqlite3_bind_text(stmt, 1, archive_path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(write_time));
+        sqlite3_bind_int64(stmt, 3, static_cast<int64_t>(file_size));
+        sqlite3_bind_blob(stmt, 4, listing.data(), static_cast<int>(listing.size()),
+                          SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 5, std::chrono::system_clock::now().time_since_epoch().count());
+
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite archive listing put error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        return {};
+    }
+
+    [[nodiscard]] std::expected<StoredListing, CacheError>
+    getDirectoryListing(const std::string& directory_path, uint32_t options) {
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_, "SELECT write_time, listing FROM directory_listings "
+                               "WHERE directory_path = ? AND options = ?;")) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        sqlite3_bind_text(stmt, 1, directory_path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, options);
+
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_DONE) {
+            return std::unexpected(CacheError::NotFound);
+        }
+        if (rc != SQLITE_ROW) {
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        StoredListing stored;
+        stored.write_time = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+        const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1));
+        int blob_size = sqlite3_column_bytes(stmt, 1);
+        if (blob && blob_size > 0) {
+            stored.listing.assign(blob, blob + blob_size);
+        }
+        return stored;
+    }
+
+    [[nodiscard]] std::expected<void, CacheError>
+    putDirectoryListing(const std::string& directory_path, uint32_t options,
+                        const StoredListing& listing) {
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_, "INSERT OR REPLACE INTO directory_listings "
+                               "(directory_path, options, write_time, listing, cached_at) "
+                               "VALUES (?, ?, ?, ?, ?);")) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        sqlite3_bind_text(stmt, 1, directory_path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, options);
+        sqlite3_bind_int64(stmt, 3, static_cast<int64_t>(listing.write_time));
+        sqlite3_bind_blob(stmt, 4, listing.listing.data(), static_cast<int>(listing.listing.size()),
+                          SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 5, std::chrono::system_clock::now().time_since_epoch().count());
+
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite directory listing put error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+
+        // Keep the recently visited directories only
+        SqliteStatement trim;
+        if (trim.prepare(db_, "DELETE FROM directory_listings WHERE rowid NOT IN "
+                              "(SELECT rowid FROM directory_listings "
+                              "ORDER BY cached_at DESC LIMIT ?);")) {
+            sqlite3_bind_int(trim, 1, kMaxDirectoryListings);
+            (void)sqlite3_step(trim);
+        }
+        return {};
+    }
+
+    [[nodiscard]] std::expected<std::vector<CaptureRecord>, CacheError>
+    getCaptureInfoMany(const std::vector<std::string>& keys) {
+        std::vector<CaptureRecord> result;
+        if (keys.empty()) {
+            return result;
+        }
+
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        if (auto staged = stage_keys(db_, stmt_prefetch_insert_, keys); !staged)
+            return std::unexpected(staged.error());
+
+        stmt_capture_select_.reset();
+        int rc = SQLITE_ROW;
+        while ((rc = sqlite3_step(stmt_capture_select_)) == SQLITE_ROW) {
+            const char* key =
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt_capture_select_, 0));
+            const char* camera =
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt_capture_select_, 2));
+            if (!key) {
+                continue;
+            }
+            CaptureRecord record{.cache_key = key,
+                                 .camera_model = camera ? utf8ToWideOrEmpty(camera) : L""};
+            if (sqlite3_column_type(stmt_capture_select_, 1) != SQLITE_NULL) {
+                record.date_taken =
+                    std::chrono::system_clock::time_point(std::chrono::system_clock::duration(
+                        sqlite3_column_int64(stmt_capture_select_, 1)));
+            }
+            result.push_back(std::move(record));
+        }
+        stmt_capture_select_.reset();
+
+        sqlite3_exec(db_, "DELETE FROM temp.prefetch_keys;", nullptr, nullptr, nullptr);
+
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite capture info select error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        return result;
+    }
+
+    [[nodiscard]] std::expected<void, CacheError>
+    putCaptureInfoMany(std::span<const CaptureRecord> records) {
+        if (records.empty()) {
+            return {};
+        }
+
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
+        sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+        for (const auto& record : records) {
+            std::string camera = wideToUtf8OrEmpty(record.camera_model);
+            stmt_capture_insert_.reset();
+            sqlite3_bind_text(stmt_capture_insert_, 1, record.cache_key.c_str(), -1,
+                              SQLITE_TRANSIENT);
+            if (record.date_taken) {
+                sqlite3_bind_int64(stmt_capture_insert_, 2,
+                                   record.date_taken->time_since_epoch().count());
+            } else {
+                sqlite3_bind_null(stmt_capture_insert_, 2);
+            }
+            sqlite3_bind_text(stmt_capture_insert_, 3, camera.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt_capture_insert_, 4, now);
+
+            int rc = sqlite3_step(stmt_capture_insert_);
+            if (rc != SQLITE_DONE) {
+                LOG_ERROR("SQLite capture info put error: {} - {}", rc, sqlite3_errmsg(db_));
+                stmt_capture_insert_.reset();
+                sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+                return std::unexpected(sqlite_to_cache_error(rc));
+            }
+        }
+        stmt_capture_insert_.reset();
+        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        return {};
+    }
+
+    [[nodiscard]] std::expected<void, CacheError> vacuum() {
+        // Metadata rows are small; pack compaction reclaims the payload space
+        // in the background and never blocks readers
+        if (pack_) {
+            schedule_compaction(/*force=*/true);
+            return {};
+        }
+
+        std::lock_guard lock(db_mutex_);
+
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        int rc = sqlite3_exec(db_, "VACUUM;", nullptr, nullptr, nullptr);
+        if (rc != SQLITE_OK) {
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+
+        return {};
+    }
+
+    [[nodiscard]] std::expected<void, CacheError>
+    startCopy(const std::filesystem::path& destination) {
+        cancelCopy();
+        std::lock_guard lock(db_mutex_);
+        if (auto guard = ensureOpen(); !guard) {
+            return std::unexpected(guard.error());
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(destination.parent_path(), ec);
+        Copy copy;
+        copy.destination = destination;
+        copy.partial = destination;
+        copy.partial += L".partial";
+        std::filesystem::remove(copy.partial, ec);
+
+        // A fresh file in rollback mode takes the source's page size and,
+        // with its header, its journal mode
+        int rc = sqlite3_open(pathToUtf8(copy.partial).c_str(), &copy.db);
+        if (rc == SQLITE_OK) {
+            copy.backup = sqlite3_backup_init(copy.db, "main", db_, "main");
+        }
+        if (!copy.backup) {
+            LOG_ERROR("Failed to start cache copy to {}: {}", pathToUtf8(destination),
+                      copy.db ? sqlite3_errmsg(copy.db) : "out of memory");
+            sqlite3_close(copy.db);
+            std::filesystem::remove(copy.partial, ec);
+            return std::unexpected(CacheError::IoError);
+        }
+
+        if (pack_) {
+            // A compaction already queued runs anyway; the copy then starts over
+            copy.pack_generation = pack_->generation();
+            copy.holds_compaction = !compaction_queued_.exchange(true);
+        }
+        copy_ = std::move(copy);
+        return {};
+    }
+
+    [[nodiscard]] std::expected<bool, CacheError> copyStep() {
+        if (!copy_) {
+            return std::unexpected(CacheError::NotFound);
+        }
+        BackgroundPriority priority;
+        if (!copy_->pages_done) {
+            std::lock_guard lock(db_mutex_);
+            int rc = sqlite3_backup_step(copy_->backup, kCopyPagesPerStep);
+            if (rc == SQLITE_DONE) {
+                copy_->pages_done = true;
+            } else if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+                LOG_ERROR("Cache copy failed: {}", sqlite3_errstr(rc));
+                return std::unexpected(sqlite_to_cache_error(rc));
+            }
+            return true;
+        }
+        return pack_ ? copy_pack(kCopyPackBytesPerStep) : false;
+    }
+
+    [[nodiscard]] std::expected<void, CacheError> finishCopy() {
+        if (!copy_) {
+            return std::unexpected(CacheError::NotFound);
+        }
+        flush_pending_writes();
+        if (auto caught_up = complete_copy(); !caught_up) {
+            cancelCopy();
+            return caught_up;
+        }
+
+        // Whatever was at the destination goes: a stale WAL would be replayed
+        // into the copy, and an older pack of a higher generation chosen over it
+        const auto& destination = copy_->destination;
+        std::error_code ec;
+        for (const wchar_t* suffix : {L"-wal", L"-shm", L"-journal"}) {
+            auto stale = destination;
+            stale += suffix;
+            std::filesystem::remove(stale, ec);
+        }
+        if (pack_) {
+            std::wstring prefix = destination.stem().wstring() + L"-";
+            for (const auto& entry :
+                 std::filesystem::directory_iterator(destination.parent_path(), ec)) {
+                if (entry.path().extension() == L".pack" &&
+                    entry.path().filename().wstring().starts_with(prefix)) {
+                    std::filesystem::remove(entry.path(), ec);
+                }
+            }
+            auto pack_path = pack_copy_path();
+            auto final_path = pack_path;
+            final_path.replace_extension();
+            if (!MoveFileExW(pack_path.c_str(), final_path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+                LOG_ERROR("Failed to finalize pack copy {}: {}", pathToUtf8(final_path),
+                          GetLastError());
+                cancelCopy();
+                return std::unexpected(CacheError::IoError);
+            }
+        }
+        if (!MoveFileExW(copy_->partial.c_str(), destination.c_str(),
+                         MOVEFILE_REPLACE_EXISTING)) {
+            LOG_ERROR("Failed to finalize cache copy {}: {}", pathToUtf8(destination),
+                      GetLastError());
+            cancelCopy();
+            return std::unexpected(CacheError::IoError);
+        }
+        LOG_INFO("Cache database copied to {}", pathToUtf8(destination));
+        end_copy();
+        return {};
+    }
+
+    void cancelCopy() {
+        if (!copy_) {
+            return;
+        }
+        {
+            std::lock_guard lock(db_mutex_);
+            if (copy_->backup) {
+                sqlite3_backup_finish(copy_->backup);
+            }
+            if (copy_->db) {
+                sqlite3_close(copy_->db);
+            }
+        }
+        std::error_code ec;
+        std::filesystem::remove(copy_->partial, ec);
+        if (pack_) {
+            std::filesystem::remove(pack_copy_path(), ec);
+        }
+        end_copy();
+    }
+
+    [[nodiscard]] std::expected<uint32_t, CacheError> trainDictionary() {
+        // Sample stored lossless payloads; JPEG rows say nothing about raw pixels
+        std::vector<StoredRow> rows;
+        if (pack_) {
+            // Encoded sizes; the decoded total is bounded below
+            auto blobs = pack_->sample(kDictionarySampleRows, kDictionarySampleBytes,
+                                       [](PayloadFormat format) {
+                                           return format != PayloadFormat::Jpeg;
+                                       });
+            for (auto& blob : blobs) {
+                StoredRow row;
+                row.format = blob.format;
+                row.pack = std::move(blob);
+                rows.push_back(std::move(row));
+            }
+        } else {
+            std::lock_guard lock(db_mutex_);
+
+            if (auto guard = ensureOpen(); !guard)
+                return std::unexpected(guard.error());
+
+            SqliteStatement stmt;
+            if (!stmt.prepare(db_,
+                              "SELECT p.pixel_data, p.payload_format, t.data_size "
+                              "FROM thumbnail_payloads p JOIN thumbnails t ON t.payload_key = "
+                              "p.payload_key WHERE p.payload_format IN (0, 1) "
+                              "ORDER BY RANDOM() LIMIT ?;")) {
+                return std::unexpected(CacheError::DatabaseError);
+            }
+            sqlite3_bind_int(stmt, 1, kDictionarySampleRows);
+
+            uint64_t sample_bytes = 0;
+            while (sample_bytes < kDictionarySampleBytes && sqlite3_step(stmt) == SQLITE_ROW) {
+                sample_bytes += static_cast<uint64_t>(sqlite3_column_int64(stmt, 2));
+                StoredRow row;
+                const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+                int blob_size = sqlite3_column_bytes(stmt, 0);
+                if (blob && blob_size > 0) {
+                    row.entry.data.assign(blob, blob + blob_size);
+                    row.format = static_cast<PayloadFormat>(sqlite3_column_int(stmt, 1));
+                    rows.push_back(std::move(row));
+                }
+            }
+        }
+
+        std::vector<std::vector<uint8_t>> samples;
+        samples.reserve(rows.size());
+        uint64_t decoded_bytes = 0;
+        for (auto& row : rows) {
+            if (decoded_bytes >= kDictionarySampleBytes) {
+                break;
+            }
+            if (decode_row(row)) {
+                decoded_bytes += row.entry.data.size();
+                samples.push_back(std::move(row.entry.data));
+            }
+        }
+        if (samples.size() < static_cast<size_t>(kDictionaryMinSamples)) {
+            LOG_DEBUG("zstd dictionary: {} samples, need {}", samples.size(),
+                      kDictionaryMinSamples);
+            return std::unexpected(CacheError::NotFound);
+        }
+
+        auto dict = PayloadCodec::trainDictionary(samples, kDictionaryMaxSize);
+        if (!dict) {
+            return std::unexpected(dict.error());
+        }
+
+        uint32_t dict_id = PayloadCodec::dictionaryId(*dict);
+        if (dict_id == 0) {
+            return std::unexpected(CacheError::CompressionError);
+        }
+
+        // Persist before use, so no row ever names a dictionary the file lacks
+        std::lock_guard lock(db_mutex_);
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_,
+                          "INSERT OR REPLACE INTO zstd_dictionaries (dict_id, data, created_at) "
+                          "VALUES (?, ?, ?);")) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        sqlite3_bind_int64(stmt, 1, dict_id);
+        sqlite3_bind_blob(stmt, 2, dict->data(), static_cast<int>(dict->size()), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 3,
+                           std::chrono::system_clock::now().time_since_epoch().count());
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite dictionary insert error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        codec_.addDictionary(*dict);
+
+        LOG_INFO("Trained zstd dictionary {} ({} bytes, {} samples)", dict_id, dict->size(),
+                 samples.size());
+        return dict_id;
+    }
+
+    /// @brief Train a dictionary on the worker thread if enabled and none exists
+    void scheduleDictionaryTraining() {
+        if (!codec_.options().train_dictionary || codec_.activeDictionaryId() != 0) {
+            return;
+        }
+        enqueue_task([this]() {
+            if (auto trained = trainDictionary();
+                !trained && trained.error() != CacheError::NotFound) {
+                LOG_WARN("zstd dictionary training failed: {}", to_string(trained.error()));
+            }
+        });
+    }
+
+    // Async operations
+
+    void getAsync(const std::string& key, AsyncCallback<ThumbnailEntry> callback) {
+        enqueue_task([this, key, callback = std::move(callback)]() { callback(get(key)); });
+    }
+
+    void putAsync(ThumbnailEntry entry, AsyncCallback<void> callback) {
+        enqueue_task([this, entry = std::move(entry), callback = std::move(callback)]() {
+            callback(put(entry));
+        });
+    }
+
+    void removeAsync(const std::string& key, AsyncCallback<void> callback) {
+        enqueue_task([this, key, callback = std::move(callback)]() { callback(remove(key)); });
+    }
+
+    void removeStaleAsync(std::vector<StaleSource> sources, AsyncCallback<uint64_t> callback) {
+        enqueue_task([this, sources = std::move(sources), callback = std::move(callback)]() {
+            callback(remove_stale(sources));
+        });
+    }
+
+    void rekeySourcesAsync(std::vector<MovedSource> moves, AsyncCallback<uint64_t> callback) {
+        enqueue_task([this, moves = std::move(moves), callback = std::move(callback)]() {
+            callback(rekey_sources(moves));
+        });
+    }
+
+    void removeOlderThanAsync(std::chrono::system_clock::time_point older_than,
+                              AsyncCallback<uint64_t> callback) {
+        enqueue_task([this, older_than, callback = std::move(callback)]() {
+            BackgroundPriority priority;
+            callback(removeOlderThan(older_than));
+        });
+    }
+
+private:
+    /// @brief Encode an entry's pixels for storage (see PayloadCodec::encode)
+    [[nodiscard]] std::expected<PendingWrite, CacheError>
+    encode_write(const ThumbnailEntry& entry) const {
+        auto encoded = codec_.encode(entry.data, entry.metadata.width, entry.metadata.height);
+        if (!encoded) {
+            return std::unexpected(encoded.error());
+        }
+
+        PendingWrite write{
+            .metadata = entry.metadata, .format = encoded->format, .payload = {}};
+        write.metadata.data_size = entry.data.size();
+        write.payload = std::move(encoded->data);
+        return write;
+    }
+
+    /// @brief Insert metadata and payload rows (db_mutex_ held, inside a transaction)
+    [[nodiscard]] std::expected<void, CacheError> insert_row(const PendingWrite& write) {
+        const auto& metadata = write.metadata;
+        const std::string& payload_key = payload_key_of(metadata);
+        bool shared = !metadata.content_hash.empty();
+
+        // Payload first: a metadata row must never point at a missing payload
+        if (pack_) {
+            if (!shared || !pack_->read(payload_key)) {
+                if (auto written = pack_->write(payload_key, write.format, write.payload);
+                    !written) {
+                    return std::unexpected(written.error());
+                }
+            }
+        }
+
+        // A replaced row may have referenced another (shared) payload
+        std::vector<std::string> previous;
+        if (pack_) {
+            previous = payload_keys_for({metadata.file_hash});
+            std::erase(previous, payload_key);
+        }
+
+        if (auto inserted = insert_metadata(metadata); !inserted) {
+            return inserted;
+        }
+
+        if (pack_) {
+            release_pack_payloads(previous);
+            return {};
+        }
+
+        // INSERT OR {REPLACE|IGNORE} INTO thumbnail_payloads
+        //     (payload_key, payload_format, pixel_data)
+        SqliteStatement& stmt = shared ? stmt_put_shared_payload_ : stmt_put_payload_;
+        stmt.reset();
+        sqlite3_bind_text(stmt, 1, payload_key.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, static_cast<int>(write.format));
+        sqlite3_bind_blob(stmt, 3, write.payload.data(), static_cast<int>(write.payload.size()),
+                          SQLITE_TRANSIENT);
+
+        int rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite payload put error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+
+        return {};
+    }
+
+    /// @brief Insert or replace a metadata row (db_mutex_ held)
+    [[nodiscard]] std::expected<void, CacheError>
+    insert_metadata(const ThumbnailMetadata& metadata) {
+        stmt_put_.reset();
+
+        // Bind parameters
+        // INSERT OR REPLACE INTO thumbnails (cache_key, source_path, file_hash, width, height,
+        //                                    original_width, original_height, source_mtime,
+        //                                    cached_at, data_size, payload_key, perceptual_hash,
+        //                                    average_color, accessed_at = cached_at)
+        std::string source_path_str = pathToUtf8(metadata.source_path);
+
+        sqlite3_bind_text(stmt_put_, 1, metadata.file_hash.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt_put_, 2, source_path_str.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt_put_, 3, metadata.file_hash.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt_put_, 4, static_cast<int>(metadata.width));
+        sqlite3_bind_int(stmt_put_, 5, static_cast<int>(metadata.height));
+        sqlite3_bind_int(stmt_put_, 6, static_cast<int>(metadata.original_width));
+        sqlite3_bind_int(stmt_put_, 7, static_cast<int>(metadata.original_height));
+        sqlite3_bind_int64(stmt_put_, 8, metadata.source_mtime.time_since_epoch().count());
+        sqlite3_bind_int64(stmt_put_, 9, metadata.cached_at.time_since_epoch().count());
+        sqlite3_bind_int64(stmt_put_, 10, static_cast<sqlite3_int64>(metadata.data_size));
+        sqlite3_bind_text(stmt_put_, 11, payload_key_of(metadata).c_str(), -1, SQLITE_TRANSIENT);
+        if (metadata.perceptual_hash) {
+            sqlite3_bind_int64(stmt_put_, 12,
+                               static_cast<sqlite3_int64>(*metadata.perceptual_hash));
+        } else {
+            sqlite3_bind_null(stmt_put_, 12);
+        }
+        if (metadata.average_color) {
+            sqlite3_bind_int(stmt_put_, 13, static_cast<int>(*metadata.average_color));
+        } else {
+            sqlite3_bind_null(stmt_put_, 13);
+        }
+
+        int rc = sqlite3_step(stmt_put_);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("SQLite put error: {} - {}", rc, sqlite3_errmsg(db_));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        return {};
+    }
+
+    /// @brief Payload keys referenced by the given rows (pack backend, db_mutex_ held)
+    [[nodiscard]] std::vector<std::string>
+    payload_keys_for(const std::vector<std::string>& cache_keys) {
+        std::vector<std::string> payload_keys;
+        payload_keys.reserve(cache_keys.size());
+        for (const auto& key : cache_keys) {
+            stmt_payload_key_.reset();
+            sqlite3_bind_text(stmt_payload_key_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt_payload_key_) == SQLITE_ROW) {
+                const char* payload_key =
+                    reinterpret_cast<const char*>(sqlite3_column_text(stmt_payload_key_, 0));
+                if (payload_key) {
+                    payload_keys.emplace_back(payload_key);
+                }
+            }
+        }
+        stmt_payload_key_.reset();
+        return payload_keys;
+    }
+
+    /// @brief Drop pack payloads that no row references any more (db_mutex_ held)
+    ///
+    /// The SQLite backend does this in the thumbnails_delete_payload trigger.
+    void release_pack_payloads(const std::vector<std::string>& payload_keys) {
+        for (const auto& key : payload_keys) {
+            stmt_payload_refs_.reset();
+            sqlite3_bind_text(stmt_payload_refs_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt_payload_refs_) != SQLITE_ROW) {
+                pack_->remove(key);
+            }
+        }
+        stmt_payload_refs_.reset();
+    }
+
+    /// @brief Leave WAL checkpoints to COMMIT, or hand them to the checkpointer thread
+    void configure_checkpoints() {
+        if (!tuning_.background_checkpoint || tuning_.wal_autocheckpoint_pages == 0) {
+            sqlite3_wal_autocheckpoint(db_, static_cast<int>(tuning_.wal_autocheckpoint_pages));
+            return;
+        }
+        // Replaces the autocheckpoint hook: commits only signal the thread
+        sqlite3_wal_hook(db_, &Impl::on_wal_commit, this);
+        checkpointer_ =
+            std::jthread([this](std::stop_token stop_token) { checkpointer_thread(stop_token); });
+    }
+
+    /// @brief sqlite3_wal_hook callback, run inside each commit on the writer connection
+    static int on_wal_commit(void* context, sqlite3*, const char*, int wal_pages) {
+        auto* self = static_cast<Impl*>(context);
+        if (static_cast<uint32_t>(wal_pages) >= self->tuning_.wal_autocheckpoint_pages) {
+            {
+                std::lock_guard lock(self->checkpoint_mutex_);
+                self->checkpoint_requested_ = true;
+            }
+            self->checkpoint_cv_.notify_one();
+        }
+        return SQLITE_OK;
+    }
+
+    /// @brief Copy the WAL back into the database on a connection of its own
+    ///
+    /// PASSIVE checkpoints take no lock that readers or the writer wait for;
+    /// pages still in some reader's snapshot are left for the next pass.
+    void checkpointer_thread(std::stop_token stop_token) {
+        sqlite3* db = nullptr;
+        if (sqlite3_open_v2(pathToUtf8(db_path_).c_str(), &db,
+                            SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+            LOG_WARN("Cache checkpointer unavailable, checkpointing in COMMIT: {}",
+                     sqlite3_errmsg(db));
+            sqlite3_close(db);
+            std::lock_guard lock(db_mutex_);
+            sqlite3_wal_autocheckpoint(db_, static_cast<int>(tuning_.wal_autocheckpoint_pages));
+            return;
+        }
+        sqlite3_busy_timeout(db, static_cast<int>(tuning_.busy_timeout_ms));
+
+        while (true) {
+            {
+                std::unique_lock lock(checkpoint_mutex_);
+                auto requested = [this] { return checkpoint_requested_; };
+                if (!checkpoint_cv_.wait(lock, stop_token, requested)) {
+                    break;  // Closing; the writer's close checkpoints what is left
+                }
+                checkpoint_requested_ = false;
+            }
+
+            BackgroundPriority background;
+            int wal_pages = 0;
+            int copied_pages = 0;
+            auto start = std::chrono::steady_clock::now();
+            int rc = sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &wal_pages,
+                                               &copied_pages);
+            if (rc != SQLITE_OK && rc != SQLITE_BUSY) {
+                LOG_WARN("Cache WAL checkpoint failed: {} - {}", rc, sqlite3_errmsg(db));
+                continue;
+            }
+            LOG_DEBUG("Cache WAL checkpoint: {} of {} pages in {} ms", copied_pages, wal_pages,
+                      std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+        }
+        sqlite3_close(db);
+    }
+
+    /// @brief A reader connection checked out of the pool for one call
+    class ReaderLease {
+    public:
+        ReaderLease(Impl& impl, std::unique_ptr<ReaderConnection> reader)
+            : impl_(impl), reader_(std::move(reader)) {}
+
+        ~ReaderLease() {
+            if (reader_) {
+                impl_.release_reader(std::move(reader_));
+            }
+        }
+
+        ReaderLease(const ReaderLease&) = delete;
+        ReaderLease& operator=(const ReaderLease&) = delete;
+
+        explicit operator bool() const noexcept { return reader_ != nullptr; }
+        ReaderConnection* operator->() const noexcept { return reader_.get(); }
+
+    private:
+        Impl& impl_;
+        std::unique_ptr<ReaderConnection> reader_;
+    };
+
+    /// @brief Take an idle reader connection, opening one if none is idle
+    ///
+    /// No db_mutex_: reads never wait for the writer connection. The pool
+    /// grows to the number of threads that read at once.
+    [[nodiscard]] ReaderLease acquire_reader() {
+        {
+            std::lock_guard lock(reader_mutex_);
+            if (!reader_pool_.empty()) {
+                auto reader = std::move(reader_pool_.back());
+                reader_pool_.pop_back();
+                return ReaderLease(*this, std::move(reader));
+            }
+        }
+        if (read_only_) {
+            return ReaderLease(*this, ReaderConnection::open(immutable_uri(db_path_), tuning_,
+                                                             SQLITE_OPEN_URI));
+        }
+        return ReaderLease(*this, ReaderConnection::open(pathToUtf8(db_path_), tuning_));
+    }
+
+    void release_reader(std::unique_ptr<ReaderConnection> reader) {
+        reader->resetAll();
+        std::lock_guard lock(reader_mutex_);
+        reader_pool_.push_back(std::move(reader));
+    }
+
+    /// @brief Newest queued or committing put for a key (write_mutex_ must be held)
+    [[nodiscard]] const PendingWrite* find_pending_write(const std::string& key) const {
+        // Newest first: a later put for the same key supersedes earlier ones
+        for (const auto* writes : {&write_queue_, &committing_}) {
+            for (auto it = writes->rbegin(); it != writes->rend(); ++it) {
+                if (it->metadata.file_hash == key) {
+                    return &*it;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Copy of a queued (not yet committed) entry, payload still encoded
+    [[nodiscard]] std::optional<StoredRow> find_pending(const std::string& key) {
+        std::lock_guard lock(write_mutex_);
+        if (const auto* write = find_pending_write(key)) {
+            return StoredRow{.entry = {.metadata = write->metadata, .data = write->payload},
+                             .format = write->format};
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Metadata of a queued (not yet committed) entry
+    [[nodiscard]] std::optional<ThumbnailMetadata> find_pending_metadata(const std::string& key) {
+        std::lock_guard lock(write_mutex_);
+        if (const auto* write = find_pending_write(key)) {
+            return write->metadata;
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Record that a stored row was read, for eviction order
+    void note_access(const std::string& key) {
+        if (read_only_) {
+            return;
+        }
+        std::lock_guard lock(write_mutex_);
+        if (pending_access_.size() < kMaxPendingAccesses) {
+            pending_access_.insert(key);
+        }
+        if (pending_access_.size() >= kAccessBatchSize) {
+            write_cv_.notify_one();
+        }
+    }
+
+    void note_access(const std::vector<ThumbnailEntry>& entries) {
+        if (entries.empty() || read_only_) {
+            return;
+        }
+        std::lock_guard lock(write_mutex_);
+        for (const auto& entry : entries) {
+            if (pending_access_.size() >= kMaxPendingAccesses) {
+                break;
+            }
+            pending_access_.insert(entry.metadata.file_hash);
+        }
+        if (pending_access_.size() >= kAccessBatchSize) {
+            write_cv_.notify_one();
+        }
+    }
+
+    /// @brief Set accessed_at of rows read since the last commit (db_mutex_ held)
+    /// @return Number of rows that failed to update
+    size_t touch_rows(const std::unordered_set<std::string>& keys) {
+        auto now = std::chrono::system_clock::now();
+        auto stale = now - kAccessResolution;
+        size_t failed = 0;
+        for (const auto& key : keys) {
+            stmt_touch_.reset();
+            sqlite3_bind_int64(stmt_touch_, 1, now.time_since_epoch().count());
+            sqlite3_bind_text(stmt_touch_, 2, key.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt_touch_, 3, stale.time_since_epoch().count());
+            if (sqlite3_step(stmt_touch_) != SQLITE_DONE) {
+                ++failed;
+            }
+        }
+        stmt_touch_.reset();
+        return failed;
+    }
+
+    /// @brief Commit every queued put and recorded read in one transaction
+    ///
+    /// The batch stays visible in committing_ until COMMIT returns. Readers
+    /// look in the queues before their snapshot, so an entry is always in
+    /// one place or the other.
+    void flush_pending_writes() {
+        std::lock_guard lock(db_mutex_);
+
+        std::unordered_set<std::string> accessed;
+        {
+            std::lock_guard write_lock(write_mutex_);
+            committing_.swap(write_queue_);
+            accessed.swap(pending_access_);
+        }
+        space_cv_.notify_all();
+
+        // Only this function changes committing_, and only under write_mutex_;
+        // the reads below race with nothing but other reads
+        const auto& batch = committing_;
+        auto finish = [this] {
+            std::vector<PendingWrite> done;  // Payloads are freed outside the lock
+            std::lock_guard write_lock(write_mutex_);
+            done.swap(committing_);
+        };
+
+        if ((batch.empty() && accessed.empty()) || !db_) {
+            finish();
+            return;
+        }
+
+        auto commit_start = std::chrono::steady_clock::now();
+        sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+        size_t failed = 0;
+        for (const auto& write : batch) {
+            if (!insert_row(write)) {
+                ++failed;
+            }
+        }
+        // After the puts, so a row written in this batch keeps the newer time
+        size_t touch_failed = touch_rows(accessed);
+        int rc = sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("SQLite batch commit error: {} - {}", rc, sqlite3_errmsg(db_));
+            sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        } else if (failed > 0) {
+            LOG_WARN("Cache batch: {} of {} puts failed", failed, batch.size());
+        }
+        if (touch_failed > 0) {
+            LOG_WARN("Cache batch: {} of {} access times not updated", touch_failed,
+                     accessed.size());
+        }
+        etw::dbCommit(batch.size(), failed,
+                      std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - commit_start)
+                          .count());
+        finish();
+
+        // Replaced payloads leave dead records behind in the pack file
+        if (!batch.empty()) {
+            schedule_compaction();
+        }
+    }
+
+    void writer_thread() {
+        std::unique_lock lock(write_mutex_);
+        while (true) {
+            write_cv_.wait(lock, [this] {
+                return !write_queue_.empty() || pending_access_.size() >= kAccessBatchSize ||
+                       writer_stopping_;
+            });
+            if (write_queue_.empty() && pending_access_.empty() && writer_stopping_) {
+                break;
+            }
+
+            // Let a partial batch fill up for a while before committing it;
+            // recorded reads alone are committed at once, as they are a full batch
+            if (!writer_stopping_ && !write_queue_.empty() &&
+                write_queue_.size() < kWriteBatchSize) {
+                write_cv_.wait_for(lock, kWriteFlushInterval, [this] {
+                    return write_queue_.size() >= kWriteBatchSize || writer_stopping_;
+                });
+            }
+
+            lock.unlock();
+            flush_pending_writes();
+            lock.lock();
+        }
+    }
+
+    /// @brief Read the metadata columns of a row
+    ///
+    /// Columns: source_path, file_hash, width, height, original_width, original_height,
+    ///          source_mtime, cached_at, data_size, payload_key, perceptual_hash,
+    ///          average_color
+    [[nodiscard]] static ThumbnailMetadata read_metadata(sqlite3_stmt* stmt) {
+        ThumbnailMetadata metadata;
+
+        const char* source_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* file_hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+
+        metadata.source_path = source_path ? source_path : "";
+        metadata.file_hash = file_hash ? file_hash : "";
+        metadata.width = static_cast<uint32_t>(sqlite3_column_int(stmt, 2));
+        metadata.height = static_cast<uint32_t>(sqlite3_column_int(stmt, 3));
+        metadata.original_width = static_cast<uint32_t>(sqlite3_column_int(stmt, 4));
+        metadata.original_height = static_cast<uint32_t>(sqlite3_column_int(stmt, 5));
+
+        int64_t source_mtime = sqlite3_column_int64(stmt, 6);
+        int64_t cached_at = sqlite3_column_int64(stmt, 7);
+        metadata.source_mtime = std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(source_mtime));
+        metadata.cached_at =
+            std::chrono::system_clock::time_point(std::chrono::system_clock::duration(cached_at));
+
+        metadata.data_size = static_cast<uint64_t>(sqlite3_column_int64(stmt, 8));
+
+        const char* payload_key = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+        if (payload_key && metadata.file_hash != payload_key) {
+            metadata.content_hash = payload_key;
+        }
+        if (sqlite3_column_type(stmt, 10) != SQLITE_NULL) {
+            metadata.perceptual_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 10));
+        }
+        if (sqlite3_column_type(stmt, 11) != SQLITE_NULL) {
+            metadata.average_color = static_cast<uint32_t>(sqlite3_column_int(stmt, 11));
+        }
+        return metadata;
+    }
+
+    /// @brief Read a full entry row; pixel data is left as stored (encoded)
+    /// @param copy_payload Copy the pixel_data blob into the entry; callers that
+    ///        decode from the column while the statement is current pass false
+    ///
+    /// Columns: source_path, file_hash, width, height, original_width, original_height,
+    ///          source_mtime, cached_at, data_size, payload_key, perceptual_hash,
+    ///          average_color, pixel_data, payload_format
+    [[nodiscard]] static StoredRow read_entry_row(sqlite3_stmt* stmt, bool copy_payload = true) {
+        StoredRow row;
+        auto& entry = row.entry;
+        entry.metadata = read_metadata(stmt);
+
+        // Read pixel data blob
+        const void* blob_data = copy_payload ? sqlite3_column_blob(stmt, 12) : nullptr;
+        int blob_size = copy_payload ? sqlite3_column_bytes(stmt, 12) : 0;
+
+        if (blob_data && blob_size > 0) {
+            entry.data.resize(static_cast<size_t>(blob_size));
+            std::memcpy(entry.data.data(), blob_data, static_cast<size_t>(blob_size));
+        }
+
+        row.format = static_cast<PayloadFormat>(sqlite3_column_int(stmt, 13));
+        return row;
+    }
+
+    /// @brief Decode a row's payload to BGRA32 pixels in place
+    [[nodiscard]] std::expected<void, CacheError> decode_row(StoredRow& row) const {
+        auto& entry = row.entry;
+        std::span<const uint8_t> encoded = row.pack.data.empty() ? entry.data : row.pack.data;
+        if (encoded.empty()) {
+            return {};
+        }
+
+        auto pixels =
+            codec_.decode(row.format, encoded, entry.metadata.width, entry.metadata.height);
+        if (!pixels) {
+            return std::unexpected(pixels.error());
+        }
+        entry.data = std::move(*pixels);
+        row.format = PayloadFormat::Raw;
+        row.pack = {};
+        return {};
+    }
+
+    /// @brief Look up a row's payload in the pack file
+    [[nodiscard]] std::expected<void, CacheError> attach_pack_payload(StoredRow& row) const {
+        auto blob = pack_->read(payload_key_of(row.entry.metadata));
+        if (!blob) {
+            return std::unexpected(blob.error());
+        }
+        row.format = blob->format;
+        row.pack = std::move(*blob);
+        return {};
+    }
+
+    /// @brief Queue pack compaction on the worker thread when it is worthwhile
+    void schedule_compaction(bool force = false) {
+        if (!pack_ || (!force && !pack_->needsCompaction())) {
+            return;
+        }
+        if (compaction_queued_.exchange(true)) {
+            return;
+        }
+        enqueue_task([this]() {
+            if (auto compacted = pack_->compact(); !compacted) {
+                LOG_WARN("Pack compaction failed: {}", to_string(compacted.error()));
+            }
+            compaction_queued_ = false;
+        });
+    }
+
+    /// @brief Pack file copyStep() writes, named as PackStore::open() expects plus .tmp
+    [[nodiscard]] std::filesystem::path pack_copy_path() const {
+        return copy_->destination.parent_path() /
+               (copy_->destination.stem().wstring() + L"-" +
+                std::to_wstring(copy_->pack_generation) + L".pack.tmp");
+    }
+
+    /// @brief Copy up to max_bytes more of the pack file
+    /// @return Whether anything was left to copy
+    [[nodiscard]] std::expected<bool, CacheError> copy_pack(uint64_t max_bytes) {
+        auto copied = pack_->copyTo(pack_copy_path(), copy_->pack_generation,
+                                    copy_->pack_copied, max_bytes);
+        if (!copied && copied.error() == CacheError::Expired) {
+            // Compacted meanwhile: the new generation is copied from the start
+            std::error_code ec;
+            std::filesystem::remove(pack_copy_path(), ec);
+            copy_->pack_generation = pack_->generation();
+            copy_->pack_copied = 0;
+            return true;
+        }
+        if (!copied) {
+            return std::unexpected(copied.error());
+        }
+        bool more = *copied != copy_->pack_copied;
+        copy_->pack_copied = *copied;
+        return more;
+    }
+
+    /// @brief Copy what is left, with commits (and so pack appends) held off
+    [[nodiscard]] std::expected<void, CacheError> complete_copy() {
+        std::lock_guard lock(db_mutex_);
+        int rc = sqlite3_backup_step(copy_->backup, -1);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("Cache copy failed: {}", sqlite3_errstr(rc));
+            return std::unexpected(sqlite_to_cache_error(rc));
+        }
+        while (pack_) {
+            auto more = copy_pack(std::numeric_limits<uint64_t>::max());
+            if (!more) {
+                return std::unexpected(more.error());
+            }
+            if (!*more) {
+                break;
+            }
+        }
+        sqlite3_backup_finish(std::exchange(copy_->backup, nullptr));
+        sqlite3_close(std::exchange(copy_->db, nullptr));
+        return {};
+    }
+
+    void end_copy() {
+        if (copy_->holds_compaction) {
+            compaction_queued_ = false;
+            schedule_compaction();
+        }
+        copy_.reset();
+    }
+
+    /// @brief Run a batched job on the worker thread at background priority
+    /// @param step Processes one batch; returns whether work remains
+    /// @param done Called once with the outcome
+    ///
+    /// Each batch is queued as its own task, so gets and puts queued while a
+    /// job runs are served between its batches.
+    void enqueue_idle_job(std::function<std::expected<bool, CacheError>()> step,
+                          std::function<void(std::expected<void, CacheError>)> done) {
+        enqueue_task([this, step = std::move(step), done = std::move(done)]() mutable {
+            std::expected<bool, CacheError> more;
+            {
+                BackgroundPriority priority;
+                more = step();
+            }
+            if (more && *more) {
+                enqueue_idle_job(std::move(step), std::move(done));
+                return;
+            }
+            done(more ? std::expected<void, CacheError>{} : std::unexpected(more.error()));
+        });
+    }
+
+    /// @brief Delete rows (and pack payloads) in one transaction
+    /// @return Number of rows deleted
+    ///
+    /// Caller must hold db_mutex_.
+    uint64_t delete_keys(const std::vector<std::string>& keys) {
+        if (keys.empty()) {
+            return 0;
+        }
+
+        uint64_t count = 0;
+        sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+        std::vector<std::string> payload_keys;
+        if (pack_) {
+            payload_keys = payload_keys_for(keys);
+        }
+        for (const auto& key : keys) {
+            stmt_remove_.reset();
+            sqlite3_bind_text(stmt_remove_, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt_remove_) == SQLITE_DONE && sqlite3_changes(db_) > 0) {
+                ++count;
+            }
+        }
+        if (pack_) {
+            release_pack_payloads(payload_keys);
+        }
+        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        schedule_compaction();
+        return count;
+    }
+
+    /// @brief Delete every row for the given sources except their current keys
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    remove_stale(const std::vector<StaleSource>& sources) {
+        std::lock_guard lock(db_mutex_);
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
+        std::vector<std::string> keys;
+        for (const auto& source : sources) {
+            // "archive|entry" rows sort between "archive|" and "archive}"
+            std::string entries_begin = source.source_path + '|';
+            std::string entries_end = source.source_path + '}';
+
+            stmt_select_by_source_.reset();
+            sqlite3_bind_text(stmt_select_by_source_, 1, source.source_path.c_str(), -1,
+                              SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt_select_by_source_, 2, entries_begin.c_str(), -1,
+                              SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt_select_by_source_, 3, entries_end.c_str(), -1,
+                              SQLITE_TRANSIENT);
+            while (sqlite3_step(stmt_select_by_source_) == SQLITE_ROW) {
+                const char* key =
+                    reinterpret_cast<const char*>(sqlite3_column_text(stmt_select_by_source_, 0));
+                // Mipmap levels of the kept row share its key as prefix
+                if (key && (source.keep_key.empty() ||
+                            !std::string_view(key).starts_with(source.keep_key))) {
+                    keys.emplace_back(key);
+                }
+            }
+        }
+        stmt_select_by_source_.reset();
+
+        return delete_keys(keys);
+    }
+
+    /// @brief Rekey the rows of moved sources, deleting those whose contents changed
+    /// @return Number of rows rekeyed
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    rekey_sources(const std::vector<MovedSource>& moves) {
+        // Queued writes for the old paths are moved with the rest
+        flush_pending_writes();
+
+        struct Row {
+            std::string key;
+            std::string source_path;
+            const MovedSource* move;
+        };
+        std::vector<Row> rows;
+        {
+            std::lock_guard lock(db_mutex_);
+            if (auto guard = ensureOpen(); !guard)
+                return std::unexpected(guard.error());
+
+            for (const auto& move : moves) {
+                // Files inside a directory sort between "dir\" and "dir]",
+                // entries of an archive between "archive|" and "archive}"
+                std::string children_begin = move.old_path + '\\';
+                std::string children_end = move.old_path + ']';
+                std::string entries_begin = move.old_path + '|';
+                std::string entries_end = move.old_path + '}';
+
+                stmt_select_moved_.reset();
+                sqlite3_bind_text(stmt_select_moved_, 1, move.old_path.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt_select_moved_, 2, children_begin.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt_select_moved_, 3, children_end.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt_select_moved_, 4, entries_begin.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt_select_moved_, 5, entries_end.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+                while (sqlite3_step(stmt_select_moved_) == SQLITE_ROW) {
+                    const char* key =
+                        reinterpret_cast<const char*>(sqlite3_column_text(stmt_select_moved_, 0));
+                    const char* source =
+                        reinterpret_cast<const char*>(sqlite3_column_text(stmt_select_moved_, 1));
+                    if (key && source) {
+                        rows.push_back({key, source, &move});
+                    }
+                }
+            }
+            stmt_select_moved_.reset();
+        }
+        if (rows.empty()) {
+            return 0;
+        }
+
+        // Keys for the new paths, from one stat per file on disk
+        std::map<std::wstring, std::optional<SourceStamp>> stamps;
+        struct Rekey {
+            const std::string* old_key;
+            std::string new_key;
+            std::string new_source;
+        };
+        std::vector<Rekey> rekeyed;
+        std::vector<std::string> stale;
+        for (const auto& row : rows) {
+            std::string new_source =
+                row.move->new_path + row.source_path.substr(row.move->old_path.size());
+            auto new_path = utf8ToPath(new_source);
+            auto file = archive::VirtualPath::parse(new_path.wstring()).file_path();
+            auto [it, inserted] = stamps.try_emplace(file.wstring());
+            if (inserted) {
+                it->second = statSource(file);
+            }
+            if (!it->second) {
+                continue;  // Not there (yet); left to invalidation and the orphan sweep
+            }
+
+            // Mipmap levels ("key@size") share their row's key as prefix
+            const auto& stamp = *it->second;
+            auto old_key =
+                generateCacheKey(utf8ToPath(row.source_path), stamp.mtime, stamp.size_bytes);
+            if (!row.key.starts_with(old_key)) {
+                stale.push_back(row.key);  // Contents changed along with the path
+                continue;
+            }
+            auto new_key = generateCacheKey(new_path, stamp.mtime, stamp.size_bytes) +
+                           row.key.substr(old_key.size());
+            rekeyed.push_back({&row.key, std::move(new_key), std::move(new_source)});
+        }
+
+        std::lock_guard lock(db_mutex_);
+        if (auto guard = ensureOpen(); !guard)
+            return std::unexpected(guard.error());
+
         uint64_t count = 0;
-        if (sqlite3_step(stmt_count_) == SQLITE_ROW) {
-            count = static_cast<uint64_t>(sqlite3_column_int64(stmt_count_, 0));
+        sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+        for (const auto& rekey : rekeyed) {
+            stmt_rekey_.reset();
+            sqlite3_bind_text(stmt_rekey_, 1, rekey.old_key->c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt_rekey_, 2, rekey.new_key.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt_rekey_, 3, rekey.new_source.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt_rekey_) == SQLITE_DONE && sqlite3_changes(db_) > 0) {
+                ++count;
+            } else {
+                stale.push_back(*rekey.old_key);  // The new path already has a row
+            }
         }
+        stmt_rekey_.reset();
+        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
 
-        // Then clear
-        stmt_clear_.reset();
-        int rc = sqlite3_step(stmt_clear_);
-        if (rc != SQLITE_DONE) {
-            return std::unexpected(sqlite_to_cache_error(rc));
+        delete_keys(stale);
+        return count;
+    }
+
+    /// @brief Examine the next batch of rows and delete those whose source is gone
+    /// @return Whether rows remain to be examined
+    ///
+    /// The file system is queried without db_mutex_ held.
+    [[nodiscard]] std::expected<bool, CacheError> sweep_orphans_batch(OrphanSweep& sweep) {
+        std::vector<std::pair<std::string, std::string>> rows;  // cache_key, source_path
+        {
+            std::lock_guard lock(db_mutex_);
+            if (auto guard = ensureOpen(); !guard)
+                return std::unexpected(guard.error());
+
+            stmt_orphan_batch_.reset();
+            sqlite3_bind_int64(stmt_orphan_batch_, 1, sweep.last_rowid);
+            sqlite3_bind_int(stmt_orphan_batch_, 2, kMaintenanceBatchSize);
+
+            int rc;
+            while ((rc = sqlite3_step(stmt_orphan_batch_)) == SQLITE_ROW) {
+                sweep.last_rowid = sqlite3_column_int64(stmt_orphan_batch_, 0);
+                const char* cache_key =
+                    reinterpret_cast<const char*>(sqlite3_column_text(stmt_orphan_batch_, 1));
+                const char* source_path =
+                    reinterpret_cast<const char*>(sqlite3_column_text(stmt_orphan_batch_, 2));
+                if (cache_key && source_path) {
+                    rows.emplace_back(cache_key, source_path);
+                }
+            }
+            if (rc != SQLITE_DONE) {
+                return std::unexpected(sqlite_to_cache_error(rc));
+            }
+        }
+        if (rows.empty()) {
+            return false;
         }
 
-        return count;
+        auto orphans = find_orphans(rows);
+        if (!orphans.empty()) {
+            std::lock_guard lock(db_mutex_);
+            if (auto guard = ensureOpen(); !guard)
+                return std::unexpected(guard.error());
+            sweep.removed += delete_keys(orphans);
+        }
+        return rows.size() == static_cast<size_t>(kMaintenanceBatchSize);
     }
 
-    [[nodiscard]] std::expected<void, CacheError> vacuum() {
-        std::lock_guard lock(db_mutex_);
+    /// @brief Delete up to one batch of the least recently read entries
+    ///
+    /// A sweep that finds the cache within its limits stops at once. One that
+    /// finds a limit exceeded keeps deleting until the cache is below
+    /// kEvictionLowWater of both.
+    /// @return Whether the sweep has more to delete
+    [[nodiscard]] std::expected<bool, CacheError> evict_batch(EvictionSweep& sweep) {
+        if (!sweep.started) {
+            flush_pending_writes();  // Order by current access times
+        }
 
+        std::lock_guard lock(db_mutex_);
         if (auto guard = ensureOpen(); !guard)
             return std::unexpected(guard.error());
 
-        int rc = sqlite3_exec(db_, "VACUUM;", nullptr, nullptr, nullptr);
-        if (rc != SQLITE_OK) {
+        stmt_get_stats_.reset();
+        int rc = sqlite3_step(stmt_get_stats_);
+        if (rc != SQLITE_ROW) {
             return std::unexpected(sqlite_to_cache_error(rc));
         }
+        auto entries = static_cast<uint64_t>(sqlite3_column_int64(stmt_get_stats_, 0));
+        auto bytes = static_cast<uint64_t>(sqlite3_column_int64(stmt_get_stats_, 1));
+        stmt_get_stats_.reset();
 
-        return {};
-    }
+        if (!sweep.started) {
+            if (entries <= sweep.max_entries && bytes <= sweep.max_size_bytes) {
+                return false;
+            }
+            sweep.started = true;
+        }
+        auto target_entries =
+            static_cast<uint64_t>(static_cast<double>(sweep.max_entries) * kEvictionLowWater);
+        auto target_bytes =
+            static_cast<uint64_t>(static_cast<double>(sweep.max_size_bytes) * kEvictionLowWater);
+        auto over = [&] { return entries > target_entries || bytes > target_bytes; };
+        if (!over()) {
+            return false;
+        }
 
-    // Async operations
+        std::vector<std::string> keys;
+        stmt_oldest_.reset();
+        sqlite3_bind_int(stmt_oldest_, 1, kMaintenanceBatchSize);
+        while (over() && sqlite3_step(stmt_oldest_) == SQLITE_ROW) {
+            const char* key = reinterpret_cast<const char*>(sqlite3_column_text(stmt_oldest_, 0));
+            auto size = static_cast<uint64_t>(sqlite3_column_int64(stmt_oldest_, 1));
+            if (key) {
+                keys.emplace_back(key);
+                --entries;
+                bytes -= std::min(bytes, size);
+            }
+        }
+        stmt_oldest_.reset();
 
-    void getAsync(const std::string& key, AsyncCallback<ThumbnailEntry> callback) {
-        enqueue_task([this, key, callback = std::move(callback)]() { callback(get(key)); });
+        if (keys.empty()) {
+            return false;
+        }
+        uint64_t deleted = delete_keys(keys);
+        sweep.removed += deleted;
+        return deleted > 0 && over();
     }
 
-    void putAsync(ThumbnailEntry entry, AsyncCallback<void> callback) {
-        enqueue_task([this, entry = std::move(entry), callback = std::move(callback)]() {
-            callback(put(entry));
-        });
+    /// @brief Start over when the database was last used with the other backend
+    ///
+    /// The backend is recorded in PRAGMA user_version. Metadata rows whose
+    /// payloads live in the other store would otherwise be unreadable.
+    bool check_storage_backend() {
+        int stored = user_version();
+        int current = static_cast<int>(backend_);
+        if (stored == current) {
+            return true;
+        }
+
+        LOG_INFO("Cache storage backend changed ({} -> {}), clearing cache", stored, current);
+        std::string sql = "DELETE FROM thumbnails; DELETE FROM thumbnail_payloads; "
+                          "PRAGMA user_version = " +
+                          std::to_string(current) + ";";
+        char* err_msg = nullptr;
+        if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+            LOG_ERROR("Failed to reset cache for storage backend: {}",
+                      err_msg ? err_msg : "unknown error");
+            sqlite3_free(err_msg);
+            return false;
+        }
+        if (pack_) {
+            return pack_->clear().has_value();
+        }
+        return true;
     }
 
-    void removeAsync(const std::string& key, AsyncCallback<void> callback) {
-        enqueue_task([this, key, callback = std::move(callback)]() { callback(remove(key)); });
+    /// @brief PRAGMA user_version, which records the storage backend
+    [[nodiscard]] int user_version() const {
+        int version = 0;
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                version = sqlite3_column_int(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+        }
+        return version;
     }
 
-private:
     [[nodiscard]] std::expected<void, CacheError> ensureOpen() const {
         if (!db_) {
             return std::unexpected(CacheError::DatabaseError);
@@ -584,12 +2641,74 @@ private:
                 source_mtime INTEGER NOT NULL,
                 cached_at INTEGER NOT NULL,
                 data_size INTEGER NOT NULL,
-                pixel_data BLOB NOT NULL
+                payload_key TEXT NOT NULL,
+                perceptual_hash INTEGER,
+                average_color INTEGER,
+                accessed_at INTEGER NOT NULL DEFAULT 0
             );
 
             CREATE INDEX IF NOT EXISTS idx_file_hash ON thumbnails(file_hash);
             CREATE INDEX IF NOT EXISTS idx_cached_at ON thumbnails(cached_at);
+            CREATE INDEX IF NOT EXISTS idx_accessed_at ON thumbnails(accessed_at);
             CREATE INDEX IF NOT EXISTS idx_source_path ON thumbnails(source_path);
+            CREATE INDEX IF NOT EXISTS idx_payload_key ON thumbnails(payload_key);
+
+            -- Pixel payloads live apart from the metadata, so existence,
+            -- resolution and stats queries never read BLOB pages. A payload
+            -- is keyed by its row's cache_key, or by a content fingerprint
+            -- when identical files share it.
+            CREATE TABLE IF NOT EXISTS thumbnail_payloads (
+                payload_key TEXT PRIMARY KEY,
+                payload_format INTEGER NOT NULL DEFAULT 0,
+                pixel_data BLOB NOT NULL
+            );
+
+            CREATE TRIGGER IF NOT EXISTS thumbnails_delete_payload
+            AFTER DELETE ON thumbnails BEGIN
+                DELETE FROM thumbnail_payloads WHERE payload_key = OLD.payload_key
+                    AND NOT EXISTS (SELECT 1 FROM thumbnails WHERE payload_key = OLD.payload_key);
+            END;
+
+            CREATE TABLE IF NOT EXISTS zstd_dictionaries (
+                dict_id INTEGER PRIMARY KEY,
+                data BLOB NOT NULL,
+                created_at INTEGER NOT NULL
+            );
+
+            -- Entry listings of archives, so an unchanged archive is listed
+            -- without reading its headers. Valid while write_time and
+            -- file_size match the archive.
+            CREATE TABLE IF NOT EXISTS archive_listings (
+                archive_path TEXT PRIMARY KEY,
+                write_time INTEGER NOT NULL,
+                file_size INTEGER NOT NULL,
+                listing BLOB NOT NULL,
+                cached_at INTEGER NOT NULL
+            );
+
+            -- Sorted listings of recently visited directories, shown on a
+            -- revisit while a fresh scan revalidates them. Keyed by the
+            -- filter and sort order they were listed with.
+            CREATE TABLE IF NOT EXISTS directory_listings (
+                directory_path TEXT NOT NULL,
+                options INTEGER NOT NULL,
+                write_time INTEGER NOT NULL,
+                listing BLOB NOT NULL,
+                cached_at INTEGER NOT NULL,
+                PRIMARY KEY (directory_path, options)
+            );
+
+            -- EXIF capture date and camera of sources, under their thumbnail
+            -- cache key, so a record is valid exactly as long as a thumbnail
+            -- of the same file would be (NULL date: none recorded)
+            CREATE TABLE IF NOT EXISTS capture_info (
+                cache_key TEXT PRIMARY KEY,
+                date_taken INTEGER,
+                camera_model TEXT NOT NULL,
+                cached_at INTEGER NOT NULL
+            );
+
+            CREATE TEMP TABLE IF NOT EXISTS prefetch_keys (cache_key TEXT NOT NULL);
         )";
 
         char* err_msg = nullptr;
@@ -603,6 +2722,24 @@ private:
         return true;
     }
 
+    /// @brief Register every stored zstd dictionary with the codec
+    ///
+    /// All of them stay loaded: older rows still name the dictionary they
+    /// were compressed with.
+    void load_dictionaries() {
+        SqliteStatement stmt;
+        if (!stmt.prepare(db_, "SELECT data FROM zstd_dictionaries ORDER BY dict_id;")) {
+            return;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+            int blob_size = sqlite3_column_bytes(stmt, 0);
+            if (blob && blob_size > 0) {
+                codec_.addDictionary(std::span(blob, static_cast<size_t>(blob_size)));
+            }
+        }
+    }
+
     bool check_and_migrate_schema() {
         // Create schema_version table if not exists
         const char* create_version_table = R"(
@@ -639,8 +2776,11 @@ private:
         LOG_INFO("Cache schema version {} -> {}, clearing old cache", current_version,
                  CURRENT_SCHEMA_VERSION);
 
-        // Drop old thumbnails table if exists (cache invalidation)
-        rc = sqlite3_exec(db_, "DROP TABLE IF EXISTS thumbnails;", nullptr, nullptr, &err_msg);
+        // Drop old thumbnails tables if they exist (cache invalidation)
+        rc = sqlite3_exec(db_,
+                          "DROP TABLE IF EXISTS thumbnails; "
+                          "DROP TABLE IF EXISTS thumbnail_payloads;",
+                          nullptr, nullptr, &err_msg);
         if (rc != SQLITE_OK) {
             LOG_ERROR("Failed to drop old thumbnails table: {}",
                       err_msg ? err_msg : "unknown error");
@@ -670,26 +2810,23 @@ private:
     }
 
     bool prepare_statements() {
-        // Get full entry
-        if (!stmt_get_.prepare(
+        // Lookups by key run on the reader connections (ReaderConnection)
+
+        // Any row sharing a content payload
+        if (!stmt_get_content_.prepare(
                 db_,
-                "SELECT source_path, file_hash, width, height, original_width, original_height, "
-                "source_mtime, cached_at, data_size, pixel_data "
-                "FROM thumbnails WHERE cache_key = ?;")) {
+                "SELECT t.source_path, t.file_hash, t.width, t.height, t.original_width, "
+                "t.original_height, t.source_mtime, t.cached_at, t.data_size, t.payload_key, "
+                "t.perceptual_hash, t.average_color, p.pixel_data, p.payload_format "
+                "FROM thumbnails t JOIN thumbnail_payloads p ON p.payload_key = t.payload_key "
+                "WHERE t.payload_key = ? LIMIT 1;")) {
             return false;
         }
-
-        // Get metadata only
-        if (!stmt_get_metadata_.prepare(
+        if (!stmt_get_content_metadata_.prepare(
                 db_,
                 "SELECT source_path, file_hash, width, height, original_width, original_height, "
-                "source_mtime, cached_at, data_size "
-                "FROM thumbnails WHERE cache_key = ?;")) {
-            return false;
-        }
-
-        // Check exists
-        if (!stmt_exists_.prepare(db_, "SELECT COUNT(*) FROM thumbnails WHERE cache_key = ?;")) {
+                "source_mtime, cached_at, data_size, payload_key, perceptual_hash, "
+                "average_color FROM thumbnails WHERE payload_key = ? LIMIT 1;")) {
             return false;
         }
 
@@ -697,9 +2834,31 @@ private:
         if (!stmt_put_.prepare(db_,
                                "INSERT OR REPLACE INTO thumbnails "
                                "(cache_key, source_path, file_hash, width, height, original_width, "
-                               "original_height, "
-                               "source_mtime, cached_at, data_size, pixel_data) "
-                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);")) {
+                               "original_height, source_mtime, cached_at, data_size, payload_key, "
+                               "perceptual_hash, average_color, accessed_at) "
+                               "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, "
+                               "?9);")) {
+            return false;
+        }
+        if (!stmt_put_payload_.prepare(
+                db_, "INSERT OR REPLACE INTO thumbnail_payloads "
+                     "(payload_key, payload_format, pixel_data) VALUES (?, ?, ?);")) {
+            return false;
+        }
+        // A shared payload already stored for the same content is kept as is
+        if (!stmt_put_shared_payload_.prepare(
+                db_, "INSERT OR IGNORE INTO thumbnail_payloads "
+                     "(payload_key, payload_format, pixel_data) VALUES (?, ?, ?);")) {
+            return false;
+        }
+
+        // Payload references (pack backend: payloads are released by hand)
+        if (!stmt_payload_key_.prepare(db_,
+                                       "SELECT payload_key FROM thumbnails WHERE cache_key = ?;")) {
+            return false;
+        }
+        if (!stmt_payload_refs_.prepare(
+                db_, "SELECT 1 FROM thumbnails WHERE payload_key = ? LIMIT 1;")) {
             return false;
         }
 
@@ -713,8 +2872,50 @@ private:
             return false;
         }
 
-        // Get all paths (for orphan detection)
-        if (!stmt_get_all_paths_.prepare(db_, "SELECT cache_key, source_path FROM thumbnails;")) {
+        // Orphan detection, one rowid range at a time
+        if (!stmt_orphan_batch_.prepare(db_, "SELECT rowid, cache_key, source_path FROM thumbnails "
+                                             "WHERE rowid > ? ORDER BY rowid LIMIT ?;")) {
+            return false;
+        }
+
+        // Least recently read entries first (eviction)
+        if (!stmt_oldest_.prepare(
+                db_, "SELECT cache_key, data_size FROM thumbnails ORDER BY accessed_at LIMIT ?;")) {
+            return false;
+        }
+
+        // Record a read; rows read recently are left alone to save page writes
+        if (!stmt_touch_.prepare(db_, "UPDATE thumbnails SET accessed_at = ?1 "
+                                      "WHERE cache_key = ?2 AND accessed_at < ?3;")) {
+            return false;
+        }
+
+        // Rows for a source path and the archive entries inside it
+        if (!stmt_select_by_source_.prepare(
+                db_, "SELECT cache_key FROM thumbnails WHERE source_path = ?1 "
+                     "OR (source_path >= ?2 AND source_path < ?3);")) {
+            return false;
+        }
+
+        // Rows for a moved source, files inside it and its archive entries
+        if (!stmt_select_moved_.prepare(
+                db_, "SELECT cache_key, source_path FROM thumbnails WHERE source_path = ?1 "
+                     "OR (source_path >= ?2 AND source_path < ?3) "
+                     "OR (source_path >= ?4 AND source_path < ?5);")) {
+            return false;
+        }
+
+        if (!stmt_rekey_.prepare(db_, "UPDATE OR IGNORE thumbnails "
+                                      "SET cache_key = ?2, file_hash = ?2, source_path = ?3 "
+                                      "WHERE cache_key = ?1;")) {
+            return false;
+        }
+
+        // Perceptual hashes, one per source (SQLite takes the bare column from
+        // the row holding MAX)
+        if (!stmt_perceptual_hashes_.prepare(
+                db_, "SELECT source_path, perceptual_hash, MAX(cached_at) FROM thumbnails "
+                     "WHERE perceptual_hash IS NOT NULL GROUP BY source_path;")) {
             return false;
         }
 
@@ -736,6 +2937,24 @@ private:
             return false;
         }
 
+        // Staged keys for capture info lookups
+        if (!stmt_prefetch_insert_.prepare(db_, kPrefetchInsertSql)) {
+            return false;
+        }
+
+        // Capture info: staged keys joined the same way
+        if (!stmt_capture_select_.prepare(
+                db_, "SELECT c.cache_key, c.date_taken, c.camera_model "
+                     "FROM temp.prefetch_keys k JOIN capture_info c ON c.cache_key = k.cache_key "
+                     "ORDER BY k.rowid;")) {
+            return false;
+        }
+        if (!stmt_capture_insert_.prepare(
+                db_, "INSERT OR REPLACE INTO capture_info "
+                     "(cache_key, date_taken, camera_model, cached_at) VALUES (?, ?, ?, ?);")) {
+            return false;
+        }
+
         return true;
     }
 
@@ -780,23 +2999,62 @@ private:
     }
 
     std::filesystem::path db_path_;
-    int compression_level_ = 3;
+    StorageBackend backend_;
+    SqliteTuning tuning_;
+    PayloadCodec codec_;
+    bool read_only_ = false;  // Opened by openReadOnly(): lookups only
     sqlite3* db_ = nullptr;
 
+    // Payload store for StorageBackend::PackFile (declared before the worker,
+    // so a running compaction finishes before the store is destroyed)
+    std::unique_ptr<PackStore> pack_;
+    std::atomic<bool> compaction_queued_{false};
+
+    /// @brief Copy made by startCopy() until finishCopy() or cancelCopy()
+    struct Copy {
+        std::filesystem::path destination;
+        std::filesystem::path partial;  // Written until renamed to destination
+        sqlite3* db = nullptr;          // Of partial
+        sqlite3_backup* backup = nullptr;
+        bool pages_done = false;        // The backup has caught up once
+        uint64_t pack_generation = 0;   // Pack generation being copied
+        uint64_t pack_copied = 0;       // Bytes of it copied
+        bool holds_compaction = false;  // Set compaction_queued_ to keep compaction off
+    };
+
+    // Used by the one thread making a copy; the backup only under db_mutex_
+    std::optional<Copy> copy_;
+
     // Prepared statements
-    SqliteStatement stmt_get_;
-    SqliteStatement stmt_get_metadata_;
-    SqliteStatement stmt_exists_;
     SqliteStatement stmt_put_;
+    SqliteStatement stmt_put_payload_;
+    SqliteStatement stmt_put_shared_payload_;
+    SqliteStatement stmt_payload_key_;
+    SqliteStatement stmt_payload_refs_;
+    SqliteStatement stmt_get_content_;
+    SqliteStatement stmt_get_content_metadata_;
     SqliteStatement stmt_remove_;
     SqliteStatement stmt_remove_older_than_;
-    SqliteStatement stmt_get_all_paths_;
+    SqliteStatement stmt_orphan_batch_;
+    SqliteStatement stmt_oldest_;
+    SqliteStatement stmt_touch_;
+    SqliteStatement stmt_select_by_source_;
+    SqliteStatement stmt_select_moved_;
+    SqliteStatement stmt_rekey_;
     SqliteStatement stmt_get_stats_;
+    SqliteStatement stmt_perceptual_hashes_;
     SqliteStatement stmt_clear_;
     SqliteStatement stmt_count_;
+    SqliteStatement stmt_prefetch_insert_;
+    SqliteStatement stmt_capture_select_;
+    SqliteStatement stmt_capture_insert_;
+
+    // Mutex for the writer connection (counts contention for lockStats())
+    InstrumentedMutex db_mutex_;
 
-    // Mutex for database access
-    std::mutex db_mutex_;
+    // Idle reader connections; one is opened per concurrent reader
+    std::vector<std::unique_ptr<ReaderConnection>> reader_pool_;
+    std::mutex reader_mutex_;
 
     // Async task queue
     std::queue<std::function<void()>> task_queue_;
@@ -804,28 +3062,70 @@ private:
     std::condition_variable cv_;
     std::jthread worker_;
     std::atomic<bool> running_;
+
+    // Write-behind queue (lock order: db_mutex_ before write_mutex_)
+    std::vector<PendingWrite> write_queue_;
+    std::vector<PendingWrite> committing_;  // Batch being committed; swapped under write_mutex_
+    std::mutex write_mutex_;
+    std::condition_variable write_cv_;  // Writer: new work or shutdown
+    std::condition_variable space_cv_;  // Producers: queue drained below the limit
+    std::unordered_set<std::string> pending_access_;  // Keys read since the last commit
+    bool writer_stopping_ = false;
+    std::jthread writer_;
+
+    // Background WAL checkpoints, signalled from commits by on_wal_commit
+    std::mutex checkpoint_mutex_;
+    std::condition_variable_any checkpoint_cv_;
+    bool checkpoint_requested_ = false;
+    std::jthread checkpointer_;
 };
 
 // Public interface
 
 std::expected<std::unique_ptr<CacheDatabase>, CacheError>
-CacheDatabase::open(const std::filesystem::path& path, int compression_level) {
-    // If path is a directory, append the database filename
+CacheDatabase::open(const std::filesystem::path& path, const PayloadOptions& payload_options,
+                    StorageBackend backend, const SqliteTuning& tuning) {
+    auto db = std::unique_ptr<CacheDatabase>(new CacheDatabase());
+    db->impl_ = std::make_unique<Impl>(filePath(path), payload_options, backend, tuning);
+
+    if (!db->impl_->initialize()) {
+        return std::unexpected(CacheError::DatabaseError);
+    }
+    db->impl_->scheduleDictionaryTraining();
+
+    return db;
+}
+
+std::expected<std::unique_ptr<CacheDatabase>, CacheError>
+CacheDatabase::openReadOnly(const std::filesystem::path& path, const SqliteTuning& tuning) {
+    std::error_code ec;
     std::filesystem::path db_path = path;
-    if (std::filesystem::is_directory(path) || !path.has_extension()) {
+    if (std::filesystem::is_directory(path, ec) || !path.has_extension()) {
         db_path = path / "thumbnails.db";
     }
+    if (!std::filesystem::is_regular_file(db_path, ec)) {
+        return std::unexpected(CacheError::NotFound);
+    }
 
+    // Dictionaries come from the database; nothing is trained or encoded
     auto db = std::unique_ptr<CacheDatabase>(new CacheDatabase());
-    db->impl_ = std::make_unique<Impl>(db_path, compression_level);
+    db->impl_ = std::make_unique<Impl>(db_path, PayloadOptions{}, StorageBackend::Sqlite, tuning,
+                                       /*read_only=*/true);
 
     if (!db->impl_->initialize()) {
         return std::unexpected(CacheError::DatabaseError);
     }
-
     return db;
 }
 
+std::filesystem::path CacheDatabase::filePath(const std::filesystem::path& path) {
+    // If path is a directory, append the database filename
+    if (std::filesystem::is_directory(path) || !path.has_extension()) {
+        return path / "thumbnails.db";
+    }
+    return path;
+}
+
 CacheDatabase::CacheDatabase() = default;
 CacheDatabase::~CacheDatabase() = default;
 
@@ -838,18 +3138,41 @@ const std::filesystem::path& CacheDatabase::path() const noexcept {
     return impl_ ? impl_->path() : empty;
 }
 
+LockStats CacheDatabase::lockStats() const noexcept {
+    return impl_ ? impl_->lockStats() : LockStats{};
+}
+
+void CacheDatabase::resetLockStats() noexcept {
+    if (impl_)
+        impl_->resetLockStats();
+}
+
 std::expected<ThumbnailEntry, CacheError> CacheDatabase::get(const std::string& key) {
     if (!impl_)
         return std::unexpected(CacheError::DatabaseError);
     return impl_->get(key);
 }
 
+std::expected<std::vector<ThumbnailEntry>, CacheError>
+CacheDatabase::getMany(const std::vector<std::string>& keys, uint64_t max_bytes) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getMany(keys, max_bytes);
+}
+
 std::expected<ThumbnailMetadata, CacheError> CacheDatabase::getMetadata(const std::string& key) {
     if (!impl_)
         return std::unexpected(CacheError::DatabaseError);
     return impl_->getMetadata(key);
 }
 
+std::expected<std::vector<ThumbnailMetadata>, CacheError>
+CacheDatabase::getMetadataMany(const std::vector<std::string>& keys) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getMetadataMany(keys);
+}
+
 bool CacheDatabase::exists(const std::string& key) {
     return impl_ && impl_->exists(key);
 }
@@ -860,6 +3183,24 @@ std::expected<void, CacheError> CacheDatabase::put(const ThumbnailEntry& entry)
     return impl_->put(entry);
 }
 
+std::expected<void, CacheError> CacheDatabase::putDeferred(const ThumbnailEntry& entry) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->putDeferred(entry);
+}
+
+void CacheDatabase::flush() {
+    if (impl_)
+        impl_->flush();
+}
+
+std::expected<ThumbnailEntry, CacheError>
+CacheDatabase::linkContent(const ThumbnailMetadata& metadata) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->linkContent(metadata);
+}
+
 std::expected<void, CacheError> CacheDatabase::remove(const std::string& key) {
     if (!impl_)
         return std::unexpected(CacheError::DatabaseError);
@@ -879,6 +3220,36 @@ std::expected<uint64_t, CacheError> CacheDatabase::removeOrphaned() {
     return impl_->removeOrphaned();
 }
 
+void CacheDatabase::removeOrphanedAsync(AsyncCallback<uint64_t> callback) {
+    if (!impl_) {
+        callback(std::unexpected(CacheError::DatabaseError));
+        return;
+    }
+    impl_->removeOrphanedAsync(std::move(callback));
+}
+
+std::expected<uint64_t, CacheError> CacheDatabase::evictOldest(uint64_t max_entries,
+                                                               uint64_t max_size_bytes) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->evictOldest(max_entries, max_size_bytes);
+}
+
+void CacheDatabase::evictOldestAsync(uint64_t max_entries, uint64_t max_size_bytes,
+                                     AsyncCallback<uint64_t> callback) {
+    if (!impl_) {
+        callback(std::unexpected(CacheError::DatabaseError));
+        return;
+    }
+    impl_->evictOldestAsync(max_entries, max_size_bytes, std::move(callback));
+}
+
+std::expected<std::vector<SourceHash>, CacheError> CacheDatabase::getPerceptualHashes() {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getPerceptualHashes();
+}
+
 std::expected<CacheStats, CacheError> CacheDatabase::getStats() {
     if (!impl_)
         return std::unexpected(CacheError::DatabaseError);
@@ -891,12 +3262,87 @@ std::expected<uint64_t, CacheError> CacheDatabase::clear() {
     return impl_->clear();
 }
 
+std::expected<std::vector<uint8_t>, CacheError>
+CacheDatabase::getArchiveListing(const std::string& archive_path, uint64_t write_time,
+                                 uint64_t file_size) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getArchiveListing(archive_path, write_time, file_size);
+}
+
+std::expected<void, CacheError> CacheDatabase::putArchiveListing(const std::string& archive_path,
+                                                                 uint64_t write_time,
+                                                                 uint64_t file_size,
+                                                                 std::span<const uint8_t> listing) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->putArchiveListing(archive_path, write_time, file_size, listing);
+}
+
+std::expected<StoredListing, CacheError>
+CacheDatabase::getDirectoryListing(const std::string& directory_path, uint32_t options) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getDirectoryListing(directory_path, options);
+}
+
+std::expected<void, CacheError>
+CacheDatabase::putDirectoryListing(const std::string& directory_path, uint32_t options,
+                                   const StoredListing& listing) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->putDirectoryListing(directory_path, options, listing);
+}
+
+std::expected<std::vector<CaptureRecord>, CacheError>
+CacheDatabase::getCaptureInfoMany(const std::vector<std::string>& keys) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->getCaptureInfoMany(keys);
+}
+
+std::expected<void, CacheError>
+CacheDatabase::putCaptureInfoMany(std::span<const CaptureRecord> records) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->putCaptureInfoMany(records);
+}
+
 std::expected<void, CacheError> CacheDatabase::vacuum() {
     if (!impl_)
         return std::unexpected(CacheError::DatabaseError);
     return impl_->vacuum();
 }
 
+std::expected<void, CacheError> CacheDatabase::startCopy(const std::filesystem::path& destination) {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->startCopy(destination);
+}
+
+std::expected<bool, CacheError> CacheDatabase::copyStep() {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->copyStep();
+}
+
+std::expected<void, CacheError> CacheDatabase::finishCopy() {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->finishCopy();
+}
+
+void CacheDatabase::cancelCopy() {
+    if (impl_)
+        impl_->cancelCopy();
+}
+
+std::expected<uint32_t, CacheError> CacheDatabase::trainDictionary() {
+    if (!impl_)
+        return std::unexpected(CacheError::DatabaseError);
+    return impl_->trainDictionary();
+}
+
 void CacheDatabase::getAsync(const std::string& key, AsyncCallback<ThumbnailEntry> callback) {
     if (!impl_) {
         callback(std::unexpected(CacheError::DatabaseError));
@@ -921,4 +3367,46 @@ void CacheDatabase::removeAsync(const std::string& key, AsyncCallback<void> call
     impl_->removeAsync(key, std::move(callback));
 }
 
+Task<std::expected<ThumbnailEntry, CacheError>> CacheDatabase::getAsync(std::string key) {
+    co_return co_await awaitCallback<std::expected<ThumbnailEntry, CacheError>>(
+        [this, &key](auto done) { getAsync(key, std::move(done)); });
+}
+
+Task<std::expected<void, CacheError>> CacheDatabase::putAsync(ThumbnailEntry entry) {
+    co_return co_await awaitCallback<std::expected<void, CacheError>>(
+        [this, &entry](auto done) { putAsync(std::move(entry), std::move(done)); });
+}
+
+Task<std::expected<void, CacheError>> CacheDatabase::removeAsync(std::string key) {
+    co_return co_await awaitCallback<std::expected<void, CacheError>>(
+        [this, &key](auto done) { removeAsync(key, std::move(done)); });
+}
+
+void CacheDatabase::removeStaleAsync(std::vector<StaleSource> sources,
+                                     AsyncCallback<uint64_t> callback) {
+    if (!impl_) {
+        callback(std::unexpected(CacheError::DatabaseError));
+        return;
+    }
+    impl_->removeStaleAsync(std::move(sources), std::move(callback));
+}
+
+void CacheDatabase::rekeySourcesAsync(std::vector<MovedSource> moves,
+                                      AsyncCallback<uint64_t> callback) {
+    if (!impl_) {
+        callback(std::unexpected(CacheError::DatabaseError));
+        return;
+    }
+    impl_->rekeySourcesAsync(std::move(moves), std::move(callback));
+}
+
+void CacheDatabase::removeOlderThanAsync(std::chrono::system_clock::time_point older_than,
+                                         AsyncCallback<uint64_t> callback) {
+    if (!impl_) {
+        callback(std::unexpected(CacheError::DatabaseError));
+        return;
+    }
+    impl_->removeOlderThanAsync(older_than, std::move(callback));
+}
+
 }  // namespace nive::cache
@@ -11,9 +11,13 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
+#include "../util/instrumented_mutex.hpp"
+#include "../util/task.hpp"
 #include "cache_error.hpp"
+#include "payload_codec.hpp"
 #include "thumbnail_data.hpp"
 
 namespace nive::cache {
@@ -22,6 +26,18 @@ namespace nive::cache {
 template <typename T>
 using AsyncCallback = std::function<void(std::expected<T, CacheError>)>;
 
+/// @brief Cached rows to drop for a changed source file
+struct StaleSource {
+    std::string source_path;  // UTF-8; archive entries inside it match as well
+    std::string keep_key;     // Key for the file's current contents (empty = drop all)
+};
+
+/// @brief A source file or directory that was renamed or moved
+struct MovedSource {
+    std::string old_path;  // UTF-8; files and archive entries inside it move as well
+    std::string new_path;  // UTF-8
+};
+
 /// @brief SQLite-based thumbnail cache database
 ///
 /// Thread-safe database operations. Uses a dedicated I/O thread
@@ -32,14 +48,48 @@ using AsyncCallback = std::function<void(std::expected<T, CacheError>)>;
 /// - SQLite connections are not safely shareable across threads
 /// - Single thread serializes all DB access without additional locking
 /// - Callbacks deliver results to callers without requiring future::get() blocking
+///
+/// Lookups (get, getMany, getMetadata, getMetadataMany, exists) do not use
+/// the writer connection: each concurrent caller reads on its own
+/// read-only connection from a pool, which WAL lets run in parallel with
+/// each other and with the writer. Puts still queued or being committed are
+/// found before SQLite is asked, so a lookup never misses a finished put.
+///
+/// Metadata always lives in SQLite. Pixel payloads live either in a SQLite
+/// table or in a memory-mapped pack file (see PackStore), per StorageBackend.
 class CacheDatabase {
 public:
     /// @brief Open or create a cache database
     /// @param path Path to SQLite database file
-    /// @param compression_level zstd compression level (0=off, 1-19=zstd)
+    /// @param payload_options Pixel payload encoding (zstd level, JPEG quality)
+    /// @param backend Where pixel payloads are stored (metadata is always SQLite)
+    /// @param tuning Page size, mmap, page cache, checkpoint and busy settings
     /// @return Database instance or error
+    ///
+    /// Stored zstd dictionaries are loaded on open. With train_dictionary set
+    /// and none stored yet, one is trained in the background.
+    [[nodiscard]] static std::expected<std::unique_ptr<CacheDatabase>, CacheError>
+    open(const std::filesystem::path& path, const PayloadOptions& payload_options = {},
+         StorageBackend backend = StorageBackend::Sqlite, const SqliteTuning& tuning = {});
+
+    /// @brief Open an existing cache database for lookups only
+    /// @param path Path to the SQLite database file, or the directory holding thumbnails.db
+    /// @param tuning mmap and page cache settings (checkpoints do not apply)
+    /// @return Database instance; NotFound if there is no database there,
+    ///         DatabaseError if it cannot be opened or keeps its payloads in a pack file
+    ///
+    /// For a cache published on a share. SQLite opens it immutable: it takes
+    /// no locks and never looks for a WAL, so the file must not change while
+    /// open (publish a new one by replacing it). Only the lookups (get,
+    /// getMany, getMetadata, getMetadataMany, exists) may be used, and they
+    /// record no access times.
     [[nodiscard]] static std::expected<std::unique_ptr<CacheDatabase>, CacheError>
-    open(const std::filesystem::path& path, int compression_level = 3);
+    openReadOnly(const std::filesystem::path& path, const SqliteTuning& tuning = {});
+
+    /// @brief Get the database file open() uses for a path
+    /// @return path itself, or thumbnails.db inside it for a directory (or a path
+    ///         without an extension)
+    [[nodiscard]] static std::filesystem::path filePath(const std::filesystem::path& path);
 
     ~CacheDatabase();
 
@@ -58,24 +108,67 @@ public:
     // ===== Synchronous Operations =====
 
     /// @brief Get thumbnail entry by cache key
-    /// @param key Cache key (SHA256 hash)
+    /// @param key Cache key (see generateCacheKey)
     /// @return Thumbnail entry or error
     [[nodiscard]] std::expected<ThumbnailEntry, CacheError> get(const std::string& key);
 
+    /// @brief Get many entries with a single query
+    /// @param keys Cache keys, in order of preference
+    /// @param max_bytes Stop once this much pixel data has been read (0 = no limit)
+    /// @return Entries found, in key order (missing keys are skipped)
+    ///
+    /// Keys are staged in a temp table and joined against the thumbnails
+    /// table in one statement. Decompression runs in parallel after the
+    /// database lock is released.
+    [[nodiscard]] std::expected<std::vector<ThumbnailEntry>, CacheError>
+    getMany(const std::vector<std::string>& keys, uint64_t max_bytes = 0);
+
     /// @brief Get metadata only (without pixel data)
     /// @param key Cache key
     /// @return Metadata or error
     [[nodiscard]] std::expected<ThumbnailMetadata, CacheError> getMetadata(const std::string& key);
 
+    /// @brief Get metadata for many entries with a single query
+    /// @param keys Cache keys
+    /// @return Metadata found, in key order (missing keys are skipped)
+    ///
+    /// Reads only the metadata table; pixel payloads are stored separately
+    /// and are never loaded.
+    [[nodiscard]] std::expected<std::vector<ThumbnailMetadata>, CacheError>
+    getMetadataMany(const std::vector<std::string>& keys);
+
     /// @brief Check if entry exists
     /// @param key Cache key
     [[nodiscard]] bool exists(const std::string& key);
 
+    /// @brief Add a row that shares an already stored payload
+    /// @param metadata New row; content_hash names the payload, dimensions are
+    ///        taken from the payload's existing row
+    /// @return The new entry with decoded pixels, or NotFound if no row holds
+    ///         a payload for content_hash
+    ///
+    /// Used for content deduplication: identical files found under another
+    /// path skip decoding and reference the payload already in the cache.
+    [[nodiscard]] std::expected<ThumbnailEntry, CacheError>
+    linkContent(const ThumbnailMetadata& metadata);
+
     /// @brief Store thumbnail entry
     /// @param entry Entry to store
     /// @return Success or error
     [[nodiscard]] std::expected<void, CacheError> put(const ThumbnailEntry& entry);
 
+    /// @brief Queue a thumbnail entry for a batched write
+    /// @param entry Entry to store
+    /// @return Success (queued) or error
+    ///
+    /// Compression runs on the calling thread. Queued puts are committed in
+    /// one transaction per batch by a writer thread; the call blocks while the
+    /// queue is full. Queued entries are visible to get() and exists().
+    [[nodiscard]] std::expected<void, CacheError> putDeferred(const ThumbnailEntry& entry);
+
+    /// @brief Commit all queued puts now
+    void flush();
+
     /// @brief Delete entry by key
     /// @param key Cache key
     /// @return Success or error
@@ -89,18 +182,127 @@ public:
 
     /// @brief Delete entries for non-existent source files
     /// @return Number of deleted entries or error
+    ///
+    /// Runs in batches; the database lock is released between batches and
+    /// while the file system is queried, so reads are not held up.
     [[nodiscard]] std::expected<uint64_t, CacheError> removeOrphaned();
 
+    /// @brief Delete the least recently read entries once the cache exceeds a limit
+    ///
+    /// Reads are recorded in batches on the writer thread, at most one update
+    /// per row per hour. An exceeded limit starts eviction, which continues
+    /// until the cache is at 90% of both limits, so puts at the limit do not
+    /// each trigger another pass.
+    /// @param max_entries Entry count limit
+    /// @param max_size_bytes Total payload size limit
+    /// @return Number of deleted entries or error
+    [[nodiscard]] std::expected<uint64_t, CacheError> evictOldest(uint64_t max_entries,
+                                                                  uint64_t max_size_bytes);
+
+    /// @brief Get the perceptual hash of every source that has one
+    /// @return One hash per source path, from its most recently cached row
+    ///
+    /// Queued puts are committed first. Reads only the metadata table.
+    [[nodiscard]] std::expected<std::vector<SourceHash>, CacheError> getPerceptualHashes();
+
     /// @brief Get cache statistics
     [[nodiscard]] std::expected<CacheStats, CacheError> getStats();
 
+    /// @brief Contention on the writer connection lock since open or resetLockStats()
+    ///
+    /// Writes and maintenance hold the one lock around their SQLite calls, so
+    /// the wait time is what they lose to serialisation. Lookups on reader
+    /// connections do not take it.
+    [[nodiscard]] LockStats lockStats() const noexcept;
+
+    /// @brief Zero the lockStats() counters
+    void resetLockStats() noexcept;
+
     /// @brief Clear all entries
     /// @return Number of deleted entries or error
     [[nodiscard]] std::expected<uint64_t, CacheError> clear();
 
     /// @brief Vacuum database to reclaim space
+    ///
+    /// With the pack backend this queues pack compaction on the I/O thread
+    /// instead; reads continue while it runs.
     [[nodiscard]] std::expected<void, CacheError> vacuum();
 
+    /// @brief Start copying the database, and its pack file, to another path
+    /// @param destination Database file to write (see filePath()); put in
+    ///        place by finishCopy() only, replacing what is there
+    /// @return Error if the copy cannot be created
+    ///
+    /// The database stays in use meanwhile. SQLite's online backup copies
+    /// the pages a part per copyStep() call, and carries every later commit
+    /// into the copy; the pack file is copied as it grows. Compaction waits
+    /// until the copy ends. One copy at a time, made by one thread.
+    [[nodiscard]] std::expected<void, CacheError>
+    startCopy(const std::filesystem::path& destination);
+
+    /// @brief Copy the next part (a few megabytes, at background priority)
+    /// @return true while parts remain
+    ///
+    /// Writes are held off only while a part of the SQLite pages is copied.
+    [[nodiscard]] std::expected<bool, CacheError> copyStep();
+
+    /// @brief Bring the copy up to date and put it at its destination
+    ///
+    /// Queued writes are committed first and the last part is copied with
+    /// writes held off, so the copy holds everything stored until the call.
+    /// The files appear at the destination by renames, the database last.
+    [[nodiscard]] std::expected<void, CacheError> finishCopy();
+
+    /// @brief Abandon the copy, deleting what was written (no-op without one)
+    void cancelCopy();
+
+    /// @brief Train a zstd dictionary from a sample of cached rows
+    /// @return Id of the new dictionary, NotFound if the cache holds too few
+    ///         lossless rows, or CompressionError without zstd support
+    ///
+    /// The dictionary is stored in the zstd_dictionaries table and used for
+    /// all subsequent zstd payloads. Existing rows keep decoding with the
+    /// dictionary (or none) they were written with.
+    [[nodiscard]] std::expected<uint32_t, CacheError> trainDictionary();
+
+    /// @brief Get the stored listing of an archive
+    /// @param archive_path Archive path (UTF-8)
+    /// @param write_time Archive last write time (FILETIME ticks)
+    /// @param file_size Archive size in bytes
+    /// @return Listing bytes, or NotFound if none was stored for this state
+    [[nodiscard]] std::expected<std::vector<uint8_t>, CacheError>
+    getArchiveListing(const std::string& archive_path, uint64_t write_time, uint64_t file_size);
+
+    /// @brief Store the listing of an archive, replacing any older one
+    /// @param listing Encoded listing (opaque to the cache)
+    [[nodiscard]] std::expected<void, CacheError>
+    putArchiveListing(const std::string& archive_path, uint64_t write_time, uint64_t file_size,
+                      std::span<const uint8_t> listing);
+
+    /// @brief Get the snapshot of a directory listing
+    /// @param directory_path Directory path (UTF-8)
+    /// @param options Filter and sort order the listing was made with (see fs::snapshotOptions)
+    /// @return Snapshot, or NotFound if none was stored for these options
+    [[nodiscard]] std::expected<StoredListing, CacheError>
+    getDirectoryListing(const std::string& directory_path, uint32_t options);
+
+    /// @brief Store the snapshot of a directory listing, replacing any older one
+    ///
+    /// Only the most recently stored few hundred snapshots are kept.
+    [[nodiscard]] std::expected<void, CacheError>
+    putDirectoryListing(const std::string& directory_path, uint32_t options,
+                        const StoredListing& listing);
+
+    /// @brief Get stored capture info for many sources with a single query
+    /// @param keys Cache keys
+    /// @return Records found, in key order (missing keys are skipped)
+    [[nodiscard]] std::expected<std::vector<CaptureRecord>, CacheError>
+    getCaptureInfoMany(const std::vector<std::string>& keys);
+
+    /// @brief Store capture info records in one transaction, replacing older ones
+    [[nodiscard]] std::expected<void, CacheError>
+    putCaptureInfoMany(std::span<const CaptureRecord> records);
+
     // ===== Async Operations =====
 
     /// @brief Get thumbnail entry asynchronously
@@ -112,6 +314,44 @@ public:
     /// @brief Delete entry asynchronously
     void removeAsync(const std::string& key, AsyncCallback<void> callback);
 
+    /// @brief Awaitable getAsync; resumes on the I/O thread
+    [[nodiscard]] Task<std::expected<ThumbnailEntry, CacheError>> getAsync(std::string key);
+
+    /// @brief Awaitable putAsync; resumes on the I/O thread
+    [[nodiscard]] Task<std::expected<void, CacheError>> putAsync(ThumbnailEntry entry);
+
+    /// @brief Awaitable removeAsync; resumes on the I/O thread
+    [[nodiscard]] Task<std::expected<void, CacheError>> removeAsync(std::string key);
+
+    /// @brief Delete expired entries on the I/O thread at background priority
+    void removeOlderThanAsync(std::chrono::system_clock::time_point older_than,
+                              AsyncCallback<uint64_t> callback);
+
+    /// @brief Delete the rows of changed or deleted source files asynchronously
+    /// @param sources Source paths with the key (if any) still valid for each
+    /// @param callback Called with the number of deleted rows
+    void removeStaleAsync(std::vector<StaleSource> sources, AsyncCallback<uint64_t> callback);
+
+    /// @brief Carry the rows of renamed or moved sources over to their new paths
+    /// @param moves Old and new path of each source
+    /// @param callback Called with the number of rows carried over
+    ///
+    /// A row is rekeyed in place when its key matches the new file's stamp,
+    /// i.e. the contents were not changed by the move; its payload is kept.
+    /// Other rows of the old path are deleted. The file system is queried
+    /// without the database lock held.
+    void rekeySourcesAsync(std::vector<MovedSource> moves, AsyncCallback<uint64_t> callback);
+
+    /// @brief Delete orphaned entries on the I/O thread at background priority
+    ///
+    /// Each batch is a separate task, so other async operations run between
+    /// batches.
+    void removeOrphanedAsync(AsyncCallback<uint64_t> callback);
+
+    /// @brief evictOldest() on the I/O thread at background priority
+    void evictOldestAsync(uint64_t max_entries, uint64_t max_size_bytes,
+                          AsyncCallback<uint64_t> callback);
+
 private:
     CacheDatabase();
 
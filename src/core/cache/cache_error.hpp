@@ -17,7 +17,7 @@ enum class CacheError {
     OutOfMemory,       // Memory allocation failed
     InvalidPath,       // Invalid cache path
     AlreadyExists,     // Entry already exists
-    CompressionError,  // zstd compression/decompression failed
+    CompressionError,  // Payload encoding/decoding (zstd, JPEG) failed
 };
 
 /// @brief Get string representation of cache error
@@ -39,6 +39,8 @@ enum class CacheError {
         return "Invalid cache path";
     case CacheError::AlreadyExists:
         return "Entry already exists";
+    case CacheError::CompressionError:
+        return "Payload encoding failed";
     }
     return "Unknown cache error";
 }
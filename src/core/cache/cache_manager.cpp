@@ -3,106 +3,93 @@
 
 #include "cache_manager.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <list>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+
+#include "../fs/directory.hpp"
+#include "../fs/file_metadata.hpp"
+#include "../fs/io_scheduler.hpp"
+#include "../image/exif_reader.hpp"
+#include "../image/image_scaler.hpp"
+#include "../image/perceptual_hash.hpp"
+#include "../util/logger.hpp"
+#include "../util/lru_cache.hpp"
+#include "../util/memory_accounting.hpp"
+#include "../util/string_utils.hpp"
+#include "../util/task_group.hpp"
+#include "cache_shards.hpp"
 
 namespace nive::cache {
 
-/// @brief LRU cache implementation
-template <typename Key, typename Value>
-class LruCache {
-public:
-    explicit LruCache(size_t capacity) : capacity_(capacity) {}
-
-    [[nodiscard]] std::optional<Value> get(const Key& key) {
-        auto it = cache_map_.find(key);
-        if (it == cache_map_.end()) {
-            return std::nullopt;
-        }
+namespace {
 
-        // Move to front (most recently used)
-        cache_list_.splice(cache_list_.begin(), cache_list_, it->second);
-        return it->second->second;
-    }
+// Disk puts between two checks of the size and entry limits
+constexpr uint32_t kEvictionCheckPuts = 512;
 
-    void put(const Key& key, Value value) {
-        auto it = cache_map_.find(key);
+// An offline share must not hold up opening the cache
+constexpr std::chrono::milliseconds kSharedTierProbeTimeout{1500};
 
-        if (it != cache_map_.end()) {
-            // Update existing
-            it->second->second = std::move(value);
-            cache_list_.splice(cache_list_.begin(), cache_list_, it->second);
-            return;
-        }
-
-        // Evict if at capacity
-        if (cache_map_.size() >= capacity_) {
-            auto last = cache_list_.end();
-            --last;
-            cache_map_.erase(last->first);
-            cache_list_.pop_back();
-        }
-
-        // Insert new
-        cache_list_.emplace_front(key, std::move(value));
-        cache_map_[key] = cache_list_.begin();
-    }
-
-    void remove(const Key& key) {
-        auto it = cache_map_.find(key);
-        if (it != cache_map_.end()) {
-            cache_list_.erase(it->second);
-            cache_map_.erase(it);
-        }
-    }
-
-    [[nodiscard]] bool contains(const Key& key) const {
-        return cache_map_.find(key) != cache_map_.end();
-    }
-
-    void clear() {
-        cache_list_.clear();
-        cache_map_.clear();
-    }
-
-    [[nodiscard]] size_t size() const { return cache_map_.size(); }
-
-    [[nodiscard]] size_t capacity() const { return capacity_; }
-
-private:
-    size_t capacity_;
-    std::list<std::pair<Key, Value>> cache_list_;
-    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator> cache_map_;
-};
+}  // namespace
 
 /// @brief Cache manager implementation
 class CacheManager::Impl {
 public:
     explicit Impl(CacheConfig config)
-        : config_(std::move(config)), memory_cache_(config_.memory_cache_size) {}
+        : config_(std::move(config)), memory_cache_(config_.memory_cache_bytes) {}
 
     [[nodiscard]] bool initialize() {
-        auto db_result = CacheDatabase::open(config_.database_path, config_.compression_level);
-        if (!db_result) {
+        auto shards = CacheShards::open(config_);
+        if (!shards) {
             return false;
         }
-        database_ = std::move(*db_result);
+        shards_ = std::move(*shards);
+
+        // The shared tier is optional: without it only its hits are lost
+        if (!config_.shared_database_path.empty()) {
+            open_shared_tier();
+        }
         return true;
     }
 
     [[nodiscard]] const CacheConfig& config() const noexcept { return config_; }
 
-    [[nodiscard]] bool isReady() const noexcept { return database_ && database_->isOpen(); }
+    [[nodiscard]] bool isReady() const noexcept { return shards_ && shards_->main()->isOpen(); }
 
     [[nodiscard]] std::expected<image::DecodedImage, CacheError>
-    getThumbnail(const std::filesystem::path& path) {
-        std::string key = generateCacheKey(path);
+    getThumbnail(const std::filesystem::path& path, const std::optional<SourceStamp>& stamp,
+                 uint32_t requested_size) {
+        std::string key = key_for(path, stamp);
         if (key.empty()) {
             return std::unexpected(CacheError::InvalidPath);
         }
 
+        // A reduced level serves small display sizes; full size is the fallback
+        uint32_t level = thumbnailLevel(requested_size);
+        if (level != config_.mip_base_size) {
+            if (auto reduced = lookup(path, mipLevelKey(key, level))) {
+                return reduced;
+            }
+        }
+
+        auto result = lookup(path, key);
+        if (!result) {
+            ++stats_.misses;
+        }
+        return result;
+    }
+
+    [[nodiscard]] uint32_t thumbnailLevel(uint32_t requested_size) const noexcept {
+        return selectMipLevel(config_.mip_base_size, config_.mip_levels, requested_size);
+    }
+
+    /// @brief Look up one cache key of path, memory tier first (counts hits only)
+    [[nodiscard]] std::expected<image::DecodedImage, CacheError>
+    lookup(const std::filesystem::path& path, const std::string& key) {
         // Check memory cache first
         {
             std::lock_guard lock(memory_mutex_);
@@ -113,26 +100,70 @@ public:
             }
         }
 
-        // Check disk cache
-        auto result = database_->get(key);
+        // Check disk cache, then the shared tier
+        auto database = shards_->forPath(path);
+        auto result = database->get(key);
+        bool from_shared_tier = false;
+        if (!result && result.error() == CacheError::NotFound && shared_tier_) {
+            result = shared_tier_->get(key);
+            from_shared_tier = result.has_value();
+        }
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+
+        ++stats_.hits;
+
+        // Add to memory cache; the returned image shares its pixels
+        auto shared = std::make_shared<const ThumbnailEntry>(std::move(*result));
+        if (from_shared_tier) {
+            promote(*database, *shared);
+        }
+        {
+            std::lock_guard lock(memory_mutex_);
+            cache_in_memory(key, shared);
+        }
+
+        return convert_entry_to_image(shared);
+    }
+
+    [[nodiscard]] std::expected<image::DecodedImage, CacheError>
+    getThumbnailByContent(const std::filesystem::path& path, const std::string& content_hash,
+                          const std::optional<SourceStamp>& stamp) {
+        auto source = stamp ? stamp : statSource(path);
+        std::string key = key_for(path, source);
+        if (key.empty()) {
+            return std::unexpected(CacheError::InvalidPath);
+        }
+
+        ThumbnailMetadata metadata;
+        metadata.file_hash = key;
+        metadata.source_path = path;
+        metadata.cached_at = std::chrono::system_clock::now();
+        if (source) {
+            metadata.source_mtime = source->mtime;
+        }
+        metadata.content_hash = content_hash;
+
+        auto result = shards_->forPath(path)->linkContent(metadata);
         if (!result) {
-            ++stats_.misses;
             return std::unexpected(result.error());
         }
 
         ++stats_.hits;
 
-        // Add to memory cache
+        auto shared = std::make_shared<const ThumbnailEntry>(std::move(*result));
         {
             std::lock_guard lock(memory_mutex_);
-            memory_cache_.put(key, *result);
+            cache_in_memory(key, shared);
         }
 
-        return convert_entry_to_image(*result);
+        return convert_entry_to_image(shared);
     }
 
-    [[nodiscard]] bool hasThumbnail(const std::filesystem::path& path) {
-        std::string key = generateCacheKey(path);
+    [[nodiscard]] bool hasThumbnail(const std::filesystem::path& path,
+                                    const std::optional<SourceStamp>& stamp) {
+        std::string key = key_for(path, stamp);
         if (key.empty()) {
             return false;
         }
@@ -145,34 +176,48 @@ public:
             }
         }
 
-        // Check disk cache
-        return database_->exists(key);
+        // Check disk cache, then the shared tier
+        return shards_->forPath(path)->exists(key) || (shared_tier_ && shared_tier_->exists(key));
     }
 
-    [[nodiscard]] std::expected<void, CacheError> putThumbnail(const std::filesystem::path& path,
-                                                               const image::DecodedImage& thumbnail,
-                                                               uint32_t original_width,
-                                                               uint32_t original_height) {
-        std::string key = generateCacheKey(path);
+    [[nodiscard]] std::expected<void, CacheError>
+    putThumbnail(const std::filesystem::path& path, const image::DecodedImage& thumbnail,
+                 uint32_t original_width, uint32_t original_height,
+                 const std::optional<SourceStamp>& stamp, const std::string& content_hash,
+                 std::optional<uint64_t> perceptual_hash) {
+        auto source = stamp ? stamp : statSource(path);
+        std::string key = key_for(path, source);
         if (key.empty()) {
             return std::unexpected(CacheError::InvalidPath);
         }
 
-        auto entry = buildEntry(key, path, thumbnail, original_width, original_height);
+        auto built = buildEntry(key, path, thumbnail, original_width, original_height, source);
+        built.metadata.content_hash = content_hash;
+        built.metadata.perceptual_hash = perceptual_hash;
+        built.metadata.average_color = image::averageColor(thumbnail);
+        auto entry = std::make_shared<const ThumbnailEntry>(std::move(built));
 
         // Store in memory cache
         {
             std::lock_guard lock(memory_mutex_);
-            memory_cache_.put(key, entry);
+            cache_in_memory(key, entry);
         }
 
-        // Store in disk cache
-        return database_->put(entry);
+        // Store in disk cache (batched by the database's write-behind queue)
+        auto database = shards_->forPath(path);
+        if (auto stored = database->putDeferred(*entry); !stored) {
+            return stored;
+        }
+        note_disk_put();
+
+        put_mip_levels(*database, *entry, thumbnail, source);
+        return {};
     }
 
     [[nodiscard]] std::optional<ImageResolution>
-    getImageResolution(const std::filesystem::path& path) {
-        std::string key = generateCacheKey(path);
+    getImageResolution(const std::filesystem::path& path,
+                       const std::optional<SourceStamp>& stamp) {
+        std::string key = key_for(path, stamp);
         if (key.empty()) {
             return std::nullopt;
         }
@@ -181,36 +226,246 @@ public:
         {
             std::lock_guard lock(memory_mutex_);
             auto cached = memory_cache_.get(key);
-            if (cached && cached->metadata.original_width > 0) {
-                return ImageResolution{cached->metadata.original_width,
-                                       cached->metadata.original_height};
+            if (cached && (*cached)->metadata.original_width > 0) {
+                return ImageResolution{(*cached)->metadata.original_width,
+                                       (*cached)->metadata.original_height,
+                                       (*cached)->metadata.average_color};
             }
         }
 
-        // Fall back to disk cache
-        auto result = database_->get(key);
-        if (result && result->metadata.original_width > 0) {
-            return ImageResolution{result->metadata.original_width,
-                                   result->metadata.original_height};
+        // Fall back to the disk cache's metadata table (no pixel payload is read)
+        auto result = shards_->forPath(path)->getMetadata(key);
+        if (!result && shared_tier_) {
+            result = shared_tier_->getMetadata(key);
+        }
+        if (result && result->original_width > 0) {
+            return ImageResolution{result->original_width, result->original_height,
+                                   result->average_color};
         }
 
         return std::nullopt;
     }
 
+    [[nodiscard]] std::vector<std::optional<ImageResolution>>
+    getImageResolutions(const std::vector<fs::FileMetadata>& files) {
+        std::vector<std::optional<ImageResolution>> resolutions(files.size());
+        if (!isReady()) {
+            return resolutions;
+        }
+
+        std::vector<std::string> keys;
+        std::vector<const std::filesystem::path*> sources;  // Per key
+        std::unordered_map<std::string, size_t> index_of;
+        keys.reserve(files.size());
+        auto file_keys = generateCacheKeys(files);
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (!files[i].is_image() || file_keys[i].empty()) {
+                continue;
+            }
+            index_of.emplace(file_keys[i], i);
+            keys.push_back(std::move(file_keys[i]));
+            sources.push_back(&files[i].path);
+        }
+
+        auto fill = [&](const std::vector<ThumbnailMetadata>& found) {
+            for (const auto& metadata : found) {
+                auto it = index_of.find(metadata.file_hash);
+                if (it != index_of.end() && metadata.original_width > 0) {
+                    resolutions[it->second] = ImageResolution{
+                        metadata.original_width, metadata.original_height, metadata.average_color};
+                }
+            }
+        };
+        auto shards = index_shards(sources);
+        for (size_t d = 0; d < shards.databases.size(); ++d) {
+            if (auto result = shards.databases[d]->getMetadataMany(shards.keysOf(d, keys))) {
+                fill(*result);
+            }
+        }
+
+        // What the local tier lacks, the shared tier may have
+        if (shared_tier_) {
+            std::erase_if(keys, [&](const std::string& key) {
+                return resolutions[index_of.at(key)].has_value();
+            });
+            if (auto result = shared_tier_->getMetadataMany(keys)) {
+                fill(*result);
+            }
+        }
+        return resolutions;
+    }
+
+    void fillCaptureInfo(std::vector<fs::FileMetadata>& files, std::stop_token stop) {
+        // Only files on disk whose format carries EXIF; archive entries would
+        // have to be extracted
+        std::vector<std::string> keys;
+        std::vector<size_t> file_of;  // Index into files, per key
+        std::unordered_map<std::string, size_t> index_of;
+        for (size_t i = 0; i < files.size(); ++i) {
+            const auto& file = files[i];
+            if (!file.is_image() || file.is_in_archive() ||
+                !image::mayHaveCaptureInfo(file.extension)) {
+                continue;
+            }
+            if (auto key = generateCacheKey(file); !key.empty()) {
+                index_of.emplace(key, keys.size());
+                file_of.push_back(i);
+                keys.push_back(std::move(key));
+            }
+        }
+        if (keys.empty()) {
+            return;
+        }
+
+        std::vector<const std::filesystem::path*> sources;
+        sources.reserve(keys.size());
+        for (size_t i : file_of) {
+            sources.push_back(&files[i].path);
+        }
+        auto shards = isReady() ? index_shards(sources) : ShardIndex{};
+
+        std::vector<bool> stored(keys.size(), false);
+        for (size_t d = 0; d < shards.databases.size(); ++d) {
+            if (auto records = shards.databases[d]->getCaptureInfoMany(shards.keysOf(d, keys))) {
+                for (auto& record : *records) {
+                    auto it = index_of.find(record.cache_key);
+                    if (it == index_of.end()) {
+                        continue;
+                    }
+                    auto& file = files[file_of[it->second]];
+                    file.date_taken = record.date_taken;
+                    file.camera_model = std::move(record.camera_model);
+                    stored[it->second] = true;
+                }
+            }
+        }
+
+        std::vector<size_t> missing;
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (!stored[k]) {
+                missing.push_back(k);
+            }
+        }
+        if (missing.empty()) {
+            return;
+        }
+
+        // Headers only, on all cores; the I/O scheduler keeps a slow volume
+        // from being read by every thread at once
+        std::vector<CaptureRecord> records(missing.size());
+        std::vector<size_t> record_database(missing.size());
+        auto read_headers = [&](size_t first, size_t last) {
+            for (size_t m = first; m < last; ++m) {
+                auto& file = files[file_of[missing[m]]];
+                auto slot = fs::IoScheduler::instance().acquire(
+                    file.path, fs::IoPriority::Foreground, stop);
+                if (!slot) {
+                    return;
+                }
+                auto info = image::readCaptureInfo(file.path);
+                records[m].cache_key = keys[missing[m]];
+                record_database[m] = shards.databases.empty() ? 0 : shards.database_of[missing[m]];
+                if (info) {
+                    file.date_taken = info->date_taken;
+                    file.camera_model = info->camera_model;
+                    records[m].date_taken = info->date_taken;
+                    records[m].camera_model = std::move(info->camera_model);
+                }
+            }
+        };
+        parallelFor(0, missing.size(), 1, read_headers, globalThreadPool(), TaskPriority::Normal);
+
+        // Files skipped by a stop are read next time; a lost record only
+        // costs reading the header again
+        for (size_t d = 0; d < shards.databases.size(); ++d) {
+            std::vector<CaptureRecord> shard_records;
+            for (size_t m = 0; m < records.size(); ++m) {
+                if (!records[m].cache_key.empty() && record_database[m] == d) {
+                    shard_records.push_back(std::move(records[m]));
+                }
+            }
+            (void)shards.databases[d]->putCaptureInfoMany(shard_records);
+        }
+    }
+
     void removeThumbnail(const std::filesystem::path& path) {
         std::string key = generateCacheKey(path);
         if (key.empty()) {
             return;
         }
 
-        // Remove from memory cache
-        {
-            std::lock_guard lock(memory_mutex_);
-            memory_cache_.remove(key);
+        std::vector<std::string> keys{key};
+        for (uint32_t level = 1; level < config_.mip_levels; ++level) {
+            keys.push_back(mipLevelKey(key, config_.mip_base_size >> level));
+        }
+
+        auto database = shards_->forPath(path);
+        for (const auto& entry_key : keys) {
+            // Remove from memory cache
+            {
+                std::lock_guard lock(memory_mutex_);
+                memory_cache_.remove(entry_key);
+                memory_charge_.set(memory_cache_.totalCost());
+            }
+
+            // Remove from disk cache (ignore result)
+            (void)database->remove(entry_key);
+        }
+    }
+
+    void invalidate(const std::vector<std::filesystem::path>& paths) {
+        std::vector<const std::filesystem::path*> changed;
+        changed.reserve(paths.size());
+        for (const auto& path : paths) {
+            changed.push_back(&path);
+        }
+        auto shards = index_shards(changed);
+
+        std::vector<std::vector<StaleSource>> sources(shards.databases.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            // A file that still exists keeps the row for its current contents
+            std::string keep_key;
+            if (auto stamp = statSource(paths[i])) {
+                keep_key = generateCacheKey(paths[i], stamp->mtime, stamp->size_bytes);
+            }
+            sources[shards.database_of[i]].push_back({pathToUtf8(paths[i]), std::move(keep_key)});
         }
 
-        // Remove from disk cache (ignore result)
-        (void)database_->remove(key);
+        for (size_t d = 0; d < shards.databases.size(); ++d) {
+            shards.databases[d]->removeStaleAsync(std::move(sources[d]), count_evictions());
+        }
+    }
+
+    void rekey(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& moves) {
+        std::vector<const std::filesystem::path*> from_paths;
+        from_paths.reserve(moves.size());
+        for (const auto& move : moves) {
+            from_paths.push_back(&move.first);
+        }
+        auto shards = index_shards(from_paths);
+
+        // Rows cannot follow a file to another shard; they are dropped there
+        std::vector<std::vector<MovedSource>> sources(shards.databases.size());
+        std::vector<std::vector<StaleSource>> dropped(shards.databases.size());
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const auto& [from, to] = moves[i];
+            const auto& database = shards.databases[shards.database_of[i]];
+            if (shards_->forPath(to) == database) {
+                sources[shards.database_of[i]].push_back({pathToUtf8(from), pathToUtf8(to)});
+            } else {
+                dropped[shards.database_of[i]].push_back({pathToUtf8(from), {}});
+            }
+        }
+
+        for (size_t d = 0; d < shards.databases.size(); ++d) {
+            if (!sources[d].empty()) {
+                shards.databases[d]->rekeySourcesAsync(std::move(sources[d]),
+                                                       [](std::expected<uint64_t, CacheError>) {});
+            }
+            if (!dropped[d].empty()) {
+                shards.databases[d]->removeStaleAsync(std::move(dropped[d]), count_evictions());
+            }
+        }
     }
 
     void getThumbnailAsync(
@@ -234,7 +489,7 @@ public:
         }
 
         // Load from disk asynchronously
-        database_->getAsync(key, [this, key, callback = std::move(callback)](
+        shards_->forPath(path)->getAsync(key, [this, key, callback = std::move(callback)](
                                      std::expected<ThumbnailEntry, CacheError> result) {
             if (!result) {
                 ++stats_.misses;
@@ -245,44 +500,58 @@ public:
             ++stats_.hits;
 
             // Add to memory cache
+            auto shared = std::make_shared<const ThumbnailEntry>(std::move(*result));
             {
                 std::lock_guard lock(memory_mutex_);
-                memory_cache_.put(key, *result);
+                cache_in_memory(key, shared);
             }
 
-            callback(convert_entry_to_image(*result));
+            callback(convert_entry_to_image(shared));
         });
     }
 
     void putThumbnailAsync(const std::filesystem::path& path, image::DecodedImage thumbnail,
                            uint32_t original_width, uint32_t original_height,
                            std::function<void(std::expected<void, CacheError>)> callback) {
-        std::string key = generateCacheKey(path);
+        auto source = statSource(path);
+        std::string key = key_for(path, source);
         if (key.empty()) {
             callback(std::unexpected(CacheError::InvalidPath));
             return;
         }
 
-        auto entry = buildEntry(key, path, thumbnail, original_width, original_height);
+        auto entry = buildEntry(key, path, thumbnail, original_width, original_height, source);
 
         // Store in memory cache immediately
         {
             std::lock_guard lock(memory_mutex_);
-            memory_cache_.put(key, entry);
+            cache_in_memory(key, std::make_shared<const ThumbnailEntry>(entry));
         }
 
         // Store in disk cache asynchronously
-        database_->putAsync(std::move(entry), std::move(callback));
+        shards_->forPath(path)->putAsync(std::move(entry), std::move(callback));
+        note_disk_put();
     }
 
     void clearMemoryCache() {
         std::lock_guard lock(memory_mutex_);
         memory_cache_.clear();
+        memory_charge_.set(0);
+    }
+
+    uint64_t trimMemoryCache(double keep_fraction) {
+        std::lock_guard lock(memory_mutex_);
+        size_t before = memory_cache_.totalCost();
+        auto keep = static_cast<size_t>(static_cast<double>(before) *
+                                        std::clamp(keep_fraction, 0.0, 1.0));
+        stats_.memory_evictions += memory_cache_.shrinkTo(keep);
+        memory_charge_.set(memory_cache_.totalCost());
+        return before - memory_cache_.totalCost();
     }
 
     [[nodiscard]] std::expected<uint64_t, CacheError> clearAll() {
         clearMemoryCache();
-        return database_->clear();
+        return sum_over(shards_->all(), [](CacheDatabase& database) { return database.clear(); });
     }
 
     [[nodiscard]] std::expected<uint64_t, CacheError> cleanupExpired() {
@@ -291,7 +560,9 @@ public:
         }
 
         auto cutoff = std::chrono::system_clock::now() - *config_.retention_period;
-        auto result = database_->removeOlderThan(cutoff);
+        auto result = sum_over(shards_->all(), [cutoff](CacheDatabase& database) {
+            return database.removeOlderThan(cutoff);
+        });
         if (result) {
             stats_.evictions += *result;
         }
@@ -299,7 +570,9 @@ public:
     }
 
     [[nodiscard]] std::expected<uint64_t, CacheError> cleanupOrphaned() {
-        auto result = database_->removeOrphaned();
+        // Shards of volumes not seen this session are not probed
+        auto result = sum_over(shards_->used(),
+                               [](CacheDatabase& database) { return database.removeOrphaned(); });
         if (result) {
             stats_.evictions += *result;
         }
@@ -307,58 +580,194 @@ public:
     }
 
     [[nodiscard]] std::expected<uint64_t, CacheError> enforceLimits() {
-        auto stats_result = database_->getStats();
-        if (!stats_result) {
-            return std::unexpected(stats_result.error());
+        auto databases = shards_->all();
+        std::vector<uint64_t> sizes;
+        uint64_t total_entries = 0;
+        uint64_t total_bytes = 0;
+        for (const auto& database : databases) {
+            auto stats_result = database->getStats();
+            if (!stats_result) {
+                return std::unexpected(stats_result.error());
+            }
+            total_entries += stats_result->total_entries;
+            total_bytes += stats_result->total_size_bytes;
+            sizes.push_back(stats_result->total_size_bytes);
         }
 
         uint64_t removed = 0;
 
         // If over entry limit or size limit, clean up expired entries first
-        if (stats_result->total_entries > config_.max_entries ||
-            stats_result->total_size_bytes > config_.max_size_bytes) {
+        if (total_entries > config_.max_entries || total_bytes > config_.max_size_bytes) {
             auto expired = cleanupExpired();
             if (expired) {
                 removed += *expired;
             }
 
-            // Check again
-            stats_result = database_->getStats();
-            if (!stats_result) {
-                return removed;
+            // Then evict the oldest entries until within both limits
+            auto limits = share_limits(sizes);
+            for (size_t d = 0; d < databases.size(); ++d) {
+                auto evicted = databases[d]->evictOldest(limits[d].entries, limits[d].bytes);
+                if (evicted) {
+                    removed += *evicted;
+                    stats_.evictions += *evicted;
+                }
             }
         }
 
-        // TODO: If still over limit, evict oldest entries
-        // This would require a more sophisticated approach
-
         return removed;
     }
 
-    [[nodiscard]] CacheStats getStats() const {
+    void scheduleMaintenance() {
+        auto databases = shards_->all();
+        if (config_.retention_period) {
+            auto cutoff = std::chrono::system_clock::now() - *config_.retention_period;
+            for (const auto& database : databases) {
+                database->removeOlderThanAsync(cutoff, count_evictions());
+            }
+        }
+        auto limits = share_limits(file_sizes(databases));
+        for (size_t d = 0; d < databases.size(); ++d) {
+            databases[d]->evictOldestAsync(limits[d].entries, limits[d].bytes, count_evictions());
+        }
+        for (const auto& database : shards_->used()) {
+            database->removeOrphanedAsync(count_evictions());
+        }
+    }
+
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    dropVolume(const std::filesystem::path& volume) {
+        return shards_->dropVolume(volume);
+    }
+
+    [[nodiscard]] std::expected<bool, CacheError>
+    relocate(const std::filesystem::path& database_path, std::stop_token stop) {
+        if (!shards_) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        return shards_->relocate(database_path, std::move(stop));
+    }
+
+    [[nodiscard]] std::filesystem::path databasePath() {
+        return shards_ ? shards_->databasePath() : std::filesystem::path{};
+    }
+
+    [[nodiscard]] CacheStats getRuntimeStats() const {
         CacheStats stats = stats_;
-        if (database_) {
-            auto db_stats = database_->getStats();
-            if (db_stats) {
-                stats.total_entries = db_stats->total_entries;
-                stats.total_size_bytes = db_stats->total_size_bytes;
+        std::lock_guard lock(memory_mutex_);
+        stats.memory_evictions = stats_.memory_evictions;
+        stats.memory_entries = memory_cache_.size();
+        stats.memory_size_bytes = memory_cache_.totalCost();
+        stats.memory_capacity_bytes = memory_cache_.capacity();
+        return stats;
+    }
+
+    [[nodiscard]] CacheStats getStats() const {
+        CacheStats stats = getRuntimeStats();
+        if (!shards_) {
+            return stats;
+        }
+        for (const auto& database : shards_->all()) {
+            auto db_stats = database->getStats();
+            if (!db_stats || db_stats->total_entries == 0) {
+                continue;
+            }
+            if (stats.total_entries == 0) {
                 stats.oldest_entry = db_stats->oldest_entry;
                 stats.newest_entry = db_stats->newest_entry;
+            } else {
+                stats.oldest_entry = (std::min)(stats.oldest_entry, db_stats->oldest_entry);
+                stats.newest_entry = (std::max)(stats.newest_entry, db_stats->newest_entry);
             }
+            stats.total_entries += db_stats->total_entries;
+            stats.total_size_bytes += db_stats->total_size_bytes;
         }
         return stats;
     }
 
-    [[nodiscard]] std::expected<void, CacheError> compact() { return database_->vacuum(); }
+    [[nodiscard]] std::expected<std::vector<SourceHash>, CacheError> getPerceptualHashes() {
+        if (!shards_) {
+            return std::unexpected(CacheError::DatabaseError);
+        }
+        // A shard that cannot be read leaves its sources out
+        auto main = shards_->main();
+        auto hashes = main->getPerceptualHashes();
+        if (!hashes) {
+            return hashes;
+        }
+        for (const auto& database : shards_->all()) {
+            if (database == main) {
+                continue;
+            }
+            if (auto shard_hashes = database->getPerceptualHashes()) {
+                hashes->insert(hashes->end(), std::make_move_iterator(shard_hashes->begin()),
+                               std::make_move_iterator(shard_hashes->end()));
+            }
+        }
+        return hashes;
+    }
+
+    [[nodiscard]] std::expected<void, CacheError> compact() {
+        std::expected<void, CacheError> result;
+        for (const auto& database : shards_->all()) {
+            if (auto compacted = database->vacuum(); !compacted && result) {
+                result = compacted;
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] std::optional<std::vector<uint8_t>>
+    getArchiveListing(const std::filesystem::path& archive_path, uint64_t write_time,
+                      uint64_t file_size) {
+        auto listing = shards_->forPath(archive_path)
+                           ->getArchiveListing(pathToUtf8(archive_path), write_time, file_size);
+        if (!listing) {
+            return std::nullopt;
+        }
+        return std::move(*listing);
+    }
+
+    void putArchiveListing(const std::filesystem::path& archive_path, uint64_t write_time,
+                           uint64_t file_size, const std::vector<uint8_t>& listing) {
+        // A lost listing only costs reading the archive headers next time
+        (void)shards_->forPath(archive_path)
+            ->putArchiveListing(pathToUtf8(archive_path), write_time, file_size, listing);
+    }
+
+    [[nodiscard]] std::optional<StoredListing>
+    getDirectoryListing(const std::filesystem::path& directory, uint32_t options) {
+        auto listing =
+            shards_->forPath(directory)->getDirectoryListing(pathToUtf8(directory), options);
+        if (!listing) {
+            return std::nullopt;
+        }
+        return std::move(*listing);
+    }
+
+    void putDirectoryListing(const std::filesystem::path& directory, uint32_t options,
+                             const StoredListing& listing) {
+        // A lost snapshot only costs waiting for the scan next time
+        (void)shards_->forPath(directory)->putDirectoryListing(pathToUtf8(directory), options,
+                                                               listing);
+    }
 
     void prefetch(const std::filesystem::path& directory,
                   std::function<void(const std::filesystem::path&)> callback) {
+        auto database = shards_->forPath(directory);
         std::error_code ec;
         for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
             if (!entry.is_regular_file())
                 continue;
 
-            std::string key = generateCacheKey(entry.path());
+            // directory_entry already carries mtime and size from the enumeration
+            std::error_code stamp_ec;
+            auto mtime = entry.last_write_time(stamp_ec);
+            auto size = stamp_ec ? 0 : entry.file_size(stamp_ec);
+            std::string key =
+                stamp_ec ? generateCacheKey(entry.path())
+                         : generateCacheKey(
+                               entry.path(),
+                               std::chrono::clock_cast<std::chrono::system_clock>(mtime), size);
             if (key.empty())
                 continue;
 
@@ -373,22 +782,341 @@ public:
             }
 
             // Try to load from disk
-            auto result = database_->get(key);
+            auto result = database->get(key);
             if (result) {
                 std::lock_guard lock(memory_mutex_);
-                memory_cache_.put(key, std::move(*result));
+                cache_in_memory(key, std::make_shared<const ThumbnailEntry>(std::move(*result)));
                 if (callback)
                     callback(entry.path());
             }
         }
     }
 
+    uint64_t prefetch(const std::vector<fs::FileMetadata>& files, uint64_t max_bytes,
+                      uint32_t requested_size) {
+        if (!isReady()) {
+            return 0;
+        }
+
+        // Load the level getThumbnail will look up for this size
+        uint32_t level = thumbnailLevel(requested_size);
+        bool reduced = level != config_.mip_base_size;
+
+        std::vector<std::string> keys;
+        std::vector<const std::filesystem::path*> sources;  // Per key
+        keys.reserve(files.size());
+        auto file_keys = generateCacheKeys(files);
+        {
+            // Skip what the memory tier already holds
+            std::lock_guard lock(memory_mutex_);
+            for (size_t i = 0; i < files.size(); ++i) {
+                // Folder mosaics are keyed like images, by the folder's path and stamp
+                bool folder = files[i].is_directory() && !files[i].is_in_archive();
+                if ((!files[i].is_image() && !folder) || file_keys[i].empty()) {
+                    continue;
+                }
+                auto key = reduced ? mipLevelKey(file_keys[i], level) : std::move(file_keys[i]);
+                if (!memory_cache_.contains(key)) {
+                    keys.push_back(std::move(key));
+                    sources.push_back(&files[i].path);
+                }
+            }
+        }
+
+        uint64_t capacity = memory_cache_.capacity();
+        uint64_t budget = max_bytes > 0 ? std::min(max_bytes, capacity) : capacity;
+
+        // One query per shard the listing spans (usually one), sharing the budget
+        auto shards = index_shards(sources);
+        std::optional<std::vector<ThumbnailEntry>> result;
+        uint64_t local_bytes = 0;
+        for (size_t d = 0; d < shards.databases.size() && local_bytes < budget; ++d) {
+            auto found = shards.databases[d]->getMany(shards.keysOf(d, keys), budget - local_bytes);
+            if (!found) {
+                continue;
+            }
+            for (const auto& entry : *found) {
+                local_bytes += entry.data.size();
+            }
+            if (!result) {
+                result = std::move(*found);
+            } else {
+                result->insert(result->end(), std::make_move_iterator(found->begin()),
+                               std::make_move_iterator(found->end()));
+            }
+        }
+        if (!result) {
+            return 0;
+        }
+
+        // Keys the local tier lacks are asked of the shared tier with what is
+        // left of the budget, and its hits copied locally
+        std::vector<ThumbnailEntry> from_shared_tier;
+        if (shared_tier_) {
+            std::unordered_set<std::string_view> found;
+            for (const auto& entry : *result) {
+                found.insert(entry.metadata.file_hash);
+            }
+            std::erase_if(keys, [&](const std::string& key) { return found.contains(key); });
+            if (!keys.empty() && local_bytes < budget) {
+                if (auto shared = shared_tier_->getMany(keys, budget - local_bytes)) {
+                    from_shared_tier = std::move(*shared);
+                }
+            }
+            for (const auto& entry : from_shared_tier) {
+                promote(*shards_->forPath(entry.metadata.source_path), entry);
+            }
+        }
+
+        // Insert back to front so the first files end up most recently used
+        uint64_t loaded = 0;
+        std::lock_guard lock(memory_mutex_);
+        for (auto* entries : {&from_shared_tier, &*result}) {
+            for (auto it = entries->rbegin(); it != entries->rend(); ++it) {
+                loaded += it->data.size();
+                std::string key = it->metadata.file_hash;
+                cache_in_memory(key, std::make_shared<const ThumbnailEntry>(std::move(*it)));
+            }
+        }
+        return loaded;
+    }
+
 private:
+    /// @brief Open config_.shared_database_path read-only, if it can be reached
+    void open_shared_tier() {
+        const auto& path = config_.shared_database_path;
+        if (!fs::isPathReachable(path, kSharedTierProbeTimeout)) {
+            LOG_WARN("Shared cache unreachable: {}", pathToUtf8(path));
+            return;
+        }
+        // Opening the local database immutable beside its writer would read torn pages
+        std::error_code ec;
+        auto local_path = shards_->main()->path();
+        if (std::filesystem::equivalent(path, local_path, ec) ||
+            std::filesystem::equivalent(path / "thumbnails.db", local_path, ec)) {
+            LOG_WARN("Shared cache {} is the local cache; not used", pathToUtf8(path));
+            return;
+        }
+        // Pages are read over the network rather than faulted in through a mapping
+        SqliteTuning tuning = config_.sqlite;
+        tuning.mmap_size_bytes = 0;
+        auto shared = CacheDatabase::openReadOnly(path, tuning);
+        if (!shared) {
+            LOG_WARN("Shared cache unavailable at {}: {}", pathToUtf8(path),
+                     to_string(shared.error()));
+            return;
+        }
+        shared_tier_ = std::move(*shared);
+    }
+
+    /// @brief Copy an entry found in the shared tier to the local disk tier
+    void promote(CacheDatabase& database, const ThumbnailEntry& entry) {
+        ++stats_.shared_hits;
+        if (database.putDeferred(entry)) {
+            note_disk_put();
+        }
+    }
+
+    /// @brief Databases a batch of source paths is stored in
+    struct ShardIndex {
+        std::vector<std::shared_ptr<CacheDatabase>> databases;
+        std::vector<size_t> database_of;  // Per path, index into databases
+
+        /// @brief Pick the keys of the paths stored in one database
+        [[nodiscard]] std::vector<std::string> keysOf(size_t database,
+                                                      const std::vector<std::string>& keys) const {
+            if (databases.size() == 1) {
+                return keys;
+            }
+            std::vector<std::string> picked;
+            for (size_t k = 0; k < keys.size(); ++k) {
+                if (database_of[k] == database) {
+                    picked.push_back(keys[k]);
+                }
+            }
+            return picked;
+        }
+    };
+
+    /// @brief Find the database of each path; a listing usually needs one
+    [[nodiscard]] ShardIndex index_shards(const std::vector<const std::filesystem::path*>& paths) {
+        ShardIndex index;
+        index.database_of.reserve(paths.size());
+        for (const auto* path : paths) {
+            auto database = shards_->forPath(*path);
+            auto it = std::find(index.databases.begin(), index.databases.end(), database);
+            index.database_of.push_back(static_cast<size_t>(it - index.databases.begin()));
+            if (it == index.databases.end()) {
+                index.databases.push_back(std::move(database));
+            }
+        }
+        return index;
+    }
+
+    struct Limits {
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    /// @brief Split the entry and size limits between databases by their weights
+    ///
+    /// Each shard is held to its share, so the cache as a whole stays within
+    /// the limits wherever its thumbnails came from.
+    [[nodiscard]] std::vector<Limits> share_limits(const std::vector<uint64_t>& weights) const {
+        uint64_t total = 0;
+        for (uint64_t weight : weights) {
+            total += weight;
+        }
+        std::vector<Limits> limits;
+        for (uint64_t weight : weights) {
+            double share = total > 0 ? static_cast<double>(weight) / static_cast<double>(total)
+                                     : 1.0 / static_cast<double>(weights.size());
+            if (weights.size() == 1) {
+                share = 1.0;
+            }
+            limits.push_back(
+                {static_cast<uint64_t>(static_cast<double>(config_.max_entries) * share),
+                 static_cast<uint64_t>(static_cast<double>(config_.max_size_bytes) * share)});
+        }
+        return limits;
+    }
+
+    /// @brief Weigh databases by file size, without querying them
+    [[nodiscard]] static std::vector<uint64_t>
+    file_sizes(const std::vector<std::shared_ptr<CacheDatabase>>& databases) {
+        std::vector<uint64_t> sizes;
+        for (const auto& database : databases) {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(database->path(), ec);
+            sizes.push_back(ec ? 0 : size);
+        }
+        return sizes;
+    }
+
+    /// @brief Run a counting operation on each database and add up the counts
+    /// @return Total, or the first error (the other databases are still run)
+    template <typename Operation>
+    [[nodiscard]] static std::expected<uint64_t, CacheError>
+    sum_over(const std::vector<std::shared_ptr<CacheDatabase>>& databases, Operation operation) {
+        std::expected<uint64_t, CacheError> total = 0;
+        for (const auto& database : databases) {
+            auto count = operation(*database);
+            if (!count) {
+                if (total) {
+                    total = std::unexpected(count.error());
+                }
+            } else if (total) {
+                *total += *count;
+            }
+        }
+        return total;
+    }
+
+    /// @brief Callback adding the rows an async cleanup removed to the evictions
+    [[nodiscard]] AsyncCallback<uint64_t> count_evictions() {
+        return [this](std::expected<uint64_t, CacheError> result) {
+            if (result) {
+                std::lock_guard lock(memory_mutex_);
+                stats_.evictions += *result;
+            }
+        };
+    }
+
+    /// @brief Approximate memory footprint of a cached entry
+    [[nodiscard]] static size_t entry_cost(const ThumbnailEntry& entry) {
+        return sizeof(ThumbnailEntry) + entry.data.capacity() + entry.metadata.file_hash.size() +
+               entry.metadata.source_path.native().size() * sizeof(wchar_t);
+    }
+
+    /// @brief Insert into the memory tier (memory_mutex_ must be held)
+    void cache_in_memory(const std::string& key, std::shared_ptr<const ThumbnailEntry> entry) {
+        size_t cost = entry_cost(*entry);
+        stats_.memory_evictions += memory_cache_.put(key, std::move(entry), cost);
+        memory_charge_.set(memory_cache_.totalCost());
+    }
+
+    /// @brief Store the reduced levels of a freshly generated thumbnail
+    ///
+    /// Levels are scaled from the full-size thumbnail rather than the source, so
+    /// they cost a fraction of the decode that produced it. Levels the thumbnail
+    /// already fits in are skipped; lookups fall back to full size for them.
+    void put_mip_levels(CacheDatabase& database, const ThumbnailEntry& base,
+                        const image::DecodedImage& thumbnail,
+                        const std::optional<SourceStamp>& source) {
+        uint32_t extent = (std::max)(thumbnail.width(), thumbnail.height());
+        for (uint32_t level = 1; level < config_.mip_levels; ++level) {
+            uint32_t level_size = config_.mip_base_size >> level;
+            if (level_size == 0 || level_size >= extent) {
+                continue;
+            }
+
+            auto reduced = image::generateThumbnail(thumbnail, level_size);
+            if (!reduced) {
+                return;
+            }
+
+            const auto& metadata = base.metadata;
+            std::string key = mipLevelKey(metadata.file_hash, level_size);
+            auto built = buildEntry(key, metadata.source_path, *reduced, metadata.original_width,
+                                    metadata.original_height, source);
+            if (!metadata.content_hash.empty()) {
+                built.metadata.content_hash = mipLevelKey(metadata.content_hash, level_size);
+            }
+            auto entry = std::make_shared<const ThumbnailEntry>(std::move(built));
+            {
+                std::lock_guard lock(memory_mutex_);
+                cache_in_memory(key, entry);
+            }
+            (void)database.putDeferred(*entry);
+            note_disk_put();
+        }
+    }
+
+    /// @brief Queue a background eviction pass every kEvictionCheckPuts disk puts
+    ///
+    /// The pass does nothing while the cache is within its limits; one that is
+    /// still running is not queued again.
+    void note_disk_put() {
+        if (puts_since_eviction_.fetch_add(1, std::memory_order_relaxed) + 1 <
+            kEvictionCheckPuts) {
+            return;
+        }
+        puts_since_eviction_.store(0, std::memory_order_relaxed);
+        if (eviction_queued_.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        // Queued again once every shard's pass is done
+        auto databases = shards_->all();
+        auto limits = share_limits(file_sizes(databases));
+        auto pending = std::make_shared<std::atomic<size_t>>(databases.size());
+        for (size_t d = 0; d < databases.size(); ++d) {
+            databases[d]->evictOldestAsync(
+                limits[d].entries, limits[d].bytes,
+                [this, pending](std::expected<uint64_t, CacheError> result) {
+                    if (result) {
+                        std::lock_guard lock(memory_mutex_);
+                        stats_.evictions += *result;
+                    }
+                    if (pending->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        eviction_queued_.store(false, std::memory_order_release);
+                    }
+                });
+        }
+    }
+
+    /// @brief Cache key for path, using the stamp to avoid a stat when known
+    [[nodiscard]] static std::string key_for(const std::filesystem::path& path,
+                                             const std::optional<SourceStamp>& stamp) {
+        return stamp ? generateCacheKey(path, stamp->mtime, stamp->size_bytes)
+                     : generateCacheKey(path);
+    }
+
     [[nodiscard]] static ThumbnailEntry buildEntry(const std::string& key,
                                                    const std::filesystem::path& path,
                                                    const image::DecodedImage& thumbnail,
                                                    uint32_t original_width,
-                                                   uint32_t original_height) {
+                                                   uint32_t original_height,
+                                                   const std::optional<SourceStamp>& stamp) {
         ThumbnailEntry entry;
         entry.metadata.file_hash = key;
         entry.metadata.source_path = path;
@@ -398,10 +1126,9 @@ private:
         entry.metadata.original_height = original_height;
         entry.metadata.cached_at = std::chrono::system_clock::now();
 
-        std::error_code ec;
-        auto mtime = std::filesystem::last_write_time(path, ec);
-        if (!ec) {
-            entry.metadata.source_mtime = std::chrono::clock_cast<std::chrono::system_clock>(mtime);
+        // For archive entries this is the archive's mtime
+        if (stamp) {
+            entry.metadata.source_mtime = stamp->mtime;
         }
 
         entry.data.assign(thumbnail.pixels().begin(), thumbnail.pixels().end());
@@ -409,19 +1136,27 @@ private:
         return entry;
     }
 
-    [[nodiscard]] static image::DecodedImage convert_entry_to_image(const ThumbnailEntry& entry) {
-        std::vector<uint8_t> pixels(entry.data.begin(), entry.data.end());
-        uint32_t stride = (entry.metadata.width * 4 + 3) & ~3u;  // BGRA32
+    /// @brief Wrap a cached entry as an image sharing its pixel buffer (no copy)
+    [[nodiscard]] static image::DecodedImage
+    convert_entry_to_image(const std::shared_ptr<const ThumbnailEntry>& entry) {
+        uint32_t stride = (entry->metadata.width * 4 + 3) & ~3u;  // BGRA32
 
-        return image::DecodedImage(entry.metadata.width, entry.metadata.height,
+        // Aliasing constructor: the buffer keeps the whole entry alive
+        image::SharedPixels pixels(entry, &entry->data);
+        return image::DecodedImage(entry->metadata.width, entry->metadata.height,
                                    image::PixelFormat::BGRA32, stride, std::move(pixels));
     }
 
     CacheConfig config_;
-    std::unique_ptr<CacheDatabase> database_;
-    LruCache<std::string, ThumbnailEntry> memory_cache_;
-    std::mutex memory_mutex_;
+    std::unique_ptr<CacheShards> shards_;
+    std::unique_ptr<CacheDatabase> shared_tier_;  // Read-only, on a share; may be null
+    // Entries are immutable once inserted, so hits hand out shared views
+    LruCache<std::string, std::shared_ptr<const ThumbnailEntry>> memory_cache_;
+    MemoryCharge memory_charge_{MemoryCategory::CacheTier};  // Guarded by memory_mutex_
+    mutable std::mutex memory_mutex_;
     mutable CacheStats stats_;
+    std::atomic<uint32_t> puts_since_eviction_{0};
+    std::atomic<bool> eviction_queued_{false};
 };
 
 // Public interface
@@ -450,36 +1185,77 @@ bool CacheManager::isReady() const noexcept {
 }
 
 std::expected<image::DecodedImage, CacheError>
-CacheManager::getThumbnail(const std::filesystem::path& path) {
-    return impl_->getThumbnail(path);
+CacheManager::getThumbnail(const std::filesystem::path& path,
+                           const std::optional<SourceStamp>& stamp, uint32_t requested_size) {
+    return impl_->getThumbnail(path, stamp, requested_size);
 }
 
-bool CacheManager::hasThumbnail(const std::filesystem::path& path) {
-    return impl_->hasThumbnail(path);
+uint32_t CacheManager::thumbnailLevel(uint32_t requested_size) const noexcept {
+    return impl_->thumbnailLevel(requested_size);
 }
 
-std::expected<void, CacheError> CacheManager::putThumbnail(const std::filesystem::path& path,
-                                                           const image::DecodedImage& thumbnail,
-                                                           uint32_t original_width,
-                                                           uint32_t original_height) {
-    return impl_->putThumbnail(path, thumbnail, original_width, original_height);
+bool CacheManager::hasThumbnail(const std::filesystem::path& path,
+                                const std::optional<SourceStamp>& stamp) {
+    return impl_->hasThumbnail(path, stamp);
+}
+
+std::expected<void, CacheError>
+CacheManager::putThumbnail(const std::filesystem::path& path, const image::DecodedImage& thumbnail,
+                           uint32_t original_width, uint32_t original_height,
+                           const std::optional<SourceStamp>& stamp,
+                           const std::string& content_hash,
+                           std::optional<uint64_t> perceptual_hash) {
+    return impl_->putThumbnail(path, thumbnail, original_width, original_height, stamp,
+                               content_hash, perceptual_hash);
+}
+
+std::expected<image::DecodedImage, CacheError>
+CacheManager::getThumbnailByContent(const std::filesystem::path& path,
+                                    const std::string& content_hash,
+                                    const std::optional<SourceStamp>& stamp) {
+    return impl_->getThumbnailByContent(path, content_hash, stamp);
 }
 
 std::optional<ImageResolution>
-CacheManager::getImageResolution(const std::filesystem::path& path) {
-    return impl_->getImageResolution(path);
+CacheManager::getImageResolution(const std::filesystem::path& path,
+                                 const std::optional<SourceStamp>& stamp) {
+    return impl_->getImageResolution(path, stamp);
+}
+
+std::vector<std::optional<ImageResolution>>
+CacheManager::getImageResolutions(const std::vector<fs::FileMetadata>& files) {
+    return impl_->getImageResolutions(files);
+}
+
+void CacheManager::fillCaptureInfo(std::vector<fs::FileMetadata>& files, std::stop_token stop) {
+    impl_->fillCaptureInfo(files, std::move(stop));
 }
 
 void CacheManager::removeThumbnail(const std::filesystem::path& path) {
     impl_->removeThumbnail(path);
 }
 
+void CacheManager::invalidate(const std::vector<std::filesystem::path>& paths) {
+    impl_->invalidate(paths);
+}
+
+void CacheManager::rekey(
+    const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& moves) {
+    impl_->rekey(moves);
+}
+
 void CacheManager::getThumbnailAsync(
     const std::filesystem::path& path,
     std::function<void(std::expected<image::DecodedImage, CacheError>)> callback) {
     impl_->getThumbnailAsync(path, std::move(callback));
 }
 
+Task<std::expected<image::DecodedImage, CacheError>>
+CacheManager::getThumbnailAsync(std::filesystem::path path) {
+    co_return co_await awaitCallback<std::expected<image::DecodedImage, CacheError>>(
+        [this, &path](auto done) { impl_->getThumbnailAsync(path, std::move(done)); });
+}
+
 void CacheManager::putThumbnailAsync(
     const std::filesystem::path& path, image::DecodedImage thumbnail, uint32_t original_width,
     uint32_t original_height, std::function<void(std::expected<void, CacheError>)> callback) {
@@ -491,6 +1267,10 @@ void CacheManager::clearMemoryCache() {
     impl_->clearMemoryCache();
 }
 
+uint64_t CacheManager::trimMemoryCache(double keep_fraction) {
+    return impl_->trimMemoryCache(keep_fraction);
+}
+
 std::expected<uint64_t, CacheError> CacheManager::clearAll() {
     return impl_->clearAll();
 }
@@ -507,17 +1287,69 @@ std::expected<uint64_t, CacheError> CacheManager::enforceLimits() {
     return impl_->enforceLimits();
 }
 
+void CacheManager::scheduleMaintenance() {
+    impl_->scheduleMaintenance();
+}
+
 CacheStats CacheManager::getStats() const {
     return impl_->getStats();
 }
 
+CacheStats CacheManager::getRuntimeStats() const {
+    return impl_->getRuntimeStats();
+}
+
+std::expected<std::vector<SourceHash>, CacheError> CacheManager::getPerceptualHashes() {
+    return impl_->getPerceptualHashes();
+}
+
+std::expected<uint64_t, CacheError> CacheManager::dropVolume(const std::filesystem::path& volume) {
+    return impl_->dropVolume(volume);
+}
+
+std::expected<bool, CacheError>
+CacheManager::relocate(const std::filesystem::path& database_path, std::stop_token stop) {
+    return impl_->relocate(database_path, std::move(stop));
+}
+
+std::filesystem::path CacheManager::databasePath() {
+    return impl_->databasePath();
+}
+
 std::expected<void, CacheError> CacheManager::compact() {
     return impl_->compact();
 }
 
+std::optional<std::vector<uint8_t>>
+CacheManager::getArchiveListing(const std::filesystem::path& archive_path, uint64_t write_time,
+                                uint64_t file_size) {
+    return impl_->getArchiveListing(archive_path, write_time, file_size);
+}
+
+void CacheManager::putArchiveListing(const std::filesystem::path& archive_path,
+                                     uint64_t write_time, uint64_t file_size,
+                                     const std::vector<uint8_t>& listing) {
+    impl_->putArchiveListing(archive_path, write_time, file_size, listing);
+}
+
+std::optional<StoredListing>
+CacheManager::getDirectoryListing(const std::filesystem::path& directory, uint32_t options) {
+    return impl_->getDirectoryListing(directory, options);
+}
+
+void CacheManager::putDirectoryListing(const std::filesystem::path& directory, uint32_t options,
+                                       const StoredListing& listing) {
+    impl_->putDirectoryListing(directory, options, listing);
+}
+
 void CacheManager::prefetch(const std::filesystem::path& directory,
                             std::function<void(const std::filesystem::path&)> callback) {
     impl_->prefetch(directory, std::move(callback));
 }
 
+uint64_t CacheManager::prefetch(const std::vector<fs::FileMetadata>& files, uint64_t max_bytes,
+                                uint32_t requested_size) {
+    return impl_->prefetch(files, max_bytes, requested_size);
+}
+
 }  // namespace nive::cache
@@ -4,6 +4,9 @@
 /// Provides a two-tier caching system:
 /// 1. LRU memory cache for fast access
 /// 2. Persistent database for disk storage
+///
+/// An optional read-only shared tier (a team cache on a share) is consulted
+/// after the disk tier; what it serves is copied to the disk tier.
 
 #pragma once
 
@@ -12,8 +15,11 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <stop_token>
+#include <vector>
 
 #include "../image/decoded_image.hpp"
+#include "../util/task.hpp"
 #include "cache_database.hpp"
 #include "cache_error.hpp"
 #include "thumbnail_data.hpp"
@@ -24,6 +30,7 @@ namespace nive::cache {
 struct ImageResolution {
     uint32_t width = 0;
     uint32_t height = 0;
+    std::optional<uint32_t> average_color;  // 0xRRGGBB of the cached thumbnail, if known
 };
 
 /// @brief High-level cache manager
@@ -32,6 +39,19 @@ struct ImageResolution {
 /// - Fast LRU memory cache
 /// - Persistent database cache
 ///
+/// With CacheConfig::shared_database_path set, a database on a share
+/// (for example one filled by nive --pregenerate) is opened read-only as a
+/// third tier. A lookup the local tiers miss tries it, and a hit is stored
+/// in the local disk tier, so each machine reads a thumbnail over the
+/// network once and decodes nothing. Keys include the source path, so
+/// machines must reach the library under the same path (a UNC path is
+/// safest). An unreachable share leaves the tier out.
+///
+/// The disk tier is sharded by volume (see CacheShards): removable drives
+/// and network shares each get a database of their own, opened on first
+/// use. Limits apply to the shards together; the orphan sweep only visits
+/// the shards of volumes used since startup.
+///
 /// Thread-safe for all operations.
 class CacheManager {
 public:
@@ -59,41 +79,111 @@ public:
 
     /// @brief Get cached thumbnail for a file
     /// @param path Source file path
+    /// @param stamp Known mtime/size of the source (skips the stat when given)
+    /// @param requested_size Display size the image is for (0 = full size)
     /// @return Decoded thumbnail image or error
     ///
-    /// Checks memory cache first, then disk cache.
-    /// Returns NotFound if not cached.
+    /// Checks memory cache first, then disk cache, then the shared tier. With
+    /// mipmap levels enabled, returns the level chosen by thumbnailLevel(),
+    /// falling back to full size. Returns NotFound if not cached.
     [[nodiscard]] std::expected<image::DecodedImage, CacheError>
-    getThumbnail(const std::filesystem::path& path);
+    getThumbnail(const std::filesystem::path& path,
+                 const std::optional<SourceStamp>& stamp = std::nullopt,
+                 uint32_t requested_size = 0);
+
+    /// @brief Nominal size of the stored level that serves a display size
+    /// @param requested_size Display size (0 = full size)
+    /// @return Smallest level not smaller than requested_size; the full size
+    ///         when mipmap levels are disabled
+    [[nodiscard]] uint32_t thumbnailLevel(uint32_t requested_size) const noexcept;
 
     /// @brief Check if thumbnail is cached
     /// @param path Source file path
-    /// @return true if cached (memory or disk)
-    [[nodiscard]] bool hasThumbnail(const std::filesystem::path& path);
+    /// @param stamp Known mtime/size of the source (skips the stat when given)
+    /// @return true if cached (memory, disk or shared tier)
+    [[nodiscard]] bool hasThumbnail(const std::filesystem::path& path,
+                                    const std::optional<SourceStamp>& stamp = std::nullopt);
 
     /// @brief Store thumbnail in cache
     /// @param path Source file path
     /// @param thumbnail Thumbnail image to cache
     /// @param original_width Original image width
     /// @param original_height Original image height
+    /// @param stamp Known mtime/size of the source (skips the stat when given)
+    /// @param content_hash Content fingerprint; when set, the payload is stored
+    ///        once and shared with other files of identical content
+    /// @param perceptual_hash Perceptual hash of the thumbnail (see image::differenceHash)
     /// @return Success or error
     ///
-    /// Stores in both memory and disk cache.
-    [[nodiscard]] std::expected<void, CacheError> putThumbnail(const std::filesystem::path& path,
-                                                               const image::DecodedImage& thumbnail,
-                                                               uint32_t original_width,
-                                                               uint32_t original_height);
+    /// Stores in both memory and disk cache. With mipmap levels enabled, the
+    /// reduced levels are scaled from thumbnail and stored alongside it. The
+    /// thumbnail's average colour is kept in the metadata for placeholders.
+    [[nodiscard]] std::expected<void, CacheError>
+    putThumbnail(const std::filesystem::path& path, const image::DecodedImage& thumbnail,
+                 uint32_t original_width, uint32_t original_height,
+                 const std::optional<SourceStamp>& stamp = std::nullopt,
+                 const std::string& content_hash = {},
+                 std::optional<uint64_t> perceptual_hash = std::nullopt);
+
+    /// @brief Get a thumbnail stored for another file with identical content
+    /// @param path Source file path
+    /// @param content_hash Content fingerprint (see contentFingerprint)
+    /// @param stamp Known mtime/size of the source (skips the stat when given)
+    /// @return Decoded thumbnail image, or NotFound if no file with this
+    ///         content has been cached
+    ///
+    /// On a hit the path gets its own cache entry that references the shared
+    /// payload, so later lookups by path hit directly.
+    [[nodiscard]] std::expected<image::DecodedImage, CacheError>
+    getThumbnailByContent(const std::filesystem::path& path, const std::string& content_hash,
+                          const std::optional<SourceStamp>& stamp = std::nullopt);
 
     /// @brief Get original image resolution from cache
     /// @param path Source file path
+    /// @param stamp Known mtime/size of the source (skips the stat when given)
     /// @return Resolution if cached, nullopt otherwise
     [[nodiscard]] std::optional<ImageResolution>
-    getImageResolution(const std::filesystem::path& path);
+    getImageResolution(const std::filesystem::path& path,
+                       const std::optional<SourceStamp>& stamp = std::nullopt);
+
+    /// @brief Get original resolutions for a listing with one metadata query
+    /// @param files Files to look up (non-images are skipped)
+    /// @return One element per file; nullopt where not cached
+    ///
+    /// Reads only cache metadata, never pixel data, so a whole directory's
+    /// resolution column can be filled up front.
+    [[nodiscard]] std::vector<std::optional<ImageResolution>>
+    getImageResolutions(const std::vector<fs::FileMetadata>& files);
+
+    /// @brief Fill in the EXIF capture date and camera of a listing
+    /// @param files Files to fill (date_taken and camera_model are set)
+    /// @param stop Stops reading headers; files not yet read keep empty fields
+    ///
+    /// Stored values come from one query; the headers of the rest are read
+    /// in parallel (see image::readCaptureInfo) and stored under the files'
+    /// cache keys, so a folder's headers are only read on its first visit.
+    /// Archive entries and formats without EXIF are skipped.
+    void fillCaptureInfo(std::vector<fs::FileMetadata>& files, std::stop_token stop = {});
 
     /// @brief Remove thumbnail from cache
     /// @param path Source file path
     void removeThumbnail(const std::filesystem::path& path);
 
+    /// @brief Drop disk cache entries made stale by file system changes
+    /// @param paths Changed, renamed or deleted files (archives cover their entries)
+    ///
+    /// Rows for a file's current contents are kept. Runs on the cache I/O
+    /// thread; memory entries are left to age out, as their keys no longer match.
+    void invalidate(const std::vector<std::filesystem::path>& paths);
+
+    /// @brief Carry disk cache entries over to renamed or moved files
+    /// @param moves (old path, new path) of each file or directory, after the move
+    ///
+    /// Entries of files whose contents are unchanged are rekeyed in place, so
+    /// nothing is decoded again at the new location; the rest are dropped.
+    /// Runs on the cache I/O thread, ahead of any invalidation queued later.
+    void rekey(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& moves);
+
     /// @brief Get thumbnail asynchronously
     /// @param path Source file path
     /// @param callback Called with result
@@ -101,16 +191,57 @@ public:
     getThumbnailAsync(const std::filesystem::path& path,
                       std::function<void(std::expected<image::DecodedImage, CacheError>)> callback);
 
+    /// @brief Awaitable getThumbnailAsync
+    ///
+    /// Resumes on the calling thread for a memory hit, else on the cache I/O thread.
+    [[nodiscard]] Task<std::expected<image::DecodedImage, CacheError>>
+    getThumbnailAsync(std::filesystem::path path);
+
     /// @brief Store thumbnail asynchronously
     void putThumbnailAsync(const std::filesystem::path& path, image::DecodedImage thumbnail,
                            uint32_t original_width, uint32_t original_height,
                            std::function<void(std::expected<void, CacheError>)> callback);
 
+    // ===== Archive Listings =====
+
+    /// @brief Get the stored listing of an archive
+    /// @param archive_path Archive file path
+    /// @param write_time Archive last write time (FILETIME ticks)
+    /// @param file_size Archive size in bytes
+    /// @return Listing bytes, or nullopt if none was stored for this archive state
+    [[nodiscard]] std::optional<std::vector<uint8_t>>
+    getArchiveListing(const std::filesystem::path& archive_path, uint64_t write_time,
+                      uint64_t file_size);
+
+    /// @brief Store the listing of an archive (see archive::encodeListing)
+    void putArchiveListing(const std::filesystem::path& archive_path, uint64_t write_time,
+                           uint64_t file_size, const std::vector<uint8_t>& listing);
+
+    // ===== Directory Listings =====
+
+    /// @brief Get the snapshot of a directory listing (see fs::encodeSnapshot)
+    /// @param directory Directory path
+    /// @param options Filter and sort order (see fs::snapshotOptions)
+    /// @return Snapshot, or nullopt if none was stored for these options
+    [[nodiscard]] std::optional<StoredListing>
+    getDirectoryListing(const std::filesystem::path& directory, uint32_t options);
+
+    /// @brief Store the snapshot of a directory listing
+    void putDirectoryListing(const std::filesystem::path& directory, uint32_t options,
+                             const StoredListing& listing);
+
     // ===== Cache Management =====
 
     /// @brief Clear memory cache only
     void clearMemoryCache();
 
+    /// @brief Evict the least recently used memory entries, keeping a fraction of the bytes
+    /// @param keep_fraction Share of the memory tier's bytes to keep (0 to 1)
+    /// @return Bytes evicted
+    ///
+    /// For memory pressure; the entries stay on disk and the budget is unchanged.
+    uint64_t trimMemoryCache(double keep_fraction);
+
     /// @brief Clear all caches (memory and disk)
     /// @return Number of entries cleared
     [[nodiscard]] std::expected<uint64_t, CacheError> clearAll();
@@ -123,13 +254,54 @@ public:
     /// @return Number of entries removed
     [[nodiscard]] std::expected<uint64_t, CacheError> cleanupOrphaned();
 
+    /// @brief Delete the disk cache of the removable drive or share a path is on
+    /// @param volume Any path on the volume
+    /// @return Number of shards deleted (0 for fixed drives, whose thumbnails
+    ///         share the main database), or DatabaseError
+    ///
+    /// Deletes the volume's shard directory rather than its rows, so the cost
+    /// does not grow with the entries. Memory entries are left to age out.
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    dropVolume(const std::filesystem::path& volume);
+
+    /// @brief Move the disk cache (main database and volume shards) elsewhere
+    /// @param database_path New CacheConfig::database_path
+    /// @param stop Abandons the move, leaving the cache where it was
+    /// @return true once moved, false if stopped, or the error (the cache
+    ///         then stays where it was)
+    ///
+    /// Blocks until done; run it on a thread of its own. Lookups and writes
+    /// go to the old location until the copies are complete, then to the
+    /// new one. The shared tier and memory tier are not affected.
+    [[nodiscard]] std::expected<bool, CacheError>
+    relocate(const std::filesystem::path& database_path, std::stop_token stop);
+
+    /// @brief Get the CacheConfig::database_path in use (empty if none is open)
+    [[nodiscard]] std::filesystem::path databasePath();
+
     /// @brief Enforce size limits (evict oldest entries)
     /// @return Number of entries evicted
     [[nodiscard]] std::expected<uint64_t, CacheError> enforceLimits();
 
+    /// @brief Queue expiry, limit enforcement and the orphan sweep
+    ///
+    /// Runs on the cache I/O thread at background priority, in batches that
+    /// interleave with thumbnail reads and writes. Returns immediately.
+    void scheduleMaintenance();
+
     /// @brief Get cache statistics
     [[nodiscard]] CacheStats getStats() const;
 
+    /// @brief Get hit, miss and memory tier statistics, without querying the database
+    ///
+    /// The disk totals and entry times are left empty; cheap enough to poll.
+    [[nodiscard]] CacheStats getRuntimeStats() const;
+
+    /// @brief Get the perceptual hash of every cached source that has one
+    ///
+    /// Reads the disk cache's metadata only; no pixel data is loaded.
+    [[nodiscard]] std::expected<std::vector<SourceHash>, CacheError> getPerceptualHashes();
+
     /// @brief Compact database (vacuum)
     [[nodiscard]] std::expected<void, CacheError> compact();
 
@@ -141,6 +313,18 @@ public:
     void prefetch(const std::filesystem::path& directory,
                   std::function<void(const std::filesystem::path&)> callback = nullptr);
 
+    /// @brief Bulk-load cached thumbnails for a listing into the memory cache
+    /// @param files Files in display order (non-images are skipped)
+    /// @param max_bytes Pixel data budget (0 = memory cache capacity)
+    /// @param requested_size Display size; selects the mipmap level (0 = full size)
+    /// @return Bytes of pixel data loaded
+    ///
+    /// Issues one database query for all keys that are not already in memory,
+    /// so later lookups for these files are memory hits. Keys derive from the
+    /// metadata, so no file is touched. Earlier files win when over budget.
+    uint64_t prefetch(const std::vector<fs::FileMetadata>& files, uint64_t max_bytes = 0,
+                      uint32_t requested_size = 0);
+
 private:
     CacheManager();
 
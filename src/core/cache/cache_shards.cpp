@@ -0,0 +1,351 @@
+/// @file cache_shards.cpp
+/// @brief Per-volume cache database shards
+
+#include "cache_shards.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <format>
+#include <ranges>
+#include <thread>
+
+#include "../fs/io_scheduler.hpp"
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+
+namespace nive::cache {
+
+namespace {
+
+// A drive letter may be given to another stick; its shard is looked up again
+constexpr std::chrono::seconds kDriveResolveInterval{10};
+
+// How long a relocation waits for the old databases to be released
+constexpr std::chrono::seconds kRetireTimeout{10};
+
+[[nodiscard]] bool is_unc(std::wstring_view volume) noexcept {
+    return volume.size() > 2 && (volume[0] == L'\\' || volume[0] == L'/') &&
+           (volume[1] == L'\\' || volume[1] == L'/');
+}
+
+/// @brief Directory-safe form of a lowercase share name
+[[nodiscard]] std::string sanitized(std::string_view name) {
+    std::string out;
+    out.reserve(name.size());
+    for (char c : name) {
+        bool keep = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '_';
+        out.push_back(keep ? c : '-');
+    }
+    return out;
+}
+
+}  // namespace
+
+std::string shardNameOf(const std::filesystem::path& path) {
+    std::wstring volume = fs::volumeName(path);
+    if (is_unc(volume)) {
+        return "share-" + sanitized(wideToUtf8OrEmpty(std::wstring_view(volume).substr(2)));
+    }
+    if (volume.size() != 2 || volume[1] != L':') {
+        return {};
+    }
+
+    std::wstring root = volume + L"\\";
+    switch (GetDriveTypeW(root.c_str())) {
+    case DRIVE_REMOVABLE:
+    case DRIVE_CDROM:
+    case DRIVE_REMOTE:
+        break;
+    default:
+        return {};
+    }
+    DWORD serial = 0;
+    if (!GetVolumeInformationW(root.c_str(), nullptr, 0, &serial, nullptr, nullptr, nullptr, 0)) {
+        return {};
+    }
+    return std::format("volume-{:08x}", serial);
+}
+
+CacheShards::CacheShards(const CacheConfig& config)
+    : config_(config), shard_root_(shard_root_of(config.database_path)) {}
+
+CacheShards::~CacheShards() = default;
+
+std::expected<std::unique_ptr<CacheShards>, CacheError>
+CacheShards::open(const CacheConfig& config) {
+    auto shards = std::unique_ptr<CacheShards>(new CacheShards(config));
+    auto main = CacheDatabase::open(
+        config.database_path,
+        PayloadOptions{.compression_level = config.compression_level,
+                       .jpeg_quality = config.jpeg_quality,
+                       .train_dictionary = config.zstd_dictionary},
+        config.storage_backend, config.sqlite);
+    if (!main) {
+        return std::unexpected(main.error());
+    }
+    shards->main_ = std::move(*main);
+    return shards;
+}
+
+std::shared_ptr<CacheDatabase> CacheShards::main() {
+    std::lock_guard lock(mutex_);
+    return main_;
+}
+
+std::filesystem::path CacheShards::databasePath() {
+    std::lock_guard lock(mutex_);
+    return config_.database_path;
+}
+
+std::shared_ptr<CacheDatabase> CacheShards::forPath(const std::filesystem::path& path) {
+    std::unique_lock lock(mutex_);
+    std::string name = shard_name(path, lock);
+    if (name.empty()) {
+        return main_;
+    }
+    used_.insert(name);
+    if (auto it = shards_.find(name); it != shards_.end()) {
+        return it->second;
+    }
+    auto shard = open_shard(name);
+    // A shard that cannot be opened is not retried for every lookup
+    return shards_.emplace(name, shard ? shard : main_).first->second;
+}
+
+std::vector<std::shared_ptr<CacheDatabase>> CacheShards::all() {
+    std::lock_guard lock(mutex_);
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(shard_root_, ec)) {
+        std::string name = pathToUtf8(entry.path().filename());
+        if (entry.is_directory(ec) && !shards_.contains(name)) {
+            if (auto shard = open_shard(name)) {
+                shards_.emplace(std::move(name), std::move(shard));
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<CacheDatabase>> databases{main_};
+    for (const auto& [name, shard] : shards_) {
+        if (shard != main_) {
+            databases.push_back(shard);
+        }
+    }
+    return databases;
+}
+
+std::vector<std::shared_ptr<CacheDatabase>> CacheShards::used() {
+    std::lock_guard lock(mutex_);
+    std::vector<std::shared_ptr<CacheDatabase>> databases{main_};
+    for (const auto& name : used_) {
+        if (auto it = shards_.find(name); it != shards_.end() && it->second != main_) {
+            databases.push_back(it->second);
+        }
+    }
+    return databases;
+}
+
+std::expected<uint64_t, CacheError> CacheShards::dropVolume(const std::filesystem::path& path) {
+    std::unique_lock lock(mutex_);
+    std::string name = shard_name(path, lock);
+    if (name.empty()) {
+        return 0;
+    }
+
+    // Closed before its files go; held under the lock so no lookup reopens it
+    if (auto it = shards_.find(name); it != shards_.end()) {
+        auto shard = std::move(it->second);
+        shards_.erase(it);
+        if (shard && shard != main_) {
+            shard->flush();
+        }
+    }
+    used_.erase(name);
+
+    std::error_code ec;
+    auto removed = std::filesystem::remove_all(shard_root_ / name, ec);
+    if (ec) {
+        LOG_WARN("Failed to drop cache shard {}: {}", name, ec.message());
+        return std::unexpected(CacheError::DatabaseError);
+    }
+    return removed > 0 ? 1 : 0;
+}
+
+std::expected<bool, CacheError> CacheShards::relocate(const std::filesystem::path& database_path,
+                                                      std::stop_token stop) {
+    auto old_path = databasePath();
+    if (database_path == old_path) {
+        return true;
+    }
+
+    // Every copy made beside the one it replaces, main database first
+    struct Move {
+        std::shared_ptr<CacheDatabase> database;
+        std::filesystem::path destination;
+        bool started = false;
+        bool done = false;
+    };
+    std::vector<Move> moves;
+    auto new_root = shard_root_of(database_path);
+    for (auto& database : all()) {
+        std::filesystem::path destination = CacheDatabase::filePath(database_path);
+        if (!moves.empty()) {
+            // The shard's name is its directory below the shard root
+            auto name = database->path().parent_path().filename();
+            destination =
+                CacheDatabase::filePath(new_root / name / database_path.filename());
+        }
+        moves.push_back(Move{std::move(database), std::move(destination)});
+    }
+    auto abandon = [&moves] {
+        for (auto& move : moves) {
+            if (move.started) {
+                move.database->cancelCopy();
+            }
+        }
+    };
+
+    LOG_INFO("Moving cache from {} to {}", pathToUtf8(old_path), pathToUtf8(database_path));
+    for (auto& move : moves) {
+        if (auto started = move.database->startCopy(move.destination); !started) {
+            abandon();
+            return std::unexpected(started.error());
+        }
+        move.started = true;
+    }
+    for (bool copying = true; copying;) {
+        copying = false;
+        for (auto& move : moves) {
+            if (move.done) {
+                continue;
+            }
+            auto slot =
+                fs::IoScheduler::instance().acquire(move.destination, fs::IoPriority::Background,
+                                                    stop);
+            if (!slot || stop.stop_requested()) {
+                abandon();
+                return false;
+            }
+            auto more = move.database->copyStep();
+            if (!more) {
+                LOG_WARN("Failed to copy cache database {}: {}",
+                         pathToUtf8(move.database->path()), to_string(more.error()));
+                abandon();
+                return std::unexpected(more.error());
+            }
+            move.done = !*more;
+            copying = copying || *more;
+        }
+    }
+    // Shards first: a main database at the new location marks the move complete
+    for (auto& move : moves | std::views::reverse) {
+        if (auto finished = move.database->finishCopy(); !finished) {
+            move.started = false;
+            abandon();
+            return std::unexpected(finished.error());
+        }
+        move.started = false;
+    }
+
+    // Shards reopen from the new root on their next lookup
+    auto main = CacheDatabase::open(
+        database_path,
+        PayloadOptions{.compression_level = config_.compression_level,
+                       .jpeg_quality = config_.jpeg_quality,
+                       .train_dictionary = config_.zstd_dictionary},
+        config_.storage_backend, config_.sqlite);
+    if (!main) {
+        LOG_ERROR("Failed to open moved cache {}: {}", pathToUtf8(database_path),
+                  to_string(main.error()));
+        return std::unexpected(main.error());
+    }
+    std::vector<std::weak_ptr<CacheDatabase>> retired;
+    for (auto& move : moves) {
+        retired.push_back(move.database);
+    }
+    moves.clear();
+    {
+        std::lock_guard lock(mutex_);
+        main_ = std::move(*main);
+        shards_.clear();
+        config_.database_path = database_path;
+        shard_root_ = new_root;
+    }
+    LOG_INFO("Cache moved to {}", pathToUtf8(database_path));
+
+    // The old files go once the lookups and queued jobs holding them end
+    auto deadline = std::chrono::steady_clock::now() + kRetireTimeout;
+    while (std::ranges::any_of(retired, [](const auto& weak) { return !weak.expired(); })) {
+        if (std::chrono::steady_clock::now() > deadline || stop.stop_requested()) {
+            LOG_WARN("Old cache {} still in use; left in place", pathToUtf8(old_path));
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    remove_files(old_path);
+    return true;
+}
+
+std::filesystem::path CacheShards::shard_root_of(const std::filesystem::path& database_path) {
+    return database_path.parent_path() / (database_path.filename().wstring() + L".volumes");
+}
+
+void CacheShards::remove_files(const std::filesystem::path& database_path) {
+    std::error_code ec;
+    if (std::filesystem::remove_all(shard_root_of(database_path), ec); ec) {
+        LOG_WARN("Failed to remove old cache shards: {}", ec.message());
+    }
+
+    // Beside the database may be other files of the application (a library)
+    auto file = CacheDatabase::filePath(database_path);
+    std::wstring stem = file.stem().wstring();
+    std::wstring db_name = file.filename().wstring();
+    for (const auto& entry : std::filesystem::directory_iterator(file.parent_path(), ec)) {
+        std::wstring name = entry.path().filename().wstring();
+        bool pack = entry.path().extension() == L".pack" && name.starts_with(stem + L"-");
+        if (pack || name == db_name || name == db_name + L"-wal" || name == db_name + L"-shm") {
+            std::error_code remove_ec;
+            if (!std::filesystem::remove(entry.path(), remove_ec) && remove_ec) {
+                LOG_WARN("Failed to remove old cache file {}: {}", pathToUtf8(entry.path()),
+                         remove_ec.message());
+            }
+        }
+    }
+}
+
+std::string CacheShards::shard_name(const std::filesystem::path& path,
+                                    std::unique_lock<std::mutex>& lock) {
+    std::wstring volume = fs::volumeName(path);
+    auto now = std::chrono::steady_clock::now();
+    if (auto it = volumes_.find(volume); it != volumes_.end() && it->second.expires > now) {
+        return it->second.shard;
+    }
+
+    // The drive queries can block (e.g. a spun-down disk); lookups on other
+    // volumes go on meanwhile
+    lock.unlock();
+    std::string shard = shardNameOf(path);
+    lock.lock();
+
+    auto expires = is_unc(volume) ? std::chrono::steady_clock::time_point::max()
+                                  : now + kDriveResolveInterval;
+    volumes_.insert_or_assign(std::move(volume), Resolved{shard, expires});
+    return shard;
+}
+
+std::shared_ptr<CacheDatabase> CacheShards::open_shard(const std::string& name) {
+    auto path = shard_root_ / utf8ToWideOrEmpty(name) / config_.database_path.filename();
+    auto shard = CacheDatabase::open(
+        path,
+        PayloadOptions{.compression_level = config_.compression_level,
+                       .jpeg_quality = config_.jpeg_quality,
+                       .train_dictionary = config_.zstd_dictionary},
+        config_.storage_backend, config_.sqlite);
+    if (!shard) {
+        LOG_WARN("Failed to open cache shard {}: {}", pathToUtf8(path), to_string(shard.error()));
+        return nullptr;
+    }
+    LOG_DEBUG("Opened cache shard {}", pathToUtf8(path));
+    return std::move(*shard);
+}
+
+}  // namespace nive::cache
@@ -0,0 +1,133 @@
+/// @file cache_shards.hpp
+/// @brief Disk tier split into one database per removable or network volume
+///
+/// Thumbnails of fixed local drives stay in the main database. Each
+/// removable drive (by volume serial) and each network share (by
+/// \\server\share, or a mapped drive's serial) gets a database of its own
+/// beside it, opened on first use. Shards keep their own writer thread and
+/// WAL, so writes for different volumes do not queue behind each other, and
+/// a volume's thumbnails can be dropped by deleting its shard directory.
+
+#pragma once
+
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cache_database.hpp"
+#include "cache_error.hpp"
+#include "thumbnail_data.hpp"
+
+namespace nive::cache {
+
+/// @brief Name of the shard holding a path's thumbnails
+/// @return "volume-<serial>" or "share-<server>-<share>", or empty for the
+///         main database (fixed drives, and volumes that cannot be queried)
+///
+/// Queries the drive type and, for removable and mapped drives, the volume
+/// serial. Not cached; CacheShards caches per drive letter.
+[[nodiscard]] std::string shardNameOf(const std::filesystem::path& path);
+
+/// @brief The main cache database and the volume shards beside it
+///
+/// Thread-safe. Databases are handed out as shared pointers, so a shard
+/// dropped while a lookup still uses it closes once that lookup is done.
+class CacheShards {
+public:
+    /// @brief Open the main database; shards open on first use
+    /// @param config Cache configuration (database_path, payload and SQLite settings)
+    /// @return Shard set, or the error opening the main database
+    [[nodiscard]] static std::expected<std::unique_ptr<CacheShards>, CacheError>
+    open(const CacheConfig& config);
+
+    ~CacheShards();
+
+    // Non-copyable, non-movable
+    CacheShards(const CacheShards&) = delete;
+    CacheShards& operator=(const CacheShards&) = delete;
+    CacheShards(CacheShards&&) = delete;
+    CacheShards& operator=(CacheShards&&) = delete;
+
+    /// @brief Get the main database (fixed local drives)
+    [[nodiscard]] std::shared_ptr<CacheDatabase> main();
+
+    /// @brief Get the CacheConfig::database_path in use (changed by relocate())
+    [[nodiscard]] std::filesystem::path databasePath();
+
+    /// @brief Get the database for a source path, opening its shard if needed
+    ///
+    /// Virtual archive paths go with their archive. A shard that cannot be
+    /// opened falls back to the main database.
+    [[nodiscard]] std::shared_ptr<CacheDatabase> forPath(const std::filesystem::path& path);
+
+    /// @brief Get every database, opening the shards stored on disk
+    ///
+    /// For expiry, limits, statistics and clearing; only local cache files
+    /// are opened, never the volumes themselves.
+    [[nodiscard]] std::vector<std::shared_ptr<CacheDatabase>> all();
+
+    /// @brief Get the main database and the shards used since startup
+    ///
+    /// For the orphan sweep, which has to query every source file: volumes
+    /// not seen this session may be unplugged or offline.
+    [[nodiscard]] std::vector<std::shared_ptr<CacheDatabase>> used();
+
+    /// @brief Delete the shard of the volume a path is on
+    /// @return Number of shards deleted (0 for the main database's volumes),
+    ///         or DatabaseError if its files could not be removed
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    dropVolume(const std::filesystem::path& path);
+
+    /// @brief Move the main database and every shard to another location
+    /// @param database_path New CacheConfig::database_path
+    /// @param stop Abandons the move; the databases stay where they were
+    /// @return true once the move is complete, false if stopped, or the error
+    ///         copying or opening a database (the old location stays in use)
+    ///
+    /// Blocks while the databases are copied a part at a time (at background
+    /// I/O priority), serving lookups and writes from the old location.
+    /// The new databases take their place at once when all are copied;
+    /// puts still queued for the old ones then are lost. The old files are
+    /// deleted once the lookups using them are done.
+    [[nodiscard]] std::expected<bool, CacheError>
+    relocate(const std::filesystem::path& database_path, std::stop_token stop);
+
+private:
+    explicit CacheShards(const CacheConfig& config);
+
+    /// @brief Resolve a path's shard name, cached per volume (mutex_ held)
+    [[nodiscard]] std::string shard_name(const std::filesystem::path& path,
+                                         std::unique_lock<std::mutex>& lock);
+
+    /// @brief Open a shard by name (mutex_ held); nullptr if it cannot be opened
+    [[nodiscard]] std::shared_ptr<CacheDatabase> open_shard(const std::string& name);
+
+    /// @brief Root of the shard directories beside a main database path
+    [[nodiscard]] static std::filesystem::path
+    shard_root_of(const std::filesystem::path& database_path);
+
+    /// @brief Remove the files of a main database and its shards
+    static void remove_files(const std::filesystem::path& database_path);
+
+    struct Resolved {
+        std::string shard;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    CacheConfig config_;  // database_path changed by relocate() under mutex_
+    std::filesystem::path shard_root_;  // One directory per shard
+    std::shared_ptr<CacheDatabase> main_;
+    std::mutex mutex_;
+    std::unordered_map<std::wstring, Resolved> volumes_;  // By fs::volumeName
+    std::unordered_map<std::string, std::shared_ptr<CacheDatabase>> shards_;
+    std::unordered_set<std::string> used_;  // Shards reached since startup
+};
+
+}  // namespace nive::cache
@@ -0,0 +1,567 @@
+/// @file pack_store.cpp
+/// @brief Memory-mapped, append-only thumbnail payload store
+
+#include "pack_store.hpp"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string>
+
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+#include "../util/win32_utils.hpp"
+
+namespace nive::cache {
+
+namespace {
+
+constexpr uint32_t kPackMagic = 0x4B50564E;  // "NVPK"
+constexpr uint32_t kPackVersion = 1;
+constexpr uint32_t kRecordMarker = 0x4345524E;  // "NREC"
+constexpr uint8_t kFlagTombstone = 0x01;
+
+// The file is grown in steps so appends rarely need a new mapping
+constexpr uint64_t kMinMapSize = 64ull * 1024 * 1024;
+constexpr uint64_t kMaxGrowStep = 1024ull * 1024 * 1024;
+
+// Compact once dead records take this much space and outweigh live ones
+constexpr uint64_t kCompactMinDeadBytes = 64ull * 1024 * 1024;
+
+struct FileHeader {
+    uint32_t magic = kPackMagic;
+    uint32_t version = kPackVersion;
+    uint64_t reserved = 0;
+};
+static_assert(sizeof(FileHeader) == 16);
+
+/// @brief Record header; followed by the key bytes, then the payload
+struct RecordHeader {
+    uint32_t marker = kRecordMarker;
+    uint8_t flags = 0;
+    uint8_t format = 0;
+    uint16_t key_size = 0;
+    uint32_t payload_size = 0;
+    uint32_t checksum = 0;  // Over key and payload
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+[[nodiscard]] constexpr uint64_t record_size(uint64_t key_size, uint64_t payload_size) noexcept {
+    // 8-byte aligned, so every header is naturally aligned in the view
+    return (sizeof(RecordHeader) + key_size + payload_size + 7) & ~uint64_t{7};
+}
+
+[[nodiscard]] std::span<const uint8_t> key_bytes(std::string_view key) noexcept {
+    return {reinterpret_cast<const uint8_t*>(key.data()), key.size()};
+}
+
+[[nodiscard]] Hash128 key_hash(std::string_view key) noexcept {
+    return hash128(key_bytes(key));
+}
+
+[[nodiscard]] uint32_t record_checksum(std::string_view key,
+                                       std::span<const uint8_t> payload) noexcept {
+    return static_cast<uint32_t>(hash128(payload, key_hash(key).low).low);
+}
+
+/// @brief Shared file handle; closed when the last mapping of the file goes away
+using FileHandle = std::shared_ptr<void>;
+
+FileHandle open_file(const std::filesystem::path& path) {
+    // FILE_SHARE_DELETE lets compaction delete a generation readers still map
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Failed to open pack file {}: {}", pathToUtf8(path), GetLastError());
+        return nullptr;
+    }
+    return FileHandle(file, [](void* handle) { CloseHandle(handle); });
+}
+
+}  // namespace
+
+/// @brief A read/write view of a pack file
+///
+/// Readers keep a mapping alive through PackBlob::owner, so growing the file
+/// or switching generations never invalidates a view that is still in use.
+struct PackStore::Mapping {
+    FileHandle file;
+    HANDLE mapping = nullptr;
+    uint8_t* base = nullptr;
+    uint64_t size = 0;
+
+    Mapping() = default;
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping() {
+        if (base) {
+            UnmapViewOfFile(base);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+    }
+
+    /// @brief Map a file, growing it to at least size bytes
+    static std::shared_ptr<Mapping> create(FileHandle file, uint64_t size) {
+        auto view = std::make_shared<Mapping>();
+        view->file = std::move(file);
+        view->size = size;
+
+        // A maximum size beyond the end of the file extends it
+        view->mapping =
+            CreateFileMappingW(view->file.get(), nullptr, PAGE_READWRITE,
+                               static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+        if (!view->mapping) {
+            LOG_ERROR("CreateFileMapping failed for pack file: {}", GetLastError());
+            return nullptr;
+        }
+
+        view->base = static_cast<uint8_t*>(
+            MapViewOfFile(view->mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+        if (!view->base) {
+            LOG_ERROR("MapViewOfFile failed for pack file: {}", GetLastError());
+            return nullptr;
+        }
+        return view;
+    }
+};
+
+std::expected<std::unique_ptr<PackStore>, CacheError>
+PackStore::open(const std::filesystem::path& base) {
+    auto store = std::unique_ptr<PackStore>(new PackStore());
+    store->base_ = base;
+
+    std::error_code ec;
+    std::filesystem::create_directories(base.parent_path(), ec);
+
+    // Pick the newest complete generation; older ones and unfinished
+    // compactions (*.tmp) are leftovers from an earlier run
+    std::wstring prefix = base.filename().wstring() + L"-";
+    uint64_t newest = 0;
+    std::vector<std::filesystem::path> stale;
+    for (const auto& entry : std::filesystem::directory_iterator(base.parent_path(), ec)) {
+        std::wstring name = entry.path().filename().wstring();
+        if (!name.starts_with(prefix)) {
+            continue;
+        }
+        if (entry.path().extension() != L".pack") {
+            if (entry.path().extension() == L".tmp") {
+                stale.push_back(entry.path());
+            }
+            continue;
+        }
+
+        std::string digits = pathToUtf8(entry.path().stem()).substr(prefix.size());
+        uint64_t generation = 0;
+        auto [ptr, parse_ec] =
+            std::from_chars(digits.data(), digits.data() + digits.size(), generation);
+        if (parse_ec != std::errc{} || ptr != digits.data() + digits.size()) {
+            continue;
+        }
+        if (generation > newest) {
+            if (newest > 0) {
+                stale.push_back(store->generationPath(newest));
+            }
+            newest = generation;
+        } else {
+            stale.push_back(entry.path());
+        }
+    }
+    for (const auto& path : stale) {
+        std::filesystem::remove(path, ec);
+    }
+
+    if (!store->openGeneration(newest > 0 ? newest : 1)) {
+        return std::unexpected(CacheError::IoError);
+    }
+    return store;
+}
+
+PackStore::~PackStore() {
+    flush();
+}
+
+std::filesystem::path PackStore::generationPath(uint64_t generation) const {
+    auto path = base_;
+    path += L"-" + std::to_wstring(generation) + L".pack";
+    return path;
+}
+
+bool PackStore::openGeneration(uint64_t generation) {
+    auto path = generationPath(generation);
+    auto file = open_file(path);
+    if (!file) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size{};
+    GetFileSizeEx(file.get(), &file_size);
+    auto size = static_cast<uint64_t>(file_size.QuadPart);
+
+    auto view = Mapping::create(file, std::max(size, kMinMapSize));
+    if (!view) {
+        return false;
+    }
+
+    // A new (or unrecognized) file starts over with a fresh header
+    FileHeader header;
+    std::memcpy(&header, view->base, sizeof(header));
+    if (header.magic != kPackMagic || header.version != kPackVersion) {
+        if (size > 0) {
+            LOG_WARN("Pack file {} has an unknown format, starting empty", pathToUtf8(path));
+        }
+        header = FileHeader{};
+        std::memset(view->base, 0, static_cast<size_t>(std::min(size, view->size)));
+        std::memcpy(view->base, &header, sizeof(header));
+        size = sizeof(header);
+    }
+
+    // Rebuild the index from the record headers. Space past the last record
+    // is zero-filled preallocation, so the first bad marker ends the scan.
+    Index index;
+    uint64_t live_bytes = 0;
+    uint64_t pos = sizeof(FileHeader);
+    while (pos + sizeof(RecordHeader) <= view->size) {
+        RecordHeader record;
+        std::memcpy(&record, view->base + pos, sizeof(record));
+        if (record.marker != kRecordMarker || record.key_size == 0) {
+            break;
+        }
+        uint64_t length = record_size(record.key_size, record.payload_size);
+        if (pos + length > view->size) {
+            break;
+        }
+
+        std::string_view key(reinterpret_cast<const char*>(view->base + pos + sizeof(record)),
+                             record.key_size);
+        Hash128 hash = key_hash(key);
+        if (auto it = index.find(hash); it != index.end()) {
+            live_bytes -= record_size(it->second.key_size, it->second.payload_size);
+            index.erase(it);
+        }
+        if (!(record.flags & kFlagTombstone)) {
+            index[hash] = Location{.offset = pos,
+                                   .payload_size = record.payload_size,
+                                   .key_size = record.key_size,
+                                   .format = static_cast<PayloadFormat>(record.format)};
+            live_bytes += length;
+        }
+        pos += length;
+    }
+
+    std::unique_lock lock(state_mutex_);
+    generation_ = generation;
+    mapping_ = std::move(view);
+    index_ = std::move(index);
+    end_ = pos;
+    live_bytes_ = live_bytes;
+
+    LOG_INFO("Pack file opened: {} ({} entries, {} bytes)", pathToUtf8(path), index_.size(), end_);
+    return true;
+}
+
+std::expected<PackBlob, CacheError> PackStore::read(std::string_view key) const {
+    Location location;
+    std::shared_ptr<const Mapping> view;
+    {
+        std::shared_lock lock(state_mutex_);
+        auto it = index_.find(key_hash(key));
+        if (it == index_.end()) {
+            return std::unexpected(CacheError::NotFound);
+        }
+        location = it->second;
+        view = mapping_;
+    }
+
+    const uint8_t* record = view->base + location.offset;
+    std::string_view stored_key(reinterpret_cast<const char*>(record + sizeof(RecordHeader)),
+                                location.key_size);
+    if (stored_key != key) {
+        return std::unexpected(CacheError::NotFound);  // 128-bit hash collision
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    std::span<const uint8_t> payload(record + sizeof(RecordHeader) + location.key_size,
+                                     location.payload_size);
+    if (header.checksum != record_checksum(key, payload)) {
+        LOG_WARN("Pack record checksum mismatch at offset {}", location.offset);
+        return std::unexpected(CacheError::CorruptedData);
+    }
+
+    return PackBlob{.owner = std::move(view), .format = location.format, .data = payload};
+}
+
+std::expected<void, CacheError>
+PackStore::write(std::string_view key, PayloadFormat format, std::span<const uint8_t> payload) {
+    std::lock_guard lock(append_mutex_);
+    return append(key, format, 0, payload);
+}
+
+void PackStore::remove(std::string_view key) {
+    std::lock_guard lock(append_mutex_);
+    {
+        std::shared_lock state_lock(state_mutex_);
+        if (!index_.contains(key_hash(key))) {
+            return;
+        }
+    }
+    (void)append(key, PayloadFormat::Raw, kFlagTombstone, {});
+}
+
+bool PackStore::ensureCapacity(uint64_t required) {
+    // Only the appending thread replaces mapping_, so reading it here is safe
+    if (required <= mapping_->size) {
+        return true;
+    }
+
+    uint64_t grow = std::clamp(mapping_->size, kMinMapSize, kMaxGrowStep);
+    uint64_t size = std::max(required, mapping_->size + grow);
+    auto view = Mapping::create(mapping_->file, size);
+    if (!view) {
+        return false;
+    }
+
+    std::unique_lock lock(state_mutex_);
+    mapping_ = std::move(view);
+    return true;
+}
+
+std::expected<void, CacheError> PackStore::append(std::string_view key, PayloadFormat format,
+                                                  uint8_t flags,
+                                                  std::span<const uint8_t> payload) {
+    if (key.empty() || key.size() > UINT16_MAX || payload.size() > UINT32_MAX) {
+        return std::unexpected(CacheError::InvalidPath);
+    }
+
+    uint64_t length = record_size(key.size(), payload.size());
+    if (!ensureCapacity(end_ + length)) {
+        return std::unexpected(CacheError::IoError);
+    }
+
+    // Past end_ nothing is indexed yet, so the copy needs no lock
+    RecordHeader header;
+    header.flags = flags;
+    header.format = static_cast<uint8_t>(format);
+    header.key_size = static_cast<uint16_t>(key.size());
+    header.payload_size = static_cast<uint32_t>(payload.size());
+    header.checksum = record_checksum(key, payload);
+
+    uint8_t* record = mapping_->base + end_;
+    std::memcpy(record + sizeof(header), key.data(), key.size());
+    if (!payload.empty()) {
+        std::memcpy(record + sizeof(header) + key.size(), payload.data(), payload.size());
+    }
+    // Header last: a record is only recognized once its body is in place
+    std::memcpy(record, &header, sizeof(header));
+
+    std::unique_lock lock(state_mutex_);
+    Hash128 hash = key_hash(key);
+    if (auto it = index_.find(hash); it != index_.end()) {
+        live_bytes_ -= record_size(it->second.key_size, it->second.payload_size);
+        index_.erase(it);
+    }
+    if (!(flags & kFlagTombstone)) {
+        index_[hash] = Location{.offset = end_,
+                                .payload_size = header.payload_size,
+                                .key_size = header.key_size,
+                                .format = format};
+        live_bytes_ += length;
+    }
+    end_ += length;
+    return {};
+}
+
+std::expected<void, CacheError> PackStore::clear() {
+    std::lock_guard lock(append_mutex_);
+    return switchGeneration({});
+}
+
+void PackStore::flush() {
+    std::shared_ptr<const Mapping> view;
+    uint64_t end = 0;
+    {
+        std::shared_lock lock(state_mutex_);
+        view = mapping_;
+        end = end_;
+    }
+    if (view && end > 0) {
+        FlushViewOfFile(view->base, static_cast<SIZE_T>(end));
+    }
+}
+
+bool PackStore::needsCompaction() const {
+    std::shared_lock lock(state_mutex_);
+    uint64_t dead = end_ - sizeof(FileHeader) - live_bytes_;
+    return dead >= kCompactMinDeadBytes && dead > live_bytes_;
+}
+
+std::expected<uint64_t, CacheError> PackStore::compact() {
+    std::lock_guard lock(append_mutex_);
+
+    // Appends are blocked, so the index cannot change under the copy
+    Index live;
+    uint64_t old_end = 0;
+    {
+        std::shared_lock state_lock(state_mutex_);
+        live = index_;
+        old_end = end_;
+    }
+
+    if (auto switched = switchGeneration(live); !switched) {
+        return std::unexpected(switched.error());
+    }
+
+    std::shared_lock state_lock(state_mutex_);
+    uint64_t reclaimed = old_end > end_ ? old_end - end_ : 0;
+    LOG_INFO("Pack file compacted: {} bytes reclaimed", reclaimed);
+    return reclaimed;
+}
+
+std::expected<void, CacheError> PackStore::switchGeneration(const Index& keep) {
+    // append_mutex_ is held by the caller
+    uint64_t next = generation_ + 1;
+    auto final_path = generationPath(next);
+    auto tmp_path = final_path;
+    tmp_path += L".tmp";
+
+    // Copy records in file order so the old view is read sequentially
+    std::vector<std::pair<Hash128, Location>> records(keep.begin(), keep.end());
+    std::ranges::sort(records, {}, [](const auto& record) { return record.second.offset; });
+
+    uint64_t total = sizeof(FileHeader);
+    for (const auto& [hash, location] : records) {
+        total += record_size(location.key_size, location.payload_size);
+    }
+
+    Index index;
+    {
+        auto file = open_file(tmp_path);
+        if (!file) {
+            return std::unexpected(CacheError::IoError);
+        }
+        auto target = Mapping::create(file, std::max(total, kMinMapSize));
+        if (!target) {
+            return std::unexpected(CacheError::IoError);
+        }
+
+        FileHeader header;
+        std::memcpy(target->base, &header, sizeof(header));
+        uint64_t pos = sizeof(FileHeader);
+        for (const auto& [hash, location] : records) {
+            uint64_t length = record_size(location.key_size, location.payload_size);
+            std::memcpy(target->base + pos, mapping_->base + location.offset,
+                        static_cast<size_t>(length));
+            Location moved = location;
+            moved.offset = pos;
+            index.emplace(hash, moved);
+            pos += length;
+        }
+        FlushViewOfFile(target->base, static_cast<SIZE_T>(pos));
+    }
+
+    // Only a finished copy gets a .pack name
+    if (!MoveFileExW(tmp_path.c_str(), final_path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        LOG_ERROR("Failed to finalize pack file {}: {}", pathToUtf8(final_path), GetLastError());
+        DeleteFileW(tmp_path.c_str());
+        return std::unexpected(CacheError::IoError);
+    }
+
+    auto file = open_file(final_path);
+    auto view = file ? Mapping::create(file, std::max(total, kMinMapSize)) : nullptr;
+    if (!view) {
+        return std::unexpected(CacheError::IoError);
+    }
+
+    auto old_path = generationPath(generation_);
+    {
+        std::unique_lock state_lock(state_mutex_);
+        generation_ = next;
+        mapping_ = std::move(view);
+        index_ = std::move(index);
+        end_ = total;
+        live_bytes_ = total - sizeof(FileHeader);
+    }
+
+    // Readers may still map the old file; it disappears once they let go
+    DeleteFileW(old_path.c_str());
+    return {};
+}
+
+uint64_t PackStore::generation() const {
+    std::shared_lock lock(state_mutex_);
+    return generation_;
+}
+
+std::expected<uint64_t, CacheError> PackStore::copyTo(const std::filesystem::path& destination,
+                                                      uint64_t generation, uint64_t offset,
+                                                      uint64_t max_bytes) const {
+    // The view stays valid while the file grows; only what end_ covers is written
+    std::shared_ptr<const Mapping> view;
+    uint64_t end = 0;
+    {
+        std::shared_lock lock(state_mutex_);
+        if (generation != generation_) {
+            return std::unexpected(CacheError::Expired);
+        }
+        view = mapping_;
+        end = end_;
+    }
+    if (offset > 0 && offset >= end) {
+        return offset;
+    }
+
+    HandleGuard file(CreateFileW(destination.c_str(), GENERIC_WRITE, 0, nullptr,
+                                 offset == 0 ? CREATE_ALWAYS : OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    LARGE_INTEGER position{};
+    position.QuadPart = static_cast<LONGLONG>(offset);
+    if (!file || !SetFilePointerEx(file.get(), position, nullptr, FILE_BEGIN)) {
+        LOG_ERROR("Failed to open pack copy {}: {}", pathToUtf8(destination), GetLastError());
+        return std::unexpected(CacheError::IoError);
+    }
+
+    uint64_t stop = offset + std::min(end - offset, max_bytes);
+    while (offset < stop) {
+        auto length = static_cast<DWORD>(std::min<uint64_t>(stop - offset, 64ull * 1024 * 1024));
+        DWORD written = 0;
+        if (!WriteFile(file.get(), view->base + offset, length, &written, nullptr) ||
+            written != length) {
+            LOG_ERROR("Failed to write pack copy {}: {}", pathToUtf8(destination),
+                      GetLastError());
+            return std::unexpected(CacheError::IoError);
+        }
+        offset += length;
+    }
+    return offset;
+}
+
+std::vector<PackBlob> PackStore::sample(size_t max_records, uint64_t max_bytes,
+                                        const std::function<bool(PayloadFormat)>& filter) const {
+    std::vector<PackBlob> blobs;
+    std::shared_lock lock(state_mutex_);
+
+    uint64_t bytes = 0;
+    for (const auto& [hash, location] : index_) {
+        if (blobs.size() >= max_records || bytes >= max_bytes) {
+            break;
+        }
+        if (!filter(location.format)) {
+            continue;
+        }
+        const uint8_t* payload =
+            mapping_->base + location.offset + sizeof(RecordHeader) + location.key_size;
+        blobs.push_back(PackBlob{.owner = mapping_,
+                                 .format = location.format,
+                                 .data = {payload, location.payload_size}});
+        bytes += location.payload_size;
+    }
+    return blobs;
+}
+
+}  // namespace nive::cache
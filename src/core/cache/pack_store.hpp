@@ -0,0 +1,159 @@
+/// @file pack_store.hpp
+/// @brief Memory-mapped, append-only thumbnail payload store
+///
+/// Alternative to keeping payloads as SQLite BLOBs. Payloads are appended to
+/// a pack file that stays mapped into memory, so a read is a pointer into the
+/// mapped view and a write is a copy to the end of the file. An in-memory
+/// hash index maps cache keys to record offsets; it is rebuilt from the
+/// record headers on open.
+///
+/// Pack files are named <base>-<generation>.pack. Compaction copies the live
+/// records into the next generation and deletes the old file once the last
+/// reader has released its view.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../util/hash.hpp"
+#include "cache_error.hpp"
+#include "payload_codec.hpp"
+
+namespace nive::cache {
+
+/// @brief A stored payload, viewed in place inside the mapped pack file
+struct PackBlob {
+    std::shared_ptr<const void> owner;  // Keeps the mapped view alive
+    PayloadFormat format = PayloadFormat::Raw;
+    std::span<const uint8_t> data;
+};
+
+/// @brief Append-only payload store backed by a memory-mapped file
+///
+/// Thread-safe. Reads run concurrently with each other, with appends, and
+/// with compaction; appends and compaction are serialized.
+class PackStore {
+public:
+    /// @brief Open the newest pack generation, or create the first one
+    /// @param base Path prefix for pack files (e.g. <cache dir>/thumbnails)
+    /// @return Store or error
+    [[nodiscard]] static std::expected<std::unique_ptr<PackStore>, CacheError>
+    open(const std::filesystem::path& base);
+
+    ~PackStore();
+
+    // Non-copyable, non-movable
+    PackStore(const PackStore&) = delete;
+    PackStore& operator=(const PackStore&) = delete;
+    PackStore(PackStore&&) = delete;
+    PackStore& operator=(PackStore&&) = delete;
+
+    /// @brief Get a payload by cache key
+    /// @return View into the mapped file, NotFound, or CorruptedData when the
+    ///         record fails its checksum (e.g. torn by a crash)
+    [[nodiscard]] std::expected<PackBlob, CacheError> read(std::string_view key) const;
+
+    /// @brief Append a payload, replacing any earlier one for the key
+    [[nodiscard]] std::expected<void, CacheError>
+    write(std::string_view key, PayloadFormat format, std::span<const uint8_t> payload);
+
+    /// @brief Remove a payload (appends a tombstone so removal survives reopen)
+    void remove(std::string_view key);
+
+    /// @brief Drop every payload by starting an empty generation
+    [[nodiscard]] std::expected<void, CacheError> clear();
+
+    /// @brief Write dirty mapped pages back to disk
+    void flush();
+
+    /// @brief Whether enough space is dead to make compaction worthwhile
+    [[nodiscard]] bool needsCompaction() const;
+
+    /// @brief Rewrite live records into a new generation
+    /// @return Bytes reclaimed or error
+    ///
+    /// Reads continue against the old view while records are copied; the
+    /// switch to the new file takes the index lock only briefly.
+    [[nodiscard]] std::expected<uint64_t, CacheError> compact();
+
+    /// @brief Get the generation of the pack file in use (its name's number)
+    [[nodiscard]] uint64_t generation() const;
+
+    /// @brief Copy the pack file in use to another file, a part at a time
+    /// @param destination File written from offset on (created when offset is 0)
+    /// @param generation Generation being copied, from generation() when the copy began
+    /// @param offset Bytes copied so far
+    /// @param max_bytes Most bytes to copy in this call
+    /// @return Bytes copied now in total; unchanged once the copy has caught
+    ///         up, or Expired if a compaction has replaced the generation
+    ///
+    /// Records are never changed once written, so a copy runs alongside
+    /// reads and appends; a last call made while appends are held off
+    /// brings it up to date. The copy opens with the same records.
+    [[nodiscard]] std::expected<uint64_t, CacheError>
+    copyTo(const std::filesystem::path& destination, uint64_t generation, uint64_t offset,
+           uint64_t max_bytes) const;
+
+    /// @brief Collect payloads, in no particular order
+    /// @param max_records Maximum number of payloads
+    /// @param max_bytes Stop once this many payload bytes are collected
+    /// @param filter Formats to include
+    [[nodiscard]] std::vector<PackBlob>
+    sample(size_t max_records, uint64_t max_bytes,
+           const std::function<bool(PayloadFormat)>& filter) const;
+
+private:
+    struct Mapping;
+
+    /// @brief Location of a live record
+    struct Location {
+        uint64_t offset = 0;
+        uint32_t payload_size = 0;
+        uint16_t key_size = 0;
+        PayloadFormat format = PayloadFormat::Raw;
+    };
+
+    /// @brief Index hash for cache-key hashes (already uniformly distributed)
+    struct KeyHasher {
+        [[nodiscard]] size_t operator()(const Hash128& hash) const noexcept {
+            return static_cast<size_t>(hash.low);
+        }
+    };
+
+    using Index = std::unordered_map<Hash128, Location, KeyHasher>;
+
+    PackStore() = default;
+
+    [[nodiscard]] bool openGeneration(uint64_t generation);
+    [[nodiscard]] bool ensureCapacity(uint64_t required);
+    [[nodiscard]] std::expected<void, CacheError> append(std::string_view key,
+                                                         PayloadFormat format, uint8_t flags,
+                                                         std::span<const uint8_t> payload);
+    [[nodiscard]] std::expected<void, CacheError> switchGeneration(const Index& keep);
+    [[nodiscard]] std::filesystem::path generationPath(uint64_t generation) const;
+
+    std::filesystem::path base_;
+    uint64_t generation_ = 0;
+
+    // Guards mapping_, index_, end_ and live_bytes_
+    mutable std::shared_mutex state_mutex_;
+    std::shared_ptr<Mapping> mapping_;
+    Index index_;
+    uint64_t end_ = 0;         // End of the last record
+    uint64_t live_bytes_ = 0;  // Bytes of records still referenced by the index
+
+    // Serializes appends, removals and generation switches
+    std::mutex append_mutex_;
+};
+
+}  // namespace nive::cache
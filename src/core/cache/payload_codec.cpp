@@ -0,0 +1,371 @@
+/// @file payload_codec.cpp
+/// @brief Thumbnail payload encoding (zstd with optional dictionaries, WIC JPEG)
+
+#include "payload_codec.hpp"
+
+#include <Windows.h>
+
+#include <wincodec.h>
+
+#include "../image/image_encoder.hpp"
+#include "../image/wic_factory.hpp"
+#include "../util/com_ptr.hpp"
+#include "../util/logger.hpp"
+#include "../util/win32_utils.hpp"
+
+#ifdef NIVE_HAS_ZSTD
+    #include <zdict.h>
+    #include <zstd.h>
+#endif
+
+namespace nive::cache {
+
+namespace {
+
+#ifdef NIVE_HAS_ZSTD
+/// @brief Per-thread zstd contexts
+///
+/// Payloads are encoded on whichever thread stores them (generator workers,
+/// the cache writer) and decoded on readers and the parallel prefetch pool.
+/// A context per thread avoids both locking and the allocation the one-shot
+/// ZSTD_compress/ZSTD_decompress make on every call.
+struct ZstdContexts {
+    ZSTD_CCtx* cctx = nullptr;
+    ZSTD_DCtx* dctx = nullptr;
+
+    ZstdContexts() = default;
+    ZstdContexts(const ZstdContexts&) = delete;
+    ZstdContexts& operator=(const ZstdContexts&) = delete;
+
+    ~ZstdContexts() {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+ZstdContexts& thread_contexts() {
+    thread_local ZstdContexts contexts;
+    return contexts;
+}
+
+ZSTD_CCtx* thread_cctx() {
+    auto& contexts = thread_contexts();
+    if (!contexts.cctx) {
+        contexts.cctx = ZSTD_createCCtx();
+    }
+    return contexts.cctx;
+}
+
+ZSTD_DCtx* thread_dctx() {
+    auto& contexts = thread_contexts();
+    if (!contexts.dctx) {
+        contexts.dctx = ZSTD_createDCtx();
+    }
+    return contexts.dctx;
+}
+
+std::expected<std::vector<uint8_t>, CacheError> zstd_compress(std::span<const uint8_t> data,
+                                                              int level, const ZSTD_CDict* dict) {
+    ZSTD_CCtx* cctx = thread_cctx();
+    if (!cctx) {
+        return std::unexpected(CacheError::OutOfMemory);
+    }
+
+    size_t bound = ZSTD_compressBound(data.size());
+    std::vector<uint8_t> compressed(bound);
+
+    size_t compressed_size =
+        dict ? ZSTD_compress_usingCDict(cctx, compressed.data(), compressed.size(), data.data(),
+                                        data.size(), dict)
+             : ZSTD_compressCCtx(cctx, compressed.data(), compressed.size(), data.data(),
+                                 data.size(), level);
+
+    if (ZSTD_isError(compressed_size)) {
+        LOG_ERROR("zstd compression failed: {}", ZSTD_getErrorName(compressed_size));
+        return std::unexpected(CacheError::CompressionError);
+    }
+
+    compressed.resize(compressed_size);
+    return compressed;
+}
+
+std::expected<std::vector<uint8_t>, CacheError> zstd_decompress(std::span<const uint8_t> data,
+                                                                const ZSTD_DDict* dict) {
+    unsigned long long decompressed_size = ZSTD_getFrameContentSize(data.data(), data.size());
+    if (decompressed_size == ZSTD_CONTENTSIZE_ERROR ||
+        decompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+        LOG_ERROR("zstd: cannot determine decompressed size");
+        return std::unexpected(CacheError::CompressionError);
+    }
+
+    ZSTD_DCtx* dctx = thread_dctx();
+    if (!dctx) {
+        return std::unexpected(CacheError::OutOfMemory);
+    }
+
+    // Decompressed straight into the buffer the thumbnail will own
+    std::vector<uint8_t> decompressed(static_cast<size_t>(decompressed_size));
+
+    size_t result = dict ? ZSTD_decompress_usingDDict(dctx, decompressed.data(),
+                                                      decompressed.size(), data.data(),
+                                                      data.size(), dict)
+                         : ZSTD_decompressDCtx(dctx, decompressed.data(), decompressed.size(),
+                                               data.data(), data.size());
+
+    if (ZSTD_isError(result)) {
+        LOG_ERROR("zstd decompression failed: {}", ZSTD_getErrorName(result));
+        return std::unexpected(CacheError::CompressionError);
+    }
+
+    decompressed.resize(result);
+    return decompressed;
+}
+#endif  // NIVE_HAS_ZSTD
+
+std::expected<std::vector<uint8_t>, CacheError> jpeg_encode(std::span<const uint8_t> bgra,
+                                                            uint32_t width, uint32_t height,
+                                                            int quality) {
+    image::ImageView view(bgra.data(), width, height, width * 4, image::PixelFormat::BGRA32);
+    auto encoded = image::encodeJpeg(view, quality);
+    if (!encoded) {
+        return std::unexpected(encoded.error() == image::EncodeError::OutOfMemory
+                                   ? CacheError::OutOfMemory
+                                   : CacheError::CompressionError);
+    }
+    return std::move(*encoded);
+}
+
+std::expected<std::vector<uint8_t>, CacheError> jpeg_decode(std::span<const uint8_t> data,
+                                                            uint32_t width, uint32_t height) {
+    ComInitializer com(COINIT_MULTITHREADED);
+
+    IWICImagingFactory* factory = image::wicFactory();
+    if (!factory) {
+        return std::unexpected(CacheError::CompressionError);
+    }
+
+    ComPtr<IWICStream> stream;
+    HRESULT hr = factory->CreateStream(&stream);
+    if (SUCCEEDED(hr)) {
+        hr = stream->InitializeFromMemory(const_cast<BYTE*>(data.data()),
+                                          static_cast<DWORD>(data.size()));
+    }
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateDecoderFromStream(stream.Get(), &GUID_VendorMicrosoft,
+                                              WICDecodeMetadataCacheOnDemand, &decoder);
+    }
+
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (SUCCEEDED(hr)) {
+        hr = decoder->GetFrame(0, &frame);
+    }
+
+    UINT frame_width = 0;
+    UINT frame_height = 0;
+    if (SUCCEEDED(hr)) {
+        hr = frame->GetSize(&frame_width, &frame_height);
+    }
+    if (SUCCEEDED(hr) && (frame_width != width || frame_height != height)) {
+        return std::unexpected(CacheError::CorruptedData);
+    }
+
+    ComPtr<IWICFormatConverter> converter;
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateFormatConverter(&converter);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA,
+                                   WICBitmapDitherTypeNone, nullptr, 0.0,
+                                   WICBitmapPaletteTypeCustom);
+    }
+
+    std::vector<uint8_t> pixels;
+    if (SUCCEEDED(hr)) {
+        pixels.resize(static_cast<size_t>(width) * height * 4);
+        hr = converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(pixels.size()),
+                                   pixels.data());
+    }
+    if (FAILED(hr)) {
+        LOG_DEBUG("JPEG thumbnail decode failed: 0x{:08x}", static_cast<uint32_t>(hr));
+        return std::unexpected(CacheError::CorruptedData);
+    }
+
+    return pixels;
+}
+
+}  // namespace
+
+bool isOpaque(std::span<const uint8_t> bgra) noexcept {
+    for (size_t i = 3; i < bgra.size(); i += 4) {
+        if (bgra[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Digested zstd dictionary, shared by all encode/decode calls
+struct PayloadCodec::Dictionary {
+    uint32_t id = 0;
+#ifdef NIVE_HAS_ZSTD
+    ZSTD_CDict* cdict = nullptr;
+    ZSTD_DDict* ddict = nullptr;
+
+    ~Dictionary() {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+    }
+#endif
+};
+
+PayloadCodec::PayloadCodec(PayloadOptions options) : options_(options) {
+}
+
+PayloadCodec::~PayloadCodec() = default;
+
+uint32_t PayloadCodec::addDictionary(std::span<const uint8_t> data) {
+#ifdef NIVE_HAS_ZSTD
+    uint32_t id = dictionaryId(data);
+    if (id == 0) {
+        LOG_WARN("Ignoring zstd dictionary without a dictionary id");
+        return 0;
+    }
+
+    auto dict = std::make_shared<Dictionary>();
+    dict->id = id;
+    dict->cdict = ZSTD_createCDict(data.data(), data.size(),
+                                   options_.compression_level > 0 ? options_.compression_level : 3);
+    dict->ddict = ZSTD_createDDict(data.data(), data.size());
+    if (!dict->cdict || !dict->ddict) {
+        LOG_ERROR("Failed to load zstd dictionary {}", id);
+        return 0;
+    }
+
+    std::unique_lock lock(dict_mutex_);
+    dictionaries_[id] = std::move(dict);
+    return id;
+#else
+    (void)data;
+    return 0;
+#endif
+}
+
+uint32_t PayloadCodec::dictionaryId(std::span<const uint8_t> data) noexcept {
+#ifdef NIVE_HAS_ZSTD
+    return ZDICT_getDictID(data.data(), data.size());
+#else
+    (void)data;
+    return 0;
+#endif
+}
+
+uint32_t PayloadCodec::activeDictionaryId() const {
+    std::shared_lock lock(dict_mutex_);
+    return dictionaries_.empty() ? 0 : dictionaries_.rbegin()->first;
+}
+
+std::shared_ptr<const PayloadCodec::Dictionary> PayloadCodec::findDictionary(uint32_t id) const {
+    std::shared_lock lock(dict_mutex_);
+    if (id == 0) {
+        return dictionaries_.empty() ? nullptr : dictionaries_.rbegin()->second;
+    }
+    auto it = dictionaries_.find(id);
+    return it != dictionaries_.end() ? it->second : nullptr;
+}
+
+std::expected<std::vector<uint8_t>, CacheError>
+PayloadCodec::trainDictionary(const std::vector<std::vector<uint8_t>>& samples, size_t max_size) {
+#ifdef NIVE_HAS_ZSTD
+    std::vector<uint8_t> buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const auto& sample : samples) {
+        buffer.insert(buffer.end(), sample.begin(), sample.end());
+        sizes.push_back(sample.size());
+    }
+
+    std::vector<uint8_t> dict(max_size);
+    size_t dict_size = ZDICT_trainFromBuffer(dict.data(), dict.size(), buffer.data(), sizes.data(),
+                                             static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(dict_size)) {
+        LOG_WARN("zstd dictionary training failed: {}", ZDICT_getErrorName(dict_size));
+        return std::unexpected(CacheError::CompressionError);
+    }
+
+    dict.resize(dict_size);
+    return dict;
+#else
+    (void)samples;
+    (void)max_size;
+    return std::unexpected(CacheError::CompressionError);
+#endif
+}
+
+std::expected<EncodedPayload, CacheError> PayloadCodec::encode(std::span<const uint8_t> bgra,
+                                                               uint32_t width,
+                                                               uint32_t height) const {
+    if (bgra.empty()) {
+        return EncodedPayload{};
+    }
+
+    // Lossy only where it cannot drop information the grid renders (alpha)
+    if (options_.jpeg_quality > 0 && bgra.size() == static_cast<size_t>(width) * height * 4 &&
+        isOpaque(bgra)) {
+        if (auto jpeg = jpeg_encode(bgra, width, height, options_.jpeg_quality)) {
+            return EncodedPayload{.format = PayloadFormat::Jpeg, .data = std::move(*jpeg)};
+        }
+    }
+
+#ifdef NIVE_HAS_ZSTD
+    if (options_.compression_level > 0) {
+        auto dict = findDictionary(0);
+        auto compressed =
+            zstd_compress(bgra, options_.compression_level, dict ? dict->cdict : nullptr);
+        if (!compressed) {
+            return std::unexpected(compressed.error());
+        }
+        return EncodedPayload{.format = PayloadFormat::Zstd, .data = std::move(*compressed)};
+    }
+#endif
+
+    return EncodedPayload{.format = PayloadFormat::Raw,
+                          .data = std::vector<uint8_t>(bgra.begin(), bgra.end())};
+}
+
+std::expected<std::vector<uint8_t>, CacheError>
+PayloadCodec::decode(PayloadFormat format, std::span<const uint8_t> data, uint32_t width,
+                     uint32_t height) const {
+    switch (format) {
+    case PayloadFormat::Raw:
+        return std::vector<uint8_t>(data.begin(), data.end());
+
+    case PayloadFormat::Zstd:
+#ifdef NIVE_HAS_ZSTD
+    {
+        // Frames written with a dictionary record its id in the header
+        uint32_t dict_id = ZSTD_getDictID_fromFrame(data.data(), data.size());
+        std::shared_ptr<const Dictionary> dict;
+        if (dict_id != 0) {
+            dict = findDictionary(dict_id);
+            if (!dict) {
+                LOG_WARN("Cached thumbnail needs unknown zstd dictionary {}", dict_id);
+                return std::unexpected(CacheError::CompressionError);
+            }
+        }
+        return zstd_decompress(data, dict ? dict->ddict : nullptr);
+    }
+#else
+        LOG_WARN("Cached thumbnail is zstd-compressed but zstd support is not built in");
+        return std::unexpected(CacheError::CompressionError);
+#endif
+
+    case PayloadFormat::Jpeg:
+        return jpeg_decode(data, width, height);
+    }
+
+    return std::unexpected(CacheError::CorruptedData);
+}
+
+}  // namespace nive::cache
@@ -0,0 +1,116 @@
+/// @file payload_codec.hpp
+/// @brief Storage encoding of cached thumbnail pixel data
+///
+/// Thumbnails are held as BGRA32 in memory. On disk the pixels are stored
+/// raw, zstd-compressed (lossless, optionally with a trained dictionary),
+/// or as JPEG via WIC (lossy; only used for fully opaque thumbnails).
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+#include "cache_error.hpp"
+
+namespace nive::cache {
+
+/// @brief Payload encoding, stored in the payload_format column
+enum class PayloadFormat : uint8_t {
+    Raw = 0,   // Uncompressed BGRA32
+    Zstd = 1,  // zstd-compressed BGRA32 (the frame names its dictionary, if any)
+    Jpeg = 2,  // JPEG (opaque images only)
+};
+
+/// @brief Payload encoding options
+struct PayloadOptions {
+    int compression_level = 3;  // zstd level for lossless payloads (0 = off)
+    int jpeg_quality = 85;      // JPEG quality for opaque images (0 = lossless only)
+    bool train_dictionary = false;  // Train a zstd dictionary once enough rows exist
+};
+
+/// @brief Encoded payload ready for storage
+struct EncodedPayload {
+    PayloadFormat format = PayloadFormat::Raw;
+    std::vector<uint8_t> data;
+};
+
+/// @brief Check whether every pixel of a BGRA32 buffer is fully opaque
+[[nodiscard]] bool isOpaque(std::span<const uint8_t> bgra) noexcept;
+
+/// @brief Encodes and decodes stored thumbnail payloads
+///
+/// Thread-safe: encode() and decode() may run concurrently on any thread.
+///
+/// zstd payloads can use trained dictionaries. Each dictionary carries its
+/// own id (embedded in every frame compressed with it), so frames decode
+/// with whichever registered dictionary they name. New payloads use the
+/// dictionary with the highest id.
+class PayloadCodec {
+public:
+    explicit PayloadCodec(PayloadOptions options = {});
+    ~PayloadCodec();
+
+    // Non-copyable, non-movable
+    PayloadCodec(const PayloadCodec&) = delete;
+    PayloadCodec& operator=(const PayloadCodec&) = delete;
+    PayloadCodec(PayloadCodec&&) = delete;
+    PayloadCodec& operator=(PayloadCodec&&) = delete;
+
+    [[nodiscard]] const PayloadOptions& options() const noexcept { return options_; }
+
+    /// @brief Encode BGRA32 pixels for storage
+    /// @param bgra Pixel data (tightly packed, stride = width * 4)
+    /// @param width Image width
+    /// @param height Image height
+    /// @return Encoded payload or error
+    ///
+    /// Opaque images use JPEG when jpeg_quality > 0; images with alpha (or
+    /// when JPEG encoding fails) fall back to zstd, or raw without zstd.
+    [[nodiscard]] std::expected<EncodedPayload, CacheError>
+    encode(std::span<const uint8_t> bgra, uint32_t width, uint32_t height) const;
+
+    /// @brief Decode a stored payload back to BGRA32 pixels
+    /// @param format Payload format
+    /// @param data Stored payload
+    /// @param width Expected image width
+    /// @param height Expected image height
+    /// @return Pixel data (stride = width * 4) or error
+    [[nodiscard]] std::expected<std::vector<uint8_t>, CacheError>
+    decode(PayloadFormat format, std::span<const uint8_t> data, uint32_t width,
+           uint32_t height) const;
+
+    /// @brief Register a zstd dictionary
+    /// @param data Dictionary content (as produced by trainDictionary)
+    /// @return Dictionary id, or 0 if the data is not a usable dictionary
+    uint32_t addDictionary(std::span<const uint8_t> data);
+
+    /// @brief Id of the dictionary used for new payloads (0 = none)
+    [[nodiscard]] uint32_t activeDictionaryId() const;
+
+    /// @brief Id embedded in a zstd dictionary (0 if not a dictionary or no zstd)
+    [[nodiscard]] static uint32_t dictionaryId(std::span<const uint8_t> data) noexcept;
+
+    /// @brief Train a zstd dictionary from raw payload samples
+    /// @param samples Uncompressed sample payloads
+    /// @param max_size Maximum dictionary size in bytes
+    /// @return Dictionary content or error (CompressionError without zstd)
+    [[nodiscard]] static std::expected<std::vector<uint8_t>, CacheError>
+    trainDictionary(const std::vector<std::vector<uint8_t>>& samples, size_t max_size);
+
+private:
+    struct Dictionary;
+
+    /// @brief Look up a dictionary by id (0 = the active one); nullptr if absent
+    [[nodiscard]] std::shared_ptr<const Dictionary> findDictionary(uint32_t id) const;
+
+    PayloadOptions options_;
+    mutable std::shared_mutex dict_mutex_;
+    std::map<uint32_t, std::shared_ptr<const Dictionary>> dictionaries_;
+};
+
+}  // namespace nive::cache
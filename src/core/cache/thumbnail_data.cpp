@@ -3,44 +3,171 @@
 
 #include "thumbnail_data.hpp"
 
-#include <format>
+#include <Windows.h>
 
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <unordered_map>
+
+#include "../archive/virtual_path.hpp"
+#include "../fs/file_metadata.hpp"
 #include "../util/hash.hpp"
-#include "../util/string_utils.hpp"
 
 namespace nive::cache {
 
+namespace {
+
+/// @brief Hash the native (UTF-16) path bytes followed by an optional suffix
+std::string hash_key(const std::filesystem::path& path, std::span<const uint64_t> suffix) {
+    const auto& native = path.native();
+
+    // Path bytes and the numeric fields hashed in one contiguous buffer
+    std::vector<uint8_t> buffer(native.size() * sizeof(wchar_t) + suffix.size_bytes());
+    std::memcpy(buffer.data(), native.data(), native.size() * sizeof(wchar_t));
+    if (!suffix.empty()) {
+        std::memcpy(buffer.data() + native.size() * sizeof(wchar_t), suffix.data(),
+                    suffix.size_bytes());
+    }
+
+    return hashToHex(hash128(buffer));
+}
+
+// Bytes hashed from each end of a file for its content fingerprint
+constexpr size_t kFingerprintBlockSize = 64 * 1024;
+
+/// @brief Hash size, head and tail (tail may be empty for small files)
+std::string hash_fingerprint(uint64_t size, std::span<const uint8_t> head,
+                             std::span<const uint8_t> tail) {
+    std::vector<uint8_t> buffer(sizeof(size) + head.size() + tail.size());
+    std::memcpy(buffer.data(), &size, sizeof(size));
+    std::memcpy(buffer.data() + sizeof(size), head.data(), head.size());
+    if (!tail.empty()) {
+        std::memcpy(buffer.data() + sizeof(size) + head.size(), tail.data(), tail.size());
+    }
+    return hashToHex(hash128(buffer));
+}
+
+}  // namespace
+
 std::string generateCacheKey(const std::filesystem::path& path,
-                             std::chrono::system_clock::time_point mtime) {
-    // Create a unique key from path + modification time
-    auto mtime_epoch =
-        std::chrono::duration_cast<std::chrono::milliseconds>(mtime.time_since_epoch()).count();
+                             std::chrono::system_clock::time_point mtime, uint64_t size_bytes) {
+    auto mtime_epoch = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(mtime.time_since_epoch()).count());
+
+    const uint64_t suffix[] = {mtime_epoch, size_bytes};
+    return hash_key(path, suffix);
+}
 
-    std::string key_source = std::format("{}|{}", pathToUtf8(path), mtime_epoch);
+std::string generateCacheKey(const fs::FileMetadata& file) {
+    if (file.virtual_path && file.virtual_path->is_in_archive()) {
+        // Entry metadata does not describe the archive itself
+        return generateCacheKey(file.virtual_path->to_string());
+    }
+    return generateCacheKey(file.path, file.modified_time, file.size_bytes);
+}
 
-    auto hash_result = sha256Hex(key_source);
+std::optional<SourceStamp> statSource(const std::filesystem::path& path) {
+    // Archive entries have no stamp of their own; use the (outermost) archive's
+    auto vpath = archive::VirtualPath::parse(path.wstring());
 
-    if (hash_result) {
-        return *hash_result;
+    WIN32_FILE_ATTRIBUTE_DATA attrs{};
+    if (!GetFileAttributesExW(vpath.file_path().c_str(), GetFileExInfoStandard, &attrs)) {
+        return std::nullopt;
     }
 
-    // Fallback: use path hash only
-    return sha256Hex(pathToUtf8(path)).value_or("");
+    uint64_t ticks = (static_cast<uint64_t>(attrs.ftLastWriteTime.dwHighDateTime) << 32) |
+                     attrs.ftLastWriteTime.dwLowDateTime;
+    uint64_t size = (static_cast<uint64_t>(attrs.nFileSizeHigh) << 32) | attrs.nFileSizeLow;
+
+    return SourceStamp{.mtime = fs::fileTimeToSystemClock(ticks), .size_bytes = size};
 }
 
-std::string generateCacheKey(const std::filesystem::path& path) {
-    std::error_code ec;
-    auto mtime = std::filesystem::last_write_time(path, ec);
+std::optional<std::string> contentFingerprint(const std::filesystem::path& path) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return std::nullopt;
+    }
+
+    auto read_at = [file](uint64_t offset, std::vector<uint8_t>& out) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read = 0;
+        return ReadFile(file, out.data(), static_cast<DWORD>(out.size()), &read, &overlapped) &&
+               read == out.size();
+    };
+
+    std::optional<std::string> fingerprint;
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size)) {
+        auto total = static_cast<uint64_t>(size.QuadPart);
+        auto head_size = static_cast<size_t>(std::min<uint64_t>(total, kFingerprintBlockSize));
+        auto tail_size =
+            static_cast<size_t>(std::min<uint64_t>(total - head_size, kFingerprintBlockSize));
+        std::vector<uint8_t> head(head_size);
+        std::vector<uint8_t> tail(tail_size);
+        if (read_at(0, head) && (tail.empty() || read_at(total - tail.size(), tail))) {
+            fingerprint = hash_fingerprint(total, head, tail);
+        }
+    }
+
+    CloseHandle(file);
+    return fingerprint;
+}
+
+std::string contentFingerprint(std::span<const uint8_t> data) {
+    auto head = data.first(std::min(data.size(), kFingerprintBlockSize));
+    auto tail = data.last(std::min(data.size() - head.size(), kFingerprintBlockSize));
+    return hash_fingerprint(data.size(), head, tail);
+}
+
+std::string mipLevelKey(const std::string& key, uint32_t level_size) {
+    return key + '@' + std::to_string(level_size);
+}
 
-    if (ec) {
-        // If we can't get mtime, just use path
-        return sha256Hex(pathToUtf8(path)).value_or("");
+uint32_t selectMipLevel(uint32_t base_size, uint32_t levels, uint32_t requested) {
+    uint32_t selected = base_size;
+    for (uint32_t level = 1; level < levels && requested > 0; ++level) {
+        uint32_t level_size = base_size >> level;
+        if (level_size < requested) {
+            break;
+        }
+        selected = level_size;
     }
+    return selected;
+}
 
-    // Convert file_time to system_clock
-    auto sys_time = std::chrono::clock_cast<std::chrono::system_clock>(mtime);
+std::string generateCacheKey(const std::filesystem::path& path) {
+    auto stamp = statSource(path);
+    if (!stamp) {
+        // If we can't query the file, just use path
+        return hash_key(path, {});
+    }
+    return generateCacheKey(path, stamp->mtime, stamp->size_bytes);
+}
 
-    return generateCacheKey(path, sys_time);
+std::vector<std::string> generateCacheKeys(const std::vector<fs::FileMetadata>& files) {
+    std::vector<std::string> keys;
+    keys.reserve(files.size());
+    std::unordered_map<std::wstring, std::optional<SourceStamp>> archive_stamps;
+    for (const auto& file : files) {
+        if (!file.is_in_archive()) {
+            keys.push_back(generateCacheKey(file));
+            continue;
+        }
+        // Same key as generateCacheKey(virtual path string), one stat per archive
+        std::filesystem::path path = file.virtual_path->to_string();
+        auto [it, inserted] = archive_stamps.try_emplace(file.virtual_path->file_path().native());
+        if (inserted) {
+            it->second = statSource(it->first);
+        }
+        keys.push_back(it->second
+                           ? generateCacheKey(path, it->second->mtime, it->second->size_bytes)
+                           : hash_key(path, {}));
+    }
+    return keys;
 }
 
 }  // namespace nive::cache
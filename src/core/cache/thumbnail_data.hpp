@@ -7,14 +7,19 @@
 #include <cstdint>
 #include <filesystem>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+namespace nive::fs {
+struct FileMetadata;
+}
+
 namespace nive::cache {
 
 /// @brief Thumbnail metadata stored in cache
 struct ThumbnailMetadata {
-    std::string file_hash;                               // SHA256 of source file path + mtime
+    std::string file_hash;                               // Hash of source path + mtime + size
     std::filesystem::path source_path;                   // Original file path
     uint32_t width = 0;                                  // Thumbnail width
     uint32_t height = 0;                                 // Thumbnail height
@@ -23,6 +28,9 @@ struct ThumbnailMetadata {
     std::chrono::system_clock::time_point source_mtime;  // Source file modification time
     std::chrono::system_clock::time_point cached_at;     // When this was cached
     uint64_t data_size = 0;                              // Size of thumbnail data in bytes
+    std::string content_hash;  // Content fingerprint of a shared payload (empty = not shared)
+    std::optional<uint64_t> perceptual_hash;  // See image::differenceHash (full size rows only)
+    std::optional<uint32_t> average_color;    // See image::averageColor (full size rows only)
 };
 
 /// @brief Complete thumbnail cache entry
@@ -36,13 +44,40 @@ struct ThumbnailEntry {
     }
 };
 
+/// @brief Perceptual hash of a cached source file
+struct SourceHash {
+    std::filesystem::path source_path;  // File path or virtual path of an archive entry
+    uint64_t hash = 0;                  // See image::differenceHash
+};
+
+/// @brief EXIF capture info of a source, stored under the source's cache key
+///
+/// Files without an EXIF block get a record too (with both fields empty),
+/// so they are not read again.
+struct CaptureRecord {
+    std::string cache_key;
+    std::optional<std::chrono::system_clock::time_point> date_taken;
+    std::wstring camera_model;
+};
+
+/// @brief Snapshot of a directory listing (see fs::encodeSnapshot)
+struct StoredListing {
+    uint64_t write_time = 0;       // Directory last write time when listed (FILETIME ticks)
+    std::vector<uint8_t> listing;  // Encoded entries (opaque to the cache)
+};
+
 /// @brief Cache statistics
 struct CacheStats {
     uint64_t total_entries = 0;
     uint64_t total_size_bytes = 0;
     uint64_t hits = 0;
     uint64_t misses = 0;
-    uint64_t evictions = 0;
+    uint64_t evictions = 0;         // Disk entries removed by cleanup
+    uint64_t memory_evictions = 0;  // Memory tier entries evicted to fit the byte budget
+    uint64_t memory_entries = 0;
+    uint64_t memory_size_bytes = 0;
+    uint64_t memory_capacity_bytes = 0;
+    uint64_t shared_hits = 0;  // Hits served by the shared tier (and copied locally)
     std::chrono::system_clock::time_point oldest_entry;
     std::chrono::system_clock::time_point newest_entry;
 
@@ -52,6 +87,26 @@ struct CacheStats {
     }
 };
 
+/// @brief Disk tier storage for thumbnail pixel payloads
+enum class StorageBackend : uint8_t {
+    Sqlite = 0,    // BLOB rows in the cache database
+    PackFile = 1,  // Memory-mapped append-only pack file (see PackStore)
+};
+
+/// @brief SQLite tuning of the cache database connections
+///
+/// Defaults suit a local SSD. Checkpoints run on a background connection by
+/// default, so a COMMIT never stops to copy the WAL back into the database.
+struct SqliteTuning {
+    uint64_t mmap_size_bytes = 256ULL * 1024 * 1024;  // Mapped reads per connection (0 = off)
+    uint32_t page_size = 16384;                       // New databases only (512-65536, 2^n)
+    uint32_t cache_size_kib = 40960;                  // Writer page cache
+    uint32_t reader_cache_size_kib = 8192;            // Page cache of each reader connection
+    uint32_t wal_autocheckpoint_pages = 1000;         // WAL size to checkpoint at (0 = never)
+    bool background_checkpoint = true;                // On a background thread, not in COMMIT
+    uint32_t busy_timeout_ms = 5000;                  // Lock wait before SQLITE_BUSY
+};
+
 /// @brief Cache configuration
 struct CacheConfig {
     std::filesystem::path database_path;
@@ -59,19 +114,92 @@ struct CacheConfig {
     uint64_t max_entries = 10000;
     std::optional<std::chrono::hours> retention_period;  // nullopt = never expire
     int compression_level = 3;                           // 0=off, 1-19=zstd levels
-    size_t memory_cache_size = 100;                      // LRU memory cache size
+    int jpeg_quality = 85;                               // JPEG for opaque, 0=lossless only
+    bool zstd_dictionary = true;                         // Train/use a zstd dictionary
+    StorageBackend storage_backend = StorageBackend::Sqlite;
+    bool deduplicate = false;                            // Share payloads of identical files
+    uint32_t mip_levels = 1;     // Stored sizes per thumbnail, each half the previous (1-3)
+    uint32_t mip_base_size = 0;  // Nominal size of level 0 (the stored thumbnail size)
+    uint64_t memory_cache_bytes = 256 * 1024 * 1024;     // LRU memory tier budget (256 MB)
+    SqliteTuning sqlite;
+
+    // Read-only team cache on a share, consulted after the local disk tier;
+    // hits are copied to the local tier (empty = none)
+    std::filesystem::path shared_database_path;
+};
+
+/// @brief Identity of a source file's contents as seen by the cache
+///
+/// Callers that already hold directory metadata pass this along so that
+/// cache lookups do not have to stat the file again.
+struct SourceStamp {
+    std::chrono::system_clock::time_point mtime;
+    uint64_t size_bytes = 0;
 };
 
-/// @brief Generate cache key from file path and modification time
+/// @brief Generate cache key from file path, modification time and size
 /// @param path File path
 /// @param mtime File modification time
-/// @return SHA256 hash as hex string
+/// @param size_bytes File size in bytes
+/// @return 128-bit hash as 32-character hex string
 [[nodiscard]] std::string generateCacheKey(const std::filesystem::path& path,
-                                           std::chrono::system_clock::time_point mtime);
+                                           std::chrono::system_clock::time_point mtime,
+                                           uint64_t size_bytes = 0);
+
+/// @brief Generate cache key from already-enumerated file metadata
+///
+/// Uses the metadata's mtime and size; no filesystem access.
+/// @param file File metadata (e.g. from a directory scan)
+/// @return 128-bit hash as 32-character hex string
+[[nodiscard]] std::string generateCacheKey(const fs::FileMetadata& file);
+
+/// @brief Read the stamp of a source file with a single attribute query
+///
+/// For a virtual path inside an archive ("archive|entry") the archive's
+/// stamp is returned, so entries are invalidated with their archive.
+/// @param path File path or virtual path string
+/// @return Stamp, or nullopt if the file cannot be queried
+[[nodiscard]] std::optional<SourceStamp> statSource(const std::filesystem::path& path);
 
-/// @brief Generate cache key from file path (auto-detects mtime)
+/// @brief Fingerprint a source file's contents
+///
+/// Hashes the size and the first and last 64 KB, so the cost does not grow
+/// with the file. Identical files anywhere (including archive entries, see
+/// the span overload) get the same fingerprint.
 /// @param path File path
-/// @return SHA256 hash as hex string, or empty on error
+/// @return 128-bit hash as hex string, or nullopt if the file cannot be read
+[[nodiscard]] std::optional<std::string> contentFingerprint(const std::filesystem::path& path);
+
+/// @brief Fingerprint contents already in memory (same value as for the file)
+[[nodiscard]] std::string contentFingerprint(std::span<const uint8_t> data);
+
+/// @brief Cache key of a reduced mipmap level
+/// @param key Cache key of the full-size thumbnail
+/// @param level_size Nominal size of the level
+/// @return Key sharing the full-size key as prefix
+[[nodiscard]] std::string mipLevelKey(const std::string& key, uint32_t level_size);
+
+/// @brief Pick the mipmap level that best serves a requested size
+/// @param base_size Nominal size of level 0
+/// @param levels Number of levels (level i is base_size >> i)
+/// @param requested Requested size (0 = full size)
+/// @return Nominal size of the smallest level not smaller than requested
+[[nodiscard]] uint32_t selectMipLevel(uint32_t base_size, uint32_t levels, uint32_t requested);
+
+/// @brief Generate cache key from file path (queries mtime and size)
+///
+/// Prefer the FileMetadata overload when metadata is already at hand.
+/// @param path File path or virtual path string
+/// @return 128-bit hash as hex string (path-only when the file cannot be queried)
 [[nodiscard]] std::string generateCacheKey(const std::filesystem::path& path);
 
+/// @brief Generate cache keys for a listing, one per file
+///
+/// Like the FileMetadata overload, except that the stamp of an archive is
+/// queried once for all of its entries rather than once per entry.
+/// @param files File metadata, e.g. the entries of one archive
+/// @return Keys in the order of files
+[[nodiscard]] std::vector<std::string>
+generateCacheKeys(const std::vector<fs::FileMetadata>& files);
+
 }  // namespace nive::cache
@@ -41,6 +41,30 @@ enum class CacheLocation {
     return CacheLocation::AppData;
 }
 
+/// @brief Disk storage for cached thumbnail pixels
+enum class CacheStorage {
+    Sqlite,  // BLOBs in the cache database
+    Pack,    // Memory-mapped pack file next to the database
+};
+
+/// @brief Get string representation of CacheStorage
+[[nodiscard]] constexpr std::string_view to_string(CacheStorage storage) noexcept {
+    switch (storage) {
+    case CacheStorage::Sqlite:
+        return "sqlite";
+    case CacheStorage::Pack:
+        return "pack";
+    }
+    return "sqlite";
+}
+
+/// @brief Parse CacheStorage from string
+[[nodiscard]] constexpr CacheStorage cacheStorageFromString(std::string_view str) noexcept {
+    if (str == "pack")
+        return CacheStorage::Pack;
+    return CacheStorage::Sqlite;
+}
+
 /// @brief File sorting method
 enum class SortMethod {
     Lexicographic,  // Standard string comparison
@@ -48,6 +72,8 @@ enum class SortMethod {
     DateModified,   // By modification time
     DateCreated,    // By creation time
     Size,           // By file size
+    DateTaken,      // By EXIF capture date
+    CameraModel,    // By EXIF camera model
 };
 
 /// @brief Get string representation of SortMethod
@@ -63,6 +89,10 @@ enum class SortMethod {
         return "date_created";
     case SortMethod::Size:
         return "size";
+    case SortMethod::DateTaken:
+        return "date_taken";
+    case SortMethod::CameraModel:
+        return "camera_model";
     }
     return "natural";
 }
@@ -77,6 +107,10 @@ enum class SortMethod {
         return SortMethod::DateCreated;
     if (str == "size")
         return SortMethod::Size;
+    if (str == "date_taken")
+        return SortMethod::DateTaken;
+    if (str == "camera_model")
+        return SortMethod::CameraModel;
     return SortMethod::Natural;
 }
 
@@ -208,10 +242,19 @@ struct WindowState {
 /// Note: stored_size is the maximum size of thumbnails saved to cache (e.g., 384x384).
 /// display_size is the current size shown in the grid view and can be adjusted at runtime.
 struct ThumbnailSettings {
-    int stored_size = 384;   // Max thumbnail size stored in cache (64-2048)
-    int display_size = 128;  // Current display size in grid view (adjustable at runtime)
-    int buffer_count = 50;   // Number of thumbnails to keep outside visible range
-    int worker_count = 4;    // Number of thumbnail generation threads (1-16)
+    int stored_size = 384;         // Max thumbnail size stored in cache (64-2048)
+    int display_size = 128;        // Current display size in grid view (adjustable at runtime)
+    int buffer_count = 50;         // Number of thumbnails to keep outside visible range
+    int worker_count = 4;          // Number of thumbnail decode threads (1-16)
+    int io_worker_count = 4;       // Threads checking the cache and reading files ahead (1-8)
+    bool adaptive_workers = true;  // Scale decode threads with load and power (from worker_count)
+    int mip_levels = 1;            // Cached sizes per thumbnail, each half the previous (1-3)
+    bool pregenerate = false;      // Generate the rest of the folder in the background when idle
+    int pregenerate_depth = 0;     // Subfolder levels pre-generation descends into (0-4)
+    bool progressive = true;       // Show a quick preview before the full-quality thumbnail
+    bool shell_cache = false;      // Use Explorer's cached thumbnails for formats slow to decode
+    bool gpu_scaling = false;      // Resample thumbnails of 512 px and up on the GPU, batched
+    bool trace_requests = false;   // Time each request's hops; log the slowest per folder
 };
 
 /// @brief Cache settings
@@ -220,9 +263,30 @@ struct CacheSettings {
     std::filesystem::path custom_path;  // Used when location == Custom
     uint64_t max_size_mb = 500;
     uint64_t max_entries = 10000;
+    uint64_t memory_cache_mb = 256;  // In-memory thumbnail tier budget
     int compression_level = 3;       // 0=off, 1-19=zstd levels
+    int jpeg_quality = 85;           // Opaque thumbnails as JPEG (0=lossless only, 1-100)
+    bool zstd_dictionary = true;     // Train a zstd dictionary from cached thumbnails
+    CacheStorage storage = CacheStorage::Sqlite;  // Where thumbnail pixels are stored
+    bool deduplicate = false;        // Share thumbnails between files with identical content
     bool retention_enabled = false;  // Enable automatic cache cleanup
     int retention_days = 30;         // Days to keep cache entries (when enabled)
+
+    // SQLite tuning of the cache database (file only; see cache::SqliteTuning)
+    int sqlite_mmap_mb = 256;                  // Memory-mapped reads (0 = off)
+    int sqlite_page_size = 16384;              // Page size of newly created databases
+    int sqlite_wal_autocheckpoint = 1000;      // WAL pages before a checkpoint (0 = never)
+    bool sqlite_background_checkpoint = true;  // Checkpoint off the writer thread
+    int sqlite_busy_timeout_ms = 5000;         // Lock wait before giving up
+
+    // Read-only team cache on a share, e.g. a thumbnails.db filled by
+    // nive --pregenerate and published there (empty = none; file only)
+    std::filesystem::path shared_path;
+
+    // Database still being moved to the location above (empty = none). Set
+    // while App::relocateCache() copies it, so an exit part way resumes the
+    // move from here instead of starting with an empty cache.
+    std::filesystem::path migrate_from;
 };
 
 /// @brief Sorting settings
@@ -235,7 +299,8 @@ struct SortSettings {
     [[nodiscard]] int toSortOrder() const noexcept {
         // fs::SortOrder values:
         // Natural=0, NaturalDesc=1, Name=2, NameDesc=3, Size=4, SizeDesc=5,
-        // Modified=6, ModifiedDesc=7, Type=8, TypeDesc=9
+        // Modified=6, ModifiedDesc=7, Type=8, TypeDesc=9, Taken=10, TakenDesc=11,
+        // Camera=12, CameraDesc=13
         int base = 0;
         switch (method) {
         case SortMethod::Natural:
@@ -253,6 +318,12 @@ struct SortSettings {
         case SortMethod::DateCreated:
             base = 6;  // Use Modified as fallback (no DateCreated in SortOrder)
             break;
+        case SortMethod::DateTaken:
+            base = 10;  // Taken
+            break;
+        case SortMethod::CameraModel:
+            base = 12;  // Camera
+            break;
         }
         return ascending ? base : base + 1;
     }
@@ -261,6 +332,20 @@ struct SortSettings {
 /// @brief Plugin settings
 struct PluginSettings {
     std::vector<std::string> disabled_plugins;  // Plugin names to not load
+    bool isolate = false;                       // Decode in plugin host processes
+    int host_processes = 2;                     // Host processes per plugin when isolated (1-8)
+};
+
+/// @brief Library index settings
+struct LibrarySettings {
+    bool index_enabled = false;      // Crawl roots in the background for filename search
+    std::vector<std::string> roots;  // Indexed directories (UTF-8), subdirectories included
+};
+
+/// @brief Batch export settings (File > Export images)
+struct ExportSettings {
+    int max_side = 2048;    // Longest side of exported images (64-16384)
+    int jpeg_quality = 85;  // JPEG quality (1-100)
 };
 
 /// @brief Application settings
@@ -284,24 +369,36 @@ struct Settings {
     ViewerDisplayMode viewer_display_mode = ViewerDisplayMode::ShrinkToFit;
     WindowState main_window;
     WindowState viewer_window;
+    bool color_management = true;      // Convert images with an ICC profile for display
+    int slideshow_interval_ms = 4000;  // Time each slide is shown (500-600000)
 
     // File operations
     ConflictResolution conflict_resolution = ConflictResolution::Ask;
     bool confirm_delete = true;
     bool use_recycle_bin = true;
     bool show_hidden_files = false;
-    bool show_images_only = true;  // Filter to show only supported image formats
+    bool show_images_only = true;     // Filter to show only supported image formats
+    bool flatten_subfolders = false;  // List the files of all subfolders as one view
 
     // Startup directory settings
     StartupDirectory startup_directory = StartupDirectory::LastOpened;
     std::filesystem::path custom_startup_path;  // Used when startup_directory == Custom
+    bool single_instance = false;  // Later launches hand their path to the running window
 
     // Last directory (for restoring previous session)
     std::filesystem::path last_directory;
+    uint64_t last_scroll_index = 0;   // First visible grid item in last_directory
+    uint64_t last_visible_count = 0;  // Grid items that fit on screen (0 = unknown)
 
     // Plugin settings
     PluginSettings plugins;
 
+    // Library index settings
+    LibrarySettings library;
+
+    // Batch export settings
+    ExportSettings export_images;
+
     // Language setting ("auto" = system detection, or explicit tag like "en", "ja")
     std::string language = "auto";
 
@@ -73,6 +73,15 @@ Settings parse_settings(const toml::table& tbl) {
         settings.thumbnails.display_size = get_or(*thumbnails, "display_size", 128);
         settings.thumbnails.buffer_count = get_or(*thumbnails, "buffer_count", 50);
         settings.thumbnails.worker_count = get_or(*thumbnails, "worker_count", 4);
+        settings.thumbnails.io_worker_count = get_or(*thumbnails, "io_worker_count", 4);
+        settings.thumbnails.adaptive_workers = get_or(*thumbnails, "adaptive_workers", true);
+        settings.thumbnails.mip_levels = get_or(*thumbnails, "mip_levels", 1);
+        settings.thumbnails.pregenerate = get_or(*thumbnails, "pregenerate", false);
+        settings.thumbnails.pregenerate_depth = get_or(*thumbnails, "pregenerate_depth", 0);
+        settings.thumbnails.progressive = get_or(*thumbnails, "progressive", true);
+        settings.thumbnails.shell_cache = get_or(*thumbnails, "shell_cache", false);
+        settings.thumbnails.gpu_scaling = get_or(*thumbnails, "gpu_scaling", false);
+        settings.thumbnails.trace_requests = get_or(*thumbnails, "trace_requests", false);
     }
 
     // Cache settings
@@ -85,14 +94,38 @@ Settings parse_settings(const toml::table& tbl) {
                 settings.cache.custom_path = from_utf8(str->get());
             }
         }
+        if (auto path_str = cache->get("shared_path")) {
+            if (auto* str = path_str->as_string()) {
+                settings.cache.shared_path = from_utf8(str->get());
+            }
+        }
+        if (auto path_str = cache->get("migrate_from")) {
+            if (auto* str = path_str->as_string()) {
+                settings.cache.migrate_from = from_utf8(str->get());
+            }
+        }
 
         settings.cache.max_size_mb =
             static_cast<uint64_t>(get_or(*cache, "max_size_mb", int64_t{500}));
         settings.cache.max_entries =
             static_cast<uint64_t>(get_or(*cache, "max_entries", int64_t{10000}));
+        settings.cache.memory_cache_mb =
+            static_cast<uint64_t>(get_or(*cache, "memory_cache_mb", int64_t{256}));
         settings.cache.compression_level = get_or(*cache, "compression_level", 3);
+        settings.cache.jpeg_quality = get_or(*cache, "jpeg_quality", 85);
+        settings.cache.zstd_dictionary = get_or(*cache, "zstd_dictionary", true);
+        settings.cache.storage =
+            cacheStorageFromString(get_or<std::string>(*cache, "storage", "sqlite"));
+        settings.cache.deduplicate = get_or(*cache, "deduplicate", false);
         settings.cache.retention_enabled = get_or(*cache, "retention_enabled", false);
         settings.cache.retention_days = get_or(*cache, "retention_days", 30);
+        settings.cache.sqlite_mmap_mb = get_or(*cache, "sqlite_mmap_mb", 256);
+        settings.cache.sqlite_page_size = get_or(*cache, "sqlite_page_size", 16384);
+        settings.cache.sqlite_wal_autocheckpoint =
+            get_or(*cache, "sqlite_wal_autocheckpoint", 1000);
+        settings.cache.sqlite_background_checkpoint =
+            get_or(*cache, "sqlite_background_checkpoint", true);
+        settings.cache.sqlite_busy_timeout_ms = get_or(*cache, "sqlite_busy_timeout_ms", 5000);
     }
 
     // Sorting settings
@@ -119,6 +152,8 @@ Settings parse_settings(const toml::table& tbl) {
     if (auto* viewer = tbl["viewer"].as_table()) {
         auto mode_str = get_or<std::string>(*viewer, "display_mode", "shrink");
         settings.viewer_display_mode = displayModeFromString(mode_str);
+        settings.color_management = get_or(*viewer, "color_management", true);
+        settings.slideshow_interval_ms = get_or(*viewer, "slideshow_interval_ms", 4000);
     }
 
     // File operations
@@ -129,6 +164,7 @@ Settings parse_settings(const toml::table& tbl) {
         settings.use_recycle_bin = get_or(*file_ops, "use_recycle_bin", true);
         settings.show_hidden_files = get_or(*file_ops, "show_hidden_files", false);
         settings.show_images_only = get_or(*file_ops, "show_images_only", true);
+        settings.flatten_subfolders = get_or(*file_ops, "flatten_subfolders", false);
     }
 
     // Main window state
@@ -173,6 +209,7 @@ Settings parse_settings(const toml::table& tbl) {
                 settings.custom_startup_path = from_utf8(str->get());
             }
         }
+        settings.single_instance = get_or(*startup, "single_instance", false);
     }
 
     // Application state
@@ -182,6 +219,10 @@ Settings parse_settings(const toml::table& tbl) {
                 settings.last_directory = from_utf8(str->get());
             }
         }
+        settings.last_scroll_index =
+            static_cast<uint64_t>(get_or(*state, "last_scroll_index", int64_t{0}));
+        settings.last_visible_count =
+            static_cast<uint64_t>(get_or(*state, "last_visible_count", int64_t{0}));
     }
 
     // Plugin settings
@@ -195,6 +236,28 @@ Settings parse_settings(const toml::table& tbl) {
                 }
             }
         }
+        settings.plugins.isolate = get_or(*plugins, "isolate", false);
+        settings.plugins.host_processes = get_or(*plugins, "host_processes", 2);
+    }
+
+    // Library index settings
+    if (auto* library = tbl["library"].as_table()) {
+        settings.library.index_enabled = get_or(*library, "enabled", false);
+        if (auto* roots = library->get("roots")) {
+            if (auto* arr = roots->as_array()) {
+                for (const auto& item : *arr) {
+                    if (auto* str = item.as_string()) {
+                        settings.library.roots.push_back(str->get());
+                    }
+                }
+            }
+        }
+    }
+
+    // Batch export settings
+    if (auto* export_images = tbl["export"].as_table()) {
+        settings.export_images.max_side = get_or(*export_images, "max_side", 2048);
+        settings.export_images.jpeg_quality = get_or(*export_images, "jpeg_quality", 85);
     }
 
     // Language setting
@@ -208,24 +271,49 @@ toml::table serialize_settings(const Settings& settings) {
 
     // Thumbnail settings
     tbl.insert("thumbnails", toml::table{
-                                 { "stored_size",  settings.thumbnails.stored_size},
-                                 {"display_size", settings.thumbnails.display_size},
-                                 {"buffer_count", settings.thumbnails.buffer_count},
-                                 {"worker_count", settings.thumbnails.worker_count},
+                                 {      "stored_size",       settings.thumbnails.stored_size},
+                                 {     "display_size",      settings.thumbnails.display_size},
+                                 {     "buffer_count",      settings.thumbnails.buffer_count},
+                                 {     "worker_count",      settings.thumbnails.worker_count},
+                                 {  "io_worker_count",   settings.thumbnails.io_worker_count},
+                                 { "adaptive_workers",  settings.thumbnails.adaptive_workers},
+                                 {       "mip_levels",        settings.thumbnails.mip_levels},
+                                 {      "pregenerate",       settings.thumbnails.pregenerate},
+                                 {"pregenerate_depth", settings.thumbnails.pregenerate_depth},
+                                 {      "progressive",       settings.thumbnails.progressive},
+                                 {      "shell_cache",       settings.thumbnails.shell_cache},
+                                 {      "gpu_scaling",       settings.thumbnails.gpu_scaling},
+                                 {   "trace_requests",    settings.thumbnails.trace_requests},
     });
 
     // Cache settings
     toml::table cache_tbl{
-        {         "location",  std::string(to_string(settings.cache.location))},
-        {      "max_size_mb", static_cast<int64_t>(settings.cache.max_size_mb)},
-        {      "max_entries", static_cast<int64_t>(settings.cache.max_entries)},
-        {"compression_level",                 settings.cache.compression_level},
-        {"retention_enabled",                 settings.cache.retention_enabled},
-        {   "retention_days",                    settings.cache.retention_days},
+        {                    "location",      std::string(to_string(settings.cache.location))},
+        {                 "max_size_mb",     static_cast<int64_t>(settings.cache.max_size_mb)},
+        {                 "max_entries",     static_cast<int64_t>(settings.cache.max_entries)},
+        {             "memory_cache_mb", static_cast<int64_t>(settings.cache.memory_cache_mb)},
+        {           "compression_level",                     settings.cache.compression_level},
+        {                "jpeg_quality",                          settings.cache.jpeg_quality},
+        {             "zstd_dictionary",                       settings.cache.zstd_dictionary},
+        {                     "storage",       std::string(to_string(settings.cache.storage))},
+        {                 "deduplicate",                           settings.cache.deduplicate},
+        {           "retention_enabled",                     settings.cache.retention_enabled},
+        {              "retention_days",                        settings.cache.retention_days},
+        {              "sqlite_mmap_mb",                        settings.cache.sqlite_mmap_mb},
+        {            "sqlite_page_size",                      settings.cache.sqlite_page_size},
+        {   "sqlite_wal_autocheckpoint",             settings.cache.sqlite_wal_autocheckpoint},
+        {"sqlite_background_checkpoint",          settings.cache.sqlite_background_checkpoint},
+        {      "sqlite_busy_timeout_ms",                settings.cache.sqlite_busy_timeout_ms},
     };
     if (!settings.cache.custom_path.empty()) {
         cache_tbl.insert("custom_path", to_utf8(settings.cache.custom_path.wstring()));
     }
+    if (!settings.cache.shared_path.empty()) {
+        cache_tbl.insert("shared_path", to_utf8(settings.cache.shared_path.wstring()));
+    }
+    if (!settings.cache.migrate_from.empty()) {
+        cache_tbl.insert("migrate_from", to_utf8(settings.cache.migrate_from.wstring()));
+    }
     tbl.insert("cache", std::move(cache_tbl));
 
     // Sorting settings
@@ -246,8 +334,11 @@ toml::table serialize_settings(const Settings& settings) {
     }
 
     // Viewer settings
-    tbl.insert("viewer", toml::table{
-                             {"display_mode", std::string(to_string(settings.viewer_display_mode))},
+    tbl.insert("viewer",
+               toml::table{
+                   {         "display_mode", std::string(to_string(settings.viewer_display_mode))},
+                   {     "color_management",                            settings.color_management},
+                   {"slideshow_interval_ms",                       settings.slideshow_interval_ms},
     });
 
     // File operations
@@ -258,6 +349,7 @@ toml::table serialize_settings(const Settings& settings) {
                    {    "use_recycle_bin",                             settings.use_recycle_bin},
                    {  "show_hidden_files",                           settings.show_hidden_files},
                    {   "show_images_only",                            settings.show_images_only},
+                   { "flatten_subfolders",                          settings.flatten_subfolders},
     });
 
     // Main window state
@@ -294,7 +386,8 @@ toml::table serialize_settings(const Settings& settings) {
 
     // Startup settings
     toml::table startup_tbl{
-        {"directory", std::string(to_string(settings.startup_directory))},
+        {      "directory", std::string(to_string(settings.startup_directory))},
+        {"single_instance",                           settings.single_instance},
     };
     if (!settings.custom_startup_path.empty()) {
         startup_tbl.insert("custom_path", to_utf8(settings.custom_startup_path.wstring()));
@@ -303,19 +396,46 @@ toml::table serialize_settings(const Settings& settings) {
 
     // Application state
     if (!settings.last_directory.empty()) {
-        tbl.insert("state", toml::table{
-                                {"last_directory", to_utf8(settings.last_directory.wstring())},
+        tbl.insert("state",
+                   toml::table{
+                       {    "last_directory",        to_utf8(settings.last_directory.wstring())},
+                       { "last_scroll_index",  static_cast<int64_t>(settings.last_scroll_index)},
+                       {"last_visible_count", static_cast<int64_t>(settings.last_visible_count)},
         });
     }
 
     // Plugin settings
+    toml::table plugins_tbl{
+        {       "isolate",        settings.plugins.isolate},
+        {"host_processes", settings.plugins.host_processes},
+    };
     if (!settings.plugins.disabled_plugins.empty()) {
         toml::array disabled_arr;
         for (const auto& name : settings.plugins.disabled_plugins) {
             disabled_arr.push_back(name);
         }
-        tbl.insert("plugins", toml::table{{"disabled", std::move(disabled_arr)}});
+        plugins_tbl.insert("disabled", std::move(disabled_arr));
     }
+    tbl.insert("plugins", std::move(plugins_tbl));
+
+    // Library index settings
+    toml::table library_tbl{
+        {"enabled", settings.library.index_enabled},
+    };
+    if (!settings.library.roots.empty()) {
+        toml::array roots_arr;
+        for (const auto& root : settings.library.roots) {
+            roots_arr.push_back(root);
+        }
+        library_tbl.insert("roots", std::move(roots_arr));
+    }
+    tbl.insert("library", std::move(library_tbl));
+
+    // Batch export settings
+    tbl.insert("export", toml::table{
+                             {"max_side", settings.export_images.max_side},
+                             {"jpeg_quality", settings.export_images.jpeg_quality},
+    });
 
     // Language setting
     tbl.insert("i18n", toml::table{
@@ -387,7 +507,10 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         // Create parent directories
         std::filesystem::create_directories(path.parent_path());
 
-        std::ofstream file(path);
+        // Written aside and renamed, so a crash never leaves half a file
+        auto temp = path;
+        temp += L".tmp";
+        std::ofstream file(temp, std::ios::trunc);
         if (!file) {
             return std::unexpected(ConfigError::IoError);
         }
@@ -406,6 +529,17 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         file << "display_size = " << settings.thumbnails.display_size << "\n";
         file << "buffer_count = " << settings.thumbnails.buffer_count << "\n";
         file << "worker_count = " << settings.thumbnails.worker_count << "\n";
+        file << "io_worker_count = " << settings.thumbnails.io_worker_count << "\n";
+        file << "adaptive_workers = " << (settings.thumbnails.adaptive_workers ? "true" : "false")
+             << "\n";
+        file << "mip_levels = " << settings.thumbnails.mip_levels << "\n";
+        file << "pregenerate = " << (settings.thumbnails.pregenerate ? "true" : "false") << "\n";
+        file << "pregenerate_depth = " << settings.thumbnails.pregenerate_depth << "\n";
+        file << "progressive = " << (settings.thumbnails.progressive ? "true" : "false") << "\n";
+        file << "shell_cache = " << (settings.thumbnails.shell_cache ? "true" : "false") << "\n";
+        file << "gpu_scaling = " << (settings.thumbnails.gpu_scaling ? "true" : "false") << "\n";
+        file << "trace_requests = " << (settings.thumbnails.trace_requests ? "true" : "false")
+             << "\n";
         file << "\n";
 
         // Cache settings
@@ -414,12 +548,31 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         if (!settings.cache.custom_path.empty()) {
             file << "custom_path = \"" << to_utf8(settings.cache.custom_path.wstring()) << "\"\n";
         }
+        if (!settings.cache.shared_path.empty()) {
+            file << "shared_path = \"" << to_utf8(settings.cache.shared_path.wstring()) << "\"\n";
+        }
+        if (!settings.cache.migrate_from.empty()) {
+            file << "migrate_from = \"" << to_utf8(settings.cache.migrate_from.wstring())
+                 << "\"\n";
+        }
         file << "max_size_mb = " << settings.cache.max_size_mb << "\n";
         file << "max_entries = " << settings.cache.max_entries << "\n";
+        file << "memory_cache_mb = " << settings.cache.memory_cache_mb << "\n";
         file << "compression_level = " << settings.cache.compression_level << "\n";
+        file << "jpeg_quality = " << settings.cache.jpeg_quality << "\n";
+        file << "zstd_dictionary = " << (settings.cache.zstd_dictionary ? "true" : "false")
+             << "\n";
+        file << "storage = \"" << to_string(settings.cache.storage) << "\"\n";
+        file << "deduplicate = " << (settings.cache.deduplicate ? "true" : "false") << "\n";
         file << "retention_enabled = " << (settings.cache.retention_enabled ? "true" : "false")
              << "\n";
         file << "retention_days = " << settings.cache.retention_days << "\n";
+        file << "sqlite_mmap_mb = " << settings.cache.sqlite_mmap_mb << "\n";
+        file << "sqlite_page_size = " << settings.cache.sqlite_page_size << "\n";
+        file << "sqlite_wal_autocheckpoint = " << settings.cache.sqlite_wal_autocheckpoint << "\n";
+        file << "sqlite_background_checkpoint = "
+             << (settings.cache.sqlite_background_checkpoint ? "true" : "false") << "\n";
+        file << "sqlite_busy_timeout_ms = " << settings.cache.sqlite_busy_timeout_ms << "\n";
         file << "\n";
 
         // Sorting settings
@@ -445,6 +598,8 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         // Viewer settings
         file << "[viewer]\n";
         file << "display_mode = \"" << to_string(settings.viewer_display_mode) << "\"\n";
+        file << "color_management = " << (settings.color_management ? "true" : "false") << "\n";
+        file << "slideshow_interval_ms = " << settings.slideshow_interval_ms << "\n";
         file << "\n";
 
         // File operations
@@ -454,6 +609,8 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         file << "use_recycle_bin = " << (settings.use_recycle_bin ? "true" : "false") << "\n";
         file << "show_hidden_files = " << (settings.show_hidden_files ? "true" : "false") << "\n";
         file << "show_images_only = " << (settings.show_images_only ? "true" : "false") << "\n";
+        file << "flatten_subfolders = " << (settings.flatten_subfolders ? "true" : "false")
+             << "\n";
         file << "\n";
 
         // Main window state
@@ -491,18 +648,23 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
         if (!settings.custom_startup_path.empty()) {
             file << "custom_path = \"" << to_utf8(settings.custom_startup_path.wstring()) << "\"\n";
         }
+        file << "single_instance = " << (settings.single_instance ? "true" : "false") << "\n";
         file << "\n";
 
         // Application state
         if (!settings.last_directory.empty()) {
             file << "[state]\n";
             file << "last_directory = \"" << to_utf8(settings.last_directory.wstring()) << "\"\n";
+            file << "last_scroll_index = " << settings.last_scroll_index << "\n";
+            file << "last_visible_count = " << settings.last_visible_count << "\n";
             file << "\n";
         }
 
         // Plugin settings
+        file << "[plugins]\n";
+        file << "isolate = " << (settings.plugins.isolate ? "true" : "false") << "\n";
+        file << "host_processes = " << settings.plugins.host_processes << "\n";
         if (!settings.plugins.disabled_plugins.empty()) {
-            file << "[plugins]\n";
             file << "disabled = [\n";
             for (size_t i = 0; i < settings.plugins.disabled_plugins.size(); ++i) {
                 file << "    \"" << settings.plugins.disabled_plugins[i] << "\"";
@@ -511,14 +673,48 @@ std::expected<void, ConfigError> SettingsManager::saveTo(const Settings& setting
                 }
                 file << "\n";
             }
-            file << "]\n\n";
+            file << "]\n";
         }
+        file << "\n";
+
+        // Library index settings
+        file << "[library]\n";
+        file << "enabled = " << (settings.library.index_enabled ? "true" : "false") << "\n";
+        if (!settings.library.roots.empty()) {
+            file << "roots = [\n";
+            for (size_t i = 0; i < settings.library.roots.size(); ++i) {
+                file << "    \"" << settings.library.roots[i] << "\"";
+                if (i + 1 < settings.library.roots.size()) {
+                    file << ",";
+                }
+                file << "\n";
+            }
+            file << "]\n";
+        }
+        file << "\n";
+
+        // Batch export settings
+        file << "[export]\n";
+        file << "max_side = " << settings.export_images.max_side << "\n";
+        file << "jpeg_quality = " << settings.export_images.jpeg_quality << "\n";
+        file << "\n";
 
         // Language setting
         file << "[i18n]\n";
         file << "language = \"" << settings.language << "\"\n";
 #endif
 
+        file.close();
+        std::error_code ec;
+        if (file.fail()) {
+            std::filesystem::remove(temp, ec);
+            return std::unexpected(ConfigError::IoError);
+        }
+        std::filesystem::rename(temp, path, ec);
+        if (ec) {
+            std::filesystem::remove(temp, ec);
+            return std::unexpected(ConfigError::IoError);
+        }
         return {};
     } catch (const std::exception&) {
         return std::unexpected(ConfigError::IoError);
@@ -552,6 +748,24 @@ ValidationResult SettingsManager::validate(const Settings& settings) {
         result.valid = false;
     }
 
+    // I/O worker count
+    if (settings.thumbnails.io_worker_count < 1 || settings.thumbnails.io_worker_count > 8) {
+        result.errors.push_back("thumbnails.io_worker_count must be between 1 and 8");
+        result.valid = false;
+    }
+
+    // Mipmap levels
+    if (settings.thumbnails.mip_levels < 1 || settings.thumbnails.mip_levels > 3) {
+        result.errors.push_back("thumbnails.mip_levels must be between 1 and 3");
+        result.valid = false;
+    }
+
+    // Pre-generation depth
+    if (settings.thumbnails.pregenerate_depth < 0 || settings.thumbnails.pregenerate_depth > 4) {
+        result.errors.push_back("thumbnails.pregenerate_depth must be between 0 and 4");
+        result.valid = false;
+    }
+
     // Custom cache path
     if (settings.cache.location == CacheLocation::Custom && settings.cache.custom_path.empty()) {
         result.errors.push_back("cache.custom_path required when cache.location is custom");
@@ -571,6 +785,32 @@ ValidationResult SettingsManager::validate(const Settings& settings) {
         result.valid = false;
     }
 
+    // SQLite tuning
+    int page_size = settings.cache.sqlite_page_size;
+    if (page_size < 512 || page_size > 65536 || (page_size & (page_size - 1)) != 0) {
+        result.errors.push_back("cache.sqlite_page_size must be a power of two from 512 to 65536");
+        result.valid = false;
+    }
+    if (settings.cache.sqlite_mmap_mb < 0 || settings.cache.sqlite_wal_autocheckpoint < 0 ||
+        settings.cache.sqlite_busy_timeout_ms < 0) {
+        result.errors.push_back(
+            "cache.sqlite_mmap_mb, sqlite_wal_autocheckpoint and sqlite_busy_timeout_ms must not "
+            "be negative");
+        result.valid = false;
+    }
+
+    // JPEG quality
+    if (settings.cache.jpeg_quality < 0 || settings.cache.jpeg_quality > 100) {
+        result.errors.push_back("cache.jpeg_quality must be between 0 and 100");
+        result.valid = false;
+    }
+
+    // Memory cache budget
+    if (settings.cache.memory_cache_mb < 1) {
+        result.errors.push_back("cache.memory_cache_mb must be at least 1");
+        result.valid = false;
+    }
+
     // Retention days
     if (settings.cache.retention_enabled && settings.cache.retention_days < 1) {
         result.errors.push_back(
@@ -578,6 +818,28 @@ ValidationResult SettingsManager::validate(const Settings& settings) {
         result.valid = false;
     }
 
+    // Slideshow
+    if (settings.slideshow_interval_ms < 500 || settings.slideshow_interval_ms > 600000) {
+        result.errors.push_back("viewer.slideshow_interval_ms must be between 500 and 600000");
+        result.valid = false;
+    }
+
+    // Plugin host processes
+    if (settings.plugins.host_processes < 1 || settings.plugins.host_processes > 8) {
+        result.errors.push_back("plugins.host_processes must be between 1 and 8");
+        result.valid = false;
+    }
+
+    // Batch export
+    if (settings.export_images.max_side < 64 || settings.export_images.max_side > 16384) {
+        result.errors.push_back("export.max_side must be between 64 and 16384");
+        result.valid = false;
+    }
+    if (settings.export_images.jpeg_quality < 1 || settings.export_images.jpeg_quality > 100) {
+        result.errors.push_back("export.jpeg_quality must be between 1 and 100");
+        result.valid = false;
+    }
+
     // Warnings
     if (settings.thumbnails.stored_size > 1024) {
         result.warnings.push_back("Large thumbnail size may increase cache size significantly");
@@ -71,6 +71,9 @@ public:
     /// @param settings Settings to save
     /// @param path Path to save to
     /// @return Success or error
+    ///
+    /// Writes path.tmp and renames it over path, so a crash mid-write leaves
+    /// the previous file in place.
     [[nodiscard]] static std::expected<void, ConfigError> saveTo(const Settings& settings,
                                                                  const std::filesystem::path& path);
 
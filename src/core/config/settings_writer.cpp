@@ -0,0 +1,78 @@
+/// @file settings_writer.cpp
+/// @brief Debounced settings persistence implementation
+
+#include "settings_writer.hpp"
+
+#include <utility>
+
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+#include "settings_manager.hpp"
+
+namespace nive::config {
+
+SettingsWriter::SettingsWriter(std::filesystem::path path, std::chrono::milliseconds delay)
+    : path_(std::move(path)), delay_(delay),
+      thread_([this](std::stop_token stop) { run(stop); }) {}
+
+SettingsWriter::~SettingsWriter() {
+    // run() writes what is pending before it sees the stop
+    thread_.request_stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SettingsWriter::schedule(Settings settings) {
+    {
+        std::lock_guard lock(mutex_);
+        pending_ = std::move(settings);
+        due_ = std::chrono::steady_clock::now() + delay_;
+    }
+    wake_.notify_one();
+}
+
+void SettingsWriter::flush() {
+    std::unique_lock lock(mutex_);
+    if (!pending_ && !writing_) {
+        return;
+    }
+    flush_ = true;
+    wake_.notify_one();
+    idle_.wait(lock, [this] { return !pending_ && !writing_; });
+}
+
+void SettingsWriter::run(std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        wake_.wait(lock, stop, [this] { return pending_.has_value(); });
+        if (!pending_) {
+            return;  // Stopped with nothing left to write
+        }
+
+        // Each schedule() moves due_ back; a flush or stop writes at once
+        while (!flush_ && !stop.stop_requested() && std::chrono::steady_clock::now() < due_) {
+            wake_.wait_until(lock, stop, due_, [this] { return flush_; });
+        }
+
+        Settings settings = std::move(*pending_);
+        pending_.reset();
+        writing_ = true;
+        lock.unlock();
+
+        auto result = SettingsManager::saveTo(settings, path_);
+        if (!result) {
+            LOG_WARN("Failed to save settings to {}: {}", pathToUtf8(path_),
+                     to_string(result.error()));
+        }
+
+        lock.lock();
+        writing_ = false;
+        if (!pending_) {
+            flush_ = false;
+            idle_.notify_all();
+        }
+    }
+}
+
+}  // namespace nive::config
@@ -0,0 +1,66 @@
+/// @file settings_writer.hpp
+/// @brief Debounced settings persistence on a background thread
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "settings.hpp"
+
+namespace nive::config {
+
+/// @brief Writes settings snapshots to disk off the caller's thread
+///
+/// schedule() takes a copy and returns; the file is written once no newer
+/// snapshot has arrived for the delay, so a burst of window and view changes
+/// costs one write of the last one. Serialization and the atomic replace done
+/// by SettingsManager::saveTo() both run on the writer thread.
+class SettingsWriter {
+public:
+    static constexpr std::chrono::milliseconds kDefaultDelay{500};
+
+    /// @brief Start the writer thread
+    /// @param path File to write
+    /// @param delay Quiet time after the last schedule() before writing
+    explicit SettingsWriter(std::filesystem::path path,
+                            std::chrono::milliseconds delay = kDefaultDelay);
+
+    /// @brief Write any pending snapshot, then stop
+    ~SettingsWriter();
+
+    // Non-copyable, non-movable
+    SettingsWriter(const SettingsWriter&) = delete;
+    SettingsWriter& operator=(const SettingsWriter&) = delete;
+    SettingsWriter(SettingsWriter&&) = delete;
+    SettingsWriter& operator=(SettingsWriter&&) = delete;
+
+    /// @brief Queue a snapshot, replacing any not yet written
+    void schedule(Settings settings);
+
+    /// @brief Write the pending snapshot now and wait until it is on disk
+    void flush();
+
+private:
+    void run(std::stop_token stop);
+
+    std::filesystem::path path_;
+    std::chrono::milliseconds delay_;
+
+    std::mutex mutex_;
+    std::condition_variable_any wake_;  // schedule(), flush() and stop
+    std::condition_variable idle_;      // A write finished
+    std::optional<Settings> pending_;
+    std::chrono::steady_clock::time_point due_;
+    bool writing_ = false;
+    bool flush_ = false;
+
+    std::jthread thread_;  // Declared last: stopped before the state it uses
+};
+
+}  // namespace nive::config
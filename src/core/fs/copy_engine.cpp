@@ -0,0 +1,360 @@
+/// @file copy_engine.cpp
+/// @brief Parallel copy engine implementation
+
+#include "copy_engine.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../util/win32_utils.hpp"
+#include "io_scheduler.hpp"
+
+namespace nive::fs {
+
+namespace {
+
+constexpr auto kProgressInterval = std::chrono::milliseconds(100);
+
+/// @brief Attributes that SetFileAttributesW carries over to the copy
+constexpr DWORD kCopiedAttributes = FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN |
+                                    FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_ARCHIVE |
+                                    FILE_ATTRIBUTE_NOT_CONTENT_INDEXED;
+
+/// @brief Temporary path next to the destination (thread-safe)
+[[nodiscard]] std::filesystem::path temp_path_for(const std::filesystem::path& dest) {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    return dest.parent_path() / std::format(L".nive_tmp_{:016x}", rng());
+}
+
+/// @brief Rename a complete temporary file to the destination, or delete it
+[[nodiscard]] bool commit(const std::filesystem::path& temp, const CopyJob& job) {
+    DWORD flags = MOVEFILE_COPY_ALLOWED;
+    if (job.replace_existing) {
+        flags |= MOVEFILE_REPLACE_EXISTING;
+    }
+    if (MoveFileExW(temp.c_str(), job.dest.c_str(), flags)) {
+        return true;
+    }
+    DeleteFileW(temp.c_str());
+    return false;
+}
+
+/// @brief A small file read into memory
+struct LoadedFile {
+    size_t job = 0;
+    std::vector<uint8_t> data;
+    BY_HANDLE_FILE_INFORMATION info{};
+};
+
+[[nodiscard]] std::optional<LoadedFile> read_whole(const CopyJob& job, size_t index) {
+    HandleGuard file(CreateFileW(job.source.c_str(), GENERIC_READ,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                                 FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!file) {
+        return std::nullopt;
+    }
+
+    LoadedFile loaded{.job = index};
+    if (!GetFileInformationByHandle(file.get(), &loaded.info) || loaded.info.nFileSizeHigh != 0) {
+        return std::nullopt;
+    }
+    DWORD size = loaded.info.nFileSizeLow;
+    loaded.data.resize(size);
+    DWORD read = 0;
+    if (size > 0 &&
+        (!ReadFile(file.get(), loaded.data.data(), size, &read, nullptr) || read != size)) {
+        return std::nullopt;
+    }
+    return loaded;
+}
+
+[[nodiscard]] bool write_whole(const LoadedFile& loaded, const CopyJob& job,
+                               const CopyOptions& options) {
+    auto temp = temp_path_for(job.dest);
+    HandleGuard file(CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!file) {
+        return false;
+    }
+
+    auto size = static_cast<DWORD>(loaded.data.size());
+    DWORD written = 0;
+    bool ok = size == 0 || (WriteFile(file.get(), loaded.data.data(), size, &written, nullptr) &&
+                            written == size);
+    if (ok && options.preserve_timestamps) {
+        SetFileTime(file.get(), &loaded.info.ftCreationTime, &loaded.info.ftLastAccessTime,
+                    &loaded.info.ftLastWriteTime);
+    }
+    file.close();
+    if (!ok) {
+        DeleteFileW(temp.c_str());
+        return false;
+    }
+
+    if (DWORD attributes = loaded.info.dwFileAttributes & kCopiedAttributes; attributes != 0) {
+        SetFileAttributesW(temp.c_str(), attributes);
+    }
+    return commit(temp, job);
+}
+
+/// @brief State of one CopyFile2 call, seen by its progress routine
+struct LargeCopy {
+    std::stop_token stop;
+    std::atomic<uint64_t>* done = nullptr;
+    uint64_t reported = 0;
+};
+
+COPYFILE2_MESSAGE_ACTION CALLBACK copy_progress(const COPYFILE2_MESSAGE* message,
+                                                PVOID context) {
+    auto* copy = static_cast<LargeCopy*>(context);
+    if (message->Type == COPYFILE2_CALLBACK_CHUNK_FINISHED) {
+        uint64_t transferred = message->Info.ChunkFinished.uliTotalBytesTransferred.QuadPart;
+        *copy->done += transferred - copy->reported;
+        copy->reported = transferred;
+    }
+    return copy->stop.stop_requested() ? COPYFILE2_PROGRESS_CANCEL : COPYFILE2_PROGRESS_CONTINUE;
+}
+
+[[nodiscard]] bool copy_large(const CopyJob& job, const CopyOptions& options, LargeCopy& copy) {
+    auto temp = temp_path_for(job.dest);
+    COPYFILE2_EXTENDED_PARAMETERS params{};
+    params.dwSize = sizeof(params);
+    params.dwCopyFlags = COPY_FILE_NO_BUFFERING | COPY_FILE_FAIL_IF_EXISTS;
+    params.pProgressRoutine = copy_progress;
+    params.pvCallbackContext = &copy;
+    if (FAILED(CopyFile2(job.source.c_str(), temp.c_str(), &params))) {
+        DeleteFileW(temp.c_str());
+        return false;
+    }
+
+    // CopyFile2 keeps only the last write time
+    WIN32_FILE_ATTRIBUTE_DATA source{};
+    if (options.preserve_timestamps &&
+        GetFileAttributesExW(job.source.c_str(), GetFileExInfoStandard, &source)) {
+        HandleGuard file(CreateFileW(temp.c_str(), FILE_WRITE_ATTRIBUTES,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (file) {
+            SetFileTime(file.get(), &source.ftCreationTime, &source.ftLastAccessTime,
+                        &source.ftLastWriteTime);
+        }
+    }
+    return commit(temp, job);
+}
+
+class Engine {
+public:
+    Engine(std::span<const CopyJob> jobs, const CopyOptions& options,
+           const CopyEngineConfig& config)
+        : jobs_(jobs), options_(options), config_(config) {}
+
+    FileOperationResult run(const ProgressCallback& progress) {
+        uint64_t total = 0;
+        std::unordered_set<std::wstring> parents;
+        for (size_t i = 0; i < jobs_.size(); ++i) {
+            total += jobs_[i].size;
+            (jobs_[i].size >= config_.large_file_threshold ? large_ : small_).push_back(i);
+            parents.insert(jobs_[i].dest.parent_path().native());
+        }
+
+        // A directory that cannot be created shows up as failed writes
+        uint32_t parallel = config_.max_parallel;
+        for (const auto& parent : parents) {
+            std::error_code ec;
+            std::filesystem::create_directories(parent, ec);
+            if (config_.max_parallel == 0) {
+                parallel = std::max(parallel, IoScheduler::instance().slotCount(parent));
+            }
+        }
+        parallel = std::clamp<uint32_t>(parallel, 1, static_cast<uint32_t>(jobs_.size()));
+
+        reading_done_ = small_.empty();
+        running_ = parallel;
+        bool cancelled = false;
+        {
+            std::jthread reader;
+            if (!small_.empty()) {
+                reader = std::jthread([this] { read_small(); });
+            }
+            std::vector<std::jthread> workers;
+            for (uint32_t i = 0; i < parallel; ++i) {
+                workers.emplace_back([this] { work(); });
+            }
+
+            // Progress is reported here, so the callback never runs on a worker
+            std::unique_lock lock(mutex_);
+            while (running_ > 0) {
+                cv_.wait_for(lock, kProgressInterval, [this] { return running_ == 0; });
+                if (!progress || cancelled) {
+                    continue;
+                }
+                const auto& current = jobs_[current_.load()].source;
+                lock.unlock();
+                bool keep_going = progress(current, done_.load(), total);
+                lock.lock();
+                if (!keep_going) {
+                    cancelled = true;
+                    stop_.request_stop();
+                }
+            }
+        }
+
+        if (cancelled) {
+            result_.error = FileOperationError::Cancelled;
+        } else if (!result_.failed_files.empty()) {
+            result_.error = result_.files_processed > 0 ? FileOperationError::PartialSuccess
+                                                        : FileOperationError::IoError;
+        }
+        return std::move(result_);
+    }
+
+private:
+    /// @brief Read small files in job order, staying within the read-ahead budget
+    void read_small() {
+        auto stop = stop_.get_token();
+        for (size_t index : small_) {
+            const auto& job = jobs_[index];
+            {
+                std::unique_lock lock(mutex_);
+                if (!cv_.wait(lock, stop, [&] {
+                        return buffered_ == 0 || buffered_ + job.size <= config_.read_ahead_bytes;
+                    })) {
+                    break;
+                }
+            }
+
+            auto slot = IoScheduler::instance().acquire(job.source, IoPriority::Foreground, stop);
+            if (!slot) {
+                break;
+            }
+            auto loaded = read_whole(job, index);
+            slot.release();
+            if (!loaded) {
+                finish(index, false);
+                continue;
+            }
+            {
+                std::lock_guard lock(mutex_);
+                buffered_ += loaded->data.size();
+                loaded_.push_back(std::move(*loaded));
+            }
+            cv_.notify_all();
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            reading_done_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    /// @brief Write loaded small files and copy large ones until none are left
+    void work() {
+        auto stop = stop_.get_token();
+        for (;;) {
+            std::optional<LoadedFile> loaded;
+            size_t index = 0;
+            {
+                std::unique_lock lock(mutex_);
+                if (!cv_.wait(lock, stop, [this] {
+                        return !loaded_.empty() || next_large_ < large_.size() || reading_done_;
+                    })) {
+                    break;
+                }
+                if (!loaded_.empty()) {
+                    loaded = std::move(loaded_.front());
+                    loaded_.pop_front();
+                    buffered_ -= loaded->data.size();
+                    index = loaded->job;
+                } else if (next_large_ < large_.size()) {
+                    index = large_[next_large_++];
+                } else {
+                    break;
+                }
+            }
+            cv_.notify_all();  // The reader may be waiting for buffer room
+
+            const auto& job = jobs_[index];
+            current_ = index;
+            auto slot = IoScheduler::instance().acquire(job.dest, IoPriority::Foreground, stop);
+            if (!slot) {
+                break;
+            }
+            if (loaded) {
+                finish(index, write_whole(*loaded, job, options_));
+                continue;
+            }
+
+            LargeCopy copy{.stop = stop, .done = &done_};
+            bool ok = copy_large(job, options_, copy);
+            if (!ok && stop.stop_requested()) {
+                break;
+            }
+            done_ -= std::min(copy.reported, job.size);  // finish() adds the whole size
+            finish(index, ok);
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            --running_;
+        }
+        cv_.notify_all();
+    }
+
+    void finish(size_t index, bool ok) {
+        const auto& job = jobs_[index];
+        done_ += job.size;
+        std::lock_guard lock(mutex_);
+        if (ok) {
+            ++result_.files_processed;
+            result_.bytes_processed += job.size;
+        } else {
+            result_.failed_files.push_back(job.source);
+        }
+    }
+
+    const std::span<const CopyJob> jobs_;
+    const CopyOptions& options_;
+    const CopyEngineConfig& config_;
+    std::vector<size_t> small_;  // Job indices, set before the threads start
+    std::vector<size_t> large_;
+
+    std::stop_source stop_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::deque<LoadedFile> loaded_;  // Guarded by mutex_
+    uint64_t buffered_ = 0;          // Bytes in loaded_; guarded by mutex_
+    size_t next_large_ = 0;          // Guarded by mutex_
+    bool reading_done_ = false;      // Guarded by mutex_
+    uint32_t running_ = 0;           // Workers not yet finished; guarded by mutex_
+    FileOperationResult result_;     // Guarded by mutex_
+
+    std::atomic<uint64_t> done_{0};   // Bytes copied, for progress
+    std::atomic<size_t> current_{0};  // Job last started, for progress
+};
+
+}  // namespace
+
+FileOperationResult copyInParallel(std::span<const CopyJob> jobs, const CopyOptions& options,
+                                   const CopyEngineConfig& config, ProgressCallback progress) {
+    if (jobs.empty()) {
+        return {};
+    }
+    Engine engine(jobs, options, config);
+    return engine.run(progress);
+}
+
+}  // namespace nive::fs
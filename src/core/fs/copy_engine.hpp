@@ -0,0 +1,52 @@
+/// @file copy_engine.hpp
+/// @brief Parallel copy of a batch of files
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "file_operations.hpp"
+
+namespace nive::fs {
+
+/// @brief One file for copyInParallel()
+struct CopyJob {
+    std::filesystem::path source;
+    std::filesystem::path dest;
+    uint64_t size = 0;              // Expected size, for scheduling and progress
+    bool replace_existing = false;  // Fails with the file unchanged if false and dest exists
+};
+
+/// @brief Tuning of copyInParallel()
+struct CopyEngineConfig {
+    uint32_t max_parallel = 0;                        // 0 = the destination's I/O slots
+    uint64_t large_file_threshold = 8 * 1024 * 1024;  // From here on, CopyFile2 unbuffered
+    uint64_t read_ahead_bytes = 64 * 1024 * 1024;     // Small-file data read, not yet written
+};
+
+/// @brief Copy a batch of files with bounded parallelism on the destination volume
+///
+/// Small files are read whole by a reader thread, in job order and up to
+/// read_ahead_bytes ahead, and written by the copy workers; that keeps many
+/// small writes in flight on a latency-bound target (USB stick, SMB share).
+/// Large files are copied by the workers with CopyFile2 and
+/// COPY_FILE_NO_BUFFERING, so they neither go through nor evict the cache.
+/// Every write holds an IoScheduler slot of the destination volume.
+///
+/// Each file is written to a temporary name next to its destination and
+/// renamed into place, as safeCopyFile() does. Progress is reported on the
+/// calling thread several times a second; returning false cancels the
+/// batch, and files not yet finished are then neither processed nor failed.
+/// @param jobs Files to copy
+/// @param options Copy options (preserve_timestamps is honoured here)
+/// @param config Engine tuning
+/// @param progress Progress callback (optional)
+/// @return Operation result
+[[nodiscard]] FileOperationResult copyInParallel(std::span<const CopyJob> jobs,
+                                                 const CopyOptions& options,
+                                                 const CopyEngineConfig& config = {},
+                                                 ProgressCallback progress = nullptr);
+
+}  // namespace nive::fs
@@ -7,10 +7,21 @@
 #include <ShlObj.h>
 
 #include <algorithm>
+#include <condition_variable>
 #include <cwctype>
+#include <execution>
 #include <future>
-#include <thread>
-
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+
+#include "../util/executor.hpp"
+#include "../util/task_group.hpp"
+#include "../util/thread_pool.hpp"
+#include "directory_reader.hpp"
+#include "io_scheduler.hpp"
 #include "natural_sort.hpp"
 
 namespace nive::fs {
@@ -69,125 +80,529 @@ namespace {
     return true;
 }
 
-/// @brief Sort entries according to sort order
-void sort_entries(std::vector<FileMetadata>& entries, SortOrder order) {
-    auto compare = [order](const FileMetadata& a, const FileMetadata& b) -> bool {
-        // Directories always come first (except for type sort)
-        if (order != SortOrder::Type && order != SortOrder::TypeDesc) {
-            if (a.is_directory() != b.is_directory()) {
-                return a.is_directory();
-            }
+// Listings at least this large are sorted on all cores
+constexpr size_t kParallelSortThreshold = 16 * 1024;
+
+// Names tokenized per parallel task when filling sort keys
+constexpr size_t kSortKeyGrain = 2048;
+
+/// @brief Check if a sort order compares names naturally (for ties, in type order)
+[[nodiscard]] constexpr bool uses_natural_keys(SortOrder order) noexcept {
+    switch (order) {
+    case SortOrder::Name:
+    case SortOrder::NameDesc:
+    case SortOrder::Size:
+    case SortOrder::SizeDesc:
+    case SortOrder::Modified:
+    case SortOrder::ModifiedDesc:
+    case SortOrder::Taken:
+    case SortOrder::TakenDesc:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/// @brief Compute an entry's natural sort key if it has none yet
+void fill_sort_key(FileMetadata& entry) {
+    if (entry.sort_key.empty() && !entry.name.empty()) {
+        entry.sort_key = naturalSortKey(entry.name);
+    }
+}
+
+/// @brief Order two entries for a sort order
+[[nodiscard]] bool entry_less(const FileMetadata& a, const FileMetadata& b, SortOrder order) {
+    // Directories always come first (except for type sort)
+    if (order != SortOrder::Type && order != SortOrder::TypeDesc) {
+        if (a.is_directory() != b.is_directory()) {
+            return a.is_directory();
         }
+    }
+
+    switch (order) {
+    case SortOrder::Natural:
+        return a.sort_key < b.sort_key;
 
-        switch (order) {
-        case SortOrder::Natural:
-            return naturalCompare(a.name, b.name) < 0;
+    case SortOrder::NaturalDesc:
+        return a.sort_key > b.sort_key;
 
-        case SortOrder::NaturalDesc:
-            return naturalCompare(a.name, b.name) > 0;
+    case SortOrder::Name:
+        return a.name < b.name;
 
-        case SortOrder::Name:
-            return a.name < b.name;
+    case SortOrder::NameDesc:
+        return a.name > b.name;
 
-        case SortOrder::NameDesc:
-            return a.name > b.name;
+    case SortOrder::Size:
+        return a.size_bytes < b.size_bytes;
 
-        case SortOrder::Size:
-            return a.size_bytes < b.size_bytes;
+    case SortOrder::SizeDesc:
+        return a.size_bytes > b.size_bytes;
 
-        case SortOrder::SizeDesc:
-            return a.size_bytes > b.size_bytes;
+    case SortOrder::Modified:
+        return a.modified_time < b.modified_time;
 
-        case SortOrder::Modified:
-            return a.modified_time < b.modified_time;
+    case SortOrder::ModifiedDesc:
+        return a.modified_time > b.modified_time;
 
-        case SortOrder::ModifiedDesc:
-            return a.modified_time > b.modified_time;
+    case SortOrder::Type: {
+        if (a.extension != b.extension) {
+            return a.extension < b.extension;
+        }
+        return a.sort_key < b.sort_key;
+    }
 
-        case SortOrder::Type: {
-            if (a.extension != b.extension) {
-                return a.extension < b.extension;
+    case SortOrder::TypeDesc: {
+        if (a.extension != b.extension) {
+            return a.extension > b.extension;
+        }
+        return a.sort_key > b.sort_key;
+    }
+
+    case SortOrder::Taken:
+        return a.date_taken.value_or(a.modified_time) < b.date_taken.value_or(b.modified_time);
+
+    case SortOrder::TakenDesc:
+        return a.date_taken.value_or(a.modified_time) > b.date_taken.value_or(b.modified_time);
+
+    // Files without a camera come last either way
+    case SortOrder::Camera: {
+        if (a.camera_model != b.camera_model) {
+            if (a.camera_model.empty() || b.camera_model.empty()) {
+                return b.camera_model.empty();
             }
-            return naturalCompare(a.name, b.name) < 0;
+            return a.camera_model < b.camera_model;
         }
+        return a.sort_key < b.sort_key;
+    }
 
-        case SortOrder::TypeDesc: {
-            if (a.extension != b.extension) {
-                return a.extension > b.extension;
+    case SortOrder::CameraDesc: {
+        if (a.camera_model != b.camera_model) {
+            if (a.camera_model.empty() || b.camera_model.empty()) {
+                return b.camera_model.empty();
             }
-            return naturalCompare(a.name, b.name) > 0;
+            return a.camera_model > b.camera_model;
         }
+        return a.sort_key > b.sort_key;
+    }
 
-        default:
-            return naturalCompare(a.name, b.name) < 0;
+    default:
+        return a.sort_key < b.sort_key;
+    }
+}
+
+/// @brief Sort entries according to sort order
+void sort_entries(std::vector<FileMetadata>& entries, SortOrder order) {
+    bool parallel = entries.size() >= kParallelSortThreshold;
+
+    // Tokenize each name once; the comparator then only compares bytes
+    if (uses_natural_keys(order)) {
+        if (parallel) {
+            parallelFor(0, entries.size(), kSortKeyGrain, [&entries](size_t first, size_t last) {
+                std::for_each(entries.begin() + static_cast<std::ptrdiff_t>(first),
+                              entries.begin() + static_cast<std::ptrdiff_t>(last), fill_sort_key);
+            });
+        } else {
+            std::for_each(entries.begin(), entries.end(), fill_sort_key);
         }
+    }
+
+    auto compare = [order](const FileMetadata& a, const FileMetadata& b) {
+        return entry_less(a, b, order);
     };
 
-    std::sort(entries.begin(), entries.end(), compare);
-}
+    if (!parallel) {
+        std::sort(entries.begin(), entries.end(), compare);
+        return;
+    }
 
-}  // namespace
+    // Sort a permutation, so each entry is moved once rather than swapped
+    // around by every pass of the sort
+    std::vector<uint32_t> permutation(entries.size());
+    std::iota(permutation.begin(), permutation.end(), 0u);
+    std::sort(std::execution::par, permutation.begin(), permutation.end(),
+              [&entries, &compare](uint32_t a, uint32_t b) {
+                  return compare(entries[a], entries[b]);
+              });
 
-std::expected<DirectoryListing, DirectoryError> scanDirectory(const std::filesystem::path& path,
-                                                              const DirectoryFilter& filter,
-                                                              SortOrder sort_order) {
-    // Check if path exists
-    std::error_code ec;
-    if (!std::filesystem::exists(path, ec)) {
-        return std::unexpected(DirectoryError::NotFound);
+    std::vector<FileMetadata> sorted;
+    sorted.reserve(entries.size());
+    for (uint32_t index : permutation) {
+        sorted.push_back(std::move(entries[index]));
     }
+    entries = std::move(sorted);
+}
 
-    if (!std::filesystem::is_directory(path, ec)) {
-        return std::unexpected(DirectoryError::NotADirectory);
+/// @brief Owns a FindFirstFileExW search handle
+class FindHandle {
+public:
+    explicit FindHandle(HANDLE handle) noexcept : handle_(handle) {}
+    ~FindHandle() {
+        if (handle_ != INVALID_HANDLE_VALUE) {
+            FindClose(handle_);
+        }
     }
 
-    DirectoryListing listing;
-    listing.path = path;
+    FindHandle(const FindHandle&) = delete;
+    FindHandle& operator=(const FindHandle&) = delete;
 
-    // Use Windows API for better performance and attribute access
-    WIN32_FIND_DATAW find_data;
+    [[nodiscard]] bool valid() const noexcept { return handle_ != INVALID_HANDLE_VALUE; }
+    [[nodiscard]] HANDLE get() const noexcept { return handle_; }
+
+private:
+    HANDLE handle_;
+};
+
+/// @brief Start a large-fetch search over all entries of a directory
+[[nodiscard]] HANDLE find_first(const std::filesystem::path& path, WIN32_FIND_DATAW& find_data,
+                                FINDEX_SEARCH_OPS search_op = FindExSearchNameMatch) {
     std::wstring search_path = path.wstring() + L"\\*";
+    return FindFirstFileExW(search_path.c_str(), FindExInfoBasic, &find_data, search_op, nullptr,
+                            FIND_FIRST_EX_LARGE_FETCH);
+}
 
-    HANDLE find_handle = FindFirstFileW(search_path.c_str(), &find_data);
-    if (find_handle == INVALID_HANDLE_VALUE) {
-        DWORD error = GetLastError();
-        if (error == ERROR_ACCESS_DENIED) {
-            return std::unexpected(DirectoryError::AccessDenied);
-        }
-        return std::unexpected(DirectoryError::IoError);
+[[nodiscard]] bool is_dot_entry(const wchar_t* name) noexcept {
+    return wcscmp(name, L".") == 0 || wcscmp(name, L"..") == 0;
+}
+
+/// @brief Build metadata from a directory record without another file system query
+[[nodiscard]] FileMetadata metadata_from_record(const std::filesystem::path& directory,
+                                                const DirectoryRecord& record) {
+    FileMetadata metadata;
+    metadata.path = directory / record.name;
+    metadata.name = record.name;
+    metadata.extension = metadata.path.extension().wstring();
+    metadata.attributes = fileAttributesFromWin32(record.attributes);
+    metadata.type = getFileType(metadata.path, metadata.attributes.is_directory);
+    metadata.size_bytes = record.size;
+    metadata.created_time = fileTimeToSystemClock(record.created);
+    metadata.modified_time = fileTimeToSystemClock(record.modified);
+    metadata.accessed_time = fileTimeToSystemClock(record.accessed);
+    metadata.file_id = record.id;
+    return metadata;
+}
+
+}  // namespace
+
+bool passesFilter(const FileMetadata& metadata, const DirectoryFilter& filter) {
+    return passes_filter(metadata, filter);
+}
+
+void sortEntries(std::vector<FileMetadata>& entries, SortOrder order) {
+    sort_entries(entries, order);
+}
+
+void mergeEntries(std::vector<FileMetadata>& entries, std::vector<FileMetadata> added,
+                  SortOrder order) {
+    if (added.empty()) {
+        return;
+    }
+    sort_entries(added, order);
+    if (uses_natural_keys(order)) {
+        std::for_each(entries.begin(), entries.end(), fill_sort_key);
     }
 
-    do {
-        // Skip . and ..
-        if (wcscmp(find_data.cFileName, L".") == 0 || wcscmp(find_data.cFileName, L"..") == 0) {
-            continue;
+    // The existing entries are sorted already; merging them with the few
+    // new ones is linear, where sorting everything again is not
+    auto middle = static_cast<std::ptrdiff_t>(entries.size());
+    entries.insert(entries.end(), std::make_move_iterator(added.begin()),
+                   std::make_move_iterator(added.end()));
+    std::inplace_merge(entries.begin(), entries.begin() + middle, entries.end(),
+                       [order](const FileMetadata& a, const FileMetadata& b) {
+                           return entry_less(a, b, order);
+                       });
+}
+
+std::expected<size_t, DirectoryError>
+enumerateDirectory(const std::filesystem::path& path, const DirectoryFilter& filter,
+                   const DirectoryChunkCallback& on_chunk, std::stop_token stop_token,
+                   size_t chunk_size) {
+    if (chunk_size == 0) {
+        chunk_size = kDefaultScanBatchSize;
+    }
+
+    // The listing counts as one reader of the volume for its whole duration
+    auto io_slot = IoScheduler::instance().acquire(path, IoPriority::Foreground, stop_token);
+    if (!io_slot) {
+        return std::unexpected(DirectoryError::Cancelled);
+    }
+
+    auto reader = DirectoryReader::open(path);
+    if (!reader) {
+        return std::unexpected(reader.error());
+    }
+
+    size_t emitted = 0;
+    std::vector<FileMetadata> chunk;
+    chunk.reserve(chunk_size);
+
+    DirectoryRecord record;
+    for (;;) {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DirectoryError::Cancelled);
         }
 
-        std::filesystem::path entry_path = path / find_data.cFileName;
-        auto metadata = getFileMetadata(entry_path);
+        auto more = reader->next(record);
+        if (!more) {
+            return std::unexpected(more.error());
+        }
+        if (!*more) {
+            break;
+        }
 
-        if (!metadata) {
+        // Cheap attribute checks before building the entry
+        if ((record.attributes & FILE_ATTRIBUTE_HIDDEN) && !filter.include_hidden) {
+            continue;
+        }
+        if ((record.attributes & FILE_ATTRIBUTE_SYSTEM) && !filter.include_system) {
             continue;
         }
 
-        // Apply filter
-        if (!passes_filter(*metadata, filter)) {
+        auto metadata = metadata_from_record(path, record);
+        if (!passes_filter(metadata, filter)) {
             continue;
         }
 
-        // Update statistics
-        if (metadata->is_directory()) {
-            ++listing.total_directories;
-        } else {
+        chunk.push_back(std::move(metadata));
+        if (chunk.size() >= chunk_size) {
+            emitted += chunk.size();
+            on_chunk(chunk);
+            chunk.clear();
+        }
+    }
+
+    if (!chunk.empty()) {
+        emitted += chunk.size();
+        on_chunk(chunk);
+    }
+
+    return emitted;
+}
+
+namespace {
+
+/// @brief State a flattened scan shares between its tasks and the scanning thread
+///
+/// Held by shared_ptr: a task may still be unlocking when the scan returns.
+struct TreeScan {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::filesystem::path> found;  // Subdirectories not yet queued
+    std::vector<FileMetadata> ready;           // Files not yet delivered
+    size_t in_flight = 0;                      // Directories being enumerated
+    uint64_t directories = 0;                  // Directories enumerated, root included
+    std::optional<DirectoryError> root_error;
+};
+
+/// @brief Enumerate one directory of a flattened scan (thread pool task)
+void scan_tree_directory(TreeScan& scan, const std::filesystem::path& directory, bool is_root,
+                         const DirectoryFilter& filter, std::stop_token stop_token,
+                         size_t chunk_size) {
+    // Directories have to come through to be descended into; files get the
+    // full filter below
+    DirectoryFilter walk_filter;
+    walk_filter.include_hidden = filter.include_hidden;
+    walk_filter.include_system = filter.include_system;
+
+    auto result = enumerateDirectory(
+        directory, walk_filter,
+        [&](std::vector<FileMetadata>& chunk) {
+            std::vector<std::filesystem::path> subdirectories;
+            std::vector<FileMetadata> files;
+            for (auto& entry : chunk) {
+                if (entry.is_directory()) {
+                    // Junctions and symbolic links could loop or leave the tree
+                    if (!entry.attributes.is_reparse_point) {
+                        subdirectories.push_back(std::move(entry.path));
+                    }
+                } else if (passes_filter(entry, filter)) {
+                    files.push_back(std::move(entry));
+                }
+            }
+            {
+                std::lock_guard lock(scan.mutex);
+                scan.found.insert(scan.found.end(),
+                                  std::make_move_iterator(subdirectories.begin()),
+                                  std::make_move_iterator(subdirectories.end()));
+                scan.ready.insert(scan.ready.end(), std::make_move_iterator(files.begin()),
+                                  std::make_move_iterator(files.end()));
+            }
+            scan.cv.notify_one();
+        },
+        stop_token, chunk_size);
+
+    {
+        std::lock_guard lock(scan.mutex);
+        if (!result && is_root) {
+            scan.root_error = result.error();
+        }
+        --scan.in_flight;
+        ++scan.directories;
+    }
+    scan.cv.notify_one();
+}
+
+/// @brief Scan a directory tree as one flat listing (see scanDirectory, filter.flatten)
+[[nodiscard]] std::expected<DirectoryListing, DirectoryError>
+scan_tree(const std::filesystem::path& path, const DirectoryFilter& filter, SortOrder sort_order,
+          std::stop_token stop_token, const DirectoryBatchCallback& batch_callback,
+          size_t batch_size) {
+    auto scan = std::make_shared<TreeScan>();
+    auto& pool = globalThreadPool();
+
+    DirectoryListing listing;
+    listing.path = path;
+    size_t streamed = 0;  // Entries already handed to batch_callback
+
+    // Unlike a single directory, the first chunks are held back only until
+    // the listing outgrows one batch
+    auto deliver = [&](std::vector<FileMetadata> files) {
+        for (const auto& entry : files) {
             ++listing.total_files;
-            listing.total_size_bytes += metadata->size_bytes;
+            listing.total_size_bytes += entry.size_bytes;
+        }
+        listing.entries.insert(listing.entries.end(), std::make_move_iterator(files.begin()),
+                               std::make_move_iterator(files.end()));
+        if (batch_callback && (streamed > 0 || listing.entries.size() > batch_size)) {
+            batch_callback(std::vector<FileMetadata>(
+                listing.entries.begin() + static_cast<std::ptrdiff_t>(streamed),
+                listing.entries.end()));
+            streamed = listing.entries.size();
+        }
+    };
+
+    std::vector<std::filesystem::path> pending{path};
+    bool root_submitted = false;
+
+    std::unique_lock lock(scan->mutex);
+    for (;;) {
+        pending.insert(pending.end(), std::make_move_iterator(scan->found.begin()),
+                       std::make_move_iterator(scan->found.end()));
+        scan->found.clear();
+
+        while (!stop_token.stop_requested() && !pending.empty() &&
+               scan->in_flight < kTreeScanParallelism) {
+            ++scan->in_flight;
+            bool is_root = !std::exchange(root_submitted, true);
+            (void)pool.submit([scan, directory = std::move(pending.back()), is_root, filter,
+                               stop_token, batch_size]() {
+                scan_tree_directory(*scan, directory, is_root, filter, stop_token, batch_size);
+            });
+            pending.pop_back();
+        }
+
+        if (!scan->ready.empty()) {
+            auto files = std::exchange(scan->ready, {});
+            lock.unlock();
+            deliver(std::move(files));
+            lock.lock();
+            continue;
+        }
+
+        // Once stopped, only the tasks still running are waited for
+        bool stopped = stop_token.stop_requested();
+        if (scan->in_flight == 0 && (pending.empty() || stopped)) {
+            break;
         }
+        // Run a queued task rather than block: on a pool worker (scanDirectoryAsync)
+        // the directory tasks may be queued behind this very thread
+        lock.unlock();
+        bool helped = pool.runPending(TaskPriority::Normal);
+        lock.lock();
+        if (helped) {
+            continue;
+        }
+        scan->cv.wait(lock, [&] {
+            return !scan->found.empty() || !scan->ready.empty() || scan->in_flight == 0 ||
+                   (!stopped && !pending.empty() && scan->in_flight < kTreeScanParallelism);
+        });
+    }
+    auto root_error = scan->root_error;
+    listing.total_directories = scan->directories > 0 ? scan->directories - 1 : 0;
+    lock.unlock();
+
+    if (stop_token.stop_requested()) {
+        return std::unexpected(DirectoryError::Cancelled);
+    }
+    if (root_error) {
+        return std::unexpected(*root_error);
+    }
+
+    sort_entries(listing.entries, sort_order);
+    return listing;
+}
+
+}  // namespace
+
+std::expected<DirectoryListing, DirectoryError> scanDirectory(const std::filesystem::path& path,
+                                                              const DirectoryFilter& filter,
+                                                              SortOrder sort_order) {
+    return scanDirectory(path, filter, sort_order, std::stop_token{});
+}
+
+std::expected<DirectoryListing, DirectoryError>
+scanDirectory(const std::filesystem::path& path, const DirectoryFilter& filter,
+              SortOrder sort_order, std::stop_token stop_token,
+              const DirectoryBatchCallback& batch_callback, size_t batch_size) {
+    // Check if path exists
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return std::unexpected(DirectoryError::NotFound);
+    }
+
+    if (!std::filesystem::is_directory(path, ec)) {
+        return std::unexpected(DirectoryError::NotADirectory);
+    }
+
+    if (filter.flatten) {
+        return scan_tree(path, filter, sort_order, stop_token, batch_callback, batch_size);
+    }
+
+    DirectoryListing listing;
+    listing.path = path;
 
-        listing.entries.push_back(std::move(*metadata));
+    // The first chunk is held back so a directory that fits in a single chunk
+    // is reported only through the final listing
+    bool held_first_chunk = false;
+    bool streaming = false;
+
+    auto result = enumerateDirectory(
+        path, filter,
+        [&](std::vector<FileMetadata>& chunk) {
+            for (const auto& entry : chunk) {
+                // Update statistics
+                if (entry.is_directory()) {
+                    ++listing.total_directories;
+                } else {
+                    ++listing.total_files;
+                    listing.total_size_bytes += entry.size_bytes;
+                }
+            }
 
-    } while (FindNextFileW(find_handle, &find_data));
+            size_t chunk_start = listing.entries.size();
+            listing.entries.insert(listing.entries.end(), std::make_move_iterator(chunk.begin()),
+                                   std::make_move_iterator(chunk.end()));
 
-    FindClose(find_handle);
+            if (!batch_callback) {
+                return;
+            }
+            if (!held_first_chunk) {
+                held_first_chunk = true;
+                return;
+            }
+            if (!streaming) {
+                // Second chunk: flush the held one as well
+                streaming = true;
+                chunk_start = 0;
+            }
+            batch_callback(std::vector<FileMetadata>(
+                listing.entries.begin() + static_cast<std::ptrdiff_t>(chunk_start),
+                listing.entries.end()));
+        },
+        stop_token, batch_size);
+
+    if (!result) {
+        return std::unexpected(result.error());
+    }
 
     // Sort entries
     sort_entries(listing.entries, sort_order);
@@ -195,22 +610,26 @@ std::expected<DirectoryListing, DirectoryError> scanDirectory(const std::filesys
     return listing;
 }
 
-void scanDirectoryAsync(
+std::jthread scanDirectoryAsync(
     const std::filesystem::path& path, const DirectoryFilter& filter, SortOrder sort_order,
     std::function<void(std::expected<DirectoryListing, DirectoryError>)> callback,
-    std::function<void(size_t, size_t)> progress_callback) {
-    // Launch async task
-    std::thread([path, filter, sort_order, callback = std::move(callback),
-                 progress_callback = std::move(progress_callback)]() {
-        auto result = scanDirectory(path, filter, sort_order);
-
-        // Progress callback (if provided) - report completion
-        if (progress_callback && result) {
-            progress_callback(result->entries.size(), result->entries.size());
+    DirectoryBatchCallback batch_callback, size_t batch_size) {
+    return std::jthread([path, filter, sort_order, callback = std::move(callback),
+                         batch_callback = std::move(batch_callback),
+                         batch_size](std::stop_token stop_token) {
+        auto result = scanDirectory(path, filter, sort_order, stop_token, batch_callback,
+                                    batch_size);
+        if (callback) {
+            callback(std::move(result));
         }
+    });
+}
 
-        callback(std::move(result));
-    }).detach();
+Task<std::expected<DirectoryListing, DirectoryError>>
+scanDirectoryAsync(std::filesystem::path path, DirectoryFilter filter, SortOrder sort_order,
+                   std::stop_token stop_token) {
+    co_await resumeOn(poolExecutor());
+    co_return scanDirectory(path, filter, sort_order, stop_token);
 }
 
 std::expected<std::vector<std::filesystem::path>, DirectoryError>
@@ -226,17 +645,20 @@ getSubdirectories(const std::filesystem::path& path, bool include_hidden) {
 
     std::vector<std::filesystem::path> subdirs;
 
+    // Directory-only search is a hint; file systems that ignore it still
+    // return files, which the attribute check below skips
     WIN32_FIND_DATAW find_data;
-    std::wstring search_path = path.wstring() + L"\\*";
-
-    HANDLE find_handle = FindFirstFileW(search_path.c_str(), &find_data);
-    if (find_handle == INVALID_HANDLE_VALUE) {
+    FindHandle find_handle(find_first(path, find_data, FindExSearchLimitToDirectories));
+    if (!find_handle.valid()) {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND) {
+            return subdirs;
+        }
         return std::unexpected(DirectoryError::IoError);
     }
 
     do {
         // Skip . and ..
-        if (wcscmp(find_data.cFileName, L".") == 0 || wcscmp(find_data.cFileName, L"..") == 0) {
+        if (is_dot_entry(find_data.cFileName)) {
             continue;
         }
 
@@ -257,9 +679,7 @@ getSubdirectories(const std::filesystem::path& path, bool include_hidden) {
 
         subdirs.push_back(path / find_data.cFileName);
 
-    } while (FindNextFileW(find_handle, &find_data));
-
-    FindClose(find_handle);
+    } while (FindNextFileW(find_handle.get(), &find_data));
 
     // Sort naturally
     std::sort(subdirs.begin(), subdirs.end(),
@@ -278,12 +698,32 @@ std::optional<std::filesystem::path> getParentDirectory(const std::filesystem::p
 }
 
 bool isDirectoryEmpty(const std::filesystem::path& path) {
-    std::error_code ec;
-    auto it = std::filesystem::directory_iterator(path, ec);
-    if (ec) {
+    // One small query answers it; the first batch holds the first real entry
+    constexpr size_t kProbeBufferSize = 4096;
+    auto reader = DirectoryReader::open(path, kProbeBufferSize);
+    if (!reader) {
         return true;  // Treat errors as empty
     }
-    return it == std::filesystem::directory_iterator{};
+    DirectoryRecord record;
+    auto more = reader->next(record);
+    return !more || !*more;
+}
+
+bool isPathReachable(const std::filesystem::path& path, std::chrono::milliseconds timeout) {
+    auto check = [](const std::filesystem::path& target) {
+        std::error_code ec;
+        return std::filesystem::exists(target, ec);
+    };
+    if (detectVolumeKind(path) != VolumeKind::Network) {
+        return check(path);
+    }
+
+    // Not on the pool: a hung probe would hold a worker, and the pool's
+    // shutdown, for as long as the redirector takes to give up
+    auto result = std::make_shared<std::promise<bool>>();
+    auto answer = result->get_future();
+    std::thread([result, path, check] { result->set_value(check(path)); }).detach();
+    return answer.wait_for(timeout) == std::future_status::ready && answer.get();
 }
 
 std::expected<size_t, DirectoryError> countFiles(const std::filesystem::path& path,
@@ -293,33 +733,8 @@ std::expected<size_t, DirectoryError> countFiles(const std::filesystem::path& pa
         return std::unexpected(DirectoryError::NotFound);
     }
 
-    size_t count = 0;
-
-    WIN32_FIND_DATAW find_data;
-    std::wstring search_path = path.wstring() + L"\\*";
-
-    HANDLE find_handle = FindFirstFileW(search_path.c_str(), &find_data);
-    if (find_handle == INVALID_HANDLE_VALUE) {
-        return std::unexpected(DirectoryError::IoError);
-    }
-
-    do {
-        if (wcscmp(find_data.cFileName, L".") == 0 || wcscmp(find_data.cFileName, L"..") == 0) {
-            continue;
-        }
-
-        std::filesystem::path entry_path = path / find_data.cFileName;
-        auto metadata = getFileMetadata(entry_path);
-
-        if (metadata && passes_filter(*metadata, filter)) {
-            ++count;
-        }
-
-    } while (FindNextFileW(find_handle, &find_data));
-
-    FindClose(find_handle);
-
-    return count;
+    // Entries are counted per chunk; the chunks themselves are discarded
+    return enumerateDirectory(path, filter, [](std::vector<FileMetadata>&) {});
 }
 
 std::vector<std::filesystem::path> getDrives() {
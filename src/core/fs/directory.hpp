@@ -3,12 +3,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <expected>
 #include <filesystem>
 #include <functional>
+#include <stop_token>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "../util/task.hpp"
 #include "file_metadata.hpp"
 
 namespace nive::fs {
@@ -19,7 +23,8 @@ enum class DirectoryError {
     NotFound,
     AccessDenied,
     NotADirectory,
-    IoError
+    IoError,
+    Cancelled
 };
 
 /// @brief Convert error to string
@@ -35,6 +40,8 @@ enum class DirectoryError {
         return "Not a directory";
     case DirectoryError::IoError:
         return "I/O error";
+    case DirectoryError::Cancelled:
+        return "Cancelled";
     default:
         return "Unknown error";
     }
@@ -51,9 +58,19 @@ enum class SortOrder {
     Modified,  // By modification time
     ModifiedDesc,
     Type,  // By file type/extension
-    TypeDesc
+    TypeDesc,
+    Taken,  // By EXIF capture date, else modification time
+    TakenDesc,
+    Camera,  // By camera model, then name
+    CameraDesc
 };
 
+/// @brief Check if a sort order needs FileMetadata::date_taken or camera_model
+[[nodiscard]] constexpr bool needsCaptureInfo(SortOrder order) noexcept {
+    return order == SortOrder::Taken || order == SortOrder::TakenDesc ||
+           order == SortOrder::Camera || order == SortOrder::CameraDesc;
+}
+
 /// @brief Filter options for directory scanning
 struct DirectoryFilter {
     bool include_hidden = false;
@@ -64,8 +81,37 @@ struct DirectoryFilter {
     bool archives_only = false;
 
     std::vector<std::wstring> extensions;  // Empty = all extensions
+
+    // Scans also list the files of every subdirectory, as one flat listing
+    // without the directories themselves (see scanDirectory)
+    bool flatten = false;
 };
 
+/// @brief Check whether an entry passes a filter
+/// @param metadata Entry to test
+/// @param filter Filter options
+[[nodiscard]] bool passesFilter(const FileMetadata& metadata, const DirectoryFilter& filter);
+
+/// @brief Sort entries in place; directories come first except in type order
+/// @param entries Entries to sort
+/// @param order Sort order
+///
+/// Natural orders compare precomputed keys (see naturalSortKey). Keys are
+/// stored in each entry's sort_key, so re-sorting the same entries in
+/// another order tokenizes no names again. Large listings compute keys and
+/// sort on all cores, ordering an index permutation instead of the entries.
+void sortEntries(std::vector<FileMetadata>& entries, SortOrder order);
+
+/// @brief Merge new entries into entries already sorted by sortEntries()
+/// @param entries Sorted entries, extended in place
+/// @param added Entries to merge in (in any order)
+/// @param order Sort order entries were sorted in
+///
+/// Sorts only the added entries, then merges in linear time, so a few
+/// changes to a large listing do not re-sort it.
+void mergeEntries(std::vector<FileMetadata>& entries, std::vector<FileMetadata> added,
+                  SortOrder order);
+
 /// @brief Directory listing result
 struct DirectoryListing {
     std::filesystem::path path;
@@ -84,16 +130,88 @@ struct DirectoryListing {
 scanDirectory(const std::filesystem::path& path, const DirectoryFilter& filter = {},
               SortOrder sort_order = SortOrder::Natural);
 
+/// @brief Callback receiving entries as they are enumerated (unsorted, already filtered)
+using DirectoryBatchCallback = std::function<void(std::vector<FileMetadata> batch)>;
+
+/// @brief Default number of entries per incremental batch
+inline constexpr size_t kDefaultScanBatchSize = 256;
+
+/// @brief Directories enumerated at once by a flattened scan
+inline constexpr size_t kTreeScanParallelism = 8;
+
+/// @brief Callback receiving one chunk of a streaming enumeration
+///
+/// The chunk may be moved from; entries are filtered but unsorted.
+using DirectoryChunkCallback = std::function<void(std::vector<FileMetadata>& chunk)>;
+
+/// @brief Enumerate a directory as a stream of chunks
+///
+/// Reads through DirectoryReader, so each round trip to the file system
+/// (notably SMB) returns as many entries as fit a large buffer, and builds
+/// FileMetadata (file IDs included) straight from the directory records
+/// without a per-entry attribute query.
+/// @param path Directory path
+/// @param filter Filter options
+/// @param on_chunk Called with every chunk of up to chunk_size entries
+/// @param stop_token Checked between entries; a stop request yields DirectoryError::Cancelled
+/// @param chunk_size Maximum entries per chunk
+/// @return Number of entries emitted or error
+[[nodiscard]] std::expected<size_t, DirectoryError>
+enumerateDirectory(const std::filesystem::path& path, const DirectoryFilter& filter,
+                   const DirectoryChunkCallback& on_chunk, std::stop_token stop_token = {},
+                   size_t chunk_size = kDefaultScanBatchSize);
+
+/// @brief Scan directory with cancellation and incremental delivery
+///
+/// Entries are handed to batch_callback in enumeration order every batch_size
+/// entries; the returned listing holds all entries in sorted order. A directory
+/// that fits in a single batch never invokes batch_callback.
+///
+/// With filter.flatten, subdirectories are enumerated in parallel on the
+/// global thread pool, one task per directory and at most
+/// kTreeScanParallelism at once. Batches then arrive in completion order,
+/// mixing directories; batch_callback is still called from the calling
+/// thread only. Subdirectories that cannot be read are skipped, and
+/// junctions and symbolic links are not followed.
+/// @param path Directory path
+/// @param filter Filter options
+/// @param sort_order Sort order
+/// @param stop_token Checked between entries; a stop request yields DirectoryError::Cancelled
+/// @param batch_callback Called from the scanning thread with each batch (optional)
+/// @param batch_size Entries per batch
+/// @return Directory listing or error
+[[nodiscard]] std::expected<DirectoryListing, DirectoryError>
+scanDirectory(const std::filesystem::path& path, const DirectoryFilter& filter,
+              SortOrder sort_order, std::stop_token stop_token,
+              const DirectoryBatchCallback& batch_callback = nullptr,
+              size_t batch_size = kDefaultScanBatchSize);
+
 /// @brief Scan directory asynchronously
+///
+/// The scan runs on the returned thread. Destroying the thread (or calling
+/// request_stop() on it) cancels the scan; callback then receives
+/// DirectoryError::Cancelled unless the scan had already completed.
 /// @param path Directory path
 /// @param filter Filter options
 /// @param sort_order Sort order
-/// @param callback Called with result
-/// @param progress_callback Called periodically with progress (optional)
-void scanDirectoryAsync(
+/// @param callback Called with result on the scanning thread
+/// @param batch_callback Called with incremental batches on the scanning thread (optional)
+/// @param batch_size Entries per batch
+/// @return Thread owning the scan
+[[nodiscard]] std::jthread scanDirectoryAsync(
     const std::filesystem::path& path, const DirectoryFilter& filter, SortOrder sort_order,
     std::function<void(std::expected<DirectoryListing, DirectoryError>)> callback,
-    std::function<void(size_t current, size_t total)> progress_callback = nullptr);
+    DirectoryBatchCallback batch_callback = nullptr, size_t batch_size = kDefaultScanBatchSize);
+
+/// @brief Scan directory as an awaitable task
+///
+/// The scan runs on the global ThreadPool, and the awaiting coroutine
+/// resumes there with the result; it hops back with resumeOn() if it
+/// needs another thread.
+/// @param stop_token Cancels the scan (result DirectoryError::Cancelled)
+[[nodiscard]] Task<std::expected<DirectoryListing, DirectoryError>>
+scanDirectoryAsync(std::filesystem::path path, DirectoryFilter filter, SortOrder sort_order,
+                   std::stop_token stop_token);
 
 /// @brief Get subdirectories of a directory
 /// @param path Directory path
@@ -111,6 +229,18 @@ getParentDirectory(const std::filesystem::path& path);
 /// @brief Check if directory is empty
 [[nodiscard]] bool isDirectoryEmpty(const std::filesystem::path& path);
 
+/// @brief Check that a path exists, waiting at most timeout for the answer
+/// @param path File or directory path
+/// @param timeout Time to wait on a network path
+/// @return false if the path does not exist or did not answer in time
+///
+/// Local paths are checked directly. A network path (see detectVolumeKind)
+/// is checked on a thread of its own, which is left to finish on its own
+/// when it overruns, so an offline SMB server costs the timeout rather than
+/// the redirector's 20 s or more.
+[[nodiscard]] bool isPathReachable(const std::filesystem::path& path,
+                                   std::chrono::milliseconds timeout);
+
 /// @brief Count files in directory (non-recursive)
 [[nodiscard]] std::expected<size_t, DirectoryError> countFiles(const std::filesystem::path& path,
                                                                const DirectoryFilter& filter = {});
@@ -0,0 +1,409 @@
+/// @file directory_model.cpp
+/// @brief Directory model implementation
+
+#include "directory_model.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+namespace nive::fs {
+
+namespace {
+
+constexpr uint32_t kNoPrefix = UINT32_MAX;
+constexpr int64_t kNoTime = INT64_MIN;
+
+// Attribute column bits
+constexpr uint8_t kDirectory = 1u << 0;
+constexpr uint8_t kHidden = 1u << 1;
+constexpr uint8_t kSystem = 1u << 2;
+constexpr uint8_t kReadonly = 1u << 3;
+constexpr uint8_t kArchiveBit = 1u << 4;
+constexpr uint8_t kCompressed = 1u << 5;
+constexpr uint8_t kEncrypted = 1u << 6;
+
+[[nodiscard]] uint8_t pack_attributes(const FileAttributes& attributes) noexcept {
+    return (attributes.is_directory ? kDirectory : 0) | (attributes.is_hidden ? kHidden : 0) |
+           (attributes.is_system ? kSystem : 0) | (attributes.is_readonly ? kReadonly : 0) |
+           (attributes.is_archive ? kArchiveBit : 0) |
+           (attributes.is_compressed ? kCompressed : 0) |
+           (attributes.is_encrypted ? kEncrypted : 0);
+}
+
+[[nodiscard]] FileAttributes unpack_attributes(uint8_t bits) noexcept {
+    return FileAttributes{
+        .is_directory = (bits & kDirectory) != 0,
+        .is_hidden = (bits & kHidden) != 0,
+        .is_system = (bits & kSystem) != 0,
+        .is_readonly = (bits & kReadonly) != 0,
+        .is_archive = (bits & kArchiveBit) != 0,
+        .is_compressed = (bits & kCompressed) != 0,
+        .is_encrypted = (bits & kEncrypted) != 0,
+    };
+}
+
+[[nodiscard]] std::chrono::system_clock::time_point to_time(int64_t ticks) noexcept {
+    return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+}
+
+[[nodiscard]] int64_t to_ticks(std::chrono::system_clock::time_point time) noexcept {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+}  // namespace
+
+/// @brief Columns for a run of rows, built once and shared between models
+struct DirectoryModel::Chunk {
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    /// @brief Where a row's strings are in the arenas
+    struct Strings {
+        uint32_t prefix = kNoPrefix;   // Path text before the file name
+        Span file_name;                // Path text from the file name on
+        Span name;                     // Usually the same text as file_name
+        Span extension;                // Usually the tail of name
+        Span sort_key;                 // In keys
+        uint32_t archive = kNoPrefix;  // Archive path of virtual_path
+        Span internal;                 // Internal path of virtual_path
+        Span camera_model;
+    };
+
+    std::wstring text;
+    std::string keys;
+    std::vector<Span> prefixes;  // Interned, in text
+
+    std::vector<Strings> strings;
+    std::vector<uint64_t> sizes;
+    std::vector<int64_t> created;  // system_clock ticks
+    std::vector<int64_t> modified;
+    std::vector<int64_t> accessed;
+    std::vector<FileType> types;
+    std::vector<uint8_t> attributes;
+    std::vector<FileId> ids;     // Empty if no row has one (archives, FAT)
+    std::vector<int64_t> taken;  // kNoTime if unknown; empty if no row has one
+    std::unordered_map<std::wstring_view, uint32_t> names;  // Into text; first row of a name
+    // Row::sourceId() of each row, kNoPathId until first asked for; chunks are
+    // shared by the models built on them, so each row is interned once
+    std::unique_ptr<std::atomic<PathId>[]> source_ids;
+
+    explicit Chunk(std::vector<FileMetadata>& entries);
+
+    [[nodiscard]] std::wstring_view view(Span span) const noexcept {
+        return std::wstring_view(text).substr(span.offset, span.length);
+    }
+
+    [[nodiscard]] std::wstring_view prefix(uint32_t index) const noexcept {
+        return index == kNoPrefix ? std::wstring_view() : view(prefixes[index]);
+    }
+
+private:
+    [[nodiscard]] Span add(std::wstring_view str) {
+        Span span{static_cast<uint32_t>(text.size()), static_cast<uint32_t>(str.size())};
+        text.append(str);
+        return span;
+    }
+
+    [[nodiscard]] uint32_t intern(std::wstring_view str,
+                                  std::unordered_map<std::wstring, uint32_t>& index) {
+        auto [it, inserted] =
+            index.try_emplace(std::wstring(str), static_cast<uint32_t>(prefixes.size()));
+        if (inserted) {
+            prefixes.push_back(add(str));
+        }
+        return it->second;
+    }
+};
+
+DirectoryModel::Chunk::Chunk(std::vector<FileMetadata>& entries) {
+    size_t count = entries.size();
+    strings.reserve(count);
+    sizes.reserve(count);
+    created.reserve(count);
+    modified.reserve(count);
+    accessed.reserve(count);
+    types.reserve(count);
+    attributes.reserve(count);
+
+    std::unordered_map<std::wstring, uint32_t> interned;
+    for (auto& entry : entries) {
+        Strings row;
+
+        // Split the path at its file name; the part before it is shared
+        const std::wstring& native = entry.path.native();
+        size_t file_name_length = entry.path.filename().native().size();
+        std::wstring_view whole(native);
+        std::wstring_view head = whole.substr(0, whole.size() - file_name_length);
+        std::wstring_view tail = whole.substr(head.size());
+        if (!head.empty()) {
+            row.prefix = intern(head, interned);
+        }
+        row.file_name = add(tail);
+
+        if (entry.name == tail) {
+            row.name = row.file_name;
+        } else {
+            row.name = add(entry.name);
+        }
+        std::wstring_view name = view(row.name);
+        if (name.ends_with(entry.extension)) {
+            row.extension = {row.name.offset + static_cast<uint32_t>(name.size() -
+                                                                     entry.extension.size()),
+                             static_cast<uint32_t>(entry.extension.size())};
+        } else {
+            row.extension = add(entry.extension);
+        }
+
+        row.sort_key = {static_cast<uint32_t>(keys.size()),
+                        static_cast<uint32_t>(entry.sort_key.size())};
+        keys.append(entry.sort_key);
+
+        if (entry.virtual_path) {
+            row.archive = intern(entry.virtual_path->archive_path().native(), interned);
+            row.internal = add(entry.virtual_path->internal_path());
+        }
+        if (!entry.camera_model.empty()) {
+            row.camera_model = add(entry.camera_model);
+        }
+
+        strings.push_back(row);
+        sizes.push_back(entry.size_bytes);
+        created.push_back(to_ticks(entry.created_time));
+        modified.push_back(to_ticks(entry.modified_time));
+        accessed.push_back(to_ticks(entry.accessed_time));
+        types.push_back(entry.type);
+        attributes.push_back(pack_attributes(entry.attributes));
+        if (entry.file_id.valid() && ids.empty()) {
+            ids.resize(strings.size() - 1);
+        }
+        if (!ids.empty()) {
+            ids.push_back(entry.file_id);
+        }
+        if (entry.date_taken && taken.empty()) {
+            taken.resize(strings.size() - 1, kNoTime);
+        }
+        if (!taken.empty()) {
+            taken.push_back(entry.date_taken ? to_ticks(*entry.date_taken) : kNoTime);
+        }
+    }
+    text.shrink_to_fit();
+    keys.shrink_to_fit();
+
+    // Views into text, so only once it no longer moves
+    names.reserve(count);
+    for (uint32_t i = 0; i < strings.size(); ++i) {
+        names.try_emplace(view(strings[i].name), i);
+    }
+    source_ids = std::make_unique<std::atomic<PathId>[]>(strings.size());
+}
+
+// ===== Row =====
+
+std::wstring_view DirectoryModel::Row::name() const noexcept {
+    return chunk_->view(chunk_->strings[index_].name);
+}
+
+std::wstring_view DirectoryModel::Row::extension() const noexcept {
+    return chunk_->view(chunk_->strings[index_].extension);
+}
+
+std::filesystem::path DirectoryModel::Row::path() const {
+    const auto& row = chunk_->strings[index_];
+    std::wstring native(chunk_->prefix(row.prefix));
+    native.append(chunk_->view(row.file_name));
+    return std::filesystem::path(std::move(native));
+}
+
+FileType DirectoryModel::Row::type() const noexcept {
+    return chunk_->types[index_];
+}
+
+FileAttributes DirectoryModel::Row::attributes() const noexcept {
+    return unpack_attributes(chunk_->attributes[index_]);
+}
+
+uint64_t DirectoryModel::Row::size_bytes() const noexcept {
+    return chunk_->sizes[index_];
+}
+
+std::chrono::system_clock::time_point DirectoryModel::Row::created_time() const noexcept {
+    return to_time(chunk_->created[index_]);
+}
+
+std::chrono::system_clock::time_point DirectoryModel::Row::modified_time() const noexcept {
+    return to_time(chunk_->modified[index_]);
+}
+
+std::chrono::system_clock::time_point DirectoryModel::Row::accessed_time() const noexcept {
+    return to_time(chunk_->accessed[index_]);
+}
+
+FileId DirectoryModel::Row::file_id() const noexcept {
+    return chunk_->ids.empty() ? FileId{} : chunk_->ids[index_];
+}
+
+std::optional<archive::VirtualPath> DirectoryModel::Row::virtual_path() const {
+    const auto& row = chunk_->strings[index_];
+    if (row.archive == kNoPrefix) {
+        return std::nullopt;
+    }
+    return archive::VirtualPath(std::filesystem::path(chunk_->prefix(row.archive)),
+                                std::wstring(chunk_->view(row.internal)));
+}
+
+std::optional<std::chrono::system_clock::time_point>
+DirectoryModel::Row::date_taken() const noexcept {
+    if (chunk_->taken.empty() || chunk_->taken[index_] == kNoTime) {
+        return std::nullopt;
+    }
+    return to_time(chunk_->taken[index_]);
+}
+
+std::wstring_view DirectoryModel::Row::camera_model() const noexcept {
+    return chunk_->view(chunk_->strings[index_].camera_model);
+}
+
+bool DirectoryModel::Row::is_directory() const noexcept {
+    return type() == FileType::Directory || (chunk_->attributes[index_] & kDirectory) != 0;
+}
+
+bool DirectoryModel::Row::is_in_archive() const noexcept {
+    // Matches VirtualPath::is_in_archive(): an entry path inside an archive
+    const auto& row = chunk_->strings[index_];
+    return row.archive != kNoPrefix && row.internal.length > 0;
+}
+
+std::wstring DirectoryModel::Row::sourceIdentifier() const {
+    if (is_in_archive()) {
+        return virtual_path()->to_string();
+    }
+    return path().wstring();
+}
+
+PathId DirectoryModel::Row::sourceId() const {
+    auto& cached = chunk_->source_ids[index_];
+    PathId id = cached.load(std::memory_order_relaxed);
+    if (id == kNoPathId) {
+        // A race interns the same string twice, to the same id
+        id = internPath(std::wstring_view(sourceIdentifier()));
+        cached.store(id, std::memory_order_relaxed);
+    }
+    return id;
+}
+
+FileMetadata DirectoryModel::Row::metadata() const {
+    const auto& row = chunk_->strings[index_];
+    FileMetadata metadata;
+    metadata.path = path();
+    metadata.name = name();
+    metadata.extension = extension();
+    metadata.type = type();
+    metadata.attributes = attributes();
+    metadata.size_bytes = size_bytes();
+    metadata.created_time = created_time();
+    metadata.modified_time = modified_time();
+    metadata.accessed_time = accessed_time();
+    metadata.file_id = file_id();
+    metadata.virtual_path = virtual_path();
+    metadata.date_taken = date_taken();
+    metadata.camera_model = camera_model();
+    metadata.sort_key =
+        std::string(std::string_view(chunk_->keys).substr(row.sort_key.offset,
+                                                          row.sort_key.length));
+    return metadata;
+}
+
+// ===== ModelDelta =====
+
+void ModelDelta::add(std::vector<IndexRange>& ranges, size_t index) {
+    if (!ranges.empty() && ranges.back().first + ranges.back().count == index) {
+        ++ranges.back().count;
+    } else {
+        ranges.push_back({index, 1});
+    }
+}
+
+std::optional<size_t> ModelDelta::map(size_t old_index) const noexcept {
+    size_t index = old_index;
+    for (const auto& range : removed) {
+        if (old_index < range.first) {
+            break;
+        }
+        if (old_index < range.first + range.count) {
+            return std::nullopt;
+        }
+        index -= range.count;
+    }
+    // index counts kept rows before the row; inserted rows ahead of it push it back
+    for (const auto& range : inserted) {
+        if (range.first > index) {
+            break;
+        }
+        index += range.count;
+    }
+    return index;
+}
+
+// ===== DirectoryModel =====
+
+DirectoryModel::DirectoryModel() = default;
+
+DirectoryModel::DirectoryModel(std::vector<FileMetadata> entries) {
+    if (!entries.empty()) {
+        size_ = entries.size();
+        chunks_.push_back(std::make_shared<const Chunk>(entries));
+        ends_.push_back(size_);
+    }
+}
+
+DirectoryModel::~DirectoryModel() = default;
+
+std::shared_ptr<const DirectoryModel>
+DirectoryModel::append(std::vector<FileMetadata> entries) const {
+    auto model = std::make_shared<DirectoryModel>(*this);
+    if (!entries.empty()) {
+        model->size_ += entries.size();
+        model->chunks_.push_back(std::make_shared<const Chunk>(entries));
+        model->ends_.push_back(model->size_);
+    }
+    return model;
+}
+
+DirectoryModel::Row DirectoryModel::operator[](size_t index) const noexcept {
+    // A complete listing is one chunk; streamed batches add one each
+    if (chunks_.size() == 1) {
+        return Row(chunks_.front().get(), index);
+    }
+    auto it = std::upper_bound(ends_.begin(), ends_.end(), index);
+    auto chunk = static_cast<size_t>(it - ends_.begin());
+    size_t start = chunk == 0 ? 0 : ends_[chunk - 1];
+    return Row(chunks_[chunk].get(), index - start);
+}
+
+std::vector<FileMetadata> DirectoryModel::metadata(size_t first) const {
+    std::vector<FileMetadata> entries;
+    if (first >= size_) {
+        return entries;
+    }
+    entries.reserve(size_ - first);
+    for (size_t i = first; i < size_; ++i) {
+        entries.push_back((*this)[i].metadata());
+    }
+    return entries;
+}
+
+std::optional<size_t> DirectoryModel::find(std::wstring_view name) const noexcept {
+    // Earlier chunks first, so a repeated name finds its first row as before
+    for (size_t chunk = 0; chunk < chunks_.size(); ++chunk) {
+        const auto& names = chunks_[chunk]->names;
+        if (auto it = names.find(name); it != names.end()) {
+            return (chunk == 0 ? 0 : ends_[chunk - 1]) + it->second;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace nive::fs
@@ -0,0 +1,137 @@
+/// @file directory_model.hpp
+/// @brief Immutable directory listing stored in compact columns
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../util/path_interner.hpp"
+#include "file_metadata.hpp"
+
+namespace nive::fs {
+
+/// @brief Run of consecutive row indices
+struct IndexRange {
+    size_t first = 0;
+    size_t count = 0;
+};
+
+/// @brief Rows that changed from one model to the next
+///
+/// Ranges are ascending and apply as: drop removed (indices in the previous
+/// model), then insert inserted (indices in the new one). Updated rows kept
+/// their place, and their name, but have new metadata.
+struct ModelDelta {
+    std::vector<IndexRange> removed;
+    std::vector<IndexRange> inserted;
+    std::vector<IndexRange> updated;
+
+    /// @brief Add a row index to ascending ranges, extending the last when adjacent
+    static void add(std::vector<IndexRange>& ranges, size_t index);
+
+    /// @brief Get where a row of the previous model is now
+    /// @return New index, or nullopt if the row was removed
+    [[nodiscard]] std::optional<size_t> map(size_t old_index) const noexcept;
+};
+
+/// @brief Immutable, shareable listing of a directory or archive
+///
+/// Holds the same information as a vector of FileMetadata in a fraction of
+/// the memory: sizes, times, types and attributes live in one column each,
+/// and the strings of a chunk of rows share one arena. The text of a path
+/// before its file name is interned, so a listing stores its directory once.
+///
+/// A model never changes once built. The state and every view share one
+/// through std::shared_ptr<const DirectoryModel>; append() builds a new
+/// model that shares the existing rows, so streamed batches are not copied.
+class DirectoryModel {
+    struct Chunk;
+
+public:
+    /// @brief Lightweight view of one row, valid while its model is alive
+    class Row {
+    public:
+        [[nodiscard]] std::wstring_view name() const noexcept;
+        [[nodiscard]] std::wstring_view extension() const noexcept;
+        [[nodiscard]] std::filesystem::path path() const;
+        [[nodiscard]] FileType type() const noexcept;
+        [[nodiscard]] FileAttributes attributes() const noexcept;
+        [[nodiscard]] uint64_t size_bytes() const noexcept;
+        [[nodiscard]] std::chrono::system_clock::time_point created_time() const noexcept;
+        [[nodiscard]] std::chrono::system_clock::time_point modified_time() const noexcept;
+        [[nodiscard]] std::chrono::system_clock::time_point accessed_time() const noexcept;
+        [[nodiscard]] FileId file_id() const noexcept;
+        [[nodiscard]] std::optional<archive::VirtualPath> virtual_path() const;
+        [[nodiscard]] std::optional<std::chrono::system_clock::time_point>
+        date_taken() const noexcept;
+        [[nodiscard]] std::wstring_view camera_model() const noexcept;
+
+        [[nodiscard]] bool is_image() const noexcept { return type() == FileType::Image; }
+        [[nodiscard]] bool is_archive() const noexcept { return type() == FileType::Archive; }
+        [[nodiscard]] bool is_directory() const noexcept;
+        [[nodiscard]] bool is_in_archive() const noexcept;
+
+        /// @brief Same as FileMetadata::sourceIdentifier()
+        [[nodiscard]] std::wstring sourceIdentifier() const;
+
+        /// @brief Interned sourceIdentifier(), kept with the row once asked for
+        [[nodiscard]] PathId sourceId() const;
+
+        /// @brief Copy the row out as FileMetadata (including its sort key)
+        [[nodiscard]] FileMetadata metadata() const;
+
+    private:
+        friend class DirectoryModel;
+        Row(const Chunk* chunk, size_t index) noexcept : chunk_(chunk), index_(index) {}
+
+        const Chunk* chunk_;
+        size_t index_;
+    };
+
+    /// @brief Create an empty model
+    DirectoryModel();
+
+    /// @brief Create a model from entries, keeping their order
+    explicit DirectoryModel(std::vector<FileMetadata> entries);
+
+    ~DirectoryModel();
+
+    DirectoryModel(const DirectoryModel&) = default;
+    DirectoryModel& operator=(const DirectoryModel&) = default;
+    DirectoryModel(DirectoryModel&&) noexcept = default;
+    DirectoryModel& operator=(DirectoryModel&&) noexcept = default;
+
+    /// @brief Build a model with this one's rows followed by entries
+    /// @param entries Rows to append
+    /// @return New model; this model's rows are shared, not copied
+    [[nodiscard]] std::shared_ptr<const DirectoryModel>
+    append(std::vector<FileMetadata> entries) const;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    /// @brief Get a row (index must be below size())
+    [[nodiscard]] Row operator[](size_t index) const noexcept;
+
+    /// @brief Copy rows out as FileMetadata
+    /// @param first Index of the first row to copy
+    [[nodiscard]] std::vector<FileMetadata> metadata(size_t first = 0) const;
+
+    /// @brief Find a row by name
+    /// @return Index of the first row with the name; a hash lookup per chunk
+    [[nodiscard]] std::optional<size_t> find(std::wstring_view name) const noexcept;
+
+private:
+    std::vector<std::shared_ptr<const Chunk>> chunks_;
+    std::vector<size_t> ends_;  // One past each chunk's last row
+    size_t size_ = 0;
+};
+
+}  // namespace nive::fs
@@ -0,0 +1,208 @@
+/// @file directory_reader.cpp
+/// @brief Directory reader implementation
+
+#include "directory_reader.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "../util/win32_utils.hpp"
+
+namespace nive::fs {
+
+namespace {
+
+constexpr size_t kMinBufferSize = 4096;  // Room for any single entry
+
+/// @brief A directory information class, as first and as later query
+struct InfoClass {
+    FILE_INFO_BY_HANDLE_CLASS restart;
+    FILE_INFO_BY_HANDLE_CLASS next;
+};
+
+/// @brief Classes to try, richest first
+constexpr std::array<InfoClass, 3> kInfoClasses = {{
+    {FileIdExtdDirectoryRestartInfo, FileIdExtdDirectoryInfo},
+    {FileIdBothDirectoryRestartInfo, FileIdBothDirectoryInfo},
+    {FileFullDirectoryRestartInfo, FileFullDirectoryInfo},
+}};
+
+/// @brief Check if a query failed because the file system lacks the class
+[[nodiscard]] bool is_unsupported(DWORD error) noexcept {
+    return error == ERROR_INVALID_PARAMETER || error == ERROR_NOT_SUPPORTED ||
+           error == ERROR_INVALID_LEVEL || error == ERROR_INVALID_FUNCTION;
+}
+
+[[nodiscard]] DirectoryError open_error(DWORD error) noexcept {
+    switch (error) {
+    case ERROR_FILE_NOT_FOUND:
+    case ERROR_PATH_NOT_FOUND:
+    case ERROR_BAD_NETPATH:
+    case ERROR_BAD_NET_NAME:
+        return DirectoryError::NotFound;
+    case ERROR_ACCESS_DENIED:
+        return DirectoryError::AccessDenied;
+    case ERROR_DIRECTORY:
+        return DirectoryError::NotADirectory;
+    default:
+        return DirectoryError::IoError;
+    }
+}
+
+/// @brief Fill the fields every directory information class has
+template <typename Info>
+[[nodiscard]] DWORD fill_record(const Info& info, DirectoryRecord& record) noexcept {
+    record.name = std::wstring_view(info.FileName, info.FileNameLength / sizeof(wchar_t));
+    record.attributes = info.FileAttributes;
+    record.size = static_cast<uint64_t>(info.EndOfFile.QuadPart);
+    record.created = static_cast<uint64_t>(info.CreationTime.QuadPart);
+    record.modified = static_cast<uint64_t>(info.LastWriteTime.QuadPart);
+    record.accessed = static_cast<uint64_t>(info.LastAccessTime.QuadPart);
+    record.id = {};
+    return info.NextEntryOffset;
+}
+
+/// @brief Get the 64-bit serial number of the volume a handle is on
+[[nodiscard]] uint64_t volume_serial(HANDLE handle) noexcept {
+    FILE_ID_INFO id_info{};
+    if (GetFileInformationByHandleEx(handle, FileIdInfo, &id_info, sizeof(id_info))) {
+        return id_info.VolumeSerialNumber;
+    }
+    BY_HANDLE_FILE_INFORMATION info{};
+    if (GetFileInformationByHandle(handle, &info)) {
+        return info.dwVolumeSerialNumber;
+    }
+    return 0;
+}
+
+}  // namespace
+
+class DirectoryReader::Impl {
+public:
+    Impl(HandleGuard handle, size_t buffer_size)
+        : handle_(std::move(handle)),
+          buffer_((std::clamp<size_t>(buffer_size, kMinBufferSize, MAXDWORD) + 7) / 8),
+          volume_(volume_serial(handle_.get())) {}
+
+    std::expected<bool, DirectoryError> next(DirectoryRecord& record) {
+        for (;;) {
+            if (!entry_) {
+                auto fetched = fetch();
+                if (!fetched || !*fetched) {
+                    return fetched;
+                }
+            }
+
+            DWORD next_offset = parse(entry_, record);
+            entry_ = next_offset == 0 ? nullptr : entry_ + next_offset;
+            if (record.name != L"." && record.name != L"..") {
+                return true;
+            }
+        }
+    }
+
+private:
+    /// @brief Fill the buffer with the next batch of entries
+    /// @return true if entries were fetched, false at the end, or IoError
+    std::expected<bool, DirectoryError> fetch() {
+        auto bytes = static_cast<DWORD>(buffer_.size() * sizeof(uint64_t));
+        while (!done_ && class_index_ < kInfoClasses.size()) {
+            const auto& info_class = kInfoClasses[class_index_];
+            if (GetFileInformationByHandleEx(handle_.get(),
+                                             started_ ? info_class.next : info_class.restart,
+                                             buffer_.data(), bytes)) {
+                started_ = true;
+                entry_ = reinterpret_cast<const std::byte*>(buffer_.data());
+                return true;
+            }
+
+            DWORD error = GetLastError();
+            if (error == ERROR_NO_MORE_FILES || error == ERROR_FILE_NOT_FOUND) {
+                // ERROR_FILE_NOT_FOUND: empty volume root (no . / .. entries)
+                done_ = true;
+            } else if (!started_ && is_unsupported(error)) {
+                ++class_index_;
+            } else {
+                return std::unexpected(DirectoryError::IoError);
+            }
+        }
+        if (!done_) {
+            return std::unexpected(DirectoryError::IoError);
+        }
+        return false;
+    }
+
+    /// @brief Decode one entry of the current class
+    /// @return Offset of the next entry, or 0 if it was the last in the buffer
+    [[nodiscard]] DWORD parse(const std::byte* entry, DirectoryRecord& record) const noexcept {
+        DWORD next_offset = 0;
+        switch (class_index_) {
+        case 0: {
+            const auto& info = *reinterpret_cast<const FILE_ID_EXTD_DIR_INFO*>(entry);
+            next_offset = fill_record(info, record);
+            std::memcpy(&record.id.low, info.FileId.Identifier, sizeof(uint64_t));
+            std::memcpy(&record.id.high, info.FileId.Identifier + sizeof(uint64_t),
+                        sizeof(uint64_t));
+            break;
+        }
+        case 1: {
+            const auto& info = *reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(entry);
+            next_offset = fill_record(info, record);
+            record.id.low = static_cast<uint64_t>(info.FileId.QuadPart);
+            break;
+        }
+        default:
+            next_offset =
+                fill_record(*reinterpret_cast<const FILE_FULL_DIR_INFO*>(entry), record);
+            break;
+        }
+        if (record.id.valid()) {
+            record.id.volume = volume_;
+        }
+        return next_offset;
+    }
+
+    HandleGuard handle_;
+    std::vector<uint64_t> buffer_;  // 8-byte aligned for the LARGE_INTEGER fields
+    uint64_t volume_ = 0;
+    size_t class_index_ = 0;
+    bool started_ = false;
+    bool done_ = false;
+    const std::byte* entry_ = nullptr;  // Next entry in buffer_, if any
+};
+
+std::expected<DirectoryReader, DirectoryError>
+DirectoryReader::open(const std::filesystem::path& path, size_t buffer_size) {
+    HandleGuard handle(CreateFileW(path.c_str(), FILE_LIST_DIRECTORY | FILE_READ_ATTRIBUTES,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+    if (!handle) {
+        return std::unexpected(open_error(GetLastError()));
+    }
+
+    // FILE_FLAG_BACKUP_SEMANTICS opens files as well
+    FILE_BASIC_INFO basic{};
+    if (GetFileInformationByHandleEx(handle.get(), FileBasicInfo, &basic, sizeof(basic)) &&
+        (basic.FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        return std::unexpected(DirectoryError::NotADirectory);
+    }
+
+    return DirectoryReader(std::make_unique<Impl>(std::move(handle), buffer_size));
+}
+
+DirectoryReader::DirectoryReader(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+DirectoryReader::~DirectoryReader() = default;
+
+DirectoryReader::DirectoryReader(DirectoryReader&&) noexcept = default;
+
+DirectoryReader& DirectoryReader::operator=(DirectoryReader&&) noexcept = default;
+
+std::expected<bool, DirectoryError> DirectoryReader::next(DirectoryRecord& record) {
+    return impl_->next(record);
+}
+
+}  // namespace nive::fs
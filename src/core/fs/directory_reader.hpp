@@ -0,0 +1,66 @@
+/// @file directory_reader.hpp
+/// @brief Bulk directory metadata through GetFileInformationByHandleEx
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#include "directory.hpp"
+#include "file_metadata.hpp"
+
+namespace nive::fs {
+
+/// @brief Default bytes of directory entries fetched per file system query
+inline constexpr size_t kDirectoryReadBufferSize = 256 * 1024;
+
+/// @brief One directory entry as reported by the file system
+struct DirectoryRecord {
+    std::wstring_view name;   // Valid until the next call to DirectoryReader::next()
+    uint32_t attributes = 0;  // FILE_ATTRIBUTE_*
+    uint64_t size = 0;
+    uint64_t created = 0;     // FILETIME ticks
+    uint64_t modified = 0;
+    uint64_t accessed = 0;
+    FileId id;                // Invalid if the file system has no IDs
+};
+
+/// @brief Reads a directory's entries with their metadata in large batches
+///
+/// Opens the directory once and queries FileIdExtdDirectoryInfo into a
+/// large buffer, so each round trip (one SMB request on a share) returns
+/// hundreds of entries with attributes, sizes, times and file IDs, and no
+/// entry needs a query of its own. File systems without that class fall
+/// back to FileIdBothDirectoryInfo (64-bit IDs) and then to
+/// FileFullDirectoryInfo (no IDs), which is what FindFirstFileExW uses.
+class DirectoryReader {
+public:
+    /// @brief Open a directory for reading
+    /// @param path Directory path
+    /// @param buffer_size Bytes fetched per query
+    /// @return Reader, or NotFound, AccessDenied, NotADirectory or IoError
+    [[nodiscard]] static std::expected<DirectoryReader, DirectoryError>
+    open(const std::filesystem::path& path, size_t buffer_size = kDirectoryReadBufferSize);
+
+    ~DirectoryReader();
+
+    DirectoryReader(DirectoryReader&&) noexcept;
+    DirectoryReader& operator=(DirectoryReader&&) noexcept;
+
+    /// @brief Read the next entry; "." and ".." are skipped
+    /// @param record Filled in with the entry
+    /// @return true if record was filled, false at the end, or IoError
+    [[nodiscard]] std::expected<bool, DirectoryError> next(DirectoryRecord& record);
+
+private:
+    class Impl;
+    explicit DirectoryReader(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::fs
@@ -0,0 +1,336 @@
+/// @file directory_watcher.cpp
+/// @brief Directory change notification implementation
+
+#include "directory_watcher.hpp"
+#include <Windows.h>
+
+#include <algorithm>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+
+namespace nive::fs {
+
+namespace {
+
+// Notification buffer per directory. ReadDirectoryChangesW fails with
+// ERROR_INVALID_PARAMETER above 64KB on network shares.
+constexpr DWORD kNotifyBufferBytes = 64 * 1024;
+
+constexpr DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+/// @brief Map a FILE_ACTION_* code
+[[nodiscard]] FileChangeAction to_change_action(DWORD action) noexcept {
+    switch (action) {
+    case FILE_ACTION_ADDED:
+        return FileChangeAction::Added;
+    case FILE_ACTION_REMOVED:
+        return FileChangeAction::Removed;
+    case FILE_ACTION_RENAMED_OLD_NAME:
+        return FileChangeAction::RenamedFrom;
+    case FILE_ACTION_RENAMED_NEW_NAME:
+        return FileChangeAction::RenamedTo;
+    default:
+        return FileChangeAction::Modified;
+    }
+}
+
+/// @brief Drop changes that repeat the previous change to the same file
+void collapse_repeats(std::vector<FileChange>& changes) {
+    std::unordered_map<std::wstring, FileChangeAction> last_action;
+    std::erase_if(changes, [&last_action](const FileChange& change) {
+        auto [it, inserted] = last_action.try_emplace(change.path.native(), change.action);
+        if (inserted) {
+            return false;
+        }
+        bool repeat = it->second == change.action;
+        it->second = change.action;
+        return repeat;
+    });
+}
+
+}  // namespace
+
+class DirectoryWatcher::Impl {
+public:
+    Impl(DirectoryChangeCallback callback, DirectoryWatcherConfig config)
+        : callback_(std::move(callback)), config_(config) {
+        // One wait slot is taken by the wake event
+        config_.max_directories =
+            std::clamp<size_t>(config_.max_directories, 1, MAXIMUM_WAIT_OBJECTS - 1);
+        wake_event_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        thread_ = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+    }
+
+    ~Impl() {
+        thread_.request_stop();
+        SetEvent(wake_event_);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        CloseHandle(wake_event_);
+    }
+
+    void watch(const std::filesystem::path& directory) {
+        auto normalized = directory.lexically_normal();
+        {
+            std::lock_guard lock(mutex_);
+            std::erase(recent_, normalized);
+            recent_.insert(recent_.begin(), std::move(normalized));
+            if (recent_.size() > config_.max_directories) {
+                recent_.resize(config_.max_directories);
+            }
+        }
+        SetEvent(wake_event_);
+    }
+
+    void unwatch(const std::filesystem::path& directory) {
+        {
+            std::lock_guard lock(mutex_);
+            std::erase(recent_, directory.lexically_normal());
+        }
+        SetEvent(wake_event_);
+    }
+
+    [[nodiscard]] std::vector<std::filesystem::path> watchedDirectories() const {
+        std::lock_guard lock(mutex_);
+        return recent_;
+    }
+
+private:
+    /// @brief An open directory handle with its outstanding read
+    struct Watch {
+        std::filesystem::path directory;
+        HANDLE handle = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped{};
+        bool read_pending = false;
+        std::vector<DWORD> buffer;  // DWORD-aligned, as FILE_NOTIFY_INFORMATION requires
+        std::vector<FileChange> changes;
+        bool overflowed = false;
+        std::chrono::steady_clock::time_point last_change;
+    };
+
+    void run(std::stop_token stop_token) {
+        while (!stop_token.stop_requested()) {
+            std::vector<HANDLE> handles{wake_event_};
+            for (const auto& watch : watches_) {
+                handles.push_back(watch->overlapped.hEvent);
+            }
+
+            DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()),
+                                                  handles.data(), FALSE, next_timeout());
+            if (stop_token.stop_requested()) {
+                break;
+            }
+
+            if (result == WAIT_OBJECT_0) {
+                reconcile();
+            } else if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size()) {
+                complete_read(*watches_[result - WAIT_OBJECT_0 - 1]);
+            }
+            deliver_quiet();
+        }
+
+        for (auto& watch : watches_) {
+            close_watch(*watch);
+        }
+        watches_.clear();
+    }
+
+    /// @brief Open and close handles to match the recently used list
+    void reconcile() {
+        std::vector<std::filesystem::path> wanted = watchedDirectories();
+
+        std::erase_if(watches_, [this, &wanted](const std::unique_ptr<Watch>& watch) {
+            if (std::find(wanted.begin(), wanted.end(), watch->directory) != wanted.end()) {
+                return false;
+            }
+            close_watch(*watch);
+            return true;
+        });
+
+        for (const auto& directory : wanted) {
+            bool open = std::any_of(watches_.begin(), watches_.end(), [&directory](const auto& w) {
+                return w->directory == directory;
+            });
+            if (!open) {
+                open_watch(directory);
+            }
+        }
+    }
+
+    void open_watch(const std::filesystem::path& directory) {
+        auto watch = std::make_unique<Watch>();
+        watch->directory = directory;
+        watch->handle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (watch->handle == INVALID_HANDLE_VALUE) {
+            forget(directory);
+            return;
+        }
+        watch->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        watch->buffer.resize(kNotifyBufferBytes / sizeof(DWORD));
+
+        if (!issue_read(*watch)) {
+            close_watch(*watch);
+            forget(directory);
+            return;
+        }
+        watches_.push_back(std::move(watch));
+    }
+
+    [[nodiscard]] bool issue_read(Watch& watch) {
+        watch.read_pending = ReadDirectoryChangesW(
+            watch.handle, watch.buffer.data(), kNotifyBufferBytes,
+            config_.watch_subtree ? TRUE : FALSE, kNotifyFilter, nullptr, &watch.overlapped,
+            nullptr) != FALSE;
+        return watch.read_pending;
+    }
+
+    void close_watch(Watch& watch) {
+        if (watch.read_pending) {
+            CancelIoEx(watch.handle, &watch.overlapped);
+            DWORD bytes = 0;
+            GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, TRUE);
+            watch.read_pending = false;
+        }
+        if (watch.handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(watch.handle);
+            watch.handle = INVALID_HANDLE_VALUE;
+        }
+        if (watch.overlapped.hEvent) {
+            CloseHandle(watch.overlapped.hEvent);
+            watch.overlapped.hEvent = nullptr;
+        }
+    }
+
+    /// @brief Drop a directory that can no longer be watched from the list
+    void forget(const std::filesystem::path& directory) {
+        std::lock_guard lock(mutex_);
+        std::erase(recent_, directory);
+    }
+
+    void complete_read(Watch& watch) {
+        watch.read_pending = false;
+        watch.last_change = std::chrono::steady_clock::now();
+
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, FALSE)) {
+            // Directory deleted, share disconnected, ...: report and stop watching
+            fail(watch);
+            return;
+        }
+
+        if (bytes == 0) {
+            // The system buffer overflowed and the notifications were discarded
+            watch.overflowed = true;
+        } else {
+            const auto* base = reinterpret_cast<const BYTE*>(watch.buffer.data());
+            const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(base);
+            while (true) {
+                std::wstring_view name(info->FileName, info->FileNameLength / sizeof(wchar_t));
+                watch.changes.push_back(
+                    {to_change_action(info->Action), watch.directory / std::wstring(name)});
+                if (info->NextEntryOffset == 0) {
+                    break;
+                }
+                info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(
+                    reinterpret_cast<const BYTE*>(info) + info->NextEntryOffset);
+            }
+        }
+
+        if (!issue_read(watch)) {
+            fail(watch);
+        }
+    }
+
+    /// @brief Deliver what was collected for a broken watch and remove it
+    void fail(Watch& watch) {
+        watch.overflowed = true;
+        deliver(watch);
+        auto directory = watch.directory;
+        close_watch(watch);
+        forget(directory);
+        std::erase_if(watches_, [&watch](const auto& w) { return w.get() == &watch; });
+    }
+
+    /// @brief Wait until the earliest quiet period ends (or indefinitely)
+    [[nodiscard]] DWORD next_timeout() const {
+        auto now = std::chrono::steady_clock::now();
+        DWORD timeout = INFINITE;
+        for (const auto& watch : watches_) {
+            if (watch->changes.empty() && !watch->overflowed) {
+                continue;
+            }
+            auto due = watch->last_change + config_.quiet_period;
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(due - now).count();
+            timeout = std::min(timeout, static_cast<DWORD>(std::max<int64_t>(wait, 0)));
+        }
+        return timeout;
+    }
+
+    /// @brief Deliver every directory that has been quiet long enough
+    void deliver_quiet() {
+        auto now = std::chrono::steady_clock::now();
+        for (auto& watch : watches_) {
+            if ((!watch->changes.empty() || watch->overflowed) &&
+                now - watch->last_change >= config_.quiet_period) {
+                deliver(*watch);
+            }
+        }
+    }
+
+    void deliver(Watch& watch) {
+        DirectoryChanges batch;
+        batch.directory = watch.directory;
+        batch.overflowed = watch.overflowed;
+        if (!watch.overflowed) {
+            // A rescan supersedes individual changes
+            batch.changes = std::move(watch.changes);
+            collapse_repeats(batch.changes);
+        }
+        watch.changes.clear();
+        watch.overflowed = false;
+
+        if (callback_) {
+            callback_(std::move(batch));
+        }
+    }
+
+    DirectoryChangeCallback callback_;
+    DirectoryWatcherConfig config_;
+
+    // Recently used directories, most recent first (shared with callers)
+    mutable std::mutex mutex_;
+    std::vector<std::filesystem::path> recent_;
+
+    // Open watches (watcher thread only)
+    std::vector<std::unique_ptr<Watch>> watches_;
+
+    HANDLE wake_event_ = nullptr;
+    std::jthread thread_;
+};
+
+DirectoryWatcher::DirectoryWatcher(DirectoryChangeCallback callback,
+                                   DirectoryWatcherConfig config)
+    : impl_(std::make_unique<Impl>(std::move(callback), config)) {}
+
+DirectoryWatcher::~DirectoryWatcher() = default;
+
+void DirectoryWatcher::watch(const std::filesystem::path& directory) {
+    impl_->watch(directory);
+}
+
+void DirectoryWatcher::unwatch(const std::filesystem::path& directory) {
+    impl_->unwatch(directory);
+}
+
+std::vector<std::filesystem::path> DirectoryWatcher::watchedDirectories() const {
+    return impl_->watchedDirectories();
+}
+
+}  // namespace nive::fs
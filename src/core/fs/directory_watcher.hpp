@@ -0,0 +1,88 @@
+/// @file directory_watcher.hpp
+/// @brief File system change notifications for recently visited directories
+///
+/// Wraps overlapped ReadDirectoryChangesW on a single background thread.
+/// Notifications for a directory are collected until it has been quiet for
+/// a short interval, then delivered as one batch, so a bulk copy produces a
+/// handful of callbacks rather than one per file.
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nive::fs {
+
+/// @brief Kind of change reported for a file
+enum class FileChangeAction {
+    Added,
+    Removed,
+    Modified,     // Contents, size or timestamps changed
+    RenamedFrom,  // Old name of a renamed file
+    RenamedTo     // New name of a renamed file
+};
+
+/// @brief A single change inside a watched directory
+struct FileChange {
+    FileChangeAction action = FileChangeAction::Modified;
+    std::filesystem::path path;  // Full path of the affected file
+};
+
+/// @brief Changes collected for one watched directory
+struct DirectoryChanges {
+    std::filesystem::path directory;
+    std::vector<FileChange> changes;  // In notification order, repeats collapsed
+    // Notifications were lost (buffer overflow) or the watch failed (e.g. the
+    // directory was deleted); changes is incomplete and the directory needs a rescan
+    bool overflowed = false;
+};
+
+/// @brief Callback receiving change batches (called from the watcher thread)
+using DirectoryChangeCallback = std::function<void(DirectoryChanges changes)>;
+
+/// @brief Directory watcher configuration
+struct DirectoryWatcherConfig {
+    size_t max_directories = 8;                   // Most recently watched directories kept
+    std::chrono::milliseconds quiet_period{200};  // Delivery waits for this much silence
+    bool watch_subtree = false;                   // Also report changes in subdirectories
+};
+
+/// @brief Watches the most recently visited directories for changes
+///
+/// Thread-safe. watch() moves a directory to the front of the recently used
+/// list; the least recently used directory is dropped once the list is full.
+/// Subdirectories are watched only with DirectoryWatcherConfig::watch_subtree;
+/// their changes are then reported in the batch of the watched directory.
+class DirectoryWatcher {
+public:
+    /// @brief Start the watcher thread
+    /// @param callback Called with each batch of changes
+    /// @param config Watcher configuration
+    explicit DirectoryWatcher(DirectoryChangeCallback callback,
+                              DirectoryWatcherConfig config = {});
+    ~DirectoryWatcher();
+
+    // Non-copyable, non-movable
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+    DirectoryWatcher(DirectoryWatcher&&) = delete;
+    DirectoryWatcher& operator=(DirectoryWatcher&&) = delete;
+
+    /// @brief Start watching a directory, or mark it most recently used
+    void watch(const std::filesystem::path& directory);
+
+    /// @brief Stop watching a directory
+    void unwatch(const std::filesystem::path& directory);
+
+    /// @brief Get watched directories, most recently used first
+    [[nodiscard]] std::vector<std::filesystem::path> watchedDirectories() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::fs
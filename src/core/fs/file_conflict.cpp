@@ -5,49 +5,167 @@
 #include <Windows.h>
 
 #include <algorithm>
-#include <array>
 #include <cwctype>
-#include <fstream>
+#include <span>
+
+#include "../util/win32_utils.hpp"
+#include "folder_stats.hpp"
 
 namespace nive::fs {
 
 namespace {
 
-/// @brief Size of blocks to compare for identity check
-constexpr size_t kHashBlockSize = 4096;
-
-/// @brief Simple hash function for quick file comparison
-[[nodiscard]] uint64_t quickHash(const std::vector<char>& data) {
-    // FNV-1a hash
-    uint64_t hash = 14695981039346656037ULL;
-    for (char c : data) {
-        hash ^= static_cast<uint64_t>(static_cast<unsigned char>(c));
-        hash *= 1099511628211ULL;
+constexpr uint32_t kMinBlockSize = 4096;
+constexpr uint32_t kMaxSampleBlocks = 64;
+constexpr size_t kFullReadChunk = 1024 * 1024;
+
+/// @brief Size and modification time of a regular file
+struct FileStamp {
+    uint64_t size = 0;
+    uint64_t modified = 0;  // FILETIME ticks
+};
+
+[[nodiscard]] std::optional<FileStamp> stat_file(const std::filesystem::path& path) {
+    WIN32_FILE_ATTRIBUTE_DATA data{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        return std::nullopt;
     }
-    return hash;
+    return FileStamp{
+        .size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow,
+        .modified = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                    data.ftLastWriteTime.dwLowDateTime,
+    };
 }
 
-/// @brief Read a block of data from a file at specified position
-[[nodiscard]] std::vector<char> readBlock(const std::filesystem::path& path, uint64_t offset,
-                                          size_t size) {
-    std::vector<char> buffer(size);
+/// @brief Hash a whole file, reading it front to back
+[[nodiscard]] std::optional<Hash128> hash_whole(const std::filesystem::path& path,
+                                                uint64_t size) {
+    HandleGuard file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // Chunks are chained through the seed, so equal content gives equal digests
+    Hash128 digest{.low = size, .high = 0};
+    std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(size, kFullReadChunk)));
+    uint64_t remaining = size;
+    while (remaining > 0) {
+        auto count = static_cast<DWORD>(std::min<uint64_t>(remaining, buffer.size()));
+        DWORD read = 0;
+        if (!ReadFile(file.get(), buffer.data(), count, &read, nullptr) || read != count) {
+            return std::nullopt;
+        }
+        digest = hash128(std::span(buffer.data(), read), digest.low ^ digest.high);
+        remaining -= read;
+    }
+    return digest;
+}
 
-    std::ifstream file(path, std::ios::binary);
+/// @brief Hash evenly spread blocks of a file, all read at once from one handle
+[[nodiscard]] std::optional<Hash128> hash_sampled(const std::filesystem::path& path,
+                                                  uint64_t size, uint32_t block,
+                                                  uint32_t count) {
+    HandleGuard file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 nullptr, OPEN_EXISTING,
+                                 FILE_FLAG_OVERLAPPED | FILE_FLAG_RANDOM_ACCESS, nullptr));
     if (!file) {
-        return {};
+        return std::nullopt;
     }
 
-    file.seekg(static_cast<std::streamoff>(offset));
-    file.read(buffer.data(), static_cast<std::streamsize>(size));
+    struct Read {
+        OVERLAPPED overlapped{};
+        HandleGuard event;
+    };
+    std::vector<uint8_t> buffer(static_cast<size_t>(block) * count);
+    std::vector<Read> reads(count);
+    size_t issued = 0;
+    bool ok = true;
+    for (; issued < count; ++issued) {
+        // First and last block always. Every read is issued before any is
+        // waited on, so a network share costs one round trip, not one per block
+        uint64_t offset = count == 1 ? 0 : (size - block) * issued / (count - 1);
+        auto& read = reads[issued];
+        read.event = HandleGuard(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+        if (!read.event) {
+            ok = false;
+            break;
+        }
+        read.overlapped.Offset = static_cast<DWORD>(offset);
+        read.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        read.overlapped.hEvent = read.event.get();
+        if (!ReadFile(file.get(), buffer.data() + issued * block, block, nullptr,
+                      &read.overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            ok = false;
+            break;
+        }
+    }
+    if (!ok) {
+        CancelIoEx(file.get(), nullptr);
+    }
 
-    auto bytes_read = file.gcount();
-    buffer.resize(static_cast<size_t>(bytes_read));
+    // Every issued read must finish before the buffer goes away
+    for (size_t i = 0; i < issued; ++i) {
+        DWORD done = 0;
+        if (!GetOverlappedResult(file.get(), &reads[i].overlapped, &done, TRUE) ||
+            done != block) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return std::nullopt;
+    }
+    return hash128(buffer, size);
+}
+
+/// @brief Digest a file's content, consulting and filling the cache
+[[nodiscard]] std::optional<Hash128> content_digest(const std::filesystem::path& path,
+                                                    const FileStamp& stamp,
+                                                    const IdentityCheckOptions& options,
+                                                    FileIdentityCache* cache) {
+    if (cache) {
+        if (auto digest = cache->find(path, stamp.size, stamp.modified, options)) {
+            return digest;
+        }
+    }
 
-    return buffer;
+    uint32_t block = std::max(options.block_size, kMinBlockSize);
+    uint32_t count = std::clamp(options.sample_blocks, 1u, kMaxSampleBlocks);
+    auto digest = options.full_content || stamp.size <= static_cast<uint64_t>(block) * count
+                      ? hash_whole(path, stamp.size)
+                      : hash_sampled(path, stamp.size, block, count);
+
+    if (digest && cache) {
+        cache->insert(path, stamp.size, stamp.modified, options, *digest);
+    }
+    return digest;
 }
 
 }  // namespace
 
+// ===== FileIdentityCache =====
+
+std::optional<Hash128> FileIdentityCache::find(const std::filesystem::path& path, uint64_t size,
+                                               uint64_t modified,
+                                               const IdentityCheckOptions& options) const {
+    auto it = entries_.find(path.native());
+    if (it == entries_.end() || it->second.size != size || it->second.modified != modified ||
+        it->second.options != options) {
+        return std::nullopt;
+    }
+    return it->second.digest;
+}
+
+void FileIdentityCache::insert(const std::filesystem::path& path, uint64_t size,
+                               uint64_t modified, const IdentityCheckOptions& options,
+                               const Hash128& digest) {
+    entries_.insert_or_assign(path.native(), Entry{size, modified, options, digest});
+}
+
+// ===== Conflict detection =====
+
 OperationValidation validateOperation(const std::filesystem::path& source,
                                       const std::filesystem::path& dest, bool is_move) {
     OperationValidation result;
@@ -114,70 +232,31 @@ OperationValidation validateOperation(const std::filesystem::path& source,
     return result;
 }
 
-bool areFilesIdentical(const std::filesystem::path& path1, const std::filesystem::path& path2) {
-    std::error_code ec;
-
-    // Check if both exist
-    if (!std::filesystem::exists(path1, ec) || !std::filesystem::exists(path2, ec)) {
-        return false;
-    }
-
-    // Compare sizes first (fast check)
-    auto size1 = std::filesystem::file_size(path1, ec);
-    if (ec)
-        return false;
-
-    auto size2 = std::filesystem::file_size(path2, ec);
-    if (ec)
-        return false;
-
-    if (size1 != size2) {
+bool areFilesIdentical(const std::filesystem::path& path1, const std::filesystem::path& path2,
+                       const IdentityCheckOptions& options, FileIdentityCache* cache) {
+    auto stamp1 = stat_file(path1);
+    auto stamp2 = stat_file(path2);
+    if (!stamp1 || !stamp2 || stamp1->size != stamp2->size) {
         return false;
     }
 
     // Empty files are identical
-    if (size1 == 0) {
+    if (stamp1->size == 0) {
         return true;
     }
 
-    // Compare first block
-    auto block1_start = readBlock(path1, 0, kHashBlockSize);
-    auto block2_start = readBlock(path2, 0, kHashBlockSize);
-
-    if (block1_start != block2_start) {
+    auto digest1 = content_digest(path1, *stamp1, options, cache);
+    if (!digest1) {
         return false;
     }
-
-    // For small files, we're done
-    if (size1 <= kHashBlockSize) {
-        return true;
-    }
-
-    // Compare last block
-    uint64_t last_offset = size1 > kHashBlockSize ? size1 - kHashBlockSize : 0;
-    auto block1_end = readBlock(path1, last_offset, kHashBlockSize);
-    auto block2_end = readBlock(path2, last_offset, kHashBlockSize);
-
-    if (block1_end != block2_end) {
-        return false;
-    }
-
-    // For large files, also check a middle block
-    if (size1 > kHashBlockSize * 3) {
-        uint64_t mid_offset = size1 / 2;
-        auto block1_mid = readBlock(path1, mid_offset, kHashBlockSize);
-        auto block2_mid = readBlock(path2, mid_offset, kHashBlockSize);
-
-        if (block1_mid != block2_mid) {
-            return false;
-        }
-    }
-
-    return true;
+    auto digest2 = content_digest(path2, *stamp2, options, cache);
+    return digest2 && *digest1 == *digest2;
 }
 
 std::vector<FileConflictInfo> detectConflicts(const std::vector<std::filesystem::path>& sources,
-                                              const std::filesystem::path& dest_dir) {
+                                              const std::filesystem::path& dest_dir,
+                                              const IdentityCheckOptions& options,
+                                              FileIdentityCache* cache) {
     std::vector<FileConflictInfo> conflicts;
     std::error_code ec;
 
@@ -192,7 +271,7 @@ std::vector<FileConflictInfo> detectConflicts(const std::vector<std::filesystem:
             info.dest_size = std::filesystem::file_size(dest, ec);
             info.source_time = std::filesystem::last_write_time(source, ec);
             info.dest_time = std::filesystem::last_write_time(dest, ec);
-            info.files_identical = areFilesIdentical(source, dest);
+            info.files_identical = areFilesIdentical(source, dest, options, cache);
 
             conflicts.push_back(std::move(info));
         }
@@ -213,22 +292,7 @@ uint64_t getAvailableSpace(const std::filesystem::path& path) {
 }
 
 uint64_t calculateTotalSize(const std::vector<std::filesystem::path>& paths) {
-    uint64_t total = 0;
-    std::error_code ec;
-
-    for (const auto& path : paths) {
-        if (std::filesystem::is_regular_file(path, ec)) {
-            total += std::filesystem::file_size(path, ec);
-        } else if (std::filesystem::is_directory(path, ec)) {
-            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
-                if (entry.is_regular_file(ec)) {
-                    total += entry.file_size(ec);
-                }
-            }
-        }
-    }
-
-    return total;
+    return FolderStats::instance().measure(paths).bytes;
 }
 
 bool isSubdirectory(const std::filesystem::path& source, const std::filesystem::path& dest) {
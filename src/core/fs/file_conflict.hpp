@@ -4,10 +4,15 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "../util/hash.hpp"
+
 namespace nive::fs {
 
 /// @brief Action to take when a file conflict is detected
@@ -63,20 +68,68 @@ struct OperationValidation {
                                                     const std::filesystem::path& dest,
                                                     bool is_move);
 
-/// @brief Check if two files are identical (quick check using size and partial hash)
+/// @brief How areFilesIdentical() compares the content of two files of the same size
+struct IdentityCheckOptions {
+    uint32_t sample_blocks = 3;       // Blocks spread evenly from the first to the last
+    uint32_t block_size = 64 * 1024;  // Bytes per sampled block
+    bool full_content = false;        // Hash every byte instead of sampling
+
+    [[nodiscard]] bool operator==(const IdentityCheckOptions&) const noexcept = default;
+};
+
+/// @brief Content digests remembered across one conflict session
+///
+/// Keyed by path, size and modification time, so a file that changed since
+/// it was digested is read again. Not thread-safe.
+class FileIdentityCache {
+public:
+    /// @brief Find the digest of a file taken with the same options
+    [[nodiscard]] std::optional<Hash128> find(const std::filesystem::path& path, uint64_t size,
+                                              uint64_t modified,
+                                              const IdentityCheckOptions& options) const;
+
+    /// @brief Remember the digest of a file
+    void insert(const std::filesystem::path& path, uint64_t size, uint64_t modified,
+                const IdentityCheckOptions& options, const Hash128& digest);
+
+    void clear() noexcept { entries_.clear(); }
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        uint64_t modified = 0;  // FILETIME ticks
+        IdentityCheckOptions options;
+        Hash128 digest;
+    };
+
+    std::unordered_map<std::wstring, Entry> entries_;
+};
+
+/// @brief Check if two files are identical
+///
+/// Files of different sizes never are. Otherwise each file is opened once
+/// and digested: small files (and every file with full_content) are hashed
+/// whole, larger ones by reading the sample blocks with overlapped I/O.
 /// @param path1 First file path
 /// @param path2 Second file path
+/// @param options Sampling strategy
+/// @param cache Digests to reuse and fill (optional)
 /// @return True if files appear to be identical
 [[nodiscard]] bool areFilesIdentical(const std::filesystem::path& path1,
-                                     const std::filesystem::path& path2);
+                                     const std::filesystem::path& path2,
+                                     const IdentityCheckOptions& options = {},
+                                     FileIdentityCache* cache = nullptr);
 
 /// @brief Detect conflicts for a batch of file operations
 /// @param sources Source file paths
 /// @param dest_dir Destination directory
+/// @param options Identity check sampling strategy
+/// @param cache Digests to reuse and fill (optional)
 /// @return List of conflicts found
 [[nodiscard]] std::vector<FileConflictInfo>
 detectConflicts(const std::vector<std::filesystem::path>& sources,
-                const std::filesystem::path& dest_dir);
+                const std::filesystem::path& dest_dir, const IdentityCheckOptions& options = {},
+                FileIdentityCache* cache = nullptr);
 
 /// @brief Get available disk space on the drive containing the path
 /// @param path Path to check
@@ -84,7 +137,7 @@ detectConflicts(const std::vector<std::filesystem::path>& sources,
 [[nodiscard]] uint64_t getAvailableSpace(const std::filesystem::path& path);
 
 /// @brief Calculate total size of files
-/// @param paths File paths
+/// @param paths File paths; directories count every file below them (see FolderStats)
 /// @return Total size in bytes
 [[nodiscard]] uint64_t calculateTotalSize(const std::vector<std::filesystem::path>& paths);
 
@@ -4,45 +4,37 @@
 #include "file_metadata.hpp"
 #include <Windows.h>
 
-#include <algorithm>
-#include <array>
-#include <cwctype>
 #include <format>
 
+#include "../util/extension_table.hpp"
+
 namespace nive::fs {
 
 namespace {
 
-// Supported image extensions (WIC-compatible + common formats)
-constexpr std::array<std::wstring_view, 15> kImageExtensions = {
-    L".jpg", L".jpeg", L".png",  L".gif",  L".bmp", L".tiff", L".tif", L".webp",
-    L".ico", L".heic", L".heif", L".avif", L".jxr", L".wdp",  L".dds"};
-
-// Supported archive extensions
-constexpr std::array<std::wstring_view, 8> kArchiveExtensions = {
-    L".zip", L".7z", L".rar", L".lzh", L".lha", L".tar", L".gz", L".cbz"};
-
-[[nodiscard]] std::wstring to_lower(std::wstring_view str) {
-    std::wstring result(str);
-    std::transform(result.begin(), result.end(), result.begin(),
-                   [](wchar_t c) { return static_cast<wchar_t>(::towlower(c)); });
-    return result;
+// Supported image (WIC-compatible + common formats) and archive extensions
+constexpr auto kExtensionTypes = makeExtensionTable<FileType>({
+    {"jpg", FileType::Image},   {"jpeg", FileType::Image},  {"png", FileType::Image},
+    {"gif", FileType::Image},   {"bmp", FileType::Image},   {"tiff", FileType::Image},
+    {"tif", FileType::Image},   {"webp", FileType::Image},  {"ico", FileType::Image},
+    {"heic", FileType::Image},  {"heif", FileType::Image},  {"avif", FileType::Image},
+    {"jxr", FileType::Image},   {"wdp", FileType::Image},   {"dds", FileType::Image},
+    {"zip", FileType::Archive}, {"7z", FileType::Archive},  {"rar", FileType::Archive},
+    {"lzh", FileType::Archive}, {"lha", FileType::Archive}, {"tar", FileType::Archive},
+    {"gz", FileType::Archive},  {"cbz", FileType::Archive},
+});
+
+/// @brief Classify an extension, Other when it is not in the table
+[[nodiscard]] FileType extension_type(std::wstring_view ext) noexcept {
+    const FileType* type = kExtensionTypes.find(ext);
+    return type ? *type : FileType::Other;
 }
 
 [[nodiscard]] std::chrono::system_clock::time_point filetime_to_system_clock(const FILETIME& ft) {
-    // FILETIME is 100-nanosecond intervals since January 1, 1601
-    // system_clock is typically since January 1, 1970
-    constexpr int64_t kFileTimeToUnixEpoch = 116444736000000000LL;
-
     ULARGE_INTEGER uli;
     uli.LowPart = ft.dwLowDateTime;
     uli.HighPart = ft.dwHighDateTime;
-
-    int64_t ticks = static_cast<int64_t>(uli.QuadPart) - kFileTimeToUnixEpoch;
-    auto duration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>(ticks);
-
-    return std::chrono::system_clock::time_point(
-        std::chrono::duration_cast<std::chrono::system_clock::duration>(duration));
+    return fileTimeToSystemClock(uli.QuadPart);
 }
 
 }  // namespace
@@ -67,46 +59,49 @@ std::wstring FileMetadata::sizeString() const {
 }
 
 bool isImageExtension(std::wstring_view ext) noexcept {
-    if (ext.empty())
-        return false;
-
-    std::wstring lower_ext = to_lower(ext);
-    for (const auto& image_ext : kImageExtensions) {
-        if (lower_ext == image_ext) {
-            return true;
-        }
-    }
-    return false;
+    return extension_type(ext) == FileType::Image;
 }
 
 bool isArchiveExtension(std::wstring_view ext) noexcept {
-    if (ext.empty())
-        return false;
-
-    std::wstring lower_ext = to_lower(ext);
-    for (const auto& archive_ext : kArchiveExtensions) {
-        if (lower_ext == archive_ext) {
-            return true;
-        }
-    }
-    return false;
+    return extension_type(ext) == FileType::Archive;
 }
 
 FileType getFileType(const std::filesystem::path& path) noexcept {
     std::error_code ec;
-    if (std::filesystem::is_directory(path, ec)) {
+    return getFileType(path, std::filesystem::is_directory(path, ec));
+}
+
+FileType getFileType(const std::filesystem::path& path, bool is_directory) noexcept {
+    if (is_directory) {
         return FileType::Directory;
     }
 
-    auto ext = path.extension().wstring();
-    if (isImageExtension(ext)) {
-        return FileType::Image;
-    }
-    if (isArchiveExtension(ext)) {
-        return FileType::Archive;
-    }
+    return extension_type(path.extension().native());
+}
+
+FileAttributes fileAttributesFromWin32(uint32_t attributes) noexcept {
+    FileAttributes result;
+    result.is_directory = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    result.is_hidden = (attributes & FILE_ATTRIBUTE_HIDDEN) != 0;
+    result.is_system = (attributes & FILE_ATTRIBUTE_SYSTEM) != 0;
+    result.is_readonly = (attributes & FILE_ATTRIBUTE_READONLY) != 0;
+    result.is_archive = (attributes & FILE_ATTRIBUTE_ARCHIVE) != 0;
+    result.is_compressed = (attributes & FILE_ATTRIBUTE_COMPRESSED) != 0;
+    result.is_encrypted = (attributes & FILE_ATTRIBUTE_ENCRYPTED) != 0;
+    result.is_reparse_point = (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+    return result;
+}
 
-    return FileType::Other;
+std::chrono::system_clock::time_point fileTimeToSystemClock(uint64_t ticks) noexcept {
+    // FILETIME is 100-nanosecond intervals since January 1, 1601
+    // system_clock is typically since January 1, 1970
+    constexpr int64_t kFileTimeToUnixEpoch = 116444736000000000LL;
+
+    auto duration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>(
+        static_cast<int64_t>(ticks) - kFileTimeToUnixEpoch);
+
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(duration));
 }
 
 std::optional<FileMetadata> getFileMetadata(const std::filesystem::path& path) {
@@ -119,16 +114,10 @@ std::optional<FileMetadata> getFileMetadata(const std::filesystem::path& path) {
     metadata.path = path;
     metadata.name = path.filename().wstring();
     metadata.extension = path.extension().wstring();
-    metadata.type = getFileType(path);
 
     // Attributes
-    metadata.attributes.is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-    metadata.attributes.is_hidden = (data.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) != 0;
-    metadata.attributes.is_system = (data.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM) != 0;
-    metadata.attributes.is_readonly = (data.dwFileAttributes & FILE_ATTRIBUTE_READONLY) != 0;
-    metadata.attributes.is_archive = (data.dwFileAttributes & FILE_ATTRIBUTE_ARCHIVE) != 0;
-    metadata.attributes.is_compressed = (data.dwFileAttributes & FILE_ATTRIBUTE_COMPRESSED) != 0;
-    metadata.attributes.is_encrypted = (data.dwFileAttributes & FILE_ATTRIBUTE_ENCRYPTED) != 0;
+    metadata.attributes = fileAttributesFromWin32(data.dwFileAttributes);
+    metadata.type = getFileType(path, metadata.attributes.is_directory);
 
     // Size
     ULARGE_INTEGER size;
@@ -47,6 +47,19 @@ struct FileAttributes {
     bool is_archive = false;
     bool is_compressed = false;
     bool is_encrypted = false;
+    bool is_reparse_point = false;  // Junction or symbolic link
+};
+
+/// @brief File system identity of a file, unchanged by renames and moves within a volume
+struct FileId {
+    uint64_t volume = 0;  // Volume serial number
+    uint64_t low = 0;     // FILE_ID_128; NTFS and SMB use only the low half
+    uint64_t high = 0;
+
+    /// @brief Check if the file system reported an ID (FAT and archives do not)
+    [[nodiscard]] bool valid() const noexcept { return low != 0 || high != 0; }
+
+    [[nodiscard]] bool operator==(const FileId&) const noexcept = default;
 };
 
 /// @brief File metadata
@@ -63,9 +76,20 @@ struct FileMetadata {
     std::chrono::system_clock::time_point modified_time;
     std::chrono::system_clock::time_point accessed_time;
 
+    // Filled in by directory enumeration where the file system has IDs
+    FileId file_id;
+
     // Virtual path for files inside archives
     std::optional<archive::VirtualPath> virtual_path;
 
+    // naturalSortKey(name), filled in by sortEntries and reused on later sorts
+    std::string sort_key;
+
+    // Capture date and camera from the file's EXIF block, filled in by the
+    // caller (from the thumbnail cache) when the sort order needs them
+    std::optional<std::chrono::system_clock::time_point> date_taken;
+    std::wstring camera_model;
+
     /// @brief Check if file is an image
     [[nodiscard]] bool is_image() const noexcept { return type == FileType::Image; }
 
@@ -96,14 +120,29 @@ struct FileMetadata {
 };
 
 /// @brief Supported image extensions
+///
+/// Takes the extension with or without its dot, in any ASCII case, and does
+/// not allocate (see ExtensionTable).
 [[nodiscard]] bool isImageExtension(std::wstring_view ext) noexcept;
 
-/// @brief Supported archive extensions
+/// @brief Supported archive extensions, matched like isImageExtension()
 [[nodiscard]] bool isArchiveExtension(std::wstring_view ext) noexcept;
 
 /// @brief Determine file type from extension
 [[nodiscard]] FileType getFileType(const std::filesystem::path& path) noexcept;
 
+/// @brief Determine file type when the directory bit is already known
+///
+/// Unlike getFileType(path), this does not touch the file system. Used by
+/// directory enumeration, where the attributes come with the find data.
+[[nodiscard]] FileType getFileType(const std::filesystem::path& path, bool is_directory) noexcept;
+
+/// @brief Decode Win32 FILE_ATTRIBUTE_* flags
+[[nodiscard]] FileAttributes fileAttributesFromWin32(uint32_t attributes) noexcept;
+
+/// @brief Convert a Win32 FILETIME value (100ns ticks since 1601-01-01) to system_clock
+[[nodiscard]] std::chrono::system_clock::time_point fileTimeToSystemClock(uint64_t ticks) noexcept;
+
 /// @brief Get file metadata
 /// @param path File path
 /// @return File metadata or nullopt if file doesn't exist
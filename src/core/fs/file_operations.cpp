@@ -10,6 +10,7 @@
 #include <format>
 #include <random>
 
+#include "copy_engine.hpp"
 #include "trash.hpp"
 
 namespace nive::fs {
@@ -65,6 +66,23 @@ constexpr std::array<std::wstring_view, 22> kReservedNames = {
     L"COM5", L"COM6", L"COM7", L"COM8", L"COM9", L"LPT1", L"LPT2", L"LPT3",
     L"LPT4", L"LPT5", L"LPT6", L"LPT7", L"LPT8", L"LPT9"};
 
+/// @brief Add the result of the copy to that of the checks made before it
+[[nodiscard]] FileOperationResult merge_results(FileOperationResult result,
+                                                FileOperationResult copied) {
+    result.files_processed += copied.files_processed;
+    result.bytes_processed += copied.bytes_processed;
+    result.failed_files.insert(result.failed_files.end(),
+                               std::make_move_iterator(copied.failed_files.begin()),
+                               std::make_move_iterator(copied.failed_files.end()));
+    if (copied.error == FileOperationError::Cancelled) {
+        result.error = FileOperationError::Cancelled;
+    } else if (!result.failed_files.empty()) {
+        result.error = result.files_processed > 0 ? FileOperationError::PartialSuccess
+                                                  : FileOperationError::IoError;
+    }
+    return result;
+}
+
 }  // namespace
 
 std::expected<void, FileOperationError> copyFile(const std::filesystem::path& source,
@@ -126,41 +144,32 @@ FileOperationResult copyFiles(std::span<const std::filesystem::path> sources,
                               ProgressCallback progress) {
     FileOperationResult result;
 
-    // Calculate total size
-    uint64_t total_size = 0;
-    for (const auto& source : sources) {
-        total_size += get_file_size(source);
-    }
-
-    uint64_t processed_size = 0;
-
+    // Settle existing destinations up front; the rest is copied in parallel
+    std::vector<CopyJob> jobs;
+    jobs.reserve(sources.size());
     for (const auto& source : sources) {
-        auto dest = dest_dir / source.filename();
+        CopyJob job{.source = source,
+                    .dest = dest_dir / source.filename(),
+                    .size = get_file_size(source),
+                    .replace_existing = options.overwrite_existing};
 
-        // Progress callback
-        if (progress && !progress(source, processed_size, total_size)) {
-            result.error = FileOperationError::Cancelled;
-            return result;
-        }
-
-        auto copy_result = copyFile(source, dest, options);
-        if (copy_result) {
-            ++result.files_processed;
-            auto file_size = get_file_size(source);
-            result.bytes_processed += file_size;
-            processed_size += file_size;
-        } else {
-            result.failed_files.push_back(source);
-            processed_size += get_file_size(source);
+        std::error_code ec;
+        if (std::filesystem::exists(job.dest, ec)) {
+            if (options.skip_existing) {
+                ++result.files_processed;
+                result.bytes_processed += job.size;
+                continue;
+            }
+            if (!options.overwrite_existing) {
+                result.failed_files.push_back(source);
+                continue;
+            }
         }
+        jobs.push_back(std::move(job));
     }
 
-    if (!result.failed_files.empty()) {
-        result.error = result.files_processed > 0 ? FileOperationError::PartialSuccess
-                                                  : FileOperationError::IoError;
-    }
-
-    return result;
+    return merge_results(std::move(result),
+                         copyInParallel(jobs, options, {}, std::move(progress)));
 }
 
 std::expected<void, FileOperationError> moveFile(const std::filesystem::path& source,
@@ -575,25 +584,15 @@ FileOperationResult copyFilesWithConflictHandling(std::span<const std::filesyste
                                                   const ExtendedCopyOptions& options,
                                                   ProgressCallback progress) {
     FileOperationResult result;
-
-    // Calculate total size
-    uint64_t total_size = 0;
-    for (const auto& source : sources) {
-        total_size += get_file_size(source);
-    }
-
-    uint64_t processed_size = 0;
     std::optional<ConflictResolution> apply_to_all_resolution;
+    FileIdentityCache identity_cache;
 
+    // Every conflict is resolved before the first copy starts
+    std::vector<CopyJob> jobs;
+    jobs.reserve(sources.size());
     for (const auto& source : sources) {
         auto dest = dest_dir / source.filename();
 
-        // Progress callback
-        if (progress && !progress(source, processed_size, total_size)) {
-            result.error = FileOperationError::Cancelled;
-            return result;
-        }
-
         // Check for conflict
         if (std::filesystem::exists(dest)) {
             // Build conflict info
@@ -606,14 +605,14 @@ FileOperationResult copyFilesWithConflictHandling(std::span<const std::filesyste
             conflict.dest_size = std::filesystem::file_size(dest, ec);
             conflict.source_time = std::filesystem::last_write_time(source, ec);
             conflict.dest_time = std::filesystem::last_write_time(dest, ec);
-            conflict.files_identical = areFilesIdentical(source, dest);
+            conflict.files_identical =
+                areFilesIdentical(source, dest, options.identity_check, &identity_cache);
 
             // Skip identical files if option is set
             if ((options.skip_identical ||
                  (apply_to_all_resolution && apply_to_all_resolution->skip_identical)) &&
                 conflict.files_identical) {
                 ++result.files_processed;
-                processed_size += get_file_size(source);
                 continue;
             }
 
@@ -635,7 +634,6 @@ FileOperationResult copyFilesWithConflictHandling(std::span<const std::filesyste
             } else {
                 // No conflict handler, skip by default
                 result.failed_files.push_back(source);
-                processed_size += get_file_size(source);
                 continue;
             }
 
@@ -645,34 +643,20 @@ FileOperationResult copyFilesWithConflictHandling(std::span<const std::filesyste
             if (resolved_dest.empty()) {
                 // Skip this file
                 ++result.files_processed;
-                processed_size += get_file_size(source);
                 continue;
             }
             dest = resolved_dest;
         }
 
-        // Perform the copy
-        CopyOptions copy_opts = options;
-        copy_opts.overwrite_existing = true;  // We handled conflicts above
-
-        auto copy_result = safeCopyFile(source, dest, copy_opts);
-        if (copy_result) {
-            ++result.files_processed;
-            auto file_size = get_file_size(source);
-            result.bytes_processed += file_size;
-            processed_size += file_size;
-        } else {
-            result.failed_files.push_back(source);
-            processed_size += get_file_size(source);
-        }
-    }
-
-    if (!result.failed_files.empty()) {
-        result.error = result.files_processed > 0 ? FileOperationError::PartialSuccess
-                                                  : FileOperationError::IoError;
+        // Conflicts are handled above, so an existing destination is replaced
+        jobs.push_back({.source = source,
+                        .dest = std::move(dest),
+                        .size = get_file_size(source),
+                        .replace_existing = true});
     }
 
-    return result;
+    return merge_results(std::move(result),
+                         copyInParallel(jobs, options, {}, std::move(progress)));
 }
 
 FileOperationResult moveFilesWithConflictHandling(std::span<const std::filesystem::path> sources,
@@ -688,6 +672,7 @@ FileOperationResult moveFilesWithConflictHandling(std::span<const std::filesyste
 
     uint64_t processed_size = 0;
     std::optional<ConflictResolution> apply_to_all_resolution;
+    FileIdentityCache identity_cache;
 
     for (const auto& source : sources) {
         auto dest = dest_dir / source.filename();
@@ -709,7 +694,8 @@ FileOperationResult moveFilesWithConflictHandling(std::span<const std::filesyste
             conflict.dest_size = std::filesystem::file_size(dest, ec);
             conflict.source_time = std::filesystem::last_write_time(source, ec);
             conflict.dest_time = std::filesystem::last_write_time(dest, ec);
-            conflict.files_identical = areFilesIdentical(source, dest);
+            conflict.files_identical =
+                areFilesIdentical(source, dest, options.identity_check, &identity_cache);
 
             // Skip identical files if option is set
             if ((options.skip_identical ||
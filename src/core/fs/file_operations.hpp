@@ -177,6 +177,7 @@ struct ExtendedCopyOptions : public CopyOptions {
     ConflictCallback on_conflict;         // Called when conflict detected
     bool move_replaced_to_trash = false;  // Move replaced files to recycle bin
     bool skip_identical = false;          // Skip files that are identical
+    IdentityCheckOptions identity_check;  // How files_identical is decided
 };
 
 /// @brief Copy files with conflict detection and resolution
@@ -0,0 +1,309 @@
+/// @file folder_stats.cpp
+/// @brief Parallel folder statistics implementation
+///
+/// Every directory of a walk is a node. A node is pending on its own read
+/// and on each subdirectory queued from it; whichever finishes last stores
+/// the node's totals in the cache and adds them to its parent, so totals
+/// travel up the tree as subtrees complete, without any task waiting.
+
+#include "folder_stats.hpp"
+
+#include <Windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <expected>
+#include <vector>
+
+#include "../util/string_utils.hpp"
+#include "../util/task_group.hpp"
+#include "directory_reader.hpp"
+#include "io_scheduler.hpp"
+
+namespace nive::fs {
+
+namespace {
+
+// Cached totals are trusted this long without a notification
+constexpr auto kEntryLifetime = std::chrono::minutes(10);
+
+// Entries kept; the cache starts over once it grows past this
+constexpr size_t kMaxEntries = 256 * 1024;
+
+constexpr auto kProgressInterval = std::chrono::milliseconds(100);
+
+[[nodiscard]] std::wstring cache_key(const std::filesystem::path& path) {
+    std::wstring key = toLowercaseAscii(path.lexically_normal().native());
+    while (key.size() > 3 && (key.back() == L'\\' || key.back() == L'/')) {
+        key.pop_back();
+    }
+    return key;
+}
+
+[[nodiscard]] uint64_t filetime_ticks(const FILETIME& time) noexcept {
+    return static_cast<uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime;
+}
+
+}  // namespace
+
+/// @brief A directory being read, and the subtree below it
+struct FolderStats::Node {
+    std::filesystem::path path;
+    std::wstring key;
+    uint64_t modified = 0;         // Of the directory itself, for the cache
+    std::shared_ptr<Node> parent;  // Null for a measured path
+    std::atomic<size_t> pending{1};  // Its own read plus unfinished subdirectories
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> directories{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<bool> complete{true};
+};
+
+/// @brief State of one measure() call, shared by its tasks
+struct FolderStats::Walk {
+    // Everything counted so far, for progress
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> directories{0};
+    std::atomic<uint64_t> bytes{0};
+
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t roots_pending = 0;  // Guarded by mutex
+    FolderTotals result;       // Guarded by mutex
+
+    // Last, so it is destroyed (waiting for the tasks) before the rest
+    TaskGroup group{globalThreadPool(), TaskPriority::Normal};
+
+    void count(const FolderTotals& totals) noexcept {
+        files.fetch_add(totals.files, std::memory_order_relaxed);
+        directories.fetch_add(totals.directories, std::memory_order_relaxed);
+        bytes.fetch_add(totals.bytes, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] FolderTotals counted() const noexcept {
+        return FolderTotals{
+            .files = files.load(std::memory_order_relaxed),
+            .directories = directories.load(std::memory_order_relaxed),
+            .bytes = bytes.load(std::memory_order_relaxed),
+            .complete = false,
+        };
+    }
+};
+
+FolderStats& FolderStats::instance() {
+    static FolderStats stats;
+    return stats;
+}
+
+FolderTotals FolderStats::measure(std::span<const std::filesystem::path> paths,
+                                  const FolderStatsProgress& progress, std::stop_token stop) {
+    Walk walk;
+    std::stop_callback forward_stop(stop, [&walk] { walk.group.cancel(); });
+
+    FolderTotals loose;  // Files and cached directories among the paths
+    for (const auto& path : paths) {
+        WIN32_FILE_ATTRIBUTE_DATA data{};
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+            loose.complete = false;
+            continue;
+        }
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            ++loose.files;
+            loose.bytes += static_cast<uint64_t>(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+            continue;
+        }
+
+        auto node = std::make_shared<Node>();
+        node->path = path;
+        node->key = cache_key(path);
+        node->modified = filetime_ticks(data.ftLastWriteTime);
+        FolderTotals cached;
+        if (lookup(node->key, node->modified, cached)) {
+            loose += cached;
+            continue;
+        }
+        {
+            std::lock_guard lock(walk.mutex);
+            ++walk.roots_pending;
+        }
+        walk.group.run([this, &walk, node] { scan(node, walk); });
+    }
+    walk.count(loose);
+
+    // Without workers the tasks run in wait() below, on this thread
+    if (globalThreadPool().workerCount() > 0) {
+        std::unique_lock lock(walk.mutex);
+        while (walk.roots_pending > 0 && !walk.group.cancelled()) {
+            if (walk.done.wait_for(lock, kProgressInterval,
+                                   [&walk] { return walk.roots_pending == 0; })) {
+                break;
+            }
+            if (progress) {
+                lock.unlock();
+                if (!progress(walk.counted())) {
+                    walk.group.cancel();
+                }
+                lock.lock();
+            }
+        }
+    }
+    walk.group.wait();
+
+    std::lock_guard lock(walk.mutex);
+    if (walk.roots_pending > 0) {
+        // Cancelled: subtrees left unread never reached their roots
+        return walk.counted();
+    }
+    FolderTotals totals = walk.result;
+    totals += loose;
+    return totals;
+}
+
+void FolderStats::scan(const std::shared_ptr<Node>& node, Walk& walk) {
+    std::vector<std::shared_ptr<Node>> children;
+    FolderTotals direct;
+    {
+        auto slot = IoScheduler::instance().acquire(node->path, IoPriority::Foreground,
+                                                    walk.group.stopToken());
+        std::expected<DirectoryReader, DirectoryError> reader =
+            std::unexpected(DirectoryError::Cancelled);
+        if (slot) {
+            reader = DirectoryReader::open(node->path);
+        }
+        if (!reader) {
+            direct.complete = false;
+        }
+        DirectoryRecord record;
+        while (reader && !walk.group.cancelled()) {
+            auto more = reader->next(record);
+            if (!more || !*more) {
+                direct.complete = direct.complete && more.has_value();
+                break;
+            }
+            if (!(record.attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                ++direct.files;
+                direct.bytes += record.size;
+                continue;
+            }
+            ++direct.directories;
+            if (record.attributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                continue;  // Not followed; it may lead back up the tree
+            }
+            auto child = std::make_shared<Node>();
+            child->path = node->path / record.name;
+            child->key = cache_key(child->path);
+            child->modified = record.modified;
+            child->parent = node;
+            FolderTotals cached;
+            if (lookup(child->key, child->modified, cached)) {
+                direct += cached;
+            } else {
+                children.push_back(std::move(child));
+            }
+        }
+        if (walk.group.cancelled()) {
+            direct.complete = false;
+        }
+    }
+
+    walk.count(direct);
+    node->files.fetch_add(direct.files, std::memory_order_relaxed);
+    node->directories.fetch_add(direct.directories, std::memory_order_relaxed);
+    node->bytes.fetch_add(direct.bytes, std::memory_order_relaxed);
+    if (!direct.complete) {
+        node->complete.store(false, std::memory_order_relaxed);
+    }
+    node->pending.fetch_add(children.size(), std::memory_order_relaxed);
+    for (auto& child : children) {
+        walk.group.run([this, &walk, child = std::move(child)] { scan(child, walk); });
+    }
+    finish(node, walk);
+}
+
+void FolderStats::finish(const std::shared_ptr<Node>& node, Walk& walk) {
+    if (node->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    FolderTotals totals{
+        .files = node->files.load(std::memory_order_relaxed),
+        .directories = node->directories.load(std::memory_order_relaxed),
+        .bytes = node->bytes.load(std::memory_order_relaxed),
+        .complete = node->complete.load(std::memory_order_relaxed),
+    };
+    if (totals.complete && node->modified != 0) {
+        store(node->key, node->modified, totals);
+    }
+
+    if (const auto& parent = node->parent) {
+        parent->files.fetch_add(totals.files, std::memory_order_relaxed);
+        parent->directories.fetch_add(totals.directories, std::memory_order_relaxed);
+        parent->bytes.fetch_add(totals.bytes, std::memory_order_relaxed);
+        if (!totals.complete) {
+            parent->complete.store(false, std::memory_order_relaxed);
+        }
+        finish(parent, walk);
+        return;
+    }
+    {
+        std::lock_guard lock(walk.mutex);
+        walk.result += totals;
+        --walk.roots_pending;
+    }
+    walk.done.notify_all();
+}
+
+bool FolderStats::lookup(const std::wstring& key, uint64_t modified, FolderTotals& totals) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return false;
+    }
+    if (it->second.modified != modified ||
+        std::chrono::steady_clock::now() - it->second.measured > kEntryLifetime) {
+        entries_.erase(it);
+        return false;
+    }
+    totals = it->second.totals;
+    return true;
+}
+
+void FolderStats::store(std::wstring key, uint64_t modified, const FolderTotals& totals) {
+    std::lock_guard lock(mutex_);
+    if (entries_.size() >= kMaxEntries) {
+        entries_.clear();
+    }
+    entries_.insert_or_assign(std::move(key),
+                              Entry{modified, totals, std::chrono::steady_clock::now()});
+}
+
+void FolderStats::invalidate(const std::filesystem::path& path) {
+    std::wstring key = cache_key(path);
+    std::lock_guard lock(mutex_);
+    if (entries_.empty()) {
+        return;
+    }
+    for (std::filesystem::path current(key);; current = current.parent_path()) {
+        entries_.erase(current.native());
+        if (!current.has_relative_path()) {
+            break;
+        }
+    }
+}
+
+void FolderStats::invalidateTree(const std::filesystem::path& directory) {
+    invalidate(directory);
+    std::wstring prefix = cache_key(directory);
+    if (prefix.back() != L'\\') {
+        prefix += L'\\';
+    }
+    std::lock_guard lock(mutex_);
+    std::erase_if(entries_,
+                  [&prefix](const auto& entry) { return entry.first.starts_with(prefix); });
+}
+
+void FolderStats::clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+}
+
+}  // namespace nive::fs
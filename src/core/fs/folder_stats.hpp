@@ -0,0 +1,110 @@
+/// @file folder_stats.hpp
+/// @brief Recursive file counts and sizes of folders, walked in parallel and cached
+///
+/// Each directory is read by a task of its own on the global thread pool,
+/// which queues a task per subdirectory, so a wide tree is read by every
+/// worker at once (within the I/O slots of its volume). Totals of every
+/// directory read to the end are cached with the directory's last-write
+/// time; a later query stops at any subdirectory whose entry is still
+/// valid. Write times only change with a directory's own entries, so the
+/// directory watcher drops the entries of a changed path and its parents,
+/// and entries expire after a while for trees outside the watched ones.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+
+namespace nive::fs {
+
+/// @brief Totals of files under one or more paths
+struct FolderTotals {
+    uint64_t files = 0;
+    uint64_t directories = 0;  // Below the paths measured, not counting them
+    uint64_t bytes = 0;
+    bool complete = true;  // false if a directory could not be read, or cancelled
+
+    FolderTotals& operator+=(const FolderTotals& other) noexcept {
+        files += other.files;
+        directories += other.directories;
+        bytes += other.bytes;
+        complete = complete && other.complete;
+        return *this;
+    }
+};
+
+/// @brief Totals counted so far, while a measurement runs
+/// @return false to cancel
+///
+/// Called on the thread running FolderStats::measure(), about ten times a second.
+using FolderStatsProgress = std::function<bool(const FolderTotals& so_far)>;
+
+/// @brief Measures folders, caching the totals of each directory
+///
+/// Thread-safe. Directory symlinks and junctions are counted as
+/// directories but not followed, as std::filesystem's recursive iterator
+/// does by default.
+class FolderStats {
+public:
+    FolderStats() = default;
+
+    FolderStats(const FolderStats&) = delete;
+    FolderStats& operator=(const FolderStats&) = delete;
+
+    /// @brief Get the process-wide instance (the one the directory watcher invalidates)
+    [[nodiscard]] static FolderStats& instance();
+
+    /// @brief Count the files under some paths
+    /// @param paths Files and directories; files count as themselves
+    /// @param progress Partial totals callback (optional)
+    /// @param stop Cancels the walk, like progress returning false
+    /// @return Totals; not complete if cancelled or a directory was unreadable
+    [[nodiscard]] FolderTotals measure(std::span<const std::filesystem::path> paths,
+                                       const FolderStatsProgress& progress = {},
+                                       std::stop_token stop = {});
+
+    /// @brief Drop the cached totals of a path and of every directory above it
+    /// @param path Changed file or directory
+    void invalidate(const std::filesystem::path& path);
+
+    /// @brief Drop the cached totals of a directory, its parents and everything below it
+    ///
+    /// For a watch that lost notifications.
+    void invalidateTree(const std::filesystem::path& directory);
+
+    /// @brief Drop every cached total
+    void clear();
+
+private:
+    struct Node;
+    struct Walk;
+
+    struct Entry {
+        uint64_t modified = 0;  // FILETIME ticks of the directory when measured
+        FolderTotals totals;
+        std::chrono::steady_clock::time_point measured;
+    };
+
+    /// @brief Cached totals of a directory last written at modified, if still valid
+    [[nodiscard]] bool lookup(const std::wstring& key, uint64_t modified, FolderTotals& totals);
+    void store(std::wstring key, uint64_t modified, const FolderTotals& totals);
+
+    /// @brief Read one directory, queueing its uncached subdirectories (a walk task)
+    void scan(const std::shared_ptr<Node>& node, Walk& walk);
+
+    /// @brief Count one finished part of a node; the last one passes its totals up
+    void finish(const std::shared_ptr<Node>& node, Walk& walk);
+
+    std::mutex mutex_;
+    std::unordered_map<std::wstring, Entry> entries_;  // By lowercase path
+};
+
+}  // namespace nive::fs
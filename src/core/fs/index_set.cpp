@@ -0,0 +1,225 @@
+/// @file index_set.cpp
+/// @brief Range set operations
+
+#include "index_set.hpp"
+
+#include <algorithm>
+
+namespace nive::fs {
+
+namespace {
+
+[[nodiscard]] constexpr size_t end_of(const IndexRange& range) noexcept {
+    return range.first + range.count;
+}
+
+}  // namespace
+
+IndexSet IndexSet::all(size_t count) {
+    IndexSet set;
+    set.append({0, count});
+    return set;
+}
+
+IndexSet IndexSet::fromIndices(std::span<const size_t> indices) {
+    std::vector<size_t> sorted(indices.begin(), indices.end());
+    std::ranges::sort(sorted);
+    IndexSet set;
+    for (size_t index : sorted) {
+        if (set.ranges_.empty() || end_of(set.ranges_.back()) <= index) {
+            set.append({index, 1});
+        }
+    }
+    return set;
+}
+
+std::optional<size_t> IndexSet::first() const noexcept {
+    if (ranges_.empty()) {
+        return std::nullopt;
+    }
+    return ranges_.front().first;
+}
+
+bool IndexSet::contains(size_t index) const noexcept {
+    // The last range starting at or before index
+    auto it = std::ranges::upper_bound(ranges_, index, {}, &IndexRange::first);
+    return it != ranges_.begin() && index < end_of(*std::prev(it));
+}
+
+void IndexSet::insert(IndexRange range) {
+    if (range.count == 0) {
+        return;
+    }
+    size_t first = range.first;
+    size_t last = end_of(range);
+
+    // Ranges ending before first, and not touching it, stay as they are
+    auto begin = std::ranges::lower_bound(ranges_, first, {}, end_of);
+    auto stop = begin;
+    while (stop != ranges_.end() && stop->first <= last) {
+        first = (std::min)(first, stop->first);
+        last = (std::max)(last, end_of(*stop));
+        count_ -= stop->count;
+        ++stop;
+    }
+
+    IndexRange merged{first, last - first};
+    count_ += merged.count;
+    if (begin == stop) {
+        ranges_.insert(begin, merged);
+    } else {
+        *begin = merged;
+        ranges_.erase(std::next(begin), stop);
+    }
+}
+
+void IndexSet::erase(IndexRange range) {
+    if (range.count == 0) {
+        return;
+    }
+    size_t first = range.first;
+    size_t last = end_of(range);
+
+    // Ranges overlapping [first, last) lose that part; at most two pieces remain
+    auto begin = std::ranges::upper_bound(ranges_, first, {}, end_of);
+    auto stop = begin;
+    std::optional<IndexRange> left;
+    std::optional<IndexRange> right;
+    while (stop != ranges_.end() && stop->first < last) {
+        if (stop->first < first) {
+            left = IndexRange{stop->first, first - stop->first};
+        }
+        if (end_of(*stop) > last) {
+            right = IndexRange{last, end_of(*stop) - last};
+        }
+        count_ -= stop->count;
+        ++stop;
+    }
+    if (begin == stop) {
+        return;
+    }
+
+    auto at = ranges_.erase(begin, stop);
+    if (right) {
+        at = ranges_.insert(at, *right);
+        count_ += right->count;
+    }
+    if (left) {
+        ranges_.insert(at, *left);
+        count_ += left->count;
+    }
+}
+
+void IndexSet::toggle(size_t index) {
+    if (contains(index)) {
+        erase(index);
+    } else {
+        insert(index);
+    }
+}
+
+void IndexSet::truncate(size_t size) {
+    if (!ranges_.empty() && end_of(ranges_.back()) > size) {
+        erase({size, end_of(ranges_.back()) - size});
+    }
+}
+
+IndexSet IndexSet::difference(const IndexSet& other) const {
+    IndexSet result;
+    auto cut = other.ranges_.begin();
+    for (const auto& range : ranges_) {
+        size_t first = range.first;
+        size_t last = end_of(range);
+        // Ranges of other ending before this one cannot cut the ones after it
+        while (cut != other.ranges_.end() && end_of(*cut) <= first) {
+            ++cut;
+        }
+        for (auto it = cut; first < last; ++it) {
+            if (it == other.ranges_.end() || it->first >= last) {
+                result.append({first, last - first});
+                break;
+            }
+            if (it->first > first) {
+                result.append({first, it->first - first});
+            }
+            first = (std::max)(first, end_of(*it));
+        }
+    }
+    return result;
+}
+
+IndexSet IndexSet::mapped(const ModelDelta& delta) const {
+    // Drop the removed rows, shifting the kept ones down past them
+    IndexSet kept;
+    auto removed = delta.removed.begin();
+    size_t removed_before = 0;
+    for (const auto& range : ranges_) {
+        size_t first = range.first;
+        size_t last = end_of(range);
+        while (first < last) {
+            while (removed != delta.removed.end() && end_of(*removed) <= first) {
+                removed_before += removed->count;
+                ++removed;
+            }
+            if (removed != delta.removed.end() && removed->first <= first) {
+                first = (std::min)(last, end_of(*removed));
+                continue;
+            }
+            size_t stop = removed == delta.removed.end() ? last
+                                                         : (std::min)(last, removed->first);
+            kept.append({first - removed_before, stop - first});
+            first = stop;
+        }
+    }
+
+    // Each inserted range pushes the kept rows from its position on back by its count
+    IndexSet result;
+    auto inserted = delta.inserted.begin();
+    size_t offset = 0;
+    for (const auto& range : kept.ranges_) {
+        size_t first = range.first;
+        size_t last = end_of(range);
+        while (first < last) {
+            while (inserted != delta.inserted.end() && inserted->first <= first + offset) {
+                offset += inserted->count;
+                ++inserted;
+            }
+            size_t stop = inserted == delta.inserted.end()
+                              ? last
+                              : (std::min)(last, inserted->first - offset);
+            result.append({first + offset, stop - first});
+            first = stop;
+        }
+    }
+    return result;
+}
+
+std::vector<size_t> IndexSet::toVector() const {
+    std::vector<size_t> indices;
+    indices.reserve(count_);
+    for (size_t index : *this) {
+        indices.push_back(index);
+    }
+    return indices;
+}
+
+bool IndexSet::operator==(const IndexSet& other) const noexcept {
+    return count_ == other.count_ &&
+           std::ranges::equal(ranges_, other.ranges_, [](const auto& a, const auto& b) {
+               return a.first == b.first && a.count == b.count;
+           });
+}
+
+void IndexSet::append(IndexRange range) {
+    if (range.count == 0) {
+        return;
+    }
+    if (!ranges_.empty() && end_of(ranges_.back()) == range.first) {
+        ranges_.back().count += range.count;
+    } else {
+        ranges_.push_back(range);
+    }
+    count_ += range.count;
+}
+
+}  // namespace nive::fs
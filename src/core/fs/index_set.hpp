@@ -0,0 +1,133 @@
+/// @file index_set.hpp
+/// @brief Set of row indices stored as ascending ranges
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "directory_model.hpp"
+
+namespace nive::fs {
+
+/// @brief Set of row indices, kept as sorted, disjoint, non-adjacent ranges
+///
+/// Selections are mostly a few runs: select-all over a 200k-row listing is
+/// one range rather than 200k flags or indices. Lookups are a binary search
+/// over the ranges, and insert, erase, difference and mapping through a
+/// ModelDelta cost O(ranges), not O(rows). Iterating yields each index in
+/// ascending order without building a vector.
+class IndexSet {
+public:
+    /// @brief Forward iterator over the indices, in ascending order
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const size_t*;
+        using reference = size_t;
+
+        Iterator() = default;
+
+        [[nodiscard]] size_t operator*() const noexcept { return index_; }
+
+        Iterator& operator++() noexcept {
+            if (++index_ == range_->first + range_->count && ++range_ != end_) {
+                index_ = range_->first;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        [[nodiscard]] bool operator==(const Iterator& other) const noexcept {
+            return range_ == other.range_ && (range_ == end_ || index_ == other.index_);
+        }
+
+    private:
+        friend class IndexSet;
+
+        Iterator(const IndexRange* range, const IndexRange* end) noexcept
+            : range_(range), end_(end), index_(range != end ? range->first : 0) {}
+
+        const IndexRange* range_ = nullptr;
+        const IndexRange* end_ = nullptr;
+        size_t index_ = 0;
+    };
+
+    IndexSet() = default;
+
+    /// @brief Create the set of every index below count
+    [[nodiscard]] static IndexSet all(size_t count);
+
+    /// @brief Create a set from indices in any order, duplicates allowed
+    [[nodiscard]] static IndexSet fromIndices(std::span<const size_t> indices);
+
+    [[nodiscard]] bool empty() const noexcept { return ranges_.empty(); }
+
+    /// @brief Get the number of indices (not ranges)
+    [[nodiscard]] size_t count() const noexcept { return count_; }
+
+    /// @brief Get the ranges, ascending
+    [[nodiscard]] const std::vector<IndexRange>& ranges() const noexcept { return ranges_; }
+
+    /// @brief Get the lowest index
+    [[nodiscard]] std::optional<size_t> first() const noexcept;
+
+    [[nodiscard]] bool contains(size_t index) const noexcept;
+
+    void clear() noexcept {
+        ranges_.clear();
+        count_ = 0;
+    }
+
+    void insert(size_t index) { insert(IndexRange{index, 1}); }
+    void insert(IndexRange range);
+
+    void erase(size_t index) { erase(IndexRange{index, 1}); }
+    void erase(IndexRange range);
+
+    void toggle(size_t index);
+
+    /// @brief Drop every index at or past size
+    void truncate(size_t size);
+
+    /// @brief Get the indices in this set that are not in other
+    [[nodiscard]] IndexSet difference(const IndexSet& other) const;
+
+    /// @brief Move the indices with their rows from one model to the next
+    /// @return Where the rows are now; removed rows are dropped
+    ///
+    /// Gives the same result as ModelDelta::map() on each index, range by range.
+    [[nodiscard]] IndexSet mapped(const ModelDelta& delta) const;
+
+    /// @brief Copy the indices into a vector
+    [[nodiscard]] std::vector<size_t> toVector() const;
+
+    [[nodiscard]] Iterator begin() const noexcept {
+        return {ranges_.data(), ranges_.data() + ranges_.size()};
+    }
+    [[nodiscard]] Iterator end() const noexcept {
+        const IndexRange* last = ranges_.data() + ranges_.size();
+        return {last, last};
+    }
+
+    [[nodiscard]] bool operator==(const IndexSet& other) const noexcept;
+
+private:
+    /// @brief Add a range past every range held, joining the last when adjacent
+    void append(IndexRange range);
+
+    std::vector<IndexRange> ranges_;
+    size_t count_ = 0;
+};
+
+}  // namespace nive::fs
@@ -0,0 +1,199 @@
+/// @file io_scheduler.cpp
+/// @brief Per-volume I/O scheduler implementation
+
+#include "io_scheduler.hpp"
+#include <Windows.h>
+
+#include <winioctl.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+#include "../util/win32_utils.hpp"
+
+namespace nive::fs {
+
+namespace {
+
+[[nodiscard]] bool is_separator(wchar_t c) noexcept {
+    return c == L'\\' || c == L'/';
+}
+
+/// @brief Ask a fixed drive whether it incurs a seek penalty
+[[nodiscard]] VolumeKind query_seek_penalty(const std::wstring& drive) {
+    // No access rights are needed for a storage property query
+    std::wstring device = L"\\\\.\\" + drive;
+    HandleGuard handle(CreateFileW(device.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                   OPEN_EXISTING, 0, nullptr));
+    if (!handle) {
+        return VolumeKind::Unknown;
+    }
+
+    STORAGE_PROPERTY_QUERY query{};
+    query.PropertyId = StorageDeviceSeekPenaltyProperty;
+    query.QueryType = PropertyStandardQuery;
+    DEVICE_SEEK_PENALTY_DESCRIPTOR penalty{};
+    DWORD returned = 0;
+    if (!DeviceIoControl(handle.get(), IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                         &penalty, sizeof(penalty), &returned, nullptr) ||
+        returned < sizeof(penalty)) {
+        return VolumeKind::Unknown;
+    }
+    return penalty.IncursSeekPenalty ? VolumeKind::Hdd : VolumeKind::Ssd;
+}
+
+}  // namespace
+
+std::wstring volumeName(const std::filesystem::path& path) {
+    const std::wstring& native = path.native();
+    if (native.size() >= 2 && is_separator(native[0]) && is_separator(native[1])) {
+        // \\server\share: everything up to the separator after the share
+        size_t server_end = native.find_first_of(L"\\/", 2);
+        size_t share_end = server_end == std::wstring::npos
+                               ? std::wstring::npos
+                               : native.find_first_of(L"\\/", server_end + 1);
+        return toLowercaseAscii(native.substr(0, share_end));
+    }
+    return toLowercaseAscii(path.root_name().native());
+}
+
+VolumeKind detectVolumeKind(const std::filesystem::path& path) {
+    std::wstring name = volumeName(path);
+    if (name.size() >= 2 && is_separator(name[0]) && is_separator(name[1])) {
+        return VolumeKind::Network;
+    }
+    if (name.size() != 2 || name[1] != L':') {
+        return VolumeKind::Unknown;
+    }
+
+    std::wstring root = name + L"\\";
+    switch (GetDriveTypeW(root.c_str())) {
+    case DRIVE_REMOTE:
+        return VolumeKind::Network;
+    case DRIVE_FIXED:
+        return query_seek_penalty(name);
+    case DRIVE_RAMDISK:
+        return VolumeKind::Ssd;
+    case DRIVE_REMOVABLE:
+    case DRIVE_CDROM:
+        return VolumeKind::Hdd;
+    default:
+        return VolumeKind::Unknown;
+    }
+}
+
+// ===== Slot =====
+
+IoScheduler::Slot::Slot(Slot&& other) noexcept
+    : owner_(std::exchange(other.owner_, nullptr)), volume_(std::exchange(other.volume_, nullptr)) {
+}
+
+IoScheduler::Slot& IoScheduler::Slot::operator=(Slot&& other) noexcept {
+    if (this != &other) {
+        release();
+        owner_ = std::exchange(other.owner_, nullptr);
+        volume_ = std::exchange(other.volume_, nullptr);
+    }
+    return *this;
+}
+
+void IoScheduler::Slot::release() noexcept {
+    if (owner_) {
+        owner_->release(*volume_);
+        owner_ = nullptr;
+        volume_ = nullptr;
+    }
+}
+
+// ===== IoScheduler =====
+
+IoScheduler::IoScheduler(IoSchedulerConfig config) : config_(config) {}
+
+IoScheduler& IoScheduler::instance() {
+    // Never destroyed: slots may still be released by threads stopping at exit
+    static auto* scheduler = new IoScheduler();
+    return *scheduler;
+}
+
+IoScheduler::Slot IoScheduler::acquire(const std::filesystem::path& path, IoPriority priority,
+                                       std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+    Volume& volume = volume_of(path, lock);
+
+    bool foreground = priority == IoPriority::Foreground;
+    if (foreground) {
+        ++volume.waiting_foreground;
+    }
+    bool ready = cv_.wait(lock, stop, [&volume, foreground] {
+        return volume.active < volume.slots && (foreground || volume.waiting_foreground == 0);
+    });
+    if (foreground) {
+        --volume.waiting_foreground;
+    }
+    if (!ready) {
+        // Background waiters may be able to go now
+        cv_.notify_all();
+        return {};
+    }
+    ++volume.active;
+    return Slot(this, &volume);
+}
+
+VolumeKind IoScheduler::volumeKind(const std::filesystem::path& path) {
+    std::unique_lock lock(mutex_);
+    return volume_of(path, lock).kind;
+}
+
+uint32_t IoScheduler::slotCount(const std::filesystem::path& path) {
+    std::unique_lock lock(mutex_);
+    return volume_of(path, lock).slots;
+}
+
+IoScheduler::Volume& IoScheduler::volume_of(const std::filesystem::path& path,
+                                            std::unique_lock<std::mutex>& lock) {
+    std::wstring name = volumeName(path);
+    if (auto it = volumes_.find(name); it != volumes_.end()) {
+        return it->second;
+    }
+
+    // The device query can block (e.g. a spun-down disk); do not hold up other volumes
+    lock.unlock();
+    VolumeKind kind = detectVolumeKind(path);
+    lock.lock();
+
+    auto [it, inserted] = volumes_.try_emplace(std::move(name));
+    if (inserted) {
+        it->second.kind = kind;
+        switch (kind) {
+        case VolumeKind::Ssd:
+            it->second.slots = config_.ssd_slots;
+            break;
+        case VolumeKind::Hdd:
+            it->second.slots = config_.hdd_slots;
+            break;
+        case VolumeKind::Network:
+            it->second.slots = config_.network_slots;
+            break;
+        case VolumeKind::Unknown:
+            it->second.slots = config_.unknown_slots;
+            break;
+        }
+        it->second.slots = std::max(it->second.slots, 1u);
+        LOG_INFO("I/O scheduler: volume {} is {}, {} concurrent reads",
+                 wideToUtf8OrEmpty(it->first), to_string(kind), it->second.slots);
+    }
+    // Elements of an unordered_map keep their address, so slots may point at them
+    return it->second;
+}
+
+void IoScheduler::release(Volume& volume) noexcept {
+    {
+        std::lock_guard lock(mutex_);
+        --volume.active;
+    }
+    cv_.notify_all();
+}
+
+}  // namespace nive::fs
@@ -0,0 +1,143 @@
+/// @file io_scheduler.hpp
+/// @brief Per-volume limits on concurrent file system I/O
+///
+/// Thumbnail reads, directory scans and cache maintenance all reach the
+/// same volumes. Each takes a slot for the volume it reads from, so a
+/// high-latency share gets a few deep reads instead of every thread
+/// queueing on it, while a local SSD still gets many reads in parallel.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace nive::fs {
+
+/// @brief Storage behind a volume, as far as it matters for I/O scheduling
+enum class VolumeKind {
+    Ssd,      // Local, no seek penalty
+    Hdd,      // Local with a seek penalty, or removable media
+    Network,  // SMB share or mapped network drive
+    Unknown,  // Could not be queried; scheduled like Hdd
+};
+
+[[nodiscard]] constexpr std::string_view to_string(VolumeKind kind) noexcept {
+    switch (kind) {
+    case VolumeKind::Ssd:
+        return "SSD";
+    case VolumeKind::Hdd:
+        return "HDD";
+    case VolumeKind::Network:
+        return "network";
+    case VolumeKind::Unknown:
+        return "unknown";
+    }
+    return "unknown";
+}
+
+/// @brief Name of the volume a path is on: "c:" or "\\server\share", lowercase
+[[nodiscard]] std::wstring volumeName(const std::filesystem::path& path);
+
+/// @brief Detect the kind of volume a path is on
+///
+/// UNC paths and DRIVE_REMOTE drives are Network. Fixed drives are asked
+/// for their seek penalty (IOCTL_STORAGE_QUERY_PROPERTY); removable and
+/// optical drives are Hdd. Not cached; IoScheduler caches per volume.
+[[nodiscard]] VolumeKind detectVolumeKind(const std::filesystem::path& path);
+
+/// @brief Scheduling class of an I/O request
+enum class IoPriority {
+    Foreground,  // The user is waiting (visible thumbnails, the open folder)
+    Background,  // Pregeneration, cache maintenance; waits while foreground work waits
+};
+
+/// @brief Concurrent I/O allowed per volume kind
+struct IoSchedulerConfig {
+    uint32_t ssd_slots = 8;
+    uint32_t hdd_slots = 2;      // More streams only make the head seek between them
+    uint32_t network_slots = 2;  // Few large reads keep an SMB connection busy
+    uint32_t unknown_slots = 2;
+};
+
+/// @brief Limits concurrent I/O per volume
+///
+/// Thread-safe. Each volume (drive letter or \\server\share) gets the slot
+/// count of its kind, detected on first use. A background request waits
+/// while a foreground request is waiting for the same volume.
+class IoScheduler {
+    struct Volume;
+
+public:
+    /// @brief A held slot, released on destruction
+    class Slot {
+    public:
+        Slot() = default;
+        ~Slot() { release(); }
+
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+        Slot(Slot&& other) noexcept;
+        Slot& operator=(Slot&& other) noexcept;
+
+        /// @brief Check if a slot is held (false if the wait was stopped)
+        [[nodiscard]] explicit operator bool() const noexcept { return owner_ != nullptr; }
+
+        /// @brief Release the slot early
+        void release() noexcept;
+
+    private:
+        friend class IoScheduler;
+        Slot(IoScheduler* owner, Volume* volume) noexcept : owner_(owner), volume_(volume) {}
+
+        IoScheduler* owner_ = nullptr;
+        Volume* volume_ = nullptr;
+    };
+
+    explicit IoScheduler(IoSchedulerConfig config = {});
+
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    /// @brief Get the process-wide scheduler
+    [[nodiscard]] static IoScheduler& instance();
+
+    /// @brief Wait for a slot on the volume of a path
+    /// @param path Any path on the volume to be read
+    /// @param priority Scheduling class
+    /// @param stop Stops the wait; the returned slot is then empty
+    /// @return Held slot, or an empty one if stop was requested
+    [[nodiscard]] Slot acquire(const std::filesystem::path& path,
+                               IoPriority priority = IoPriority::Foreground,
+                               std::stop_token stop = {});
+
+    /// @brief Get the (cached) kind of the volume a path is on
+    [[nodiscard]] VolumeKind volumeKind(const std::filesystem::path& path);
+
+    /// @brief Get the number of slots of the volume a path is on
+    [[nodiscard]] uint32_t slotCount(const std::filesystem::path& path);
+
+private:
+    struct Volume {
+        VolumeKind kind = VolumeKind::Unknown;
+        uint32_t slots = 0;
+        uint32_t active = 0;
+        uint32_t waiting_foreground = 0;
+    };
+
+    /// @brief Find or detect the volume of a path (mutex_ held; may unlock it)
+    Volume& volume_of(const std::filesystem::path& path, std::unique_lock<std::mutex>& lock);
+    void release(Volume& volume) noexcept;
+
+    IoSchedulerConfig config_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::unordered_map<std::wstring, Volume> volumes_;  // By lowercase volume name
+};
+
+}  // namespace nive::fs
@@ -0,0 +1,232 @@
+/// @file listing_snapshot.cpp
+/// @brief Directory listing snapshot encoding
+///
+/// Little-endian, fixed-width fields like archive listings: a header
+/// (magic, version, entry count), then per entry its type, Win32
+/// attributes, name and camera lengths in UTF-16 units, flags, size, times
+/// and file ID, followed by the name and camera model. Paths and
+/// extensions are derived on decode.
+
+#include "listing_snapshot.hpp"
+#include <Windows.h>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace nive::fs {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4C44564E;  // "NVDL"
+constexpr uint32_t kVersion = 1;
+
+// Entry flags
+constexpr uint32_t kEntryDateTaken = 1u << 0;
+
+template <typename T>
+void append(std::vector<uint8_t>& out, T value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void append(std::vector<uint8_t>& out, std::wstring_view text) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+    out.insert(out.end(), bytes, bytes + text.size() * sizeof(wchar_t));
+}
+
+/// @brief Bounds-checked reads from an encoded snapshot
+class Cursor {
+public:
+    explicit Cursor(std::span<const uint8_t> data) : data_(data) {}
+
+    template <typename T>
+    [[nodiscard]] bool read(T& value) {
+        if (data_.size() - offset_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+    [[nodiscard]] bool read(std::wstring& value, size_t length) {
+        if ((data_.size() - offset_) / sizeof(wchar_t) < length) {
+            return false;
+        }
+        value.resize(length);
+        std::memcpy(value.data(), data_.data() + offset_, length * sizeof(wchar_t));
+        offset_ += length * sizeof(wchar_t);
+        return true;
+    }
+
+    [[nodiscard]] size_t remaining() const noexcept { return data_.size() - offset_; }
+
+private:
+    std::span<const uint8_t> data_;
+    size_t offset_ = 0;
+};
+
+/// @brief Inverse of fileAttributesFromWin32
+[[nodiscard]] uint32_t attributes_to_win32(const FileAttributes& attributes) noexcept {
+    return (attributes.is_directory ? FILE_ATTRIBUTE_DIRECTORY : 0) |
+           (attributes.is_hidden ? FILE_ATTRIBUTE_HIDDEN : 0) |
+           (attributes.is_system ? FILE_ATTRIBUTE_SYSTEM : 0) |
+           (attributes.is_readonly ? FILE_ATTRIBUTE_READONLY : 0) |
+           (attributes.is_archive ? FILE_ATTRIBUTE_ARCHIVE : 0) |
+           (attributes.is_compressed ? FILE_ATTRIBUTE_COMPRESSED : 0) |
+           (attributes.is_encrypted ? FILE_ATTRIBUTE_ENCRYPTED : 0) |
+           (attributes.is_reparse_point ? FILE_ATTRIBUTE_REPARSE_POINT : 0);
+}
+
+[[nodiscard]] int64_t ticks_of(std::chrono::system_clock::time_point time) noexcept {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+[[nodiscard]] std::chrono::system_clock::time_point time_of(int64_t ticks) noexcept {
+    return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+}
+
+/// @brief Check if a fresh entry differs from its snapshot in what the views show
+[[nodiscard]] bool changed(const FileMetadata& before, const FileMetadata& after) noexcept {
+    return before.type != after.type || before.size_bytes != after.size_bytes ||
+           before.modified_time != after.modified_time ||
+           before.created_time != after.created_time ||
+           attributes_to_win32(before.attributes) != attributes_to_win32(after.attributes) ||
+           before.file_id != after.file_id;
+}
+
+}  // namespace
+
+std::optional<uint64_t> directoryWriteTime(const std::filesystem::path& path) {
+    WIN32_FILE_ATTRIBUTE_DATA attrs{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attrs) ||
+        (attrs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        return std::nullopt;
+    }
+    return (static_cast<uint64_t>(attrs.ftLastWriteTime.dwHighDateTime) << 32) |
+           attrs.ftLastWriteTime.dwLowDateTime;
+}
+
+uint32_t snapshotOptions(const DirectoryFilter& filter, SortOrder order) noexcept {
+    // Extension lists are not part of the key; listings filtered by them
+    // are not snapshotted
+    uint32_t flags = (filter.include_hidden ? 1u << 0 : 0) | (filter.include_system ? 1u << 1 : 0) |
+                     (filter.directories_only ? 1u << 2 : 0) | (filter.files_only ? 1u << 3 : 0) |
+                     (filter.images_only ? 1u << 4 : 0) | (filter.archives_only ? 1u << 5 : 0) |
+                     (filter.flatten ? 1u << 6 : 0);
+    return flags | (static_cast<uint32_t>(order) << 8);
+}
+
+std::vector<uint8_t> encodeSnapshot(std::span<const FileMetadata> entries) {
+    std::vector<uint8_t> out;
+    out.reserve(16 + entries.size() * 112);
+
+    append(out, kMagic);
+    append(out, kVersion);
+    append(out, static_cast<uint64_t>(entries.size()));
+
+    for (const auto& entry : entries) {
+        append(out, static_cast<uint32_t>(entry.type));
+        append(out, attributes_to_win32(entry.attributes));
+        append(out, static_cast<uint32_t>(entry.name.size()));
+        append(out, static_cast<uint32_t>(entry.camera_model.size()));
+        append(out, entry.date_taken ? kEntryDateTaken : 0u);
+        append(out, entry.size_bytes);
+        append(out, ticks_of(entry.created_time));
+        append(out, ticks_of(entry.modified_time));
+        append(out, ticks_of(entry.accessed_time));
+        append(out, entry.date_taken ? ticks_of(*entry.date_taken) : int64_t{0});
+        append(out, entry.file_id.volume);
+        append(out, entry.file_id.low);
+        append(out, entry.file_id.high);
+        append(out, std::wstring_view(entry.name));
+        append(out, std::wstring_view(entry.camera_model));
+    }
+    return out;
+}
+
+std::optional<std::vector<FileMetadata>> decodeSnapshot(std::span<const uint8_t> data,
+                                                        const std::filesystem::path& directory) {
+    Cursor cursor(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t count = 0;
+    if (!cursor.read(magic) || !cursor.read(version) || !cursor.read(count) ||
+        magic != kMagic || version != kVersion) {
+        return std::nullopt;
+    }
+
+    // Fixed part of an entry bounds the count a corrupt header can claim
+    constexpr size_t kEntryFixedSize = 5 * sizeof(uint32_t) + 8 * sizeof(uint64_t);
+    if (count > cursor.remaining() / kEntryFixedSize) {
+        return std::nullopt;
+    }
+    std::vector<FileMetadata> entries;
+    entries.reserve(static_cast<size_t>(count));
+
+    for (uint64_t i = 0; i < count; ++i) {
+        FileMetadata entry;
+        uint32_t type = 0;
+        uint32_t attributes = 0;
+        uint32_t name_length = 0;
+        uint32_t camera_length = 0;
+        uint32_t flags = 0;
+        int64_t created = 0;
+        int64_t modified = 0;
+        int64_t accessed = 0;
+        int64_t taken = 0;
+        if (!cursor.read(type) || !cursor.read(attributes) || !cursor.read(name_length) ||
+            !cursor.read(camera_length) || !cursor.read(flags) || !cursor.read(entry.size_bytes) ||
+            !cursor.read(created) || !cursor.read(modified) || !cursor.read(accessed) ||
+            !cursor.read(taken) || !cursor.read(entry.file_id.volume) ||
+            !cursor.read(entry.file_id.low) || !cursor.read(entry.file_id.high) ||
+            !cursor.read(entry.name, name_length) ||
+            !cursor.read(entry.camera_model, camera_length) || entry.name.empty() ||
+            type > static_cast<uint32_t>(FileType::Other)) {
+            return std::nullopt;
+        }
+        entry.path = directory / entry.name;
+        entry.extension = entry.path.extension().wstring();
+        entry.type = static_cast<FileType>(type);
+        entry.attributes = fileAttributesFromWin32(attributes);
+        entry.created_time = time_of(created);
+        entry.modified_time = time_of(modified);
+        entry.accessed_time = time_of(accessed);
+        if (flags & kEntryDateTaken) {
+            entry.date_taken = time_of(taken);
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+ListingDiff diffListings(std::span<const FileMetadata> snapshot,
+                         std::span<const FileMetadata> fresh) {
+    std::unordered_map<std::wstring_view, const FileMetadata*> before;
+    before.reserve(snapshot.size());
+    for (const auto& entry : snapshot) {
+        before.emplace(entry.name, &entry);
+    }
+
+    ListingDiff diff;
+    for (const auto& entry : fresh) {
+        auto it = before.find(entry.name);
+        if (it == before.end()) {
+            diff.upserted.push_back(entry);
+            continue;
+        }
+        if (changed(*it->second, entry)) {
+            diff.upserted.push_back(entry);
+        }
+        before.erase(it);
+    }
+    // What is left was not listed again
+    for (const auto& entry : snapshot) {
+        if (before.contains(entry.name)) {
+            diff.removed.push_back(entry.name);
+        }
+    }
+    return diff;
+}
+
+}  // namespace nive::fs
@@ -0,0 +1,61 @@
+/// @file listing_snapshot.hpp
+/// @brief Sorted directory listings persisted between visits
+///
+/// A revisit of a slow (network) folder shows the listing saved last time
+/// at once, while a fresh scan revalidates it in the background; what the
+/// scan finds different is then applied as a patch (see diffListings).
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "directory.hpp"
+#include "file_metadata.hpp"
+
+namespace nive::fs {
+
+/// @brief Entries of a sorted listing above which no snapshot is kept
+inline constexpr size_t kMaxSnapshotEntries = 100000;
+
+/// @brief Differences between a snapshot and a fresh listing of its directory
+struct ListingDiff {
+    std::vector<std::wstring> removed;   // Names no longer listed
+    std::vector<FileMetadata> upserted;  // New entries, and entries that changed
+
+    [[nodiscard]] bool empty() const noexcept { return removed.empty() && upserted.empty(); }
+};
+
+/// @brief Get a directory's last write time, which moves when entries come or go
+/// @return FILETIME ticks, or nullopt if the directory cannot be queried
+[[nodiscard]] std::optional<uint64_t> directoryWriteTime(const std::filesystem::path& path);
+
+/// @brief Key the filter and order a listing was made with
+///
+/// A snapshot is only shown for the same key: another sort order or filter
+/// lists other entries, or the same ones in another order.
+[[nodiscard]] uint32_t snapshotOptions(const DirectoryFilter& filter, SortOrder order) noexcept;
+
+/// @brief Encode the entries of a listing, in their order
+[[nodiscard]] std::vector<uint8_t> encodeSnapshot(std::span<const FileMetadata> entries);
+
+/// @brief Decode entries written by encodeSnapshot
+/// @param data Encoded snapshot
+/// @param directory Directory the entries belong to (not stored)
+/// @return Entries in their stored order, or nullopt if data is malformed
+///         or from another format version
+[[nodiscard]] std::optional<std::vector<FileMetadata>>
+decodeSnapshot(std::span<const uint8_t> data, const std::filesystem::path& directory);
+
+/// @brief Find what changed between a snapshot and a fresh listing
+///
+/// Entries are matched by name. A matched entry is upserted when its type,
+/// size, times, attributes or file ID differ; capture info is not compared.
+[[nodiscard]] ListingDiff diffListings(std::span<const FileMetadata> snapshot,
+                                       std::span<const FileMetadata> fresh);
+
+}  // namespace nive::fs
@@ -3,6 +3,8 @@
 
 #include "natural_sort.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <cwctype>
 
 namespace nive::fs {
@@ -55,8 +57,55 @@ struct NumberInfo {
     return info;
 }
 
+// Sort key token tags. A digit run sorts before any character, as in
+// naturalCompare; ASCII characters are stored as themselves plus an offset
+// that keeps them above the digit tag and below the wide-character tag.
+constexpr uint8_t kKeyNumber = 0x01;
+constexpr uint8_t kKeyAsciiOffset = 0x02;
+constexpr uint8_t kKeyWide = 0xFF;
+
 }  // namespace
 
+std::string naturalSortKey(std::wstring_view str) {
+    std::string key;
+    key.reserve(str.size() + 8);
+
+    size_t i = 0;
+    while (i < str.size()) {
+        wchar_t c = str[i];
+        if (!is_digit(c)) {
+            wchar_t lower = to_lower(c);
+            if (lower < 0x80) {
+                key.push_back(static_cast<char>(lower + kKeyAsciiOffset));
+            } else {
+                key.push_back(static_cast<char>(kKeyWide));
+                key.push_back(static_cast<char>((lower >> 8) & 0xFF));
+                key.push_back(static_cast<char>(lower & 0xFF));
+            }
+            ++i;
+            continue;
+        }
+
+        // Tag, significant byte count, value big-endian, then leading zeros:
+        // fewer bytes is a smaller value, and equal values order by zeros
+        auto number = parse_number(str, i);
+        int bytes = 0;
+        for (uint64_t v = number.value; v != 0; v >>= 8) {
+            ++bytes;
+        }
+        key.push_back(static_cast<char>(kKeyNumber));
+        key.push_back(static_cast<char>(bytes));
+        for (int b = bytes - 1; b >= 0; --b) {
+            key.push_back(static_cast<char>((number.value >> (b * 8)) & 0xFF));
+        }
+        auto zeros = static_cast<uint16_t>(std::min<size_t>(number.leading_zeros, 0xFFFF));
+        key.push_back(static_cast<char>(zeros >> 8));
+        key.push_back(static_cast<char>(zeros & 0xFF));
+        i += number.length;
+    }
+    return key;
+}
+
 int naturalCompare(std::wstring_view a, std::wstring_view b) noexcept {
     size_t i = 0;
     size_t j = 0;
@@ -19,6 +19,16 @@ namespace nive::fs {
 /// Case-insensitive comparison that treats embedded numbers as numeric values.
 [[nodiscard]] int naturalCompare(std::wstring_view a, std::wstring_view b) noexcept;
 
+/// @brief Build a collation key that orders like naturalCompare
+/// @param str String to tokenize
+/// @return Key whose byte-wise comparison (std::string's operator<, which
+///         compares as memcmp does) matches naturalCompare(a, b)
+///
+/// Tokenizes once, so sorting many names compares keys instead of
+/// re-parsing digit runs on every comparison. ASCII characters take one
+/// byte, other characters three, and a digit run at most eleven.
+[[nodiscard]] std::string naturalSortKey(std::wstring_view str);
+
 /// @brief Comparator for natural sorting
 ///
 /// Use with std::sort:
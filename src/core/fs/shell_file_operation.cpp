@@ -45,9 +45,12 @@ IFACEMETHODIMP_(ULONG) FileOperationSink::Release() {
 // ============================================================================
 
 IFACEMETHODIMP FileOperationSink::PostRenameItem(DWORD, IShellItem* item, LPCWSTR,
-                                                  HRESULT hr_result, IShellItem*) {
+                                                  HRESULT hr_result, IShellItem* new_item) {
     if (SUCCEEDED(hr_result)) {
         ++success_count_;
+        if (moved_ && new_item) {
+            moved_(pathFromItem(item), pathFromItem(new_item));
+        }
     } else {
         failed_files_.push_back(pathFromItem(item));
     }
@@ -55,9 +58,12 @@ IFACEMETHODIMP FileOperationSink::PostRenameItem(DWORD, IShellItem* item, LPCWST
 }
 
 IFACEMETHODIMP FileOperationSink::PostMoveItem(DWORD, IShellItem* item, IShellItem*, LPCWSTR,
-                                                HRESULT hr_result, IShellItem*) {
+                                                HRESULT hr_result, IShellItem* new_item) {
     if (SUCCEEDED(hr_result)) {
         ++success_count_;
+        if (moved_ && new_item) {
+            moved_(pathFromItem(item), pathFromItem(new_item));
+        }
     } else {
         failed_files_.push_back(pathFromItem(item));
     }
@@ -84,6 +90,14 @@ IFACEMETHODIMP FileOperationSink::PostDeleteItem(DWORD, IShellItem* item, HRESUL
     return S_OK;
 }
 
+IFACEMETHODIMP FileOperationSink::UpdateProgress(UINT work_total, UINT work_so_far) {
+    // A failure result makes IFileOperation abort the remaining items
+    if (progress_ && !progress_(work_so_far, work_total)) {
+        return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    }
+    return S_OK;
+}
+
 // ============================================================================
 // FileOperationSink - Result building
 // ============================================================================
@@ -218,20 +232,29 @@ namespace {
         return result;
     }
 
-    auto* sink = new FileOperationSink();
+    auto* sink = new FileOperationSink(options.progress, options.moved);
     DWORD cookie = 0;
     op->Advise(sink, &cookie);
 
+    std::vector<std::filesystem::path> unparsed;  // Gone or unreachable before the operation
     for (const auto& path : paths) {
         ComPtr<IShellItem> item;
         hr = createShellItem(path, item);
         if (FAILED(hr)) {
+            unparsed.push_back(path);
             continue;
         }
         op->DeleteItem(item.Get(), nullptr);
     }
 
     auto result = executeAndCollect(op, sink);
+    if (!unparsed.empty()) {
+        result.failed_files.insert(result.failed_files.end(), unparsed.begin(), unparsed.end());
+        if (result.error != FileOperationError::Cancelled) {
+            result.error = result.files_processed > 0 ? FileOperationError::PartialSuccess
+                                                      : FileOperationError::IoError;
+        }
+    }
 
     op->Unadvise(cookie);
     sink->Release();
@@ -259,7 +282,7 @@ FileOperationResult ShellFileOperation::copyItems(std::span<const ResolvedFileIt
         return result;
     }
 
-    auto* sink = new FileOperationSink();
+    auto* sink = new FileOperationSink(options.progress, options.moved);
     DWORD cookie = 0;
     op->Advise(sink, &cookie);
 
@@ -302,7 +325,7 @@ FileOperationResult ShellFileOperation::moveItems(std::span<const ResolvedFileIt
         return result;
     }
 
-    auto* sink = new FileOperationSink();
+    auto* sink = new FileOperationSink(options.progress, options.moved);
     DWORD cookie = 0;
     op->Advise(sink, &cookie);
 
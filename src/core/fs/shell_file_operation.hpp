@@ -8,6 +8,7 @@
 #include <shobjidl_core.h>
 
 #include <filesystem>
+#include <functional>
 #include <optional>
 #include <span>
 #include <string>
@@ -25,17 +26,31 @@ struct ResolvedFileItem {
     std::optional<std::wstring> dest_name;  // Renamed filename, nullopt = keep original
 };
 
+/// @brief Progress of a shell operation
+/// @param done Work done, in the shell's own units
+/// @param total Total work in the same units
+/// @return false to cancel the operation
+using ShellProgressCallback = std::function<bool(uint64_t done, uint64_t total)>;
+
+/// @brief Called for each item moved or renamed, with its old and new path
+using ShellMovedCallback =
+    std::function<void(const std::filesystem::path& from, const std::filesystem::path& to)>;
+
 /// @brief Options for shell file operations
 struct ShellOperationOptions {
     HWND owner_window = nullptr;
     bool allow_undo = false;
-    bool no_ui = false;  // Suppress all UI including progress dialog
+    bool no_ui = false;              // Suppress all UI including progress dialog
+    ShellProgressCallback progress;  // Called on the operating thread (optional)
+    ShellMovedCallback moved;        // Called on the operating thread (optional)
 };
 
 /// @brief IFileOperationProgressSink implementation that tracks per-item results
 class FileOperationSink : public IFileOperationProgressSink {
 public:
-    FileOperationSink() = default;
+    explicit FileOperationSink(ShellProgressCallback progress = nullptr,
+                               ShellMovedCallback moved = nullptr)
+        : progress_(std::move(progress)), moved_(std::move(moved)) {}
     virtual ~FileOperationSink() = default;
 
     // IUnknown
@@ -64,8 +79,8 @@ public:
         return S_OK;
     }
 
-    // IFileOperationProgressSink - progress updates (no-ops)
-    IFACEMETHODIMP UpdateProgress(UINT, UINT) override { return S_OK; }
+    // IFileOperationProgressSink - progress updates
+    IFACEMETHODIMP UpdateProgress(UINT work_total, UINT work_so_far) override;
     IFACEMETHODIMP ResetTimer() override { return S_OK; }
     IFACEMETHODIMP PauseTimer() override { return S_OK; }
     IFACEMETHODIMP ResumeTimer() override { return S_OK; }
@@ -77,6 +92,8 @@ private:
     /// @brief Extract filesystem path from IShellItem
     static std::filesystem::path pathFromItem(IShellItem* item);
 
+    ShellProgressCallback progress_;
+    ShellMovedCallback moved_;
     LONG ref_count_ = 1;
     uint64_t success_count_ = 0;
     std::vector<std::filesystem::path> failed_files_;
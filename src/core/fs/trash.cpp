@@ -10,6 +10,9 @@
 
 #include <shellapi.h>
 
+#include "../util/win32_utils.hpp"
+#include "shell_file_operation.hpp"
+
 namespace nive::fs {
 
 namespace {
@@ -53,58 +56,45 @@ namespace {
     }
 }
 
-}  // namespace
-
-std::expected<void, TrashError> trashFile(const std::filesystem::path& path,
-                                          const TrashOptions& options) {
-    if (!std::filesystem::exists(path)) {
-        return std::unexpected(TrashError::NotFound);
-    }
-
-    // Build double-null terminated path
-    std::wstring file_list = path.wstring() + L'\0' + L'\0';
-
-    SHFILEOPSTRUCTW file_op = {};
-    file_op.hwnd = nullptr;
-    file_op.wFunc = FO_DELETE;
-    file_op.pFrom = file_list.c_str();
-    file_op.pTo = nullptr;
-    file_op.fFlags = 0;
-
-    if (options.allow_undo) {
-        file_op.fFlags |= FOF_ALLOWUNDO;
-    }
-    if (!options.show_confirmation) {
-        file_op.fFlags |= FOF_NOCONFIRMATION;
-    }
-    if (!options.show_progress || options.silent) {
-        file_op.fFlags |= FOF_SILENT;
-    }
-    if (options.silent) {
-        file_op.fFlags |= FOF_NOERRORUI;
+/// @brief Delete files in one IFileOperation transaction, with a result per file
+[[nodiscard]] TrashResult delete_batch(std::span<const std::filesystem::path> paths,
+                                       const TrashOptions& options, bool recycle) {
+    TrashResult result;
+    if (paths.empty()) {
+        return result;
     }
 
-    int result = SHFileOperationW(&file_op);
-
-    if (result != 0) {
-        return std::unexpected(shfile_error_to_trash_error(result));
-    }
+    ComInitializer com(COINIT_APARTMENTTHREADED);
+    ShellOperationOptions shell_options{
+        .allow_undo = recycle,
+        .no_ui = options.silent || !options.show_progress,
+    };
+    auto op_result = recycle ? ShellFileOperation::recycleItems(paths, shell_options)
+                             : ShellFileOperation::deleteItems(paths, shell_options);
 
-    if (file_op.fAnyOperationsAborted) {
-        return std::unexpected(TrashError::Cancelled);
+    result.files_trashed = op_result.files_processed;
+    result.failed_files = std::move(op_result.failed_files);
+    if (op_result.error == FileOperationError::Cancelled) {
+        result.error = TrashError::Cancelled;
+    } else if (op_result.error == FileOperationError::NotFound) {
+        result.error = TrashError::NotFound;
+    } else if (op_result.error == FileOperationError::AccessDenied) {
+        result.error = TrashError::AccessDenied;
+    } else if (op_result.error) {
+        result.error = TrashError::IoError;
     }
-
-    return {};
+    return result;
 }
 
-TrashResult trashFiles(std::span<const std::filesystem::path> paths, const TrashOptions& options) {
+/// @brief Delete files with one SHFileOperation, which can ask for confirmation
+[[nodiscard]] TrashResult delete_with_prompt(std::span<const std::filesystem::path> paths,
+                                             const TrashOptions& options, bool recycle) {
     TrashResult result;
 
     if (paths.empty()) {
         return result;
     }
 
-    // Build file list
     std::wstring file_list = build_file_list(paths);
 
     SHFILEOPSTRUCTW file_op = {};
@@ -112,14 +102,11 @@ TrashResult trashFiles(std::span<const std::filesystem::path> paths, const Trash
     file_op.wFunc = FO_DELETE;
     file_op.pFrom = file_list.c_str();
     file_op.pTo = nullptr;
-    file_op.fFlags = 0;
+    file_op.fFlags = FOF_NOCONFIRMMKDIR;
 
-    if (options.allow_undo) {
+    if (recycle) {
         file_op.fFlags |= FOF_ALLOWUNDO;
     }
-    if (!options.show_confirmation) {
-        file_op.fFlags |= FOF_NOCONFIRMATION;
-    }
     if (!options.show_progress || options.silent) {
         file_op.fFlags |= FOF_SILENT;
     }
@@ -127,9 +114,6 @@ TrashResult trashFiles(std::span<const std::filesystem::path> paths, const Trash
         file_op.fFlags |= FOF_NOERRORUI;
     }
 
-    // Allow partial success
-    file_op.fFlags |= FOF_NOCONFIRMMKDIR;
-
     int op_result = SHFileOperationW(&file_op);
 
     if (op_result != 0) {
@@ -146,17 +130,19 @@ TrashResult trashFiles(std::span<const std::filesystem::path> paths, const Trash
         return result;
     }
 
-    // Success - all files trashed
     result.files_trashed = paths.size();
     return result;
 }
 
-std::expected<void, TrashError> permanentDelete(const std::filesystem::path& path,
-                                                const TrashOptions& options) {
+}  // namespace
+
+std::expected<void, TrashError> trashFile(const std::filesystem::path& path,
+                                          const TrashOptions& options) {
     if (!std::filesystem::exists(path)) {
         return std::unexpected(TrashError::NotFound);
     }
 
+    // Build double-null terminated path
     std::wstring file_list = path.wstring() + L'\0' + L'\0';
 
     SHFILEOPSTRUCTW file_op = {};
@@ -166,7 +152,9 @@ std::expected<void, TrashError> permanentDelete(const std::filesystem::path& pat
     file_op.pTo = nullptr;
     file_op.fFlags = 0;
 
-    // No FOF_ALLOWUNDO = permanent delete
+    if (options.allow_undo) {
+        file_op.fFlags |= FOF_ALLOWUNDO;
+    }
     if (!options.show_confirmation) {
         file_op.fFlags |= FOF_NOCONFIRMATION;
     }
@@ -190,15 +178,21 @@ std::expected<void, TrashError> permanentDelete(const std::filesystem::path& pat
     return {};
 }
 
-TrashResult permanentDeleteFiles(std::span<const std::filesystem::path> paths,
-                                 const TrashOptions& options) {
-    TrashResult result;
+TrashResult trashFiles(std::span<const std::filesystem::path> paths, const TrashOptions& options) {
+    if (options.show_confirmation) {
+        // IFileOperation is always confirmed by the caller; keep the shell's prompt here
+        return delete_with_prompt(paths, options, options.allow_undo);
+    }
+    return delete_batch(paths, options, options.allow_undo);
+}
 
-    if (paths.empty()) {
-        return result;
+std::expected<void, TrashError> permanentDelete(const std::filesystem::path& path,
+                                                const TrashOptions& options) {
+    if (!std::filesystem::exists(path)) {
+        return std::unexpected(TrashError::NotFound);
     }
 
-    std::wstring file_list = build_file_list(paths);
+    std::wstring file_list = path.wstring() + L'\0' + L'\0';
 
     SHFILEOPSTRUCTW file_op = {};
     file_op.hwnd = nullptr;
@@ -218,23 +212,25 @@ TrashResult permanentDeleteFiles(std::span<const std::filesystem::path> paths,
         file_op.fFlags |= FOF_NOERRORUI;
     }
 
-    int op_result = SHFileOperationW(&file_op);
+    int result = SHFileOperationW(&file_op);
 
-    if (op_result != 0) {
-        result.error = shfile_error_to_trash_error(op_result);
-        for (const auto& path : paths) {
-            result.failed_files.push_back(path);
-        }
-        return result;
+    if (result != 0) {
+        return std::unexpected(shfile_error_to_trash_error(result));
     }
 
     if (file_op.fAnyOperationsAborted) {
-        result.error = TrashError::Cancelled;
-        return result;
+        return std::unexpected(TrashError::Cancelled);
     }
 
-    result.files_trashed = paths.size();
-    return result;
+    return {};
+}
+
+TrashResult permanentDeleteFiles(std::span<const std::filesystem::path> paths,
+                                 const TrashOptions& options) {
+    if (options.show_confirmation) {
+        return delete_with_prompt(paths, options, false);
+    }
+    return delete_batch(paths, options, false);
 }
 
 std::expected<void, TrashError> emptyRecycleBin(const std::wstring& drive_letter,
@@ -63,6 +63,10 @@ struct TrashResult {
                                                         const TrashOptions& options = {});
 
 /// @brief Move multiple files to recycle bin
+///
+/// All files go through one IFileOperation transaction, so a large selection
+/// costs one round of shell and recycle bin bookkeeping, and failures are
+/// reported per file. show_confirmation falls back to SHFileOperation.
 /// @param paths File paths
 /// @param options Trash options
 /// @return Operation result
@@ -76,7 +80,7 @@ struct TrashResult {
 [[nodiscard]] std::expected<void, TrashError> permanentDelete(const std::filesystem::path& path,
                                                               const TrashOptions& options = {});
 
-/// @brief Permanently delete multiple files
+/// @brief Permanently delete multiple files in one transaction, as trashFiles()
 /// @param paths File paths
 /// @param options Options
 /// @return Operation result
@@ -7,12 +7,26 @@
 
 #include <icu.h>
 
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace nive::i18n {
 
 namespace {
 
+// Compiled formats kept per thread; past this many the cache starts over
+constexpr size_t kMaxCompiledFormats = 128;
+
+// Formatted messages are mostly short; longer ones are formatted twice
+constexpr size_t kInitialResultLength = 128;
+
+struct FormatCloser {
+    void operator()(UMessageFormat* fmt) const noexcept { umsg_close(fmt); }
+};
+using FormatPtr = std::unique_ptr<UMessageFormat, FormatCloser>;
+
 // Convert UTF-8 to UChar (char16_t, compatible with wchar_t on Windows)
 std::vector<UChar> toUChar(std::string_view utf8) {
     if (utf8.empty()) {
@@ -45,69 +59,101 @@ std::wstring toWide(std::string_view utf8) {
     return result;
 }
 
-}  // namespace
+/// @brief Get the compiled format of a pattern, compiling it on first use
+/// @return Format, or nullptr if the pattern does not compile (remembered too)
+///
+/// Cached per thread, as a UMessageFormat must not be used by two threads
+/// at once, and keyed by locale and pattern text, so a locale switch or a
+/// reloaded catalogue finds its own entries.
+UMessageFormat* compiled_format(std::string_view pattern, std::string_view locale) {
+    thread_local std::unordered_map<std::string, FormatPtr> formats;
+
+    std::string key;
+    key.reserve(locale.size() + 1 + pattern.size());
+    key.append(locale);
+    key.push_back('\0');
+    key.append(pattern);
+    if (auto it = formats.find(key); it != formats.end()) {
+        return it->second.get();
+    }
 
-std::wstring icuFormat(std::string_view pattern, std::string_view locale,
-                       std::initializer_list<std::pair<std::string, int64_t>> args) {
-    // Convert pattern to UChar
+    if (formats.size() >= kMaxCompiledFormats) {
+        formats.clear();
+    }
+    FormatPtr fmt;
     auto u_pattern = toUChar(pattern);
-    if (u_pattern.empty()) {
-        return toWide(pattern);
+    if (!u_pattern.empty()) {
+        UErrorCode status = U_ZERO_ERROR;
+        std::string locale_str(locale);
+        fmt.reset(umsg_open(u_pattern.data(), static_cast<int32_t>(u_pattern.size()),
+                            locale_str.c_str(), nullptr, &status));
+        if (U_FAILURE(status)) {
+            fmt.reset();
+        }
     }
+    return formats.emplace(std::move(key), std::move(fmt)).first->second.get();
+}
 
-    // Open the message format
+/// @brief Format into a string, growing it once if the message does not fit
+/// @return false on failure
+template <typename... Args>
+bool format_into(UMessageFormat* fmt, std::wstring& out, Args... args) {
+    static_assert(sizeof(UChar) == sizeof(wchar_t), "UChar must be same size as wchar_t");
     UErrorCode status = U_ZERO_ERROR;
-    std::string locale_str(locale);
-    UMessageFormat* fmt =
-        umsg_open(u_pattern.data(), static_cast<int32_t>(u_pattern.size()),
-                  locale_str.c_str(), nullptr, &status);
-    if (U_FAILURE(status) || !fmt) {
+    int32_t length = umsg_format(fmt, reinterpret_cast<UChar*>(out.data()),
+                                 static_cast<int32_t>(out.size()), &status, args...);
+    if (status == U_BUFFER_OVERFLOW_ERROR && length > 0) {
+        out.resize(static_cast<size_t>(length));
+        status = U_ZERO_ERROR;
+        length = umsg_format(fmt, reinterpret_cast<UChar*>(out.data()),
+                             static_cast<int32_t>(out.size()), &status, args...);
+    }
+    if (U_FAILURE(status) || length <= 0) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(length));
+    return true;
+}
+
+}  // namespace
+
+std::wstring icuFormat(std::string_view pattern, std::string_view locale,
+                       std::initializer_list<std::pair<std::string, int64_t>> args) {
+    UMessageFormat* fmt = compiled_format(pattern, locale);
+    if (!fmt) {
         return toWide(pattern);
     }
 
-    // Build argument arrays.
     // ICU umsg_format uses positional args (arg0, arg1, ...).
     // For named patterns like "{count, plural, ...}", the argument names in the pattern
     // map to positional indices in order of first appearance.
     // Since our patterns typically use a single named arg, we pass all values positionally.
-    std::vector<int64_t> arg_values;
+    std::vector<double> values;
+    values.reserve(args.size());
     for (const auto& [name, value] : args) {
-        arg_values.push_back(value);
+        values.push_back(static_cast<double>(value));
     }
 
-    // Format the message
-    // umsg_format is variadic; for simplicity with dynamic args, use a fixed buffer approach
-    UChar result_buf[1024] = {};
-    int32_t result_len = 0;
-    status = U_ZERO_ERROR;
-
-    // Use umsg_vformat with argument list based on number of args
-    if (arg_values.empty()) {
-        result_len = umsg_format(fmt, result_buf, 1024, &status);
-    } else if (arg_values.size() == 1) {
-        result_len =
-            umsg_format(fmt, result_buf, 1024, &status, static_cast<double>(arg_values[0]));
-    } else if (arg_values.size() == 2) {
-        result_len = umsg_format(fmt, result_buf, 1024, &status,
-                                 static_cast<double>(arg_values[0]),
-                                 static_cast<double>(arg_values[1]));
-    } else if (arg_values.size() == 3) {
-        result_len = umsg_format(fmt, result_buf, 1024, &status,
-                                 static_cast<double>(arg_values[0]),
-                                 static_cast<double>(arg_values[1]),
-                                 static_cast<double>(arg_values[2]));
+    // umsg_format is variadic, so each argument count is its own call
+    std::wstring result(kInitialResultLength, L'\0');
+    bool formatted = false;
+    switch (values.size()) {
+    case 0:
+        formatted = format_into(fmt, result);
+        break;
+    case 1:
+        formatted = format_into(fmt, result, values[0]);
+        break;
+    case 2:
+        formatted = format_into(fmt, result, values[0], values[1]);
+        break;
+    case 3:
+        formatted = format_into(fmt, result, values[0], values[1], values[2]);
+        break;
+    default:
+        break;
     }
-
-    umsg_close(fmt);
-
-    if (U_FAILURE(status) || result_len <= 0) {
-        return toWide(pattern);
-    }
-
-    // UChar -> wstring (both are 16-bit UTF-16 on Windows)
-    static_assert(sizeof(UChar) == sizeof(wchar_t), "UChar must be same size as wchar_t");
-    return std::wstring(reinterpret_cast<const wchar_t*>(result_buf),
-                        static_cast<size_t>(result_len));
+    return formatted ? result : toWide(pattern);
 }
 
 }  // namespace nive::i18n
@@ -13,7 +13,9 @@ namespace nive::i18n {
 /// @brief Format a message using ICU MessageFormat syntax.
 ///
 /// Uses Windows built-in ICU C API (umsg_open / umsg_format / umsg_close).
-/// Supports plural rules, select, and other ICU patterns.
+/// Supports plural rules, select, and other ICU patterns. Each thread
+/// compiles a pattern once per locale and reuses the UMessageFormat for
+/// later calls.
 ///
 /// @param pattern UTF-8 ICU MessageFormat pattern (e.g. "{count, plural, one {# file} other {# files}}")
 /// @param locale ICU locale string (e.g. "en")
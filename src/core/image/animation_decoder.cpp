@@ -0,0 +1,384 @@
+/// @file animation_decoder.cpp
+/// @brief Animation frame compositing over WIC
+
+#include "animation_decoder.hpp"
+#include <Windows.h>
+
+#include <wincodec.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "../util/com_ptr.hpp"
+#include "wic_factory.hpp"
+
+namespace nive::image {
+
+namespace {
+
+// Browsers stretch GIF delays under 20 ms to 100 ms, and enough files rely
+// on that for faster playback to look broken
+constexpr std::chrono::milliseconds kMinDelay{20};
+constexpr std::chrono::milliseconds kDefaultDelay{100};
+
+/// @brief What happens to a GIF frame's rectangle before the next frame is drawn
+enum class Disposal {
+    Keep,
+    Background,  // Cleared to transparent
+    Previous,    // Restored to what was there before the frame
+};
+
+DecodeError open_error(HRESULT hr) {
+    switch (hr) {
+    case HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND):
+    case HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND):
+        return DecodeError::FileNotFound;
+    case HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED):
+        return DecodeError::AccessDenied;
+    case WINCODEC_ERR_COMPONENTNOTFOUND:
+    case WINCODEC_ERR_UNKNOWNIMAGEFORMAT:
+        return DecodeError::UnsupportedFormat;
+    case E_OUTOFMEMORY:
+        return DecodeError::OutOfMemory;
+    default:
+        return DecodeError::CorruptedData;
+    }
+}
+
+/// @brief Read an unsigned integer metadata item
+uint32_t read_uint(IWICMetadataQueryReader* reader, const wchar_t* name, uint32_t fallback) {
+    if (!reader) {
+        return fallback;
+    }
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    uint32_t result = fallback;
+    if (SUCCEEDED(reader->GetMetadataByName(name, &value))) {
+        switch (value.vt) {
+        case VT_UI1:
+            result = value.bVal;
+            break;
+        case VT_UI2:
+            result = value.uiVal;
+            break;
+        case VT_UI4:
+            result = value.ulVal;
+            break;
+        default:
+            break;
+        }
+    }
+    PropVariantClear(&value);
+    return result;
+}
+
+/// @brief Read a byte-vector metadata item
+std::vector<uint8_t> read_bytes(IWICMetadataQueryReader* reader, const wchar_t* name) {
+    std::vector<uint8_t> result;
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    if (SUCCEEDED(reader->GetMetadataByName(name, &value)) && value.vt == (VT_UI1 | VT_VECTOR)) {
+        result.assign(value.caub.pElems, value.caub.pElems + value.caub.cElems);
+    }
+    PropVariantClear(&value);
+    return result;
+}
+
+/// @brief Number of plays from the NETSCAPE2.0 looping extension (1 without one)
+uint32_t read_play_count(IWICMetadataQueryReader* reader) {
+    if (!reader) {
+        return 1;
+    }
+    auto application = read_bytes(reader, L"/appext/Application");
+    if (application.size() != 11 || (std::memcmp(application.data(), "NETSCAPE2.0", 11) != 0 &&
+                                     std::memcmp(application.data(), "ANIMEXTS1.0", 11) != 0)) {
+        return 1;
+    }
+    // Sub-block: size (3), id (1), repeat count (little-endian)
+    auto data = read_bytes(reader, L"/appext/Data");
+    if (data.size() < 4 || data[0] < 3 || data[1] != 1) {
+        return 1;
+    }
+    uint32_t repeats = data[2] | (static_cast<uint32_t>(data[3]) << 8);
+    return repeats == 0 ? 0 : repeats + 1;
+}
+
+}  // namespace
+
+/// @brief Animation decoder implementation
+class AnimationDecoder::Impl {
+public:
+    [[nodiscard]] std::expected<void, DecodeError> openFile(const std::filesystem::path& path) {
+        factory_ = wicFactory();
+        if (!factory_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+        HRESULT hr = factory_->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                         WICDecodeMetadataCacheOnDemand, &decoder_);
+        if (FAILED(hr)) {
+            return std::unexpected(open_error(hr));
+        }
+        return init();
+    }
+
+    [[nodiscard]] std::expected<void, DecodeError> openMemory(std::vector<uint8_t> data) {
+        factory_ = wicFactory();
+        if (!factory_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+        if (data.empty() || data.size() > std::numeric_limits<DWORD>::max()) {
+            return std::unexpected(DecodeError::UnsupportedFormat);
+        }
+        data_ = std::move(data);
+
+        HRESULT hr = factory_->CreateStream(&stream_);
+        if (SUCCEEDED(hr)) {
+            hr = stream_->InitializeFromMemory(data_.data(), static_cast<DWORD>(data_.size()));
+        }
+        if (SUCCEEDED(hr)) {
+            hr = factory_->CreateDecoderFromStream(stream_.Get(), nullptr,
+                                                   WICDecodeMetadataCacheOnDemand, &decoder_);
+        }
+        if (FAILED(hr)) {
+            return std::unexpected(open_error(hr));
+        }
+        return init();
+    }
+
+    [[nodiscard]] uint32_t width() const noexcept { return width_; }
+    [[nodiscard]] uint32_t height() const noexcept { return height_; }
+    [[nodiscard]] uint32_t frameCount() const noexcept { return frame_count_; }
+    [[nodiscard]] uint32_t playCount() const noexcept { return play_count_; }
+
+    [[nodiscard]] std::expected<AnimationFrame, DecodeError> next() {
+        uint32_t index = next_index_;
+        if (index == 0) {
+            // Start over from an empty canvas
+            canvas_ = DecodedImage(width_, height_, PixelFormat::BGRA32);
+            std::memset(canvas_.data(), 0, canvas_.sizeBytes());
+            pending_disposal_ = Disposal::Keep;
+        }
+        dispose_previous();
+
+        ComPtr<IWICBitmapFrameDecode> frame;
+        HRESULT hr = decoder_->GetFrame(index, &frame);
+        if (FAILED(hr)) {
+            return std::unexpected(open_error(hr));
+        }
+
+        ComPtr<IWICMetadataQueryReader> metadata;
+        if (gif_) {
+            frame->GetMetadataQueryReader(&metadata);
+        }
+        auto delay = std::chrono::milliseconds(
+            metadata ? read_uint(metadata.Get(), L"/grctlext/Delay", 0) * 10 : 0);
+        if (delay < kMinDelay) {
+            delay = kDefaultDelay;
+        }
+
+        ComPtr<IWICFormatConverter> converter;
+        hr = factory_->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr)) {
+            hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA,
+                                       WICBitmapDitherTypeNone, nullptr, 0.0,
+                                       WICBitmapPaletteTypeCustom);
+        }
+        UINT frame_width = 0, frame_height = 0;
+        if (SUCCEEDED(hr)) {
+            hr = converter->GetSize(&frame_width, &frame_height);
+        }
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::CorruptedData);
+        }
+
+        DecodedImage pixels(frame_width, frame_height, PixelFormat::BGRA32);
+        hr = converter->CopyPixels(nullptr, pixels.stride(),
+                                   static_cast<UINT>(pixels.sizeBytes()), pixels.data());
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::CorruptedData);
+        }
+
+        // The frame's rectangle on the canvas, clipped to it
+        uint32_t left = metadata ? read_uint(metadata.Get(), L"/imgdesc/Left", 0) : 0;
+        uint32_t top = metadata ? read_uint(metadata.Get(), L"/imgdesc/Top", 0) : 0;
+        Rect rect{std::min(left, width_), std::min(top, height_), 0, 0};
+        rect.width = std::min<uint32_t>(frame_width, width_ - rect.x);
+        rect.height = std::min<uint32_t>(frame_height, height_ - rect.y);
+
+        Disposal disposal = Disposal::Keep;
+        if (metadata) {
+            switch (read_uint(metadata.Get(), L"/grctlext/Disposal", 0)) {
+            case 2:
+                disposal = Disposal::Background;
+                break;
+            case 3:
+                disposal = Disposal::Previous;
+                break;
+            default:
+                break;
+            }
+        }
+        if (disposal == Disposal::Previous) {
+            save_rect(rect);
+        }
+        draw(pixels, rect);
+        pending_disposal_ = disposal;
+        pending_rect_ = rect;
+
+        next_index_ = (index + 1) % frame_count_;
+        // The canvas copies itself on the next write, leaving this frame intact
+        return AnimationFrame{std::make_shared<const DecodedImage>(canvas_.share()), index, delay};
+    }
+
+private:
+    struct Rect {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    [[nodiscard]] std::expected<void, DecodeError> init() {
+        UINT count = 0;
+        if (FAILED(decoder_->GetFrameCount(&count)) || count < 2) {
+            return std::unexpected(DecodeError::UnsupportedFormat);
+        }
+        frame_count_ = count;
+
+        GUID container{};
+        decoder_->GetContainerFormat(&container);
+        gif_ = container == GUID_ContainerFormatGif;
+
+        // GIF frames are drawn onto a logical screen; other formats use frame 0's size
+        ComPtr<IWICMetadataQueryReader> metadata;
+        if (gif_) {
+            decoder_->GetMetadataQueryReader(&metadata);
+            width_ = read_uint(metadata.Get(), L"/logscrdesc/Width", 0);
+            height_ = read_uint(metadata.Get(), L"/logscrdesc/Height", 0);
+            play_count_ = read_play_count(metadata.Get());
+        }
+        if (width_ == 0 || height_ == 0) {
+            ComPtr<IWICBitmapFrameDecode> frame;
+            UINT w = 0, h = 0;
+            if (FAILED(decoder_->GetFrame(0, &frame)) || FAILED(frame->GetSize(&w, &h)) ||
+                w == 0 || h == 0) {
+                return std::unexpected(DecodeError::CorruptedData);
+            }
+            width_ = w;
+            height_ = h;
+        }
+        return {};
+    }
+
+    /// @brief Apply the previous frame's disposal to its rectangle
+    void dispose_previous() {
+        const Rect& rect = pending_rect_;
+        if (pending_disposal_ == Disposal::Background) {
+            for (uint32_t y = 0; y < rect.height; ++y) {
+                std::memset(canvas_.row(rect.y + y) + static_cast<size_t>(rect.x) * 4, 0,
+                            static_cast<size_t>(rect.width) * 4);
+            }
+        } else if (pending_disposal_ == Disposal::Previous && saved_.valid()) {
+            for (uint32_t y = 0; y < rect.height; ++y) {
+                std::memcpy(canvas_.row(rect.y + y) + static_cast<size_t>(rect.x) * 4,
+                            std::as_const(saved_).row(y), static_cast<size_t>(rect.width) * 4);
+            }
+        }
+        pending_disposal_ = Disposal::Keep;
+    }
+
+    /// @brief Keep a copy of a canvas rectangle for Disposal::Previous
+    void save_rect(const Rect& rect) {
+        if (rect.width == 0 || rect.height == 0) {
+            saved_ = {};
+            return;
+        }
+        saved_ = DecodedImage(rect.width, rect.height, PixelFormat::BGRA32);
+        for (uint32_t y = 0; y < rect.height; ++y) {
+            std::memcpy(saved_.row(y),
+                        std::as_const(canvas_).row(rect.y + y) + static_cast<size_t>(rect.x) * 4,
+                        static_cast<size_t>(rect.width) * 4);
+        }
+    }
+
+    /// @brief Draw a frame: GIF pixels over the canvas (transparent ones skipped), others over it
+    void draw(const DecodedImage& pixels, const Rect& rect) {
+        for (uint32_t y = 0; y < rect.height; ++y) {
+            const uint8_t* src = pixels.row(y);
+            uint8_t* dst = canvas_.row(rect.y + y) + static_cast<size_t>(rect.x) * 4;
+            if (!gif_) {
+                std::memcpy(dst, src, static_cast<size_t>(rect.width) * 4);
+                continue;
+            }
+            for (uint32_t x = 0; x < rect.width; ++x) {
+                if (src[x * 4 + 3] != 0) {
+                    std::memcpy(dst + static_cast<size_t>(x) * 4, src + static_cast<size_t>(x) * 4,
+                                4);
+                }
+            }
+        }
+    }
+
+    IWICImagingFactory* factory_ = nullptr;
+    std::vector<uint8_t> data_;  // Bytes behind stream_ for in-memory images
+    ComPtr<IWICStream> stream_;
+    ComPtr<IWICBitmapDecoder> decoder_;
+    bool gif_ = false;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t frame_count_ = 0;
+    uint32_t play_count_ = 1;
+
+    uint32_t next_index_ = 0;
+    DecodedImage canvas_;
+    Disposal pending_disposal_ = Disposal::Keep;  // Of the last frame drawn
+    Rect pending_rect_;
+    DecodedImage saved_;  // Canvas under the last frame, for Disposal::Previous
+};
+
+AnimationDecoder::AnimationDecoder(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {
+}
+
+AnimationDecoder::~AnimationDecoder() = default;
+
+std::expected<std::unique_ptr<AnimationDecoder>, DecodeError>
+AnimationDecoder::open(const std::filesystem::path& path) {
+    auto impl = std::make_unique<Impl>();
+    if (auto opened = impl->openFile(path); !opened) {
+        return std::unexpected(opened.error());
+    }
+    return std::unique_ptr<AnimationDecoder>(new AnimationDecoder(std::move(impl)));
+}
+
+std::expected<std::unique_ptr<AnimationDecoder>, DecodeError>
+AnimationDecoder::openFromMemory(std::vector<uint8_t> data) {
+    auto impl = std::make_unique<Impl>();
+    if (auto opened = impl->openMemory(std::move(data)); !opened) {
+        return std::unexpected(opened.error());
+    }
+    return std::unique_ptr<AnimationDecoder>(new AnimationDecoder(std::move(impl)));
+}
+
+uint32_t AnimationDecoder::width() const noexcept {
+    return impl_->width();
+}
+
+uint32_t AnimationDecoder::height() const noexcept {
+    return impl_->height();
+}
+
+uint32_t AnimationDecoder::frameCount() const noexcept {
+    return impl_->frameCount();
+}
+
+uint32_t AnimationDecoder::playCount() const noexcept {
+    return impl_->playCount();
+}
+
+std::expected<AnimationFrame, DecodeError> AnimationDecoder::next() {
+    return impl_->next();
+}
+
+}  // namespace nive::image
@@ -0,0 +1,73 @@
+/// @file animation_decoder.hpp
+/// @brief Incremental compositing of animated image frames
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief One frame of an animation, composited onto the whole canvas
+struct AnimationFrame {
+    std::shared_ptr<const DecodedImage> image;  // BGRA32, canvas size
+    uint32_t index = 0;
+    std::chrono::milliseconds delay{0};  // How long the frame stays on screen
+};
+
+/// @brief Decodes the frames of an animated GIF (or other multi-frame WIC image) in order
+///
+/// The WIC decoder and the canvas stay alive between frames, so each frame
+/// costs its own decode and the rectangle it covers rather than a re-open
+/// and a replay of every frame before it. GIF disposal (keep, restore to
+/// background, restore to previous) and transparency are honoured. Frames of
+/// other containers replace the whole canvas.
+///
+/// Thread-safe: no (one thread at a time, with COM initialised)
+class AnimationDecoder {
+public:
+    ~AnimationDecoder();
+
+    AnimationDecoder(const AnimationDecoder&) = delete;
+    AnimationDecoder& operator=(const AnimationDecoder&) = delete;
+
+    /// @brief Open an image file for frame-by-frame decoding
+    /// @return Decoder, or DecodeError::UnsupportedFormat if the image has a single frame
+    [[nodiscard]] static std::expected<std::unique_ptr<AnimationDecoder>, DecodeError>
+    open(const std::filesystem::path& path);
+
+    /// @brief Open an image held in memory (see open)
+    /// @param data Encoded image; kept by the decoder, which reads it on demand
+    [[nodiscard]] static std::expected<std::unique_ptr<AnimationDecoder>, DecodeError>
+    openFromMemory(std::vector<uint8_t> data);
+
+    /// @brief Canvas width in pixels
+    [[nodiscard]] uint32_t width() const noexcept;
+
+    /// @brief Canvas height in pixels
+    [[nodiscard]] uint32_t height() const noexcept;
+
+    [[nodiscard]] uint32_t frameCount() const noexcept;
+
+    /// @brief Number of times the animation plays (0 = forever)
+    [[nodiscard]] uint32_t playCount() const noexcept;
+
+    /// @brief Composite the next frame, starting over after the last one
+    /// @return Frame, whose image is not touched by later calls
+    [[nodiscard]] std::expected<AnimationFrame, DecodeError> next();
+
+private:
+    class Impl;
+    explicit AnimationDecoder(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::image
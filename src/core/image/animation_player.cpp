@@ -0,0 +1,213 @@
+/// @file animation_player.cpp
+/// @brief Animation playback implementation
+
+#include "animation_player.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../util/logger.hpp"
+#include "../util/win32_utils.hpp"
+
+namespace nive::image {
+
+/// @brief Animation player implementation
+class AnimationPlayer::Impl {
+public:
+    Impl(std::unique_ptr<AnimationDecoder> decoder, FrameCallback on_frame,
+         const AnimationPlayerConfig& config)
+        : decoder_(std::move(decoder)), on_frame_(std::move(on_frame)),
+          width_(decoder_->width()), height_(decoder_->height()),
+          frame_count_(decoder_->frameCount()), play_count_(decoder_->playCount()),
+          ahead_frames_(std::max<uint32_t>(config.ahead_frames, 1)) {
+        uint64_t frame_bytes = static_cast<uint64_t>(width_) * height_ * 4;
+        keep_all_ = frame_bytes * frame_count_ <= config.cache_bytes;
+    }
+
+    [[nodiscard]] std::expected<void, DecodeError> start() {
+        auto first = produce();
+        if (!first) {
+            return std::unexpected(first.error());
+        }
+        current_ = std::move(*first);
+        thread_ = std::jthread([this](std::stop_token stop) { run(stop); });
+        return {};
+    }
+
+    [[nodiscard]] uint32_t width() const noexcept { return width_; }
+    [[nodiscard]] uint32_t height() const noexcept { return height_; }
+    [[nodiscard]] uint32_t frameCount() const noexcept { return frame_count_; }
+
+    [[nodiscard]] AnimationFrame currentFrame() const {
+        std::lock_guard lock(mutex_);
+        return current_;
+    }
+
+    void setPaused(bool paused) {
+        {
+            std::lock_guard lock(mutex_);
+            paused_ = paused;
+        }
+        wake_.notify_all();
+    }
+
+    [[nodiscard]] bool paused() const {
+        std::lock_guard lock(mutex_);
+        return paused_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Get the frame after the last one produced, from the cache or the decoder
+    [[nodiscard]] std::expected<AnimationFrame, DecodeError> produce() {
+        if (all_frames_.size() == frame_count_) {
+            AnimationFrame frame = all_frames_[next_index_];
+            next_index_ = (next_index_ + 1) % frame_count_;
+            return frame;
+        }
+        auto frame = decoder_->next();
+        if (!frame) {
+            return std::unexpected(frame.error());
+        }
+        next_index_ = (frame->index + 1) % frame_count_;
+        if (keep_all_) {
+            all_frames_.push_back(*frame);
+            if (all_frames_.size() == frame_count_) {
+                // Replayed from memory from now on; let go of the file
+                decoder_.reset();
+            }
+        }
+        return frame;
+    }
+
+    void run(std::stop_token stop) {
+        ComInitializer com(COINIT_MULTITHREADED);
+        uint32_t plays = 1;
+        auto due = Clock::now() + currentFrame().delay;
+
+        while (!stop.stop_requested()) {
+            // Decode ahead while the shown frame still has time left
+            while (ahead_.size() < ahead_frames_ && (ahead_.empty() || Clock::now() < due) &&
+                   !stop.stop_requested()) {
+                auto frame = produce();
+                if (!frame) {
+                    LOG_WARN("Animation playback stopped: {}", to_string(frame.error()));
+                    return;
+                }
+                ahead_.push_back(std::move(*frame));
+            }
+            if (ahead_.empty()) {
+                return;
+            }
+
+            std::unique_lock lock(mutex_);
+            if (paused_) {
+                wake_.wait(lock, stop, [this] { return !paused_; });
+                due = Clock::now();
+                continue;
+            }
+            if (wake_.wait_until(lock, stop, due, [this] { return paused_; }) ||
+                stop.stop_requested()) {
+                continue;
+            }
+
+            AnimationFrame frame = std::move(ahead_.front());
+            ahead_.pop_front();
+            // Frame 0 again begins another play
+            if (frame.index == 0) {
+                if (play_count_ != 0 && plays >= play_count_) {
+                    return;
+                }
+                ++plays;
+            }
+
+            // Keep to the file's timing, but after falling behind (a slow
+            // decode, a suspended machine) resume from now instead of rushing
+            auto now = Clock::now();
+            due = std::max(due, now - frame.delay) + frame.delay;
+            current_ = std::move(frame);
+            lock.unlock();
+
+            if (on_frame_) {
+                on_frame_();
+            }
+        }
+    }
+
+    // Playback thread only (and start(), before the thread exists)
+    std::unique_ptr<AnimationDecoder> decoder_;
+    std::vector<AnimationFrame> all_frames_;  // Filled during the first play when keep_all_
+    std::deque<AnimationFrame> ahead_;
+    uint32_t next_index_ = 0;
+
+    FrameCallback on_frame_;
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t frame_count_;
+    uint32_t play_count_;
+    uint32_t ahead_frames_;
+    bool keep_all_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any wake_;
+    AnimationFrame current_;
+    bool paused_ = false;
+
+    std::jthread thread_;  // Last: stopped and joined before the members it uses go
+};
+
+AnimationPlayer::AnimationPlayer(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {
+}
+
+AnimationPlayer::~AnimationPlayer() = default;
+
+std::expected<std::unique_ptr<AnimationPlayer>, DecodeError>
+AnimationPlayer::start(std::unique_ptr<AnimationDecoder> decoder, FrameCallback on_frame,
+                       const AnimationPlayerConfig& config) {
+    if (!decoder) {
+        return std::unexpected(DecodeError::InternalError);
+    }
+    auto impl = std::make_unique<Impl>(std::move(decoder), std::move(on_frame), config);
+    if (auto started = impl->start(); !started) {
+        return std::unexpected(started.error());
+    }
+    return std::unique_ptr<AnimationPlayer>(new AnimationPlayer(std::move(impl)));
+}
+
+uint32_t AnimationPlayer::width() const noexcept {
+    return impl_->width();
+}
+
+uint32_t AnimationPlayer::height() const noexcept {
+    return impl_->height();
+}
+
+uint32_t AnimationPlayer::frameCount() const noexcept {
+    return impl_->frameCount();
+}
+
+AnimationFrame AnimationPlayer::currentFrame() const {
+    return impl_->currentFrame();
+}
+
+void AnimationPlayer::pause() {
+    impl_->setPaused(true);
+}
+
+void AnimationPlayer::resume() {
+    impl_->setPaused(false);
+}
+
+bool AnimationPlayer::paused() const {
+    return impl_->paused();
+}
+
+}  // namespace nive::image
@@ -0,0 +1,77 @@
+/// @file animation_player.hpp
+/// @brief Timed animation playback on a background thread
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+
+#include "animation_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief AnimationPlayer configuration
+struct AnimationPlayerConfig {
+    size_t cache_bytes = 64ull * 1024 * 1024;  // Every frame is kept if all fit in this
+    uint32_t ahead_frames = 4;                  // Frames decoded ahead of the one shown
+};
+
+/// @brief Plays an animation, switching frames at their delays on its own thread
+///
+/// The thread decodes ahead into a small ring while waiting for the shown
+/// frame's time to run out. An animation whose frames all fit in
+/// AnimationPlayerConfig::cache_bytes is decoded once and then replayed from
+/// memory; a longer one (a 500-frame GIF) is decoded again on every play, so
+/// memory stays at a few frames however long it is. Playback stops on the
+/// last frame after the file's play count.
+///
+/// Thread-safe: yes
+class AnimationPlayer {
+public:
+    /// @brief Called on the playback thread whenever currentFrame() changes
+    using FrameCallback = std::function<void()>;
+
+    ~AnimationPlayer();
+
+    AnimationPlayer(const AnimationPlayer&) = delete;
+    AnimationPlayer& operator=(const AnimationPlayer&) = delete;
+
+    /// @brief Decode the first frame and start playing
+    /// @param decoder Opened animation, used only by the player from now on
+    /// @param on_frame Frame change notification (keep it short, e.g. post a message)
+    /// @param config Frame cache limits
+    /// @return Player showing frame 0, or the error decoding it
+    [[nodiscard]] static std::expected<std::unique_ptr<AnimationPlayer>, DecodeError>
+    start(std::unique_ptr<AnimationDecoder> decoder, FrameCallback on_frame,
+          const AnimationPlayerConfig& config = {});
+
+    /// @brief Canvas width in pixels
+    [[nodiscard]] uint32_t width() const noexcept;
+
+    /// @brief Canvas height in pixels
+    [[nodiscard]] uint32_t height() const noexcept;
+
+    [[nodiscard]] uint32_t frameCount() const noexcept;
+
+    /// @brief Get the frame to show now
+    [[nodiscard]] AnimationFrame currentFrame() const;
+
+    /// @brief Hold the current frame until resume()
+    void pause();
+
+    /// @brief Continue playing, with the next frame shown straight away
+    void resume();
+
+    [[nodiscard]] bool paused() const;
+
+private:
+    class Impl;
+    explicit AnimationPlayer(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::image
@@ -0,0 +1,343 @@
+/// @file batch_export.cpp
+/// @brief Batch JPEG export implementation
+///
+/// The calling thread names the outputs, keeps one image in flight per pool
+/// worker and records finished sources in the checkpoint: a header line
+/// "nive-export <version> <max_side> <quality>", then one UTF-8 source path
+/// per line. Items decode at the reduced size where the decoder can; only
+/// plugin decodes are full size, and those go through a byte budget.
+
+#include "batch_export.hpp"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+#include "../thumbnail/decode_admission.hpp"
+#include "../util/logger.hpp"
+#include "../util/mapped_file.hpp"
+#include "../util/string_utils.hpp"
+#include "../util/task_group.hpp"
+#include "../util/win32_utils.hpp"
+#include "decoder_registry.hpp"
+#include "image_encoder.hpp"
+#include "image_scaler.hpp"
+#include "wic_decoder.hpp"
+
+namespace nive::image {
+
+namespace {
+
+constexpr int kCheckpointVersion = 1;
+
+// Full-size plugin decodes held at once across the export
+constexpr uint64_t kFullDecodeBudget = 512ull * 1024 * 1024;
+
+enum class ItemOutcome {
+    Exported,
+    Failed,
+    Cancelled,
+};
+
+[[nodiscard]] std::string checkpoint_header(const ExportOptions& options) {
+    return std::format("nive-export {} {} {}", kCheckpointVersion, options.max_side,
+                       options.jpeg_quality);
+}
+
+/// @brief Read the sources an earlier export with the same header finished
+/// @return Source paths, or nullopt if there is no checkpoint or it is for other options
+[[nodiscard]] std::optional<std::unordered_set<std::wstring>>
+read_checkpoint(const std::filesystem::path& path, const std::string& header) {
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != header) {
+        return std::nullopt;
+    }
+    std::unordered_set<std::wstring> done;
+    while (std::getline(file, line)) {
+        // A line cut short by a crash has no newline; the next run redoes it
+        if (file.eof() || line.empty()) {
+            break;
+        }
+        done.insert(utf8ToPath(line).wstring());
+    }
+    return done;
+}
+
+/// @brief Pick <stem>.jpg in dest_dir, numbered if the name is on disk or claimed
+[[nodiscard]] std::filesystem::path output_path(const std::filesystem::path& dest_dir,
+                                                const std::filesystem::path& source,
+                                                std::unordered_set<std::wstring>& claimed) {
+    const std::wstring stem = source.stem().wstring();
+    std::error_code ec;
+    for (int n = 1;; ++n) {
+        std::wstring name = n == 1 ? stem + L".jpg" : std::format(L"{} ({}).jpg", stem, n);
+        std::filesystem::path target = dest_dir / name;
+        if (!std::filesystem::exists(target, ec) && claimed.insert(toLowercaseAscii(name)).second) {
+            return target;
+        }
+    }
+}
+
+/// @brief Scale an image down to fit max_side, leaving smaller ones as they are
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+fit(DecodedImage image, uint32_t max_side, std::stop_token stop) {
+    if (std::max(image.width(), image.height()) <= max_side) {
+        return image;
+    }
+    return generateThumbnail(image, max_side, {}, stop);
+}
+
+/// @brief Decode an image at no more than max_side, reducing while decoding where possible
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+decode_reduced(std::span<const uint8_t> data, const std::filesystem::path& source,
+               uint32_t max_side, const DecoderRegistry& decoders,
+               thumbnail::DecodeAdmission& admission, std::stop_token stop) {
+    const DecoderChoice choice = decoders.choose(data, pathToUtf8(source.extension()));
+
+    if (choice.kind == DecoderKind::Native && choice.native) {
+        if (auto reduced = choice.native->decodeThumbnailFromMemory(data, max_side)) {
+            return fit(std::move(reduced->image), max_side, stop);
+        }
+        // Anything the built-in codec rejects goes on to WIC, as in decode()
+    }
+    if (choice.kind != DecoderKind::Plugin) {
+        WicDecoder wic;
+        auto reduced = wic.decodeThumbnailFromMemory(data, max_side, stop);
+        if (!reduced) {
+            return std::unexpected(reduced.error());
+        }
+        return std::move(reduced->image);
+    }
+
+    // Plugins only decode at full size
+    uint64_t bytes = 0;
+    if (auto info = decoders.getInfo(data, choice)) {
+        bytes = static_cast<uint64_t>(info->width) * info->height * 4;
+    }
+    auto permit = admission.acquire(bytes, stop);
+    if (!permit) {
+        return std::unexpected(DecodeError::Cancelled);
+    }
+    auto full = decoders.decode(data, choice);
+    if (!full) {
+        return std::unexpected(full.error());
+    }
+    return fit(std::move(*full), max_side, stop);
+}
+
+/// @brief Composite a BGRA32 image onto white (JPEG has no alpha)
+void flatten_onto_white(DecodedImage& image) {
+    if (image.format() != PixelFormat::BGRA32) {
+        return;
+    }
+    const uint32_t stride = image.stride();
+    uint8_t* pixels = image.data();
+    for (uint32_t y = 0; y < image.height(); ++y) {
+        uint8_t* px = pixels + static_cast<size_t>(y) * stride;
+        for (uint32_t x = 0; x < image.width(); ++x, px += 4) {
+            const uint32_t alpha = px[3];
+            if (alpha == 255) {
+                continue;
+            }
+            for (int c = 0; c < 3; ++c) {
+                px[c] = static_cast<uint8_t>((px[c] * alpha + 255 * (255 - alpha) + 127) / 255);
+            }
+            px[3] = 255;
+        }
+    }
+}
+
+/// @brief Write a file that must not exist yet, through a .part file beside it
+[[nodiscard]] bool write_new_file(const std::filesystem::path& target,
+                                  std::span<const uint8_t> bytes) {
+    std::filesystem::path part = target;
+    part += L".part";
+    {
+        std::ofstream out(part, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+        if (!out.flush()) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(part, ec);
+            return false;
+        }
+    }
+    // No MOVEFILE_REPLACE_EXISTING: a file that appeared meanwhile is kept
+    if (!MoveFileExW(part.c_str(), target.c_str(), 0)) {
+        std::error_code ec;
+        std::filesystem::remove(part, ec);
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] ItemOutcome export_one(const std::filesystem::path& source,
+                                     const std::filesystem::path& target,
+                                     const ExportOptions& options, const DecoderRegistry& decoders,
+                                     thumbnail::DecodeAdmission& admission,
+                                     std::stop_token stop) {
+    // Pool workers may never have touched COM
+    ComInitializer com(COINIT_MULTITHREADED);
+
+    auto file = MappedFile::open(source);
+    if (!file) {
+        LOG_WARN("Export: cannot read {}", pathToUtf8(source));
+        return ItemOutcome::Failed;
+    }
+    auto image =
+        decode_reduced(file->bytes(), source, options.max_side, decoders, admission, stop);
+    file->close();
+    if (stop.stop_requested()) {
+        return ItemOutcome::Cancelled;
+    }
+    if (!image) {
+        LOG_WARN("Export: cannot decode {}: {}", pathToUtf8(source), to_string(image.error()));
+        return ItemOutcome::Failed;
+    }
+
+    flatten_onto_white(*image);
+    auto jpeg = encodeJpeg(*image, options.jpeg_quality);
+    if (!jpeg) {
+        LOG_WARN("Export: cannot encode {}: {}", pathToUtf8(source), to_string(jpeg.error()));
+        return ItemOutcome::Failed;
+    }
+    if (stop.stop_requested()) {
+        return ItemOutcome::Cancelled;
+    }
+    if (!write_new_file(target, *jpeg)) {
+        LOG_WARN("Export: cannot write {}", pathToUtf8(target));
+        return ItemOutcome::Failed;
+    }
+    return ItemOutcome::Exported;
+}
+
+}  // namespace
+
+ExportResult exportImages(std::span<const std::filesystem::path> sources,
+                          const std::filesystem::path& dest_dir, const ExportOptions& options,
+                          const DecoderRegistry& decoders, const ExportProgress& progress,
+                          std::stop_token stop) {
+    ExportResult result;
+    const std::filesystem::path checkpoint = dest_dir / kExportCheckpointName;
+    const std::string header = checkpoint_header(options);
+    const auto finished_before = read_checkpoint(checkpoint, header);
+
+    std::ofstream journal;
+    if (finished_before) {
+        journal.open(checkpoint, std::ios::binary | std::ios::app);
+    } else {
+        journal.open(checkpoint, std::ios::binary | std::ios::trunc);
+        journal << header << '\n';
+    }
+    if (!journal) {
+        LOG_WARN("Export: cannot write checkpoint {}", pathToUtf8(checkpoint));
+    }
+
+    struct Item {
+        const std::filesystem::path* source;
+        std::filesystem::path target;
+    };
+    std::vector<Item> items;
+    items.reserve(sources.size());
+    std::unordered_set<std::wstring> claimed;
+    for (const auto& source : sources) {
+        if (finished_before && finished_before->contains(source.wstring())) {
+            ++result.resumed;
+            continue;
+        }
+        items.push_back({&source, output_path(dest_dir, source, claimed)});
+    }
+
+    const uint64_t total = sources.size();
+    uint64_t done = result.resumed;
+    std::stop_source cancel;
+    std::stop_callback forward_stop(stop, [&cancel] { cancel.request_stop(); });
+    if (progress && !progress(done, total)) {
+        cancel.request_stop();
+    }
+
+    thumbnail::DecodeAdmission admission(kFullDecodeBudget);
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<std::pair<size_t, ItemOutcome>> outcomes;  // Guarded by mutex
+
+    auto run_item = [&](size_t index) {
+        ItemOutcome outcome = ItemOutcome::Failed;
+        try {
+            outcome = export_one(*items[index].source, items[index].target, options, decoders,
+                                 admission, cancel.get_token());
+        } catch (const std::bad_alloc&) {
+            LOG_WARN("Export: out of memory for {}", pathToUtf8(*items[index].source));
+        }
+        {
+            std::lock_guard lock(mutex);
+            outcomes.emplace_back(index, outcome);
+        }
+        finished.notify_one();
+    };
+
+    ThreadPool& pool = globalThreadPool();
+    const size_t max_in_flight = std::max<size_t>(pool.workerCount(), 1);
+    TaskGroup group(pool, TaskPriority::Low);
+    size_t next = 0;
+    size_t in_flight = 0;
+    while (in_flight > 0 || (next < items.size() && !cancel.stop_requested())) {
+        while (next < items.size() && in_flight < max_in_flight && !cancel.stop_requested()) {
+            size_t index = next++;
+            ++in_flight;
+            if (pool.workerCount() == 0) {
+                run_item(index);
+            } else {
+                group.run([&run_item, index] { run_item(index); });
+            }
+        }
+
+        std::vector<std::pair<size_t, ItemOutcome>> drained;
+        {
+            std::unique_lock lock(mutex);
+            finished.wait(lock, [&] { return !outcomes.empty(); });
+            drained.swap(outcomes);
+        }
+        for (const auto& [index, outcome] : drained) {
+            --in_flight;
+            if (outcome == ItemOutcome::Cancelled) {
+                continue;
+            }
+            ++done;
+            if (outcome == ItemOutcome::Exported) {
+                ++result.exported;
+                journal << pathToUtf8(*items[index].source) << '\n';
+            } else {
+                result.failed.push_back(*items[index].source);
+            }
+        }
+        journal.flush();
+
+        if (progress && !cancel.stop_requested() && !progress(done, total)) {
+            cancel.request_stop();
+        }
+    }
+    group.wait();
+
+    result.cancelled = cancel.stop_requested() && done < total;
+    journal.close();
+    if (!result.cancelled && result.failed.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(checkpoint, ec);
+    }
+    LOG_INFO("Exported {} images to {} ({} resumed, {} failed{})", result.exported,
+             pathToUtf8(dest_dir), result.resumed, result.failed.size(),
+             result.cancelled ? ", cancelled" : "");
+    return result;
+}
+
+}  // namespace nive::image
@@ -0,0 +1,68 @@
+/// @file batch_export.hpp
+/// @brief Resized JPEG copies of many images, made in parallel and resumable
+///
+/// Each image goes through read (a file mapping), decode (reduced where the
+/// decoder can), resize, encode and write. Images run on the global thread
+/// pool, at most one per worker at a time, so a large selection holds no
+/// more than a few images in memory. A checkpoint in the destination
+/// records what is done, so an export that was cancelled or interrupted
+/// picks up where it stopped when run again.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <vector>
+
+namespace nive::image {
+
+class DecoderRegistry;
+
+/// @brief How exported images are made
+struct ExportOptions {
+    uint32_t max_side = 2048;  // Longest side of the output; smaller images keep their size
+    int jpeg_quality = 85;     // 1-100
+};
+
+/// @brief Outcome of an export
+struct ExportResult {
+    uint64_t exported = 0;  // Written by this run
+    uint64_t resumed = 0;   // Written by an earlier run of the same export
+    std::vector<std::filesystem::path> failed;  // Sources that could not be exported
+    bool cancelled = false;
+};
+
+/// @brief Progress of an export, in images
+/// @return false to cancel
+///
+/// Called on the thread running exportImages(), which may block in it (to
+/// pause): images already started finish meanwhile, no others start.
+using ExportProgress = std::function<bool(uint64_t done, uint64_t total)>;
+
+/// @brief Name of the checkpoint an unfinished export keeps in its destination
+inline constexpr std::wstring_view kExportCheckpointName = L".nive-export";
+
+/// @brief Export images as JPEGs into a directory
+/// @param sources Image files; each becomes <stem>.jpg, numbered if the name is taken
+/// @param dest_dir Existing destination directory
+/// @param options Output size and quality
+/// @param decoders Decoders to read the sources with
+/// @param progress Progress callback (optional)
+/// @param stop Cancels the export, like progress returning false
+/// @return What was exported
+///
+/// Translucent images are composited onto white. Sources the checkpoint
+/// left by an earlier export with the same options lists are skipped; the
+/// checkpoint is removed once every source has been exported.
+[[nodiscard]] ExportResult exportImages(std::span<const std::filesystem::path> sources,
+                                        const std::filesystem::path& dest_dir,
+                                        const ExportOptions& options,
+                                        const DecoderRegistry& decoders,
+                                        const ExportProgress& progress = {},
+                                        std::stop_token stop = {});
+
+}  // namespace nive::image
@@ -0,0 +1,393 @@
+/// @file color_management.cpp
+/// @brief ICC profile reading and cached ICM color transforms
+
+#include "color_management.hpp"
+
+#include <Windows.h>
+
+#include <Icm.h>
+#include <wincodec.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "../util/com_ptr.hpp"
+#include "../util/logger.hpp"
+#include "wic_factory.hpp"
+
+#pragma comment(lib, "mscms.lib")
+
+namespace nive::image {
+
+namespace {
+
+constexpr size_t kIccHeaderBytes = 128;
+constexpr size_t kIccMaxBytes = 64 * 1024 * 1024;
+
+// Rows converted per TranslateBitmapBits call, between stop checks
+constexpr uint32_t kBandRows = 64;
+
+// EXIF ColorSpace value for sRGB (WICColorContextExifColorSpace)
+constexpr UINT kExifColorSpaceSrgb = 1;
+
+[[nodiscard]] uint32_t read_be32(std::span<const uint8_t> data, size_t offset) noexcept {
+    return (static_cast<uint32_t>(data[offset]) << 24) |
+           (static_cast<uint32_t>(data[offset + 1]) << 16) |
+           (static_cast<uint32_t>(data[offset + 2]) << 8) | data[offset + 3];
+}
+
+[[nodiscard]] bool has_signature(std::span<const uint8_t> data, size_t offset,
+                                 std::string_view signature) noexcept {
+    return offset + signature.size() <= data.size() &&
+           std::equal(signature.begin(), signature.end(), data.begin() + offset);
+}
+
+/// @brief Check for the ICC header signature ("acsp" at byte 36)
+[[nodiscard]] bool is_icc_profile(std::span<const uint8_t> icc) noexcept {
+    return icc.size() >= kIccHeaderBytes + 4 && has_signature(icc, 36, "acsp");
+}
+
+/// @brief Get the ASCII text of the profile description ('desc' tag)
+/// @return Description (v2 'desc' or first v4 'mluc' record), or empty if absent
+[[nodiscard]] std::string profile_description(std::span<const uint8_t> icc) {
+    uint32_t tag_count = read_be32(icc, kIccHeaderBytes);
+    for (uint32_t i = 0; i < tag_count; ++i) {
+        size_t entry = kIccHeaderBytes + 4 + static_cast<size_t>(i) * 12;
+        if (entry + 12 > icc.size()) {
+            break;
+        }
+        if (!has_signature(icc, entry, "desc")) {
+            continue;
+        }
+        size_t offset = read_be32(icc, entry + 4);
+        size_t size = read_be32(icc, entry + 8);
+        if (offset > icc.size() || size > icc.size() - offset || size < 12) {
+            return {};
+        }
+        auto tag = icc.subspan(offset, size);
+
+        std::string text;
+        if (has_signature(tag, 0, "desc")) {
+            size_t length = std::min<size_t>(read_be32(tag, 8), tag.size() - 12);
+            text.assign(tag.begin() + 12, tag.begin() + 12 + length);
+        } else if (has_signature(tag, 0, "mluc") && tag.size() >= 28) {
+            // First record: language, country, length and offset of UTF-16BE text
+            size_t length = read_be32(tag, 20);
+            size_t start = read_be32(tag, 24);
+            if (start <= tag.size() && length <= tag.size() - start) {
+                for (size_t pos = start; pos + 1 < start + length; pos += 2) {
+                    text.push_back(tag[pos] == 0 ? static_cast<char>(tag[pos + 1]) : '?');
+                }
+            }
+        }
+        // v2 text is NUL-terminated
+        if (auto nul = text.find('\0'); nul != std::string::npos) {
+            text.resize(nul);
+        }
+        return text;
+    }
+    return {};
+}
+
+/// @brief Check if a profile is one of the sRGB profiles cameras and editors embed
+[[nodiscard]] bool describes_srgb(std::span<const uint8_t> icc) {
+    return profile_description(icc).starts_with("sRGB");
+}
+
+/// @brief Get the embedded profile of the first frame of an opened image
+ColorProfile profile_from_decoder(IWICImagingFactory* factory, IWICBitmapDecoder* decoder) {
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (FAILED(decoder->GetFrame(0, &frame))) {
+        return {};
+    }
+
+    UINT count = 0;
+    if (FAILED(frame->GetColorContexts(0, nullptr, &count)) || count == 0) {
+        return {};
+    }
+    std::vector<ComPtr<IWICColorContext>> contexts(count);
+    std::vector<IWICColorContext*> raw(count);
+    for (UINT i = 0; i < count; ++i) {
+        if (FAILED(factory->CreateColorContext(&contexts[i]))) {
+            return {};
+        }
+        raw[i] = contexts[i].Get();
+    }
+    if (FAILED(frame->GetColorContexts(count, raw.data(), &count))) {
+        return {};
+    }
+
+    for (UINT i = 0; i < count; ++i) {
+        WICColorContextType type{};
+        if (FAILED(raw[i]->GetType(&type))) {
+            continue;
+        }
+        if (type == WICColorContextExifColorSpace) {
+            // Only sRGB is declared this way in practice; any other value
+            // has no profile to convert from
+            UINT color_space = 0;
+            raw[i]->GetExifColorSpace(&color_space);
+            if (color_space != kExifColorSpaceSrgb) {
+                LOG_DEBUG("EXIF color space {} has no ICC profile; treating as sRGB", color_space);
+            }
+            continue;
+        }
+        UINT size = 0;
+        if (FAILED(raw[i]->GetProfileBytes(0, nullptr, &size)) || size == 0 ||
+            size > kIccMaxBytes) {
+            continue;
+        }
+        std::vector<uint8_t> icc(size);
+        if (SUCCEEDED(raw[i]->GetProfileBytes(size, icc.data(), &size))) {
+            icc.resize(size);
+            return ColorProfile(std::move(icc));
+        }
+    }
+    return {};
+}
+
+/// @brief Path of the system sRGB profile, looked up once
+const std::wstring& srgb_profile_path() {
+    static const std::wstring path = [] {
+        wchar_t buffer[MAX_PATH] = {};
+        DWORD size = sizeof(buffer);
+        if (!GetStandardColorSpaceProfileW(nullptr, LCS_sRGB, buffer, &size)) {
+            LOG_WARN("No standard sRGB color profile installed");
+            return std::wstring();
+        }
+        return std::wstring(buffer);
+    }();
+    return path;
+}
+
+/// @brief Open a profile for ICM (sRGB from the system profile)
+[[nodiscard]] HPROFILE open_profile(const ColorProfile& profile) {
+    PROFILE source{};
+    if (profile.isSrgb()) {
+        const std::wstring& path = srgb_profile_path();
+        if (path.empty()) {
+            return nullptr;
+        }
+        source.dwType = PROFILE_FILENAME;
+        source.pProfileData = const_cast<wchar_t*>(path.c_str());
+        source.cbDataSize = static_cast<DWORD>((path.size() + 1) * sizeof(wchar_t));
+    } else {
+        // ICM takes a non-const pointer but only reads through it
+        auto bytes = profile.bytes();
+        source.dwType = PROFILE_MEMBUFFER;
+        source.pProfileData = const_cast<uint8_t*>(bytes.data());
+        source.cbDataSize = static_cast<DWORD>(bytes.size());
+    }
+    return OpenColorProfileW(&source, PROFILE_READ, FILE_SHARE_READ, OPEN_EXISTING);
+}
+
+/// @brief Cache key of a (source, target) pair
+[[nodiscard]] uint64_t pair_key(const ColorProfile& source, const ColorProfile& target) noexcept {
+    return source.id().low ^ (target.id().low * 0x9E3779B97F4A7C15ull) ^ target.id().high;
+}
+
+}  // namespace
+
+// ColorProfile
+
+ColorProfile::ColorProfile(std::vector<uint8_t> icc) {
+    if (!is_icc_profile(icc) || describes_srgb(icc)) {
+        return;
+    }
+    id_ = hash128(icc);
+    icc_ = std::make_shared<const std::vector<uint8_t>>(std::move(icc));
+}
+
+std::optional<ColorProfile> ColorProfile::fromFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return std::nullopt;
+    }
+    auto size = static_cast<size_t>(file.tellg());
+    if (size < kIccHeaderBytes || size > kIccMaxBytes) {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> icc(size);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(icc.data()), static_cast<std::streamsize>(size))) {
+        return std::nullopt;
+    }
+    if (!is_icc_profile(icc)) {
+        return std::nullopt;
+    }
+    return ColorProfile(std::move(icc));
+}
+
+std::span<const uint8_t> ColorProfile::bytes() const noexcept {
+    return icc_ ? std::span<const uint8_t>(*icc_) : std::span<const uint8_t>();
+}
+
+// Embedded profiles
+
+ColorProfile readEmbeddedProfile(const std::filesystem::path& path) {
+    IWICImagingFactory* factory = wicFactory();
+    if (!factory) {
+        return {};
+    }
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (FAILED(factory->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                  WICDecodeMetadataCacheOnDemand, &decoder))) {
+        return {};
+    }
+    return profile_from_decoder(factory, decoder.Get());
+}
+
+ColorProfile readEmbeddedProfile(std::span<const uint8_t> data) {
+    IWICImagingFactory* factory = wicFactory();
+    if (!factory || data.empty() || data.size() > std::numeric_limits<DWORD>::max()) {
+        return {};
+    }
+    ComPtr<IWICStream> stream;
+    HRESULT hr = factory->CreateStream(&stream);
+    if (SUCCEEDED(hr)) {
+        // WIC takes a non-const pointer but only reads through it
+        hr = stream->InitializeFromMemory(const_cast<BYTE*>(data.data()),
+                                          static_cast<DWORD>(data.size()));
+    }
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateDecoderFromStream(stream.Get(), nullptr,
+                                              WICDecodeMetadataCacheOnDemand, &decoder);
+    }
+    if (FAILED(hr)) {
+        return {};
+    }
+    return profile_from_decoder(factory, decoder.Get());
+}
+
+// ColorTransformCache
+
+/// @brief ICM transform between two profiles (null handle if it could not be built)
+class ColorTransformCache::Transform {
+public:
+    Transform(ColorProfile source, ColorProfile target)
+        : source_(std::move(source)), target_(std::move(target)) {
+        HPROFILE profiles[2] = {open_profile(source_), open_profile(target_)};
+        if (profiles[0] && profiles[1]) {
+            DWORD intent = INTENT_PERCEPTUAL;
+            handle_ = CreateMultiProfileTransform(profiles, 2, &intent, 1, BEST_MODE,
+                                                  INDEX_DONT_CARE);
+        }
+        for (HPROFILE profile : profiles) {
+            if (profile) {
+                CloseColorProfile(profile);
+            }
+        }
+        if (!handle_) {
+            LOG_WARN("Failed to build color transform (error {})", GetLastError());
+        }
+    }
+
+    ~Transform() {
+        if (handle_) {
+            DeleteColorTransform(handle_);
+        }
+    }
+
+    Transform(const Transform&) = delete;
+    Transform& operator=(const Transform&) = delete;
+
+    [[nodiscard]] bool valid() const noexcept { return handle_ != nullptr; }
+
+    [[nodiscard]] bool matches(const ColorProfile& source,
+                               const ColorProfile& target) const noexcept {
+        return source_ == source && target_ == target;
+    }
+
+    /// @brief Convert rows of pixels; the ICM handle is used by one thread at a time
+    bool translate(const uint8_t* source, uint32_t source_stride, uint8_t* dest,
+                   uint32_t dest_stride, BMFORMAT format, uint32_t width, uint32_t rows) {
+        std::lock_guard lock(mutex_);
+        return TranslateBitmapBits(handle_, const_cast<uint8_t*>(source), format, width, rows,
+                                   source_stride, dest, format, dest_stride, nullptr, 0) != FALSE;
+    }
+
+private:
+    ColorProfile source_;
+    ColorProfile target_;
+    HTRANSFORM handle_ = nullptr;
+    std::mutex mutex_;
+};
+
+ColorTransformCache& ColorTransformCache::instance() {
+    // Never destroyed: workers may still convert during static destruction
+    static auto* cache = new ColorTransformCache();
+    return *cache;
+}
+
+std::shared_ptr<ColorTransformCache::Transform>
+ColorTransformCache::transform(const ColorProfile& source, const ColorProfile& target) {
+    uint64_t key = pair_key(source, target);
+    std::lock_guard lock(mutex_);
+    if (auto cached = transforms_.get(key); cached && (*cached)->matches(source, target)) {
+        return *cached;
+    }
+    // Built under the lock: a pair's first images wait for one build, not race to several
+    auto built = std::make_shared<Transform>(source, target);
+    transforms_.put(key, built, 1);
+    return built;
+}
+
+std::expected<DecodedImage, DecodeError>
+ColorTransformCache::convert(ImageView image, const ColorProfile& source,
+                             const ColorProfile& target, std::stop_token stop_token) {
+    // Both layouts are stored blue first, as ICM's RGBQUAD / RGBTRIPLE formats
+    BMFORMAT format{};
+    if (image.format() == PixelFormat::BGRA32) {
+        format = BM_xRGBQUADS;
+    } else if (image.format() == PixelFormat::BGR24) {
+        format = BM_RGBTRIPLETS;
+    } else {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    if (!image.valid()) {
+        return std::unexpected(DecodeError::InternalError);
+    }
+
+    auto cached = transform(source, target);
+    if (!cached->valid()) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+
+    uint32_t width = image.width();
+    uint32_t height = image.height();
+    DecodedImage result(width, height, image.format());
+    for (uint32_t y = 0; y < height; y += kBandRows) {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+        uint32_t rows = std::min(kBandRows, height - y);
+        if (!cached->translate(image.row(y), image.stride(), result.row(y), result.stride(),
+                               format, width, rows)) {
+            LOG_DEBUG("TranslateBitmapBits failed (error {})", GetLastError());
+            return std::unexpected(DecodeError::InternalError);
+        }
+    }
+
+    // ICM leaves the fourth byte of a quad undefined; carry alpha over
+    if (format == BM_xRGBQUADS) {
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* from = image.row(y);
+            uint8_t* to = result.row(y);
+            for (uint32_t x = 0; x < width; ++x) {
+                to[x * 4 + 3] = from[x * 4 + 3];
+            }
+        }
+    }
+    return result;
+}
+
+void ColorTransformCache::clear() {
+    std::lock_guard lock(mutex_);
+    transforms_.clear();
+}
+
+}  // namespace nive::image
@@ -0,0 +1,118 @@
+/// @file color_management.hpp
+/// @brief ICC color management: embedded profiles and cached color transforms
+///
+/// Decoders hand out pixels in the image's own color space. Images tagged
+/// with a wide-gamut profile (Display P3, Adobe RGB) look washed out or
+/// oversaturated when those values are shown as sRGB, so they are converted
+/// through a Windows ICM transform. Building a transform parses both
+/// profiles and computes lookup tables, so transforms are cached per
+/// (source, target) pair and reused for every image and thumbnail.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <vector>
+
+#include "../util/hash.hpp"
+#include "../util/lru_cache.hpp"
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief ICC color profile, identified by a hash of its bytes
+///
+/// A default-constructed profile stands for sRGB. Profiles that describe
+/// sRGB themselves (the common "sRGB IEC61966-2.1" tag) compare equal to it,
+/// so sRGB-tagged images are never converted to sRGB.
+class ColorProfile {
+public:
+    /// @brief sRGB
+    ColorProfile() = default;
+
+    /// @brief Wrap ICC profile bytes
+    /// @param icc Profile data (a profile describing sRGB yields sRGB)
+    explicit ColorProfile(std::vector<uint8_t> icc);
+
+    /// @brief Read an ICC profile file (.icc, .icm)
+    /// @return Profile, or nullopt if the file cannot be read or is no ICC profile
+    [[nodiscard]] static std::optional<ColorProfile> fromFile(const std::filesystem::path& path);
+
+    /// @brief Check if this is sRGB (no profile bytes)
+    [[nodiscard]] bool isSrgb() const noexcept { return !icc_; }
+
+    /// @brief Profile bytes (empty for sRGB)
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept;
+
+    /// @brief Hash of the profile bytes (zero for sRGB)
+    [[nodiscard]] const Hash128& id() const noexcept { return id_; }
+
+    [[nodiscard]] bool operator==(const ColorProfile& other) const noexcept {
+        return id_ == other.id_;
+    }
+
+private:
+    std::shared_ptr<const std::vector<uint8_t>> icc_;
+    Hash128 id_{};
+};
+
+/// @brief Read the color profile embedded in an image file (first frame)
+/// @return Embedded profile, or sRGB if there is none or WIC cannot read the image
+///
+/// Only the header and metadata are parsed; no pixels are decoded.
+[[nodiscard]] ColorProfile readEmbeddedProfile(const std::filesystem::path& path);
+
+/// @brief Read the color profile embedded in an image in memory (see above)
+[[nodiscard]] ColorProfile readEmbeddedProfile(std::span<const uint8_t> data);
+
+/// @brief Process-wide cache of ICC color transforms, one per (source, target) pair
+///
+/// Transforms that could not be built are cached too, so a broken profile
+/// costs one attempt rather than one per image.
+///
+/// Thread-safe: yes (each transform is used by one thread at a time)
+class ColorTransformCache {
+public:
+    static constexpr size_t kMaxTransforms = 16;
+
+    /// @brief Get the shared cache
+    [[nodiscard]] static ColorTransformCache& instance();
+
+    /// @brief Convert an image from one color profile to another
+    /// @param image BGRA32 or BGR24 pixels in the source color space (alpha is kept)
+    /// @param source Profile the pixels are in
+    /// @param target Profile to convert to
+    /// @param stop_token Checked between bands of rows
+    /// @return Converted image, DecodeError::UnsupportedFormat for other pixel
+    ///         formats or profiles Windows cannot use, or DecodeError::Cancelled
+    ///
+    /// Callers skip the call when source == target; the result would equal
+    /// the input.
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    convert(ImageView image, const ColorProfile& source, const ColorProfile& target,
+            std::stop_token stop_token = {});
+
+    /// @brief Drop every cached transform (e.g. after the monitor profile changed)
+    void clear();
+
+private:
+    class Transform;
+
+    ColorTransformCache() = default;
+
+    /// @brief Get the transform for a pair, building it on first use
+    [[nodiscard]] std::shared_ptr<Transform> transform(const ColorProfile& source,
+                                                       const ColorProfile& target);
+
+    std::mutex mutex_;
+    LruCache<uint64_t, std::shared_ptr<Transform>> transforms_{kMaxTransforms};
+};
+
+}  // namespace nive::image
@@ -1,15 +1,21 @@
 /// @file decoded_image.hpp
 /// @brief Decoded image data container
 ///
-/// Holds pixel data after decoding from various image formats.
+/// Holds pixel data after decoding from various image formats. ImageView is
+/// the non-owning counterpart that scalers, converters and uploads take, so
+/// crops and tiles of a larger image are passed without copying.
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <span>
 #include <vector>
 
+#include "pixel_buffer.hpp"
+
 namespace nive::image {
 
 /// @brief Pixel format enumeration
@@ -21,6 +27,8 @@ enum class PixelFormat {
     RGB24,   // 24-bit RGB
     Gray8,   // 8-bit grayscale
     Gray16,  // 16-bit grayscale
+    RGBA64,  // 64-bit RGBA, 16-bit unsigned integer channels (gamma encoded)
+    RGBA16F,  // 64-bit RGBA, half-float channels (linear scRGB: 1.0 = SDR white, may exceed it)
 };
 
 /// @brief Get bytes per pixel for a pixel format
@@ -36,6 +44,9 @@ enum class PixelFormat {
         return 1;
     case PixelFormat::Gray16:
         return 2;
+    case PixelFormat::RGBA64:
+    case PixelFormat::RGBA16F:
+        return 8;
     default:
         return 0;
     }
@@ -43,25 +54,141 @@ enum class PixelFormat {
 
 /// @brief Check if pixel format has alpha channel
 [[nodiscard]] constexpr bool hasAlpha(PixelFormat format) noexcept {
-    return format == PixelFormat::BGRA32 || format == PixelFormat::RGBA32;
+    return format == PixelFormat::BGRA32 || format == PixelFormat::RGBA32 ||
+           format == PixelFormat::RGBA64 || format == PixelFormat::RGBA16F;
+}
+
+/// @brief Check if pixel format keeps more than 8 bits per color channel
+[[nodiscard]] constexpr bool isHighPrecision(PixelFormat format) noexcept {
+    return format == PixelFormat::Gray16 || format == PixelFormat::RGBA64 ||
+           format == PixelFormat::RGBA16F;
+}
+
+/// @brief Shared, immutable pixel buffer owned outside DecodedImage (e.g. a cache entry)
+using SharedPixels = std::shared_ptr<const std::vector<uint8_t>>;
+
+/// @brief Row alignment of new images: DWORD, as GDI and WIC expect
+inline constexpr uint32_t kDefaultRowAlignment = 4;
+
+/// @brief Row alignment for SIMD kernels and GPU uploads (one cache line)
+///
+/// PixelBufferPool blocks start on this boundary, so with it every row does.
+inline constexpr uint32_t kSimdRowAlignment = 64;
+static_assert(kSimdRowAlignment <= PixelBufferPool::kAlignment);
+
+/// @brief Row pitch of width pixels, rounded up to alignment (a power of two)
+[[nodiscard]] constexpr uint32_t alignedStride(uint32_t width, PixelFormat format,
+                                               uint32_t alignment = kDefaultRowAlignment) noexcept {
+    uint32_t row_bytes = width * bytesPerPixel(format);
+    return (row_bytes + alignment - 1) & ~(alignment - 1);
 }
 
+/// @brief Read-only view of pixel rows owned elsewhere
+///
+/// A pointer, dimensions, row pitch and format; cheap to copy and never
+/// owns anything, so the pixels must outlive it. Rows are stride() bytes
+/// apart and may be wider than the view, which makes a crop or tile of a
+/// larger image a view into its buffer (see crop()).
+class ImageView {
+public:
+    constexpr ImageView() noexcept = default;
+
+    /// @param data First pixel of the first row
+    /// @param width Width in pixels
+    /// @param height Height in pixels
+    /// @param stride Bytes from one row to the next
+    /// @param format Pixel format
+    constexpr ImageView(const uint8_t* data, uint32_t width, uint32_t height, uint32_t stride,
+                        PixelFormat format) noexcept
+        : data_(data), width_(width), height_(height), stride_(stride), format_(format) {}
+
+    [[nodiscard]] constexpr bool valid() const noexcept {
+        return data_ != nullptr && width_ > 0 && height_ > 0;
+    }
+    [[nodiscard]] constexpr explicit operator bool() const noexcept { return valid(); }
+
+    [[nodiscard]] constexpr uint32_t width() const noexcept { return width_; }
+    [[nodiscard]] constexpr uint32_t height() const noexcept { return height_; }
+    [[nodiscard]] constexpr PixelFormat format() const noexcept { return format_; }
+    [[nodiscard]] constexpr uint32_t stride() const noexcept { return stride_; }
+    [[nodiscard]] constexpr const uint8_t* data() const noexcept { return data_; }
+
+    /// @brief Get the bytes from the first pixel to the end of the last row's pixels
+    ///
+    /// The last row stops at its last pixel, so a crop never reaches past
+    /// the buffer it views.
+    [[nodiscard]] constexpr size_t sizeBytes() const noexcept {
+        if (height_ == 0) {
+            return 0;
+        }
+        return static_cast<size_t>(stride_) * (height_ - 1) +
+               static_cast<size_t>(width_) * bytesPerPixel(format_);
+    }
+
+    /// @brief Get the viewed bytes (see sizeBytes)
+    [[nodiscard]] constexpr std::span<const uint8_t> pixels() const noexcept {
+        return {data_, sizeBytes()};
+    }
+
+    /// @brief Get pointer to specific row
+    /// @param row Row index (0-based)
+    [[nodiscard]] constexpr const uint8_t* row(uint32_t row) const noexcept {
+        return data_ + static_cast<size_t>(row) * stride_;
+    }
+
+    /// @brief Get a view of a rectangle, clipped to this view (no copy)
+    [[nodiscard]] constexpr ImageView crop(uint32_t x, uint32_t y, uint32_t width,
+                                           uint32_t height) const noexcept {
+        x = (std::min)(x, width_);
+        y = (std::min)(y, height_);
+        width = (std::min)(width, width_ - x);
+        height = (std::min)(height, height_ - y);
+        return {row(y) + static_cast<size_t>(x) * bytesPerPixel(format_), width, height, stride_,
+                format_};
+    }
+
+    /// @brief Check if every row starts on an alignment boundary (a power of two)
+    [[nodiscard]] bool isAligned(uint32_t alignment) const noexcept {
+        return (reinterpret_cast<uintptr_t>(data_) & (alignment - 1)) == 0 &&
+               (stride_ & (alignment - 1)) == 0;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t stride_ = 0;
+    PixelFormat format_ = PixelFormat::Unknown;
+};
+
 /// @brief Decoded image data
 ///
 /// Owns the pixel data buffer and provides access to image properties.
 /// Uses BGRA32 as the primary format for Windows compatibility.
+///
+/// The buffer may instead be shared with other owners (e.g. the thumbnail
+/// memory cache), or be part of another image's (a tile cropped from it).
+/// Read access never copies; the first mutable access on a shared buffer
+/// makes a private copy. Owned buffers come from PixelBufferPool.
+///
+/// Converts implicitly to ImageView, so functions taking a view accept a
+/// DecodedImage as well.
 class DecodedImage {
 public:
     /// @brief Construct empty image
     DecodedImage() = default;
 
-    /// @brief Construct image with dimensions and format
+    /// @brief Construct image with dimensions and format (pixels left uninitialised)
     /// @param width Image width in pixels
     /// @param height Image height in pixels
     /// @param format Pixel format
-    DecodedImage(uint32_t width, uint32_t height, PixelFormat format)
-        : width_(width), height_(height), format_(format), stride_(calculate_stride(width, format)),
-          pixels_(static_cast<size_t>(stride_) * height) {}
+    /// @param row_alignment Row pitch alignment in bytes, a power of two
+    ///        (kSimdRowAlignment for images fed to SIMD kernels or the GPU)
+    DecodedImage(uint32_t width, uint32_t height, PixelFormat format,
+                 uint32_t row_alignment = kDefaultRowAlignment)
+        : width_(width), height_(height), format_(format),
+          stride_(alignedStride(width, format, row_alignment)),
+          owned_(static_cast<size_t>(stride_) * height) {}
 
     /// @brief Construct image with existing pixel data (takes ownership)
     /// @param width Image width in pixels
@@ -70,9 +197,42 @@ public:
     /// @param stride Row stride in bytes
     /// @param pixels Pixel data (moved)
     DecodedImage(uint32_t width, uint32_t height, PixelFormat format, uint32_t stride,
-                 std::vector<uint8_t> pixels)
+                 PixelBuffer pixels)
+        : width_(width), height_(height), format_(format), stride_(stride),
+          owned_(std::move(pixels)) {}
+
+    /// @brief Construct image viewing a shared pixel buffer (no copy)
+    /// @param width Image width in pixels
+    /// @param height Image height in pixels
+    /// @param format Pixel format
+    /// @param stride Row stride in bytes
+    /// @param pixels Shared pixel data
+    DecodedImage(uint32_t width, uint32_t height, PixelFormat format, uint32_t stride,
+                 SharedPixels pixels)
         : width_(width), height_(height), format_(format), stride_(stride),
-          pixels_(std::move(pixels)) {}
+          shared_view_(*pixels), shared_(std::move(pixels)) {}
+
+    /// @brief Construct image viewing pixels kept alive by another owner (no copy)
+    /// @param view Pixels, e.g. a crop of the image owner holds
+    /// @param owner Keeps the viewed pixels alive
+    DecodedImage(ImageView view, std::shared_ptr<const void> owner)
+        : width_(view.width()), height_(view.height()), format_(view.format()),
+          stride_(view.stride()), shared_view_(view.pixels()), shared_(std::move(owner)) {}
+
+    /// @brief Copy viewed pixels into a new image of its own
+    /// @param view Pixels to copy
+    /// @param row_alignment Row pitch alignment of the copy (a power of two)
+    /// @throws std::bad_alloc when the buffer cannot be allocated
+    [[nodiscard]] static DecodedImage copyOf(ImageView view,
+                                             uint32_t row_alignment = kDefaultRowAlignment) {
+        DecodedImage copy(view.width(), view.height(), view.format(), row_alignment);
+        size_t row_bytes = static_cast<size_t>(view.width()) * bytesPerPixel(view.format());
+        for (uint32_t y = 0; y < view.height(); ++y) {
+            std::memcpy(copy.owned_.data() + static_cast<size_t>(y) * copy.stride_, view.row(y),
+                        row_bytes);
+        }
+        return copy;
+    }
 
     // Move-only type
     DecodedImage(const DecodedImage&) = delete;
@@ -84,12 +244,20 @@ public:
 
     /// @brief Check if image is valid (has data)
     [[nodiscard]] bool valid() const noexcept {
-        return width_ > 0 && height_ > 0 && !pixels_.empty();
+        return width_ > 0 && height_ > 0 && !buffer().empty();
     }
 
     /// @brief Check if image is valid
     [[nodiscard]] explicit operator bool() const noexcept { return valid(); }
 
+    /// @brief Get a view of the pixels, valid while this image is unchanged
+    [[nodiscard]] ImageView view() const noexcept {
+        return ImageView(buffer().data(), width_, height_, stride_, format_);
+    }
+
+    /// @brief View the pixels (see view())
+    [[nodiscard]] operator ImageView() const noexcept { return view(); }
+
     // Accessors
     [[nodiscard]] uint32_t width() const noexcept { return width_; }
     [[nodiscard]] uint32_t height() const noexcept { return height_; }
@@ -97,55 +265,88 @@ public:
     [[nodiscard]] uint32_t stride() const noexcept { return stride_; }
 
     /// @brief Get total size of pixel data in bytes
-    [[nodiscard]] size_t sizeBytes() const noexcept { return pixels_.size(); }
+    [[nodiscard]] size_t sizeBytes() const noexcept { return buffer().size(); }
+
+    /// @brief Check if the pixel buffer is shared with other owners
+    [[nodiscard]] bool isShared() const noexcept { return shared_ != nullptr; }
 
     /// @brief Get read-only access to pixel data
-    [[nodiscard]] std::span<const uint8_t> pixels() const noexcept { return pixels_; }
+    [[nodiscard]] std::span<const uint8_t> pixels() const noexcept { return buffer(); }
 
-    /// @brief Get mutable access to pixel data
-    [[nodiscard]] std::span<uint8_t> pixels() noexcept { return pixels_; }
+    /// @brief Get mutable access to pixel data (copies a shared buffer first)
+    [[nodiscard]] std::span<uint8_t> pixels() { return mutableBuffer(); }
 
     /// @brief Get pointer to pixel data
-    [[nodiscard]] const uint8_t* data() const noexcept { return pixels_.data(); }
+    [[nodiscard]] const uint8_t* data() const noexcept { return buffer().data(); }
 
-    /// @brief Get mutable pointer to pixel data
-    [[nodiscard]] uint8_t* data() noexcept { return pixels_.data(); }
+    /// @brief Get mutable pointer to pixel data (copies a shared buffer first)
+    [[nodiscard]] uint8_t* data() { return mutableBuffer().data(); }
 
     /// @brief Get pointer to specific row
     /// @param row Row index (0-based)
     [[nodiscard]] const uint8_t* row(uint32_t row) const noexcept {
-        return pixels_.data() + static_cast<size_t>(row) * stride_;
+        return buffer().data() + static_cast<size_t>(row) * stride_;
     }
 
-    /// @brief Get mutable pointer to specific row
+    /// @brief Get mutable pointer to specific row (copies a shared buffer first)
     /// @param row Row index (0-based)
-    [[nodiscard]] uint8_t* row(uint32_t row) noexcept {
-        return pixels_.data() + static_cast<size_t>(row) * stride_;
+    [[nodiscard]] uint8_t* row(uint32_t row) {
+        return mutableBuffer().data() + static_cast<size_t>(row) * stride_;
     }
 
-    /// @brief Release ownership of pixel data
-    [[nodiscard]] std::vector<uint8_t> release() noexcept {
+    /// @brief Get another image viewing the same pixels (no copy)
+    ///
+    /// An owned buffer becomes shared first, so both images then copy on
+    /// their first mutable access.
+    [[nodiscard]] DecodedImage share() {
+        if (!shared_) {
+            auto pixels = std::make_shared<const PixelBuffer>(std::move(owned_));
+            owned_.clear();
+            shared_view_ = *pixels;
+            shared_ = std::move(pixels);
+        }
+        DecodedImage result(width_, height_, format_, stride_, PixelBuffer{});
+        result.shared_view_ = shared_view_;
+        result.shared_ = shared_;
+        return result;
+    }
+
+    /// @brief Release ownership of pixel data (copies a shared buffer)
+    [[nodiscard]] PixelBuffer release() {
+        PixelBuffer pixels =
+            shared_ ? PixelBuffer(shared_view_.begin(), shared_view_.end()) : std::move(owned_);
         width_ = 0;
         height_ = 0;
         format_ = PixelFormat::Unknown;
         stride_ = 0;
-        return std::move(pixels_);
+        owned_.clear();
+        shared_view_ = {};
+        shared_.reset();
+        return pixels;
     }
 
 private:
-    /// @brief Calculate stride (row pitch) with 4-byte alignment
-    [[nodiscard]] static uint32_t calculate_stride(uint32_t width, PixelFormat format) noexcept {
-        uint32_t bpp = bytesPerPixel(format);
-        uint32_t row_bytes = width * bpp;
-        // Align to 4 bytes (DWORD alignment for Windows GDI)
-        return (row_bytes + 3) & ~3u;
+    [[nodiscard]] std::span<const uint8_t> buffer() const noexcept {
+        return shared_ ? shared_view_ : std::span<const uint8_t>(owned_);
+    }
+
+    /// @brief Detach from a shared buffer, then return the owned one
+    [[nodiscard]] PixelBuffer& mutableBuffer() {
+        if (shared_) {
+            owned_.assign(shared_view_.begin(), shared_view_.end());
+            shared_view_ = {};
+            shared_.reset();
+        }
+        return owned_;
     }
 
     uint32_t width_ = 0;
     uint32_t height_ = 0;
     PixelFormat format_ = PixelFormat::Unknown;
     uint32_t stride_ = 0;
-    std::vector<uint8_t> pixels_;
+    PixelBuffer owned_;
+    std::span<const uint8_t> shared_view_;  // Pixels of shared_, or part of them
+    std::shared_ptr<const void> shared_;    // Set instead of owned_ when viewing a shared buffer
 };
 
 /// @brief Image metadata (dimensions, format info)
@@ -155,6 +356,7 @@ struct ImageInfo {
     PixelFormat format = PixelFormat::Unknown;
     uint32_t frame_count = 1;  // For animated images
     bool has_alpha = false;
+    bool high_precision = false;  // More than 8 bits per channel or floating point (HDR)
     uint32_t dpi_x = 96;
     uint32_t dpi_y = 96;
 };
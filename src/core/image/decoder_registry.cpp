@@ -0,0 +1,264 @@
+/// @file decoder_registry.cpp
+/// @brief Content-based decoder selection
+
+#include "decoder_registry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <mutex>
+
+#include "../plugin/plugin_manager.hpp"
+#include "../util/extension_table.hpp"
+#include "../util/string_utils.hpp"
+#include "wic_decoder.hpp"
+
+namespace nive::image {
+
+namespace {
+
+/// @brief Extensions a format is known by, the usual one first
+struct FormatExtensions {
+    ImageFormat format;
+    std::array<std::string_view, 4> extensions;
+};
+
+constexpr std::array<FormatExtensions, 11> kFormatExtensions = {{
+    {ImageFormat::Jpeg, {"jpg", "jpeg", "jpe", "jfif"}},
+    {ImageFormat::Png, {"png"}},
+    {ImageFormat::Gif, {"gif"}},
+    {ImageFormat::Bmp, {"bmp", "dib"}},
+    {ImageFormat::Tiff, {"tif", "tiff"}},
+    {ImageFormat::Ico, {"ico"}},
+    {ImageFormat::JpegXr, {"jxr", "wdp", "hdp"}},
+    {ImageFormat::WebP, {"webp"}},
+    {ImageFormat::Avif, {"avif"}},
+    {ImageFormat::Heif, {"heic", "heif", "hif"}},
+    {ImageFormat::JpegXl, {"jxl"}},
+}};
+
+[[nodiscard]] const FormatExtensions* find_format(ImageFormat format) noexcept {
+    auto it = std::ranges::find(kFormatExtensions, format, &FormatExtensions::format);
+    return it != kFormatExtensions.end() ? &*it : nullptr;
+}
+
+// Every extension of kFormatExtensions, for lookups that do not scan the lists;
+// keep the two in step
+constexpr auto kExtensionFormats = makeExtensionTable<ImageFormat>({
+    {"jpg", ImageFormat::Jpeg},   {"jpeg", ImageFormat::Jpeg},  {"jpe", ImageFormat::Jpeg},
+    {"jfif", ImageFormat::Jpeg},  {"png", ImageFormat::Png},    {"gif", ImageFormat::Gif},
+    {"bmp", ImageFormat::Bmp},    {"dib", ImageFormat::Bmp},    {"tif", ImageFormat::Tiff},
+    {"tiff", ImageFormat::Tiff},  {"ico", ImageFormat::Ico},    {"jxr", ImageFormat::JpegXr},
+    {"wdp", ImageFormat::JpegXr}, {"hdp", ImageFormat::JpegXr}, {"webp", ImageFormat::WebP},
+    {"avif", ImageFormat::Avif},  {"heic", ImageFormat::Heif},  {"heif", ImageFormat::Heif},
+    {"hif", ImageFormat::Heif},   {"jxl", ImageFormat::JpegXl},
+});
+
+[[nodiscard]] bool known_as(const FormatExtensions& entry, std::string_view extension) noexcept {
+    const ImageFormat* format = kExtensionFormats.find(extension);
+    return format && *format == entry.format;
+}
+
+/// @brief Check if an extension belongs to any format sniffFormat() recognises
+[[nodiscard]] bool known_extension(std::string_view extension) noexcept {
+    return kExtensionFormats.contains(extension);
+}
+
+[[nodiscard]] bool starts_with(std::span<const uint8_t> data, std::string_view magic,
+                               size_t offset = 0) noexcept {
+    return data.size() >= offset + magic.size() &&
+           std::memcmp(data.data() + offset, magic.data(), magic.size()) == 0;
+}
+
+/// @brief Tell AVIF from other HEIF files by the brands of an ISO BMFF 'ftyp' box
+[[nodiscard]] ImageFormat sniff_heif(std::span<const uint8_t> data) noexcept {
+    static constexpr std::string_view kHeifBrands[] = {"heic", "heix", "hevc", "hevx",
+                                                       "heim", "heis", "mif1", "msf1"};
+
+    size_t box_size = (static_cast<size_t>(data[0]) << 24) | (static_cast<size_t>(data[1]) << 16) |
+                      (static_cast<size_t>(data[2]) << 8) | data[3];
+    size_t end = std::min(box_size, data.size());
+
+    // Major brand at 8, minor version at 12, compatible brands from 16
+    bool heif = false;
+    for (size_t offset = 8; offset + 4 <= end; offset += offset == 8 ? 8 : 4) {
+        std::string_view brand(reinterpret_cast<const char*>(data.data() + offset), 4);
+        if (brand == "avif" || brand == "avis") {
+            return ImageFormat::Avif;
+        }
+        heif = heif || std::ranges::find(kHeifBrands, brand) != std::end(kHeifBrands);
+    }
+    return heif ? ImageFormat::Heif : ImageFormat::Unknown;
+}
+
+/// @brief Lowercase an extension and drop its leading dot
+[[nodiscard]] std::string normalize_extension(std::string_view extension) {
+    if (extension.starts_with('.')) {
+        extension.remove_prefix(1);
+    }
+    return toLowercaseAscii(extension);
+}
+
+}  // namespace
+
+ImageFormat sniffFormat(std::span<const uint8_t> header) noexcept {
+    if (starts_with(header, "\xFF\xD8\xFF")) {
+        return ImageFormat::Jpeg;
+    }
+    if (starts_with(header, "\x89PNG\r\n\x1A\n")) {
+        return ImageFormat::Png;
+    }
+    if (starts_with(header, "GIF87a") || starts_with(header, "GIF89a")) {
+        return ImageFormat::Gif;
+    }
+    if (starts_with(header, std::string_view("II*\0", 4)) ||
+        starts_with(header, std::string_view("MM\0*", 4))) {
+        return ImageFormat::Tiff;
+    }
+    if (starts_with(header, "II\xBC")) {
+        return ImageFormat::JpegXr;
+    }
+    if (starts_with(header, "RIFF") && starts_with(header, "WEBP", 8)) {
+        return ImageFormat::WebP;
+    }
+    if (starts_with(header, "ftyp", 4)) {
+        return sniff_heif(header);
+    }
+    if (starts_with(header, "\xFF\x0A") ||
+        starts_with(header, std::string_view("\0\0\0\x0CJXL \r\n\x87\n", 12))) {
+        return ImageFormat::JpegXl;
+    }
+    // Reserved zero, type 1, at least one image
+    if (starts_with(header, std::string_view("\0\0\1\0", 4)) && header.size() >= 6 &&
+        (header[4] != 0 || header[5] != 0)) {
+        return ImageFormat::Ico;
+    }
+    if (starts_with(header, "BM")) {
+        return ImageFormat::Bmp;
+    }
+    return ImageFormat::Unknown;
+}
+
+DecoderRegistry::DecoderRegistry(plugin::PluginManager* plugins) : plugins_(plugins) {
+}
+
+const DecoderRegistry& DecoderRegistry::builtin() {
+    static const DecoderRegistry registry;
+    return registry;
+}
+
+DecoderChoice DecoderRegistry::choose(std::span<const uint8_t> data,
+                                      std::string_view extension) const {
+    ImageFormat format = sniffFormat(data.first(std::min(data.size(), kSniffBytes)));
+    std::string ext = normalize_extension(extension);
+    std::string key = std::format("{}:{}", ext, static_cast<int>(format));
+    uint64_t generation = plugins_ ? plugins_->generation() : 0;
+
+    {
+        std::shared_lock lock(mutex_);
+        if (generation == plugin_generation_) {
+            if (auto it = choices_.find(key); it != choices_.end()) {
+                return it->second;
+            }
+        }
+    }
+
+    DecoderChoice choice = resolve(format, ext);
+
+    std::unique_lock lock(mutex_);
+    if (generation != plugin_generation_) {
+        choices_.clear();
+        plugin_generation_ = generation;
+    }
+    choices_.emplace(std::move(key), choice);
+    return choice;
+}
+
+DecoderChoice DecoderRegistry::choose(const std::filesystem::path& path) const {
+    std::array<uint8_t, kSniffBytes> header{};
+    std::ifstream file(path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(header.data()), header.size());
+    auto length = static_cast<size_t>(std::max<std::streamsize>(file.gcount(), 0));
+    return choose(std::span<const uint8_t>(header.data(), length), pathToUtf8(path.extension()));
+}
+
+DecoderChoice DecoderRegistry::resolve(ImageFormat format, const std::string& extension) const {
+    DecoderChoice choice;
+    choice.format = format;
+    const FormatExtensions* entry = find_format(format);
+
+    // Ask plugins about the extension the content calls for. The file's own
+    // extension stands when it agrees with the content, when the content is
+    // not recognised, and for TIFF containers under an extension of their
+    // own (camera raw formats).
+    std::string_view plugin_ext = extension;
+    if (entry && !known_as(*entry, extension) &&
+        (format != ImageFormat::Tiff || known_extension(extension))) {
+        plugin_ext = entry->extensions.front();
+    }
+    if (plugins_ && !plugin_ext.empty()) {
+        std::string dotted = std::format(".{}", plugin_ext);
+        if (plugins_->supportsExtension(dotted)) {
+            choice.kind = DecoderKind::Plugin;
+            choice.plugin_extension = std::move(dotted);
+            return choice;
+        }
+    }
+
+    if (entry) {
+        if (const NativeDecoder* native = nativeDecoderFor(entry->extensions.front())) {
+            choice.kind = DecoderKind::Native;
+            choice.native = native;
+            return choice;
+        }
+    }
+
+    choice.kind = DecoderKind::Wic;
+    return choice;
+}
+
+std::expected<ImageInfo, DecodeError>
+DecoderRegistry::getInfo(std::span<const uint8_t> data, const DecoderChoice& choice) const {
+    if (choice.kind == DecoderKind::Plugin && plugins_) {
+        const std::string& ext = choice.plugin_extension;
+        if (auto info = plugins_->getImageInfo(data.data(), data.size(), ext)) {
+            return *info;
+        }
+    } else if (choice.kind == DecoderKind::Native && choice.native) {
+        if (auto info = choice.native->getInfoFromMemory(data)) {
+            return info;
+        }
+    }
+
+    WicDecoder wic;
+    if (!wic.isAvailable()) {
+        return std::unexpected(DecodeError::DecoderNotAvailable);
+    }
+    return wic.getInfoFromMemory(data);
+}
+
+std::expected<DecodedImage, DecodeError>
+DecoderRegistry::decode(std::span<const uint8_t> data, const DecoderChoice& choice,
+                        PixelFormat target_format) const {
+    if (choice.kind == DecoderKind::Plugin && plugins_) {
+        const std::string& ext = choice.plugin_extension;
+        if (auto image = plugins_->decode(data.data(), data.size(), ext, target_format)) {
+            return std::move(*image);
+        }
+    } else if (choice.kind == DecoderKind::Native && choice.native) {
+        // The built-in codecs write BGRA32 only; other targets go to WIC
+        if (auto image = choice.native->decodeFromMemory(data, target_format)) {
+            return image;
+        }
+    }
+
+    WicDecoder wic;
+    if (!wic.isAvailable()) {
+        return std::unexpected(DecodeError::DecoderNotAvailable);
+    }
+    return wic.decodeFromMemory(data, target_format);
+}
+
+}  // namespace nive::image
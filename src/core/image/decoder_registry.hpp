@@ -0,0 +1,136 @@
+/// @file decoder_registry.hpp
+/// @brief Decoder choice from an image's content
+///
+/// A file's first bytes say what it is whatever it is called. The registry
+/// sniffs them once and routes the image to a plugin, a built-in codec or
+/// WIC, so a misnamed file goes straight to the decoder that can read it
+/// instead of failing in the one its extension points at first. The
+/// thumbnail generator and the viewer share one instance.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+#include "native_decoder.hpp"
+
+namespace nive::plugin {
+class PluginManager;
+}
+
+namespace nive::image {
+
+/// @brief Image format recognised from magic bytes
+enum class ImageFormat {
+    Unknown,
+    Jpeg,
+    Png,
+    Gif,
+    Bmp,
+    Tiff,  // Also the container of most camera raw formats
+    Ico,
+    JpegXr,
+    WebP,
+    Avif,
+    Heif,
+    JpegXl,
+};
+
+/// @brief Identify an image format from the start of a file
+/// @param header First DecoderRegistry::kSniffBytes bytes (fewer if the file is shorter)
+[[nodiscard]] ImageFormat sniffFormat(std::span<const uint8_t> header) noexcept;
+
+/// @brief Kind of decoder an image is routed to
+enum class DecoderKind {
+    Plugin,
+    Native,  // Built-in codec (NativeDecoder)
+    Wic,
+};
+
+/// @brief Decoder picked for an image
+struct DecoderChoice {
+    DecoderKind kind = DecoderKind::Wic;
+    ImageFormat format = ImageFormat::Unknown;
+    const NativeDecoder* native = nullptr;  // Set for DecoderKind::Native
+    std::string plugin_extension;           // For DecoderKind::Plugin, e.g. ".avif"
+};
+
+/// @brief Picks decoders by content, remembering the choice per extension and format
+///
+/// Plugins keep priority for the formats they claim, as before, but are
+/// asked about the extension the content calls for rather than the file's
+/// own: a JPEG named .avif goes to the JPEG decoders, not the AVIF plugin.
+/// Content that is not recognised (and TIFF-based raw files) is routed by
+/// extension. Cached choices are dropped whenever plugins are loaded or
+/// unloaded.
+///
+/// Thread-safe: yes
+class DecoderRegistry {
+public:
+    /// @brief Bytes of a file that sniffFormat() looks at
+    static constexpr size_t kSniffBytes = 64;
+
+    /// @brief Construct a registry
+    /// @param plugins Plugin manager (can be nullptr to route to built-in decoders only)
+    explicit DecoderRegistry(plugin::PluginManager* plugins = nullptr);
+
+    DecoderRegistry(const DecoderRegistry&) = delete;
+    DecoderRegistry& operator=(const DecoderRegistry&) = delete;
+
+    /// @brief Get a process-wide registry without plugins
+    [[nodiscard]] static const DecoderRegistry& builtin();
+
+    /// @brief Pick the decoder for an image
+    /// @param data Start of the image (only the first kSniffBytes are read)
+    /// @param extension File extension, with or without the leading dot, any case
+    [[nodiscard]] DecoderChoice choose(std::span<const uint8_t> data,
+                                       std::string_view extension) const;
+
+    /// @brief Pick the decoder for an image file, reading its first kSniffBytes
+    [[nodiscard]] DecoderChoice choose(const std::filesystem::path& path) const;
+
+    /// @brief Decode an image at full size through the chosen decoder
+    /// @param data Whole encoded image
+    /// @param choice Result of choose() for the same image
+    /// @param target_format BGRA32, or RGBA64 / RGBA16F to keep high-precision sources so
+    /// @return Image or error; WIC is tried when a plugin or built-in codec fails
+    ///
+    /// A high-precision target is a preference: 8-bit plugin output comes
+    /// back as BGRA32. Must be called on a thread with COM
+    /// initialised.
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decode(std::span<const uint8_t> data, const DecoderChoice& choice,
+           PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Read image metadata through the chosen decoder, without decoding pixels
+    /// @param data Whole encoded image (built-in codecs and WIC read only the header)
+    /// @param choice Result of choose() for the same image
+    /// @return Information, from WIC when the plugin cannot report it
+    ///
+    /// Must be called on a thread with COM initialised.
+    [[nodiscard]] std::expected<ImageInfo, DecodeError>
+    getInfo(std::span<const uint8_t> data, const DecoderChoice& choice) const;
+
+    /// @brief Get the plugin manager (can be nullptr)
+    [[nodiscard]] plugin::PluginManager* plugins() const noexcept { return plugins_; }
+
+private:
+    [[nodiscard]] DecoderChoice resolve(ImageFormat format, const std::string& extension) const;
+
+    plugin::PluginManager* plugins_;
+
+    // Choices keyed by "<extension>:<format>", valid for plugin_generation_
+    mutable std::shared_mutex mutex_;
+    mutable std::unordered_map<std::string, DecoderChoice> choices_;
+    mutable uint64_t plugin_generation_ = 0;
+};
+
+}  // namespace nive::image
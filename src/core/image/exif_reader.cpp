@@ -0,0 +1,364 @@
+/// @file exif_reader.cpp
+/// @brief JPEG APP1 and TIFF IFD walker for the capture tags
+
+#include "exif_reader.hpp"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "../util/string_utils.hpp"
+#include "../util/win32_utils.hpp"
+
+namespace nive::image {
+
+namespace {
+
+// IFD0 tags
+constexpr uint16_t kTagMake = 0x010F;
+constexpr uint16_t kTagModel = 0x0110;
+constexpr uint16_t kTagDateTime = 0x0132;
+constexpr uint16_t kTagExifIfd = 0x8769;
+
+// Exif IFD tags
+constexpr uint16_t kTagDateTimeOriginal = 0x9003;
+constexpr uint16_t kTagDateTimeDigitized = 0x9004;
+constexpr uint16_t kTagSubSecTime = 0x9290;
+constexpr uint16_t kTagSubSecTimeOriginal = 0x9291;
+constexpr uint16_t kTagSubSecTimeDigitized = 0x9292;
+
+// TIFF field types
+constexpr uint16_t kTypeAscii = 2;
+constexpr uint16_t kTypeLong = 4;
+constexpr uint16_t kTypeIfd = 13;
+
+constexpr size_t kIfdEntrySize = 12;
+
+// JPEG markers
+constexpr uint8_t kMarkerApp1 = 0xE1;
+constexpr uint8_t kMarkerSos = 0xDA;
+constexpr uint8_t kMarkerEoi = 0xD9;
+
+constexpr std::array<uint8_t, 6> kExifSignature{'E', 'x', 'i', 'f', 0, 0};
+
+/// @brief Bounds-checked reads from a TIFF block in its byte order
+class TiffReader {
+public:
+    TiffReader(std::span<const uint8_t> data, bool little_endian) noexcept
+        : data_(data), little_endian_(little_endian) {}
+
+    [[nodiscard]] std::optional<uint16_t> u16(size_t offset) const noexcept {
+        if (offset > data_.size() || data_.size() - offset < 2) {
+            return std::nullopt;
+        }
+        uint16_t a = data_[offset];
+        uint16_t b = data_[offset + 1];
+        return static_cast<uint16_t>(little_endian_ ? a | (b << 8) : (a << 8) | b);
+    }
+
+    [[nodiscard]] std::optional<uint32_t> u32(size_t offset) const noexcept {
+        auto first = u16(offset);
+        auto second = u16(offset + 2);
+        if (!first || !second) {
+            return std::nullopt;
+        }
+        return little_endian_ ? (static_cast<uint32_t>(*second) << 16) | *first
+                              : (static_cast<uint32_t>(*first) << 16) | *second;
+    }
+
+    /// @brief Bytes of a field, inline in the entry when they fit in four
+    [[nodiscard]] std::span<const uint8_t> value(size_t entry, uint32_t length) const noexcept {
+        size_t offset = entry + 8;
+        if (length > 4) {
+            auto pointer = u32(offset);
+            if (!pointer) {
+                return {};
+            }
+            offset = *pointer;
+        }
+        if (offset > data_.size() || data_.size() - offset < length) {
+            return {};
+        }
+        return data_.subspan(offset, length);
+    }
+
+private:
+    std::span<const uint8_t> data_;
+    bool little_endian_;
+};
+
+/// @brief One IFD's worth of the tags of interest
+struct IfdTags {
+    std::string make;
+    std::string model;
+    std::string date_time;
+    std::string sub_sec;
+    std::optional<uint32_t> exif_ifd;
+};
+
+/// @brief Get an ASCII field's text without its terminator and padding
+[[nodiscard]] std::string ascii_text(std::span<const uint8_t> bytes) {
+    std::string text(bytes.begin(), bytes.end());
+    if (auto nul = text.find('\0'); nul != std::string::npos) {
+        text.resize(nul);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.pop_back();
+    }
+    size_t start = text.find_first_not_of(" \t");
+    return start == std::string::npos ? std::string() : text.substr(start);
+}
+
+/// @brief Collect the tags of interest from the IFD at an offset
+[[nodiscard]] IfdTags read_ifd(const TiffReader& reader, uint32_t offset) {
+    IfdTags tags;
+    auto count = reader.u16(offset);
+    if (!count) {
+        return tags;
+    }
+    for (uint16_t i = 0; i < *count; ++i) {
+        size_t entry = offset + 2 + size_t{i} * kIfdEntrySize;
+        auto tag = reader.u16(entry);
+        auto type = reader.u16(entry + 2);
+        auto length = reader.u32(entry + 4);
+        if (!tag || !type || !length) {
+            break;  // Entry runs past the bytes read
+        }
+
+        if (*type == kTypeAscii) {
+            std::string* target = nullptr;
+            switch (*tag) {
+            case kTagMake:
+                target = &tags.make;
+                break;
+            case kTagModel:
+                target = &tags.model;
+                break;
+            case kTagDateTime:
+            case kTagDateTimeOriginal:
+            case kTagDateTimeDigitized:
+                // Original beats digitized beats the IFD0 modification time
+                if (*tag == kTagDateTimeOriginal || tags.date_time.empty()) {
+                    target = &tags.date_time;
+                }
+                break;
+            case kTagSubSecTime:
+            case kTagSubSecTimeOriginal:
+            case kTagSubSecTimeDigitized:
+                if (*tag == kTagSubSecTimeOriginal || tags.sub_sec.empty()) {
+                    target = &tags.sub_sec;
+                }
+                break;
+            default:
+                break;
+            }
+            if (target) {
+                *target = ascii_text(reader.value(entry, *length));
+            }
+        } else if (*tag == kTagExifIfd && (*type == kTypeLong || *type == kTypeIfd)) {
+            tags.exif_ifd = reader.u32(entry + 8);
+        }
+    }
+    return tags;
+}
+
+/// @brief Parse "YYYY:MM:DD HH:MM:SS" plus optional fractional digits
+[[nodiscard]] std::optional<std::chrono::system_clock::time_point>
+parse_date_time(std::string_view text, std::string_view sub_sec) {
+    if (text.size() < 19) {
+        return std::nullopt;
+    }
+    auto number = [text](size_t offset, size_t digits) -> std::optional<int> {
+        int value = 0;
+        for (size_t i = offset; i < offset + digits; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                return std::nullopt;
+            }
+            value = value * 10 + (text[i] - '0');
+        }
+        return value;
+    };
+    auto year = number(0, 4);
+    auto month = number(5, 2);
+    auto day = number(8, 2);
+    auto hour = number(11, 2);
+    auto minute = number(14, 2);
+    auto second = number(17, 2);
+    if (!year || !month || !day || !hour || !minute || !second || *hour > 23 || *minute > 59 ||
+        *second > 60) {
+        return std::nullopt;
+    }
+
+    // Unset clocks write zeros, which is not a date
+    std::chrono::year_month_day date{std::chrono::year(*year),
+                                     std::chrono::month(static_cast<unsigned>(*month)),
+                                     std::chrono::day(static_cast<unsigned>(*day))};
+    if (*year == 0 || !date.ok()) {
+        return std::nullopt;
+    }
+
+    auto time = std::chrono::sys_days(date) + std::chrono::hours(*hour) +
+                std::chrono::minutes(*minute) + std::chrono::seconds(*second);
+
+    // Bursts shot within one second are told apart by the sub-second field
+    std::chrono::microseconds fraction{0};
+    int64_t scale = 100000;
+    for (char c : sub_sec) {
+        if (c < '0' || c > '9' || scale == 0) {
+            break;
+        }
+        fraction += std::chrono::microseconds((c - '0') * scale);
+        scale /= 10;
+    }
+
+    return std::chrono::time_point_cast<std::chrono::system_clock::duration>(time + fraction);
+}
+
+/// @brief Decode tag text: UTF-8 where valid, else one character per byte
+[[nodiscard]] std::wstring widen(std::string_view text) {
+    if (auto wide = utf8ToWide(text)) {
+        return std::move(*wide);
+    }
+    std::wstring wide;
+    wide.reserve(text.size());
+    for (char c : text) {
+        wide.push_back(static_cast<wchar_t>(static_cast<unsigned char>(c)));
+    }
+    return wide;
+}
+
+/// @brief Name a camera by model, adding the maker's first word when the model lacks it
+[[nodiscard]] std::wstring camera_name(std::string_view make, std::string_view model) {
+    std::string_view brand = make.substr(0, make.find(' '));
+    if (model.empty()) {
+        return widen(brand);
+    }
+    if (brand.empty() ||
+        toLowercaseAscii(model.substr(0, brand.size())) == toLowercaseAscii(brand)) {
+        return widen(model);
+    }
+    std::string name(brand);
+    name.push_back(' ');
+    name.append(model);
+    return widen(name);
+}
+
+/// @brief Parse a TIFF block (the TIFF header onwards)
+[[nodiscard]] std::optional<CaptureInfo> parse_tiff(std::span<const uint8_t> tiff) {
+    if (tiff.size() < 8) {
+        return std::nullopt;
+    }
+    bool little_endian = false;
+    if (tiff[0] == 'I' && tiff[1] == 'I') {
+        little_endian = true;
+    } else if (tiff[0] != 'M' || tiff[1] != 'M') {
+        return std::nullopt;
+    }
+    TiffReader reader(tiff, little_endian);
+    auto magic = reader.u16(2);
+    auto ifd0_offset = reader.u32(4);
+    if (!magic || *magic != 42 || !ifd0_offset) {
+        return std::nullopt;
+    }
+
+    IfdTags ifd0 = read_ifd(reader, *ifd0_offset);
+    IfdTags exif;
+    if (ifd0.exif_ifd && *ifd0.exif_ifd != *ifd0_offset) {
+        exif = read_ifd(reader, *ifd0.exif_ifd);
+    }
+
+    CaptureInfo info;
+    if (!exif.date_time.empty()) {
+        info.date_taken = parse_date_time(exif.date_time, exif.sub_sec);
+    }
+    if (!info.date_taken && !ifd0.date_time.empty()) {
+        info.date_taken = parse_date_time(ifd0.date_time, ifd0.sub_sec);
+    }
+    info.camera_model = camera_name(ifd0.make, ifd0.model);
+    return info;
+}
+
+/// @brief Find the EXIF block among a JPEG's segments, before the scan data
+[[nodiscard]] std::optional<CaptureInfo> parse_jpeg(std::span<const uint8_t> jpeg) {
+    size_t pos = 2;  // After SOI
+    while (pos + 4 <= jpeg.size()) {
+        if (jpeg[pos] != 0xFF) {
+            return std::nullopt;
+        }
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            ++pos;  // Fill byte
+            continue;
+        }
+        pos += 2;
+        if (marker == kMarkerSos || marker == kMarkerEoi) {
+            return std::nullopt;
+        }
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            continue;  // Standalone markers have no length
+        }
+
+        size_t length = (size_t{jpeg[pos]} << 8) | jpeg[pos + 1];
+        if (length < 2) {
+            return std::nullopt;
+        }
+        size_t body = pos + 2;
+        size_t body_length = std::min(length - 2, jpeg.size() - std::min(body, jpeg.size()));
+        if (marker == kMarkerApp1 && body_length >= kExifSignature.size() &&
+            std::memcmp(jpeg.data() + body, kExifSignature.data(), kExifSignature.size()) == 0) {
+            return parse_tiff(jpeg.subspan(body + kExifSignature.size(),
+                                           body_length - kExifSignature.size()));
+        }
+        pos += length;
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+bool mayHaveCaptureInfo(std::wstring_view extension) noexcept {
+    // JPEG, TIFF, and the raw formats that are TIFF files underneath
+    constexpr std::array<std::wstring_view, 13> kExtensions{
+        L".jpg", L".jpeg", L".jpe", L".jfif", L".tif", L".tiff", L".dng",
+        L".nef", L".nrw",  L".cr2", L".arw",  L".pef", L".srw",
+    };
+    if (extension.size() > 6) {
+        return false;
+    }
+    std::array<wchar_t, 6> lower{};
+    for (size_t i = 0; i < extension.size(); ++i) {
+        wchar_t c = extension[i];
+        lower[i] = (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c - L'A' + L'a') : c;
+    }
+    std::wstring_view key(lower.data(), extension.size());
+    return std::find(kExtensions.begin(), kExtensions.end(), key) != kExtensions.end();
+}
+
+std::optional<CaptureInfo> parseCaptureInfo(std::span<const uint8_t> header) {
+    if (header.size() >= 2 && header[0] == 0xFF && header[1] == 0xD8) {
+        return parse_jpeg(header);
+    }
+    return parse_tiff(header);
+}
+
+std::optional<CaptureInfo> readCaptureInfo(const std::filesystem::path& path) {
+    HandleGuard file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // One read: the header is small enough that asking for less saves nothing
+    std::vector<uint8_t> header(kExifHeaderBytes);
+    DWORD read = 0;
+    if (!ReadFile(file.get(), header.data(), static_cast<DWORD>(header.size()), &read, nullptr)) {
+        return std::nullopt;
+    }
+    header.resize(read);
+    return parseCaptureInfo(header);
+}
+
+}  // namespace nive::image
@@ -0,0 +1,55 @@
+/// @file exif_reader.hpp
+/// @brief Capture date and camera from the EXIF block of a file's header
+///
+/// Only the first bytes of a file are read: the EXIF block of a JPEG sits in
+/// its APP1 segment before any image data, and TIFF-based files (including
+/// DNG and most camera raws) keep IFD0 and the Exif IFD near the start.
+/// Nothing is decoded, so a folder's worth of files is parsed in the time
+/// one thumbnail takes to decode.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace nive::image {
+
+/// @brief Bytes read from the start of a file for its EXIF block
+///
+/// Covers a JPEG APP1 segment (at most 64 KiB) behind an APP0 segment.
+inline constexpr size_t kExifHeaderBytes = 128 * 1024;
+
+/// @brief When and with what a picture was taken
+struct CaptureInfo {
+    // DateTimeOriginal (else DateTimeDigitized, else DateTime) with its
+    // sub-second field, as recorded: camera wall-clock time read as UTC
+    std::optional<std::chrono::system_clock::time_point> date_taken;
+
+    // Model, prefixed with the maker's name when the model does not start with it
+    std::wstring camera_model;
+
+    [[nodiscard]] bool operator==(const CaptureInfo&) const = default;
+};
+
+/// @brief Check if files with an extension can carry an EXIF block this reader parses
+/// @param extension Extension with the dot, any case
+[[nodiscard]] bool mayHaveCaptureInfo(std::wstring_view extension) noexcept;
+
+/// @brief Parse the capture info from the start of a JPEG or TIFF file
+/// @param header First bytes of the file; tags past its end are not found
+/// @return Capture info (either field may be empty), or nullopt if the bytes
+///         are neither format or hold no EXIF block
+[[nodiscard]] std::optional<CaptureInfo> parseCaptureInfo(std::span<const uint8_t> header);
+
+/// @brief Read the capture info of a file
+/// @param path File to read; at most kExifHeaderBytes are read
+/// @return Capture info, or nullopt if the file cannot be read or has none
+[[nodiscard]] std::optional<CaptureInfo> readCaptureInfo(const std::filesystem::path& path);
+
+}  // namespace nive::image
@@ -25,6 +25,7 @@ enum class DecodeError {
     OutOfMemory,
     DecoderNotAvailable,
     InternalError,
+    Cancelled,  // Stop was requested through the caller's stop_token
 };
 
 /// @brief Get string representation of decode error
@@ -44,6 +45,8 @@ enum class DecodeError {
         return "Decoder not available";
     case DecodeError::InternalError:
         return "Internal decoder error";
+    case DecodeError::Cancelled:
+        return "Decoding cancelled";
     }
     return "Unknown decode error";
 }
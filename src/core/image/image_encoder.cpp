@@ -0,0 +1,128 @@
+/// @file image_encoder.cpp
+/// @brief WIC image encoding implementation
+
+#include "image_encoder.hpp"
+
+#include <Windows.h>
+
+#include <wincodec.h>
+
+#include <algorithm>
+
+#include "../util/com_ptr.hpp"
+#include "../util/logger.hpp"
+#include "../util/win32_utils.hpp"
+#include "wic_factory.hpp"
+
+namespace nive::image {
+
+std::expected<std::vector<uint8_t>, EncodeError> encodeJpeg(ImageView image, int quality) {
+    if (image.format() != PixelFormat::BGRA32 || !image.valid()) {
+        return std::unexpected(EncodeError::UnsupportedFormat);
+    }
+
+    // Callers may be on threads that never touched COM (e.g. parallel decode)
+    ComInitializer com(COINIT_MULTITHREADED);
+
+    IWICImagingFactory* factory = wicFactory();
+    if (!factory) {
+        return std::unexpected(EncodeError::EncoderNotAvailable);
+    }
+
+    // Wraps the rows where they are; the encoder only reads them
+    ComPtr<IWICBitmap> bitmap;
+    HRESULT hr = factory->CreateBitmapFromMemory(
+        image.width(), image.height(), GUID_WICPixelFormat32bppBGRA, image.stride(),
+        static_cast<UINT>(image.sizeBytes()), const_cast<BYTE*>(image.data()), &bitmap);
+    if (FAILED(hr)) {
+        return std::unexpected(hr == E_OUTOFMEMORY ? EncodeError::OutOfMemory
+                                                   : EncodeError::EncodingFailed);
+    }
+
+    ComPtr<IStream> stream;
+    if (FAILED(CreateStreamOnHGlobal(nullptr, TRUE, &stream))) {
+        return std::unexpected(EncodeError::OutOfMemory);
+    }
+
+    ComPtr<IWICBitmapEncoder> encoder;
+    hr = factory->CreateEncoder(GUID_ContainerFormatJpeg, nullptr, &encoder);
+    if (FAILED(hr)) {
+        return std::unexpected(EncodeError::EncoderNotAvailable);
+    }
+    hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
+
+    ComPtr<IWICBitmapFrameEncode> frame;
+    ComPtr<IPropertyBag2> props;
+    if (SUCCEEDED(hr)) {
+        hr = encoder->CreateNewFrame(&frame, &props);
+    }
+
+    if (SUCCEEDED(hr)) {
+        PROPBAG2 option{};
+        option.pstrName = const_cast<LPOLESTR>(L"ImageQuality");
+        VARIANT value{};
+        value.vt = VT_R4;
+        value.fltVal = static_cast<float>(std::clamp(quality, 1, 100)) / 100.0f;
+        hr = props->Write(1, &option, &value);
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = frame->Initialize(props.Get());
+    }
+    if (SUCCEEDED(hr)) {
+        hr = frame->SetSize(image.width(), image.height());
+    }
+
+    // The JPEG encoder takes 24bpp BGR; convert from BGRA if it insists
+    WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+    if (SUCCEEDED(hr)) {
+        hr = frame->SetPixelFormat(&format);
+    }
+
+    ComPtr<IWICBitmapSource> source = bitmap;
+    if (SUCCEEDED(hr) && !IsEqualGUID(format, GUID_WICPixelFormat32bppBGRA)) {
+        ComPtr<IWICFormatConverter> converter;
+        hr = factory->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr)) {
+            hr = converter->Initialize(bitmap.Get(), format, WICBitmapDitherTypeNone, nullptr,
+                                       0.0, WICBitmapPaletteTypeCustom);
+        }
+        if (SUCCEEDED(hr)) {
+            source = converter;
+        }
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = frame->WriteSource(source.Get(), nullptr);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = frame->Commit();
+    }
+    if (SUCCEEDED(hr)) {
+        hr = encoder->Commit();
+    }
+    if (FAILED(hr)) {
+        LOG_DEBUG("JPEG encode failed: 0x{:08x}", static_cast<uint32_t>(hr));
+        return std::unexpected(hr == E_OUTOFMEMORY ? EncodeError::OutOfMemory
+                                                   : EncodeError::EncodingFailed);
+    }
+
+    // Copy the encoded stream out
+    STATSTG stat{};
+    if (FAILED(stream->Stat(&stat, STATFLAG_NONAME))) {
+        return std::unexpected(EncodeError::EncodingFailed);
+    }
+    std::vector<uint8_t> encoded(static_cast<size_t>(stat.cbSize.QuadPart));
+
+    LARGE_INTEGER zero{};
+    stream->Seek(zero, STREAM_SEEK_SET, nullptr);
+    ULONG read = 0;
+    hr = stream->Read(encoded.data(), static_cast<ULONG>(encoded.size()), &read);
+    if (FAILED(hr) || read != encoded.size()) {
+        return std::unexpected(EncodeError::EncodingFailed);
+    }
+
+    return encoded;
+}
+
+}  // namespace nive::image
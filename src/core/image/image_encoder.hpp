@@ -0,0 +1,47 @@
+/// @file image_encoder.hpp
+/// @brief Encoding decoded images to files through WIC
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string_view>
+#include <vector>
+
+#include "decoded_image.hpp"
+
+namespace nive::image {
+
+/// @brief Image encoding errors
+enum class EncodeError {
+    UnsupportedFormat,    // Pixel format the encoder cannot take
+    EncoderNotAvailable,  // WIC or its JPEG encoder could not be created
+    OutOfMemory,
+    EncodingFailed,
+};
+
+/// @brief Get string representation of encode error
+[[nodiscard]] constexpr std::string_view to_string(EncodeError error) noexcept {
+    switch (error) {
+    case EncodeError::UnsupportedFormat:
+        return "Unsupported pixel format";
+    case EncodeError::EncoderNotAvailable:
+        return "Encoder not available";
+    case EncodeError::OutOfMemory:
+        return "Out of memory";
+    case EncodeError::EncodingFailed:
+        return "Encoding failed";
+    }
+    return "Unknown encode error";
+}
+
+/// @brief Encode an image as baseline JPEG
+/// @param image BGRA32 pixels; alpha is dropped, so composite translucent images first
+/// @param quality 1 (smallest) to 100 (best)
+/// @return JPEG file contents
+///
+/// Initialises COM on the calling thread if it has not been.
+[[nodiscard]] std::expected<std::vector<uint8_t>, EncodeError> encodeJpeg(ImageView image,
+                                                                          int quality);
+
+}  // namespace nive::image
@@ -8,8 +8,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <optional>
 
 #include "../util/com_ptr.hpp"
+#include "../util/thread_pool.hpp"
+#include "resampler.hpp"
+#include "wic_factory.hpp"
 
 #pragma comment(lib, "windowscodecs.lib")
 
@@ -17,6 +21,10 @@ namespace nive::image {
 
 namespace {
 
+// Output rows are produced in bands of about this size so a cancelled scale
+// stops between bands
+constexpr size_t kScaleBandBytes = 1024 * 1024;
+
 /// @brief Convert ScaleMode to WIC interpolation mode
 WICBitmapInterpolationMode to_wic_interpolation(ScaleMode mode) {
     switch (mode) {
@@ -29,12 +37,30 @@ WICBitmapInterpolationMode to_wic_interpolation(ScaleMode mode) {
     case ScaleMode::HighQualityCubic:
         return WICBitmapInterpolationModeHighQualityCubic;
     case ScaleMode::Fant:
+    case ScaleMode::Box:
+    case ScaleMode::Area:
         return WICBitmapInterpolationModeFant;
+    case ScaleMode::Lanczos:
+        return WICBitmapInterpolationModeHighQualityCubic;
     default:
         return WICBitmapInterpolationModeCubic;
     }
 }
 
+/// @brief Native resampler filter for a scale mode, if it has one
+std::optional<ResampleFilter> to_resample_filter(ScaleMode mode) {
+    switch (mode) {
+    case ScaleMode::Box:
+        return ResampleFilter::Box;
+    case ScaleMode::Area:
+        return ResampleFilter::Area;
+    case ScaleMode::Lanczos:
+        return ResampleFilter::Lanczos3;
+    default:
+        return std::nullopt;
+    }
+}
+
 /// @brief Convert PixelFormat to WIC format GUID
 const GUID& pixel_format_to_wic_guid(PixelFormat format) {
     switch (format) {
@@ -50,21 +76,15 @@ const GUID& pixel_format_to_wic_guid(PixelFormat format) {
         return GUID_WICPixelFormat8bppGray;
     case PixelFormat::Gray16:
         return GUID_WICPixelFormat16bppGray;
+    case PixelFormat::RGBA64:
+        return GUID_WICPixelFormat64bppRGBA;
+    case PixelFormat::RGBA16F:
+        return GUID_WICPixelFormat64bppRGBAHalf;
     default:
         return GUID_WICPixelFormat32bppBGRA;
     }
 }
 
-/// @brief Get WIC factory (lazily initialized)
-IWICImagingFactory* get_wic_factory() {
-    static ComPtr<IWICImagingFactory> factory = []() {
-        ComPtr<IWICImagingFactory> f;
-        CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&f));
-        return f;
-    }();
-    return factory.Get();
-}
-
 }  // namespace
 
 std::pair<uint32_t, uint32_t> calculateScaledDimensions(uint32_t source_width,
@@ -137,9 +157,10 @@ std::pair<uint32_t, uint32_t> calculateScaledDimensions(uint32_t source_width,
     return {result_width, result_height};
 }
 
-std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
-                                                    uint32_t target_width, uint32_t target_height,
-                                                    const ScaleOptions& options) {
+std::expected<DecodedImage, DecodeError> scaleImage(ImageView source, uint32_t target_width,
+                                                    uint32_t target_height,
+                                                    const ScaleOptions& options,
+                                                    std::stop_token stop_token) {
     if (!source.valid()) {
         return std::unexpected(DecodeError::CorruptedData);
     }
@@ -148,7 +169,7 @@ std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
         return std::unexpected(DecodeError::InternalError);
     }
 
-    auto* factory = get_wic_factory();
+    auto* factory = wicFactory();
     if (!factory) {
         return std::unexpected(DecodeError::DecoderNotAvailable);
     }
@@ -161,9 +182,18 @@ std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
     if (actual_width == source.width() && actual_height == source.height() &&
         options.output_format == source.format()) {
         // Return a copy
-        std::vector<uint8_t> pixels(source.pixels().begin(), source.pixels().end());
-        return DecodedImage(source.width(), source.height(), source.format(), source.stride(),
-                            std::move(pixels));
+        try {
+            return DecodedImage::copyOf(source);
+        } catch (const std::bad_alloc&) {
+            return std::unexpected(DecodeError::OutOfMemory);
+        }
+    }
+
+    // Native filters read and write the pixels directly
+    if (auto filter = to_resample_filter(options.mode);
+        filter && source.format() == PixelFormat::BGRA32 &&
+        options.output_format == PixelFormat::BGRA32) {
+        return resampleBgra(source, actual_width, actual_height, *filter, stop_token);
     }
 
     // Create bitmap from source data
@@ -205,17 +235,27 @@ std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
     uint32_t bpp = bytesPerPixel(options.output_format);
     uint32_t stride = (actual_width * bpp + 3) & ~3u;
 
-    std::vector<uint8_t> pixels;
+    PixelBuffer pixels;
     try {
         pixels.resize(static_cast<size_t>(stride) * actual_height);
     } catch (const std::bad_alloc&) {
         return std::unexpected(DecodeError::OutOfMemory);
     }
 
-    // Copy pixels
-    hr = converter->CopyPixels(nullptr, stride, static_cast<UINT>(pixels.size()), pixels.data());
-    if (FAILED(hr)) {
-        return std::unexpected(DecodeError::InternalError);
+    // Copy pixels in bands, checking for cancellation between them
+    UINT band_rows = static_cast<UINT>(std::max<size_t>(kScaleBandBytes / stride, 1));
+    for (UINT y = 0; y < actual_height; y += band_rows) {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+        UINT rows = std::min(band_rows, actual_height - y);
+        WICRect band{0, static_cast<INT>(y), static_cast<INT>(actual_width),
+                     static_cast<INT>(rows)};
+        hr = converter->CopyPixels(&band, stride, stride * rows,
+                                   pixels.data() + static_cast<size_t>(stride) * y);
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
     }
 
     return DecodedImage(actual_width, actual_height, options.output_format, stride,
@@ -223,17 +263,45 @@ std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
 }
 
 std::expected<DecodedImage, DecodeError>
-generateThumbnail(const DecodedImage& source, uint32_t max_size, const ScaleOptions& options) {
+scaleImageParallel(ImageView source, uint32_t target_width, uint32_t target_height,
+                   const ScaleOptions& options, std::stop_token stop_token) {
+    auto filter = to_resample_filter(options.mode);
+    if (!filter || !source.valid() || source.format() != PixelFormat::BGRA32 ||
+        options.output_format != PixelFormat::BGRA32 || target_width == 0 ||
+        target_height == 0) {
+        return scaleImage(source, target_width, target_height, options, stop_token);
+    }
+
+    auto [actual_width, actual_height] = calculateScaledDimensions(
+        source.width(), source.height(), target_width, target_height, options.fit);
+    return resampleBgraParallel(source, actual_width, actual_height, *filter, globalThreadPool(),
+                                stop_token);
+}
+
+std::expected<DecodedImage, DecodeError>
+convertPixelFormat(ImageView source, PixelFormat format, std::stop_token stop_token) {
+    // A same-size scale is a plain WIC format conversion
+    return scaleImage(source, source.width(), source.height(),
+                      {.mode = ScaleMode::NearestNeighbor, .fit = FitMode::Fill,
+                       .output_format = format},
+                      stop_token);
+}
+
+std::expected<DecodedImage, DecodeError>
+generateThumbnail(ImageView source, uint32_t max_size, const ScaleOptions& options,
+                  std::stop_token stop_token) {
     ScaleOptions thumb_options = options;
     thumb_options.fit = FitMode::Contain;
 
-    // Use Fant for better quality when downscaling
-    if (thumb_options.mode == ScaleMode::Cubic &&
-        (source.width() > max_size * 2 || source.height() > max_size * 2)) {
-        thumb_options.mode = ScaleMode::Fant;
+    // Area averages every source pixel for large reductions; Lanczos keeps
+    // mild ones sharp. Both avoid the WIC round trip for BGRA32.
+    if (thumb_options.mode == ScaleMode::Cubic) {
+        thumb_options.mode = (source.width() > max_size * 2 || source.height() > max_size * 2)
+                                 ? ScaleMode::Area
+                                 : ScaleMode::Lanczos;
     }
 
-    return scaleImage(source, max_size, max_size, thumb_options);
+    return scaleImage(source, max_size, max_size, thumb_options, stop_token);
 }
 
 }  // namespace nive::image
@@ -2,11 +2,13 @@
 /// @brief Image scaling using WIC
 ///
 /// Provides high-quality image scaling for thumbnail generation
-/// and display purposes.
+/// and display purposes. Sources are views, so a crop or tile is scaled
+/// without copying it out first.
 
 #pragma once
 
 #include <expected>
+#include <stop_token>
 
 #include "decoded_image.hpp"
 #include "image_decoder.hpp"
@@ -14,12 +16,19 @@
 namespace nive::image {
 
 /// @brief Scaling algorithm
+///
+/// Box, Area and Lanczos run on the native resampler for BGRA32 to BGRA32
+/// scales (no WIC bitmap round trip); other formats fall back to the
+/// nearest WIC mode.
 enum class ScaleMode {
     NearestNeighbor,   // Fastest, pixelated
     Linear,            // Bilinear interpolation
     Cubic,             // Bicubic interpolation (default)
     HighQualityCubic,  // Best quality, slowest
     Fant,              // Good for downscaling
+    Box,               // Native box filter, fast and soft
+    Area,              // Native pixel-area average, like Fant
+    Lanczos,           // Native Lanczos-3, sharpest
 };
 
 /// @brief Fit mode for scaling to target dimensions
@@ -42,11 +51,35 @@ struct ScaleOptions {
 /// @param target_width Target width in pixels
 /// @param target_height Target height in pixels
 /// @param options Scaling options
-/// @return Scaled image or error
-[[nodiscard]] std::expected<DecodedImage, DecodeError> scaleImage(const DecodedImage& source,
-                                                                  uint32_t target_width,
-                                                                  uint32_t target_height,
-                                                                  const ScaleOptions& options = {});
+/// @param stop_token Checked between output bands
+/// @return Scaled image or error (DecodeError::Cancelled once stop is requested)
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+scaleImage(ImageView source, uint32_t target_width, uint32_t target_height,
+           const ScaleOptions& options = {}, std::stop_token stop_token = {});
+
+/// @brief Scale an image with output rows split into strips across the global ThreadPool
+/// @param source Source image
+/// @param target_width Target width in pixels
+/// @param target_height Target height in pixels
+/// @param options Scaling options
+/// @param stop_token Checked between row bands of every strip
+/// @return Scaled image or error (DecodeError::Cancelled once stop is requested)
+///
+/// For very large images (viewer fit modes). Only the native modes (Box,
+/// Area, Lanczos) on BGRA32 run in parallel; anything else is scaleImage.
+/// Blocks the caller, which also scales one strip, so it must not be called
+/// from a global pool task.
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+scaleImageParallel(ImageView source, uint32_t target_width, uint32_t target_height,
+                   const ScaleOptions& options = {}, std::stop_token stop_token = {});
+
+/// @brief Convert an image to another pixel format at the same size
+/// @param source Source image
+/// @param format Output format (e.g. RGBA16F to BGRA32 for a display without float bitmaps)
+/// @param stop_token Checked between output bands
+/// @return Converted image or error (DecodeError::Cancelled once stop is requested)
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+convertPixelFormat(ImageView source, PixelFormat format, std::stop_token stop_token = {});
 
 /// @brief Calculate scaled dimensions preserving aspect ratio
 /// @param source_width Source width
@@ -62,9 +95,12 @@ calculateScaledDimensions(uint32_t source_width, uint32_t source_height, uint32_
 /// @brief Generate thumbnail from decoded image
 /// @param source Source image
 /// @param max_size Maximum dimension (width or height)
-/// @param options Scaling options (fit mode is always Contain)
-/// @return Thumbnail image or error
+/// @param options Scaling options (fit mode is always Contain). The default
+///        Cubic mode picks Area for reductions past 2x and Lanczos otherwise.
+/// @param stop_token Checked between output bands
+/// @return Thumbnail image or error (DecodeError::Cancelled once stop is requested)
 [[nodiscard]] std::expected<DecodedImage, DecodeError>
-generateThumbnail(const DecodedImage& source, uint32_t max_size, const ScaleOptions& options = {});
+generateThumbnail(ImageView source, uint32_t max_size, const ScaleOptions& options = {},
+                  std::stop_token stop_token = {});
 
 }  // namespace nive::image
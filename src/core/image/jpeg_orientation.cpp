@@ -0,0 +1,343 @@
+/// @file jpeg_orientation.cpp
+/// @brief EXIF orientation rewrite and the pixel transforms of the eight orientations
+
+#include "jpeg_orientation.hpp"
+
+#include <Windows.h>
+#include <wincodec.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../util/com_ptr.hpp"
+#include "../util/win32_utils.hpp"
+#include "exif_reader.hpp"
+#include "wic_factory.hpp"
+
+namespace nive::image {
+
+namespace {
+
+constexpr uint16_t kTagOrientation = 0x0112;
+constexpr uint16_t kTypeShort = 3;
+constexpr size_t kIfdEntrySize = 12;
+
+constexpr uint8_t kMarkerApp1 = 0xE1;
+constexpr uint8_t kMarkerSos = 0xDA;
+constexpr uint8_t kMarkerEoi = 0xD9;
+
+constexpr std::array<uint8_t, 6> kExifSignature{'E', 'x', 'i', 'f', 0, 0};
+
+/// @brief How an orientation maps stored coordinates to displayed ones
+///
+/// Coordinates relative to the image centre, y down: shown = [a b; c d] * stored.
+struct Transform {
+    int a, b, c, d;
+
+    [[nodiscard]] constexpr Transform then(const Transform& next) const noexcept {
+        return {next.a * a + next.b * c, next.a * b + next.b * d, next.c * a + next.d * c,
+                next.c * b + next.d * d};
+    }
+    [[nodiscard]] constexpr bool operator==(const Transform&) const = default;
+};
+
+// Index = EXIF orientation - 1
+constexpr std::array<Transform, 8> kOrientations{{
+    {1, 0, 0, 1},    // 1: As stored
+    {-1, 0, 0, 1},   // 2: Mirrored horizontally
+    {-1, 0, 0, -1},  // 3: Rotated 180
+    {1, 0, 0, -1},   // 4: Mirrored vertically
+    {0, 1, 1, 0},    // 5: Transposed
+    {0, -1, 1, 0},   // 6: Turned 90 clockwise
+    {0, -1, -1, 0},  // 7: Transversed
+    {0, 1, -1, 0},   // 8: Turned 90 counter-clockwise
+}};
+
+/// @brief Orientation whose display transform is the change
+[[nodiscard]] constexpr uint16_t orientation_of(OrientationChange change) noexcept {
+    switch (change) {
+    case OrientationChange::RotateClockwise:
+        return 6;
+    case OrientationChange::RotateCounterClockwise:
+        return 8;
+    case OrientationChange::Rotate180:
+        return 3;
+    case OrientationChange::FlipHorizontal:
+        return 2;
+    case OrientationChange::FlipVertical:
+        return 4;
+    }
+    return 1;
+}
+
+/// @brief The Orientation field of a JPEG's IFD0
+struct OrientationField {
+    size_t offset = 0;  // Of the value in the file
+    bool little_endian = false;
+    uint16_t value = 1;
+};
+
+[[nodiscard]] uint32_t read_uint(std::span<const uint8_t> data, size_t offset, size_t size,
+                                 bool little_endian) noexcept {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        size_t byte = little_endian ? size - 1 - i : i;
+        value = (value << 8) | data[offset + byte];
+    }
+    return value;
+}
+
+/// @brief Find the Orientation field in the IFD0 of a TIFF block
+/// @param tiff_offset Offset of the TIFF block in the file, added to the result
+[[nodiscard]] std::optional<OrientationField> find_in_tiff(std::span<const uint8_t> tiff,
+                                                           size_t tiff_offset) noexcept {
+    if (tiff.size() < 8) {
+        return std::nullopt;
+    }
+    bool little_endian = tiff[0] == 'I' && tiff[1] == 'I';
+    if (!little_endian && !(tiff[0] == 'M' && tiff[1] == 'M')) {
+        return std::nullopt;
+    }
+    if (read_uint(tiff, 2, 2, little_endian) != 42) {
+        return std::nullopt;
+    }
+    size_t ifd = read_uint(tiff, 4, 4, little_endian);
+    if (ifd > tiff.size() - 2) {
+        return std::nullopt;
+    }
+    size_t entries = read_uint(tiff, ifd, 2, little_endian);
+    for (size_t i = 0; i < entries; ++i) {
+        size_t entry = ifd + 2 + i * kIfdEntrySize;
+        if (entry + kIfdEntrySize > tiff.size()) {
+            break;
+        }
+        if (read_uint(tiff, entry, 2, little_endian) != kTagOrientation) {
+            continue;
+        }
+        // One SHORT, stored left-justified in the value field
+        if (read_uint(tiff, entry + 2, 2, little_endian) != kTypeShort ||
+            read_uint(tiff, entry + 4, 4, little_endian) != 1) {
+            return std::nullopt;
+        }
+        return OrientationField{
+            .offset = tiff_offset + entry + 8,
+            .little_endian = little_endian,
+            .value = static_cast<uint16_t>(read_uint(tiff, entry + 8, 2, little_endian)),
+        };
+    }
+    return std::nullopt;
+}
+
+/// @brief Find the Orientation field in the EXIF block of a JPEG's header
+/// @return Field, or nullopt if the header has no EXIF block or the block no tag
+[[nodiscard]] std::optional<OrientationField> find_orientation(std::span<const uint8_t> jpeg) {
+    size_t pos = 2;  // After SOI
+    while (pos + 4 <= jpeg.size()) {
+        if (jpeg[pos] != 0xFF) {
+            return std::nullopt;
+        }
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            ++pos;  // Fill byte
+            continue;
+        }
+        pos += 2;
+        if (marker == kMarkerSos || marker == kMarkerEoi) {
+            return std::nullopt;
+        }
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            continue;  // Standalone markers have no length
+        }
+
+        size_t length = (size_t{jpeg[pos]} << 8) | jpeg[pos + 1];
+        if (length < 2) {
+            return std::nullopt;
+        }
+        size_t body = pos + 2;
+        size_t body_length = std::min(length - 2, jpeg.size() - std::min(body, jpeg.size()));
+        if (marker == kMarkerApp1 && body_length >= kExifSignature.size() &&
+            std::memcmp(jpeg.data() + body, kExifSignature.data(), kExifSignature.size()) == 0) {
+            size_t tiff = body + kExifSignature.size();
+            return find_in_tiff(jpeg.subspan(tiff, body_length - kExifSignature.size()), tiff);
+        }
+        pos += length;
+    }
+    return std::nullopt;
+}
+
+/// @brief Add an Orientation tag through WIC's in-place metadata writer
+[[nodiscard]] std::expected<void, ReorientError> write_with_wic(const std::filesystem::path& path,
+                                                                uint16_t orientation) {
+    ComInitializer com(COINIT_MULTITHREADED);
+    IWICImagingFactory* factory = wicFactory();
+    if (!factory) {
+        return std::unexpected(ReorientError::IoError);
+    }
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    HRESULT hr = factory->CreateDecoderFromFilename(path.c_str(), nullptr,
+                                                    GENERIC_READ | GENERIC_WRITE,
+                                                    WICDecodeMetadataCacheOnDemand, &decoder);
+    if (FAILED(hr)) {
+        return std::unexpected(ReorientError::IoError);
+    }
+    ComPtr<IWICBitmapFrameDecode> frame;
+    ComPtr<IWICFastMetadataEncoder> encoder;
+    ComPtr<IWICMetadataQueryWriter> writer;
+    if (FAILED(decoder->GetFrame(0, &frame)) ||
+        FAILED(factory->CreateFastMetadataEncoderFromFrameDecode(frame.Get(), &encoder)) ||
+        FAILED(encoder->GetMetadataQueryWriter(&writer))) {
+        return std::unexpected(ReorientError::NoRoom);
+    }
+
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    value.vt = VT_UI2;
+    value.uiVal = orientation;
+    // Fails when the APP1 block has no padding left to grow into
+    if (FAILED(writer->SetMetadataByName(L"/app1/ifd/{ushort=274}", &value)) ||
+        FAILED(encoder->Commit())) {
+        return std::unexpected(ReorientError::NoRoom);
+    }
+    return {};
+}
+
+}  // namespace
+
+uint16_t composeOrientation(uint16_t orientation, OrientationChange change) noexcept {
+    if (orientation < 1 || orientation > 8) {
+        orientation = 1;
+    }
+    Transform target =
+        kOrientations[orientation - 1].then(kOrientations[orientation_of(change) - 1]);
+    for (size_t i = 0; i < kOrientations.size(); ++i) {
+        if (kOrientations[i] == target) {
+            return static_cast<uint16_t>(i + 1);
+        }
+    }
+    return 1;  // Unreachable: the eight orientations are closed under composition
+}
+
+DecodedImage orientImage(DecodedImage image, uint16_t orientation) {
+    if (orientation <= 1 || orientation > 8 || bytesPerPixel(image.format()) != 4) {
+        return image;
+    }
+
+    const uint32_t w = image.width();
+    const uint32_t h = image.height();
+    const bool transposed = orientation >= 5;
+    DecodedImage upright(transposed ? h : w, transposed ? w : h, image.format());
+
+    for (uint32_t y = 0; y < upright.height(); ++y) {
+        uint8_t* dst = upright.row(y);
+        for (uint32_t x = 0; x < upright.width(); ++x) {
+            uint32_t sx = x;
+            uint32_t sy = y;
+            switch (orientation) {
+            case 2:  // Mirrored horizontally
+                sx = w - 1 - x;
+                break;
+            case 3:  // Rotated 180
+                sx = w - 1 - x;
+                sy = h - 1 - y;
+                break;
+            case 4:  // Mirrored vertically
+                sy = h - 1 - y;
+                break;
+            case 5:  // Transposed
+                sx = y;
+                sy = x;
+                break;
+            case 6:  // Needs 90 clockwise
+                sx = y;
+                sy = h - 1 - x;
+                break;
+            case 7:  // Transversed
+                sx = w - 1 - y;
+                sy = h - 1 - x;
+                break;
+            case 8:  // Needs 90 counter-clockwise
+                sx = w - 1 - y;
+                sy = x;
+                break;
+            }
+            std::memcpy(dst + static_cast<size_t>(x) * 4,
+                        std::as_const(image).row(sy) + static_cast<size_t>(sx) * 4, 4);
+        }
+    }
+    return upright;
+}
+
+DecodedImage orientImage(DecodedImage image, OrientationChange change) {
+    return orientImage(std::move(image), orientation_of(change));
+}
+
+bool canReorient(std::wstring_view extension) noexcept {
+    constexpr std::array<std::wstring_view, 4> kExtensions{L".jpg", L".jpeg", L".jpe", L".jfif"};
+    if (extension.size() > 5) {
+        return false;
+    }
+    std::array<wchar_t, 5> lower{};
+    for (size_t i = 0; i < extension.size(); ++i) {
+        wchar_t c = extension[i];
+        lower[i] = (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c - L'A' + L'a') : c;
+    }
+    std::wstring_view key(lower.data(), extension.size());
+    return std::find(kExtensions.begin(), kExtensions.end(), key) != kExtensions.end();
+}
+
+std::expected<uint16_t, ReorientError> reorientJpeg(const std::filesystem::path& path,
+                                                    OrientationChange change) {
+    std::optional<OrientationField> field;
+    {
+        HandleGuard file(CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                                     nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!file) {
+            return std::unexpected(ReorientError::IoError);
+        }
+
+        std::vector<uint8_t> header(kExifHeaderBytes);
+        DWORD read = 0;
+        if (!ReadFile(file.get(), header.data(), static_cast<DWORD>(header.size()), &read,
+                      nullptr)) {
+            return std::unexpected(ReorientError::IoError);
+        }
+        header.resize(read);
+        if (header.size() < 4 || header[0] != 0xFF || header[1] != 0xD8) {
+            return std::unexpected(ReorientError::NotJpeg);
+        }
+
+        field = find_orientation(header);
+        if (field) {
+            uint16_t orientation = composeOrientation(field->value, change);
+            std::array<uint8_t, 2> bytes{};
+            bytes[field->little_endian ? 0 : 1] = static_cast<uint8_t>(orientation & 0xFF);
+            bytes[field->little_endian ? 1 : 0] = static_cast<uint8_t>(orientation >> 8);
+
+            LARGE_INTEGER offset{};
+            offset.QuadPart = static_cast<LONGLONG>(field->offset);
+            DWORD written = 0;
+            if (!SetFilePointerEx(file.get(), offset, nullptr, FILE_BEGIN) ||
+                !WriteFile(file.get(), bytes.data(), static_cast<DWORD>(bytes.size()), &written,
+                           nullptr) ||
+                written != bytes.size()) {
+                return std::unexpected(ReorientError::IoError);
+            }
+            return orientation;
+        }
+    }
+
+    // No tag to overwrite: the file is closed again so WIC can open it for writing
+    uint16_t orientation = composeOrientation(1, change);
+    if (auto added = write_with_wic(path, orientation); !added) {
+        return std::unexpected(added.error());
+    }
+    return orientation;
+}
+
+}  // namespace nive::image
@@ -0,0 +1,85 @@
+/// @file jpeg_orientation.hpp
+/// @brief Lossless rotation and flipping of JPEGs through their EXIF orientation
+///
+/// A JPEG is turned by changing the Orientation tag every viewer (and every
+/// decoder here) applies, never by decoding and encoding its pixels. A tag
+/// already in the file is overwritten in place, two bytes; a file without
+/// one gets it through WIC's fast metadata encoder, which writes into the
+/// padding of the metadata block without touching the compressed data.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <string_view>
+
+#include "decoded_image.hpp"
+
+namespace nive::image {
+
+/// @brief A turn or mirror of the displayed image
+enum class OrientationChange {
+    RotateClockwise,         // 90 degrees
+    RotateCounterClockwise,  // 90 degrees
+    Rotate180,
+    FlipHorizontal,  // Left and right swapped
+    FlipVertical,    // Top and bottom swapped
+};
+
+/// @brief Check if a change swaps the displayed width and height
+[[nodiscard]] constexpr bool swapsAxes(OrientationChange change) noexcept {
+    return change == OrientationChange::RotateClockwise ||
+           change == OrientationChange::RotateCounterClockwise;
+}
+
+/// @brief Errors rewriting a JPEG's orientation
+enum class ReorientError {
+    NotJpeg,  // Not a JPEG, or its segments could not be walked
+    NoRoom,   // No Orientation tag, and no space in the metadata to add one
+    IoError,  // The file could not be opened for writing, read or written
+};
+
+/// @brief Get string representation of reorient error
+[[nodiscard]] constexpr std::string_view to_string(ReorientError error) noexcept {
+    switch (error) {
+    case ReorientError::NotJpeg:
+        return "Not a JPEG file";
+    case ReorientError::NoRoom:
+        return "No room for the orientation in the metadata";
+    case ReorientError::IoError:
+        return "I/O error";
+    }
+    return "Unknown reorient error";
+}
+
+/// @brief EXIF orientation after a change to an image shown with another
+/// @param orientation Current orientation (1-8; anything else is taken as 1)
+/// @param change Turn or mirror applied to the image as displayed
+/// @return New orientation (1-8)
+[[nodiscard]] uint16_t composeOrientation(uint16_t orientation, OrientationChange change) noexcept;
+
+/// @brief Turn and/or mirror pixels the way an EXIF orientation displays them
+/// @param image Image as stored (BGRA32 or another 4-byte format)
+/// @param orientation EXIF orientation (1 or out of range returns the image as is)
+/// @return Image as displayed
+[[nodiscard]] DecodedImage orientImage(DecodedImage image, uint16_t orientation);
+
+/// @brief Apply a change to pixels that are already upright
+[[nodiscard]] DecodedImage orientImage(DecodedImage image, OrientationChange change);
+
+/// @brief Check if files with an extension can be reoriented (JPEG)
+/// @param extension Extension with the dot, any case
+[[nodiscard]] bool canReorient(std::wstring_view extension) noexcept;
+
+/// @brief Rotate or flip a JPEG file without re-encoding it
+/// @param path JPEG file, rewritten in place
+/// @param change Turn or mirror of the image as displayed
+/// @return The orientation written
+///
+/// Initialises COM on the calling thread if the WIC route is needed and it
+/// has not been. The file's write time changes as with any edit.
+[[nodiscard]] std::expected<uint16_t, ReorientError>
+reorientJpeg(const std::filesystem::path& path, OrientationChange change);
+
+}  // namespace nive::image
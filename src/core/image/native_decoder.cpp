@@ -0,0 +1,82 @@
+/// @file native_decoder.cpp
+/// @brief Built-in codec decoder registry and file access
+
+#include "native_decoder.hpp"
+
+#include <system_error>
+#include <utility>
+
+#include "../util/mapped_file.hpp"
+
+#ifdef NIVE_HAS_SPNG
+#include "spng_decoder.hpp"
+#endif
+#ifdef NIVE_HAS_TURBOJPEG
+#include "turbojpeg_decoder.hpp"
+#endif
+
+namespace nive::image {
+
+namespace {
+
+[[nodiscard]] std::expected<MappedFile, DecodeError> map_file(const std::filesystem::path& path) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return std::unexpected(DecodeError::FileNotFound);
+    }
+    auto file = MappedFile::open(path, MappedFile::Access::Sequential);
+    if (!file) {
+        return std::unexpected(DecodeError::AccessDenied);
+    }
+    return std::move(*file);
+}
+
+}  // namespace
+
+std::expected<ImageInfo, DecodeError>
+NativeDecoder::getInfo(const std::filesystem::path& path) const {
+    auto file = map_file(path);
+    if (!file) {
+        return std::unexpected(file.error());
+    }
+    return getInfoFromMemory(file->bytes());
+}
+
+std::expected<DecodedImage, DecodeError> NativeDecoder::decode(const std::filesystem::path& path,
+                                                               PixelFormat target_format) const {
+    auto file = map_file(path);
+    if (!file) {
+        return std::unexpected(file.error());
+    }
+    return decodeFromMemory(file->bytes(), target_format);
+}
+
+std::expected<DecodedImage, DecodeError>
+NativeDecoder::decodeFrame(const std::filesystem::path& path, uint32_t frame_index,
+                           PixelFormat target_format) const {
+    if (frame_index != 0) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    return decode(path, target_format);
+}
+
+const NativeDecoder* nativeDecoderFor(std::string_view extension) noexcept {
+    if (extension.starts_with('.')) {
+        extension.remove_prefix(1);
+    }
+#ifdef NIVE_HAS_TURBOJPEG
+    static const TurboJpegDecoder jpeg;
+    if (jpeg.supportsExtension(extension)) {
+        return &jpeg;
+    }
+#endif
+#ifdef NIVE_HAS_SPNG
+    static const SpngDecoder png;
+    if (png.supportsExtension(extension)) {
+        return &png;
+    }
+#endif
+    return nullptr;
+}
+
+}  // namespace nive::image
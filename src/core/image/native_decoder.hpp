@@ -0,0 +1,65 @@
+/// @file native_decoder.hpp
+/// @brief Built-in codec decoders tried ahead of WIC
+///
+/// JPEG and PNG make up most of a typical library. Decoding them with
+/// libjpeg-turbo and libspng directly skips WIC's COM layers and, for JPEG,
+/// reduces the image by DCT scaling in the codec itself. Each decoder is only
+/// compiled in when its library is found at configure time; without them
+/// nativeDecoderFor() returns nullptr and everything goes through WIC.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "image_decoder.hpp"
+#include "wic_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief Decoder for one format backed by a codec library linked into nive
+///
+/// Output is always BGRA32. Requests for another target format fail with
+/// DecodeError::UnsupportedFormat, as do inputs the codec cannot produce BGRA
+/// from (CMYK JPEG), so the caller falls back to WIC.
+///
+/// Thread-safe: yes
+class NativeDecoder : public IImageDecoder {
+public:
+    /// @brief Map the file and read its header (see getInfoFromMemory)
+    [[nodiscard]] std::expected<ImageInfo, DecodeError>
+    getInfo(const std::filesystem::path& path) const final;
+
+    /// @brief Map the file and decode it (see decodeFromMemory)
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decode(const std::filesystem::path& path,
+           PixelFormat target_format = PixelFormat::BGRA32) const final;
+
+    /// @brief Decode the first frame (the only one these decoders read)
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decodeFrame(const std::filesystem::path& path, uint32_t frame_index,
+                PixelFormat target_format = PixelFormat::BGRA32) const final;
+
+    /// @brief Decode from memory for a thumbnail, reducing while decoding where possible
+    /// @param data Encoded image
+    /// @param min_size Longer side the result must keep (if the image is that large)
+    /// @return Upright BGRA32 image no smaller than min_size (full size if not reducible)
+    ///
+    /// Unlike decodeFromMemory, EXIF orientation is applied, matching
+    /// WicDecoder::decodeThumbnail. The caller scales the result to size.
+    [[nodiscard]] virtual std::expected<PreviewImage, DecodeError>
+    decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t min_size) const = 0;
+
+protected:
+    NativeDecoder() = default;
+};
+
+/// @brief Get the built-in decoder for a file extension
+/// @param extension Lowercase extension, with or without the leading dot
+/// @return Decoder, or nullptr if none is compiled in for the extension
+[[nodiscard]] const NativeDecoder* nativeDecoderFor(std::string_view extension) noexcept;
+
+}  // namespace nive::image
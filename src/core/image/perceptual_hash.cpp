@@ -0,0 +1,80 @@
+/// @file perceptual_hash.cpp
+/// @brief Difference hash over an area-averaged luma grid, and the mean colour
+
+#include "perceptual_hash.hpp"
+
+#include <array>
+
+namespace nive::image {
+
+namespace {
+
+// One more column than bits per row: each bit compares two neighbours
+constexpr uint32_t kGridWidth = 9;
+constexpr uint32_t kGridHeight = 8;
+
+}  // namespace
+
+std::optional<uint64_t> differenceHash(ImageView image) {
+    if (image.format() != PixelFormat::BGRA32 || image.width() < kGridWidth ||
+        image.height() < kGridHeight) {
+        return std::nullopt;
+    }
+
+    // Sum the luma of every pixel into its grid cell (BT.601 weights, x1000).
+    // Cell edges fall on whole pixels, so each pixel counts once.
+    std::array<uint64_t, kGridWidth * kGridHeight> sums{};
+    std::array<uint64_t, kGridWidth * kGridHeight> counts{};
+    const uint32_t width = image.width();
+    const uint32_t height = image.height();
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = image.row(y);
+        uint32_t cell_row = y * kGridHeight / height * kGridWidth;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint8_t* pixel = row + static_cast<size_t>(x) * 4;
+            uint32_t luma = pixel[2] * 299u + pixel[1] * 587u + pixel[0] * 114u;
+            uint32_t cell = cell_row + x * kGridWidth / width;
+            sums[cell] += luma;
+            ++counts[cell];
+        }
+    }
+
+    // Every cell holds at least one pixel: the image is no smaller than the grid
+    for (size_t i = 0; i < sums.size(); ++i) {
+        sums[i] /= counts[i];
+    }
+
+    uint64_t hash = 0;
+    for (uint32_t gy = 0; gy < kGridHeight; ++gy) {
+        for (uint32_t gx = 0; gx + 1 < kGridWidth; ++gx) {
+            size_t left = gy * kGridWidth + gx;
+            hash = (hash << 1) | (sums[left] < sums[left + 1] ? 1u : 0u);
+        }
+    }
+    return hash;
+}
+
+std::optional<uint32_t> averageColor(ImageView image) {
+    if (image.format() != PixelFormat::BGRA32 || image.width() == 0 || image.height() == 0) {
+        return std::nullopt;
+    }
+
+    std::array<uint64_t, 3> sums{};  // B, G, R
+    const uint32_t width = image.width();
+    const uint32_t height = image.height();
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = image.row(y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint8_t* pixel = row + static_cast<size_t>(x) * 4;
+            sums[0] += pixel[0];
+            sums[1] += pixel[1];
+            sums[2] += pixel[2];
+        }
+    }
+
+    uint64_t count = static_cast<uint64_t>(width) * height;
+    auto channel = [&](size_t i) { return static_cast<uint32_t>(sums[i] / count); };
+    return (channel(2) << 16) | (channel(1) << 8) | channel(0);
+}
+
+}  // namespace nive::image
@@ -0,0 +1,43 @@
+/// @file perceptual_hash.hpp
+/// @brief Perceptual hashes for finding visually similar images
+///
+/// A difference hash (dHash) reduces an image to a 9x8 grid of luma
+/// averages and records, for each row, whether brightness rises from one
+/// cell to the next. Rescaled, recompressed or lightly edited copies of an
+/// image get hashes a few bits apart; unrelated images differ in about half
+/// of the 64 bits.
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+#include "decoded_image.hpp"
+
+namespace nive::image {
+
+/// @brief Hamming distance at or below which two hashes count as the same picture
+inline constexpr uint32_t kSimilarHashDistance = 10;
+
+/// @brief Compute the 64-bit difference hash of an image
+/// @param image Image to hash (must be PixelFormat::BGRA32); a thumbnail is
+///        enough, the hash only sees a 9x8 reduction
+/// @return Hash, or nullopt if the image is not BGRA32 or smaller than 9x8
+[[nodiscard]] std::optional<uint64_t> differenceHash(ImageView image);
+
+/// @brief Compute the mean colour of an image
+/// @param image Image to average (must be PixelFormat::BGRA32)
+/// @return Colour as 0xRRGGBB, or nullopt if the image is not BGRA32 or empty
+///
+/// Shown as the placeholder of a thumbnail that is still loading, it gives
+/// the cell the tone of the picture. Alpha is ignored: thumbnails are
+/// composited onto an opaque background before they are cached.
+[[nodiscard]] std::optional<uint32_t> averageColor(ImageView image);
+
+/// @brief Get the number of bits in which two hashes differ
+[[nodiscard]] constexpr uint32_t hashDistance(uint64_t a, uint64_t b) noexcept {
+    return static_cast<uint32_t>(std::popcount(a ^ b));
+}
+
+}  // namespace nive::image
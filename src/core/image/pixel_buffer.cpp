@@ -0,0 +1,100 @@
+/// @file pixel_buffer.cpp
+/// @brief Pixel buffer pool implementation
+
+#include "pixel_buffer.hpp"
+
+#include <bit>
+
+namespace nive::image {
+
+namespace {
+
+constexpr std::align_val_t kBlockAlignment{PixelBufferPool::kAlignment};
+
+constexpr int kMinOctave = std::bit_width(PixelBufferPool::kMinPooledBytes - 1);
+
+/// @brief Size class of a pooled request
+struct SizeClass {
+    size_t index;
+    size_t bytes;  // Block size every request of the class gets
+};
+
+/// @brief Round a request up to the next of four steps between powers of two
+/// @param bytes Request in [kMinPooledBytes, kMaxPooledBytes]
+[[nodiscard]] constexpr SizeClass size_class(size_t bytes) noexcept {
+    // 2^(octave-1) < bytes <= 2^octave, in steps of a quarter of 2^(octave-1)
+    int octave = std::bit_width(bytes - 1);
+    size_t step = size_t{1} << (octave - 3);
+    size_t steps = (bytes + step - 1) / step;  // 5 to 8
+    return {static_cast<size_t>(octave - kMinOctave) * 4 + (steps - 5), steps * step};
+}
+
+[[nodiscard]] constexpr bool pooled(size_t bytes) noexcept {
+    return bytes >= PixelBufferPool::kMinPooledBytes && bytes <= PixelBufferPool::kMaxPooledBytes;
+}
+
+}  // namespace
+
+PixelBufferPool& PixelBufferPool::instance() {
+    // Never destroyed: images in other statics may be freed after it would be
+    static auto* pool = new PixelBufferPool();
+    return *pool;
+}
+
+void* PixelBufferPool::allocate(size_t bytes) {
+    if (!pooled(bytes)) {
+        return ::operator new(bytes, kBlockAlignment);
+    }
+
+    SizeClass size = size_class(bytes);
+    {
+        std::lock_guard lock(mutex_);
+        auto& blocks = free_blocks_[size.index];
+        if (!blocks.empty()) {
+            void* block = blocks.back();
+            blocks.pop_back();
+            cached_bytes_ -= size.bytes;
+            charge_.set(cached_bytes_);
+            return block;
+        }
+    }
+    return ::operator new(size.bytes, kBlockAlignment);
+}
+
+void PixelBufferPool::deallocate(void* block, size_t bytes) noexcept {
+    if (!block) {
+        return;
+    }
+    if (pooled(bytes)) {
+        SizeClass size = size_class(bytes);
+        std::lock_guard lock(mutex_);
+        if (cached_bytes_ + size.bytes <= kMaxCachedBytes) {
+            try {
+                free_blocks_[size.index].push_back(block);
+                cached_bytes_ += size.bytes;
+                charge_.set(cached_bytes_);
+                return;
+            } catch (const std::bad_alloc&) {
+                // Free it instead
+            }
+        }
+    }
+    ::operator delete(block, kBlockAlignment);
+}
+
+void PixelBufferPool::trim() noexcept {
+    std::array<std::vector<void*>, kClassCount> blocks;
+    {
+        std::lock_guard lock(mutex_);
+        blocks.swap(free_blocks_);
+        cached_bytes_ = 0;
+        charge_.set(0);
+    }
+    for (auto& list : blocks) {
+        for (void* block : list) {
+            ::operator delete(block, kBlockAlignment);
+        }
+    }
+}
+
+}  // namespace nive::image
@@ -0,0 +1,106 @@
+/// @file pixel_buffer.hpp
+/// @brief Pooled, uninitialised storage for decoded pixels
+///
+/// Decodes and scales allocate frames of several megabytes each. Taking them
+/// from a size-class pool reuses memory that is already committed, instead
+/// of page-faulting in (and zeroing) a fresh heap block for every image.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "../util/memory_accounting.hpp"
+
+namespace nive::image {
+
+/// @brief Process-wide pool of large pixel allocations, recycled by size class
+///
+/// Requests from kMinPooledBytes to kMaxPooledBytes are rounded up to one of
+/// four size classes per power of two (at most 25% slack), and freed blocks
+/// are kept for reuse up to kMaxCachedBytes in total. Other requests go
+/// straight to the heap. Every block starts on a kAlignment boundary, so
+/// images with kSimdRowAlignment rows are aligned row by row.
+///
+/// Thread-safe: yes (a block may be freed on a different thread than it was
+/// allocated on)
+class PixelBufferPool {
+public:
+    static constexpr size_t kMinPooledBytes = 64 * 1024;
+    static constexpr size_t kMaxPooledBytes = 1024ull * 1024 * 1024;
+    static constexpr size_t kMaxCachedBytes = 256ull * 1024 * 1024;
+    static constexpr size_t kAlignment = 64;
+
+    /// @brief Get the shared pool
+    [[nodiscard]] static PixelBufferPool& instance();
+
+    /// @brief Allocate at least bytes bytes (contents unspecified)
+    /// @throws std::bad_alloc when the heap is exhausted
+    [[nodiscard]] void* allocate(size_t bytes);
+
+    /// @brief Return a block from allocate()
+    /// @param bytes The size passed to allocate()
+    void deallocate(void* block, size_t bytes) noexcept;
+
+    /// @brief Free every cached block back to the heap
+    void trim() noexcept;
+
+private:
+    // Four classes per power of two from 2^16 to 2^30
+    static constexpr size_t kClassCount = (30 - 16) * 4 + 4;
+
+    PixelBufferPool() = default;
+
+    std::mutex mutex_;
+    std::array<std::vector<void*>, kClassCount> free_blocks_;
+    size_t cached_bytes_ = 0;
+    MemoryCharge charge_{MemoryCategory::PixelPool};  // cached_bytes_, for memoryUsage()
+};
+
+/// @brief Allocator drawing from PixelBufferPool that leaves elements uninitialised
+///
+/// resize() and the size constructor of a vector using it skip the zero
+/// fill; every pixel is written by the decoder or scaler anyway.
+template <typename T>
+class PixelAllocator {
+public:
+    using value_type = T;
+
+    PixelAllocator() noexcept = default;
+    template <typename U>
+    PixelAllocator(const PixelAllocator<U>&) noexcept {}
+
+    [[nodiscard]] T* allocate(size_t count) {
+        return static_cast<T*>(PixelBufferPool::instance().allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* block, size_t count) noexcept {
+        PixelBufferPool::instance().deallocate(block, count * sizeof(T));
+    }
+
+    /// @brief Default-initialise (for trivial types: leave as is) instead of value-initialise
+    template <typename U>
+    void construct(U* element) noexcept {
+        ::new (static_cast<void*>(element)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* element, Args&&... args) {
+        ::new (static_cast<void*>(element)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    [[nodiscard]] bool operator==(const PixelAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+/// @brief Pixel storage of a DecodedImage
+using PixelBuffer = std::vector<uint8_t, PixelAllocator<uint8_t>>;
+
+}  // namespace nive::image
@@ -0,0 +1,316 @@
+/// @file pixel_convert.cpp
+/// @brief Pixel layout conversion kernels (scalar, SSSE3, AVX2)
+
+#include "pixel_convert.hpp"
+
+#include <cstring>
+#include <utility>
+
+#include "resampler.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#define NIVE_PIXEL_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+namespace nive::image {
+
+namespace {
+
+/// @brief Convert one row of `width` pixels
+using RowKernel = void (*)(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+// ---- Scalar ---------------------------------------------------------------
+// Each kernel also finishes the pixels its SIMD variants leave over, so they
+// take the pixel offset to start at.
+
+void swap4_scalar_from(const uint8_t* src, uint8_t* dst, uint32_t x, uint32_t width) {
+    for (; x < width; ++x) {
+        const uint8_t* s = src + static_cast<size_t>(x) * 4;
+        uint8_t* d = dst + static_cast<size_t>(x) * 4;
+        uint8_t first = s[0];
+        uint8_t second = s[1];
+        uint8_t third = s[2];
+        uint8_t alpha = s[3];
+        d[0] = third;
+        d[1] = second;
+        d[2] = first;
+        d[3] = alpha;
+    }
+}
+
+void swap3_scalar_from(const uint8_t* src, uint8_t* dst, uint32_t x, uint32_t width) {
+    for (; x < width; ++x) {
+        const uint8_t* s = src + static_cast<size_t>(x) * 3;
+        uint8_t* d = dst + static_cast<size_t>(x) * 3;
+        uint8_t first = s[0];
+        uint8_t second = s[1];
+        uint8_t third = s[2];
+        d[0] = third;
+        d[1] = second;
+        d[2] = first;
+    }
+}
+
+template <bool Swap>
+void expand3_scalar_from(const uint8_t* src, uint8_t* dst, uint32_t x, uint32_t width) {
+    for (; x < width; ++x) {
+        const uint8_t* s = src + static_cast<size_t>(x) * 3;
+        uint8_t* d = dst + static_cast<size_t>(x) * 4;
+        d[0] = Swap ? s[2] : s[0];
+        d[1] = s[1];
+        d[2] = Swap ? s[0] : s[2];
+        d[3] = 0xFF;
+    }
+}
+
+void gray_scalar_from(const uint8_t* src, uint8_t* dst, uint32_t x, uint32_t width) {
+    for (; x < width; ++x) {
+        uint8_t* d = dst + static_cast<size_t>(x) * 4;
+        d[0] = d[1] = d[2] = src[x];
+        d[3] = 0xFF;
+    }
+}
+
+void swap4_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    swap4_scalar_from(src, dst, 0, width);
+}
+
+void swap3_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    swap3_scalar_from(src, dst, 0, width);
+}
+
+template <bool Swap>
+void expand3_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    expand3_scalar_from<Swap>(src, dst, 0, width);
+}
+
+void gray_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    gray_scalar_from(src, dst, 0, width);
+}
+
+#ifdef NIVE_PIXEL_CONVERT_X86
+
+// ---- SSSE3 (pshufb) -------------------------------------------------------
+// Loads stay inside the row: loops stop while a full 16-byte load still fits.
+
+void swap4_ssse3(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_shuffle_epi8(pixels, mask));
+    }
+    swap4_scalar_from(src, dst, x, width);
+}
+
+void swap3_ssse3(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    // Five pixels per step; the 16th byte is written back unchanged, so the
+    // overlapping store is safe in place
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    uint32_t x = 0;
+    for (; x + 6 <= width; x += 5) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3), _mm_shuffle_epi8(pixels, mask));
+    }
+    swap3_scalar_from(src, dst, x, width);
+}
+
+template <bool Swap>
+__m128i expand3_mask_ssse3() {
+    return Swap ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+}
+
+template <bool Swap>
+void expand3_ssse3(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    const __m128i mask = expand3_mask_ssse3<Swap>();
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    uint32_t x = 0;
+    for (; x + 6 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), pixels);
+    }
+    expand3_scalar_from<Swap>(src, dst, x, width);
+}
+
+void gray_ssse3(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i masks[4] = {
+        _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+        _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+        _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+        _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1),
+    };
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        for (int i = 0; i < 4; ++i) {
+            __m128i pixels = _mm_or_si128(_mm_shuffle_epi8(gray, masks[i]), alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (x + i * 4) * 4), pixels);
+        }
+    }
+    gray_scalar_from(src, dst, x, width);
+}
+
+// ---- AVX2 -----------------------------------------------------------------
+
+void swap4_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    const __m256i mask =
+        _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5,
+                         4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4),
+                            _mm256_shuffle_epi8(pixels, mask));
+    }
+    _mm256_zeroupper();
+    swap4_ssse3(src + x * 4, dst + x * 4, width - x);
+}
+
+template <bool Swap>
+void expand3_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    // Four source pixels (12 bytes) per 128-bit lane
+    const __m128i lane_mask = expand3_mask_ssse3<Swap>();
+    const __m256i mask = _mm256_broadcastsi128_si256(lane_mask);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    uint32_t x = 0;
+    for (; x + 10 <= width; x += 8) {
+        const uint8_t* s = src + static_cast<size_t>(x) * 3;
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12));
+        __m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, mask), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), pixels);
+    }
+    _mm256_zeroupper();
+    expand3_ssse3<Swap>(src + static_cast<size_t>(x) * 3, dst + x * 4, width - x);
+}
+
+void gray_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    // Widen to 32 bits, then spread each value over three channels by multiplying
+    const __m256i spread = _mm256_set1_epi32(0x00010101);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i gray =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x)));
+        __m256i pixels = _mm256_or_si256(_mm256_mullo_epi32(gray, spread), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), pixels);
+    }
+    _mm256_zeroupper();
+    gray_scalar_from(src, dst, x, width);
+}
+
+#endif  // NIVE_PIXEL_CONVERT_X86
+
+struct Kernels {
+    RowKernel swap4;         // BGRA32 <-> RGBA32
+    RowKernel swap3;         // BGR24 <-> RGB24
+    RowKernel expand3;       // BGR24 -> BGRA32, RGB24 -> RGBA32
+    RowKernel expand3_swap;  // RGB24 -> BGRA32, BGR24 -> RGBA32
+    RowKernel gray;          // Gray8 -> BGRA32 / RGBA32
+};
+
+Kernels kernels_for(SimdLevel level) noexcept {
+    switch (level) {
+#ifdef NIVE_PIXEL_CONVERT_X86
+    case SimdLevel::Avx2:
+        return {swap4_avx2, swap3_ssse3, expand3_avx2<false>, expand3_avx2<true>, gray_avx2};
+    case SimdLevel::Sse41:  // Implies SSSE3
+        return {swap4_ssse3, swap3_ssse3, expand3_ssse3<false>, expand3_ssse3<true>,
+                gray_ssse3};
+#endif
+    default:
+        return {swap4_scalar, swap3_scalar, expand3_scalar<false>, expand3_scalar<true>,
+                gray_scalar};
+    }
+}
+
+const Kernels& kernels() noexcept {
+    static const Kernels selected = kernels_for(detectedSimdLevel());
+    return selected;
+}
+
+[[nodiscard]] bool is_quad(PixelFormat format) noexcept {
+    return format == PixelFormat::BGRA32 || format == PixelFormat::RGBA32;
+}
+
+[[nodiscard]] bool is_triple(PixelFormat format) noexcept {
+    return format == PixelFormat::BGR24 || format == PixelFormat::RGB24;
+}
+
+/// @brief Pick the row kernel for a pair (nullptr for identical or unsupported formats)
+[[nodiscard]] RowKernel kernel_for(PixelFormat from, PixelFormat to) noexcept {
+    const Kernels& k = kernels();
+    if (is_quad(from) && is_quad(to) && from != to) {
+        return k.swap4;
+    }
+    if (is_triple(from) && is_triple(to) && from != to) {
+        return k.swap3;
+    }
+    if (is_triple(from) && is_quad(to)) {
+        // Blue first in both, or red first in both
+        bool same_order = (from == PixelFormat::BGR24) == (to == PixelFormat::BGRA32);
+        return same_order ? k.expand3 : k.expand3_swap;
+    }
+    if (from == PixelFormat::Gray8 && is_quad(to)) {
+        return k.gray;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+bool canConvertPixels(PixelFormat from, PixelFormat to) noexcept {
+    return (from == to && bytesPerPixel(from) > 0) || kernel_for(from, to) != nullptr;
+}
+
+bool convertPixels(const uint8_t* src, size_t src_stride, PixelFormat from, uint8_t* dst,
+                   size_t dst_stride, PixelFormat to, uint32_t width, uint32_t height) noexcept {
+    if (!canConvertPixels(from, to)) {
+        return false;
+    }
+
+    RowKernel kernel = kernel_for(from, to);
+    size_t row_bytes = static_cast<size_t>(width) * bytesPerPixel(from);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* in = src + y * src_stride;
+        uint8_t* out = dst + y * dst_stride;
+        if (kernel) {
+            kernel(in, out, width);
+        } else if (in != out) {
+            std::memcpy(out, in, row_bytes);
+        }
+    }
+    return true;
+}
+
+std::expected<DecodedImage, DecodeError> convertPixels(DecodedImage image, PixelFormat format) {
+    PixelFormat from = image.format();
+    if (!canConvertPixels(from, format)) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    if (from == format || !image.valid()) {
+        return image;
+    }
+
+    uint32_t width = image.width();
+    uint32_t height = image.height();
+    if (bytesPerPixel(from) == bytesPerPixel(format)) {
+        // Same size: swap channels in the image's own buffer
+        uint32_t stride = image.stride();
+        PixelBuffer pixels = image.release();
+        convertPixels(pixels.data(), stride, from, pixels.data(), stride, format, width, height);
+        return DecodedImage(width, height, format, stride, std::move(pixels));
+    }
+
+    DecodedImage result(width, height, format);
+    convertPixels(std::as_const(image).data(), image.stride(), from, result.data(),
+                  result.stride(), format, width, height);
+    return result;
+}
+
+}  // namespace nive::image
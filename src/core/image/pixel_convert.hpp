@@ -0,0 +1,47 @@
+/// @file pixel_convert.hpp
+/// @brief Conversions between 8-bit pixel layouts with SSSE3 and AVX2 kernels
+///
+/// Covers what decoders and plugins hand out (RGBA, RGB, BGR, gray) on the
+/// way to BGRA32, the layout D2D and the cache work in. Channel swaps of
+/// equal-size layouts run in place. Kernels are picked once from the same
+/// CPU detection as the resampler.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief Check if convertPixels handles a pair of formats
+/// @return true for identical formats, BGRA32 <-> RGBA32, BGR24 <-> RGB24, and
+///         BGR24, RGB24 or Gray8 to BGRA32 or RGBA32 (alpha set to opaque)
+[[nodiscard]] bool canConvertPixels(PixelFormat from, PixelFormat to) noexcept;
+
+/// @brief Convert rows of pixels between layouts
+/// @param src First source row
+/// @param src_stride Source row stride in bytes
+/// @param from Source layout
+/// @param dst First destination row (may equal src when both layouts have the
+///        same size and the strides match)
+/// @param dst_stride Destination row stride in bytes
+/// @param to Destination layout
+/// @param width Pixels per row
+/// @param height Rows
+/// @return false if canConvertPixels(from, to) is false (nothing is written)
+bool convertPixels(const uint8_t* src, size_t src_stride, PixelFormat from, uint8_t* dst,
+                   size_t dst_stride, PixelFormat to, uint32_t width, uint32_t height) noexcept;
+
+/// @brief Convert an image to another 8-bit layout
+/// @param image Source image; reused in place for channel swaps
+/// @param format Target layout
+/// @return Converted image, DecodeError::UnsupportedFormat for pairs
+///         canConvertPixels rejects
+[[nodiscard]] std::expected<DecodedImage, DecodeError> convertPixels(DecodedImage image,
+                                                                     PixelFormat format);
+
+}  // namespace nive::image
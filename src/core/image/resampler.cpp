@@ -0,0 +1,614 @@
+/// @file resampler.cpp
+/// @brief Separable BGRA32 resampler with SSE4.1 and AVX2 kernels
+
+#include "resampler.hpp"
+
+#include "../util/task_group.hpp"
+#include "../util/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <optional>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#define NIVE_RESAMPLER_X86
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace nive::image {
+
+namespace {
+
+// Coefficients are 14-bit fixed point: an 8-bit sample times a weight, summed
+// over every tap, stays well inside int32 even with Lanczos overshoot
+constexpr int kPrecisionBits = 14;
+constexpr int32_t kOne = 1 << kPrecisionBits;
+constexpr int32_t kRound = 1 << (kPrecisionBits - 1);
+
+// Rows between cancellation checks in each pass
+constexpr uint32_t kBandRows = 64;
+
+// Parallel strips shorter than this cost more in duplicated horizontal work
+// (the filter overlap at each seam) than they save
+constexpr uint32_t kMinStripRows = 64;
+
+/// @brief Taps of every output pixel along one axis
+struct Coefficients {
+    std::vector<uint32_t> start;   // First source index of each output
+    std::vector<uint32_t> count;   // Taps of each output
+    std::vector<int16_t> weights;  // `stride` fixed-point weights per output
+    size_t stride = 0;
+};
+
+double sinc(double x) {
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= std::numbers::pi;
+    return std::sin(x) / x;
+}
+
+double box_kernel(double x) {
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+}
+
+double lanczos3_kernel(double x) {
+    return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+/// @brief Build the fixed-point coefficient table for one axis
+Coefficients compute_coefficients(uint32_t in_size, uint32_t out_size, ResampleFilter filter) {
+    double scale = static_cast<double>(in_size) / out_size;
+    double filter_scale = std::max(scale, 1.0);
+
+    // Half-width of each output's footprint in source pixels
+    double half = 0.0;
+    switch (filter) {
+    case ResampleFilter::Box:
+        half = 0.5 * filter_scale;
+        break;
+    case ResampleFilter::Area:
+        half = 0.5 * scale;
+        break;
+    case ResampleFilter::Lanczos3:
+        half = 3.0 * filter_scale;
+        break;
+    }
+
+    Coefficients table;
+    table.stride = static_cast<size_t>(std::ceil(2.0 * half)) + 2;
+    table.start.resize(out_size);
+    table.count.resize(out_size);
+    table.weights.assign(table.stride * out_size, 0);
+
+    std::vector<double> weights(table.stride);
+    for (uint32_t i = 0; i < out_size; ++i) {
+        double center = (i + 0.5) * scale;
+        auto first = static_cast<int64_t>(std::max(std::floor(center - half), 0.0));
+        auto last = std::min(static_cast<int64_t>(std::ceil(center + half)),
+                             static_cast<int64_t>(in_size));
+        last = std::clamp<int64_t>(last, first + 1, first + static_cast<int64_t>(table.stride));
+
+        double total = 0.0;
+        size_t taps = static_cast<size_t>(last - first);
+        for (size_t k = 0; k < taps; ++k) {
+            double x = static_cast<double>(first + static_cast<int64_t>(k));
+            double w = 0.0;
+            if (filter == ResampleFilter::Area) {
+                w = std::max(std::min(x + 1.0, center + half) - std::max(x, center - half), 0.0);
+            } else if (filter == ResampleFilter::Box) {
+                w = box_kernel((x + 0.5 - center) / filter_scale);
+            } else {
+                w = lanczos3_kernel((x + 0.5 - center) / filter_scale);
+            }
+            weights[k] = w;
+            total += w;
+        }
+        if (total == 0.0) {
+            // Degenerate footprint (tiny upscale step): nearest source pixel
+            std::fill(weights.begin(), weights.begin() + taps, 0.0);
+            weights[std::min(static_cast<size_t>(center - first), taps - 1)] = 1.0;
+            total = 1.0;
+        }
+
+        // Trim zero taps from both ends so kernels do no wasted work
+        size_t begin = 0;
+        size_t end = taps;
+        while (begin + 1 < end && weights[begin] == 0.0) {
+            ++begin;
+        }
+        while (end - 1 > begin && weights[end - 1] == 0.0) {
+            --end;
+        }
+
+        // Quantize, then put the rounding error on the largest tap so a flat
+        // image stays exactly flat
+        int16_t* out = &table.weights[i * table.stride];
+        int32_t sum = 0;
+        size_t largest = 0;
+        for (size_t k = begin; k < end; ++k) {
+            auto fixed = static_cast<int32_t>(std::lround(weights[k] / total * kOne));
+            out[k - begin] = static_cast<int16_t>(fixed);
+            sum += fixed;
+            if (std::abs(fixed) > std::abs(out[largest])) {
+                largest = k - begin;
+            }
+        }
+        out[largest] = static_cast<int16_t>(out[largest] + (kOne - sum));
+
+        table.start[i] = static_cast<uint32_t>(first + static_cast<int64_t>(begin));
+        table.count[i] = static_cast<uint32_t>(end - begin);
+    }
+    return table;
+}
+
+[[nodiscard]] uint8_t clamp_byte(int32_t value) noexcept {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+// Pass kernels. Horizontal: one pixel row to out_width pixels. Vertical: one
+// output row of `row_bytes` from `count` rows of `src` starting at `start`.
+using HorizontalKernel = void (*)(const uint8_t* src, uint8_t* dst, uint32_t out_width,
+                                  const Coefficients& table);
+using VerticalKernel = void (*)(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                                size_t row_bytes, const int16_t* weights, uint32_t start,
+                                uint32_t count);
+
+void horizontal_scalar(const uint8_t* src, uint8_t* dst, uint32_t out_width,
+                       const Coefficients& table) {
+    for (uint32_t x = 0; x < out_width; ++x) {
+        const uint8_t* pixel = src + static_cast<size_t>(table.start[x]) * 4;
+        const int16_t* weights = &table.weights[x * table.stride];
+        int32_t sum[4] = {kRound, kRound, kRound, kRound};
+        for (uint32_t k = 0; k < table.count[x]; ++k) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += pixel[k * 4 + c] * weights[k];
+            }
+        }
+        for (int c = 0; c < 4; ++c) {
+            dst[x * 4 + c] = clamp_byte(sum[c] >> kPrecisionBits);
+        }
+    }
+}
+
+/// @brief Vertical pass over bytes [from, to) of the row
+void vertical_scalar_range(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t from,
+                           size_t to, const int16_t* weights, uint32_t start, uint32_t count) {
+    for (size_t i = from; i < to; ++i) {
+        int32_t sum = kRound;
+        for (uint32_t k = 0; k < count; ++k) {
+            sum += src[(start + k) * src_stride + i] * weights[k];
+        }
+        dst[i] = clamp_byte(sum >> kPrecisionBits);
+    }
+}
+
+void vertical_scalar(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t row_bytes,
+                     const int16_t* weights, uint32_t start, uint32_t count) {
+    vertical_scalar_range(src, src_stride, dst, 0, row_bytes, weights, start, count);
+}
+
+#ifdef NIVE_RESAMPLER_X86
+
+/// @brief Two 16-bit weights in one 32-bit lane, the layout _mm_madd_epi16 pairs with
+[[nodiscard]] int32_t weight_pair(int16_t first, int16_t second) noexcept {
+    return static_cast<int32_t>(static_cast<uint16_t>(first) |
+                                (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16));
+}
+
+[[nodiscard]] int32_t load_u32(const uint8_t* p) noexcept {
+    int32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/// @brief Accumulate the horizontal taps from `k` on with SSE4.1, two at a time
+/// @return [b g r a] sums including the rounding term
+__m128i horizontal_taps_sse41(const uint8_t* pixel, const int16_t* weights, uint32_t k,
+                              uint32_t count, __m128i sum) {
+    // 16-bit [b0 g0 r0 a0 b1 g1 r1 a1] -> [b0 b1 g0 g1 r0 r1 a0 a1]
+    const __m128i interleave =
+        _mm_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+    for (; k + 2 <= count; k += 2) {
+        __m128i pixels = _mm_cvtepu8_epi16(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + k * 4)));
+        pixels = _mm_shuffle_epi8(pixels, interleave);
+        __m128i w = _mm_set1_epi32(weight_pair(weights[k], weights[k + 1]));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, w));
+    }
+    if (k < count) {
+        // Odd tap: pair the last pixel with zero weight
+        __m128i pixels = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(load_u32(pixel + k * 4)));
+        pixels = _mm_shuffle_epi8(pixels, interleave);
+        __m128i w = _mm_set1_epi32(weight_pair(weights[k], 0));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, w));
+    }
+    return sum;
+}
+
+void store_pixel_sse41(uint8_t* dst, __m128i sum) {
+    sum = _mm_srai_epi32(sum, kPrecisionBits);
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum, sum), _mm_setzero_si128());
+    int32_t value = _mm_cvtsi128_si32(packed);
+    std::memcpy(dst, &value, sizeof(value));
+}
+
+void horizontal_sse41(const uint8_t* src, uint8_t* dst, uint32_t out_width,
+                      const Coefficients& table) {
+    const __m128i round = _mm_set1_epi32(kRound);
+    for (uint32_t x = 0; x < out_width; ++x) {
+        const uint8_t* pixel = src + static_cast<size_t>(table.start[x]) * 4;
+        const int16_t* weights = &table.weights[x * table.stride];
+        __m128i sum = horizontal_taps_sse41(pixel, weights, 0, table.count[x], round);
+        store_pixel_sse41(dst + x * 4, sum);
+    }
+}
+
+void horizontal_avx2(const uint8_t* src, uint8_t* dst, uint32_t out_width,
+                     const Coefficients& table) {
+    // Per 128-bit lane, as in horizontal_taps_sse41
+    const __m256i interleave =
+        _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15, 0, 1, 8, 9, 2, 3,
+                         10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+    const __m128i round = _mm_set1_epi32(kRound);
+    for (uint32_t x = 0; x < out_width; ++x) {
+        const uint8_t* pixel = src + static_cast<size_t>(table.start[x]) * 4;
+        const int16_t* weights = &table.weights[x * table.stride];
+        uint32_t count = table.count[x];
+
+        // Four taps at a time: taps k, k+1 in the low lane, k+2, k+3 in the high lane
+        __m256i wide = _mm256_setzero_si256();
+        uint32_t k = 0;
+        for (; k + 4 <= count; k += 4) {
+            __m256i pixels = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + k * 4)));
+            pixels = _mm256_shuffle_epi8(pixels, interleave);
+            int32_t low = weight_pair(weights[k], weights[k + 1]);
+            int32_t high = weight_pair(weights[k + 2], weights[k + 3]);
+            __m256i w = _mm256_setr_epi32(low, low, low, low, high, high, high, high);
+            wide = _mm256_add_epi32(wide, _mm256_madd_epi16(pixels, w));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(wide),
+                                    _mm256_extracti128_si256(wide, 1));
+        sum = horizontal_taps_sse41(pixel, weights, k, count, _mm_add_epi32(sum, round));
+        store_pixel_sse41(dst + x * 4, sum);
+    }
+    _mm256_zeroupper();
+}
+
+void vertical_sse41(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t row_bytes,
+                    const int16_t* weights, uint32_t start, uint32_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(kRound);
+    size_t i = 0;
+    for (; i + 16 <= row_bytes; i += 16) {
+        __m128i s0 = round, s1 = round, s2 = round, s3 = round;
+        for (uint32_t k = 0; k < count; k += 2) {
+            // Rows in pairs; an odd last row is paired with itself at zero weight
+            bool pair = k + 1 < count;
+            const uint8_t* a = src + (start + k) * src_stride + i;
+            const uint8_t* b = pair ? a + src_stride : a;
+            __m128i w = _mm_set1_epi32(weight_pair(weights[k], pair ? weights[k + 1] : 0));
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+            __m128i lo = _mm_unpacklo_epi8(va, vb);
+            __m128i hi = _mm_unpackhi_epi8(va, vb);
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+            s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+        }
+        s0 = _mm_srai_epi32(s0, kPrecisionBits);
+        s1 = _mm_srai_epi32(s1, kPrecisionBits);
+        s2 = _mm_srai_epi32(s2, kPrecisionBits);
+        s3 = _mm_srai_epi32(s3, kPrecisionBits);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    vertical_scalar_range(src, src_stride, dst, i, row_bytes, weights, start, count);
+}
+
+void vertical_avx2(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t row_bytes,
+                   const int16_t* weights, uint32_t start, uint32_t count) {
+    // Same steps as vertical_sse41 in each 128-bit lane; unpack and pack are
+    // both per lane, so the bytes come back out in order
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(kRound);
+    size_t i = 0;
+    for (; i + 32 <= row_bytes; i += 32) {
+        __m256i s0 = round, s1 = round, s2 = round, s3 = round;
+        for (uint32_t k = 0; k < count; k += 2) {
+            bool pair = k + 1 < count;
+            const uint8_t* a = src + (start + k) * src_stride + i;
+            const uint8_t* b = pair ? a + src_stride : a;
+            __m256i w = _mm256_set1_epi32(weight_pair(weights[k], pair ? weights[k + 1] : 0));
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+            __m256i lo = _mm256_unpacklo_epi8(va, vb);
+            __m256i hi = _mm256_unpackhi_epi8(va, vb);
+            s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), w));
+            s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), w));
+            s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), w));
+            s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), w));
+        }
+        s0 = _mm256_srai_epi32(s0, kPrecisionBits);
+        s1 = _mm256_srai_epi32(s1, kPrecisionBits);
+        s2 = _mm256_srai_epi32(s2, kPrecisionBits);
+        s3 = _mm256_srai_epi32(s3, kPrecisionBits);
+        __m256i packed =
+            _mm256_packus_epi16(_mm256_packs_epi32(s0, s1), _mm256_packs_epi32(s2, s3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    _mm256_zeroupper();
+    vertical_sse41(src + i, src_stride, dst + i, row_bytes - i, weights, start, count);
+}
+
+#endif  // NIVE_RESAMPLER_X86
+
+SimdLevel detect_simd_level() noexcept {
+#ifdef NIVE_RESAMPLER_X86
+    int info[4] = {};
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    if (max_leaf < 1) {
+        return SimdLevel::Scalar;
+    }
+
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    // AVX2 also needs the OS to save YMM state on context switches
+    bool avx2 = false;
+    if (osxsave && avx && max_leaf >= 7 && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    if (avx2) {
+        return SimdLevel::Avx2;
+    }
+    if (sse41) {
+        return SimdLevel::Sse41;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+struct Kernels {
+    HorizontalKernel horizontal;
+    VerticalKernel vertical;
+};
+
+Kernels kernels_for(SimdLevel level) noexcept {
+    switch (level) {
+#ifdef NIVE_RESAMPLER_X86
+    case SimdLevel::Avx2:
+        return {horizontal_avx2, vertical_avx2};
+    case SimdLevel::Sse41:
+        return {horizontal_sse41, vertical_sse41};
+#endif
+    default:
+        return {horizontal_scalar, vertical_scalar};
+    }
+}
+
+bool row_has_translucency(const uint8_t* row, uint32_t width) {
+    for (uint32_t x = 0; x < width; ++x) {
+        if (row[x * 4 + 3] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Multiply colour channels by alpha (leaves opaque pixels unchanged)
+void premultiply_row(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    for (size_t i = 0; i < static_cast<size_t>(width) * 4; i += 4) {
+        uint32_t alpha = src[i + 3];
+        for (size_t c = 0; c < 3; ++c) {
+            dst[i + c] = static_cast<uint8_t>((src[i + c] * alpha + 127) / 255);
+        }
+        dst[i + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+/// @brief Divide colour channels by alpha (leaves opaque pixels unchanged)
+void unpremultiply_row(uint8_t* row, uint32_t width) {
+    for (size_t i = 0; i < static_cast<size_t>(width) * 4; i += 4) {
+        uint32_t alpha = row[i + 3];
+        if (alpha == 255) {
+            continue;
+        }
+        for (size_t c = 0; c < 3; ++c) {
+            if (alpha == 0) {
+                row[i + c] = 0;
+                continue;
+            }
+            uint32_t value = (row[i + c] * 255 + alpha / 2) / alpha;
+            row[i + c] = static_cast<uint8_t>(std::min<uint32_t>(value, 255));
+        }
+    }
+}
+
+std::optional<DecodeError> validate(ImageView source, uint32_t target_width,
+                                    uint32_t target_height) {
+    if (!source.valid()) {
+        return DecodeError::CorruptedData;
+    }
+    if (source.format() != PixelFormat::BGRA32) {
+        return DecodeError::UnsupportedFormat;
+    }
+    if (target_width == 0 || target_height == 0) {
+        return DecodeError::InternalError;
+    }
+    return std::nullopt;
+}
+
+/// @brief Resample output rows [y_begin, y_end) into `pixels` (tightly packed rows)
+/// @return false if cancelled; throws std::bad_alloc
+///
+/// A strip runs its own horizontal pass over the source rows it reads, so
+/// strips are independent. Translucent source rows are premultiplied as they
+/// are read; since that leaves opaque pixels unchanged, strips agree at
+/// their seams whichever rows they saw.
+bool resample_strip(ImageView source, const Coefficients& columns,
+                    const Coefficients& rows, uint32_t y_begin, uint32_t y_end, uint8_t* pixels,
+                    const Kernels& kernels, std::stop_token stop_token) {
+    uint32_t first_row = source.height();
+    uint32_t last_row = 0;
+    for (uint32_t y = y_begin; y < y_end; ++y) {
+        first_row = std::min(first_row, rows.start[y]);
+        last_row = std::max(last_row, rows.start[y] + rows.count[y]);
+    }
+    if (first_row >= last_row) {
+        return true;
+    }
+
+    auto target_width = static_cast<uint32_t>(columns.start.size());
+    size_t row_bytes = static_cast<size_t>(target_width) * 4;
+
+    // Horizontal pass, over only the source rows this strip reads. Its rows
+    // start on cache lines, so the vertical pass loads aligned memory.
+    size_t intermediate_stride =
+        alignedStride(target_width, PixelFormat::BGRA32, kSimdRowAlignment);
+    PixelBuffer intermediate(intermediate_stride * (last_row - first_row));
+    std::vector<uint8_t> premultiplied;
+    bool translucent = false;
+    for (uint32_t y = first_row; y < last_row; ++y) {
+        if ((y - first_row) % kBandRows == 0 && stop_token.stop_requested()) {
+            return false;
+        }
+        const uint8_t* row = source.row(y);
+        if (row_has_translucency(row, source.width())) {
+            premultiplied.resize(static_cast<size_t>(source.width()) * 4);
+            premultiply_row(row, premultiplied.data(), source.width());
+            row = premultiplied.data();
+            translucent = true;
+        }
+        kernels.horizontal(row, intermediate.data() + intermediate_stride * (y - first_row),
+                           target_width, columns);
+    }
+
+    // Vertical pass
+    for (uint32_t y = y_begin; y < y_end; ++y) {
+        if ((y - y_begin) % kBandRows == 0 && stop_token.stop_requested()) {
+            return false;
+        }
+        uint8_t* out = pixels + row_bytes * y;
+        kernels.vertical(intermediate.data(), intermediate_stride, out, row_bytes,
+                         &rows.weights[y * rows.stride], rows.start[y] - first_row,
+                         rows.count[y]);
+        if (translucent) {
+            unpremultiply_row(out, target_width);
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+SimdLevel detectedSimdLevel() noexcept {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const char* to_string(SimdLevel level) noexcept {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::Sse41:
+        return "sse4.1";
+    case SimdLevel::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+std::expected<DecodedImage, DecodeError>
+resampleBgra(ImageView source, uint32_t target_width, uint32_t target_height,
+             ResampleFilter filter, std::stop_token stop_token) {
+    if (auto error = validate(source, target_width, target_height)) {
+        return std::unexpected(*error);
+    }
+
+    const Kernels kernels = kernels_for(detectedSimdLevel());
+    try {
+        Coefficients columns = compute_coefficients(source.width(), target_width, filter);
+        Coefficients rows = compute_coefficients(source.height(), target_height, filter);
+
+        size_t row_bytes = static_cast<size_t>(target_width) * 4;
+        PixelBuffer pixels(row_bytes * target_height);
+        if (!resample_strip(source, columns, rows, 0, target_height, pixels.data(), kernels,
+                            stop_token)) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+        return DecodedImage(target_width, target_height, PixelFormat::BGRA32,
+                            static_cast<uint32_t>(row_bytes), std::move(pixels));
+    } catch (const std::bad_alloc&) {
+        return std::unexpected(DecodeError::OutOfMemory);
+    }
+}
+
+std::expected<DecodedImage, DecodeError>
+resampleBgraParallel(ImageView source, uint32_t target_width, uint32_t target_height,
+                     ResampleFilter filter, ThreadPool& pool, std::stop_token stop_token) {
+    if (auto error = validate(source, target_width, target_height)) {
+        return std::unexpected(*error);
+    }
+
+    const Kernels kernels = kernels_for(detectedSimdLevel());
+    Coefficients columns;
+    Coefficients rows;
+    PixelBuffer pixels;
+    size_t row_bytes = static_cast<size_t>(target_width) * 4;
+    try {
+        columns = compute_coefficients(source.width(), target_width, filter);
+        rows = compute_coefficients(source.height(), target_height, filter);
+        pixels.resize(row_bytes * target_height);
+    } catch (const std::bad_alloc&) {
+        return std::unexpected(DecodeError::OutOfMemory);
+    }
+
+    // One strip per worker plus the calling thread, none shorter than kMinStripRows
+    size_t strips =
+        std::clamp<size_t>(target_height / kMinStripRows, 1, pool.workerCount() + 1);
+    size_t strip_rows = (target_height + strips - 1) / strips;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> out_of_memory{false};
+    parallelFor(
+        0, target_height, strip_rows,
+        [&](size_t y_begin, size_t y_end) {
+            if (cancelled.load(std::memory_order_relaxed) ||
+                out_of_memory.load(std::memory_order_relaxed)) {
+                return;
+            }
+            try {
+                if (!resample_strip(source, columns, rows, static_cast<uint32_t>(y_begin),
+                                    static_cast<uint32_t>(y_end), pixels.data(), kernels,
+                                    stop_token)) {
+                    cancelled.store(true, std::memory_order_relaxed);
+                }
+            } catch (const std::bad_alloc&) {
+                out_of_memory.store(true, std::memory_order_relaxed);
+            }
+        },
+        pool);
+
+    if (out_of_memory.load(std::memory_order_relaxed)) {
+        return std::unexpected(DecodeError::OutOfMemory);
+    }
+    if (cancelled.load(std::memory_order_relaxed)) {
+        return std::unexpected(DecodeError::Cancelled);
+    }
+    return DecodedImage(target_width, target_height, PixelFormat::BGRA32,
+                        static_cast<uint32_t>(row_bytes), std::move(pixels));
+}
+
+}  // namespace nive::image
@@ -0,0 +1,65 @@
+/// @file resampler.hpp
+/// @brief Native separable resampler for BGRA32 images
+///
+/// Backs ScaleMode::Box, Area and Lanczos in scaleImage, without the WIC
+/// bitmap round trip. Kernels use AVX2 or SSE4.1 when the CPU has them.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <stop_token>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive {
+class ThreadPool;
+}
+
+namespace nive::image {
+
+/// @brief Separable resampling filter
+enum class ResampleFilter {
+    Box,       // Box kernel sampled at source pixel centres
+    Area,      // Exact pixel-area coverage (like WIC Fant)
+    Lanczos3,  // Windowed sinc with three lobes, sharpest
+};
+
+/// @brief Instruction set the resampler kernels run with
+enum class SimdLevel {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+/// @brief Get the best instruction set this CPU and OS support (detected once)
+[[nodiscard]] SimdLevel detectedSimdLevel() noexcept;
+
+[[nodiscard]] const char* to_string(SimdLevel level) noexcept;
+
+/// @brief Resample a BGRA32 image
+/// @param source Source image (must be PixelFormat::BGRA32)
+/// @param target_width Output width in pixels
+/// @param target_height Output height in pixels
+/// @param filter Filter for both axes
+/// @param stop_token Checked between row bands
+/// @return Resampled BGRA32 image or error (DecodeError::Cancelled once stop is requested)
+///
+/// Filters are applied horizontally then vertically with 14-bit fixed-point
+/// coefficient tables computed once per axis. Translucent images are
+/// resampled premultiplied, so transparent pixels do not bleed colour.
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+resampleBgra(ImageView source, uint32_t target_width, uint32_t target_height,
+             ResampleFilter filter, std::stop_token stop_token = {});
+
+/// @brief Resample a BGRA32 image with output rows split into strips across a pool
+/// @param pool Pool running all strips but the first, which runs on the calling thread
+///
+/// Same result as resampleBgra. Blocks until every strip is done, so it must
+/// not be called from a task of the same pool.
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+resampleBgraParallel(ImageView source, uint32_t target_width, uint32_t target_height,
+                     ResampleFilter filter, ThreadPool& pool, std::stop_token stop_token = {});
+
+}  // namespace nive::image
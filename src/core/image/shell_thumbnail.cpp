@@ -0,0 +1,91 @@
+/// @file shell_thumbnail.cpp
+/// @brief Shell thumbnail cache lookup
+
+#include "shell_thumbnail.hpp"
+#include <Windows.h>
+
+#include <ShObjIdl.h>
+
+#include <cstring>
+
+#include "../util/com_ptr.hpp"
+
+namespace nive::image {
+
+namespace {
+
+/// @brief Owns an HBITMAP returned by the shell
+struct BitmapHandle {
+    HBITMAP handle = nullptr;
+    ~BitmapHandle() {
+        if (handle) {
+            DeleteObject(handle);
+        }
+    }
+};
+
+/// @brief Copy a 32bpp DIB section into a top-down BGRA32 image
+std::expected<DecodedImage, DecodeError> copy_bitmap(HBITMAP bitmap) {
+    BITMAP info{};
+    if (!GetObjectW(bitmap, sizeof(info), &info) || info.bmWidth <= 0 || info.bmHeight == 0) {
+        return std::unexpected(DecodeError::InternalError);
+    }
+    auto width = static_cast<uint32_t>(info.bmWidth);
+    auto height = static_cast<uint32_t>(info.bmHeight < 0 ? -info.bmHeight : info.bmHeight);
+
+    DecodedImage image(width, height, PixelFormat::BGRA32);
+    BITMAPINFO header{};
+    header.bmiHeader.biSize = sizeof(header.bmiHeader);
+    header.bmiHeader.biWidth = static_cast<LONG>(width);
+    header.bmiHeader.biHeight = -static_cast<LONG>(height);  // Top-down
+    header.bmiHeader.biPlanes = 1;
+    header.bmiHeader.biBitCount = 32;
+    header.bmiHeader.biCompression = BI_RGB;
+
+    HDC dc = GetDC(nullptr);
+    int rows = GetDIBits(dc, bitmap, 0, height, image.pixels().data(), &header,
+                         DIB_RGB_COLORS);
+    ReleaseDC(nullptr, dc);
+    if (rows != static_cast<int>(height)) {
+        return std::unexpected(DecodeError::InternalError);
+    }
+
+    // Opaque photo thumbnails often come back with the alpha channel left at zero
+    auto pixels = image.pixels();
+    bool any_alpha = false;
+    for (size_t i = 3; i < pixels.size() && !any_alpha; i += 4) {
+        any_alpha = pixels[i] != 0;
+    }
+    if (!any_alpha) {
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 0xFF;
+        }
+    }
+    return image;
+}
+
+}  // namespace
+
+std::expected<PreviewImage, DecodeError>
+shellCachedThumbnail(const std::filesystem::path& path, uint32_t min_size) {
+    ComPtr<IShellItemImageFactory> factory;
+    if (FAILED(SHCreateItemFromParsingName(path.c_str(), nullptr, IID_PPV_ARGS(&factory)))) {
+        return std::unexpected(DecodeError::FileNotFound);
+    }
+
+    SIZE size{static_cast<LONG>(min_size), static_cast<LONG>(min_size)};
+    BitmapHandle bitmap;
+    HRESULT hr = factory->GetImage(
+        size, SIIGBF_INCACHEONLY | SIIGBF_THUMBNAILONLY | SIIGBF_BIGGERSIZEOK, &bitmap.handle);
+    if (FAILED(hr) || !bitmap.handle) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+
+    auto image = copy_bitmap(bitmap.handle);
+    if (!image) {
+        return std::unexpected(image.error());
+    }
+    return PreviewImage{.image = std::move(*image)};
+}
+
+}  // namespace nive::image
@@ -0,0 +1,29 @@
+/// @file shell_thumbnail.hpp
+/// @brief Thumbnails Windows already holds in its shell thumbnail cache
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+
+#include "image_decoder.hpp"
+#include "wic_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief Get the thumbnail Explorer cached for a file, without generating one
+/// @param path File on disk
+/// @param min_size Longer side wanted; a larger cached thumbnail is returned as is
+/// @return BGRA32 thumbnail, or DecodeError::UnsupportedFormat if none is cached
+///
+/// Asks IShellItemImageFactory for SIIGBF_INCACHEONLY | SIIGBF_THUMBNAILONLY,
+/// so it only reads thumbcache_*.db and never runs a thumbnail handler or
+/// falls back to the file's icon. For RAW, HEIC and other formats that are
+/// slow to decode this is far cheaper than the decode it replaces. The
+/// source size is not known from the cache, so source_width and
+/// source_height are 0. Call on a thread with COM initialised.
+[[nodiscard]] std::expected<PreviewImage, DecodeError>
+shellCachedThumbnail(const std::filesystem::path& path, uint32_t min_size);
+
+}  // namespace nive::image
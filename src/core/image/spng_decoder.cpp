@@ -0,0 +1,156 @@
+/// @file spng_decoder.cpp
+/// @brief libspng PNG decoder implementation
+
+#include "spng_decoder.hpp"
+
+#include <spng.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "pixel_convert.hpp"
+
+namespace nive::image {
+
+namespace {
+
+constexpr std::array<std::string_view, 1> SUPPORTED_EXTENSIONS = {"png"};
+
+constexpr uint8_t PNG_MAGIC[] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// Images larger than this are left to WIC (and the viewer's tiled path)
+constexpr uint32_t kMaxDimension = 65535;
+
+using SpngContext = std::unique_ptr<spng_ctx, decltype(&spng_ctx_free)>;
+
+[[nodiscard]] DecodeError to_decode_error(int error) noexcept {
+    return error == SPNG_EMEM ? DecodeError::OutOfMemory : DecodeError::CorruptedData;
+}
+
+/// @brief Create a context reading the buffer and parse the header
+[[nodiscard]] std::expected<SpngContext, DecodeError> open_png(std::span<const uint8_t> data,
+                                                              spng_ihdr& ihdr) {
+    SpngContext ctx(spng_ctx_new(0), &spng_ctx_free);
+    if (!ctx) {
+        return std::unexpected(DecodeError::OutOfMemory);
+    }
+    spng_set_image_limits(ctx.get(), kMaxDimension, kMaxDimension);
+    if (int error = spng_set_png_buffer(ctx.get(), data.data(), data.size()); error != 0) {
+        return std::unexpected(to_decode_error(error));
+    }
+    if (int error = spng_get_ihdr(ctx.get(), &ihdr); error != 0) {
+        return std::unexpected(to_decode_error(error));
+    }
+    return ctx;
+}
+
+[[nodiscard]] bool has_alpha(spng_ctx* ctx, const spng_ihdr& ihdr) noexcept {
+    if (ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA ||
+        ihdr.color_type == SPNG_COLOR_TYPE_TRUECOLOR_ALPHA) {
+        return true;
+    }
+    spng_trns trns{};
+    return spng_get_trns(ctx, &trns) == 0;
+}
+
+}  // namespace
+
+std::string_view SpngDecoder::name() const noexcept {
+    return "libspng";
+}
+
+std::span<const std::string_view> SpngDecoder::supportedExtensions() const noexcept {
+    return SUPPORTED_EXTENSIONS;
+}
+
+bool SpngDecoder::supportsExtension(std::string_view extension) const noexcept {
+    return std::ranges::find(SUPPORTED_EXTENSIONS, extension) != SUPPORTED_EXTENSIONS.end();
+}
+
+bool SpngDecoder::canDecode(std::span<const uint8_t> data) const noexcept {
+    return data.size() >= sizeof(PNG_MAGIC) &&
+           std::equal(std::begin(PNG_MAGIC), std::end(PNG_MAGIC), data.begin());
+}
+
+std::expected<ImageInfo, DecodeError>
+SpngDecoder::getInfoFromMemory(std::span<const uint8_t> data) const {
+    spng_ihdr ihdr{};
+    auto ctx = open_png(data, ihdr);
+    if (!ctx) {
+        return std::unexpected(ctx.error());
+    }
+
+    ImageInfo info;
+    info.width = ihdr.width;
+    info.height = ihdr.height;
+    info.has_alpha = has_alpha(ctx->get(), ihdr);
+    info.high_precision = ihdr.bit_depth == 16;
+    if (info.has_alpha) {
+        info.format = PixelFormat::BGRA32;
+    } else if (ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE) {
+        info.format = ihdr.bit_depth == 16 ? PixelFormat::Gray16 : PixelFormat::Gray8;
+    } else {
+        info.format = PixelFormat::BGR24;
+    }
+
+    // pHYs, when given in pixels per metre
+    spng_phys phys{};
+    if (spng_get_phys(ctx->get(), &phys) == 0 && phys.unit_specifier == 1 && phys.ppu_x > 0 &&
+        phys.ppu_y > 0) {
+        info.dpi_x = static_cast<uint32_t>(std::lround(phys.ppu_x * 0.0254));
+        info.dpi_y = static_cast<uint32_t>(std::lround(phys.ppu_y * 0.0254));
+    }
+    return info;
+}
+
+std::expected<DecodedImage, DecodeError>
+SpngDecoder::decodeFromMemory(std::span<const uint8_t> data, PixelFormat target_format) const {
+    if (target_format != PixelFormat::BGRA32) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    spng_ihdr ihdr{};
+    auto ctx = open_png(data, ihdr);
+    if (!ctx) {
+        return std::unexpected(ctx.error());
+    }
+
+    size_t size = 0;
+    if (int error = spng_decoded_image_size(ctx->get(), SPNG_FMT_RGBA8, &size); error != 0) {
+        return std::unexpected(to_decode_error(error));
+    }
+    DecodedImage image(ihdr.width, ihdr.height, PixelFormat::BGRA32);
+    auto pixels = image.pixels();
+    if (size != pixels.size()) {
+        return std::unexpected(DecodeError::InternalError);
+    }
+    if (int error = spng_decode_image(ctx->get(), pixels.data(), pixels.size(), SPNG_FMT_RGBA8,
+                                      SPNG_DECODE_TRNS);
+        error != 0) {
+        return std::unexpected(to_decode_error(error));
+    }
+
+    // libspng has no BGRA output; swap R and B in place
+    convertPixels(pixels.data(), image.stride(), PixelFormat::RGBA32, pixels.data(),
+                  image.stride(), PixelFormat::BGRA32, image.width(), image.height());
+    return image;
+}
+
+std::expected<PreviewImage, DecodeError>
+SpngDecoder::decodeThumbnailFromMemory(std::span<const uint8_t> data,
+                                       uint32_t /*min_size*/) const {
+    auto image = decodeFromMemory(data);
+    if (!image) {
+        return std::unexpected(image.error());
+    }
+    PreviewImage preview;
+    preview.source_width = image->width();
+    preview.source_height = image->height();
+    preview.image = std::move(*image);
+    return preview;
+}
+
+}  // namespace nive::image
@@ -0,0 +1,40 @@
+/// @file spng_decoder.hpp
+/// @brief PNG decoder using libspng
+
+#pragma once
+
+#include "native_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief PNG decoder using libspng
+///
+/// Every bit depth and colour type is expanded to 8-bit BGRA, with tRNS
+/// transparency applied. Only the first frame of an animated PNG is read.
+///
+/// Thread-safe: yes (one libspng context per call)
+class SpngDecoder final : public NativeDecoder {
+public:
+    SpngDecoder() = default;
+
+    [[nodiscard]] std::string_view name() const noexcept override;
+
+    [[nodiscard]] std::span<const std::string_view> supportedExtensions() const noexcept override;
+
+    [[nodiscard]] bool supportsExtension(std::string_view extension) const noexcept override;
+
+    [[nodiscard]] bool canDecode(std::span<const uint8_t> data) const noexcept override;
+
+    [[nodiscard]] std::expected<ImageInfo, DecodeError>
+    getInfoFromMemory(std::span<const uint8_t> data) const override;
+
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decodeFromMemory(std::span<const uint8_t> data,
+                     PixelFormat target_format = PixelFormat::BGRA32) const override;
+
+    /// @brief Decode at full size (PNG has no reduced decode); orientation is not applied
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t min_size) const override;
+};
+
+}  // namespace nive::image
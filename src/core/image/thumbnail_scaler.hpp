@@ -0,0 +1,34 @@
+/// @file thumbnail_scaler.hpp
+/// @brief Interface for handing the final thumbnail resample to another device
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <stop_token>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief Scaler the thumbnail generator offloads its final resample to
+///
+/// The generator calls it from every decode worker at once, so
+/// implementations must be thread-safe; they are free to batch concurrent
+/// calls into one submission. Any error lets the caller fall back to
+/// generateThumbnail() on the CPU.
+class IThumbnailScaler {
+public:
+    virtual ~IThumbnailScaler() = default;
+
+    /// @brief Scale a BGRA32 image to fit inside max_size x max_size
+    /// @param source Decoded image, larger than max_size on its longer side
+    /// @param max_size Longer side of the result
+    /// @param stop_token Checked before the work is submitted
+    /// @return Scaled BGRA32 image, or an error (DecodeError::Cancelled once stop is requested)
+    [[nodiscard]] virtual std::expected<DecodedImage, DecodeError>
+    scaleThumbnail(ImageView source, uint32_t max_size, std::stop_token stop_token) = 0;
+};
+
+}  // namespace nive::image
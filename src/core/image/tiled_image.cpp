@@ -0,0 +1,363 @@
+/// @file tiled_image.cpp
+/// @brief Tiled image implementation over WIC bitmap sources
+
+#include "tiled_image.hpp"
+#include <Windows.h>
+
+#include <wincodec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../util/com_ptr.hpp"
+#include "../util/lru_cache.hpp"
+#include "resampler.hpp"
+#include "wic_factory.hpp"
+
+namespace nive::image {
+
+namespace {
+
+// Levels whose whole image fits within this many pixels per side are decoded
+// whole, in one streaming pass, and tiles are cut from that copy. Asking WIC
+// for a rectangle of such a level would decode most of the file per tile.
+constexpr uint32_t kWholeLevelSize = 2048;
+
+// Rows copied per CopyPixels call while decoding a whole level
+constexpr uint32_t kBandRows = 256;
+
+DecodeError open_error(HRESULT hr) {
+    switch (hr) {
+    case HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND):
+    case HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND):
+        return DecodeError::FileNotFound;
+    case HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED):
+        return DecodeError::AccessDenied;
+    case WINCODEC_ERR_COMPONENTNOTFOUND:
+    case WINCODEC_ERR_UNKNOWNIMAGEFORMAT:
+        return DecodeError::UnsupportedFormat;
+    case E_OUTOFMEMORY:
+        return DecodeError::OutOfMemory;
+    default:
+        return DecodeError::CorruptedData;
+    }
+}
+
+/// @brief Side of a level: full size halved per level, rounded up, at least 1
+uint32_t level_side(uint32_t side, uint32_t level) noexcept {
+    uint64_t divisor = uint64_t{1} << level;
+    return static_cast<uint32_t>(std::max<uint64_t>((side + divisor - 1) / divisor, 1));
+}
+
+}  // namespace
+
+/// @brief Tiled image implementation
+class TiledImage::Impl {
+public:
+    explicit Impl(const TiledImageConfig& config)
+        : tile_size_(std::max<uint32_t>(config.tile_size, 16)), tiles_(config.cache_bytes) {}
+
+    [[nodiscard]] std::expected<void, DecodeError> open(const std::filesystem::path& path) {
+        factory_ = wicFactory();
+        if (!factory_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+
+        HRESULT hr = factory_->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                 WICDecodeMetadataCacheOnDemand, &decoder_);
+        if (FAILED(hr)) {
+            return std::unexpected(open_error(hr));
+        }
+
+        ComPtr<IWICBitmapFrameDecode> frame;
+        hr = decoder_->GetFrame(0, &frame);
+        if (FAILED(hr)) {
+            return std::unexpected(open_error(hr));
+        }
+
+        ComPtr<IWICFormatConverter> converter;
+        hr = factory_->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr)) {
+            hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA,
+                                       WICBitmapDitherTypeNone, nullptr, 0.0,
+                                       WICBitmapPaletteTypeCustom);
+        }
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::UnsupportedFormat);
+        }
+
+        UINT width = 0, height = 0;
+        hr = converter->GetSize(&width, &height);
+        if (FAILED(hr) || width == 0 || height == 0) {
+            return std::unexpected(DecodeError::CorruptedData);
+        }
+        width_ = width;
+        height_ = height;
+
+        // Halve down to the first level that fits in a single tile
+        uint32_t level_count = 1;
+        while (std::max(level_side(width_, level_count - 1),
+                        level_side(height_, level_count - 1)) > tile_size_) {
+            ++level_count;
+        }
+        whole_level_ = level_count - 1;
+        for (uint32_t level = 0; level < level_count; ++level) {
+            if (std::max(levelWidth(level), levelHeight(level)) <= kWholeLevelSize) {
+                whole_level_ = level;
+                break;
+            }
+        }
+
+        sources_.resize(level_count);
+        sources_[0] = converter;
+        whole_images_.resize(level_count);
+        return {};
+    }
+
+    [[nodiscard]] uint32_t width() const noexcept { return width_; }
+    [[nodiscard]] uint32_t height() const noexcept { return height_; }
+    [[nodiscard]] uint32_t tileSize() const noexcept { return tile_size_; }
+
+    [[nodiscard]] uint32_t levelCount() const noexcept {
+        return static_cast<uint32_t>(sources_.size());
+    }
+
+    [[nodiscard]] uint32_t levelWidth(uint32_t level) const noexcept {
+        return level_side(width_, level);
+    }
+
+    [[nodiscard]] uint32_t levelHeight(uint32_t level) const noexcept {
+        return level_side(height_, level);
+    }
+
+    [[nodiscard]] uint32_t columns(uint32_t level) const noexcept {
+        return (levelWidth(level) + tile_size_ - 1) / tile_size_;
+    }
+
+    [[nodiscard]] uint32_t rows(uint32_t level) const noexcept {
+        return (levelHeight(level) + tile_size_ - 1) / tile_size_;
+    }
+
+    [[nodiscard]] uint32_t levelForScale(float scale) const noexcept {
+        if (!(scale > 0.0f) || scale >= 1.0f) {
+            return 0;
+        }
+        auto level = static_cast<uint32_t>(std::floor(std::log2(1.0f / scale)));
+        return std::min(level, levelCount() - 1);
+    }
+
+    [[nodiscard]] std::expected<std::shared_ptr<const DecodedImage>, DecodeError>
+    tile(const TileKey& key) {
+        if (auto cached = cachedTile(key)) {
+            return cached;
+        }
+        if (key.level >= levelCount() || key.column >= columns(key.level) ||
+            key.row >= rows(key.level)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        uint32_t x = key.column * tile_size_;
+        uint32_t y = key.row * tile_size_;
+        uint32_t w = std::min(tile_size_, levelWidth(key.level) - x);
+        uint32_t h = std::min(tile_size_, levelHeight(key.level) - y);
+
+        std::expected<DecodedImage, DecodeError> decoded;
+        if (key.level >= whole_level_) {
+            auto whole = whole_image(key.level);
+            if (!whole) {
+                return std::unexpected(whole.error());
+            }
+            // A view into the whole level, which it keeps alive
+            decoded = DecodedImage((*whole)->view().crop(x, y, w, h), *whole);
+        } else {
+            decoded = copy_rect(key.level, x, y, w, h);
+        }
+        if (!decoded) {
+            return std::unexpected(decoded.error());
+        }
+
+        // Cropped tiles are charged their own pixels, not the rows they span
+        auto result = std::make_shared<const DecodedImage>(std::move(*decoded));
+        tiles_.put(key.packed(), result, static_cast<size_t>(w) * h * 4);
+        return result;
+    }
+
+    [[nodiscard]] std::shared_ptr<const DecodedImage> cachedTile(const TileKey& key) {
+        auto cached = tiles_.get(key.packed());
+        return cached ? *cached : nullptr;
+    }
+
+    [[nodiscard]] size_t cachedBytes() const noexcept { return tiles_.totalCost(); }
+
+private:
+    /// @brief Get the WIC source producing a level, creating its scaler if needed
+    [[nodiscard]] IWICBitmapSource* level_source(uint32_t level) {
+        if (!sources_[level]) {
+            ComPtr<IWICBitmapScaler> scaler;
+            HRESULT hr = factory_->CreateBitmapScaler(&scaler);
+            if (SUCCEEDED(hr)) {
+                hr = scaler->Initialize(sources_[0].Get(), levelWidth(level), levelHeight(level),
+                                        WICBitmapInterpolationModeFant);
+            }
+            if (FAILED(hr)) {
+                return nullptr;
+            }
+            sources_[level] = scaler;
+        }
+        return sources_[level].Get();
+    }
+
+    /// @brief Decode one rectangle of a level through CopyPixels
+    [[nodiscard]] std::expected<void, DecodeError> copy_pixels(uint32_t level, uint32_t x,
+                                                               uint32_t y, uint32_t w, uint32_t h,
+                                                               uint8_t* dest, uint32_t stride) {
+        IWICBitmapSource* source = level_source(level);
+        if (!source) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+        WICRect rect{static_cast<INT>(x), static_cast<INT>(y), static_cast<INT>(w),
+                     static_cast<INT>(h)};
+        HRESULT hr = source->CopyPixels(&rect, stride, stride * h, dest);
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::CorruptedData);
+        }
+        return {};
+    }
+
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    copy_rect(uint32_t level, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+        DecodedImage result;
+        try {
+            result = DecodedImage(w, h, PixelFormat::BGRA32);
+        } catch (const std::bad_alloc&) {
+            return std::unexpected(DecodeError::OutOfMemory);
+        }
+        auto copied = copy_pixels(level, x, y, w, h, result.data(), result.stride());
+        if (!copied) {
+            return std::unexpected(copied.error());
+        }
+        return result;
+    }
+
+    /// @brief Get a coarse level decoded whole, decoding it on first use
+    ///
+    /// whole_level_ is streamed through a WIC scaler in row bands; coarser
+    /// levels are resampled from it.
+    [[nodiscard]] std::expected<std::shared_ptr<const DecodedImage>, DecodeError>
+    whole_image(uint32_t level) {
+        auto& slot = whole_images_[level];
+        if (slot) {
+            return slot;
+        }
+
+        std::expected<DecodedImage, DecodeError> decoded;
+        if (level == whole_level_) {
+            uint32_t w = levelWidth(level);
+            uint32_t h = levelHeight(level);
+            DecodedImage image;
+            try {
+                image = DecodedImage(w, h, PixelFormat::BGRA32, kSimdRowAlignment);
+            } catch (const std::bad_alloc&) {
+                return std::unexpected(DecodeError::OutOfMemory);
+            }
+            for (uint32_t y = 0; y < h; y += kBandRows) {
+                auto copied = copy_pixels(level, 0, y, w, std::min<uint32_t>(kBandRows, h - y),
+                                          image.row(y), image.stride());
+                if (!copied) {
+                    return std::unexpected(copied.error());
+                }
+            }
+            decoded = std::move(image);
+        } else {
+            auto finer = whole_image(whole_level_);
+            if (!finer) {
+                return std::unexpected(finer.error());
+            }
+            decoded = resampleBgra(**finer, levelWidth(level), levelHeight(level),
+                                   ResampleFilter::Area);
+        }
+        if (!decoded) {
+            return std::unexpected(decoded.error());
+        }
+
+        slot = std::make_shared<const DecodedImage>(std::move(*decoded));
+        return slot;
+    }
+
+    uint32_t tile_size_;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t whole_level_ = 0;  // Finest level decoded whole rather than by rectangle
+
+    ComPtr<IWICImagingFactory> factory_;
+    ComPtr<IWICBitmapDecoder> decoder_;
+    std::vector<ComPtr<IWICBitmapSource>> sources_;  // Per level, created on demand
+    std::vector<std::shared_ptr<const DecodedImage>> whole_images_;  // Levels >= whole_level_
+
+    LruCache<uint64_t, std::shared_ptr<const DecodedImage>> tiles_;
+};
+
+TiledImage::TiledImage(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+TiledImage::~TiledImage() = default;
+
+std::expected<std::unique_ptr<TiledImage>, DecodeError>
+TiledImage::open(const std::filesystem::path& path, const TiledImageConfig& config) {
+    auto impl = std::make_unique<Impl>(config);
+    if (auto opened = impl->open(path); !opened) {
+        return std::unexpected(opened.error());
+    }
+    return std::unique_ptr<TiledImage>(new TiledImage(std::move(impl)));
+}
+
+uint32_t TiledImage::width() const noexcept {
+    return impl_->width();
+}
+
+uint32_t TiledImage::height() const noexcept {
+    return impl_->height();
+}
+
+uint32_t TiledImage::tileSize() const noexcept {
+    return impl_->tileSize();
+}
+
+uint32_t TiledImage::levelCount() const noexcept {
+    return impl_->levelCount();
+}
+
+uint32_t TiledImage::levelWidth(uint32_t level) const noexcept {
+    return impl_->levelWidth(level);
+}
+
+uint32_t TiledImage::levelHeight(uint32_t level) const noexcept {
+    return impl_->levelHeight(level);
+}
+
+uint32_t TiledImage::columns(uint32_t level) const noexcept {
+    return impl_->columns(level);
+}
+
+uint32_t TiledImage::rows(uint32_t level) const noexcept {
+    return impl_->rows(level);
+}
+
+uint32_t TiledImage::levelForScale(float scale) const noexcept {
+    return impl_->levelForScale(scale);
+}
+
+std::expected<std::shared_ptr<const DecodedImage>, DecodeError>
+TiledImage::tile(const TileKey& key) {
+    return impl_->tile(key);
+}
+
+std::shared_ptr<const DecodedImage> TiledImage::cachedTile(const TileKey& key) {
+    return impl_->cachedTile(key);
+}
+
+size_t TiledImage::cachedBytes() const noexcept {
+    return impl_->cachedBytes();
+}
+
+}  // namespace nive::image
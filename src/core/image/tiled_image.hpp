@@ -0,0 +1,105 @@
+/// @file tiled_image.hpp
+/// @brief Image decoded on demand in tiles, with a pyramid of reduced levels
+///
+/// For images too large to decode whole (gigapixel panoramas, scans), only
+/// the tiles on screen are decoded, each through a WIC CopyPixels call
+/// limited to the tile's rectangle.
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+
+#include "decoded_image.hpp"
+#include "image_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief Position of a tile in a TiledImage
+struct TileKey {
+    uint32_t level = 0;  // 0 = full size, each further level halves both sides
+    uint32_t column = 0;
+    uint32_t row = 0;
+
+    [[nodiscard]] bool operator==(const TileKey&) const = default;
+
+    /// @brief Pack into one integer, for use as a cache key
+    [[nodiscard]] uint64_t packed() const noexcept {
+        return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(row) << 24) | column;
+    }
+};
+
+/// @brief TiledImage configuration
+struct TiledImageConfig {
+    uint32_t tile_size = 512;                  // Tile side in pixels at every level
+    size_t cache_bytes = 256ull * 1024 * 1024;  // Budget for decoded tiles
+};
+
+/// @brief Image split into tiles that are decoded when first asked for
+///
+/// Level 0 is the image at full size; level n is scaled by 2^-n, down to the
+/// first level that fits in one tile. Decoded tiles (BGRA32) are kept in an
+/// LRU cache bounded by TiledImageConfig::cache_bytes. Tiles of the coarse
+/// levels decoded whole view that level's buffer instead of copying out of it.
+///
+/// Thread-safe: no (meant for the viewer's UI thread)
+class TiledImage {
+public:
+    ~TiledImage();
+
+    TiledImage(const TiledImage&) = delete;
+    TiledImage& operator=(const TiledImage&) = delete;
+
+    /// @brief Open an image file for tiled decoding
+    /// @param path Path to image file (any format WIC decodes)
+    /// @param config Tile size and cache budget
+    /// @return Tiled image or error; no pixels are decoded yet
+    [[nodiscard]] static std::expected<std::unique_ptr<TiledImage>, DecodeError>
+    open(const std::filesystem::path& path, const TiledImageConfig& config = {});
+
+    /// @brief Full-size width in pixels
+    [[nodiscard]] uint32_t width() const noexcept;
+
+    /// @brief Full-size height in pixels
+    [[nodiscard]] uint32_t height() const noexcept;
+
+    [[nodiscard]] uint32_t tileSize() const noexcept;
+
+    /// @brief Number of pyramid levels (at least 1)
+    [[nodiscard]] uint32_t levelCount() const noexcept;
+
+    [[nodiscard]] uint32_t levelWidth(uint32_t level) const noexcept;
+    [[nodiscard]] uint32_t levelHeight(uint32_t level) const noexcept;
+
+    /// @brief Number of tile columns at a level
+    [[nodiscard]] uint32_t columns(uint32_t level) const noexcept;
+
+    /// @brief Number of tile rows at a level
+    [[nodiscard]] uint32_t rows(uint32_t level) const noexcept;
+
+    /// @brief Get the smallest level still at least as detailed as a display scale
+    /// @param scale Displayed size divided by full size
+    [[nodiscard]] uint32_t levelForScale(float scale) const noexcept;
+
+    /// @brief Get a tile, decoding it if it is not cached
+    /// @param key Tile position (must be within columns() x rows() of its level)
+    /// @return BGRA32 tile, smaller than tileSize() at the right and bottom edges
+    [[nodiscard]] std::expected<std::shared_ptr<const DecodedImage>, DecodeError>
+    tile(const TileKey& key);
+
+    /// @brief Get a tile only if it is already cached
+    [[nodiscard]] std::shared_ptr<const DecodedImage> cachedTile(const TileKey& key);
+
+    /// @brief Bytes held by cached tiles
+    [[nodiscard]] size_t cachedBytes() const noexcept;
+
+private:
+    class Impl;
+    explicit TiledImage(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::image
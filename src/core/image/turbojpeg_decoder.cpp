@@ -0,0 +1,282 @@
+/// @file turbojpeg_decoder.cpp
+/// @brief libjpeg-turbo JPEG decoder implementation
+
+#include "turbojpeg_decoder.hpp"
+
+#include <turbojpeg.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "jpeg_orientation.hpp"
+
+namespace nive::image {
+
+namespace {
+
+constexpr std::array<std::string_view, 4> SUPPORTED_EXTENSIONS = {"jpg", "jpeg", "jpe", "jfif"};
+
+constexpr uint8_t JPEG_MAGIC[] = {0xFF, 0xD8, 0xFF};
+
+constexpr uint16_t kExifOrientationTag = 0x0112;
+
+/// @brief Per-thread TurboJPEG decompressor
+///
+/// tj3Init allocates the whole libjpeg state; reusing one per thread keeps
+/// that out of every thumbnail decode.
+struct TurboHandle {
+    tjhandle handle = tj3Init(TJINIT_DECOMPRESS);
+
+    TurboHandle() = default;
+    TurboHandle(const TurboHandle&) = delete;
+    TurboHandle& operator=(const TurboHandle&) = delete;
+
+    ~TurboHandle() {
+        if (handle) {
+            tj3Destroy(handle);
+        }
+    }
+};
+
+[[nodiscard]] tjhandle thread_handle() {
+    thread_local TurboHandle decompressor;
+    return decompressor.handle;
+}
+
+/// @brief Full-size header fields of a JPEG
+struct JpegHeader {
+    int width = 0;
+    int height = 0;
+    int colorspace = TJCS_YCbCr;
+};
+
+/// @brief Parse the header into the handle, rejecting what cannot be decoded to BGRA
+[[nodiscard]] std::expected<JpegHeader, DecodeError> read_header(tjhandle handle,
+                                                                 std::span<const uint8_t> data) {
+    if (!handle) {
+        return std::unexpected(DecodeError::DecoderNotAvailable);
+    }
+    if (tj3DecompressHeader(handle, data.data(), data.size()) != 0) {
+        return std::unexpected(DecodeError::CorruptedData);
+    }
+    JpegHeader header{tj3Get(handle, TJPARAM_JPEGWIDTH), tj3Get(handle, TJPARAM_JPEGHEIGHT),
+                      tj3Get(handle, TJPARAM_COLORSPACE)};
+    if (header.width <= 0 || header.height <= 0) {
+        return std::unexpected(DecodeError::CorruptedData);
+    }
+    // TurboJPEG only converts CMYK to CMYK; WIC handles those
+    if (header.colorspace == TJCS_CMYK || header.colorspace == TJCS_YCCK) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    return header;
+}
+
+/// @brief Get the smallest scaling factor (at most 1/1) keeping the longer side >= min_size
+[[nodiscard]] tjscalingfactor pick_scaling(const JpegHeader& header, uint32_t min_size) noexcept {
+    int count = 0;
+    const tjscalingfactor* factors = tj3GetScalingFactors(&count);
+    int longer = std::max(header.width, header.height);
+
+    tjscalingfactor best{1, 1};
+    for (int i = 0; factors && i < count; ++i) {
+        tjscalingfactor factor = factors[i];
+        if (factor.num > factor.denom ||
+            TJSCALED(longer, factor) < static_cast<int>(std::min<uint32_t>(min_size, longer))) {
+            continue;
+        }
+        if (factor.num * best.denom < best.num * factor.denom) {
+            best = factor;
+        }
+    }
+    return best;
+}
+
+/// @brief Decompress the parsed image at a scaling factor into BGRA32
+[[nodiscard]] std::expected<DecodedImage, DecodeError>
+decompress(tjhandle handle, std::span<const uint8_t> data, const JpegHeader& header,
+           tjscalingfactor factor) {
+    // Lossless JPEG only decodes at 1/1
+    if (tj3SetScalingFactor(handle, factor) != 0) {
+        factor = {1, 1};
+        if (tj3SetScalingFactor(handle, factor) != 0) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+    }
+
+    DecodedImage image(static_cast<uint32_t>(TJSCALED(header.width, factor)),
+                       static_cast<uint32_t>(TJSCALED(header.height, factor)),
+                       PixelFormat::BGRA32);
+    // Alpha is filled with 0xFF
+    if (tj3Decompress8(handle, data.data(), data.size(), image.data(),
+                       static_cast<int>(image.stride()), TJPF_BGRA) != 0 &&
+        tj3GetErrorCode(handle) == TJERR_FATAL) {
+        return std::unexpected(DecodeError::CorruptedData);
+    }
+    // Warnings (a truncated file, say) leave the undecoded rows grey, as WIC does
+    return image;
+}
+
+/// @brief Read a 16- or 32-bit TIFF field
+[[nodiscard]] uint32_t read_tiff_uint(std::span<const uint8_t> tiff, size_t offset, size_t size,
+                                      bool big_endian) noexcept {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        size_t byte = big_endian ? i : size - 1 - i;
+        value = (value << 8) | tiff[offset + byte];
+    }
+    return value;
+}
+
+/// @brief Find the orientation tag in IFD0 of an EXIF TIFF block
+[[nodiscard]] uint16_t read_tiff_orientation(std::span<const uint8_t> tiff) noexcept {
+    if (tiff.size() < 8) {
+        return 1;
+    }
+    bool big_endian = tiff[0] == 'M' && tiff[1] == 'M';
+    if (!big_endian && !(tiff[0] == 'I' && tiff[1] == 'I')) {
+        return 1;
+    }
+    if (read_tiff_uint(tiff, 2, 2, big_endian) != 42) {
+        return 1;
+    }
+
+    size_t ifd = read_tiff_uint(tiff, 4, 4, big_endian);
+    if (ifd > tiff.size() - 2) {
+        return 1;
+    }
+    size_t entries = read_tiff_uint(tiff, ifd, 2, big_endian);
+    for (size_t i = 0; i < entries; ++i) {
+        size_t entry = ifd + 2 + i * 12;
+        if (entry + 12 > tiff.size()) {
+            break;
+        }
+        if (read_tiff_uint(tiff, entry, 2, big_endian) != kExifOrientationTag) {
+            continue;
+        }
+        // SHORT, stored left-justified in the value field
+        if (read_tiff_uint(tiff, entry + 2, 2, big_endian) != 3) {
+            return 1;
+        }
+        auto orientation = static_cast<uint16_t>(read_tiff_uint(tiff, entry + 8, 2, big_endian));
+        return orientation >= 1 && orientation <= 8 ? orientation : 1;
+    }
+    return 1;
+}
+
+/// @brief Read the EXIF orientation (1-8, 1 if absent) from the APP1 segment
+[[nodiscard]] uint16_t read_exif_orientation(std::span<const uint8_t> data) noexcept {
+    static constexpr uint8_t kExifHeader[] = {'E', 'x', 'i', 'f', 0, 0};
+
+    size_t pos = 2;  // After SOI
+    while (pos + 4 <= data.size() && data[pos] == 0xFF) {
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {  // Fill byte
+            ++pos;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) {  // SOS or EOI: no metadata follows
+            break;
+        }
+        size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > data.size()) {
+            break;
+        }
+        auto segment = data.subspan(pos + 4, length - 2);
+        if (marker == 0xE1 && segment.size() > sizeof(kExifHeader) &&
+            std::memcmp(segment.data(), kExifHeader, sizeof(kExifHeader)) == 0) {
+            return read_tiff_orientation(segment.subspan(sizeof(kExifHeader)));
+        }
+        pos += 2 + length;
+    }
+    return 1;
+}
+
+}  // namespace
+
+std::string_view TurboJpegDecoder::name() const noexcept {
+    return "libjpeg-turbo";
+}
+
+std::span<const std::string_view> TurboJpegDecoder::supportedExtensions() const noexcept {
+    return SUPPORTED_EXTENSIONS;
+}
+
+bool TurboJpegDecoder::supportsExtension(std::string_view extension) const noexcept {
+    return std::ranges::find(SUPPORTED_EXTENSIONS, extension) != SUPPORTED_EXTENSIONS.end();
+}
+
+bool TurboJpegDecoder::canDecode(std::span<const uint8_t> data) const noexcept {
+    return data.size() >= sizeof(JPEG_MAGIC) &&
+           std::equal(std::begin(JPEG_MAGIC), std::end(JPEG_MAGIC), data.begin());
+}
+
+std::expected<ImageInfo, DecodeError>
+TurboJpegDecoder::getInfoFromMemory(std::span<const uint8_t> data) const {
+    tjhandle handle = thread_handle();
+    auto header = read_header(handle, data);
+    if (!header) {
+        return std::unexpected(header.error());
+    }
+
+    ImageInfo info;
+    info.width = static_cast<uint32_t>(header->width);
+    info.height = static_cast<uint32_t>(header->height);
+    info.format = header->colorspace == TJCS_GRAY ? PixelFormat::Gray8 : PixelFormat::BGR24;
+    // JFIF density, when given in dots per inch
+    if (tj3Get(handle, TJPARAM_DENSITYUNITS) == 1) {
+        int dpi_x = tj3Get(handle, TJPARAM_XDENSITY);
+        int dpi_y = tj3Get(handle, TJPARAM_YDENSITY);
+        if (dpi_x > 0 && dpi_y > 0) {
+            info.dpi_x = static_cast<uint32_t>(dpi_x);
+            info.dpi_y = static_cast<uint32_t>(dpi_y);
+        }
+    }
+    return info;
+}
+
+std::expected<DecodedImage, DecodeError>
+TurboJpegDecoder::decodeFromMemory(std::span<const uint8_t> data,
+                                   PixelFormat target_format) const {
+    if (target_format != PixelFormat::BGRA32) {
+        return std::unexpected(DecodeError::UnsupportedFormat);
+    }
+    tjhandle handle = thread_handle();
+    auto header = read_header(handle, data);
+    if (!header) {
+        return std::unexpected(header.error());
+    }
+    tj3Set(handle, TJPARAM_FASTDCT, 0);
+    tj3Set(handle, TJPARAM_FASTUPSAMPLE, 0);
+    return decompress(handle, data, *header, {1, 1});
+}
+
+std::expected<PreviewImage, DecodeError>
+TurboJpegDecoder::decodeThumbnailFromMemory(std::span<const uint8_t> data,
+                                            uint32_t min_size) const {
+    tjhandle handle = thread_handle();
+    auto header = read_header(handle, data);
+    if (!header) {
+        return std::unexpected(header.error());
+    }
+    // The result is scaled down to thumbnail size anyway, hiding the
+    // fast DCT's rounding and the blockier chroma upsampling
+    tj3Set(handle, TJPARAM_FASTDCT, 1);
+    tj3Set(handle, TJPARAM_FASTUPSAMPLE, 1);
+    auto image = decompress(handle, data, *header, pick_scaling(*header, min_size));
+    if (!image) {
+        return std::unexpected(image.error());
+    }
+
+    uint16_t orientation = read_exif_orientation(data);
+    bool transposed = orientation >= 5;
+    PreviewImage preview;
+    preview.image = orientImage(std::move(*image), orientation);
+    preview.source_width = static_cast<uint32_t>(transposed ? header->height : header->width);
+    preview.source_height = static_cast<uint32_t>(transposed ? header->width : header->height);
+    return preview;
+}
+
+}  // namespace nive::image
@@ -0,0 +1,39 @@
+/// @file turbojpeg_decoder.hpp
+/// @brief JPEG decoder using libjpeg-turbo's TurboJPEG API
+
+#pragma once
+
+#include "native_decoder.hpp"
+
+namespace nive::image {
+
+/// @brief JPEG decoder using libjpeg-turbo
+///
+/// Thumbnails are decoded at the smallest TurboJPEG scaling factor (down to
+/// 1/8) that still covers the requested size, with fast DCT and upsampling.
+///
+/// Thread-safe: yes (one TurboJPEG handle per thread)
+class TurboJpegDecoder final : public NativeDecoder {
+public:
+    TurboJpegDecoder() = default;
+
+    [[nodiscard]] std::string_view name() const noexcept override;
+
+    [[nodiscard]] std::span<const std::string_view> supportedExtensions() const noexcept override;
+
+    [[nodiscard]] bool supportsExtension(std::string_view extension) const noexcept override;
+
+    [[nodiscard]] bool canDecode(std::span<const uint8_t> data) const noexcept override;
+
+    [[nodiscard]] std::expected<ImageInfo, DecodeError>
+    getInfoFromMemory(std::span<const uint8_t> data) const override;
+
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decodeFromMemory(std::span<const uint8_t> data,
+                     PixelFormat target_format = PixelFormat::BGRA32) const override;
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t min_size) const override;
+};
+
+}  // namespace nive::image
@@ -8,8 +8,12 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
 
 #include "../util/com_ptr.hpp"
+#include "image_scaler.hpp"
+#include "wic_factory.hpp"
 
 #pragma comment(lib, "windowscodecs.lib")
 
@@ -29,6 +33,101 @@ constexpr uint8_t GIF89_MAGIC[] = {0x47, 0x49, 0x46, 0x38, 0x39, 0x61};  // "GIF
 constexpr uint8_t TIFF_LE_MAGIC[] = {0x49, 0x49, 0x2A, 0x00};            // Little-endian
 constexpr uint8_t TIFF_BE_MAGIC[] = {0x4D, 0x4D, 0x00, 0x2A};            // Big-endian
 
+// Pixels are copied in bands of about this size so a cancelled decode stops
+// between bands instead of after the whole frame
+constexpr size_t kCopyBandBytes = 4 * 1024 * 1024;
+
+// Embedded thumbnails smaller than this (or the requested size, if smaller)
+// look worse than a placeholder and are ignored
+constexpr uint32_t kMinEmbeddedPreviewSize = 96;
+
+/// @brief Size fitting inside max_size x max_size with the same aspect, never upscaled
+std::pair<UINT, UINT> fit_within(UINT width, UINT height, uint32_t max_size) {
+    if (width <= max_size && height <= max_size) {
+        return {width, height};
+    }
+    double scale = static_cast<double>(max_size) / static_cast<double>(std::max(width, height));
+    return {std::max<UINT>(static_cast<UINT>(width * scale + 0.5), 1),
+            std::max<UINT>(static_cast<UINT>(height * scale + 0.5), 1)};
+}
+
+/// @brief Smallest size with the same aspect whose longer side is at least min_size
+std::pair<UINT, UINT> cover_size(UINT width, UINT height, uint32_t min_size) {
+    UINT longer = std::max(width, height);
+    if (longer <= min_size) {
+        return {width, height};
+    }
+    auto scale_up = [longer, min_size](UINT side) {
+        UINT scaled = static_cast<UINT>((static_cast<uint64_t>(side) * min_size + longer - 1) /
+                                        longer);
+        return std::max<UINT>(scaled, 1);
+    };
+    return {scale_up(width), scale_up(height)};
+}
+
+/// @brief Check if two sizes have the same aspect ratio within 2%
+///
+/// Some cameras pad the EXIF thumbnail to 4:3 with black bars; such a
+/// thumbnail must not stand in for a 16:9 or 3:2 image.
+bool same_aspect(UINT width_a, UINT height_a, UINT width_b, UINT height_b) {
+    if (height_a == 0 || height_b == 0) {
+        return false;
+    }
+    double a = static_cast<double>(width_a) / height_a;
+    double b = static_cast<double>(width_b) / height_b;
+    return std::abs(a - b) <= 0.02 * std::max(a, b);
+}
+
+/// @brief EXIF orientation of a frame (1-8), or 1 when it has none
+uint16_t read_orientation(IWICBitmapFrameDecode* frame) {
+    ComPtr<IWICMetadataQueryReader> reader;
+    if (FAILED(frame->GetMetadataQueryReader(&reader))) {
+        return 1;
+    }
+
+    // The photo policy name resolves to the EXIF tag (274) in JPEG, TIFF and raw files
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    uint16_t orientation = 1;
+    if (SUCCEEDED(reader->GetMetadataByName(L"System.Photo.Orientation", &value)) &&
+        value.vt == VT_UI2) {
+        orientation = value.uiVal;
+    }
+    PropVariantClear(&value);
+    return orientation >= 1 && orientation <= 8 ? orientation : 1;
+}
+
+/// @brief Check if an EXIF orientation turns the image by 90 degrees
+bool swaps_axes(uint16_t orientation) {
+    return orientation >= 5 && orientation <= 8;
+}
+
+/// @brief Flip and rotation that displays an image with an EXIF orientation upright
+///
+/// WIC rotates clockwise first and flips the rotated result.
+WICBitmapTransformOptions orientation_transform(uint16_t orientation) {
+    switch (orientation) {
+    case 2:
+        return WICBitmapTransformFlipHorizontal;
+    case 3:
+        return WICBitmapTransformRotate180;
+    case 4:
+        return WICBitmapTransformFlipVertical;
+    case 5:
+        return static_cast<WICBitmapTransformOptions>(WICBitmapTransformRotate90 |
+                                                      WICBitmapTransformFlipHorizontal);
+    case 6:
+        return WICBitmapTransformRotate90;
+    case 7:
+        return static_cast<WICBitmapTransformOptions>(WICBitmapTransformRotate270 |
+                                                      WICBitmapTransformFlipHorizontal);
+    case 8:
+        return WICBitmapTransformRotate270;
+    default:
+        return WICBitmapTransformRotate0;
+    }
+}
+
 /// @brief Check if data starts with given signature
 bool matches_signature(std::span<const uint8_t> data, std::span<const uint8_t> signature,
                        size_t offset = 0) {
@@ -58,6 +157,12 @@ PixelFormat wic_format_to_pixel_format(const GUID& wic_format) {
     if (IsEqualGUID(wic_format, GUID_WICPixelFormat16bppGray)) {
         return PixelFormat::Gray16;
     }
+    if (IsEqualGUID(wic_format, GUID_WICPixelFormat64bppRGBA)) {
+        return PixelFormat::RGBA64;
+    }
+    if (IsEqualGUID(wic_format, GUID_WICPixelFormat64bppRGBAHalf)) {
+        return PixelFormat::RGBA16F;
+    }
     return PixelFormat::Unknown;
 }
 
@@ -76,6 +181,10 @@ const GUID& pixel_format_to_wic(PixelFormat format) {
         return GUID_WICPixelFormat8bppGray;
     case PixelFormat::Gray16:
         return GUID_WICPixelFormat16bppGray;
+    case PixelFormat::RGBA64:
+        return GUID_WICPixelFormat64bppRGBA;
+    case PixelFormat::RGBA16F:
+        return GUID_WICPixelFormat64bppRGBAHalf;
     default:
         return GUID_WICPixelFormat32bppBGRA;
     }
@@ -108,11 +217,7 @@ DecodeError hresult_to_decode_error(HRESULT hr) {
 /// @brief WIC decoder implementation
 class WicDecoder::Impl {
 public:
-    Impl() {
-        HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
-                                      IID_PPV_ARGS(&factory_));
-        available_ = SUCCEEDED(hr);
-    }
+    Impl() : factory_(wicFactory()) { available_ = factory_ != nullptr; }
 
     [[nodiscard]] bool isAvailable() const noexcept { return available_; }
 
@@ -153,13 +258,15 @@ public:
         return get_info_from_decoder(decoder.Get());
     }
 
-    [[nodiscard]] std::expected<DecodedImage, DecodeError> decode(const std::filesystem::path& path,
-                                                                  PixelFormat target_format) const {
-        return decode_frame_impl(path, 0, target_format);
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decode(const std::filesystem::path& path, PixelFormat target_format,
+           std::stop_token stop_token) const {
+        return decode_frame_impl(path, 0, target_format, stop_token);
     }
 
     [[nodiscard]] std::expected<DecodedImage, DecodeError>
-    decodeFromMemory(std::span<const uint8_t> data, PixelFormat target_format) const {
+    decodeFromMemory(std::span<const uint8_t> data, PixelFormat target_format,
+                     std::stop_token stop_token) const {
         if (!available_) {
             return std::unexpected(DecodeError::DecoderNotAvailable);
         }
@@ -176,13 +283,135 @@ public:
             return std::unexpected(hresult_to_decode_error(hr));
         }
 
-        return decode_frame_from_decoder(decoder.Get(), 0, target_format);
+        return decode_frame_from_decoder(decoder.Get(), 0, target_format, stop_token);
     }
 
     [[nodiscard]] std::expected<DecodedImage, DecodeError>
     decodeFrame(const std::filesystem::path& path, uint32_t frame_index,
                 PixelFormat target_format) const {
-        return decode_frame_impl(path, frame_index, target_format);
+        return decode_frame_impl(path, frame_index, target_format, {});
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodePreview(const std::filesystem::path& path, uint32_t max_size, PixelFormat target_format,
+                  std::stop_token stop_token) const {
+        if (!available_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = factory_->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                         WICDecodeMetadataCacheOnDemand, &decoder);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        return decode_preview_from_decoder(decoder.Get(), max_size, target_format, stop_token);
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodePreviewFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                            PixelFormat target_format, std::stop_token stop_token) const {
+        if (!available_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+
+        auto stream = create_stream_from_memory(data);
+        if (!stream) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = factory_->CreateDecoderFromStream(stream.Get(), nullptr,
+                                                       WICDecodeMetadataCacheOnDemand, &decoder);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        return decode_preview_from_decoder(decoder.Get(), max_size, target_format, stop_token);
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeFirstPassFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                              PixelFormat target_format, std::stop_token stop_token) const {
+        if (!available_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+
+        auto stream = create_stream_from_memory(data);
+        if (!stream) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = factory_->CreateDecoderFromStream(stream.Get(), nullptr,
+                                                       WICDecodeMetadataCacheOnDemand, &decoder);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+        ComPtr<IWICBitmapFrameDecode> frame;
+        hr = decoder->GetFrame(0, &frame);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        // Progressive JPEG scans and Adam7 passes; baseline images report one level
+        ComPtr<IWICProgressiveLevelControl> levels;
+        UINT level_count = 0;
+        if (FAILED(frame->QueryInterface(IID_PPV_ARGS(&levels))) ||
+            FAILED(levels->GetLevelCount(&level_count)) || level_count < 2 ||
+            FAILED(levels->SetCurrentLevel(0))) {
+            return std::unexpected(DecodeError::UnsupportedFormat);
+        }
+
+        UINT width = 0, height = 0;
+        hr = frame->GetSize(&width, &height);
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+        return finish_preview(frame.Get(), frame.Get(), width, height, max_size, target_format);
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnail(const std::filesystem::path& path, uint32_t max_size,
+                    PixelFormat target_format, std::stop_token stop_token) const {
+        if (!available_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = factory_->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                         WICDecodeMetadataCacheOnDemand, &decoder);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        return decode_thumbnail_from_decoder(decoder.Get(), max_size, target_format, stop_token);
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                              PixelFormat target_format, std::stop_token stop_token) const {
+        if (!available_) {
+            return std::unexpected(DecodeError::DecoderNotAvailable);
+        }
+
+        auto stream = create_stream_from_memory(data);
+        if (!stream) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = factory_->CreateDecoderFromStream(stream.Get(), nullptr,
+                                                       WICDecodeMetadataCacheOnDemand, &decoder);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        return decode_thumbnail_from_decoder(decoder.Get(), max_size, target_format, stop_token);
     }
 
 private:
@@ -212,25 +441,13 @@ private:
         double dpi_x = 96.0, dpi_y = 96.0;
         frame->GetResolution(&dpi_x, &dpi_y);
 
-        // Check for alpha
-        ComPtr<IWICComponentInfo> comp_info;
-        factory_->CreateComponentInfo(pixel_format, &comp_info);
-
-        ComPtr<IWICPixelFormatInfo> format_info;
-        bool has_alpha_channel = false;
-        if (comp_info && SUCCEEDED(comp_info.As(&format_info))) {
-            UINT channel_count = 0;
-            format_info->GetChannelCount(&channel_count);
-            // Most formats with alpha have 4 channels (RGBA/BGRA)
-            has_alpha_channel = (channel_count == 4 || channel_count == 2);
-        }
-
         return ImageInfo{
             .width = width,
             .height = height,
             .format = wic_format_to_pixel_format(pixel_format),
             .frame_count = frame_count > 0 ? frame_count : 1,
-            .has_alpha = has_alpha_channel,
+            .has_alpha = wicFormatHasAlpha(pixel_format),
+            .high_precision = wicFormatIsHighPrecision(pixel_format),
             .dpi_x = static_cast<uint32_t>(dpi_x),
             .dpi_y = static_cast<uint32_t>(dpi_y),
         };
@@ -238,7 +455,7 @@ private:
 
     [[nodiscard]] std::expected<DecodedImage, DecodeError>
     decode_frame_impl(const std::filesystem::path& path, uint32_t frame_index,
-                      PixelFormat target_format) const {
+                      PixelFormat target_format, std::stop_token stop_token) const {
         if (!available_) {
             return std::unexpected(DecodeError::DecoderNotAvailable);
         }
@@ -250,20 +467,32 @@ private:
             return std::unexpected(hresult_to_decode_error(hr));
         }
 
-        return decode_frame_from_decoder(decoder.Get(), frame_index, target_format);
+        return decode_frame_from_decoder(decoder.Get(), frame_index, target_format, stop_token);
     }
 
     [[nodiscard]] std::expected<DecodedImage, DecodeError>
     decode_frame_from_decoder(IWICBitmapDecoder* decoder, uint32_t frame_index,
-                              PixelFormat target_format) const {
+                              PixelFormat target_format, std::stop_token stop_token) const {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+
         ComPtr<IWICBitmapFrameDecode> frame;
         HRESULT hr = decoder->GetFrame(frame_index, &frame);
         if (FAILED(hr)) {
             return std::unexpected(hresult_to_decode_error(hr));
         }
 
+        return copy_source(frame.Get(), target_format, 1, stop_token);
+    }
+
+    /// @brief Convert a bitmap source to the target format and copy it out, upright
+    /// @param orientation EXIF orientation to undo (1 = as stored)
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    copy_source(IWICBitmapSource* source, PixelFormat target_format, uint16_t orientation,
+                std::stop_token stop_token) const {
         UINT width = 0, height = 0;
-        hr = frame->GetSize(&width, &height);
+        HRESULT hr = source->GetSize(&width, &height);
         if (FAILED(hr)) {
             return std::unexpected(DecodeError::InternalError);
         }
@@ -277,7 +506,7 @@ private:
             return std::unexpected(DecodeError::InternalError);
         }
 
-        hr = converter->Initialize(frame.Get(), target_wic_format, WICBitmapDitherTypeNone, nullptr,
+        hr = converter->Initialize(source, target_wic_format, WICBitmapDitherTypeNone, nullptr,
                                    0.0, WICBitmapPaletteTypeCustom);
         if (FAILED(hr)) {
             return std::unexpected(DecodeError::InternalError);
@@ -288,40 +517,356 @@ private:
         uint32_t stride = (width * bpp + 3) & ~3u;
 
         // Allocate pixel buffer
-        std::vector<uint8_t> pixels;
+        PixelBuffer pixels;
         try {
             pixels.resize(static_cast<size_t>(stride) * height);
         } catch (const std::bad_alloc&) {
             return std::unexpected(DecodeError::OutOfMemory);
         }
 
-        // Copy pixels
-        hr = converter->CopyPixels(nullptr,  // Entire bitmap
-                                   stride, static_cast<UINT>(pixels.size()), pixels.data());
+        // Copy pixels in bands, checking for cancellation between them
+        UINT band_rows = static_cast<UINT>(std::max<size_t>(kCopyBandBytes / stride, 1));
+        for (UINT y = 0; y < height; y += band_rows) {
+            if (stop_token.stop_requested()) {
+                return std::unexpected(DecodeError::Cancelled);
+            }
+            UINT rows = std::min(band_rows, height - y);
+            WICRect band{0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(rows)};
+            hr = converter->CopyPixels(&band, stride, stride * rows,
+                                       pixels.data() + static_cast<size_t>(stride) * y);
+            if (FAILED(hr)) {
+                return std::unexpected(DecodeError::InternalError);
+            }
+        }
+
+        if (orientation == 1) {
+            return DecodedImage(width, height, target_format, stride, std::move(pixels));
+        }
+
+        // Rotate the copied pixels rather than the decoder, which would be
+        // asked for the image a column at a time
+        ComPtr<IWICBitmap> bitmap;
+        ComPtr<IWICBitmapFlipRotator> rotator;
+        hr = factory_->CreateBitmapFromMemory(width, height, target_wic_format, stride,
+                                              static_cast<UINT>(pixels.size()), pixels.data(),
+                                              &bitmap);
+        if (SUCCEEDED(hr)) {
+            hr = factory_->CreateBitmapFlipRotator(&rotator);
+        }
+        if (SUCCEEDED(hr)) {
+            hr = rotator->Initialize(bitmap.Get(), orientation_transform(orientation));
+        }
         if (FAILED(hr)) {
             return std::unexpected(DecodeError::InternalError);
         }
+        pixels = {};
 
-        return DecodedImage(width, height, target_format, stride, std::move(pixels));
+        UINT upright_width = 0, upright_height = 0;
+        rotator->GetSize(&upright_width, &upright_height);
+        uint32_t upright_stride = (upright_width * bpp + 3) & ~3u;
+        PixelBuffer upright;
+        try {
+            upright.resize(static_cast<size_t>(upright_stride) * upright_height);
+        } catch (const std::bad_alloc&) {
+            return std::unexpected(DecodeError::OutOfMemory);
+        }
+        hr = rotator->CopyPixels(nullptr, upright_stride, static_cast<UINT>(upright.size()),
+                                 upright.data());
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        return DecodedImage(upright_width, upright_height, target_format, upright_stride,
+                            std::move(upright));
     }
 
-    [[nodiscard]] ComPtr<IStream> create_stream_from_memory(std::span<const uint8_t> data) const {
-        ComPtr<IStream> stream;
-        HRESULT hr = CreateStreamOnHGlobal(nullptr, TRUE, &stream);
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decode_thumbnail_from_decoder(IWICBitmapDecoder* decoder, uint32_t max_size,
+                                  PixelFormat target_format, std::stop_token stop_token) const {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+
+        ComPtr<IWICBitmapFrameDecode> frame;
+        HRESULT hr = decoder->GetFrame(0, &frame);
         if (FAILED(hr)) {
-            return nullptr;
+            return std::unexpected(hresult_to_decode_error(hr));
         }
 
-        ULONG written = 0;
-        hr = stream->Write(data.data(), static_cast<ULONG>(data.size()), &written);
-        if (FAILED(hr) || written != data.size()) {
-            return nullptr;
+        UINT width = 0, height = 0;
+        hr = frame->GetSize(&width, &height);
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+        uint16_t orientation = read_orientation(frame.Get());
+
+        // An embedded thumbnail will do if the thumbnail is not upscaled from it
+        ComPtr<IWICBitmapSource> source;
+        ComPtr<IWICBitmapSource> embedded;
+        UINT needed = std::min<UINT>(max_size, std::max(width, height));
+        if (SUCCEEDED(frame->GetThumbnail(&embedded))) {
+            UINT embedded_width = 0, embedded_height = 0;
+            embedded->GetSize(&embedded_width, &embedded_height);
+            if (std::max(embedded_width, embedded_height) >= needed &&
+                same_aspect(embedded_width, embedded_height, width, height)) {
+                source = embedded;
+            }
+        }
+
+        // Else the smallest reduced-resolution decode that still covers the size
+        if (!source) {
+            auto [cover_width, cover_height] = cover_size(width, height, max_size);
+            auto reduced = reduced_source(frame.Get(), width, cover_width, cover_height,
+                                          target_format);
+            if (!reduced) {
+                return std::unexpected(reduced.error());
+            }
+            if (*reduced) {
+                UINT reduced_width = 0, reduced_height = 0;
+                (*reduced)->GetSize(&reduced_width, &reduced_height);
+                if (std::max(reduced_width, reduced_height) >= needed) {
+                    source = *reduced;
+                }
+            }
+        }
+
+        // Else the full frame, scaled as it streams out of the codec
+        if (!source) {
+            source = frame;
+        }
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+
+        // Scale ahead of the format converter, so only thumbnail-sized
+        // buffers are allocated whatever the source size
+        UINT source_width = 0, source_height = 0;
+        source->GetSize(&source_width, &source_height);
+        if (std::max(source_width, source_height) > max_size) {
+            auto [thumb_width, thumb_height] = calculateScaledDimensions(
+                source_width, source_height, max_size, max_size, FitMode::Contain);
+            // Fant averages every source pixel; cubic is sharper for mild reductions
+            auto mode = std::max(source_width, source_height) > max_size * 2
+                            ? WICBitmapInterpolationModeFant
+                            : WICBitmapInterpolationModeCubic;
+            ComPtr<IWICBitmapScaler> scaler;
+            hr = factory_->CreateBitmapScaler(&scaler);
+            if (SUCCEEDED(hr)) {
+                hr = scaler->Initialize(source.Get(), thumb_width, thumb_height, mode);
+            }
+            if (FAILED(hr)) {
+                return std::unexpected(DecodeError::InternalError);
+            }
+            source = scaler;
+        }
+
+        auto image = copy_source(source.Get(), target_format, orientation, stop_token);
+        if (!image) {
+            return std::unexpected(image.error());
+        }
+        if (swaps_axes(orientation)) {
+            std::swap(width, height);
+        }
+        return PreviewImage{
+            .image = std::move(*image),
+            .source_width = width,
+            .source_height = height,
+        };
+    }
+
+    /// @brief Let the codec decode at the supported size closest to the one given
+    /// @return Reduced bitmap, or null when the codec only decodes at full size
+    [[nodiscard]] std::expected<ComPtr<IWICBitmapSource>, DecodeError>
+    reduced_source(IWICBitmapFrameDecode* frame, UINT width, UINT reduced_width,
+                   UINT reduced_height, PixelFormat target_format) const {
+        ComPtr<IWICBitmapSourceTransform> transform;
+        if (FAILED(frame->QueryInterface(IID_PPV_ARGS(&transform)))) {
+            return ComPtr<IWICBitmapSource>();
         }
 
-        // Seek back to beginning
-        LARGE_INTEGER zero = {};
-        stream->Seek(zero, STREAM_SEEK_SET, nullptr);
+        // JPEG decodes directly at 1/2, 1/4 and 1/8 scale
+        HRESULT hr = transform->GetClosestSize(&reduced_width, &reduced_height);
+        if (FAILED(hr) || reduced_width >= width) {
+            return ComPtr<IWICBitmapSource>();
+        }
+
+        WICPixelFormatGUID format = pixel_format_to_wic(target_format);
+        transform->GetClosestPixelFormat(&format);
 
+        // Decode straight into the bitmap's own buffer
+        ComPtr<IWICBitmap> bitmap;
+        hr = factory_->CreateBitmap(reduced_width, reduced_height, format, WICBitmapCacheOnLoad,
+                                    &bitmap);
+        if (hr == E_OUTOFMEMORY) {
+            return std::unexpected(DecodeError::OutOfMemory);
+        }
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+        {
+            ComPtr<IWICBitmapLock> lock;
+            WICRect rect{0, 0, static_cast<INT>(reduced_width), static_cast<INT>(reduced_height)};
+            UINT stride = 0, size = 0;
+            BYTE* data = nullptr;
+            hr = bitmap->Lock(&rect, WICBitmapLockWrite, &lock);
+            if (SUCCEEDED(hr)) {
+                hr = lock->GetStride(&stride);
+            }
+            if (SUCCEEDED(hr)) {
+                hr = lock->GetDataPointer(&size, &data);
+            }
+            if (SUCCEEDED(hr)) {
+                hr = transform->CopyPixels(nullptr, reduced_width, reduced_height, &format,
+                                           WICBitmapTransformRotate0, stride, size, data);
+            }
+        }  // Unlocked here, before the bitmap is read
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+        return ComPtr<IWICBitmapSource>(bitmap);
+    }
+
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decode_preview_from_decoder(IWICBitmapDecoder* decoder, uint32_t max_size,
+                                PixelFormat target_format, std::stop_token stop_token) const {
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+
+        ComPtr<IWICBitmapFrameDecode> frame;
+        HRESULT hr = decoder->GetFrame(0, &frame);
+        if (FAILED(hr)) {
+            return std::unexpected(hresult_to_decode_error(hr));
+        }
+
+        UINT width = 0, height = 0;
+        hr = frame->GetSize(&width, &height);
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        // Fastest first: a thumbnail stored in the file needs no decode of the image
+        ComPtr<IWICBitmapSource> source;
+        ComPtr<IWICBitmapSource> embedded;
+        if (SUCCEEDED(frame->GetThumbnail(&embedded))) {
+            UINT embedded_width = 0, embedded_height = 0;
+            embedded->GetSize(&embedded_width, &embedded_height);
+            if (std::max(embedded_width, embedded_height) >=
+                std::min(max_size, kMinEmbeddedPreviewSize)) {
+                source = embedded;
+            }
+        }
+
+        // Otherwise let the codec decode at reduced resolution
+        if (!source) {
+            auto [reduced_width, reduced_height] = fit_within(width, height, max_size);
+            auto reduced = reduced_source(frame.Get(), width, reduced_width, reduced_height,
+                                          target_format);
+            if (!reduced) {
+                return std::unexpected(reduced.error());
+            }
+            source = std::move(*reduced);
+        }
+
+        if (!source) {
+            return std::unexpected(DecodeError::UnsupportedFormat);
+        }
+        if (stop_token.stop_requested()) {
+            return std::unexpected(DecodeError::Cancelled);
+        }
+        return finish_preview(frame.Get(), source.Get(), width, height, max_size, target_format);
+    }
+
+    /// @brief Convert a preview source, scale it to max_size and turn it upright
+    /// @param frame Frame the source stands for (for its EXIF orientation)
+    /// @param width Stored width of the frame
+    /// @param height Stored height of the frame
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    finish_preview(IWICBitmapFrameDecode* frame, IWICBitmapSource* source, UINT width,
+                   UINT height, uint32_t max_size, PixelFormat target_format) const {
+        // Convert, then scale to the preview size with nearest neighbour
+        ComPtr<IWICFormatConverter> converter;
+        HRESULT hr = factory_->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr)) {
+            hr = converter->Initialize(source, pixel_format_to_wic(target_format),
+                                       WICBitmapDitherTypeNone, nullptr, 0.0,
+                                       WICBitmapPaletteTypeCustom);
+        }
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        UINT source_width = 0, source_height = 0;
+        source->GetSize(&source_width, &source_height);
+        auto [preview_width, preview_height] = fit_within(source_width, source_height, max_size);
+
+        ComPtr<IWICBitmapSource> output = converter;
+        if (preview_width != source_width || preview_height != source_height) {
+            ComPtr<IWICBitmapScaler> scaler;
+            hr = factory_->CreateBitmapScaler(&scaler);
+            if (SUCCEEDED(hr)) {
+                hr = scaler->Initialize(converter.Get(), preview_width, preview_height,
+                                        WICBitmapInterpolationModeNearestNeighbor);
+            }
+            if (FAILED(hr)) {
+                return std::unexpected(DecodeError::InternalError);
+            }
+            output = scaler;
+        }
+
+        // The preview is small, so it is turned upright straight from the scaler
+        uint16_t orientation = read_orientation(frame);
+        if (orientation != 1) {
+            ComPtr<IWICBitmapFlipRotator> rotator;
+            hr = factory_->CreateBitmapFlipRotator(&rotator);
+            if (SUCCEEDED(hr)) {
+                hr = rotator->Initialize(output.Get(), orientation_transform(orientation));
+            }
+            if (FAILED(hr)) {
+                return std::unexpected(DecodeError::InternalError);
+            }
+            output = rotator;
+            if (swaps_axes(orientation)) {
+                std::swap(preview_width, preview_height);
+                std::swap(width, height);
+            }
+        }
+
+        uint32_t stride = (preview_width * bytesPerPixel(target_format) + 3) & ~3u;
+        PixelBuffer pixels(static_cast<size_t>(stride) * preview_height);
+        hr = output->CopyPixels(nullptr, stride, static_cast<UINT>(pixels.size()), pixels.data());
+        if (FAILED(hr)) {
+            return std::unexpected(DecodeError::InternalError);
+        }
+
+        return PreviewImage{
+            .image = DecodedImage(preview_width, preview_height, target_format, stride,
+                                  std::move(pixels)),
+            .source_width = width,
+            .source_height = height,
+        };
+    }
+
+    /// @brief Wrap caller memory in a read-only stream, without copying it
+    ///
+    /// The stream reads the span in place, so the data must outlive every
+    /// decoder created from it (all callers decode within the same call).
+    [[nodiscard]] ComPtr<IWICStream>
+    create_stream_from_memory(std::span<const uint8_t> data) const {
+        if (data.size() > std::numeric_limits<DWORD>::max()) {
+            return nullptr;
+        }
+
+        ComPtr<IWICStream> stream;
+        HRESULT hr = factory_->CreateStream(&stream);
+        if (SUCCEEDED(hr)) {
+            // WIC takes a non-const pointer but only reads through it
+            hr = stream->InitializeFromMemory(const_cast<BYTE*>(data.data()),
+                                              static_cast<DWORD>(data.size()));
+        }
+        if (FAILED(hr)) {
+            return nullptr;
+        }
         return stream;
     }
 
@@ -388,12 +933,24 @@ WicDecoder::getInfoFromMemory(std::span<const uint8_t> data) const {
 
 std::expected<DecodedImage, DecodeError> WicDecoder::decode(const std::filesystem::path& path,
                                                             PixelFormat target_format) const {
-    return impl_->decode(path, target_format);
+    return impl_->decode(path, target_format, {});
 }
 
 std::expected<DecodedImage, DecodeError>
 WicDecoder::decodeFromMemory(std::span<const uint8_t> data, PixelFormat target_format) const {
-    return impl_->decodeFromMemory(data, target_format);
+    return impl_->decodeFromMemory(data, target_format, {});
+}
+
+std::expected<DecodedImage, DecodeError> WicDecoder::decode(const std::filesystem::path& path,
+                                                            std::stop_token stop_token,
+                                                            PixelFormat target_format) const {
+    return impl_->decode(path, target_format, stop_token);
+}
+
+std::expected<DecodedImage, DecodeError>
+WicDecoder::decodeFromMemory(std::span<const uint8_t> data, std::stop_token stop_token,
+                             PixelFormat target_format) const {
+    return impl_->decodeFromMemory(data, target_format, stop_token);
 }
 
 std::expected<DecodedImage, DecodeError> WicDecoder::decodeFrame(const std::filesystem::path& path,
@@ -402,6 +959,38 @@ std::expected<DecodedImage, DecodeError> WicDecoder::decodeFrame(const std::file
     return impl_->decodeFrame(path, frame_index, target_format);
 }
 
+std::expected<PreviewImage, DecodeError>
+WicDecoder::decodePreview(const std::filesystem::path& path, uint32_t max_size,
+                          std::stop_token stop_token, PixelFormat target_format) const {
+    return impl_->decodePreview(path, max_size, target_format, stop_token);
+}
+
+std::expected<PreviewImage, DecodeError>
+WicDecoder::decodePreviewFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                                    std::stop_token stop_token, PixelFormat target_format) const {
+    return impl_->decodePreviewFromMemory(data, max_size, target_format, stop_token);
+}
+
+std::expected<PreviewImage, DecodeError>
+WicDecoder::decodeFirstPassFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                                      std::stop_token stop_token,
+                                      PixelFormat target_format) const {
+    return impl_->decodeFirstPassFromMemory(data, max_size, target_format, stop_token);
+}
+
+std::expected<PreviewImage, DecodeError>
+WicDecoder::decodeThumbnail(const std::filesystem::path& path, uint32_t max_size,
+                            std::stop_token stop_token, PixelFormat target_format) const {
+    return impl_->decodeThumbnail(path, max_size, target_format, stop_token);
+}
+
+std::expected<PreviewImage, DecodeError>
+WicDecoder::decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                                      std::stop_token stop_token,
+                                      PixelFormat target_format) const {
+    return impl_->decodeThumbnailFromMemory(data, max_size, target_format, stop_token);
+}
+
 bool WicDecoder::isAvailable() const noexcept {
     return impl_->isAvailable();
 }
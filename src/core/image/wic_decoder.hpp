@@ -5,10 +5,19 @@
 
 #pragma once
 
+#include <stop_token>
+
 #include "image_decoder.hpp"
 
 namespace nive::image {
 
+/// @brief Reduced image from WicDecoder::decodePreview or WicDecoder::decodeThumbnail
+struct PreviewImage {
+    DecodedImage image;
+    uint32_t source_width = 0;  // Full size of the image it stands for, after orientation
+    uint32_t source_height = 0;
+};
+
 /// @brief WIC-based image decoder
 ///
 /// Supports all formats that WIC supports natively:
@@ -53,6 +62,86 @@ public:
     decodeFrame(const std::filesystem::path& path, uint32_t frame_index,
                 PixelFormat target_format = PixelFormat::BGRA32) const override;
 
+    /// @brief Decode image from file, stopping early when requested
+    /// @param path Path to image file
+    /// @param stop_token Checked between frame operations and pixel bands
+    /// @param target_format Preferred output format
+    /// @return Decoded image, or DecodeError::Cancelled once stop is requested
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decode(const std::filesystem::path& path, std::stop_token stop_token,
+           PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode image from memory, stopping early when requested
+    /// @param data Image data in memory
+    /// @param stop_token Checked between frame operations and pixel bands
+    /// @param target_format Preferred output format
+    /// @return Decoded image, or DecodeError::Cancelled once stop is requested
+    [[nodiscard]] std::expected<DecodedImage, DecodeError>
+    decodeFromMemory(std::span<const uint8_t> data, std::stop_token stop_token,
+                     PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode a quick, low-quality preview of an image file
+    /// @param path Path to image file
+    /// @param max_size Maximum preview dimension (never upscaled)
+    /// @param stop_token Checked before decoding
+    /// @param target_format Preferred output format
+    /// @return Preview, or DecodeError::UnsupportedFormat when the image has no fast route
+    ///
+    /// Uses the embedded thumbnail (EXIF in JPEG, TIFF and raw files) when there
+    /// is one, else a reduced-resolution decode (JPEG DCT scaling through
+    /// IWICBitmapSourceTransform), finished with a nearest-neighbour scale and
+    /// EXIF orientation. Formats that can only be decoded at full size fail,
+    /// so the caller pays for a full decode once rather than twice.
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodePreview(const std::filesystem::path& path, uint32_t max_size,
+                  std::stop_token stop_token = {},
+                  PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode a quick, low-quality preview from memory (see decodePreview)
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodePreviewFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                            std::stop_token stop_token = {},
+                            PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode the coarsest pass of a progressive JPEG or interlaced PNG from memory
+    /// @param data Image data in memory
+    /// @param max_size Maximum preview dimension (never upscaled)
+    /// @param stop_token Checked before decoding
+    /// @param target_format Preferred output format
+    /// @return Preview, or DecodeError::UnsupportedFormat when the image has no passes
+    ///
+    /// The first pass sits at the start of the file, so over a slow link (a
+    /// mapping of a network file) it is ready long before the whole image
+    /// has been read. Scaled and turned upright like decodePreview.
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeFirstPassFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                              std::stop_token stop_token = {},
+                              PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode an image straight to thumbnail size
+    /// @param path Path to image file
+    /// @param max_size Thumbnail size (max dimension, never upscaled)
+    /// @param stop_token Checked between frame operations and pixel bands
+    /// @param target_format Preferred output format
+    /// @return Upright thumbnail fitting within max_size x max_size
+    ///
+    /// Reads the least that covers max_size: the embedded thumbnail (EXIF in
+    /// JPEG, TIFF and raw files) when it is large enough, else a
+    /// reduced-resolution decode (JPEG DCT scaling to 1/2, 1/4 or 1/8), else
+    /// the full frame. A scaler sits in front of the format converter, so no
+    /// full-resolution buffer is allocated on any route. EXIF orientation is
+    /// applied.
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnail(const std::filesystem::path& path, uint32_t max_size,
+                    std::stop_token stop_token = {},
+                    PixelFormat target_format = PixelFormat::BGRA32) const;
+
+    /// @brief Decode an image from memory straight to thumbnail size (see decodeThumbnail)
+    [[nodiscard]] std::expected<PreviewImage, DecodeError>
+    decodeThumbnailFromMemory(std::span<const uint8_t> data, uint32_t max_size,
+                              std::stop_token stop_token = {},
+                              PixelFormat target_format = PixelFormat::BGRA32) const;
+
     /// @brief Check if WIC is available on this system
     [[nodiscard]] bool isAvailable() const noexcept;
 
@@ -0,0 +1,94 @@
+/// @file wic_factory.cpp
+/// @brief Shared WIC factory implementation
+
+#include "wic_factory.hpp"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../util/com_ptr.hpp"
+
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace nive::image {
+
+namespace {
+
+std::mutex g_factory_mutex;
+ComPtr<IWICImagingFactory> g_factory;
+
+/// @brief What callers ask about a pixel format
+struct FormatTraits {
+    bool has_alpha = false;
+    bool high_precision = false;
+};
+
+// Formats already asked about; images use a handful, so a list beats a map
+std::mutex g_format_mutex;
+std::vector<std::pair<WICPixelFormatGUID, FormatTraits>> g_format_traits;
+
+/// @brief Look up a format in the WIC component registry, once per format
+FormatTraits format_traits(const WICPixelFormatGUID& format) {
+    {
+        std::lock_guard lock(g_format_mutex);
+        for (const auto& [known, traits] : g_format_traits) {
+            if (IsEqualGUID(known, format)) {
+                return traits;
+            }
+        }
+    }
+
+    auto* factory = wicFactory();
+    if (!factory) {
+        return {};
+    }
+    ComPtr<IWICComponentInfo> comp_info;
+    ComPtr<IWICPixelFormatInfo> format_info;
+    FormatTraits traits;
+    if (SUCCEEDED(factory->CreateComponentInfo(format, &comp_info)) &&
+        SUCCEEDED(comp_info.As(&format_info))) {
+        UINT channel_count = 0;
+        UINT bits_per_pixel = 0;
+        format_info->GetChannelCount(&channel_count);
+        format_info->GetBitsPerPixel(&bits_per_pixel);
+        // Most formats with alpha have 4 channels (RGBA/BGRA), or 2 (gray + alpha)
+        traits.has_alpha = (channel_count == 4 || channel_count == 2);
+
+        WICPixelFormatNumericRepresentation numeric = WICPixelFormatNumericRepresentationUnsigned;
+        ComPtr<IWICPixelFormatInfo2> format_info2;
+        if (SUCCEEDED(format_info.As(&format_info2))) {
+            format_info2->GetNumericRepresentation(&numeric);
+        }
+        bool is_float = numeric == WICPixelFormatNumericRepresentationFloat ||
+                        numeric == WICPixelFormatNumericRepresentationFixed;
+        bool deep = channel_count > 0 && bits_per_pixel / channel_count > 8;
+        traits.high_precision = is_float || deep;
+    }
+
+    std::lock_guard lock(g_format_mutex);
+    g_format_traits.emplace_back(format, traits);
+    return traits;
+}
+
+}  // namespace
+
+IWICImagingFactory* wicFactory() {
+    std::lock_guard lock(g_factory_mutex);
+    if (!g_factory) {
+        // Fails on a thread without COM initialised; a later caller may succeed
+        CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                         IID_PPV_ARGS(&g_factory));
+    }
+    return g_factory.Get();
+}
+
+bool wicFormatHasAlpha(const WICPixelFormatGUID& format) {
+    return format_traits(format).has_alpha;
+}
+
+bool wicFormatIsHighPrecision(const WICPixelFormatGUID& format) {
+    return format_traits(format).high_precision;
+}
+
+}  // namespace nive::image
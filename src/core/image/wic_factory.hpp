@@ -0,0 +1,26 @@
+/// @file wic_factory.hpp
+/// @brief Process-wide WIC imaging factory and pixel format lookups
+
+#pragma once
+
+#include <Windows.h>
+
+#include <wincodec.h>
+
+namespace nive::image {
+
+/// @brief Get the shared WIC imaging factory
+/// @return Factory, or nullptr if it could not be created (retried on the next call)
+///
+/// The factory is free-threaded, so one instance serves every thread that
+/// has initialised COM. It lives until process exit.
+[[nodiscard]] IWICImagingFactory* wicFactory();
+
+/// @brief Check if a WIC pixel format carries alpha (looked up once per format)
+[[nodiscard]] bool wicFormatHasAlpha(const WICPixelFormatGUID& format);
+
+/// @brief Check if a WIC pixel format has more than 8 bits per channel or is
+/// floating point (looked up once per format)
+[[nodiscard]] bool wicFormatIsHighPrecision(const WICPixelFormatGUID& format);
+
+}  // namespace nive::image
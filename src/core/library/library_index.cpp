@@ -0,0 +1,790 @@
+/// @file library_index.cpp
+/// @brief Library index implementation
+
+#include "library_index.hpp"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <sqlite3.h>
+
+#include "../fs/directory_reader.hpp"
+#include "../fs/directory_watcher.hpp"
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+
+namespace nive::library {
+
+namespace {
+
+// Schema version; a database written by another version is rebuilt
+// v1: files table with an FTS5 trigram index on name
+constexpr int kSchemaVersion = 1;
+
+// Rows written per crawl transaction. Searches see each batch once committed.
+constexpr size_t kCrawlBatchSize = 1000;
+
+// Trigram tokens are three characters; shorter terms are matched with LIKE
+constexpr size_t kMinTrigramTerm = 3;
+
+// Roots watched at once (the watcher clamps this to its wait limit)
+constexpr size_t kMaxWatchedRoots = 63;
+
+constexpr const char* kCreateSchemaSql = R"sql(
+    CREATE TABLE IF NOT EXISTS files (
+        id INTEGER PRIMARY KEY,
+        path TEXT NOT NULL UNIQUE COLLATE NOCASE,
+        name TEXT NOT NULL,
+        size INTEGER NOT NULL,
+        mtime INTEGER NOT NULL,
+        attributes INTEGER NOT NULL,
+        seen INTEGER NOT NULL
+    );
+    CREATE VIRTUAL TABLE IF NOT EXISTS files_fts USING fts5(
+        name, content='files', content_rowid='id', tokenize='trigram'
+    );
+    CREATE TRIGGER IF NOT EXISTS files_ai AFTER INSERT ON files BEGIN
+        INSERT INTO files_fts(rowid, name) VALUES (new.id, new.name);
+    END;
+    CREATE TRIGGER IF NOT EXISTS files_ad AFTER DELETE ON files BEGIN
+        INSERT INTO files_fts(files_fts, rowid, name) VALUES ('delete', old.id, old.name);
+    END;
+    CREATE TRIGGER IF NOT EXISTS files_au AFTER UPDATE OF name ON files
+    WHEN old.name IS NOT new.name BEGIN
+        INSERT INTO files_fts(files_fts, rowid, name) VALUES ('delete', old.id, old.name);
+        INSERT INTO files_fts(rowid, name) VALUES (new.id, new.name);
+    END;
+)sql";
+
+constexpr const char* kDropSchemaSql = R"sql(
+    DROP TRIGGER IF EXISTS files_ai;
+    DROP TRIGGER IF EXISTS files_ad;
+    DROP TRIGGER IF EXISTS files_au;
+    DROP TABLE IF EXISTS files_fts;
+    DROP TABLE IF EXISTS files;
+)sql";
+
+// RAII wrapper for sqlite3_stmt
+class SqliteStatement {
+public:
+    SqliteStatement() = default;
+    ~SqliteStatement() { finalize(); }
+
+    SqliteStatement(const SqliteStatement&) = delete;
+    SqliteStatement& operator=(const SqliteStatement&) = delete;
+
+    bool prepare(sqlite3* db, const char* sql) {
+        finalize();
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt_, nullptr);
+        if (rc != SQLITE_OK) {
+            LOG_ERROR("SQLite prepare failed: {} - {}", rc, sqlite3_errmsg(db));
+            return false;
+        }
+        return true;
+    }
+
+    void finalize() {
+        if (stmt_) {
+            sqlite3_finalize(stmt_);
+            stmt_ = nullptr;
+        }
+    }
+
+    void reset() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+
+    operator sqlite3_stmt*() const { return stmt_; }
+
+private:
+    sqlite3_stmt* stmt_ = nullptr;
+};
+
+/// @brief Runs the calling thread at background CPU and I/O priority for a scope
+class BackgroundPriority {
+public:
+    BackgroundPriority()
+        : active_(SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0) {}
+    ~BackgroundPriority() {
+        if (active_) {
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
+    }
+
+    BackgroundPriority(const BackgroundPriority&) = delete;
+    BackgroundPriority& operator=(const BackgroundPriority&) = delete;
+
+private:
+    bool active_;
+};
+
+/// @brief An indexed file, as stored
+struct FileRow {
+    std::string path;  // UTF-8
+    std::string name;  // UTF-8
+    uint64_t size = 0;
+    uint64_t mtime = 0;  // FILETIME ticks
+    uint32_t attributes = 0;
+};
+
+/// @brief How much of a directory tree a crawl saw
+enum class CrawlResult {
+    Complete,
+    Partial,  // The root or a subdirectory could not be listed
+    Stopped,
+};
+
+/// @brief Check if a file belongs in the index (images and archives)
+[[nodiscard]] bool is_indexed(const std::filesystem::path& path) {
+    auto ext = path.extension().wstring();
+    return fs::isImageExtension(ext) || fs::isArchiveExtension(ext);
+}
+
+/// @brief Bounds of the paths below a directory, for a range query on the path index
+///
+/// "C:\a" covers "C:\a\" up to "C:\a]", as ']' follows '\'.
+[[nodiscard]] std::pair<std::string, std::string> subtree_range(std::string directory) {
+    if (!directory.empty() && directory.back() == '\\') {
+        directory.pop_back();
+    }
+    return {directory + '\\', directory + ']'};
+}
+
+/// @brief Count the characters of a UTF-8 string
+[[nodiscard]] size_t utf8_length(std::string_view text) noexcept {
+    return static_cast<size_t>(std::count_if(text.begin(), text.end(), [](char c) {
+        return (static_cast<unsigned char>(c) & 0xC0) != 0x80;  // Not a continuation byte
+    }));
+}
+
+/// @brief Quote a term as an FTS5 string, so its punctuation is matched literally
+[[nodiscard]] std::string fts_quote(std::string_view term) {
+    std::string quoted = "\"";
+    for (char c : term) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+/// @brief Build a LIKE pattern matching a term anywhere (escape character '\')
+[[nodiscard]] std::string like_pattern(std::string_view term) {
+    std::string pattern = "%";
+    for (char c : term) {
+        if (c == '%' || c == '_' || c == '\\') {
+            pattern += '\\';
+        }
+        pattern += c;
+    }
+    pattern += '%';
+    return pattern;
+}
+
+void bind_text(sqlite3_stmt* stmt, int index, const std::string& text) {
+    sqlite3_bind_text(stmt, index, text.data(), static_cast<int>(text.size()), SQLITE_STATIC);
+}
+
+[[nodiscard]] std::string column_text(sqlite3_stmt* stmt, int index) {
+    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, index));
+    return text ? std::string(text, static_cast<size_t>(sqlite3_column_bytes(stmt, index)))
+                : std::string();
+}
+
+}  // namespace
+
+class LibraryIndex::Impl {
+public:
+    explicit Impl(std::filesystem::path db_path) : db_path_(std::move(db_path)) {}
+
+    ~Impl() {
+        // The worker goes first; the watcher's callback only queues
+        worker_ = {};
+        watcher_.reset();
+        statements_finalize();
+        if (read_db_) {
+            sqlite3_close(read_db_);
+        }
+        if (db_) {
+            sqlite3_close(db_);
+        }
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    [[nodiscard]] std::expected<void, LibraryError> initialize() {
+        std::error_code ec;
+        std::filesystem::create_directories(db_path_.parent_path(), ec);
+        if (ec) {
+            LOG_ERROR("Failed to create library index directory: {}", ec.message());
+            return std::unexpected(LibraryError::InvalidPath);
+        }
+
+        auto path_utf8 = pathToUtf8(db_path_);
+        if (sqlite3_open_v2(path_utf8.c_str(), &db_,
+                            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                            nullptr) != SQLITE_OK) {
+            LOG_ERROR("Failed to open library index: {}", sqlite3_errmsg(db_));
+            return std::unexpected(LibraryError::DatabaseError);
+        }
+
+        sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "PRAGMA temp_store=MEMORY;", nullptr, nullptr, nullptr);
+        // UPDATE OR REPLACE on a rename must fire the delete trigger, or the
+        // replaced row would linger in files_fts
+        sqlite3_exec(db_, "PRAGMA recursive_triggers=ON;", nullptr, nullptr, nullptr);
+
+        if (!create_schema() || !prepare_statements()) {
+            return std::unexpected(LibraryError::DatabaseError);
+        }
+
+        // Searches read through a connection of their own (WAL readers never block)
+        if (sqlite3_open_v2(path_utf8.c_str(), &read_db_,
+                            SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+            LOG_ERROR("Failed to open library index for reading: {}", sqlite3_errmsg(read_db_));
+            return std::unexpected(LibraryError::DatabaseError);
+        }
+
+        SqliteStatement max_seen;
+        if (max_seen.prepare(db_, "SELECT COALESCE(MAX(seen), 0) FROM files") &&
+            sqlite3_step(max_seen) == SQLITE_ROW) {
+            generation_ = static_cast<uint64_t>(sqlite3_column_int64(max_seen, 0));
+        }
+
+        LOG_INFO("Library index opened: {}", path_utf8);
+        return {};
+    }
+
+    void start() {
+        watcher_ = std::make_unique<fs::DirectoryWatcher>(
+            [this](fs::DirectoryChanges changes) { on_changes(std::move(changes)); },
+            fs::DirectoryWatcherConfig{.max_directories = kMaxWatchedRoots,
+                                       .watch_subtree = true});
+        worker_ = std::jthread([this](std::stop_token stop) { run(stop); });
+    }
+
+    void setRoots(std::vector<std::filesystem::path> roots) {
+        std::vector<std::filesystem::path> previous;
+        {
+            std::lock_guard lock(mutex_);
+            previous = std::exchange(roots_, roots);
+            crawl_all_ = true;
+            rescan_roots_.clear();
+        }
+        cv_.notify_all();
+
+        for (const auto& root : previous) {
+            if (std::find(roots.begin(), roots.end(), root) == roots.end()) {
+                watcher_->unwatch(root);
+            }
+        }
+        for (const auto& root : roots) {
+            watcher_->watch(root);
+        }
+    }
+
+    void rescan() {
+        {
+            std::lock_guard lock(mutex_);
+            crawl_all_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    [[nodiscard]] std::expected<std::vector<fs::FileMetadata>, LibraryError>
+    search(std::wstring_view query, size_t limit) const {
+        std::string match;
+        std::vector<std::string> patterns;
+        auto text = wideToUtf8OrEmpty(query);
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find_first_of(" \t", pos);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string_view term(text.data() + pos, end - pos);
+            pos = end + 1;
+            if (term.empty()) {
+                continue;
+            }
+            if (utf8_length(term) >= kMinTrigramTerm) {
+                match += match.empty() ? fts_quote(term) : " " + fts_quote(term);
+            } else {
+                patterns.push_back(like_pattern(term));
+            }
+        }
+        if (match.empty() && patterns.empty()) {
+            return std::vector<fs::FileMetadata>{};
+        }
+
+        // Terms of three characters or more go through the trigram index;
+        // a query of only shorter terms scans the name column
+        std::string sql = "SELECT f.path, f.size, f.mtime, f.attributes FROM files f";
+        if (!match.empty()) {
+            sql += " JOIN files_fts ON files_fts.rowid = f.id WHERE files_fts MATCH ?";
+        }
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            sql += (match.empty() && i == 0) ? " WHERE" : " AND";
+            sql += " f.name LIKE ? ESCAPE '\\'";
+        }
+        sql += " LIMIT ?";
+
+        std::lock_guard lock(read_mutex_);
+        SqliteStatement stmt;
+        if (!stmt.prepare(read_db_, sql.c_str())) {
+            return std::unexpected(LibraryError::DatabaseError);
+        }
+        int index = 1;
+        if (!match.empty()) {
+            bind_text(stmt, index++, match);
+        }
+        for (const auto& pattern : patterns) {
+            bind_text(stmt, index++, pattern);
+        }
+        sqlite3_bind_int64(stmt, index, static_cast<int64_t>(limit));
+
+        std::vector<fs::FileMetadata> results;
+        int rc = SQLITE_ROW;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            fs::FileMetadata metadata;
+            metadata.path = utf8ToPath(column_text(stmt, 0));
+            metadata.name = metadata.path.filename().wstring();
+            metadata.extension = metadata.path.extension().wstring();
+            metadata.size_bytes = static_cast<uint64_t>(sqlite3_column_int64(stmt, 1));
+            metadata.modified_time =
+                fs::fileTimeToSystemClock(static_cast<uint64_t>(sqlite3_column_int64(stmt, 2)));
+            metadata.attributes =
+                fs::fileAttributesFromWin32(static_cast<uint32_t>(sqlite3_column_int64(stmt, 3)));
+            metadata.type = fs::getFileType(metadata.path, false);
+            results.push_back(std::move(metadata));
+        }
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("Library search failed: {}", sqlite3_errmsg(read_db_));
+            return std::unexpected(LibraryError::DatabaseError);
+        }
+        return results;
+    }
+
+    [[nodiscard]] uint64_t fileCount() const {
+        std::lock_guard lock(read_mutex_);
+        SqliteStatement stmt;
+        if (!stmt.prepare(read_db_, "SELECT COUNT(*) FROM files") ||
+            sqlite3_step(stmt) != SQLITE_ROW) {
+            return 0;
+        }
+        return static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+    }
+
+    [[nodiscard]] bool isCrawling() const noexcept { return crawling_.load(); }
+
+private:
+    [[nodiscard]] bool create_schema() {
+        SqliteStatement version;
+        int stored = 0;
+        if (version.prepare(db_, "PRAGMA user_version") && sqlite3_step(version) == SQLITE_ROW) {
+            stored = sqlite3_column_int(version, 0);
+        }
+        version.finalize();
+
+        if (stored != 0 && stored != kSchemaVersion) {
+            LOG_INFO("Library index schema {} is outdated, rebuilding", stored);
+            sqlite3_exec(db_, kDropSchemaSql, nullptr, nullptr, nullptr);
+        }
+
+        char* error = nullptr;
+        if (sqlite3_exec(db_, kCreateSchemaSql, nullptr, nullptr, &error) != SQLITE_OK) {
+            LOG_ERROR("Failed to create library index schema: {}", error ? error : "");
+            sqlite3_free(error);
+            return false;
+        }
+        auto set_version = "PRAGMA user_version=" + std::to_string(kSchemaVersion);
+        sqlite3_exec(db_, set_version.c_str(), nullptr, nullptr, nullptr);
+        return true;
+    }
+
+    [[nodiscard]] bool prepare_statements() {
+        return stmt_upsert_.prepare(db_, "INSERT INTO files (path, name, size, mtime, attributes, "
+                                         "seen) VALUES (?1, ?2, ?3, ?4, ?5, ?6) "
+                                         "ON CONFLICT(path) DO UPDATE SET name = excluded.name, "
+                                         "size = excluded.size, mtime = excluded.mtime, "
+                                         "attributes = excluded.attributes, "
+                                         "seen = excluded.seen") &&
+               stmt_remove_.prepare(db_, "DELETE FROM files WHERE path = ?1 OR "
+                                         "(path >= ?2 AND path < ?3)") &&
+               stmt_move_.prepare(db_, "UPDATE OR REPLACE files SET path = ?1 || substr(path, ?2) "
+                                       "WHERE path >= ?3 AND path < ?4") &&
+               stmt_sweep_.prepare(db_, "DELETE FROM files WHERE seen <> ?1 AND "
+                                        "path >= ?2 AND path < ?3") &&
+               stmt_touch_.prepare(db_, "UPDATE files SET seen = ?1 WHERE seen <> ?1 AND "
+                                        "path >= ?2 AND path < ?3") &&
+               stmt_sweep_all_.prepare(db_, "DELETE FROM files WHERE seen <> ?1");
+    }
+
+    void statements_finalize() {
+        stmt_upsert_.finalize();
+        stmt_remove_.finalize();
+        stmt_move_.finalize();
+        stmt_sweep_.finalize();
+        stmt_touch_.finalize();
+        stmt_sweep_all_.finalize();
+    }
+
+    // ===== Watcher thread =====
+
+    void on_changes(fs::DirectoryChanges changes) {
+        {
+            std::lock_guard lock(mutex_);
+            if (changes.overflowed) {
+                // Notifications were lost: the root needs a crawl of its own
+                if (std::find(rescan_roots_.begin(), rescan_roots_.end(), changes.directory) ==
+                    rescan_roots_.end()) {
+                    rescan_roots_.push_back(changes.directory);
+                }
+            } else {
+                changes_.push_back(std::move(changes));
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // ===== Worker thread =====
+
+    void run(std::stop_token stop) {
+        BackgroundPriority priority;
+
+        std::unique_lock lock(mutex_);
+        while (!stop.stop_requested()) {
+            cv_.wait(lock, stop, [this] {
+                return crawl_all_ || !rescan_roots_.empty() || !changes_.empty();
+            });
+            if (stop.stop_requested()) {
+                break;
+            }
+
+            auto changes = std::exchange(changes_, {});
+            auto rescan = std::exchange(rescan_roots_, {});
+            bool crawl_all = std::exchange(crawl_all_, false);
+            auto roots = roots_;
+            lock.unlock();
+
+            for (const auto& batch : changes) {
+                apply(batch, stop);
+            }
+            if (crawl_all) {
+                crawl(roots, true, stop);
+            } else if (!rescan.empty()) {
+                crawl(rescan, false, stop);
+            }
+
+            lock.lock();
+        }
+    }
+
+    /// @brief Crawl roots; with all set, drop every row not seen (roots removed)
+    void crawl(const std::vector<std::filesystem::path>& roots, bool all, std::stop_token stop) {
+        crawling_ = true;
+        uint64_t generation = ++generation_;
+        bool complete = true;
+        for (const auto& root : roots) {
+            auto result = crawl_tree(root, generation, stop);
+            if (result == CrawlResult::Stopped) {
+                complete = false;
+                break;
+            }
+            if (result == CrawlResult::Partial) {
+                complete = false;
+            } else {
+                // A watch that failed was dropped; it comes back with the crawl
+                watcher_->watch(root);
+            }
+        }
+        if (all && complete) {
+            sqlite3_bind_int64(stmt_sweep_all_, 1, static_cast<int64_t>(generation));
+            sqlite3_step(stmt_sweep_all_);
+            stmt_sweep_all_.reset();
+        }
+        crawling_ = false;
+        LOG_DEBUG("Library crawl finished ({} roots, generation {})", roots.size(), generation);
+    }
+
+    /// @brief Index a directory tree and drop the rows below it that were not seen
+    ///
+    /// If the tree could not be listed completely, its rows are kept instead.
+    CrawlResult crawl_tree(const std::filesystem::path& directory, uint64_t generation,
+                           std::stop_token stop) {
+        auto result = walk(directory, generation, stop);
+        if (result == CrawlResult::Stopped) {
+            return result;
+        }
+
+        auto [low, high] = subtree_range(pathToUtf8(directory));
+        SqliteStatement& stmt = result == CrawlResult::Complete ? stmt_sweep_ : stmt_touch_;
+        sqlite3_bind_int64(stmt, 1, static_cast<int64_t>(generation));
+        bind_text(stmt, 2, low);
+        bind_text(stmt, 3, high);
+        sqlite3_step(stmt);
+        stmt.reset();
+        return result;
+    }
+
+    /// @brief List a directory tree, writing its files in batches
+    CrawlResult walk(const std::filesystem::path& root, uint64_t generation,
+                     std::stop_token stop) {
+        auto result = CrawlResult::Complete;
+        std::vector<std::filesystem::path> pending{root};
+        std::vector<FileRow> rows;
+        fs::DirectoryRecord record;
+
+        while (!pending.empty()) {
+            if (stop.stop_requested()) {
+                write_rows(rows, generation);
+                return CrawlResult::Stopped;
+            }
+            auto directory = std::move(pending.back());
+            pending.pop_back();
+
+            auto reader = fs::DirectoryReader::open(directory);
+            if (!reader) {
+                // Gone or forbidden subdirectories are expected; anything else
+                // (an unreachable root, a dropped share) leaves the tree unknown
+                if (directory == root || reader.error() == fs::DirectoryError::IoError) {
+                    result = CrawlResult::Partial;
+                }
+                continue;
+            }
+
+            for (;;) {
+                auto more = reader->next(record);
+                if (!more) {
+                    result = CrawlResult::Partial;
+                    break;
+                }
+                if (!*more) {
+                    break;
+                }
+                if (record.attributes & FILE_ATTRIBUTE_DIRECTORY) {
+                    // Junctions and symbolic links could loop or leave the root
+                    if ((record.attributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) {
+                        pending.push_back(directory / record.name);
+                    }
+                    continue;
+                }
+                auto path = directory / record.name;
+                if (!is_indexed(path)) {
+                    continue;
+                }
+                rows.push_back({pathToUtf8(path), wideToUtf8OrEmpty(record.name), record.size,
+                                record.modified, record.attributes});
+                if (rows.size() >= kCrawlBatchSize) {
+                    write_rows(rows, generation);
+                    rows.clear();
+                }
+            }
+        }
+        write_rows(rows, generation);
+        return result;
+    }
+
+    void write_rows(const std::vector<FileRow>& rows, uint64_t generation) {
+        if (rows.empty()) {
+            return;
+        }
+        sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+        for (const auto& row : rows) {
+            upsert(row, generation);
+        }
+        sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+    }
+
+    void upsert(const FileRow& row, uint64_t generation) {
+        bind_text(stmt_upsert_, 1, row.path);
+        bind_text(stmt_upsert_, 2, row.name);
+        sqlite3_bind_int64(stmt_upsert_, 3, static_cast<int64_t>(row.size));
+        sqlite3_bind_int64(stmt_upsert_, 4, static_cast<int64_t>(row.mtime));
+        sqlite3_bind_int64(stmt_upsert_, 5, static_cast<int64_t>(row.attributes));
+        sqlite3_bind_int64(stmt_upsert_, 6, static_cast<int64_t>(generation));
+        if (sqlite3_step(stmt_upsert_) != SQLITE_DONE) {
+            LOG_WARN("Library index write failed: {}", sqlite3_errmsg(db_));
+        }
+        stmt_upsert_.reset();
+    }
+
+    /// @brief Apply one batch of change notifications in a single transaction
+    ///
+    /// Directories that appear (created, or moved in from outside the roots)
+    /// are crawled once the batch is committed.
+    void apply(const fs::DirectoryChanges& batch, std::stop_token stop) {
+        std::vector<std::filesystem::path> new_directories;
+        const auto& changes = batch.changes;
+
+        sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+        for (size_t i = 0; i < changes.size(); ++i) {
+            const auto& change = changes[i];
+            switch (change.action) {
+            case fs::FileChangeAction::RenamedFrom:
+                if (i + 1 < changes.size() &&
+                    changes[i + 1].action == fs::FileChangeAction::RenamedTo) {
+                    rename(change.path, changes[i + 1].path, new_directories);
+                    ++i;
+                } else {
+                    remove(change.path);
+                }
+                break;
+            case fs::FileChangeAction::Removed:
+                remove(change.path);
+                break;
+            case fs::FileChangeAction::Added:
+            case fs::FileChangeAction::RenamedTo:
+                update(change.path, &new_directories);
+                break;
+            case fs::FileChangeAction::Modified:
+                update(change.path, nullptr);
+                break;
+            }
+        }
+        sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+
+        for (const auto& directory : new_directories) {
+            if (crawl_tree(directory, ++generation_, stop) == CrawlResult::Stopped) {
+                break;
+            }
+        }
+    }
+
+    /// @brief Re-read a file after a change
+    /// @param new_directories Receives the path if it is a directory (nullptr = ignore those)
+    void update(const std::filesystem::path& path,
+                std::vector<std::filesystem::path>* new_directories) {
+        WIN32_FILE_ATTRIBUTE_DATA data{};
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+            remove(path);  // Already gone again
+            return;
+        }
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (new_directories && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) {
+                new_directories->push_back(path);
+            }
+            return;
+        }
+        if (!is_indexed(path)) {
+            return;
+        }
+        FileRow row;
+        row.path = pathToUtf8(path);
+        row.name = wideToUtf8OrEmpty(path.filename().wstring());
+        row.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        row.mtime = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                    data.ftLastWriteTime.dwLowDateTime;
+        row.attributes = data.dwFileAttributes;
+        upsert(row, generation_);
+    }
+
+    /// @brief Drop a file, or everything below a directory
+    void remove(const std::filesystem::path& path) {
+        auto path_utf8 = pathToUtf8(path);
+        auto [low, high] = subtree_range(path_utf8);
+        bind_text(stmt_remove_, 1, path_utf8);
+        bind_text(stmt_remove_, 2, low);
+        bind_text(stmt_remove_, 3, high);
+        sqlite3_step(stmt_remove_);
+        stmt_remove_.reset();
+    }
+
+    /// @brief Follow a rename; a renamed directory's rows are rewritten, not re-crawled
+    void rename(const std::filesystem::path& from, const std::filesystem::path& to,
+                std::vector<std::filesystem::path>& new_directories) {
+        DWORD attributes = GetFileAttributesW(to.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            remove(from);
+            update(to, &new_directories);
+            return;
+        }
+
+        auto from_utf8 = pathToUtf8(from);
+        auto to_utf8 = pathToUtf8(to);
+        auto [low, high] = subtree_range(from_utf8);
+        bind_text(stmt_move_, 1, to_utf8);
+        // substr() counts characters from 1; keep from the separator on
+        sqlite3_bind_int64(stmt_move_, 2, static_cast<int64_t>(utf8_length(from_utf8) + 1));
+        bind_text(stmt_move_, 3, low);
+        bind_text(stmt_move_, 4, high);
+        sqlite3_step(stmt_move_);
+        stmt_move_.reset();
+    }
+
+    std::filesystem::path db_path_;
+    sqlite3* db_ = nullptr;       // Worker thread only, after initialize()
+    sqlite3* read_db_ = nullptr;  // Guarded by read_mutex_
+    mutable std::mutex read_mutex_;
+
+    SqliteStatement stmt_upsert_;
+    SqliteStatement stmt_remove_;
+    SqliteStatement stmt_move_;
+    SqliteStatement stmt_sweep_;
+    SqliteStatement stmt_touch_;
+    SqliteStatement stmt_sweep_all_;
+
+    uint64_t generation_ = 0;  // Crawl generation stored in files.seen; worker thread only
+    std::atomic<bool> crawling_{false};
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::vector<std::filesystem::path> roots_;         // Guarded by mutex_
+    std::vector<std::filesystem::path> rescan_roots_;  // Guarded by mutex_
+    std::vector<fs::DirectoryChanges> changes_;        // Guarded by mutex_
+    bool crawl_all_ = false;                           // Guarded by mutex_
+
+    std::unique_ptr<fs::DirectoryWatcher> watcher_;
+    std::jthread worker_;
+};
+
+std::expected<std::unique_ptr<LibraryIndex>, LibraryError>
+LibraryIndex::open(const std::filesystem::path& path) {
+    auto impl = std::make_unique<Impl>(path);
+    if (auto result = impl->initialize(); !result) {
+        return std::unexpected(result.error());
+    }
+    impl->start();
+    return std::unique_ptr<LibraryIndex>(new LibraryIndex(std::move(impl)));
+}
+
+LibraryIndex::LibraryIndex(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+LibraryIndex::~LibraryIndex() = default;
+
+void LibraryIndex::setRoots(std::vector<std::filesystem::path> roots) {
+    impl_->setRoots(std::move(roots));
+}
+
+void LibraryIndex::rescan() {
+    impl_->rescan();
+}
+
+std::expected<std::vector<fs::FileMetadata>, LibraryError>
+LibraryIndex::search(std::wstring_view query, size_t limit) const {
+    return impl_->search(query, limit);
+}
+
+uint64_t LibraryIndex::fileCount() const {
+    return impl_->fileCount();
+}
+
+bool LibraryIndex::isCrawling() const noexcept {
+    return impl_->isCrawling();
+}
+
+}  // namespace nive::library
@@ -0,0 +1,104 @@
+/// @file library_index.hpp
+/// @brief Recursive filename index over configured library roots
+///
+/// Crawls the roots in the background and keeps the name, path, size and
+/// modification time of every image and archive in a SQLite database with
+/// an FTS5 trigram index, so filename searches across the whole library
+/// return in milliseconds without touching the file system.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "../fs/file_metadata.hpp"
+
+namespace nive::library {
+
+/// @brief Library index errors
+enum class LibraryError {
+    DatabaseError,  // SQLite error
+    InvalidPath,    // Database location unusable
+};
+
+/// @brief Get string representation of library error
+[[nodiscard]] constexpr std::string_view to_string(LibraryError error) noexcept {
+    switch (error) {
+    case LibraryError::DatabaseError:
+        return "Database error";
+    case LibraryError::InvalidPath:
+        return "Invalid library index path";
+    }
+    return "Unknown library error";
+}
+
+/// @brief Default maximum number of search results
+inline constexpr size_t kDefaultSearchLimit = 500;
+
+/// @brief Filename index of the images and archives under a set of roots
+///
+/// Thread-safe. A single background thread, at background CPU and I/O
+/// priority, crawls the roots and applies change notifications; the roots
+/// are watched recursively, so files added, removed or renamed anywhere
+/// below them are reflected without a rescan. An overflowed or failed watch
+/// rescans its root.
+///
+/// search() reads through a connection of its own and never waits for the
+/// crawler: WAL mode lets it see the last committed batch while the next is
+/// being written.
+class LibraryIndex {
+public:
+    /// @brief Open or create a library index
+    /// @param path Path to SQLite database file
+    /// @return Index with no roots yet, or error
+    [[nodiscard]] static std::expected<std::unique_ptr<LibraryIndex>, LibraryError>
+    open(const std::filesystem::path& path);
+
+    /// @brief Stop the crawler and close the database
+    ~LibraryIndex();
+
+    // Non-copyable, non-movable
+    LibraryIndex(const LibraryIndex&) = delete;
+    LibraryIndex& operator=(const LibraryIndex&) = delete;
+    LibraryIndex(LibraryIndex&&) = delete;
+    LibraryIndex& operator=(LibraryIndex&&) = delete;
+
+    /// @brief Set the indexed roots and crawl them
+    ///
+    /// Files already indexed stay searchable during the crawl; files under
+    /// roots no longer listed are dropped once it completes.
+    void setRoots(std::vector<std::filesystem::path> roots);
+
+    /// @brief Crawl every root again
+    void rescan();
+
+    /// @brief Find files by name
+    /// @param query Whitespace-separated terms, each matched anywhere in the
+    ///              file name, case-insensitively; all must match
+    /// @param limit Maximum number of results
+    /// @return Matching files (path, name, type, size, modification time), or error
+    ///
+    /// The metadata carries the indexed size and time, which is what
+    /// generateCacheKey() uses, so the results hit cached thumbnails.
+    [[nodiscard]] std::expected<std::vector<fs::FileMetadata>, LibraryError>
+    search(std::wstring_view query, size_t limit = kDefaultSearchLimit) const;
+
+    /// @brief Get the number of indexed files
+    [[nodiscard]] uint64_t fileCount() const;
+
+    /// @brief Check if a crawl is in progress
+    [[nodiscard]] bool isCrawling() const noexcept;
+
+private:
+    class Impl;
+    explicit LibraryIndex(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace nive::library
@@ -0,0 +1,155 @@
+/// @file similar_images.cpp
+/// @brief BK-tree over perceptual hashes with union-find grouping
+
+#include "similar_images.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+
+namespace nive::library {
+
+namespace {
+
+/// @brief Metric tree over 64-bit hashes under Hamming distance
+///
+/// Each node holds one distinct hash; its children are keyed by their
+/// distance to it. By the triangle inequality, a child at distance c can
+/// only hold matches within r of a query at distance d when |c - d| <= r.
+class BkTree {
+public:
+    /// @brief Add a hash
+    /// @return Index of the node holding it (an existing node for a repeat)
+    uint32_t insert(uint64_t hash) {
+        if (nodes_.empty()) {
+            nodes_.push_back({hash, {}});
+            return 0;
+        }
+        uint32_t index = 0;
+        while (true) {
+            uint32_t distance = image::hashDistance(hash, nodes_[index].hash);
+            if (distance == 0) {
+                return index;
+            }
+            auto& children = nodes_[index].children;
+            auto child = std::ranges::find(children, distance, &Child::distance);
+            if (child == children.end()) {
+                auto added = static_cast<uint32_t>(nodes_.size());
+                children.push_back({distance, added});
+                nodes_.push_back({hash, {}});
+                return added;
+            }
+            index = child->node;
+        }
+    }
+
+    /// @brief Call visit(node) for every node within max_distance of hash
+    template <typename Visit>
+    void query(uint64_t hash, uint32_t max_distance, Visit&& visit) const {
+        if (nodes_.empty()) {
+            return;
+        }
+        stack_.assign(1, 0);
+        while (!stack_.empty()) {
+            uint32_t index = stack_.back();
+            stack_.pop_back();
+            const auto& node = nodes_[index];
+            uint32_t distance = image::hashDistance(hash, node.hash);
+            if (distance <= max_distance) {
+                visit(index);
+            }
+            for (const auto& child : node.children) {
+                uint32_t gap = child.distance > distance ? child.distance - distance
+                                                         : distance - child.distance;
+                if (gap <= max_distance) {
+                    stack_.push_back(child.node);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return nodes_.size(); }
+    [[nodiscard]] uint64_t hashAt(uint32_t index) const noexcept { return nodes_[index].hash; }
+
+private:
+    struct Child {
+        uint32_t distance = 0;
+        uint32_t node = 0;
+    };
+    struct Node {
+        uint64_t hash = 0;
+        std::vector<Child> children;
+    };
+
+    std::vector<Node> nodes_;
+    mutable std::vector<uint32_t> stack_;  // Reused between queries
+};
+
+/// @brief Disjoint sets over node indices, with path halving
+class UnionFind {
+public:
+    explicit UnionFind(size_t count) : parent_(count) {
+        std::iota(parent_.begin(), parent_.end(), uint32_t{0});
+    }
+
+    [[nodiscard]] uint32_t find(uint32_t index) {
+        while (parent_[index] != index) {
+            parent_[index] = parent_[parent_[index]];
+            index = parent_[index];
+        }
+        return index;
+    }
+
+    void unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) {
+            parent_[(std::max)(a, b)] = (std::min)(a, b);
+        }
+    }
+
+private:
+    std::vector<uint32_t> parent_;
+};
+
+}  // namespace
+
+std::vector<std::vector<std::filesystem::path>>
+findSimilarImages(std::span<const cache::SourceHash> hashes, uint32_t max_distance,
+                  std::stop_token stop_token) {
+    // Identical hashes share a node, so each distinct hash is looked up once
+    BkTree tree;
+    std::vector<uint32_t> node_of(hashes.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        node_of[i] = tree.insert(hashes[i].hash);
+    }
+
+    UnionFind sets(tree.size());
+    for (uint32_t node = 0; node < tree.size(); ++node) {
+        if (stop_token.stop_requested()) {
+            return {};
+        }
+        tree.query(tree.hashAt(node), max_distance,
+                   [&sets, node](uint32_t match) { sets.unite(node, match); });
+    }
+
+    std::unordered_map<uint32_t, std::vector<std::filesystem::path>> by_root;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        by_root[sets.find(node_of[i])].push_back(hashes[i].source_path);
+    }
+
+    std::vector<std::vector<std::filesystem::path>> groups;
+    for (auto& [root, paths] : by_root) {
+        if (paths.size() > 1) {
+            std::ranges::sort(paths);
+            groups.push_back(std::move(paths));
+        }
+    }
+    std::ranges::sort(groups, [](const auto& a, const auto& b) {
+        return a.size() != b.size() ? a.size() > b.size() : a.front() < b.front();
+    });
+    return groups;
+}
+
+}  // namespace nive::library
@@ -0,0 +1,35 @@
+/// @file similar_images.hpp
+/// @brief Grouping of visually similar images by perceptual hash
+///
+/// Works on the hashes the thumbnail pipeline stores in the cache, so a
+/// whole library is compared without decoding any image again.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stop_token>
+#include <vector>
+
+#include "../cache/thumbnail_data.hpp"
+#include "../image/perceptual_hash.hpp"
+
+namespace nive::library {
+
+/// @brief Group images whose perceptual hashes are close
+/// @param hashes Hashes to compare (see cache::CacheManager::getPerceptualHashes)
+/// @param max_distance Greatest Hamming distance between neighbours in a group
+/// @param stop_token Checked between lookups
+/// @return Groups of two or more paths, largest first, each sorted by path;
+///         empty once stop is requested
+///
+/// Hashes go into a BK-tree, so each lookup only visits subtrees whose
+/// distance bounds admit a match. Groups are connected components: an
+/// image joins a group when it is near any of its members.
+[[nodiscard]] std::vector<std::vector<std::filesystem::path>>
+findSimilarImages(std::span<const cache::SourceHash> hashes,
+                  uint32_t max_distance = image::kSimilarHashDistance,
+                  std::stop_token stop_token = {});
+
+}  // namespace nive::library
@@ -0,0 +1,343 @@
+/// @file plugin_host.cpp
+/// @brief Out-of-process plugin host pool implementation
+
+#include "plugin_host.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+#include "plugin_host_protocol.hpp"
+
+namespace nive::plugin {
+
+namespace {
+
+// A request taking longer than this is taken for a hung plugin
+constexpr DWORD kRequestTimeoutMs = 60'000;
+
+// Input sections grow in steps of this size
+constexpr uint64_t kInputGranularity = uint64_t{1} << 20;
+
+}  // namespace
+
+/// @brief One host process and its channel
+class PluginHostPool::Host {
+public:
+    Host(std::wstring channel, uint32_t epoch) : channel_(std::move(channel)), epoch_(epoch) {}
+
+    ~Host() {
+        if (process_ && alive()) {
+            TerminateProcess(process_.get(), host::kExitOk);
+        }
+    }
+
+    Host(const Host&) = delete;
+    Host& operator=(const Host&) = delete;
+
+    /// @brief Create the control block and events the process opens on start
+    bool createChannel() {
+        if (!control_.create(channel_, sizeof(host::Control))) {
+            return false;
+        }
+        std::memset(control_.data(), 0, sizeof(host::Control));
+        control().magic = host::kMagic;
+        control().version = host::kVersion;
+
+        request_ = HandleGuard(
+            CreateEventW(nullptr, FALSE, FALSE, host::requestEventName(channel_).c_str()));
+        done_ = HandleGuard(
+            CreateEventW(nullptr, FALSE, FALSE, host::doneEventName(channel_).c_str()));
+        return request_ && done_;
+    }
+
+    void attach(HANDLE process) { process_ = HandleGuard(process); }
+
+    /// @brief Send a request and wait for the response
+    /// @return Error reported by the host, NIVE_PLUGIN_ERROR_DECODE_FAILED if it died
+    NivePluginError call(host::Op op, const uint8_t* data, size_t size,
+                         const std::string& extension, NivePixelFormat preferred,
+                         const NiveDecodeHints* hints) {
+        if (!input_.valid() || input_.capacity() < size) {
+            uint64_t capacity =
+                std::max((size + kInputGranularity - 1) / kInputGranularity, uint64_t{1}) *
+                kInputGranularity;
+            if (!input_.create(host::inputName(channel_, ++input_generation_), capacity)) {
+                return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        // The only copy: encoded bytes, not pixels
+        std::memcpy(input_.data(), data, size);
+
+        host::Control& request = control();
+        request.op = op;
+        request.input_generation = input_generation_;
+        request.input_capacity = input_.capacity();
+        request.input_size = size;
+        request.preferred_format = preferred;
+        request.has_hints = hints ? 1 : 0;
+        request.hints = hints ? *hints : NiveDecodeHints{};
+        size_t length = std::min(extension.size(), sizeof(request.extension) - 1);
+        std::memcpy(request.extension, extension.data(), length);
+        request.extension[length] = '\0';
+        request.error = NIVE_PLUGIN_ERROR_DECODE_FAILED;
+
+        SetEvent(request_.get());
+        HANDLE waits[] = {done_.get(), process_.get()};
+        DWORD result = WaitForMultipleObjects(2, waits, FALSE, kRequestTimeoutMs);
+        if (result != WAIT_OBJECT_0) {
+            if (result == WAIT_TIMEOUT) {
+                LOG_WARN("Plugin host did not answer within {} ms, ending it",
+                         kRequestTimeoutMs);
+                TerminateProcess(process_.get(), host::kExitOk);
+            }
+            dead_ = true;
+            return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+        }
+
+        const host::Control& response = control();
+        if (op == host::Op::Decode && response.error == NIVE_PLUGIN_OK &&
+            (!output_.valid() || response.output_generation != output_generation_)) {
+            output_generation_ = response.output_generation;
+            if (!output_.open(host::outputName(channel_, output_generation_),
+                              response.output_capacity)) {
+                return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        return response.error;
+    }
+
+    [[nodiscard]] host::Control& control() const noexcept {
+        return *reinterpret_cast<host::Control*>(control_.data());
+    }
+
+    [[nodiscard]] const host::SharedSection& output() const noexcept { return output_; }
+
+    [[nodiscard]] bool alive() const noexcept {
+        return !dead_ && WaitForSingleObject(process_.get(), 0) == WAIT_TIMEOUT;
+    }
+
+    /// @brief Get the exit code of a process that ended
+    [[nodiscard]] DWORD exitCode() const noexcept {
+        DWORD code = 0;
+        GetExitCodeProcess(process_.get(), &code);
+        return code;
+    }
+
+    [[nodiscard]] uint32_t epoch() const noexcept { return epoch_; }
+
+private:
+    std::wstring channel_;
+    uint32_t epoch_;
+    HandleGuard process_;
+    HandleGuard request_;
+    HandleGuard done_;
+    host::SharedSection control_;
+    host::SharedSection input_;
+    host::SharedSection output_;
+    uint32_t input_generation_ = 0;
+    uint32_t output_generation_ = 0;
+    bool dead_ = false;
+};
+
+PluginHostPool::PluginHostPool(std::filesystem::path host_executable, size_t hosts_per_plugin)
+    : executable_(std::move(host_executable)),
+      hosts_per_plugin_(std::max<size_t>(hosts_per_plugin, 1)),
+      job_(CreateJobObjectW(nullptr, nullptr)) {
+    if (!job_) {
+        LOG_WARN("Failed to create plugin host job object; hosts may outlive nive");
+        return;
+    }
+
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+    limits.BasicLimitInformation.LimitFlags =
+        JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE | JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION;
+    SetInformationJobObject(job_.get(), JobObjectExtendedLimitInformation, &limits,
+                            sizeof(limits));
+
+    // Decoders have no business with the desktop, the clipboard or other windows
+    JOBOBJECT_BASIC_UI_RESTRICTIONS ui = {};
+    ui.UIRestrictionsClass = JOB_OBJECT_UILIMIT_DESKTOP | JOB_OBJECT_UILIMIT_DISPLAYSETTINGS |
+                             JOB_OBJECT_UILIMIT_EXITWINDOWS | JOB_OBJECT_UILIMIT_GLOBALATOMS |
+                             JOB_OBJECT_UILIMIT_HANDLES | JOB_OBJECT_UILIMIT_READCLIPBOARD |
+                             JOB_OBJECT_UILIMIT_SYSTEMPARAMETERS |
+                             JOB_OBJECT_UILIMIT_WRITECLIPBOARD;
+    SetInformationJobObject(job_.get(), JobObjectBasicUIRestrictions, &ui, sizeof(ui));
+}
+
+PluginHostPool::~PluginHostPool() {
+    std::lock_guard lock(mutex_);
+    slots_.clear();
+}
+
+void PluginHostPool::warm(const std::filesystem::path& plugin) {
+    std::wstring key = plugin.wstring();
+    if (auto worker = acquire(key)) {
+        give_back(key, std::move(worker));
+    }
+}
+
+void PluginHostPool::release(const std::filesystem::path& plugin) {
+    std::vector<std::unique_ptr<Host>> ending;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = slots_.find(plugin.wstring());
+        if (it == slots_.end()) {
+            return;
+        }
+        Slot& slot = it->second;
+        ending = std::move(slot.idle);
+        slot.idle.clear();
+        slot.running -= ending.size();
+        slot.broken = false;
+        ++slot.epoch;
+    }
+    returned_.notify_all();
+}
+
+NivePluginError PluginHostPool::decode(const std::filesystem::path& plugin, const uint8_t* data,
+                                       size_t size, const std::string& extension,
+                                       NivePixelFormat preferred, const NiveDecodeHints* hints,
+                                       const ImageSink& sink) {
+    std::wstring key = plugin.wstring();
+    auto worker = acquire(key);
+    if (!worker) {
+        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    }
+
+    NivePluginError error =
+        worker->call(host::Op::Decode, data, size, extension, preferred, hints);
+    if (error == NIVE_PLUGIN_OK) {
+        const host::Control& response = worker->control();
+        uint64_t bytes = static_cast<uint64_t>(response.width) * response.height *
+                         host::bytesPerPixel(response.format);
+        if (bytes == 0 || bytes > worker->output().capacity()) {
+            error = NIVE_PLUGIN_ERROR_DECODE_FAILED;
+        } else {
+            NiveDecodedImage image = {worker->output().data(), response.width, response.height,
+                                      response.format};
+            sink(image, response.info);
+        }
+    }
+
+    give_back(key, std::move(worker));
+    return error;
+}
+
+std::expected<NiveImageInfo, NivePluginError>
+PluginHostPool::getImageInfo(const std::filesystem::path& plugin, const uint8_t* data,
+                             size_t size, const std::string& extension) {
+    std::wstring key = plugin.wstring();
+    auto worker = acquire(key);
+    if (!worker) {
+        return std::unexpected(NIVE_PLUGIN_ERROR_DECODE_FAILED);
+    }
+
+    NivePluginError error = worker->call(host::Op::ImageInfo, data, size, extension,
+                                         NIVE_PIXEL_FORMAT_RGBA8, nullptr);
+    NiveImageInfo info = worker->control().image_info;
+    give_back(key, std::move(worker));
+    if (error != NIVE_PLUGIN_OK) {
+        return std::unexpected(error);
+    }
+    if (info.frame_count == 0) {
+        info.frame_count = 1;  // Not reported by API 1.2 / 1.3 plugins
+    }
+    return info;
+}
+
+std::unique_ptr<PluginHostPool::Host> PluginHostPool::acquire(const std::wstring& plugin) {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        Slot& slot = slots_[plugin];
+        if (slot.broken) {
+            return nullptr;
+        }
+        while (!slot.idle.empty()) {
+            auto worker = std::move(slot.idle.back());
+            slot.idle.pop_back();
+            if (worker->alive()) {
+                return worker;
+            }
+            --slot.running;  // Ended while idle
+        }
+
+        if (slot.running < hosts_per_plugin_) {
+            ++slot.running;
+            uint32_t epoch = slot.epoch;
+            std::wstring channel = L"Local\\nive_plugin_host_" +
+                                   std::to_wstring(GetCurrentProcessId()) + L"_" +
+                                   std::to_wstring(next_channel_++);
+            lock.unlock();
+
+            auto worker = spawn(plugin, channel, epoch);
+            if (!worker) {
+                lock.lock();
+                --slots_[plugin].running;
+                returned_.notify_one();
+            }
+            return worker;
+        }
+
+        returned_.wait(lock);
+    }
+}
+
+void PluginHostPool::give_back(const std::wstring& plugin, std::unique_ptr<Host> worker) {
+    bool alive = worker->alive();
+    if (!alive) {
+        DWORD code = worker->exitCode();
+        LOG_WARN("Plugin host for {} ended (exit code 0x{:08X})", pathToUtf8(plugin),
+                 static_cast<unsigned>(code));
+        if (code == host::kExitLoadFailed) {
+            std::lock_guard lock(mutex_);
+            slots_[plugin].broken = true;
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        Slot& slot = slots_[plugin];
+        if (alive && worker->epoch() == slot.epoch) {
+            slot.idle.push_back(std::move(worker));
+        } else {
+            --slot.running;
+        }
+    }
+    returned_.notify_one();
+    // A host that is not kept ends here, outside the lock
+}
+
+std::unique_ptr<PluginHostPool::Host> PluginHostPool::spawn(const std::wstring& plugin,
+                                                            const std::wstring& channel,
+                                                            uint32_t epoch) {
+    auto worker = std::make_unique<Host>(channel, epoch);
+    if (!worker->createChannel()) {
+        LOG_WARN("Failed to create plugin host channel: {}", GetLastError());
+        return nullptr;
+    }
+
+    std::wstring command = L"\"" + executable_.wstring() + L"\" \"" + plugin + L"\" " + channel +
+                           L" " + std::to_wstring(GetCurrentProcessId());
+    STARTUPINFOW startup = {};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION process = {};
+
+    // Suspended until it is in the job, so it cannot start anything outside it
+    if (!CreateProcessW(executable_.c_str(), command.data(), nullptr, nullptr, FALSE,
+                        CREATE_SUSPENDED, nullptr, nullptr, &startup, &process)) {
+        LOG_WARN("Failed to start plugin host {}: {}", pathToUtf8(executable_), GetLastError());
+        return nullptr;
+    }
+    if (job_) {
+        AssignProcessToJobObject(job_.get(), process.hProcess);
+    }
+    ResumeThread(process.hThread);
+    CloseHandle(process.hThread);
+
+    worker->attach(process.hProcess);
+    return worker;
+}
+
+}  // namespace nive::plugin
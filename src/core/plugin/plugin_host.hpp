@@ -0,0 +1,113 @@
+/// @file plugin_host.hpp
+/// @brief Warm pool of out-of-process plugin hosts
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nive/plugin_api.h"
+#include "util/win32_utils.hpp"
+
+namespace nive::plugin {
+
+/// @brief Runs decoder plugins in nive_plugin_host processes
+///
+/// Each host loads one plugin and serves one request at a time over a
+/// shared memory channel (see plugin_host_protocol.hpp): encoded bytes go
+/// in through one section, pixels come back in another that the caller
+/// reads in place. Up to hosts_per_plugin hosts run per plugin, so that
+/// many decodes proceed in parallel; idle hosts stay alive for the next
+/// request. A host that crashes or hangs fails its request and is
+/// replaced on the next one. Hosts belong to a job object that ends them
+/// with this process and denies them desktop and clipboard access.
+///
+/// Thread-safe.
+class PluginHostPool {
+public:
+    /// @brief Receives a decoded image while the host's output section is mapped
+    /// @param image Tightly packed pixels (valid only during the call)
+    /// @param info Source size and the region image covers
+    using ImageSink =
+        std::function<void(const NiveDecodedImage& image, const NiveDecodeInfo& info)>;
+
+    /// @param host_executable Path to nive_plugin_host.exe
+    /// @param hosts_per_plugin Processes at most per plugin (at least 1)
+    PluginHostPool(std::filesystem::path host_executable, size_t hosts_per_plugin);
+    ~PluginHostPool();
+
+    // Non-copyable, non-movable
+    PluginHostPool(const PluginHostPool&) = delete;
+    PluginHostPool& operator=(const PluginHostPool&) = delete;
+    PluginHostPool(PluginHostPool&&) = delete;
+    PluginHostPool& operator=(PluginHostPool&&) = delete;
+
+    /// @brief Start a host for a plugin ahead of its first request
+    void warm(const std::filesystem::path& plugin);
+
+    /// @brief End the hosts of a plugin (when it is unloaded)
+    ///
+    /// Hosts busy with a request end when it completes.
+    void release(const std::filesystem::path& plugin);
+
+    /// @brief Decode in a host
+    /// @param plugin Plugin DLL path
+    /// @param data Image data
+    /// @param size Data size in bytes
+    /// @param extension File extension hint
+    /// @param preferred Format hint, as for PluginLoader::decode
+    /// @param hints Target size and region, or nullptr for the full image
+    /// @param sink Called with the pixels on success
+    /// @return NIVE_PLUGIN_OK after sink ran, the plugin's error, or
+    ///         NIVE_PLUGIN_ERROR_DECODE_FAILED if the host died
+    NivePluginError decode(const std::filesystem::path& plugin, const uint8_t* data, size_t size,
+                           const std::string& extension, NivePixelFormat preferred,
+                           const NiveDecodeHints* hints, const ImageSink& sink);
+
+    /// @brief Read image metadata in a host
+    [[nodiscard]] std::expected<NiveImageInfo, NivePluginError>
+    getImageInfo(const std::filesystem::path& plugin, const uint8_t* data, size_t size,
+                 const std::string& extension);
+
+private:
+    class Host;
+
+    /// @brief Hosts of one plugin
+    struct Slot {
+        std::vector<std::unique_ptr<Host>> idle;
+        size_t running = 0;   // Idle and busy hosts
+        uint32_t epoch = 0;   // Bumped by release(); busy hosts of older epochs end
+        bool broken = false;  // Plugin does not load in a host
+    };
+
+    /// @brief Take an idle host, start one, or wait for one to come back
+    /// @return Host, or nullptr if none can be started
+    [[nodiscard]] std::unique_ptr<Host> acquire(const std::wstring& plugin);
+
+    /// @brief Return a host after a request (destroys it if it died)
+    void give_back(const std::wstring& plugin, std::unique_ptr<Host> worker);
+
+    /// @brief Start a host process (mutex_ not held)
+    [[nodiscard]] std::unique_ptr<Host> spawn(const std::wstring& plugin,
+                                              const std::wstring& channel, uint32_t epoch);
+
+    std::filesystem::path executable_;
+    size_t hosts_per_plugin_;
+    HandleGuard job_;  // Kills hosts when the last handle (ours) closes
+
+    std::mutex mutex_;
+    std::condition_variable returned_;
+    std::unordered_map<std::wstring, Slot> slots_;  // By plugin path
+    uint32_t next_channel_ = 0;
+};
+
+}  // namespace nive::plugin
@@ -0,0 +1,163 @@
+/// @file plugin_host_protocol.hpp
+/// @brief Shared memory channel between PluginHostPool and nive_plugin_host
+///
+/// Each host process owns one channel: a control block, an input section the
+/// client copies encoded bytes into and an output section the host decodes
+/// into. All three are pagefile-backed file mappings named after the channel
+/// and reused while large enough, so a decode costs one event round trip and
+/// pixels never pass through a pipe.
+
+#pragma once
+
+#include <Windows.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "nive/plugin_api.h"
+#include "util/win32_utils.hpp"
+
+namespace nive::plugin::host {
+
+inline constexpr uint32_t kMagic = 0x4856504E;  // "NPVH"
+inline constexpr uint32_t kVersion = 1;
+
+// Host process exit codes
+inline constexpr DWORD kExitOk = 0;
+inline constexpr DWORD kExitBadArguments = 1;
+inline constexpr DWORD kExitChannelFailed = 2;
+inline constexpr DWORD kExitLoadFailed = 3;
+
+/// @brief Request kinds
+enum class Op : uint32_t {
+    Decode = 1,     // Decode into the output section (hinted if has_hints)
+    ImageInfo = 2,  // Fill image_info from the headers
+};
+
+/// @brief Control block at the start of a channel
+///
+/// The client writes the request half and signals the request event; the
+/// host writes the response half and signals the done event. Only one side
+/// touches the block at a time.
+struct Control {
+    uint32_t magic;
+    uint32_t version;
+
+    // Request (client)
+    Op op;
+    uint32_t input_generation;  // Bumped when the client recreates the input section
+    uint64_t input_capacity;
+    uint64_t input_size;
+    NivePixelFormat preferred_format;
+    uint32_t has_hints;
+    NiveDecodeHints hints;
+    char extension[32];  // NUL-terminated
+
+    // Response (host)
+    NivePluginError error;
+    uint32_t output_generation;  // Bumped when the host recreates the output section
+    uint64_t output_capacity;
+    uint32_t width;
+    uint32_t height;
+    NivePixelFormat format;  // Rows are tightly packed
+    NiveDecodeInfo info;
+    NiveImageInfo image_info;
+};
+
+[[nodiscard]] inline std::wstring requestEventName(const std::wstring& channel) {
+    return channel + L"_request";
+}
+
+[[nodiscard]] inline std::wstring doneEventName(const std::wstring& channel) {
+    return channel + L"_done";
+}
+
+[[nodiscard]] inline std::wstring inputName(const std::wstring& channel, uint32_t generation) {
+    return channel + L"_in" + std::to_wstring(generation);
+}
+
+[[nodiscard]] inline std::wstring outputName(const std::wstring& channel, uint32_t generation) {
+    return channel + L"_out" + std::to_wstring(generation);
+}
+
+/// @brief Get bytes per pixel of a plugin pixel format (0 if unknown)
+[[nodiscard]] constexpr size_t bytesPerPixel(NivePixelFormat format) noexcept {
+    switch (format) {
+    case NIVE_PIXEL_FORMAT_RGBA8:
+    case NIVE_PIXEL_FORMAT_BGRA8:
+        return 4;
+    case NIVE_PIXEL_FORMAT_RGB8:
+        return 3;
+    case NIVE_PIXEL_FORMAT_GRAY8:
+        return 1;
+    case NIVE_PIXEL_FORMAT_RGBA16:
+    case NIVE_PIXEL_FORMAT_RGBA16F:
+        return 8;
+    }
+    return 0;
+}
+
+/// @brief Named pagefile-backed mapping with a read-write view
+class SharedSection {
+public:
+    SharedSection() = default;
+    ~SharedSection() { reset(); }
+
+    // Non-copyable, non-movable (views are handed out as raw pointers)
+    SharedSection(const SharedSection&) = delete;
+    SharedSection& operator=(const SharedSection&) = delete;
+    SharedSection(SharedSection&&) = delete;
+    SharedSection& operator=(SharedSection&&) = delete;
+
+    /// @brief Create a new mapping, replacing the current one
+    bool create(const std::wstring& name, uint64_t capacity) {
+        reset();
+        mapping_ = HandleGuard(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                                  static_cast<DWORD>(capacity >> 32),
+                                                  static_cast<DWORD>(capacity), name.c_str()));
+        return map(capacity);
+    }
+
+    /// @brief Open a mapping created by the other side, replacing the current one
+    bool open(const std::wstring& name, uint64_t capacity) {
+        reset();
+        mapping_ =
+            HandleGuard(OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str()));
+        return map(capacity);
+    }
+
+    void reset() noexcept {
+        if (view_) {
+            UnmapViewOfFile(view_);
+            view_ = nullptr;
+        }
+        mapping_.close();
+        capacity_ = 0;
+    }
+
+    [[nodiscard]] uint8_t* data() const noexcept { return static_cast<uint8_t*>(view_); }
+    [[nodiscard]] uint64_t capacity() const noexcept { return capacity_; }
+    [[nodiscard]] bool valid() const noexcept { return view_ != nullptr; }
+
+private:
+    bool map(uint64_t capacity) {
+        if (!mapping_) {
+            return false;
+        }
+        view_ = MapViewOfFile(mapping_.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0,
+                              static_cast<SIZE_T>(capacity));
+        if (!view_) {
+            mapping_.close();
+            return false;
+        }
+        capacity_ = capacity;
+        return true;
+    }
+
+    HandleGuard mapping_;
+    void* view_ = nullptr;
+    uint64_t capacity_ = 0;
+};
+
+}  // namespace nive::plugin::host
@@ -3,6 +3,9 @@
 
 #include "plugin_loader.hpp"
 
+#include <algorithm>
+#include <thread>
+
 namespace nive::plugin {
 
 std::expected<PluginLoader, LoadError> PluginLoader::load(const std::filesystem::path& path) {
@@ -50,8 +53,16 @@ std::expected<PluginLoader, LoadError> PluginLoader::load(const std::filesystem:
     }
 
     // Get optional function pointers
+    loader.decode_ex_fn_ = loader.getProc<NivePluginDecodeExFn>(NIVE_PLUGIN_DECODE_EX_NAME);
+    loader.get_image_info_fn_ =
+        loader.getProc<NivePluginGetImageInfoFn>(NIVE_PLUGIN_GET_IMAGE_INFO_NAME);
+    loader.decode_into_fn_ = loader.getProc<NivePluginDecodeIntoFn>(NIVE_PLUGIN_DECODE_INTO_NAME);
+    loader.decode_hinted_fn_ =
+        loader.getProc<NivePluginDecodeHintedFn>(NIVE_PLUGIN_DECODE_HINTED_NAME);
     loader.init_fn_ = loader.getProc<NivePluginInitFn>(NIVE_PLUGIN_INIT_NAME);
     loader.shutdown_fn_ = loader.getProc<NivePluginShutdownFn>(NIVE_PLUGIN_SHUTDOWN_NAME);
+    loader.thread_detach_fn_ =
+        loader.getProc<NivePluginThreadDetachFn>(NIVE_PLUGIN_THREAD_DETACH_NAME);
     loader.has_settings_fn_ = loader.getProc<NivePluginHasSettingsFn>(NIVE_PLUGIN_HAS_SETTINGS_NAME);
     loader.show_settings_fn_ = loader.getProc<NivePluginShowSettingsFn>(NIVE_PLUGIN_SHOW_SETTINGS_NAME);
 
@@ -70,9 +81,16 @@ std::expected<PluginLoader, LoadError> PluginLoader::load(const std::filesystem:
         return std::unexpected(LoadError::VersionMismatch);
     }
 
-    // Initialize plugin if init function exists
-    if (loader.init_fn_) {
-        NivePluginError result = loader.init_fn_();
+    // Initialize plugin if an init function exists; init_ex also hands over the
+    // thread budget for decodes (the viewer's), thumbnails ask for fewer per call
+    auto init_ex = loader.getProc<NivePluginInitExFn>(NIVE_PLUGIN_INIT_EX_NAME);
+    if (init_ex || loader.init_fn_) {
+        NiveHostInfo host = {
+            .api_version_major = NIVE_PLUGIN_API_VERSION_MAJOR,
+            .api_version_minor = NIVE_PLUGIN_API_VERSION_MINOR,
+            .decode_threads = std::max(std::thread::hardware_concurrency(), 1u),
+        };
+        NivePluginError result = init_ex ? init_ex(&host) : loader.init_fn_();
         if (result != NIVE_PLUGIN_OK) {
             FreeLibrary(loader.module_);
             loader.module_ = nullptr;
@@ -96,8 +114,12 @@ PluginLoader::~PluginLoader() {
 PluginLoader::PluginLoader(PluginLoader&& other) noexcept
     : module_(other.module_), path_(std::move(other.path_)), info_(other.info_),
       get_info_fn_(other.get_info_fn_), can_decode_fn_(other.can_decode_fn_),
-      decode_fn_(other.decode_fn_), free_image_fn_(other.free_image_fn_), init_fn_(other.init_fn_),
-      shutdown_fn_(other.shutdown_fn_), has_settings_fn_(other.has_settings_fn_),
+      decode_fn_(other.decode_fn_), free_image_fn_(other.free_image_fn_),
+      decode_ex_fn_(other.decode_ex_fn_), get_image_info_fn_(other.get_image_info_fn_),
+      decode_into_fn_(other.decode_into_fn_), decode_hinted_fn_(other.decode_hinted_fn_),
+      init_fn_(other.init_fn_),
+      shutdown_fn_(other.shutdown_fn_), thread_detach_fn_(other.thread_detach_fn_),
+      has_settings_fn_(other.has_settings_fn_),
       show_settings_fn_(other.show_settings_fn_) {
     other.module_ = nullptr;
     other.info_ = nullptr;
@@ -105,8 +127,13 @@ PluginLoader::PluginLoader(PluginLoader&& other) noexcept
     other.can_decode_fn_ = nullptr;
     other.decode_fn_ = nullptr;
     other.free_image_fn_ = nullptr;
+    other.decode_ex_fn_ = nullptr;
+    other.get_image_info_fn_ = nullptr;
+    other.decode_into_fn_ = nullptr;
+    other.decode_hinted_fn_ = nullptr;
     other.init_fn_ = nullptr;
     other.shutdown_fn_ = nullptr;
+    other.thread_detach_fn_ = nullptr;
     other.has_settings_fn_ = nullptr;
     other.show_settings_fn_ = nullptr;
 }
@@ -129,8 +156,13 @@ PluginLoader& PluginLoader::operator=(PluginLoader&& other) noexcept {
         can_decode_fn_ = other.can_decode_fn_;
         decode_fn_ = other.decode_fn_;
         free_image_fn_ = other.free_image_fn_;
+        decode_ex_fn_ = other.decode_ex_fn_;
+        get_image_info_fn_ = other.get_image_info_fn_;
+        decode_into_fn_ = other.decode_into_fn_;
+        decode_hinted_fn_ = other.decode_hinted_fn_;
         init_fn_ = other.init_fn_;
         shutdown_fn_ = other.shutdown_fn_;
+        thread_detach_fn_ = other.thread_detach_fn_;
         has_settings_fn_ = other.has_settings_fn_;
         show_settings_fn_ = other.show_settings_fn_;
 
@@ -141,8 +173,13 @@ PluginLoader& PluginLoader::operator=(PluginLoader&& other) noexcept {
         other.can_decode_fn_ = nullptr;
         other.decode_fn_ = nullptr;
         other.free_image_fn_ = nullptr;
+        other.decode_ex_fn_ = nullptr;
+        other.get_image_info_fn_ = nullptr;
+        other.decode_into_fn_ = nullptr;
+        other.decode_hinted_fn_ = nullptr;
         other.init_fn_ = nullptr;
         other.shutdown_fn_ = nullptr;
+        other.thread_detach_fn_ = nullptr;
         other.has_settings_fn_ = nullptr;
         other.show_settings_fn_ = nullptr;
     }
@@ -157,14 +194,17 @@ bool PluginLoader::canDecode(const std::string& extension) const {
 }
 
 std::expected<NiveDecodedImage, NivePluginError>
-PluginLoader::decode(const uint8_t* data, size_t size, const std::string& extension) const {
+PluginLoader::decode(const uint8_t* data, size_t size, const std::string& extension,
+                     NivePixelFormat preferred_format) const {
     if (!decode_fn_) {
         return std::unexpected(NIVE_PLUGIN_ERROR_DECODE_FAILED);
     }
 
     NiveDecodedImage image = {};
-    NivePluginError result =
-        decode_fn_(data, size, extension.empty() ? nullptr : extension.c_str(), &image);
+    const char* ext = extension.empty() ? nullptr : extension.c_str();
+    NivePluginError result = preferred_format != NIVE_PIXEL_FORMAT_RGBA8 && decode_ex_fn_
+                                 ? decode_ex_fn_(data, size, ext, preferred_format, &image)
+                                 : decode_fn_(data, size, ext, &image);
 
     if (result != NIVE_PLUGIN_OK) {
         return std::unexpected(result);
@@ -173,6 +213,60 @@ PluginLoader::decode(const uint8_t* data, size_t size, const std::string& extens
     return image;
 }
 
+std::expected<HintedDecode, NivePluginError>
+PluginLoader::decodeHinted(const uint8_t* data, size_t size, const std::string& extension,
+                           NivePixelFormat preferred_format, const NiveDecodeHints& hints) const {
+    if (!decode_hinted_fn_) {
+        auto image = decode(data, size, extension, preferred_format);
+        if (!image) {
+            return std::unexpected(image.error());
+        }
+        NiveDecodeInfo info = {image->width, image->height, 0, 0, image->width, image->height};
+        return HintedDecode{*image, info};
+    }
+
+    HintedDecode result = {};
+    const char* ext = extension.empty() ? nullptr : extension.c_str();
+    NivePluginError error =
+        decode_hinted_fn_(data, size, ext, preferred_format, &hints, &result.image, &result.info);
+    if (error != NIVE_PLUGIN_OK) {
+        return std::unexpected(error);
+    }
+
+    return result;
+}
+
+std::expected<NiveImageInfo, NivePluginError>
+PluginLoader::getImageInfo(const uint8_t* data, size_t size, const std::string& extension) const {
+    if (!get_image_info_fn_) {
+        return std::unexpected(NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT);
+    }
+
+    NiveImageInfo info = {};
+    const char* ext = extension.empty() ? nullptr : extension.c_str();
+    NivePluginError result = get_image_info_fn_(data, size, ext, &info);
+    if (result != NIVE_PLUGIN_OK) {
+        return std::unexpected(result);
+    }
+    if (info.frame_count == 0) {
+        info.frame_count = 1;  // Not reported by API 1.2 / 1.3 plugins
+    }
+
+    return info;
+}
+
+NivePluginError PluginLoader::decodeInto(const uint8_t* data, size_t size,
+                                         const std::string& extension, NivePixelFormat format,
+                                         uint8_t* pixels, size_t stride, uint32_t width,
+                                         uint32_t height) const {
+    if (!supportsDecodeInto()) {
+        return NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT;
+    }
+
+    const char* ext = extension.empty() ? nullptr : extension.c_str();
+    return decode_into_fn_(data, size, ext, format, pixels, stride, width, height);
+}
+
 void PluginLoader::freeImage(NiveDecodedImage& image) const {
     if (free_image_fn_ && image.pixels) {
         free_image_fn_(&image);
@@ -180,6 +274,27 @@ void PluginLoader::freeImage(NiveDecodedImage& image) const {
     }
 }
 
+uint32_t PluginLoader::threading() const noexcept {
+    // The fields do not exist in the info of plugins built against 1.5 or earlier
+    if (!info_ || info_->api_version_minor < 6) {
+        return 0;
+    }
+    return info_->threading;
+}
+
+uint32_t PluginLoader::maxConcurrency() const noexcept {
+    if (threading() == 0) {
+        return 1;
+    }
+    return info_->max_concurrency;
+}
+
+void PluginLoader::detachThread() const {
+    if (thread_detach_fn_ && (threading() & NIVE_PLUGIN_THREADING_PER_THREAD_STATE)) {
+        thread_detach_fn_();
+    }
+}
+
 bool PluginLoader::hasSettings() const noexcept {
     return has_settings_fn_ && has_settings_fn_() != 0;
 }
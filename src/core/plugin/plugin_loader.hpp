@@ -40,6 +40,12 @@ enum class LoadError {
     return "Unknown error";
 }
 
+/// @brief Result of PluginLoader::decodeHinted
+struct HintedDecode {
+    NiveDecodedImage image;  // Free with PluginLoader::freeImage
+    NiveDecodeInfo info;     // Source size and the region image covers
+};
+
 /// @brief RAII wrapper for loaded plugin DLL
 ///
 /// Manages the lifecycle of a dynamically loaded plugin, including
@@ -77,14 +83,69 @@ public:
     /// @param data Image data
     /// @param size Data size in bytes
     /// @param extension File extension hint (optional)
+    /// @param preferred_format Format hint, passed on by plugins that export decode_ex
     /// @return Decoded image on success, error code on failure
     [[nodiscard]] std::expected<NiveDecodedImage, NivePluginError>
-    decode(const uint8_t* data, size_t size, const std::string& extension = "") const;
+    decode(const uint8_t* data, size_t size, const std::string& extension = "",
+           NivePixelFormat preferred_format = NIVE_PIXEL_FORMAT_RGBA8) const;
+
+    /// @brief Check if the plugin exports decode_hinted (API 1.3)
+    [[nodiscard]] bool supportsHints() const noexcept { return decode_hinted_fn_ != nullptr; }
+
+    /// @brief Decode image, letting the plugin reduce it to what the hints ask for
+    /// @param data Image data
+    /// @param size Data size in bytes
+    /// @param extension File extension hint
+    /// @param preferred_format Format hint
+    /// @param hints Target size and region
+    /// @return Decoded image on success, error code on failure
+    ///
+    /// Plugins without decode_hinted decode the whole image through decode();
+    /// the info then describes the full image.
+    [[nodiscard]] std::expected<HintedDecode, NivePluginError>
+    decodeHinted(const uint8_t* data, size_t size, const std::string& extension,
+                 NivePixelFormat preferred_format, const NiveDecodeHints& hints) const;
+
+    /// @brief Check if the plugin can decode into host buffers (getImageInfo, decodeInto)
+    [[nodiscard]] bool supportsDecodeInto() const noexcept {
+        return get_image_info_fn_ && decode_into_fn_;
+    }
+
+    /// @brief Check if the plugin exports get_image_info
+    [[nodiscard]] bool supportsImageInfo() const noexcept { return get_image_info_fn_ != nullptr; }
+
+    /// @brief Read image dimensions, format, frame count and alpha from the headers
+    /// @return Information, or NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT without get_image_info
+    [[nodiscard]] std::expected<NiveImageInfo, NivePluginError>
+    getImageInfo(const uint8_t* data, size_t size, const std::string& extension = "") const;
+
+    /// @brief Decode image into a caller-owned buffer
+    /// @param data Image data
+    /// @param size Data size in bytes
+    /// @param extension File extension hint
+    /// @param format Exact format to write
+    /// @param pixels Destination, stride * height bytes
+    /// @param stride Destination row stride in bytes
+    /// @param width Width from getImageInfo()
+    /// @param height Height from getImageInfo()
+    /// @return NIVE_PLUGIN_OK on success, error code on failure
+    NivePluginError decodeInto(const uint8_t* data, size_t size, const std::string& extension,
+                               NivePixelFormat format, uint8_t* pixels, size_t stride,
+                               uint32_t width, uint32_t height) const;
 
     /// @brief Free decoded image data
     /// @param image Image to free
     void freeImage(NiveDecodedImage& image) const;
 
+    /// @brief Get the threading flags (NIVE_PLUGIN_THREADING_*), 0 before API 1.6
+    [[nodiscard]] uint32_t threading() const noexcept;
+
+    /// @brief Get the most concurrent decoding calls allowed (1 for serial plugins, 0 = no limit)
+    [[nodiscard]] uint32_t maxConcurrency() const noexcept;
+
+    /// @brief Let a per-thread-state plugin release the calling thread's state
+    void detachThread() const;
+
     /// @brief Check if plugin has a settings dialog
     [[nodiscard]] bool hasSettings() const noexcept;
 
@@ -117,8 +178,13 @@ private:
     NivePluginCanDecodeFn can_decode_fn_ = nullptr;
     NivePluginDecodeFn decode_fn_ = nullptr;
     NivePluginFreeImageFn free_image_fn_ = nullptr;
+    NivePluginDecodeExFn decode_ex_fn_ = nullptr;
+    NivePluginGetImageInfoFn get_image_info_fn_ = nullptr;
+    NivePluginDecodeIntoFn decode_into_fn_ = nullptr;
+    NivePluginDecodeHintedFn decode_hinted_fn_ = nullptr;
     NivePluginInitFn init_fn_ = nullptr;
     NivePluginShutdownFn shutdown_fn_ = nullptr;
+    NivePluginThreadDetachFn thread_detach_fn_ = nullptr;
     NivePluginHasSettingsFn has_settings_fn_ = nullptr;
     NivePluginShowSettingsFn show_settings_fn_ = nullptr;
 };
@@ -4,13 +4,73 @@
 #include "plugin_manager.hpp"
 
 #include <algorithm>
+#include <chrono>
 
+#include "../util/logger.hpp"
 #include "../util/string_utils.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/trace.hpp"
 #include "image/decoded_image.hpp"
+#include "image/image_scaler.hpp"
+#include "image/pixel_convert.hpp"
 
 namespace nive::plugin {
 
-PluginManager::PluginManager(const PluginManagerConfig& config) : config_(config) {
+namespace {
+
+/// @brief Map the host's target format to the format plugins are asked for
+[[nodiscard]] NivePixelFormat preferred_format(image::PixelFormat target_format) noexcept {
+    switch (target_format) {
+    case image::PixelFormat::RGBA64:
+        return NIVE_PIXEL_FORMAT_RGBA16;
+    case image::PixelFormat::RGBA16F:
+        return NIVE_PIXEL_FORMAT_RGBA16F;
+    default:
+        return NIVE_PIXEL_FORMAT_RGBA8;
+    }
+}
+
+/// @brief Map plugin header information to the host's, nullopt for empty images
+[[nodiscard]] std::optional<image::ImageInfo> to_image_info(const NiveImageInfo& source) {
+    if (source.width == 0 || source.height == 0) {
+        return std::nullopt;
+    }
+
+    image::ImageInfo info{
+        .width = source.width,
+        .height = source.height,
+        .frame_count = source.frame_count,
+        .has_alpha = source.has_alpha != 0,
+    };
+    switch (source.format) {
+    case NIVE_PIXEL_FORMAT_RGBA8:
+    case NIVE_PIXEL_FORMAT_BGRA8:
+        info.format = image::PixelFormat::BGRA32;
+        break;
+    case NIVE_PIXEL_FORMAT_RGB8:
+        info.format = image::PixelFormat::RGB24;
+        break;
+    case NIVE_PIXEL_FORMAT_GRAY8:
+        info.format = image::PixelFormat::Gray8;
+        break;
+    case NIVE_PIXEL_FORMAT_RGBA16:
+        info.format = image::PixelFormat::RGBA64;
+        info.high_precision = true;
+        break;
+    case NIVE_PIXEL_FORMAT_RGBA16F:
+        info.format = image::PixelFormat::RGBA16F;
+        info.high_precision = true;
+        break;
+    default:
+        break;
+    }
+    return info;
+}
+
+}  // namespace
+
+PluginManager::PluginManager(const PluginManagerConfig& config)
+    : config_(config), snapshot_(std::make_shared<const Snapshot>()) {
 }
 
 PluginManager::~PluginManager() {
@@ -30,29 +90,82 @@ bool PluginManager::initialize() {
         std::filesystem::create_directories(config_.pluginsDirectory, ec);
     }
 
+    // Host processes, when asked for and shipped alongside
+    if (config_.isolate) {
+        if (std::filesystem::exists(config_.host_executable)) {
+            hosts_ = std::make_shared<PluginHostPool>(config_.host_executable,
+                                                      config_.host_processes);
+        } else {
+            LOG_WARN("Plugin host {} not found; plugins decode in-process",
+                     pathToUtf8(config_.host_executable));
+        }
+    }
+
     initialized_ = true;
 
     // Scan for plugins
     scanPlugins();
 
-    // Auto-load if configured
+    // Auto-load if configured; plugins the manifest knows wait for their first use
     if (config_.auto_load) {
+        auto manifest =
+            config_.manifest_path.empty() ? std::vector<ManifestEntry>{}
+                                          : loadManifest(config_.manifest_path);
         for (const auto& path : discovered_) {
-            loadPlugin(path);
+            auto current = statPlugin(path);
+            const ManifestEntry* known = current ? findCurrent(manifest, *current) : nullptr;
+            if (known) {
+                PluginInfo info = known->info;
+                info.loaded = true;
+                add_plugin(std::make_shared<Plugin>(std::move(info)));
+            } else {
+                loadPlugin(path);
+            }
+        }
+        if (!config_.manifest_path.empty()) {
+            save_manifest(manifest);
         }
     }
 
+    for (const auto& name : config_.disabled) {
+        unloadPlugin(name);
+    }
+
     return true;
 }
 
+std::future<bool> PluginManager::initializeAsync(ThreadPool& pool) {
+    pending_.store(true, std::memory_order_release);
+    return pool.submit(
+        [this] {
+            ScopedTrace trace("plugin scan", "startup");
+            auto start = std::chrono::steady_clock::now();
+            bool initialized = initialize();
+            pending_.store(false, std::memory_order_release);
+            pending_.notify_all();
+            LOG_INFO("Plugin manager initialized: {} plugins in {} ms", loadedCount(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+            return initialized;
+        },
+        TaskPriority::Low);
+}
+
 void PluginManager::shutdown() {
+    // A pending initialization would load plugins again after this returned
+    pending_.wait(true, std::memory_order_acquire);
     std::lock_guard lock(mutex_);
 
     // Clear extension map
     extensionMap_.clear();
 
-    // Unload all plugins (destructors will handle shutdown)
+    // End idle hosts; busy ones end with their decode
+    hosts_.reset();
+
+    // Unload all plugins (the last decode still using one unloads it)
     plugins_.clear();
+    publish();
 
     discovered_.clear();
     initialized_ = false;
@@ -88,34 +201,17 @@ bool PluginManager::loadPlugin(const std::filesystem::path& path) {
         return false;
     }
 
-    auto loader = std::make_unique<PluginLoader>(std::move(*result));
-    const NivePluginInfo* info = loader->info();
-
-    if (!info || !info->name) {
+    PluginInfo info = make_plugin_info(*result);
+    if (info.name.empty()) {
         return false;
     }
+    add_plugin(std::make_shared<Plugin>(std::move(info), std::move(*result)));
 
-    std::string name = info->name;
-
-    // Check if already loaded
-    if (plugins_.contains(name)) {
-        // Unload existing first
-        unloadPlugin(name);
+    // The first decode should not wait for a process to start
+    if (hosts_) {
+        hosts_->warm(path);
     }
 
-    // Register extensions
-    if (info->supported_extensions) {
-        for (size_t i = 0; i < info->extension_count; ++i) {
-            if (info->supported_extensions[i]) {
-                std::string ext = info->supported_extensions[i];
-                extensionMap_[ext].push_back(name);
-            }
-        }
-    }
-
-    // Store the loader
-    plugins_[name] = std::move(loader);
-
     return true;
 }
 
@@ -135,8 +231,13 @@ bool PluginManager::unloadPlugin(const std::string& name) {
     // Remove empty extension entries
     std::erase_if(extensionMap_, [](const auto& pair) { return pair.second.empty(); });
 
-    // Unload (destructor handles cleanup)
+    if (hosts_) {
+        hosts_->release(it->second->info.path);
+    }
+
+    // Unload (destructor handles cleanup, after decodes still using it)
     plugins_.erase(it);
+    publish();
 
     return true;
 }
@@ -149,7 +250,7 @@ bool PluginManager::reloadPlugin(const std::string& name) {
         return false;
     }
 
-    auto path = it->second->path();
+    auto path = it->second->info.path;
 
     // Unload
     unloadPlugin(name);
@@ -164,15 +265,15 @@ std::vector<PluginInfo> PluginManager::listPlugins() const {
     std::vector<PluginInfo> result;
 
     // Add loaded plugins
-    for (const auto& [name, loader] : plugins_) {
-        result.push_back(make_plugin_info(*loader));
+    for (const auto& [name, plugin] : plugins_) {
+        result.push_back(plugin->info);
     }
 
     // Add discovered but not loaded plugins
     for (const auto& path : discovered_) {
         bool loaded = false;
-        for (const auto& [name, loader] : plugins_) {
-            if (loader->path() == path) {
+        for (const auto& [name, plugin] : plugins_) {
+            if (plugin->info.path == path) {
                 loaded = true;
                 break;
             }
@@ -194,8 +295,8 @@ std::vector<PluginInfo> PluginManager::loadedPlugins() const {
     std::lock_guard lock(mutex_);
 
     std::vector<PluginInfo> result;
-    for (const auto& [name, loader] : plugins_) {
-        result.push_back(make_plugin_info(*loader));
+    for (const auto& [name, plugin] : plugins_) {
+        result.push_back(plugin->info);
     }
 
     return result;
@@ -219,48 +320,95 @@ std::vector<std::string> PluginManager::findDecoders(const std::string& extensio
 }
 
 std::optional<image::DecodedImage> PluginManager::decode(const uint8_t* data, size_t size,
-                                                         const std::string& extension) const {
-    std::lock_guard lock(mutex_);
+                                                         const std::string& extension,
+                                                         image::PixelFormat target_format) const {
+    auto plugins = snapshot();
+    if (plugins->hosts) {
+        auto result = decodeIsolated(*plugins, data, size, extension, nullptr, target_format);
+        if (!result) {
+            return std::nullopt;
+        }
+        return std::move(result->image);
+    }
 
-    // Find plugins that support this extension (inline to avoid double-lock)
-    std::string ext = extension;
-    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
-        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-    });
+    NivePixelFormat preferred = preferred_format(target_format);
+    for (const Plugin* plugin : candidates(*plugins, extension)) {
+        Plugin::Call call(*plugin);
+        const PluginLoader* loader = call.loader();
+        if (!loader) {
+            continue;
+        }
+        if (auto image = decodeWith(*loader, data, size, extension, preferred, target_format)) {
+            return image;
+        }
+    }
 
-    std::vector<std::string> decoders;
-    auto map_it = extensionMap_.find(ext);
-    if (map_it != extensionMap_.end()) {
-        decoders = map_it->second;
+    return std::nullopt;
+}
+
+std::optional<HintedImage> PluginManager::decodeHinted(const uint8_t* data, size_t size,
+                                                       const std::string& extension,
+                                                       const NiveDecodeHints& hints,
+                                                       image::PixelFormat target_format) const {
+    auto plugins = snapshot();
+    if (plugins->hosts) {
+        return decodeIsolated(*plugins, data, size, extension, &hints, target_format);
     }
 
-    // Try each decoder
-    for (const auto& name : decoders) {
-        auto it = plugins_.find(name);
-        if (it == plugins_.end()) {
+    NivePixelFormat preferred = preferred_format(target_format);
+    for (const Plugin* plugin : candidates(*plugins, extension)) {
+        Plugin::Call call(*plugin);
+        const PluginLoader* loader = call.loader();
+        if (!loader) {
+            continue;
+        }
+        if (!loader->supportsHints()) {
+            // Full decode, through the host buffer route where there is one
+            auto image = decodeWith(*loader, data, size, extension, preferred, target_format);
+            if (image) {
+                uint32_t width = image->width();
+                uint32_t height = image->height();
+                return HintedImage{std::move(*image), {width, height, 0, 0, width, height}};
+            }
             continue;
         }
 
-        auto result = it->second->decode(data, size, extension);
+        auto result = loader->decodeHinted(data, size, extension, preferred, hints);
         if (result) {
-            auto image = convertImage(*result);
-            it->second->freeImage(*result);
+            auto image = convertImage(result->image, target_format);
+            loader->freeImage(result->image);
             if (image) {
-                return image;
+                return HintedImage{std::move(*image), result->info};
             }
         }
     }
 
-    // Try all plugins if extension-based lookup failed
-    for (const auto& [name, loader] : plugins_) {
-        if (loader->canDecode(extension)) {
-            auto result = loader->decode(data, size, extension);
-            if (result) {
-                auto image = convertImage(*result);
-                loader->freeImage(*result);
-                if (image) {
-                    return image;
-                }
+    return std::nullopt;
+}
+
+std::optional<image::ImageInfo> PluginManager::getImageInfo(const uint8_t* data, size_t size,
+                                                            const std::string& extension) const {
+    auto plugins = snapshot();
+    for (const Plugin* plugin : candidates(*plugins, extension)) {
+        // Plugins parse headers in their hosts too, which load DLLs on their own
+        std::expected<NiveImageInfo, NivePluginError> result;
+        if (plugins->hosts) {
+            const PluginLoader* loader = plugin->loaded();
+            if (loader && !loader->supportsImageInfo()) {
+                continue;
+            }
+            result = plugins->hosts->getImageInfo(plugin->info.path, data, size, extension);
+        } else {
+            Plugin::Call call(*plugin);
+            const PluginLoader* loader = call.loader();
+            if (!loader || !loader->supportsImageInfo()) {
+                continue;
+            }
+            result = loader->getImageInfo(data, size, extension);
+        }
+        if (result) {
+            if (auto info = to_image_info(*result)) {
+                return info;
             }
         }
     }
@@ -269,20 +417,21 @@ std::optional<image::DecodedImage> PluginManager::decode(const uint8_t* data, si
 }
 
 bool PluginManager::supportsExtension(const std::string& extension) const {
-    std::lock_guard lock(mutex_);
+    auto plugins = snapshot();
 
     std::string ext = extension;
     std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
         return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
     });
 
-    if (extensionMap_.contains(ext)) {
+    if (plugins->extensions.contains(ext)) {
         return true;
     }
 
-    // Check each plugin
-    for (const auto& [name, loader] : plugins_) {
-        if (loader->canDecode(ext)) {
+    // Check each loaded plugin (can_decode may run alongside the plugin's decodes)
+    for (const auto& plugin : plugins->plugins) {
+        const PluginLoader* loader = plugin->loaded();
+        if (loader && loader->canDecode(ext)) {
             return true;
         }
     }
@@ -290,6 +439,18 @@ bool PluginManager::supportsExtension(const std::string& extension) const {
     return false;
 }
 
+void PluginManager::detachThread() const {
+    auto plugins = snapshot();
+    if (plugins->hosts) {
+        return;  // Decodes ran in the host processes, not on this thread
+    }
+    for (const auto& plugin : plugins->plugins) {
+        if (const PluginLoader* loader = plugin->loaded()) {
+            loader->detachThread();
+        }
+    }
+}
+
 size_t PluginManager::loadedCount() const {
     std::lock_guard lock(mutex_);
     return plugins_.size();
@@ -304,6 +465,136 @@ void PluginManager::set_plugins_directory(const std::filesystem::path& path) {
     }
 }
 
+void PluginManager::publish() {
+    auto next = std::make_shared<Snapshot>();
+    next->hosts = hosts_;
+    for (const auto& [name, plugin] : plugins_) {
+        next->plugins.push_back(plugin);
+    }
+    for (const auto& [ext, names] : extensionMap_) {
+        auto& registered = next->extensions[ext];
+        for (const auto& name : names) {
+            if (auto it = plugins_.find(name); it != plugins_.end()) {
+                registered.push_back(it->second.get());
+            }
+        }
+    }
+
+    snapshot_.store(std::move(next), std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<const PluginManager::Plugin*>
+PluginManager::candidates(const Snapshot& snapshot, const std::string& extension) {
+    std::string ext = extension;
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    // Plugins registered for the extension first, then any other that claims it
+    std::vector<const Plugin*> plugins;
+    if (auto it = snapshot.extensions.find(ext); it != snapshot.extensions.end()) {
+        plugins = it->second;
+    }
+    // Plugins not loaded yet are known only by the extensions they list
+    for (const auto& plugin : snapshot.plugins) {
+        const PluginLoader* loader = plugin->loaded();
+        if (loader && !std::ranges::contains(plugins, plugin.get()) &&
+            loader->canDecode(extension)) {
+            plugins.push_back(plugin.get());
+        }
+    }
+    return plugins;
+}
+
+void PluginManager::add_plugin(std::shared_ptr<Plugin> plugin) {
+    const std::string& name = plugin->info.name;
+
+    // Check if already loaded
+    if (plugins_.contains(name)) {
+        // Unload existing first
+        unloadPlugin(name);
+    }
+
+    // Register extensions
+    for (const auto& ext : plugin->info.extensions) {
+        extensionMap_[ext].push_back(name);
+    }
+
+    // Store the plugin
+    std::string key = name;
+    plugins_[key] = std::move(plugin);
+    publish();
+}
+
+void PluginManager::save_manifest(const std::vector<ManifestEntry>& previous) const {
+    std::vector<ManifestEntry> entries;
+    bool changed = false;
+    for (const auto& [name, plugin] : plugins_) {
+        auto entry = statPlugin(plugin->info.path);
+        if (!entry) {
+            continue;
+        }
+        changed = changed || !findCurrent(previous, *entry);
+        entry->info = plugin->info;
+        entries.push_back(std::move(*entry));
+    }
+    if (!changed && entries.size() == previous.size()) {
+        return;
+    }
+    if (!saveManifest(config_.manifest_path, entries)) {
+        LOG_WARN("Failed to write plugin manifest {}", pathToUtf8(config_.manifest_path));
+    }
+}
+
+PluginManager::Plugin::Plugin(PluginInfo plugin_info, PluginLoader&& loader)
+    : info(std::move(plugin_info)), loader_(std::move(loader)) {
+    loaded_.store(&*loader_, std::memory_order_release);
+}
+
+const PluginLoader* PluginManager::Plugin::get() const {
+    if (const PluginLoader* loader = loaded()) {
+        return loader;
+    }
+    if (failed_) {
+        return nullptr;
+    }
+
+    auto result = PluginLoader::load(info.path);
+    if (!result) {
+        LOG_WARN("Failed to load plugin {}: {}", pathToUtf8(info.path), to_string(result.error()));
+        failed_ = true;
+        return nullptr;
+    }
+    LOG_DEBUG("Loaded plugin {} on first use", info.name);
+    loader_.emplace(std::move(*result));
+    loaded_.store(&*loader_, std::memory_order_release);
+    return &*loader_;
+}
+
+PluginManager::Plugin::Call::Call(const Plugin& plugin) : plugin_(plugin) {
+    std::unique_lock lock(plugin.calls);
+    const PluginLoader* loader = plugin.get();
+    if (!loader) {
+        return;
+    }
+    uint32_t limit = loader->maxConcurrency();
+    plugin.slot_free_.wait(lock, [&] { return limit == 0 || plugin.active_calls_ < limit; });
+    ++plugin.active_calls_;
+    loader_ = loader;
+}
+
+PluginManager::Plugin::Call::~Call() {
+    if (!loader_) {
+        return;
+    }
+    {
+        std::lock_guard lock(plugin_.calls);
+        --plugin_.active_calls_;
+    }
+    plugin_.slot_free_.notify_one();
+}
+
 PluginInfo PluginManager::make_plugin_info(const PluginLoader& loader) const {
     PluginInfo info;
     info.path = loader.path();
@@ -329,47 +620,138 @@ PluginInfo PluginManager::make_plugin_info(const PluginLoader& loader) const {
     return info;
 }
 
-std::optional<image::DecodedImage> PluginManager::convertImage(const NiveDecodedImage& src) const {
+std::optional<image::DecodedImage>
+PluginManager::decodeWith(const PluginLoader& loader, const uint8_t* data, size_t size,
+                          const std::string& extension, NivePixelFormat preferred,
+                          image::PixelFormat target_format) const {
+    auto direct = decodeInto(loader, data, size, extension, target_format);
+    if (direct) {
+        return std::move(*direct);
+    }
+    if (direct.error() != NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT) {
+        return std::nullopt;  // decode() would fail the same way
+    }
+
+    auto result = loader.decode(data, size, extension, preferred);
+    if (!result) {
+        return std::nullopt;
+    }
+    auto image = convertImage(*result, target_format);
+    loader.freeImage(*result);
+    return image;
+}
+
+std::expected<image::DecodedImage, NivePluginError>
+PluginManager::decodeInto(const PluginLoader& loader, const uint8_t* data, size_t size,
+                          const std::string& extension, image::PixelFormat target_format) const {
+    auto info = loader.getImageInfo(data, size, extension);
+    if (!info) {
+        return std::unexpected(info.error());
+    }
+    if (info->width == 0 || info->height == 0) {
+        return std::unexpected(NIVE_PLUGIN_ERROR_INVALID_DATA);
+    }
+
+    // 8-bit sources are written as BGRA; high-precision ones as 16-bit integers,
+    // which every such plugin can produce, and converted below if need be
+    bool high_precision = image::isHighPrecision(target_format) &&
+                          (info->format == NIVE_PIXEL_FORMAT_RGBA16 ||
+                           info->format == NIVE_PIXEL_FORMAT_RGBA16F);
+    NivePixelFormat format = high_precision ? NIVE_PIXEL_FORMAT_RGBA16 : NIVE_PIXEL_FORMAT_BGRA8;
+    image::DecodedImage image(info->width, info->height,
+                              high_precision ? image::PixelFormat::RGBA64
+                                             : image::PixelFormat::BGRA32);
+
+    NivePluginError result = loader.decodeInto(data, size, extension, format, image.data(),
+                                               image.stride(), info->width, info->height);
+    if (result != NIVE_PLUGIN_OK) {
+        return std::unexpected(result);
+    }
+
+    if (image.format() == target_format || !high_precision) {
+        return image;
+    }
+    auto converted = image::convertPixelFormat(image, target_format);
+    if (!converted) {
+        return std::unexpected(NIVE_PLUGIN_ERROR_DECODE_FAILED);
+    }
+    return std::move(*converted);
+}
+
+std::optional<HintedImage>
+PluginManager::decodeIsolated(const Snapshot& snapshot, const uint8_t* data, size_t size,
+                              const std::string& extension, const NiveDecodeHints* hints,
+                              image::PixelFormat target_format) const {
+    // Pixels are converted straight out of the host's output section
+    NivePixelFormat preferred = preferred_format(target_format);
+    for (const Plugin* plugin : candidates(snapshot, extension)) {
+        std::optional<HintedImage> result;
+        auto sink = [&](const NiveDecodedImage& pixels, const NiveDecodeInfo& info) {
+            if (auto image = convertImage(pixels, target_format)) {
+                result = HintedImage{std::move(*image), info};
+            }
+        };
+        snapshot.hosts->decode(plugin->info.path, data, size, extension, preferred, hints, sink);
+        if (result) {
+            return result;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<image::DecodedImage>
+PluginManager::convertImage(const NiveDecodedImage& src, image::PixelFormat target_format) const {
     if (!src.pixels || src.width == 0 || src.height == 0) {
         return std::nullopt;
     }
 
-    // Determine bytes per pixel and target format
-    size_t bytes_per_pixel;
-    image::PixelFormat format;
+    // 8-bit layouts become BGRA32 in the same pass that copies the pixels out
+    image::PixelFormat source_format;
+    image::PixelFormat format = image::PixelFormat::BGRA32;
 
     switch (src.format) {
     case NIVE_PIXEL_FORMAT_RGBA8:
-        bytes_per_pixel = 4;
-        format = image::PixelFormat::BGRA32;  // Convert to Windows-native BGRA
+        source_format = image::PixelFormat::RGBA32;
+        break;
+    case NIVE_PIXEL_FORMAT_BGRA8:
+        source_format = image::PixelFormat::BGRA32;
         break;
     case NIVE_PIXEL_FORMAT_RGB8:
-        bytes_per_pixel = 3;
-        format = image::PixelFormat::RGB24;
+        source_format = image::PixelFormat::RGB24;
         break;
     case NIVE_PIXEL_FORMAT_GRAY8:
-        bytes_per_pixel = 1;
-        format = image::PixelFormat::Gray8;
+        source_format = image::PixelFormat::Gray8;
+        break;
+    case NIVE_PIXEL_FORMAT_RGBA16:
+        source_format = format = image::PixelFormat::RGBA64;
+        break;
+    case NIVE_PIXEL_FORMAT_RGBA16F:
+        source_format = format = image::PixelFormat::RGBA16F;
         break;
     default:
         return std::nullopt;
     }
 
-    // Calculate stride and copy pixels
-    uint32_t stride = src.width * static_cast<uint32_t>(bytes_per_pixel);
-    size_t total_size = stride * src.height;
-
-    std::vector<uint8_t> pixels(total_size);
-    std::memcpy(pixels.data(), src.pixels, total_size);
+    // Plugin rows are tightly packed
+    image::DecodedImage image(src.width, src.height, format);
+    size_t source_stride = static_cast<size_t>(src.width) * image::bytesPerPixel(source_format);
+    if (!image::convertPixels(src.pixels, source_stride, source_format, image.data(),
+                              image.stride(), format, src.width, src.height)) {
+        return std::nullopt;
+    }
 
-    // Convert RGBA → BGRA by swapping R and B channels
-    if (src.format == NIVE_PIXEL_FORMAT_RGBA8) {
-        for (size_t i = 0; i < total_size; i += 4) {
-            std::swap(pixels[i], pixels[i + 2]);
-        }
+    if (!image::isHighPrecision(format) || format == target_format) {
+        return image;
     }
 
-    return image::DecodedImage(src.width, src.height, format, stride, std::move(pixels));
+    // Callers that did not ask for high precision only handle 8-bit output
+    auto converted = image::convertPixelFormat(
+        image, image::isHighPrecision(target_format) ? target_format : image::PixelFormat::BGRA32);
+    if (!converted) {
+        return std::nullopt;
+    }
+    return std::move(*converted);
 }
 
 }  // namespace nive::plugin
@@ -3,15 +3,27 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
 #include <filesystem>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "image/decoded_image.hpp"
+#include "plugin_host.hpp"
 #include "plugin_loader.hpp"
+#include "plugin_manifest.hpp"
+
+namespace nive {
+class ThreadPool;
+}
 
 namespace nive::plugin {
 
@@ -19,22 +31,32 @@ namespace nive::plugin {
 struct PluginManagerConfig {
     std::filesystem::path pluginsDirectory;  // Directory to scan for plugins
     bool auto_load = true;                   // Automatically load plugins on init
+    bool isolate = false;                    // Decode in host processes (see PluginHostPool)
+    std::filesystem::path host_executable;   // nive_plugin_host.exe, required by isolate
+    size_t host_processes = 2;               // Host processes per plugin when isolated
+    std::filesystem::path manifest_path;     // Metadata cache; empty loads every DLL on init
+    std::vector<std::string> disabled;       // Plugin names unloaded again on init
 };
 
-/// @brief Plugin information for external queries
-struct PluginInfo {
-    std::string name;
-    std::string version;
-    std::string author;
-    std::string description;
-    std::filesystem::path path;
-    std::vector<std::string> extensions;
-    bool loaded = false;
-    bool has_settings = false;
+/// @brief Image from PluginManager::decodeHinted
+struct HintedImage {
+    image::DecodedImage image;
+    NiveDecodeInfo info;  // Source size and the region image covers
 };
 
 /// @brief Manages plugin discovery, loading, and lifecycle
 ///
+/// Decoding reads an immutable snapshot of the loaded plugins that load and
+/// unload swap atomically, so decodes never wait on the manager's lock and a
+/// plugin unloaded mid-decode stays loaded until that decode returns. Calls
+/// into one plugin are serialized per plugin (see plugin_api.h).
+///
+/// With config.isolate, plugins still load here for their metadata and
+/// settings dialogs, but decode() and friends run them in host processes:
+/// a plugin that crashes on a file fails that decode instead of the app, and
+/// decodes no longer serialize on the manager's lock. Without the host
+/// executable the manager decodes in-process.
+///
 /// Thread-safe for all public methods.
 class PluginManager {
 public:
@@ -51,10 +73,21 @@ public:
 
     /// @brief Initialize the plugin manager
     ///
-    /// Scans the plugins directory and optionally loads all plugins.
+    /// Scans the plugins directory and optionally loads all plugins. Plugins
+    /// whose DLL is unchanged since the manifest was written are registered
+    /// from it, and their DLL is loaded on the first call that needs it; the
+    /// manifest is rewritten when any entry changed.
     /// @return true on success
     bool initialize();
 
+    /// @brief Run initialize() on a pool thread
+    /// @param pool Pool to run on
+    /// @return Result of initialize()
+    ///
+    /// Decoding calls made meanwhile wait for it to finish, so an image
+    /// that needs a plugin is never routed elsewhere for being early.
+    std::future<bool> initializeAsync(ThreadPool& pool);
+
     /// @brief Shutdown and unload all plugins
     void shutdown();
 
@@ -92,16 +125,63 @@ public:
     /// @param data Image data
     /// @param size Data size in bytes
     /// @param extension File extension hint
+    /// @param target_format RGBA64 or RGBA16F asks plugins for high-precision output
     /// @return Decoded image on success, nullopt on failure
-    [[nodiscard]] std::optional<image::DecodedImage> decode(const uint8_t* data, size_t size,
-                                                            const std::string& extension) const;
+    ///
+    /// High-precision plugin output is converted to target_format, or to
+    /// BGRA32 when an 8-bit format was asked for; 8-bit output (RGBA, RGB,
+    /// gray) always becomes BGRA32.
+    /// Plugins that decode into host buffers (API 1.2) write BGRA32 straight
+    /// into the image, without an intermediate copy or channel swap.
+    [[nodiscard]] std::optional<image::DecodedImage>
+    decode(const uint8_t* data, size_t size, const std::string& extension,
+           image::PixelFormat target_format = image::PixelFormat::BGRA32) const;
+
+    /// @brief Decode image using available plugins, reduced to what the hints ask for
+    /// @param data Image data
+    /// @param size Data size in bytes
+    /// @param extension File extension hint
+    /// @param hints Target size and region; plugins before API 1.3 ignore them
+    /// @param target_format As for decode()
+    /// @return Image with the source size and region it covers, nullopt on failure
+    ///
+    /// The image can be larger than the target size (callers scale it) and
+    /// covers the whole source unless info says otherwise.
+    [[nodiscard]] std::optional<HintedImage>
+    decodeHinted(const uint8_t* data, size_t size, const std::string& extension,
+                 const NiveDecodeHints& hints,
+                 image::PixelFormat target_format = image::PixelFormat::BGRA32) const;
+
+    /// @brief Read image metadata through plugins that parse headers only
+    /// @param data Image data
+    /// @param size Data size in bytes
+    /// @param extension File extension hint
+    /// @return Information from the first plugin that reports it, nullopt when no
+    ///         plugin for the extension exports get_image_info (callers decode instead)
+    ///
+    /// format is the PixelFormat decode() produces (RGBA64 for 16-bit sources).
+    [[nodiscard]] std::optional<image::ImageInfo>
+    getImageInfo(const uint8_t* data, size_t size, const std::string& extension) const;
 
     /// @brief Check if any plugins support the given extension
     [[nodiscard]] bool supportsExtension(const std::string& extension) const;
 
+    /// @brief Let plugins keeping per-thread state release the calling thread's
+    ///
+    /// Decode threads call this before they end (see nive_plugin_thread_detach).
+    void detachThread() const;
+
     /// @brief Get number of loaded plugins
     [[nodiscard]] size_t loadedCount() const;
 
+    /// @brief Get a counter that changes whenever a plugin is loaded or unloaded
+    ///
+    /// Lets callers that cache extension lookups (DecoderRegistry) notice
+    /// without taking the manager's lock.
+    [[nodiscard]] uint64_t generation() const noexcept {
+        return generation_.load(std::memory_order_acquire);
+    }
+
     /// @brief Get plugins directory
     [[nodiscard]] const std::filesystem::path& pluginsDirectory() const noexcept {
         return config_.pluginsDirectory;
@@ -111,18 +191,112 @@ public:
     void set_plugins_directory(const std::filesystem::path& path);
 
 private:
+    /// @brief A registered plugin and the slots its decode functions are called in
+    struct Plugin {
+        /// @brief One call into the plugin's decoding functions
+        ///
+        /// Waits for a slot: serial plugins have one, threaded ones
+        /// (NIVE_PLUGIN_THREADING_*) as many as they allow, so their decodes
+        /// run in parallel instead of queuing on one lock.
+        class Call {
+        public:
+            explicit Call(const Plugin& plugin);
+            ~Call();
+
+            Call(const Call&) = delete;
+            Call& operator=(const Call&) = delete;
+
+            /// @brief Get the loader, nullptr if the DLL fails to load (no slot is held)
+            [[nodiscard]] const PluginLoader* loader() const noexcept { return loader_; }
+
+        private:
+            const Plugin& plugin_;
+            const PluginLoader* loader_ = nullptr;
+        };
+
+        /// @brief Plugin registered from the manifest, loaded by get()
+        explicit Plugin(PluginInfo plugin_info) : info(std::move(plugin_info)) {}
+
+        /// @brief Plugin whose DLL is already loaded
+        Plugin(PluginInfo plugin_info, PluginLoader&& loader);
+
+        /// @brief Get the loader, loading the DLL on first use (calls held)
+        /// @return nullptr if the DLL fails to load (not retried)
+        [[nodiscard]] const PluginLoader* get() const;
+
+        /// @brief Get the loader if the DLL is loaded (any thread)
+        [[nodiscard]] const PluginLoader* loaded() const noexcept {
+            return loaded_.load(std::memory_order_acquire);
+        }
+
+        PluginInfo info;  // From the DLL, or the manifest until it loads
+        mutable std::mutex calls;  // Guards loading and the slot count
+
+    private:
+        mutable std::condition_variable slot_free_;
+        mutable uint32_t active_calls_ = 0;
+        mutable std::optional<PluginLoader> loader_;
+        mutable std::atomic<const PluginLoader*> loaded_{nullptr};
+        mutable bool failed_ = false;
+    };
+
+    /// @brief What the read path sees; replaced, never modified, once published
+    struct Snapshot {
+        std::vector<std::shared_ptr<const Plugin>> plugins;
+        std::unordered_map<std::string, std::vector<const Plugin*>> extensions;
+        std::shared_ptr<PluginHostPool> hosts;
+    };
+
+    /// @brief Get the current snapshot
+    [[nodiscard]] std::shared_ptr<const Snapshot> snapshot() const {
+        pending_.wait(true, std::memory_order_acquire);
+        return snapshot_.load(std::memory_order_acquire);
+    }
+
+    /// @brief Publish a snapshot of plugins_ and extensionMap_ (mutex_ held)
+    void publish();
+
+    /// @brief Register a plugin, replacing one of the same name (mutex_ held)
+    void add_plugin(std::shared_ptr<Plugin> plugin);
+
+    /// @brief Write the manifest from the registered plugins if it differs (mutex_ held)
+    void save_manifest(const std::vector<ManifestEntry>& previous) const;
+
     /// @brief Create PluginInfo from loaded plugin
     [[nodiscard]] PluginInfo make_plugin_info(const PluginLoader& loader) const;
 
+    /// @brief Get the loaded plugins to try for an extension, in order
+    [[nodiscard]] static std::vector<const Plugin*> candidates(const Snapshot& snapshot,
+                                                               const std::string& extension);
+
+    /// @brief Decode with one plugin, into a host buffer when the plugin supports it
+    [[nodiscard]] std::optional<image::DecodedImage>
+    decodeWith(const PluginLoader& loader, const uint8_t* data, size_t size,
+               const std::string& extension, NivePixelFormat preferred,
+               image::PixelFormat target_format) const;
+
+    /// @brief Decode into a DecodedImage allocated here (API 1.2 plugins)
+    /// @return Image, or NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT if the plugin cannot
+    [[nodiscard]] std::expected<image::DecodedImage, NivePluginError>
+    decodeInto(const PluginLoader& loader, const uint8_t* data, size_t size,
+               const std::string& extension, image::PixelFormat target_format) const;
+
+    /// @brief Decode through the snapshot's host pool
+    /// @return nullopt when no host decoded the image
+    [[nodiscard]] std::optional<HintedImage>
+    decodeIsolated(const Snapshot& snapshot, const uint8_t* data, size_t size,
+                   const std::string& extension, const NiveDecodeHints* hints,
+                   image::PixelFormat target_format) const;
+
     /// @brief Convert NiveDecodedImage to DecodedImage
     [[nodiscard]] std::optional<image::DecodedImage>
-    convertImage(const NiveDecodedImage& src) const;
+    convertImage(const NiveDecodedImage& src, image::PixelFormat target_format) const;
 
     PluginManagerConfig config_;
-    mutable std::recursive_mutex mutex_;
+    mutable std::recursive_mutex mutex_;  // Serializes changes; decoding goes by snapshot_
 
     // Loaded plugins indexed by name
-    std::unordered_map<std::string, std::unique_ptr<PluginLoader>> plugins_;
+    std::unordered_map<std::string, std::shared_ptr<Plugin>> plugins_;
 
     // Discovered plugin paths (not yet loaded)
     std::vector<std::filesystem::path> discovered_;
@@ -130,6 +304,12 @@ private:
     // Extension to plugin name mapping for quick lookup
     std::unordered_map<std::string, std::vector<std::string>> extensionMap_;
 
+    // Host processes when isolated; shared so that decodes in flight keep it alive
+    std::shared_ptr<PluginHostPool> hosts_;
+
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<bool> pending_{false};  // initializeAsync() has not finished
     bool initialized_ = false;
 };
 
@@ -0,0 +1,159 @@
+/// @file plugin_manifest.cpp
+/// @brief Plugin metadata cache implementation
+///
+/// One line per plugin, tab-separated: path, write time, size, name, version,
+/// author, description, comma-separated extensions, has_settings. Tabs and
+/// line breaks in plugin strings are stored as spaces.
+
+#include "plugin_manifest.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <string_view>
+
+#include "../util/string_utils.hpp"
+
+namespace nive::plugin {
+
+namespace {
+
+constexpr std::string_view kHeader = "nive-plugin-manifest 1";
+constexpr size_t kFieldCount = 9;
+
+/// @brief Make a string safe to store as one field
+[[nodiscard]] std::string field(std::string_view value) {
+    std::string result(value);
+    for (char& c : result) {
+        if (c == '\t' || c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return result;
+}
+
+/// @brief Split a line at a separator
+[[nodiscard]] std::vector<std::string_view> split(std::string_view line, char separator) {
+    std::vector<std::string_view> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t end = line.find(separator, start);
+        parts.push_back(line.substr(start, end - start));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+template <typename T>
+[[nodiscard]] bool parse_number(std::string_view text, T& value) {
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+}  // namespace
+
+std::optional<ManifestEntry> statPlugin(const std::filesystem::path& path) {
+    std::error_code ec;
+    auto write_time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+
+    ManifestEntry entry;
+    entry.info.path = path;
+    entry.write_time = static_cast<int64_t>(write_time.time_since_epoch().count());
+    entry.file_size = size;
+    return entry;
+}
+
+std::vector<ManifestEntry> loadManifest(const std::filesystem::path& file) {
+    std::ifstream stream(file, std::ios::binary);
+    std::string line;
+    if (!stream || !std::getline(stream, line) || trim(line) != kHeader) {
+        return {};
+    }
+
+    std::vector<ManifestEntry> entries;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        auto fields = split(line, '\t');
+        if (fields.size() != kFieldCount) {
+            continue;
+        }
+
+        ManifestEntry entry;
+        if (!parse_number(fields[1], entry.write_time) ||
+            !parse_number(fields[2], entry.file_size) || fields[3].empty()) {
+            continue;
+        }
+        entry.info.path = utf8ToPath(fields[0]);
+        entry.info.name = fields[3];
+        entry.info.version = fields[4];
+        entry.info.author = fields[5];
+        entry.info.description = fields[6];
+        if (!fields[7].empty()) {
+            for (auto ext : split(fields[7], ',')) {
+                entry.info.extensions.emplace_back(ext);
+            }
+        }
+        entry.info.has_settings = fields[8] == "1";
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+bool saveManifest(const std::filesystem::path& file, const std::vector<ManifestEntry>& entries) {
+    std::error_code ec;
+    std::filesystem::create_directories(file.parent_path(), ec);
+
+    // Written aside and renamed, so a crash never leaves half a manifest
+    auto temp = file;
+    temp += L".tmp";
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            return false;
+        }
+        stream << kHeader << '\n';
+        for (const auto& entry : entries) {
+            std::string extensions;
+            for (const auto& ext : entry.info.extensions) {
+                if (!extensions.empty()) {
+                    extensions += ',';
+                }
+                extensions += field(ext);
+            }
+            stream << field(pathToUtf8(entry.info.path)) << '\t' << entry.write_time << '\t'
+                   << entry.file_size << '\t' << field(entry.info.name) << '\t'
+                   << field(entry.info.version) << '\t' << field(entry.info.author) << '\t'
+                   << field(entry.info.description) << '\t' << extensions << '\t'
+                   << (entry.info.has_settings ? '1' : '0') << '\n';
+        }
+        if (!stream.flush()) {
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp, file, ec);
+    return !ec;
+}
+
+const ManifestEntry* findCurrent(const std::vector<ManifestEntry>& entries,
+                                 const ManifestEntry& current) {
+    for (const auto& entry : entries) {
+        if (entry.info.path == current.info.path && entry.write_time == current.write_time &&
+            entry.file_size == current.file_size) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace nive::plugin
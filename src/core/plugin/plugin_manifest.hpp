@@ -0,0 +1,49 @@
+/// @file plugin_manifest.hpp
+/// @brief On-disk cache of plugin metadata, for registering plugins without loading them
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nive::plugin {
+
+/// @brief Plugin information for external queries
+struct PluginInfo {
+    std::string name;
+    std::string version;
+    std::string author;
+    std::string description;
+    std::filesystem::path path;
+    std::vector<std::string> extensions;
+    bool loaded = false;
+    bool has_settings = false;
+};
+
+/// @brief A plugin as last seen loaded, with the DLL state it was read from
+struct ManifestEntry {
+    PluginInfo info;
+    int64_t write_time = 0;  // DLL last write time (file clock ticks)
+    uint64_t file_size = 0;
+};
+
+/// @brief Describe a plugin DLL's current state
+/// @return Entry with write_time and file_size set, nullopt if the file is missing
+[[nodiscard]] std::optional<ManifestEntry> statPlugin(const std::filesystem::path& path);
+
+/// @brief Read a manifest
+/// @return Entries, empty if the file is missing or from another format version
+[[nodiscard]] std::vector<ManifestEntry> loadManifest(const std::filesystem::path& file);
+
+/// @brief Write a manifest, replacing the file
+/// @return false on I/O failure
+bool saveManifest(const std::filesystem::path& file, const std::vector<ManifestEntry>& entries);
+
+/// @brief Find the entry for a DLL if the DLL has not changed since it was written
+[[nodiscard]] const ManifestEntry* findCurrent(const std::vector<ManifestEntry>& entries,
+                                               const ManifestEntry& current);
+
+}  // namespace nive::plugin
@@ -0,0 +1,67 @@
+/// @file decode_admission.cpp
+/// @brief Byte-weighted decode admission implementation
+
+#include "decode_admission.hpp"
+
+#include <algorithm>
+
+namespace nive::thumbnail {
+
+std::optional<DecodeAdmission::Permit> DecodeAdmission::acquire(uint64_t bytes,
+                                                                std::stop_token stop,
+                                                                bool* waited) {
+    if (waited) {
+        *waited = false;
+    }
+    if (budget_ == 0 || bytes == 0) {
+        return Permit();
+    }
+    bytes = std::min(bytes, budget_);
+
+    std::unique_lock lock(mutex_);
+    if (waiting_.empty() && in_use_ + bytes <= budget_) {
+        in_use_ += bytes;
+        return Permit(this, bytes);
+    }
+
+    if (waited) {
+        *waited = true;
+    }
+    uint64_t ticket = next_ticket_++;
+    waiting_.emplace(ticket, bytes);
+    bool admitted = changed_.wait(lock, stop, [&] { return fits(ticket, bytes); });
+    waiting_.erase(ticket);
+    if (admitted) {
+        in_use_ += bytes;
+    }
+    // The oldest waiter changed, which may let another one in
+    lock.unlock();
+    changed_.notify_all();
+    if (!admitted) {
+        return std::nullopt;
+    }
+    return Permit(this, bytes);
+}
+
+uint64_t DecodeAdmission::inUse() const {
+    std::lock_guard lock(mutex_);
+    return in_use_;
+}
+
+void DecodeAdmission::release(uint64_t bytes) noexcept {
+    {
+        std::lock_guard lock(mutex_);
+        in_use_ -= bytes;
+    }
+    changed_.notify_all();
+}
+
+bool DecodeAdmission::fits(uint64_t ticket, uint64_t bytes) const noexcept {
+    if (in_use_ + bytes > budget_) {
+        return false;
+    }
+    const auto& [oldest, oldest_bytes] = *waiting_.begin();
+    return oldest == ticket || in_use_ + oldest_bytes + bytes <= budget_;
+}
+
+}  // namespace nive::thumbnail
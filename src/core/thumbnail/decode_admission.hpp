@@ -0,0 +1,94 @@
+/// @file decode_admission.hpp
+/// @brief Byte-weighted admission of full-resolution decodes
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <utility>
+
+namespace nive::thumbnail {
+
+/// @brief Semaphore counted in bytes, bounding the decode buffers held at once
+///
+/// Each decode worker acquires what its decode is estimated to allocate
+/// before starting it. Small decodes share the budget freely; one larger
+/// than the whole budget is charged the whole budget, so it runs alone
+/// rather than never. Waiters are served in arrival order, except that a
+/// later one may go ahead while it fits alongside the oldest waiter's
+/// charge: small images keep flowing without starving a huge one.
+class DecodeAdmission {
+public:
+    /// @brief Charge held by one admitted decode, returned on destruction
+    class Permit {
+    public:
+        Permit() = default;
+        ~Permit() { release(); }
+
+        Permit(Permit&& other) noexcept
+            : owner_(std::exchange(other.owner_, nullptr)), bytes_(other.bytes_) {}
+        Permit& operator=(Permit&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner_ = std::exchange(other.owner_, nullptr);
+                bytes_ = other.bytes_;
+            }
+            return *this;
+        }
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+        /// @brief Return the charge before destruction
+        void release() noexcept {
+            if (owner_) {
+                std::exchange(owner_, nullptr)->release(bytes_);
+            }
+        }
+
+    private:
+        friend class DecodeAdmission;
+        Permit(DecodeAdmission* owner, uint64_t bytes) noexcept : owner_(owner), bytes_(bytes) {}
+
+        DecodeAdmission* owner_ = nullptr;
+        uint64_t bytes_ = 0;
+    };
+
+    /// @param budget Bytes admitted at once (0 = unbounded)
+    explicit DecodeAdmission(uint64_t budget) noexcept : budget_(budget) {}
+
+    // Non-copyable, non-movable (permits point back at it)
+    DecodeAdmission(const DecodeAdmission&) = delete;
+    DecodeAdmission& operator=(const DecodeAdmission&) = delete;
+    DecodeAdmission(DecodeAdmission&&) = delete;
+    DecodeAdmission& operator=(DecodeAdmission&&) = delete;
+
+    /// @brief Wait until bytes fit in the budget
+    /// @param waited Set when the call had to wait (may be nullptr)
+    /// @return Permit, or nullopt if stop was requested first
+    [[nodiscard]] std::optional<Permit> acquire(uint64_t bytes, std::stop_token stop,
+                                                bool* waited = nullptr);
+
+    [[nodiscard]] uint64_t budget() const noexcept { return budget_; }
+
+    /// @brief Get bytes charged to running decodes
+    [[nodiscard]] uint64_t inUse() const;
+
+private:
+    void release(uint64_t bytes) noexcept;
+
+    /// @brief Check if a waiter may take bytes now (lock held)
+    [[nodiscard]] bool fits(uint64_t ticket, uint64_t bytes) const noexcept;
+
+    const uint64_t budget_;
+    mutable std::mutex mutex_;
+    std::condition_variable_any changed_;
+    uint64_t in_use_ = 0;
+    uint64_t next_ticket_ = 0;
+    std::map<uint64_t, uint64_t> waiting_;  // Ticket (arrival order) -> bytes
+};
+
+}  // namespace nive::thumbnail
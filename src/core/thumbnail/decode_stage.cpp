@@ -0,0 +1,139 @@
+/// @file decode_stage.cpp
+/// @brief Work-stealing decode stage implementation
+
+#include "decode_stage.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+namespace nive::thumbnail {
+
+DecodeStage::DecodeStage(size_t worker_count, size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+    worker_count = std::max<size_t>(worker_count, 1);
+    active_lanes_.store(worker_count);
+    lanes_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        lanes_.push_back(std::make_unique<Lane>());
+    }
+}
+
+bool DecodeStage::push(PreparedRequest prepared) {
+    {
+        std::unique_lock lock(wait_mutex_);
+        space_cv_.wait(lock, [this] { return stopped_ || size_.load() < capacity_; });
+        if (stopped_) {
+            return false;
+        }
+        size_.fetch_add(1);
+    }
+
+    size_t lane_count = active_lanes_.load(std::memory_order_relaxed);
+    auto& lane = *lanes_[next_lane_.fetch_add(1, std::memory_order_relaxed) % lane_count];
+    {
+        std::lock_guard lock(lane.mutex);
+        lane.items.push_back(std::move(prepared));
+    }
+
+    {
+        std::lock_guard lock(wait_mutex_);
+        ++ready_;
+    }
+    items_cv_.notify_one();
+    return true;
+}
+
+std::optional<PreparedRequest> DecodeStage::pop(size_t worker) {
+    {
+        std::unique_lock lock(wait_mutex_);
+        items_cv_.wait(lock, [this] { return stopped_ || ready_ > 0; });
+        if (stopped_) {
+            return std::nullopt;
+        }
+        // Claim one item; it is on some lane, though another worker may take
+        // the one found first
+        --ready_;
+    }
+
+    std::optional<PreparedRequest> prepared;
+    while (!(prepared = takeOwn(worker)) && !(prepared = steal(worker))) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard lock(wait_mutex_);
+        size_.fetch_sub(1);
+    }
+    space_cv_.notify_one();
+    return prepared;
+}
+
+void DecodeStage::stop() {
+    {
+        std::lock_guard lock(wait_mutex_);
+        stopped_ = true;
+    }
+    items_cv_.notify_all();
+    space_cv_.notify_all();
+}
+
+void DecodeStage::restart() {
+    std::lock_guard lock(wait_mutex_);
+    stopped_ = false;
+}
+
+void DecodeStage::setActiveLanes(size_t count) {
+    active_lanes_.store(std::clamp<size_t>(count, 1, lanes_.size()), std::memory_order_relaxed);
+}
+
+std::vector<PreparedRequest> DecodeStage::drain() {
+    std::vector<PreparedRequest> remaining;
+    std::lock_guard lock(wait_mutex_);
+    for (auto& lane : lanes_) {
+        std::lock_guard lane_lock(lane->mutex);
+        std::move(lane->items.begin(), lane->items.end(), std::back_inserter(remaining));
+        lane->items.clear();
+    }
+    ready_ = 0;
+    size_.store(0);
+    return remaining;
+}
+
+size_t DecodeStage::size() const noexcept {
+    return size_.load(std::memory_order_relaxed);
+}
+
+uint64_t DecodeStage::stolenCount() const noexcept {
+    return stolen_.load(std::memory_order_relaxed);
+}
+
+std::optional<PreparedRequest> DecodeStage::takeOwn(size_t worker) {
+    auto& lane = *lanes_[worker % lanes_.size()];
+    std::lock_guard lock(lane.mutex);
+    if (lane.items.empty()) {
+        return std::nullopt;
+    }
+    PreparedRequest prepared = std::move(lane.items.front());
+    lane.items.pop_front();
+    return prepared;
+}
+
+std::optional<PreparedRequest> DecodeStage::steal(size_t worker) {
+    // Start after our own lane so thieves spread over the victims
+    for (size_t offset = 1; offset < lanes_.size(); ++offset) {
+        auto& lane = *lanes_[(worker + offset) % lanes_.size()];
+        std::lock_guard lock(lane.mutex);
+        if (lane.items.empty()) {
+            continue;
+        }
+        // The back is the entry its owner would reach last
+        PreparedRequest prepared = std::move(lane.items.back());
+        lane.items.pop_back();
+        stolen_.fetch_add(1, std::memory_order_relaxed);
+        return prepared;
+    }
+    return std::nullopt;
+}
+
+}  // namespace nive::thumbnail
@@ -0,0 +1,121 @@
+/// @file decode_stage.hpp
+/// @brief Work-stealing hand-off between the thumbnail I/O and decode stages
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "../util/mapped_file.hpp"
+#include "thumbnail_request.hpp"
+
+namespace nive::thumbnail {
+
+/// @brief Image shown in one tile of a folder mosaic
+struct FolderImage {
+    std::filesystem::path path;
+    cache::SourceStamp stamp;  // From the directory listing; keys its cached thumbnail
+};
+
+/// @brief A request whose I/O is done, waiting for a decode worker
+struct PreparedRequest {
+    ThumbnailRequest request;
+    MappedFile file_data;      // Prefetched mapping of a plain file (empty: decode by path)
+    std::string content_hash;  // Fingerprint when deduplication is enabled
+    std::vector<FolderImage> folder_images;  // Tiles of a folder mosaic, in name order
+    std::chrono::steady_clock::time_point start_time;  // When the I/O stage took the request
+};
+
+/// @brief Bounded set of per-worker deques with work stealing
+///
+/// The I/O stage pushes prepared requests round-robin onto the decode
+/// workers' deques. A worker takes from the front of its own deque and, when
+/// that is empty, steals from the back of another's, so one worker stuck on
+/// a huge image does not hold up the requests queued behind it.
+///
+/// push() blocks while the stage holds its capacity, which bounds how far
+/// the I/O stage reads ahead of decoding.
+class DecodeStage {
+public:
+    /// @brief Create the stage
+    /// @param worker_count Number of decode workers (one deque each)
+    /// @param capacity Maximum prepared requests held at once
+    DecodeStage(size_t worker_count, size_t capacity);
+    ~DecodeStage() = default;
+
+    // Non-copyable, non-movable
+    DecodeStage(const DecodeStage&) = delete;
+    DecodeStage& operator=(const DecodeStage&) = delete;
+    DecodeStage(DecodeStage&&) = delete;
+    DecodeStage& operator=(DecodeStage&&) = delete;
+
+    /// @brief Hand a prepared request to the decode workers
+    /// @param prepared Request with its prefetched data
+    /// @return false if the stage was stopped (the request is dropped)
+    ///
+    /// Blocks while the stage is full.
+    bool push(PreparedRequest prepared);
+
+    /// @brief Take the next request for a worker
+    /// @param worker Index of the calling worker
+    /// @return Request, or nullopt once the stage is stopped
+    ///
+    /// Blocks until a request is available on any deque.
+    [[nodiscard]] std::optional<PreparedRequest> pop(size_t worker);
+
+    /// @brief Unblock all waiting threads; push() and pop() fail from now on
+    void stop();
+
+    /// @brief Accept requests again after stop()
+    void restart();
+
+    /// @brief Limit push() to the lanes of the first count workers
+    /// @param count Workers currently taking requests (others are parked)
+    ///
+    /// Requests already on other lanes are still reached by stealing.
+    void setActiveLanes(size_t count);
+
+    /// @brief Remove and return everything still held (after stop())
+    [[nodiscard]] std::vector<PreparedRequest> drain();
+
+    /// @brief Get number of prepared requests waiting for a decode worker
+    [[nodiscard]] size_t size() const noexcept;
+
+    /// @brief Get number of requests taken from another worker's deque
+    [[nodiscard]] uint64_t stolenCount() const noexcept;
+
+private:
+    struct Lane {
+        std::mutex mutex;
+        std::deque<PreparedRequest> items;
+    };
+
+    [[nodiscard]] std::optional<PreparedRequest> takeOwn(size_t worker);
+    [[nodiscard]] std::optional<PreparedRequest> steal(size_t worker);
+
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    size_t capacity_;
+
+    // Guards sleeping and waking only; lanes have their own locks
+    std::mutex wait_mutex_;
+    std::condition_variable items_cv_;
+    std::condition_variable space_cv_;
+    size_t ready_ = 0;             // Items on lanes not yet claimed by pop()
+    std::atomic<size_t> size_{0};  // Items held, including slots reserved by push()
+    std::atomic<size_t> next_lane_{0};
+    std::atomic<size_t> active_lanes_{1};
+    std::atomic<uint64_t> stolen_{0};
+    bool stopped_ = false;
+};
+
+}  // namespace nive::thumbnail
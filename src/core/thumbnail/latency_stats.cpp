@@ -0,0 +1,259 @@
+/// @file latency_stats.cpp
+/// @brief Latency histogram implementation
+
+#include "latency_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <string_view>
+
+#include "../util/string_utils.hpp"
+
+namespace nive::thumbnail {
+
+namespace {
+
+[[nodiscard]] size_t bucket_for(uint64_t us) noexcept {
+    constexpr size_t kSub = LatencyHistogram::kSubBuckets;
+    if (us < kSub) {
+        return static_cast<size_t>(us);
+    }
+    // Octave from the top bit, sub-bucket from the two bits below it
+    auto octave = static_cast<size_t>(std::bit_width(us) - 1);
+    auto sub = static_cast<size_t>(us >> (octave - 2)) & (kSub - 1);
+    return std::min(kSub + (octave - 2) * kSub + sub, LatencyHistogram::kBucketCount - 1);
+}
+
+/// @brief Midpoint of a bucket's range in microseconds
+[[nodiscard]] double bucket_value(size_t bucket) noexcept {
+    constexpr size_t kSub = LatencyHistogram::kSubBuckets;
+    if (bucket < kSub) {
+        return static_cast<double>(bucket);
+    }
+    size_t octave = (bucket - kSub) / kSub + 2;
+    size_t sub = (bucket - kSub) % kSub;
+    double lower = static_cast<double>((kSub + sub) << (octave - 2));
+    double width = static_cast<double>(uint64_t{1} << (octave - 2));
+    return lower + width / 2.0;
+}
+
+[[nodiscard]] size_t kind_slot(Stage stage, SourceKind kind) noexcept {
+    return static_cast<size_t>(stage) * kSourceKindCount + static_cast<size_t>(kind);
+}
+
+[[nodiscard]] size_t format_slot(Stage stage, SourceFormat format) noexcept {
+    return static_cast<size_t>(stage) * kSourceFormatCount + static_cast<size_t>(format);
+}
+
+void append_row(std::string& out, Stage stage, std::string_view group,
+                const LatencySummary& summary) {
+    if (summary.count == 0) {
+        return;
+    }
+    out += std::format("{:<12} {:<8} {:>8} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}\n",
+                       to_string(stage), group, summary.count, summary.mean_ms, summary.p50_ms,
+                       summary.p95_ms, summary.p99_ms, summary.max_ms);
+}
+
+}  // namespace
+
+const char* to_string(Stage stage) noexcept {
+    switch (stage) {
+    case Stage::CacheLookup:
+        return "cache_get";
+    case Stage::Read:
+        return "read";
+    case Stage::Decode:
+        return "decode";
+    case Stage::Scale:
+        return "scale";
+    case Stage::CacheWrite:
+        return "cache_put";
+    case Stage::Total:
+        return "total";
+    case Stage::Preview:
+        return "preview";
+    }
+    return "unknown";
+}
+
+const char* to_string(SourceKind kind) noexcept {
+    switch (kind) {
+    case SourceKind::File:
+        return "file";
+    case SourceKind::Memory:
+        return "memory";
+    case SourceKind::Archive:
+        return "archive";
+    }
+    return "unknown";
+}
+
+const char* to_string(SourceFormat format) noexcept {
+    switch (format) {
+    case SourceFormat::Jpeg:
+        return "jpeg";
+    case SourceFormat::Png:
+        return "png";
+    case SourceFormat::Gif:
+        return "gif";
+    case SourceFormat::Bmp:
+        return "bmp";
+    case SourceFormat::Tiff:
+        return "tiff";
+    case SourceFormat::Webp:
+        return "webp";
+    case SourceFormat::Heif:
+        return "heif";
+    case SourceFormat::Other:
+        return "other";
+    }
+    return "unknown";
+}
+
+SourceFormat formatFromPath(const std::filesystem::path& path) {
+    std::wstring ext = toLowercaseAscii(path.extension().wstring());
+    if (ext == L".jpg" || ext == L".jpeg") {
+        return SourceFormat::Jpeg;
+    }
+    if (ext == L".png") {
+        return SourceFormat::Png;
+    }
+    if (ext == L".gif") {
+        return SourceFormat::Gif;
+    }
+    if (ext == L".bmp") {
+        return SourceFormat::Bmp;
+    }
+    if (ext == L".tif" || ext == L".tiff") {
+        return SourceFormat::Tiff;
+    }
+    if (ext == L".webp") {
+        return SourceFormat::Webp;
+    }
+    if (ext == L".heic" || ext == L".heif" || ext == L".avif") {
+        return SourceFormat::Heif;
+    }
+    return SourceFormat::Other;
+}
+
+LatencyHistogram::Snapshot& LatencyHistogram::Snapshot::operator+=(
+    const Snapshot& other) noexcept {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    sum_us += other.sum_us;
+    max_us = std::max(max_us, other.max_us);
+    return *this;
+}
+
+LatencySummary LatencyHistogram::Snapshot::summary() const noexcept {
+    LatencySummary result;
+    for (auto count : buckets) {
+        result.count += count;
+    }
+    if (result.count == 0) {
+        return result;
+    }
+
+    // Rank of each percentile (1-based), found in one pass over the buckets
+    auto rank = [count = result.count](double p) {
+        return std::max<uint64_t>(static_cast<uint64_t>(p * static_cast<double>(count) + 0.5), 1);
+    };
+    const uint64_t ranks[] = {rank(0.50), rank(0.95), rank(0.99)};
+    double* targets[] = {&result.p50_ms, &result.p95_ms, &result.p99_ms};
+    double max_value = static_cast<double>(max_us);
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t bucket = 0; bucket < kBucketCount && next < 3; ++bucket) {
+        seen += buckets[bucket];
+        while (next < 3 && seen >= ranks[next]) {
+            *targets[next] = std::min(bucket_value(bucket), max_value) / 1000.0;
+            ++next;
+        }
+    }
+
+    result.mean_ms = static_cast<double>(sum_us) / static_cast<double>(result.count) / 1000.0;
+    result.max_ms = max_value / 1000.0;
+    return result;
+}
+
+void LatencyHistogram::record(uint64_t us) noexcept {
+    buckets_[bucket_for(us)].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const noexcept {
+    Snapshot result;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    result.sum_us = sum_us_.load(std::memory_order_relaxed);
+    result.max_us = max_us_.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum_us_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+}
+
+void StageLatencies::record(Stage stage, SourceKind kind, SourceFormat format,
+                            uint64_t us) noexcept {
+    by_kind_[kind_slot(stage, kind)].record(us);
+    by_format_[format_slot(stage, format)].record(us);
+}
+
+LatencySummary StageLatencies::summary(Stage stage) const noexcept {
+    LatencyHistogram::Snapshot merged;
+    for (size_t kind = 0; kind < kSourceKindCount; ++kind) {
+        merged += by_kind_[kind_slot(stage, static_cast<SourceKind>(kind))].snapshot();
+    }
+    return merged.summary();
+}
+
+LatencySummary StageLatencies::summary(Stage stage, SourceKind kind) const noexcept {
+    return by_kind_[kind_slot(stage, kind)].snapshot().summary();
+}
+
+LatencySummary StageLatencies::summary(Stage stage, SourceFormat format) const noexcept {
+    return by_format_[format_slot(stage, format)].snapshot().summary();
+}
+
+void StageLatencies::reset() noexcept {
+    for (auto& histogram : by_kind_) {
+        histogram.reset();
+    }
+    for (auto& histogram : by_format_) {
+        histogram.reset();
+    }
+}
+
+std::string StageLatencies::report() const {
+    std::string out = std::format("{:<12} {:<8} {:>8} {:>9} {:>9} {:>9} {:>9} {:>9}\n", "stage",
+                                  "source", "count", "mean_ms", "p50_ms", "p95_ms", "p99_ms",
+                                  "max_ms");
+    for (size_t i = 0; i < kStageCount; ++i) {
+        auto stage = static_cast<Stage>(i);
+        append_row(out, stage, "all", summary(stage));
+        for (size_t kind = 0; kind < kSourceKindCount; ++kind) {
+            auto source = static_cast<SourceKind>(kind);
+            append_row(out, stage, to_string(source), summary(stage, source));
+        }
+        for (size_t format = 0; format < kSourceFormatCount; ++format) {
+            auto source = static_cast<SourceFormat>(format);
+            append_row(out, stage, to_string(source), summary(stage, source));
+        }
+    }
+    return out;
+}
+
+}  // namespace nive::thumbnail
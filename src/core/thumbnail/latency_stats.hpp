@@ -0,0 +1,133 @@
+/// @file latency_stats.hpp
+/// @brief Lock-free per-stage latency histograms for thumbnail generation
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace nive::thumbnail {
+
+/// @brief Pipeline stage a latency sample belongs to
+enum class Stage : uint8_t {
+    CacheLookup,  // Cache get, plus content fingerprint and lookup when deduplicating
+    Read,         // File read ahead of decoding, or archive extraction
+    Decode,       // Plugin or WIC decode (WIC scales to size while decoding)
+    Scale,        // Thumbnail scaling of plugin results
+    CacheWrite,   // Compression and hand-off to the cache writer
+    Total,        // Taken by the I/O stage until the callback
+    Preview,      // Progressive first pass, embedded thumbnail or reduced decode
+};
+inline constexpr size_t kStageCount = 7;
+
+/// @brief Where a request's bytes come from
+enum class SourceKind : uint8_t {
+    File,
+    Memory,
+    Archive,
+};
+inline constexpr size_t kSourceKindCount = 3;
+
+/// @brief Image format, judged by extension
+enum class SourceFormat : uint8_t {
+    Jpeg,
+    Png,
+    Gif,
+    Bmp,
+    Tiff,
+    Webp,
+    Heif,  // HEIC, HEIF and AVIF
+    Other,
+};
+inline constexpr size_t kSourceFormatCount = 8;
+
+[[nodiscard]] const char* to_string(Stage stage) noexcept;
+[[nodiscard]] const char* to_string(SourceKind kind) noexcept;
+[[nodiscard]] const char* to_string(SourceFormat format) noexcept;
+
+/// @brief Classify a source path by its extension
+[[nodiscard]] SourceFormat formatFromPath(const std::filesystem::path& path);
+
+/// @brief Percentiles of a set of latency samples
+struct LatencySummary {
+    uint64_t count = 0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+/// @brief Log-linear latency histogram with relaxed atomic counters
+///
+/// Microsecond samples fall into four buckets per power of two, so a
+/// percentile is within about 12% of the true value. Recording is a few
+/// relaxed atomic adds; readers may see a sample half recorded, which is
+/// harmless for monitoring.
+class LatencyHistogram {
+public:
+    // Values 0-3 exactly, then four buckets per octave up to 2^32 us (~70 minutes)
+    static constexpr size_t kSubBuckets = 4;
+    static constexpr size_t kBucketCount = kSubBuckets + 30 * kSubBuckets;
+
+    /// @brief Bucket counts copied out of a histogram, which can be merged
+    struct Snapshot {
+        std::array<uint64_t, kBucketCount> buckets{};
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+
+        Snapshot& operator+=(const Snapshot& other) noexcept;
+
+        /// @brief Compute count, mean and percentiles
+        [[nodiscard]] LatencySummary summary() const noexcept;
+    };
+
+    /// @brief Add a sample
+    /// @param us Latency in microseconds
+    void record(uint64_t us) noexcept;
+
+    /// @brief Copy the current counts
+    [[nodiscard]] Snapshot snapshot() const noexcept;
+
+    /// @brief Discard all samples
+    void reset() noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+/// @brief Histograms for every stage, broken down by source kind and by format
+///
+/// Each sample is recorded twice, once under its source kind and once under
+/// its format, rather than in a full stage x kind x format grid.
+class StageLatencies {
+public:
+    /// @brief Add a sample
+    void record(Stage stage, SourceKind kind, SourceFormat format, uint64_t us) noexcept;
+
+    /// @brief Summary of a stage over all sources
+    [[nodiscard]] LatencySummary summary(Stage stage) const noexcept;
+
+    /// @brief Summary of a stage for one source kind
+    [[nodiscard]] LatencySummary summary(Stage stage, SourceKind kind) const noexcept;
+
+    /// @brief Summary of a stage for one format
+    [[nodiscard]] LatencySummary summary(Stage stage, SourceFormat format) const noexcept;
+
+    /// @brief Discard all samples
+    void reset() noexcept;
+
+    /// @brief Format every non-empty histogram as a text table (one row per line)
+    [[nodiscard]] std::string report() const;
+
+private:
+    std::array<LatencyHistogram, kStageCount * kSourceKindCount> by_kind_;
+    std::array<LatencyHistogram, kStageCount * kSourceFormatCount> by_format_;
+};
+
+}  // namespace nive::thumbnail
@@ -0,0 +1,308 @@
+/// @file pregenerator.cpp
+/// @brief Idle-time thumbnail pre-generation implementation
+
+#include "pregenerator.hpp"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "../archive/archive_manager.hpp"
+#include "../cache/cache_manager.hpp"
+#include "../util/logger.hpp"
+#include "../util/string_utils.hpp"
+#include "thumbnail_generator.hpp"
+
+namespace nive::thumbnail {
+
+Pregenerator::Pregenerator(ThumbnailGenerator& generator, const PregeneratorConfig& config)
+    : generator_(generator), config_(config), outstanding_(std::make_shared<Outstanding>()) {
+    config_.max_outstanding = std::max<size_t>(config_.max_outstanding, 1);
+}
+
+Pregenerator::~Pregenerator() {
+    stop();
+}
+
+void Pregenerator::start(const std::filesystem::path& root, uint32_t size) {
+    stop();
+
+    outstanding_ = std::make_shared<Outstanding>();
+    submitted_.store(0);
+    completed_.store(0);
+    failed_.store(0);
+    skipped_.store(0);
+    running_.store(true);
+    thread_ = std::jthread([this, root, size](std::stop_token stop_token) {
+        crawl(stop_token, root, size);
+    });
+}
+
+void Pregenerator::stop() {
+    if (thread_.joinable()) {
+        thread_.request_stop();
+        thread_.join();
+    }
+    cancelOutstanding();
+    running_.store(false);
+}
+
+bool Pregenerator::isRunning() const noexcept {
+    return running_.load();
+}
+
+void Pregenerator::setPaused(bool paused) {
+    auto outstanding = outstanding_;
+    {
+        std::lock_guard lock(outstanding->mutex);
+        paused_.store(paused);
+    }
+    outstanding->cv.notify_all();
+}
+
+uint64_t Pregenerator::submittedCount() const noexcept {
+    return submitted_.load(std::memory_order_relaxed);
+}
+
+uint64_t Pregenerator::completedCount() const noexcept {
+    return completed_.load(std::memory_order_relaxed);
+}
+
+uint64_t Pregenerator::failedCount() const noexcept {
+    return failed_.load(std::memory_order_relaxed);
+}
+
+uint64_t Pregenerator::skippedCount() const noexcept {
+    return skipped_.load(std::memory_order_relaxed);
+}
+
+size_t Pregenerator::outstandingCount() const {
+    auto outstanding = outstanding_;
+    std::lock_guard lock(outstanding->mutex);
+    return outstanding->requests.size();
+}
+
+void Pregenerator::setCacheManager(cache::CacheManager* cache) noexcept {
+    cache_ = cache;
+}
+
+void Pregenerator::setArchiveManager(archive::ArchiveManager* archives) noexcept {
+    archives_ = archives;
+}
+
+void Pregenerator::crawl(std::stop_token stop_token, std::filesystem::path root, uint32_t size) {
+    // Lowers this thread's CPU and I/O priority for the directory scans
+    bool background = config_.yield_to_foreground &&
+                      SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    bool archives = config_.include_archives && archives_ && archives_->isAvailable();
+
+    fs::DirectoryFilter filter;
+    filter.include_hidden = config_.include_hidden;
+
+    // Breadth first, so the current listing finishes before any subfolder
+    std::deque<std::pair<std::filesystem::path, uint32_t>> directories;
+    directories.emplace_back(std::move(root), 0);
+    size_t visited = 0;
+
+    while (!directories.empty() && !stop_token.stop_requested()) {
+        auto [directory, depth] = std::move(directories.front());
+        directories.pop_front();
+        if (!waitForTurn(stop_token)) {
+            break;  // Scans wait too, so a paused crawl does no I/O at all
+        }
+
+        auto listing = fs::scanDirectory(directory, filter, config_.sort_order, stop_token);
+        if (!listing) {
+            if (listing.error() != fs::DirectoryError::Cancelled) {
+                LOG_DEBUG("Pre-generation: skipping {}: {}", pathToUtf8(directory),
+                          fs::to_string(listing.error()));
+            }
+            continue;
+        }
+        ++visited;
+
+        for (const auto& entry : listing->entries) {
+            if (entry.is_directory()) {
+                if (depth < config_.max_depth) {
+                    directories.emplace_back(entry.path, depth + 1);
+                }
+                continue;
+            }
+            if (archives && entry.is_archive()) {
+                // Its entries first; the archive itself is then shown by its cover
+                submitArchive(stop_token, entry.path, size);
+            } else if (!entry.is_image()) {
+                continue;
+            }
+            if (!waitForTurn(stop_token)) {
+                break;
+            }
+            submit(entry, size);
+        }
+    }
+
+    LOG_INFO("Pre-generation {}: {} requests in {} directories",
+             stop_token.stop_requested() ? "stopped" : "finished", submitted_.load(), visited);
+
+    if (background) {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    }
+    running_.store(false);
+}
+
+bool Pregenerator::waitForTurn(std::stop_token stop_token) {
+    auto ready = [this] {
+        if (paused_.load()) {
+            return false;
+        }
+        if (!config_.yield_to_foreground) {
+            return outstanding_->requests.size() < config_.max_outstanding &&
+                   !generator_.isSaturated();
+        }
+        return generator_.urgentCount() == 0 &&
+               generator_.backgroundCount() < config_.max_outstanding;
+    };
+
+    // Completions wake the wait early; new foreground requests are seen on
+    // the next poll
+    std::unique_lock lock(outstanding_->mutex);
+    while (!stop_token.stop_requested()) {
+        if (outstanding_->cv.wait_for(lock, stop_token, config_.poll_interval, ready)) {
+            return !stop_token.stop_requested();
+        }
+    }
+    return false;
+}
+
+void Pregenerator::submit(const fs::FileMetadata& file, uint32_t size) {
+    cache::SourceStamp stamp{.mtime = file.modified_time, .size_bytes = file.size_bytes};
+    if (cache_ && cache_->hasThumbnail(file.path, stamp)) {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    track(file.path.wstring(), [&](ThumbnailCallback callback) {
+        return generator_.request(file, std::move(callback), priority(), size);
+    });
+}
+
+void Pregenerator::submitArchive(std::stop_token stop_token,
+                                 const std::filesystem::path& archive_path, uint32_t size) {
+    auto entries = archives_->getImageEntries(archive_path);
+    if (!entries) {
+        LOG_DEBUG("Pre-generation: skipping archive {}: {}", pathToUtf8(archive_path),
+                  archive::to_string(entries.error()));
+        return;
+    }
+
+    // Entries are stamped with their archive, so one stat covers them all
+    auto stamp = cache::statSource(archive_path);
+    std::vector<std::wstring> to_extract;
+    for (const auto& entry : *entries) {
+        if (entry.is_encrypted) {
+            continue;
+        }
+        archive::VirtualPath vpath(archive_path, entry.path);
+        if (cache_ && cache_->hasThumbnail(vpath.to_string(), stamp)) {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            to_extract.push_back(entry.path);
+        }
+    }
+    if (to_extract.empty()) {
+        return;
+    }
+
+    // Solid archives would decompress their block again for every entry;
+    // one sequential pass hands each entry over as it comes out
+    if (archives_->isSolid(archive_path)) {
+        auto result = archives_->extractBatch(
+            archive_path, to_extract,
+            [&](const std::wstring& entry_path, std::vector<uint8_t> data) {
+                if (!waitForTurn(stop_token)) {
+                    return false;
+                }
+                archive::VirtualPath vpath(archive_path, entry_path);
+                track(vpath.to_string(), [&](ThumbnailCallback callback) {
+                    return generator_.requestFromArchive(vpath, std::move(data),
+                                                         std::move(callback), priority(), size,
+                                                         stamp);
+                });
+                return true;
+            });
+        if (!result && result.error() != archive::ArchiveError::Cancelled) {
+            LOG_DEBUG("Pre-generation: batch extraction failed for {}: {}",
+                      pathToUtf8(archive_path), archive::to_string(result.error()));
+        }
+        return;
+    }
+
+    for (const auto& entry_path : to_extract) {
+        if (!waitForTurn(stop_token)) {
+            return;
+        }
+        archive::VirtualPath vpath(archive_path, entry_path);
+        track(vpath.to_string(), [&](ThumbnailCallback callback) {
+            return generator_.requestFromArchive(vpath, std::move(callback), priority(), size,
+                                                 kNoViewIndex, stamp);
+        });
+    }
+}
+
+void Pregenerator::track(const std::wstring& key,
+                         const std::function<RequestId(ThumbnailCallback)>& issue) {
+    auto outstanding = outstanding_;
+
+    // Register before submitting: the callback may run before request() returns
+    {
+        std::lock_guard lock(outstanding->mutex);
+        outstanding->requests.emplace(key, 0);
+    }
+
+    // Results only warm the cache; the view requests what it shows itself
+    auto id = issue([this, outstanding, key](ThumbnailResult result) {
+        if (result.preview) {
+            return;  // The refined pass follows
+        }
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        if (!result.success()) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard lock(outstanding->mutex);
+            outstanding->requests.erase(key);
+        }
+        outstanding->cv.notify_one();
+    });
+
+    {
+        std::lock_guard lock(outstanding->mutex);
+        if (auto it = outstanding->requests.find(key); it != outstanding->requests.end()) {
+            it->second = id;
+        }
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Pregenerator::cancelOutstanding() {
+    std::vector<RequestId> ids;
+    {
+        std::lock_guard lock(outstanding_->mutex);
+        for (const auto& [path, id] : outstanding_->requests) {
+            if (id != 0) {
+                ids.push_back(id);
+            }
+        }
+        outstanding_->requests.clear();
+    }
+
+    // Detaches only this crawl's callbacks; a visible request coalesced
+    // with one of them still gets its result
+    for (auto id : ids) {
+        (void)generator_.cancel(id);
+    }
+}
+
+}  // namespace nive::thumbnail
@@ -0,0 +1,169 @@
+/// @file pregenerator.hpp
+/// @brief Idle-time thumbnail pre-generation for a whole directory tree
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+
+#include "../fs/directory.hpp"
+#include "thumbnail_request.hpp"
+
+namespace nive::archive {
+class ArchiveManager;
+}
+
+namespace nive::cache {
+class CacheManager;
+}
+
+namespace nive::thumbnail {
+
+class ThumbnailGenerator;
+
+/// @brief Configuration for the pre-generator
+struct PregeneratorConfig {
+    uint32_t max_depth = 0;        // Subfolder levels to include (0 = the directory only)
+    size_t max_outstanding = 2;    // Crawl requests pending or in flight at once
+    bool include_hidden = false;   // Also visit hidden files and folders
+    fs::SortOrder sort_order = fs::SortOrder::Natural;  // Order within each directory
+    std::chrono::milliseconds poll_interval{100};  // Recheck for foreground work this often
+
+    // Idle-time crawls wait for foreground work and run in background mode.
+    // A bulk run (nive --pregenerate) turns this off: it submits at
+    // Priority::Normal and keeps max_outstanding requests in the pipeline
+    bool yield_to_foreground = true;
+
+    // Also thumbnail the images inside archives (requires setArchiveManager())
+    bool include_archives = false;
+};
+
+/// @brief Crawls a directory in the background and requests every thumbnail
+///
+/// Requests go to the generator at Priority::Low, so its workers run them in
+/// background mode and results only warm the cache (the callback discards
+/// them). The crawl thread itself runs in background mode too.
+///
+/// The crawler yields to the user: it submits nothing while the generator
+/// has any request above Priority::Low pending or in flight, and keeps at
+/// most max_outstanding Priority::Low requests in the pipeline, so a burst
+/// of visible-range requests never waits behind more than that.
+///
+/// Directories are visited breadth first: the listing the user is looking
+/// at completes before any subfolder.
+///
+/// With a cache set, files it already holds are skipped before anything is
+/// submitted, so a crawl stopped part way and started again only repeats the
+/// directory scans.
+class Pregenerator {
+public:
+    /// @brief Create a pre-generator feeding a generator
+    /// @param generator Generator to submit requests to (must outlive this)
+    /// @param config Crawl options
+    Pregenerator(ThumbnailGenerator& generator, const PregeneratorConfig& config = {});
+
+    /// @brief Destructor - stops the crawl and cancels its requests
+    ~Pregenerator();
+
+    // Non-copyable, non-movable
+    Pregenerator(const Pregenerator&) = delete;
+    Pregenerator& operator=(const Pregenerator&) = delete;
+    Pregenerator(Pregenerator&&) = delete;
+    Pregenerator& operator=(Pregenerator&&) = delete;
+
+    /// @brief Start crawling a directory, replacing any running crawl
+    /// @param root Directory to crawl
+    /// @param size Thumbnail size to request (max dimension)
+    void start(const std::filesystem::path& root, uint32_t size);
+
+    /// @brief Stop the crawl and cancel its outstanding requests
+    void stop();
+
+    /// @brief Check if a crawl is in progress
+    [[nodiscard]] bool isRunning() const noexcept;
+
+    /// @brief Hold the crawl before its next directory or request (efficiency mode)
+    ///
+    /// Requests already submitted still complete. Carries over to crawls
+    /// started while paused.
+    void setPaused(bool paused);
+
+    /// @brief Get number of requests submitted by the current crawl
+    [[nodiscard]] uint64_t submittedCount() const noexcept;
+
+    /// @brief Get number of submitted requests that have completed
+    [[nodiscard]] uint64_t completedCount() const noexcept;
+
+    /// @brief Get number of completed requests that produced no thumbnail
+    [[nodiscard]] uint64_t failedCount() const noexcept;
+
+    /// @brief Get number of files skipped because the cache already held them
+    [[nodiscard]] uint64_t skippedCount() const noexcept;
+
+    /// @brief Get number of submitted requests not yet completed
+    [[nodiscard]] size_t outstandingCount() const;
+
+    /// @brief Set the cache used to skip files already thumbnailed
+    void setCacheManager(cache::CacheManager* cache) noexcept;
+
+    /// @brief Set the archive manager used to list archives (include_archives)
+    void setArchiveManager(archive::ArchiveManager* archives) noexcept;
+
+private:
+    /// @brief Requests of the current crawl not yet completed, shared with their callbacks
+    struct Outstanding {
+        std::mutex mutex;
+        std::condition_variable_any cv;  // Signalled when a request completes
+        std::unordered_map<std::wstring, RequestId> requests;  // Path -> request ID (0 = pending)
+    };
+
+    /// @brief Crawl thread function
+    void crawl(std::stop_token stop_token, std::filesystem::path root, uint32_t size);
+
+    /// @brief Wait until the generator is idle and a request slot is free
+    /// @return false if the crawl was stopped while waiting
+    /// Also waits while the crawl is paused.
+    [[nodiscard]] bool waitForTurn(std::stop_token stop_token);
+
+    /// @brief Submit one file at the crawl's priority
+    void submit(const fs::FileMetadata& file, uint32_t size);
+
+    /// @brief Submit the image entries of an archive
+    void submitArchive(std::stop_token stop_token, const std::filesystem::path& archive_path,
+                       uint32_t size);
+
+    /// @brief Register a request under key, then issue it with a callback that retires it
+    void track(const std::wstring& key, const std::function<RequestId(ThumbnailCallback)>& issue);
+
+    /// @brief Priority the crawl submits at
+    [[nodiscard]] Priority priority() const noexcept {
+        return config_.yield_to_foreground ? Priority::Low : Priority::Normal;
+    }
+
+    /// @brief Cancel every outstanding request of the crawl
+    void cancelOutstanding();
+
+    ThumbnailGenerator& generator_;
+    PregeneratorConfig config_;
+    std::shared_ptr<Outstanding> outstanding_;
+    cache::CacheManager* cache_ = nullptr;
+    archive::ArchiveManager* archives_ = nullptr;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> paused_{false};
+    std::jthread thread_;
+};
+
+}  // namespace nive::thumbnail
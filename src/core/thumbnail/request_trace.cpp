@@ -0,0 +1,113 @@
+/// @file request_trace.cpp
+/// @brief Request timelines and the slow request log
+
+#include "request_trace.hpp"
+
+#include <format>
+
+#include "../util/string_utils.hpp"
+
+namespace nive::thumbnail {
+
+namespace {
+
+/// @brief Columns of a waterfall bar, spanning the slowest hop of the request
+constexpr size_t kBarWidth = 40;
+
+}  // namespace
+
+const char* to_string(Hop hop) noexcept {
+    switch (hop) {
+    case Hop::Queued:
+        return "queued";
+    case Hop::Dequeued:
+        return "dequeued";
+    case Hop::CacheChecked:
+        return "cache_checked";
+    case Hop::Read:
+        return "read";
+    case Hop::DecodeStart:
+        return "decode_start";
+    case Hop::Decoded:
+        return "decoded";
+    case Hop::Scaled:
+        return "scaled";
+    case Hop::CacheWritten:
+        return "cache_written";
+    case Hop::Completed:
+        return "completed";
+    case Hop::Delivered:
+        return "delivered";
+    }
+    return "unknown";
+}
+
+uint32_t RequestTimeline::totalUs() const noexcept {
+    return *std::ranges::max_element(us);
+}
+
+void SlowRequestLog::record(uint64_t request_id, const std::filesystem::path& path,
+                            const RequestTimeline& timeline) {
+    if (!timeline.enabled() || capacity_ == 0) {
+        return;
+    }
+    uint32_t total = timeline.totalUs();
+    std::lock_guard lock(mutex_);
+    if (entries_.size() == capacity_ && total <= entries_.back().timeline.totalUs()) {
+        return;
+    }
+    // Requests that joined another are delivered under its id, once each
+    if (std::ranges::any_of(entries_,
+                            [request_id](const Entry& e) { return e.request_id == request_id; })) {
+        return;
+    }
+    auto position = std::ranges::find_if(
+        entries_, [total](const Entry& entry) { return entry.timeline.totalUs() < total; });
+    entries_.insert(position, Entry{.request_id = request_id, .path = path, .timeline = timeline});
+    if (entries_.size() > capacity_) {
+        entries_.pop_back();
+    }
+}
+
+std::string SlowRequestLog::waterfall() const {
+    std::lock_guard lock(mutex_);
+    if (entries_.empty()) {
+        return {};
+    }
+    std::string out = std::format("  {:<14} {:>9} {:>9}\n", "hop", "at_ms", "delta_ms");
+    for (const auto& entry : entries_) {
+        const auto& timeline = entry.timeline;
+        double total_us = static_cast<double>(timeline.totalUs());
+        out += std::format("request {} {:.2f} ms {}\n", entry.request_id, total_us / 1000.0,
+                           pathToUtf8(entry.path));
+
+        // Each bar covers the time from the previous hop reached to this one
+        uint32_t previous = 0;
+        for (size_t i = 0; i < kHopCount; ++i) {
+            uint32_t at = timeline.us[i];
+            if (at == 0) {
+                continue;
+            }
+            auto column = [&](uint32_t us) {
+                double width = static_cast<double>(kBarWidth);
+                return total_us > 0.0 ? static_cast<size_t>(us / total_us * width) : 0;
+            };
+            size_t from = std::min(column(std::min(previous, at)), kBarWidth - 1);
+            size_t to = std::clamp(column(at), from + 1, kBarWidth);
+            std::string bar(kBarWidth, ' ');
+            bar.replace(from, to - from, to - from, '=');
+            out += std::format("  {:<14} {:>9.2f} {:>+9.2f} |{}|\n",
+                               to_string(static_cast<Hop>(i)), at / 1000.0,
+                               (static_cast<double>(at) - previous) / 1000.0, bar);
+            previous = std::max(previous, at);
+        }
+    }
+    return out;
+}
+
+void SlowRequestLog::reset() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+}
+
+}  // namespace nive::thumbnail
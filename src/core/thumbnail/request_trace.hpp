@@ -0,0 +1,102 @@
+/// @file request_trace.hpp
+/// @brief Per-request timelines of thumbnail requests, and a log of the slowest
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nive::thumbnail {
+
+/// @brief Point a request passes on its way from the grid to the screen
+enum class Hop : uint8_t {
+    Queued,        // Submitted to the ThumbnailQueue (or joined an identical request)
+    Dequeued,      // Taken by an I/O worker
+    CacheChecked,  // Cache lookup answered, hit or miss
+    Read,          // File read, or archive entry extracted
+    DecodeStart,   // Taken by a decode worker
+    Decoded,       // Decode finished
+    Scaled,        // Thumbnail scaled and color converted
+    CacheWritten,  // Compressed and handed to the cache writer
+    Completed,     // Result passed to the callback, which posts it to the UI thread
+    Delivered,     // Taken by the UI thread and given to the grid
+};
+inline constexpr size_t kHopCount = 10;
+
+[[nodiscard]] const char* to_string(Hop hop) noexcept;
+
+/// @brief Times a request reached each hop, relative to when it was created
+///
+/// Carried by value from ThumbnailRequest to ThumbnailResult. Tracing is off
+/// until start() is called (GeneratorConfig::trace_requests); mark() is then
+/// a clock read and a store, from whichever thread holds the request.
+struct RequestTimeline {
+    std::chrono::steady_clock::time_point origin;  // Request created; unset while tracing is off
+    std::array<uint32_t, kHopCount> us{};          // Microseconds from origin, 0 = not reached
+
+    /// @brief Start tracing from the request's creation time
+    void start(std::chrono::steady_clock::time_point created_at) noexcept { origin = created_at; }
+
+    [[nodiscard]] bool enabled() const noexcept {
+        return origin != std::chrono::steady_clock::time_point{};
+    }
+
+    /// @brief Record reaching a hop now (the last call for a hop wins)
+    void mark(Hop hop) noexcept {
+        if (!enabled()) {
+            return;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - origin)
+                           .count();
+        // At least 1, so a hop reached at once still counts as reached
+        us[static_cast<size_t>(hop)] =
+            static_cast<uint32_t>(std::clamp<int64_t>(elapsed, 1, UINT32_MAX));
+    }
+
+    [[nodiscard]] bool reached(Hop hop) const noexcept {
+        return us[static_cast<size_t>(hop)] != 0;
+    }
+
+    /// @brief Time to the latest hop reached, in microseconds
+    [[nodiscard]] uint32_t totalUs() const noexcept;
+};
+
+/// @brief The slowest traced requests, kept for a waterfall report
+///
+/// Thread-safe. Holds at most a capacity of timelines; a request faster than
+/// all of them once full is not kept.
+class SlowRequestLog {
+public:
+    explicit SlowRequestLog(size_t capacity = 20) : capacity_(capacity) {}
+
+    /// @brief Offer a finished request's timeline
+    void record(uint64_t request_id, const std::filesystem::path& path,
+                const RequestTimeline& timeline);
+
+    /// @brief Format the kept requests, slowest first, one waterfall each
+    /// @return Empty if nothing was recorded
+    [[nodiscard]] std::string waterfall() const;
+
+    /// @brief Forget every kept request
+    void reset();
+
+private:
+    struct Entry {
+        uint64_t request_id = 0;
+        std::filesystem::path path;
+        RequestTimeline timeline;
+    };
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;  // Sorted slowest first
+};
+
+}  // namespace nive::thumbnail
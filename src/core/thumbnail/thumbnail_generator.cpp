@@ -6,23 +6,235 @@
 
 #include <objbase.h>
 
+#include <algorithm>
 #include <chrono>
-#include <fstream>
+#include <cstring>
+#include <functional>
 
+#include "../archive/archive_manager.hpp"
 #include "../cache/cache_manager.hpp"
+#include "../fs/directory_reader.hpp"
+#include "../fs/io_scheduler.hpp"
+#include "../fs/natural_sort.hpp"
+#include "../image/color_management.hpp"
+#include "../image/decoder_registry.hpp"
 #include "../image/image_scaler.hpp"
+#include "../image/perceptual_hash.hpp"
+#include "../image/shell_thumbnail.hpp"
+#include "../image/thumbnail_scaler.hpp"
 #include "../image/wic_decoder.hpp"
 #include "../plugin/plugin_manager.hpp"
+#include "../util/etw.hpp"
+#include "../util/execution_policy.hpp"
 #include "../util/logger.hpp"
+#include "../util/mapped_file.hpp"
 #include "../util/string_utils.hpp"
+#include "../util/trace.hpp"
 
 namespace nive::thumbnail {
 
-ThumbnailGenerator::ThumbnailGenerator(const GeneratorConfig& config) : config_(config) {
+namespace {
+
+// Larger files are not prefetched; the decoder streams them from disk
+constexpr uint64_t kMaxPrefetchBytes = 64 * 1024 * 1024;
+
+// Requests an I/O worker takes at once from a seeking volume and reads in
+// disk order: about the visible screen and the next one of a grid
+constexpr size_t kDiskOrderBatch = 48;
+
+// NTFS file IDs carry a sequence number in the top 16 bits; below it is the
+// MFT record, which files written together get in order, like their clusters
+constexpr uint64_t kFileRecordMask = (uint64_t{1} << 48) - 1;
+
+// Folder mosaics are a 2x2 grid of the first images by name, picked from
+// the first kFolderScanLimit entries so a huge folder costs one bounded read
+constexpr uint32_t kFolderMosaicColumns = 2;
+constexpr size_t kFolderMosaicTiles = kFolderMosaicColumns * kFolderMosaicColumns;
+constexpr size_t kFolderScanLimit = 256;
+constexpr uint32_t kFolderMosaicBackground = 0xFFE8E8E8;  // Opaque BGRA, behind empty tiles
+
+/// @brief Estimate the bytes a decode allocates for the image it produces
+///
+/// Plugins are assumed to decode at full size even when they take the size
+/// hint; libjpeg-turbo scales by up to 1/8 while keeping the longer side at
+/// least size, as TurboJpegDecoder picks its factor.
+[[nodiscard]] uint64_t decode_footprint(const image::ImageInfo& info, image::ImageFormat format,
+                                        bool native, uint32_t size) noexcept {
+    uint64_t width = info.width;
+    uint64_t height = info.height;
+    if (native && format == image::ImageFormat::Jpeg) {
+        for (int step = 0; step < 3 && std::max(width, height) / 2 >= size; ++step) {
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+    }
+    uint64_t pixel_bytes = std::max<uint64_t>(image::bytesPerPixel(info.format), 4);
+    return width * height * pixel_bytes;
+}
+
+/// @brief Check if reads on a volume cost a seek, so their order matters
+[[nodiscard]] bool seeks(const std::filesystem::path& path) {
+    auto kind = fs::IoScheduler::instance().volumeKind(path);
+    return kind == fs::VolumeKind::Hdd || kind == fs::VolumeKind::Unknown;
+}
+
+/// @brief Map a plain file and read it in for the decode stage
+/// @return Mapped contents, or nullopt if unreadable or too large to prefetch
+std::optional<MappedFile> read_source(const ThumbnailSource& source) {
+    uint64_t size = 0;
+    if (source.stamp) {
+        size = source.stamp->size_bytes;
+    } else {
+        std::error_code ec;
+        size = std::filesystem::file_size(source.path, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+    }
+    if (size == 0 || size > kMaxPrefetchBytes) {
+        return std::nullopt;
+    }
+
+    auto file = MappedFile::open(source.path);
+    if (file) {
+        file->prefault();
+    }
+    return file;
+}
+
+/// @brief List the images a folder mosaic shows
+/// @return Up to kFolderMosaicTiles images, by natural name order
+std::vector<FolderImage> list_folder_images(const std::filesystem::path& folder) {
+    std::vector<FolderImage> images;
+    auto reader = fs::DirectoryReader::open(folder);
+    if (!reader) {
+        return images;
+    }
+    fs::DirectoryRecord record;
+    for (size_t seen = 0; seen < kFolderScanLimit; ++seen) {
+        auto more = reader->next(record);
+        if (!more || !*more) {
+            break;
+        }
+        if (record.attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN)) {
+            continue;
+        }
+        std::filesystem::path path = folder / record.name;
+        if (!fs::isImageExtension(path.extension().native())) {
+            continue;
+        }
+        images.push_back({.path = std::move(path),
+                          .stamp = {.mtime = fs::fileTimeToSystemClock(record.modified),
+                                    .size_bytes = record.size}});
+    }
+
+    std::ranges::sort(images, [](const FolderImage& a, const FolderImage& b) {
+        return fs::naturalCompare(a.path.filename().native(), b.path.filename().native()) < 0;
+    });
+    if (images.size() > kFolderMosaicTiles) {
+        images.resize(kFolderMosaicTiles);
+    }
+    return images;
+}
+
+/// @brief Copy the centre of a tile into its cell of the mosaic
+/// @param tile BGRA32 image at least as large as the cell
+void blit_tile(image::DecodedImage& mosaic, const image::DecodedImage& tile, uint32_t x,
+               uint32_t y, uint32_t cell) {
+    uint32_t offset_x = (tile.width() - cell) / 2;
+    uint32_t offset_y = (tile.height() - cell) / 2;
+    for (uint32_t row = 0; row < cell; ++row) {
+        std::memcpy(mosaic.row(y + row) + static_cast<size_t>(x) * 4,
+                    tile.row(offset_y + row) + static_cast<size_t>(offset_x) * 4,
+                    static_cast<size_t>(cell) * 4);
+    }
+}
+
+/// @brief Runs a function when destroyed
+///
+/// Held by a coalesced request's callback, so the job is released however
+/// the request goes away: delivered, dropped from the queue, or cancelled.
+class ReleaseGuard {
+public:
+    explicit ReleaseGuard(std::function<void()> release) : release_(std::move(release)) {}
+    ~ReleaseGuard() { release_(); }
+
+    ReleaseGuard(const ReleaseGuard&) = delete;
+    ReleaseGuard& operator=(const ReleaseGuard&) = delete;
+
+private:
+    std::function<void()> release_;
+};
+
+/// @brief Coalescing key of a request
+uint64_t job_key(const ThumbnailRequest& request) {
+    return static_cast<uint64_t>(request.path_id) << 32 | request.target_size;
+}
+
+/// @brief Microseconds since a start time
+[[nodiscard]] uint64_t elapsed_us(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count());
+}
+
+/// @brief Run the current thread in background mode (lower CPU, I/O and memory priority)
+///
+/// Used for Priority::Low work and in efficiency mode, so pre-generation gives
+/// way to foreground requests on the other threads and to the rest of the system.
+class BackgroundMode {
+public:
+    explicit BackgroundMode(bool enable)
+        : active_(enable && SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN)) {}
+    ~BackgroundMode() {
+        if (active_) {
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
+    }
+
+    BackgroundMode(const BackgroundMode&) = delete;
+    BackgroundMode& operator=(const BackgroundMode&) = delete;
+
+private:
+    bool active_;
+};
+
+// A step up must raise throughput by this much, or it is undone and the
+// controller holds for kAdaptHoldTicks before trying again
+constexpr double kMinGrowthGain = 1.05;
+constexpr int kAdaptHoldTicks = 5;
+
+}  // namespace
+
+ThumbnailGenerator::ThumbnailGenerator(const GeneratorConfig& config)
+    : config_(config), admission_(config.max_decode_bytes) {
+    uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    if (config_.worker_count == 0) {
+        config_.worker_count = cores;
+    }
+    config_.io_worker_count = std::max(config_.io_worker_count, 1u);
+    if (config_.adaptive) {
+        if (config_.max_workers == 0) {
+            config_.max_workers = cores;
+        }
+        config_.min_workers = std::clamp(config_.min_workers, 1u, config_.max_workers);
+        config_.worker_count =
+            std::clamp(config_.worker_count, config_.min_workers, config_.max_workers);
+        thread_count_ = config_.max_workers;
+    } else {
+        thread_count_ = config_.worker_count;
+    }
+    if (config_.max_prefetched == 0) {
+        config_.max_prefetched = static_cast<size_t>(thread_count_) * 2;
+    }
+    stage_ = std::make_unique<DecodeStage>(thread_count_, config_.max_prefetched);
+    queue_.setLimits(config_.max_queue_size, config_.max_queued_bytes);
 }
 
 ThumbnailGenerator::~ThumbnailGenerator() {
     stop();
+    // Release queued requests while the coalescing state they refer to is alive
+    (void)queue_.cancelAll();
 }
 
 void ThumbnailGenerator::start() {
@@ -31,10 +243,22 @@ void ThumbnailGenerator::start() {
     }
 
     queue_.restart();
-    workers_.reserve(config_.worker_count);
+    stage_->restart();
+    active_workers_.store(baseWorkers());
+    stage_->setActiveLanes(baseWorkers());
 
-    for (uint32_t i = 0; i < config_.worker_count; ++i) {
-        workers_.emplace_back([this](std::stop_token stop_token) { workerThread(stop_token); });
+    workers_.reserve(thread_count_);
+    for (uint32_t i = 0; i < thread_count_; ++i) {
+        workers_.emplace_back(
+            [this, i](std::stop_token stop_token) { workerThread(stop_token, i); });
+    }
+    io_workers_.reserve(config_.io_worker_count);
+    for (uint32_t i = 0; i < config_.io_worker_count; ++i) {
+        io_workers_.emplace_back([this](std::stop_token stop_token) { ioThread(stop_token); });
+    }
+    if (config_.adaptive) {
+        controller_ =
+            std::jthread([this](std::stop_token stop_token) { controllerThread(stop_token); });
     }
 }
 
@@ -44,14 +268,25 @@ void ThumbnailGenerator::stop() {
     }
 
     queue_.stop();
+    stage_->stop();
+    controller_ = {};  // Requests stop and joins
 
     // Request stop for all workers
+    for (auto& worker : io_workers_) {
+        worker.request_stop();
+    }
     for (auto& worker : workers_) {
         worker.request_stop();
     }
 
     // Wait for workers to finish
+    io_workers_.clear();
     workers_.clear();
+
+    // Prefetched requests that never reached a decode worker
+    for (auto& prepared : stage_->drain()) {
+        queue_.finish(prepared.request.id);
+    }
 }
 
 bool ThumbnailGenerator::isRunning() const noexcept {
@@ -70,10 +305,31 @@ RequestId ThumbnailGenerator::request(const std::filesystem::path& path, Thumbna
         .callback = std::move(callback),
     };
 
-    stats_.total_requests.fetch_add(1, std::memory_order_relaxed);
-    queue_.push(std::move(req));
+    return submit(std::move(req));
+}
 
-    return id;
+RequestId ThumbnailGenerator::request(const fs::FileMetadata& file, ThumbnailCallback callback,
+                                      Priority priority, uint32_t size, size_t view_index) {
+    auto id = nextRequestId();
+
+    // Archives are shown by their cover image, folders by a mosaic of their
+    // first images, built behind the images on screen
+    cache::SourceStamp stamp{.mtime = file.modified_time, .size_bytes = file.size_bytes};
+    ThumbnailRequest req{
+        .id = id,
+        .source = file.is_archive()     ? ThumbnailSource::from_archive_cover(file.path, stamp)
+                  : file.is_directory() ? ThumbnailSource::from_folder(file.path, stamp)
+                                        : ThumbnailSource::from_file(file.path, stamp),
+        .target_size = size > 0 ? size : config_.default_thumbnail_size,
+        .priority = file.is_directory() ? std::min(priority, Priority::Low) : priority,
+        .callback = std::move(callback),
+        .view_index = view_index,
+    };
+    if (req.source.is_file() && file.file_id.valid()) {
+        req.source.disk_order = file.file_id.low & kFileRecordMask;
+    }
+
+    return submit(std::move(req));
 }
 
 RequestId ThumbnailGenerator::requestFromMemory(const std::filesystem::path& virtual_path,
@@ -91,13 +347,72 @@ RequestId ThumbnailGenerator::requestFromMemory(const std::filesystem::path& vir
     };
 
     stats_.total_requests.fetch_add(1, std::memory_order_relaxed);
-    queue_.push(std::move(req));
+    enqueue(std::move(req));
+
+    return id;
+}
+
+RequestId
+ThumbnailGenerator::requestFromArchive(const archive::VirtualPath& entry,
+                                       ThumbnailCallback callback, Priority priority,
+                                       uint32_t size, size_t view_index,
+                                       const std::optional<cache::SourceStamp>& archive_stamp) {
+    auto id = nextRequestId();
+
+    ThumbnailRequest req{
+        .id = id,
+        .source = ThumbnailSource::from_archive(entry, archive_stamp),
+        .target_size = size > 0 ? size : config_.default_thumbnail_size,
+        .priority = priority,
+        .callback = std::move(callback),
+        .view_index = view_index,
+    };
+
+    return submit(std::move(req));
+}
+
+RequestId
+ThumbnailGenerator::requestFromArchive(const archive::VirtualPath& entry,
+                                       std::vector<uint8_t> data, ThumbnailCallback callback,
+                                       Priority priority, uint32_t size,
+                                       const std::optional<cache::SourceStamp>& archive_stamp) {
+    auto id = nextRequestId();
+
+    ThumbnailRequest req{
+        .id = id,
+        .source = ThumbnailSource::from_archive(entry, std::move(data), archive_stamp),
+        .target_size = size > 0 ? size : config_.default_thumbnail_size,
+        .priority = priority,
+        .callback = std::move(callback),
+    };
+
+    stats_.total_requests.fetch_add(1, std::memory_order_relaxed);
+    enqueue(std::move(req));
 
     return id;
 }
 
 bool ThumbnailGenerator::cancel(RequestId id) {
-    if (queue_.cancel(id)) {
+    RequestId target = id;
+    {
+        std::lock_guard lock(jobs_mutex_);
+        if (auto it = subscriptions_.find(id); it != subscriptions_.end()) {
+            auto job = it->second;
+            if (job->subscribers.size() > 1) {
+                // Others still want the result: only drop this caller's callback
+                std::erase_if(job->subscribers,
+                              [id](const auto& subscriber) { return subscriber.first == id; });
+                subscriptions_.erase(it);
+                stats_.cancelled_requests.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            // Last caller: cancel the work itself
+            target = job->request_id;
+            detach(job);
+        }
+    }
+
+    if (queue_.cancel(target)) {
         stats_.cancelled_requests.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
@@ -105,12 +420,39 @@ bool ThumbnailGenerator::cancel(RequestId id) {
 }
 
 size_t ThumbnailGenerator::cancelByPath(const std::filesystem::path& path) {
+    {
+        // A path never interned has no jobs
+        const PathId path_id = PathInterner::instance().find(path.native());
+        std::lock_guard lock(jobs_mutex_);
+        std::vector<std::shared_ptr<Job>> matching;
+        for (const auto& [key, job] : jobs_) {
+            if (path_id != kNoPathId && key >> 32 == path_id) {
+                matching.push_back(job);
+            }
+        }
+        for (const auto& job : matching) {
+            detach(job);
+        }
+    }
+
     size_t count = queue_.cancelByPath(path);
     stats_.cancelled_requests.fetch_add(count, std::memory_order_relaxed);
     return count;
 }
 
+uint64_t ThumbnailGenerator::advanceEpoch() {
+    uint64_t epoch = queue_.advanceEpoch();
+    LOG_TRACE("ThumbnailGenerator::advanceEpoch: {}", epoch);
+    return epoch;
+}
+
 size_t ThumbnailGenerator::cancelAll() {
+    {
+        std::lock_guard lock(jobs_mutex_);
+        jobs_.clear();
+        subscriptions_.clear();
+    }
+
     size_t count = queue_.cancelAll();
     stats_.cancelled_requests.fetch_add(count, std::memory_order_relaxed);
     return count;
@@ -120,10 +462,59 @@ bool ThumbnailGenerator::updatePriority(RequestId id, Priority new_priority) {
     return queue_.updatePriority(id, new_priority);
 }
 
+size_t ThumbnailGenerator::setViewport(const Viewport& viewport) {
+    {
+        // The queue drops (or stops) these; new requests must not attach to them
+        std::lock_guard lock(jobs_mutex_);
+        std::vector<std::shared_ptr<Job>> outside;
+        for (const auto& [key, job] : jobs_) {
+            if (job->view_index != kNoViewIndex &&
+                (job->view_index < viewport.keep_first || job->view_index >= viewport.keep_last)) {
+                outside.push_back(job);
+            }
+        }
+        for (const auto& job : outside) {
+            detach(job);
+        }
+    }
+
+    size_t count = queue_.setViewport(viewport);
+    stats_.cancelled_requests.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
 size_t ThumbnailGenerator::pendingCount() const {
     return queue_.size();
 }
 
+uint64_t ThumbnailGenerator::pendingBytes() const {
+    return queue_.pendingBytes();
+}
+
+bool ThumbnailGenerator::isSaturated() const {
+    return queue_.saturated();
+}
+
+size_t ThumbnailGenerator::urgentCount() const {
+    return queue_.urgentCount();
+}
+
+size_t ThumbnailGenerator::backgroundCount() const {
+    return queue_.backgroundCount();
+}
+
+PipelineDepth ThumbnailGenerator::pipelineDepth() const {
+    return PipelineDepth{
+        .queued = queue_.size(),
+        .reading = reading_.load(std::memory_order_relaxed),
+        .prefetched = stage_->size(),
+        .decoding = decoding_.load(std::memory_order_relaxed),
+        .stolen = stage_->stolenCount(),
+        .io_workers = config_.io_worker_count,
+        .decode_workers = active_workers_.load(std::memory_order_relaxed),
+    };
+}
+
 const GeneratorStats& ThumbnailGenerator::stats() const noexcept {
     return stats_;
 }
@@ -133,18 +524,115 @@ void ThumbnailGenerator::resetStats() {
     stats_.completed_requests.store(0, std::memory_order_relaxed);
     stats_.failed_requests.store(0, std::memory_order_relaxed);
     stats_.cancelled_requests.store(0, std::memory_order_relaxed);
+    stats_.coalesced_requests.store(0, std::memory_order_relaxed);
+    stats_.shed_requests.store(0, std::memory_order_relaxed);
+    stats_.shell_cache_hits.store(0, std::memory_order_relaxed);
+    stats_.admission_waits.store(0, std::memory_order_relaxed);
     stats_.total_processing_time_ms.store(0, std::memory_order_relaxed);
+    stats_.latencies.reset();
+    stats_.slowest.reset();
+}
+
+void ThumbnailGenerator::recordDelivery(ThumbnailResult& result) {
+    if (!result.timeline.enabled()) {
+        return;
+    }
+    result.timeline.mark(Hop::Delivered);
+    // A preview's request goes on to its refined pass
+    if (!result.preview) {
+        stats_.slowest.record(result.request_id, result.path, result.timeline);
+    }
 }
 
 void ThumbnailGenerator::setCacheManager(cache::CacheManager* cache) noexcept {
     cache_ = cache;
 }
 
-void ThumbnailGenerator::setPluginManager(plugin::PluginManager* plugins) noexcept {
-    plugins_ = plugins;
+void ThumbnailGenerator::setDecoderRegistry(const image::DecoderRegistry* decoders) noexcept {
+    decoders_ = decoders;
+}
+
+void ThumbnailGenerator::setArchiveManager(archive::ArchiveManager* archives) noexcept {
+    archives_ = archives;
+}
+
+void ThumbnailGenerator::setScaler(image::IThumbnailScaler* scaler) noexcept {
+    scaler_ = scaler;
+}
+
+void ThumbnailGenerator::ioThread(std::stop_token stop_token) {
+    auto thread_id = GetCurrentThreadId();
+    LOG_DEBUG("ioThread[{}]: starting", thread_id);
+
+    // Archive extraction and cache conversion may use COM
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    bool com_initialized = SUCCEEDED(hr);
+
+    auto process = [this](ThumbnailRequest& request) {
+        auto id = request.id;
+        request.timeline.mark(Hop::Dequeued);
+
+        // Batched requests may have been cancelled while waiting their turn
+        if (abandoned(request)) {
+            queue_.finish(id);
+            return;
+        }
+
+        auto io_start = std::chrono::steady_clock::now();
+        reading_.fetch_add(1, std::memory_order_relaxed);
+        std::optional<PreparedRequest> prepared;
+        {
+            bool efficient = efficient_.load(std::memory_order_relaxed);
+            BackgroundMode background(efficient || request.priority == Priority::Low);
+            ScopedEcoQoS eco_qos(efficient);
+            prepared = prepareRequest(request);
+        }
+        reading_.fetch_sub(1, std::memory_order_relaxed);
+        io_time_us_.fetch_add(elapsed_us(io_start), std::memory_order_relaxed);
+        io_samples_.fetch_add(1, std::memory_order_relaxed);
+
+        // Blocks while the decode stage is full, so reads stay a bounded
+        // distance ahead of decoding
+        if (!prepared || !stage_->push(std::move(*prepared))) {
+            queue_.finish(id);
+        }
+    };
+
+    while (!stop_token.stop_requested()) {
+        auto request_opt = queue_.pop();
+        if (!request_opt) {
+            // Queue stopped or empty - check if we should exit
+            if (queue_.isStopped()) {
+                break;
+            }
+            continue;
+        }
+
+        // On a disk that seeks, reading a screenful in queue order is a
+        // seek per file. Take the rest of the screen and read it sorted by
+        // position instead, so the heads sweep across the folder once.
+        if (request_opt->source.disk_order == 0 || !seeks(request_opt->source.path)) {
+            process(*request_opt);
+            continue;
+        }
+        auto batch = queue_.tryPopBatch(request_opt->priority, kDiskOrderBatch - 1);
+        batch.insert(batch.begin(), std::move(*request_opt));
+        std::stable_sort(batch.begin(), batch.end(),
+                         [](const ThumbnailRequest& a, const ThumbnailRequest& b) {
+                             return a.source.disk_order < b.source.disk_order;
+                         });
+        for (auto& request : batch) {
+            process(request);
+        }
+    }
+
+    if (com_initialized) {
+        CoUninitialize();
+    }
+    LOG_DEBUG("ioThread[{}]: exiting", thread_id);
 }
 
-void ThumbnailGenerator::workerThread(std::stop_token stop_token) {
+void ThumbnailGenerator::workerThread(std::stop_token stop_token, size_t worker_index) {
     auto thread_id = GetCurrentThreadId();
     LOG_DEBUG("workerThread[{}]: starting", thread_id);
 
@@ -160,43 +648,46 @@ void ThumbnailGenerator::workerThread(std::stop_token stop_token) {
     {
         image::WicDecoder decoder;
 
-        while (!stop_token.stop_requested()) {
-            LOG_TRACE("workerThread[{}]: waiting for request, queue_size={}", thread_id,
-                      queue_.size());
-            auto request_opt = queue_.pop();
-            if (!request_opt) {
-                // Queue stopped or empty - check if we should exit
-                LOG_DEBUG("workerThread[{}]: pop returned nullopt, stopped={}", thread_id,
-                          queue_.isStopped());
-                if (queue_.isStopped()) {
-                    break;
-                }
-                continue;
+        while (waitUntilActive(stop_token, worker_index)) {
+            auto prepared = stage_->pop(worker_index);
+            if (!prepared) {
+                // Stage stopped
+                break;
             }
 
-            auto& request = *request_opt;
-            LOG_DEBUG("workerThread[{}]: got request id={}, path={}", thread_id, request.id,
-                      pathToUtf8(request.source.path));
-
-            // Check if cancelled while waiting
-            if (queue_.isCancelled(request.id)) {
-                LOG_DEBUG("workerThread[{}]: request {} was cancelled", thread_id, request.id);
-                queue_.clearCancelled(request.id);
-                continue;
+            auto id = prepared->request.id;
+            prepared->request.timeline.mark(Hop::DecodeStart);
+            etw::decodeStart(id);
+            auto decode_start = std::chrono::steady_clock::now();
+            decoding_.fetch_add(1, std::memory_order_relaxed);
+            std::optional<ThumbnailRequest> refine;
+            {
+                bool efficient = efficient_.load(std::memory_order_relaxed);
+                BackgroundMode background(efficient ||
+                                          prepared->request.priority == Priority::Low);
+                ScopedEcoQoS eco_qos(efficient);
+                refine = processRequest(*prepared, decoder);
             }
-
-            // Check stop again before processing
-            if (stop_token.stop_requested() || queue_.isStopped()) {
-                LOG_DEBUG("workerThread[{}]: stop requested before processing", thread_id);
-                break;
+            decoding_.fetch_sub(1, std::memory_order_relaxed);
+            auto decode_us = elapsed_us(decode_start);
+            etw::decodeEnd(id, decode_us);
+            decode_time_us_.fetch_add(decode_us, std::memory_order_relaxed);
+            decode_samples_.fetch_add(1, std::memory_order_relaxed);
+            queue_.finish(id);
+            // Queued only after finish(), so the ID is never in flight and
+            // pending at once; a cancel that arrived meanwhile still wins
+            if (refine && !abandoned(*refine)) {
+                refine->stop = std::stop_source{std::nostopstate};
+                enqueue(std::move(*refine));
             }
-
-            LOG_DEBUG("workerThread[{}]: processing request {}", thread_id, request.id);
-            processRequest(request, decoder);
-            LOG_DEBUG("workerThread[{}]: completed request {}", thread_id, request.id);
         }
     }  // decoder destroyed here
 
+    // Plugins keeping decoder state per thread free this worker's
+    if (plugin::PluginManager* plugins = decoders_ ? decoders_->plugins() : nullptr) {
+        plugins->detachThread();
+    }
+
     // Clean up COM
     if (com_initialized) {
         CoUninitialize();
@@ -204,7 +695,141 @@ void ThumbnailGenerator::workerThread(std::stop_token stop_token) {
     LOG_DEBUG("workerThread[{}]: exiting", thread_id);
 }
 
-void ThumbnailGenerator::processRequest(ThumbnailRequest& request, image::WicDecoder& decoder) {
+bool ThumbnailGenerator::waitUntilActive(std::stop_token stop_token, size_t worker_index) {
+    if (worker_index < active_workers_.load(std::memory_order_relaxed)) {
+        return !stop_token.stop_requested();
+    }
+    std::unique_lock lock(active_mutex_);
+    active_cv_.wait(lock, stop_token, [this, worker_index] {
+        return worker_index < active_workers_.load(std::memory_order_relaxed);
+    });
+    return !stop_token.stop_requested();
+}
+
+void ThumbnailGenerator::setActiveWorkers(uint32_t count) {
+    {
+        std::lock_guard lock(active_mutex_);
+        active_workers_.store(count);
+    }
+    stage_->setActiveLanes(count);
+    active_cv_.notify_all();
+}
+
+uint32_t ThumbnailGenerator::baseWorkers() const noexcept {
+    if (efficient_.load(std::memory_order_relaxed)) {
+        return std::clamp(config_.efficient_workers, 1u, config_.worker_count);
+    }
+    return config_.worker_count;
+}
+
+void ThumbnailGenerator::setEfficiencyMode(bool enabled) {
+    if (efficient_.exchange(enabled) == enabled) {
+        return;
+    }
+    LOG_INFO("Thumbnail efficiency mode {}", enabled ? "on" : "off");
+    if (running_.load()) {
+        setActiveWorkers(baseWorkers());
+    }
+}
+
+bool ThumbnailGenerator::efficiencyMode() const noexcept {
+    return efficient_.load(std::memory_order_relaxed);
+}
+
+void ThumbnailGenerator::controllerThread(std::stop_token stop_token) {
+    uint64_t last_io_us = io_time_us_.load();
+    uint64_t last_io_samples = io_samples_.load();
+    uint64_t last_decode_us = decode_time_us_.load();
+    uint64_t last_decode_samples = decode_samples_.load();
+    double last_throughput = 0.0;
+    bool last_grew = false;
+    int hold = 0;
+
+    std::mutex tick_mutex;
+    std::condition_variable_any tick_cv;
+    while (!stop_token.stop_requested()) {
+        {
+            // Sleeps one interval; wakes early only when stop is requested
+            std::unique_lock lock(tick_mutex);
+            (void)tick_cv.wait_for(lock, stop_token, config_.adapt_interval, [] { return false; });
+        }
+        if (stop_token.stop_requested()) {
+            break;
+        }
+
+        // Per-interval averages
+        uint64_t io_us = io_time_us_.load() - last_io_us;
+        uint64_t io_count = io_samples_.load() - last_io_samples;
+        uint64_t decode_us = decode_time_us_.load() - last_decode_us;
+        uint64_t decode_count = decode_samples_.load() - last_decode_samples;
+        last_io_us += io_us;
+        last_io_samples += io_count;
+        last_decode_us += decode_us;
+        last_decode_samples += decode_count;
+        double io_ms = io_count > 0 ? io_us / 1000.0 / io_count : 0.0;
+        double decode_ms = decode_count > 0 ? decode_us / 1000.0 / decode_count : 0.0;
+        double seconds = std::chrono::duration<double>(config_.adapt_interval).count();
+        double throughput = decode_count / seconds;
+
+        auto depth = pipelineDepth();
+        uint32_t active = depth.decode_workers;
+        auto power = currentPowerSource();
+        uint32_t cap = config_.max_workers;
+        if (power == PowerSource::Battery) {
+            cap = std::max(config_.min_workers, config_.max_workers / 2);
+        } else if (power == PowerSource::BatterySaver) {
+            cap = config_.min_workers;
+        }
+        if (efficient_.load(std::memory_order_relaxed)) {
+            cap = std::min(cap, baseWorkers());
+        }
+
+        uint32_t target = active;
+        const char* reason = nullptr;
+        if (hold > 0) {
+            --hold;
+        }
+        if (active > cap) {
+            target = cap;
+            reason = "power";
+        } else if (last_grew && throughput < last_throughput * kMinGrowthGain) {
+            // The extra threads did not pay off (contention, memory or disk bound)
+            target = std::max(config_.min_workers, active - 1);
+            reason = "no throughput gain";
+            hold = kAdaptHoldTicks;
+        } else if (depth.prefetched >= active && depth.decoding >= active) {
+            // Prepared work is backing up behind busy decoders
+            if (hold == 0 && active < cap) {
+                target = std::min(cap, active + std::max(active / 4, 1u));
+                reason = "decode backlog";
+            }
+        } else if (depth.queued > 0 && depth.prefetched == 0 &&
+                   depth.reading >= depth.io_workers && depth.decoding < active) {
+            // Decoders idle while every I/O thread is busy: more would only wait
+            target = std::max(config_.min_workers, active - 1);
+            reason = "waiting on I/O";
+        }
+
+        target = std::min(target, cap);  // min_workers may exceed the efficiency mode cap
+        last_grew = target > active;
+        last_throughput = throughput;
+        if (target != active) {
+            LOG_INFO("Thumbnail decode threads {} -> {} ({}): {:.1f}/s, decode {:.1f}ms, "
+                     "io {:.1f}ms, queued={} prefetched={} decoding={}, power={}",
+                     active, target, reason, throughput, decode_ms, io_ms, depth.queued,
+                     depth.prefetched, depth.decoding, to_string(power));
+            setActiveWorkers(target);
+        } else if (decode_count > 0 || depth.queued > 0) {
+            LOG_DEBUG("Thumbnail decode threads {}: {:.1f}/s, decode {:.1f}ms, io {:.1f}ms, "
+                      "queued={} prefetched={} decoding={}, power={}",
+                      active, throughput, decode_ms, io_ms, depth.queued, depth.prefetched,
+                      depth.decoding, to_string(power));
+        }
+    }
+}
+
+std::optional<PreparedRequest> ThumbnailGenerator::prepareRequest(ThumbnailRequest& request) {
+    ScopedTrace trace("thumbnail read", "thumbnail");
     auto start_time = std::chrono::steady_clock::now();
 
     ThumbnailResult result{
@@ -213,108 +838,378 @@ void ThumbnailGenerator::processRequest(ThumbnailRequest& request, image::WicDec
         .error = std::nullopt,
     };
 
-    // Check cache first (only for file-based sources, not memory)
-    bool is_file_source = !request.source.memory_data.has_value();
-    if (cache_ && is_file_source) {
-        auto cached = cache_->getThumbnail(request.source.path);
+    // Check cache first (files and archive entries; raw memory sources have no stable key)
+    bool is_cacheable = request.source.is_cacheable();
+    uint64_t lookup_us = 0;
+    if (cache_ && is_cacheable) {
+        auto lookup_start = std::chrono::steady_clock::now();
+        auto cached =
+            cache_->getThumbnail(request.source.path, request.source.stamp, request.target_size);
+        lookup_us = elapsed_us(lookup_start);
+        request.timeline.mark(Hop::CacheChecked);
         if (cached) {
+            etw::cacheHit(request.id, lookup_us);
             result.thumbnail = std::move(*cached);
 
             // Retrieve original resolution from cache (memory cache hit, O(1))
-            if (auto res = cache_->getImageResolution(request.source.path)) {
+            if (auto res = cache_->getImageResolution(request.source.path, request.source.stamp)) {
                 result.original_width = res->width;
                 result.original_height = res->height;
             }
 
+            recordLatency(request, Stage::CacheLookup, lookup_us);
             stats_.completed_requests.fetch_add(1, std::memory_order_relaxed);
+            complete(request, std::move(result), start_time);
+            return std::nullopt;
+        }
+        etw::cacheMiss(request.id, lookup_us);
+    }
 
-            // Update timing stats
-            auto end_time = std::chrono::steady_clock::now();
-            auto duration_ms =
-                std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time)
-                    .count();
-            stats_.total_processing_time_ms.fetch_add(static_cast<uint64_t>(duration_ms),
-                                                      std::memory_order_relaxed);
-
-            // Invoke callback
-            if (request.callback && !queue_.isStopped()) {
-                try {
-                    request.callback(std::move(result));
-                } catch (...) {
-                    // Ignore callback exceptions
-                }
+    // Reads below share the source's volume with scans and other readers; a
+    // request cancelled while waiting for its turn is dropped here
+    fs::IoScheduler::Slot io_slot;
+    if (!request.source.memory_data) {
+        io_slot = fs::IoScheduler::instance().acquire(
+            request.source.path,
+            request.priority == Priority::Low ? fs::IoPriority::Background
+                                              : fs::IoPriority::Foreground,
+            request.stop.get_token());
+        if (!io_slot) {
+            return std::nullopt;
+        }
+    }
+
+    // Cache miss for an archive cover: pick and extract the cover entry
+    if (request.source.archive_cover && !request.source.memory_data) {
+        std::expected<archive::ArchiveCover, archive::ArchiveError> cover =
+            std::unexpected(archive::ArchiveError::DllNotFound);
+        if (archives_) {
+            auto extract_start = std::chrono::steady_clock::now();
+            cover = archives_->extractCover(request.source.path);
+            recordLatency(request, Stage::Read, elapsed_us(extract_start));
+        }
+        if (!cover) {
+            LOG_DEBUG("No cover for {}: {}", pathToUtf8(request.source.path),
+                      archive::to_string(cover.error()));
+            result.error = std::string(archive::to_string(cover.error()));
+            stats_.failed_requests.fetch_add(1, std::memory_order_relaxed);
+            complete(request, std::move(result), start_time);
+            return std::nullopt;
+        }
+        request.source.archive_entry =
+            archive::VirtualPath(request.source.path, cover->entry_path);
+        request.source.memory_data = std::move(cover->data);
+    }
+
+    // Cache miss for a folder: pick the images its mosaic shows
+    std::vector<FolderImage> folder_images;
+    if (request.source.folder_mosaic) {
+        auto list_start = std::chrono::steady_clock::now();
+        folder_images = list_folder_images(request.source.path);
+        recordLatency(request, Stage::Read, elapsed_us(list_start));
+        if (folder_images.empty()) {
+            result.error = "no images";
+            stats_.failed_requests.fetch_add(1, std::memory_order_relaxed);
+            complete(request, std::move(result), start_time);
+            return std::nullopt;
+        }
+    }
+
+    // Cache miss for an archive entry: extract it now, on this worker
+    if (request.source.archive_entry && !request.source.memory_data) {
+        std::expected<std::vector<uint8_t>, archive::ArchiveError> data =
+            std::unexpected(archive::ArchiveError::DllNotFound);
+        if (archives_) {
+            auto extract_start = std::chrono::steady_clock::now();
+            data = archives_->extractToMemory(*request.source.archive_entry);
+            recordLatency(request, Stage::Read, elapsed_us(extract_start));
+        }
+        if (!data) {
+            LOG_WARN("Failed to extract {} from archive: {}", pathToUtf8(request.source.path),
+                     archive::to_string(data.error()));
+            result.error = std::string(archive::to_string(data.error()));
+            stats_.failed_requests.fetch_add(1, std::memory_order_relaxed);
+            complete(request, std::move(result), start_time);
+            return std::nullopt;
+        }
+        request.source.memory_data = std::move(*data);
+    }
+    if (request.source.memory_data) {
+        request.source_charge.set(request.source.memory_data->size());
+    }
+
+    // Cache miss for a plain file: read it here so the decode worker never
+    // waits on the disk. Very large files are left to be streamed by the decoder.
+    PreparedRequest prepared{.folder_images = std::move(folder_images),
+                             .start_time = start_time};
+    if (request.source.is_file()) {
+        auto read_start = std::chrono::steady_clock::now();
+        if (auto data = read_source(request.source)) {
+            prepared.file_data = std::move(*data);
+            recordLatency(request, Stage::Read, elapsed_us(read_start));
+        }
+    }
+    request.timeline.mark(Hop::Read);
+    if (abandoned(request)) {
+        return std::nullopt;
+    }
+
+    // Identical content cached under another path: reuse its thumbnail without decoding
+    auto dedupe_start = std::chrono::steady_clock::now();
+    if (cache_ && is_cacheable && !request.source.folder_mosaic &&
+        cache_->config().deduplicate) {
+        if (request.source.memory_data) {
+            prepared.content_hash = cache::contentFingerprint(*request.source.memory_data);
+        } else if (!prepared.file_data.empty()) {
+            prepared.content_hash = cache::contentFingerprint(prepared.file_data.bytes());
+        } else if (auto fingerprint = cache::contentFingerprint(request.source.path)) {
+            prepared.content_hash = std::move(*fingerprint);
+        }
+    }
+    io_slot.release();
+    if (!prepared.content_hash.empty()) {
+        auto shared = cache_->getThumbnailByContent(request.source.path, prepared.content_hash,
+                                                    request.source.stamp);
+        lookup_us += elapsed_us(dedupe_start);
+        if (shared) {
+            result.thumbnail = std::move(*shared);
+            if (auto res = cache_->getImageResolution(request.source.path, request.source.stamp)) {
+                result.original_width = res->width;
+                result.original_height = res->height;
             }
-            return;
+
+            recordLatency(request, Stage::CacheLookup, lookup_us);
+            stats_.completed_requests.fetch_add(1, std::memory_order_relaxed);
+            complete(request, std::move(result), start_time);
+            return std::nullopt;
+        }
+    }
+
+    if (cache_ && is_cacheable) {
+        recordLatency(request, Stage::CacheLookup, lookup_us);
+    }
+    prepared.request = std::move(request);
+    return prepared;
+}
+
+std::optional<ThumbnailRequest> ThumbnailGenerator::processRequest(PreparedRequest& prepared,
+                                                                   image::WicDecoder& decoder) {
+    ScopedTrace trace("thumbnail decode", "thumbnail");
+    auto& request = prepared.request;
+
+    // Cancellation after the I/O stage took the request, or a newer epoch:
+    // stop at the next checkpoint and drop the result
+    std::stop_token stop = request.stop.get_token();
+    auto cancelled = [this, &request] {
+        if (!abandoned(request)) {
+            return false;
         }
+        etw::decodeCancelled(request.id);
+        return true;
+    };
+    if (cancelled()) {
+        return std::nullopt;
     }
 
-    // Decode image: try plugins first, then fall back to WIC
+    // One sniff of the first bytes decides the decoder, whatever the file is
+    // called; a folder has no bytes of its own, its mosaic is composed instead
+    bool folder = request.source.folder_mosaic;
+    image::DecoderChoice choice = folder ? image::DecoderChoice{} : chooseDecoder(prepared);
+
+    // With mipmap levels the full size is generated and stored, and the
+    // level for the requested size is scaled from it
+    bool is_cacheable = request.source.is_cacheable();
+    bool mipmapped = cache_ && is_cacheable && cache_->config().mip_levels > 1;
+    uint32_t generate_size = mipmapped ? cache_->config().mip_base_size : request.target_size;
+
+    // Formats without a built-in codec are the slow ones (RAW, HEIC, plugins);
+    // Explorer may already have thumbnailed the file, which costs one cache read
+    auto decode_start = std::chrono::steady_clock::now();
     std::expected<image::DecodedImage, image::DecodeError> decode_result =
         std::unexpected(image::DecodeError::UnsupportedFormat);
+    bool from_shell = false;
+    if (config_.shell_cache && !folder && !choice.native && request.source.is_file()) {
+        if (auto cached = image::shellCachedThumbnail(request.source.path, generate_size)) {
+            decode_result = std::move(cached->image);
+            from_shell = true;
+            stats_.shell_cache_hits.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 
-    if (plugins_) {
-        std::string ext = pathToUtf8(request.source.path.extension());
-        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
-            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-        });
-
-        if (request.source.memory_data && plugins_->supportsExtension(ext)) {
-            auto plugin_result = plugins_->decode(
-                request.source.memory_data->data(),
-                request.source.memory_data->size(), ext);
-            if (plugin_result) {
-                decode_result = std::move(*plugin_result);
-            }
-        } else if (!request.source.memory_data && plugins_->supportsExtension(ext)) {
-            // Read file into memory for plugin decode
-            std::ifstream file(request.source.path, std::ios::binary | std::ios::ate);
-            if (file) {
-                auto file_size = file.tellg();
-                file.seekg(0, std::ios::beg);
-                std::vector<uint8_t> data(static_cast<size_t>(file_size));
-                if (file.read(reinterpret_cast<char*>(data.data()), file_size)) {
-                    auto plugin_result = plugins_->decode(data.data(), data.size(), ext);
-                    if (plugin_result) {
-                        decode_result = std::move(*plugin_result);
-                    }
-                }
-            }
+    // Progressive mode: show a preview now, refine once every first pass is done
+    if (config_.progressive && !request.refine && !from_shell &&
+        deliverPreview(prepared, decoder, choice)) {
+        return std::move(request);
+    }
+
+    ThumbnailResult result{
+        .path = request.source.path,
+        .thumbnail = std::nullopt,
+        .error = std::nullopt,
+    };
+
+    // In-memory bytes: extracted archive entry, raw memory source or prefetched file
+    std::span<const uint8_t> source_data;
+    if (request.source.memory_data) {
+        source_data = *request.source.memory_data;
+    } else if (!prepared.file_data.empty()) {
+        source_data = prepared.file_data.bytes();
+    }
+
+    // Decode image with the chosen plugin or built-in codec, falling back to WIC
+    uint32_t original_width = 0;
+    uint32_t original_height = 0;
+    if (folder) {
+        decode_result = composeFolder(prepared, decoder, generate_size);
+    }
+
+    // Plugin and built-in codec decodes read from memory; a file too large
+    // to prefetch is mapped for them
+    plugin::PluginManager* plugins = decoders_ ? decoders_->plugins() : nullptr;
+    const image::NativeDecoder* native = choice.native;
+    bool use_plugin = choice.kind == image::DecoderKind::Plugin && plugins;
+    std::optional<MappedFile> file;
+    std::span<const uint8_t> decode_data = source_data;
+    if (!decode_result && (use_plugin || native) && decode_data.empty() &&
+        (file = MappedFile::open(request.source.path))) {
+        decode_data = file->bytes();
+    }
+
+    // Both allocate the full image (or a DCT-reduced one) before scaling;
+    // the header says how large, and huge images wait for each other here
+    std::optional<DecodeAdmission::Permit> permit;
+    if (!decode_result && !decode_data.empty()) {
+        permit = admitDecode(decode_data, choice, generate_size, stop);
+        if (!permit && cancelled()) {
+            return std::nullopt;
         }
     }
 
-    // Fallback to WIC if plugin decode failed
-    if (!decode_result) {
-        if (request.source.memory_data) {
-            decode_result = decoder.decodeFromMemory(*request.source.memory_data);
+    // Plugins that honour the size hint decode at reduced resolution
+    if (!decode_result && use_plugin && !decode_data.empty()) {
+        const std::string& ext = choice.plugin_extension;
+        // One thread each: thumbnails already decode in parallel on the workers
+        NiveDecodeHints hints = {
+            .target_width = generate_size,
+            .target_height = generate_size,
+            .max_threads = 1,
+        };
+        std::optional<plugin::HintedImage> plugin_result =
+            plugins->decodeHinted(decode_data.data(), decode_data.size(), ext, hints);
+        if (plugin_result) {
+            original_width = plugin_result->info.source_width;
+            original_height = plugin_result->info.source_height;
+            decode_result = std::move(plugin_result->image);
+        }
+    }
+
+    // libjpeg-turbo / libspng, when built in: no COM round trips, and JPEG is
+    // reduced by DCT scaling. Anything they reject (CMYK JPEG) goes on to WIC.
+    if (!decode_result && native && !decode_data.empty() && !cancelled()) {
+        if (auto source = native->decodeThumbnailFromMemory(decode_data, generate_size)) {
+            original_width = source->source_width;
+            original_height = source->source_height;
+            decode_result = std::move(source->image);
+        }
+    }
+
+    // Fallback to WIC if plugin and native decodes failed (plugin decodes cannot be interrupted).
+    // WIC decodes straight to the generated size, from the embedded EXIF
+    // thumbnail or a reduced-resolution decode when either is large enough.
+    if (!decode_result && !folder && !cancelled()) {
+        auto source = source_data.empty()
+                          ? decoder.decodeThumbnail(request.source.path, generate_size, stop)
+                          : decoder.decodeThumbnailFromMemory(source_data, generate_size, stop);
+        if (source) {
+            original_width = source->source_width;
+            original_height = source->source_height;
+            decode_result = std::move(source->image);
         } else {
-            decode_result = decoder.decode(request.source.path);
+            decode_result = std::unexpected(source.error());
         }
     }
+    if (cancelled()) {
+        return std::nullopt;
+    }
+    recordLatency(request, Stage::Decode, elapsed_us(decode_start));
+    request.timeline.mark(Hop::Decoded);
+
+    // The embedded profile is read while the bytes are still at hand; the
+    // conversion waits until the image is down to thumbnail size
+    image::ColorProfile profile;
+    if (config_.color_management && decode_result && !folder && !from_shell) {
+        profile = source_data.empty() ? image::readEmbeddedProfile(request.source.path)
+                                      : image::readEmbeddedProfile(source_data);
+    }
+
+    // Prefetched bytes are no longer needed; release them before scaling
+    prepared.file_data.close();
 
     if (!decode_result) {
         result.error = std::string(image::to_string(decode_result.error()));
         stats_.failed_requests.fetch_add(1, std::memory_order_relaxed);
     } else {
-        // Store original dimensions for cache
-        uint32_t original_width = decode_result->width();
-        uint32_t original_height = decode_result->height();
+        // Generate thumbnail (WIC results already fit, plugin results may be larger)
+        auto scale_start = std::chrono::steady_clock::now();
+        std::expected<image::DecodedImage, image::DecodeError> thumb_result =
+            std::unexpected(image::DecodeError::InternalError);
+        bool bgra = decode_result->format() == image::PixelFormat::BGRA32;
+        if (std::max(decode_result->width(), decode_result->height()) <= generate_size && bgra) {
+            thumb_result = std::move(*decode_result);
+        } else {
+            // Large outputs are where the CPU resample costs most; the scaler
+            // may batch them with other workers', and any failure falls back
+            if (scaler_ && bgra && generate_size >= config_.offload_scale_min_size) {
+                thumb_result = scaler_->scaleThumbnail(*decode_result, generate_size, stop);
+            }
+            if (!thumb_result && thumb_result.error() != image::DecodeError::Cancelled) {
+                thumb_result = image::generateThumbnail(*decode_result, generate_size, {}, stop);
+            }
+        }
+        if (thumb_result && !profile.isSrgb()) {
+            // Kept unconverted if the profile is unusable
+            auto converted = image::ColorTransformCache::instance().convert(
+                *thumb_result, profile, image::ColorProfile(), stop);
+            if (converted) {
+                thumb_result = std::move(*converted);
+            }
+        }
+        if (cancelled()) {
+            return std::nullopt;
+        }
+        recordLatency(request, Stage::Scale, elapsed_us(scale_start));
+        request.timeline.mark(Hop::Scaled);
 
-        // Generate thumbnail
-        auto thumb_result = image::generateThumbnail(*decode_result, request.target_size);
+        // Free the full-size image and let the next large decode in
+        *decode_result = image::DecodedImage();
+        permit.reset();
 
         if (thumb_result) {
-            // Save to cache before moving (only for file-based sources)
-            if (cache_ && is_file_source) {
-                // Use synchronous putThumbnail; worker threads can handle the blocking
-                auto cache_result = cache_->putThumbnail(request.source.path, *thumb_result,
-                                                         original_width, original_height);
-                // Cache failures are not critical, just log them
-                if (!cache_result) {
-                    LOG_DEBUG("Failed to cache thumbnail for {}", pathToUtf8(request.source.path));
-                }
+            // Save to cache before moving (files and archive entries)
+            if (cache_ && is_cacheable) {
+                // Compresses on this worker; the row is committed by a batched writer.
+                // The perceptual hash costs one pass over the thumbnail's pixels.
+                auto put_start = std::chrono::steady_clock::now();
+                auto cache_result = cache_->putThumbnail(
+                    request.source.path, *thumb_result, original_width, original_height,
+                    request.source.stamp, prepared.content_hash,
+                    image::differenceHash(*thumb_result));
+                auto put_us = elapsed_us(put_start);
+                recordLatency(request, Stage::CacheWrite, put_us);
+                request.timeline.mark(Hop::CacheWritten);
+                // Cache failures are not critical; the event records them
+                etw::cacheWrite(request.id, cache_result.has_value(), put_us);
             }
 
             result.thumbnail = std::move(*thumb_result);
+            if (mipmapped &&
+                cache_->thumbnailLevel(request.target_size) != cache_->config().mip_base_size) {
+                // Just stored, so this is a memory tier hit
+                if (auto level = cache_->getThumbnail(request.source.path, request.source.stamp,
+                                                      request.target_size)) {
+                    result.thumbnail = std::move(*level);
+                }
+            }
             result.original_width = original_width;
             result.original_height = original_height;
             stats_.completed_requests.fetch_add(1, std::memory_order_relaxed);
@@ -324,15 +1219,176 @@ void ThumbnailGenerator::processRequest(ThumbnailRequest& request, image::WicDec
         }
     }
 
+    complete(request, std::move(result), prepared.start_time);
+    return std::nullopt;
+}
+
+std::expected<image::DecodedImage, image::DecodeError>
+ThumbnailGenerator::composeFolder(PreparedRequest& prepared, image::WicDecoder& decoder,
+                                  uint32_t size) {
+    std::stop_token stop = prepared.request.stop.get_token();
+    const uint32_t gap = std::max(size / 64, 2u);
+    if (size <= gap * kFolderMosaicColumns) {
+        return std::unexpected(image::DecodeError::InternalError);
+    }
+    const uint32_t cell = (size - gap) / kFolderMosaicColumns;
+
+    image::DecodedImage mosaic(size, size, image::PixelFormat::BGRA32);
+    for (uint32_t y = 0; y < size; ++y) {
+        std::fill_n(reinterpret_cast<uint32_t*>(mosaic.row(y)), size, kFolderMosaicBackground);
+    }
+
+    // Tiles come from the images' own cached thumbnails where they exist;
+    // the rest are decoded straight to tile size and not cached
+    size_t placed = 0;
+    for (const auto& folder_image : prepared.folder_images) {
+        if (stop.stop_requested()) {
+            return std::unexpected(image::DecodeError::Cancelled);
+        }
+        std::optional<image::DecodedImage> tile;
+        if (cache_) {
+            if (auto cached = cache_->getThumbnail(folder_image.path, folder_image.stamp, cell)) {
+                tile = std::move(*cached);
+            }
+        }
+        if (!tile) {
+            if (auto source = decoder.decodeThumbnail(folder_image.path, cell, stop)) {
+                tile = std::move(source->image);
+            }
+        }
+        if (!tile) {
+            continue;
+        }
+        auto covered = image::scaleImage(*tile, cell, cell,
+                                         {.mode = image::ScaleMode::Area,
+                                          .fit = image::FitMode::Cover},
+                                         stop);
+        if (!covered || covered->width() < cell || covered->height() < cell) {
+            continue;
+        }
+        auto column = static_cast<uint32_t>(placed % kFolderMosaicColumns);
+        auto row = static_cast<uint32_t>(placed / kFolderMosaicColumns);
+        blit_tile(mosaic, *covered, column * (cell + gap), row * (cell + gap), cell);
+        ++placed;
+    }
+    if (placed == 0) {
+        return std::unexpected(image::DecodeError::CorruptedData);
+    }
+    return mosaic;
+}
+
+std::optional<DecodeAdmission::Permit>
+ThumbnailGenerator::admitDecode(std::span<const uint8_t> data, const image::DecoderChoice& choice,
+                                uint32_t size, std::stop_token stop) {
+    uint64_t bytes = 0;
+    if (admission_.budget() != 0) {
+        // Headers only; an unreadable one is left for the decode to report
+        std::optional<image::ImageInfo> info;
+        plugin::PluginManager* plugins = decoders_ ? decoders_->plugins() : nullptr;
+        if (choice.kind == image::DecoderKind::Plugin && plugins) {
+            info = plugins->getImageInfo(data.data(), data.size(), choice.plugin_extension);
+        } else if (choice.native) {
+            if (auto native_info = choice.native->getInfoFromMemory(data)) {
+                info = *native_info;
+            }
+        }
+        if (info) {
+            bytes = decode_footprint(*info, choice.format, choice.native != nullptr, size);
+        }
+    }
+
+    bool waited = false;
+    auto permit = admission_.acquire(bytes, std::move(stop), &waited);
+    if (waited) {
+        stats_.admission_waits.fetch_add(1, std::memory_order_relaxed);
+    }
+    return permit;
+}
+
+image::DecoderChoice ThumbnailGenerator::chooseDecoder(const PreparedRequest& prepared) const {
+    const auto& decoders = decoders_ ? *decoders_ : image::DecoderRegistry::builtin();
+    const auto& source = prepared.request.source;
+    // An archive cover is judged by its entry, not the archive's extension
+    std::string ext = pathToUtf8(
+        source.archive_entry
+            ? std::filesystem::path(source.archive_entry->internal_path()).extension()
+            : source.path.extension());
+
+    if (source.memory_data) {
+        return decoders.choose(*source.memory_data, ext);
+    }
+    if (!prepared.file_data.empty()) {
+        return decoders.choose(prepared.file_data.bytes(), ext);
+    }
+    // Too large to prefetch: read just the header
+    return decoders.choose(source.path);
+}
+
+bool ThumbnailGenerator::deliverPreview(PreparedRequest& prepared, image::WicDecoder& decoder,
+                                        const image::DecoderChoice& choice) {
+    auto& request = prepared.request;
+
+    // Plain files on the WIC route only; background work has nobody waiting
+    if (!request.source.is_file() || request.priority == Priority::Low ||
+        choice.kind == image::DecoderKind::Plugin) {
+        return false;
+    }
+
+    auto preview_start = std::chrono::steady_clock::now();
+    std::stop_token stop = request.stop.get_token();
+    auto preview =
+        prepared.file_data.empty()
+            ? decoder.decodePreview(request.source.path, request.target_size, stop)
+            : decoder.decodePreviewFromMemory(prepared.file_data.bytes(), request.target_size,
+                                              stop);
+    // No fast route (e.g. PNG): the full decode below is the only pass
+    if (!preview || stop.stop_requested()) {
+        return false;
+    }
+    recordLatency(request, Stage::Preview, elapsed_us(preview_start));
+
+    if (request.callback && !queue_.isStopped() && !queue_.isStale(request)) {
+        ThumbnailResult result{
+            .path = request.source.path,
+            .path_id = request.path_id,
+            .thumbnail = std::move(preview->image),
+            .error = std::nullopt,
+            .original_width = preview->source_width,
+            .original_height = preview->source_height,
+            .preview = true,
+            .request_id = request.id,
+            .timeline = request.timeline,
+        };
+        try {
+            request.callback(std::move(result));
+        } catch (...) {
+            // Ignore callback exceptions
+        }
+    }
+
+    // The refined pass reads the file again when its turn comes rather than
+    // holding the bytes while every other first pass runs
+    request.refine = true;
+    return true;
+}
+
+void ThumbnailGenerator::complete(ThumbnailRequest& request, ThumbnailResult result,
+                                  std::chrono::steady_clock::time_point start_time) {
     // Update timing stats
     auto end_time = std::chrono::steady_clock::now();
     auto duration_ms =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
     stats_.total_processing_time_ms.fetch_add(static_cast<uint64_t>(duration_ms),
                                               std::memory_order_relaxed);
+    recordLatency(request, Stage::Total, elapsed_us(start_time));
+    result.path_id = request.path_id;
+    result.request_id = request.id;
+    request.timeline.mark(Hop::Completed);
+    result.timeline = request.timeline;
 
-    // Invoke callback only if not stopped (avoid posting to destroyed window)
-    if (request.callback && !queue_.isStopped()) {
+    // Invoke callback only if not stopped (avoid posting to destroyed window);
+    // results of a stale epoch belong to a view that is gone
+    if (request.callback && !queue_.isStopped() && !queue_.isStale(request)) {
         try {
             request.callback(std::move(result));
         } catch (...) {
@@ -341,8 +1397,156 @@ void ThumbnailGenerator::processRequest(ThumbnailRequest& request, image::WicDec
     }
 }
 
+void ThumbnailGenerator::recordLatency(const ThumbnailRequest& request, Stage stage,
+                                       uint64_t us) {
+    bool archive = request.source.archive_entry || request.source.archive_cover;
+    SourceKind kind = archive                      ? SourceKind::Archive
+                      : request.source.memory_data ? SourceKind::Memory
+                                                   : SourceKind::File;
+    stats_.latencies.record(stage, kind, formatFromPath(request.source.path), us);
+}
+
+void ThumbnailGenerator::enqueue(ThumbnailRequest request) {
+    if (request.path_id == kNoPathId) {
+        request.path_id = internPath(request.source.path);
+    }
+    if (size_t shed = queue_.push(std::move(request)); shed > 0) {
+        stats_.shed_requests.fetch_add(shed, std::memory_order_relaxed);
+    }
+}
+
 RequestId ThumbnailGenerator::nextRequestId() {
     return next_id_.fetch_add(1, std::memory_order_relaxed);
 }
 
+RequestId ThumbnailGenerator::submit(ThumbnailRequest request) {
+    auto id = request.id;
+    stats_.total_requests.fetch_add(1, std::memory_order_relaxed);
+    if (request.source.memory_data) {
+        request.source_charge.set(request.source.memory_data->size());
+    }
+    if (config_.trace_requests) {
+        request.timeline.start(request.created_at);
+        request.timeline.mark(Hop::Queued);
+    }
+
+    request.epoch = queue_.epoch();
+    request.path_id = internPath(request.source.path);
+    auto key = job_key(request);
+    std::shared_ptr<Job> job;
+    RequestId raise_id = 0;
+    Priority raise_priority = request.priority;
+    {
+        std::lock_guard lock(jobs_mutex_);
+        if (auto it = jobs_.find(key); it != jobs_.end()) {
+            // A job without a view index is never dropped by the viewport, so
+            // any caller may attach; otherwise only callers at the same index
+            // A stale job is dropped unanswered, so only jobs of this epoch qualify
+            auto& existing = it->second;
+            if (existing->epoch == request.epoch &&
+                (existing->view_index == kNoViewIndex ||
+                 existing->view_index == request.view_index)) {
+                existing->subscribers.emplace_back(id, std::move(request.callback));
+                subscriptions_.emplace(id, existing);
+                if (static_cast<uint8_t>(request.priority) >
+                    static_cast<uint8_t>(existing->priority)) {
+                    existing->priority = request.priority;
+                    raise_id = existing->request_id;
+                    raise_priority = request.priority;
+                }
+                job = existing;
+            }
+        }
+
+        if (!job) {
+            job = std::make_shared<Job>(Job{
+                .key = key,
+                .request_id = id,
+                .view_index = request.view_index,
+                .priority = request.priority,
+                .epoch = request.epoch,
+            });
+            job->subscribers.emplace_back(id, std::move(request.callback));
+            jobs_.insert_or_assign(job->key, job);
+            subscriptions_.emplace(id, job);
+
+            auto guard = std::make_shared<ReleaseGuard>([this, weak = std::weak_ptr<Job>(job)] {
+                if (auto released = weak.lock()) {
+                    std::lock_guard guard_lock(jobs_mutex_);
+                    detach(released);
+                }
+            });
+            request.callback = [this, job, guard](ThumbnailResult result) {
+                deliver(job, std::move(result));
+            };
+        } else {
+            stats_.coalesced_requests.fetch_add(1, std::memory_order_relaxed);
+            LOG_TRACE("ThumbnailGenerator::submit: request {} joins request {}", id,
+                      job->request_id);
+        }
+    }
+
+    if (job->request_id == id) {
+        enqueue(std::move(request));
+    } else if (raise_id != 0) {
+        (void)queue_.updatePriority(raise_id, raise_priority);
+    }
+    return id;
+}
+
+void ThumbnailGenerator::deliver(const std::shared_ptr<Job>& job, ThumbnailResult result) {
+    std::vector<std::pair<RequestId, ThumbnailCallback>> subscribers;
+    {
+        std::lock_guard lock(jobs_mutex_);
+        if (result.preview) {
+            // The job stays open for its refined pass (and new subscribers)
+            subscribers = job->subscribers;
+        } else {
+            detach(job);
+            subscribers = std::move(job->subscribers);
+            job->subscribers.clear();
+        }
+    }
+
+    for (size_t i = 0; i < subscribers.size(); ++i) {
+        auto& callback = subscribers[i].second;
+        if (!callback) {
+            continue;
+        }
+        if (i + 1 == subscribers.size()) {
+            callback(std::move(result));
+            break;
+        }
+        // Every subscriber but the last views the same pixels
+        ThumbnailResult copy{
+            .path = result.path,
+            .path_id = result.path_id,
+            .thumbnail = std::nullopt,
+            .error = result.error,
+            .original_width = result.original_width,
+            .original_height = result.original_height,
+            .preview = result.preview,
+            .request_id = result.request_id,
+            .timeline = result.timeline,
+        };
+        if (result.thumbnail) {
+            copy.thumbnail = result.thumbnail->share();
+        }
+        try {
+            callback(std::move(copy));
+        } catch (...) {
+            // Ignore callback exceptions
+        }
+    }
+}
+
+void ThumbnailGenerator::detach(const std::shared_ptr<Job>& job) {
+    if (auto it = jobs_.find(job->key); it != jobs_.end() && it->second == job) {
+        jobs_.erase(it);
+    }
+    for (const auto& subscriber : job->subscribers) {
+        subscriptions_.erase(subscriber.first);
+    }
+}
+
 }  // namespace nive::thumbnail
@@ -1,38 +1,89 @@
 /// @file thumbnail_generator.hpp
 /// @brief Asynchronous thumbnail generation service
 ///
-/// Manages a pool of worker threads for generating thumbnails
-/// from image files.
+/// Runs a two-stage pipeline: a small I/O pool that checks the cache and
+/// reads source bytes, feeding a decode pool that decodes, scales and stores.
 
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "../fs/file_metadata.hpp"
+#include "decode_admission.hpp"
+#include "decode_stage.hpp"
+#include "latency_stats.hpp"
+#include "request_trace.hpp"
 #include "thumbnail_queue.hpp"
 #include "thumbnail_request.hpp"
 
+namespace nive::archive {
+class ArchiveManager;
+}
+
 namespace nive::cache {
 class CacheManager;
 }
 
 namespace nive::image {
+class DecoderRegistry;
+class IThumbnailScaler;
+struct DecoderChoice;
 class WicDecoder;
 }
 
-namespace nive::plugin {
-class PluginManager;
-}
-
 namespace nive::thumbnail {
 
 /// @brief Configuration for thumbnail generator
 struct GeneratorConfig {
-    uint32_t worker_count = 4;  // Number of worker threads
+    uint32_t worker_count = 0;     // Decode threads (0 = hardware_concurrency())
+    uint32_t io_worker_count = 4;  // Cache lookup and file read threads (see fs::IoScheduler)
     uint32_t default_thumbnail_size = 256;
-    size_t max_queue_size = 1000;  // Maximum pending requests
+    size_t max_queue_size = 1000;  // Maximum pending requests (0 = unbounded)
+    uint64_t max_queued_bytes = 256ull * 1024 * 1024;  // memory_data bytes pending (0 = unbounded)
+    size_t max_prefetched = 0;     // Requests read ahead of decoding (0 = 2 per decode thread)
+    // Full-resolution decode buffers held at once, estimated from the image
+    // header before each plugin or built-in codec decode (0 = unbounded)
+    uint64_t max_decode_bytes = 1024ull * 1024 * 1024;
+
+    // Adaptive decode threads: worker_count is the starting point and the
+    // count moves between min_workers and max_workers (see controllerThread)
+    bool adaptive = false;
+    uint32_t min_workers = 1;
+    uint32_t max_workers = 0;  // 0 = hardware_concurrency()
+    std::chrono::milliseconds adapt_interval{1000};
+
+    // Progressive display: a cache miss for a plain file first delivers a fast
+    // preview (ThumbnailResult::preview), then a refined pass queued behind
+    // every other first pass of the same priority
+    bool progressive = false;
+
+    // Convert thumbnails of images with an embedded ICC profile to sRGB before
+    // they are cached, so the cache holds display-ready pixels
+    bool color_management = false;
+
+    // Final resamples to at least this size go to the scaler set by setScaler()
+    uint32_t offload_scale_min_size = 512;
+
+    // Before decoding a file no built-in codec handles, take the thumbnail
+    // Explorer cached for it, if any (see image::shellCachedThumbnail)
+    bool shell_cache = false;
+
+    // Decode threads allowed to take work in efficiency mode (see setEfficiencyMode)
+    uint32_t efficient_workers = 1;
+
+    // Time each request at every hop (RequestTimeline) and keep the slowest
+    // in GeneratorStats::slowest; a refined pass overwrites its first pass's hops
+    bool trace_requests = false;
 };
 
 /// @brief Statistics for thumbnail generation
@@ -41,7 +92,24 @@ struct GeneratorStats {
     std::atomic<uint64_t> completed_requests{0};
     std::atomic<uint64_t> failed_requests{0};
     std::atomic<uint64_t> cancelled_requests{0};
+    std::atomic<uint64_t> coalesced_requests{0};  // Attached to an identical pending request
+    std::atomic<uint64_t> shed_requests{0};       // Dropped to keep the queue within its limits
+    std::atomic<uint64_t> shell_cache_hits{0};    // Taken from the Windows thumbnail cache
+    std::atomic<uint64_t> admission_waits{0};     // Decodes that waited for decode memory
     std::atomic<uint64_t> total_processing_time_ms{0};
+    StageLatencies latencies;  // Per-stage histograms by source kind and format
+    SlowRequestLog slowest;    // Slowest traced requests (see GeneratorConfig::trace_requests)
+};
+
+/// @brief Requests in each pipeline stage, to show which one is the bottleneck
+struct PipelineDepth {
+    size_t queued = 0;      // Waiting for an I/O worker
+    size_t reading = 0;     // Cache lookup or file read in progress
+    size_t prefetched = 0;  // Read, waiting for a decode worker
+    size_t decoding = 0;    // Decode, scale or cache write in progress
+    uint64_t stolen = 0;    // Requests a decode worker took from another's deque
+    uint32_t io_workers = 0;
+    uint32_t decode_workers = 0;  // Active decode threads (adaptive: current target)
 };
 
 /// @brief Asynchronous thumbnail generation service
@@ -49,11 +117,23 @@ struct GeneratorStats {
 /// Manages thumbnail generation using dedicated worker threads and a priority queue.
 /// Thread-safe for all public methods.
 ///
-/// Async pattern: Queue + Worker Threads
+/// Async pattern: Queue + Staged Worker Threads
 /// Uses dedicated std::jthread workers (not the global ThreadPool) because:
 /// - Priority queue allows reordering pending requests (visible-first thumbnails)
-/// - Dedicated workers keep CPU-bound decoding separate from general tasks
-/// - Worker count is tunable independently of the global pool
+/// - I/O workers take requests in priority order, answer cache hits and read
+///   file bytes, so decode workers never block on slow (network) storage.
+///   Reads take a slot from fs::IoScheduler, which limits how many run at
+///   once on each volume (fewer on a share or HDD than on an SSD). On an HDD
+///   a worker takes a screenful of same-priority requests at once and reads
+///   them in file ID order, which follows their placement on the disk
+/// - Decode workers share the prefetched requests through a work-stealing
+///   DecodeStage, sized to the CPU count by default
+/// - Worker counts are tunable independently of the global pool
+///
+/// File and lazy archive requests are coalesced by path and size: a request
+/// made while an identical one is queued or in flight attaches its callback
+/// to that job instead of decoding again. Each caller keeps its own request
+/// ID; cancelling one only detaches its callback while others still wait.
 class ThumbnailGenerator {
 public:
     /// @brief Construct generator with configuration
@@ -88,6 +168,24 @@ public:
                                     uint32_t size = 0  // 0 = use default
     );
 
+    /// @brief Request thumbnail generation for an enumerated file
+    /// @param file File metadata from a directory scan
+    /// @param callback Callback when thumbnail is ready
+    /// @param priority Request priority
+    /// @param size Thumbnail size (max dimension)
+    /// @param view_index Position in the item view, for viewport scheduling
+    /// @return Request ID for cancellation
+    ///
+    /// The metadata's mtime and size form the cache key, so the worker does
+    /// not stat the file again on lookup. An archive gets the thumbnail of its
+    /// cover image (see ArchiveManager::extractCover), cached under the
+    /// archive's own path; requires setArchiveManager(). A folder gets a 2x2
+    /// mosaic of its first images at no more than Low priority, cached under
+    /// the folder's path and mtime (see composeFolder).
+    [[nodiscard]] RequestId request(const fs::FileMetadata& file, ThumbnailCallback callback,
+                                    Priority priority = Priority::Normal, uint32_t size = 0,
+                                    size_t view_index = kNoViewIndex);
+
     /// @brief Request thumbnail generation from memory data
     /// @param virtual_path Virtual path for identification
     /// @param data Image data in memory
@@ -100,9 +198,43 @@ public:
                                               Priority priority = Priority::Normal,
                                               uint32_t size = 0);
 
-    /// @brief Cancel a pending request
+    /// @brief Request thumbnail generation for an archive entry
+    /// @param entry Virtual path of the entry (must be inside an archive)
+    /// @param callback Callback when thumbnail is ready
+    /// @param priority Request priority
+    /// @param size Thumbnail size (max dimension)
+    /// @param view_index Position in the item view, for viewport scheduling
+    /// @param archive_stamp Stamp of the archive when known (skips the cache stat)
+    /// @return Request ID for cancellation
+    ///
+    /// Extraction runs on a worker thread and is skipped when the cache
+    /// already holds the thumbnail. Requires setArchiveManager().
+    [[nodiscard]] RequestId
+    requestFromArchive(const archive::VirtualPath& entry, ThumbnailCallback callback,
+                       Priority priority = Priority::Normal, uint32_t size = 0,
+                       size_t view_index = kNoViewIndex,
+                       const std::optional<cache::SourceStamp>& archive_stamp = std::nullopt);
+
+    /// @brief Request thumbnail generation for an already extracted archive entry
+    /// @param entry Virtual path of the entry
+    /// @param data Entry contents (e.g. from ArchiveManager::extractBatch)
+    /// @param callback Callback when thumbnail is ready
+    /// @param priority Request priority
+    /// @param size Thumbnail size (max dimension)
+    /// @param archive_stamp Stamp of the archive when known (skips the cache stat)
+    /// @return Request ID for cancellation
+    [[nodiscard]] RequestId
+    requestFromArchive(const archive::VirtualPath& entry, std::vector<uint8_t> data,
+                       ThumbnailCallback callback, Priority priority = Priority::Normal,
+                       uint32_t size = 0,
+                       const std::optional<cache::SourceStamp>& archive_stamp = std::nullopt);
+
+    /// @brief Cancel a request
     /// @param id Request ID to cancel
     /// @return true if request was found and cancelled
+    ///
+    /// A request already being decoded stops at its next checkpoint and
+    /// produces no callback.
     bool cancel(RequestId id);
 
     /// @brief Cancel all requests for a path
@@ -110,51 +242,224 @@ public:
     /// @return Number of cancelled requests
     size_t cancelByPath(const std::filesystem::path& path);
 
-    /// @brief Cancel all pending requests
+    /// @brief Cancel all pending and in-flight requests
     /// @return Number of cancelled requests
     size_t cancelAll();
 
+    /// @brief Retire every request made so far, in O(1) (see ThumbnailQueue::advanceEpoch)
+    /// @return The new epoch
+    ///
+    /// Use instead of cancelAll() on navigation: the UI thread does not walk
+    /// the queue under the lock the workers pop from. Stale requests are
+    /// dropped by the workers and never call back, so no result of the old
+    /// view is posted.
+    uint64_t advanceEpoch();
+
     /// @brief Update priority of a pending request
     /// @param id Request ID
     /// @param new_priority New priority
     /// @return true if request was found and updated
     bool updatePriority(RequestId id, Priority new_priority);
 
+    /// @brief Reorder pending requests for a new viewport (see ThumbnailQueue::setViewport)
+    /// @param viewport Visible and kept index ranges, scroll direction and speed
+    /// @return Number of requests dropped
+    ///
+    /// Use instead of cancelAll() on scroll: requests that stay in range keep
+    /// their place in the queue.
+    size_t setViewport(const Viewport& viewport);
+
     /// @brief Get number of pending requests
     [[nodiscard]] size_t pendingCount() const;
 
+    /// @brief Get the in-memory source bytes held by pending requests
+    [[nodiscard]] uint64_t pendingBytes() const;
+
+    /// @brief Check if the queue is near max_queue_size or max_queued_bytes
+    ///
+    /// Past either limit the queue sheds its lowest-ranked requests, Low
+    /// priority first. Producers of bulk work (archive extraction) should
+    /// wait while this is true.
+    [[nodiscard]] bool isSaturated() const;
+
+    /// @brief Get number of pending and in-flight requests above Priority::Low
+    ///
+    /// Priority::Low requests run in background mode (lower CPU and I/O
+    /// priority); background producers should wait while this is non-zero.
+    [[nodiscard]] size_t urgentCount() const;
+
+    /// @brief Get number of pending and in-flight Priority::Low requests
+    [[nodiscard]] size_t backgroundCount() const;
+
+    /// @brief Get the number of requests in each pipeline stage
+    [[nodiscard]] PipelineDepth pipelineDepth() const;
+
+    /// @brief Enter or leave efficiency mode (window minimized, on battery)
+    ///
+    /// In efficiency mode at most GeneratorConfig::efficient_workers decode
+    /// threads take work, and every request runs in background mode under
+    /// EcoQoS as Priority::Low ones always do. Leaving it restores
+    /// worker_count; the adaptive controller moves on from there.
+    void setEfficiencyMode(bool enabled);
+
+    /// @brief Check if the generator is in efficiency mode
+    [[nodiscard]] bool efficiencyMode() const noexcept;
+
     /// @brief Get generator statistics
     [[nodiscard]] const GeneratorStats& stats() const noexcept;
 
     /// @brief Reset statistics
     void resetStats();
 
+    /// @brief Mark a result as taken by the UI thread and offer it to stats().slowest
+    /// @param result Result from a callback; untraced results are left alone
+    void recordDelivery(ThumbnailResult& result);
+
     /// @brief Set cache manager for thumbnail caching
     /// @param cache Pointer to cache manager (can be nullptr to disable caching)
     void setCacheManager(cache::CacheManager* cache) noexcept;
 
-    /// @brief Set plugin manager for plugin-based decoding
-    /// @param plugins Pointer to plugin manager (can be nullptr to disable)
-    void setPluginManager(plugin::PluginManager* plugins) noexcept;
+    /// @brief Set the registry that picks each image's decoder (plugins included)
+    /// @param decoders Pointer to decoder registry (nullptr: built-in decoders only)
+    void setDecoderRegistry(const image::DecoderRegistry* decoders) noexcept;
+
+    /// @brief Set archive manager for extracting archive entries
+    /// @param archives Pointer to archive manager (can be nullptr to disable)
+    void setArchiveManager(archive::ArchiveManager* archives) noexcept;
+
+    /// @brief Set a scaler to take over large thumbnail resamples (e.g. on the GPU)
+    /// @param scaler Pointer to scaler (nullptr: always scale on the decode worker)
+    /// @note Set before start(); the scaler must outlive the generator's workers
+    void setScaler(image::IThumbnailScaler* scaler) noexcept;
 
 private:
-    /// @brief Worker thread function
-    void workerThread(std::stop_token stop_token);
+    /// @brief I/O stage thread function
+    void ioThread(std::stop_token stop_token);
+
+    /// @brief Decode stage thread function
+    void workerThread(std::stop_token stop_token, size_t worker_index);
+
+    /// @brief Adjust the active decode thread count from recent measurements
+    ///
+    /// Grows while prepared requests back up behind busy decoders (and the
+    /// last step raised throughput), shrinks while decoders sit idle waiting
+    /// on I/O, and caps the count on battery power. Decisions are logged.
+    void controllerThread(std::stop_token stop_token);
+
+    /// @brief Park a decode thread while its index is above the active count
+    /// @return false once the thread should exit
+    [[nodiscard]] bool waitUntilActive(std::stop_token stop_token, size_t worker_index);
+
+    /// @brief Change the number of decode threads allowed to take work
+    void setActiveWorkers(uint32_t count);
+
+    /// @brief Decode threads to start with or return to (efficiency mode: the cap)
+    [[nodiscard]] uint32_t baseWorkers() const noexcept;
+
+    /// @brief Add a latency sample for a request's source kind and format
+    void recordLatency(const ThumbnailRequest& request, Stage stage, uint64_t us);
 
-    /// @brief Process a single thumbnail request
-    void processRequest(ThumbnailRequest& request, image::WicDecoder& decoder);
+    /// @brief Answer a request from the cache or read its source bytes
+    /// @return Request for the decode stage, or nullopt if it was completed here
+    [[nodiscard]] std::optional<PreparedRequest> prepareRequest(ThumbnailRequest& request);
+
+    /// @brief Decode, scale and cache a prepared request
+    /// @return Refined pass to queue once the request is finished (progressive mode)
+    [[nodiscard]] std::optional<ThumbnailRequest> processRequest(PreparedRequest& prepared,
+                                                                 image::WicDecoder& decoder);
+
+    /// @brief Composite the tiles of a folder mosaic (see ThumbnailSource::from_folder)
+    /// @param size Width and height of the mosaic
+    /// @return Mosaic, or an error if none of the folder's images could be read
+    [[nodiscard]] std::expected<image::DecodedImage, image::DecodeError>
+    composeFolder(PreparedRequest& prepared, image::WicDecoder& decoder, uint32_t size);
+
+    /// @brief Wait until the decode memory a source needs is free
+    /// @param data Source bytes, whose header gives the image dimensions
+    /// @return Permit to hold while decoding, or nullopt if the request was cancelled
+    [[nodiscard]] std::optional<DecodeAdmission::Permit>
+    admitDecode(std::span<const uint8_t> data, const image::DecoderChoice& choice, uint32_t size,
+                std::stop_token stop);
+
+    /// @brief Pick the decoder for a prepared request from its first bytes
+    [[nodiscard]] image::DecoderChoice chooseDecoder(const PreparedRequest& prepared) const;
+
+    /// @brief Deliver a fast preview for a first-pass request
+    /// @return true if a preview was delivered and the request needs a refined pass
+    [[nodiscard]] bool deliverPreview(PreparedRequest& prepared, image::WicDecoder& decoder,
+                                      const image::DecoderChoice& choice);
+
+    /// @brief Record timing and invoke the request's callback
+    void complete(ThumbnailRequest& request, ThumbnailResult result,
+                  std::chrono::steady_clock::time_point start_time);
 
     /// @brief Generate next unique request ID
     [[nodiscard]] RequestId nextRequestId();
 
+    /// @brief Callers waiting on one queued or in-flight request
+    struct Job {
+        uint64_t key = 0;          // Path id and size (see submit())
+        RequestId request_id = 0;  // The queued request doing the work
+        size_t view_index = kNoViewIndex;
+        Priority priority = Priority::Normal;
+        uint64_t epoch = 0;  // Epoch of the queued request
+        std::vector<std::pair<RequestId, ThumbnailCallback>> subscribers;
+    };
+
+    /// @brief Enqueue a request, or attach it to an identical pending job
+    /// @return The caller's request ID
+    [[nodiscard]] RequestId submit(ThumbnailRequest request);
+
+    /// @brief Push a request to the queue, counting the requests it sheds
+    void enqueue(ThumbnailRequest request);
+
+    /// @brief Check if a request was cancelled or belongs to a stale epoch
+    [[nodiscard]] bool abandoned(const ThumbnailRequest& request) const noexcept {
+        return request.stop.stop_requested() || queue_.isStale(request);
+    }
+
+    /// @brief Hand a result to every subscriber of a job
+    void deliver(const std::shared_ptr<Job>& job, ThumbnailResult result);
+
+    /// @brief Stop further attachments to a job (jobs_mutex_ held)
+    void detach(const std::shared_ptr<Job>& job);
+
     GeneratorConfig config_;
     ThumbnailQueue queue_;
+    std::unique_ptr<DecodeStage> stage_;
+    DecodeAdmission admission_;
+    std::vector<std::jthread> io_workers_;
     std::vector<std::jthread> workers_;
+    std::atomic<size_t> reading_{0};   // Requests inside prepareRequest()
+    std::atomic<size_t> decoding_{0};  // Requests inside processRequest()
+
+    // Decode threads started (adaptive: max_workers); those at or above
+    // active_workers_ are parked
+    uint32_t thread_count_ = 0;
+    std::atomic<uint32_t> active_workers_{0};
+    std::mutex active_mutex_;
+    std::condition_variable_any active_cv_;
+    std::jthread controller_;
+
+    // Stage timings sampled by the controller
+    std::atomic<uint64_t> io_time_us_{0};
+    std::atomic<uint64_t> io_samples_{0};
+    std::atomic<uint64_t> decode_time_us_{0};
+    std::atomic<uint64_t> decode_samples_{0};
     GeneratorStats stats_;
     std::atomic<RequestId> next_id_{1};
     std::atomic<bool> running_{false};
+    std::atomic<bool> efficient_{false};
     cache::CacheManager* cache_ = nullptr;
-    plugin::PluginManager* plugins_ = nullptr;
+    const image::DecoderRegistry* decoders_ = nullptr;
+    archive::ArchiveManager* archives_ = nullptr;
+    image::IThumbnailScaler* scaler_ = nullptr;
+
+    // Coalescing state. Never held while calling into queue_: the queue
+    // destroys dropped requests under its own lock, which releases their job.
+    std::mutex jobs_mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs_;
+    std::unordered_map<RequestId, std::shared_ptr<Job>> subscriptions_;  // Caller ID -> job
 };
 
 }  // namespace nive::thumbnail
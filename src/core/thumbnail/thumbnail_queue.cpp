@@ -5,183 +5,286 @@
 
 #include <algorithm>
 
+#include "../util/etw.hpp"
 #include "../util/logger.hpp"
-#include "../util/string_utils.hpp"
 
 namespace nive::thumbnail {
 
-void ThumbnailQueue::push(ThumbnailRequest request) {
+namespace {
+
+[[nodiscard]] bool is_urgent(Priority priority) noexcept {
+    return priority != Priority::Low;
+}
+
+[[nodiscard]] uint64_t data_bytes(const ThumbnailRequest& request) noexcept {
+    return request.source.memory_data ? request.source.memory_data->size() : 0;
+}
+
+}  // namespace
+
+void ThumbnailQueue::setLimits(size_t max_requests, uint64_t max_bytes) {
+    std::vector<ThumbnailRequest> dropped;
+    {
+        std::lock_guard lock(mutex_);
+        max_requests_ = max_requests;
+        max_bytes_ = max_bytes;
+        shed(dropped);
+    }
+}
+
+size_t ThumbnailQueue::push(ThumbnailRequest request) {
     auto id = request.id;
-    auto path = pathToUtf8(request.source.path);
+    std::vector<ThumbnailRequest> dropped;  // Destroyed after the lock is released
     {
         std::lock_guard lock(mutex_);
         if (stopped_) {
             LOG_WARN("ThumbnailQueue::push: queue is stopped, ignoring request {}", id);
-            return;
+            return 0;
+        }
+        if (viewport_) {
+            request.view_rank = viewport_->rank(request.view_index);
         }
-        queue_.push(std::move(request));
-        LOG_TRACE("ThumbnailQueue::push: added request {}, queue_size={}, path={}", id,
-                  queue_.size(), path);
+        etw::queuePush(id, static_cast<int>(request.priority), request.view_index);
+        insert(std::move(request));
+        shed(dropped);
     }
     cv_.notify_one();
+    return dropped.size();
 }
 
-void ThumbnailQueue::pushBatch(std::vector<ThumbnailRequest> requests) {
+size_t ThumbnailQueue::pushBatch(std::vector<ThumbnailRequest> requests) {
+    std::vector<ThumbnailRequest> dropped;
     {
         std::lock_guard lock(mutex_);
         if (stopped_) {
-            return;
+            return 0;
         }
         for (auto& req : requests) {
-            queue_.push(std::move(req));
+            if (viewport_) {
+                req.view_rank = viewport_->rank(req.view_index);
+            }
+            etw::queuePush(req.id, static_cast<int>(req.priority), req.view_index);
+            insert(std::move(req));
         }
+        shed(dropped);
     }
     cv_.notify_all();
+    return dropped.size();
 }
 
 std::optional<ThumbnailRequest> ThumbnailQueue::pop() {
+    std::vector<ThumbnailRequest> stale;  // Destroyed after the lock is released
     std::unique_lock lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopped_ || !heap_.empty(); });
 
-    LOG_TRACE("ThumbnailQueue::pop: waiting, queue_size={}, stopped={}", queue_.size(), stopped_);
-    cv_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
-    LOG_TRACE("ThumbnailQueue::pop: woke up, queue_size={}, stopped={}", queue_.size(), stopped_);
-
-    // Return immediately when stopped (don't process remaining items)
-    if (stopped_) {
-        LOG_DEBUG("ThumbnailQueue::pop: returning nullopt due to stopped");
-        return std::nullopt;
-    }
-
-    // Skip cancelled requests
-    while (!queue_.empty()) {
-        auto request = std::move(const_cast<ThumbnailRequest&>(queue_.top()));
-        queue_.pop();
+        // Return immediately when stopped (don't process remaining items)
+        if (stopped_) {
+            LOG_DEBUG("ThumbnailQueue::pop: returning nullopt due to stopped");
+            return std::nullopt;
+        }
 
-        if (cancelled_.find(request.id) == cancelled_.end()) {
-            LOG_TRACE("ThumbnailQueue::pop: returning request {}, remaining={}", request.id,
-                      queue_.size());
-            return request;
+        // Cancelled requests are removed from the heap; stale ones only sink,
+        // so once they reach the top nothing current is left
+        dropStaleTop(stale);
+        if (!heap_.empty()) {
+            break;
         }
-        LOG_DEBUG("ThumbnailQueue::pop: skipping cancelled request {}", request.id);
-        // Request was cancelled, try next one
     }
-
-    LOG_DEBUG("ThumbnailQueue::pop: queue empty after skipping cancelled, returning nullopt");
-    return std::nullopt;
+    auto request = removeAt(0);
+    start(request);
+    return request;
 }
 
 std::optional<ThumbnailRequest> ThumbnailQueue::tryPop() {
+    std::vector<ThumbnailRequest> stale;
     std::lock_guard lock(mutex_);
 
-    while (!queue_.empty()) {
-        auto request = std::move(const_cast<ThumbnailRequest&>(queue_.top()));
-        queue_.pop();
-
-        if (cancelled_.find(request.id) == cancelled_.end()) {
-            return request;
-        }
-        // Request was cancelled, try next one
+    dropStaleTop(stale);
+    if (heap_.empty()) {
+        return std::nullopt;
     }
+    auto request = removeAt(0);
+    start(request);
+    return request;
+}
 
-    return std::nullopt;
+std::vector<ThumbnailRequest> ThumbnailQueue::tryPopBatch(Priority priority, size_t max_count) {
+    std::vector<ThumbnailRequest> stale;
+    std::lock_guard lock(mutex_);
+
+    dropStaleTop(stale);
+    std::vector<ThumbnailRequest> requests;
+    while (requests.size() < max_count && !heap_.empty() && heap_.front().priority == priority &&
+           !isStale(heap_.front())) {
+        auto request = removeAt(0);
+        start(request);
+        requests.push_back(std::move(request));
+    }
+    return requests;
 }
 
 bool ThumbnailQueue::cancel(RequestId id) {
     std::lock_guard lock(mutex_);
-    auto [_, inserted] = cancelled_.insert(id);
-    return inserted;
+    if (auto it = slots_.find(id); it != slots_.end()) {
+        (void)removeAt(it->second);
+        return true;
+    }
+    if (auto it = in_flight_.find(id); it != in_flight_.end()) {
+        return it->second.stop.request_stop();
+    }
+    return false;
 }
 
 size_t ThumbnailQueue::cancelByPath(const std::filesystem::path& path) {
     std::lock_guard lock(mutex_);
 
-    // We need to rebuild the queue, collecting non-matching requests
-    std::vector<ThumbnailRequest> remaining;
-    size_t cancelled_count = 0;
-
-    while (!queue_.empty()) {
-        auto request = std::move(const_cast<ThumbnailRequest&>(queue_.top()));
-        queue_.pop();
+    // One pass to drop matches, then one O(n) heapify
+    auto removed = std::remove_if(heap_.begin(), heap_.end(), [&path](const auto& request) {
+        return request.source.path == path;
+    });
+    size_t cancelled_count = static_cast<size_t>(heap_.end() - removed);
+    if (cancelled_count > 0) {
+        heap_.erase(removed, heap_.end());
+        heapify();
+    }
 
-        if (request.source.path == path) {
-            cancelled_.insert(request.id);
+    for (auto& [id, active] : in_flight_) {
+        if (active.path == path && active.stop.request_stop()) {
             ++cancelled_count;
-        } else {
-            remaining.push_back(std::move(request));
         }
     }
 
-    // Rebuild queue
-    for (auto& req : remaining) {
-        queue_.push(std::move(req));
-    }
-
     return cancelled_count;
 }
 
 size_t ThumbnailQueue::cancelAll() {
     std::lock_guard lock(mutex_);
-    size_t count = queue_.size();
+    size_t count = heap_.size();
+    for (auto& [id, active] : in_flight_) {
+        if (active.stop.request_stop()) {
+            ++count;
+        }
+    }
     LOG_DEBUG("ThumbnailQueue::cancelAll: cancelling {} requests", count);
 
-    while (!queue_.empty()) {
-        cancelled_.insert(queue_.top().id);
-        queue_.pop();
-    }
+    heap_.clear();
+    slots_.clear();
+    urgent_pending_ = 0;
+    pending_bytes_ = 0;
 
     return count;
 }
 
 bool ThumbnailQueue::isCancelled(RequestId id) const {
     std::lock_guard lock(mutex_);
-    return cancelled_.find(id) != cancelled_.end();
+    auto it = in_flight_.find(id);
+    return it != in_flight_.end() && it->second.stop.stop_requested();
 }
 
-void ThumbnailQueue::clearCancelled(RequestId id) {
+void ThumbnailQueue::finish(RequestId id) {
     std::lock_guard lock(mutex_);
-    cancelled_.erase(id);
+    auto it = in_flight_.find(id);
+    if (it == in_flight_.end()) {
+        return;
+    }
+    if (it->second.urgent) {
+        --urgent_in_flight_;
+    }
+    in_flight_.erase(it);
 }
 
 bool ThumbnailQueue::updatePriority(RequestId id, Priority new_priority) {
     std::lock_guard lock(mutex_);
 
-    // Find and update the request, then rebuild queue
-    std::vector<ThumbnailRequest> requests;
-    bool found = false;
+    auto it = slots_.find(id);
+    if (it == slots_.end()) {
+        return false;
+    }
 
-    while (!queue_.empty()) {
-        auto request = std::move(const_cast<ThumbnailRequest&>(queue_.top()));
-        queue_.pop();
+    size_t slot = it->second;
+    Priority old_priority = heap_[slot].priority;
+    heap_[slot].priority = new_priority;
+    urgent_pending_ += is_urgent(new_priority);
+    urgent_pending_ -= is_urgent(old_priority);
+    if (static_cast<uint8_t>(new_priority) > static_cast<uint8_t>(old_priority)) {
+        siftUp(slot);
+    } else {
+        siftDown(slot);
+    }
 
-        if (request.id == id) {
-            request.priority = new_priority;
-            found = true;
-        }
-        requests.push_back(std::move(request));
+    return true;
+}
+
+size_t ThumbnailQueue::setViewport(const Viewport& viewport) {
+    std::lock_guard lock(mutex_);
+    viewport_ = viewport;
+
+    auto outside = [&viewport](size_t index) {
+        return index != kNoViewIndex &&
+               (index < viewport.keep_first || index >= viewport.keep_last);
+    };
+
+    // Every rank changes, so re-rank in place and heapify once (O(n))
+    auto kept = std::remove_if(heap_.begin(), heap_.end(), [&outside](const auto& request) {
+        return outside(request.view_index);
+    });
+    size_t dropped = static_cast<size_t>(heap_.end() - kept);
+    heap_.erase(kept, heap_.end());
+    for (auto& request : heap_) {
+        request.view_rank = viewport.rank(request.view_index);
     }
+    heapify();
 
-    // Rebuild queue
-    for (auto& req : requests) {
-        queue_.push(std::move(req));
+    for (auto& [id, active] : in_flight_) {
+        if (outside(active.view_index) && active.stop.request_stop()) {
+            ++dropped;
+        }
     }
 
-    return found;
+    LOG_TRACE("ThumbnailQueue::setViewport: [{}, {}), dropped={}, remaining={}", viewport.first,
+              viewport.last, dropped, heap_.size());
+    return dropped;
 }
 
 size_t ThumbnailQueue::size() const {
     std::lock_guard lock(mutex_);
-    return queue_.size();
+    return heap_.size();
 }
 
 bool ThumbnailQueue::empty() const {
     std::lock_guard lock(mutex_);
-    return queue_.empty();
+    return heap_.empty();
+}
+
+uint64_t ThumbnailQueue::pendingBytes() const {
+    std::lock_guard lock(mutex_);
+    return pending_bytes_;
+}
+
+bool ThumbnailQueue::saturated() const {
+    std::lock_guard lock(mutex_);
+    return (max_requests_ > 0 && heap_.size() * 4 >= max_requests_ * 3) ||
+           (max_bytes_ > 0 && pending_bytes_ * 4 >= max_bytes_ * 3);
+}
+
+size_t ThumbnailQueue::urgentCount() const {
+    std::lock_guard lock(mutex_);
+    return urgent_pending_ + urgent_in_flight_;
+}
+
+size_t ThumbnailQueue::backgroundCount() const {
+    std::lock_guard lock(mutex_);
+    return (heap_.size() - urgent_pending_) + (in_flight_.size() - urgent_in_flight_);
 }
 
 void ThumbnailQueue::stop() {
     {
         std::lock_guard lock(mutex_);
         stopped_ = true;
+        for (auto& [id, active] : in_flight_) {
+            active.stop.request_stop();
+        }
     }
     cv_.notify_all();
 }
@@ -194,19 +297,159 @@ bool ThumbnailQueue::isStopped() const {
 void ThumbnailQueue::restart() {
     std::lock_guard lock(mutex_);
     stopped_ = false;
-    cancelled_.clear();
+    viewport_.reset();
 }
 
-void ThumbnailQueue::rebuildQueue() {
+void ThumbnailQueue::insert(ThumbnailRequest request) {
     // Called with lock held
-    std::vector<ThumbnailRequest> requests;
-    while (!queue_.empty()) {
-        requests.push_back(std::move(const_cast<ThumbnailRequest&>(queue_.top())));
-        queue_.pop();
+    auto id = request.id;
+    urgent_pending_ += is_urgent(request.priority);
+    pending_bytes_ += data_bytes(request);
+    heap_.push_back(std::move(request));
+    slots_[id] = heap_.size() - 1;
+    siftUp(heap_.size() - 1);
+}
+
+ThumbnailRequest ThumbnailQueue::removeAt(size_t slot) {
+    // Called with lock held. The last element fills the hole and is sifted
+    // whichever way it belongs.
+    ThumbnailRequest request = std::move(heap_[slot]);
+    slots_.erase(request.id);
+    urgent_pending_ -= is_urgent(request.priority);
+    pending_bytes_ -= data_bytes(request);
+
+    size_t last = heap_.size() - 1;
+    if (slot != last) {
+        place(slot, std::move(heap_[last]));
+        heap_.pop_back();
+        siftDown(slot);
+        siftUp(slot);
+    } else {
+        heap_.pop_back();
     }
-    for (auto& req : requests) {
-        queue_.push(std::move(req));
+    return request;
+}
+
+void ThumbnailQueue::siftUp(size_t slot) {
+    // Called with lock held
+    ThumbnailRequest moving = std::move(heap_[slot]);
+    while (slot > 0) {
+        size_t parent = (slot - 1) / kArity;
+        if (!(heap_[parent] < moving)) {
+            break;
+        }
+        place(slot, std::move(heap_[parent]));
+        slot = parent;
     }
+    place(slot, std::move(moving));
+}
+
+void ThumbnailQueue::siftDown(size_t slot) {
+    // Called with lock held
+    ThumbnailRequest moving = std::move(heap_[slot]);
+    size_t count = heap_.size();
+    while (true) {
+        size_t first_child = slot * kArity + 1;
+        if (first_child >= count) {
+            break;
+        }
+        size_t best = first_child;
+        size_t end = std::min(first_child + kArity, count);
+        for (size_t child = first_child + 1; child < end; ++child) {
+            if (heap_[best] < heap_[child]) {
+                best = child;
+            }
+        }
+        if (!(moving < heap_[best])) {
+            break;
+        }
+        place(slot, std::move(heap_[best]));
+        slot = best;
+    }
+    place(slot, std::move(moving));
+}
+
+void ThumbnailQueue::heapify() {
+    // Called with lock held. Floyd's construction, then the slot map and
+    // urgent count are rebuilt.
+    if (heap_.size() > 1) {
+        for (size_t slot = (heap_.size() - 2) / kArity + 1; slot-- > 0;) {
+            siftDown(slot);
+        }
+    }
+    slots_.clear();
+    urgent_pending_ = 0;
+    pending_bytes_ = 0;
+    for (size_t slot = 0; slot < heap_.size(); ++slot) {
+        slots_[heap_[slot].id] = slot;
+        urgent_pending_ += is_urgent(heap_[slot].priority);
+        pending_bytes_ += data_bytes(heap_[slot]);
+    }
+}
+
+bool ThumbnailQueue::overLimits() const {
+    // Called with lock held
+    return (max_requests_ > 0 && heap_.size() > max_requests_) ||
+           (max_bytes_ > 0 && pending_bytes_ > max_bytes_);
+}
+
+size_t ThumbnailQueue::lowestSlot() const {
+    // Called with lock held, heap_ not empty. The lowest request is a leaf:
+    // every slot from the last parent's first child on.
+    size_t count = heap_.size();
+    size_t lowest = count > 1 ? (count - 2) / kArity + 1 : 0;
+    for (size_t slot = lowest + 1; slot < count; ++slot) {
+        if (heap_[slot] < heap_[lowest]) {
+            lowest = slot;
+        }
+    }
+    return lowest;
+}
+
+void ThumbnailQueue::shed(std::vector<ThumbnailRequest>& dropped) {
+    // Called with lock held. Low priority and far from the viewport go first.
+    while (!heap_.empty() && overLimits()) {
+        dropped.push_back(removeAt(lowestSlot()));
+    }
+    if (!dropped.empty()) {
+        LOG_TRACE("ThumbnailQueue: shed {} requests, {} pending ({} bytes)", dropped.size(),
+                  heap_.size(), pending_bytes_);
+    }
+}
+
+void ThumbnailQueue::dropStaleTop(std::vector<ThumbnailRequest>& dropped) {
+    // Called with lock held. Stale requests rank below current ones, so when
+    // the top is stale every pending request is.
+    if (heap_.empty() || !isStale(heap_.front())) {
+        return;
+    }
+    dropped.reserve(dropped.size() + heap_.size());
+    for (auto& request : heap_) {
+        dropped.push_back(std::move(request));
+    }
+    heap_.clear();
+    slots_.clear();
+    urgent_pending_ = 0;
+    pending_bytes_ = 0;
+    LOG_TRACE("ThumbnailQueue: dropped {} stale requests", dropped.size());
+}
+
+void ThumbnailQueue::start(ThumbnailRequest& request) {
+    // Called with lock held
+    request.stop = std::stop_source{};
+    bool urgent = is_urgent(request.priority);
+    urgent_in_flight_ += urgent;
+    in_flight_.insert_or_assign(request.id, InFlight{.path = request.source.path,
+                                                     .view_index = request.view_index,
+                                                     .stop = request.stop,
+                                                     .urgent = urgent});
+    etw::queuePop(request.id, heap_.size());
+}
+
+void ThumbnailQueue::place(size_t slot, ThumbnailRequest request) {
+    // Called with lock held
+    slots_[request.id] = slot;
+    heap_[slot] = std::move(request);
 }
 
 }  // namespace nive::thumbnail
@@ -3,11 +3,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <optional>
-#include <queue>
-#include <unordered_set>
+#include <unordered_map>
 #include <vector>
 
 #include "thumbnail_request.hpp"
@@ -17,10 +18,26 @@ namespace nive::thumbnail {
 /// @brief Thread-safe priority queue for thumbnail requests
 ///
 /// Supports:
-/// - Priority-based ordering
+/// - Priority-based ordering, refined by distance from the viewport
 /// - Request cancellation
 /// - Batch operations
 /// - Graceful shutdown
+///
+/// Pending requests live in an indexed 4-ary heap with an id -> slot map, so
+/// cancel() and updatePriority() are O(log n) instead of a full rebuild, and
+/// the lock is held only briefly while workers wait in pop().
+///
+/// Requests handed out by pop() stay tracked as in flight until finish(), so
+/// cancelling one requests stop on its stop_source rather than being a no-op.
+///
+/// advanceEpoch() retires every request made so far in O(1), without
+/// touching the heap: stale requests rank below all current ones, are shed
+/// first, and are dropped instead of handed out when they reach the top.
+///
+/// Pending requests can be bounded by count and by the bytes of their
+/// memory_data (see setLimits). A push past either limit sheds the pending
+/// request that would run last, which may be the pushed one; shed requests
+/// are dropped like cancelled ones.
 class ThumbnailQueue {
 public:
     ThumbnailQueue() = default;
@@ -32,45 +49,84 @@ public:
     ThumbnailQueue(ThumbnailQueue&&) = delete;
     ThumbnailQueue& operator=(ThumbnailQueue&&) = delete;
 
+    /// @brief Bound the pending requests
+    /// @param max_requests Most pending requests (0 = unbounded)
+    /// @param max_bytes Most memory_data bytes held by pending requests (0 = unbounded)
+    void setLimits(size_t max_requests, uint64_t max_bytes);
+
     /// @brief Push a request to the queue
     /// @param request Request to add
-    void push(ThumbnailRequest request);
+    /// @return Number of pending requests shed to stay within the limits
+    size_t push(ThumbnailRequest request);
 
     /// @brief Push multiple requests to the queue
     /// @param requests Requests to add
-    void pushBatch(std::vector<ThumbnailRequest> requests);
+    /// @return Number of pending requests shed to stay within the limits
+    size_t pushBatch(std::vector<ThumbnailRequest> requests);
 
     /// @brief Pop highest priority request from the queue
     /// @return Request or nullopt if queue is empty/stopped
     ///
-    /// Blocks until a request is available or the queue is stopped.
+    /// Blocks until a current request is available or the queue is stopped;
+    /// stale requests reaching the top are dropped. The request is in flight
+    /// until finish() is called with its ID.
     [[nodiscard]] std::optional<ThumbnailRequest> pop();
 
     /// @brief Try to pop a request without blocking
     /// @return Request or nullopt if queue is empty
+    ///
+    /// Like pop(), the request is in flight until finish().
     [[nodiscard]] std::optional<ThumbnailRequest> tryPop();
 
+    /// @brief Take the next requests of one priority without blocking
+    /// @param priority Only top requests of this priority are taken
+    /// @param max_count Most requests to take
+    /// @return Requests in queue order, possibly none; each is in flight until finish()
+    [[nodiscard]] std::vector<ThumbnailRequest> tryPopBatch(Priority priority, size_t max_count);
+
     /// @brief Cancel a specific request by ID
     /// @param id Request ID to cancel
     /// @return true if request was found and cancelled
+    ///
+    /// A pending request is removed from the queue; an in-flight request is
+    /// asked to stop through its stop_source.
     bool cancel(RequestId id);
 
     /// @brief Cancel all requests matching a path
     /// @param path Path to match
-    /// @return Number of cancelled requests
+    /// @return Number of cancelled requests (pending and in flight)
     size_t cancelByPath(const std::filesystem::path& path);
 
-    /// @brief Cancel all pending requests
+    /// @brief Cancel all pending and in-flight requests
     /// @return Number of cancelled requests
     size_t cancelAll();
 
-    /// @brief Check if a request ID is cancelled
+    /// @brief Make every request pushed so far stale
+    /// @return The new epoch, to stamp on requests made from now on
+    ///
+    /// Takes no lock. Workers drop stale requests when they reach them and
+    /// stop stale in-flight ones at their next isStale() check.
+    uint64_t advanceEpoch() noexcept {
+        return epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    /// @brief Get the current epoch
+    [[nodiscard]] uint64_t epoch() const noexcept {
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    /// @brief Check if a request was made before the last advanceEpoch()
+    [[nodiscard]] bool isStale(const ThumbnailRequest& request) const noexcept {
+        return request.epoch != epoch();
+    }
+
+    /// @brief Check if an in-flight request has been cancelled
     /// @param id Request ID to check
     [[nodiscard]] bool isCancelled(RequestId id) const;
 
-    /// @brief Clear the cancelled set for a request ID
-    /// @param id Request ID to clear
-    void clearCancelled(RequestId id);
+    /// @brief Mark an in-flight request as done
+    /// @param id Request ID returned by pop() or tryPop()
+    void finish(RequestId id);
 
     /// @brief Update priority of a request
     /// @param id Request ID
@@ -78,13 +134,39 @@ public:
     /// @return true if request was found and updated
     bool updatePriority(RequestId id, Priority new_priority);
 
+    /// @brief Apply a new viewport to pending requests
+    /// @param viewport Visible and kept index ranges, scroll direction and speed
+    /// @return Number of requests dropped for falling outside the kept range
+    ///
+    /// Re-ranks pending requests in place, so requests still inside the kept
+    /// range survive a scroll. In-flight requests outside it are asked to stop
+    /// (and counted). Requests without a view index are kept as they are.
+    size_t setViewport(const Viewport& viewport);
+
     /// @brief Get number of pending requests
     [[nodiscard]] size_t size() const;
 
+    /// @brief Get the memory_data bytes held by pending requests
+    [[nodiscard]] uint64_t pendingBytes() const;
+
+    /// @brief Check if pending requests are near a limit
+    ///
+    /// True from three quarters of either limit; producers of bulk work
+    /// should wait until it clears, or their requests start being shed.
+    [[nodiscard]] bool saturated() const;
+
     /// @brief Check if queue is empty
     [[nodiscard]] bool empty() const;
 
-    /// @brief Stop the queue (unblocks waiting threads)
+    /// @brief Get number of pending and in-flight requests above Priority::Low
+    ///
+    /// Background work waits while this is non-zero.
+    [[nodiscard]] size_t urgentCount() const;
+
+    /// @brief Get number of pending and in-flight Priority::Low requests
+    [[nodiscard]] size_t backgroundCount() const;
+
+    /// @brief Stop the queue (unblocks waiting threads, stops in-flight requests)
     void stop();
 
     /// @brief Check if queue is stopped
@@ -94,14 +176,42 @@ public:
     void restart();
 
 private:
-    // Rebuild priority queue after modification
-    void rebuildQueue();
+    // Heap maintenance (mutex_ held). Slot 0 holds the request to run next.
+    static constexpr size_t kArity = 4;
+
+    void insert(ThumbnailRequest request);
+    [[nodiscard]] ThumbnailRequest removeAt(size_t slot);
+    void siftUp(size_t slot);
+    void siftDown(size_t slot);
+    void heapify();
+    void place(size_t slot, ThumbnailRequest request);
+    void start(ThumbnailRequest& request);
+    [[nodiscard]] bool overLimits() const;
+    [[nodiscard]] size_t lowestSlot() const;
+    void shed(std::vector<ThumbnailRequest>& dropped);
+    void dropStaleTop(std::vector<ThumbnailRequest>& dropped);
+
+    /// @brief A request a worker has taken, kept so it can still be cancelled
+    struct InFlight {
+        std::filesystem::path path;
+        size_t view_index = kNoViewIndex;
+        std::stop_source stop;
+        bool urgent = false;
+    };
 
     mutable std::mutex mutex_;
     std::condition_variable cv_;
-    std::priority_queue<ThumbnailRequest> queue_;
-    std::unordered_set<RequestId> cancelled_;
+    std::vector<ThumbnailRequest> heap_;
+    std::unordered_map<RequestId, size_t> slots_;  // Request ID -> index in heap_
+    std::unordered_map<RequestId, InFlight> in_flight_;
+    std::optional<Viewport> viewport_;
+    size_t urgent_pending_ = 0;    // Entries of heap_ above Priority::Low
+    size_t urgent_in_flight_ = 0;  // Entries of in_flight_ with urgent set
+    uint64_t pending_bytes_ = 0;   // memory_data bytes of heap_
+    size_t max_requests_ = 0;      // 0 = unbounded
+    uint64_t max_bytes_ = 0;       // 0 = unbounded
     bool stopped_ = false;
+    std::atomic<uint64_t> epoch_{0};
 };
 
 }  // namespace nive::thumbnail
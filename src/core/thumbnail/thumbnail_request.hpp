@@ -4,15 +4,22 @@
 #pragma once
 
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <stop_token>
 #include <variant>
 #include <vector>
 
+#include "../archive/virtual_path.hpp"
+#include "../cache/thumbnail_data.hpp"
 #include "../image/decoded_image.hpp"
+#include "../util/memory_accounting.hpp"
+#include "../util/path_interner.hpp"
+#include "request_trace.hpp"
 
 namespace nive::thumbnail {
 
@@ -27,13 +34,79 @@ enum class Priority : uint8_t {
 /// @brief Source for thumbnail generation
 struct ThumbnailSource {
     std::filesystem::path path;
-    std::optional<std::vector<uint8_t>> memory_data;  // For archive contents
+    std::optional<std::vector<uint8_t>> memory_data;  // Pre-extracted data
+    std::optional<archive::VirtualPath> archive_entry;  // Extracted lazily by the worker
+    std::optional<cache::SourceStamp> stamp;            // Known mtime/size (skips cache stat)
+    bool archive_cover = false;  // Path is an archive; its cover image is the source
+    bool folder_mosaic = false;  // Path is a directory; its first images are composited
+    uint64_t disk_order = 0;     // Where the file sits on its volume, roughly (0 = unknown)
 
     /// @brief Create source from file path
     static ThumbnailSource from_file(const std::filesystem::path& path) {
         return ThumbnailSource{.path = path, .memory_data = std::nullopt};
     }
 
+    /// @brief Create source from file path with its mtime/size already known
+    static ThumbnailSource from_file(const std::filesystem::path& path, cache::SourceStamp stamp) {
+        return ThumbnailSource{.path = path, .stamp = stamp};
+    }
+
+    /// @brief Create source for an archive entry
+    ///
+    /// The entry is extracted on a generator worker, and only when the cache
+    /// does not already hold its thumbnail. The path is the virtual path string.
+    /// @param archive_stamp Stamp of the (outermost) archive, which keys its
+    ///        entries; queried on the worker when not given
+    static ThumbnailSource from_archive(const archive::VirtualPath& entry,
+                                        std::optional<cache::SourceStamp> archive_stamp = {}) {
+        return ThumbnailSource{
+            .path = entry.to_string(), .archive_entry = entry, .stamp = archive_stamp};
+    }
+
+    /// @brief Create source for an archive entry that has already been extracted
+    ///
+    /// Unlike from_memory(), the result is cached under the entry's virtual path.
+    static ThumbnailSource from_archive(const archive::VirtualPath& entry,
+                                        std::vector<uint8_t> data,
+                                        std::optional<cache::SourceStamp> archive_stamp = {}) {
+        return ThumbnailSource{.path = entry.to_string(),
+                               .memory_data = std::move(data),
+                               .archive_entry = entry,
+                               .stamp = archive_stamp};
+    }
+
+    /// @brief Create source for the cover of an archive file
+    ///
+    /// The cover entry is picked and extracted on a generator worker, and only
+    /// when the cache does not already hold the thumbnail, which is cached under
+    /// the archive path and stamp. The worker then sets archive_entry to the cover.
+    static ThumbnailSource from_archive_cover(const std::filesystem::path& path,
+                                              cache::SourceStamp stamp) {
+        return ThumbnailSource{.path = path, .stamp = stamp, .archive_cover = true};
+    }
+
+    /// @brief Create source for the mosaic of a folder's first images
+    ///
+    /// The images are listed and composited on generator workers, and only
+    /// when the cache does not already hold the mosaic, which is cached under
+    /// the folder path and stamp. Adding, removing or renaming an entry
+    /// changes the folder's mtime, so the mosaic is built again.
+    static ThumbnailSource from_folder(const std::filesystem::path& path,
+                                       cache::SourceStamp stamp) {
+        return ThumbnailSource{.path = path, .stamp = stamp, .folder_mosaic = true};
+    }
+
+    /// @brief Check if the result can be cached (has a stable on-disk identity)
+    [[nodiscard]] bool is_cacheable() const noexcept {
+        return !memory_data.has_value() || archive_entry.has_value();
+    }
+
+    /// @brief Check if the source is a plain file on disk
+    [[nodiscard]] bool is_file() const noexcept {
+        return !memory_data.has_value() && !archive_entry.has_value() && !archive_cover &&
+               !folder_mosaic;
+    }
+
     /// @brief Create source from memory data (e.g., extracted from archive)
     static ThumbnailSource from_memory(const std::filesystem::path& virtual_path,
                                        std::vector<uint8_t> data) {
@@ -44,10 +117,14 @@ struct ThumbnailSource {
 /// @brief Result of thumbnail generation
 struct ThumbnailResult {
     std::filesystem::path path;
+    PathId path_id = kNoPathId;  // Interned source.path of the request answered
     std::optional<image::DecodedImage> thumbnail;
     std::optional<std::string> error;
     uint32_t original_width = 0;
     uint32_t original_height = 0;
+    bool preview = false;  // Fast first pass; the refined thumbnail for the path follows
+    uint64_t request_id = 0;  // RequestId of the request answered, for trace events
+    RequestTimeline timeline;  // Hops of the request answered, when tracing
 
     [[nodiscard]] bool success() const noexcept {
         return thumbnail.has_value() && !error.has_value();
@@ -60,22 +137,85 @@ using ThumbnailCallback = std::function<void(ThumbnailResult)>;
 /// @brief Request ID for tracking and cancellation
 using RequestId = uint64_t;
 
+/// @brief View index of a request that is not tied to a grid position
+inline constexpr size_t kNoViewIndex = static_cast<size_t>(-1);
+
+/// @brief Visible range of the item view, used to order and prune pending requests
+///
+/// Indices are positions in the displayed listing. Requests outside
+/// [keep_first, keep_last) are dropped when the viewport is applied.
+struct Viewport {
+    size_t first = 0;       // First visible item
+    size_t last = 0;        // One past the last visible item
+    size_t keep_first = 0;  // Requests before this index are dropped
+    size_t keep_last = 0;   // Requests at or after this index are dropped
+    int direction = 0;      // Scroll direction: -1 towards the start, 1 towards the end, 0 idle
+    double velocity = 0.0;  // Scroll speed in items per second
+
+    /// @brief Scheduling rank of an item (lower runs first)
+    ///
+    /// Visible items come first, nearest the center first. Off-screen items
+    /// follow; those the scroll is heading towards rank by when they cross
+    /// the leading edge, ahead of those left behind.
+    [[nodiscard]] double rank(size_t index) const noexcept {
+        if (index == kNoViewIndex || last <= first) {
+            return 0.0;
+        }
+        double span = static_cast<double>(last - first);
+        if (direction > 0 && index >= last) {
+            return span + static_cast<double>(index - last);
+        }
+        if (direction < 0 && index < first) {
+            return span + static_cast<double>(first - 1 - index);
+        }
+        double center = (static_cast<double>(first) + static_cast<double>(last)) / 2.0;
+        double distance = std::abs(static_cast<double>(index) - center);
+        if (index >= first && index < last) {
+            return distance;
+        }
+        double factor = direction != 0 ? 2.0 : 1.0;  // Left behind, or idle
+        return span + distance * factor;
+    }
+};
+
 /// @brief Thumbnail generation request
 struct ThumbnailRequest {
     RequestId id = 0;
     ThumbnailSource source;
+    PathId path_id = kNoPathId;  // Interned source.path, set by the generator
     uint32_t target_size = 256;
     Priority priority = Priority::Normal;
     ThumbnailCallback callback;
     std::chrono::steady_clock::time_point created_at = std::chrono::steady_clock::now();
+    size_t view_index = kNoViewIndex;  // Position in the item view (see Viewport)
+    double view_rank = 0.0;            // Set by the queue from the current viewport
+    bool refine = false;               // Second pass after a progressive preview
+    uint64_t epoch = 0;                // Queue epoch when submitted (see advanceEpoch)
+    RequestTimeline timeline;          // Hop times, when tracing (see GeneratorConfig)
+    // source.memory_data while the request is queued or in flight
+    MemoryCharge source_charge{MemoryCategory::QueuedSources};
+    // Given a stop state when a worker takes the request; cancelling it then
+    // interrupts the decode instead of discarding the finished result
+    std::stop_source stop{std::nostopstate};
 
     /// @brief Comparison for priority queue ordering
     ///
-    /// Higher priority comes first, then earlier created time.
+    /// A later epoch comes first, so stale requests sink below every current
+    /// one. Then higher priority, then first passes before refinements, then
+    /// lower view rank, then earlier created time.
     [[nodiscard]] bool operator<(const ThumbnailRequest& other) const noexcept {
+        if (epoch != other.epoch) {
+            return epoch < other.epoch;
+        }
         if (priority != other.priority) {
             return static_cast<uint8_t>(priority) < static_cast<uint8_t>(other.priority);
         }
+        if (refine != other.refine) {
+            return refine;
+        }
+        if (view_rank != other.view_rank) {
+            return view_rank > other.view_rank;
+        }
         // Earlier created time has higher priority
         return created_at > other.created_at;
     }
@@ -0,0 +1,89 @@
+/// @file etw.cpp
+/// @brief TraceLogging provider and event definitions
+
+#include "etw.hpp"
+
+#include <Windows.h>
+
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+// Name hash of "Nive" (see the file comment in etw.hpp). Defined at file
+// scope: the macro places the provider metadata in its own section.
+TRACELOGGING_DEFINE_PROVIDER(g_provider, "Nive",
+                             (0xc50419a7, 0x42f7, 0x5ef4, 0x3f, 0x2e, 0x17, 0xbb, 0x1b, 0xfc,
+                              0x15, 0xe5));
+
+namespace nive::etw {
+
+// Every event is verbose: the hot paths emit one per thumbnail
+#define NIVE_ETW_WRITE(name, keyword, ...)                                                         \
+    TraceLoggingWrite(g_provider, name, TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),               \
+                      TraceLoggingKeyword(keyword), __VA_ARGS__)
+
+void registerProvider() {
+    TraceLoggingRegister(g_provider);
+}
+
+void unregisterProvider() {
+    TraceLoggingUnregister(g_provider);
+}
+
+void queuePush(uint64_t request_id, int priority, uint64_t view_index) {
+    NIVE_ETW_WRITE("QueuePush", kQueue, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingInt32(priority, "Priority"),
+                   TraceLoggingUInt64(view_index, "ViewIndex"));
+}
+
+void queuePop(uint64_t request_id, uint64_t remaining) {
+    NIVE_ETW_WRITE("QueuePop", kQueue, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingUInt64(remaining, "Remaining"));
+}
+
+void cacheHit(uint64_t request_id, uint64_t lookup_us) {
+    NIVE_ETW_WRITE("CacheHit", kCache, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingUInt64(lookup_us, "LookupUs"));
+}
+
+void cacheMiss(uint64_t request_id, uint64_t lookup_us) {
+    NIVE_ETW_WRITE("CacheMiss", kCache, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingUInt64(lookup_us, "LookupUs"));
+}
+
+void decodeStart(uint64_t request_id) {
+    NIVE_ETW_WRITE("DecodeStart", kDecode, TraceLoggingUInt64(request_id, "RequestId"));
+}
+
+void decodeEnd(uint64_t request_id, uint64_t decode_us) {
+    NIVE_ETW_WRITE("DecodeEnd", kDecode, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingUInt64(decode_us, "DecodeUs"));
+}
+
+void decodeCancelled(uint64_t request_id) {
+    NIVE_ETW_WRITE("DecodeCancelled", kDecode, TraceLoggingUInt64(request_id, "RequestId"));
+}
+
+void cacheWrite(uint64_t request_id, bool ok, uint64_t put_us) {
+    NIVE_ETW_WRITE("CacheWrite", kCache, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingBool(ok, "Ok"), TraceLoggingUInt64(put_us, "PutUs"));
+}
+
+void dbCommit(uint64_t rows, uint64_t failed, uint64_t commit_us) {
+    NIVE_ETW_WRITE("DbCommit", kCache, TraceLoggingUInt64(rows, "Rows"),
+                   TraceLoggingUInt64(failed, "Failed"),
+                   TraceLoggingUInt64(commit_us, "CommitUs"));
+}
+
+void uiStage(uint64_t request_id, bool ok) {
+    NIVE_ETW_WRITE("UiStage", kUi, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingBool(ok, "Ok"));
+}
+
+void uiUpload(uint64_t request_id, bool gpu) {
+    NIVE_ETW_WRITE("UiUpload", kUi, TraceLoggingUInt64(request_id, "RequestId"),
+                   TraceLoggingBool(gpu, "Gpu"));
+}
+
+#undef NIVE_ETW_WRITE
+
+}  // namespace nive::etw
@@ -0,0 +1,69 @@
+/// @file etw.hpp
+/// @brief ETW (TraceLogging) events for the thumbnail, cache and upload hot paths
+///
+/// The provider is "Nive", GUID {c50419a7-42f7-5ef4-3f2e-17bb1bfc15e5} (the
+/// name hash, so tools accept "*Nive"). With no session listening each event
+/// is a test of the provider's enable mask; nothing is formatted. Record with
+///
+///     tracelog -start nive -f nive.etl -guid *Nive -level 5
+///     tracelog -stop nive
+///
+/// and open the .etl in WPA; every per-request event carries the request id,
+/// so one thumbnail can be followed from queue to screen.
+
+#pragma once
+
+#include <cstdint>
+
+namespace nive::etw {
+
+/// @brief Keywords to enable event groups separately
+enum Keyword : uint64_t {
+    kQueue = 0x1,   // Queue push and pop
+    kDecode = 0x2,  // Decode start and end, cancellation
+    kCache = 0x4,   // Cache hits and misses, database writes
+    kUi = 0x8,      // Bitmap staging and upload to the grid
+};
+
+/// @brief Register the provider; call once before any thread emits events
+void registerProvider();
+
+/// @brief Unregister the provider; events after this are dropped
+void unregisterProvider();
+
+/// @brief A request entered the thumbnail queue
+void queuePush(uint64_t request_id, int priority, uint64_t view_index);
+
+/// @brief An I/O thread took a request off the queue
+void queuePop(uint64_t request_id, uint64_t remaining);
+
+/// @brief A request was answered from the cache
+void cacheHit(uint64_t request_id, uint64_t lookup_us);
+
+/// @brief A request missed the cache and will be read and decoded
+void cacheMiss(uint64_t request_id, uint64_t lookup_us);
+
+/// @brief A decode worker started on a request
+void decodeStart(uint64_t request_id);
+
+/// @brief A decode worker finished a request
+/// @param decode_us Time since decodeStart
+void decodeEnd(uint64_t request_id, uint64_t decode_us);
+
+/// @brief A request in flight was cancelled and its result dropped
+void decodeCancelled(uint64_t request_id);
+
+/// @brief A thumbnail was compressed and queued for the database writer
+void cacheWrite(uint64_t request_id, bool ok, uint64_t put_us);
+
+/// @brief The database writer committed a batch of thumbnails
+void dbCommit(uint64_t rows, uint64_t failed, uint64_t commit_us);
+
+/// @brief A worker staged a thumbnail on the GPU for the UI thread
+void uiStage(uint64_t request_id, bool ok);
+
+/// @brief The grid took a thumbnail on the UI thread
+/// @param gpu true if a staged bitmap was used rather than an upload from memory
+void uiUpload(uint64_t request_id, bool gpu);
+
+}  // namespace nive::etw
@@ -0,0 +1,71 @@
+/// @file execution_policy.cpp
+/// @brief Execution policy and EcoQoS implementation
+
+#include "execution_policy.hpp"
+
+#include <Windows.h>
+
+namespace nive {
+
+namespace {
+
+/// @brief Set or clear the execution speed throttling of the calling thread
+/// @param throttle true for EcoQoS; false hands the choice back to the system
+bool set_power_throttling(bool throttle) {
+    THREAD_POWER_THROTTLING_STATE state{};
+    state.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION;
+    state.ControlMask = throttle ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+    state.StateMask = throttle ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+    return SetThreadInformation(GetCurrentThread(), ThreadPowerThrottling, &state,
+                                sizeof(state)) != 0;
+}
+
+}  // namespace
+
+PowerSource currentPowerSource() {
+    SYSTEM_POWER_STATUS status{};
+    if (!GetSystemPowerStatus(&status)) {
+        return PowerSource::Ac;
+    }
+    if (status.SystemStatusFlag & 1) {
+        return PowerSource::BatterySaver;
+    }
+    return status.ACLineStatus == 0 ? PowerSource::Battery : PowerSource::Ac;
+}
+
+const char* to_string(PowerSource source) {
+    switch (source) {
+    case PowerSource::Battery:
+        return "battery";
+    case PowerSource::BatterySaver:
+        return "battery saver";
+    default:
+        return "ac";
+    }
+}
+
+ExecutionPolicy::ExecutionPolicy() : power_(currentPowerSource()) {
+}
+
+bool ExecutionPolicy::setMinimized(bool minimized) noexcept {
+    bool was_efficient = efficient();
+    minimized_ = minimized;
+    return efficient() != was_efficient;
+}
+
+bool ExecutionPolicy::refreshPowerSource() {
+    bool was_efficient = efficient();
+    power_ = currentPowerSource();
+    return efficient() != was_efficient;
+}
+
+ScopedEcoQoS::ScopedEcoQoS(bool enable) : active_(enable && set_power_throttling(true)) {
+}
+
+ScopedEcoQoS::~ScopedEcoQoS() {
+    if (active_) {
+        set_power_throttling(false);
+    }
+}
+
+}  // namespace nive
@@ -0,0 +1,67 @@
+/// @file execution_policy.hpp
+/// @brief Power and window conditions that decide how hard background work may run
+
+#pragma once
+
+namespace nive {
+
+/// @brief Where the machine draws power from
+enum class PowerSource { Ac, Battery, BatterySaver };
+
+/// @brief Read the current power source (Ac if it cannot be read)
+[[nodiscard]] PowerSource currentPowerSource();
+
+[[nodiscard]] const char* to_string(PowerSource source);
+
+/// @brief Tracks whether background work should run in efficiency mode
+///
+/// Efficiency mode applies while the main window is minimized or the
+/// machine runs on battery: the owner lowers thumbnail decode concurrency,
+/// runs the remaining work under EcoQoS at background priority and pauses
+/// idle crawls, so nive neither drains the battery nor competes with the
+/// foreground application.
+///
+/// Not thread-safe: fed from the UI thread (WM_SIZE, WM_POWERBROADCAST)
+class ExecutionPolicy {
+public:
+    /// @brief Start from the current power source, window not minimized
+    ExecutionPolicy();
+
+    /// @brief Record whether the main window is minimized
+    /// @return true if efficient() changed
+    bool setMinimized(bool minimized) noexcept;
+
+    /// @brief Re-read the power source after a power status change
+    /// @return true if efficient() changed
+    bool refreshPowerSource();
+
+    [[nodiscard]] bool minimized() const noexcept { return minimized_; }
+    [[nodiscard]] PowerSource powerSource() const noexcept { return power_; }
+
+    /// @brief Check if background work should hold back
+    [[nodiscard]] bool efficient() const noexcept {
+        return minimized_ || power_ != PowerSource::Ac;
+    }
+
+private:
+    bool minimized_ = false;
+    PowerSource power_ = PowerSource::Ac;
+};
+
+/// @brief Run the calling thread under EcoQoS for a scope
+///
+/// The scheduler then prefers efficiency cores and low clock speeds for the
+/// thread. Restores the system's default choice on exit.
+class ScopedEcoQoS {
+public:
+    explicit ScopedEcoQoS(bool enable = true);
+    ~ScopedEcoQoS();
+
+    ScopedEcoQoS(const ScopedEcoQoS&) = delete;
+    ScopedEcoQoS& operator=(const ScopedEcoQoS&) = delete;
+
+private:
+    bool active_;
+};
+
+}  // namespace nive
@@ -0,0 +1,61 @@
+/// @file executor.hpp
+/// @brief Places a coroutine can be resumed on, and the co_await to move there
+
+#pragma once
+
+#include <coroutine>
+
+#include "thread_pool.hpp"
+
+namespace nive {
+
+/// @brief Resumes suspended coroutines on some thread
+///
+/// Thread-safe: schedule() may be called from any thread
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /// @brief Resume a coroutine later on this executor's thread(s)
+    virtual void schedule(std::coroutine_handle<> handle) = 0;
+};
+
+/// @brief Resumes coroutines as tasks of a ThreadPool
+///
+/// The handle is the whole task, so scheduling one takes a pooled job
+/// block rather than a heap allocation.
+class ThreadPoolExecutor final : public Executor {
+public:
+    explicit ThreadPoolExecutor(ThreadPool& pool, TaskPriority priority = TaskPriority::Normal)
+        : pool_(pool), priority_(priority) {}
+
+    void schedule(std::coroutine_handle<> handle) override {
+        pool_.post([handle] { handle.resume(); }, priority_);
+    }
+
+private:
+    ThreadPool& pool_;
+    TaskPriority priority_;
+};
+
+/// @brief Executor over globalThreadPool() at Normal priority
+[[nodiscard]] inline Executor& poolExecutor() {
+    static ThreadPoolExecutor executor(globalThreadPool());
+    return executor;
+}
+
+/// @brief Awaitable that continues the coroutine on an executor
+///
+///     co_await resumeOn(poolExecutor());  // Off the UI thread from here
+[[nodiscard]] inline auto resumeOn(Executor& executor) noexcept {
+    struct Awaiter {
+        Executor& executor;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) const { executor.schedule(handle); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{executor};
+}
+
+}  // namespace nive
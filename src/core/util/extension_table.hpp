@@ -0,0 +1,171 @@
+/// @file extension_table.hpp
+/// @brief Compile-time perfect hash over a fixed set of file extensions
+///
+/// File listings classify every entry by extension, so the lookup has to be
+/// cheap: one hash over the case-folded code units, one slot load and one
+/// compare, with no lowercased copy of the input.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace nive {
+
+/// @brief Fold ASCII upper case to lower case, leaving every other code unit as is
+template <typename Char>
+[[nodiscard]] constexpr Char foldAscii(Char c) noexcept {
+    return c >= Char('A') && c <= Char('Z') ? static_cast<Char>(c - Char('A') + Char('a')) : c;
+}
+
+/// @brief An extension and what it maps to
+template <typename Value>
+struct ExtensionEntry {
+    std::string_view extension;  // Lowercase ASCII, without the dot
+    Value value;
+};
+
+/// @brief Fixed extension map with a perfect hash found at compile time
+///
+/// Lookups take char or wchar_t extensions, with or without the leading dot,
+/// in any ASCII case. The hash folds case as it goes; the one candidate slot
+/// is then compared against the input code unit by code unit. Build tables
+/// with makeExtensionTable() or makeExtensionSet() so a seed is searched for
+/// in a constant expression: a set no seed separates fails to compile.
+template <typename Value, size_t N>
+class ExtensionTable {
+public:
+    static_assert(N > 0 && N < 255, "Slots index entries with a uint8_t");
+
+    consteval explicit ExtensionTable(const std::array<ExtensionEntry<Value>, N>& entries)
+        : entries_(entries) {
+        for (size_t i = 0; i < N; ++i) {
+            std::string_view ext = entries_[i].extension;
+            if (ext.empty()) {
+                throw "empty extension";
+            }
+            for (char c : ext) {
+                if (c == '.' || static_cast<unsigned char>(c) > 0x7F || foldAscii(c) != c) {
+                    throw "extensions must be lowercase ASCII without the dot";
+                }
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (entries_[j].extension == ext) {
+                    throw "duplicate extension";
+                }
+            }
+            max_length_ = ext.size() > max_length_ ? ext.size() : max_length_;
+        }
+        for (uint32_t seed = 0; seed < kMaxSeeds; ++seed) {
+            if (place(seed)) {
+                seed_ = seed;
+                return;
+            }
+        }
+        throw "no perfect hash seed found";
+    }
+
+    /// @brief Look up an extension
+    /// @return The mapped value, or nullptr when the extension is not in the table
+    [[nodiscard]] constexpr const Value* find(std::string_view ext) const noexcept {
+        return lookup(ext);
+    }
+    [[nodiscard]] constexpr const Value* find(std::wstring_view ext) const noexcept {
+        return lookup(ext);
+    }
+
+    [[nodiscard]] constexpr bool contains(std::string_view ext) const noexcept {
+        return lookup(ext) != nullptr;
+    }
+    [[nodiscard]] constexpr bool contains(std::wstring_view ext) const noexcept {
+        return lookup(ext) != nullptr;
+    }
+
+private:
+    // Four slots per entry (rounded up) leave a free seed within a few tries
+    static constexpr size_t kSlots = std::bit_ceil(N) * 4;
+    static constexpr uint32_t kMaxSeeds = 1u << 16;
+
+    /// @brief FNV-1a over the folded code units, mixed down so the low bits carry
+    template <typename Char>
+    [[nodiscard]] static constexpr uint32_t hash(std::basic_string_view<Char> ext,
+                                                 uint32_t seed) noexcept {
+        uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (Char c : ext) {
+            h ^= static_cast<uint32_t>(static_cast<std::make_unsigned_t<Char>>(foldAscii(c)));
+            h *= 16777619u;
+        }
+        return h ^ (h >> 16);
+    }
+
+    template <typename Char>
+    [[nodiscard]] constexpr const Value*
+    lookup(std::basic_string_view<Char> ext) const noexcept {
+        if (!ext.empty() && ext.front() == Char('.')) {
+            ext.remove_prefix(1);
+        }
+        if (ext.empty() || ext.size() > max_length_) {
+            return nullptr;
+        }
+        uint8_t slot = slots_[hash(ext, seed_) & (kSlots - 1)];
+        if (slot == 0) {
+            return nullptr;
+        }
+        const ExtensionEntry<Value>& entry = entries_[slot - 1];
+        if (entry.extension.size() != ext.size()) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < ext.size(); ++i) {
+            if (foldAscii(ext[i]) != static_cast<Char>(entry.extension[i])) {
+                return nullptr;
+            }
+        }
+        return &entry.value;
+    }
+
+    /// @brief Try to place every entry in a slot of its own under seed
+    consteval bool place(uint32_t seed) {
+        slots_ = {};
+        for (size_t i = 0; i < N; ++i) {
+            uint8_t& slot = slots_[hash(entries_[i].extension, seed) & (kSlots - 1)];
+            if (slot != 0) {
+                return false;
+            }
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        return true;
+    }
+
+    std::array<ExtensionEntry<Value>, N> entries_;
+    std::array<uint8_t, kSlots> slots_{};  // Entry index + 1; 0 = empty
+    size_t max_length_ = 0;
+    uint32_t seed_ = 0;
+};
+
+/// @brief Build an extension map, e.g. makeExtensionTable<Format>({{"png", Format::Png}})
+template <typename Value, size_t N>
+[[nodiscard]] consteval ExtensionTable<Value, N>
+makeExtensionTable(const ExtensionEntry<Value> (&entries)[N]) {
+    std::array<ExtensionEntry<Value>, N> copy{};
+    for (size_t i = 0; i < N; ++i) {
+        copy[i] = entries[i];
+    }
+    return ExtensionTable<Value, N>(copy);
+}
+
+/// @brief Build a set of extensions, e.g. makeExtensionSet({"zip", "7z"})
+template <size_t N>
+[[nodiscard]] consteval ExtensionTable<bool, N>
+makeExtensionSet(const std::string_view (&extensions)[N]) {
+    std::array<ExtensionEntry<bool>, N> entries{};
+    for (size_t i = 0; i < N; ++i) {
+        entries[i] = {extensions[i], true};
+    }
+    return ExtensionTable<bool, N>(entries);
+}
+
+}  // namespace nive
@@ -1,11 +1,16 @@
 /// @file hash.cpp
-/// @brief SHA256 hash implementation using Windows CNG (BCrypt)
+/// @brief SHA256 (Windows CNG) and MurmurHash3 x64_128 implementations
 
 #include "hash.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <format>
 #include <memory>
 
+#include "mapped_file.hpp"
+
 // Link with bcrypt.lib (handled in CMakeLists.txt)
 #pragma comment(lib, "bcrypt.lib")
 
@@ -23,119 +28,159 @@ public:
         }
     }
 
-    // Non-copyable
+    // Non-copyable, non-movable (shared by every thread once opened)
     BcryptAlgorithm(const BcryptAlgorithm&) = delete;
     BcryptAlgorithm& operator=(const BcryptAlgorithm&) = delete;
-
-    // Movable
-    BcryptAlgorithm(BcryptAlgorithm&& other) noexcept : handle_(other.handle_) {
-        other.handle_ = nullptr;
-    }
-
-    BcryptAlgorithm& operator=(BcryptAlgorithm&& other) noexcept {
-        if (this != &other) {
-            if (handle_) {
-                BCryptCloseAlgorithmProvider(handle_, 0);
-            }
-            handle_ = other.handle_;
-            other.handle_ = nullptr;
+    BcryptAlgorithm(BcryptAlgorithm&&) = delete;
+    BcryptAlgorithm& operator=(BcryptAlgorithm&&) = delete;
+
+    [[nodiscard]] bool open(LPCWSTR algorithm_id, ULONG flags) {
+        NTSTATUS status = BCryptOpenAlgorithmProvider(&handle_, algorithm_id, nullptr, flags);
+        if (!BCRYPT_SUCCESS(status)) {
+            handle_ = nullptr;
+            return false;
         }
-        return *this;
-    }
-
-    [[nodiscard]] bool open(LPCWSTR algorithm_id) {
-        NTSTATUS status = BCryptOpenAlgorithmProvider(&handle_, algorithm_id, nullptr, 0);
+        DWORD result_size = 0;
+        status = BCryptGetProperty(handle_, BCRYPT_OBJECT_LENGTH,
+                                   reinterpret_cast<PUCHAR>(&object_size_), sizeof(object_size_),
+                                   &result_size, 0);
         return BCRYPT_SUCCESS(status);
     }
 
     [[nodiscard]] BCRYPT_ALG_HANDLE get() const noexcept { return handle_; }
+    [[nodiscard]] DWORD objectSize() const noexcept { return object_size_; }
     [[nodiscard]] explicit operator bool() const noexcept { return handle_ != nullptr; }
 
 private:
     BCRYPT_ALG_HANDLE handle_ = nullptr;
+    DWORD object_size_ = 0;
 };
 
-/// @brief RAII wrapper for BCrypt hash handle
-class BcryptHash {
-public:
-    BcryptHash() = default;
-    ~BcryptHash() {
-        if (handle_) {
-            BCryptDestroyHash(handle_);
+/// @brief SHA256 provider opened once per process
+///
+/// CNG algorithm handles may be shared between threads; opening one costs
+/// far more than hashing a cache key, so it is never done per call.
+/// @return Provider, or nullptr if it could not be opened
+const BcryptAlgorithm* sha256_provider() {
+    static const auto provider = [] {
+        auto algorithm = std::make_unique<BcryptAlgorithm>();
+        if (!algorithm->open(BCRYPT_SHA256_ALGORITHM, BCRYPT_HASH_REUSABLE_FLAG)) {
+            algorithm.reset();
         }
-    }
+        return algorithm;
+    }();
+    return provider.get();
+}
 
-    // Non-copyable, non-movable
-    BcryptHash(const BcryptHash&) = delete;
-    BcryptHash& operator=(const BcryptHash&) = delete;
-    BcryptHash(BcryptHash&&) = delete;
-    BcryptHash& operator=(BcryptHash&&) = delete;
+// BCryptHashData takes a ULONG length; larger inputs are fed in pieces
+constexpr size_t kMaxHashChunk = size_t{1} << 30;
+
+/// @brief Final avalanche mix of MurmurHash3
+constexpr uint64_t fmix64(uint64_t k) noexcept {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
 
-    [[nodiscard]] bool create(BCRYPT_ALG_HANDLE algorithm, PUCHAR hash_object,
-                              ULONG hash_object_size) {
-        NTSTATUS status =
-            BCryptCreateHash(algorithm, &handle_, hash_object, hash_object_size, nullptr, 0, 0);
-        return BCRYPT_SUCCESS(status);
-    }
+/// @brief Load a little-endian 64-bit block (unaligned)
+uint64_t load_u64(const uint8_t* p) noexcept {
+    uint64_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-    [[nodiscard]] bool hash_data(const uint8_t* data, size_t size) {
-        NTSTATUS status =
-            BCryptHashData(handle_, const_cast<PUCHAR>(data), static_cast<ULONG>(size), 0);
-        return BCRYPT_SUCCESS(status);
-    }
+}  // namespace
 
-    [[nodiscard]] bool finish(uint8_t* output, size_t output_size) {
-        NTSTATUS status = BCryptFinishHash(handle_, output, static_cast<ULONG>(output_size), 0);
-        return BCRYPT_SUCCESS(status);
+Sha256Stream::~Sha256Stream() {
+    if (handle_) {
+        BCryptDestroyHash(handle_);
     }
+}
 
-    [[nodiscard]] BCRYPT_HASH_HANDLE get() const noexcept { return handle_; }
-    [[nodiscard]] explicit operator bool() const noexcept { return handle_ != nullptr; }
-
-private:
-    BCRYPT_HASH_HANDLE handle_ = nullptr;
-};
+Sha256Stream::Sha256Stream(Sha256Stream&& other) noexcept
+    : object_(std::move(other.object_)), handle_(other.handle_), failed_(other.failed_) {
+    other.handle_ = nullptr;
+}
 
-}  // namespace
+Sha256Stream& Sha256Stream::operator=(Sha256Stream&& other) noexcept {
+    if (this != &other) {
+        if (handle_) {
+            BCryptDestroyHash(handle_);
+        }
+        object_ = std::move(other.object_);
+        handle_ = other.handle_;
+        failed_ = other.failed_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
 
-std::expected<Sha256Hash, HashError> sha256(std::span<const uint8_t> data) {
-    // Open algorithm provider
-    BcryptAlgorithm algorithm;
-    if (!algorithm.open(BCRYPT_SHA256_ALGORITHM)) {
+std::expected<Sha256Stream, HashError> Sha256Stream::create() {
+    const auto* provider = sha256_provider();
+    if (!provider) {
         return std::unexpected(HashError::InitializationFailed);
     }
 
-    // Get hash object size
-    DWORD hash_object_size = 0;
-    DWORD result_size = 0;
-    NTSTATUS status = BCryptGetProperty(algorithm.get(), BCRYPT_OBJECT_LENGTH,
-                                        reinterpret_cast<PUCHAR>(&hash_object_size),
-                                        sizeof(hash_object_size), &result_size, 0);
+    Sha256Stream stream;
+    stream.object_ = std::make_unique<uint8_t[]>(provider->objectSize());
+    NTSTATUS status =
+        BCryptCreateHash(provider->get(), &stream.handle_, stream.object_.get(),
+                         provider->objectSize(), nullptr, 0, BCRYPT_HASH_REUSABLE_FLAG);
     if (!BCRYPT_SUCCESS(status)) {
+        stream.handle_ = nullptr;
         return std::unexpected(HashError::InitializationFailed);
     }
+    return stream;
+}
 
-    // Allocate hash object
-    auto hash_object = std::make_unique<uint8_t[]>(hash_object_size);
-
-    // Create hash
-    BcryptHash hash;
-    if (!hash.create(algorithm.get(), hash_object.get(), hash_object_size)) {
-        return std::unexpected(HashError::InitializationFailed);
+void Sha256Stream::update(std::span<const uint8_t> data) {
+    while (!failed_ && !data.empty()) {
+        auto chunk = data.first(std::min(data.size(), kMaxHashChunk));
+        NTSTATUS status = BCryptHashData(handle_, const_cast<PUCHAR>(chunk.data()),
+                                         static_cast<ULONG>(chunk.size()), 0);
+        failed_ = !BCRYPT_SUCCESS(status);
+        data = data.subspan(chunk.size());
     }
+}
 
-    // Hash the data
-    if (!hash.hash_data(data.data(), data.size())) {
+std::expected<Sha256Hash, HashError> Sha256Stream::finish() {
+    // Finishing a reusable hash also resets it, failed or not
+    Sha256Hash result{};
+    NTSTATUS status =
+        BCryptFinishHash(handle_, result.data(), static_cast<ULONG>(result.size()), 0);
+    bool failed = failed_ || !BCRYPT_SUCCESS(status);
+    failed_ = false;
+    if (failed) {
         return std::unexpected(HashError::ComputationFailed);
     }
+    return result;
+}
 
-    // Get the result
-    Sha256Hash result{};
-    if (!hash.finish(result.data(), result.size())) {
-        return std::unexpected(HashError::ComputationFailed);
+std::expected<Sha256Hash, HashError> sha256(std::span<const uint8_t> data) {
+    // One reusable hash object per thread; it is reset by every finish()
+    thread_local auto stream = Sha256Stream::create();
+    if (!stream) {
+        return std::unexpected(stream.error());
     }
+    stream->update(data);
+    return stream->finish();
+}
 
-    return result;
+std::expected<Sha256Hash, HashError> sha256File(const std::filesystem::path& path) {
+    auto file = MappedFile::open(path, MappedFile::Access::Sequential);
+    if (!file) {
+        return std::unexpected(HashError::ReadFailed);
+    }
+
+    auto stream = Sha256Stream::create();
+    if (!stream) {
+        return std::unexpected(stream.error());
+    }
+    stream->update(file->bytes());
+    return stream->finish();
 }
 
 std::expected<Sha256Hash, HashError> sha256(std::string_view str) {
@@ -170,4 +215,85 @@ std::expected<std::string, HashError> sha256Hex(std::string_view str) {
     return hashToHex(*hash_result);
 }
 
+Hash128 hash128(std::span<const uint8_t> data, uint64_t seed) noexcept {
+    constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+    constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    const uint8_t* bytes = data.data();
+    const size_t len = data.size();
+    const size_t nblocks = len / 16;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    // Body: 16-byte blocks
+    for (size_t i = 0; i < nblocks; ++i) {
+        uint64_t k1 = load_u64(bytes + i * 16);
+        uint64_t k2 = load_u64(bytes + i * 16 + 8);
+
+        k1 *= c1;
+        k1 = std::rotl(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+
+        h1 = std::rotl(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = std::rotl(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+
+        h2 = std::rotl(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // Tail: remaining 0-15 bytes
+    const uint8_t* tail = bytes + nblocks * 16;
+    const size_t rem = len & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+
+    for (size_t i = rem; i > 8; --i) {
+        k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+    }
+    if (rem > 8) {
+        k2 *= c2;
+        k2 = std::rotl(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+    }
+
+    for (size_t i = (rem < 8 ? rem : 8); i > 0; --i) {
+        k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+    }
+    if (rem > 0) {
+        k1 *= c1;
+        k1 = std::rotl(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    // Finalization
+    h1 ^= static_cast<uint64_t>(len);
+    h2 ^= static_cast<uint64_t>(len);
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return Hash128{.low = h1, .high = h2};
+}
+
+std::string hashToHex(const Hash128& hash) {
+    return std::format("{:016x}{:016x}", hash.high, hash.low);
+}
+
 }  // namespace nive
@@ -1,14 +1,20 @@
 /// @file hash.hpp
-/// @brief Cryptographic hash utilities using Windows CNG (BCrypt)
+/// @brief Hash utilities
 ///
-/// Provides SHA256 hashing for cache key generation.
+/// Provides SHA256 hashing via Windows CNG (BCrypt) and a fast
+/// non-cryptographic 128-bit hash for cache key generation. The SHA256
+/// provider is opened once per process and hash objects are reusable, so a
+/// call costs the hashing alone.
 
 #pragma once
 
 #include <Windows.h>
 
 #include <array>
+#include <cstdint>
 #include <expected>
+#include <filesystem>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
@@ -20,10 +26,19 @@ namespace nive {
 /// @brief SHA256 hash result (32 bytes)
 using Sha256Hash = std::array<uint8_t, 32>;
 
+/// @brief 128-bit non-cryptographic hash result
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    [[nodiscard]] constexpr bool operator==(const Hash128&) const noexcept = default;
+};
+
 /// @brief Hash computation errors
 enum class HashError {
     InitializationFailed,
     ComputationFailed,
+    ReadFailed,
 };
 
 /// @brief Get string representation of hash error
@@ -33,15 +48,60 @@ enum class HashError {
         return "Hash initialization failed";
     case HashError::ComputationFailed:
         return "Hash computation failed";
+    case HashError::ReadFailed:
+        return "Hash input could not be read";
     }
     return "Unknown hash error";
 }
 
+/// @brief Incremental SHA256 over data that arrives in pieces
+///
+/// Holds a reusable CNG hash object: finish() returns the digest and leaves
+/// the stream ready for the next input. Not thread-safe; use one per thread.
+class Sha256Stream {
+public:
+    /// @brief Create a stream
+    /// @return Stream, or InitializationFailed if CNG is unavailable
+    [[nodiscard]] static std::expected<Sha256Stream, HashError> create();
+
+    ~Sha256Stream();
+
+    // Non-copyable
+    Sha256Stream(const Sha256Stream&) = delete;
+    Sha256Stream& operator=(const Sha256Stream&) = delete;
+
+    // Movable
+    Sha256Stream(Sha256Stream&& other) noexcept;
+    Sha256Stream& operator=(Sha256Stream&& other) noexcept;
+
+    /// @brief Hash the next piece of input (any size)
+    ///
+    /// A failure is reported by finish().
+    void update(std::span<const uint8_t> data);
+
+    /// @brief Complete the digest and reset the stream
+    [[nodiscard]] std::expected<Sha256Hash, HashError> finish();
+
+private:
+    Sha256Stream() = default;
+
+    std::unique_ptr<uint8_t[]> object_;  // Hash object memory owned for CNG
+    BCRYPT_HASH_HANDLE handle_ = nullptr;
+    bool failed_ = false;
+};
+
 /// @brief Compute SHA256 hash of data
 /// @param data Data to hash
 /// @return Hash result or error
+///
+/// Uses a stream kept per thread, so repeated calls allocate nothing.
 [[nodiscard]] std::expected<Sha256Hash, HashError> sha256(std::span<const uint8_t> data);
 
+/// @brief Compute SHA256 hash of a whole file through a mapped view
+/// @param path File to hash
+/// @return Hash result, ReadFailed if the file cannot be mapped (or is empty), or error
+[[nodiscard]] std::expected<Sha256Hash, HashError> sha256File(const std::filesystem::path& path);
+
 /// @brief Compute SHA256 hash of string
 /// @param str String to hash
 /// @return Hash result or error
@@ -62,4 +122,18 @@ enum class HashError {
 /// @return Hex string or error
 [[nodiscard]] std::expected<std::string, HashError> sha256Hex(std::string_view str);
 
+/// @brief Compute a fast 128-bit hash (MurmurHash3 x64_128)
+///
+/// Not suitable for security purposes; intended for cache keys where
+/// SHA256 is needlessly expensive.
+/// @param data Data to hash
+/// @param seed Hash seed
+/// @return Hash result
+[[nodiscard]] Hash128 hash128(std::span<const uint8_t> data, uint64_t seed = 0) noexcept;
+
+/// @brief Convert 128-bit hash to hexadecimal string
+/// @param hash Hash value
+/// @return 32-character lowercase hex string (high word first)
+[[nodiscard]] std::string hashToHex(const Hash128& hash);
+
 }  // namespace nive
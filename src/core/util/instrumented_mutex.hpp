@@ -0,0 +1,84 @@
+/// @file instrumented_mutex.hpp
+/// @brief Mutex that counts contention and the time spent waiting for it
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace nive {
+
+/// @brief Contention counters of an InstrumentedMutex
+struct LockStats {
+    uint64_t acquisitions = 0;  // lock() and successful try_lock() calls
+    uint64_t contended = 0;     // lock() calls that found the mutex held
+    uint64_t wait_ns = 0;       // Total time contended lock() calls waited
+    uint64_t max_wait_ns = 0;   // Longest single wait
+};
+
+/// @brief std::mutex drop-in (Lockable) that records how long lockers wait
+///
+/// An uncontended lock() costs one try_lock() and a relaxed increment; the
+/// clock is only read when the mutex is already held. Counters are relaxed,
+/// so stats() taken while others lock is a close, not exact, snapshot.
+class InstrumentedMutex {
+public:
+    InstrumentedMutex() = default;
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        if (mutex_.try_lock()) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mutex_.lock();
+        auto waited = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        wait_ns_.fetch_add(waited, std::memory_order_relaxed);
+        // Only the holder updates the maximum, so a plain load/store is race-free
+        if (waited > max_wait_ns_.load(std::memory_order_relaxed)) {
+            max_wait_ns_.store(waited, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() { mutex_.unlock(); }
+
+    [[nodiscard]] LockStats stats() const noexcept {
+        return {.acquisitions = acquisitions_.load(std::memory_order_relaxed),
+                .contended = contended_.load(std::memory_order_relaxed),
+                .wait_ns = wait_ns_.load(std::memory_order_relaxed),
+                .max_wait_ns = max_wait_ns_.load(std::memory_order_relaxed)};
+    }
+
+    /// @brief Zero the counters
+    void resetStats() noexcept {
+        acquisitions_.store(0, std::memory_order_relaxed);
+        contended_.store(0, std::memory_order_relaxed);
+        wait_ns_.store(0, std::memory_order_relaxed);
+        max_wait_ns_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex mutex_;
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> wait_ns_{0};
+    std::atomic<uint64_t> max_wait_ns_{0};
+};
+
+}  // namespace nive
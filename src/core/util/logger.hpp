@@ -3,13 +3,23 @@
 
 #pragma once
 
-// Enable all log levels at compile time
-#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+// Statements below SPDLOG_ACTIVE_LEVEL compile to nothing. The build sets it
+// per configuration (trace in Debug, debug in RelWithDebInfo, info in
+// Release); without one, NDEBUG decides.
+#ifndef SPDLOG_ACTIVE_LEVEL
+    #ifdef NDEBUG
+        #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+    #else
+        #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+    #endif
+#endif
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <string>
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
@@ -18,12 +28,23 @@
 
 namespace nive {
 
+/// @brief Messages the async logger holds before the oldest are overwritten
+inline constexpr size_t kLogQueueSize = 8192;
+
 /// @brief Initialize the logging system
+///
+/// Messages are formatted on the calling thread and written by one
+/// background thread, so a decode worker never waits on the file. When the
+/// queue is full the oldest message is dropped rather than blocking the
+/// caller. Warnings and errors are flushed at once, the rest every second.
+///
 /// @param log_file Path to the log file
 /// @param console_output Enable console output
 /// @return true if initialization succeeded
 inline bool init_logging(const std::filesystem::path& log_file, bool console_output = true) {
     try {
+        spdlog::init_thread_pool(kLogQueueSize, 1);
+
         std::vector<spdlog::sink_ptr> sinks;
 
         // File sink
@@ -40,12 +61,15 @@ inline bool init_logging(const std::filesystem::path& log_file, bool console_out
         }
 
         // Create and register logger
-        auto logger = std::make_shared<spdlog::logger>("nive", sinks.begin(), sinks.end());
-        logger->set_level(spdlog::level::trace);
+        auto logger = std::make_shared<spdlog::async_logger>(
+            "nive", sinks.begin(), sinks.end(), spdlog::thread_pool(),
+            spdlog::async_overflow_policy::overrun_oldest);
+        logger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
         logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%s:%#] %v");
 
         spdlog::set_default_logger(logger);
-        spdlog::flush_on(spdlog::level::debug);
+        spdlog::flush_on(spdlog::level::warn);
+        spdlog::flush_every(std::chrono::seconds(1));
 
         return true;
     } catch (const spdlog::spdlog_ex&) {
@@ -53,17 +77,27 @@ inline bool init_logging(const std::filesystem::path& log_file, bool console_out
     }
 }
 
-/// @brief Shutdown the logging system
+/// @brief Shutdown the logging system, writing out queued messages
 inline void shutdown_logging() {
     spdlog::shutdown();
 }
 
+// Log with source location at a level, if the build keeps that level. A
+// stripped statement still names its arguments (checked, never evaluated),
+// so variables kept only for a debug message do not become unused.
+#define NIVE_LOG_AT(active, level, ...)                                                            \
+    do {                                                                                           \
+        if constexpr (SPDLOG_ACTIVE_LEVEL <= (active)) {                                           \
+            SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, __VA_ARGS__);                  \
+        }                                                                                          \
+    } while (false)
+
 // Convenience macros for logging with source location
-#define LOG_TRACE(...) SPDLOG_TRACE(__VA_ARGS__)
-#define LOG_DEBUG(...) SPDLOG_DEBUG(__VA_ARGS__)
-#define LOG_INFO(...) SPDLOG_INFO(__VA_ARGS__)
-#define LOG_WARN(...) SPDLOG_WARN(__VA_ARGS__)
-#define LOG_ERROR(...) SPDLOG_ERROR(__VA_ARGS__)
-#define LOG_CRITICAL(...) SPDLOG_CRITICAL(__VA_ARGS__)
+#define LOG_TRACE(...) NIVE_LOG_AT(SPDLOG_LEVEL_TRACE, spdlog::level::trace, __VA_ARGS__)
+#define LOG_DEBUG(...) NIVE_LOG_AT(SPDLOG_LEVEL_DEBUG, spdlog::level::debug, __VA_ARGS__)
+#define LOG_INFO(...) NIVE_LOG_AT(SPDLOG_LEVEL_INFO, spdlog::level::info, __VA_ARGS__)
+#define LOG_WARN(...) NIVE_LOG_AT(SPDLOG_LEVEL_WARN, spdlog::level::warn, __VA_ARGS__)
+#define LOG_ERROR(...) NIVE_LOG_AT(SPDLOG_LEVEL_ERROR, spdlog::level::err, __VA_ARGS__)
+#define LOG_CRITICAL(...) NIVE_LOG_AT(SPDLOG_LEVEL_CRITICAL, spdlog::level::critical, __VA_ARGS__)
 
 }  // namespace nive
@@ -0,0 +1,111 @@
+/// @file lru_cache.hpp
+/// @brief Least-recently-used cache budgeted by per-entry cost
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+namespace nive {
+
+/// @brief LRU cache implementation, budgeted by a per-entry cost (bytes)
+///
+/// Not synchronised; owners shared across threads guard it with their own lock.
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    [[nodiscard]] std::optional<Value> get(const Key& key) {
+        auto it = cache_map_.find(key);
+        if (it == cache_map_.end()) {
+            return std::nullopt;
+        }
+
+        // Move to front (most recently used)
+        cache_list_.splice(cache_list_.begin(), cache_list_, it->second);
+        return it->second->value;
+    }
+
+    /// @brief Insert or update an entry, evicting least recently used ones to fit
+    /// @return Number of entries evicted
+    size_t put(const Key& key, Value value, size_t cost) {
+        remove(key);
+
+        // An entry larger than the whole budget is not worth caching
+        if (cost > capacity_) {
+            return 0;
+        }
+
+        size_t evicted = 0;
+        while (!cache_list_.empty() && total_cost_ + cost > capacity_) {
+            evict_last();
+            ++evicted;
+        }
+
+        cache_list_.push_front(Node{key, std::move(value), cost});
+        cache_map_[key] = cache_list_.begin();
+        total_cost_ += cost;
+        return evicted;
+    }
+
+    void remove(const Key& key) {
+        auto it = cache_map_.find(key);
+        if (it != cache_map_.end()) {
+            total_cost_ -= it->second->cost;
+            cache_list_.erase(it->second);
+            cache_map_.erase(it);
+        }
+    }
+
+    [[nodiscard]] bool contains(const Key& key) const {
+        return cache_map_.find(key) != cache_map_.end();
+    }
+
+    /// @brief Evict least recently used entries until the costs sum to at most cost
+    /// @return Number of entries evicted
+    size_t shrinkTo(size_t cost) {
+        size_t evicted = 0;
+        while (!cache_list_.empty() && total_cost_ > cost) {
+            evict_last();
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    void clear() {
+        cache_list_.clear();
+        cache_map_.clear();
+        total_cost_ = 0;
+    }
+
+    [[nodiscard]] size_t size() const { return cache_map_.size(); }
+
+    /// @brief Sum of the costs of all entries
+    [[nodiscard]] size_t totalCost() const { return total_cost_; }
+
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+
+private:
+    struct Node {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    void evict_last() {
+        auto& last = cache_list_.back();
+        total_cost_ -= last.cost;
+        cache_map_.erase(last.key);
+        cache_list_.pop_back();
+    }
+
+    size_t capacity_;
+    size_t total_cost_ = 0;
+    std::list<Node> cache_list_;
+    std::unordered_map<Key, typename std::list<Node>::iterator> cache_map_;
+};
+
+}  // namespace nive
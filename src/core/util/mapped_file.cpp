@@ -0,0 +1,85 @@
+/// @file mapped_file.cpp
+/// @brief Memory-mapped file implementation
+
+#include "mapped_file.hpp"
+
+#include "win32_utils.hpp"
+
+namespace nive {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+std::optional<MappedFile> MappedFile::open(const std::filesystem::path& path, Access access) {
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    flags |= access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HandleGuard file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 nullptr, OPEN_EXISTING, flags, nullptr));
+    if (!file) {
+        return std::nullopt;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file.get(), &size) || size.QuadPart <= 0 ||
+        static_cast<uint64_t>(size.QuadPart) > SIZE_MAX) {
+        return std::nullopt;
+    }
+
+    // The view keeps the section alive after both handles are closed
+    HandleGuard mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping) {
+        return std::nullopt;
+    }
+    void* view = MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        return std::nullopt;
+    }
+
+    MappedFile result;
+    result.data_ = static_cast<const uint8_t*>(view);
+    result.size_ = static_cast<size_t>(size.QuadPart);
+    return result;
+}
+
+void MappedFile::prefault() const noexcept {
+    if (!data_) {
+        return;
+    }
+
+    // One large batched read, then a touch per page for anything it skipped
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t*>(data_), size_};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+
+    constexpr size_t kPageSize = 4096;
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < size_; offset += kPageSize) {
+        sink = sink + data_[offset];
+    }
+}
+
+void MappedFile::close() noexcept {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+}  // namespace nive
@@ -0,0 +1,62 @@
+/// @file mapped_file.hpp
+/// @brief Read-only memory-mapped view of a whole file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace nive {
+
+/// @brief Whole file mapped read-only into memory
+///
+/// For handing file contents to decoders that take a memory buffer without
+/// first copying them into one. Pages are read in as the view is touched.
+/// A read error on the underlying file (e.g. a dropped network share) raises
+/// an in-page exception while the view is read, rather than failing up front.
+class MappedFile {
+public:
+    /// @brief How the view will be read (a hint to the file cache)
+    enum class Access {
+        Sequential,  // Front to back once, as decoders do (FILE_FLAG_SEQUENTIAL_SCAN)
+        Random,
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    // Non-copyable
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Movable
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /// @brief Map a file
+    /// @param path File to map (opened shared for reading and writing, not deletion)
+    /// @param access Expected read pattern
+    /// @return Mapped file, or nullopt if it cannot be opened or is empty
+    [[nodiscard]] static std::optional<MappedFile> open(const std::filesystem::path& path,
+                                                        Access access = Access::Sequential);
+
+    [[nodiscard]] const uint8_t* data() const noexcept { return data_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept { return {data_, size_}; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    /// @brief Read the whole file into memory now, so later reads of the view do not block
+    void prefault() const noexcept;
+
+    /// @brief Unmap the view (data() becomes null)
+    void close() noexcept;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace nive
@@ -0,0 +1,76 @@
+/// @file memory_accounting.cpp
+/// @brief Memory accounting counters
+
+#include "memory_accounting.hpp"
+
+#include <format>
+
+namespace nive {
+
+namespace {
+
+// Constant-initialised and trivially destructible, so charges held by other
+// statics (the pixel pool) can still drop theirs at exit
+constinit std::array<std::atomic<uint64_t>, kMemoryCategoryCount> g_charged{};
+
+}  // namespace
+
+std::string_view to_string(MemoryCategory category) noexcept {
+    switch (category) {
+    case MemoryCategory::CacheTier:
+        return "cache";
+    case MemoryCategory::GridBitmaps:
+        return "grid_gpu";
+    case MemoryCategory::GridPixels:
+        return "grid_cpu";
+    case MemoryCategory::Viewer:
+        return "viewer";
+    case MemoryCategory::ArchiveBuffers:
+        return "archive";
+    case MemoryCategory::QueuedSources:
+        return "queued";
+    case MemoryCategory::PixelPool:
+        return "pixel_pool";
+    }
+    return "unknown";
+}
+
+uint64_t MemoryUsage::total() const noexcept {
+    uint64_t sum = 0;
+    for (uint64_t value : bytes) {
+        sum += value;
+    }
+    return sum;
+}
+
+MemoryUsage memoryUsage() noexcept {
+    MemoryUsage usage;
+    for (size_t i = 0; i < kMemoryCategoryCount; ++i) {
+        usage.bytes[i] = g_charged[i].load(std::memory_order_relaxed);
+    }
+    return usage;
+}
+
+std::string formatMemoryUsage(const MemoryUsage& usage) {
+    constexpr double kMiB = 1024.0 * 1024.0;
+    std::string text;
+    for (size_t i = 0; i < kMemoryCategoryCount; ++i) {
+        text += std::format("{}{} {:.1f} MiB", i ? ", " : "",
+                            to_string(static_cast<MemoryCategory>(i)),
+                            static_cast<double>(usage.bytes[i]) / kMiB);
+    }
+    text += std::format(" (total {:.1f} MiB)", static_cast<double>(usage.total()) / kMiB);
+    return text;
+}
+
+void MemoryCharge::set(uint64_t bytes) noexcept {
+    auto& counter = g_charged[static_cast<size_t>(category_)];
+    if (bytes > bytes_) {
+        counter.fetch_add(bytes - bytes_, std::memory_order_relaxed);
+    } else if (bytes < bytes_) {
+        counter.fetch_sub(bytes_ - bytes, std::memory_order_relaxed);
+    }
+    bytes_ = bytes;
+}
+
+}  // namespace nive
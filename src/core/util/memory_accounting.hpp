@@ -0,0 +1,106 @@
+/// @file memory_accounting.hpp
+/// @brief Process-wide byte counters of the large allocations, by subsystem
+///
+/// Each owner of a big buffer holds a MemoryCharge and sets it to the bytes
+/// it keeps; the charge is dropped when the owner goes. memoryUsage() sums
+/// the charges per category for the performance overlay and the low-memory
+/// log. Counting is a relaxed atomic add per change, so owners can update
+/// on every insert and evict.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace nive {
+
+/// @brief Subsystem a charge belongs to
+enum class MemoryCategory : uint8_t {
+    CacheTier,       // CacheManager's memory tier of thumbnail entries
+    GridBitmaps,     // ThumbnailGrid's atlas pages and standalone bitmaps (GPU)
+    GridPixels,      // ThumbnailGrid's decoded thumbnails not yet uploaded
+    Viewer,          // The viewer's image, its fit copy and mip levels
+    ArchiveBuffers,  // Nested archives held in memory by ArchiveManager
+    QueuedSources,   // memory_data of thumbnail requests queued or in flight
+    PixelPool,       // Free blocks kept by image::PixelBufferPool
+};
+
+inline constexpr size_t kMemoryCategoryCount = 7;
+
+/// @brief Short name of a category, as the overlay and logs show it
+[[nodiscard]] std::string_view to_string(MemoryCategory category) noexcept;
+
+/// @brief Bytes charged per category at one moment
+struct MemoryUsage {
+    std::array<uint64_t, kMemoryCategoryCount> bytes{};
+
+    [[nodiscard]] uint64_t operator[](MemoryCategory category) const noexcept {
+        return bytes[static_cast<size_t>(category)];
+    }
+
+    /// @brief Sum over every category
+    [[nodiscard]] uint64_t total() const noexcept;
+};
+
+/// @brief Read the current charges
+///
+/// Categories are read one after another, so the total is close, not exact,
+/// while owners are changing theirs.
+[[nodiscard]] MemoryUsage memoryUsage() noexcept;
+
+/// @brief Format usage as "cache 12.0 MiB, grid_gpu 48.0 MiB, ..." for logging
+[[nodiscard]] std::string formatMemoryUsage(const MemoryUsage& usage);
+
+/// @brief Bytes one owner holds in a category
+///
+/// Copying charges the same bytes again (a copy of the owner copies its
+/// buffers); moving hands the charge over. Not synchronised: the owner
+/// guards set() with its own lock, as it does the buffers themselves.
+class MemoryCharge {
+public:
+    explicit MemoryCharge(MemoryCategory category) noexcept : category_(category) {}
+    ~MemoryCharge() { set(0); }
+
+    MemoryCharge(const MemoryCharge& other) noexcept : category_(other.category_) {
+        set(other.bytes_);
+    }
+
+    MemoryCharge& operator=(const MemoryCharge& other) noexcept {
+        if (this != &other) {
+            set(0);
+            category_ = other.category_;
+            set(other.bytes_);
+        }
+        return *this;
+    }
+
+    MemoryCharge(MemoryCharge&& other) noexcept
+        : category_(other.category_), bytes_(other.bytes_) {
+        other.bytes_ = 0;
+    }
+
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+        if (this != &other) {
+            set(0);
+            category_ = other.category_;
+            bytes_ = other.bytes_;
+            other.bytes_ = 0;
+        }
+        return *this;
+    }
+
+    /// @brief Set the bytes this owner holds now
+    void set(uint64_t bytes) noexcept;
+
+    [[nodiscard]] uint64_t bytes() const noexcept { return bytes_; }
+
+private:
+    MemoryCategory category_;
+    uint64_t bytes_ = 0;
+};
+
+}  // namespace nive
@@ -0,0 +1,59 @@
+/// @file memory_pressure.cpp
+/// @brief Low-memory notification implementation
+
+#include "memory_pressure.hpp"
+
+#include <Windows.h>
+
+#include <utility>
+
+#include "logger.hpp"
+
+namespace nive {
+
+MemoryPressureMonitor::MemoryPressureMonitor(std::function<void()> on_low_memory,
+                                             std::chrono::milliseconds cooldown)
+    : on_low_memory_(std::move(on_low_memory)), cooldown_(cooldown) {
+    notification_ = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    stop_event_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!notification_ || !stop_event_) {
+        LOG_WARN("Memory pressure monitor unavailable: error {}", GetLastError());
+        return;
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() {
+    if (thread_.joinable()) {
+        SetEvent(stop_event_);
+        thread_.join();
+    }
+    for (void* handle : {notification_, stop_event_}) {
+        if (handle) {
+            CloseHandle(handle);
+        }
+    }
+}
+
+bool MemoryPressureMonitor::isLow() const noexcept {
+    BOOL low = FALSE;
+    return notification_ && QueryMemoryResourceNotification(notification_, &low) && low;
+}
+
+void MemoryPressureMonitor::run() {
+    HANDLE handles[] = {stop_event_, notification_};
+    auto cooldown_ms = static_cast<DWORD>(cooldown_.count());
+    while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        LOG_INFO("Physical memory is low; trimming caches");
+        try {
+            on_low_memory_();
+        } catch (...) {
+            // Ignore callback exceptions
+        }
+        if (WaitForSingleObject(stop_event_, cooldown_ms) == WAIT_OBJECT_0) {
+            break;
+        }
+    }
+}
+
+}  // namespace nive
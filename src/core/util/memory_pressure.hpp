@@ -0,0 +1,51 @@
+/// @file memory_pressure.hpp
+/// @brief Notification of low physical memory, for caches to trim themselves
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace nive {
+
+/// @brief Calls back when the system reports low physical memory
+///
+/// Waits on CreateMemoryResourceNotification(LowMemoryResourceNotification)
+/// on a thread of its own. The notification stays signalled for as long as
+/// memory is low, so after each callback the monitor waits out a cooldown
+/// before it can fire again, giving the trimmed memory time to show.
+class MemoryPressureMonitor {
+public:
+    static constexpr std::chrono::milliseconds kDefaultCooldown{10000};
+
+    /// @brief Start monitoring
+    /// @param on_low_memory Called on the monitor thread; post to the owner's thread from it
+    /// @param cooldown Least time between two callbacks
+    explicit MemoryPressureMonitor(std::function<void()> on_low_memory,
+                                   std::chrono::milliseconds cooldown = kDefaultCooldown);
+    ~MemoryPressureMonitor();
+
+    // Non-copyable, non-movable
+    MemoryPressureMonitor(const MemoryPressureMonitor&) = delete;
+    MemoryPressureMonitor& operator=(const MemoryPressureMonitor&) = delete;
+    MemoryPressureMonitor(MemoryPressureMonitor&&) = delete;
+    MemoryPressureMonitor& operator=(MemoryPressureMonitor&&) = delete;
+
+    /// @brief Check if monitoring runs (the notification could be created)
+    [[nodiscard]] bool active() const noexcept { return thread_.joinable(); }
+
+    /// @brief Check if physical memory is low right now
+    [[nodiscard]] bool isLow() const noexcept;
+
+private:
+    void run();
+
+    std::function<void()> on_low_memory_;
+    std::chrono::milliseconds cooldown_;
+    void* notification_ = nullptr;  // HANDLE
+    void* stop_event_ = nullptr;    // HANDLE
+    std::thread thread_;
+};
+
+}  // namespace nive
@@ -0,0 +1,53 @@
+/// @file path_interner.cpp
+/// @brief Path interner implementation
+
+#include "path_interner.hpp"
+
+#include <mutex>
+
+namespace nive {
+
+PathInterner& PathInterner::instance() {
+    static PathInterner interner;
+    return interner;
+}
+
+PathId PathInterner::intern(std::wstring_view path) {
+    {
+        std::shared_lock lock(mutex_);
+        if (auto it = ids_.find(path); it != ids_.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock lock(mutex_);
+    if (auto it = ids_.find(path); it != ids_.end()) {
+        return it->second;  // Interned by another thread in between
+    }
+    const std::wstring& stored = paths_.emplace_back(path);
+    auto id = static_cast<PathId>(paths_.size());
+    ids_.emplace(stored, id);
+    return id;
+}
+
+PathId PathInterner::find(std::wstring_view path) const {
+    std::shared_lock lock(mutex_);
+    auto it = ids_.find(path);
+    return it != ids_.end() ? it->second : kNoPathId;
+}
+
+const std::wstring& PathInterner::path(PathId id) const {
+    static const std::wstring kEmpty;
+    std::shared_lock lock(mutex_);
+    if (id == kNoPathId || id > paths_.size()) {
+        return kEmpty;
+    }
+    return paths_[id - 1];
+}
+
+size_t PathInterner::size() const {
+    std::shared_lock lock(mutex_);
+    return paths_.size();
+}
+
+}  // namespace nive
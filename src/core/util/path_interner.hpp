@@ -0,0 +1,77 @@
+/// @file path_interner.hpp
+/// @brief Process-wide compact ids for paths
+///
+/// The thumbnail pipeline keys every request, result and UI map by a
+/// source's path string (the virtual path string for archive entries).
+/// Interning it once gives a 32-bit id that is hashed and compared in a
+/// single step, and carried through the pipeline instead of the string.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace nive {
+
+/// @brief Id of an interned path; equal ids mean equal path strings
+using PathId = uint32_t;
+
+/// @brief Id of no path, never handed out
+inline constexpr PathId kNoPathId = 0;
+
+/// @brief Maps path strings to PathIds and back
+///
+/// Strings are compared exactly, as the string keys they replace were.
+/// Ids are handed out in order from 1 and stay valid for the life of the
+/// process: strings are never removed, so a table holds each path seen
+/// once (tens of bytes per path).
+///
+/// Thread-safe: yes. Lookups of known paths share a reader lock.
+class PathInterner {
+public:
+    PathInterner() = default;
+
+    PathInterner(const PathInterner&) = delete;
+    PathInterner& operator=(const PathInterner&) = delete;
+
+    /// @brief Get the process-wide table
+    [[nodiscard]] static PathInterner& instance();
+
+    /// @brief Get the id of a path string, interning it if new
+    [[nodiscard]] PathId intern(std::wstring_view path);
+
+    /// @brief Get the id of a path string if it was interned
+    /// @return Id, or kNoPathId if the path was never interned
+    [[nodiscard]] PathId find(std::wstring_view path) const;
+
+    /// @brief Get the path string of an id
+    /// @return Path, or an empty string for kNoPathId and unknown ids
+    ///
+    /// The reference stays valid for the life of the table.
+    [[nodiscard]] const std::wstring& path(PathId id) const;
+
+    /// @brief Get the number of interned paths
+    [[nodiscard]] size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::deque<std::wstring> paths_;                     // Id - 1 -> path; never moves
+    std::unordered_map<std::wstring_view, PathId> ids_;  // Views into paths_
+};
+
+/// @brief Intern a path in the process-wide table
+[[nodiscard]] inline PathId internPath(std::wstring_view path) {
+    return PathInterner::instance().intern(path);
+}
+
+/// @brief Intern a path in the process-wide table
+[[nodiscard]] inline PathId internPath(const std::filesystem::path& path) {
+    return PathInterner::instance().intern(path.native());
+}
+
+}  // namespace nive
@@ -0,0 +1,44 @@
+/// @file task.cpp
+/// @brief Detached task runner
+
+#include "task.hpp"
+
+#include <exception>
+
+#include "logger.hpp"
+
+namespace nive {
+
+namespace {
+
+/// @brief Eagerly started coroutine that frees its frame when it ends
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const noexcept {
+            try {
+                throw;
+            } catch (const std::exception& e) {
+                LOG_ERROR("Detached task failed: {}", e.what());
+            } catch (...) {
+                LOG_ERROR("Detached task failed with an unknown exception");
+            }
+        }
+    };
+};
+
+DetachedTask run_detached(Task<void> task) {
+    co_await std::move(task);
+}
+
+}  // namespace
+
+void detach(Task<void> task) {
+    run_detached(std::move(task));
+}
+
+}  // namespace nive
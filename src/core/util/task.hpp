@@ -0,0 +1,223 @@
+/// @file task.hpp
+/// @brief C++20 coroutine task type and adapters for callback-based async APIs
+///
+/// A Task<T> is a lazily started coroutine: it runs when awaited, on the
+/// awaiting thread, until it suspends on something (an executor hop, a
+/// callback-based operation) and is resumed wherever that completes. Where
+/// it runs next is chosen explicitly with co_await resumeOn(executor)
+/// (executor.hpp), so a chain such as "scan on the pool, then update the
+/// list on the UI thread" costs one hop per co_await instead of a
+/// std::function per stage.
+///
+///     Task<void> refresh(fs::DirectoryFilter filter) {
+///         auto listing = co_await fs::scanDirectoryAsync(path, filter, order, stop);
+///         co_await resumeOn(ui_executor);
+///         show(std::move(listing));
+///     }
+
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace nive {
+
+template <typename T = void>
+class [[nodiscard]] Task;
+
+namespace detail {
+
+/// @brief Resumes the awaiting coroutine when a task finishes (symmetric transfer)
+struct TaskFinalAwaiter {
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    [[nodiscard]] std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> finished) const noexcept {
+        if (auto continuation = finished.promise().continuation) {
+            return continuation;
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+    [[nodiscard]] TaskFinalAwaiter final_suspend() const noexcept { return {}; }
+};
+
+template <typename T>
+struct TaskPromise final : TaskPromiseBase {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+
+    [[nodiscard]] Task<T> get_return_object() noexcept;
+
+    template <typename U>
+        requires std::convertible_to<U&&, T>
+    void return_value(U&& value) {
+        result.template emplace<1>(std::forward<U>(value));
+    }
+
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+
+    [[nodiscard]] T take() {
+        if (result.index() == 2) {
+            std::rethrow_exception(std::get<2>(result));
+        }
+        return std::move(std::get<1>(result));
+    }
+};
+
+template <>
+struct TaskPromise<void> final : TaskPromiseBase {
+    std::exception_ptr error;
+
+    [[nodiscard]] Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    void take() const {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+}  // namespace detail
+
+/// @brief Lazily started coroutine producing a T
+///
+/// Move-only; owns the coroutine frame. co_await runs the task and yields
+/// its result, rethrowing any exception it ended with. A task must be
+/// awaited (or handed to detach()) to run at all.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() noexcept = default;
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task() { reset(); }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /// @brief Check if the task holds a coroutine
+    [[nodiscard]] bool valid() const noexcept { return handle_ != nullptr; }
+
+    [[nodiscard]] auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            [[nodiscard]] bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            [[nodiscard]] std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<> awaiting) const noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() const { return handle.promise().take(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    void reset() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+}  // namespace detail
+
+/// @brief Start a task nobody awaits; it frees itself when done
+///
+/// An exception the task ends with is logged and dropped.
+void detach(Task<void> task);
+
+/// @brief Awaitable over a callback-based operation
+///
+/// start is called with a one-shot callback taking the Result; the awaiting
+/// coroutine resumes on whichever thread calls it, or continues inline if
+/// it was called before start returned. No thread hop is added.
+///
+///     auto entry = co_await awaitCallback<Result>([&](auto done) {
+///         database.getAsync(key, std::move(done));
+///     });
+template <typename Result, typename Start>
+class [[nodiscard]] CallbackAwaitable {
+public:
+    explicit CallbackAwaitable(Start start) : start_(std::move(start)) {}
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+    [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        start_([this](Result result) {
+            result_.emplace(std::move(result));
+            // Second to arrive resumes: here, unless await_suspend has not returned yet
+            if (arrived_.exchange(true, std::memory_order_acq_rel)) {
+                handle_.resume();
+            }
+        });
+        return !arrived_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    [[nodiscard]] Result await_resume() { return std::move(*result_); }
+
+private:
+    Start start_;
+    std::coroutine_handle<> handle_;
+    std::optional<Result> result_;
+    std::atomic<bool> arrived_{false};
+};
+
+/// @brief Make a CallbackAwaitable, deducing the starter's type
+template <typename Result, typename Start>
+[[nodiscard]] CallbackAwaitable<Result, std::decay_t<Start>> awaitCallback(Start&& start) {
+    return CallbackAwaitable<Result, std::decay_t<Start>>(std::forward<Start>(start));
+}
+
+}  // namespace nive
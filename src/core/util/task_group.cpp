@@ -0,0 +1,53 @@
+/// @file task_group.cpp
+/// @brief TaskGroup implementation
+
+#include "task_group.hpp"
+
+namespace nive {
+
+void TaskGroup::State::fail(std::exception_ptr failure) {
+    {
+        std::lock_guard lock(mutex);
+        if (!error) {
+            error = std::move(failure);
+        }
+    }
+    stop.request_stop();
+}
+
+void TaskGroup::State::finish() noexcept {
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pending.notify_all();
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool, TaskPriority priority)
+    : pool_(pool), priority_(priority), state_(std::make_shared<State>()) {
+}
+
+TaskGroup::~TaskGroup() {
+    join();
+}
+
+void TaskGroup::wait() {
+    join();
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(state_->mutex);
+        error = std::exchange(state_->error, nullptr);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGroup::join() noexcept {
+    for (size_t pending; (pending = state_->pending.load(std::memory_order_acquire)) != 0;) {
+        // Help while tasks are queued; block once the rest are running elsewhere
+        if (!pool_.runPending(priority_)) {
+            state_->pending.wait(pending, std::memory_order_acquire);
+        }
+    }
+}
+
+}  // namespace nive
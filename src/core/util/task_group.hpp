@@ -0,0 +1,154 @@
+/// @file task_group.hpp
+/// @brief Structured fork/join on the ThreadPool: TaskGroup and parallelFor
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+
+#include "thread_pool.hpp"
+
+namespace nive {
+
+/// @brief Tasks run on a pool and waited for together
+///
+/// Tasks are posted without futures. wait() returns once every task has
+/// finished, running queued pool tasks on the calling thread meanwhile
+/// rather than only blocking. The first exception a task throws cancels the
+/// group and is rethrown by wait(). Tasks not yet started when the group is
+/// cancelled are skipped; running ones can poll stopToken().
+///
+/// The destructor waits too (dropping any exception), so tasks may capture
+/// locals of the scope that owns the group.
+///
+/// Thread-safe: run() and cancel() from any thread, including group tasks
+class TaskGroup {
+public:
+    /// @param pool Pool the tasks run on
+    /// @param priority Lane the tasks are queued in; wait() helps with tasks of
+    ///                 this lane or above
+    explicit TaskGroup(ThreadPool& pool = globalThreadPool(),
+                       TaskPriority priority = TaskPriority::Normal);
+
+    /// @brief Wait for the tasks, dropping an exception wait() would rethrow
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /// @brief Queue a task of the group
+    template <std::invocable F>
+    void run(F&& task) {
+        state_->pending.fetch_add(1, std::memory_order_relaxed);
+        try {
+            pool_.post(
+                [state = state_, task = std::forward<F>(task)]() mutable {
+                    if (!state->stop.stop_requested()) {
+                        try {
+                            task();
+                        } catch (...) {
+                            state->fail(std::current_exception());
+                        }
+                    }
+                    state->finish();
+                },
+                priority_);
+        } catch (...) {
+            state_->finish();
+            throw;
+        }
+    }
+
+    /// @brief Wait for every task queued so far and those they queue
+    /// @throws The first exception a task threw
+    void wait();
+
+    /// @brief Skip tasks not yet started and ask running ones to stop
+    void cancel() noexcept { state_->stop.request_stop(); }
+
+    /// @brief Check if the group was cancelled (or a task threw)
+    [[nodiscard]] bool cancelled() const noexcept { return state_->stop.stop_requested(); }
+
+    /// @brief Token that is stopped when the group is cancelled
+    [[nodiscard]] std::stop_token stopToken() const noexcept { return state_->stop.get_token(); }
+
+private:
+    /// @brief Shared with the queued tasks, so the last one may finish after wait() returned
+    struct State {
+        std::atomic<size_t> pending{0};
+        std::stop_source stop;
+        std::mutex mutex;
+        std::exception_ptr error;  // First failure
+
+        void fail(std::exception_ptr failure);
+        void finish() noexcept;
+    };
+
+    /// @brief Wait without rethrowing
+    void join() noexcept;
+
+    ThreadPool& pool_;
+    TaskPriority priority_;
+    std::shared_ptr<State> state_;
+};
+
+/// @brief Run fn over [first, last) in chunks of grain elements on a pool and the caller
+///
+/// Chunks are claimed in order from a shared counter by the caller and by up
+/// to one helper task per worker, so uneven chunks balance themselves. A
+/// range of one chunk runs on the caller alone. Returns once every chunk is
+/// done; the first exception thrown stops further chunks and is rethrown.
+///
+/// @param first First index
+/// @param last One past the last index
+/// @param grain Elements per chunk (at least 1); pick it so a chunk is worth a task
+/// @param fn Callable as fn(chunk_first, chunk_last), called concurrently
+/// @param pool Pool the helpers run on
+/// @param priority Lane of the helper tasks
+template <typename F>
+    requires std::invocable<F&, size_t, size_t>
+void parallelFor(size_t first, size_t last, size_t grain, F&& fn,
+                 ThreadPool& pool = globalThreadPool(),
+                 TaskPriority priority = TaskPriority::High) {
+    if (first >= last) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (last - first - 1) / grain + 1;
+    if (chunks == 1 || pool.workerCount() == 0) {
+        fn(first, last);
+        return;
+    }
+
+    std::atomic<size_t> next{0};  // Next chunk to claim
+    TaskGroup group(pool, priority);
+    auto claim = [&] {
+        for (size_t chunk; !group.cancelled() &&
+                           (chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+            size_t begin = first + chunk * grain;
+            fn(begin, std::min(begin + grain, last));
+        }
+    };
+
+    size_t helpers = std::min(chunks - 1, pool.workerCount());
+    for (size_t i = 0; i < helpers; ++i) {
+        group.run(claim);
+    }
+    try {
+        claim();
+    } catch (...) {
+        // The helpers reference this frame: stop them before unwinding
+        group.cancel();
+        throw;  // ~TaskGroup waits
+    }
+    group.wait();
+}
+
+}  // namespace nive
@@ -3,14 +3,258 @@
 
 #include "thread_pool.hpp"
 
+#include <algorithm>
+#include <deque>
 #include <format>
+#include <mutex>
+
+#include "logger.hpp"
 
 namespace nive {
 
+namespace {
+
+/// @brief Free list of PoolJob blocks of one thread
+///
+/// Trivially destructible so it stays usable while the thread exits; the
+/// blocks are released by BlockCacheCleanup, after which frees go straight
+/// to the heap.
+struct BlockCache {
+    struct Node {
+        Node* next;
+    };
+
+    static constexpr size_t kMaxBlocks = 64;
+
+    Node* head = nullptr;
+    size_t count = 0;
+    bool closed = false;
+};
+
+thread_local BlockCache t_blocks;
+
+struct BlockCacheCleanup {
+    ~BlockCacheCleanup() {
+        while (auto* node = t_blocks.head) {
+            t_blocks.head = node->next;
+            ::operator delete(node, detail::PoolJob::kSmallSize);
+        }
+        t_blocks.count = 0;
+        t_blocks.closed = true;
+    }
+};
+
+thread_local BlockCacheCleanup t_block_cleanup;
+
+/// @brief Pool and index of the worker running on this thread, if any
+struct CurrentWorker {
+    const ThreadPool* pool = nullptr;
+    size_t index = 0;
+};
+
+thread_local CurrentWorker t_worker;
+
+/// @brief Chase-Lev work-stealing deque of jobs
+///
+/// The owning worker pushes and pops at the bottom; any thread steals from
+/// the top. Follows Le et al., "Correct and Efficient Work-Stealing for Weak
+/// Memory Models" (PPoPP 2013). The ring only grows; outgrown rings are kept
+/// until the deque is destroyed because a thief may still be reading one.
+class WorkDeque {
+public:
+    WorkDeque() {
+        rings_.push_back(std::make_unique<Ring>(kInitialCapacity));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    /// @brief Add a job at the bottom (owner only)
+    void push(detail::PoolJob* job) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        if (bottom - top >= ring->capacity) {
+            ring = grow(ring, top, bottom);
+        }
+        ring->put(bottom, job);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /// @brief Take the job at the bottom, the one pushed last (owner only)
+    [[nodiscard]] detail::PoolJob* pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        detail::PoolJob* job = ring->get(bottom);
+        if (top == bottom) {
+            // Last job: race the thieves for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    /// @brief Take the job at the top, the oldest (any thread)
+    /// @return Job, or null if empty or another thread took it first
+    [[nodiscard]] detail::PoolJob* steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        detail::PoolJob* job = ring_.load(std::memory_order_acquire)->get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+private:
+    static constexpr int64_t kInitialCapacity = 64;
+
+    struct Ring {
+        explicit Ring(int64_t size)
+            : capacity(size), slots(std::make_unique<std::atomic<detail::PoolJob*>[]>(size)) {}
+
+        [[nodiscard]] detail::PoolJob* get(int64_t index) const {
+            return slots[index & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, detail::PoolJob* job) {
+            slots[index & (capacity - 1)].store(job, std::memory_order_relaxed);
+        }
+
+        int64_t capacity;  // Power of two
+        std::unique_ptr<std::atomic<detail::PoolJob*>[]> slots;
+    };
+
+    Ring* grow(Ring* ring, int64_t top, int64_t bottom) {
+        auto grown = std::make_unique<Ring>(ring->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->put(i, ring->get(i));
+        }
+        rings_.push_back(std::move(grown));
+        ring = rings_.back().get();
+        ring_.store(ring, std::memory_order_release);
+        return ring;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Ring*> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings_;  // Owner only
+};
+
+/// @brief CPU set IDs of the cores an affinity prefers
+/// @return IDs, or empty for Any, on non-hybrid CPUs, or if the query fails
+[[nodiscard]] std::vector<ULONG> cpu_sets_for(ThreadAffinity affinity) {
+    if (affinity == ThreadAffinity::Any) {
+        return {};
+    }
+    ULONG length = 0;
+    GetSystemCpuSetInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+    if (length == 0) {
+        return {};
+    }
+    std::vector<std::byte> buffer(length);
+    auto* first = reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data());
+    if (!GetSystemCpuSetInformation(first, length, &length, GetCurrentProcess(), 0)) {
+        return {};
+    }
+
+    std::vector<std::pair<ULONG, BYTE>> sets;  // ID, efficiency class
+    BYTE lowest = 0xFF;
+    BYTE highest = 0;
+    for (ULONG offset = 0; offset < length;) {
+        const auto* info =
+            reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(buffer.data() + offset);
+        if (info->Size == 0) {
+            break;
+        }
+        if (info->Type == CpuSetInformation) {
+            BYTE efficiency = info->CpuSet.EfficiencyClass;
+            sets.emplace_back(info->CpuSet.Id, efficiency);
+            lowest = std::min(lowest, efficiency);
+            highest = std::max(highest, efficiency);
+        }
+        offset += info->Size;
+    }
+    if (sets.empty() || lowest == highest) {
+        return {};
+    }
+
+    // Higher classes are the faster cores
+    BYTE wanted = affinity == ThreadAffinity::Performance ? highest : lowest;
+    std::vector<ULONG> ids;
+    for (const auto& [id, efficiency] : sets) {
+        if (efficiency == wanted) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+}  // namespace
+
+namespace detail {
+
+void* PoolJob::operator new(size_t size) {
+    if (size <= kSmallSize) {
+        if (auto* node = t_blocks.head) {
+            t_blocks.head = node->next;
+            --t_blocks.count;
+            return node;
+        }
+        return ::operator new(kSmallSize);
+    }
+    return ::operator new(size);
+}
+
+void PoolJob::operator delete(void* block, size_t size) noexcept {
+    if (size > kSmallSize) {
+        ::operator delete(block, size);
+        return;
+    }
+    if (t_blocks.closed || t_blocks.count >= BlockCache::kMaxBlocks) {
+        ::operator delete(block, kSmallSize);
+        return;
+    }
+    (void)&t_block_cleanup;  // Registers the cleanup on this thread's first cached block
+    t_blocks.head = new (block) BlockCache::Node{t_blocks.head};
+    ++t_blocks.count;
+}
+
+}  // namespace detail
+
+/// @brief Deques of one worker, one per lane
+struct alignas(64) ThreadPool::Worker {
+    WorkDeque lanes[kTaskPriorityCount];
+};
+
+/// @brief Queues for tasks submitted from outside the pool, and pool-wide settings
+struct ThreadPool::Shared {
+    std::mutex mutex;
+    std::deque<detail::PoolJob*> lanes[kTaskPriorityCount];
+    std::atomic<size_t> sizes[kTaskPriorityCount]{};  // Read without the mutex to skip empty lanes
+    std::vector<ULONG> cpu_sets;                      // Empty: no affinity
+};
+
 ThreadPool::ThreadPool() : ThreadPool(ThreadPoolConfig{}) {
 }
 
-ThreadPool::ThreadPool(ThreadPoolConfig config) : config_(config) {
+ThreadPool::ThreadPool(ThreadPoolConfig config)
+    : config_(config), shared_(std::make_unique<Shared>()) {
     size_t num_threads = config_.num_threads;
     if (num_threads == 0) {
         num_threads = std::thread::hardware_concurrency();
@@ -19,24 +263,99 @@ ThreadPool::ThreadPool(ThreadPoolConfig config) : config_(config) {
         }
     }
 
+    shared_->cpu_sets = cpu_sets_for(config_.affinity);
+    if (!shared_->cpu_sets.empty()) {
+        LOG_DEBUG("{}: {} workers on {} CPU sets", config_.name_prefix, num_threads,
+                  shared_->cpu_sets.size());
+    }
+
     workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
 
+    threads_.reserve(num_threads);
     for (size_t i = 0; i < num_threads; ++i) {
-        workers_.emplace_back([this, i](std::stop_token stop_token) { workerLoop(stop_token, i); });
+        threads_.emplace_back([this, i](std::stop_token stop_token) { workerLoop(stop_token, i); });
     }
 }
 
 ThreadPool::~ThreadPool() {
-    // Request stop - workers will exit their loops
+    // Workers run what is queued, then exit their loops
+    requestStop();
+    threads_.clear();
+
+    // A task queued as the last worker exited is run here
+    while (auto* job = take(kNoWorker)) {
+        runJob(job);
+    }
+}
+
+void ThreadPool::requestStop() noexcept {
     stop_source_.request_stop();
-    queue_cv_.notify_all();
+    wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    wake_epoch_.notify_all();
+}
+
+void ThreadPool::enqueue(std::unique_ptr<detail::PoolJob> job, TaskPriority priority) {
+    auto lane = static_cast<size_t>(priority);
+    outstanding_.fetch_add(1, std::memory_order_relaxed);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    try {
+        if (t_worker.pool == this) {
+            workers_[t_worker.index]->lanes[lane].push(job.get());
+        } else {
+            std::lock_guard lock(shared_->mutex);
+            shared_->lanes[lane].push_back(job.get());
+            shared_->sizes[lane].fetch_add(1, std::memory_order_release);
+        }
+    } catch (...) {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        outstanding_.fetch_sub(1, std::memory_order_relaxed);
+        throw;
+    }
+    (void)job.release();  // Owned by the queue until run
 
-    // jthreads automatically join on destruction
+    // A worker about to sleep rereads the epoch, so it never misses this job
+    wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+        wake_epoch_.notify_one();
+    }
 }
 
-void ThreadPool::workerLoop(std::stop_token stop_token, [[maybe_unused]] size_t worker_id) {
+detail::PoolJob* ThreadPool::take(size_t worker_id, size_t lanes) {
+    size_t count = workers_.size();
+    bool owner = worker_id != kNoWorker;
+    size_t start = owner ? worker_id : 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        detail::PoolJob* job = owner ? workers_[worker_id]->lanes[lane].pop() : nullptr;
+        if (!job && shared_->sizes[lane].load(std::memory_order_acquire) > 0) {
+            std::lock_guard lock(shared_->mutex);
+            if (auto& queue = shared_->lanes[lane]; !queue.empty()) {
+                job = queue.front();
+                queue.pop_front();
+                shared_->sizes[lane].fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        for (size_t i = owner ? 1 : 0; !job && i < count; ++i) {
+            job = workers_[(start + i) % count]->lanes[lane].steal();
+        }
+        if (job) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::workerLoop(std::stop_token /*stop_token*/, size_t worker_id) {
+    t_worker = {this, worker_id};
+
     // Set thread priority
     SetThreadPriority(GetCurrentThread(), static_cast<int>(config_.priority));
+    if (const auto& sets = shared_->cpu_sets; !sets.empty()) {
+        SetThreadSelectedCpuSets(GetCurrentThread(), sets.data(), static_cast<ULONG>(sets.size()));
+    }
 
     // Set thread name for debugging (Windows 10+)
 #if defined(_DEBUG) || defined(DEBUG)
@@ -45,40 +364,50 @@ void ThreadPool::workerLoop(std::stop_token stop_token, [[maybe_unused]] size_t
     SetThreadDescription(GetCurrentThread(), thread_name.c_str());
 #endif
 
-    while (!stop_token.stop_requested()) {
-        std::function<void()> task;
-
-        {
-            std::unique_lock lock(queue_mutex_);
-
-            // Wait for a task or stop request
-            queue_cv_.wait(lock, stop_token, [this] { return !tasks_.empty(); });
-
-            // Check if we should exit
-            if (stop_token.stop_requested() && tasks_.empty()) {
-                break;
-            }
+    // The pool's own stop source ends the loop, once nothing is left to run
+    for (;;) {
+        if (auto* job = take(worker_id)) {
+            runJob(job);
+            continue;
+        }
+        uint32_t seen = wake_epoch_.load(std::memory_order_seq_cst);
+        if (auto* job = take(worker_id)) {
+            runJob(job);
+            continue;
+        }
+        if (stop_source_.stop_requested()) {
+            break;
+        }
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        wake_epoch_.wait(seen, std::memory_order_seq_cst);
+        sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+    }
 
-            if (tasks_.empty()) {
-                continue;
-            }
+    t_worker = {};
+}
 
-            task = std::move(tasks_.front());
-            tasks_.pop();
-        }
+void ThreadPool::runJob(detail::PoolJob* job) {
+    job->run();
+    delete job;
+    if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        outstanding_.notify_all();
+    }
+}
 
-        if (task) {
-            ++active_tasks_;
-            task();
-            --active_tasks_;
-            idle_cv_.notify_all();
-        }
+bool ThreadPool::runPending(TaskPriority lowest) {
+    size_t worker_id = t_worker.pool == this ? t_worker.index : kNoWorker;
+    auto* job = take(worker_id, static_cast<size_t>(lowest) + 1);
+    if (!job) {
+        return false;
     }
+    runJob(job);
+    return true;
 }
 
 void ThreadPool::waitIdle() {
-    std::unique_lock lock(queue_mutex_);
-    idle_cv_.wait(lock, [this] { return tasks_.empty() && active_tasks_.load() == 0; });
+    for (size_t outstanding; (outstanding = outstanding_.load(std::memory_order_acquire)) != 0;) {
+        outstanding_.wait(outstanding, std::memory_order_acquire);
+    }
 }
 
 // Global thread pool singleton
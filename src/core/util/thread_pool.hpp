@@ -1,5 +1,5 @@
 /// @file thread_pool.hpp
-/// @brief Thread pool implementation using std::jthread and stop_token
+/// @brief Work-stealing thread pool using std::jthread and stop_token
 ///
 /// Provides a modern C++20/26 thread pool for background task execution.
 
@@ -9,15 +9,16 @@
 
 #include <atomic>
 #include <concepts>
-#include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <future>
 #include <memory>
-#include <mutex>
-#include <queue>
 #include <stop_token>
+#include <string_view>
 #include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace nive {
@@ -31,20 +32,114 @@ enum class ThreadPriority {
     Highest = THREAD_PRIORITY_HIGHEST,
 };
 
+/// @brief Order in which queued tasks are taken; every High task is taken before a Normal one
+enum class TaskPriority : uint8_t {
+    High = 0,  // Work someone is waiting on (startup, strips of a visible image)
+    Normal,
+    Low,  // Work nobody waits on (plugin scans, maintenance)
+};
+
+/// @brief Number of TaskPriority lanes
+inline constexpr size_t kTaskPriorityCount = 3;
+
+/// @brief Cores the workers prefer on hybrid CPUs
+///
+/// Applied as soft CPU sets (SetThreadSelectedCpuSets): the scheduler may
+/// still run workers elsewhere under load. On CPUs whose cores all share one
+/// efficiency class, every choice behaves like Any.
+enum class ThreadAffinity {
+    Any,          // No preference
+    Performance,  // Cores of the highest efficiency class (P-cores)
+    Efficiency,   // Cores of the lowest efficiency class (E-cores)
+};
+
 /// @brief Configuration for thread pool
 struct ThreadPoolConfig {
     size_t num_threads = 0;  // 0 = hardware_concurrency()
     ThreadPriority priority = ThreadPriority::BelowNormal;
     std::string_view name_prefix = "nive-worker";
+    ThreadAffinity affinity = ThreadAffinity::Any;
 };
 
-/// @brief A modern thread pool using std::jthread
+namespace detail {
+
+/// @brief One submitted task, allocated once per submit
+///
+/// Holds the callable and its promise together in place of the
+/// std::function, packaged_task and shared_ptr a task used to take. Blocks
+/// up to kSmallSize are recycled through a per-thread free list.
+class PoolJob {
+public:
+    /// @brief Largest job (callable plus promise) kept on the free lists
+    static constexpr size_t kSmallSize = 128;
+
+    virtual ~PoolJob() = default;
+
+    /// @brief Run the task and fulfil its promise
+    virtual void run() noexcept = 0;
+
+    [[nodiscard]] static void* operator new(size_t size);
+    static void operator delete(void* block, size_t size) noexcept;
+};
+
+template <typename F, typename R>
+class PoolTask final : public PoolJob {
+public:
+    explicit PoolTask(F&& task) : task_(std::move(task)) {}
+
+    [[nodiscard]] std::future<R> future() { return promise_.get_future(); }
+
+    void run() noexcept override {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                task_();
+                promise_.set_value();
+            } else {
+                promise_.set_value(task_());
+            }
+        } catch (...) {
+            promise_.set_exception(std::current_exception());
+        }
+    }
+
+private:
+    F task_;
+    std::promise<R> promise_;
+};
+
+/// @brief Task without a result; nothing observes its exceptions
+template <typename F>
+class PoolCall final : public PoolJob {
+public:
+    explicit PoolCall(F&& task) : task_(std::move(task)) {}
+
+    void run() noexcept override {
+        try {
+            task_();
+        } catch (...) {
+            // Dropped, as by a discarded future
+        }
+    }
+
+private:
+    F task_;
+};
+
+}  // namespace detail
+
+/// @brief A work-stealing thread pool using std::jthread
 ///
 /// Features:
 /// - Automatic thread count based on hardware_concurrency
 /// - Cooperative cancellation via std::stop_token
 /// - Returns std::future for task results
-/// - Configurable thread priority
+/// - Task priority lanes and configurable thread priority and affinity
+///
+/// Each worker owns a Chase-Lev deque per lane: tasks a worker submits go
+/// to the bottom of its own deque and are taken back from there (LIFO, so
+/// fan-out stays cache-warm), while idle workers steal from the top of
+/// others'. Tasks from other threads go to a shared queue per lane. Idle
+/// workers sleep on an atomic counter and are woken one per submit.
 ///
 /// Async pattern: ThreadPool + Future
 /// General-purpose pool for fire-and-forget or future-based background tasks.
@@ -59,7 +154,7 @@ public:
     /// @brief Create a thread pool with custom configuration
     explicit ThreadPool(ThreadPoolConfig config);
 
-    /// @brief Destructor - requests stop and waits for all threads
+    /// @brief Destructor - runs the queued tasks, then stops and joins the threads
     ~ThreadPool();
 
     // Non-copyable, non-movable
@@ -70,91 +165,108 @@ public:
 
     /// @brief Submit a task to the pool
     /// @param task Callable to execute
+    /// @param priority Lane the task is queued in
     /// @return Future for the task result
     template <std::invocable F>
-    [[nodiscard]] auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    [[nodiscard]] auto submit(F&& task, TaskPriority priority = TaskPriority::Normal)
+        -> std::future<std::invoke_result_t<F>> {
         using ReturnType = std::invoke_result_t<F>;
-
-        auto packaged = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(task));
-
-        auto future = packaged->get_future();
-
-        {
-            std::lock_guard lock(queue_mutex_);
-            if (stop_source_.stop_requested()) {
-                // Pool is stopping, don't accept new tasks
-                packaged->operator()();  // Execute immediately with potential exception
-                return future;
-            }
-
-            tasks_.emplace([packaged = std::move(packaged)]() { (*packaged)(); });
+        using Job = detail::PoolTask<std::decay_t<F>, ReturnType>;
+
+        auto job = std::make_unique<Job>(std::decay_t<F>(std::forward<F>(task)));
+        auto future = job->future();
+        if (stop_source_.stop_requested()) {
+            // Pool is stopping, don't accept new tasks
+            job->run();  // Execute immediately with potential exception
+            return future;
         }
-
-        queue_cv_.notify_one();
+        enqueue(std::move(job), priority);
         return future;
     }
 
+    /// @brief Queue a task without a future (see TaskGroup for waiting on several)
+    /// @param task Callable to execute; exceptions it throws are dropped
+    /// @param priority Lane the task is queued in
+    template <std::invocable F>
+    void post(F&& task, TaskPriority priority = TaskPriority::Normal) {
+        auto job = std::make_unique<detail::PoolCall<std::decay_t<F>>>(
+            std::decay_t<F>(std::forward<F>(task)));
+        if (stop_source_.stop_requested()) {
+            job->run();
+            return;
+        }
+        enqueue(std::move(job), priority);
+    }
+
     /// @brief Submit a task that can be cancelled
     /// @param task Callable that takes a stop_token
+    /// @param priority Lane the task is queued in
     /// @return Future for the task result
     template <std::invocable<std::stop_token> F>
-    [[nodiscard]] auto submitCancellable(F&& task)
+    [[nodiscard]] auto submitCancellable(F&& task, TaskPriority priority = TaskPriority::Normal)
         -> std::future<std::invoke_result_t<F, std::stop_token>> {
-        using ReturnType = std::invoke_result_t<F, std::stop_token>;
-
-        auto packaged = std::make_shared<std::packaged_task<ReturnType()>>(
-            [task = std::forward<F>(task), stop_token = stop_source_.get_token()]() mutable {
-                return task(stop_token);
-            });
-
-        auto future = packaged->get_future();
-
-        {
-            std::lock_guard lock(queue_mutex_);
-            tasks_.emplace([packaged = std::move(packaged)]() { (*packaged)(); });
-        }
-
-        queue_cv_.notify_one();
-        return future;
+        auto bound = [task = std::forward<F>(task),
+                      stop_token = stop_source_.get_token()]() mutable { return task(stop_token); };
+        return submit(std::move(bound), priority);
     }
 
     /// @brief Get the number of worker threads
-    [[nodiscard]] size_t workerCount() const noexcept { return workers_.size(); }
+    [[nodiscard]] size_t workerCount() const noexcept { return threads_.size(); }
 
-    /// @brief Get the number of pending tasks
-    [[nodiscard]] size_t pendingCount() const {
-        std::lock_guard lock(queue_mutex_);
-        return tasks_.size();
+    /// @brief Get the number of queued tasks not yet started
+    [[nodiscard]] size_t pendingCount() const noexcept {
+        return queued_.load(std::memory_order_relaxed);
     }
 
     /// @brief Check if the pool is stopping
     [[nodiscard]] bool stopping() const noexcept { return stop_source_.stop_requested(); }
 
     /// @brief Request all tasks to stop (does not wait)
-    void requestStop() noexcept {
-        stop_source_.request_stop();
-        queue_cv_.notify_all();
-    }
+    void requestStop() noexcept;
 
     /// @brief Wait for all pending tasks to complete
     ///
-    /// Note: Does not prevent new tasks from being submitted.
+    /// Note: Does not prevent new tasks from being submitted. Must not be
+    /// called from a task of this pool.
     void waitIdle();
 
+    /// @brief Run one queued task on the calling thread, for a thread waiting on others
+    /// @param lowest Lowest lane to take from; Low takes any task
+    /// @return false if no task of those lanes was queued
+    bool runPending(TaskPriority lowest = TaskPriority::Low);
+
 private:
+    struct Worker;
+    struct Shared;
+
+    /// @brief Queue a job: on the caller's own deque on a worker thread, else shared
+    void enqueue(std::unique_ptr<detail::PoolJob> job, TaskPriority priority);
+
+    /// @brief Worker index for take() on a thread that owns no deque
+    static constexpr size_t kNoWorker = static_cast<size_t>(-1);
+
+    /// @brief Take the next job, highest lane first
+    /// @param worker_id Worker whose own deque is tried first, or kNoWorker
+    /// @param lanes Number of lanes to look in, from High
+    [[nodiscard]] detail::PoolJob* take(size_t worker_id, size_t lanes = kTaskPriorityCount);
+
+    /// @brief Run a taken job and count it finished
+    void runJob(detail::PoolJob* job);
+
     void workerLoop(std::stop_token stop_token, size_t worker_id);
 
-    std::vector<std::jthread> workers_;
+    ThreadPoolConfig config_;
     std::stop_source stop_source_;
 
-    mutable std::mutex queue_mutex_;
-    std::condition_variable_any queue_cv_;
-    std::queue<std::function<void()>> tasks_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unique_ptr<Shared> shared_;
 
-    std::atomic<size_t> active_tasks_{0};
-    std::condition_variable_any idle_cv_;
+    std::atomic<size_t> queued_{0};        // Jobs in any deque or shared queue
+    std::atomic<size_t> outstanding_{0};   // Jobs submitted and not yet finished
+    std::atomic<uint32_t> wake_epoch_{0};  // Bumped per submit; idle workers wait on it
+    std::atomic<uint32_t> sleeping_{0};
 
-    ThreadPoolConfig config_;
+    std::vector<std::jthread> threads_;  // Last: joined before the state above goes
 };
 
 /// @brief Global thread pool for background tasks
@@ -0,0 +1,121 @@
+/// @file trace.cpp
+/// @brief Trace event recording and Chrome trace JSON output
+
+#include "trace.hpp"
+
+#include <Windows.h>
+
+#include <format>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "logger.hpp"
+
+namespace nive {
+
+namespace {
+
+/// @brief Append a string as a JSON string literal
+void append_json_string(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+}  // namespace
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder instance;
+    return instance;
+}
+
+void TraceRecorder::start(const std::filesystem::path& output) {
+    std::lock_guard lock(mutex_);
+    output_ = output;
+    origin_ = Clock::now();
+    events_.clear();
+    events_.reserve(4096);
+    enabled_.store(true, std::memory_order_release);
+    LOG_INFO("Tracing to {}", pathToUtf8(output));
+}
+
+bool TraceRecorder::stop() {
+    std::vector<Event> events;
+    std::filesystem::path output;
+    {
+        std::lock_guard lock(mutex_);
+        if (!enabled_.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        events.swap(events_);
+        output = output_;
+    }
+
+    std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    json.reserve(json.size() + events.size() * 96);
+    auto pid = static_cast<unsigned>(GetCurrentProcessId());
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        json += i == 0 ? "{\"name\":" : ",\n{\"name\":";
+        append_json_string(json, event.name);
+        json += ",\"cat\":";
+        append_json_string(json, event.category);
+        if (event.duration_us < 0) {
+            json += std::format(R"(,"ph":"i","s":"t","ts":{},"pid":{},"tid":{}}})",
+                                event.begin_us, pid, event.thread_id);
+        } else {
+            json += std::format(R"(,"ph":"X","ts":{},"dur":{},"pid":{},"tid":{}}})",
+                                event.begin_us, event.duration_us, pid, event.thread_id);
+        }
+    }
+    json += "]}\n";
+
+    std::error_code ec;
+    std::filesystem::create_directories(output.parent_path(), ec);
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+        LOG_WARN("Failed to write trace {}", pathToUtf8(output));
+        return false;
+    }
+    LOG_INFO("Trace written: {} events to {}", events.size(), pathToUtf8(output));
+    return true;
+}
+
+void TraceRecorder::complete(const char* name, const char* category, Clock::time_point begin,
+                             Clock::time_point end) {
+    if (!enabled()) {
+        return;
+    }
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    add({name, category, duration_cast<microseconds>(begin - origin_).count(),
+         duration_cast<microseconds>(end - begin).count(),
+         static_cast<uint32_t>(GetCurrentThreadId())});
+}
+
+void TraceRecorder::instant(const char* name, const char* category) {
+    if (!enabled()) {
+        return;
+    }
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - origin_);
+    add({name, category, now.count(), -1, static_cast<uint32_t>(GetCurrentThreadId())});
+}
+
+void TraceRecorder::add(const Event& event) {
+    std::lock_guard lock(mutex_);
+    if (enabled() && events_.size() < kMaxEvents) {
+        events_.push_back(event);
+    }
+}
+
+}  // namespace nive
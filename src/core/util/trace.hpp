@@ -0,0 +1,104 @@
+/// @file trace.hpp
+/// @brief Timeline of timed events, written as Chrome trace JSON
+///
+/// Off by default; when started (--trace on the command line) events are
+/// kept in memory and written on stop(), ready to load in chrome://tracing
+/// or ui.perfetto.dev. A disabled recorder costs one atomic load per event.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace nive {
+
+/// @brief Records trace events from any thread
+///
+/// Names and categories must be string literals (or otherwise outlive the
+/// recorder); only their pointers are stored.
+///
+/// Thread-safe: yes
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Events kept at most; later ones are dropped (about 40 MiB)
+    static constexpr size_t kMaxEvents = 1 << 20;
+
+    /// @brief Get the singleton instance
+    [[nodiscard]] static TraceRecorder& instance();
+
+    /// @brief Start recording
+    /// @param output File written by stop()
+    void start(const std::filesystem::path& output);
+
+    /// @brief Stop recording and write the events
+    /// @return false if recording was not started or the file could not be written
+    bool stop();
+
+    /// @brief Check if events are being recorded
+    [[nodiscard]] bool enabled() const noexcept {
+        return enabled_.load(std::memory_order_acquire);
+    }
+
+    /// @brief Record a span of time on the calling thread
+    void complete(const char* name, const char* category, Clock::time_point begin,
+                  Clock::time_point end);
+
+    /// @brief Record a point in time on the calling thread
+    void instant(const char* name, const char* category);
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        int64_t begin_us;     // Since origin_
+        int64_t duration_us;  // -1 for instant events
+        uint32_t thread_id;
+    };
+
+    TraceRecorder() = default;
+
+    void add(const Event& event);
+
+    std::atomic<bool> enabled_{false};
+    std::mutex mutex_;
+    std::filesystem::path output_;
+    Clock::time_point origin_;
+    std::vector<Event> events_;
+};
+
+/// @brief Records the lifetime of a scope as a complete event
+class ScopedTrace {
+public:
+    explicit ScopedTrace(const char* name, const char* category = "nive") noexcept
+        : name_(name), category_(category) {
+        if (TraceRecorder::instance().enabled()) {
+            begin_ = TraceRecorder::Clock::now();
+        }
+    }
+
+    ~ScopedTrace() {
+        if (begin_ != TraceRecorder::Clock::time_point{}) {
+            TraceRecorder::instance().complete(name_, category_, begin_,
+                                               TraceRecorder::Clock::now());
+        }
+    }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    TraceRecorder::Clock::time_point begin_{};  // Unset while disabled
+};
+
+}  // namespace nive
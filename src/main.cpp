@@ -5,9 +5,17 @@
 
 #include <CommCtrl.h>
 #include <ShlObj.h>
+#include <shellapi.h>
 #include <objbase.h>
 
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "core/util/etw.hpp"
 #include "core/util/logger.hpp"
+#include "core/util/trace.hpp"
 #include "ui/app.hpp"
 
 // Link with required libraries
@@ -29,20 +37,96 @@ bool InitializeCommonControls() {
     return InitCommonControlsEx(&icc) != FALSE;
 }
 
-/// @brief Parse command line for initial path
-std::wstring ParseCommandLine(LPWSTR lpCmdLine) {
+/// @brief Options given on the command line
+struct CommandLine {
+    std::wstring path;
+    bool trace = false;                  // --trace or --trace=<file>
+    std::filesystem::path trace_output;  // Empty for the default beside the log
+    std::optional<nive::ui::PregenerationOptions> pregenerate;  // --pregenerate <root> [--jobs N]
+};
+
+/// @brief Parse the arguments after --pregenerate: a root and an optional --jobs N
+std::optional<nive::ui::PregenerationOptions> ParsePregenerate(const std::wstring& args) {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(args.c_str(), &argc);
+    if (!argv) {
+        return std::nullopt;
+    }
+    std::optional<nive::ui::PregenerationOptions> options;
+    if (argc >= 1) {
+        options.emplace();
+        options->root = argv[0];
+        for (int i = 1; i + 1 < argc; ++i) {
+            if (std::wstring_view(argv[i]) == L"--jobs") {
+                options->jobs = static_cast<uint32_t>(std::wcstoul(argv[i + 1], nullptr, 10));
+                ++i;
+            }
+        }
+    }
+    LocalFree(argv);
+    return options;
+}
+
+/// @brief Send standard output to the console the app was started from
+///
+/// A GUI-subsystem process gets no console of its own; output that was
+/// redirected to a file already has a handle and is left alone.
+void AttachParentConsole() {
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (out && out != INVALID_HANDLE_VALUE) {
+        return;
+    }
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        HANDLE console = CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE,
+                                     nullptr, OPEN_EXISTING, 0, nullptr);
+        if (console != INVALID_HANDLE_VALUE) {
+            SetStdHandle(STD_OUTPUT_HANDLE, console);
+        }
+    }
+}
+
+/// @brief Parse command line for a leading --trace option and the initial path
+CommandLine ParseCommandLine(LPWSTR lpCmdLine) {
+    CommandLine result;
     if (!lpCmdLine || lpCmdLine[0] == L'\0') {
-        return L"";
+        return result;
+    }
+
+    std::wstring rest = lpCmdLine;
+    constexpr std::wstring_view kTrace = L"--trace";
+    if (rest.starts_with(kTrace) &&
+        (rest.size() == kTrace.size() || rest[kTrace.size()] == L' ' ||
+         rest[kTrace.size()] == L'=')) {
+        result.trace = true;
+        size_t end = rest.find(L' ', kTrace.size());
+        if (rest.size() > kTrace.size() && rest[kTrace.size()] == L'=') {
+            result.trace_output = rest.substr(kTrace.size() + 1, end - kTrace.size() - 1);
+        }
+        size_t next = end == std::wstring::npos ? end : rest.find_first_not_of(L' ', end);
+        rest = next == std::wstring::npos ? std::wstring() : rest.substr(next);
+    }
+    if (rest.empty()) {
+        return result;
+    }
+
+    constexpr std::wstring_view kPregenerate = L"--pregenerate";
+    if (rest.starts_with(kPregenerate) &&
+        (rest.size() == kPregenerate.size() || rest[kPregenerate.size()] == L' ')) {
+        result.pregenerate = ParsePregenerate(rest.substr(kPregenerate.size()));
+        if (!result.pregenerate) {
+            result.pregenerate.emplace();  // No root: reported by the run
+        }
+        return result;
     }
 
-    // Simple parsing: use the entire command line as a path
+    // Simple parsing: use the rest of the command line as a path
     // Strip quotes if present
-    std::wstring path = lpCmdLine;
-    if (path.front() == L'"' && path.back() == L'"') {
-        path = path.substr(1, path.length() - 2);
+    if (rest.size() >= 2 && rest.front() == L'"' && rest.back() == L'"') {
+        rest = rest.substr(1, rest.length() - 2);
     }
+    result.path = std::move(rest);
 
-    return path;
+    return result;
 }
 
 }  // namespace
@@ -65,9 +149,11 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
         return 1;
     }
 
+    auto command_line = ParseCommandLine(lpCmdLine);
+
     // Initialize logging
+    std::filesystem::path log_path;
     {
-        std::filesystem::path log_path;
         wchar_t* local_app_data = nullptr;
         if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &local_app_data))) {
             log_path = std::filesystem::path(local_app_data) / L"nive" / L"nive.log";
@@ -80,21 +166,49 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
         LOG_INFO("nive starting...");
     }
 
-    // Parse command line
+    // ETW events cost nothing until a session enables the provider
+    nive::etw::registerProvider();
+
+    // Startup and browsing timeline, written on exit
+    if (command_line.trace) {
+        nive::TraceRecorder::instance().start(command_line.trace_output.empty()
+                                                  ? log_path.parent_path() / L"nive_trace.json"
+                                                  : command_line.trace_output);
+    }
+
+    // Headless: fill the thumbnail cache for a tree and exit
+    if (command_line.pregenerate) {
+        AttachParentConsole();
+        int result = nive::ui::App::instance().runPregeneration(*command_line.pregenerate);
+        nive::TraceRecorder::instance().stop();
+        nive::etw::unregisterProvider();
+        LOG_INFO("nive shutting down");
+        nive::shutdown_logging();
+        CoUninitialize();
+        return result;
+    }
+
     nive::ui::AppConfig config;
-    config.initial_path = ParseCommandLine(lpCmdLine);
+    config.initial_path = command_line.path;
 
     // Initialize and run application
     auto& app = nive::ui::App::instance();
     if (!app.initialize(hInstance, config)) {
+        nive::TraceRecorder::instance().stop();
+        nive::etw::unregisterProvider();
+        if (app.forwarded()) {
+            nive::shutdown_logging();
+        }
         CoUninitialize();
-        return 1;
+        return app.forwarded() ? 0 : 1;
     }
 
     int result = app.run();
 
     // Cleanup after message loop exits
     app.shutdown();
+    nive::TraceRecorder::instance().stop();
+    nive::etw::unregisterProvider();
 
     LOG_INFO("nive shutting down");
     nive::shutdown_logging();
@@ -0,0 +1,231 @@
+/// @file main.cpp
+/// @brief nive_plugin_host entry point: runs one decoder plugin out of process
+///
+/// Started by PluginHostPool as
+///     nive_plugin_host.exe <plugin path> <channel name> <parent process id>
+/// and serves decode requests over the channel until the parent exits. A
+/// plugin that crashes takes only this process down.
+
+#include <Windows.h>
+
+#include <shellapi.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "plugin/plugin_host_protocol.hpp"
+#include "plugin/plugin_loader.hpp"
+
+namespace {
+
+using namespace nive;
+using namespace nive::plugin;
+
+// Output sections grow in steps of this size; larger than needed by more than
+// kOutputSlack times (and above kOutputKeep) they shrink again
+constexpr uint64_t kOutputGranularity = uint64_t{4} << 20;
+constexpr uint64_t kOutputKeep = uint64_t{64} << 20;
+constexpr uint64_t kOutputSlack = 4;
+
+/// @brief State of the channel served by this process
+struct Channel {
+    std::wstring name;
+    host::SharedSection control_section;
+    host::SharedSection input;
+    host::SharedSection output;
+    uint32_t input_generation = 0;
+    HandleGuard request;
+    HandleGuard done;
+
+    [[nodiscard]] host::Control& control() const noexcept {
+        return *reinterpret_cast<host::Control*>(control_section.data());
+    }
+};
+
+/// @brief Make the output section hold at least size bytes
+bool reserve_output(Channel& channel, uint64_t size) {
+    host::Control& control = channel.control();
+    uint64_t capacity = channel.output.capacity();
+    bool too_small = !channel.output.valid() || capacity < size;
+    bool too_large = capacity > kOutputKeep && capacity > size * kOutputSlack;
+    if (!too_small && !too_large) {
+        return true;
+    }
+
+    capacity = std::max((size + kOutputGranularity - 1) / kOutputGranularity, uint64_t{1}) *
+               kOutputGranularity;
+    ++control.output_generation;
+    if (!channel.output.create(host::outputName(channel.name, control.output_generation),
+                               capacity)) {
+        control.output_capacity = 0;
+        return false;
+    }
+    control.output_capacity = capacity;
+    return true;
+}
+
+/// @brief Copy a plugin-allocated image into the output section
+NivePluginError publish(Channel& channel, const PluginLoader& loader, NiveDecodedImage& image) {
+    host::Control& control = channel.control();
+    size_t row = static_cast<size_t>(image.width) * host::bytesPerPixel(image.format);
+    uint64_t size = static_cast<uint64_t>(row) * image.height;
+    if (!image.pixels || size == 0) {
+        loader.freeImage(image);
+        return NIVE_PLUGIN_ERROR_DECODE_FAILED;
+    }
+    if (!reserve_output(channel, size)) {
+        loader.freeImage(image);
+        return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+    }
+
+    std::memcpy(channel.output.data(), image.pixels, static_cast<size_t>(size));
+    control.width = image.width;
+    control.height = image.height;
+    control.format = image.format;
+    loader.freeImage(image);
+    return NIVE_PLUGIN_OK;
+}
+
+/// @brief Decode the input section, the way PluginManager does in-process
+NivePluginError decode(Channel& channel, const PluginLoader& loader, const std::string& extension) {
+    host::Control& control = channel.control();
+    const uint8_t* data = channel.input.data();
+    size_t size = static_cast<size_t>(control.input_size);
+
+    if (control.has_hints && loader.supportsHints()) {
+        auto result = loader.decodeHinted(data, size, extension, control.preferred_format,
+                                          control.hints);
+        if (!result) {
+            return result.error();
+        }
+        control.info = result->info;
+        return publish(channel, loader, result->image);
+    }
+
+    // Plugins that decode into host buffers write straight into the output section
+    if (loader.supportsDecodeInto()) {
+        auto info = loader.getImageInfo(data, size, extension);
+        if (info && info->width != 0 && info->height != 0) {
+            bool high_precision = (control.preferred_format == NIVE_PIXEL_FORMAT_RGBA16 ||
+                                   control.preferred_format == NIVE_PIXEL_FORMAT_RGBA16F) &&
+                                  (info->format == NIVE_PIXEL_FORMAT_RGBA16 ||
+                                   info->format == NIVE_PIXEL_FORMAT_RGBA16F);
+            NivePixelFormat format =
+                high_precision ? NIVE_PIXEL_FORMAT_RGBA16 : NIVE_PIXEL_FORMAT_BGRA8;
+            size_t stride = static_cast<size_t>(info->width) * host::bytesPerPixel(format);
+            if (!reserve_output(channel, static_cast<uint64_t>(stride) * info->height)) {
+                return NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+            }
+
+            NivePluginError result =
+                loader.decodeInto(data, size, extension, format, channel.output.data(), stride,
+                                  info->width, info->height);
+            if (result == NIVE_PLUGIN_OK) {
+                control.width = info->width;
+                control.height = info->height;
+                control.format = format;
+                control.info = {info->width, info->height, 0, 0, info->width, info->height};
+                return NIVE_PLUGIN_OK;
+            }
+            if (result != NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT) {
+                return result;
+            }
+        }
+    }
+
+    auto image = loader.decode(data, size, extension, control.preferred_format);
+    if (!image) {
+        return image.error();
+    }
+    control.info = {image->width, image->height, 0, 0, image->width, image->height};
+    return publish(channel, loader, *image);
+}
+
+/// @brief Handle the request in the control block
+void serve(Channel& channel, const PluginLoader& loader) {
+    host::Control& control = channel.control();
+
+    // The client recreates the input section when a file does not fit
+    if (control.input_generation != channel.input_generation || !channel.input.valid()) {
+        channel.input_generation = control.input_generation;
+        if (!channel.input.open(host::inputName(channel.name, channel.input_generation),
+                                control.input_capacity)) {
+            control.error = NIVE_PLUGIN_ERROR_OUT_OF_MEMORY;
+            return;
+        }
+    }
+    if (control.input_size > channel.input.capacity()) {
+        control.error = NIVE_PLUGIN_ERROR_INVALID_DATA;
+        return;
+    }
+
+    control.extension[sizeof(control.extension) - 1] = '\0';
+    std::string extension = control.extension;
+
+    switch (control.op) {
+    case host::Op::Decode:
+        control.error = decode(channel, loader, extension);
+        return;
+    case host::Op::ImageInfo: {
+        auto info = loader.getImageInfo(channel.input.data(),
+                                        static_cast<size_t>(control.input_size), extension);
+        if (info) {
+            control.image_info = *info;
+        }
+        control.error = info ? NIVE_PLUGIN_OK : info.error();
+        return;
+    }
+    }
+    control.error = NIVE_PLUGIN_ERROR_UNSUPPORTED_FORMAT;
+}
+
+}  // namespace
+
+/// @brief Host process entry point
+int WINAPI wWinMain(_In_ HINSTANCE /*hInstance*/, _In_opt_ HINSTANCE /*hPrevInstance*/,
+                    _In_ LPWSTR /*lpCmdLine*/, _In_ int /*nCmdShow*/
+) {
+    // Crashes end the process quietly; the client notices through its handle
+    SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX | SEM_NOOPENFILEERRORBOX);
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv || argc != 4) {
+        return static_cast<int>(host::kExitBadArguments);
+    }
+    std::filesystem::path plugin_path = argv[1];
+    Channel channel;
+    channel.name = argv[2];
+    DWORD parent_id = static_cast<DWORD>(std::wcstoul(argv[3], nullptr, 10));
+    LocalFree(argv);
+
+    HandleGuard parent(OpenProcess(SYNCHRONIZE, FALSE, parent_id));
+    channel.request = HandleGuard(
+        OpenEventW(SYNCHRONIZE, FALSE, host::requestEventName(channel.name).c_str()));
+    channel.done = HandleGuard(
+        OpenEventW(EVENT_MODIFY_STATE, FALSE, host::doneEventName(channel.name).c_str()));
+    if (!parent || !channel.request || !channel.done ||
+        !channel.control_section.open(channel.name, sizeof(host::Control)) ||
+        channel.control().magic != host::kMagic || channel.control().version != host::kVersion) {
+        return static_cast<int>(host::kExitChannelFailed);
+    }
+
+    // WIC-based plugins need COM on the decoding thread
+    ComInitializer com(COINIT_MULTITHREADED);
+
+    auto loader = PluginLoader::load(plugin_path);
+    if (!loader) {
+        return static_cast<int>(host::kExitLoadFailed);
+    }
+
+    HANDLE waits[] = {channel.request.get(), parent.get()};
+    while (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0) {
+        serve(channel, *loader);
+        SetEvent(channel.done.get());
+    }
+
+    return static_cast<int>(host::kExitOk);
+}
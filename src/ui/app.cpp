@@ -3,21 +3,153 @@
 
 #include "app.hpp"
 
+#include <Psapi.h>
 #include <ShlObj.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <unordered_map>
+#include <utility>
+
 #include "components/file_list_view.hpp"
 #include "components/thumbnail_grid.hpp"
 #include "core/archive/archive_entry.hpp"
 #include "core/config/settings_manager.hpp"
 #include "core/fs/directory.hpp"
+#include "core/fs/folder_stats.hpp"
+#include "core/fs/natural_sort.hpp"
 #include "core/i18n/i18n.hpp"
+#include "core/image/pixel_buffer.hpp"
+#include "core/library/similar_images.hpp"
+#include "core/util/etw.hpp"
 #include "core/util/logger.hpp"
+#include "core/util/memory_accounting.hpp"
 #include "core/util/string_utils.hpp"
+#include "core/util/thread_pool.hpp"
+#include "core/util/trace.hpp"
 #include "image_viewer_window.hpp"
 #include "main_window.hpp"
 
 namespace nive::ui {
 
+namespace {
+
+[[nodiscard]] double to_ms(std::chrono::steady_clock::duration elapsed) noexcept {
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+/// @brief Logs and traces how long each startup phase took, so cold-start regressions show
+class StartupTimer {
+public:
+    explicit StartupTimer(std::chrono::steady_clock::time_point start)
+        : start_(start), last_(start) {}
+
+    /// @param name String literal (kept by the trace)
+    void phase(const char* name) {
+        auto now = std::chrono::steady_clock::now();
+        LOG_INFO("Startup: {} {:.1f} ms (total {:.1f} ms)", name, to_ms(now - last_),
+                 to_ms(now - start_));
+        TraceRecorder::instance().complete(name, "startup", last_, now);
+        last_ = now;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+/// @brief Check a saved startup path, giving an offline network share a short deadline
+///
+/// Unreachable paths fall back to the Pictures folder rather than keeping
+/// the window from appearing until the SMB timeout.
+[[nodiscard]] bool is_startup_reachable(const std::filesystem::path& path) {
+    constexpr std::chrono::milliseconds kStartupProbeTimeout{1500};
+    if (path.empty()) {
+        return false;
+    }
+    if (!fs::isPathReachable(path, kStartupProbeTimeout)) {
+        LOG_INFO("Startup path unreachable: {}", pathToUtf8(path));
+        return false;
+    }
+    return true;
+}
+
+// Set by the console control handler; a pre-generation run stops at its next check
+std::atomic<bool> g_pregeneration_interrupted{false};
+
+BOOL WINAPI on_console_interrupt(DWORD type) {
+    if (type == CTRL_C_EVENT || type == CTRL_BREAK_EVENT || type == CTRL_CLOSE_EVENT) {
+        g_pregeneration_interrupted.store(true);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/// @brief Write a line to standard output: the console, or the file it is redirected to
+void print_line(const std::string& text) {
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (!out || out == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    auto line = text + "\r\n";
+    DWORD mode = 0;
+    DWORD written = 0;
+    if (GetConsoleMode(out, &mode)) {
+        auto wide = utf8ToWideOrEmpty(line);
+        WriteConsoleW(out, wide.data(), static_cast<DWORD>(wide.size()), &written, nullptr);
+    } else {
+        WriteFile(out, line.data(), static_cast<DWORD>(line.size()), &written, nullptr);
+    }
+}
+
+/// @brief Send a path to the main window of the instance already running
+/// @return false if no window turned up or it did not accept the message
+///
+/// The other process may still be starting, between creating the mutex and
+/// its window, so the window is looked for a few times before giving up.
+bool forward_to_running(const std::filesystem::path& path) {
+    constexpr int kAttempts = 20;
+    constexpr DWORD kRetryMs = 100;
+    constexpr UINT kSendTimeoutMs = 5000;
+
+    HWND target = nullptr;
+    for (int attempt = 0; attempt < kAttempts && !target; ++attempt) {
+        target = MainWindow::findRunning();
+        if (!target) {
+            Sleep(kRetryMs);
+        }
+    }
+    if (!target) {
+        return false;
+    }
+
+    // Only the foreground process may hand foreground rights to another
+    DWORD process_id = 0;
+    GetWindowThreadProcessId(target, &process_id);
+    AllowSetForegroundWindow(process_id);
+
+    std::wstring text = path.wstring();
+    COPYDATASTRUCT data{};
+    data.dwData = MainWindow::kCopyDataOpenPath;
+    data.cbData = static_cast<DWORD>(text.size() * sizeof(wchar_t));
+    data.lpData = text.data();
+    DWORD_PTR accepted = FALSE;
+    LRESULT sent = SendMessageTimeoutW(target, WM_COPYDATA, 0, reinterpret_cast<LPARAM>(&data),
+                                       SMTO_ABORTIFHUNG, kSendTimeoutMs, &accepted);
+    return sent != 0 && accepted == TRUE;
+}
+
+// Listings that take this long to scan are saved for the next visit; once
+// saved, a folder's snapshot is refreshed after every revalidating scan
+constexpr std::chrono::milliseconds kSnapshotMinScan{250};
+
+}  // namespace
+
 App& App::instance() {
     static App app;
     return app;
@@ -28,6 +160,8 @@ App::~App() = default;
 
 bool App::initialize(HINSTANCE hInstance, const AppConfig& config) {
     hinstance_ = hInstance;
+    startup_begin_ = std::chrono::steady_clock::now();
+    StartupTimer timer(startup_begin_);
 
     // Initialize OLE for drag and drop
     HRESULT hr = OleInitialize(nullptr);
@@ -37,6 +171,26 @@ bool App::initialize(HINSTANCE hInstance, const AppConfig& config) {
 
     // Load settings
     settings_ = config::SettingsManager::loadOrDefault();
+    timer.phase("settings");
+
+    // A second launch reuses the first one's warm caches instead of cold-starting its own
+    if (settings_.single_instance) {
+        instance_mutex_ = CreateMutexW(nullptr, FALSE, L"Local\\nive.single_instance");
+        if (instance_mutex_ && GetLastError() == ERROR_ALREADY_EXISTS) {
+            if (forward_to_running(config.initial_path)) {
+                LOG_INFO("Forwarded \"{}\" to the running instance",
+                         pathToUtf8(config.initial_path));
+                forwarded_ = true;
+                CloseHandle(instance_mutex_);
+                instance_mutex_ = nullptr;
+                return false;
+            }
+            LOG_WARN("Running instance did not respond; starting another");
+        }
+    }
+
+    settings_writer_ =
+        std::make_unique<config::SettingsWriter>(config::SettingsManager::defaultPath());
 
     // Initialize i18n (before any UI creation)
     {
@@ -49,30 +203,17 @@ bool App::initialize(HINSTANCE hInstance, const AppConfig& config) {
         }
     }
 
+    timer.phase("i18n");
+
     // Create application state
     state_ = std::make_unique<AppState>();
 
-    // Initialize core modules
-    if (!initializeCore()) {
-        // Non-fatal - continue with limited functionality
-    }
-
-    // Start thumbnail generator
-    if (thumbnails_) {
-        thumbnails_->start();
-    }
-
-    // Create main window
-    main_window_ = std::make_unique<MainWindow>();
-    if (!main_window_->create(hInstance)) {
-        MessageBoxW(nullptr, L"Failed to create main window", L"Error", MB_ICONERROR);
-        return false;
-    }
-
-    // Show window
-    main_window_->show(config.start_maximized || settings_.main_window.maximized);
+    // The cache and library databases open on the pool while the rest of
+    // the core and the window are set up; plugins finish in the background
+    auto pending = startCore();
+    timer.phase("core");
 
-    // Navigate to initial path
+    // Determine initial path
     std::filesystem::path initial_path;
     if (!config.initial_path.empty()) {
         // Command-line argument takes precedence
@@ -88,14 +229,12 @@ bool App::initialize(HINSTANCE hInstance, const AppConfig& config) {
             break;
         }
         case config::StartupDirectory::LastOpened:
-            if (!settings_.last_directory.empty() &&
-                std::filesystem::exists(settings_.last_directory)) {
+            if (is_startup_reachable(settings_.last_directory)) {
                 initial_path = settings_.last_directory;
             }
             break;
         case config::StartupDirectory::Custom:
-            if (!settings_.custom_startup_path.empty() &&
-                std::filesystem::exists(settings_.custom_startup_path)) {
+            if (is_startup_reachable(settings_.custom_startup_path)) {
                 initial_path = settings_.custom_startup_path;
             }
             break;
@@ -110,9 +249,47 @@ bool App::initialize(HINSTANCE hInstance, const AppConfig& config) {
         }
     }
 
+    // Reopening the previous session's directory: warm the memory cache for
+    // its first screen while the window is being created
+    bool restore_session = config.initial_path.empty() &&
+                           settings_.startup_directory == config::StartupDirectory::LastOpened &&
+                           !initial_path.empty() && initial_path == settings_.last_directory;
+
+    // The window decides on its library search box when it is created
+    finishLibrary(pending);
+    timer.phase("library wait");
+
+    // Create main window
+    main_window_ = std::make_unique<MainWindow>();
+    if (!main_window_->create(hInstance)) {
+        MessageBoxW(nullptr, L"Failed to create main window", L"Error", MB_ICONERROR);
+        return false;
+    }
+    ui_executor_.emplace(main_window_->hwnd());
+
+    // Show window
+    main_window_->show(config.start_maximized || settings_.main_window.maximized);
+    timer.phase("window");
+
+    finishCore(pending);
+    if (thumbnails_) {
+        thumbnails_->start();
+    }
+    timer.phase("cache wait");
+
+    if (restore_session) {
+        startWarmup(initial_path);
+    }
+
+    // Navigate to initial path
+    if (restore_session) {
+        main_window_->setStartupScroll(initial_path,
+                                       static_cast<size_t>(settings_.last_scroll_index));
+    }
     if (!initial_path.empty()) {
         navigateTo(initial_path);
     }
+    timer.phase("first navigation");
 
     return true;
 }
@@ -129,6 +306,11 @@ int App::run() {
 }
 
 void App::shutdown() {
+    if (instance_mutex_) {
+        CloseHandle(instance_mutex_);
+        instance_mutex_ = nullptr;
+    }
+
     // Save window state
     if (main_window_) {
         main_window_->saveState(settings_);
@@ -142,8 +324,35 @@ void App::shutdown() {
         settings_.last_directory = state_->currentPath();
     }
 
-    // Save settings
+    // Save settings; the last write must land before the process exits
     saveSettings();
+    if (settings_writer_) {
+        settings_writer_->flush();
+    }
+
+    logThumbnailLatencies();
+
+    // Stop any directory scan, archive batch or warm-up still in flight
+    cancelDirectoryScan();
+    cancelArchiveBatch();
+    cancelDirectoryPrefetch();
+    if (warmup_thread_.joinable()) {
+        warmup_thread_.request_stop();
+        warmup_thread_.join();
+    }
+
+    // A cache move stops between parts and resumes at the next start
+    if (cache_move_thread_.joinable()) {
+        cache_move_thread_.request_stop();
+        cache_move_thread_.join();
+    }
+
+    // Stop change notifications before the cache they invalidate goes away
+    watcher_.reset();
+    memory_monitor_.reset();
+
+    // Stop the library crawler between directories
+    library_.reset();
 
     // Cancel pending thumbnail requests and stop generator
     if (thumbnails_) {
@@ -163,10 +372,115 @@ void App::shutdown() {
     // the window procedure. Let the unique_ptrs clean up when App is destroyed.
 }
 
+int App::runPregeneration(const PregenerationOptions& options) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(options.root, ec)) {
+        print_line(std::format("Not a directory: {}", pathToUtf8(options.root)));
+        return 1;
+    }
+
+    // Overrides for this run only: without a settings writer nothing is saved
+    settings_ = config::SettingsManager::loadOrDefault();
+    if (options.jobs > 0) {
+        settings_.thumbnails.worker_count = static_cast<int>(options.jobs);
+    }
+    settings_.thumbnails.adaptive_workers = false;  // Every decode thread busy from the start
+    settings_.thumbnails.progressive = false;       // No preview pass nobody would see
+    settings_.library.index_enabled = false;
+
+    auto pending = startCore();
+    auto cache_result = pending.cache.get();
+    if (!cache_result) {
+        print_line(std::format("Thumbnail cache unavailable: {}",
+                               cache::to_string(cache_result.error())));
+        return 1;
+    }
+    cache_ = std::move(*cache_result);
+    thumbnails_->setCacheManager(cache_.get());
+    thumbnails_->start();
+
+    // Enough requests in flight to keep every I/O and decode thread busy
+    auto jobs = static_cast<size_t>(std::max(settings_.thumbnails.worker_count, 1));
+    thumbnail::PregeneratorConfig pregen_config;
+    pregen_config.max_depth = UINT32_MAX;
+    pregen_config.max_outstanding = jobs * 4;
+    pregen_config.include_hidden = settings_.show_hidden_files;
+    pregen_config.sort_order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+    pregen_config.yield_to_foreground = false;
+    pregen_config.include_archives = true;
+    pregenerator_ = std::make_unique<thumbnail::Pregenerator>(*thumbnails_, pregen_config);
+    pregenerator_->setCacheManager(cache_.get());
+    pregenerator_->setArchiveManager(archive_.get());
+
+    SetConsoleCtrlHandler(on_console_interrupt, TRUE);
+    print_line(std::format("Pre-generating thumbnails under {} with {} decode threads",
+                           pathToUtf8(options.root), jobs));
+    LOG_INFO("Headless pre-generation of {} with {} decode threads", pathToUtf8(options.root),
+             jobs);
+
+    constexpr std::chrono::milliseconds kPollInterval{200};
+    constexpr std::chrono::seconds kProgressInterval{2};
+    auto start = std::chrono::steady_clock::now();
+    auto last_report = start;
+    uint64_t last_completed = 0;
+    pregenerator_->start(options.root, thumbnailRequestSize());
+    while ((pregenerator_->isRunning() || pregenerator_->outstandingCount() > 0) &&
+           !g_pregeneration_interrupted.load()) {
+        std::this_thread::sleep_for(kPollInterval);
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report < kProgressInterval) {
+            continue;
+        }
+        uint64_t completed = pregenerator_->completedCount();
+        double seconds = std::chrono::duration<double>(now - last_report).count();
+        print_line(std::format("{} thumbnails ({:.1f}/s), {} already cached, {} failed", completed,
+                               static_cast<double>(completed - last_completed) / seconds,
+                               pregenerator_->skippedCount(), pregenerator_->failedCount()));
+        last_report = now;
+        last_completed = completed;
+    }
+
+    bool interrupted = g_pregeneration_interrupted.load();
+    pregenerator_->stop();
+    thumbnails_->stop();
+    if (plugins_) {
+        plugins_->shutdown();
+    }
+
+    uint64_t completed = pregenerator_->completedCount();
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto summary = std::format(
+        "Pre-generation {}: {} thumbnails in {:.1f} s ({:.1f}/s), {} already cached, {} failed",
+        interrupted ? "interrupted" : "finished", completed, seconds,
+        seconds > 0 ? static_cast<double>(completed) / seconds : 0.0,
+        pregenerator_->skippedCount(), pregenerator_->failedCount());
+    print_line(summary);
+    LOG_INFO("{}", summary);
+    if (interrupted) {
+        print_line("Run the same command again to continue; cached files are skipped");
+    }
+    return interrupted ? 2 : 0;
+}
+
 HWND App::mainHwnd() const noexcept {
     return main_window_ ? main_window_->hwnd() : nullptr;
 }
 
+void App::openForwarded(const std::filesystem::path& path) {
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+    if (IsIconic(hwnd)) {
+        ShowWindow(hwnd, SW_RESTORE);
+    }
+    SetForegroundWindow(hwnd);
+    if (!path.empty()) {
+        navigateTo(path);
+    }
+}
+
 void App::navigateTo(const std::filesystem::path& path) {
     // Handle archives first (they exist as files)
     if (archive_ && archive_->isAvailable() && archive_->isArchive(path)) {
@@ -217,45 +531,297 @@ void App::refresh() {
     }
 }
 
+void App::refreshAfterFileOperation() {
+    // Groups are found again, so a deleted duplicate leaves its group
+    if (showing_similar_) {
+        findSimilarImages();
+        return;
+    }
+    auto path = state_->currentPath().lexically_normal();
+    // The watcher sees only the top folder of a flattened listing
+    if (watcher_ && !scan_in_progress_ && !scan_flattened_) {
+        auto watched = watcher_->watchedDirectories();
+        if (std::find(watched.begin(), watched.end(), path) != watched.end()) {
+            return;
+        }
+    }
+    refresh();
+}
+
+void App::searchLibrary(const std::wstring& query) {
+    if (query.find_first_not_of(L" \t") == std::wstring::npos) {
+        if (isSearchingLibrary()) {
+            refresh();  // Ends the search
+        }
+        return;
+    }
+    if (!library_) {
+        return;
+    }
+
+    auto results = library_->search(query);
+    if (!results) {
+        LOG_WARN("Library search failed: {}", library::to_string(results.error()));
+        return;
+    }
+
+    // Results replace the listing like a scan of their own
+    logThumbnailLatencies();
+    cancelDirectoryScan();
+    cancelArchiveBatch();
+    library_query_ = query;
+    scan_flattened_ = false;
+    showing_similar_ = false;
+
+    fs::sortEntries(*results, static_cast<fs::SortOrder>(settings_.sort.toSortOrder()));
+
+    // One bulk query warms the memory cache for the first screen of results
+    constexpr size_t kSearchPrefetchCount = 64;
+    if (cache_ && cache_->isReady()) {
+        std::vector<fs::FileMetadata> screen(
+            results->begin(),
+            results->begin() + static_cast<ptrdiff_t>(std::min(results->size(),
+                                                               kSearchPrefetchCount)));
+        cache_->prefetch(screen, 0, thumbnailRequestSize());
+    }
+    state_->setFiles(std::move(*results));
+}
+
+void App::findSimilarImages() {
+    HWND hwnd = mainHwnd();
+    if (!hwnd || !cache_ || !cache_->isReady()) {
+        return;
+    }
+
+    // The groups replace the listing like a scan of their own
+    logThumbnailLatencies();
+    cancelDirectoryScan();
+    cancelArchiveBatch();
+    library_query_.clear();
+    scan_flattened_ = false;
+    showing_similar_ = true;
+
+    uint64_t generation = ++scan_generation_;
+    scan_in_progress_ = true;
+    scan_streamed_ = false;
+
+    scan_thread_ = std::jthread([this, hwnd, generation,
+                                 cache = cache_.get()](std::stop_token stop_token) {
+        ScanUpdate update{.generation = generation};
+        auto hashes = cache->getPerceptualHashes();
+        if (!hashes) {
+            LOG_WARN("Failed to read perceptual hashes: {}", cache::to_string(hashes.error()));
+            update.result = std::unexpected(fs::DirectoryError::IoError);
+        } else {
+            fs::DirectoryListing listing;
+            auto groups =
+                library::findSimilarImages(*hashes, image::kSimilarHashDistance, stop_token);
+            for (const auto& group : groups) {
+                // Archive entries and files gone since they were cached drop out
+                std::vector<fs::FileMetadata> members;
+                for (const auto& path : group) {
+                    if (auto file = fs::getFileMetadata(path)) {
+                        members.push_back(std::move(*file));
+                    }
+                }
+                if (members.size() > 1) {
+                    listing.entries.insert(listing.entries.end(),
+                                           std::make_move_iterator(members.begin()),
+                                           std::make_move_iterator(members.end()));
+                }
+            }
+            if (stop_token.stop_requested()) {
+                return;
+            }
+            LOG_INFO("Similar images: {} hashed, {} listed", hashes->size(),
+                     listing.entries.size());
+            listing.total_files = listing.entries.size();
+            update.result = std::move(listing);
+        }
+        {
+            std::lock_guard lock(scan_queue_mutex_);
+            scan_updates_.push(std::move(update));
+        }
+        PostMessageW(hwnd, WM_DIRECTORY_SCAN_UPDATE, 0, 0);
+    });
+}
+
+void App::resort() {
+    // Similar images stay in their groups
+    if (showing_similar_) {
+        return;
+    }
+
+    // A running scan sorts in the order it started with, and archive listings
+    // keep their own order; both are simply loaded again
+    auto path = state_->currentPath();
+    if (scan_in_progress_ || (archive_ && archive_->isArchive(path))) {
+        refresh();
+        return;
+    }
+
+    // Capture info is only read by scans that sort by it
+    auto order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+    if (fs::needsCaptureInfo(order)) {
+        refresh();
+        return;
+    }
+
+    auto files = state_->model()->metadata();
+    fs::sortEntries(files, order);
+    state_->reorderFiles(std::move(files));
+}
+
 void App::saveSettings() {
-    (void)config::SettingsManager::save(settings_);
+    if (settings_writer_) {
+        settings_writer_->schedule(settings_);
+    }
+}
+
+void App::relocateCache() {
+    if (!cache_ || !cache_->isReady()) {
+        return;
+    }
+    auto target = config::getCachePath(settings_);
+    auto source = cache_->databasePath();
+
+    if (cache_move_thread_.joinable() && cache_move_target_ == target && source != target) {
+        return;  // Already under way
+    }
+    // A move toward an earlier choice is abandoned; its copies are deleted
+    if (cache_move_thread_.joinable()) {
+        cache_move_thread_.request_stop();
+        cache_move_thread_.join();
+    }
+    if (source == target) {
+        if (!settings_.cache.migrate_from.empty()) {
+            settings_.cache.migrate_from.clear();
+            saveSettings();
+        }
+        return;
+    }
+
+    settings_.cache.migrate_from = source;
+    saveSettings();
+    cache_move_target_ = target;
+    cache_move_thread_ = std::jthread([cache = cache_.get(), target,
+                                       hwnd = mainHwnd()](std::stop_token stop_token) {
+        auto moved = cache->relocate(target, stop_token);
+        if (!moved) {
+            LOG_WARN("Cache not moved to {}: {}", pathToUtf8(target),
+                     cache::to_string(moved.error()));
+        }
+        if (hwnd) {
+            PostMessageW(hwnd, WM_CACHE_RELOCATED, moved && *moved ? 1 : 0, 0);
+        }
+    });
+}
+
+void App::onCacheRelocated(bool moved) {
+    cache_move_target_.clear();
+    // A move that failed or was stopped is tried again at the next start
+    if (moved && cache_ && cache_->databasePath() == config::getCachePath(settings_)) {
+        settings_.cache.migrate_from.clear();
+        saveSettings();
+    }
 }
 
 bool App::isArchiveSupportAvailable() const noexcept {
     return archive_ && archive_->isAvailable();
 }
 
-bool App::initializeCore() {
+App::PendingCore App::startCore() {
+    PendingCore pending;
+
     // Initialize cache
     cache::CacheConfig cache_config;
     cache_config.database_path = config::getCachePath(settings_);
-    cache_config.memory_cache_size = 100;  // Items in memory
+    if (const auto& from = settings_.cache.migrate_from; !from.empty()) {
+        // A move cut short: served from where it started until finishCore() resumes it
+        std::error_code ec;
+        if (!std::filesystem::exists(cache::CacheDatabase::filePath(cache_config.database_path),
+                                     ec) &&
+            std::filesystem::exists(cache::CacheDatabase::filePath(from), ec)) {
+            cache_config.database_path = from;
+        }
+    }
+    cache_config.memory_cache_bytes = settings_.cache.memory_cache_mb * 1024 * 1024;
     cache_config.max_entries = settings_.cache.max_entries;
     cache_config.max_size_bytes = settings_.cache.max_size_mb * 1024 * 1024;
     cache_config.compression_level = settings_.cache.compression_level;
-
-    auto cache_result = cache::CacheManager::create(cache_config);
-    if (cache_result) {
-        cache_ = std::move(*cache_result);
+    cache_config.jpeg_quality = settings_.cache.jpeg_quality;
+    cache_config.zstd_dictionary = settings_.cache.zstd_dictionary;
+    cache_config.deduplicate = settings_.cache.deduplicate;
+    cache_config.mip_levels = static_cast<uint32_t>(settings_.thumbnails.mip_levels);
+    cache_config.mip_base_size = static_cast<uint32_t>(settings_.thumbnails.stored_size);
+    cache_config.storage_backend = settings_.cache.storage == config::CacheStorage::Pack
+                                       ? cache::StorageBackend::PackFile
+                                       : cache::StorageBackend::Sqlite;
+    cache_config.sqlite = {
+        .mmap_size_bytes = static_cast<uint64_t>(settings_.cache.sqlite_mmap_mb) * 1024 * 1024,
+        .page_size = static_cast<uint32_t>(settings_.cache.sqlite_page_size),
+        .wal_autocheckpoint_pages =
+            static_cast<uint32_t>(settings_.cache.sqlite_wal_autocheckpoint),
+        .background_checkpoint = settings_.cache.sqlite_background_checkpoint,
+        .busy_timeout_ms = static_cast<uint32_t>(settings_.cache.sqlite_busy_timeout_ms),
+    };
+    cache_config.shared_database_path = settings_.cache.shared_path;
+
+    pending.cache = globalThreadPool().submit(
+        [cache_config] {
+            ScopedTrace trace("cache open", "startup");
+            return cache::CacheManager::create(cache_config);
+        },
+        TaskPriority::High);
+
+    // The library index lives beside the thumbnail cache
+    if (settings_.library.index_enabled) {
+        auto library_path = config::getCachePath(settings_).parent_path() / L"library.db";
+        pending.library = globalThreadPool().submit(
+            [library_path] {
+                ScopedTrace trace("library open", "startup");
+                return library::LibraryIndex::open(library_path);
+            },
+            TaskPriority::High);
     }
 
-    // Initialize archive manager
+    // Initialize archive manager; 7z.dll is looked for on first use.
+    // Listings live beside the thumbnails: cache_ is set by finishCore(),
+    // before the first navigation lists an archive
     archive::ArchiveManagerConfig archive_config;
+    archive_config.load_listing = [this](const std::filesystem::path& path,
+                                         const archive::ListingStamp& stamp) {
+        return cache_ ? cache_->getArchiveListing(path, stamp.write_time, stamp.size)
+                      : std::nullopt;
+    };
+    archive_config.store_listing = [this](const std::filesystem::path& path,
+                                          const archive::ListingStamp& stamp,
+                                          const std::vector<uint8_t>& listing) {
+        if (cache_) {
+            cache_->putArchiveListing(path, stamp.write_time, stamp.size, listing);
+        }
+    };
     archive_ = std::make_unique<archive::ArchiveManager>(archive_config);
 
     // Initialize thumbnail generator
     thumbnail::GeneratorConfig thumb_config;
     thumb_config.default_thumbnail_size = settings_.thumbnails.stored_size;
     thumb_config.worker_count = static_cast<uint32_t>(settings_.thumbnails.worker_count);
+    thumb_config.io_worker_count = static_cast<uint32_t>(settings_.thumbnails.io_worker_count);
+    thumb_config.adaptive = settings_.thumbnails.adaptive_workers;
+    thumb_config.progressive = settings_.thumbnails.progressive;
+    thumb_config.shell_cache = settings_.thumbnails.shell_cache;
+    thumb_config.trace_requests = settings_.thumbnails.trace_requests;
+    thumb_config.color_management = settings_.color_management;
 
     thumbnails_ = std::make_unique<thumbnail::ThumbnailGenerator>(thumb_config);
-
-    // Connect cache manager to thumbnail generator
-    if (cache_) {
-        thumbnails_->setCacheManager(cache_.get());
+    if (settings_.thumbnails.gpu_scaling) {
+        gpu_scaler_ = std::make_unique<d2d::GpuThumbnailScaler>();
+        thumbnails_->setScaler(gpu_scaler_.get());
     }
 
-    // Initialize plugin manager
+    // Initialize plugin manager; plugins the manifest knows load on first
+    // use, and decodes started before the scan is done wait for it
     {
         wchar_t exe_path[MAX_PATH];
         GetModuleFileNameW(nullptr, exe_path, MAX_PATH);
@@ -264,171 +830,1063 @@ bool App::initializeCore() {
         plugin::PluginManagerConfig plugin_config;
         plugin_config.pluginsDirectory = plugins_dir;
         plugin_config.auto_load = true;
+        plugin_config.isolate = settings_.plugins.isolate;
+        plugin_config.host_executable =
+            std::filesystem::path(exe_path).parent_path() / L"nive_plugin_host.exe";
+        plugin_config.host_processes = static_cast<size_t>(settings_.plugins.host_processes);
+        plugin_config.manifest_path =
+            config::getCachePath(settings_).parent_path() / L"plugins.manifest";
+        plugin_config.disabled = settings_.plugins.disabled_plugins;
 
         plugins_ = std::make_unique<plugin::PluginManager>(plugin_config);
-        if (plugins_->initialize()) {
-            // Unload disabled plugins per settings
-            for (const auto& name : settings_.plugins.disabled_plugins) {
-                plugins_->unloadPlugin(name);
-            }
-            LOG_INFO("Plugin manager initialized: {} plugins loaded", plugins_->loadedCount());
-        } else {
-            LOG_WARN("Failed to initialize plugin manager");
-        }
+        (void)plugins_->initializeAsync(globalThreadPool());
     }
 
-    // Connect plugin manager to thumbnail generator
-    if (plugins_ && thumbnails_) {
-        thumbnails_->setPluginManager(plugins_.get());
+    // Thumbnails and the viewer pick decoders (plugins included) through one registry
+    decoders_ = std::make_unique<image::DecoderRegistry>(plugins_.get());
+    if (thumbnails_) {
+        thumbnails_->setDecoderRegistry(decoders_.get());
     }
 
-    return true;
-}
-
-void App::loadDirectory(const std::filesystem::path& path) {
-    fs::DirectoryFilter filter;
-    filter.include_hidden = settings_.show_hidden_files;
-    filter.images_only = settings_.show_images_only;
-
-    auto result =
-        fs::scanDirectory(path, filter, static_cast<fs::SortOrder>(settings_.sort.toSortOrder()));
-    if (result) {
-        // Cancel any pending thumbnail requests for old directory
-        // MUST be done BEFORE setting new files, which triggers new thumbnail requests
-        if (thumbnails_) {
-            thumbnails_->cancelAll();
-        }
+    // Archive entries are extracted by the generator workers
+    if (archive_ && thumbnails_) {
+        thumbnails_->setArchiveManager(archive_.get());
+    }
 
-        state_->setFiles(std::move(result->entries));
+    return pending;
+}
 
-        // If the Image Viewer is showing a file that no longer exists in the
-        // current directory (e.g. it was deleted from the Main Window's File
-        // List or Thumbnail Grid), close the viewer. Without this hook, the
-        // viewer would keep displaying a stale decoded image of a file that
-        // was just deleted.
-        if (viewer_window_ && viewer_window_->isVisible()) {
-            const auto& shown = viewer_window_->currentPath();
-            if (!shown.empty() && !shown.is_in_archive()) {
-                const auto shown_name = shown.filename();
-                bool still_present = false;
-                for (const auto& f : state_->files()) {
-                    if (f.name == shown_name) {
-                        still_present = true;
-                        break;
-                    }
-                }
-                if (!still_present) {
-                    viewer_window_->close();
-                }
-            }
+void App::finishLibrary(PendingCore& pending) {
+    if (!pending.library.valid()) {
+        return;
+    }
+    auto library_result = pending.library.get();
+    if (library_result) {
+        library_ = std::move(*library_result);
+        std::vector<std::filesystem::path> roots;
+        for (const auto& root : settings_.library.roots) {
+            roots.push_back(utf8ToPath(root));
         }
+        library_->setRoots(std::move(roots));
+    } else {
+        LOG_WARN("Library index unavailable: {}", library::to_string(library_result.error()));
     }
 }
 
-void App::loadArchive(const std::filesystem::path& archive_path) {
-    if (!archive_ || !archive_->isAvailable()) {
-        return;
+void App::finishCore(PendingCore& pending) {
+    auto cache_result = pending.cache.get();
+    if (cache_result) {
+        cache_ = std::move(*cache_result);
+        cache_->scheduleMaintenance();
+        if (!settings_.cache.migrate_from.empty()) {
+            relocateCache();
+        }
     }
 
-    // Cancel any pending thumbnail requests
-    if (thumbnails_) {
-        thumbnails_->cancelAll();
+    // Connect cache manager to thumbnail generator
+    if (cache_ && thumbnails_) {
+        thumbnails_->setCacheManager(cache_.get());
     }
 
-    auto entries_result = archive_->getImageEntries(archive_path);
-    if (!entries_result) {
-        LOG_WARN("Failed to load archive {}: {}", pathToUtf8(archive_path),
-                 to_string(entries_result.error()));
-        state_->setFiles({});
-        return;
+    // Only worth it with a cache to keep the results
+    if (settings_.thumbnails.pregenerate && thumbnails_ && cache_) {
+        thumbnail::PregeneratorConfig pregen_config;
+        pregen_config.max_depth = static_cast<uint32_t>(settings_.thumbnails.pregenerate_depth);
+        pregen_config.include_hidden = settings_.show_hidden_files;
+        pregen_config.sort_order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+        pregenerator_ = std::make_unique<thumbnail::Pregenerator>(*thumbnails_, pregen_config);
+        pregenerator_->setCacheManager(cache_.get());
     }
 
-    std::vector<fs::FileMetadata> files;
-    for (const auto& entry : *entries_result) {
-        if (entry.is_directory) {
-            continue;
-        }
+    // Targeted invalidation for the directories the user has visited
+    watcher_ = std::make_unique<fs::DirectoryWatcher>(
+        [this](fs::DirectoryChanges changes) { onDirectoryChanges(std::move(changes)); });
 
-        fs::FileMetadata meta;
-        meta.virtual_path = archive::VirtualPath(archive_path, entry.path);
-        meta.path = archive_path / entry.path;
-        meta.name = entry.name;
-        meta.extension = entry.extension();
-        meta.type = fs::FileType::Image;
-        meta.size_bytes = entry.uncompressed_size;
-        meta.modified_time = entry.modified_time;
+    // Low memory trims the caches on the UI thread, which owns the grid
+    memory_monitor_ = std::make_unique<MemoryPressureMonitor>(
+        [hwnd = mainHwnd()] { PostMessageW(hwnd, WM_MEMORY_LOW, 0, 0); });
 
-        files.push_back(std::move(meta));
+    // Started on battery: throttle from the first request
+    applyExecutionPolicy();
+}
+
+void App::onWindowMinimized(bool minimized) {
+    if (execution_policy_.setMinimized(minimized)) {
+        applyExecutionPolicy();
     }
+}
 
-    LOG_INFO("Loaded {} images from archive {}", files.size(), pathToUtf8(archive_path));
-    state_->setFiles(std::move(files));
+void App::onPowerStatusChanged() {
+    if (execution_policy_.refreshPowerSource()) {
+        applyExecutionPolicy();
+    }
 }
 
-void App::requestThumbnail(const std::filesystem::path& path, thumbnail::Priority priority) {
-    if (!thumbnails_ || !thumbnails_->isRunning()) {
-        return;
+void App::applyExecutionPolicy() {
+    bool efficient = execution_policy_.efficient();
+    LOG_INFO("Efficiency mode {} (minimized={}, power={})", efficient ? "on" : "off",
+             execution_policy_.minimized(), to_string(execution_policy_.powerSource()));
+    if (thumbnails_) {
+        thumbnails_->setEfficiencyMode(efficient);
     }
+    if (pregenerator_) {
+        pregenerator_->setPaused(efficient);
+    }
+}
 
-    HWND hwnd = mainHwnd();
-    if (!hwnd) {
+void App::startWarmup(const std::filesystem::path& path) {
+    if (!cache_ || !cache_->isReady()) {
         return;
     }
-
-    // Request thumbnail with callback (ignore request ID)
-    (void)thumbnails_->request(
-        path,
-        [this, hwnd](thumbnail::ThumbnailResult result) {
-            // This callback runs on worker thread - queue result and notify UI thread
-            {
-                std::lock_guard lock(thumbnail_queue_mutex_);
-                thumbnail_results_.push(std::move(result));
-            }
-            // Post message to UI thread
-            PostMessageW(hwnd, WM_THUMBNAIL_READY, 0, 0);
-        },
-        priority, static_cast<uint32_t>(settings_.thumbnails.stored_size));
+    warmup_thread_ = warmScreen(path, static_cast<size_t>(settings_.last_scroll_index));
 }
 
-void App::requestThumbnail(const archive::VirtualPath& vpath, thumbnail::Priority priority) {
-    if (!thumbnails_ || !thumbnails_->isRunning()) {
+void App::prefetchDirectory(const std::filesystem::path& path) {
+    if (!cache_ || !cache_->isReady() || path == state_->currentPath()) {
+        return;
+    }
+    // Archives list through the archive manager, not a scan
+    if (archive_ && archive_->isAvailable() && archive_->isArchive(path)) {
+        return;
+    }
+    if (path == prefetch_path_ && prefetch_thread_.joinable()) {
         return;
     }
+    cancelDirectoryPrefetch();
+    prefetch_path_ = path;
+    prefetch_thread_ = warmScreen(path, 0);
+}
+
+void App::cancelDirectoryPrefetch() {
+    if (prefetch_thread_.joinable()) {
+        prefetch_thread_.request_stop();
+        prefetch_thread_.join();
+    }
+    prefetch_path_.clear();
+}
+
+std::jthread App::warmScreen(const std::filesystem::path& path, size_t first) const {
+    fs::DirectoryFilter filter;
+    filter.include_hidden = settings_.show_hidden_files;
+    filter.images_only = settings_.show_images_only;
+    filter.flatten = settings_.flatten_subfolders;
+    auto sort_order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+
+    // Without a saved screen size, assume a generous first screen
+    constexpr size_t kDefaultWarmupCount = 64;
+    size_t count = settings_.last_visible_count > 0
+                       ? static_cast<size_t>(settings_.last_visible_count)
+                       : kDefaultWarmupCount;
+    uint32_t size = thumbnailRequestSize();
+
+    return std::jthread([cache = cache_.get(), path, filter, sort_order, first, count,
+                         size](std::stop_token stop_token) {
+        // Same filter and order as the scan that follows, so the indices match
+        auto listing = fs::scanDirectory(path, filter, sort_order, stop_token);
+        if (!listing || stop_token.stop_requested()) {
+            return;
+        }
+
+        const auto& entries = listing->entries;
+        size_t begin = (std::min)(first, entries.size());
+        size_t end = (std::min)(begin + count, entries.size());
+        std::vector<fs::FileMetadata> screen(entries.begin() + begin, entries.begin() + end);
 
+        // One bulk query for the whole screen
+        uint64_t loaded = cache->prefetch(screen, 0, size);
+        LOG_DEBUG("Warm-up of {}: {} bytes for {} files", pathToUtf8(path), loaded,
+                  screen.size());
+    });
+}
+
+void App::loadDirectory(const std::filesystem::path& path) {
     HWND hwnd = mainHwnd();
     if (!hwnd) {
         return;
     }
 
-    if (vpath.is_in_archive()) {
-        // Extract from archive and request thumbnail from memory
-        if (!archive_) {
+    logThumbnailLatencies();
+    scan_started_ = std::chrono::steady_clock::now();
+
+    // Stop the previous scan before starting a new one. The scan checks its
+    // stop token between entries, so the join returns promptly; anything it
+    // already queued is dropped by the generation check.
+    cancelDirectoryScan();
+    cancelArchiveBatch();
+    cancelDirectoryPrefetch();  // Whatever it loaded is in the memory tier by now
+    library_query_.clear();
+    showing_similar_ = false;
+
+    if (watcher_) {
+        watcher_->watch(path);
+    }
+
+    fs::DirectoryFilter filter;
+    filter.include_hidden = settings_.show_hidden_files;
+    filter.images_only = settings_.show_images_only;
+    filter.flatten = settings_.flatten_subfolders;
+
+    uint64_t generation = ++scan_generation_;
+    scan_in_progress_ = true;
+    scan_streamed_ = false;
+    scan_flattened_ = filter.flatten;
+
+    auto post_update = [this, hwnd](ScanUpdate update) {
+        {
+            std::lock_guard lock(scan_queue_mutex_);
+            scan_updates_.push(std::move(update));
+        }
+        PostMessageW(hwnd, WM_DIRECTORY_SCAN_UPDATE, 0, 0);
+    };
+
+    // Warm the memory cache on the scan thread before each delivery, so the
+    // grid's first thumbnail requests are memory hits. Both callbacks run on
+    // the scan thread; once the budget is spent, later files load on demand.
+    struct PrefetchState {
+        uint64_t budget = 0;
+        bool streamed = false;
+    };
+    auto prefetch_state = std::make_shared<PrefetchState>();
+    if (cache_ && cache_->isReady()) {
+        prefetch_state->budget = cache_->config().memory_cache_bytes;
+    }
+    auto prefetch = [cache = cache_.get(), prefetch_state, size = thumbnailRequestSize()](
+                        const std::vector<fs::FileMetadata>& files) {
+        if (prefetch_state->budget > 0) {
+            uint64_t loaded = cache->prefetch(files, prefetch_state->budget, size);
+            prefetch_state->budget -= std::min(prefetch_state->budget, loaded);
+        }
+    };
+
+    // Resolutions come from cache metadata alone, so every file gets one,
+    // not only those that fit the prefetch budget
+    auto lookup_resolutions = [cache = cache_.get()](const std::vector<fs::FileMetadata>& files) {
+        std::vector<std::pair<std::filesystem::path, cache::ImageResolution>> found;
+        if (!cache || !cache->isReady()) {
+            return found;
+        }
+        auto resolutions = cache->getImageResolutions(files);
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (resolutions[i]) {
+                found.emplace_back(files[i].sourceIdentifier(), *resolutions[i]);
+            }
+        }
+        return found;
+    };
+
+    // A listing saved on an earlier visit shows at once; the scan then
+    // revalidates it instead of streaming batches over it
+    auto order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+    bool use_snapshot = cache_ && cache_->isReady() && !filter.flatten;
+    uint32_t snapshot_options = fs::snapshotOptions(filter, order);
+
+    auto on_batch = [post_update, prefetch, lookup_resolutions, prefetch_state,
+                     generation](std::vector<fs::FileMetadata> batch) {
+        prefetch_state->streamed = true;
+        prefetch(batch);
+        auto resolutions = lookup_resolutions(batch);
+        post_update({generation, std::move(batch), std::nullopt, std::move(resolutions)});
+    };
+
+    // Run here rather than through scanDirectoryAsync, so reading capture
+    // info after the listing stops with the scan
+    scan_thread_ = std::jthread([path, filter, order, on_batch, post_update, prefetch,
+                                 lookup_resolutions, prefetch_state, generation, use_snapshot,
+                                 snapshot_options,
+                                 cache = cache_.get()](std::stop_token stop_token) {
+        auto scan_start = std::chrono::steady_clock::now();
+        std::optional<std::vector<fs::FileMetadata>> snapshot;
+        if (use_snapshot) {
+            if (auto stored = cache->getDirectoryListing(path, snapshot_options)) {
+                snapshot = fs::decodeSnapshot(stored->listing, path);
+            }
+            if (snapshot && !stop_token.stop_requested()) {
+                prefetch_state->streamed = true;
+                prefetch(*snapshot);
+                auto resolutions = lookup_resolutions(*snapshot);
+                post_update({generation, *snapshot, std::nullopt, std::move(resolutions), true});
+            }
+        }
+
+        auto result = fs::scanDirectory(
+            path, filter, order, stop_token,
+            snapshot ? fs::DirectoryBatchCallback() : fs::DirectoryBatchCallback(on_batch));
+
+        // A cancelled scan has been superseded; nobody is waiting for it
+        if (!result && result.error() == fs::DirectoryError::Cancelled) {
             return;
         }
 
-        auto data = archive_->extractToMemory(vpath);
-        if (!data) {
-            std::filesystem::path vpath_as_path(vpath.to_string());
-            LOG_WARN("Failed to extract {} from archive: {}", pathToUtf8(vpath_as_path),
-                     to_string(data.error()));
+        // Sorting by capture date or camera needs every file's EXIF header.
+        // Streamed batches are on screen meanwhile; the sorted listing then
+        // replaces them. Known folders are served from the cache.
+        if (result && cache && fs::needsCaptureInfo(order)) {
+            cache->fillCaptureInfo(result->entries, stop_token);
+            if (stop_token.stop_requested()) {
+                return;
+            }
+            fs::sortEntries(result->entries, order);
+        }
+
+        // Save the sorted listing of a slow folder for the next visit
+        std::optional<fs::ListingDiff> changes;
+        if (result && snapshot) {
+            changes = fs::diffListings(*snapshot, result->entries);
+        }
+        bool slow = std::chrono::steady_clock::now() - scan_start >= kSnapshotMinScan;
+        if (result && use_snapshot && (snapshot || slow) &&
+            result->entries.size() <= fs::kMaxSnapshotEntries) {
+            if (auto write_time = fs::directoryWriteTime(path)) {
+                cache->putDirectoryListing(
+                    path, snapshot_options,
+                    {.write_time = *write_time, .listing = fs::encodeSnapshot(result->entries)});
+            }
+        }
+
+        // Streamed batches were already prefetched as they arrived; of a
+        // revalidated snapshot, only the entries that changed are new
+        std::vector<std::pair<std::filesystem::path, cache::ImageResolution>> resolutions;
+        if (changes) {
+            prefetch(changes->upserted);
+            resolutions = lookup_resolutions(changes->upserted);
+        } else if (result && !prefetch_state->streamed) {
+            prefetch(result->entries);
+            resolutions = lookup_resolutions(result->entries);
+        }
+        post_update({generation, {}, std::move(result), std::move(resolutions), false,
+                     std::move(changes)});
+    });
+}
+
+void App::cancelDirectoryScan() {
+    if (scan_thread_.joinable()) {
+        scan_thread_.request_stop();
+        scan_thread_.join();
+    }
+    // Invalidate anything the stopped scan already queued
+    ++scan_generation_;
+    scan_in_progress_ = false;
+    scan_snapshot_ = false;
+
+    // The pre-generation crawl belongs to the listing being replaced
+    if (pregenerator_) {
+        pregenerator_->stop();
+    }
+}
+
+void App::logThumbnailLatencies() {
+    // One report per listing: the numbers cover the folder being left
+    if (!thumbnails_) {
+        return;
+    }
+    const auto& latencies = thumbnails_->stats().latencies;
+    auto total = latencies.summary(thumbnail::Stage::Total);
+    if (total.count == 0) {
+        return;
+    }
+    LOG_INFO("Thumbnail stage latencies ({} requests, p95 {:.1f}ms):\n{}", total.count,
+             total.p95_ms, latencies.report());
+    if (auto waterfall = thumbnails_->stats().slowest.waterfall(); !waterfall.empty()) {
+        LOG_INFO("Slowest thumbnail requests (ms from request):\n{}", waterfall);
+    }
+    LOG_INFO("Memory: {}", formatMemoryUsage(memoryUsage()));
+    thumbnails_->resetStats();
+}
+
+void App::updatePerfOverlay() {
+    auto* grid = main_window_ ? main_window_->thumbnailGrid() : nullptr;
+    if (!grid || !grid->perfOverlayVisible()) {
+        return;
+    }
+    constexpr double kMiB = 1024.0 * 1024.0;
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = perf_sample_.time == std::chrono::steady_clock::time_point{}
+                         ? 0.0
+                         : std::chrono::duration<double>(now - perf_sample_.time).count();
+    PerfSample sample{.time = now};
+    std::wstring text;
+
+    if (thumbnails_) {
+        auto depth = thumbnails_->pipelineDepth();
+        const auto& stats = thumbnails_->stats();
+        sample.completed = stats.completed_requests.load(std::memory_order_relaxed);
+        // The counters restart with each listing (see logThumbnailLatencies)
+        uint64_t completed = sample.completed >= perf_sample_.completed
+                                 ? sample.completed - perf_sample_.completed
+                                 : sample.completed;
+        double per_second = seconds > 0.0 ? static_cast<double>(completed) / seconds : 0.0;
+        const auto& latencies = stats.latencies;
+        text += std::format(L"queue {:<5} read {}/{}  ready {}  decode {}/{}\n", depth.queued,
+                            depth.reading, depth.io_workers, depth.prefetched, depth.decoding,
+                            depth.decode_workers);
+        text += std::format(L"decode/s {:<7.1f} p95 decode {:.1f} total {:.1f} ms\n", per_second,
+                            latencies.summary(thumbnail::Stage::Decode).p95_ms,
+                            latencies.summary(thumbnail::Stage::Total).p95_ms);
+    }
+
+    if (cache_) {
+        // Hit rate over the interval, not since startup
+        auto stats = cache_->getRuntimeStats();
+        sample.cache_hits = stats.hits;
+        sample.cache_misses = stats.misses;
+        cache::CacheStats interval{.hits = stats.hits - perf_sample_.cache_hits,
+                                   .misses = stats.misses - perf_sample_.cache_misses};
+        text += std::format(L"cache hit {:>5.1f}%  memory {:.0f}/{:.0f} MiB\n",
+                            interval.hitRate() * 100.0,
+                            static_cast<double>(stats.memory_size_bytes) / kMiB,
+                            static_cast<double>(stats.memory_capacity_bytes) / kMiB);
+    }
+
+    PROCESS_MEMORY_COUNTERS_EX memory = {};
+    memory.cb = sizeof(memory);
+    double private_mib = 0.0;
+    if (GetProcessMemoryInfo(GetCurrentProcess(),
+                             reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory), memory.cb)) {
+        private_mib = static_cast<double>(memory.PrivateUsage) / kMiB;
+    }
+    auto usage = memoryUsage();
+    auto mib = [&usage](MemoryCategory category) {
+        return static_cast<double>(usage[category]) / kMiB;
+    };
+    text += std::format(L"process {:.0f} MiB  tracked {:.0f} MiB\n", private_mib,
+                        static_cast<double>(usage.total()) / kMiB);
+    text += std::format(L"cache {:.0f}  grid gpu {:.0f} cpu {:.0f}  viewer {:.0f}\n",
+                        mib(MemoryCategory::CacheTier), mib(MemoryCategory::GridBitmaps),
+                        mib(MemoryCategory::GridPixels), mib(MemoryCategory::Viewer));
+    text += std::format(L"archive {:.0f}  queued {:.0f}  pixel pool {:.0f} MiB\n",
+                        mib(MemoryCategory::ArchiveBuffers), mib(MemoryCategory::QueuedSources),
+                        mib(MemoryCategory::PixelPool));
+
+    auto frames = grid->takeFrameStats();
+    text += std::format(L"frame {:.1f} ms avg  {:.1f} max  {} frames  {} dropped", frames.mean_ms,
+                        frames.max_ms, frames.frames, frames.dropped);
+
+    perf_sample_ = sample;
+    grid->setPerfOverlayText(std::move(text));
+}
+
+void App::releaseMemory() {
+    constexpr double kLowMemoryCacheKeep = 0.25;
+
+    auto before = memoryUsage();
+    if (cache_) {
+        (void)cache_->trimMemoryCache(kLowMemoryCacheKeep);
+    }
+    if (auto* grid = main_window_ ? main_window_->thumbnailGrid() : nullptr) {
+        grid->releaseMemory();
+    }
+    image::PixelBufferPool::instance().trim();
+
+    auto after = memoryUsage();
+    LOG_INFO("Low memory: released {:.1f} MiB; before: {}; after: {}",
+             static_cast<double>(before.total() - (std::min)(after.total(), before.total())) /
+                 (1024.0 * 1024.0),
+             formatMemoryUsage(before), formatMemoryUsage(after));
+}
+
+void App::processDirectoryScanUpdates() {
+    std::queue<ScanUpdate> updates;
+
+    // Swap queues under lock to minimize lock time
+    {
+        std::lock_guard lock(scan_queue_mutex_);
+        updates.swap(scan_updates_);
+    }
+
+    // Batches that arrived together are shown with a single state update
+    std::vector<fs::FileMetadata> pending;
+    std::vector<std::pair<std::filesystem::path, FileListView::Resolution>> resolutions;
+    std::vector<ThumbnailGrid::Placeholder> placeholders;
+    auto flush_pending = [this, &pending]() {
+        if (pending.empty()) {
             return;
         }
+        // Flattened scans mix many directories in completion order, so their
+        // batches are shown sorted rather than in enumeration order
+        auto order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+        if (!scan_streamed_) {
+            // First batch replaces the previous directory's contents
+            if (thumbnails_) {
+                (void)thumbnails_->advanceEpoch();
+            }
+            scan_streamed_ = true;
+            if (scan_flattened_) {
+                fs::sortEntries(pending, order);
+            }
+            state_->setFiles(std::move(pending));
+        } else if (scan_flattened_) {
+            state_->mergeFiles(std::move(pending), order);
+        } else {
+            state_->appendFiles(std::move(pending));
+        }
+        pending.clear();
+    };
+
+    while (!updates.empty()) {
+        auto update = std::move(updates.front());
+        updates.pop();
+
+        // Drop output from scans that were superseded by a later navigation
+        if (update.generation != scan_generation_) {
+            continue;
+        }
+
+        for (auto& [path, resolution] : update.resolutions) {
+            if (resolution.average_color) {
+                placeholders.push_back({.path = path,
+                                        .width = resolution.width,
+                                        .height = resolution.height,
+                                        .color = *resolution.average_color});
+            }
+            resolutions.emplace_back(
+                std::move(path), FileListView::Resolution{resolution.width, resolution.height});
+        }
+
+        if (update.snapshot) {
+            // Sorted already; takes the place of the first streamed batch
+            if (thumbnails_) {
+                (void)thumbnails_->advanceEpoch();
+            }
+            scan_streamed_ = true;
+            scan_snapshot_ = true;
+            state_->setFiles(std::move(update.batch));
+            continue;
+        }
+
+        if (!update.result) {
+            pending.insert(pending.end(), std::make_move_iterator(update.batch.begin()),
+                           std::make_move_iterator(update.batch.end()));
+            continue;
+        }
+
+        flush_pending();
+        finishDirectoryScan(std::move(*update.result), std::move(update.changes));
+    }
+
+    flush_pending();
+
+    // Applied after the rows exist; the list keeps them across re-sorts
+    if (!resolutions.empty() && main_window_) {
+        if (auto* list = main_window_->fileListView()) {
+            list->setResolutions(resolutions);
+        }
+    }
+    if (!placeholders.empty() && main_window_) {
+        if (auto* grid = main_window_->thumbnailGrid()) {
+            grid->setPlaceholders(placeholders);
+        }
+    }
+}
+
+void App::finishDirectoryScan(std::expected<fs::DirectoryListing, fs::DirectoryError> result,
+                              std::optional<fs::ListingDiff> changes) {
+    scan_in_progress_ = false;
+    bool from_snapshot = std::exchange(scan_snapshot_, false);
+    TraceRecorder::instance().complete("directory scan", "browse", scan_started_,
+                                       std::chrono::steady_clock::now());
+
+    if (!result) {
+        LOG_WARN("Failed to scan directory: {}", fs::to_string(result.error()));
+        // A snapshot of a folder that is gone must not stay on screen; one
+        // of an unreachable share is the best listing there is
+        if (from_snapshot && (result.error() == fs::DirectoryError::NotFound ||
+                              result.error() == fs::DirectoryError::NotADirectory)) {
+            state_->setFiles({});
+        }
+        return;
+    }
+
+    if (changes) {
+        // The snapshot is on screen; patch in what the scan found different,
+        // like change notifications (rewritten files lose their thumbnails)
+        LOG_DEBUG("Directory snapshot revalidated: {} removed, {} added or changed",
+                  changes->removed.size(), changes->upserted.size());
+        std::vector<std::filesystem::path> replaced;
+        for (const auto& entry : changes->upserted) {
+            if (state_->findFile(entry.name)) {
+                replaced.push_back(entry.path);
+            }
+        }
+        if (auto* grid = main_window_ ? main_window_->thumbnailGrid() : nullptr) {
+            if (!replaced.empty()) {
+                grid->discardThumbnails(replaced);
+            }
+        }
+        auto order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+        state_->applyFileChanges(changes->removed, std::move(changes->upserted), order);
+    } else if (scan_streamed_) {
+        // Batches were shown in enumeration order; apply the sorted order
+        state_->reorderFiles(std::move(result->entries));
+    } else {
+        // Retire the old directory's thumbnail requests
+        // MUST be done BEFORE setting new files, which triggers new thumbnail requests
+        if (thumbnails_) {
+            (void)thumbnails_->advanceEpoch();
+        }
+
+        state_->setFiles(std::move(result->entries));
+    }
+
+    // Fill in the rest of the folder once the visible requests are done
+    if (pregenerator_ && !showing_similar_) {
+        pregenerator_->start(state_->currentPath(), thumbnailRequestSize());
+    }
+
+    closeViewerIfFileRemoved();
+}
+
+void App::onDirectoryChanges(fs::DirectoryChanges changes) {
+    // Runs on the watcher thread. The cache is updated for every watched
+    // directory; only the current one is reflected in the view.
+    auto& folder_stats = fs::FolderStats::instance();
+    if (changes.overflowed) {
+        folder_stats.invalidateTree(changes.directory);
+    } else {
+        for (const auto& change : changes.changes) {
+            folder_stats.invalidate(change.path);
+        }
+    }
+
+    if (cache_ && cache_->isReady()) {
+        std::vector<std::filesystem::path> stale;
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renamed;
+        const auto& list = changes.changes;
+        for (size_t i = 0; i < list.size(); ++i) {
+            // A rename made elsewhere (e.g. Explorer) keeps its entries too
+            if (list[i].action == fs::FileChangeAction::RenamedFrom && i + 1 < list.size() &&
+                list[i + 1].action == fs::FileChangeAction::RenamedTo) {
+                renamed.emplace_back(list[i].path, list[i + 1].path);
+                ++i;
+            } else if (list[i].action != fs::FileChangeAction::Added &&
+                       list[i].action != fs::FileChangeAction::RenamedTo) {
+                stale.push_back(list[i].path);
+            }
+        }
+        if (!renamed.empty()) {
+            cache_->rekey(renamed);
+        }
+        if (!stale.empty()) {
+            cache_->invalidate(stale);
+        }
+    }
+
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+    {
+        std::lock_guard lock(change_queue_mutex_);
+        directory_changes_.push_back(std::move(changes));
+    }
+    PostMessageW(hwnd, WM_DIRECTORY_CHANGED, 0, 0);
+}
+
+void App::processDirectoryChanges() {
+    std::vector<fs::DirectoryChanges> batches;
+    {
+        std::lock_guard lock(change_queue_mutex_);
+        batches.swap(directory_changes_);
+    }
+
+    // Search results and similar image groups span many directories; the
+    // library index follows the changes, and the next search shows them
+    if (isSearchingLibrary() || showing_similar_) {
+        return;
+    }
+
+    auto current = state_->currentPath().lexically_normal();
+    fs::DirectoryFilter filter;
+    filter.include_hidden = settings_.show_hidden_files;
+    filter.images_only = settings_.show_images_only;
+
+    // Latest state per name: metadata to show, or nullopt to drop the entry
+    std::unordered_map<std::wstring, std::optional<fs::FileMetadata>> latest;
+    bool rescan = false;
+    for (auto& batch : batches) {
+        if (batch.directory != current) {
+            continue;
+        }
+        if (batch.overflowed) {
+            rescan = true;
+            continue;
+        }
+        for (const auto& change : batch.changes) {
+            auto name = change.path.filename().wstring();
+            if (change.action == fs::FileChangeAction::Removed ||
+                change.action == fs::FileChangeAction::RenamedFrom) {
+                latest[name] = std::nullopt;
+                continue;
+            }
+            auto metadata = fs::getFileMetadata(change.path);
+            if (metadata && fs::passesFilter(*metadata, filter)) {
+                latest[name] = std::move(metadata);
+            } else {
+                latest[name] = std::nullopt;
+            }
+        }
+    }
+
+    // A flattened listing holds files of other directories under the same
+    // names, so it is listed again rather than patched by name
+    if (rescan || (scan_flattened_ && !latest.empty() && !scan_in_progress_)) {
+        refresh();
+        return;
+    }
+    // A running scan is listing the directory anyway
+    if (latest.empty() || scan_in_progress_) {
+        return;
+    }
+
+    std::vector<std::wstring> removed;
+    std::vector<fs::FileMetadata> upserted;
+    std::vector<std::filesystem::path> replaced;
+    for (auto& [name, metadata] : latest) {
+        if (metadata) {
+            if (state_->findFile(name)) {
+                replaced.push_back(metadata->path);
+            }
+            upserted.push_back(std::move(*metadata));
+        } else {
+            removed.push_back(name);
+        }
+    }
+
+    // Thumbnails of rewritten files are stale; everything else keeps its own
+    if (auto* grid = main_window_ ? main_window_->thumbnailGrid() : nullptr) {
+        if (!replaced.empty()) {
+            grid->discardThumbnails(replaced);
+        }
+    }
+    // Changed files are few; their headers are read here so they merge in place
+    auto order = static_cast<fs::SortOrder>(settings_.sort.toSortOrder());
+    if (cache_ && fs::needsCaptureInfo(order)) {
+        cache_->fillCaptureInfo(upserted);
+    }
+    state_->applyFileChanges(removed, std::move(upserted), order);
+    closeViewerIfFileRemoved();
+}
+
+void App::closeViewerIfFileRemoved() {
+    // If the Image Viewer is showing a file that no longer exists in the
+    // current directory (e.g. it was deleted from the Main Window's File
+    // List or Thumbnail Grid), close the viewer. Without this hook, the
+    // viewer would keep displaying a stale decoded image of a file that
+    // was just deleted.
+    if (viewer_window_ && viewer_window_->isVisible()) {
+        const auto& shown = viewer_window_->currentPath();
+        if (!shown.empty() && !shown.is_in_archive()) {
+            const auto shown_name = shown.filename();
+            if (!state_->findFile(shown_name)) {
+                viewer_window_->close();
+            }
+        }
+    }
+}
+
+void App::loadArchive(const std::filesystem::path& archive_path) {
+    if (!archive_ || !archive_->isAvailable()) {
+        return;
+    }
+
+    logThumbnailLatencies();
+
+    // A directory scan still running would overwrite the archive listing
+    cancelDirectoryScan();
+    cancelArchiveBatch();
+    library_query_.clear();
+    scan_flattened_ = false;
+    showing_similar_ = false;
+
+    // Retire the previous listing's thumbnail requests
+    if (thumbnails_) {
+        (void)thumbnails_->advanceEpoch();
+    }
+
+    auto entries_result = archive_->listEntries(archive_path);
+    if (!entries_result) {
+        LOG_WARN("Failed to load archive {}: {}", pathToUtf8(archive_path),
+                 to_string(entries_result.error()));
+        state_->setFiles({});
+        return;
+    }
+    std::sort(entries_result->begin(), entries_result->end(),
+              [](const archive::ArchiveEntry& a, const archive::ArchiveEntry& b) {
+                  return fs::naturalCompare(a.path, b.path) < 0;
+              });
+
+    // Archives inside the archive come first, like folders; their path is
+    // the nested archive path that navigateTo() opens
+    std::vector<fs::FileMetadata> files;
+    for (const auto& entry : *entries_result) {
+        if (entry.is_directory || !archive_->isArchive(std::filesystem::path(entry.path))) {
+            continue;
+        }
+        fs::FileMetadata meta;
+        meta.path = archive::VirtualPath(archive_path, entry.path).to_string();
+        meta.name = entry.name;
+        meta.extension = entry.extension();
+        meta.type = fs::FileType::Archive;
+        meta.size_bytes = entry.uncompressed_size;
+        meta.modified_time = entry.modified_time;
+        files.push_back(std::move(meta));
+    }
+    size_t archive_count = files.size();
+
+    for (const auto& entry : *entries_result) {
+        if (entry.is_directory || !entry.is_image()) {
+            continue;
+        }
+
+        fs::FileMetadata meta;
+        meta.virtual_path = archive::VirtualPath(archive_path, entry.path);
+        meta.path = archive_path / entry.path;
+        meta.name = entry.name;
+        meta.extension = entry.extension();
+        meta.type = fs::FileType::Image;
+        meta.size_bytes = entry.uncompressed_size;
+        meta.modified_time = entry.modified_time;
+
+        files.push_back(std::move(meta));
+    }
+
+    LOG_INFO("Loaded {} images and {} archives from archive {}", files.size() - archive_count,
+             archive_count, pathToUtf8(archive_path));
 
-        // Use virtual path string as the path identifier
-        std::filesystem::path virtual_path_id(vpath.to_string());
+    archive_stamp_path_ = archive_path;
+    archive_stamp_ = cache::statSource(archive_path);
+
+    // One bulk query warms the memory cache for the first screen of entries,
+    // as the scan thread does for a folder
+    constexpr size_t kArchivePrefetchCount = 64;
+    if (cache_ && cache_->isReady()) {
+        size_t count = std::min(files.size(), archive_count + kArchivePrefetchCount);
+        std::vector<fs::FileMetadata> screen(files.begin(),
+                                             files.begin() + static_cast<ptrdiff_t>(count));
+        cache_->prefetch(screen, 0, thumbnailRequestSize());
+    }
+
+    // Solid archives re-decompress the solid block for every single-entry
+    // extraction, so thumbnail them in one sequential pass instead. Started
+    // before setFiles() so the grid's per-entry requests defer to the batch.
+    if (thumbnails_ && thumbnails_->isRunning() && archive_->isSolid(archive_path)) {
+        std::vector<std::wstring> entry_paths;
+        entry_paths.reserve(files.size() - archive_count);
+        for (const auto& file : files | std::views::drop(archive_count)) {
+            entry_paths.push_back(file.virtual_path->internal_path());
+        }
+        startArchiveBatch(archive_path, std::move(entry_paths));
+    }
+
+    state_->setFiles(std::move(files));
+}
+
+void App::startArchiveBatch(const std::filesystem::path& archive_path,
+                            std::vector<std::wstring> entry_paths) {
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(archive_batch_mutex_);
+        archive_batch_path_ = archive_path;
+        archive_batch_pending_ = {entry_paths.begin(), entry_paths.end()};
+    }
+
+    auto size = thumbnailRequestSize();
+    auto stamp = archive_path == archive_stamp_path_ ? archive_stamp_ : std::nullopt;
+    archive_batch_thread_ = std::jthread([this, hwnd, archive_path, size, stamp,
+                                          entry_paths = std::move(entry_paths)](
+                                             std::stop_token stop_token) {
+        // Deliver an entry to the generator and drop it from the pending set
+        auto hand_over = [&](const std::wstring& entry_path, std::vector<uint8_t>* data) {
+            {
+                std::lock_guard lock(archive_batch_mutex_);
+                archive_batch_pending_.erase(entry_path);
+            }
+            archive::VirtualPath vpath(archive_path, entry_path);
+            if (data) {
+                (void)thumbnails_->requestFromArchive(vpath, std::move(*data),
+                                                      makeThumbnailCallback(hwnd),
+                                                      thumbnail::Priority::Normal, size, stamp);
+            } else {
+                (void)thumbnails_->requestFromArchive(vpath, makeThumbnailCallback(hwnd),
+                                                      thumbnail::Priority::Normal, size,
+                                                      thumbnail::kNoViewIndex, stamp);
+            }
+        };
+
+        // Entries already cached need no extraction at all
+        std::vector<std::wstring> to_extract;
+        for (const auto& entry_path : entry_paths) {
+            if (cache_ && cache_->hasThumbnail(
+                              archive::VirtualPath(archive_path, entry_path).to_string(), stamp)) {
+                hand_over(entry_path, nullptr);
+            } else {
+                to_extract.push_back(entry_path);
+            }
+        }
 
-        (void)thumbnails_->requestFromMemory(
-            virtual_path_id, std::move(*data),
-            [this, hwnd, vpath](thumbnail::ThumbnailResult result) {
-                // Override path with virtual path string for correct keying
-                result.path = std::filesystem::path(vpath.to_string());
-                {
-                    std::lock_guard lock(thumbnail_queue_mutex_);
-                    thumbnail_results_.push(std::move(result));
+        auto result = archive_->extractBatch(
+            archive_path, to_extract,
+            [&](const std::wstring& entry_path, std::vector<uint8_t> data) {
+                // Keep the generator queue short so decompression does not
+                // run arbitrarily far ahead of decoding
+                constexpr size_t kMaxQueuedFromBatch = 32;
+                while (!stop_token.stop_requested() &&
+                       (thumbnails_->pendingCount() > kMaxQueuedFromBatch ||
+                        thumbnails_->isSaturated())) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
-                PostMessageW(hwnd, WM_THUMBNAIL_READY, 0, 0);
-            },
-            priority, static_cast<uint32_t>(settings_.thumbnails.stored_size));
+                if (stop_token.stop_requested()) {
+                    return false;
+                }
+                hand_over(entry_path, &data);
+                return true;
+            });
+
+        if (!result) {
+            LOG_WARN("Batch extraction failed for {}: {}", pathToUtf8(archive_path),
+                     to_string(result.error()));
+        }
+
+        // Anything the pass did not deliver falls back to per-entry extraction
+        std::vector<std::wstring> remaining;
+        {
+            std::lock_guard lock(archive_batch_mutex_);
+            remaining.assign(archive_batch_pending_.begin(), archive_batch_pending_.end());
+        }
+        if (!stop_token.stop_requested()) {
+            for (const auto& entry_path : remaining) {
+                hand_over(entry_path, nullptr);
+            }
+        }
+
+        std::lock_guard lock(archive_batch_mutex_);
+        archive_batch_path_.clear();
+        archive_batch_pending_.clear();
+    });
+}
+
+void App::cancelArchiveBatch() {
+    if (archive_batch_thread_.joinable()) {
+        archive_batch_thread_.request_stop();
+        archive_batch_thread_.join();
+    }
+    std::lock_guard lock(archive_batch_mutex_);
+    archive_batch_path_.clear();
+    archive_batch_pending_.clear();
+}
+
+bool App::isPendingInArchiveBatch(const archive::VirtualPath& vpath) {
+    std::lock_guard lock(archive_batch_mutex_);
+    return !archive_batch_path_.empty() && vpath.archive_path() == archive_batch_path_ &&
+           archive_batch_pending_.contains(vpath.internal_path());
+}
+
+void App::requestThumbnail(const std::filesystem::path& path, thumbnail::Priority priority) {
+    if (!thumbnails_ || !thumbnails_->isRunning()) {
+        return;
+    }
+
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+
+    // Request thumbnail with callback (ignore request ID)
+    (void)thumbnails_->request(path, makeThumbnailCallback(hwnd), priority,
+                               thumbnailRequestSize());
+}
+
+void App::requestThumbnail(const fs::FileMetadata& file, thumbnail::Priority priority,
+                           size_t view_index) {
+    if (file.is_in_archive()) {
+        requestThumbnail(*file.virtual_path, priority, view_index);
+        return;
+    }
+
+    if (!thumbnails_ || !thumbnails_->isRunning()) {
+        return;
+    }
+
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+
+    (void)thumbnails_->request(file, makeThumbnailCallback(hwnd), priority,
+                               thumbnailRequestSize(), view_index);
+}
+
+void App::setThumbnailViewport(const thumbnail::Viewport& viewport) {
+    if (thumbnails_) {
+        (void)thumbnails_->setViewport(viewport);
+    }
+}
+
+uint32_t App::thumbnailLevel(int display_size) const {
+    if (!cache_) {
+        return static_cast<uint32_t>(settings_.thumbnails.stored_size);
+    }
+    return cache_->thumbnailLevel(static_cast<uint32_t>(display_size));
+}
+
+uint32_t App::thumbnailRequestSize() const {
+    // Without mipmap levels every request is for the one stored size
+    if (settings_.thumbnails.mip_levels > 1) {
+        return static_cast<uint32_t>(settings_.thumbnails.display_size);
+    }
+    return static_cast<uint32_t>(settings_.thumbnails.stored_size);
+}
+
+thumbnail::ThumbnailCallback App::makeThumbnailCallback(HWND hwnd) {
+    return [this, hwnd](thumbnail::ThumbnailResult result) {
+        // This callback runs on worker thread - upload the pixels here so the
+        // UI thread only copies GPU memory, then queue and notify
+        d2d::StagedBitmap staged;
+        if (result.success() && result.thumbnail) {
+            const auto& image = *result.thumbnail;
+            staged = d2d::GpuDevice::instance().stage(
+                image, d2d::ThumbnailAtlas::fits(image) ? d2d::ThumbnailAtlas::kBorder : 0);
+            etw::uiStage(result.request_id, static_cast<bool>(staged));
+        }
+        bool notify = false;
+        {
+            std::lock_guard lock(thumbnail_queue_mutex_);
+            thumbnail_results_.push({std::move(result), std::move(staged)});
+            notify = !std::exchange(thumbnail_notify_posted_, true);
+        }
+        // One message per batch: later results ride along with the pending one
+        if (notify) {
+            PostMessageW(hwnd, WM_THUMBNAIL_READY, 0, 0);
+        }
+    };
+}
+
+void App::requestThumbnail(const archive::VirtualPath& vpath, thumbnail::Priority priority,
+                           size_t view_index) {
+    if (!thumbnails_ || !thumbnails_->isRunning()) {
+        return;
+    }
+
+    HWND hwnd = mainHwnd();
+    if (!hwnd) {
+        return;
+    }
+
+    if (vpath.is_in_archive()) {
+        // A running solid-archive batch will deliver this entry itself
+        if (isPendingInArchiveBatch(vpath)) {
+            return;
+        }
+
+        // Extraction happens on a generator worker (and is skipped on cache hits);
+        // the result path is the virtual path string used for keying
+        auto stamp = vpath.archive_path() == archive_stamp_path_ ? archive_stamp_ : std::nullopt;
+        (void)thumbnails_->requestFromArchive(vpath, makeThumbnailCallback(hwnd), priority,
+                                              thumbnailRequestSize(), view_index, stamp);
     } else {
         // Regular filesystem path
         requestThumbnail(vpath.archive_path(), priority);
@@ -436,44 +1894,75 @@ void App::requestThumbnail(const archive::VirtualPath& vpath, thumbnail::Priorit
 }
 
 void App::processThumbnailResults() {
-    std::queue<thumbnail::ThumbnailResult> results;
+    // Pace batches: deliver at most once per interval and let results collect
+    auto now = std::chrono::steady_clock::now();
+    auto since_last = now - last_thumbnail_batch_;
+    if (since_last < kThumbnailBatchInterval && main_window_) {
+        main_window_->scheduleThumbnailResults(
+            std::chrono::ceil<std::chrono::milliseconds>(kThumbnailBatchInterval - since_last));
+        return;
+    }
+
+    std::queue<ReadyThumbnail> results;
 
     // Swap queues under lock to minimize lock time
     {
         std::lock_guard lock(thumbnail_queue_mutex_);
         results.swap(thumbnail_results_);
+        thumbnail_notify_posted_ = false;
     }
 
     if (results.empty()) {
         return;
     }
+    last_thumbnail_batch_ = now;
+    ScopedTrace trace("thumbnail batch", "browse");
+    if (!first_thumbnails_shown_) {
+        first_thumbnails_shown_ = true;
+        LOG_INFO("Startup: first thumbnails {:.1f} ms after launch", to_ms(now - startup_begin_));
+        TraceRecorder::instance().complete("first thumbnails", "startup", startup_begin_, now);
+    }
 
-    LOG_DEBUG("processThumbnailResults: processing {} results", results.size());
-
-    // Process results on UI thread
-    size_t success_count = 0;
+    // Process results on UI thread; the grid uploads the batch and repaints once
+    std::vector<ThumbnailGrid::ThumbnailUpdate> batch;
+    batch.reserve(results.size());
     while (!results.empty()) {
-        auto result = std::move(results.front());
+        auto [result, staged] = std::move(results.front());
         results.pop();
+        if (thumbnails_) {
+            thumbnails_->recordDelivery(result);
+        }
 
         if (result.success() && result.thumbnail && main_window_) {
-            if (auto* grid = main_window_->thumbnailGrid()) {
-                grid->setThumbnail(result.path, std::move(*result.thumbnail));
-                success_count++;
-            }
             if (auto* list = main_window_->fileListView()) {
-                list->setResolution(result.path, result.original_width, result.original_height);
+                list->setResolution(result.path_id, result.original_width,
+                                    result.original_height);
             }
+            batch.push_back({.id = result.path_id,
+                             .image = std::move(*result.thumbnail),
+                             .staged = std::move(staged),
+                             .preview = result.preview,
+                             .request_id = result.request_id});
         } else if (result.error) {
             LOG_WARN("Thumbnail generation failed for {}: {}", pathToUtf8(result.path), *result.error);
         }
     }
 
-    LOG_DEBUG("processThumbnailResults: {} thumbnails set successfully", success_count);
+    if (auto* grid = main_window_ ? main_window_->thumbnailGrid() : nullptr) {
+        grid->setThumbnails(std::move(batch));
+    }
+
+    if (thumbnails_) {
+        auto depth = thumbnails_->pipelineDepth();
+        LOG_DEBUG("Thumbnail pipeline: queued={} reading={}/{} prefetched={} decoding={}/{} "
+                  "stolen={}",
+                  depth.queued, depth.reading, depth.io_workers, depth.prefetched, depth.decoding,
+                  depth.decode_workers, depth.stolen);
+    }
 
-    // Update status bar with current thumbnail count
+    // Thumbnail count; batches can land faster than the display refreshes
     if (main_window_) {
-        main_window_->updateStatusBar();
+        main_window_->requestStatusBarUpdate();
     }
 }
 
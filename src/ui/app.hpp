@@ -5,18 +5,38 @@
 
 #include <Windows.h>
 
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "core/archive/archive_manager.hpp"
 #include "core/cache/cache_manager.hpp"
 #include "core/config/settings.hpp"
+#include "core/config/settings_writer.hpp"
+#include "core/fs/directory.hpp"
+#include "core/fs/directory_watcher.hpp"
+#include "core/fs/listing_snapshot.hpp"
+#include "core/image/decoder_registry.hpp"
+#include "core/library/library_index.hpp"
 #include "core/plugin/plugin_manager.hpp"
+#include "core/thumbnail/pregenerator.hpp"
 #include "core/thumbnail/thumbnail_generator.hpp"
 #include "core/thumbnail/thumbnail_request.hpp"
+#include "core/util/execution_policy.hpp"
+#include "core/util/memory_pressure.hpp"
 #include "state/app_state.hpp"
+#include "ui/d2d/core/gpu_device.hpp"
+#include "ui/d2d/core/gpu_scaler.hpp"
+#include "window_executor.hpp"
 
 namespace nive::ui {
 
@@ -24,15 +44,38 @@ namespace nive::ui {
 class MainWindow;
 class ImageViewerWindow;
 
-// Custom window message for thumbnail completion
+// Custom window message for thumbnail completion (at most one outstanding;
+// results that arrive meanwhile are delivered with it)
 constexpr UINT WM_THUMBNAIL_READY = WM_USER + 100;
 
+// Custom window message for incremental directory scan results
+constexpr UINT WM_DIRECTORY_SCAN_UPDATE = WM_USER + 101;
+
+// Custom window message for file system change notifications
+constexpr UINT WM_DIRECTORY_CHANGED = WM_USER + 102;
+
+// Custom window message resuming a coroutine on the UI thread (see WindowExecutor)
+constexpr UINT WM_RESUME_COROUTINE = WM_USER + 103;
+
+// Custom window message for low physical memory (see App::releaseMemory)
+constexpr UINT WM_MEMORY_LOW = WM_USER + 104;
+
+// Custom window message for the end of a cache move (see App::relocateCache);
+// wParam is nonzero if the cache now lives at the new location
+constexpr UINT WM_CACHE_RELOCATED = WM_USER + 105;
+
 /// @brief Application configuration
 struct AppConfig {
     std::wstring initial_path;
     bool start_maximized = false;
 };
 
+/// @brief Options for a headless pre-generation run (nive --pregenerate)
+struct PregenerationOptions {
+    std::filesystem::path root;  // Directory tree to thumbnail
+    uint32_t jobs = 0;           // Decode threads (0 = the thumbnails.worker_count setting)
+};
+
 /// @brief Main application class
 ///
 /// Manages application lifecycle, creates main window, and
@@ -45,9 +88,20 @@ public:
     /// @brief Initialize application
     /// @param hInstance Application instance handle
     /// @param config Application configuration
-    /// @return true if initialization succeeded
+    /// @return true if initialization succeeded; false as well when the path
+    ///         was handed to a running instance (see forwarded())
     bool initialize(HINSTANCE hInstance, const AppConfig& config = {});
 
+    /// @brief Check if initialize() passed its path to a running instance
+    ///
+    /// With settings.single_instance on, a later launch sends its path to the
+    /// window already open, whose caches and pools are warm, and exits.
+    [[nodiscard]] bool forwarded() const noexcept { return forwarded_; }
+
+    /// @brief Handle a path forwarded by a later launch (UI thread)
+    /// @param path Folder, archive or file to open; empty to only raise the window
+    void openForwarded(const std::filesystem::path& path);
+
     /// @brief Run application message loop
     /// @return Exit code
     int run();
@@ -55,6 +109,17 @@ public:
     /// @brief Shutdown application
     void shutdown();
 
+    /// @brief Thumbnail a directory tree into the cache without creating windows
+    /// @param options Tree to crawl and decode threads to use
+    /// @return Exit code: 0 when done, 1 on error, 2 when interrupted
+    ///
+    /// Uses the same cache, generator, archive and plugin setup as the GUI,
+    /// crawls every subfolder and archive with no yielding, and prints
+    /// throughput to the console it was started from. Files the cache
+    /// already holds are skipped, so an interrupted run picks up where it got
+    /// to. Call instead of initialize()/run()/shutdown().
+    int runPregeneration(const PregenerationOptions& options);
+
     /// @brief Get application state
     [[nodiscard]] AppState& state() noexcept { return *state_; }
 
@@ -70,30 +135,107 @@ public:
     /// @brief Get thumbnail generator
     [[nodiscard]] thumbnail::ThumbnailGenerator* thumbnails() noexcept { return thumbnails_.get(); }
 
+    /// @brief Get library index (nullptr unless enabled in settings)
+    [[nodiscard]] library::LibraryIndex* library() noexcept { return library_.get(); }
+
     /// @brief Get plugin manager
     [[nodiscard]] plugin::PluginManager* plugins() noexcept { return plugins_.get(); }
 
+    /// @brief Get the decoder registry shared by thumbnails and the viewer
+    [[nodiscard]] const image::DecoderRegistry& decoders() const noexcept {
+        return decoders_ ? *decoders_ : image::DecoderRegistry::builtin();
+    }
+
     /// @brief Get main window handle
     [[nodiscard]] HWND mainHwnd() const noexcept;
 
     /// @brief Get main window
     [[nodiscard]] MainWindow* mainWindow() noexcept { return main_window_.get(); }
 
+    /// @brief Get the executor resuming coroutines on the UI thread
+    /// @note Valid once the main window exists
+    [[nodiscard]] Executor& uiExecutor() noexcept { return *ui_executor_; }
+
     /// @brief Get application instance handle
     [[nodiscard]] HINSTANCE hinstance() const noexcept { return hinstance_; }
 
     /// @brief Navigate to path
     void navigateTo(const std::filesystem::path& path);
 
+    /// @brief Speculatively warm the memory cache for a folder the user may open
+    /// @param path Folder, e.g. the directory tree item under the mouse
+    ///
+    /// Scans the folder on a thread of its own, with the current filter and
+    /// sort order, and bulk-loads the cached thumbnails of its first screen,
+    /// so navigating there finds them in memory. Starting another prefetch
+    /// or navigating anywhere cancels it. The current folder and archives
+    /// are ignored.
+    void prefetchDirectory(const std::filesystem::path& path);
+
+    /// @brief Cancel the prefetch started by prefetchDirectory(), if any
+    void cancelDirectoryPrefetch();
+
     /// @brief Open image in viewer
     void openImage(const archive::VirtualPath& path);
 
     /// @brief Refresh current directory
     void refresh();
 
+    /// @brief Show the results of a file operation in the current directory
+    ///
+    /// When the directory watcher covers the current directory, its change
+    /// notifications patch the listing in place and nothing is rescanned;
+    /// otherwise this is refresh().
+    void refreshAfterFileOperation();
+
+    /// @brief Apply the sort settings to the current listing
+    ///
+    /// Re-sorts the listed entries in place, reusing their sort keys,
+    /// instead of scanning the directory again.
+    void resort();
+
+    /// @brief Show the library files whose names match a query in place of the directory
+    /// @param query Search terms; empty returns to the current directory
+    ///
+    /// Results come from the library index, not the file system, and carry
+    /// the indexed mtime and size, so their thumbnails come from the cache.
+    /// Navigating anywhere ends the search.
+    void searchLibrary(const std::wstring& query);
+
+    /// @brief Check if the listing shows library search results
+    [[nodiscard]] bool isSearchingLibrary() const noexcept { return !library_query_.empty(); }
+
+    /// @brief Get the query whose results are listed (empty when not searching)
+    [[nodiscard]] const std::wstring& libraryQuery() const noexcept { return library_query_; }
+
+    /// @brief List the cached images that look alike, in place of the directory
+    ///
+    /// Compares the perceptual hashes stored with cached thumbnails on the
+    /// scan thread; nothing is decoded. Each group of similar images is listed
+    /// together. Only images that have been thumbnailed are found, and archive
+    /// entries are left out. Navigating anywhere ends the listing.
+    void findSimilarImages();
+
+    /// @brief Check if the listing shows groups of similar images
+    [[nodiscard]] bool isShowingSimilarImages() const noexcept { return showing_similar_; }
+
     /// @brief Save settings
+    ///
+    /// Hands a snapshot to the settings writer, which writes it on its own
+    /// thread once saves stop arriving; no file I/O happens on the caller.
     void saveSettings();
 
+    /// @brief Move the disk cache to the location in the settings (call from UI thread)
+    ///
+    /// After the settings dialog changes the cache location. The databases
+    /// are copied on a thread of their own while thumbnails keep coming from
+    /// the old location; the move resumes at the next start if the
+    /// application exits first. No-op if the cache is already there.
+    void relocateCache();
+
+    /// @brief Record the end of a cache move (WM_CACHE_RELOCATED, UI thread)
+    void onCacheRelocated(bool moved);
+
     /// @brief Check if archive support is available
     [[nodiscard]] bool isArchiveSupportAvailable() const noexcept;
 
@@ -103,15 +245,68 @@ public:
     void requestThumbnail(const std::filesystem::path& path,
                           thumbnail::Priority priority = thumbnail::Priority::Normal);
 
+    /// @brief Request thumbnail for an enumerated file or archive entry
+    /// @param file File metadata (its mtime/size form the cache key)
+    /// @param priority Request priority
+    /// @param view_index Position in the thumbnail grid (see setThumbnailViewport)
+    void requestThumbnail(const fs::FileMetadata& file,
+                          thumbnail::Priority priority = thumbnail::Priority::Normal,
+                          size_t view_index = thumbnail::kNoViewIndex);
+
     /// @brief Request thumbnail for a virtual path (archive contents)
     /// @param path Virtual path
     /// @param priority Request priority
+    /// @param view_index Position in the thumbnail grid (see setThumbnailViewport)
     void requestThumbnail(const archive::VirtualPath& path,
-                          thumbnail::Priority priority = thumbnail::Priority::Normal);
+                          thumbnail::Priority priority = thumbnail::Priority::Normal,
+                          size_t view_index = thumbnail::kNoViewIndex);
+
+    /// @brief Reorder pending thumbnail requests for the grid's visible range
+    /// @param viewport Visible and kept index ranges, scroll direction and speed
+    void setThumbnailViewport(const thumbnail::Viewport& viewport);
+
+    /// @brief Get the cached thumbnail level that serves a grid display size
+    /// @param display_size Grid thumbnail size in pixels
+    /// @return Nominal level size; requests must be reissued when this changes
+    [[nodiscard]] uint32_t thumbnailLevel(int display_size) const;
 
     /// @brief Process pending thumbnail results (call from UI thread)
+    ///
+    /// Results are delivered to the grid as one batch at most once per
+    /// kThumbnailBatchInterval; a call inside the interval defers the batch.
     void processThumbnailResults();
 
+    /// @brief Minimum time between thumbnail result batches (about one frame)
+    static constexpr std::chrono::milliseconds kThumbnailBatchInterval{16};
+
+    /// @brief Sample the live counters into the grid's performance overlay (UI thread)
+    ///
+    /// Rates cover the time since the previous call; MainWindow calls this
+    /// on a timer while the overlay is shown.
+    void updatePerfOverlay();
+
+    /// @brief Process pending directory scan batches and results (call from UI thread)
+    void processDirectoryScanUpdates();
+
+    /// @brief Apply pending file system change notifications (call from UI thread)
+    void processDirectoryChanges();
+
+    /// @brief Trim the caches that can refill themselves (call from UI thread)
+    ///
+    /// Sent as WM_MEMORY_LOW when the system reports low physical memory:
+    /// the memory tier keeps its most recent quarter, the grid keeps the
+    /// visible thumbnails and the pixel pool frees its blocks.
+    void releaseMemory();
+
+    /// @brief Track main window minimize and restore (call from UI thread)
+    void onWindowMinimized(bool minimized);
+
+    /// @brief Re-read the power source after WM_POWERBROADCAST (call from UI thread)
+    void onPowerStatusChanged();
+
+    /// @brief Check whether a directory scan is still delivering entries
+    [[nodiscard]] bool isLoadingDirectory() const noexcept { return scan_in_progress_; }
+
 private:
     App();
     ~App();
@@ -119,25 +314,140 @@ private:
     App(const App&) = delete;
     App& operator=(const App&) = delete;
 
-    bool initializeCore();
+    /// @brief Directory scan output queued for the UI thread
+    struct ScanUpdate {
+        uint64_t generation = 0;
+        std::vector<fs::FileMetadata> batch;
+        // Set only for the final update of a scan
+        std::optional<std::expected<fs::DirectoryListing, fs::DirectoryError>> result;
+        // Cached original resolutions and thumbnail colours of the delivered files,
+        // by sourceIdentifier()
+        std::vector<std::pair<std::filesystem::path, cache::ImageResolution>> resolutions;
+        // The batch is the sorted snapshot of the last visit, shown until the scan ends
+        bool snapshot = false;
+        // With the result of a scan that revalidated a snapshot: what it found different
+        std::optional<fs::ListingDiff> changes;
+    };
+
+    /// @brief Subsystems opening on the thread pool during startup
+    struct PendingCore {
+        std::future<std::expected<std::unique_ptr<cache::CacheManager>, cache::CacheError>>
+            cache;
+        std::future<std::expected<std::unique_ptr<library::LibraryIndex>, library::LibraryError>>
+            library;  // Not valid without the library index
+    };
+
+    /// @brief Set up the core, starting the slow parts on the thread pool
+    [[nodiscard]] PendingCore startCore();
+
+    /// @brief Take the library index once it is open
+    void finishLibrary(PendingCore& pending);
+
+    /// @brief Take the cache once it is open and connect what depends on it
+    void finishCore(PendingCore& pending);
+    void startWarmup(const std::filesystem::path& path);
+    /// @brief Scan a folder and bulk-load the cached thumbnails of one screen from first
+    [[nodiscard]] std::jthread warmScreen(const std::filesystem::path& path, size_t first) const;
     void loadDirectory(const std::filesystem::path& path);
     void loadArchive(const std::filesystem::path& archive_path);
+    void cancelDirectoryScan();
+    void logThumbnailLatencies();
+    void startArchiveBatch(const std::filesystem::path& archive_path,
+                           std::vector<std::wstring> entry_paths);
+    void cancelArchiveBatch();
+    [[nodiscard]] bool isPendingInArchiveBatch(const archive::VirtualPath& vpath);
+    [[nodiscard]] thumbnail::ThumbnailCallback makeThumbnailCallback(HWND hwnd);
+    [[nodiscard]] uint32_t thumbnailRequestSize() const;
+    void finishDirectoryScan(std::expected<fs::DirectoryListing, fs::DirectoryError> result,
+                             std::optional<fs::ListingDiff> changes);
+    void closeViewerIfFileRemoved();
+    void onDirectoryChanges(fs::DirectoryChanges changes);
+
+    /// @brief Throttle or release background work per execution_policy_
+    void applyExecutionPolicy();
 
     HINSTANCE hinstance_ = nullptr;
 
     config::Settings settings_;
+    std::unique_ptr<config::SettingsWriter> settings_writer_;
+
+    // Single-instance mode: held by the first process, closed on exit
+    HANDLE instance_mutex_ = nullptr;
+    bool forwarded_ = false;
     std::unique_ptr<AppState> state_;
     std::unique_ptr<MainWindow> main_window_;
+    std::optional<WindowExecutor> ui_executor_;  // Posts to main_window_
     std::unique_ptr<ImageViewerWindow> viewer_window_;
 
     std::unique_ptr<cache::CacheManager> cache_;
     std::unique_ptr<archive::ArchiveManager> archive_;
+    std::unique_ptr<d2d::GpuThumbnailScaler> gpu_scaler_;  // Optional; outlives thumbnails_
     std::unique_ptr<thumbnail::ThumbnailGenerator> thumbnails_;
+    std::unique_ptr<thumbnail::Pregenerator> pregenerator_;  // Optional idle-time crawl
+    std::unique_ptr<library::LibraryIndex> library_;         // Optional filename index
     std::unique_ptr<plugin::PluginManager> plugins_;
+    ExecutionPolicy execution_policy_;  // Minimized / on battery: efficiency mode
+    std::unique_ptr<image::DecoderRegistry> decoders_;
+
+    // Thumbnail result with its bitmap, created on the worker that finished it
+    struct ReadyThumbnail {
+        thumbnail::ThumbnailResult result;
+        d2d::StagedBitmap staged;  // Empty without a shared GPU device
+    };
 
     // Thread-safe queue for thumbnail results from worker threads
     mutable std::mutex thumbnail_queue_mutex_;
-    std::queue<thumbnail::ThumbnailResult> thumbnail_results_;
+    std::queue<ReadyThumbnail> thumbnail_results_;
+    bool thumbnail_notify_posted_ = false;  // WM_THUMBNAIL_READY sent, results not yet taken
+    std::chrono::steady_clock::time_point last_thumbnail_batch_;  // UI thread only
+    std::chrono::steady_clock::time_point startup_begin_;  // initialize() entered
+    bool first_thumbnails_shown_ = false;
+
+    // Counters at the previous performance overlay sample (UI thread only)
+    struct PerfSample {
+        std::chrono::steady_clock::time_point time;
+        uint64_t completed = 0;
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+    };
+    PerfSample perf_sample_;
+
+    // Directory scan state (generation and flags are UI-thread only)
+    uint64_t scan_generation_ = 0;
+    std::chrono::steady_clock::time_point scan_started_;  // Traced as "directory scan"
+    bool scan_in_progress_ = false;
+    bool scan_streamed_ = false;    // Batches already shown for the current scan
+    bool scan_flattened_ = false;   // Current scan lists all subfolders (streams sorted)
+    bool scan_snapshot_ = false;    // A snapshot is shown while the current scan revalidates it
+    bool showing_similar_ = false;  // Listing holds findSimilarImages() groups
+    std::wstring library_query_;    // Query whose results are listed, if any
+    std::mutex scan_queue_mutex_;
+    std::queue<ScanUpdate> scan_updates_;
+    std::filesystem::path prefetch_path_;  // Folder prefetch_thread_ warms (UI thread only)
+
+    // Solid archive batch extraction (see startArchiveBatch)
+    std::mutex archive_batch_mutex_;
+    std::filesystem::path archive_batch_path_;
+    std::unordered_set<std::wstring> archive_batch_pending_;  // Entries not yet delivered
+
+    // Stamp of the listed archive, which keys its entries' thumbnails; queried
+    // once in loadArchive() instead of by every cache lookup (UI thread only)
+    std::filesystem::path archive_stamp_path_;
+    std::optional<cache::SourceStamp> archive_stamp_;
+
+    // Change notifications for the current and recently visited directories
+    std::mutex change_queue_mutex_;
+    std::vector<fs::DirectoryChanges> directory_changes_;
+
+    // Declared last so the workers are stopped and joined before the state they use is destroyed
+    std::jthread scan_thread_;
+    std::jthread archive_batch_thread_;
+    std::jthread warmup_thread_;  // Startup cache warm-up (see startWarmup)
+    std::jthread cache_move_thread_;  // See relocateCache
+    std::filesystem::path cache_move_target_;  // Of cache_move_thread_
+    std::jthread prefetch_thread_;  // Hover prefetch (see prefetchDirectory)
+    std::unique_ptr<fs::DirectoryWatcher> watcher_;
+    std::unique_ptr<MemoryPressureMonitor> memory_monitor_;  // Posts WM_MEMORY_LOW
 };
 
 }  // namespace nive::ui
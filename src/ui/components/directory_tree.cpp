@@ -8,16 +8,232 @@
 
 #include <CommCtrl.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include "core/archive/archive_manager.hpp"
 #include "core/fs/directory.hpp"
 #include "core/fs/file_metadata.hpp"
+#include "core/fs/natural_sort.hpp"
+#include "core/i18n/i18n.hpp"
 #include "dnd/drop_target.hpp"
 
 namespace nive::ui {
 
+namespace {
+
+// Children per batch sent to the UI thread while a node loads
+constexpr size_t kChildBatchSize = 256;
+
+/// @brief Find the sibling to insert a child after, keeping natural order
+/// @param siblings Children inserted so far, sorted by key
+/// @param key Natural sort key of the new child
+/// @param first Handle to insert after when the child sorts first
+[[nodiscard]] HTREEITEM insert_position(
+    const std::vector<std::pair<std::string, HTREEITEM>>& siblings, const std::string& key,
+    HTREEITEM first) {
+    auto it = std::lower_bound(siblings.begin(), siblings.end(), key,
+                               [](const auto& sibling, const std::string& k) {
+                                   return sibling.first < k;
+                               });
+    return it == siblings.begin() ? first : std::prev(it)->second;
+}
+
+/// @brief Read a drive's display name, e.g. "System (C:)"
+/// @note Blocks until the volume answers; for an offline network drive, the SMB timeout
+[[nodiscard]] std::wstring drive_label(const std::filesystem::path& drive) {
+    wchar_t volume_name[MAX_PATH] = {};
+    GetVolumeInformationW(drive.c_str(), volume_name, MAX_PATH, nullptr, nullptr, nullptr,
+                          nullptr, 0);
+
+    std::wstring letter = drive.wstring().substr(0, 2);
+    if (volume_name[0] != L'\0') {
+        return std::wstring(volume_name) + L" (" + letter + L")";
+    }
+    return L"Local Disk (" + letter + L")";
+}
+
+}  // namespace
+
+/// @brief Children, probe or drive label result delivered to the UI thread
+struct DirectoryTree::LoadResult {
+    enum class Kind { Batch, Done, Probe, Label } kind = Kind::Batch;
+    uint64_t id = 0;  // Load the result belongs to (Batch, Done)
+    HTREEITEM item = nullptr;
+    std::vector<std::filesystem::path> directories;  // Batch
+    std::vector<std::filesystem::path> archives;     // Batch
+    std::filesystem::path path;                      // Probe, Label
+    bool has_children = false;                       // Probe
+    std::wstring label;                              // Label
+};
+
+/// @brief Enumerates children on a background thread
+///
+/// Requests are served in order, loads before probes, so probing the
+/// children of one node never delays the expansion of another. Drive labels
+/// queue with the probes. Results are queued and the tree is posted
+/// kWmChildrenLoaded to collect them.
+class DirectoryTree::Loader {
+public:
+    explicit Loader(HWND hwnd) : hwnd_(hwnd) {
+        worker_ = std::jthread([this](std::stop_token stop) { run(stop); });
+    }
+
+    /// @brief Enumerate the children of a directory
+    /// @param archive Archive manager to detect archive files, or nullptr
+    void load(uint64_t id, HTREEITEM item, std::filesystem::path path,
+              const archive::ArchiveManager* archive, std::stop_token stop) {
+        {
+            std::lock_guard lock(mutex_);
+            loads_.push_back({id, item, std::move(path), archive, std::move(stop)});
+        }
+        cv_.notify_one();
+    }
+
+    /// @brief Check whether directories have children
+    void probe(std::vector<std::pair<HTREEITEM, std::filesystem::path>> items,
+               std::stop_token stop) {
+        {
+            std::lock_guard lock(mutex_);
+            for (auto& [item, path] : items) {
+                probes_.push_back({item, std::move(path), stop});
+            }
+        }
+        cv_.notify_one();
+    }
+
+    /// @brief Read the labels of drives that may be slow to answer
+    void label(std::vector<std::pair<HTREEITEM, std::filesystem::path>> items) {
+        {
+            std::lock_guard lock(mutex_);
+            for (auto& [item, path] : items) {
+                probes_.push_back({item, std::move(path), {}, true});
+            }
+        }
+        cv_.notify_one();
+    }
+
+    /// @brief Take the results delivered so far (UI thread)
+    [[nodiscard]] std::vector<LoadResult> takeResults() {
+        std::lock_guard lock(mutex_);
+        std::vector<LoadResult> results;
+        results.swap(results_);
+        return results;
+    }
+
+private:
+    struct LoadRequest {
+        uint64_t id = 0;
+        HTREEITEM item = nullptr;
+        std::filesystem::path path;
+        const archive::ArchiveManager* archive = nullptr;
+        std::stop_token stop;
+    };
+
+    struct ProbeRequest {
+        HTREEITEM item = nullptr;
+        std::filesystem::path path;
+        std::stop_token stop;
+        bool label = false;  // Read the drive label instead
+    };
+
+    void run(std::stop_token stop) {
+        for (;;) {
+            std::optional<LoadRequest> load;
+            std::optional<ProbeRequest> probe;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, stop, [this] { return !loads_.empty() || !probes_.empty(); });
+                if (stop.stop_requested()) {
+                    return;
+                }
+                if (!loads_.empty()) {
+                    load = std::move(loads_.front());
+                    loads_.pop_front();
+                } else {
+                    probe = std::move(probes_.front());
+                    probes_.pop_front();
+                }
+            }
+
+            if (load) {
+                enumerate(*load);
+            } else if (probe->label) {
+                LoadResult result{LoadResult::Kind::Label};
+                result.item = probe->item;
+                result.label = drive_label(probe->path);
+                result.path = std::move(probe->path);
+                post(std::move(result));
+            } else if (!probe->stop.stop_requested()) {
+                LoadResult result{LoadResult::Kind::Probe};
+                result.item = probe->item;
+                result.has_children = !fs::isDirectoryEmpty(probe->path);
+                result.path = std::move(probe->path);
+                post(std::move(result));
+            }
+        }
+    }
+
+    void enumerate(const LoadRequest& request) {
+        // Archives are listed even when hidden; directories are filtered
+        // below as fs::getSubdirectories() does
+        fs::DirectoryFilter filter;
+        filter.include_hidden = true;
+        filter.include_system = true;
+
+        auto on_chunk = [&](std::vector<fs::FileMetadata>& chunk) {
+            LoadResult batch{LoadResult::Kind::Batch, request.id, request.item};
+            for (auto& entry : chunk) {
+                if (entry.is_directory()) {
+                    if (!entry.attributes.is_hidden && !entry.attributes.is_system) {
+                        batch.directories.push_back(std::move(entry.path));
+                    }
+                } else if (request.archive && request.archive->isArchive(entry.path)) {
+                    batch.archives.push_back(std::move(entry.path));
+                }
+            }
+            if (!batch.directories.empty() || !batch.archives.empty()) {
+                post(std::move(batch));
+            }
+        };
+        (void)fs::enumerateDirectory(request.path, filter, on_chunk, request.stop,
+                                     kChildBatchSize);
+
+        post(LoadResult{LoadResult::Kind::Done, request.id, request.item});
+    }
+
+    void post(LoadResult result) {
+        bool first = false;
+        {
+            std::lock_guard lock(mutex_);
+            first = results_.empty();
+            results_.push_back(std::move(result));
+        }
+        // One message collects everything queued until it is handled
+        if (first) {
+            PostMessageW(hwnd_, kWmChildrenLoaded, 0, 0);
+        }
+    }
+
+    HWND hwnd_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::deque<LoadRequest> loads_;     // Guarded by mutex_
+    std::deque<ProbeRequest> probes_;   // Guarded by mutex_
+    std::vector<LoadResult> results_;   // Guarded by mutex_
+    std::jthread worker_;
+};
+
 DirectoryTree::DirectoryTree() = default;
 
 DirectoryTree::~DirectoryTree() {
+    // Stop enumerations first; the worker is joined before the window goes
+    cancelAllLoads();
+    loader_.reset();
     // Wait for any pending timer pool callback before removing subclass,
     // so the callback cannot PostMessage after our handler is gone.
     if (hover_expand_timer_) {
@@ -96,6 +312,8 @@ bool DirectoryTree::create(HWND parent, HINSTANCE hInstance, int id) {
         TreeView_SetImageList(hwnd_, image_list_, TVSIL_NORMAL);
     }
 
+    loader_ = std::make_unique<Loader>(hwnd_);
+
     // Subclass for hover tracking
     SetWindowSubclass(hwnd_, subclassProc, 0, reinterpret_cast<DWORD_PTR>(this));
     hover_brush_ = CreateSolidBrush(RGB(0xE5, 0xE5, 0xE5));
@@ -114,26 +332,26 @@ void DirectoryTree::initialize() {
 }
 
 void DirectoryTree::initialize(const std::vector<std::string>& network_shares) {
+    cancelAllLoads();
     TreeView_DeleteAllItems(hwnd_);
     item_paths_.clear();
     archive_items_.clear();
-
-    // Add drives
-    auto drives = fs::getDrives();
-    for (const auto& drive : drives) {
-        // Get volume label
-        wchar_t volume_name[MAX_PATH] = {};
-        GetVolumeInformationW(drive.c_str(), volume_name, MAX_PATH, nullptr, nullptr, nullptr,
-                              nullptr, 0);
-
-        std::wstring label = drive.wstring();
-        if (volume_name[0] != L'\0') {
-            label = std::wstring(volume_name) + L" (" + drive.wstring().substr(0, 2) + L")";
-        } else {
-            label = L"Local Disk (" + drive.wstring().substr(0, 2) + L")";
+    pending_select_.clear();
+
+    // Add drives. Fixed drives answer at once; network, removable and
+    // optical drives show their letter until the loader reads their label,
+    // so an offline server cannot hold up the window for the SMB timeout.
+    std::vector<std::pair<HTREEITEM, std::filesystem::path>> labels;
+    for (const auto& drive : fs::getDrives()) {
+        UINT type = GetDriveTypeW(drive.c_str());
+        if (type == DRIVE_FIXED || type == DRIVE_RAMDISK) {
+            addItem(TVI_ROOT, drive_label(drive), drive, true);
+        } else if (HTREEITEM item = addItem(TVI_ROOT, drive.wstring().substr(0, 2), drive, true)) {
+            labels.emplace_back(item, drive);
         }
-
-        addItem(TVI_ROOT, label, drive, true);
+    }
+    if (!labels.empty()) {
+        loader_->label(std::move(labels));
     }
 
     // Add network shares
@@ -168,18 +386,8 @@ void DirectoryTree::updateNetworkShares(const std::vector<std::string>& new_shar
         if (!new_set.contains(old_share)) {
             auto it = network_items_.find(old_share);
             if (it != network_items_.end()) {
-                // Clean up child item_paths_ entries
-                std::function<void(HTREEITEM)> removeChildren = [&](HTREEITEM parent) {
-                    HTREEITEM child = TreeView_GetChild(hwnd_, parent);
-                    while (child) {
-                        HTREEITEM next = TreeView_GetNextSibling(hwnd_, child);
-                        removeChildren(child);
-                        item_paths_.erase(child);
-                        archive_items_.erase(child);
-                        child = next;
-                    }
-                };
-                removeChildren(it->second);
+                removeChildItems(it->second);
+                cancelLoad(it->second);
                 item_paths_.erase(it->second);
                 TreeView_DeleteItem(hwnd_, it->second);
                 network_items_.erase(it);
@@ -204,10 +412,14 @@ void DirectoryTree::selectPath(const std::filesystem::path& path) {
     if (path.empty()) {
         return;
     }
+    pending_select_ = path;
+    continueSelect();
+}
 
+void DirectoryTree::continueSelect() {
     // Build path components
     std::vector<std::filesystem::path> components;
-    std::filesystem::path current = path;
+    std::filesystem::path current = pending_select_;
     while (current.has_parent_path() && current != current.root_path()) {
         components.push_back(current);
         current = current.parent_path();
@@ -217,21 +429,28 @@ void DirectoryTree::selectPath(const std::filesystem::path& path) {
     // Reverse to go from root to target
     std::reverse(components.begin(), components.end());
 
-    // Expand and select each level
+    // Expand each level; a level whose children are still loading is
+    // continued from onChildrenLoaded()
     HTREEITEM item = TreeView_GetRoot(hwnd_);
+    HTREEITEM parent = nullptr;
     for (const auto& component : components) {
-        item = findItem(item, component);
-        if (!item) {
-            break;
+        HTREEITEM found = findItem(item, component);
+        if (!found) {
+            auto it = parent ? loads_.find(parent) : loads_.end();
+            if (it == loads_.end() || !it->second.loading) {
+                pending_select_.clear();  // Not in the tree
+            }
+            return;
         }
 
-        TreeView_Expand(hwnd_, item, TVE_EXPAND);
+        TreeView_Expand(hwnd_, found, TVE_EXPAND);
+        item = found;
+        parent = found;
     }
 
-    if (item) {
-        TreeView_SelectItem(hwnd_, item);
-        TreeView_EnsureVisible(hwnd_, item);
-    }
+    pending_select_.clear();
+    TreeView_SelectItem(hwnd_, item);
+    TreeView_EnsureVisible(hwnd_, item);
 }
 
 std::filesystem::path DirectoryTree::selectedPath() const {
@@ -250,7 +469,10 @@ std::filesystem::path DirectoryTree::selectedPath() const {
 void DirectoryTree::refreshPath(const std::filesystem::path& path) {
     HTREEITEM item = findItem(TreeView_GetRoot(hwnd_), path);
     if (item) {
-        removeChildItems(item);
+        // Probe the children again too
+        std::erase_if(has_children_, [&path](const auto& entry) {
+            return std::filesystem::path(entry.first).parent_path() == path;
+        });
         populateChildren(item, path);
     }
 }
@@ -268,6 +490,7 @@ LRESULT CALLBACK DirectoryTree::subclassProc(HWND hwnd, UINT msg, WPARAM wParam,
             hit_item = nullptr;
         }
         self->updateHotItem(hit_item);
+        self->updateHoverItem(hit_item);
 
         // Register for WM_MOUSELEAVE
         TRACKMOUSEEVENT tme = {sizeof(tme), TME_LEAVE, hwnd, 0};
@@ -276,6 +499,13 @@ LRESULT CALLBACK DirectoryTree::subclassProc(HWND hwnd, UINT msg, WPARAM wParam,
     }
     case WM_MOUSELEAVE:
         self->updateHotItem(nullptr);
+        self->updateHoverItem(nullptr);
+        break;
+    case WM_TIMER:
+        if (wParam == kHoverTimerId) {
+            self->onHoverTimer();
+            return 0;
+        }
         break;
     case WM_LBUTTONDOWN:
         // Clear hover highlight before selection processing to prevent
@@ -285,6 +515,14 @@ LRESULT CALLBACK DirectoryTree::subclassProc(HWND hwnd, UINT msg, WPARAM wParam,
     case kWmHoverExpand:
         self->onHoverExpandTimer();
         return 0;
+    case kWmChildrenLoaded:
+        self->onChildrenLoaded();
+        return 0;
+    case DropTarget::kWmDeferredDrop:
+        if (self->drop_target_) {
+            self->drop_target_->processDeferredDrops();
+        }
+        return 0;
     }
 
     return DefSubclassProc(hwnd, msg, wParam, lParam);
@@ -321,6 +559,43 @@ void DirectoryTree::updateHotItem(HTREEITEM new_item) {
     }
 }
 
+void DirectoryTree::updateHoverItem(HTREEITEM new_item) {
+    if (hover_item_ == new_item) {
+        return;
+    }
+
+    // Moving on withdraws the previous item's prefetch
+    KillTimer(hwnd_, kHoverTimerId);
+    if (hover_reported_ && hover_callback_) {
+        hover_callback_({});
+    }
+    hover_item_ = new_item;
+    hover_reported_ = false;
+
+    if (hover_item_ && hover_callback_) {
+        SetTimer(hwnd_, kHoverTimerId, kHoverPrefetchDelayMs, nullptr);
+    }
+}
+
+void DirectoryTree::onHoverTimer() {
+    KillTimer(hwnd_, kHoverTimerId);
+    if (!hover_item_ || hover_reported_ || !hover_callback_) {
+        return;
+    }
+
+    // The item may have been removed since; archives are not listed by scanning
+    auto it = item_paths_.find(hover_item_);
+    if (it == item_paths_.end() || archive_items_.contains(hover_item_)) {
+        return;
+    }
+    // The selected folder is already listed
+    if (hover_item_ == TreeView_GetSelection(hwnd_)) {
+        return;
+    }
+    hover_reported_ = true;
+    hover_callback_(it->second);
+}
+
 void DirectoryTree::maybeAutoExpandOnHover(HTREEITEM item) {
     // Same item as before — nothing to do (timer is already running, or
     // we've already expanded it).
@@ -379,7 +654,8 @@ void DirectoryTree::onHoverExpandTimer() {
     }
 
     // Expand the item. TVN_ITEMEXPANDING is fired and routed through
-    // handleNotify() -> expandItem() -> populateChildren() for lazy loading.
+    // handleNotify() -> expandItem() -> populateChildren(), which starts
+    // loading the children in the background.
     TreeView_Expand(hwnd_, hover_expand_item_, TVE_EXPAND);
 }
 
@@ -396,6 +672,9 @@ LRESULT DirectoryTree::handleNotify(NMHDR* nmhdr) {
     switch (nmhdr->code) {
     case TVN_SELCHANGEDW: {
         auto* nmtv = reinterpret_cast<NMTREEVIEWW*>(nmhdr);
+        if (nmtv->action == TVC_BYMOUSE || nmtv->action == TVC_BYKEYBOARD) {
+            pending_select_.clear();  // The user's choice wins over selectPath()
+        }
         auto it = item_paths_.find(nmtv->itemNew.hItem);
         if (it != item_paths_.end() && selection_callback_) {
             selection_callback_(it->second);
@@ -468,10 +747,10 @@ HTREEITEM DirectoryTree::addItem(HTREEITEM parent, const std::wstring& text,
 
 HTREEITEM DirectoryTree::addItemWithIcon(HTREEITEM parent, const std::wstring& text,
                                          const std::filesystem::path& path, bool has_children,
-                                         int icon) {
+                                         int icon, HTREEITEM insert_after) {
     TVINSERTSTRUCTW tvis = {};
     tvis.hParent = parent;
-    tvis.hInsertAfter = TVI_LAST;
+    tvis.hInsertAfter = insert_after;
     tvis.item.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_CHILDREN;
     tvis.item.pszText = const_cast<wchar_t*>(text.c_str());
     tvis.item.cChildren = has_children ? 1 : 0;
@@ -487,14 +766,9 @@ HTREEITEM DirectoryTree::addItemWithIcon(HTREEITEM parent, const std::wstring& t
 }
 
 void DirectoryTree::expandItem(HTREEITEM item) {
-    // Check if already populated (has real children)
-    HTREEITEM child = TreeView_GetChild(hwnd_, item);
-    if (child) {
-        // Check if it's a dummy item
-        auto it = item_paths_.find(child);
-        if (it != item_paths_.end()) {
-            return;  // Already populated
-        }
+    // Loading or loaded since it was last collapsed
+    if (loads_.contains(item)) {
+        return;
     }
 
     auto it = item_paths_.find(item);
@@ -507,6 +781,7 @@ void DirectoryTree::expandItem(HTREEITEM item) {
 
 void DirectoryTree::collapseItem(HTREEITEM item) {
     removeChildItems(item);
+    cancelLoad(item);
 
     // Re-insert a dummy child so the [+] expand button remains visible
     TVINSERTSTRUCTW tvis = {};
@@ -523,6 +798,7 @@ void DirectoryTree::removeChildItems(HTREEITEM parent) {
         HTREEITEM next = TreeView_GetNextSibling(hwnd_, child);
         // Recursively clean up descendants first
         removeChildItems(child);
+        cancelLoad(child);
         item_paths_.erase(child);
         archive_items_.erase(child);
         TreeView_DeleteItem(hwnd_, child);
@@ -531,57 +807,180 @@ void DirectoryTree::removeChildItems(HTREEITEM parent) {
 }
 
 void DirectoryTree::populateChildren(HTREEITEM parent, const std::filesystem::path& path) {
-    // Remove dummy child if any
-    HTREEITEM dummy = TreeView_GetChild(hwnd_, parent);
-    if (dummy) {
-        auto it = item_paths_.find(dummy);
-        if (it == item_paths_.end()) {
-            TreeView_DeleteItem(hwnd_, dummy);
-        }
-    }
-
-    // Get subdirectories
-    auto result = fs::getSubdirectories(path, false);
-    bool has_any_children = result && !result->empty();
-
-    // Check for archive files
-    std::vector<std::filesystem::path> archives;
-    if (archive_ && archive_->isAvailable()) {
-        std::error_code ec;
-        for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
-            if (!ec && entry.is_regular_file() && archive_->isArchive(entry.path())) {
-                archives.push_back(entry.path());
-            }
+    // Replaces the dummy child, or the children of a refreshed item
+    removeChildItems(parent);
+    cancelLoad(parent);
+
+    ChildLoad load;
+    load.id = ++next_load_id_;
+
+    // Shown until the first children arrive
+    TVINSERTSTRUCTW tvis = {};
+    tvis.hParent = parent;
+    tvis.hInsertAfter = TVI_LAST;
+    tvis.item.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
+    tvis.item.pszText = const_cast<wchar_t*>(i18n::tr("tree.loading").c_str());
+    tvis.item.iImage = icon_folder_;
+    tvis.item.iSelectedImage = icon_folder_;
+    load.loading = TreeView_InsertItem(hwnd_, &tvis);
+
+    const archive::ArchiveManager* archive =
+        (archive_ && archive_->isAvailable()) ? archive_ : nullptr;
+    loader_->load(load.id, parent, path, archive, load.stop.get_token());
+    loads_.insert_or_assign(parent, std::move(load));
+}
+
+void DirectoryTree::cancelLoad(HTREEITEM item) {
+    auto it = loads_.find(item);
+    if (it != loads_.end()) {
+        it->second.stop.request_stop();
+        loads_.erase(it);
+    }
+}
+
+void DirectoryTree::cancelAllLoads() {
+    for (auto& [item, load] : loads_) {
+        load.stop.request_stop();
+    }
+    loads_.clear();
+}
+
+void DirectoryTree::onChildrenLoaded() {
+    if (!loader_) {
+        return;
+    }
+    for (auto& result : loader_->takeResults()) {
+        switch (result.kind) {
+        case LoadResult::Kind::Batch:
+            addLoadedChildren(result);
+            break;
+        case LoadResult::Kind::Done:
+            finishLoad(result.item, result.id);
+            break;
+        case LoadResult::Kind::Probe:
+            setHasChildren(result.item, result.path, result.has_children);
+            break;
+        case LoadResult::Kind::Label:
+            setLabel(result.item, result.path, result.label);
+            break;
         }
-        has_any_children = has_any_children || !archives.empty();
     }
 
-    if (!has_any_children) {
+    if (!pending_select_.empty()) {
+        continueSelect();
+    }
+}
+
+void DirectoryTree::addLoadedChildren(LoadResult& result) {
+    auto it = loads_.find(result.item);
+    if (it == loads_.end() || it->second.id != result.id) {
+        return;  // Collapsed or reloaded since
+    }
+    auto& load = it->second;
+    load.any = true;
+
+    std::vector<std::pair<HTREEITEM, std::filesystem::path>> probes;
+    for (auto& directory : result.directories) {
+        auto name = directory.filename().wstring();
+        auto key = fs::naturalSortKey(name);
+
+        // Until probed, a folder shows [+]; expanding an empty one clears it
+        auto cached = has_children_.find(directory.wstring());
+        bool has_children = cached == has_children_.end() || cached->second;
+
+        HTREEITEM after = insert_position(load.directories, key, TVI_FIRST);
+        HTREEITEM child = addItemWithIcon(result.item, name, directory, has_children,
+                                          icon_folder_, after);
+        if (!child) {
+            continue;
+        }
+        auto position = std::upper_bound(
+            load.directories.begin(), load.directories.end(), key,
+            [](const std::string& k, const auto& sibling) { return k < sibling.first; });
+        load.directories.insert(position, {std::move(key), child});
+        if (cached == has_children_.end()) {
+            probes.emplace_back(child, std::move(directory));
+        }
+    }
+
+    // Archive files are non-expandable leaves after the directories
+    for (const auto& archive_path : result.archives) {
+        auto name = archive_path.filename().wstring();
+        auto key = fs::naturalSortKey(name);
+        HTREEITEM first = load.directories.empty() ? TVI_FIRST : load.directories.back().second;
+        HTREEITEM after = insert_position(load.archives, key, first);
+        HTREEITEM child = addItemWithIcon(result.item, name, archive_path, false, icon_archive_,
+                                          after);
+        if (!child) {
+            continue;
+        }
+        archive_items_.insert(child);
+        auto position = std::upper_bound(
+            load.archives.begin(), load.archives.end(), key,
+            [](const std::string& k, const auto& sibling) { return k < sibling.first; });
+        load.archives.insert(position, {std::move(key), child});
+    }
+
+    if (!probes.empty()) {
+        loader_->probe(std::move(probes), load.stop.get_token());
+    }
+}
+
+void DirectoryTree::finishLoad(HTREEITEM item, uint64_t id) {
+    auto it = loads_.find(item);
+    if (it == loads_.end() || it->second.id != id) {
+        return;
+    }
+    auto& load = it->second;
+    if (load.loading) {
+        TreeView_DeleteItem(hwnd_, load.loading);
+        load.loading = nullptr;
+    }
+    // Nothing else is inserted for this load
+    load.directories = {};
+    load.archives = {};
+
+    if (auto path = item_paths_.find(item); path != item_paths_.end()) {
+        has_children_[path->second.wstring()] = load.any;
+    }
+    if (!load.any) {
         // No children - update item
         TVITEMW tvi = {};
-        tvi.hItem = parent;
+        tvi.hItem = item;
         tvi.mask = TVIF_CHILDREN;
         tvi.cChildren = 0;
         TreeView_SetItem(hwnd_, &tvi);
-        return;
     }
+}
 
-    // Add subdirectories
-    if (result) {
-        for (const auto& subdir : *result) {
-            bool has_children = !fs::isDirectoryEmpty(subdir);
-            addItem(parent, subdir.filename().wstring(), subdir, has_children);
-        }
+void DirectoryTree::setHasChildren(HTREEITEM item, const std::filesystem::path& path,
+                                   bool has_children) {
+    has_children_[path.wstring()] = has_children;
+
+    // The item may have been removed (and its handle reused) since
+    auto it = item_paths_.find(item);
+    if (it == item_paths_.end() || it->second != path || has_children) {
+        return;
     }
+    TVITEMW tvi = {};
+    tvi.hItem = item;
+    tvi.mask = TVIF_CHILDREN;
+    tvi.cChildren = 0;
+    TreeView_SetItem(hwnd_, &tvi);
+}
 
-    // Add archive files (non-expandable leaf nodes)
-    for (const auto& archive_path : archives) {
-        auto name = archive_path.filename().wstring();
-        HTREEITEM item = addItemWithIcon(parent, name, archive_path, false, icon_archive_);
-        if (item) {
-            archive_items_.insert(item);
-        }
+void DirectoryTree::setLabel(HTREEITEM item, const std::filesystem::path& path,
+                             std::wstring& label) {
+    // The tree may have been rebuilt (and the handle reused) since
+    auto it = item_paths_.find(item);
+    if (it == item_paths_.end() || it->second != path) {
+        return;
     }
+    TVITEMW tvi = {};
+    tvi.hItem = item;
+    tvi.mask = TVIF_TEXT;
+    tvi.pszText = label.data();
+    TreeView_SetItem(hwnd_, &tvi);
 }
 
 HTREEITEM DirectoryTree::findItem(HTREEITEM start, const std::filesystem::path& path) {
@@ -7,12 +7,15 @@
 
 #include <CommCtrl.h>
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <stop_token>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace nive::archive {
@@ -27,10 +30,15 @@ namespace nive::ui {
 
 /// @brief Directory tree view component
 ///
-/// Wraps a Win32 TreeView control for directory navigation.
+/// Wraps a Win32 TreeView control for directory navigation. Children are
+/// enumerated on a background thread when a node is expanded: a "loading"
+/// child is shown at once and the children are filled in, in natural order,
+/// as batches arrive. Whether a child folder has children of its own is
+/// probed in the background too, and remembered.
 class DirectoryTree {
 public:
     using SelectionCallback = std::function<void(const std::filesystem::path&)>;
+    using HoverCallback = std::function<void(const std::filesystem::path&)>;
     using FileDropCallback =
         std::function<void(const std::vector<std::filesystem::path>& files,
                            const std::filesystem::path& dest_path, DWORD effect)>;
@@ -66,6 +74,8 @@ public:
     void setArchiveManager(archive::ArchiveManager* archive);
 
     /// @brief Select and expand path
+    ///
+    /// Levels that are still loading are expanded as their children arrive.
     void selectPath(const std::filesystem::path& path);
 
     /// @brief Get currently selected path
@@ -83,6 +93,14 @@ public:
         selection_callback_ = std::move(callback);
     }
 
+    /// @brief Set hover callback, for speculative prefetch of a folder
+    ///
+    /// Called with an item's path once the mouse has rested on it for
+    /// kHoverPrefetchDelayMs, and with an empty path when the mouse then
+    /// moves to another item or leaves the tree. Pressing the button does
+    /// not count as moving on, so a prefetch runs into the navigation.
+    void onHover(HoverCallback callback) { hover_callback_ = std::move(callback); }
+
     /// @brief Set file drop callback
     void onFileDrop(FileDropCallback callback) { file_drop_callback_ = std::move(callback); }
 
@@ -95,14 +113,37 @@ public:
     LRESULT handleNotify(NMHDR* nmhdr);
 
 private:
+    class Loader;
+    struct LoadResult;
+
+    /// @brief Children being (or done being) loaded for an expanded item
+    struct ChildLoad {
+        uint64_t id = 0;
+        std::stop_source stop;
+        HTREEITEM loading = nullptr;  // Placeholder child, until the load is done
+        bool any = false;
+        // Inserted children by natural sort key, to place the next batch
+        std::vector<std::pair<std::string, HTREEITEM>> directories;
+        std::vector<std::pair<std::string, HTREEITEM>> archives;
+    };
+
     HTREEITEM addItem(HTREEITEM parent, const std::wstring& text, const std::filesystem::path& path,
                       bool has_children);
     HTREEITEM addItemWithIcon(HTREEITEM parent, const std::wstring& text,
-                              const std::filesystem::path& path, bool has_children, int icon);
+                              const std::filesystem::path& path, bool has_children, int icon,
+                              HTREEITEM insert_after = TVI_LAST);
     void expandItem(HTREEITEM item);
     void collapseItem(HTREEITEM item);
     void removeChildItems(HTREEITEM parent);
     void populateChildren(HTREEITEM parent, const std::filesystem::path& path);
+    void cancelLoad(HTREEITEM item);
+    void cancelAllLoads();
+    void onChildrenLoaded();
+    void addLoadedChildren(LoadResult& result);
+    void finishLoad(HTREEITEM item, uint64_t id);
+    void setHasChildren(HTREEITEM item, const std::filesystem::path& path, bool has_children);
+    void setLabel(HTREEITEM item, const std::filesystem::path& path, std::wstring& label);
+    void continueSelect();
     HTREEITEM findItem(HTREEITEM start, const std::filesystem::path& path);
     void addNetworkShares(const std::vector<std::string>& shares);
 
@@ -113,6 +154,8 @@ private:
     static LRESULT CALLBACK subclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam,
                                          UINT_PTR subclass_id, DWORD_PTR ref_data);
     void updateHotItem(HTREEITEM new_item);
+    void updateHoverItem(HTREEITEM new_item);
+    void onHoverTimer();
 
     // Drag-hover auto-expand support (Explorer-like behavior)
     void maybeAutoExpandOnHover(HTREEITEM item);
@@ -121,13 +164,20 @@ private:
     static void CALLBACK hoverExpandTimerCallback(PVOID param, BOOLEAN timer_or_wait_fired);
 
     static constexpr UINT kWmHoverExpand = WM_APP + 42;
+    static constexpr UINT kWmChildrenLoaded = WM_APP + 43;
     static constexpr DWORD kDragHoverExpandDelayMs = 2500;
+    static constexpr UINT_PTR kHoverTimerId = 0x4E49;  // Clear of the control's own timers
+    static constexpr UINT kHoverPrefetchDelayMs = 300;
 
     HWND hwnd_ = nullptr;
     HIMAGELIST image_list_ = nullptr;
     HTREEITEM hot_item_ = nullptr;
     HBRUSH hover_brush_ = nullptr;
 
+    // Hover prefetch state: the item under the mouse, and whether it was reported
+    HTREEITEM hover_item_ = nullptr;
+    bool hover_reported_ = false;
+
     // Drag-hover auto-expand state
     HTREEITEM hover_expand_item_ = nullptr;
     bool hover_expand_triggered_ = false;
@@ -136,7 +186,15 @@ private:
     std::unordered_map<HTREEITEM, std::filesystem::path> item_paths_;
     std::unordered_set<HTREEITEM> archive_items_;
     std::unordered_map<std::string, HTREEITEM> network_items_;
+
+    // Background child enumeration
+    std::unique_ptr<Loader> loader_;
+    std::unordered_map<HTREEITEM, ChildLoad> loads_;
+    std::unordered_map<std::wstring, bool> has_children_;  // Probe results by path
+    uint64_t next_load_id_ = 0;
+    std::filesystem::path pending_select_;  // selectPath() target still loading
     SelectionCallback selection_callback_;
+    HoverCallback hover_callback_;
     FileDropCallback file_drop_callback_;
 
     archive::ArchiveManager* archive_ = nullptr;
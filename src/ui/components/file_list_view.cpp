@@ -3,8 +3,10 @@
 
 #include "file_list_view.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <format>
+#include <optional>
 
 #include "core/i18n/i18n.hpp"
 
@@ -16,7 +18,7 @@ FileListView::~FileListView() = default;
 bool FileListView::create(HWND parent, HINSTANCE hInstance, int id) {
     hwnd_ = CreateWindowExW(0, WC_LISTVIEWW, nullptr,
                             WS_CHILD | WS_VISIBLE | WS_BORDER | WS_TABSTOP | LVS_REPORT |
-                                LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS,
+                                LVS_OWNERDATA | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS,
                             0, 0, 100, 100, parent,
                             reinterpret_cast<HMENU>(static_cast<intptr_t>(id)), hInstance, nullptr);
 
@@ -43,40 +45,131 @@ void FileListView::setBounds(int x, int y, int width, int height) {
     }
 }
 
-void FileListView::setItems(const std::vector<fs::FileMetadata>& items) {
-    items_ = items;
-    populateItems();
+void FileListView::setItems(std::shared_ptr<const fs::DirectoryModel> items) {
+    items_ = std::move(items);
+    rows_.clear();
+    indexRows(0);
+
+    // Keep resolutions for files still listed (re-sorts, appends); drop the rest
+    std::erase_if(resolutions_,
+                  [this](const auto& entry) { return !rows_.contains(entry.first); });
+
+    // Rows are served from items_ on demand; the control only holds the count
+    ListView_SetItemState(hwnd_, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+    ListView_SetItemCountEx(hwnd_, static_cast<int>(items_->size()), 0);
+    InvalidateRect(hwnd_, nullptr, TRUE);
+}
+
+void FileListView::appendItems(std::shared_ptr<const fs::DirectoryModel> items) {
+    if (items->size() <= items_->size()) {
+        return;
+    }
+    size_t first = items_->size();
+    items_ = std::move(items);
+    indexRows(first);
+    ListView_SetItemCountEx(hwnd_, static_cast<int>(items_->size()),
+                            LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+}
+
+void FileListView::patchItems(std::shared_ptr<const fs::DirectoryModel> items,
+                              const fs::ModelDelta* delta) {
+    if (!delta) {
+        setItems(std::move(items));
+        return;
+    }
+
+    fs::IndexSet selected = selectedIndices().mapped(*delta);
+    std::optional<size_t> focused;
+    if (int index = ListView_GetNextItem(hwnd_, -1, LVNI_FOCUSED); index >= 0) {
+        focused = delta->map(static_cast<size_t>(index));
+    }
+
+    // Removed files are no longer indexed; rewritten ones may have a new resolution
+    for (const auto& range : delta->removed) {
+        for (size_t i = range.first; i < range.first + range.count; ++i) {
+            PathId key = (*items_)[i].sourceId();
+            resolutions_.erase(key);
+            rows_.erase(key);
+        }
+    }
+    for (const auto& range : delta->updated) {
+        for (size_t i = range.first; i < range.first + range.count; ++i) {
+            resolutions_.erase((*items)[i].sourceId());
+        }
+    }
+
+    size_t first = items->size();
+    if (!delta->removed.empty()) {
+        first = (std::min)(first, delta->removed.front().first);
+    }
+    if (!delta->inserted.empty()) {
+        first = (std::min)(first, delta->inserted.front().first);
+    }
+    size_t previous_size = items_->size();
+    items_ = std::move(items);
+    indexRows((std::min)(first, items_->size()));
+
+    if (first < (std::max)(previous_size, items_->size())) {
+        ListView_SetItemCountEx(hwnd_, static_cast<int>(items_->size()),
+                                LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+        ListView_SetItemState(hwnd_, -1, 0, LVIS_FOCUSED);
+        applySelection(selected);
+        if (focused) {
+            ListView_SetItemState(hwnd_, static_cast<int>(*focused), LVIS_FOCUSED, LVIS_FOCUSED);
+        }
+        if (!items_->empty() && first < items_->size()) {
+            ListView_RedrawItems(hwnd_, static_cast<int>(first),
+                                 static_cast<int>(items_->size() - 1));
+        }
+    }
+    for (const auto& range : delta->updated) {
+        ListView_RedrawItems(hwnd_, static_cast<int>(range.first),
+                             static_cast<int>(range.first + range.count - 1));
+    }
 }
 
-std::vector<size_t> FileListView::selectedIndices() const {
-    std::vector<size_t> result;
+fs::IndexSet FileListView::selectedIndices() const {
+    // Select-all is common on large folders and needs no walk
+    auto count = static_cast<size_t>(ListView_GetSelectedCount(hwnd_));
+    if (count != 0 && count == items_->size()) {
+        return fs::IndexSet::all(count);
+    }
+    fs::IndexSet result;
     int index = -1;
     while ((index = ListView_GetNextItem(hwnd_, index, LVNI_SELECTED)) != -1) {
-        result.push_back(static_cast<size_t>(index));
+        result.insert(static_cast<size_t>(index));
     }
     return result;
 }
 
-void FileListView::setSelection(const std::vector<size_t>& indices) {
-    // Clear all selection and focus first
-    ListView_SetItemState(hwnd_, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+void FileListView::setSelection(const fs::IndexSet& indices) {
+    // Clear focus first
+    ListView_SetItemState(hwnd_, -1, 0, LVIS_FOCUSED);
+    applySelection(indices);
 
-    // Set new selection
-    for (size_t idx : indices) {
-        if (idx < items_.size()) {
-            ListView_SetItemState(hwnd_, static_cast<int>(idx), LVIS_SELECTED, LVIS_SELECTED);
-        }
+    // Set keyboard focus on the first selected item
+    if (auto first = indices.first(); first && *first < items_->size()) {
+        ListView_SetItemState(hwnd_, static_cast<int>(*first), LVIS_FOCUSED, LVIS_FOCUSED);
     }
+}
 
-    // Set keyboard focus on the first selected item
-    if (!indices.empty() && indices.front() < items_.size()) {
-        ListView_SetItemState(hwnd_, static_cast<int>(indices.front()),
-                              LVIS_FOCUSED, LVIS_FOCUSED);
+void FileListView::applySelection(const fs::IndexSet& indices) {
+    // Index -1 sets every item at once, as the owner-data control stores ranges
+    if (indices.count() == items_->size() && !indices.empty()) {
+        ListView_SetItemState(hwnd_, -1, LVIS_SELECTED, LVIS_SELECTED);
+        return;
+    }
+    ListView_SetItemState(hwnd_, -1, 0, LVIS_SELECTED);
+    for (size_t index : indices) {
+        if (index >= items_->size()) {
+            break;
+        }
+        ListView_SetItemState(hwnd_, static_cast<int>(index), LVIS_SELECTED, LVIS_SELECTED);
     }
 }
 
 void FileListView::selectSingle(size_t index) {
-    if (index < items_.size()) {
+    if (index < items_->size()) {
         ListView_SetItemState(hwnd_, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
         ListView_SetItemState(hwnd_, static_cast<int>(index), LVIS_SELECTED | LVIS_FOCUSED,
                               LVIS_SELECTED | LVIS_FOCUSED);
@@ -88,7 +181,7 @@ void FileListView::clearSelection() {
 }
 
 void FileListView::ensureVisible(size_t index) {
-    if (index < items_.size()) {
+    if (index < items_->size()) {
         ListView_EnsureVisible(hwnd_, static_cast<int>(index), FALSE);
     }
 }
@@ -122,27 +215,40 @@ void FileListView::setColumnWidths(const std::array<int, 5>& widths) {
 std::vector<std::filesystem::path> FileListView::selectedFilePaths() const {
     std::vector<std::filesystem::path> paths;
     auto indices = selectedIndices();
-    for (auto i : indices) {
-        if (i < items_.size() && !items_[i].is_in_archive()) {
-            paths.push_back(items_[i].path);
+    paths.reserve(indices.count());
+    for (size_t i : indices) {
+        if (i < items_->size() && !(*items_)[i].is_in_archive()) {
+            paths.push_back((*items_)[i].path());
         }
     }
     return paths;
 }
 
-void FileListView::setResolution(const std::filesystem::path& path, uint32_t width,
-                                  uint32_t height) {
-    if (!hwnd_ || width == 0 || height == 0) {
+void FileListView::setResolution(PathId id, uint32_t width, uint32_t height) {
+    if (!hwnd_ || id == kNoPathId || width == 0 || height == 0) {
+        return;
+    }
+
+    resolutions_[id] = Resolution{width, height};
+    if (auto it = rows_.find(id); it != rows_.end()) {
+        ListView_RedrawItems(hwnd_, static_cast<int>(it->second), static_cast<int>(it->second));
+    }
+}
+
+void FileListView::setResolutions(
+    const std::vector<std::pair<std::filesystem::path, Resolution>>& resolutions) {
+    if (!hwnd_ || resolutions.empty()) {
         return;
     }
 
-    std::wstring key = path.wstring();
-    for (size_t i = 0; i < items_.size(); ++i) {
-        if (items_[i].sourceIdentifier() == key) {
-            auto text = formatResolution(width, height);
-            ListView_SetItemText(hwnd_, static_cast<int>(i), 3,
-                                 const_cast<LPWSTR>(text.c_str()));
-            return;
+    for (const auto& [path, resolution] : resolutions) {
+        if (resolution.width == 0 || resolution.height == 0) {
+            continue;
+        }
+        auto [entry, inserted] = resolutions_.insert_or_assign(internPath(path), resolution);
+        if (auto it = rows_.find(entry->first); it != rows_.end()) {
+            ListView_RedrawItems(hwnd_, static_cast<int>(it->second),
+                                 static_cast<int>(it->second));
         }
     }
 }
@@ -151,8 +257,35 @@ void FileListView::refresh() {
     InvalidateRect(hwnd_, nullptr, TRUE);
 }
 
-bool FileListView::handleNotify(NMHDR* nmhdr) {
+LRESULT FileListView::handleNotify(NMHDR* nmhdr) {
     switch (nmhdr->code) {
+    case LVN_GETDISPINFOW: {
+        // Owner-data: the control asks for the text of each visible cell
+        auto* info = reinterpret_cast<NMLVDISPINFOW*>(nmhdr);
+        auto& item = info->item;
+        if ((item.mask & LVIF_TEXT) && item.pszText && item.cchTextMax > 0 && item.iItem >= 0) {
+            auto text = cellText(static_cast<size_t>(item.iItem), item.iSubItem);
+            wcsncpy_s(item.pszText, item.cchTextMax, text.c_str(), _TRUNCATE);
+        }
+        return 0;
+    }
+
+    case LVN_ODFINDITEMW: {
+        // Type-ahead search; the control cannot search rows it does not hold
+        auto* find = reinterpret_cast<NMLVFINDITEMW*>(nmhdr);
+        return findItem(find->lvfi, find->iStart);
+    }
+
+    case LVN_ODSTATECHANGED: {
+        // Sent instead of LVN_ITEMCHANGED for a range of rows (shift-click)
+        auto* state = reinterpret_cast<NMLVODSTATECHANGE*>(nmhdr);
+        if (((state->uNewState ^ state->uOldState) & LVIS_SELECTED) &&
+            selection_changed_callback_) {
+            selection_changed_callback_(selectedIndices());
+        }
+        return 0;
+    }
+
     case NM_SETFOCUS:
         // The native ListView sends NM_SETFOCUS through WM_NOTIFY whenever
         // it gains keyboard focus. Relay this to the parent so it can
@@ -160,14 +293,14 @@ bool FileListView::handleNotify(NMHDR* nmhdr) {
         if (focus_received_callback_) {
             focus_received_callback_();
         }
-        return true;
+        return 0;
 
     case NM_DBLCLK: {
         auto* nmia = reinterpret_cast<NMITEMACTIVATE*>(nmhdr);
         if (nmia->iItem >= 0 && item_activated_callback_) {
             item_activated_callback_(static_cast<size_t>(nmia->iItem));
         }
-        return true;
+        return 0;
     }
 
     case LVN_ITEMCHANGED: {
@@ -178,7 +311,7 @@ bool FileListView::handleNotify(NMHDR* nmhdr) {
                 selection_changed_callback_(selectedIndices());
             }
         }
-        return true;
+        return 0;
     }
 
     case LVN_COLUMNCLICK: {
@@ -190,15 +323,15 @@ bool FileListView::handleNotify(NMHDR* nmhdr) {
         if (sort_changed_callback_) {
             sort_changed_callback_(column, ascending);
         }
-        return true;
+        return 0;
     }
 
     case NM_RETURN: {
-        auto indices = selectedIndices();
-        if (!indices.empty() && item_activated_callback_) {
-            item_activated_callback_(indices[0]);
+        auto first = ListView_GetNextItem(hwnd_, -1, LVNI_SELECTED);
+        if (first != -1 && item_activated_callback_) {
+            item_activated_callback_(static_cast<size_t>(first));
         }
-        return true;
+        return 0;
     }
 
     case LVN_KEYDOWN: {
@@ -209,11 +342,11 @@ bool FileListView::handleNotify(NMHDR* nmhdr) {
                 delete_requested_callback_(paths);
             }
         }
-        return true;
+        return 0;
     }
     }
 
-    return false;
+    return 0;
 }
 
 void FileListView::createColumns() {
@@ -252,73 +385,63 @@ void FileListView::createColumns() {
     ListView_InsertColumn(hwnd_, 4, &lvc);
 }
 
-void FileListView::populateItems() {
-    // Disable redraw during population
-    SendMessageW(hwnd_, WM_SETREDRAW, FALSE, 0);
-
-    ListView_DeleteAllItems(hwnd_);
-
-    LVITEMW lvi = {};
-    lvi.mask = LVIF_TEXT;
-
-    for (size_t i = 0; i < items_.size(); ++i) {
-        const auto& item = items_[i];
-
-        // Name
-        lvi.iItem = static_cast<int>(i);
-        lvi.iSubItem = 0;
-        lvi.pszText = const_cast<LPWSTR>(item.name.c_str());
-        ListView_InsertItem(hwnd_, &lvi);
-
-        // Size
-        auto size_str =
-            item.is_directory() ? std::wstring(i18n::tr("filelist.column.placeholder"))
-                                : formatSize(item.size_bytes);
-        ListView_SetItemText(hwnd_, static_cast<int>(i), 1, const_cast<LPWSTR>(size_str.c_str()));
-
-        // Date
-        auto date_str = formatDate(item.modified_time);
-        ListView_SetItemText(hwnd_, static_cast<int>(i), 2, const_cast<LPWSTR>(date_str.c_str()));
-
-        // Resolution (not available in FileMetadata)
-        ListView_SetItemText(hwnd_, static_cast<int>(i), 3,
-                             const_cast<LPWSTR>(i18n::tr("filelist.column.placeholder").c_str()));
-
-        // Path (archive internal directory)
-        auto path_str = formatArchivePath(item);
-        ListView_SetItemText(hwnd_, static_cast<int>(i), 4, const_cast<LPWSTR>(path_str.c_str()));
+void FileListView::indexRows(size_t first) {
+    rows_.reserve(items_->size());
+    for (size_t i = first; i < items_->size(); ++i) {
+        rows_.insert_or_assign((*items_)[i].sourceId(), i);
     }
-
-    // Re-enable redraw
-    SendMessageW(hwnd_, WM_SETREDRAW, TRUE, 0);
-    InvalidateRect(hwnd_, nullptr, TRUE);
 }
 
-void FileListView::updateItem(size_t index) {
-    if (index >= items_.size()) {
-        return;
+std::wstring FileListView::cellText(size_t index, int column) const {
+    if (index >= items_->size()) {
+        return {};
     }
+    auto item = (*items_)[index];
+
+    switch (static_cast<FileListColumn>(column)) {
+    case FileListColumn::Name:
+        return std::wstring(item.name());
+    case FileListColumn::Size:
+        return item.is_directory() ? std::wstring(i18n::tr("filelist.column.placeholder"))
+                                   : formatSize(item.size_bytes());
+    case FileListColumn::Date:
+        return formatDate(item.modified_time());
+    case FileListColumn::Resolution:
+        // From the thumbnail cache, when known
+        return resolutionText(item);
+    case FileListColumn::Path:
+        // Archive internal directory
+        return formatArchivePath(item);
+    }
+    return {};
+}
 
-    const auto& item = items_[index];
-    int i = static_cast<int>(index);
-
-    ListView_SetItemText(hwnd_, i, 0, const_cast<LPWSTR>(item.name.c_str()));
-
-    auto size_str = item.is_directory()
-                        ? std::wstring(i18n::tr("filelist.column.placeholder"))
-                        : formatSize(item.size_bytes);
-    ListView_SetItemText(hwnd_, i, 1, const_cast<LPWSTR>(size_str.c_str()));
-
-    auto date_str = formatDate(item.modified_time);
-    ListView_SetItemText(hwnd_, i, 2, const_cast<LPWSTR>(date_str.c_str()));
-
-    // Resolution (not available in FileMetadata)
-    ListView_SetItemText(hwnd_, i, 3,
-                         const_cast<LPWSTR>(i18n::tr("filelist.column.placeholder").c_str()));
+int FileListView::findItem(const LVFINDINFOW& find, int start) const {
+    if (!(find.flags & (LVFI_STRING | LVFI_PARTIAL)) || !find.psz || items_->empty()) {
+        return -1;
+    }
 
-    // Path (archive internal directory)
-    auto path_str = formatArchivePath(item);
-    ListView_SetItemText(hwnd_, i, 4, const_cast<LPWSTR>(path_str.c_str()));
+    std::wstring_view needle(find.psz);
+    bool partial = (find.flags & LVFI_PARTIAL) != 0;
+    auto count = static_cast<int>(items_->size());
+    int first = (start >= 0 && start < count) ? start : 0;
+    int limit = (find.flags & LVFI_WRAP) ? count : count - first;
+
+    for (int n = 0; n < limit; ++n) {
+        int i = (first + n) % count;
+        auto name = (*items_)[static_cast<size_t>(i)].name();
+        if (partial) {
+            if (name.size() < needle.size()) {
+                continue;
+            }
+            name = name.substr(0, needle.size());
+        }
+        if (CompareStringOrdinal(name.data(), static_cast<int>(name.size()), needle.data(),
+                                 static_cast<int>(needle.size()), TRUE) == CSTR_EQUAL) {
+            return i;
+        }
+    }
+    return -1;
 }
 
 std::wstring FileListView::formatSize(uint64_t size) {
@@ -348,12 +471,20 @@ std::wstring FileListView::formatResolution(uint32_t width, uint32_t height) {
     return std::format(L"{}x{}", width, height);
 }
 
-std::wstring FileListView::formatArchivePath(const fs::FileMetadata& item) {
+std::wstring FileListView::resolutionText(const fs::DirectoryModel::Row& item) const {
+    auto it = resolutions_.find(item.sourceId());
+    if (it == resolutions_.end()) {
+        return std::wstring(i18n::tr("filelist.column.placeholder"));
+    }
+    return formatResolution(it->second.width, it->second.height);
+}
+
+std::wstring FileListView::formatArchivePath(const fs::DirectoryModel::Row& item) {
     const auto& placeholder = i18n::tr("filelist.column.placeholder");
     if (!item.is_in_archive()) {
         return std::wstring(placeholder);
     }
-    auto parent = std::filesystem::path(item.virtual_path->internal_path()).parent_path();
+    auto parent = std::filesystem::path(item.virtual_path()->internal_path()).parent_path();
     auto result = parent.wstring();
     return result.empty() ? std::wstring(placeholder) : result;
 }
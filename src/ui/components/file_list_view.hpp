@@ -9,9 +9,14 @@
 
 #include <array>
 #include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "core/fs/directory_model.hpp"
 #include "core/fs/file_metadata.hpp"
+#include "core/fs/index_set.hpp"
 
 namespace nive::ui {
 
@@ -27,10 +32,12 @@ enum class FileListColumn {
 /// @brief File list view component
 ///
 /// Win32 ListView control in report (details) mode showing file information.
+/// The control is owner-data (LVS_OWNERDATA): it holds only the row count and
+/// asks for the text of visible cells, which is formatted from the model.
 class FileListView {
 public:
     using ItemActivatedCallback = std::function<void(size_t index)>;
-    using SelectionChangedCallback = std::function<void(const std::vector<size_t>&)>;
+    using SelectionChangedCallback = std::function<void(const fs::IndexSet&)>;
     using SortChangedCallback = std::function<void(FileListColumn column, bool ascending)>;
     using DeleteRequestedCallback = std::function<void(const std::vector<std::filesystem::path>&)>;
     using FocusReceivedCallback = std::function<void()>;
@@ -51,16 +58,31 @@ public:
     void setBounds(int x, int y, int width, int height);
 
     /// @brief Set items to display
-    void setItems(const std::vector<fs::FileMetadata>& items);
+    /// @param items Listing to show; shared with the state, not copied
+    void setItems(std::shared_ptr<const fs::DirectoryModel> items);
+
+    /// @brief Append items to the end of the list
+    /// @param items The current items followed by the new ones (see DirectoryModel::append)
+    void appendItems(std::shared_ptr<const fs::DirectoryModel> items);
+
+    /// @brief Replace items after a few entries were added, removed or replaced
+    /// @param items The new listing
+    /// @param delta Rows that changed from the current items; null if unknown
+    ///
+    /// Without a delta this is setItems(). With one, the scroll position is
+    /// kept, the selection and focus follow their rows, and only rows from
+    /// the first change on are indexed and redrawn.
+    void patchItems(std::shared_ptr<const fs::DirectoryModel> items,
+                    const fs::ModelDelta* delta);
 
     /// @brief Get item count
-    [[nodiscard]] size_t itemCount() const noexcept { return items_.size(); }
+    [[nodiscard]] size_t itemCount() const noexcept { return items_->size(); }
 
     /// @brief Get selected indices
-    [[nodiscard]] std::vector<size_t> selectedIndices() const;
+    [[nodiscard]] fs::IndexSet selectedIndices() const;
 
-    /// @brief Set selection
-    void setSelection(const std::vector<size_t>& indices);
+    /// @brief Set selection; indices past the items are dropped
+    void setSelection(const fs::IndexSet& indices);
 
     /// @brief Select single item
     void selectSingle(size_t index);
@@ -82,17 +104,31 @@ public:
     /// @param widths Array of column widths [Name, Size, Date, Resolution, Path]
     void setColumnWidths(const std::array<int, 5>& widths);
 
+    /// @brief Original image size shown in the Resolution column
+    struct Resolution {
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
     /// @brief Set resolution for a file item
-    /// @param path Source file path
+    /// @param id Interned source path (see ThumbnailResult::path_id)
     /// @param width Original image width
     /// @param height Original image height
-    void setResolution(const std::filesystem::path& path, uint32_t width, uint32_t height);
+    void setResolution(PathId id, uint32_t width, uint32_t height);
+
+    /// @brief Set resolutions for many items in one pass
+    /// @param resolutions Source path (sourceIdentifier form) and resolution pairs
+    ///
+    /// Resolutions are remembered, so they survive setItems() for the same files.
+    void setResolutions(
+        const std::vector<std::pair<std::filesystem::path, Resolution>>& resolutions);
 
     /// @brief Refresh display
     void refresh();
 
     /// @brief Handle WM_NOTIFY messages
-    bool handleNotify(NMHDR* nmhdr);
+    /// @return LRESULT to propagate (e.g. the LVN_ODFINDITEM match)
+    LRESULT handleNotify(NMHDR* nmhdr);
 
     /// @brief Set callbacks
     void onItemActivated(ItemActivatedCallback callback) {
@@ -123,17 +159,27 @@ public:
 
 private:
     void createColumns();
-    void populateItems();
-    void updateItem(size_t index);
+    void indexRows(size_t first);
+    // Replace the control's selected state (focus is left alone)
+    void applySelection(const fs::IndexSet& indices);
+    [[nodiscard]] std::wstring cellText(size_t index, int column) const;
+    [[nodiscard]] int findItem(const LVFINDINFOW& find, int start) const;
     static std::wstring formatSize(uint64_t size);
     static std::wstring formatDate(const std::chrono::system_clock::time_point& time);
     static std::wstring formatResolution(uint32_t width, uint32_t height);
-    static std::wstring formatArchivePath(const fs::FileMetadata& item);
+    [[nodiscard]] std::wstring resolutionText(const fs::DirectoryModel::Row& item) const;
+    static std::wstring formatArchivePath(const fs::DirectoryModel::Row& item);
 
     HWND hwnd_ = nullptr;
     HWND header_ = nullptr;
 
-    std::vector<fs::FileMetadata> items_;
+    std::shared_ptr<const fs::DirectoryModel> items_ = std::make_shared<fs::DirectoryModel>();
+
+    // Row of each item by Row::sourceId(), for resolution updates
+    std::unordered_map<PathId, size_t> rows_;
+
+    // Known resolutions by Row::sourceId(); pruned to the current items
+    std::unordered_map<PathId, Resolution> resolutions_;
 
     // Sort state
     FileListColumn sort_column_ = FileListColumn::Name;
@@ -4,14 +4,18 @@
 #include "thumbnail_grid.hpp"
 
 #include <ObjIdl.h>
+#include <dwmapi.h>
 #include <windowsx.h>
 
 #include <algorithm>
+#include <cmath>
 
 #include "core/fs/file_operations.hpp"
 #include "core/i18n/i18n.hpp"
+#include "core/util/etw.hpp"
 #include "core/util/logger.hpp"
 #include "core/util/string_utils.hpp"
+#include "core/util/trace.hpp"
 #include "dnd/drop_source.hpp"
 #include "dnd/file_data_object.hpp"
 #include "ui/app.hpp"
@@ -83,13 +87,21 @@ void ThumbnailGrid::setBounds(int x, int y, int width, int height) {
     }
 }
 
-void ThumbnailGrid::setItems(const std::vector<fs::FileMetadata>& items, bool preserve_scroll) {
+void ThumbnailGrid::setItems(std::shared_ptr<const fs::DirectoryModel> items,
+                             bool preserve_scroll) {
     cancelPendingInlineEdit();
     cancelInlineEdit();
 
-    items_ = items;
+    items_ = std::move(items);
+    item_ids_.clear();
+    id_rows_.clear();
+    indexItems(0);
     thumbnails_.clear();
-    selected_.assign(items.size(), false);
+    placeholders_.clear();
+    atlas_.clear();
+    captions_.clear();
+    requested_.clear();
+    selected_.clear();
     focused_index_ = SIZE_MAX;
     anchor_index_ = SIZE_MAX;
     if (!preserve_scroll) {
@@ -104,43 +116,232 @@ void ThumbnailGrid::setItems(const std::vector<fs::FileMetadata>& items, bool pr
     InvalidateRect(hwnd_, nullptr, FALSE);
 }
 
-void ThumbnailGrid::setThumbnail(const std::filesystem::path& path, image::DecodedImage thumbnail) {
-    auto key = path.wstring();
-    LOG_DEBUG("setThumbnail called: path={}, valid={}, map_size={}", pathToUtf8(path),
-              thumbnail.valid(), thumbnails_.size());
+void ThumbnailGrid::appendItems(std::shared_ptr<const fs::DirectoryModel> items) {
+    if (items->size() <= items_->size()) {
+        return;
+    }
+
+    size_t first_new = items_->size();
+    items_ = std::move(items);
+    indexItems(first_new);
+
+    updateLayout();
+    updateScrollbar();
+    // Only the new items can be missing a request; older visible items were
+    // already requested when they were added
+    requestVisibleThumbnails(first_new);
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+void ThumbnailGrid::reorderItems(std::shared_ptr<const fs::DirectoryModel> items) {
+    cancelPendingInlineEdit();
+    cancelInlineEdit();
+
+    items_ = std::move(items);
+    indexItems(0);
+    selected_.clear();
+    focused_index_ = SIZE_MAX;
+    anchor_index_ = SIZE_MAX;
+
+    updateLayout();
+    scroll_pos_ = std::clamp(scroll_pos_, 0, max_scroll_);
+    updateScrollbar();
+    resetThumbnailRequests();
+    requestVisibleThumbnails();
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+void ThumbnailGrid::patchItems(std::shared_ptr<const fs::DirectoryModel> items,
+                               const fs::ModelDelta* delta) {
+    if (!delta) {
+        reorderItems(std::move(items));
+    } else {
+        cancelPendingInlineEdit();
+        cancelInlineEdit();
 
-    ThumbnailEntry entry;
+        auto follow = [delta](size_t index) {
+            auto now = index == SIZE_MAX ? std::nullopt : delta->map(index);
+            return now.value_or(SIZE_MAX);
+        };
+        selected_ = selected_.mapped(*delta);
+        selected_.truncate(items->size());
+        focused_index_ = follow(focused_index_);
+        anchor_index_ = follow(anchor_index_);
+
+        // Rows before the first removal or insertion keep their index and id
+        size_t first = items_->size();
+        if (!delta->removed.empty()) {
+            first = (std::min)(first, delta->removed.front().first);
+        }
+        if (!delta->inserted.empty()) {
+            first = (std::min)(first, delta->inserted.front().first);
+        }
+        for (size_t i = first; i < row_ids_.size(); ++i) {
+            id_rows_[row_ids_[i]] = SIZE_MAX;
+        }
+        items_ = std::move(items);
+        indexItems((std::min)(first, items_->size()));
 
-    // Create D2D bitmap immediately if render target is available
-    if (device_resources_.isValid()) {
-        entry.bitmap =
-            d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), thumbnail);
+        bool moved = !delta->removed.empty() || !delta->inserted.empty();
+        if (moved) {
+            updateLayout();
+            scroll_pos_ = std::clamp(scroll_pos_, 0, max_scroll_);
+            updateScrollbar();
+            resetThumbnailRequests();
+        } else {
+            // Updated files are asked for again; an answer in flight is for the old pixels
+            for (const auto& range : delta->updated) {
+                for (size_t i = range.first; i < range.first + range.count; ++i) {
+                    requested_.erase(row_ids_[i]);
+                }
+            }
+        }
+        requestVisibleThumbnails();
+        InvalidateRect(hwnd_, nullptr, FALSE);
     }
-    entry.source = std::move(thumbnail);
 
-    thumbnails_[key] = std::move(entry);
+    std::erase_if(thumbnails_, [this](const auto& entry) {
+        if (id_rows_[entry.first] != SIZE_MAX) {
+            return false;
+        }
+        atlas_.remove(entry.first);
+        return true;
+    });
+    // Renamed items come back under a new id
+    std::erase_if(captions_,
+                  [this](const auto& entry) { return id_rows_[entry.first] == SIZE_MAX; });
+    std::erase_if(placeholders_,
+                  [this](const auto& entry) { return id_rows_[entry.first] == SIZE_MAX; });
+}
 
-    // Invalidate the affected item rect
-    for (size_t i = 0; i < items_.size(); ++i) {
-        if (items_[i].sourceIdentifier() == key) {
-            RECT rc = getItemRect(i);
-            LOG_DEBUG("  Found item at index {}, rect=({},{},{},{})", i, rc.left, rc.top, rc.right,
-                      rc.bottom);
-            InvalidateRect(hwnd_, &rc, FALSE);
-            return;
+void ThumbnailGrid::indexItems(size_t first) {
+    if (first == 0) {
+        std::ranges::fill(id_rows_, SIZE_MAX);
+    }
+    row_ids_.resize(items_->size());
+    for (size_t i = first; i < items_->size(); ++i) {
+        auto [it, added] = item_ids_.try_emplace((*items_)[i].sourceId(),
+                                                 static_cast<ItemId>(id_rows_.size()));
+        if (added) {
+            id_rows_.push_back(SIZE_MAX);
         }
+        row_ids_[i] = it->second;
+        id_rows_[it->second] = i;
     }
+}
 
-    LOG_WARN("  Item not found in items_ list, invalidating entire window");
-    InvalidateRect(hwnd_, nullptr, FALSE);
+void ThumbnailGrid::setThumbnail(const std::filesystem::path& path, image::DecodedImage thumbnail) {
+    std::vector<ThumbnailUpdate> single;
+    single.push_back({.id = internPath(path), .image = std::move(thumbnail)});
+    setThumbnails(std::move(single));
+}
+
+void ThumbnailGrid::setThumbnails(std::vector<ThumbnailUpdate> thumbnails) {
+    if (thumbnails.empty()) {
+        return;
+    }
+    uint32_t level = App::instance().thumbnailLevel(thumbnail_size_);
+    RECT dirty{};
+    bool found = false;
+    uint32_t generation = device_resources_.gpuGeneration();
+    for (auto& [path_id, thumbnail, staged, preview, request_id] : thumbnails) {
+        auto id_it = item_ids_.find(path_id);
+        if (id_it == item_ids_.end() || id_rows_[id_it->second] == SIZE_MAX) {
+            // Result for an item no longer listed
+            continue;
+        }
+        ItemId key = id_it->second;
+        if (preview) {
+            // Late preview for an item that already has its refined thumbnail
+            if (auto it = thumbnails_.find(key);
+                it != thumbnails_.end() && it->second.level != kPreviewLevel) {
+                continue;
+            }
+        }
+        ThumbnailEntry entry;
+
+        // Atlas images are uploaded when first drawn; others get a bitmap
+        // now if the render target is available. A bitmap the worker staged
+        // on the device drawn on replaces either upload
+        atlas_.remove(key);
+        bool use_staged = staged && generation != 0 && staged.generation == generation;
+        etw::uiUpload(request_id, use_staged);
+        if (use_staged) {
+            if (staged.border == 0) {
+                entry.bitmap = std::move(staged.bitmap);
+            } else {
+                entry.staged = std::move(staged.bitmap);
+            }
+        } else if (!d2d::ThumbnailAtlas::fits(thumbnail) && device_resources_.isValid()) {
+            entry.bitmap =
+                d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), thumbnail);
+        }
+        entry.width = thumbnail.width();
+        entry.height = thumbnail.height();
+        if (!entry.bitmap && !entry.staged) {
+            entry.source = std::move(thumbnail);
+        }
+        entry.level = preview ? kPreviewLevel : level;
+
+        if (!preview) {
+            requested_.erase(key);
+        }
+        thumbnails_[key] = std::move(entry);
+
+        // A single invalidation covering the whole batch
+        RECT rc = getItemRect(id_rows_[key]);
+        if (!found) {
+            dirty = rc;
+            found = true;
+        } else {
+            UnionRect(&dirty, &dirty, &rc);
+        }
+    }
+    trimThumbnails();
+
+    if (found) {
+        InvalidateRect(hwnd_, &dirty, FALSE);
+    }
+}
+
+void ThumbnailGrid::setPlaceholders(const std::vector<Placeholder>& placeholders) {
+    bool added = false;
+    const auto& interner = PathInterner::instance();
+    for (const auto& [path, width, height, color] : placeholders) {
+        auto id_it = item_ids_.find(interner.find(path.native()));
+        if (id_it == item_ids_.end() || id_rows_[id_it->second] == SIZE_MAX) {
+            continue;
+        }
+        placeholders_[id_it->second] = {width, height, color};
+        added = true;
+    }
+    if (added) {
+        InvalidateRect(hwnd_, nullptr, FALSE);
+    }
 }
 
 void ThumbnailGrid::clearThumbnails() {
     thumbnails_.clear();
+    atlas_.clear();
+    updateMemoryCharges();
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+void ThumbnailGrid::discardThumbnails(const std::vector<std::filesystem::path>& paths) {
+    const auto& interner = PathInterner::instance();
+    for (const auto& path : paths) {
+        if (auto it = item_ids_.find(interner.find(path.native())); it != item_ids_.end()) {
+            thumbnails_.erase(it->second);
+            placeholders_.erase(it->second);  // Its colour was of the old contents
+            atlas_.remove(it->second);
+        }
+    }
+    updateMemoryCharges();
     InvalidateRect(hwnd_, nullptr, FALSE);
 }
 
 void ThumbnailGrid::setThumbnailSize(int size) {
+    uint32_t previous_level = App::instance().thumbnailLevel(thumbnail_size_);
     thumbnail_size_ = size;
     item_width_ = size + kItemPadding * 2;
     item_height_ = size + kTextHeight + kItemPadding * 2;
@@ -150,30 +351,23 @@ void ThumbnailGrid::setThumbnailSize(int size) {
 
     // Save to settings
     App::instance().settings().thumbnails.display_size = size;
-}
 
-std::vector<size_t> ThumbnailGrid::selectedIndices() const {
-    std::vector<size_t> result;
-    for (size_t i = 0; i < selected_.size(); ++i) {
-        if (selected_[i]) {
-            result.push_back(i);
-        }
+    // Crossing into another cached level: current bitmaps stay up (scaled)
+    // until the sharper level replaces them
+    if (App::instance().thumbnailLevel(size) != previous_level) {
+        resetThumbnailRequests();
+        requestVisibleThumbnails();
     }
-    return result;
 }
 
-void ThumbnailGrid::setSelection(const std::vector<size_t>& indices) {
-    std::fill(selected_.begin(), selected_.end(), false);
-    for (size_t i : indices) {
-        if (i < selected_.size()) {
-            selected_[i] = true;
-        }
-    }
+void ThumbnailGrid::setSelection(const fs::IndexSet& indices) {
+    selected_ = indices;
+    selected_.truncate(items_->size());
 
     // Set keyboard focus and anchor to the first selected item
-    if (!indices.empty() && indices.front() < selected_.size()) {
-        focused_index_ = indices.front();
-        anchor_index_ = indices.front();
+    if (auto first = selected_.first()) {
+        focused_index_ = *first;
+        anchor_index_ = *first;
     } else {
         focused_index_ = SIZE_MAX;
         anchor_index_ = SIZE_MAX;
@@ -182,14 +376,14 @@ void ThumbnailGrid::setSelection(const std::vector<size_t>& indices) {
     InvalidateRect(hwnd_, nullptr, FALSE);
 
     if (selection_changed_callback_) {
-        selection_changed_callback_(indices);
+        selection_changed_callback_(selected_);
     }
 }
 
 void ThumbnailGrid::selectSingle(size_t index) {
-    std::fill(selected_.begin(), selected_.end(), false);
-    if (index < selected_.size()) {
-        selected_[index] = true;
+    selected_.clear();
+    if (index < items_->size()) {
+        selected_.insert(index);
         focused_index_ = index;
         anchor_index_ = index;
     }
@@ -201,17 +395,17 @@ void ThumbnailGrid::selectSingle(size_t index) {
 }
 
 void ThumbnailGrid::clearSelection() {
-    std::fill(selected_.begin(), selected_.end(), false);
+    selected_.clear();
     focused_index_ = SIZE_MAX;
     InvalidateRect(hwnd_, nullptr, FALSE);
 
     if (selection_changed_callback_) {
-        selection_changed_callback_({});
+        selection_changed_callback_(selected_);
     }
 }
 
 void ThumbnailGrid::ensureVisible(size_t index) {
-    if (index >= items_.size()) {
+    if (index >= items_->size()) {
         return;
     }
 
@@ -234,10 +428,91 @@ void ThumbnailGrid::ensureVisible(size_t index) {
     InvalidateRect(hwnd_, nullptr, FALSE);
 }
 
+void ThumbnailGrid::scrollToIndex(size_t index) {
+    if (items_->empty() || columns_ <= 0) {
+        return;
+    }
+
+    index = (std::min)(index, items_->size() - 1);
+    int row = static_cast<int>(index / columns_);
+    scroll_pos_ = std::clamp(row * item_height_, 0, max_scroll_);
+
+    updateScrollbar();
+    requestVisibleThumbnails();
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+size_t ThumbnailGrid::firstVisibleIndex() const {
+    if (item_height_ <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(scroll_pos_ / item_height_) * columns_;
+}
+
+size_t ThumbnailGrid::visibleCapacity() const {
+    RECT rc;
+    GetClientRect(hwnd_, &rc);
+    if (item_height_ <= 0) {
+        return 0;
+    }
+    int rows = (rc.bottom - rc.top) / item_height_ + 2;  // Partial rows at both edges
+    return static_cast<size_t>(rows) * columns_;
+}
+
 void ThumbnailGrid::refresh() {
     InvalidateRect(hwnd_, nullptr, FALSE);
 }
 
+ThumbnailGrid::FrameStats ThumbnailGrid::takeFrameStats() {
+    FrameStats stats = frame_stats_;
+    if (stats.frames > 0) {
+        stats.mean_ms = frame_total_ms_ / stats.frames;
+    }
+    frame_stats_ = {};
+    frame_total_ms_ = 0.0;
+    return stats;
+}
+
+uint64_t ThumbnailGrid::gpuBitmapBytes() const {
+    uint64_t bytes = atlas_.gpuBytes();
+    for (const auto& [id, entry] : thumbnails_) {
+        for (const auto* bitmap : {entry.bitmap.Get(), entry.staged.Get()}) {
+            if (bitmap) {
+                auto size = bitmap->GetPixelSize();
+                bytes += static_cast<uint64_t>(size.width) * size.height * 4;
+            }
+        }
+    }
+    return bytes;
+}
+
+void ThumbnailGrid::setPerfOverlayVisible(bool visible) {
+    perf_overlay_visible_ = visible;
+    if (visible) {
+        // Dropped frames are counted against the display's refresh rate
+        DWM_TIMING_INFO timing = {};
+        timing.cbSize = sizeof(timing);
+        if (SUCCEEDED(DwmGetCompositionTimingInfo(nullptr, &timing)) &&
+            timing.rateRefresh.uiNumerator > 0) {
+            refresh_period_ms_ = 1000.0 * timing.rateRefresh.uiDenominator /
+                                 timing.rateRefresh.uiNumerator;
+        }
+        (void)takeFrameStats();
+    }
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+void ThumbnailGrid::setPerfOverlayText(std::wstring text) {
+    perf_overlay_text_ = std::move(text);
+    if (perf_overlay_visible_) {
+        auto area = perfOverlayRect();
+        RECT rect = {static_cast<LONG>(area.left), static_cast<LONG>(area.top),
+                     static_cast<LONG>(std::ceil(area.right)),
+                     static_cast<LONG>(std::ceil(area.bottom))};
+        InvalidateRect(hwnd_, &rect, FALSE);
+    }
+}
+
 LRESULT CALLBACK ThumbnailGrid::WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     ThumbnailGrid* self;
 
@@ -301,8 +576,8 @@ LRESULT ThumbnailGrid::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
             deferred_select_index_ = SIZE_MAX;
 
             // Start delayed inline edit timer if click was on text area
-            if (!isInlineEditing() && deferred_idx < items_.size() &&
-                !items_[deferred_idx].is_in_archive()) {
+            if (!isInlineEditing() && deferred_idx < items_->size() &&
+                !(*items_)[deferred_idx].is_in_archive()) {
                 D2D1_RECT_F text_rect = getTextRect(deferred_idx);
                 float fx = static_cast<float>(GET_X_LPARAM(lParam));
                 float fy = static_cast<float>(GET_Y_LPARAM(lParam));
@@ -361,19 +636,23 @@ LRESULT ThumbnailGrid::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
     case WM_TIMER:
         if (wParam == kScrollDebounceTimerId) {
             KillTimer(hwnd_, kScrollDebounceTimerId);
-            if (thumbnail_cancel_callback_) {
-                thumbnail_cancel_callback_();
-            }
+            // Scrolling has settled: drop what is far away, keep the rest queued
+            scroll_velocity_ = 0.0;
+            updateViewport(true);
             requestVisibleThumbnails();
             return 0;
         }
+        if (wParam == kScrollAnimationTimerId) {
+            stepScrollAnimation();
+            return 0;
+        }
         if (wParam == kInlineEditTimerId) {
             KillTimer(hwnd_, kInlineEditTimerId);
             size_t idx = pending_inline_edit_index_;
             pending_inline_edit_index_ = SIZE_MAX;
             // Verify conditions: still focused, selected, same item, not in archive
-            if (idx < items_.size() && idx == focused_index_ && selected_[idx] &&
-                !items_[idx].is_in_archive()) {
+            if (idx < items_->size() && idx == focused_index_ && selected_.contains(idx) &&
+                !(*items_)[idx].is_in_archive()) {
                 beginInlineEdit(idx);
             }
             return 0;
@@ -382,14 +661,15 @@ LRESULT ThumbnailGrid::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
 
     case WM_NCDESTROY:
         KillTimer(hwnd_, kScrollDebounceTimerId);
+        KillTimer(hwnd_, kScrollAnimationTimerId);
         KillTimer(hwnd_, kInlineEditTimerId);
         return DefWindowProcW(hwnd_, msg, wParam, lParam);
 
     case WM_DPICHANGED: {
         UINT dpi = HIWORD(wParam);
         device_resources_.setDpi(static_cast<float>(dpi), static_cast<float>(dpi));
+        // The render target keeps its bitmaps across a DPI change
         createD2DResources();
-        recreateThumbnailBitmaps();
         last_resource_epoch_ = device_resources_.resourceEpoch();
         InvalidateRect(hwnd_, nullptr, FALSE);
         return 0;
@@ -403,7 +683,9 @@ LRESULT ThumbnailGrid::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
 // --- D2D Rendering ---
 
 void ThumbnailGrid::onPaint() {
-    LOG_TRACE("onPaint called: items={}, thumbnails={}", items_.size(), thumbnails_.size());
+    ScopedTrace trace("grid paint", "ui");
+    auto paint_start = std::chrono::steady_clock::now();
+    LOG_TRACE("onPaint called: items={}, thumbnails={}", items_->size(), thumbnails_.size());
 
     PAINTSTRUCT ps;
     BeginPaint(hwnd_, &ps);
@@ -416,7 +698,7 @@ void ThumbnailGrid::onPaint() {
         last_resource_epoch_ = epoch;
     }
 
-    if (!device_resources_.beginDraw()) {
+    if (!device_resources_.beginDraw(&ps.rcPaint)) {
         EndPaint(hwnd_, &ps);
         return;
     }
@@ -436,17 +718,24 @@ void ThumbnailGrid::onPaint() {
     rt->PushAxisAlignedClip(D2D1::RectF(0, 0, content_width, client_height),
                             D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
 
-    // Draw visible items
-    for (size_t i = 0; i < items_.size(); ++i) {
+    // Draw the visible rows; atlas thumbnails are queued and drawn together
+    // after the loop, above the highlights and placeholders drawn in it
+    size_t first_visible = 0;
+    size_t last_visible = 0;
+    if (columns_ > 0 && item_height_ > 0) {
+        first_visible = (std::min)(static_cast<size_t>(scroll_pos_ / item_height_) * columns_,
+                                   items_->size());
+        last_visible = (std::min)(
+            static_cast<size_t>((scroll_pos_ + client_rect.bottom) / item_height_ + 1) * columns_,
+            items_->size());
+    }
+    atlas_.beginFrame();
+    bool lost = false;
+    for (size_t i = first_visible; i < last_visible; ++i) {
         RECT item_rect = getItemRect(i);
 
-        // Cull items outside visible area
-        if (item_rect.bottom < 0 || item_rect.top > client_rect.bottom) {
-            continue;
-        }
-
-        const auto& item = items_[i];
-        bool is_selected = selected_[i];
+        auto item = (*items_)[i];
+        bool is_selected = selected_.contains(i);
         bool is_focused = (i == focused_index_);
 
         D2D1_RECT_F d2d_item = D2D1::RectF(static_cast<float>(item_rect.left),
@@ -467,15 +756,52 @@ void ThumbnailGrid::onPaint() {
                         static_cast<float>(item_rect.top + kItemPadding + thumbnail_size_));
 
         // Draw thumbnail or placeholder
-        auto key = item.sourceIdentifier();
-        auto thumb_it = thumbnails_.find(key);
-        if (thumb_it != thumbnails_.end() && thumb_it->second.bitmap) {
-            auto bitmap_size = thumb_it->second.bitmap->GetSize();
-            D2D1_RECT_F fit = calculateFitRectF(thumb_area, bitmap_size.width, bitmap_size.height);
-            rt->DrawBitmap(thumb_it->second.bitmap.Get(), &fit, 1.0f,
-                           D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
-        } else {
-            rt->FillRectangle(thumb_area, placeholder_brush_.Get());
+        auto thumb_it = thumbnails_.find(row_ids_[i]);
+        bool drawn = false;
+        if (thumb_it != thumbnails_.end()) {
+            auto& entry = thumb_it->second;
+            if (entry.bitmap) {
+                auto bitmap_size = entry.bitmap->GetSize();
+                D2D1_RECT_F fit =
+                    calculateFitRectF(thumb_area, bitmap_size.width, bitmap_size.height);
+                rt->DrawBitmap(entry.bitmap.Get(), &fit, 1.0f,
+                               D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
+                drawn = true;
+            } else {
+                D2D1_RECT_F fit = calculateFitRectF(thumb_area, static_cast<float>(entry.width),
+                                                    static_cast<float>(entry.height));
+                if (entry.staged) {
+                    // Uploaded by the worker: a copy between GPU bitmaps
+                    drawn = atlas_.draw(rt, thumb_it->first, entry.staged.Get(), entry.width,
+                                        entry.height, fit);
+                } else {
+                    drawn = atlas_.draw(rt, thumb_it->first, entry.source, fit);
+                }
+                if (drawn) {
+                    // The atlas holds the pixels now
+                    entry.source = image::DecodedImage{};
+                    entry.staged.Reset();
+                } else if (!entry.source.valid() && !entry.staged) {
+                    // Its slot was reused: fetch it again
+                    thumbnails_.erase(thumb_it);
+                    lost = true;
+                }
+            }
+        }
+        if (!drawn) {
+            // A cached colour in the picture's shape, else the neutral box
+            auto placeholder_it = placeholders_.find(row_ids_[i]);
+            if (placeholder_it != placeholders_.end() && placeholder_tint_brush_) {
+                const auto& placeholder = placeholder_it->second;
+                placeholder_tint_brush_->SetColor(
+                    d2d::Color::fromRgb(placeholder.color).toD2D());
+                rt->FillRectangle(calculateFitRectF(thumb_area,
+                                                    static_cast<float>(placeholder.width),
+                                                    static_cast<float>(placeholder.height)),
+                                  placeholder_tint_brush_.Get());
+            } else {
+                rt->FillRectangle(thumb_area, placeholder_brush_.Get());
+            }
             if (i < 3 && item.is_image()) {
                 LOG_TRACE("  Item {} thumbnail not found in map", i);
             }
@@ -490,9 +816,10 @@ void ThumbnailGrid::onPaint() {
             inline_edit_->render(rt);
         } else {
             auto* text_color_brush = is_selected ? selection_text_brush_.Get() : text_brush_.Get();
-            rt->DrawText(item.name.c_str(), static_cast<UINT32>(item.name.length()),
-                         text_format_.Get(), text_rect, text_color_brush,
-                         D2D1_DRAW_TEXT_OPTIONS_CLIP);
+            if (auto* layout = captionLayout(i, text_rect)) {
+                rt->DrawTextLayout(D2D1::Point2F(text_rect.left, text_rect.top), layout,
+                                   text_color_brush, D2D1_DRAW_TEXT_OPTIONS_CLIP);
+            }
         }
 
         // Focus rectangle
@@ -503,6 +830,8 @@ void ThumbnailGrid::onPaint() {
             rt->DrawRectangle(focus_rect, text_brush_.Get(), 1.0f);
         }
     }
+    atlas_.flush(rt);
+    trimCaptions(first_visible, last_visible);
 
     rt->PopAxisAlignedClip();
 
@@ -511,8 +840,18 @@ void ThumbnailGrid::onPaint() {
         renderScrollbar(rt);
     }
 
+    if (perf_overlay_visible_) {
+        renderPerfOverlay(rt);
+    }
+
     device_resources_.endDraw();
     EndPaint(hwnd_, &ps);
+    recordFrame(paint_start, scroll_animating_);
+    updateMemoryCharges();  // Uploads move pixels to the GPU
+
+    if (lost) {
+        requestVisibleThumbnails();
+    }
 }
 
 void ThumbnailGrid::onSize(int width, int height) {
@@ -547,13 +886,12 @@ void ThumbnailGrid::onMousewheel(int delta) {
         return;
     }
 
-    // Normal wheel: scroll (3 half-rows per notch, matching original behavior)
-    int notches = delta / WHEEL_DELTA;
-    int scroll_amount = notches * (item_height_ * 3 / 2);
-    scroll_pos_ = std::clamp(scroll_pos_ - scroll_amount, 0, max_scroll_);
-
-    InvalidateRect(hwnd_, nullptr, FALSE);
-    scheduleScrollThumbnailRequest();
+    // Normal wheel: 3 half-rows per notch, in proportion for the partial
+    // notches of high-resolution wheels and touchpads; notches arriving
+    // during the animation add to where it is heading
+    int scroll_amount = delta * (item_height_ * 3 / 2) / WHEEL_DELTA;
+    int from = scroll_animating_ ? scroll_target_ : scroll_pos_;
+    smoothScrollTo(from - scroll_amount);
 }
 
 void ThumbnailGrid::onLbuttondown(int x, int y, WPARAM keys) {
@@ -602,14 +940,8 @@ void ThumbnailGrid::onLbuttondown(int x, int y, WPARAM keys) {
             GetClientRect(hwnd_, &rc);
             int page_size = rc.bottom - rc.top;
 
-            if (fy < thumb_center) {
-                scroll_pos_ -= page_size;
-            } else {
-                scroll_pos_ += page_size;
-            }
-            scroll_pos_ = std::clamp(scroll_pos_, 0, max_scroll_);
-            InvalidateRect(hwnd_, nullptr, FALSE);
-            scheduleScrollThumbnailRequest();
+            int from = scroll_animating_ ? scroll_target_ : scroll_pos_;
+            smoothScrollTo(fy < thumb_center ? from - page_size : from + page_size);
             return;
         }
     }
@@ -632,7 +964,7 @@ void ThumbnailGrid::onLbuttondown(int x, int y, WPARAM keys) {
 
     bool ctrl = (keys & MK_CONTROL) != 0;
     bool shift = (keys & MK_SHIFT) != 0;
-    bool already_selected = (index < selected_.size() && selected_[index]);
+    bool already_selected = selected_.contains(index);
 
     if (shift && anchor_index_ != SIZE_MAX) {
         // Range selection
@@ -640,16 +972,13 @@ void ThumbnailGrid::onLbuttondown(int x, int y, WPARAM keys) {
         size_t end = (std::max)(anchor_index_, index);
 
         if (!ctrl) {
-            std::fill(selected_.begin(), selected_.end(), false);
-        }
-
-        for (size_t i = start; i <= end; ++i) {
-            selected_[i] = true;
+            selected_.clear();
         }
+        selected_.insert({start, end - start + 1});
         focused_index_ = index;
     } else if (ctrl) {
         // Toggle selection
-        selected_[index] = !selected_[index];
+        selected_.toggle(index);
         focused_index_ = index;
         anchor_index_ = index;
     } else if (already_selected) {
@@ -718,11 +1047,11 @@ void ThumbnailGrid::showContextMenu(int x, int y, size_t index) {
         break;
 
     case kCmdRename: {
-        if (index >= items_.size() || items_[index].is_in_archive()) {
+        if (index >= items_->size() || (*items_)[index].is_in_archive()) {
             break;
         }
         d2d::D2DRenameDialog dialog;
-        auto new_name = dialog.show(hwnd_, items_[index].name);
+        auto new_name = dialog.show(hwnd_, std::wstring((*items_)[index].name()));
         if (new_name && rename_requested_callback_) {
             rename_requested_callback_(index, *new_name);
         }
@@ -760,11 +1089,11 @@ void ThumbnailGrid::onMousemove(int x, int y, WPARAM keys) {
         if (available_height > 0.0f) {
             float delta_y = fy - scrollbar_drag_start_y_;
             float scroll_ratio = delta_y / available_height;
-            scroll_pos_ = static_cast<int>(scrollbar_drag_start_offset_ +
-                                           scroll_ratio * static_cast<float>(max_scroll_));
-            scroll_pos_ = std::clamp(scroll_pos_, 0, max_scroll_);
-            InvalidateRect(hwnd_, nullptr, FALSE);
-            scheduleScrollThumbnailRequest();
+            // The thumb follows the pointer directly, without easing
+            scroll_animating_ = false;
+            KillTimer(hwnd_, kScrollAnimationTimerId);
+            setScrollPosition(static_cast<int>(scrollbar_drag_start_offset_ +
+                                               scroll_ratio * static_cast<float>(max_scroll_)));
         }
         return;
     }
@@ -796,22 +1125,47 @@ void ThumbnailGrid::onMousemove(int x, int y, WPARAM keys) {
 
 void ThumbnailGrid::beginDrag() {
     auto paths = selectedFilePaths();
-    if (paths.empty()) {
+
+    // Archive entries travel as virtual files, extracted only when the
+    // target reads them
+    std::vector<VirtualFile> virtual_files;
+    for (size_t i : selected_) {
+        auto item = (*items_)[i];
+        if (!item.is_in_archive()) {
+            continue;
+        }
+        virtual_files.push_back(
+            {.name = std::wstring(item.name()),
+             .size_bytes = item.size_bytes(),
+             .read = [vpath = *item.virtual_path()]() -> std::optional<std::vector<uint8_t>> {
+                 auto* archives = App::instance().archive();
+                 if (!archives) {
+                     return std::nullopt;
+                 }
+                 auto data = archives->extractToMemory(vpath);
+                 if (!data) {
+                     return std::nullopt;
+                 }
+                 return std::move(*data);
+             }});
+    }
+    if (paths.empty() && virtual_files.empty()) {
         return;
     }
 
     // Notify callback
-    if (drag_start_callback_) {
+    if (drag_start_callback_ && !paths.empty()) {
         drag_start_callback_(paths);
     }
 
-    // Create OLE data object and drop source
-    IDataObject* pDataObj = createFileDataObject(paths);
+    // Create OLE data object and drop source; virtual files can only be copied
+    DWORD allowed = virtual_files.empty() ? DROPEFFECT_COPY | DROPEFFECT_MOVE : DROPEFFECT_COPY;
+    IDataObject* pDataObj = createFileDataObject(std::move(paths), std::move(virtual_files));
     IDropSource* pDropSource = new DropSource();
 
     // Perform drag-drop
     DWORD dwEffect = 0;
-    HRESULT hr = DoDragDrop(pDataObj, pDropSource, DROPEFFECT_COPY | DROPEFFECT_MOVE, &dwEffect);
+    HRESULT hr = DoDragDrop(pDataObj, pDropSource, allowed, &dwEffect);
 
     // Release COM objects
     pDropSource->Release();
@@ -825,10 +1179,10 @@ void ThumbnailGrid::beginDrag() {
 
 std::vector<std::filesystem::path> ThumbnailGrid::selectedFilePaths() const {
     std::vector<std::filesystem::path> paths;
-
-    for (size_t i = 0; i < items_.size(); ++i) {
-        if (selected_[i] && !items_[i].is_in_archive()) {
-            paths.push_back(items_[i].path);
+    paths.reserve(selected_.count());
+    for (size_t i : selected_) {
+        if (!(*items_)[i].is_in_archive()) {
+            paths.push_back((*items_)[i].path());
         }
     }
 
@@ -836,7 +1190,7 @@ std::vector<std::filesystem::path> ThumbnailGrid::selectedFilePaths() const {
 }
 
 void ThumbnailGrid::onKeydown(int vk) {
-    if (items_.empty()) {
+    if (items_->empty()) {
         return;
     }
 
@@ -877,9 +1231,9 @@ void ThumbnailGrid::onKeydown(int vk) {
         break;
 
     case VK_RIGHT:
-        if (focused_index_ != SIZE_MAX && focused_index_ < items_.size() - 1) {
+        if (focused_index_ != SIZE_MAX && focused_index_ < items_->size() - 1) {
             new_focus = focused_index_ + 1;
-        } else if (focused_index_ == SIZE_MAX && !items_.empty()) {
+        } else if (focused_index_ == SIZE_MAX && !items_->empty()) {
             new_focus = 0;
         }
         break;
@@ -893,10 +1247,10 @@ void ThumbnailGrid::onKeydown(int vk) {
     case VK_DOWN:
         if (focused_index_ != SIZE_MAX) {
             size_t next = focused_index_ + columns_;
-            if (next < items_.size()) {
+            if (next < items_->size()) {
                 new_focus = next;
             }
-        } else if (!items_.empty()) {
+        } else if (!items_->empty()) {
             new_focus = 0;
         }
         break;
@@ -906,7 +1260,7 @@ void ThumbnailGrid::onKeydown(int vk) {
         break;
 
     case VK_END:
-        new_focus = items_.size() - 1;
+        new_focus = items_->size() - 1;
         break;
 
     case VK_RETURN:
@@ -917,7 +1271,7 @@ void ThumbnailGrid::onKeydown(int vk) {
 
     case 'A':
         if (GetKeyState(VK_CONTROL) & 0x8000) {
-            std::fill(selected_.begin(), selected_.end(), true);
+            selected_ = fs::IndexSet::all(items_->size());
             InvalidateRect(hwnd_, nullptr, FALSE);
             if (selection_changed_callback_) {
                 selection_changed_callback_(selectedIndices());
@@ -926,11 +1280,10 @@ void ThumbnailGrid::onKeydown(int vk) {
         return;
 
     case VK_F2:
-        if (focused_index_ != SIZE_MAX && focused_index_ < items_.size() &&
-            selected_[focused_index_] && !items_[focused_index_].is_in_archive()) {
+        if (focused_index_ != SIZE_MAX && focused_index_ < items_->size() &&
+            selected_.contains(focused_index_) && !(*items_)[focused_index_].is_in_archive()) {
             // Only allow F2 rename when exactly one item is selected
-            auto sel = selectedIndices();
-            if (sel.size() == 1) {
+            if (selected_.count() == 1) {
                 beginInlineEdit(focused_index_);
             }
         }
@@ -948,7 +1301,7 @@ void ThumbnailGrid::onKeydown(int vk) {
         return;
     }
 
-    if (new_focus != focused_index_ && new_focus < items_.size()) {
+    if (new_focus != focused_index_ && new_focus < items_->size()) {
         bool shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
         bool ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
 
@@ -957,10 +1310,8 @@ void ThumbnailGrid::onKeydown(int vk) {
         } else if (shift && anchor_index_ != SIZE_MAX) {
             size_t start = (std::min)(anchor_index_, new_focus);
             size_t end = (std::max)(anchor_index_, new_focus);
-            std::fill(selected_.begin(), selected_.end(), false);
-            for (size_t i = start; i <= end; ++i) {
-                selected_[i] = true;
-            }
+            selected_.clear();
+            selected_.insert({start, end - start + 1});
             focused_index_ = new_focus;
         } else {
             focused_index_ = new_focus;
@@ -985,14 +1336,14 @@ void ThumbnailGrid::updateLayout() {
 
     // First pass: compute columns without scrollbar
     columns_ = (std::max)(1, width / item_width_);
-    int total_rows = (static_cast<int>(items_.size()) + columns_ - 1) / columns_;
+    int total_rows = (static_cast<int>(items_->size()) + columns_ - 1) / columns_;
     int content_height = total_rows * item_height_;
 
     // If scrollbar is needed, recompute with reduced width
     if (content_height > height) {
         int available_width = width - static_cast<int>(kScrollbarWidth);
         columns_ = (std::max)(1, available_width / item_width_);
-        total_rows = (static_cast<int>(items_.size()) + columns_ - 1) / columns_;
+        total_rows = (static_cast<int>(items_->size()) + columns_ - 1) / columns_;
         content_height = total_rows * item_height_;
     }
 
@@ -1026,7 +1377,7 @@ size_t ThumbnailGrid::hitTest(int x, int y) const {
     }
 
     size_t index = row * columns_ + col;
-    if (index >= items_.size()) {
+    if (index >= items_->size()) {
         return SIZE_MAX;
     }
 
@@ -1055,13 +1406,13 @@ D2D1_RECT_F ThumbnailGrid::getTextRect(size_t index) const {
 }
 
 void ThumbnailGrid::beginInlineEdit(size_t index) {
-    if (index >= items_.size() || items_[index].is_in_archive()) {
+    if (index >= items_->size() || (*items_)[index].is_in_archive()) {
         return;
     }
     cancelPendingInlineEdit();
 
     inline_edit_index_ = index;
-    inline_edit_original_name_ = items_[index].name;
+    inline_edit_original_name_ = (*items_)[index].name();
 
     if (!inline_edit_) {
         inline_edit_ = std::make_unique<d2d::D2DEditBox>();
@@ -1103,7 +1454,7 @@ void ThumbnailGrid::commitInlineEdit() {
     inline_edit_original_name_.clear();
 
     // Commit only if name actually changed and is valid
-    if (new_name != items_[index].name && !new_name.empty() &&
+    if (new_name != (*items_)[index].name() && !new_name.empty() &&
         fs::isValidFilename(new_name)) {
         if (rename_requested_callback_) {
             rename_requested_callback_(index, new_name);
@@ -1132,13 +1483,13 @@ void ThumbnailGrid::cancelPendingInlineEdit() {
     }
 }
 
-void ThumbnailGrid::requestVisibleThumbnails() {
+void ThumbnailGrid::requestVisibleThumbnails(size_t from_index) {
     if (!thumbnail_request_callback_) {
         LOG_DEBUG("requestVisibleThumbnails: no callback set");
         return;
     }
 
-    if (items_.empty() || columns_ <= 0 || item_height_ <= 0) {
+    if (items_->empty() || columns_ <= 0 || item_height_ <= 0) {
         return;
     }
 
@@ -1149,39 +1500,234 @@ void ThumbnailGrid::requestVisibleThumbnails() {
     // Compute visible row range via arithmetic instead of iterating all items
     int first_row = scroll_pos_ / item_height_;
     int last_row = (scroll_pos_ + client_height) / item_height_;
-    size_t first_idx = static_cast<size_t>(first_row) * columns_;
+    size_t visible_first = (std::min)(static_cast<size_t>(first_row) * columns_, items_->size());
+    size_t first_idx = (std::max)(visible_first, from_index);
     size_t last_idx =
-        (std::min)(static_cast<size_t>(last_row + 1) * columns_, items_.size());
+        (std::min)(static_cast<size_t>(last_row + 1) * columns_, items_->size());
 
     LOG_DEBUG(
         "requestVisibleThumbnails: rows=[{},{}], indices=[{},{}), items={}, columns={}, "
         "scroll_pos={}",
-        first_row, last_row, first_idx, last_idx, items_.size(), columns_, scroll_pos_);
+        first_row, last_row, first_idx, last_idx, items_->size(), columns_, scroll_pos_);
 
+    uint32_t level = App::instance().thumbnailLevel(thumbnail_size_);
     size_t requested = 0;
-    for (size_t i = first_idx; i < last_idx; ++i) {
-        const auto& item = items_[i];
-
-        // Check if we already have thumbnail (use sourceIdentifier for keying)
-        std::wstring key = item.sourceIdentifier();
-        if (item.is_image() && thumbnails_.find(key) == thumbnails_.end()) {
-            // Request using VirtualPath
-            if (item.is_in_archive() && item.virtual_path) {
-                thumbnail_request_callback_(*item.virtual_path);
-            } else {
-                thumbnail_request_callback_(archive::VirtualPath(item.path));
-            }
+    auto request = [&](size_t i) {
+        auto item = (*items_)[i];
+
+        // Check if we already have thumbnail at the current level
+        ItemId key = row_ids_[i];
+        auto it = thumbnails_.find(key);
+        // Archives show their cover image, folders a mosaic of their first images
+        bool has_thumbnail = item.is_image() || item.is_archive() ||
+                             (item.is_directory() && !item.is_in_archive());
+        if (has_thumbnail && (it == thumbnails_.end() || it->second.level != level) &&
+            !requested_.contains(key)) {
+            // Pass the metadata along so the cache key needs no extra stat
+            thumbnail_request_callback_(item.metadata(), i);
+            requested_.emplace(key, i);
             requested++;
         }
+    };
+    for (size_t i = first_idx; i < last_idx; ++i) {
+        request(i);
+    }
+
+    // Then the rows a scroll in progress brings in, in the order they cross
+    // the leading edge
+    size_t lookahead = lookaheadItems(last_idx - visible_first);
+    if (scroll_velocity_ > 0.0) {
+        size_t ahead_last = (std::min)(last_idx + lookahead, items_->size());
+        for (size_t i = (std::max)(last_idx, from_index); i < ahead_last; ++i) {
+            request(i);
+        }
+    } else if (scroll_velocity_ < 0.0) {
+        size_t ahead_first = visible_first > lookahead ? visible_first - lookahead : 0;
+        for (size_t i = visible_first; i-- > (std::max)(ahead_first, from_index);) {
+            request(i);
+        }
     }
 
     LOG_DEBUG("requestVisibleThumbnails: requested {} thumbnails", requested);
 }
 
 void ThumbnailGrid::scheduleScrollThumbnailRequest() {
+    // Reorder what is queued and request what the scroll reaches right away;
+    // requests far behind are only dropped once it settles
+    updateViewport(false);
+    requestVisibleThumbnails();
     SetTimer(hwnd_, kScrollDebounceTimerId, kScrollDebounceMs, nullptr);
 }
 
+void ThumbnailGrid::smoothScrollTo(int target) {
+    scroll_target_ = std::clamp(target, 0, max_scroll_);
+    if (scroll_animating_ || scroll_target_ == scroll_pos_) {
+        return;
+    }
+    scroll_animating_ = true;
+    scroll_exact_ = static_cast<double>(scroll_pos_);
+    scroll_step_time_ = std::chrono::steady_clock::now();
+    SetTimer(hwnd_, kScrollAnimationTimerId, kScrollAnimationMs, nullptr);
+}
+
+void ThumbnailGrid::stepScrollAnimation() {
+    // Anything else that moved the view (keyboard, layout) ends the animation
+    if (!scroll_animating_ || std::lround(scroll_exact_) != scroll_pos_) {
+        scroll_animating_ = false;
+        KillTimer(hwnd_, kScrollAnimationTimerId);
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = (std::min)(std::chrono::duration<double>(now - scroll_step_time_).count(),
+                                0.1);
+    scroll_step_time_ = now;
+
+    double target = static_cast<double>((std::min)(scroll_target_, max_scroll_));
+    double approach = 1.0 - std::exp(-elapsed / kScrollSmoothingSeconds);
+    scroll_exact_ += (target - scroll_exact_) * approach;
+    if (std::abs(target - scroll_exact_) < 0.5) {
+        scroll_exact_ = target;
+        scroll_animating_ = false;
+        KillTimer(hwnd_, kScrollAnimationTimerId);
+    }
+    setScrollPosition(static_cast<int>(std::lround(scroll_exact_)));
+}
+
+void ThumbnailGrid::setScrollPosition(int pos) {
+    pos = std::clamp(pos, 0, max_scroll_);
+    if (pos == scroll_pos_) {
+        return;
+    }
+
+    // Smoothed over the last few moves; a pause starts from rest
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - scroll_move_time_).count();
+    double instant = elapsed > 0.0 && elapsed < 0.25
+                         ? static_cast<double>(pos - scroll_pos_) / elapsed
+                         : 0.0;
+    scroll_velocity_ = 0.5 * scroll_velocity_ + 0.5 * instant;
+    scroll_move_time_ = now;
+
+    scroll_pos_ = pos;
+    InvalidateRect(hwnd_, nullptr, FALSE);
+    scheduleScrollThumbnailRequest();
+}
+
+size_t ThumbnailGrid::lookaheadItems(size_t visible_items) const {
+    if (item_height_ <= 0 || columns_ <= 0) {
+        return 0;
+    }
+    double rows = std::abs(scroll_velocity_) * kScrollLookaheadSeconds / item_height_;
+    auto items = static_cast<size_t>(std::ceil(rows)) * columns_;
+    return (std::min)(items, visible_items * kMaxLookaheadScreens);
+}
+
+void ThumbnailGrid::updateViewport(bool settled) {
+    if (items_->empty() || columns_ <= 0 || item_height_ <= 0) {
+        return;
+    }
+
+    RECT client_rect;
+    GetClientRect(hwnd_, &client_rect);
+    int client_height = client_rect.bottom - client_rect.top;
+
+    thumbnail::Viewport viewport;
+    viewport.first = (std::min)(static_cast<size_t>(scroll_pos_ / item_height_) * columns_,
+                                items_->size());
+    viewport.last = (std::min)(
+        static_cast<size_t>((scroll_pos_ + client_height) / item_height_ + 1) * columns_,
+        items_->size());
+
+    if (!settled && scroll_velocity_ != 0.0) {
+        viewport.direction = scroll_velocity_ > 0.0 ? 1 : -1;
+        viewport.velocity = std::abs(scroll_velocity_) / item_height_ * columns_;
+    }
+
+    // Keep one screen on either side, plus what the scroll reaches shortly
+    size_t span = (std::max)(viewport.last - viewport.first, static_cast<size_t>(columns_));
+    size_t lookahead = lookaheadItems(viewport.last - viewport.first);
+    size_t before = span + (viewport.direction < 0 ? lookahead : 0);
+    size_t after = span + (viewport.direction > 0 ? lookahead : 0);
+    viewport.keep_first = viewport.first > before ? viewport.first - before : 0;
+    viewport.keep_last = (std::min)(viewport.last + after, items_->size());
+
+    // Mirror the queue's drop so those items are requested again when they return
+    std::erase_if(requested_, [&viewport](const auto& pending) {
+        return pending.second < viewport.keep_first || pending.second >= viewport.keep_last;
+    });
+
+    if (viewport_changed_callback_) {
+        viewport_changed_callback_(viewport);
+    }
+}
+
+void ThumbnailGrid::trimThumbnails(bool visible_only) {
+    if (items_->empty() || columns_ <= 0 || item_height_ <= 0) {
+        return;
+    }
+
+    RECT client_rect;
+    GetClientRect(hwnd_, &client_rect);
+    int client_height = client_rect.bottom - client_rect.top;
+    size_t first = (std::min)(static_cast<size_t>(scroll_pos_ / item_height_) * columns_,
+                              items_->size());
+    size_t last = (std::min)(
+        static_cast<size_t>((scroll_pos_ + client_height) / item_height_ + 1) * columns_,
+        items_->size());
+
+    // Trim with some slack so each arriving batch does not trigger a pass
+    size_t keep = visible_only
+                      ? last - first
+                      : (std::max)(kMinRetainedThumbnails, (last - first) * kRetainedScreens);
+    size_t slack = visible_only ? 0 : keep / 4;
+    if (thumbnails_.size() <= keep + slack) {
+        return;
+    }
+
+    // The items nearest the viewport: a window of `keep` centered on it
+    size_t center = first + (last - first) / 2;
+    size_t window_first = center > keep / 2 ? center - keep / 2 : 0;
+    size_t window_last = (std::min)(window_first + keep, items_->size());
+    window_first = window_last > keep ? window_last - keep : 0;
+
+    size_t before = thumbnails_.size();
+    std::erase_if(thumbnails_, [this, window_first, window_last](const auto& entry) {
+        size_t row = id_rows_[entry.first];
+        if (row >= window_first && row < window_last) {
+            return false;
+        }
+        atlas_.remove(entry.first);
+        return true;
+    });
+    LOG_DEBUG("trimThumbnails: dropped {} far from the viewport, {} kept",
+              before - thumbnails_.size(), thumbnails_.size());
+    updateMemoryCharges();
+}
+
+void ThumbnailGrid::releaseMemory() {
+    trimThumbnails(true);
+}
+
+void ThumbnailGrid::updateMemoryCharges() {
+    uint64_t pixels = 0;
+    for (const auto& [id, entry] : thumbnails_) {
+        if (entry.source.valid()) {
+            pixels += entry.source.sizeBytes();
+        }
+    }
+    gpu_charge_.set(gpuBitmapBytes());
+    cpu_charge_.set(pixels);
+}
+
+void ThumbnailGrid::resetThumbnailRequests() {
+    // Queued requests carry stale indices or sizes; start over
+    if (thumbnail_cancel_callback_) {
+        thumbnail_cancel_callback_();
+    }
+    requested_.clear();
+}
+
 // --- D2D Resource Management ---
 
 void ThumbnailGrid::createD2DResources() {
@@ -1201,10 +1747,12 @@ void ThumbnailGrid::createD2DResources() {
     selection_text_brush_ = device_resources_.createSolidBrush(selection_text_color);
     text_brush_ = device_resources_.createSolidBrush(text_color);
     placeholder_brush_ = device_resources_.createSolidBrush(d2d::Color::fromRgb(0xE0E0E0));
+    placeholder_tint_brush_ = device_resources_.createSolidBrush(d2d::Color::fromRgb(0xE0E0E0));
     scrollbar_track_brush_ = device_resources_.createSolidBrush(d2d::Color::fromRgb(0xF0F0F0));
     scrollbar_thumb_brush_ = device_resources_.createSolidBrush(d2d::Color::fromRgb(0xC0C0C0));
 
-    // Text format (9pt Segoe UI = 12 DIPs at 96 DPI)
+    // Text format (9pt Segoe UI = 12 DIPs at 96 DPI); layouts copied it
+    captions_.clear();
     text_format_ = device_resources_.createTextFormat(L"Segoe UI", 12.0f);
     if (text_format_) {
         text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
@@ -1221,6 +1769,14 @@ void ThumbnailGrid::createD2DResources() {
             text_format_->SetTrimming(&trimming, ellipsis.Get());
         }
     }
+
+    // Performance overlay: monospace, so the counters stay in columns
+    overlay_bg_brush_ = device_resources_.createSolidBrush(d2d::Color::fromArgb(0xC0202020));
+    overlay_text_brush_ = device_resources_.createSolidBrush(d2d::Color::fromRgb(0xF0F0F0));
+    overlay_format_ = device_resources_.createTextFormat(L"Consolas", 11.0f);
+    if (overlay_format_) {
+        overlay_format_->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+    }
 }
 
 void ThumbnailGrid::discardD2DResources() {
@@ -1230,8 +1786,49 @@ void ThumbnailGrid::discardD2DResources() {
     selection_text_brush_.Reset();
     text_brush_.Reset();
     placeholder_brush_.Reset();
+    placeholder_tint_brush_.Reset();
     scrollbar_track_brush_.Reset();
     scrollbar_thumb_brush_.Reset();
+    overlay_format_.Reset();
+    overlay_bg_brush_.Reset();
+    overlay_text_brush_.Reset();
+    atlas_.reset();
+}
+
+IDWriteTextLayout* ThumbnailGrid::captionLayout(size_t index, const D2D1_RECT_F& text_rect) {
+    // Trimming depends on the box: a new item width or thumbnail size lays out again
+    D2D1_SIZE_F size = D2D1::SizeF(text_rect.right - text_rect.left,
+                                   text_rect.bottom - text_rect.top);
+    if (size.width != caption_size_.width || size.height != caption_size_.height) {
+        captions_.clear();
+        caption_size_ = size;
+    }
+
+    auto& layout = captions_[row_ids_[index]];
+    if (!layout && text_format_) {
+        auto name = (*items_)[index].name();
+        HRESULT hr = d2d::D2DFactory::instance().dwriteFactory()->CreateTextLayout(
+            name.data(), static_cast<UINT32>(name.size()), text_format_.Get(), size.width,
+            size.height, &layout);
+        if (FAILED(hr)) {
+            layout.Reset();
+        }
+    }
+    return layout.Get();
+}
+
+void ThumbnailGrid::trimCaptions(size_t first_visible, size_t last_visible) {
+    // Keep a screen's worth on either side so short scrolls reuse their layouts
+    size_t span = last_visible - first_visible;
+    if (captions_.size() <= 3 * span + kMinRetainedThumbnails) {
+        return;
+    }
+    size_t keep_first = first_visible > span ? first_visible - span : 0;
+    size_t keep_last = last_visible + span;
+    std::erase_if(captions_, [this, keep_first, keep_last](const auto& entry) {
+        size_t row = id_rows_[entry.first];
+        return row < keep_first || row >= keep_last;
+    });
 }
 
 void ThumbnailGrid::recreateThumbnailBitmaps() {
@@ -1239,12 +1836,27 @@ void ThumbnailGrid::recreateThumbnailBitmaps() {
         return;
     }
 
+    // Bitmaps and atlas pages belong to the old target. Pixels not uploaded
+    // yet are still here; the rest are requested again, from the cache
+    atlas_.reset();
     auto* rt = device_resources_.renderTarget();
-    for (auto& [key, entry] : thumbnails_) {
-        if (entry.source.valid()) {
+    for (auto it = thumbnails_.begin(); it != thumbnails_.end();) {
+        auto& entry = it->second;
+        entry.bitmap.Reset();
+        entry.staged.Reset();
+        if (!entry.source.valid()) {
+            it = thumbnails_.erase(it);
+            continue;
+        }
+        if (!d2d::ThumbnailAtlas::fits(entry.source)) {
             entry.bitmap = d2d::createBitmapFromDecodedImage(rt, entry.source);
+            if (entry.bitmap) {
+                entry.source = image::DecodedImage{};
+            }
         }
+        ++it;
     }
+    requestVisibleThumbnails();
 }
 
 // --- Custom Scrollbar ---
@@ -1264,7 +1876,7 @@ d2d::Rect ThumbnailGrid::scrollbarThumbRect() const {
     GetClientRect(hwnd_, &rc);
     float view_height = static_cast<float>(rc.bottom - rc.top);
 
-    int total_rows = (static_cast<int>(items_.size()) + columns_ - 1) / columns_;
+    int total_rows = (static_cast<int>(items_->size()) + columns_ - 1) / columns_;
     float content_height = static_cast<float>(total_rows * item_height_);
 
     if (content_height <= view_height) {
@@ -1280,6 +1892,54 @@ d2d::Rect ThumbnailGrid::scrollbarThumbRect() const {
     return d2d::Rect{track.x, thumb_y, track.width, thumb_height};
 }
 
+// --- Performance overlay ---
+
+D2D1_RECT_F ThumbnailGrid::perfOverlayRect() const {
+    RECT rc;
+    GetClientRect(hwnd_, &rc);
+    float right = static_cast<float>(rc.right) - kOverlayMargin;
+    if (max_scroll_ > 0) {
+        right -= kScrollbarWidth;
+    }
+    return D2D1::RectF(right - kOverlayWidth, kOverlayMargin, right,
+                       kOverlayMargin + kOverlayHeight);
+}
+
+void ThumbnailGrid::renderPerfOverlay(ID2D1RenderTarget* rt) {
+    if (!overlay_format_ || !overlay_bg_brush_ || !overlay_text_brush_) {
+        return;
+    }
+    auto area = perfOverlayRect();
+    rt->FillRoundedRectangle(D2D1::RoundedRect(area, 4.0f, 4.0f), overlay_bg_brush_.Get());
+    auto text = D2D1::RectF(area.left + 8.0f, area.top + 6.0f, area.right - 8.0f,
+                            area.bottom - 6.0f);
+    rt->DrawTextW(perf_overlay_text_.data(), static_cast<UINT32>(perf_overlay_text_.size()),
+                  overlay_format_.Get(), text, overlay_text_brush_.Get(),
+                  D2D1_DRAW_TEXT_OPTIONS_CLIP);
+}
+
+void ThumbnailGrid::recordFrame(std::chrono::steady_clock::time_point start, bool animating) {
+    // Animation frames follow the timer, which ticks no faster than the system timer
+    constexpr double kTimerTickMs = 15.625;
+
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    ++frame_stats_.frames;
+    frame_total_ms_ += ms;
+    frame_stats_.max_ms = (std::max)(frame_stats_.max_ms, ms);
+
+    // While scrolling animates every tick should paint; a longer gap was not shown
+    if (animating && last_animation_frame_ != std::chrono::steady_clock::time_point{}) {
+        double gap = std::chrono::duration<double, std::milli>(now - last_animation_frame_).count();
+        double interval = (std::max)(refresh_period_ms_, kTimerTickMs);
+        auto frames = static_cast<uint32_t>(gap / interval + 0.5);
+        if (frames > 1) {
+            frame_stats_.dropped += frames - 1;
+        }
+    }
+    last_animation_frame_ = animating ? now : std::chrono::steady_clock::time_point{};
+}
+
 void ThumbnailGrid::renderScrollbar(ID2D1RenderTarget* rt) {
     d2d::Rect track = scrollbarTrackRect();
     d2d::Rect thumb = scrollbarThumbRect();
@@ -8,17 +8,26 @@
 #include <d2d1.h>
 #include <dwrite.h>
 
+#include <chrono>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "core/archive/virtual_path.hpp"
+#include "core/fs/directory_model.hpp"
 #include "core/fs/file_metadata.hpp"
+#include "core/fs/index_set.hpp"
 #include "core/image/decoded_image.hpp"
+#include "core/thumbnail/thumbnail_request.hpp"
 #include "core/util/com_ptr.hpp"
+#include "core/util/memory_accounting.hpp"
 #include "ui/d2d/components/editbox.hpp"
 #include "ui/d2d/core/device_resources.hpp"
+#include "ui/d2d/core/gpu_device.hpp"
+#include "ui/d2d/core/thumbnail_atlas.hpp"
 #include "ui/d2d/core/types.hpp"
 
 namespace nive::ui {
@@ -30,9 +39,10 @@ namespace nive::ui {
 class ThumbnailGrid {
 public:
     using ItemActivatedCallback = std::function<void(size_t index)>;
-    using SelectionChangedCallback = std::function<void(const std::vector<size_t>&)>;
-    using ThumbnailRequestCallback = std::function<void(const archive::VirtualPath&)>;
+    using SelectionChangedCallback = std::function<void(const fs::IndexSet&)>;
+    using ThumbnailRequestCallback = std::function<void(const fs::FileMetadata&, size_t index)>;
     using ThumbnailCancelCallback = std::function<void()>;
+    using ViewportChangedCallback = std::function<void(const thumbnail::Viewport&)>;
     using DragStartCallback = std::function<void(const std::vector<std::filesystem::path>&)>;
     using DeleteRequestedCallback = std::function<void(const std::vector<std::filesystem::path>&)>;
     using RenameRequestedCallback = std::function<void(size_t index, const std::wstring& new_name)>;
@@ -54,16 +64,77 @@ public:
     void setBounds(int x, int y, int width, int height);
 
     /// @brief Set items to display
-    void setItems(const std::vector<fs::FileMetadata>& items, bool preserve_scroll = false);
+    /// @param items Listing to show; shared with the state, not copied
+    void setItems(std::shared_ptr<const fs::DirectoryModel> items, bool preserve_scroll = false);
+
+    /// @brief Append items, keeping scroll position, selection and loaded thumbnails
+    /// @param items The current items followed by the new ones (see DirectoryModel::append)
+    void appendItems(std::shared_ptr<const fs::DirectoryModel> items);
+
+    /// @brief Replace items with a reordering of the same entries
+    ///
+    /// Loaded thumbnails are keyed by item id, which follows the source
+    /// identifier, and survive the reorder; selection is reset because
+    /// indices no longer match.
+    void reorderItems(std::shared_ptr<const fs::DirectoryModel> items);
+
+    /// @brief Replace items after a few entries were added, removed or replaced
+    /// @param delta Rows that changed from the current items; null if unknown
+    ///
+    /// Like reorderItems(), but thumbnails of entries no longer listed are
+    /// dropped. The scroll position is kept. With a delta, only rows from the
+    /// first change on are indexed again and the selection, focus and anchor
+    /// follow their rows; updates in place keep the queued thumbnail requests.
+    void patchItems(std::shared_ptr<const fs::DirectoryModel> items,
+                    const fs::ModelDelta* delta = nullptr);
+
+    /// @brief Thumbnail for one file, as passed to setThumbnails()
+    struct ThumbnailUpdate {
+        PathId id = kNoPathId;  // Interned path (see ThumbnailResult::path_id)
+        image::DecodedImage image;
+        d2d::StagedBitmap staged;  // Optional upload of image made off the UI thread
+        bool preview = false;  // Fast first pass; the refined thumbnail follows
+        uint64_t request_id = 0;  // For trace events (see etw::uiUpload)
+    };
 
     /// @brief Set thumbnail for a file
     void setThumbnail(const std::filesystem::path& path, image::DecodedImage thumbnail);
 
+    /// @brief Set thumbnails for several files, then invalidate once
+    /// @param thumbnails Thumbnails to show
+    ///
+    /// A preview keeps the item's request pending until the refined
+    /// thumbnail replaces it, and never replaces a refined thumbnail.
+    void setThumbnails(std::vector<ThumbnailUpdate> thumbnails);
+
+    /// @brief Cached summary of a file, drawn until its thumbnail loads
+    struct Placeholder {
+        std::filesystem::path path;  // sourceIdentifier form
+        uint32_t width = 0;          // Original size: the placeholder takes its shape
+        uint32_t height = 0;
+        uint32_t color = 0;  // Average colour of the thumbnail, 0xRRGGBB
+    };
+
+    /// @brief Set placeholders for listed files
+    ///
+    /// They are kept until setItems() lists other files, so a thumbnail
+    /// dropped from memory falls back to its placeholder again.
+    void setPlaceholders(const std::vector<Placeholder>& placeholders);
+
     /// @brief Clear all thumbnails
     void clearThumbnails();
 
+    /// @brief Drop every thumbnail outside the viewport, for low memory
+    ///
+    /// They are requested again (from the cache) when scrolled back into view.
+    void releaseMemory();
+
+    /// @brief Drop the thumbnails of files whose contents changed
+    /// @param paths Source paths (sourceIdentifier form)
+    void discardThumbnails(const std::vector<std::filesystem::path>& paths);
+
     /// @brief Get item count
-    [[nodiscard]] size_t itemCount() const noexcept { return items_.size(); }
+    [[nodiscard]] size_t itemCount() const noexcept { return items_->size(); }
 
     /// @brief Get thumbnail count (loaded thumbnails)
     [[nodiscard]] size_t thumbnailCount() const noexcept { return thumbnails_.size(); }
@@ -75,10 +146,10 @@ public:
     [[nodiscard]] int thumbnailSize() const noexcept { return thumbnail_size_; }
 
     /// @brief Get selected indices
-    [[nodiscard]] std::vector<size_t> selectedIndices() const;
+    [[nodiscard]] const fs::IndexSet& selectedIndices() const noexcept { return selected_; }
 
-    /// @brief Set selection
-    void setSelection(const std::vector<size_t>& indices);
+    /// @brief Set selection; indices past the items are dropped
+    void setSelection(const fs::IndexSet& indices);
 
     /// @brief Select single item
     void selectSingle(size_t index);
@@ -89,6 +160,15 @@ public:
     /// @brief Ensure item is visible
     void ensureVisible(size_t index);
 
+    /// @brief Scroll so the item's row is at the top of the view
+    void scrollToIndex(size_t index);
+
+    /// @brief Get index of the first item in the topmost visible row
+    [[nodiscard]] size_t firstVisibleIndex() const;
+
+    /// @brief Get number of items that fit on one screen (partial rows included)
+    [[nodiscard]] size_t visibleCapacity() const;
+
     /// @brief Set callbacks
     void onItemActivated(ItemActivatedCallback callback) {
         item_activated_callback_ = std::move(callback);
@@ -106,6 +186,10 @@ public:
         thumbnail_cancel_callback_ = std::move(callback);
     }
 
+    void onViewportChanged(ViewportChangedCallback callback) {
+        viewport_changed_callback_ = std::move(callback);
+    }
+
     void onDragStart(DragStartCallback callback) { drag_start_callback_ = std::move(callback); }
 
     void onDeleteRequested(DeleteRequestedCallback callback) {
@@ -131,13 +215,51 @@ public:
     /// @brief Refresh display
     void refresh();
 
+    /// @brief Paint timing since the previous takeFrameStats() call
+    struct FrameStats {
+        uint32_t frames = 0;
+        double mean_ms = 0.0;  // BeginPaint to Present
+        double max_ms = 0.0;
+        uint32_t dropped = 0;  // Refreshes missed between frames of a scroll animation
+    };
+
+    /// @brief Get the paint timing and start counting again
+    [[nodiscard]] FrameStats takeFrameStats();
+
+    /// @brief Get the bytes of GPU bitmaps held: atlas pages and thumbnails drawn on their own
+    [[nodiscard]] uint64_t gpuBitmapBytes() const;
+
+    /// @brief Show or hide the performance overlay in the top right corner
+    void setPerfOverlayVisible(bool visible);
+
+    [[nodiscard]] bool perfOverlayVisible() const noexcept { return perf_overlay_visible_; }
+
+    /// @brief Set the counters the overlay shows, one per line
+    void setPerfOverlayText(std::wstring text);
+
 private:
-    /// @brief Cached thumbnail with D2D bitmap and source data for device-lost recreation
+    /// @brief Thumbnail on the GPU, with its pixels only until they are uploaded
+    ///
+    /// After device loss, or once the atlas reuses its slot, an entry with no
+    /// pixels left is dropped and requested again (the cache answers).
     struct ThumbnailEntry {
-        ComPtr<ID2D1Bitmap> bitmap;
-        image::DecodedImage source;
+        ComPtr<ID2D1Bitmap> bitmap;  // Only for images the atlas cannot hold
+        ComPtr<ID2D1Bitmap> staged;  // Padded worker upload, until copied into the atlas
+        image::DecodedImage source;  // Empty once uploaded
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t level = 0;  // Cached level requested for (see App::thumbnailLevel)
     };
 
+    // Thumbnails kept around the viewport: the larger of this and
+    // kRetainedScreens screens' worth of items; farther ones are dropped
+    static constexpr size_t kMinRetainedThumbnails = 1024;
+    static constexpr size_t kRetainedScreens = 4;
+
+    // Level of a progressive preview: matches no cached level, so the item
+    // is requested again if its refined pass is dropped from the queue
+    static constexpr uint32_t kPreviewLevel = 0;
+
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
     LRESULT handleMessage(UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -165,30 +287,93 @@ private:
     void updateScrollbar();
     size_t hitTest(int x, int y) const;
     RECT getItemRect(size_t index) const;
-    void requestVisibleThumbnails();
+    void requestVisibleThumbnails(size_t from_index = 0);
     void scheduleScrollThumbnailRequest();
 
+    /// @brief Ease the scroll position towards a target over the next frames
+    void smoothScrollTo(int target);
+
+    /// @brief Advance the scroll animation (kScrollAnimationTimerId)
+    void stepScrollAnimation();
+
+    /// @brief Move to a scroll position, tracking velocity and requesting what comes into view
+    void setScrollPosition(int pos);
+
+    /// @brief Get the number of items the scroll reaches within kScrollLookaheadSeconds
+    [[nodiscard]] size_t lookaheadItems(size_t visible_items) const;
+    void updateViewport(bool settled);
+    void resetThumbnailRequests();
+    /// @brief Drop thumbnails far from the viewport
+    /// @param visible_only Keep only the visible rows, not the usual margin around them
+    void trimThumbnails(bool visible_only = false);
+
+    /// @brief Charge the GPU bitmaps and the pixels still waiting for upload
+    void updateMemoryCharges();
+
+    /// @brief Give rows from first on their item ids, assigning ids to new source identifiers
+    void indexItems(size_t first);
+
     // D2D resource management
     void createD2DResources();
     void discardD2DResources();
     void recreateThumbnailBitmaps();
 
+    /// @brief Get the caption layout of an item, laying it out on first use
+    /// @param index Row index
+    /// @param text_rect Caption rectangle (see getTextRect)
+    /// @return Layout, or nullptr if DirectWrite failed
+    IDWriteTextLayout* captionLayout(size_t index, const D2D1_RECT_F& text_rect);
+
+    /// @brief Drop caption layouts of items far from the visible rows
+    void trimCaptions(size_t first_visible, size_t last_visible);
+
     // Custom scrollbar
     [[nodiscard]] d2d::Rect scrollbarTrackRect() const;
     [[nodiscard]] d2d::Rect scrollbarThumbRect() const;
     void renderScrollbar(ID2D1RenderTarget* rt);
 
+    // Performance overlay
+    [[nodiscard]] D2D1_RECT_F perfOverlayRect() const;
+    void renderPerfOverlay(ID2D1RenderTarget* rt);
+    void recordFrame(std::chrono::steady_clock::time_point start, bool animating);
+
     // Aspect-ratio fit calculation (float-based for D2D)
     [[nodiscard]] D2D1_RECT_F calculateFitRectF(const D2D1_RECT_F& container, float img_w,
                                                  float img_h) const;
 
     HWND hwnd_ = nullptr;
 
-    std::vector<fs::FileMetadata> items_;
-    std::unordered_map<std::wstring, ThumbnailEntry> thumbnails_;
+    std::shared_ptr<const fs::DirectoryModel> items_ = std::make_shared<fs::DirectoryModel>();
+    // Compact item ids, one per source identifier listed since setItems(),
+    // so thumbnails, placeholders and the atlas key on a dense index; looked
+    // up by interned path, so results find their item without a string
+    using ItemId = uint32_t;
+    std::unordered_map<PathId, ItemId> item_ids_;
+    std::vector<ItemId> row_ids_;  // Row index -> id
+    std::vector<size_t> id_rows_;  // Id -> row index, SIZE_MAX when no longer listed
+
+    std::unordered_map<ItemId, ThumbnailEntry> thumbnails_;
+    // Shape and colour drawn for items without a thumbnail (see setPlaceholders)
+    struct PlaceholderEntry {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t color = 0;
+    };
+    std::unordered_map<ItemId, PlaceholderEntry> placeholders_;
+    // Items with a request queued or in flight, by id -> index
+    std::unordered_map<ItemId, size_t> requested_;
+
+    // Scroll motion: scroll_pos_ eases towards scroll_target_ while animating
+    int scroll_target_ = 0;
+    double scroll_exact_ = 0.0;      // Sub-pixel position of the animation
+    double scroll_velocity_ = 0.0;   // Pixels per second, positive towards the end
+    bool scroll_animating_ = false;
+    std::chrono::steady_clock::time_point scroll_step_time_;  // Last animation step
+    std::chrono::steady_clock::time_point scroll_move_time_;  // Last position change
 
     // D2D rendering
     d2d::DeviceResources device_resources_;
+    d2d::ThumbnailAtlas atlas_;  // GPU copies of thumbnails, keyed like thumbnails_
     uint32_t last_resource_epoch_ = 0;
     d2d::Color bg_color_;
 
@@ -198,11 +383,15 @@ private:
     ComPtr<ID2D1SolidColorBrush> selection_text_brush_;
     ComPtr<ID2D1SolidColorBrush> text_brush_;
     ComPtr<ID2D1SolidColorBrush> placeholder_brush_;
+    ComPtr<ID2D1SolidColorBrush> placeholder_tint_brush_;  // Recoloured per placeholder
     ComPtr<ID2D1SolidColorBrush> scrollbar_track_brush_;
     ComPtr<ID2D1SolidColorBrush> scrollbar_thumb_brush_;
 
     // DirectWrite text format
     ComPtr<IDWriteTextFormat> text_format_;
+    // Laid-out, trimmed names by item id; all captions share caption_size_
+    std::unordered_map<ItemId, ComPtr<IDWriteTextLayout>> captions_;
+    D2D1_SIZE_F caption_size_{};
 
     // Layout
     int thumbnail_size_ = 128;
@@ -214,7 +403,7 @@ private:
     int max_scroll_ = 0;
 
     // Selection
-    std::vector<bool> selected_;
+    fs::IndexSet selected_;
     size_t focused_index_ = SIZE_MAX;
     size_t anchor_index_ = SIZE_MAX;
 
@@ -223,6 +412,7 @@ private:
     SelectionChangedCallback selection_changed_callback_;
     ThumbnailRequestCallback thumbnail_request_callback_;
     ThumbnailCancelCallback thumbnail_cancel_callback_;
+    ViewportChangedCallback viewport_changed_callback_;
     DragStartCallback drag_start_callback_;
     DeleteRequestedCallback delete_requested_callback_;
     RenameRequestedCallback rename_requested_callback_;
@@ -248,10 +438,38 @@ private:
     float scrollbar_drag_start_y_ = 0.0f;
     static constexpr float kScrollbarWidth = 12.0f;
 
-    // Scroll debounce timer
+    // Performance overlay: text from setPerfOverlayText(), paint timing kept here
+    bool perf_overlay_visible_ = false;
+    std::wstring perf_overlay_text_;
+    ComPtr<IDWriteTextFormat> overlay_format_;
+    ComPtr<ID2D1SolidColorBrush> overlay_bg_brush_;
+    ComPtr<ID2D1SolidColorBrush> overlay_text_brush_;
+    FrameStats frame_stats_;
+    double frame_total_ms_ = 0.0;
+    double refresh_period_ms_ = 1000.0 / 60.0;
+    std::chrono::steady_clock::time_point last_animation_frame_;
+    // Pixels may be views of cache entries, so the two can count the same bytes
+    MemoryCharge gpu_charge_{MemoryCategory::GridBitmaps};
+    MemoryCharge cpu_charge_{MemoryCategory::GridPixels};
+    static constexpr float kOverlayWidth = 300.0f;
+    static constexpr float kOverlayHeight = 130.0f;
+    static constexpr float kOverlayMargin = 8.0f;
+
+    // Scroll debounce timer: once it fires the scroll counts as settled
     static constexpr UINT_PTR kScrollDebounceTimerId = 1;
     static constexpr UINT kScrollDebounceMs = 150;
 
+    // Smooth scrolling: steps at the timer's finest resolution, closing the
+    // distance to the target with this time constant
+    static constexpr UINT_PTR kScrollAnimationTimerId = 3;
+    static constexpr UINT kScrollAnimationMs = USER_TIMER_MINIMUM;
+    static constexpr double kScrollSmoothingSeconds = 0.06;
+
+    // Time ahead of a scroll whose rows are requested and kept queued, and
+    // the most screens that may cover
+    static constexpr double kScrollLookaheadSeconds = 0.5;
+    static constexpr size_t kMaxLookaheadScreens = 4;
+
     static constexpr int kItemPadding = 8;
     static constexpr int kTextHeight = 32;
 };
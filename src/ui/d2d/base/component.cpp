@@ -10,7 +10,12 @@ namespace nive::ui::d2d {
 D2DUIComponent::D2DUIComponent() = default;
 
 void D2DUIComponent::arrange(const Rect& bounds) {
+    if (bounds_ == bounds) {
+        return;
+    }
+    invalidate();
     bounds_ = bounds;
+    invalidate();
 }
 
 void D2DUIComponent::setVisible(bool visible) {
@@ -60,9 +65,16 @@ bool D2DUIComponent::hitTest(const Point& point) const {
 }
 
 void D2DUIComponent::invalidate() {
-    onInvalidate();
+    invalidateRect(paintBounds());
+}
+
+void D2DUIComponent::invalidateRect(const Rect& area) {
+    if (area.isEmpty()) {
+        return;  // Not arranged yet
+    }
+    onInvalidate(area);
     if (parent_) {
-        parent_->invalidate();
+        parent_->invalidateRect(area);
     }
 }
 
@@ -159,9 +171,21 @@ void D2DContainerComponent::render(ID2D1RenderTarget* rt) {
     renderChildren(rt);
 }
 
+Rect D2DContainerComponent::paintArea() const {
+    if (parent_) {
+        return parent_->paintArea();
+    }
+    // Not in a dialog: paint everything
+    return Rect{-1e9f, -1e9f, 2e9f, 2e9f};
+}
+
 void D2DContainerComponent::renderChildren(ID2D1RenderTarget* rt) {
+    // Anti-aliased edges reach half a pixel past the bounds
+    constexpr float kEdgeMargin = 1.0f;
+    Rect area = paintArea();
     for (const auto& child : children_) {
-        if (child->isVisible()) {
+        if (child->isVisible() &&
+            child->paintBounds().inflated(kEdgeMargin, kEdgeMargin).intersects(area)) {
             child->render(rt);
         }
     }
@@ -25,6 +25,10 @@ class D2DContainerComponent;
 /// 1. measure() - Calculate desired size given constraints
 /// 2. arrange() - Position within allocated bounds
 /// 3. render() - Draw to render target
+///
+/// invalidate() marks only the component's paintBounds() dirty. The dirty
+/// rectangles travel up to the dialog, which repaints their union, and
+/// containers skip children outside the part being painted.
 class D2DUIComponent {
 public:
     virtual ~D2DUIComponent() = default;
@@ -41,6 +45,8 @@ public:
 
     /// @brief Arrange the component within its allocated bounds
     /// @param bounds Rectangle to position within
+    ///
+    /// Moving the component invalidates where it was and where it goes.
     virtual void arrange(const Rect& bounds);
 
     /// @brief Render the component
@@ -109,15 +115,25 @@ public:
     /// @return Win32 cursor handle, or nullptr for default arrow cursor
     [[nodiscard]] virtual HCURSOR cursor() const { return nullptr; }
 
-    /// @brief Invalidate the component (request repaint)
+    /// @brief Get the area the component draws in (absolute DIPs)
+    ///
+    /// The bounds, unless the component draws outside them (a dropdown).
+    [[nodiscard]] virtual Rect paintBounds() const { return bounds_; }
+
+    /// @brief Invalidate the component (request repaint of its paintBounds())
     void invalidate();
 
+    /// @brief Request repaint of an area
+    /// @param area Rectangle in absolute DIPs
+    void invalidateRect(const Rect& area);
+
 protected:
     D2DUIComponent();
 
-    /// @brief Called when the component needs to invalidate itself
+    /// @brief Called when an area of this component or a descendant is invalidated
+    /// @param area Rectangle in absolute DIPs
     /// Subclasses can override to add custom invalidation logic
-    virtual void onInvalidate() {}
+    virtual void onInvalidate(const Rect& area) {}
 
     /// @brief Get the content area (bounds minus padding)
     [[nodiscard]] Rect contentBounds() const noexcept;
@@ -204,7 +220,12 @@ protected:
         }
     }
 
-    /// @brief Render children
+    /// @brief Get the part of the dialog the current frame redraws (absolute DIPs)
+    ///
+    /// Asked of the parent by default; the dialog at the root answers.
+    [[nodiscard]] virtual Rect paintArea() const;
+
+    /// @brief Render the visible children that intersect paintArea()
     void renderChildren(ID2D1RenderTarget* rt);
 
     /// @brief Transform event coordinates for child
@@ -21,6 +21,7 @@ void D2DComboBox::addItems(const std::vector<std::wstring>& items) {
 
 void D2DComboBox::clearItems() {
     items_.clear();
+    item_layouts_.clear();
     selected_index_ = -1;
     hovered_item_ = -1;
     text_layout_.Reset();
@@ -67,9 +68,9 @@ void D2DComboBox::openDropdown() {
 
 void D2DComboBox::closeDropdown() {
     if (dropdown_open_) {
+        invalidate();  // While paintBounds() still covers the dropdown
         dropdown_open_ = false;
         hovered_item_ = -1;
-        invalidate();
     }
 }
 
@@ -81,6 +82,10 @@ void D2DComboBox::toggleDropdown() {
     }
 }
 
+Rect D2DComboBox::paintBounds() const {
+    return dropdown_open_ ? bounds_.united(dropdownRect()) : bounds_;
+}
+
 Rect D2DComboBox::dropdownRect() const {
     if (items_.empty()) {
         return {};
@@ -240,10 +245,9 @@ void D2DComboBox::renderDropdown(ID2D1RenderTarget* rt) {
         }
 
         // Draw item text
-        ComPtr<IDWriteTextLayout> item_layout;
-        D2DFactory::instance().dwriteFactory()->CreateTextLayout(
-            items_[i].c_str(), static_cast<UINT32>(items_[i].length()), text_format_.Get(),
-            dropdown.width - padding.left - padding.right, item_height, &item_layout);
+        auto item_layout = item_layouts_.get(i, items_[i], text_format_.Get(),
+                                             dropdown.width - padding.left - padding.right,
+                                             item_height);
 
         if (item_layout) {
             ID2D1SolidColorBrush* brush = (static_cast<int>(i) == selected_index_)
@@ -391,14 +395,17 @@ void D2DComboBox::onFocusChanged(const FocusEvent& event) {
 }
 
 void D2DComboBox::createResources(DeviceResources& resources) {
-    // Create text format
-    D2DFactory::instance().dwriteFactory()->CreateTextFormat(
-        Style::fontFamily(), nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL, Style::fontSize(), L"", &text_format_);
-
-    if (text_format_) {
-        text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
-        text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+    // The text format is device-independent, so it and the layouts built on
+    // it outlive device loss; only the brushes are recreated
+    if (!text_format_) {
+        D2DFactory::instance().dwriteFactory()->CreateTextFormat(
+            Style::fontFamily(), nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
+            DWRITE_FONT_STRETCH_NORMAL, Style::fontSize(), L"", &text_format_);
+
+        if (text_format_) {
+            text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
+            text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+        }
     }
 
     // Create brushes
@@ -412,7 +419,16 @@ void D2DComboBox::createResources(DeviceResources& resources) {
     selected_item_brush_ = resources.createSolidBrush(Style::selectedItemBackground());
     selected_item_text_brush_ = resources.createSolidBrush(Style::selectedItemTextColor());
 
-    updateTextLayout();
+    // Rebuilt only when missing or the box was resized since
+    if (!text_layout_ || text_layout_->GetMaxWidth() != textLayoutWidth()) {
+        updateTextLayout();
+    }
+}
+
+float D2DComboBox::textLayoutWidth() const {
+    Thickness padding = Style::padding();
+    float layout_width = bounds_.width - padding.left - padding.right - Style::arrowWidth();
+    return layout_width > 0 ? layout_width : 100.0f;
 }
 
 void D2DComboBox::updateTextLayout() {
@@ -424,14 +440,9 @@ void D2DComboBox::updateTextLayout() {
 
     std::wstring display_text = selectedText();
     if (!display_text.empty()) {
-        Thickness padding = Style::padding();
-        float layout_width = bounds_.width - padding.left - padding.right - Style::arrowWidth();
-        if (layout_width <= 0)
-            layout_width = 100.0f;
-
         D2DFactory::instance().dwriteFactory()->CreateTextLayout(
             display_text.c_str(), static_cast<UINT32>(display_text.length()), text_format_.Get(),
-            layout_width, Style::height(), &text_layout_);
+            textLayoutWidth(), Style::height(), &text_layout_);
     }
 }
 
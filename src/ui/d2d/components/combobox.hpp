@@ -12,6 +12,7 @@
 
 #include "ui/d2d/base/component.hpp"
 #include "ui/d2d/core/device_resources.hpp"
+#include "ui/d2d/core/text_layout_cache.hpp"
 #include "ui/d2d/styles/default_style.hpp"
 
 namespace nive::ui::d2d {
@@ -142,6 +143,9 @@ public:
     Size measure(const Size& available_size) override;
     void render(ID2D1RenderTarget* rt) override;
 
+    /// @brief Get the bounds, with the dropdown while it is open
+    [[nodiscard]] Rect paintBounds() const override;
+
     /// @brief Render the dropdown list (called by dialog for popup layer)
     void renderDropdown(ID2D1RenderTarget* rt);
 
@@ -156,6 +160,7 @@ public:
 
 private:
     void updateTextLayout();
+    [[nodiscard]] float textLayoutWidth() const;
     void renderArrow(ID2D1RenderTarget* rt, const Rect& arrow_rect);
 
     std::vector<std::wstring> items_;
@@ -168,6 +173,7 @@ private:
     // DirectWrite resources
     ComPtr<IDWriteTextFormat> text_format_;
     ComPtr<IDWriteTextLayout> text_layout_;
+    TextLayoutCache item_layouts_;  // Dropdown items
 
     // Brushes
     ComPtr<ID2D1SolidColorBrush> background_brush_;
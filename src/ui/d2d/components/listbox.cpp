@@ -28,6 +28,7 @@ void D2DListBox::insertItem(size_t index, const std::wstring& text) {
         items_.push_back(text);
     } else {
         items_.insert(items_.begin() + static_cast<ptrdiff_t>(index), text);
+        item_layouts_.clear();  // Later items moved
     }
 
     // Adjust selection if needed
@@ -44,6 +45,7 @@ void D2DListBox::removeItem(size_t index) {
     }
 
     items_.erase(items_.begin() + static_cast<ptrdiff_t>(index));
+    item_layouts_.clear();  // Later items moved
 
     // Adjust selection
     if (selected_index_ >= 0) {
@@ -66,6 +68,7 @@ void D2DListBox::removeItem(size_t index) {
 
 void D2DListBox::clearItems() {
     items_.clear();
+    item_layouts_.clear();
     selected_index_ = -1;
     hovered_index_ = -1;
     scroll_offset_ = 0.0f;
@@ -171,26 +174,16 @@ void D2DListBox::render(ID2D1RenderTarget* rt) {
 
     rt->PushAxisAlignedClip(clip_rect, D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
 
-    // Draw items
+    // Draw the visible items only, from the first one the scroll offset reaches
     float item_height = Style::itemHeight();
     float item_padding = Style::itemPadding();
-    float y = content.y - scroll_offset_;
+    auto first = static_cast<size_t>(std::max(scroll_offset_, 0.0f) / item_height);
+    float y = content.y - scroll_offset_ + static_cast<float>(first) * item_height;
 
     Color text_color = enabled_ ? Style::textColor() : Style::disabledTextColor();
     text_brush_->SetColor(text_color.toD2D());
 
-    for (size_t i = 0; i < items_.size(); ++i) {
-        // Skip items above visible area
-        if (y + item_height <= content.y) {
-            y += item_height;
-            continue;
-        }
-
-        // Stop if below visible area
-        if (y >= content.y + content.height) {
-            break;
-        }
-
+    for (size_t i = first; i < items_.size() && y < content.y + content.height; ++i) {
         D2D1_RECT_F item_rect =
             D2D1::RectF(content.x, y, content.x + content.width, y + item_height);
 
@@ -202,10 +195,8 @@ void D2DListBox::render(ID2D1RenderTarget* rt) {
         }
 
         // Draw item text
-        ComPtr<IDWriteTextLayout> item_layout;
-        D2DFactory::instance().dwriteFactory()->CreateTextLayout(
-            items_[i].c_str(), static_cast<UINT32>(items_[i].length()), text_format_.Get(),
-            content.width - item_padding * 2, item_height, &item_layout);
+        auto item_layout = item_layouts_.get(i, items_[i], text_format_.Get(),
+                                             content.width - item_padding * 2, item_height);
 
         if (item_layout) {
             ID2D1SolidColorBrush* brush = (static_cast<int>(i) == selected_index_)
@@ -464,14 +455,17 @@ void D2DListBox::onFocusChanged(const FocusEvent& event) {
 }
 
 void D2DListBox::createResources(DeviceResources& resources) {
-    // Create text format
-    D2DFactory::instance().dwriteFactory()->CreateTextFormat(
-        Style::fontFamily(), nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL, Style::fontSize(), L"", &text_format_);
-
-    if (text_format_) {
-        text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
-        text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+    // The text format is device-independent, so it and the item layouts
+    // built on it outlive device loss; only the brushes are recreated
+    if (!text_format_) {
+        D2DFactory::instance().dwriteFactory()->CreateTextFormat(
+            Style::fontFamily(), nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
+            DWRITE_FONT_STRETCH_NORMAL, Style::fontSize(), L"", &text_format_);
+
+        if (text_format_) {
+            text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
+            text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+        }
     }
 
     // Create brushes
@@ -12,6 +12,7 @@
 
 #include "ui/d2d/base/component.hpp"
 #include "ui/d2d/core/device_resources.hpp"
+#include "ui/d2d/core/text_layout_cache.hpp"
 #include "ui/d2d/styles/default_style.hpp"
 
 namespace nive::ui::d2d {
@@ -60,7 +61,8 @@ struct StyleTraits<D2DListBox> {
 
 /// @brief List box component for displaying and selecting items
 ///
-/// Supports single selection, keyboard navigation, and scrolling.
+/// Supports single selection, keyboard navigation, and scrolling. Only the
+/// visible rows are drawn, and their text layouts are kept across frames.
 class D2DListBox : public D2DUIComponent {
 public:
     using Style = StyleTraits<D2DListBox>;
@@ -164,6 +166,7 @@ private:
 
     // DirectWrite resources
     ComPtr<IDWriteTextFormat> text_format_;
+    TextLayoutCache item_layouts_;
 
     // Brushes
     ComPtr<ID2D1SolidColorBrush> background_brush_;
@@ -3,18 +3,44 @@
 
 #include "bitmap_utils.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include "core/image/decoded_image.hpp"
+#include "core/image/pixel_convert.hpp"
 
 namespace nive::ui::d2d {
 
-ComPtr<ID2D1Bitmap> createBitmapFromDecodedImage(ID2D1RenderTarget* rt,
-                                                  const image::DecodedImage& image) {
+ComPtr<ID2D1Bitmap> createBitmapFromDecodedImage(ID2D1RenderTarget* rt, image::ImageView image) {
     if (!rt || !image.valid()) {
         return nullptr;
     }
 
+    // D2D has no 24-bit or 8-bit color formats: widen other 8-bit layouts to BGRA first
+    if (image.format() != image::PixelFormat::BGRA32 &&
+        image::canConvertPixels(image.format(), image::PixelFormat::BGRA32)) {
+        image::DecodedImage bgra(image.width(), image.height(), image::PixelFormat::BGRA32);
+        image::convertPixels(image.data(), image.stride(), image.format(), bgra.data(),
+                             bgra.stride(), image::PixelFormat::BGRA32, image.width(),
+                             image.height());
+        return createBitmapFromDecodedImage(rt, bgra);
+    }
+
+    DXGI_FORMAT format;
+    switch (image.format()) {
+    case image::PixelFormat::BGRA32:
+        format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        break;
+    case image::PixelFormat::RGBA16F:
+        // Needs a D2D 1.1 render target (Windows 8+); CreateBitmap fails otherwise
+        format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        break;
+    default:
+        return nullptr;
+    }
+
     D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
-        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), 96.0f, 96.0f);
+        D2D1::PixelFormat(format, D2D1_ALPHA_MODE_PREMULTIPLIED), 96.0f, 96.0f);
 
     ComPtr<ID2D1Bitmap> bitmap;
     HRESULT hr = rt->CreateBitmap(D2D1::SizeU(image.width(), image.height()), image.data(),
@@ -27,4 +53,31 @@ ComPtr<ID2D1Bitmap> createBitmapFromDecodedImage(ID2D1RenderTarget* rt,
     return bitmap;
 }
 
+image::DecodedImage padImage(image::ImageView image, uint32_t border) {
+    if (!image.valid() || image.format() != image::PixelFormat::BGRA32) {
+        return {};
+    }
+
+    constexpr uint32_t kBytesPerPixel = 4;
+    const uint32_t width = image.width();
+    const uint32_t height = image.height();
+    image::DecodedImage padded(width + 2 * border, height + 2 * border,
+                               image::PixelFormat::BGRA32);
+
+    // Image rows framed by copies of their first and last pixels, with the
+    // first and last rows repeated above and below
+    for (uint32_t y = 0; y < padded.height(); ++y) {
+        uint32_t src_y = std::clamp(y, border, height + border - 1) - border;
+        const uint8_t* src = image.data() + static_cast<size_t>(src_y) * image.stride();
+        uint8_t* dst = padded.data() + static_cast<size_t>(y) * padded.stride();
+        std::memcpy(dst + border * kBytesPerPixel, src, width * kBytesPerPixel);
+        for (uint32_t b = 0; b < border; ++b) {
+            std::memcpy(dst + b * kBytesPerPixel, src, kBytesPerPixel);
+            std::memcpy(dst + (border + width + b) * kBytesPerPixel,
+                        src + (width - 1) * kBytesPerPixel, kBytesPerPixel);
+        }
+    }
+    return padded;
+}
+
 }  // namespace nive::ui::d2d
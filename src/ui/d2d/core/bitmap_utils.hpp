@@ -5,19 +5,32 @@
 
 #include <d2d1.h>
 
+#include <cstdint>
+
 #include "core/util/com_ptr.hpp"
 
 namespace nive::image {
 class DecodedImage;
+class ImageView;
 }
 
 namespace nive::ui::d2d {
 
-/// @brief Create a D2D bitmap from a DecodedImage (BGRA32, top-down)
+/// @brief Create a D2D bitmap from image pixels (top-down)
 /// @param rt Render target to create the bitmap on
-/// @param image Source image data
-/// @return D2D bitmap, or nullptr on failure
+/// @param image BGRA32, RGBA16F (linear scRGB) for an R16G16B16A16_FLOAT bitmap, or an
+///        8-bit layout convertPixels widens to BGRA32 (RGBA32, BGR24, RGB24, Gray8)
+/// @return D2D bitmap, or nullptr for other formats or on failure
 [[nodiscard]] ComPtr<ID2D1Bitmap> createBitmapFromDecodedImage(ID2D1RenderTarget* rt,
-                                                               const image::DecodedImage& image);
+                                                               image::ImageView image);
+
+/// @brief Copy a BGRA32 image into a larger one framed by copies of its edge pixels
+/// @param image BGRA32 pixels (a whole image or a crop of one)
+/// @param border Pixels added on each side
+/// @return Image border * 2 pixels wider and taller, or an invalid image for other formats
+///
+/// Lets a bitmap be drawn from a shared texture with linear filtering
+/// without sampling its neighbours.
+[[nodiscard]] image::DecodedImage padImage(image::ImageView image, uint32_t border);
 
 }  // namespace nive::ui::d2d
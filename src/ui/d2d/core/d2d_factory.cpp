@@ -15,8 +15,9 @@ D2DFactory& D2DFactory::instance() {
 }
 
 D2DFactory::D2DFactory() {
-    // Create D2D1 factory
-    HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, IID_PPV_ARGS(&d2d_factory_));
+    // Create D2D1 factory; multi-threaded so thumbnail workers can create
+    // bitmaps on the shared device (see GpuDevice)
+    HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, IID_PPV_ARGS(&d2d_factory_));
     if (FAILED(hr)) {
         LOG_ERROR("Failed to create D2D1 factory: 0x{:08X}", static_cast<unsigned>(hr));
         return;
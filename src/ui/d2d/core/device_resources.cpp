@@ -3,8 +3,11 @@
 
 #include "device_resources.hpp"
 
+#include <algorithm>
+
 #include "core/util/logger.hpp"
 #include "d2d_factory.hpp"
+#include "gpu_device.hpp"
 
 namespace nive::ui::d2d {
 
@@ -36,6 +39,13 @@ bool DeviceResources::setTargetWindow(HWND hwnd) {
     return createRenderTarget();
 }
 
+DeviceResources::~DeviceResources() {
+    // Release the context's hold on the back buffer before the swap chain
+    if (device_context_) {
+        device_context_->SetTarget(nullptr);
+    }
+}
+
 bool DeviceResources::createRenderTarget() {
     auto& factory = D2DFactory::instance();
     if (!factory.isValid()) {
@@ -44,55 +54,184 @@ bool DeviceResources::createRenderTarget() {
     }
 
     // Discard existing target
-    render_target_.Reset();
+    discardResources();
 
     RECT rc;
     GetClientRect(hwnd_, &rc);
+    auto width = static_cast<uint32_t>(rc.right - rc.left);
+    auto height = static_cast<uint32_t>(rc.bottom - rc.top);
+
+    if (createSwapChainTarget(width, height)) {
+        LOG_DEBUG("D2D swap chain created ({}x{} @ {:.0f} DPI)", width, height, dpi_x_);
+        return true;
+    }
+    discardResources();
+    return createHwndTarget(width, height);
+}
+
+bool DeviceResources::createSwapChainTarget(uint32_t width, uint32_t height) {
+    // Shared with the other windows and the thumbnail workers' uploads
+    auto devices = GpuDevice::instance().acquire();
+    if (!devices) {
+        return false;
+    }
+    d3d_device_ = devices->d3d;
+    generation_ = devices->generation;
+
+    ComPtr<IDXGIDevice1> dxgi_device;
+    ComPtr<IDXGIAdapter> adapter;
+    ComPtr<IDXGIFactory2> dxgi_factory;
+    if (FAILED(d3d_device_.As(&dxgi_device)) ||
+        FAILED(devices->d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+                                                 &device_context_)) ||
+        FAILED(dxgi_device->GetAdapter(&adapter)) ||
+        FAILED(adapter->GetParent(IID_PPV_ARGS(&dxgi_factory)))) {
+        LOG_DEBUG("D2D device context on D3D11 not available");
+        return false;
+    }
+
+    DXGI_SWAP_CHAIN_DESC1 desc = {};
+    desc.Width = (std::max)(width, 1u);
+    desc.Height = (std::max)(height, 1u);
+    desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    desc.BufferCount = 2;
+    desc.Scaling = DXGI_SCALING_NONE;
+    desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    desc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+    desc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
+    GpuDevice::Lock lock;
+    HRESULT hr = dxgi_factory->CreateSwapChainForHwnd(d3d_device_.Get(), hwnd_, &desc, nullptr,
+                                                      nullptr, &swap_chain_);
+    if (FAILED(hr)) {
+        // Before Windows 8.1 the waitable flag is unknown
+        desc.Flags = 0;
+        hr = dxgi_factory->CreateSwapChainForHwnd(d3d_device_.Get(), hwnd_, &desc, nullptr,
+                                                  nullptr, &swap_chain_);
+    }
+    if (FAILED(hr)) {
+        LOG_DEBUG("Flip-model swap chain not available: 0x{:08X}", static_cast<unsigned>(hr));
+        return false;
+    }
+    dxgi_factory->MakeWindowAssociation(hwnd_, DXGI_MWA_NO_ALT_ENTER);
+
+    ComPtr<IDXGISwapChain2> swap_chain2;
+    if (desc.Flags != 0 && SUCCEEDED(swap_chain_.As(&swap_chain2))) {
+        swap_chain2->SetMaximumFrameLatency(1);
+        frame_waitable_ = HandleGuard(swap_chain2->GetFrameLatencyWaitableObject());
+    } else {
+        dxgi_device->SetMaximumFrameLatency(1);
+    }
 
-    D2D1_SIZE_U size = D2D1::SizeU(static_cast<UINT32>(rc.right - rc.left),
-                                   static_cast<UINT32>(rc.bottom - rc.top));
+    if (!createTargetBitmap()) {
+        return false;
+    }
+    render_target_ = device_context_;
+    return true;
+}
 
+bool DeviceResources::createHwndTarget(uint32_t width, uint32_t height) {
     D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties();
     props.dpiX = dpi_x_;
     props.dpiY = dpi_y_;
 
-    D2D1_HWND_RENDER_TARGET_PROPERTIES hwnd_props = D2D1::HwndRenderTargetProperties(hwnd_, size);
+    D2D1_HWND_RENDER_TARGET_PROPERTIES hwnd_props =
+        D2D1::HwndRenderTargetProperties(hwnd_, D2D1::SizeU(width, height));
 
-    HRESULT hr = factory.d2dFactory()->CreateHwndRenderTarget(props, hwnd_props, &render_target_);
+    HRESULT hr = D2DFactory::instance().d2dFactory()->CreateHwndRenderTarget(props, hwnd_props,
+                                                                             &hwnd_target_);
 
     if (FAILED(hr)) {
         LOG_ERROR("Failed to create HWND render target: 0x{:08X}", static_cast<unsigned>(hr));
         return false;
     }
+    render_target_ = hwnd_target_;
+
+    // Windows 8+ render targets are device contexts; failure only disables effects
+    if (FAILED(hwnd_target_.As(&device_context_))) {
+        LOG_DEBUG("ID2D1DeviceContext not available");
+    }
+
+    LOG_DEBUG("D2D HWND render target created ({}x{} @ {:.0f} DPI)", width, height, dpi_x_);
+    return true;
+}
+
+bool DeviceResources::createTargetBitmap() {
+    ComPtr<IDXGISurface> back_buffer;
+    HRESULT hr = swap_chain_->GetBuffer(0, IID_PPV_ARGS(&back_buffer));
+    if (SUCCEEDED(hr)) {
+        D2D1_BITMAP_PROPERTIES1 props = D2D1::BitmapProperties1(
+            D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE), dpi_x_,
+            dpi_y_);
+        hr = device_context_->CreateBitmapFromDxgiSurface(back_buffer.Get(), &props,
+                                                          &target_bitmap_);
+    }
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to target the swap chain: 0x{:08X}", static_cast<unsigned>(hr));
+        return false;
+    }
 
-    LOG_DEBUG("D2D render target created ({}x{} @ {:.0f} DPI)", size.width, size.height, dpi_x_);
+    device_context_->SetTarget(target_bitmap_.Get());
+    device_context_->SetDpi(dpi_x_, dpi_y_);
+    // New buffers hold nothing to carry over into a partial present
+    presented_ = false;
     return true;
 }
 
-bool DeviceResources::beginDraw() {
+bool DeviceResources::beginDraw(const RECT* dirty) {
     if (!render_target_) {
         return false;
     }
+
+    // Block until the swap chain can queue another frame, so what is drawn
+    // reflects input up to the frame it shows in
+    if (frame_waitable_) {
+        WaitForSingleObject(frame_waitable_.get(), kFrameWaitMs);
+    }
+
+    RECT client;
+    GetClientRect(hwnd_, &client);
+    dirty_ = client;
+    partial_ = false;
+    if (swap_chain_ && presented_ && dirty && IntersectRect(&dirty_, dirty, &client) &&
+        !EqualRect(&dirty_, &client)) {
+        partial_ = true;
+    }
+
     render_target_->BeginDraw();
+    if (partial_) {
+        render_target_->PushAxisAlignedClip(drawRect(), D2D1_ANTIALIAS_MODE_ALIASED);
+    }
     return true;
 }
 
+D2D1_RECT_F DeviceResources::drawRect() const noexcept {
+    // Client pixels to DIPs
+    return D2D1::RectF(static_cast<float>(dirty_.left) * 96.0f / dpi_x_,
+                       static_cast<float>(dirty_.top) * 96.0f / dpi_y_,
+                       static_cast<float>(dirty_.right) * 96.0f / dpi_x_,
+                       static_cast<float>(dirty_.bottom) * 96.0f / dpi_y_);
+}
+
 bool DeviceResources::endDraw() {
     if (!render_target_) {
         return false;
     }
 
+    if (partial_) {
+        render_target_->PopAxisAlignedClip();
+    }
     HRESULT hr = render_target_->EndDraw();
+    if (SUCCEEDED(hr) && swap_chain_) {
+        hr = present();
+    }
 
-    if (hr == D2DERR_RECREATE_TARGET) {
-        // Device lost - recreate resources
-        LOG_WARN("D2D device lost, recreating resources");
-        discardResources();
-        if (createRenderTarget()) {
-            ++resource_epoch_;
-            // Invalidate to trigger repaint with new resources
-            InvalidateRect(hwnd_, nullptr, FALSE);
-        }
+    if (hr == D2DERR_RECREATE_TARGET || hr == DXGI_ERROR_DEVICE_REMOVED ||
+        hr == DXGI_ERROR_DEVICE_RESET) {
+        recoverDeviceLost();
         return false;
     }
 
@@ -104,14 +243,67 @@ bool DeviceResources::endDraw() {
     return true;
 }
 
+HRESULT DeviceResources::present() {
+    DXGI_PRESENT_PARAMETERS params = {};
+    if (partial_) {
+        params.DirtyRectsCount = 1;
+        params.pDirtyRects = &dirty_;
+    }
+    HRESULT hr;
+    {
+        GpuDevice::Lock lock;
+        hr = swap_chain_->Present1(1, 0, &params);
+    }
+    if (hr == DXGI_STATUS_OCCLUDED) {
+        return S_OK;
+    }
+    if (SUCCEEDED(hr)) {
+        presented_ = true;
+    }
+    return hr;
+}
+
+void DeviceResources::recoverDeviceLost() {
+    LOG_WARN("D2D device lost, recreating resources");
+    // The next window to acquire the shared device gets a new one
+    if (generation_ != 0) {
+        GpuDevice::instance().deviceLost(generation_);
+    }
+    discardResources();
+    if (createRenderTarget()) {
+        ++resource_epoch_;
+        // Invalidate to trigger repaint with new resources
+        InvalidateRect(hwnd_, nullptr, FALSE);
+    }
+}
+
 bool DeviceResources::resize(uint32_t width, uint32_t height) {
     if (!render_target_) {
         return false;
     }
 
-    D2D1_SIZE_U size = D2D1::SizeU(width, height);
-    HRESULT hr = render_target_->Resize(size);
+    HRESULT hr;
+    if (swap_chain_) {
+        // The buffers can only be resized once nothing refers to them
+        device_context_->SetTarget(nullptr);
+        target_bitmap_.Reset();
+        DXGI_SWAP_CHAIN_DESC1 desc = {};
+        swap_chain_->GetDesc1(&desc);
+        {
+            GpuDevice::Lock lock;
+            hr = swap_chain_->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, desc.Flags);
+        }
+        if (SUCCEEDED(hr) && !createTargetBitmap()) {
+            hr = E_FAIL;
+        }
+    } else {
+        hr = hwnd_target_->Resize(D2D1::SizeU(width, height));
+    }
 
+    if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) {
+        recoverDeviceLost();
+        return render_target_ != nullptr;
+    }
     if (FAILED(hr)) {
         LOG_ERROR("Failed to resize render target: 0x{:08X}", static_cast<unsigned>(hr));
         // Try recreating the render target
@@ -129,7 +321,12 @@ void DeviceResources::setDpi(float dpi_x, float dpi_y) {
     dpi_x_ = dpi_x;
     dpi_y_ = dpi_y;
 
-    if (render_target_) {
+    if (swap_chain_) {
+        // The back buffer bitmap carries the DPI the context draws at
+        device_context_->SetTarget(nullptr);
+        target_bitmap_.Reset();
+        createTargetBitmap();
+    } else if (render_target_) {
         render_target_->SetDpi(dpi_x_, dpi_y_);
     }
 }
@@ -143,7 +340,18 @@ Size DeviceResources::getSize() const noexcept {
 }
 
 void DeviceResources::discardResources() {
+    if (device_context_) {
+        device_context_->SetTarget(nullptr);
+    }
     render_target_.Reset();
+    device_context_.Reset();
+    target_bitmap_.Reset();
+    frame_waitable_.close();
+    swap_chain_.Reset();
+    d3d_device_.Reset();
+    generation_ = 0;
+    hwnd_target_.Reset();
+    presented_ = false;
 }
 
 ComPtr<ID2D1SolidColorBrush> DeviceResources::createSolidBrush(const Color& color) {
@@ -1,14 +1,18 @@
 /// @file device_resources.hpp
-/// @brief HWND render target and device-dependent resource management
+/// @brief Flip-model swap chain render target and device-dependent resource management
 
 #pragma once
 
 #include <Windows.h>
 
 #include <d2d1.h>
+#include <d2d1_1.h>
+#include <d3d11.h>
 #include <dwrite.h>
+#include <dxgi1_3.h>
 
 #include "core/util/com_ptr.hpp"
+#include "core/util/win32_utils.hpp"
 #include "types.hpp"
 
 namespace nive::ui::d2d {
@@ -17,10 +21,19 @@ namespace nive::ui::d2d {
 ///
 /// Each window that uses D2D rendering should have its own DeviceResources
 /// instance. Handles device lost scenarios and resource recreation.
+///
+/// Draws through a D2D device context into a flip-sequential DXGI swap chain
+/// on the process-wide D3D11 device (GpuDevice). beginDraw() waits on the
+/// swap chain's frame latency object (one queued frame), so input is handled
+/// at most a frame before it shows. Given the paint rectangle, drawing is clipped to it and Present1
+/// reports it as the only dirty rectangle: DXGI carries the rest over from
+/// the previous frame and the compositor updates only that part. Where D3D11
+/// or the D2D 1.1 factory is missing, an ID2D1HwndRenderTarget is used
+/// instead, with the same interface and full-window presents.
 class DeviceResources {
 public:
     DeviceResources();
-    ~DeviceResources() = default;
+    ~DeviceResources();
 
     DeviceResources(const DeviceResources&) = delete;
     DeviceResources& operator=(const DeviceResources&) = delete;
@@ -32,10 +45,16 @@ public:
 
     /// @brief Get the render target
     /// @return Render target, or nullptr if not initialized
-    [[nodiscard]] ID2D1HwndRenderTarget* renderTarget() const noexcept {
+    [[nodiscard]] ID2D1RenderTarget* renderTarget() const noexcept {
         return render_target_.Get();
     }
 
+    /// @brief Get the D2D 1.1 view of the render target (effects, float bitmaps)
+    /// @return Device context, or nullptr on the fallback target before Windows 8
+    [[nodiscard]] ID2D1DeviceContext* deviceContext() const noexcept {
+        return device_context_.Get();
+    }
+
     /// @brief Check if device resources are valid
     [[nodiscard]] bool isValid() const noexcept { return render_target_ != nullptr; }
 
@@ -54,10 +73,18 @@ public:
     }
 
     /// @brief Begin drawing operations
+    /// @param dirty Part of the client area to redraw, in pixels (PAINTSTRUCT::rcPaint);
+    ///              nullptr redraws everything. Drawing outside it is clipped away.
     /// @return true if drawing can proceed
-    bool beginDraw();
+    bool beginDraw(const RECT* dirty = nullptr);
 
-    /// @brief End drawing operations
+    /// @brief Get the part of the target the frame being drawn redraws, in DIPs
+    ///
+    /// The dirty rectangle given to beginDraw() when the frame is partial,
+    /// otherwise the whole client area. Valid between beginDraw() and endDraw().
+    [[nodiscard]] D2D1_RECT_F drawRect() const noexcept;
+
+    /// @brief End drawing operations and present the frame
     /// @return true if successful, false if device was lost (resources recreated)
     bool endDraw();
 
@@ -81,6 +108,11 @@ public:
     /// @brief Resource epoch counter, incremented on render target recreation
     [[nodiscard]] uint32_t resourceEpoch() const noexcept { return resource_epoch_; }
 
+    /// @brief Generation of the shared GpuDevice being drawn on
+    /// @return Generation bitmaps staged by GpuDevice must match to be drawn here;
+    ///         0 on the fallback target, which draws none of them
+    [[nodiscard]] uint32_t gpuGeneration() const noexcept { return generation_; }
+
     /// @brief Create a solid color brush
     /// @param color Brush color
     /// @return Brush, or nullptr on failure
@@ -100,10 +132,43 @@ public:
 private:
     bool createRenderTarget();
 
+    /// @brief Create the D2D device context on the shared device, and the swap chain
+    bool createSwapChainTarget(uint32_t width, uint32_t height);
+
+    /// @brief Create the fallback HWND render target
+    bool createHwndTarget(uint32_t width, uint32_t height);
+
+    /// @brief Point the device context at the swap chain's back buffer
+    bool createTargetBitmap();
+
+    /// @brief Present the frame, with the dirty rectangle when there is one
+    HRESULT present();
+
+    /// @brief Recreate everything after the device was lost
+    void recoverDeviceLost();
+
     static constexpr float kBaseDpi = 72.0f;
 
+    // Longest beginDraw() waits for the swap chain to accept a frame
+    static constexpr DWORD kFrameWaitMs = 100;
+
     HWND hwnd_ = nullptr;
-    ComPtr<ID2D1HwndRenderTarget> render_target_;
+    ComPtr<ID2D1RenderTarget> render_target_;  // device_context_ or hwnd_target_
+    ComPtr<ID2D1DeviceContext> device_context_;
+
+    // Swap chain path
+    ComPtr<ID3D11Device> d3d_device_;  // GpuDevice's
+    uint32_t generation_ = 0;          // Of d3d_device_
+    ComPtr<IDXGISwapChain1> swap_chain_;
+    ComPtr<ID2D1Bitmap1> target_bitmap_;
+    HandleGuard frame_waitable_;  // Null where the swap chain cannot be waited on
+
+    // Fallback path
+    ComPtr<ID2D1HwndRenderTarget> hwnd_target_;
+
+    RECT dirty_{};             // Of the frame being drawn
+    bool partial_ = false;     // dirty_ is smaller than the client area
+    bool presented_ = false;   // Current buffers hold a full frame to carry over
     float dpi_x_ = 96.0f;
     float dpi_y_ = 96.0f;
     uint32_t resource_epoch_ = 0;
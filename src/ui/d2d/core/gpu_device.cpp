@@ -0,0 +1,129 @@
+/// @file gpu_device.cpp
+/// @brief Shared device creation, loss handling and worker-thread bitmap staging
+
+#include "gpu_device.hpp"
+
+#include "bitmap_utils.hpp"
+#include "core/image/decoded_image.hpp"
+#include "core/util/logger.hpp"
+#include "d2d_factory.hpp"
+
+namespace nive::ui::d2d {
+
+namespace {
+
+// Device context of the calling thread; contexts are not shared between threads
+struct ThreadContext {
+    ComPtr<ID2D1DeviceContext> context;
+    uint32_t generation = 0;
+};
+
+thread_local ThreadContext t_context;
+
+}  // namespace
+
+GpuDevice::Lock::Lock() {
+    if (auto* factory = D2DFactory::instance().d2dFactory();
+        factory && SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&multithread_)))) {
+        multithread_->Enter();
+    }
+}
+
+GpuDevice::Lock::~Lock() {
+    if (multithread_) {
+        multithread_->Leave();
+    }
+}
+
+GpuDevice& GpuDevice::instance() {
+    static GpuDevice instance;
+    return instance;
+}
+
+std::optional<GpuDevice::Devices> GpuDevice::acquire() {
+    std::lock_guard lock(mutex_);
+    if (!devices_.d3d && !create()) {
+        return std::nullopt;
+    }
+    return devices_;
+}
+
+void GpuDevice::deviceLost(uint32_t generation) {
+    std::lock_guard lock(mutex_);
+    if (generation == devices_.generation) {
+        devices_ = {};
+    }
+}
+
+bool GpuDevice::create() {
+    auto& factory = D2DFactory::instance();
+    ComPtr<ID2D1Factory1> factory1;
+    if (!factory.isValid() ||
+        FAILED(factory.d2dFactory()->QueryInterface(IID_PPV_ARGS(&factory1)))) {
+        LOG_DEBUG("ID2D1Factory1 not available");
+        return false;
+    }
+
+    // BGRA support is what D2D interop needs; WARP covers machines without a usable GPU
+    constexpr UINT kDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+    Devices created;
+    HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, kDeviceFlags,
+                                   nullptr, 0, D3D11_SDK_VERSION, &created.d3d, nullptr, nullptr);
+    if (FAILED(hr)) {
+        hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, kDeviceFlags, nullptr, 0,
+                               D3D11_SDK_VERSION, &created.d3d, nullptr, nullptr);
+    }
+    if (FAILED(hr)) {
+        LOG_DEBUG("D3D11 device not available: 0x{:08X}", static_cast<unsigned>(hr));
+        return false;
+    }
+
+    ComPtr<IDXGIDevice> dxgi_device;
+    if (FAILED(created.d3d.As(&dxgi_device)) ||
+        FAILED(factory1->CreateDevice(dxgi_device.Get(), &created.d2d))) {
+        LOG_DEBUG("D2D device on D3D11 not available");
+        return false;
+    }
+
+    created.generation = next_generation_++;
+    devices_ = std::move(created);
+    LOG_DEBUG("Shared GPU device created (generation {})", devices_.generation);
+    return true;
+}
+
+StagedBitmap GpuDevice::stage(image::ImageView image, uint32_t border) {
+    if (!image.valid()) {
+        return {};
+    }
+
+    auto devices = acquire();
+    if (!devices) {
+        return {};
+    }
+    if (!t_context.context || t_context.generation != devices->generation) {
+        t_context = {};
+        if (FAILED(devices->d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+                                                     &t_context.context))) {
+            return {};
+        }
+        t_context.generation = devices->generation;
+    }
+
+    StagedBitmap staged;
+    staged.width = image.width();
+    staged.height = image.height();
+    staged.generation = devices->generation;
+    if (border > 0 && image.format() == image::PixelFormat::BGRA32) {
+        staged.border = border;
+        staged.bitmap = createBitmapFromDecodedImage(t_context.context.Get(),
+                                                     padImage(image, border));
+    } else {
+        staged.bitmap = createBitmapFromDecodedImage(t_context.context.Get(), image);
+    }
+    if (!staged.bitmap) {
+        return {};
+    }
+    return staged;
+}
+
+}  // namespace nive::ui::d2d
@@ -0,0 +1,99 @@
+/// @file gpu_device.hpp
+/// @brief D3D11/D2D device shared by every window, with uploads from worker threads
+
+#pragma once
+
+#include <d2d1_1.h>
+#include <d3d11.h>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "core/util/com_ptr.hpp"
+
+namespace nive::image {
+class DecodedImage;
+class ImageView;
+}
+
+namespace nive::ui::d2d {
+
+/// @brief Bitmap created on the shared device, ready to draw or copy from
+struct StagedBitmap {
+    ComPtr<ID2D1Bitmap> bitmap;
+    uint32_t width = 0;   // Image size, without the border
+    uint32_t height = 0;
+    uint32_t border = 0;  // Edge pixels copied around the image (see padImage)
+    uint32_t generation = 0;  // GpuDevice::Devices::generation it was created on
+
+    [[nodiscard]] explicit operator bool() const noexcept { return bitmap != nullptr; }
+};
+
+/// @brief Process-wide D3D11 device and the D2D device on it
+///
+/// Swap chain windows (DeviceResources) render on this one device, so a
+/// bitmap created through stage() on any thread can be drawn by, or copied
+/// into the atlas of, any of them. The D2D factory is multi-threaded and
+/// serializes D2D calls; direct D3D/DXGI calls on the device from the UI
+/// thread (Present, ResizeBuffers) go through Lock so they do not race a
+/// worker's upload.
+///
+/// When a window sees the device lost it calls deviceLost(); the next
+/// acquire() creates new devices under a new generation, and bitmaps
+/// staged on the old one are refused by their generation.
+class GpuDevice {
+public:
+    /// @brief Devices of one generation
+    struct Devices {
+        ComPtr<ID3D11Device> d3d;
+        ComPtr<ID2D1Device> d2d;
+        uint32_t generation = 0;
+    };
+
+    /// @brief Holds the D2D multithread lock for direct D3D/DXGI calls
+    class Lock {
+    public:
+        Lock();
+        ~Lock();
+
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+
+    private:
+        ComPtr<ID2D1Multithread> multithread_;  // Null on a single-threaded factory
+    };
+
+    /// @brief Get the singleton instance
+    [[nodiscard]] static GpuDevice& instance();
+
+    /// @brief Get the current devices, creating them on first use or after a loss
+    /// @return Devices, or nullopt without D3D11 (hardware or WARP) or the D2D 1.1 factory
+    [[nodiscard]] std::optional<Devices> acquire();
+
+    /// @brief Report that the devices of a generation were lost
+    /// @param generation Generation of the devices that failed; stale reports are ignored
+    void deviceLost(uint32_t generation);
+
+    /// @brief Create a bitmap of an image on the shared device (any thread)
+    /// @param image Image convertible by createBitmapFromDecodedImage
+    /// @param border Edge pixels to add around a BGRA32 image; 0 keeps it as is
+    /// @return Staged bitmap, or empty without devices or on failure
+    [[nodiscard]] StagedBitmap stage(image::ImageView image, uint32_t border = 0);
+
+    GpuDevice(const GpuDevice&) = delete;
+    GpuDevice& operator=(const GpuDevice&) = delete;
+
+private:
+    GpuDevice() = default;
+    ~GpuDevice() = default;
+
+    /// @brief Create devices under a new generation
+    bool create();
+
+    std::mutex mutex_;
+    Devices devices_;  // d3d is null before create() or after a loss
+    uint32_t next_generation_ = 1;
+};
+
+}  // namespace nive::ui::d2d
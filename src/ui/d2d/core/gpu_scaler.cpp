@@ -0,0 +1,216 @@
+/// @file gpu_scaler.cpp
+/// @brief Batched D2D thumbnail scaling with readback
+
+#include "gpu_scaler.hpp"
+
+#include <d2d1effects.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "core/image/decoded_image.hpp"
+#include "core/image/image_scaler.hpp"
+#include "core/util/logger.hpp"
+#include "gpu_device.hpp"
+
+namespace nive::ui::d2d {
+
+namespace {
+
+/// @brief GPU objects of one job between drawing and readback
+struct Staged {
+    ComPtr<ID2D1Bitmap1> target;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+[[nodiscard]] D2D1_BITMAP_PROPERTIES1 bitmap_properties(D2D1_BITMAP_OPTIONS options) {
+    return D2D1::BitmapProperties1(
+        options, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+}
+
+/// @brief Copy a drawn target into a pooled BGRA32 image through a CPU-readable bitmap
+std::expected<image::DecodedImage, image::DecodeError> read_back(ID2D1DeviceContext* context,
+                                                                 const Staged& staged) {
+    ComPtr<ID2D1Bitmap1> readable;
+    if (FAILED(context->CreateBitmap(
+            D2D1::SizeU(staged.width, staged.height), nullptr, 0,
+            bitmap_properties(D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW),
+            &readable)) ||
+        FAILED(readable->CopyFromBitmap(nullptr, staged.target.Get(), nullptr))) {
+        return std::unexpected(image::DecodeError::InternalError);
+    }
+
+    D2D1_MAPPED_RECT mapped{};
+    if (FAILED(readable->Map(D2D1_MAP_OPTIONS_READ, &mapped))) {
+        return std::unexpected(image::DecodeError::InternalError);
+    }
+    image::DecodedImage image(staged.width, staged.height, image::PixelFormat::BGRA32,
+                              image::kSimdRowAlignment);
+    auto pixels = image.pixels();
+    size_t row_bytes = static_cast<size_t>(staged.width) * 4;
+    for (uint32_t y = 0; y < staged.height; ++y) {
+        std::memcpy(pixels.data() + static_cast<size_t>(y) * image.stride(),
+                    mapped.bits + static_cast<size_t>(y) * mapped.pitch, row_bytes);
+    }
+    readable->Unmap();
+    return image;
+}
+
+}  // namespace
+
+GpuThumbnailScaler::GpuThumbnailScaler()
+    : thread_([this](std::stop_token stop_token) { run(stop_token); }) {}
+
+GpuThumbnailScaler::~GpuThumbnailScaler() {
+    thread_.request_stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::expected<image::DecodedImage, image::DecodeError>
+GpuThumbnailScaler::scaleThumbnail(image::ImageView source, uint32_t max_size,
+                                   std::stop_token stop_token) {
+    if (stop_token.stop_requested()) {
+        return std::unexpected(image::DecodeError::Cancelled);
+    }
+    if (source.format() != image::PixelFormat::BGRA32 || !source.valid() || max_size == 0) {
+        return std::unexpected(image::DecodeError::UnsupportedFormat);
+    }
+
+    // The job lives on this frame; the scaler thread marks it done before
+    // letting go of it, so waiting is not cut short by stop_token
+    Job job{.source = source, .max_size = max_size};
+    std::unique_lock lock(mutex_);
+    if (thread_.get_stop_token().stop_requested()) {
+        return std::unexpected(image::DecodeError::DecoderNotAvailable);
+    }
+    pending_.push_back(&job);
+    wake_.notify_one();
+    done_.wait(lock, [&job] { return job.done; });
+    return std::move(job.result);
+}
+
+void GpuThumbnailScaler::run(std::stop_token stop_token) {
+    std::deque<Job*> batch;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, stop_token, [this] { return !pending_.empty(); });
+            if (stop_token.stop_requested()) {
+                // Fail whatever is still queued so no caller waits forever
+                for (Job* job : pending_) {
+                    job->result = std::unexpected(image::DecodeError::DecoderNotAvailable);
+                    job->done = true;
+                }
+                pending_.clear();
+                done_.notify_all();
+                return;
+            }
+
+            // Give the other workers a moment to join this submission
+            wake_.wait_for(lock, stop_token, kBatchWindow,
+                           [this] { return pending_.size() >= kMaxBatch; });
+            size_t count = (std::min)(pending_.size(), kMaxBatch);
+            batch.assign(pending_.begin(), pending_.begin() + count);
+            pending_.erase(pending_.begin(), pending_.begin() + count);
+        }
+
+        process(batch);
+
+        std::lock_guard lock(mutex_);
+        for (Job* job : batch) {
+            job->done = true;
+        }
+        batch.clear();
+        done_.notify_all();
+    }
+}
+
+bool GpuThumbnailScaler::prepareContext() {
+    auto devices = GpuDevice::instance().acquire();
+    if (!devices) {
+        return false;
+    }
+    if (context_ && generation_ == devices->generation) {
+        return true;
+    }
+    context_.Reset();
+    if (FAILED(devices->d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &context_))) {
+        return false;
+    }
+    generation_ = devices->generation;
+    return true;
+}
+
+void GpuThumbnailScaler::process(std::deque<Job*>& batch) {
+    if (!prepareContext()) {
+        for (Job* job : batch) {
+            job->result = std::unexpected(image::DecodeError::DecoderNotAvailable);
+        }
+        return;
+    }
+
+    // Upload every source and queue its scale; D2D submits them together at EndDraw
+    UINT32 max_bitmap = context_->GetMaximumBitmapSize();
+    std::vector<Staged> staged(batch.size());
+    context_->BeginDraw();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const auto& source = batch[i]->source;
+        if (source.width() > max_bitmap || source.height() > max_bitmap) {
+            batch[i]->result = std::unexpected(image::DecodeError::UnsupportedFormat);
+            continue;
+        }
+        auto [width, height] = image::calculateScaledDimensions(
+            source.width(), source.height(), batch[i]->max_size, batch[i]->max_size);
+
+        ComPtr<ID2D1Bitmap1> input;
+        ComPtr<ID2D1Bitmap1> target;
+        ComPtr<ID2D1Effect> scale;
+        if (FAILED(context_->CreateBitmap(D2D1::SizeU(source.width(), source.height()),
+                                          source.pixels().data(), source.stride(),
+                                          bitmap_properties(D2D1_BITMAP_OPTIONS_NONE), &input)) ||
+            FAILED(context_->CreateBitmap(D2D1::SizeU(width, height), nullptr, 0,
+                                          bitmap_properties(D2D1_BITMAP_OPTIONS_TARGET),
+                                          &target)) ||
+            FAILED(context_->CreateEffect(CLSID_D2D1Scale, &scale))) {
+            batch[i]->result = std::unexpected(image::DecodeError::InternalError);
+            continue;
+        }
+        scale->SetInput(0, input.Get());
+        scale->SetValue(D2D1_SCALE_PROP_SCALE,
+                        D2D1::Vector2F(static_cast<float>(width) / source.width(),
+                                       static_cast<float>(height) / source.height()));
+        scale->SetValue(D2D1_SCALE_PROP_INTERPOLATION_MODE,
+                        D2D1_SCALE_INTERPOLATION_MODE_HIGH_QUALITY_CUBIC);
+        scale->SetValue(D2D1_SCALE_PROP_BORDER_MODE, D2D1_BORDER_MODE_HARD);
+
+        context_->SetTarget(target.Get());
+        context_->Clear(D2D1::ColorF(0, 0, 0, 0));
+        context_->DrawImage(scale.Get());
+        staged[i] = {.target = std::move(target), .width = width, .height = height};
+    }
+    HRESULT hr = context_->EndDraw();
+    context_->SetTarget(nullptr);
+    if (FAILED(hr)) {
+        if (hr == D2DERR_RECREATE_TARGET) {
+            LOG_WARN("GPU device lost while scaling thumbnails");
+            GpuDevice::instance().deviceLost(generation_);
+            context_.Reset();
+        }
+        for (Job* job : batch) {
+            job->result = std::unexpected(image::DecodeError::InternalError);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (staged[i].target) {
+            batch[i]->result = read_back(context_.Get(), staged[i]);
+        }
+    }
+}
+
+}  // namespace nive::ui::d2d
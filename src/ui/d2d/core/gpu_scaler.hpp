@@ -0,0 +1,78 @@
+/// @file gpu_scaler.hpp
+/// @brief Thumbnail resampling on the shared GPU device, batched across decode workers
+
+#pragma once
+
+#include <d2d1_1.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "core/image/thumbnail_scaler.hpp"
+#include "core/util/com_ptr.hpp"
+
+namespace nive::ui::d2d {
+
+/// @brief Scales thumbnails with the D2D high-quality scale effect on GpuDevice
+///
+/// Decode workers block in scaleThumbnail() while one thread of the scaler
+/// gathers the calls arriving within a short window into a batch, draws
+/// them all between one BeginDraw/EndDraw pair and reads each result back
+/// into a pooled DecodedImage. Without a device, or when it is lost, calls
+/// fail and the generator scales on the CPU as before.
+class GpuThumbnailScaler final : public image::IThumbnailScaler {
+public:
+    static constexpr size_t kMaxBatch = 16;
+    static constexpr std::chrono::microseconds kBatchWindow{1000};
+
+    GpuThumbnailScaler();
+    ~GpuThumbnailScaler() override;
+
+    // Non-copyable, non-movable
+    GpuThumbnailScaler(const GpuThumbnailScaler&) = delete;
+    GpuThumbnailScaler& operator=(const GpuThumbnailScaler&) = delete;
+    GpuThumbnailScaler(GpuThumbnailScaler&&) = delete;
+    GpuThumbnailScaler& operator=(GpuThumbnailScaler&&) = delete;
+
+    [[nodiscard]] std::expected<image::DecodedImage, image::DecodeError>
+    scaleThumbnail(image::ImageView source, uint32_t max_size,
+                   std::stop_token stop_token) override;
+
+private:
+    /// @brief One caller's image, owned by the waiting caller's frame
+    struct Job {
+        image::ImageView source;
+        uint32_t max_size = 0;
+        std::expected<image::DecodedImage, image::DecodeError> result =
+            std::unexpected(image::DecodeError::InternalError);
+        bool done = false;
+    };
+
+    void run(std::stop_token stop_token);
+
+    /// @brief Scale every job of a batch and mark them done
+    void process(std::deque<Job*>& batch);
+
+    /// @brief Make sure context_ is on the current device generation
+    /// @return false without a device
+    bool prepareContext();
+
+    std::mutex mutex_;
+    std::condition_variable_any wake_;  // Jobs queued
+    std::condition_variable done_;      // A batch finished
+    std::deque<Job*> pending_;
+
+    // Scaler thread only
+    ComPtr<ID2D1DeviceContext> context_;
+    uint32_t generation_ = 0;
+
+    std::jthread thread_;  // Last: stops before the members above go
+};
+
+}  // namespace nive::ui::d2d
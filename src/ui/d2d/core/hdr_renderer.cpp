@@ -0,0 +1,139 @@
+/// @file hdr_renderer.cpp
+/// @brief HDR tone mapping and scRGB to sRGB conversion through D2D effects
+
+#include "hdr_renderer.hpp"
+
+#include <d2d1effects_2.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#include "core/image/decoded_image.hpp"
+#include "core/util/logger.hpp"
+
+namespace nive::ui::d2d {
+
+namespace {
+
+// scRGB 1.0 is 80 nits; SDR displays are assumed to show that as white
+constexpr float kSdrWhiteNits = 80.0f;
+
+// Samples per axis for scrgbPeak()
+constexpr uint32_t kPeakSamples = 256;
+
+/// @brief Convert an IEEE half to float (infinities and NaN count as 0)
+[[nodiscard]] float half_to_float(uint16_t half) noexcept {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0x1F) {
+        return 0.0f;
+    }
+    if (exponent == 0) {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+}  // namespace
+
+bool HdrRenderer::draw(ID2D1DeviceContext* dc, ID2D1Bitmap* bitmap, const D2D1_RECT_F& dest,
+                       float peak) {
+    if (!dc || !bitmap) {
+        return false;
+    }
+    if (dc_.Get() != dc) {
+        reset();
+        if (!create(dc)) {
+            return false;
+        }
+    }
+
+    // Content within SDR white needs no tone mapping, only the encoding
+    if (tone_map_ && peak > 1.0f) {
+        tone_map_->SetInput(0, bitmap);
+        tone_map_->SetValue(D2D1_HDRTONEMAP_PROP_INPUT_MAX_LUMINANCE, peak * kSdrWhiteNits);
+        color_->SetInputEffect(0, tone_map_.Get());
+    } else {
+        color_->SetInput(0, bitmap);
+    }
+
+    // DrawImage has no destination rectangle: scale through the transform
+    D2D1_SIZE_F size = bitmap->GetSize();
+    if (size.width <= 0.0f || size.height <= 0.0f) {
+        return true;
+    }
+    D2D1_MATRIX_3X2_F previous;
+    dc->GetTransform(&previous);
+    auto placement = D2D1::Matrix3x2F::Scale((dest.right - dest.left) / size.width,
+                                             (dest.bottom - dest.top) / size.height) *
+                     D2D1::Matrix3x2F::Translation(dest.left, dest.top) *
+                     *D2D1::Matrix3x2F::ReinterpretBaseType(&previous);
+    dc->SetTransform(placement);
+    dc->DrawImage(color_.Get(), D2D1_INTERPOLATION_MODE_LINEAR);
+    dc->SetTransform(previous);
+    return true;
+}
+
+void HdrRenderer::reset() {
+    tone_map_.Reset();
+    color_.Reset();
+    dc_.Reset();
+}
+
+bool HdrRenderer::create(ID2D1DeviceContext* dc) {
+    ComPtr<ID2D1ColorContext> scrgb;
+    ComPtr<ID2D1ColorContext> srgb;
+    HRESULT hr = dc->CreateEffect(CLSID_D2D1ColorManagement, &color_);
+    if (SUCCEEDED(hr)) {
+        hr = dc->CreateColorContext(D2D1_COLOR_SPACE_SCRGB, nullptr, 0, &scrgb);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = dc->CreateColorContext(D2D1_COLOR_SPACE_SRGB, nullptr, 0, &srgb);
+    }
+    if (FAILED(hr)) {
+        LOG_WARN("Failed to create color management effect: 0x{:08X}",
+                 static_cast<unsigned>(hr));
+        color_.Reset();
+        return false;
+    }
+    color_->SetValue(D2D1_COLORMANAGEMENT_PROP_SOURCE_COLOR_CONTEXT, scrgb.Get());
+    color_->SetValue(D2D1_COLORMANAGEMENT_PROP_DESTINATION_COLOR_CONTEXT, srgb.Get());
+
+    // Optional: highlights are clipped without it
+    if (SUCCEEDED(dc->CreateEffect(CLSID_D2D1HdrToneMap, &tone_map_))) {
+        tone_map_->SetValue(D2D1_HDRTONEMAP_PROP_OUTPUT_MAX_LUMINANCE, kSdrWhiteNits);
+        tone_map_->SetValue(D2D1_HDRTONEMAP_PROP_DISPLAY_MODE, D2D1_HDRTONEMAP_DISPLAY_MODE_SDR);
+    } else {
+        LOG_DEBUG("HDR tone map effect unavailable; highlights will clip");
+    }
+
+    dc_ = dc;
+    return true;
+}
+
+float scrgbPeak(const image::DecodedImage& image) {
+    if (image.format() != image::PixelFormat::RGBA16F || !image.valid()) {
+        return 1.0f;
+    }
+    uint32_t step_x = std::max(image.width() / kPeakSamples, 1u);
+    uint32_t step_y = std::max(image.height() / kPeakSamples, 1u);
+
+    float peak = 1.0f;
+    for (uint32_t y = 0; y < image.height(); y += step_y) {
+        const uint8_t* row = image.row(y);
+        for (uint32_t x = 0; x < image.width(); x += step_x) {
+            uint16_t channels[4];
+            std::memcpy(channels, row + static_cast<size_t>(x) * 8, sizeof(channels));
+            for (int c = 0; c < 3; ++c) {
+                peak = std::max(peak, half_to_float(channels[c]));
+            }
+        }
+    }
+    return peak;
+}
+
+}  // namespace nive::ui::d2d
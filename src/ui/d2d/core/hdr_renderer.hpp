@@ -0,0 +1,52 @@
+/// @file hdr_renderer.hpp
+/// @brief GPU display of half-float (scRGB) bitmaps on an SDR render target
+
+#pragma once
+
+#include <d2d1_1.h>
+
+#include "core/util/com_ptr.hpp"
+
+namespace nive::image {
+class DecodedImage;
+}
+
+namespace nive::ui::d2d {
+
+/// @brief Draws R16G16B16A16_FLOAT bitmaps holding linear scRGB on an 8-bit target
+///
+/// Highlights above SDR white are compressed by the HDR tone map effect
+/// (Windows 10 1809 and later; clipped where it is missing), then the color
+/// management effect encodes linear scRGB as sRGB. Both run on the GPU, so
+/// the image stays at full precision in memory and is never converted on
+/// the CPU. Effects belong to one device context; a new context rebuilds
+/// them.
+class HdrRenderer {
+public:
+    /// @brief Draw a float bitmap scaled into a rectangle
+    /// @param dc D2D 1.1 view of the render target, between BeginDraw and EndDraw
+    /// @param bitmap R16G16B16A16_FLOAT bitmap
+    /// @param dest Destination in DIPs
+    /// @param peak Brightest channel value of the image (1.0 = SDR white), see scrgbPeak()
+    /// @return false if the effects could not be created (nothing is drawn)
+    bool draw(ID2D1DeviceContext* dc, ID2D1Bitmap* bitmap, const D2D1_RECT_F& dest, float peak);
+
+    /// @brief Release the effects (device lost, window destroyed)
+    void reset();
+
+private:
+    bool create(ID2D1DeviceContext* dc);
+
+    ComPtr<ID2D1DeviceContext> dc_;  // Context the effects were created on
+    ComPtr<ID2D1Effect> tone_map_;   // Null where the effect is unavailable
+    ComPtr<ID2D1Effect> color_;
+};
+
+/// @brief Estimate the brightest color channel of an RGBA16F image
+/// @return Largest sampled channel value (1.0 = SDR white), 1.0 for other formats
+///
+/// Reads a grid of at most 256 x 256 pixels, which is enough to decide how
+/// far highlights go beyond SDR white.
+[[nodiscard]] float scrgbPeak(const image::DecodedImage& image);
+
+}  // namespace nive::ui::d2d
@@ -0,0 +1,41 @@
+/// @file text_layout_cache.cpp
+/// @brief Text layout cache implementation
+
+#include "text_layout_cache.hpp"
+
+#include "d2d_factory.hpp"
+
+namespace nive::ui::d2d {
+
+ComPtr<IDWriteTextLayout> TextLayoutCache::get(size_t index, const std::wstring& text,
+                                               IDWriteTextFormat* format, float width,
+                                               float height) {
+    if (!format) {
+        return nullptr;
+    }
+    // A new format or box invalidates every layout
+    if (format != format_ || width != width_ || height != height_) {
+        layouts_.clear();
+        format_ = format;
+        width_ = width;
+        height_ = height;
+    }
+
+    if (auto cached = layouts_.get(index)) {
+        return *cached;
+    }
+
+    auto& factory = D2DFactory::instance();
+    if (!factory.isValid()) {
+        return nullptr;
+    }
+    ComPtr<IDWriteTextLayout> layout;
+    factory.dwriteFactory()->CreateTextLayout(text.c_str(), static_cast<UINT32>(text.length()),
+                                              format, width, height, &layout);
+    if (layout) {
+        layouts_.put(index, layout, 1);
+    }
+    return layout;
+}
+
+}  // namespace nive::ui::d2d
@@ -0,0 +1,49 @@
+/// @file text_layout_cache.hpp
+/// @brief Text layouts of list items, kept across frames
+
+#pragma once
+
+#include <dwrite.h>
+
+#include <cstddef>
+#include <string>
+
+#include "core/util/com_ptr.hpp"
+#include "core/util/lru_cache.hpp"
+
+namespace nive::ui::d2d {
+
+/// @brief Least-recently-used cache of one IDWriteTextLayout per list item
+///
+/// Lists draw the same items frame after frame; building their layouts once
+/// makes scrolling and hovering cheap. Layouts are keyed by item index and
+/// all dropped when the format or the layout box changes. The owner calls
+/// clear() when items are added, removed or edited.
+class TextLayoutCache {
+public:
+    static constexpr size_t kDefaultCapacity = 256;
+
+    explicit TextLayoutCache(size_t capacity = kDefaultCapacity) : layouts_(capacity) {}
+
+    /// @brief Get the layout of an item, creating it on first use
+    /// @param index Item index
+    /// @param text Item text
+    /// @param format Text format of every item
+    /// @param width Layout box width (DIPs)
+    /// @param height Layout box height (DIPs)
+    /// @return Layout, or nullptr if DirectWrite failed
+    [[nodiscard]] ComPtr<IDWriteTextLayout> get(size_t index, const std::wstring& text,
+                                                IDWriteTextFormat* format, float width,
+                                                float height);
+
+    /// @brief Drop every layout
+    void clear() { layouts_.clear(); }
+
+private:
+    LruCache<size_t, ComPtr<IDWriteTextLayout>> layouts_;  // Cost 1 per layout
+    IDWriteTextFormat* format_ = nullptr;  // Identity only; not held
+    float width_ = 0.0f;
+    float height_ = 0.0f;
+};
+
+}  // namespace nive::ui::d2d
@@ -0,0 +1,352 @@
+/// @file thumbnail_atlas.cpp
+/// @brief Slot allocation, upload and batched drawing of atlas pages
+
+#include "thumbnail_atlas.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "core/image/decoded_image.hpp"
+#include "core/util/logger.hpp"
+#include "bitmap_utils.hpp"
+
+namespace nive::ui::d2d {
+
+namespace {
+
+// Key of a free slot
+constexpr uint64_t kFreeSlot = UINT64_MAX;
+
+/// @brief Get the slot size class for an image
+[[nodiscard]] uint32_t slot_size_for(uint32_t width, uint32_t height) noexcept {
+    return (std::max)(std::bit_ceil((std::max)(width, height)), ThumbnailAtlas::kMinSlotSize);
+}
+
+}  // namespace
+
+struct ThumbnailAtlas::Page {
+    struct Slot {
+        uint64_t key = kFreeSlot;
+        uint64_t last_used = 0;  // Frame the slot was last drawn in
+    };
+
+    ComPtr<ID2D1Bitmap> bitmap;
+    uint32_t slot_size = 0;
+    uint32_t columns = 0;
+    std::vector<Slot> slots;
+    size_t free_slots = 0;
+    std::vector<Sprite> queued;
+
+    [[nodiscard]] D2D1_POINT_2U origin(uint32_t slot) const noexcept {
+        uint32_t pitch = slot_size + 2 * kBorder;
+        return D2D1::Point2U((slot % columns) * pitch, (slot / columns) * pitch);
+    }
+};
+
+ThumbnailAtlas::~ThumbnailAtlas() = default;
+
+bool ThumbnailAtlas::fits(image::ImageView image) noexcept {
+    return image.valid() && image.format() == image::PixelFormat::BGRA32 &&
+           image.width() <= kMaxSlotSize && image.height() <= kMaxSlotSize;
+}
+
+bool ThumbnailAtlas::draw(ID2D1RenderTarget* rt, uint64_t key, image::ImageView image,
+                          const D2D1_RECT_F& dest) {
+    if (!useTarget(rt)) {
+        return false;
+    }
+    if (auto it = resident_.find(key); it != resident_.end()) {
+        queue(it->second, dest);
+        return true;
+    }
+    if (!fits(image)) {
+        return false;
+    }
+
+    uint32_t page = 0;
+    uint32_t slot = 0;
+    D2D1_RECT_U area{};
+    if (!reserve(rt, image.width(), image.height(), page, slot, area)) {
+        return false;
+    }
+    auto padded = padImage(image, kBorder);
+    if (FAILED(pages_[page]->bitmap->CopyFromMemory(&area, padded.data(), padded.stride()))) {
+        return false;
+    }
+    commit(key, page, slot, area, dest);
+    return true;
+}
+
+bool ThumbnailAtlas::draw(ID2D1RenderTarget* rt, uint64_t key, ID2D1Bitmap* staged,
+                          uint32_t width, uint32_t height, const D2D1_RECT_F& dest) {
+    if (!useTarget(rt)) {
+        return false;
+    }
+    if (auto it = resident_.find(key); it != resident_.end()) {
+        queue(it->second, dest);
+        return true;
+    }
+    if (!staged || width == 0 || height == 0 || width > kMaxSlotSize || height > kMaxSlotSize) {
+        return false;
+    }
+
+    uint32_t page = 0;
+    uint32_t slot = 0;
+    D2D1_RECT_U area{};
+    if (!reserve(rt, width, height, page, slot, area)) {
+        return false;
+    }
+    D2D1_POINT_2U origin = D2D1::Point2U(area.left, area.top);
+    if (FAILED(pages_[page]->bitmap->CopyFromBitmap(&origin, staged, nullptr))) {
+        return false;
+    }
+    commit(key, page, slot, area, dest);
+    return true;
+}
+
+bool ThumbnailAtlas::useTarget(ID2D1RenderTarget* rt) {
+    if (!rt) {
+        return false;
+    }
+    if (rt != target_) {
+        reset();
+        target_ = rt;
+    }
+    return true;
+}
+
+bool ThumbnailAtlas::reserve(ID2D1RenderTarget* rt, uint32_t width, uint32_t height,
+                             uint32_t& page, uint32_t& slot, D2D1_RECT_U& padded) {
+    if (!allocate(rt, slot_size_for(width, height), page, slot)) {
+        return false;
+    }
+    D2D1_POINT_2U origin = pages_[page]->origin(slot);
+    padded = D2D1::RectU(origin.x, origin.y, origin.x + width + 2 * kBorder,
+                         origin.y + height + 2 * kBorder);
+    return true;
+}
+
+void ThumbnailAtlas::commit(uint64_t key, uint32_t page, uint32_t slot,
+                            const D2D1_RECT_U& padded, const D2D1_RECT_F& dest) {
+    pages_[page]->slots[slot].key = key;
+    --pages_[page]->free_slots;
+    D2D1_RECT_U source = D2D1::RectU(padded.left + kBorder, padded.top + kBorder,
+                                     padded.right - kBorder, padded.bottom - kBorder);
+    auto it = resident_.emplace(key, Location{page, slot, source}).first;
+    queue(it->second, dest);
+}
+
+void ThumbnailAtlas::queue(const Location& location, const D2D1_RECT_F& dest) {
+    auto& page = *pages_[location.page];
+    page.slots[location.slot].last_used = frame_;
+    page.queued.push_back({dest, location.source});
+}
+
+void ThumbnailAtlas::flush(ID2D1RenderTarget* rt) {
+    if (!rt || rt != target_) {
+        return;
+    }
+
+    if (!dc3_checked_) {
+        dc3_checked_ = true;
+        if (SUCCEEDED(rt->QueryInterface(IID_PPV_ARGS(&dc3_))) &&
+            FAILED(dc3_->CreateSpriteBatch(&batch_))) {
+            dc3_.Reset();
+        }
+    }
+
+    // Sprite batches only draw with aliased antialiasing; cells are axis-aligned anyway
+    D2D1_ANTIALIAS_MODE previous = rt->GetAntialiasMode();
+    if (batch_) {
+        rt->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    }
+
+    for (auto& page : pages_) {
+        if (!page || page->queued.empty()) {
+            continue;
+        }
+        if (batch_) {
+            dests_.clear();
+            sources_.clear();
+            for (const auto& sprite : page->queued) {
+                dests_.push_back(sprite.dest);
+                sources_.push_back(sprite.source);
+            }
+            batch_->Clear();
+            if (SUCCEEDED(batch_->AddSprites(static_cast<UINT32>(dests_.size()), dests_.data(),
+                                             sources_.data()))) {
+                dc3_->DrawSpriteBatch(batch_.Get(), page->bitmap.Get(),
+                                      D2D1_BITMAP_INTERPOLATION_MODE_LINEAR,
+                                      D2D1_SPRITE_OPTIONS_NONE);
+            }
+        } else {
+            for (const auto& sprite : page->queued) {
+                D2D1_RECT_F source = D2D1::RectF(
+                    static_cast<float>(sprite.source.left), static_cast<float>(sprite.source.top),
+                    static_cast<float>(sprite.source.right),
+                    static_cast<float>(sprite.source.bottom));
+                rt->DrawBitmap(page->bitmap.Get(), &sprite.dest, 1.0f,
+                               D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, &source);
+            }
+        }
+        page->queued.clear();
+    }
+
+    if (batch_) {
+        rt->SetAntialiasMode(previous);
+    }
+}
+
+void ThumbnailAtlas::remove(uint64_t key) {
+    auto it = resident_.find(key);
+    if (it != resident_.end()) {
+        evict(it->second.page, it->second.slot);
+    }
+}
+
+void ThumbnailAtlas::clear() {
+    for (auto& page : pages_) {
+        if (!page) {
+            continue;
+        }
+        for (auto& slot : page->slots) {
+            slot.key = kFreeSlot;
+        }
+        page->free_slots = page->slots.size();
+        page->queued.clear();
+    }
+    resident_.clear();
+}
+
+void ThumbnailAtlas::reset() {
+    pages_.clear();
+    live_pages_ = 0;
+    resident_.clear();
+    target_ = nullptr;
+    batch_.Reset();
+    dc3_.Reset();
+    dc3_checked_ = false;
+}
+
+bool ThumbnailAtlas::allocate(ID2D1RenderTarget* rt, uint32_t slot_size, uint32_t& page,
+                              uint32_t& slot) {
+    for (uint32_t p = 0; p < pages_.size(); ++p) {
+        const auto& candidate = pages_[p];
+        if (!candidate || candidate->slot_size != slot_size || candidate->free_slots == 0) {
+            continue;
+        }
+        for (uint32_t s = 0; s < candidate->slots.size(); ++s) {
+            if (candidate->slots[s].key == kFreeSlot) {
+                page = p;
+                slot = s;
+                return true;
+            }
+        }
+    }
+
+    if (live_pages_ < kMaxPages && addPage(rt, slot_size, page)) {
+        slot = 0;
+        return true;
+    }
+
+    // Least recently drawn slot of the size that the current frame has not used
+    uint64_t oldest = frame_;
+    bool found = false;
+    for (uint32_t p = 0; p < pages_.size(); ++p) {
+        const auto& candidate = pages_[p];
+        if (!candidate || candidate->slot_size != slot_size) {
+            continue;
+        }
+        for (uint32_t s = 0; s < candidate->slots.size(); ++s) {
+            if (candidate->slots[s].last_used < oldest) {
+                oldest = candidate->slots[s].last_used;
+                page = p;
+                slot = s;
+                found = true;
+            }
+        }
+    }
+    if (found) {
+        evict(page, slot);
+        return true;
+    }
+
+    // Trade an idle page of another size for one of this size; past that the
+    // visible set needs more than kMaxPages
+    releaseIdlePage(slot_size);
+    if (addPage(rt, slot_size, page)) {
+        slot = 0;
+        return true;
+    }
+    return false;
+}
+
+bool ThumbnailAtlas::addPage(ID2D1RenderTarget* rt, uint32_t slot_size, uint32_t& page) {
+    D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), 96.0f,
+        96.0f);
+
+    auto created = std::make_unique<Page>();
+    HRESULT hr =
+        rt->CreateBitmap(D2D1::SizeU(kPageSize, kPageSize), nullptr, 0, props, &created->bitmap);
+    if (FAILED(hr)) {
+        LOG_WARN("Thumbnail atlas page creation failed: 0x{:08X}", static_cast<uint32_t>(hr));
+        return false;
+    }
+    created->slot_size = slot_size;
+    created->columns = kPageSize / (slot_size + 2 * kBorder);
+    created->slots.resize(static_cast<size_t>(created->columns) * created->columns);
+    created->free_slots = created->slots.size();
+
+    auto released = std::ranges::find(pages_, nullptr);
+    page = static_cast<uint32_t>(released - pages_.begin());
+    if (released == pages_.end()) {
+        pages_.push_back(std::move(created));
+    } else {
+        *released = std::move(created);
+    }
+    ++live_pages_;
+    return true;
+}
+
+bool ThumbnailAtlas::releaseIdlePage(uint32_t keep_slot_size) {
+    uint64_t oldest = frame_;
+    auto victim = pages_.end();
+    for (auto it = pages_.begin(); it != pages_.end(); ++it) {
+        if (!*it || (*it)->slot_size == keep_slot_size) {
+            continue;
+        }
+        uint64_t newest = 0;
+        for (const auto& slot : (*it)->slots) {
+            newest = (std::max)(newest, slot.last_used);
+        }
+        if (newest < oldest) {
+            oldest = newest;
+            victim = it;
+        }
+    }
+    if (victim == pages_.end()) {
+        return false;
+    }
+
+    for (const auto& slot : (*victim)->slots) {
+        if (slot.key != kFreeSlot) {
+            resident_.erase(slot.key);
+        }
+    }
+    victim->reset();
+    --live_pages_;
+    return true;
+}
+
+void ThumbnailAtlas::evict(uint32_t page, uint32_t slot) {
+    auto& entry = pages_[page]->slots[slot];
+    if (entry.key == kFreeSlot) {
+        return;
+    }
+    resident_.erase(entry.key);
+    entry.key = kFreeSlot;
+    ++pages_[page]->free_slots;
+}
+
+}  // namespace nive::ui::d2d
@@ -0,0 +1,161 @@
+/// @file thumbnail_atlas.hpp
+/// @brief Thumbnails packed into a few large bitmaps and drawn in batches
+
+#pragma once
+
+#include <d2d1_3.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core/util/com_ptr.hpp"
+
+namespace nive::image {
+class DecodedImage;
+class ImageView;
+}
+
+namespace nive::ui::d2d {
+
+/// @brief GPU cache of small BGRA images in shared pages, drawn as sprites
+///
+/// Each page is one kPageSize square bitmap cut into equal slots of a power
+/// of two size (kMinSlotSize to kMaxSlotSize); an image goes into the
+/// smallest slot size that holds it, with a one-pixel border copied from its
+/// edges so linear filtering never samples a neighbour. Slots are uploaded
+/// when first drawn. Once kMaxPages pages exist, the least recently drawn
+/// slot of the size is reused, then whole pages of other sizes idle since
+/// an earlier frame; slots drawn in the current frame are never reused, so
+/// the visible set always fits even if that takes more pages.
+///
+/// draw() only queues; flush() issues one DrawSpriteBatch per page on a
+/// D2D 1.3 device context (Windows 10 1607 and later), or one DrawBitmap per
+/// image from the page elsewhere. Pages belong to one render target; a new
+/// target (device lost) drops them all and images are uploaded again.
+class ThumbnailAtlas {
+public:
+    /// @brief Side of a page in pixels
+    static constexpr uint32_t kPageSize = 2048;
+
+    /// @brief Smallest and largest slot sizes; larger images need a bitmap of their own
+    static constexpr uint32_t kMinSlotSize = 64;
+    static constexpr uint32_t kMaxSlotSize = 512;
+
+    /// @brief Pages kept before slots are reused (16 MiB each)
+    static constexpr size_t kMaxPages = 8;
+
+    /// @brief Pixels of edge copied around each image in its slot (see padImage)
+    static constexpr uint32_t kBorder = 1;
+
+    ThumbnailAtlas() = default;
+    ~ThumbnailAtlas();
+
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    /// @brief Check if an image can be held by the atlas
+    /// @return true for valid BGRA32 images no larger than kMaxSlotSize on either side
+    [[nodiscard]] static bool fits(image::ImageView image) noexcept;
+
+    /// @brief Start a frame: slots drawn from here on are in use until the next call
+    void beginFrame() noexcept { ++frame_; }
+
+    /// @brief Queue an image for drawing, uploading it if it is not resident
+    /// @param rt Render target being drawn to; another target than before resets the atlas
+    /// @param key Identifies the image; the same key must mean the same pixels until remove()
+    /// @param image Pixels to upload (see fits()); may be empty while the key is resident
+    /// @param dest Destination in DIPs
+    /// @return false if the image is not resident and could not be uploaded (nothing is
+    ///         queued); once true, the caller may drop its pixels until this returns false
+    bool draw(ID2D1RenderTarget* rt, uint64_t key, image::ImageView image,
+              const D2D1_RECT_F& dest);
+
+    /// @brief Queue an image already on the GPU, copying it into a slot if it is not resident
+    /// @param staged The image padded by kBorder (see padImage), created on the device of rt;
+    ///               may be null while the key is resident
+    /// @param width Image width without the border
+    /// @param height Image height without the border
+    /// @return As for the pixel overload; the copy stays on the GPU
+    bool draw(ID2D1RenderTarget* rt, uint64_t key, ID2D1Bitmap* staged, uint32_t width,
+              uint32_t height, const D2D1_RECT_F& dest);
+
+    /// @brief Draw the queued images, one batch per page
+    /// @param rt Render target passed to draw(), between BeginDraw and EndDraw
+    void flush(ID2D1RenderTarget* rt);
+
+    /// @brief Forget an image whose pixels changed or that is no longer shown
+    void remove(uint64_t key);
+
+    /// @brief Forget every image, keeping the pages for reuse
+    void clear();
+
+    /// @brief Get the bytes of the pages held (4 bytes a pixel)
+    [[nodiscard]] uint64_t gpuBytes() const noexcept {
+        return static_cast<uint64_t>(live_pages_) * kPageSize * kPageSize * 4;
+    }
+
+    /// @brief Release the pages (device lost, window destroyed)
+    void reset();
+
+private:
+    struct Page;
+
+    /// @brief Where a resident image is
+    struct Location {
+        uint32_t page = 0;
+        uint32_t slot = 0;
+        D2D1_RECT_U source{};  // Image pixels within the page, without the border
+    };
+
+    /// @brief Queued draw
+    struct Sprite {
+        D2D1_RECT_F dest;
+        D2D1_RECT_U source;
+    };
+
+    /// @brief Find or make a free slot of a size, evicting as described above
+    /// @return Page and slot index, or false if no page could be created
+    bool allocate(ID2D1RenderTarget* rt, uint32_t slot_size, uint32_t& page, uint32_t& slot);
+
+    /// @brief Create a page of a slot size, in a released page's place if any
+    bool addPage(ID2D1RenderTarget* rt, uint32_t slot_size, uint32_t& page);
+
+    /// @brief Drop the page idle the longest, other than those of a slot size
+    /// @return false if every page was drawn from in this frame
+    bool releaseIdlePage(uint32_t keep_slot_size);
+
+    /// @brief Free a slot, forgetting its image
+    void evict(uint32_t page, uint32_t slot);
+
+    /// @brief Switch to a render target, dropping pages of another
+    /// @return false without a target
+    bool useTarget(ID2D1RenderTarget* rt);
+
+    /// @brief Find or make a slot for an image of a size
+    /// @param padded Receives the slot area the padded image goes to
+    bool reserve(ID2D1RenderTarget* rt, uint32_t width, uint32_t height, uint32_t& page,
+                 uint32_t& slot, D2D1_RECT_U& padded);
+
+    /// @brief Record a filled slot as holding a key and queue it
+    void commit(uint64_t key, uint32_t page, uint32_t slot, const D2D1_RECT_U& padded,
+                const D2D1_RECT_F& dest);
+
+    /// @brief Queue a resident image
+    void queue(const Location& location, const D2D1_RECT_F& dest);
+
+    ID2D1RenderTarget* target_ = nullptr;  // Only compared; pages are released on change
+    std::vector<std::unique_ptr<Page>> pages_;  // Released pages stay as null entries
+    size_t live_pages_ = 0;
+    std::unordered_map<uint64_t, Location> resident_;
+    uint64_t frame_ = 1;
+
+    ComPtr<ID2D1DeviceContext3> dc3_;  // Null before Windows 10 1607
+    ComPtr<ID2D1SpriteBatch> batch_;
+    bool dc3_checked_ = false;
+    std::vector<D2D1_RECT_F> dests_;  // flush() scratch
+    std::vector<D2D1_RECT_U> sources_;
+};
+
+}  // namespace nive::ui::d2d
@@ -6,6 +6,8 @@
 #include <windowsx.h>
 
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 #include "core/util/logger.hpp"
 #include "ui/d2d/components/button.hpp"
@@ -220,10 +222,16 @@ LRESULT D2DDialog::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         PAINTSTRUCT ps;
         BeginPaint(hwnd_, &ps);
 
-        if (device_resources_.beginDraw()) {
+        if (device_resources_.beginDraw(&ps.rcPaint)) {
             auto rt = device_resources_.renderTarget();
+            // Components outside the dirty area are skipped, not just clipped
+            D2D1_RECT_F draw = device_resources_.drawRect();
+            Rect previous = std::exchange(
+                paint_area_, Rect{draw.left, draw.top, draw.right - draw.left,
+                                  draw.bottom - draw.top});
             rt->Clear(D2D1::ColorF(D2D1::ColorF::White));
             onRender(rt);
+            paint_area_ = previous;
             device_resources_.endDraw();
         }
 
@@ -472,8 +480,13 @@ LRESULT D2DDialog::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
 
     case WM_TIMER: {
         if (wParam == kCaretBlinkTimerId) {
-            // Repaint for caret blink animation
-            InvalidateRect(hwnd_, nullptr, FALSE);
+            // Repaint only the caret of the focused input, if any
+            if (auto* focused = findFocusedInputComponent()) {
+                Rect caret = focused->compositionRect();
+                if (!caret.isEmpty()) {
+                    focused->invalidateRect(caret.inflated(1.0f, 1.0f));
+                }
+            }
         }
         return 0;
     }
@@ -489,9 +502,26 @@ LRESULT D2DDialog::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         return 0;
     }
 
+    if (msg >= WM_APP && msg < 0xC000 && onAppMessage(msg, wParam, lParam)) {
+        return 0;
+    }
     return DefWindowProcW(hwnd_, msg, wParam, lParam);
 }
 
+void D2DDialog::onInvalidate(const Rect& area) {
+    if (!hwnd_) {
+        return;
+    }
+    // DIPs to client pixels, rounded outwards
+    float scale_x = device_resources_.dpiX() / 96.0f;
+    float scale_y = device_resources_.dpiY() / 96.0f;
+    RECT rc = {static_cast<LONG>(std::floor(area.x * scale_x)),
+               static_cast<LONG>(std::floor(area.y * scale_y)),
+               static_cast<LONG>(std::ceil(area.right() * scale_x)),
+               static_cast<LONG>(std::ceil(area.bottom() * scale_y))};
+    InvalidateRect(hwnd_, &rc, FALSE);
+}
+
 void D2DDialog::onRender(ID2D1RenderTarget* rt) {
     renderChildren(rt);
 }
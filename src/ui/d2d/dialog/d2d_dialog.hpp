@@ -70,6 +70,12 @@ protected:
     /// @return true to allow close, false to cancel
     virtual bool onClose() { return true; }
 
+    /// @brief Called for WM_APP range messages, e.g. results posted by workers
+    /// @return true if handled
+    virtual bool onAppMessage(UINT /*msg*/, WPARAM /*wParam*/, LPARAM /*lParam*/) {
+        return false;
+    }
+
     /// @brief End the dialog with a result
     void endDialog(INT_PTR result);
 
@@ -97,12 +103,11 @@ protected:
     /// @brief Set the default button (activated by Enter key)
     void setDefaultButton(D2DButton* button) noexcept { default_button_ = button; }
 
-    /// @brief Request repaint when child components call invalidate()
-    void onInvalidate() override {
-        if (hwnd_) {
-            InvalidateRect(hwnd_, nullptr, FALSE);
-        }
-    }
+    /// @brief Add an area invalidated by a component to the window's update region
+    void onInvalidate(const Rect& area) override;
+
+    /// @brief Get the part of the window the WM_PAINT being handled redraws
+    [[nodiscard]] Rect paintArea() const override { return paint_area_; }
 
 private:
     static LRESULT CALLBACK windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -131,6 +136,7 @@ private:
     HWND hwnd_ = nullptr;
     HWND parent_ = nullptr;
     DeviceResources device_resources_;
+    Rect paint_area_{-1e9f, -1e9f, 2e9f, 2e9f};  // Everything outside WM_PAINT
     INT_PTR result_ = IDCANCEL;
 
     std::wstring title_;
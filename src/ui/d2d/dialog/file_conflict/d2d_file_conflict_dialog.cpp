@@ -9,8 +9,7 @@
 #include "core/config/settings.hpp"
 #include "core/i18n/i18n.hpp"
 #include "core/fs/file_operations.hpp"
-#include "core/image/image_scaler.hpp"
-#include "core/image/wic_decoder.hpp"
+#include "core/thumbnail/thumbnail_generator.hpp"
 #include "ui/app.hpp"
 #include "ui/d2d/core/bitmap_utils.hpp"
 #include "ui/d2d/core/d2d_factory.hpp"
@@ -51,30 +50,6 @@ int getDefaultRadioIndex(config::ConflictResolution res) {
     }
 }
 
-// Load a decoded image for a path (use cache or load from file)
-std::unique_ptr<image::DecodedImage> loadThumbnailImage(const std::filesystem::path& path) {
-    // Try to get from cache
-    auto* cache = App::instance().cache();
-    if (cache) {
-        auto result = cache->getThumbnail(path);
-        if (result) {
-            return std::make_unique<image::DecodedImage>(std::move(*result));
-        }
-    }
-
-    // Not in cache, try loading the actual file and create a thumbnail
-    image::WicDecoder decoder;
-    auto result = decoder.decode(path);
-    if (result) {
-        auto thumb = image::generateThumbnail(*result, 384);
-        if (thumb) {
-            return std::make_unique<image::DecodedImage>(std::move(*thumb));
-        }
-    }
-
-    return nullptr;
-}
-
 }  // namespace
 
 D2DFileConflictDialog::D2DFileConflictDialog() {
@@ -91,6 +66,7 @@ D2DFileConflictDialog::show(HWND parent, const fs::FileConflictInfo& conflict) {
     cancelled_ = true;
 
     showModal(parent);
+    releaseThumbnailRequests();
 
     if (cancelled_) {
         return std::nullopt;
@@ -431,19 +407,103 @@ void D2DFileConflictDialog::populateFromConflict() {
 }
 
 void D2DFileConflictDialog::loadThumbnails() {
-    source_image_ = loadThumbnailImage(conflict_->source_path);
-    dest_image_ = loadThumbnailImage(conflict_->dest_path);
+    source_image_.reset();
+    dest_image_.reset();
+    source_bitmap_.Reset();
+    dest_bitmap_.Reset();
+
+    auto* generator = App::instance().thumbnails();
+    if (!generator || !generator->isRunning()) {
+        return;  // Placeholders only
+    }
 
-    auto* rt = deviceResources().renderTarget();
-    if (!rt)
+    previews_ = std::make_shared<PreviewState>();
+    previews_->hwnd = hwnd();
+
+    // Size 0 is the grid's size, so thumbnails the grid cached are hits
+    auto request = [&](const std::filesystem::path& path, bool source) {
+        return generator->request(
+            path,
+            [state = previews_, source](thumbnail::ThumbnailResult result) {
+                std::lock_guard lock(state->mutex);
+                if (!state->hwnd) {
+                    return;
+                }
+                if (result.success()) {
+                    (source ? state->source : state->dest) = std::move(*result.thumbnail);
+                }
+                // A preview pass is followed by the refined thumbnail
+                if (!result.preview) {
+                    (source ? state->source_done : state->dest_done) = true;
+                }
+                PostMessageW(state->hwnd, kWmPreviewReady, 0, 0);
+            },
+            thumbnail::Priority::High);
+    };
+    source_loading_ = dest_loading_ = true;
+    source_request_ = request(conflict_->source_path, true);
+    dest_request_ = request(conflict_->dest_path, false);
+}
+
+void D2DFileConflictDialog::releaseThumbnailRequests() {
+    if (!previews_) {
+        return;
+    }
+    {
+        std::lock_guard lock(previews_->mutex);
+        previews_->hwnd = nullptr;
+    }
+    if (auto* generator = App::instance().thumbnails()) {
+        for (auto id : {source_request_, dest_request_}) {
+            if (id != 0) {
+                (void)generator->cancel(id);
+            }
+        }
+    }
+    previews_.reset();
+    source_request_ = dest_request_ = 0;
+    source_loading_ = dest_loading_ = false;
+}
+
+void D2DFileConflictDialog::takePreviews() {
+    if (!previews_) {
         return;
+    }
+    std::optional<image::DecodedImage> source;
+    std::optional<image::DecodedImage> dest;
+    {
+        std::lock_guard lock(previews_->mutex);
+        source = std::move(previews_->source);
+        dest = std::move(previews_->dest);
+        previews_->source.reset();
+        previews_->dest.reset();
+        source_loading_ = !previews_->source_done;
+        dest_loading_ = !previews_->dest_done;
+    }
 
-    if (source_image_) {
-        source_bitmap_ = createBitmapFromDecodedImage(rt, *source_image_);
+    // Bitmaps are made here, or by onRender() after a device loss
+    auto* rt = deviceResources().renderTarget();
+    if (source) {
+        source_image_ = std::make_unique<image::DecodedImage>(std::move(*source));
+        if (rt) {
+            source_bitmap_ = createBitmapFromDecodedImage(rt, *source_image_);
+        }
     }
-    if (dest_image_) {
-        dest_bitmap_ = createBitmapFromDecodedImage(rt, *dest_image_);
+    if (dest) {
+        dest_image_ = std::make_unique<image::DecodedImage>(std::move(*dest));
+        if (rt) {
+            dest_bitmap_ = createBitmapFromDecodedImage(rt, *dest_image_);
+        }
     }
+    invalidate();
+}
+
+bool D2DFileConflictDialog::onAppMessage(UINT msg, WPARAM /*wParam*/, LPARAM /*lParam*/) {
+    if (msg != kWmPreviewReady) {
+        return false;
+    }
+    takePreviews();
+    return true;
 }
 
 void D2DFileConflictDialog::onRender(ID2D1RenderTarget* rt) {
@@ -499,8 +559,8 @@ void D2DFileConflictDialog::onRender(ID2D1RenderTarget* rt) {
     D2DDialog::onRender(rt);
 
     // Render thumbnails on top of reserved areas
-    renderThumbnail(rt, source_thumb_area_, source_bitmap_.Get());
-    renderThumbnail(rt, dest_thumb_area_, dest_bitmap_.Get());
+    renderThumbnail(rt, source_thumb_area_, source_bitmap_.Get(), source_loading_);
+    renderThumbnail(rt, dest_thumb_area_, dest_bitmap_.Get(), dest_loading_);
 
     // Draw border around thumbnail areas
     rt->DrawRectangle(source_thumb_area_.toD2D(), separator_brush_.Get(), 1.0f);
@@ -526,7 +586,7 @@ void D2DFileConflictDialog::onRender(ID2D1RenderTarget* rt) {
 }
 
 void D2DFileConflictDialog::renderThumbnail(ID2D1RenderTarget* rt, const Rect& area,
-                                             ID2D1Bitmap* bitmap) const {
+                                             ID2D1Bitmap* bitmap, bool loading) const {
     if (bitmap) {
         auto bmp_size = bitmap->GetSize();
 
@@ -545,10 +605,10 @@ void D2DFileConflictDialog::renderThumbnail(ID2D1RenderTarget* rt, const Rect& a
         D2D1_RECT_F dest_rect = D2D1::RectF(x, y, x + scaled_w, y + scaled_h);
         rt->DrawBitmap(bitmap, dest_rect, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
     } else {
-        // Draw placeholder
+        // Draw placeholder; the text only once there is no preview to wait for
         rt->FillRectangle(area.toD2D(), placeholder_bg_brush_.Get());
 
-        if (placeholder_text_brush_ && arrow_text_format_) {
+        if (!loading && placeholder_text_brush_ && arrow_text_format_) {
             auto& no_preview = i18n::tr("dialog.conflict.no_preview");
             rt->DrawText(no_preview.c_str(), static_cast<UINT32>(no_preview.size()),
                          arrow_text_format_.Get(), area.toD2D(), placeholder_text_brush_.Get());
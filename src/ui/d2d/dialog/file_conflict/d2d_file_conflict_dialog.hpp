@@ -5,10 +5,13 @@
 
 #include <d2d1.h>
 
+#include <memory>
+#include <mutex>
 #include <optional>
 
 #include "core/fs/file_conflict.hpp"
 #include "core/image/decoded_image.hpp"
+#include "core/thumbnail/thumbnail_request.hpp"
 #include "core/util/com_ptr.hpp"
 #include "ui/d2d/components/button.hpp"
 #include "ui/d2d/components/checkbox.hpp"
@@ -24,6 +27,10 @@ namespace nive::ui::d2d {
 /// Shows source and destination file information with thumbnails,
 /// and allows the user to choose how to resolve the conflict.
 /// Extends D2DDialog using the D2D component framework.
+///
+/// The thumbnails are requested from the app's ThumbnailGenerator at High
+/// priority when the dialog opens, so it paints at once with placeholders
+/// and shares the grid's cache; results arrive as kWmPreviewReady.
 class D2DFileConflictDialog : public D2DDialog {
 public:
     D2DFileConflictDialog();
@@ -42,16 +49,35 @@ protected:
     void onCreate() override;
     void onRender(ID2D1RenderTarget* rt) override;
     void onResize(float width, float height) override;
+    bool onAppMessage(UINT msg, WPARAM wParam, LPARAM lParam) override;
 
 private:
+    // Posted by generator workers when a requested thumbnail is ready
+    static constexpr UINT kWmPreviewReady = WM_APP + 1;
+
+    /// @brief Results of the thumbnail requests, shared with their callbacks
+    ///
+    /// Outlives the dialog when a callback is still running; hwnd is cleared
+    /// when the dialog closes, so late results are dropped.
+    struct PreviewState {
+        std::mutex mutex;
+        HWND hwnd = nullptr;
+        std::optional<image::DecodedImage> source;
+        std::optional<image::DecodedImage> dest;
+        bool source_done = false;
+        bool dest_done = false;
+    };
+
     void createComponents();
     void layoutComponents();
     void resizeToFitContent();
     void populateFromConflict();
     void loadThumbnails();
+    void releaseThumbnailRequests();
+    void takePreviews();
 
-    void renderThumbnail(ID2D1RenderTarget* rt, const Rect& area,
-                         ID2D1Bitmap* bitmap) const;
+    void renderThumbnail(ID2D1RenderTarget* rt, const Rect& area, ID2D1Bitmap* bitmap,
+                         bool loading) const;
     void renderArrow(ID2D1RenderTarget* rt, const Rect& source_area,
                      const Rect& dest_area) const;
     void renderSeparator(ID2D1RenderTarget* rt, float x, float y, float width) const;
@@ -77,6 +103,13 @@ private:
     std::unique_ptr<image::DecodedImage> source_image_;
     std::unique_ptr<image::DecodedImage> dest_image_;
 
+    // Pending thumbnail requests (0 = none)
+    std::shared_ptr<PreviewState> previews_;
+    thumbnail::RequestId source_request_ = 0;
+    thumbnail::RequestId dest_request_ = 0;
+    bool source_loading_ = false;
+    bool dest_loading_ = false;
+
     // Thumbnail reserved area rects (set during layout, used during render)
     Rect source_thumb_area_;
     Rect dest_thumb_area_;
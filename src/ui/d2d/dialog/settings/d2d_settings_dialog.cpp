@@ -357,7 +357,9 @@ std::unique_ptr<D2DContainerComponent> D2DSettingsDialog::createSortingTab() {
                             std::wstring(i18n::tr("dialog.settings.sorting.lexicographic")),
                             std::wstring(i18n::tr("dialog.settings.sorting.date_modified")),
                             std::wstring(i18n::tr("dialog.settings.sorting.date_created")),
-                            std::wstring(i18n::tr("dialog.settings.sorting.size"))});
+                            std::wstring(i18n::tr("dialog.settings.sorting.size")),
+                            std::wstring(i18n::tr("dialog.settings.sorting.date_taken")),
+                            std::wstring(i18n::tr("dialog.settings.sorting.camera_model"))});
     method_combo->createResources(deviceResources());
     sort_method_combo_ = method_combo.get();
     container->addChild(std::move(method_combo));
@@ -816,6 +818,12 @@ void D2DSettingsDialog::populateFromSettings() {
     case config::SortMethod::Size:
         method_index = 4;
         break;
+    case config::SortMethod::DateTaken:
+        method_index = 5;
+        break;
+    case config::SortMethod::CameraModel:
+        method_index = 6;
+        break;
     }
     sort_method_combo_->setSelectedIndex(method_index);
     sort_order_combo_->setSelectedIndex(settings_->sort.ascending ? 0 : 1);
@@ -922,6 +930,12 @@ bool D2DSettingsDialog::validateAndSave() {
     case 4:
         settings_->sort.method = config::SortMethod::Size;
         break;
+    case 5:
+        settings_->sort.method = config::SortMethod::DateTaken;
+        break;
+    case 6:
+        settings_->sort.method = config::SortMethod::CameraModel;
+        break;
     default:
         settings_->sort.method = config::SortMethod::Natural;
         break;
@@ -1216,14 +1230,12 @@ bool D2DSettingsDialog::onMouseDown(const MouseEvent& event) {
             if (active_popup_->selectDropdownItem(event.position)) {
                 active_popup_->closeDropdown();
                 active_popup_ = nullptr;
-                InvalidateRect(hwnd(), nullptr, FALSE);
                 return true;
             }
         }
         // Click outside dropdown - close it
         active_popup_->closeDropdown();
         active_popup_ = nullptr;
-        InvalidateRect(hwnd(), nullptr, FALSE);
     }
 
     // Forward to base class for normal handling
@@ -1249,7 +1261,6 @@ bool D2DSettingsDialog::onMouseMove(const MouseEvent& event) {
             event.position.y >= dropdown.y && event.position.y < dropdown.y + dropdown.height) {
             int item = active_popup_->hitTestDropdownItem(event.position);
             active_popup_->setHoveredItem(item);
-            InvalidateRect(hwnd(), nullptr, FALSE);
             return true;
         }
     }
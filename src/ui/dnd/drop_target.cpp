@@ -3,12 +3,30 @@
 
 #include "drop_target.hpp"
 
-#include <cwctype>
+#include <utility>
 
 #include <shellapi.h>
 
+
 namespace nive::ui {
 
+namespace {
+
+/// @brief Case-folded form of a path for comparisons (file names ignore case)
+[[nodiscard]] std::wstring path_key(const std::filesystem::path& path) {
+    auto normal = path.lexically_normal();
+    if (!normal.has_filename() && normal.has_relative_path()) {
+        normal = normal.parent_path();  // Trailing separator
+    }
+    std::wstring key = normal.wstring();
+    if (!key.empty()) {
+        CharUpperBuffW(key.data(), static_cast<DWORD>(key.size()));
+    }
+    return key;
+}
+
+}  // namespace
+
 DropTarget::DropTarget(HWND hwnd, FileDropCallback on_drop, GetDropPathCallback get_drop_path)
     : hwnd_(hwnd), on_drop_(std::move(on_drop)), get_drop_path_(std::move(get_drop_path)) {
 }
@@ -51,31 +69,22 @@ STDMETHODIMP DropTarget::DragEnter(IDataObject* pDataObj, DWORD grfKeyState, POI
         return E_INVALIDARG;
     }
 
+    endSession();
     has_valid_data_ = hasFileDrop(pDataObj);
-    first_source_path_.clear();
 
     if (!has_valid_data_) {
         *pdwEffect = DROPEFFECT_NONE;
         return S_OK;
     }
 
-    // Get first source path for drive comparison
-    auto paths = extractFilePaths(pDataObj);
-    if (!paths.empty()) {
-        first_source_path_ = paths[0];
-    }
+    // Parsed once; DragOver and Drop work from the summary
+    beginSession(pDataObj);
 
     // Get destination path
     POINT screenPt = {pt.x, pt.y};
     current_dest_path_ = get_drop_path_ ? get_drop_path_(screenPt) : std::filesystem::path{};
 
-    if (current_dest_path_.empty()) {
-        *pdwEffect = DROPEFFECT_NONE;
-        return S_OK;
-    }
-
-    // Calculate effect
-    *pdwEffect = calculateDropEffect(grfKeyState, first_source_path_, current_dest_path_);
+    *pdwEffect = effectFor(grfKeyState, current_dest_path_);
 
     return S_OK;
 }
@@ -94,21 +103,13 @@ STDMETHODIMP DropTarget::DragOver(DWORD grfKeyState, POINTL pt, DWORD* pdwEffect
     POINT screenPt = {pt.x, pt.y};
     current_dest_path_ = get_drop_path_ ? get_drop_path_(screenPt) : std::filesystem::path{};
 
-    if (current_dest_path_.empty()) {
-        *pdwEffect = DROPEFFECT_NONE;
-        return S_OK;
-    }
-
-    // Calculate effect
-    *pdwEffect = calculateDropEffect(grfKeyState, first_source_path_, current_dest_path_);
+    *pdwEffect = effectFor(grfKeyState, current_dest_path_);
 
     return S_OK;
 }
 
 STDMETHODIMP DropTarget::DragLeave() {
-    has_valid_data_ = false;
-    current_dest_path_.clear();
-    first_source_path_.clear();
+    endSession();
     if (on_drag_end_) {
         on_drag_end_();
     }
@@ -130,31 +131,23 @@ STDMETHODIMP DropTarget::Drop(IDataObject* pDataObj, DWORD grfKeyState, POINTL p
     POINT screenPt = {pt.x, pt.y};
     auto dest_path = get_drop_path_ ? get_drop_path_(screenPt) : std::filesystem::path{};
 
-    if (dest_path.empty()) {
-        *pdwEffect = DROPEFFECT_NONE;
-        return S_OK;
-    }
-
-    // Extract file paths
-    auto paths = extractFilePaths(pDataObj);
-    if (paths.empty()) {
-        *pdwEffect = DROPEFFECT_NONE;
-        return S_OK;
+    // Same data object as in DragEnter; parse again only if that found nothing
+    if (drag_paths_.empty()) {
+        beginSession(pDataObj);
     }
 
     // Calculate final effect
-    DWORD effect = calculateDropEffect(grfKeyState, paths[0], dest_path);
+    DWORD effect = drag_paths_.empty() ? DROPEFFECT_NONE : effectFor(grfKeyState, dest_path);
     *pdwEffect = effect;
 
-    // Call the callback
-    if (on_drop_) {
-        on_drop_(paths, dest_path, effect);
+    // The callback runs after the drag source has been answered
+    if (effect != DROPEFFECT_NONE && on_drop_) {
+        deferred_drops_.push_back({std::move(drag_paths_), std::move(dest_path), effect});
+        PostMessageW(hwnd_, kWmDeferredDrop, 0, 0);
     }
 
     // Clean up
-    has_valid_data_ = false;
-    current_dest_path_.clear();
-    first_source_path_.clear();
+    endSession();
     if (on_drag_end_) {
         on_drag_end_();
     }
@@ -162,6 +155,16 @@ STDMETHODIMP DropTarget::Drop(IDataObject* pDataObj, DWORD grfKeyState, POINTL p
     return S_OK;
 }
 
+void DropTarget::processDeferredDrops() {
+    // A callback may run a modal loop that takes the next drop
+    auto drops = std::exchange(deferred_drops_, {});
+    for (const auto& drop : drops) {
+        if (on_drop_) {
+            on_drop_(drop.files, drop.dest_path, drop.effect);
+        }
+    }
+}
+
 bool DropTarget::registerTarget() {
     if (registered_) {
         return true;
@@ -182,33 +185,77 @@ void DropTarget::revokeTarget() {
     }
 }
 
-DWORD DropTarget::calculateDropEffect(DWORD grfKeyState, const std::filesystem::path& source_path,
-                                      const std::filesystem::path& dest_path) {
-    if (source_path.empty() || dest_path.empty()) {
-        return DROPEFFECT_COPY;  // Default to copy if paths unknown
-    }
-
-    auto source_str = source_path.wstring();
-    auto dest_str = dest_path.wstring();
-
-    // Check if on same drive (compare first character, case-insensitive)
-    bool same_drive = false;
-    if (source_str.length() >= 1 && dest_str.length() >= 1) {
-        same_drive = (std::towupper(source_str[0]) == std::towupper(dest_str[0]));
-    }
-
+DWORD DropTarget::calculateDropEffect(DWORD grfKeyState, bool same_volume) {
     bool ctrl = (grfKeyState & MK_CONTROL) != 0;
     bool shift = (grfKeyState & MK_SHIFT) != 0;
 
-    if (same_drive) {
-        // Same drive: Default = Move, Ctrl = Copy
+    if (same_volume) {
+        // Same volume: Default = Move, Ctrl = Copy
         return ctrl ? DROPEFFECT_COPY : DROPEFFECT_MOVE;
     } else {
-        // Different drive: Default = Copy, Shift = Move
+        // Different volume: Default = Copy, Shift = Move
         return shift ? DROPEFFECT_MOVE : DROPEFFECT_COPY;
     }
 }
 
+void DropTarget::beginSession(IDataObject* pDataObj) {
+    drag_paths_ = extractFilePaths(pDataObj);
+    summary_dest_.clear();
+
+    bool first = true;
+    source_keys_.reserve(drag_paths_.size());
+    for (const auto& path : drag_paths_) {
+        auto volume = path_key(path.root_name());
+        auto parent = path_key(path.parent_path());
+        if (first) {
+            source_volume_ = std::move(volume);
+            source_parent_ = std::move(parent);
+            first = false;
+        } else {
+            if (!source_volume_.empty() && volume != source_volume_) {
+                source_volume_.clear();
+            }
+            if (!source_parent_.empty() && parent != source_parent_) {
+                source_parent_.clear();
+            }
+        }
+        source_keys_.insert(path_key(path));
+    }
+}
+
+void DropTarget::endSession() {
+    has_valid_data_ = false;
+    current_dest_path_.clear();
+    drag_paths_.clear();
+    source_volume_.clear();
+    source_parent_.clear();
+    source_keys_.clear();
+    summary_dest_.clear();
+}
+
+DWORD DropTarget::effectFor(DWORD grfKeyState, const std::filesystem::path& dest_path) {
+    if (dest_path.empty()) {
+        return DROPEFFECT_NONE;
+    }
+    if (drag_paths_.empty()) {
+        return DROPEFFECT_COPY;  // Default to copy if paths unknown
+    }
+
+    // Hit testing reports the same destination for most moves of the pointer
+    if (dest_path != summary_dest_) {
+        summary_dest_ = dest_path;
+        auto dest = path_key(dest_path);
+        dest_same_volume_ =
+            !source_volume_.empty() && path_key(dest_path.root_name()) == source_volume_;
+        dest_rejected_ = dest == source_parent_ || source_keys_.contains(dest);
+    }
+
+    if (dest_rejected_) {
+        return DROPEFFECT_NONE;
+    }
+    return calculateDropEffect(grfKeyState, dest_same_volume_);
+}
+
 bool DropTarget::hasFileDrop(IDataObject* pDataObj) {
     if (!pDataObj) {
         return false;
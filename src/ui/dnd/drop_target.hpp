@@ -10,6 +10,8 @@
 
 #include <filesystem>
 #include <functional>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace nive::ui {
@@ -29,8 +31,18 @@ using GetDropPathCallback = std::function<std::filesystem::path(POINT pt)>;
 /// @brief OLE IDropTarget implementation
 ///
 /// Handles file drops from other applications or within the same application.
+///
+/// The dragged paths are parsed once per drag session, in DragEnter, and
+/// summarized (common volume and parent directory, set of sources). DragOver
+/// and Drop decide the effect from that summary, re-examined only when the
+/// destination changes, so hovering with thousands of files stays smooth.
+/// Drop returns to the drag source at once: the drop callback runs later,
+/// when the window receives kWmDeferredDrop and calls processDeferredDrops().
 class DropTarget : public IDropTarget {
 public:
+    /// @brief Message posted to the window when a drop is waiting to be processed
+    static constexpr UINT kWmDeferredDrop = WM_APP + 51;
+
     /// @brief Create a drop target
     /// @param hwnd Window to receive drops
     /// @param on_drop Callback when files are dropped
@@ -59,33 +71,63 @@ public:
     /// @brief Revoke the drop target registration
     void revokeTarget();
 
-    /// @brief Calculate drop effect based on key state and source/dest drives
+    /// @brief Invoke the drop callback for drops taken since the last call
+    ///
+    /// Call from the window procedure when it receives kWmDeferredDrop.
+    void processDeferredDrops();
+
+    /// @brief Calculate drop effect based on key state and source/dest volumes
     ///
     /// Explorer-compatible behavior:
-    /// - Same drive: Default = Move, Ctrl = Copy
-    /// - Different drive: Default = Copy, Shift = Move
+    /// - Same volume: Default = Move, Ctrl = Copy
+    /// - Different volume: Default = Copy, Shift = Move
     ///
     /// @param grfKeyState Key state flags
-    /// @param source_path First source file path
-    /// @param dest_path Destination directory path
+    /// @param same_volume Every source is on the destination's volume
     /// @return Drop effect (DROPEFFECT_COPY or DROPEFFECT_MOVE)
-    static DWORD calculateDropEffect(DWORD grfKeyState, const std::filesystem::path& source_path,
-                                     const std::filesystem::path& dest_path);
+    static DWORD calculateDropEffect(DWORD grfKeyState, bool same_volume);
 
 private:
+    /// @brief A drop waiting for processDeferredDrops()
+    struct DeferredDrop {
+        std::vector<std::filesystem::path> files;
+        std::filesystem::path dest_path;
+        DWORD effect = DROPEFFECT_NONE;
+    };
+
     bool hasFileDrop(IDataObject* pDataObj);
     std::vector<std::filesystem::path> extractFilePaths(IDataObject* pDataObj);
 
+    /// @brief Parse the dragged paths and summarize them for effect decisions
+    void beginSession(IDataObject* pDataObj);
+
+    /// @brief Forget the drag session
+    void endSession();
+
+    /// @brief Effect for the current destination, from the session summary
+    /// @return DROPEFFECT_NONE if the destination is a source or already holds them all
+    DWORD effectFor(DWORD grfKeyState, const std::filesystem::path& dest_path);
+
     LONG ref_count_ = 1;
     HWND hwnd_;
     FileDropCallback on_drop_;
     GetDropPathCallback get_drop_path_;
     std::function<void()> on_drag_end_;
 
-    // State during drag
+    // State during drag (one session from DragEnter to DragLeave or Drop)
     bool has_valid_data_ = false;
     std::filesystem::path current_dest_path_;
-    std::filesystem::path first_source_path_;
+    std::vector<std::filesystem::path> drag_paths_;
+    std::wstring source_volume_;                    // Common volume, case-folded; empty if mixed
+    std::wstring source_parent_;                    // Common parent, case-folded; empty if mixed
+    std::unordered_set<std::wstring> source_keys_;  // Sources, case-folded
+
+    // Summary for the destination last examined
+    std::filesystem::path summary_dest_;
+    bool dest_same_volume_ = false;
+    bool dest_rejected_ = false;  // Destination is a source, or holds every source already
+
+    std::vector<DeferredDrop> deferred_drops_;  // UI thread only
     bool registered_ = false;
 };
 
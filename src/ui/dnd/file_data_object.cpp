@@ -3,12 +3,59 @@
 
 #include "file_data_object.hpp"
 
+#include <Shlwapi.h>
+
+#include <algorithm>
+#include <cwchar>
+#include <utility>
+
 namespace nive::ui {
 
-FileDataObject::FileDataObject(const std::vector<std::filesystem::path>& paths) : paths_(paths) {
+namespace {
+
+/// @brief Clipboard format for the file descriptor list of virtual files
+[[nodiscard]] CLIPFORMAT file_descriptor_format() {
+    static const auto format =
+        static_cast<CLIPFORMAT>(RegisterClipboardFormatW(CFSTR_FILEDESCRIPTORW));
+    return format;
+}
+
+/// @brief Clipboard format for the contents of one virtual file
+[[nodiscard]] CLIPFORMAT file_contents_format() {
+    static const auto format =
+        static_cast<CLIPFORMAT>(RegisterClipboardFormatW(CFSTR_FILECONTENTS));
+    return format;
+}
+
+/// @brief Fill a descriptor's name, truncated to the field
+void set_descriptor_name(FILEDESCRIPTORW& descriptor, const std::wstring& name) {
+    size_t length = (std::min)(name.size(), std::size(descriptor.cFileName) - 1);
+    std::wmemcpy(descriptor.cFileName, name.c_str(), length);
+    descriptor.cFileName[length] = L'\0';
 }
 
-FileDataObject::~FileDataObject() = default;
+/// @brief Fill a descriptor's size
+void set_descriptor_size(FILEDESCRIPTORW& descriptor, uint64_t size_bytes) {
+    descriptor.dwFlags |= FD_FILESIZE;
+    descriptor.nFileSizeHigh = static_cast<DWORD>(size_bytes >> 32);
+    descriptor.nFileSizeLow = static_cast<DWORD>(size_bytes & 0xFFFFFFFF);
+}
+
+}  // namespace
+
+FileDataObject::FileDataObject(std::vector<std::filesystem::path> paths,
+                               std::vector<VirtualFile> virtual_files)
+    : paths_(std::move(paths)), virtual_files_(std::move(virtual_files)) {
+}
+
+FileDataObject::~FileDataObject() {
+    if (hdrop_) {
+        GlobalFree(hdrop_);
+    }
+    if (descriptors_) {
+        GlobalFree(descriptors_);
+    }
+}
 
 STDMETHODIMP FileDataObject::QueryInterface(REFIID riid, void** ppv) {
     if (!ppv) {
@@ -47,15 +94,33 @@ STDMETHODIMP FileDataObject::GetData(FORMATETC* pformatetcIn, STGMEDIUM* pmedium
         return DV_E_FORMATETC;
     }
 
-    // Create HDROP data
-    HGLOBAL hGlobal = createHDrop();
-    if (!hGlobal) {
-        return E_OUTOFMEMORY;
+    // One stream per file, opened only when the target reads that file
+    if (pformatetcIn->cfFormat == file_contents_format()) {
+        IStream* stream = nullptr;
+        HRESULT hr = createContentStream(pformatetcIn->lindex, &stream);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        pmedium->tymed = TYMED_ISTREAM;
+        pmedium->pstm = stream;
+        pmedium->pUnkForRelease = nullptr;
+        return S_OK;
+    }
+
+    // Rendered once and shared: releasing the medium releases this object
+    // instead of freeing the block
+    HGLOBAL& block = pformatetcIn->cfFormat == CF_HDROP ? hdrop_ : descriptors_;
+    if (!block) {
+        block = pformatetcIn->cfFormat == CF_HDROP ? createHDrop() : createFileDescriptors();
+        if (!block) {
+            return E_OUTOFMEMORY;
+        }
     }
 
     pmedium->tymed = TYMED_HGLOBAL;
-    pmedium->hGlobal = hGlobal;
-    pmedium->pUnkForRelease = nullptr;
+    pmedium->hGlobal = block;
+    pmedium->pUnkForRelease = static_cast<IDataObject*>(this);
+    AddRef();
 
     return S_OK;
 }
@@ -97,11 +162,17 @@ STDMETHODIMP FileDataObject::EnumFormatEtc(DWORD dwDirection, IEnumFORMATETC** p
         return E_NOTIMPL;
     }
 
-    // Create a static array of supported formats
-    static FORMATETC formats[] = {
+    if (hasVirtualFiles()) {
+        FORMATETC formats[] = {
+            {file_descriptor_format(), nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL},
+            {file_contents_format(), nullptr, DVASPECT_CONTENT, -1, TYMED_ISTREAM},
+        };
+        return SHCreateStdEnumFmtEtc(2, formats, ppenumFormatEtc);
+    }
+
+    FORMATETC formats[] = {
         {CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL}
     };
-
     return SHCreateStdEnumFmtEtc(1, formats, ppenumFormatEtc);
 }
 
@@ -127,7 +198,7 @@ HGLOBAL FileDataObject::createHDrop() const {
     // DROPFILES structure + null-terminated file paths + final null terminator
     size_t total_size = sizeof(DROPFILES);
     for (const auto& path : paths_) {
-        total_size += (path.wstring().length() + 1) * sizeof(wchar_t);
+        total_size += (path.native().length() + 1) * sizeof(wchar_t);
     }
     total_size += sizeof(wchar_t);  // Final null terminator
 
@@ -154,8 +225,8 @@ HGLOBAL FileDataObject::createHDrop() const {
     auto* dest =
         reinterpret_cast<wchar_t*>(reinterpret_cast<BYTE*>(pDropFiles) + sizeof(DROPFILES));
     for (const auto& path : paths_) {
-        const auto& str = path.wstring();
-        wcscpy(dest, str.c_str());
+        const auto& str = path.native();
+        std::wmemcpy(dest, str.c_str(), str.length() + 1);
         dest += str.length() + 1;
     }
     *dest = L'\0';  // Final null terminator
@@ -164,12 +235,89 @@ HGLOBAL FileDataObject::createHDrop() const {
     return hGlobal;
 }
 
+HGLOBAL FileDataObject::createFileDescriptors() const {
+    size_t count = paths_.size() + virtual_files_.size();
+    if (count == 0) {
+        return nullptr;
+    }
+
+    // FILEGROUPDESCRIPTORW declares one descriptor; the rest follow it
+    size_t total_size = sizeof(FILEGROUPDESCRIPTORW) + (count - 1) * sizeof(FILEDESCRIPTORW);
+    HGLOBAL hGlobal = GlobalAlloc(GHND | GMEM_SHARE, total_size);
+    if (!hGlobal) {
+        return nullptr;
+    }
+
+    auto* group = static_cast<FILEGROUPDESCRIPTORW*>(GlobalLock(hGlobal));
+    if (!group) {
+        GlobalFree(hGlobal);
+        return nullptr;
+    }
+
+    group->cItems = static_cast<UINT>(count);
+    FILEDESCRIPTORW* descriptor = group->fgd;
+    for (const auto& path : paths_) {
+        descriptor->dwFlags = FD_PROGRESSUI;
+        set_descriptor_name(*descriptor, path.filename().wstring());
+        WIN32_FILE_ATTRIBUTE_DATA data = {};
+        if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+            set_descriptor_size(*descriptor, (static_cast<uint64_t>(data.nFileSizeHigh) << 32) |
+                                                 data.nFileSizeLow);
+            descriptor->dwFlags |= FD_WRITESTIME | FD_ATTRIBUTES;
+            descriptor->ftLastWriteTime = data.ftLastWriteTime;
+            descriptor->dwFileAttributes = data.dwFileAttributes;
+        }
+        ++descriptor;
+    }
+    for (const auto& file : virtual_files_) {
+        descriptor->dwFlags = FD_PROGRESSUI;
+        set_descriptor_name(*descriptor, file.name);
+        if (file.size_bytes > 0) {
+            set_descriptor_size(*descriptor, file.size_bytes);
+        }
+        ++descriptor;
+    }
+
+    GlobalUnlock(hGlobal);
+    return hGlobal;
+}
+
+HRESULT FileDataObject::createContentStream(LONG index, IStream** stream) const {
+    if (index < 0 || static_cast<size_t>(index) >= paths_.size() + virtual_files_.size()) {
+        return DV_E_LINDEX;
+    }
+
+    auto position = static_cast<size_t>(index);
+    if (position < paths_.size()) {
+        return SHCreateStreamOnFileEx(paths_[position].c_str(), STGM_READ | STGM_SHARE_DENY_WRITE,
+                                      FILE_ATTRIBUTE_NORMAL, FALSE, nullptr, stream);
+    }
+
+    const auto& file = virtual_files_[position - paths_.size()];
+    auto contents = file.read ? file.read() : std::nullopt;
+    if (!contents) {
+        return E_FAIL;
+    }
+    *stream = SHCreateMemStream(contents->data(), static_cast<UINT>(contents->size()));
+    return *stream ? S_OK : E_OUTOFMEMORY;
+}
+
 bool FileDataObject::isFormatSupported(FORMATETC* pformatetc) const {
-    if (pformatetc->cfFormat != CF_HDROP) {
+    if (pformatetc->dwAspect != DVASPECT_CONTENT) {
         return false;
     }
 
-    if (pformatetc->dwAspect != DVASPECT_CONTENT) {
+    if (hasVirtualFiles()) {
+        if (pformatetc->cfFormat == file_descriptor_format()) {
+            return (pformatetc->tymed & TYMED_HGLOBAL) != 0;
+        }
+        if (pformatetc->cfFormat == file_contents_format()) {
+            return (pformatetc->tymed & TYMED_ISTREAM) != 0;
+        }
+        return false;
+    }
+
+    if (pformatetc->cfFormat != CF_HDROP) {
         return false;
     }
 
@@ -180,8 +328,9 @@ bool FileDataObject::isFormatSupported(FORMATETC* pformatetc) const {
     return true;
 }
 
-IDataObject* createFileDataObject(const std::vector<std::filesystem::path>& paths) {
-    return new FileDataObject(paths);
+IDataObject* createFileDataObject(std::vector<std::filesystem::path> paths,
+                                  std::vector<VirtualFile> virtual_files) {
+    return new FileDataObject(std::move(paths), std::move(virtual_files));
 }
 
 }  // namespace nive::ui
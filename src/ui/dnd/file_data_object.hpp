@@ -8,18 +8,41 @@
 #include <ObjIdl.h>
 #include <ShlObj.h>
 
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace nive::ui {
 
+/// @brief A dragged file that has no path of its own (e.g. an archive entry)
+struct VirtualFile {
+    std::wstring name;        // File name the drop target creates
+    uint64_t size_bytes = 0;  // Shown in the target's progress (0 = unknown)
+    // Produces the contents when the target asks for them (UI thread);
+    // nullopt fails that one file
+    std::function<std::optional<std::vector<uint8_t>>()> read;
+};
+
 /// @brief OLE IDataObject implementation for file paths
 ///
 /// Provides file paths in CF_HDROP format for drag and drop operations.
+/// When virtual files are included, every file is offered instead as
+/// CFSTR_FILEDESCRIPTORW with one CFSTR_FILECONTENTS stream per file:
+/// files on disk are streamed from the disk and virtual files from their
+/// read callback, so nothing is extracted before the target asks for it.
+///
+/// Each HGLOBAL format is rendered once, on the first request, and the
+/// same block is handed to every caller (released through this object).
 class FileDataObject : public IDataObject {
 public:
-    /// @brief Create a data object with the given file paths
-    explicit FileDataObject(const std::vector<std::filesystem::path>& paths);
+    /// @brief Create a data object with the given files
+    /// @param paths Files on disk
+    /// @param virtual_files Files without a path, listed after the others
+    explicit FileDataObject(std::vector<std::filesystem::path> paths,
+                            std::vector<VirtualFile> virtual_files = {});
     virtual ~FileDataObject();
 
     // IUnknown
@@ -39,15 +62,26 @@ public:
     STDMETHOD(DUnadvise)(DWORD dwConnection) override;
     STDMETHOD(EnumDAdvise)(IEnumSTATDATA** ppenumAdvise) override;
 
+    /// @brief Check if the data object carries virtual files (targets can only copy them)
+    [[nodiscard]] bool hasVirtualFiles() const noexcept { return !virtual_files_.empty(); }
+
 private:
     HGLOBAL createHDrop() const;
+    HGLOBAL createFileDescriptors() const;
+    HRESULT createContentStream(LONG index, IStream** stream) const;
     bool isFormatSupported(FORMATETC* pformatetc) const;
 
     LONG ref_count_ = 1;
     std::vector<std::filesystem::path> paths_;
+    std::vector<VirtualFile> virtual_files_;
+
+    // Rendered on first request, freed with the object
+    HGLOBAL hdrop_ = nullptr;
+    HGLOBAL descriptors_ = nullptr;
 };
 
-/// @brief Create a FileDataObject with the given paths
-IDataObject* createFileDataObject(const std::vector<std::filesystem::path>& paths);
+/// @brief Create a FileDataObject with the given files
+IDataObject* createFileDataObject(std::vector<std::filesystem::path> paths,
+                                  std::vector<VirtualFile> virtual_files = {});
 
 }  // namespace nive::ui
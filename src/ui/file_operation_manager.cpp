@@ -3,84 +3,194 @@
 
 #include "file_operation_manager.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <atomic>
 #include <format>
+#include <thread>
+#include <unordered_map>
 
+#include "core/fs/folder_stats.hpp"
+#include "core/fs/io_scheduler.hpp"
 #include "core/fs/trash.hpp"
 #include "core/i18n/i18n.hpp"
+#include "core/util/logger.hpp"
+#include "core/util/string_utils.hpp"
+#include "core/util/task_group.hpp"
+#include "core/util/win32_utils.hpp"
+#include "ui/app.hpp"
 #include "ui/d2d/dialog/delete_confirm/d2d_delete_confirm_dialog.hpp"
 #include "ui/d2d/dialog/file_conflict/d2d_file_conflict_dialog.hpp"
 
 namespace nive::ui {
 
-FileOperationManager::FileOperationManager(HWND parent_window) : parent_window_(parent_window) {
+namespace {
+
+/// @brief Volumes a copy, move or delete of files reads and writes
+[[nodiscard]] std::vector<std::wstring>
+job_volumes(const std::vector<std::filesystem::path>& files,
+            const std::filesystem::path& dest_dir) {
+    std::vector<std::wstring> volumes;
+    if (!files.empty()) {
+        volumes.push_back(fs::volumeName(files.front()));
+    }
+    if (!dest_dir.empty()) {
+        auto dest = fs::volumeName(dest_dir);
+        if (std::ranges::find(volumes, dest) == volumes.end()) {
+            volumes.push_back(std::move(dest));
+        }
+    }
+    return volumes;
 }
 
-// ============================================================================
-// Public API
-// ============================================================================
+/// @brief Total size of the files under the sources, for throughput
+[[nodiscard]] uint64_t total_size(const std::vector<fs::ResolvedFileItem>& items,
+                                  std::stop_token stop) {
+    std::vector<std::filesystem::path> sources;
+    sources.reserve(items.size());
+    for (const auto& item : items) {
+        sources.push_back(item.source_path);
+    }
+    return fs::FolderStats::instance().measure(sources, {}, stop).bytes;
+}
 
-fs::FileOperationResult
-FileOperationManager::copyFiles(const std::vector<std::filesystem::path>& files,
-                                const std::filesystem::path& dest_dir,
-                                const FileOperationOptions& options) {
-    apply_to_all_resolution_.reset();
+/// @brief Moved files handed to the thumbnail cache at a time
+constexpr size_t kRekeyBatchSize = 256;
 
-    auto resolved = resolveAllConflicts(files, dest_dir, options.show_conflict_dialog);
-    if (!resolved) {
-        // User cancelled via conflict dialog
-        fs::FileOperationResult result;
-        result.error = fs::FileOperationError::Cancelled;
-        if (complete_callback_) {
-            complete_callback_(false, result);
-        }
-        return result;
+/// @brief Let the thumbnail cache rekey the entries of moved files, then clear moves
+void rekey_cache(std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& moves) {
+    if (moves.empty()) {
+        return;
     }
+    auto* cache = App::instance().cache();
+    if (cache && cache->isReady()) {
+        cache->rekey(moves);
+    }
+    moves.clear();
+}
 
-    auto result = fs::ShellFileOperation::copyItems(
-        *resolved, {.owner_window = parent_window_, .allow_undo = true});
+/// @brief Files rewritten per pool worker between progress reports
+constexpr size_t kReorientBatchPerWorker = 8;
+
+/// @brief Rotate or flip one JPEG, carrying its cached thumbnail over to the new contents
+/// @return false if the file could not be rewritten
+[[nodiscard]] bool reorient_one(const std::filesystem::path& file,
+                                image::OrientationChange change) {
+    auto* cache = App::instance().cache();
+    std::optional<image::DecodedImage> thumbnail;
+    std::optional<cache::ImageResolution> resolution;
+    if (cache && cache->isReady()) {
+        if (auto before = cache::statSource(file)) {
+            if (auto cached = cache->getThumbnail(file, before)) {
+                thumbnail = std::move(*cached);
+                resolution = cache->getImageResolution(file, before);
+            }
+        }
+    }
 
-    if (!result.failed_files.empty() && result.error != fs::FileOperationError::Cancelled) {
-        showErrorDialog(result, std::wstring(i18n::tr("file_operation.copy")));
+    auto written = image::reorientJpeg(file, change);
+    if (!written) {
+        LOG_WARN("Rotate: {}: {}", pathToUtf8(file), image::to_string(written.error()));
+        return false;
     }
 
-    if (complete_callback_) {
-        complete_callback_(result.succeeded() || result.partiallySucceeded(), result);
+    // The thumbnail turns with the file; the entry for the old contents ages out
+    if (thumbnail && resolution) {
+        if (auto after = cache::statSource(file)) {
+            bool swap = image::swapsAxes(change);
+            (void)cache->putThumbnail(file, image::orientImage(std::move(*thumbnail), change),
+                                      swap ? resolution->height : resolution->width,
+                                      swap ? resolution->width : resolution->height, after);
+        }
     }
+    return true;
+}
 
-    return result;
+}  // namespace
+
+std::wstring jobKindLabel(FileJobKind kind) {
+    switch (kind) {
+    case FileJobKind::Copy:
+        return std::wstring(i18n::tr("file_operation.copy"));
+    case FileJobKind::Move:
+        return std::wstring(i18n::tr("file_operation.move"));
+    case FileJobKind::Export:
+        return std::wstring(i18n::tr("file_operation.export"));
+    case FileJobKind::Reorient:
+        return std::wstring(i18n::tr("file_operation.reorient"));
+    default:
+        return std::wstring(i18n::tr("file_operation.delete"));
+    }
 }
 
-fs::FileOperationResult
-FileOperationManager::moveFiles(const std::vector<std::filesystem::path>& files,
-                                const std::filesystem::path& dest_dir,
-                                const FileOperationOptions& options) {
-    apply_to_all_resolution_.reset();
+/// @brief A queued or running file operation
+struct FileOperationManager::Job {
+    FileJobId id = 0;
+    FileJobKind kind = FileJobKind::Copy;
+    std::vector<std::filesystem::path> files;
+    std::filesystem::path dest_dir;  // Copy, move and export
+    FileOperationOptions options;
+    image::ExportOptions export_options;  // Export
+    image::OrientationChange orientation_change{};  // Reorient
+    std::vector<std::wstring> volumes;
+    std::stop_source stop;
+    std::jthread thread;
+
+    // Guarded by FileOperationManager::mutex_
+    FileJobState state = FileJobState::Queued;
+    bool paused = false;
+    uint64_t work_done = 0;  // IFileOperation progress units
+    uint64_t work_total = 0;
+    uint64_t total_bytes = 0;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point paused_at;
+    std::chrono::steady_clock::duration paused_for{};
+    std::optional<fs::FileConflictInfo> prompt;  // Waiting for the UI to answer
+    std::optional<fs::ConflictResolution> answer;
+    bool answered = false;
+    fs::FileOperationResult result;  // Valid once Finished
+
+    // Job thread only
+    std::optional<fs::ConflictResolution> apply_to_all_resolution;
+    fs::FileIdentityCache identity_cache;
+};
+
+FileOperationManager::FileOperationManager(HWND parent_window) : parent_window_(parent_window) {
+}
 
-    auto resolved = resolveAllConflicts(files, dest_dir, options.show_conflict_dialog);
-    if (!resolved) {
-        fs::FileOperationResult result;
-        result.error = fs::FileOperationError::Cancelled;
-        if (complete_callback_) {
-            complete_callback_(false, result);
+FileOperationManager::~FileOperationManager() {
+    cancelAll();
+    std::vector<std::shared_ptr<Job>> jobs;
+    {
+        std::lock_guard lock(mutex_);
+        jobs = jobs_;
+    }
+    for (auto& job : jobs) {
+        if (job->thread.joinable()) {
+            job->thread.join();
         }
-        return result;
     }
+}
 
-    auto result = fs::ShellFileOperation::moveItems(
-        *resolved, {.owner_window = parent_window_, .allow_undo = true});
-
-    if (!result.failed_files.empty() && result.error != fs::FileOperationError::Cancelled) {
-        showErrorDialog(result, std::wstring(i18n::tr("file_operation.move")));
-    }
+// ============================================================================
+// Public API
+// ============================================================================
 
-    if (complete_callback_) {
-        complete_callback_(result.succeeded() || result.partiallySucceeded(), result);
-    }
+std::optional<fs::FileOperationResult>
+FileOperationManager::copyFiles(const std::vector<std::filesystem::path>& files,
+                                const std::filesystem::path& dest_dir,
+                                const FileOperationOptions& options) {
+    return submit(makeJob(FileJobKind::Copy, files, dest_dir, options));
+}
 
-    return result;
+std::optional<fs::FileOperationResult>
+FileOperationManager::moveFiles(const std::vector<std::filesystem::path>& files,
+                                const std::filesystem::path& dest_dir,
+                                const FileOperationOptions& options) {
+    return submit(makeJob(FileJobKind::Move, files, dest_dir, options));
 }
 
-fs::FileOperationResult
+std::optional<fs::FileOperationResult>
 FileOperationManager::deleteFiles(const std::vector<std::filesystem::path>& files,
                                   const FileOperationOptions& options) {
     fs::FileOperationResult result;
@@ -108,27 +218,30 @@ FileOperationManager::deleteFiles(const std::vector<std::filesystem::path>& file
         use_trash = (confirm_result == DeleteConfirmResult::Trash);
     }
 
-    fs::ShellOperationOptions shell_options{.owner_window = parent_window_};
-
-    if (use_trash) {
-        shell_options.allow_undo = true;
-        result = fs::ShellFileOperation::recycleItems(files, shell_options);
-    } else {
-        result = fs::ShellFileOperation::deleteItems(files, shell_options);
-    }
-
-    if (!result.failed_files.empty() && result.error != fs::FileOperationError::Cancelled) {
-        showErrorDialog(result, std::wstring(i18n::tr("file_operation.delete")));
-    }
+    return submit(
+        makeJob(use_trash ? FileJobKind::Recycle : FileJobKind::Delete, files, {}, options));
+}
 
-    if (complete_callback_) {
-        complete_callback_(result.succeeded() || result.partiallySucceeded(), result);
-    }
+std::optional<fs::FileOperationResult>
+FileOperationManager::exportImages(const std::vector<std::filesystem::path>& files,
+                                   const std::filesystem::path& dest_dir,
+                                   const image::ExportOptions& export_options,
+                                   const FileOperationOptions& options) {
+    auto job = makeJob(FileJobKind::Export, files, dest_dir, options);
+    job->export_options = export_options;
+    return submit(std::move(job));
+}
 
-    return result;
+std::optional<fs::FileOperationResult>
+FileOperationManager::reorientImages(const std::vector<std::filesystem::path>& files,
+                                     image::OrientationChange change,
+                                     const FileOperationOptions& options) {
+    auto job = makeJob(FileJobKind::Reorient, files, {}, options);
+    job->orientation_change = change;
+    return submit(std::move(job));
 }
 
-fs::FileOperationResult
+std::optional<fs::FileOperationResult>
 FileOperationManager::handleDrop(const std::vector<std::filesystem::path>& files,
                                  const std::filesystem::path& dest_dir, DWORD effect,
                                  const FileOperationOptions& options) {
@@ -139,15 +252,407 @@ FileOperationManager::handleDrop(const std::vector<std::filesystem::path>& files
     }
 }
 
+std::expected<std::filesystem::path, fs::FileOperationError>
+FileOperationManager::renameFile(const std::filesystem::path& path, const std::wstring& new_name) {
+    auto renamed = fs::renameFile(path, new_name);
+    if (renamed) {
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> moves{
+            {path, *renamed}};
+        rekey_cache(moves);
+    }
+    return renamed;
+}
+
+void FileOperationManager::pause(FileJobId id) {
+    std::lock_guard lock(mutex_);
+    for (auto& job : jobs_) {
+        if (job->id == id && !job->paused && job->state != FileJobState::Finished) {
+            job->paused = true;
+            job->paused_at = std::chrono::steady_clock::now();
+            if (job->state == FileJobState::Running) {
+                job->state = FileJobState::Paused;
+            }
+            notifyUi();
+        }
+    }
+}
+
+void FileOperationManager::resume(FileJobId id) {
+    std::lock_guard lock(mutex_);
+    for (auto& job : jobs_) {
+        if (job->id == id && job->paused) {
+            job->paused = false;
+            if (job->state == FileJobState::Paused) {
+                job->paused_for += std::chrono::steady_clock::now() - job->paused_at;
+                job->state = FileJobState::Running;
+            }
+            cv_.notify_all();
+            notifyUi();
+        }
+    }
+}
+
+void FileOperationManager::cancel(FileJobId id) {
+    std::lock_guard lock(mutex_);
+    for (auto& job : jobs_) {
+        if (job->id != id || job->state == FileJobState::Finished) {
+            continue;
+        }
+        job->stop.request_stop();  // Wakes a paused or prompting job
+        if (job->state == FileJobState::Queued) {
+            job->result.error = fs::FileOperationError::Cancelled;
+            job->state = FileJobState::Finished;
+        }
+        notifyUi();
+    }
+}
+
+void FileOperationManager::pauseAll() {
+    for (const auto& status : jobs()) {
+        pause(status.id);
+    }
+}
+
+void FileOperationManager::resumeAll() {
+    for (const auto& status : jobs()) {
+        resume(status.id);
+    }
+}
+
+void FileOperationManager::cancelAll() {
+    for (const auto& status : jobs()) {
+        cancel(status.id);
+    }
+}
+
+std::vector<FileJobStatus> FileOperationManager::jobs() const {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+
+    std::vector<FileJobStatus> statuses;
+    statuses.reserve(jobs_.size());
+    for (const auto& job : jobs_) {
+        FileJobStatus status{
+            .id = job->id,
+            .kind = job->kind,
+            .state = job->state,
+            .file_count = job->files.size(),
+        };
+        if (job->work_total > 0) {
+            status.fraction = std::min(
+                1.0, static_cast<double>(job->work_done) / static_cast<double>(job->work_total));
+        }
+        if (job->state == FileJobState::Running || job->state == FileJobState::Paused) {
+            auto elapsed = (job->paused ? job->paused_at : now) - job->started - job->paused_for;
+            double seconds = std::chrono::duration<double>(elapsed).count();
+            if (seconds > 0.5) {
+                status.bytes_per_second = static_cast<uint64_t>(
+                    status.fraction * static_cast<double>(job->total_bytes) / seconds);
+            }
+        }
+        statuses.push_back(status);
+    }
+    return statuses;
+}
+
+void FileOperationManager::handleJobMessage() {
+    std::vector<std::shared_ptr<Job>> finished;
+    std::shared_ptr<Job> prompt_job;
+    std::optional<fs::FileConflictInfo> conflict;
+    {
+        std::lock_guard lock(mutex_);
+        message_posted_ = false;
+
+        auto done = std::ranges::stable_partition(
+            jobs_, [](const auto& job) { return job->state != FileJobState::Finished; });
+        finished.assign(done.begin(), done.end());
+        jobs_.erase(done.begin(), done.end());
+        startReadyJobs();
+
+        // A nested message loop (the dialog) may call in here again; one prompt at a time
+        while (!prompting_ && !conflict && !prompts_.empty()) {
+            auto id = prompts_.front();
+            prompts_.pop_front();
+            for (const auto& job : jobs_) {
+                if (job->id == id && job->prompt) {
+                    prompt_job = job;
+                    conflict = job->prompt;
+                }
+            }
+        }
+    }
+
+    for (auto& job : finished) {
+        if (job->thread.joinable()) {
+            job->thread.join();
+        }
+        completeJob(*job);
+    }
+    if (jobs_changed_callback_) {
+        jobs_changed_callback_();
+    }
+
+    if (conflict) {
+        prompting_ = true;
+        auto answer = showConflictDialog(*conflict);
+        prompting_ = false;
+
+        std::lock_guard lock(mutex_);
+        if (prompt_job->prompt) {
+            prompt_job->answer = answer;
+            prompt_job->answered = true;
+            prompt_job->prompt.reset();
+            cv_.notify_all();
+        }
+        if (!prompts_.empty()) {
+            notifyUi();
+        }
+    }
+}
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+std::shared_ptr<FileOperationManager::Job>
+FileOperationManager::makeJob(FileJobKind kind, const std::vector<std::filesystem::path>& files,
+                              const std::filesystem::path& dest_dir,
+                              const FileOperationOptions& options) {
+    auto job = std::make_shared<Job>();
+    job->id = next_id_++;
+    job->kind = kind;
+    job->files = files;
+    job->dest_dir = dest_dir;
+    job->options = options;
+    job->volumes = job_volumes(files, dest_dir);
+    return job;
+}
+
+std::optional<fs::FileOperationResult> FileOperationManager::submit(std::shared_ptr<Job> job) {
+    if (!job->options.background) {
+        runJob(*job);
+        completeJob(*job);
+        return std::move(job->result);
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        jobs_.push_back(std::move(job));
+        startReadyJobs();
+    }
+    if (jobs_changed_callback_) {
+        jobs_changed_callback_();
+    }
+    return std::nullopt;
+}
+
+void FileOperationManager::startReadyJobs() {
+    size_t running = 0;
+    std::vector<std::wstring> busy;  // Volumes of running jobs and of jobs queued before
+    for (const auto& job : jobs_) {
+        if (job->state == FileJobState::Running || job->state == FileJobState::Paused) {
+            ++running;
+            busy.insert(busy.end(), job->volumes.begin(), job->volumes.end());
+        }
+    }
+
+    for (auto& job : jobs_) {
+        if (running >= kMaxRunningJobs) {
+            break;
+        }
+        if (job->state != FileJobState::Queued) {
+            continue;
+        }
+
+        bool free = std::ranges::none_of(job->volumes, [&](const std::wstring& volume) {
+            return std::ranges::find(busy, volume) != busy.end();
+        });
+        busy.insert(busy.end(), job->volumes.begin(), job->volumes.end());
+        if (!free) {
+            continue;  // Keeps its place ahead of later jobs on the same volumes
+        }
+
+        job->started = std::chrono::steady_clock::now();
+        job->paused_at = job->started;
+        job->state = job->paused ? FileJobState::Paused : FileJobState::Running;
+        job->thread = std::jthread([this, job = job.get()] { runJob(*job); });
+        ++running;
+    }
+}
+
+void FileOperationManager::runJob(Job& job) {
+    ComInitializer com(COINIT_APARTMENTTHREADED);  // IFileOperation needs an STA
+
+    fs::ShellOperationOptions shell_options;
+    if (job.options.background) {
+        // The shell's own progress window would belong to this thread; report to ours instead
+        shell_options.no_ui = true;
+        shell_options.progress = [this, &job](uint64_t done, uint64_t total) {
+            return reportProgress(job, done, total);
+        };
+    } else {
+        shell_options.owner_window = parent_window_;
+    }
+
+    fs::FileOperationResult result;
+    switch (job.kind) {
+    case FileJobKind::Copy:
+    case FileJobKind::Move: {
+        auto resolved = resolveAllConflicts(job);
+        if (!resolved) {
+            result.error = fs::FileOperationError::Cancelled;
+            break;
+        }
+        if (job.options.background) {
+            auto bytes = total_size(*resolved, job.stop.get_token());
+            std::lock_guard lock(mutex_);
+            job.total_bytes = bytes;
+        }
+
+        shell_options.allow_undo = true;
+        if (job.kind == FileJobKind::Copy) {
+            result = fs::ShellFileOperation::copyItems(*resolved, shell_options);
+            break;
+        }
+
+        // Hand moves over while the operation runs, ahead of the change
+        // notifications that would invalidate the entries at the old paths
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> moved;
+        shell_options.moved = [&moved](const std::filesystem::path& from,
+                                       const std::filesystem::path& to) {
+            moved.emplace_back(from, to);
+            if (moved.size() >= kRekeyBatchSize) {
+                rekey_cache(moved);
+            }
+        };
+        result = fs::ShellFileOperation::moveItems(*resolved, shell_options);
+        rekey_cache(moved);
+        break;
+    }
+    case FileJobKind::Recycle:
+        shell_options.allow_undo = true;
+        result = fs::ShellFileOperation::recycleItems(job.files, shell_options);
+        break;
+    case FileJobKind::Delete:
+        result = fs::ShellFileOperation::deleteItems(job.files, shell_options);
+        break;
+    case FileJobKind::Export: {
+        image::ExportProgress progress;
+        if (job.options.background) {
+            progress = [this, &job](uint64_t done, uint64_t total) {
+                return reportProgress(job, done, total);
+            };
+        }
+        auto exported = image::exportImages(job.files, job.dest_dir, job.export_options,
+                                            App::instance().decoders(), progress,
+                                            job.stop.get_token());
+        result.files_processed = exported.exported + exported.resumed;
+        result.failed_files = std::move(exported.failed);
+        if (exported.cancelled) {
+            result.error = fs::FileOperationError::Cancelled;
+        } else if (!result.failed_files.empty()) {
+            result.error = result.files_processed > 0 ? fs::FileOperationError::PartialSuccess
+                                                      : fs::FileOperationError::IoError;
+        }
+        break;
+    }
+    case FileJobKind::Reorient: {
+        // Each file is a small in-place write, so workers take a batch at a
+        // time and progress (and pausing) is checked between batches
+        ThreadPool& pool = globalThreadPool();
+        const size_t batch = std::max<size_t>(pool.workerCount(), 1) * kReorientBatchPerWorker;
+        const size_t total = job.files.size();
+        auto stop = job.stop.get_token();
+        std::atomic<uint64_t> processed{0};
+        std::mutex failed_mutex;
+        for (size_t first = 0; first < total && !stop.stop_requested(); first += batch) {
+            size_t last = std::min(first + batch, total);
+            parallelFor(
+                first, last, 1,
+                [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end && !stop.stop_requested(); ++i) {
+                        if (reorient_one(job.files[i], job.orientation_change)) {
+                            processed.fetch_add(1, std::memory_order_relaxed);
+                        } else {
+                            std::lock_guard lock(failed_mutex);
+                            result.failed_files.push_back(job.files[i]);
+                        }
+                    }
+                },
+                pool, TaskPriority::Low);
+            if (job.options.background && !reportProgress(job, last, total)) {
+                break;
+            }
+        }
+        result.files_processed = processed.load(std::memory_order_relaxed);
+        if (stop.stop_requested()) {
+            result.error = fs::FileOperationError::Cancelled;
+        } else if (!result.failed_files.empty()) {
+            result.error = result.files_processed > 0 ? fs::FileOperationError::PartialSuccess
+                                                      : fs::FileOperationError::IoError;
+        }
+        break;
+    }
+    }
+
+    // Folders written to may be below the watched ones, where no
+    // notification reaches the folder statistics
+    auto& folder_stats = fs::FolderStats::instance();
+    for (const auto& file : job.files) {
+        folder_stats.invalidate(file);
+    }
+    if (!job.dest_dir.empty()) {
+        folder_stats.invalidateTree(job.dest_dir);
+    }
+
+    std::lock_guard lock(mutex_);
+    job.result = std::move(result);
+    job.state = FileJobState::Finished;
+    if (job.options.background) {
+        notifyUi();
+    }
+}
+
+bool FileOperationManager::reportProgress(Job& job, uint64_t done, uint64_t total) {
+    auto stop = job.stop.get_token();
+    std::unique_lock lock(mutex_);
+    job.work_done = done;
+    job.work_total = total;
+    notifyUi();
+
+    // Pausing holds the operation inside its progress sink until resumed or cancelled
+    cv_.wait(lock, stop, [&] { return !job.paused; });
+    return !stop.stop_requested();
+}
+
+void FileOperationManager::notifyUi() {
+    if (!message_posted_) {
+        message_posted_ = PostMessageW(parent_window_, kWmFileJob, 0, 0) != FALSE;
+    }
+}
+
+void FileOperationManager::completeJob(Job& job) {
+    const auto& result = job.result;
+    if (!result.failed_files.empty() && result.error != fs::FileOperationError::Cancelled) {
+        showErrorDialog(result, job.kind);
+    }
+
+    if (complete_callback_) {
+        bool success = result.error != fs::FileOperationError::Cancelled &&
+                       (result.succeeded() || result.partiallySucceeded());
+        complete_callback_(success, result);
+    }
+}
+
 // ============================================================================
 // Conflict resolution
 // ============================================================================
 
 std::optional<std::vector<fs::ResolvedFileItem>>
-FileOperationManager::resolveAllConflicts(const std::vector<std::filesystem::path>& files,
-                                          const std::filesystem::path& dest_dir,
-                                          bool show_dialog) {
-    auto conflicts = fs::detectConflicts(files, dest_dir);
+FileOperationManager::resolveAllConflicts(Job& job) {
+    const auto& files = job.files;
+    const auto& dest_dir = job.dest_dir;
+    auto conflicts = fs::detectConflicts(files, dest_dir, {}, &job.identity_cache);
 
     // Build a map of source path -> conflict info for quick lookup
     std::unordered_map<std::wstring, const fs::FileConflictInfo*> conflict_map;
@@ -157,6 +662,7 @@ FileOperationManager::resolveAllConflicts(const std::vector<std::filesystem::pat
 
     std::vector<fs::ResolvedFileItem> resolved_items;
     resolved_items.reserve(files.size());
+    std::vector<std::filesystem::path> to_trash;  // Replaced destinations, trashed in one batch
 
     for (const auto& file : files) {
         auto it = conflict_map.find(file.wstring());
@@ -169,24 +675,24 @@ FileOperationManager::resolveAllConflicts(const std::vector<std::filesystem::pat
         const auto& conflict = *it->second;
 
         // Handle skip_identical from apply-to-all
-        if (apply_to_all_resolution_ && apply_to_all_resolution_->skip_identical &&
+        if (job.apply_to_all_resolution && job.apply_to_all_resolution->skip_identical &&
             conflict.files_identical) {
             continue;  // Skip identical file
         }
 
         // Determine resolution
         fs::ConflictResolution resolution;
-        if (apply_to_all_resolution_) {
-            resolution = *apply_to_all_resolution_;
-        } else if (show_dialog) {
-            auto maybe_resolution = showConflictDialog(conflict);
+        if (job.apply_to_all_resolution) {
+            resolution = *job.apply_to_all_resolution;
+        } else if (job.options.show_conflict_dialog) {
+            auto maybe_resolution = promptConflict(job, conflict);
             if (!maybe_resolution) {
-                return std::nullopt;  // User cancelled
+                return std::nullopt;  // User or cancel() cancelled
             }
             resolution = *maybe_resolution;
 
             if (resolution.apply_to_all) {
-                apply_to_all_resolution_ = resolution;
+                job.apply_to_all_resolution = resolution;
             }
         } else {
             // No dialog, skip conflicts
@@ -198,27 +704,31 @@ FileOperationManager::resolveAllConflicts(const std::vector<std::filesystem::pat
             continue;
         }
 
-        auto resolved = resolveConflict(conflict, resolution, resolution.move_replaced_to_trash);
+        auto resolved = resolveConflict(conflict, resolution, to_trash);
         if (resolved) {
             resolved_items.push_back(std::move(*resolved));
         }
         // else: skip this file
     }
 
+    if (!to_trash.empty()) {
+        (void)fs::trashFiles(to_trash, fs::TrashOptions{.silent = true});
+    }
     return resolved_items;
 }
 
 std::optional<fs::ResolvedFileItem>
 FileOperationManager::resolveConflict(const fs::FileConflictInfo& conflict,
                                       const fs::ConflictResolution& resolution,
-                                      bool move_to_trash) {
+                                      std::vector<std::filesystem::path>& to_trash) {
+    bool move_to_trash = resolution.move_replaced_to_trash;
     switch (resolution.action) {
     case fs::ConflictAction::Skip:
         return std::nullopt;
 
     case fs::ConflictAction::Overwrite:
         if (move_to_trash) {
-            (void)fs::trashFile(conflict.dest_path, fs::TrashOptions{.silent = true});
+            to_trash.push_back(conflict.dest_path);
         }
         return fs::ResolvedFileItem{
             .source_path = conflict.source_path,
@@ -244,7 +754,7 @@ FileOperationManager::resolveConflict(const fs::FileConflictInfo& conflict,
     case fs::ConflictAction::KeepNewer:
         if (conflict.source_time > conflict.dest_time) {
             if (move_to_trash) {
-                (void)fs::trashFile(conflict.dest_path, fs::TrashOptions{.silent = true});
+                to_trash.push_back(conflict.dest_path);
             }
             return fs::ResolvedFileItem{
                 .source_path = conflict.source_path,
@@ -256,7 +766,7 @@ FileOperationManager::resolveConflict(const fs::FileConflictInfo& conflict,
     case fs::ConflictAction::KeepLarger:
         if (conflict.source_size > conflict.dest_size) {
             if (move_to_trash) {
-                (void)fs::trashFile(conflict.dest_path, fs::TrashOptions{.silent = true});
+                to_trash.push_back(conflict.dest_path);
             }
             return fs::ResolvedFileItem{
                 .source_path = conflict.source_path,
@@ -270,6 +780,29 @@ FileOperationManager::resolveConflict(const fs::FileConflictInfo& conflict,
     }
 }
 
+std::optional<fs::ConflictResolution>
+FileOperationManager::promptConflict(Job& job, const fs::FileConflictInfo& conflict) {
+    if (!job.options.background) {
+        return showConflictDialog(conflict);
+    }
+
+    auto stop = job.stop.get_token();
+    std::unique_lock lock(mutex_);
+    job.prompt = conflict;
+    job.answer.reset();
+    job.answered = false;
+    prompts_.push_back(job.id);
+    notifyUi();
+
+    cv_.wait(lock, stop, [&] { return job.answered; });
+    job.prompt.reset();
+    if (!job.answered) {
+        std::erase(prompts_, job.id);
+        return std::nullopt;
+    }
+    return job.answer;
+}
+
 // ============================================================================
 // UI dialogs
 // ============================================================================
@@ -281,7 +814,8 @@ FileOperationManager::showConflictDialog(const fs::FileConflictInfo& conflict) {
 }
 
 void FileOperationManager::showErrorDialog(const fs::FileOperationResult& result,
-                                           const std::wstring& operation) {
+                                           FileJobKind kind) {
+    auto operation = jobKindLabel(kind);
     std::wstring message;
 
     if (result.partiallySucceeded()) {
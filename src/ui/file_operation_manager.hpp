@@ -7,14 +7,22 @@
 
 #include <oleidl.h>
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
 #include "core/fs/file_conflict.hpp"
 #include "core/fs/file_operations.hpp"
 #include "core/fs/shell_file_operation.hpp"
+#include "core/image/batch_export.hpp"
+#include "core/image/jpeg_orientation.hpp"
 
 namespace nive::ui {
 
@@ -24,23 +32,78 @@ namespace nive::ui {
 using FileOperationCompleteCallback =
     std::function<void(bool success, const fs::FileOperationResult& result)>;
 
+/// @brief Identifier of a queued file operation
+using FileJobId = uint64_t;
+
+/// @brief What a file job does
+enum class FileJobKind {
+    Copy,
+    Move,
+    Delete,    // Permanent
+    Recycle,   // To the recycle bin
+    Export,    // Resized JPEG copies of images (image::exportImages)
+    Reorient,  // Lossless rotation of JPEGs (image::reorientJpeg)
+};
+
+/// @brief Get the localized name of a job kind, as used in messages
+[[nodiscard]] std::wstring jobKindLabel(FileJobKind kind);
+
+/// @brief Where a file job is in its life
+enum class FileJobState {
+    Queued,   // Waiting for a volume it uses to be free
+    Running,
+    Paused,
+    Finished,  // Result is being reported
+};
+
+/// @brief Snapshot of a file job for progress display
+struct FileJobStatus {
+    FileJobId id = 0;
+    FileJobKind kind = FileJobKind::Copy;
+    FileJobState state = FileJobState::Queued;
+    size_t file_count = 0;
+    double fraction = 0.0;          // Done, 0 to 1
+    uint64_t bytes_per_second = 0;  // Copy and move; 0 until known
+};
+
+/// @brief Called on the UI thread whenever a job is added, progresses or ends
+using FileJobsChangedCallback = std::function<void()>;
+
 /// @brief Options for file operations
 struct FileOperationOptions {
     bool show_conflict_dialog = true;  // Show dialog on conflicts
     bool show_delete_confirm = true;   // Show confirmation for delete
     bool default_to_trash = true;      // Default delete to trash
-    bool show_progress = false;        // Show progress dialog (future)
+    bool background = true;            // Queue as a job instead of running before returning
 };
 
 /// @brief Manages file operations with UI feedback
 ///
 /// Coordinates between file system operations, conflict detection,
 /// and UI dialogs for user interaction. Uses IFileOperation COM API
-/// for OS-native progress dialog, undo support, and Shell integration.
+/// for undo support and Shell integration. Moved and renamed files are
+/// reported to the thumbnail cache, which rekeys their entries.
+///
+/// Operations run as background jobs, one thread each. Jobs that share a
+/// volume run one after the other; jobs on different volumes run at the
+/// same time, up to kMaxRunningJobs. Conflicts are detected on the job's
+/// thread and each prompt is shown on the UI thread while the job waits.
+/// Job events reach the UI thread as kWmFileJob posted to the parent
+/// window, which passes it to handleJobMessage().
 class FileOperationManager {
+    struct Job;
+
 public:
+    /// @brief Message posted to the parent window when jobs have news
+    static constexpr UINT kWmFileJob = WM_APP + 50;
+
+    /// @brief Jobs allowed to run at once (on distinct volumes)
+    static constexpr size_t kMaxRunningJobs = 3;
+
     explicit FileOperationManager(HWND parent_window);
-    ~FileOperationManager() = default;
+
+    /// @brief Cancel every job and wait for their threads
+    ~FileOperationManager();
 
     FileOperationManager(const FileOperationManager&) = delete;
     FileOperationManager& operator=(const FileOperationManager&) = delete;
@@ -49,72 +112,167 @@ public:
     /// @param files Source file paths
     /// @param dest_dir Destination directory
     /// @param options Operation options
-    /// @return Operation result
-    fs::FileOperationResult copyFiles(const std::vector<std::filesystem::path>& files,
-                                      const std::filesystem::path& dest_dir,
-                                      const FileOperationOptions& options = {});
+    /// @return Result, or nullopt if the operation was queued (see onOperationComplete)
+    std::optional<fs::FileOperationResult>
+    copyFiles(const std::vector<std::filesystem::path>& files,
+              const std::filesystem::path& dest_dir, const FileOperationOptions& options = {});
 
     /// @brief Move files to a destination directory
     /// @param files Source file paths
     /// @param dest_dir Destination directory
     /// @param options Operation options
-    /// @return Operation result
-    fs::FileOperationResult moveFiles(const std::vector<std::filesystem::path>& files,
-                                      const std::filesystem::path& dest_dir,
-                                      const FileOperationOptions& options = {});
+    /// @return Result, or nullopt if the operation was queued (see onOperationComplete)
+    std::optional<fs::FileOperationResult>
+    moveFiles(const std::vector<std::filesystem::path>& files,
+              const std::filesystem::path& dest_dir, const FileOperationOptions& options = {});
 
     /// @brief Delete files (with confirmation)
     /// @param files Files to delete
     /// @param options Operation options
-    /// @return Operation result
-    fs::FileOperationResult deleteFiles(const std::vector<std::filesystem::path>& files,
-                                        const FileOperationOptions& options = {});
+    /// @return Result (also when cancelled at the confirmation), or nullopt if queued
+    std::optional<fs::FileOperationResult>
+    deleteFiles(const std::vector<std::filesystem::path>& files,
+                const FileOperationOptions& options = {});
+
+    /// @brief Export images as resized JPEGs into a directory
+    /// @param files Image files
+    /// @param dest_dir Destination directory
+    /// @param export_options Output size and quality
+    /// @param options Operation options (conflict options do not apply: names are numbered)
+    /// @return Result, or nullopt if the operation was queued
+    ///
+    /// Running the same export again after a cancel skips the images already
+    /// exported (see image::exportImages).
+    std::optional<fs::FileOperationResult>
+    exportImages(const std::vector<std::filesystem::path>& files,
+                 const std::filesystem::path& dest_dir,
+                 const image::ExportOptions& export_options,
+                 const FileOperationOptions& options = {});
+
+    /// @brief Rotate or flip JPEGs losslessly, through their EXIF orientation
+    /// @param files JPEG files
+    /// @param change Turn or mirror of the images as displayed
+    /// @param options Operation options (conflict options do not apply)
+    /// @return Result, or nullopt if the operation was queued
+    ///
+    /// Files are rewritten on pool workers. Cached thumbnails are turned the
+    /// same way and stored for the files' new contents, so they are not
+    /// decoded again.
+    std::optional<fs::FileOperationResult>
+    reorientImages(const std::vector<std::filesystem::path>& files,
+                   image::OrientationChange change, const FileOperationOptions& options = {});
 
     /// @brief Handle a drop operation from D&D
     /// @param files Dropped file paths
     /// @param dest_dir Destination directory
     /// @param effect Drop effect (DROPEFFECT_COPY or DROPEFFECT_MOVE)
     /// @param options Operation options
-    /// @return Operation result
-    fs::FileOperationResult handleDrop(const std::vector<std::filesystem::path>& files,
-                                       const std::filesystem::path& dest_dir, DWORD effect,
-                                       const FileOperationOptions& options = {});
+    /// @return Result, or nullopt if the operation was queued
+    std::optional<fs::FileOperationResult>
+    handleDrop(const std::vector<std::filesystem::path>& files,
+               const std::filesystem::path& dest_dir, DWORD effect,
+               const FileOperationOptions& options = {});
+
+    /// @brief Rename a file or directory in place
+    /// @param path Current path
+    /// @param new_name New name (not full path)
+    /// @return New path or error
+    ///
+    /// As with moves, the thumbnail cache entries follow the renamed file.
+    std::expected<std::filesystem::path, fs::FileOperationError>
+    renameFile(const std::filesystem::path& path, const std::wstring& new_name);
 
-    /// @brief Set callback for operation completion
+    /// @brief Pause a job at its next progress update
+    void pause(FileJobId id);
+
+    /// @brief Resume a paused job
+    void resume(FileJobId id);
+
+    /// @brief Cancel a job; items already done stay done
+    void cancel(FileJobId id);
+
+    void pauseAll();
+    void resumeAll();
+    void cancelAll();
+
+    /// @brief Get the status of every job not yet reported complete, in submission order
+    [[nodiscard]] std::vector<FileJobStatus> jobs() const;
+
+    /// @brief Process job events (UI thread; called for kWmFileJob)
+    void handleJobMessage();
+
+    /// @brief Set callback for operation completion (UI thread)
     void onOperationComplete(FileOperationCompleteCallback callback) {
         complete_callback_ = std::move(callback);
     }
 
+    /// @brief Set callback for job progress and queue changes (UI thread)
+    void onJobsChanged(FileJobsChangedCallback callback) {
+        jobs_changed_callback_ = std::move(callback);
+    }
+
 private:
+    /// @brief Create a job for files (UI thread)
+    [[nodiscard]] std::shared_ptr<Job> makeJob(FileJobKind kind,
+                                               const std::vector<std::filesystem::path>& files,
+                                               const std::filesystem::path& dest_dir,
+                                               const FileOperationOptions& options);
+
+    /// @brief Run a job now, or queue it
+    std::optional<fs::FileOperationResult> submit(std::shared_ptr<Job> job);
+
+    /// @brief Start queued jobs whose volumes are free (mutex_ held)
+    void startReadyJobs();
+
+    /// @brief Perform a job (its thread, or the UI thread when not in the background)
+    void runJob(Job& job);
+
     /// @brief Resolve conflicts and build items list for copy/move operations
-    /// @param files Source files
-    /// @param dest_dir Destination directory
-    /// @param show_dialog Whether to show conflict dialog
+    /// @param job Copy or move job
     /// @return Resolved items list, or nullopt if operation was cancelled
-    std::optional<std::vector<fs::ResolvedFileItem>>
-    resolveAllConflicts(const std::vector<std::filesystem::path>& files,
-                        const std::filesystem::path& dest_dir, bool show_dialog);
+    std::optional<std::vector<fs::ResolvedFileItem>> resolveAllConflicts(Job& job);
 
     /// @brief Resolve a single conflict according to resolution
     /// @param conflict Conflict info
     /// @param resolution User's resolution choice
-    /// @param move_to_trash Whether to move replaced file to trash
+    /// @param to_trash Receives the destination if it is replaced and goes to the trash
     /// @return Resolved item, or nullopt to skip this file
-    std::optional<fs::ResolvedFileItem> resolveConflict(const fs::FileConflictInfo& conflict,
-                                                        const fs::ConflictResolution& resolution,
-                                                        bool move_to_trash);
+    std::optional<fs::ResolvedFileItem>
+    resolveConflict(const fs::FileConflictInfo& conflict, const fs::ConflictResolution& resolution,
+                    std::vector<std::filesystem::path>& to_trash);
+
+    /// @brief Ask how to resolve a conflict, on the UI thread
+    /// @return Resolution, or nullopt if the user or a cancel ended the job
+    std::optional<fs::ConflictResolution> promptConflict(Job& job,
+                                                         const fs::FileConflictInfo& conflict);
+
+    /// @brief Record progress and wait while the job is paused (job thread)
+    /// @return false if the job was cancelled
+    bool reportProgress(Job& job, uint64_t done, uint64_t total);
+
+    /// @brief Post kWmFileJob unless one is pending (mutex_ held)
+    void notifyUi();
+
+    /// @brief Report a finished job (UI thread)
+    void completeJob(Job& job);
 
     /// @brief Show conflict dialog and get resolution
     std::optional<fs::ConflictResolution> showConflictDialog(const fs::FileConflictInfo& conflict);
 
     /// @brief Show error dialog for failed operations
-    void showErrorDialog(const fs::FileOperationResult& result, const std::wstring& operation);
+    void showErrorDialog(const fs::FileOperationResult& result, FileJobKind kind);
 
     HWND parent_window_;
     FileOperationCompleteCallback complete_callback_;
+    FileJobsChangedCallback jobs_changed_callback_;
 
-    // State for "apply to all" during batch operations
-    std::optional<fs::ConflictResolution> apply_to_all_resolution_;
+    mutable std::mutex mutex_;
+    std::condition_variable_any cv_;          // Pauses and prompt answers
+    std::vector<std::shared_ptr<Job>> jobs_;  // Guarded by mutex_
+    std::deque<FileJobId> prompts_;           // Jobs waiting for an answer; guarded by mutex_
+    bool message_posted_ = false;             // Guarded by mutex_
+    FileJobId next_id_ = 1;                   // UI thread only
+    bool prompting_ = false;                  // UI thread only
 };
 
 }  // namespace nive::ui
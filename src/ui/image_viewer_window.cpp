@@ -9,14 +9,23 @@
 #include <windowsx.h>
 
 #include <algorithm>
+#include <cmath>
 #include <format>
-#include <fstream>
+#include <utility>
 
 #include "app.hpp"
+#include "core/fs/io_scheduler.hpp"
 #include "core/i18n/i18n.hpp"
+#include "core/image/decoder_registry.hpp"
+#include "core/image/image_scaler.hpp"
+#include "core/image/pixel_buffer.hpp"
 #include "core/image/wic_decoder.hpp"
+#include "core/util/mapped_file.hpp"
 #include "core/util/string_utils.hpp"
+#include "core/util/trace.hpp"
+#include "core/util/win32_utils.hpp"
 #include "d2d/core/bitmap_utils.hpp"
+#include "d2d/core/hdr_renderer.hpp"
 #include "file_operation_manager.hpp"
 #include "main_window.hpp"
 
@@ -24,6 +33,71 @@ namespace nive::ui {
 
 namespace {
 constexpr wchar_t kWindowClass[] = L"NiveImageViewerWindow";
+
+/// @brief Check if an image may have frames to play (animated GIF or WebP read by WIC)
+[[nodiscard]] bool is_animatable(const image::DecoderChoice& choice) noexcept {
+    return choice.kind != image::DecoderKind::Plugin &&
+           (choice.format == image::ImageFormat::Gif || choice.format == image::ImageFormat::WebP);
+}
+
+/// @brief Pick the pixel format to decode an image to
+/// @param float_bitmaps Whether the render target can draw RGBA16F bitmaps
+/// @return RGBA16F for sources with more than 8 bits per channel, else BGRA32
+///
+/// Only headers are read, and only for formats that can be high precision.
+/// Plugins that cannot report metadata are asked for RGBA16F and fall back to
+/// 8 bits themselves.
+[[nodiscard]] image::PixelFormat decode_target(const image::DecoderRegistry& decoders,
+                                               const image::DecoderChoice& choice,
+                                               std::span<const uint8_t> data,
+                                               bool float_bitmaps) {
+    using image::ImageFormat;
+    if (!float_bitmaps) {
+        return image::PixelFormat::BGRA32;
+    }
+    if (choice.kind == image::DecoderKind::Plugin) {
+        auto* plugins = decoders.plugins();
+        auto info = plugins ? plugins->getImageInfo(data.data(), data.size(),
+                                                    choice.plugin_extension)
+                            : std::nullopt;
+        return !info || info->high_precision ? image::PixelFormat::RGBA16F
+                                             : image::PixelFormat::BGRA32;
+    }
+    switch (choice.format) {
+    case ImageFormat::Png:
+    case ImageFormat::Tiff:
+    case ImageFormat::JpegXr:
+    case ImageFormat::Avif:
+    case ImageFormat::Heif:
+    case ImageFormat::JpegXl:
+        break;
+    default:
+        return image::PixelFormat::BGRA32;
+    }
+    auto info = decoders.getInfo(data, choice);
+    return info && info->high_precision ? image::PixelFormat::RGBA16F
+                                        : image::PixelFormat::BGRA32;
+}
+
+/// @brief Get the path of the color profile assigned to a window's monitor
+/// @return Profile path, or empty if the monitor has none
+[[nodiscard]] std::filesystem::path monitor_profile_path(HWND hwnd) {
+    HDC dc = GetDC(hwnd);
+    if (!dc) {
+        return {};
+    }
+    wchar_t path[MAX_PATH] = {};
+    DWORD length = MAX_PATH;
+    BOOL found = GetICMProfileW(dc, &length, path);
+    ReleaseDC(hwnd, dc);
+    return found ? std::filesystem::path(path) : std::filesystem::path();
+}
+
+/// @brief Get how long each slide is shown, from the settings
+[[nodiscard]] UINT slideshow_interval() {
+    return static_cast<UINT>(std::clamp(App::instance().settings().slideshow_interval_ms, 500,
+                                        600'000));
+}
 }  // namespace
 
 ImageViewerWindow::ImageViewerWindow() = default;
@@ -108,7 +182,10 @@ void ImageViewerWindow::show() {
         // Recreate D2D bitmap from existing image since setImage() may have
         // been called before window recreation (when render target was absent)
         recreateBitmap();
+        startMipChain();
         updateTitle();
+        // A decode that finished before the window existed could not notify it
+        onPrefetched();
     }
 
     if (hwnd_) {
@@ -136,11 +213,40 @@ bool ImageViewerWindow::isVisible() const noexcept {
 }
 
 void ImageViewerWindow::setImage(const archive::VirtualPath& path) {
+    // Stop converting the previous image before its result can land
+    color_worker_ = {};
+    color_managed_.reset();
+    ++color_generation_;
+    mip_worker_ = {};
+    mips_.clear();
+    ++mip_generation_;
+
+    // The image left stays decoded while it is a neighbour (schedulePrefetch)
+    if (path != current_path_) {
+        retainCurrent();
+    }
     current_path_ = path;
+    animation_.reset();
+    animation_frame_.reset();
     image_.reset();
+    image_data_.reset();
+    image_color_managed_ = false;
+    image_full_size_ = {};
+    full_pending_ = false;
+    image_dropped_ = false;
+    reload_pending_ = false;
     bitmap_.Reset();
+    fit_image_.reset();
+    fit_image_target_ = {};
+    fit_bitmap_.Reset();
+    tiled_.reset();
+    tile_bitmaps_.clear();
+    preview_.reset();
+    preview_size_ = {};
+    decode_pending_ = false;
 
     if (path.empty()) {
+        schedulePrefetch();
         updateTitle();
         if (hwnd_) {
             InvalidateRect(hwnd_, nullptr, FALSE);
@@ -148,102 +254,197 @@ void ImageViewerWindow::setImage(const archive::VirtualPath& path) {
         return;
     }
 
-    // Decode the image: try plugins first, then fall back to WIC
-    auto* plugin_mgr = App::instance().plugins();
-
-    std::expected<image::DecodedImage, image::DecodeError> result =
-        std::unexpected(image::DecodeError::UnsupportedFormat);
-
-    if (path.is_in_archive()) {
-        // Load from archive
-        auto* archive_mgr = App::instance().archive();
-        if (!archive_mgr) {
-            return;
+    // Decoding runs on prefetch_worker_ with the decoder the content calls
+    // for (plugin, built-in codec or WIC); until it lands the cached
+    // thumbnail stands in. Only animations and tiled images open here, from
+    // their headers.
+    if (auto prefetched = takePrefetched(path)) {
+        showPage(std::move(*prefetched));
+    } else if (path.is_in_archive()) {
+        // Extracted on the worker too; an animated entry comes back as its data
+        decode_pending_ = App::instance().archive() != nullptr;
+    } else if (auto file = MappedFile::open(path.archive_path())) {
+        const auto& decoders = App::instance().decoders();
+        auto choice = decoders.choose(file->bytes(), pathToUtf8(path.archive_path().extension()));
+
+        // Animated, else tiled if WIC can read it and it is too large to decode whole
+        if (is_animatable(choice)) {
+            startAnimation(image::AnimationDecoder::open(path.archive_path()));
         }
-
-        auto data = archive_mgr->extractToMemory(path);
-        if (!data) {
-            return;
+        if (!animation_ &&
+            (choice.kind == image::DecoderKind::Plugin || !openTiled(path.archive_path()))) {
+            decode_pending_ = true;
         }
-
-        // Try plugin decode first
-        if (plugin_mgr) {
-            std::string ext = pathToUtf8(std::filesystem::path(path.filename()).extension());
-            std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
-                return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-            });
-            if (plugin_mgr->supportsExtension(ext)) {
-                auto plugin_result = plugin_mgr->decode(data->data(), data->size(), ext);
-                if (plugin_result) {
-                    result = std::move(*plugin_result);
-                }
-            }
+        if (animation_ || tiled_) {
+            resetView();
         }
+    }
+    if (decode_pending_) {
+        showPreview();
+    }
 
-        // Fallback to WIC
-        if (!result) {
-            image::WicDecoder decoder;
-            if (decoder.isAvailable()) {
-                result = decoder.decodeFromMemory(*data);
-            }
-        }
+    schedulePrefetch();
+    updateTitle();
+    updateStatusBar();
+
+    if (hwnd_) {
+        InvalidateRect(hwnd_, nullptr, FALSE);
+    }
+}
+
+void ImageViewerWindow::retainCurrent() {
+    // Animations, tiled images and images whose pixels were dropped are
+    // opened again; only whole images are kept
+    if (!image_ || image_dropped_ || animation_ || tiled_ || current_path_.empty() ||
+        decode_pending_) {
+        return;
+    }
+    PrefetchedPage page;
+    page.path = current_path_;
+    page.image = std::move(image_);
+    page.data = std::move(image_data_);
+    page.color_managed = image_color_managed_;
+    page.full_size = image_full_size_;
+    if (fit_image_) {
+        page.fit_image = std::move(fit_image_);
+        page.fit_target = fit_image_target_;
+        page.bitmap = std::move(fit_bitmap_);
     } else {
-        std::string ext = pathToUtf8(path.archive_path().extension());
-        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
-            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-        });
+        page.bitmap = std::move(bitmap_);
+    }
 
-        // Try plugin decode first (read file into memory)
-        if (plugin_mgr && plugin_mgr->supportsExtension(ext)) {
-            std::ifstream file(path.archive_path(), std::ios::binary | std::ios::ate);
-            if (file) {
-                auto file_size = file.tellg();
-                file.seekg(0, std::ios::beg);
-                std::vector<uint8_t> data(static_cast<size_t>(file_size));
-                if (file.read(reinterpret_cast<char*>(data.data()), file_size)) {
-                    auto plugin_result = plugin_mgr->decode(data.data(), data.size(), ext);
-                    if (plugin_result) {
-                        result = std::move(*plugin_result);
-                    }
-                }
-            }
+    // schedulePrefetch() drops it again if it is no neighbour of the next image
+    std::lock_guard lock(prefetch_mutex_);
+    prefetched_.push_back(std::move(page));
+}
+
+void ImageViewerWindow::showPage(PrefetchedPage page, bool keep_view) {
+    SIZE size = page.full_size;
+    if (page.image && size.cx == 0) {
+        size = SIZE{static_cast<LONG>(page.image->width()),
+                    static_cast<LONG>(page.image->height())};
+    }
+    bool resized = !keep_view && (!preview_ || !page.image || size.cx != preview_size_.cx ||
+                                  size.cy != preview_size_.cy);
+    preview_.reset();
+    preview_size_ = {};
+    bitmap_.Reset();
+    fit_image_.reset();
+    fit_image_target_ = {};
+    fit_bitmap_.Reset();
+    decode_pending_ = false;
+
+    if (page.animated && page.data) {
+        startAnimation(image::AnimationDecoder::openFromMemory(*page.data));
+    }
+    if (page.image) {
+        // The D2D bitmap for the display mode is created on first render
+        // unless the page brings it
+        image_ = std::move(page.image);
+        image_dropped_ = false;
+        image_data_ = std::move(page.data);
+        image_color_managed_ = page.color_managed;
+        image_full_size_ = page.full_size;
+        hdr_peak_ = d2d::scrgbPeak(*image_);
+        if (page.fit_image) {
+            fit_image_ = std::move(page.fit_image);
+            fit_image_target_ = page.fit_target;
+            fit_bitmap_ = std::move(page.bitmap);
+        } else {
+            bitmap_ = std::move(page.bitmap);
         }
+        startMipChain();
 
-        // Fallback to WIC
-        if (!result) {
-            image::WicDecoder decoder;
-            if (decoder.isAvailable()) {
-                result = decoder.decode(path.archive_path());
+        if (!image_color_managed_) {
+            std::function<image::ColorProfile()> read_profile;
+            if (image_data_) {
+                read_profile = [data = image_data_] { return image::readEmbeddedProfile(*data); };
+            } else {
+                read_profile = [file_path = current_path_.archive_path()] {
+                    return image::readEmbeddedProfile(file_path);
+                };
             }
+            startColorManagement(std::move(read_profile));
         }
     }
 
-    if (result) {
-        image_ = std::make_unique<image::DecodedImage>(std::move(*result));
+    // A preview was already laid out at the image's size
+    if (resized) {
+        resetView();
+    }
+}
 
-        // Create D2D bitmap from decoded image
-        if (device_resources_.isValid()) {
-            bitmap_ = d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), *image_);
-        }
+void ImageViewerWindow::requestFullResolution() {
+    if (full_pending_ || decode_pending_ || reload_pending_ || image_full_size_.cx == 0) {
+        return;
+    }
+    full_pending_ = true;
+    schedulePrefetch();
+}
 
-        // Reset zoom/scroll based on display mode
-        if (display_mode_ == config::ViewerDisplayMode::Original) {
-            zoom_ = 1.0f;
-            centerImage();
-        } else {
-            scroll_x_ = 0;
-            scroll_y_ = 0;
-        }
+void ImageViewerWindow::reloadImage() {
+    if (reload_pending_ || full_pending_ || decode_pending_) {
+        return;
     }
+    reload_pending_ = true;
+    schedulePrefetch();
+}
 
-    updateTitle();
-    updateStatusBar();
+void ImageViewerWindow::showPreview() {
+    auto* cache = App::instance().cache();
+    if (!cache) {
+        return;
+    }
+    // Cached under the path string, the virtual path for archive entries
+    std::filesystem::path key = current_path_.to_string();
+    auto thumbnail = cache->getThumbnail(key);
+    if (!thumbnail || !thumbnail->valid()) {
+        return;
+    }
+    preview_size_ = SIZE{static_cast<LONG>(thumbnail->width()),
+                         static_cast<LONG>(thumbnail->height())};
+    if (auto resolution = cache->getImageResolution(key);
+        resolution && resolution->width > 0 && resolution->height > 0) {
+        preview_size_ = SIZE{static_cast<LONG>(resolution->width),
+                             static_cast<LONG>(resolution->height)};
+    }
+    preview_ = std::make_unique<image::DecodedImage>(std::move(*thumbnail));
+    resetView();
+}
 
+void ImageViewerWindow::showInterim(PrefetchedPage page) {
+    if (!page.image || !page.image->valid() ||
+        (preview_ && page.image->width() <= preview_->width() &&
+         page.image->height() <= preview_->height())) {
+        return;
+    }
+    SIZE size = page.full_size;
+    if (size.cx == 0) {
+        size = SIZE{static_cast<LONG>(page.image->width()),
+                    static_cast<LONG>(page.image->height())};
+    }
+    bool resized = !preview_ || size.cx != preview_size_.cx || size.cy != preview_size_.cy;
+    preview_ = std::move(page.image);
+    preview_size_ = size;
+    bitmap_.Reset();
+    if (resized) {
+        resetView();
+    }
     if (hwnd_) {
         InvalidateRect(hwnd_, nullptr, FALSE);
     }
 }
 
+void ImageViewerWindow::resetView() {
+    if (display_mode_ == config::ViewerDisplayMode::Original) {
+        zoom_ = 1.0f;
+        centerImage();
+    } else {
+        scroll_x_ = 0;
+        scroll_y_ = 0;
+    }
+}
+
 void ImageViewerWindow::setDisplayMode(config::ViewerDisplayMode mode) {
     if (display_mode_ != mode) {
         display_mode_ = mode;
@@ -327,22 +528,112 @@ void ImageViewerWindow::fitToWindow() {
 
 void ImageViewerWindow::nextImage() {
     auto& state = App::instance().state();
+    prefetch_forward_ = true;
     if (state.viewerNext()) {
         auto path = state.viewerImage();
         if (path) {
             setImage(*path);
         }
+        if (slideshow_) {
+            // Stepped by hand: the next slide gets a whole interval again
+            slide_waiting_ = false;
+            SetTimer(hwnd_, kSlideshowTimerId, slideshow_interval(), nullptr);
+        }
     }
 }
 
 void ImageViewerWindow::previousImage() {
     auto& state = App::instance().state();
+    prefetch_forward_ = false;
     if (state.viewerPrevious()) {
         auto path = state.viewerImage();
         if (path) {
             setImage(*path);
         }
+        if (slideshow_) {
+            slide_waiting_ = false;
+            SetTimer(hwnd_, kSlideshowTimerId, slideshow_interval(), nullptr);
+        }
+    }
+}
+
+void ImageViewerWindow::startSlideshow() {
+    if (slideshow_ || !hwnd_) {
+        return;
+    }
+    slideshow_ = true;
+    slide_waiting_ = false;
+    prefetch_forward_ = true;
+    SetTimer(hwnd_, kSlideshowTimerId, slideshow_interval(), nullptr);
+    schedulePrefetch();
+    updateMenuCheck();
+}
+
+void ImageViewerWindow::stopSlideshow() {
+    if (!slideshow_) {
+        return;
+    }
+    slideshow_ = false;
+    slide_waiting_ = false;
+    if (hwnd_) {
+        KillTimer(hwnd_, kSlideshowTimerId);
+    }
+    schedulePrefetch();  // Back to the usual neighbours
+    updateMenuCheck();
+}
+
+void ImageViewerWindow::advanceSlide(bool interval_elapsed) {
+    auto upcoming = App::instance().state().viewerUpcoming(kSlideshowAhead, true);
+    if (upcoming.empty()) {
+        stopSlideshow();  // The last image stays up
+        return;
+    }
+
+    const archive::VirtualPath* ready = nullptr;  // Nearest slide decoded ahead
+    bool next_pending = false;                    // The next one is queued or decoding
+    {
+        std::lock_guard lock(prefetch_mutex_);
+        for (const auto& path : upcoming) {
+            if (std::ranges::any_of(prefetched_, [&](const PrefetchedPage& page) {
+                    return page.path == path && !page.interim;
+                })) {
+                ready = &path;
+                break;
+            }
+        }
+        next_pending = upcoming.front() == prefetch_active_ ||
+                       std::ranges::any_of(prefetch_queue_, [&](const PrefetchJob& job) {
+                           return job.path == upcoming.front();
+                       });
+    }
+
+    if (ready == &upcoming.front() || (interval_elapsed && !next_pending)) {
+        // Decoded, or passed over by the worker for setImage() to open
+        // (animated, tiled or unreadable)
+        showSlide(upcoming.front());
+    } else if (interval_elapsed && slide_waiting_) {
+        // A whole interval late: skip to the nearest slide that is ready,
+        // or put the next one up over its thumbnail if none is
+        showSlide(ready ? *ready : upcoming.front());
+    } else if (interval_elapsed) {
+        slide_waiting_ = true;  // onPrefetched() puts it up as it lands
+    }
+}
+
+void ImageViewerWindow::showSlide(const archive::VirtualPath& path) {
+    slide_waiting_ = false;
+    if (drawn_bitmap_) {
+        fade_bitmap_ = drawn_bitmap_;
+        fade_dest_ = drawn_dest_;
+        fade_peak_ = drawn_peak_;
+        fade_start_ = std::chrono::steady_clock::now();
     }
+    prefetch_forward_ = true;
+    App::instance().state().setViewerImage(path);
+    setImage(path);
+
+    // The interval runs from the slide going up, however late that was
+    SetTimer(hwnd_, kSlideshowTimerId, slideshow_interval(), nullptr);
 }
 
 void ImageViewerWindow::saveState(config::Settings& settings) const {
@@ -449,6 +740,29 @@ LRESULT ImageViewerWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam)
         onCommand(LOWORD(wParam));
         return 0;
 
+    case kWmAnimationFrame:
+        onAnimationFrame();
+        return 0;
+
+    case kWmColorManaged:
+        onColorManaged(wParam);
+        return 0;
+
+    case kWmPrefetched:
+        onPrefetched();
+        return 0;
+
+    case kWmMipsReady:
+        onMipsReady(wParam);
+        return 0;
+
+    case WM_TIMER:
+        if (wParam == kSlideshowTimerId) {
+            advanceSlide(true);
+            return 0;
+        }
+        break;
+
     case WM_DPICHANGED: {
         UINT dpi = HIWORD(wParam);
         device_resources_.setDpi(static_cast<float>(dpi), static_cast<float>(dpi));
@@ -466,6 +780,7 @@ LRESULT ImageViewerWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam)
 }
 
 void ImageViewerWindow::onCreate() {
+    notify_hwnd_.store(hwnd_);
     createMenu();
     createStatusBar();
 }
@@ -495,11 +810,49 @@ void ImageViewerWindow::onDestroy() {
 
     // Clear viewer state
     App::instance().state().clearViewerImage();
+    notify_hwnd_.store(nullptr);
+    KillTimer(hwnd_, kSlideshowTimerId);
+    slideshow_ = false;
+    slide_waiting_ = false;
+    color_worker_ = {};
+    color_managed_.reset();
+    mip_worker_ = {};
+    mips_.clear();
+    prefetch_worker_ = {};
+    {
+        std::lock_guard lock(prefetch_mutex_);
+        prefetch_queue_.clear();
+        prefetch_wanted_.clear();
+        prefetch_current_ = {};
+        prefetched_.clear();
+    }
+    decode_pending_ = false;
+    full_pending_ = false;
+    image_dropped_ = false;
+    reload_pending_ = false;
+    animation_.reset();
+    animation_frame_.reset();
 
     // Release D2D resources
     bitmap_.Reset();
+    fit_bitmap_.Reset();
+    tile_bitmaps_.clear();
+    drawn_bitmap_.Reset();
+    fade_bitmap_.Reset();
+    fade_layer_.Reset();
+    fade_brush_.Reset();
+    hdr_renderer_.reset();
     device_resources_.discardResources();
 
+    // Full-size frames are far larger than anything the browser reuses
+    image_.reset();
+    image_data_.reset();
+    fit_image_.reset();
+    preview_.reset();
+    tiled_.reset();
+    image::PixelBufferPool::instance().trim();
+    updateMemoryCharge();
+
     // Restore focus to the originating view
     if (previous_focus_ && IsWindow(previous_focus_)) {
         SetFocus(previous_focus_);
@@ -512,7 +865,15 @@ void ImageViewerWindow::onDestroy() {
 void ImageViewerWindow::onKeyDown(WPARAM vk) {
     switch (vk) {
     case VK_ESCAPE:
-        close();
+        if (slideshow_) {
+            stopSlideshow();
+        } else {
+            close();
+        }
+        break;
+
+    case VK_F5:
+        slideshow_ ? stopSlideshow() : startSlideshow();
         break;
 
     case VK_LEFT:
@@ -554,13 +915,19 @@ void ImageViewerWindow::onKeyDown(WPARAM vk) {
         deleteCurrentImage();
         break;
 
+    case VK_SPACE:
+        if (animation_) {
+            animation_->paused() ? animation_->resume() : animation_->pause();
+        }
+        break;
+
     default:
         break;
     }
 }
 
 void ImageViewerWindow::onMouseWheel(int delta, int x, int y) {
-    if (!image_ || !image_->valid()) {
+    if (!hasImage()) {
         return;
     }
 
@@ -585,7 +952,7 @@ void ImageViewerWindow::onMouseWheel(int delta, int x, int y) {
         // Calculate current fit zoom before switching
         int view_w = client.right - client.left;
         int view_h = client.bottom - client.top;
-        zoom_ = calculateFitZoom(image_->width(), image_->height(), view_w, view_h);
+        zoom_ = calculateFitZoom(imageWidth(), imageHeight(), view_w, view_h);
         display_mode_ = config::ViewerDisplayMode::Original;
         scroll_x_ = 0;
         scroll_y_ = 0;
@@ -615,7 +982,7 @@ void ImageViewerWindow::onMouseWheel(int delta, int x, int y) {
 }
 
 void ImageViewerWindow::onLbuttonDown(int x, int y) {
-    if (!image_ || !image_->valid()) {
+    if (!hasImage()) {
         return;
     }
 
@@ -641,7 +1008,7 @@ void ImageViewerWindow::onLbuttonUp(int x, int y) {
 }
 
 void ImageViewerWindow::onMouseMove(int x, int y) {
-    if (dragging_ && image_ && image_->valid()) {
+    if (dragging_ && hasImage()) {
         int dx = x - drag_start_x_;
         int dy = y - drag_start_y_;
 
@@ -666,6 +1033,9 @@ void ImageViewerWindow::onLbuttonDblclk(int x, int y) {
 }
 
 void ImageViewerWindow::render() {
+    // Whatever changed the images drawn repaints, so the charge is refreshed here
+    updateMemoryCharge();
+
     // Detect device lost via epoch counter
     uint32_t epoch = device_resources_.resourceEpoch();
     if (epoch != last_resource_epoch_) {
@@ -682,12 +1052,40 @@ void ImageViewerWindow::render() {
     // Clear background to black
     rt->Clear(D2D1::ColorF(D2D1::ColorF::Black));
 
-    if (bitmap_ && image_ && image_->valid()) {
+    // A slide change draws the last frame, then the new one over it (its
+    // black background included) at the opacity reached
+    if (fade_bitmap_) {
+        float fade_in = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                                     fade_start_) /
+                        kSlideFade;
+        if (!fade_layer_ && FAILED(rt->CreateLayer(&fade_layer_))) {
+            fade_layer_.Reset();
+        }
+        if (!fade_brush_) {
+            fade_brush_ = device_resources_.createSolidBrush(d2d::Color{});
+        }
+        if (fade_in >= 1.0f || !fade_layer_ || !fade_brush_) {
+            fade_bitmap_.Reset();
+        } else {
+            drawBitmap(fade_bitmap_.Get(), fade_dest_, fade_peak_, false);
+            rt->PushLayer(D2D1::LayerParameters(D2D1::InfiniteRect(), nullptr,
+                                                D2D1_ANTIALIAS_MODE_PER_PRIMITIVE,
+                                                D2D1::IdentityMatrix(), fade_in),
+                          fade_layer_.Get());
+            auto size = rt->GetSize();
+            rt->FillRectangle(D2D1::RectF(0.0f, 0.0f, size.width, size.height),
+                              fade_brush_.Get());
+        }
+    }
+
+    drawn_bitmap_.Reset();
+    ID2D1Bitmap* bitmap = currentBitmap();
+    if (bitmap || (tiled_ && device_resources_.isValid())) {
         auto image_rect = getImageAreaRect();
         float view_w = static_cast<float>(image_rect.right - image_rect.left);
         float view_h = static_cast<float>(image_rect.bottom - image_rect.top);
-        float img_w = static_cast<float>(image_->width());
-        float img_h = static_cast<float>(image_->height());
+        float img_w = static_cast<float>(imageWidth());
+        float img_h = static_cast<float>(imageHeight());
 
         float display_w, display_h;
 
@@ -696,7 +1094,7 @@ void ImageViewerWindow::render() {
             display_h = img_h * zoom_;
         } else {
             float fit_zoom = calculateFitZoom(
-                image_->width(), image_->height(),
+                imageWidth(), imageHeight(),
                 static_cast<int>(view_w), static_cast<int>(view_h));
             display_w = img_w * fit_zoom;
             display_h = img_h * fit_zoom;
@@ -723,19 +1121,865 @@ void ImageViewerWindow::render() {
             y = (view_h - display_h) / 2.0f;
         }
 
+        // A reduced decode stretched past its own size: fetch the full one
+        if (bitmap && image_ && image_full_size_.cx > 0 && !animation_ &&
+            display_w > static_cast<float>(image_->width()) + 1.0f) {
+            requestFullResolution();
+        }
+
         D2D1_RECT_F dest = D2D1::RectF(x, y, x + display_w, y + display_h);
-        auto mode = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
-        rt->DrawBitmap(bitmap_.Get(), dest, 1.0f, mode);
+
+        // Zoomed out: draw from the level nearest the drawn size, so each
+        // frame samples a texture at most twice that size
+        bool downscaled = false;
+        if (bitmap && bitmap == bitmap_.Get() && displayedImage() == image_.get() && !preview_) {
+            float pixels_w = display_w * device_resources_.dpiX() / 96.0f;
+            if (auto* level = mipBitmap(pixels_w)) {
+                bitmap = level;
+            }
+            downscaled = pixels_w < bitmap->GetPixelSize().width;
+        }
+
+        if (bitmap) {
+            drawBitmap(bitmap, dest, hdr_peak_, downscaled);
+            drawn_bitmap_ = bitmap;
+            drawn_dest_ = dest;
+            drawn_peak_ = hdr_peak_;
+        } else {
+            renderTiles(rt, dest, view_w, view_h);
+        }
     }
 
+    if (fade_bitmap_) {
+        rt->PopLayer();
+    }
     device_resources_.endDraw();
+
+    // Next fade step: beginDraw() waits for the swap chain, so one per refresh
+    if (fade_bitmap_) {
+        InvalidateRect(hwnd_, nullptr, FALSE);
+    }
+}
+
+void ImageViewerWindow::drawBitmap(ID2D1Bitmap* bitmap, const D2D1_RECT_F& dest, float peak,
+                                   bool downscaled) {
+    auto* dc = device_resources_.deviceContext();
+
+    // Float bitmaps hold linear scRGB and are tone mapped on the GPU
+    bool drawn = bitmap->GetPixelFormat().format == DXGI_FORMAT_R16G16B16A16_FLOAT &&
+                 hdr_renderer_.draw(dc, bitmap, dest, peak);
+    if (!drawn && downscaled && dc) {
+        // Averages a few texels per pixel where linear samples one
+        dc->DrawBitmap(bitmap, dest, 1.0f, D2D1_INTERPOLATION_MODE_MULTI_SAMPLE_LINEAR);
+        drawn = true;
+    }
+    if (!drawn) {
+        auto mode = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
+        device_resources_.renderTarget()->DrawBitmap(bitmap, dest, 1.0f, mode);
+    }
+}
+
+void ImageViewerWindow::updateMemoryCharge() {
+    auto bytes_of = [](const std::unique_ptr<image::DecodedImage>& image) -> uint64_t {
+        return image ? image->sizeBytes() : 0;
+    };
+    uint64_t bytes = bytes_of(image_) + bytes_of(fit_image_) + bytes_of(preview_) +
+                     (image_data_ ? image_data_->size() : 0);
+    for (const auto& level : mips_) {
+        bytes += bytes_of(level.image);
+    }
+    {
+        std::lock_guard lock(prefetch_mutex_);
+        for (const auto& page : prefetched_) {
+            bytes += bytes_of(page.image) + bytes_of(page.fit_image) +
+                     (page.data ? page.data->size() : 0);
+        }
+    }
+    memory_charge_.set(bytes);
 }
 
 void ImageViewerWindow::recreateBitmap() {
+    // Recreated by currentBitmap() on the next render
     bitmap_.Reset();
-    if (image_ && image_->valid() && device_resources_.isValid()) {
-        bitmap_ = d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), *image_);
+    fit_bitmap_.Reset();
+    tile_bitmaps_.clear();
+    hdr_renderer_.reset();
+    drawn_bitmap_.Reset();
+    fade_bitmap_.Reset();  // A fade under way ends at once
+    fade_layer_.Reset();
+    fade_brush_.Reset();
+    for (auto& level : mips_) {
+        level.bitmap.Reset();
+    }
+
+    // Prefetched pages upload theirs again when shown
+    std::lock_guard lock(prefetch_mutex_);
+    for (auto& page : prefetched_) {
+        page.bitmap.Reset();
+    }
+}
+
+ID2D1Bitmap* ImageViewerWindow::currentBitmap() {
+    const image::DecodedImage* shown = displayedImage();
+    if (!shown && preview_ && device_resources_.isValid()) {
+        // Stretched to the image's size (preview_size_) by render()
+        if (!bitmap_) {
+            bitmap_ =
+                d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), *preview_);
+        }
+        return bitmap_.Get();
+    }
+    if (shown && shown == image_.get() && image_dropped_) {
+        // Only bitmap_ holds the pixels: it is drawn (scaled by D2D in the
+        // fit modes) until a decode brings them back where they are needed
+        SIZE target = fitTargetSize();
+        bool fit_copy = display_mode_ != config::ViewerDisplayMode::Original &&
+                        (shown->width() > static_cast<uint32_t>(target.cx) ||
+                         shown->height() > static_cast<uint32_t>(target.cy));
+        if (!bitmap_ || fit_copy) {
+            reloadImage();
+        }
+        return bitmap_.Get();
     }
+    if (!shown || !shown->valid() || !device_resources_.isValid()) {
+        return nullptr;
+    }
+    auto* rt = device_resources_.renderTarget();
+
+    // The fit modes draw a monitor-sized copy of a larger image, so a resize
+    // redraws a few megapixels rather than the whole image, and images beyond
+    // the D2D bitmap size limit still show. The copy is scaled in parallel.
+    // Animation frames change too often for that and are drawn as they are.
+    if (display_mode_ != config::ViewerDisplayMode::Original && !animation_) {
+        SIZE target = fitTargetSize();
+        auto target_width = static_cast<uint32_t>(target.cx);
+        auto target_height = static_cast<uint32_t>(target.cy);
+        if (shown->width() > target_width || shown->height() > target_height) {
+            // Scaled once per image and monitor size, even if scaling failed
+            if (target.cx != fit_image_target_.cx || target.cy != fit_image_target_.cy) {
+                fit_bitmap_.Reset();
+                fit_image_.reset();
+                fit_image_target_ = target;
+                auto scaled = image::scaleImageParallel(
+                    *shown, target_width, target_height,
+                    {.mode = image::ScaleMode::Area, .output_format = shown->format()});
+                if (scaled) {
+                    fit_image_ = std::make_unique<image::DecodedImage>(std::move(*scaled));
+                }
+            }
+            if (fit_image_ && !fit_bitmap_) {
+                fit_bitmap_ = d2d::createBitmapFromDecodedImage(rt, *fit_image_);
+            }
+            if (fit_bitmap_) {
+                return fit_bitmap_.Get();
+            }
+        }
+    }
+
+    if (!bitmap_) {
+        bitmap_ = d2d::createBitmapFromDecodedImage(rt, *shown);
+        if (bitmap_ && shown == image_.get() && image_->sizeBytes() >= kDropPixelsMinBytes) {
+            // The upload is the copy drawn from now on; the mip and color
+            // workers hold their own share of the pixels until they finish
+            image_ = std::make_unique<image::DecodedImage>(image_->width(), image_->height(),
+                                                           image_->format(), image_->stride(),
+                                                           image::PixelBuffer{});
+            image_dropped_ = true;
+            return bitmap_.Get();
+        }
+    }
+    if (!bitmap_ && shown == image_.get() && image_->format() != image::PixelFormat::BGRA32) {
+        // The device cannot take float bitmaps: settle for 8 bits per channel
+        auto converted = image::convertPixelFormat(*image_, image::PixelFormat::BGRA32);
+        if (converted) {
+            image_ = std::make_unique<image::DecodedImage>(std::move(*converted));
+            fit_image_.reset();
+            fit_image_target_ = {};
+            fit_bitmap_.Reset();
+            startMipChain();
+            return currentBitmap();
+        }
+    }
+    return bitmap_.Get();
+}
+
+void ImageViewerWindow::startMipChain() {
+    mip_worker_ = {};
+    mips_.clear();
+    ++mip_generation_;
+    {
+        std::lock_guard lock(mip_mutex_);
+        mips_built_.clear();
+    }
+    if (!image_ || !image_->valid() || !hwnd_ ||
+        (std::max)(image_->width(), image_->height()) < 2 * kMipMinSide) {
+        return;
+    }
+
+    // Each level is an area average of the one before, from a shared view of image_
+    auto work = [this, source = image_->share(),
+                 generation = mip_generation_](std::stop_token stop) {
+        ComInitializer com(COINIT_MULTITHREADED);
+        std::vector<std::unique_ptr<image::DecodedImage>> levels;
+        const image::DecodedImage* previous = &source;
+        while ((std::max)(previous->width(), previous->height()) >= 2 * kMipMinSide) {
+            auto half = image::scaleImageParallel(
+                *previous, (std::max)(previous->width() / 2, 1u),
+                (std::max)(previous->height() / 2, 1u),
+                {.mode = image::ScaleMode::Area, .output_format = previous->format()}, stop);
+            if (!half) {
+                return;
+            }
+            levels.push_back(std::make_unique<image::DecodedImage>(std::move(*half)));
+            previous = levels.back().get();
+        }
+        {
+            std::lock_guard lock(mip_mutex_);
+            mips_built_ = std::move(levels);
+        }
+        if (HWND hwnd = notify_hwnd_.load()) {
+            PostMessageW(hwnd, kWmMipsReady, static_cast<WPARAM>(generation), 0);
+        }
+    };
+    mip_worker_ = std::jthread(std::move(work));
+}
+
+void ImageViewerWindow::onMipsReady(WPARAM generation) {
+    std::vector<std::unique_ptr<image::DecodedImage>> built;
+    {
+        std::lock_guard lock(mip_mutex_);
+        built = std::move(mips_built_);
+    }
+    if (generation != mip_generation_) {
+        return;
+    }
+    mips_.clear();
+    for (auto& level : built) {
+        mips_.push_back({std::move(level), nullptr});
+    }
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+ID2D1Bitmap* ImageViewerWindow::mipBitmap(float display_width) {
+    if (mips_.empty() || !device_resources_.isValid()) {
+        return nullptr;
+    }
+    MipLevel* chosen = nullptr;
+    for (auto& level : mips_) {
+        if (static_cast<float>(level.image->width()) < display_width) {
+            break;
+        }
+        chosen = &level;
+    }
+    if (!chosen) {
+        return nullptr;
+    }
+    if (!chosen->bitmap) {
+        chosen->bitmap =
+            d2d::createBitmapFromDecodedImage(device_resources_.renderTarget(), *chosen->image);
+    }
+    return chosen->bitmap.Get();
+}
+
+SIZE ImageViewerWindow::fitTargetSize() const {
+    MONITORINFO info{};
+    info.cbSize = sizeof(info);
+    HMONITOR monitor = MonitorFromWindow(hwnd_, MONITOR_DEFAULTTOPRIMARY);
+    if (!monitor || !GetMonitorInfoW(monitor, &info)) {
+        return SIZE{1920, 1080};
+    }
+    return SIZE{info.rcMonitor.right - info.rcMonitor.left,
+                info.rcMonitor.bottom - info.rcMonitor.top};
+}
+
+bool ImageViewerWindow::openTiled(const std::filesystem::path& path) {
+    image::WicDecoder decoder;
+    auto info = decoder.getInfo(path);
+    if (!info) {
+        return false;
+    }
+
+    // Sides beyond this cannot be uploaded as one bitmap
+    uint32_t max_side = 16384;
+    if (device_resources_.isValid()) {
+        max_side = device_resources_.renderTarget()->GetMaximumBitmapSize();
+    }
+    uint64_t pixels = static_cast<uint64_t>(info->width) * info->height;
+    if (pixels < kTiledMinPixels && info->width <= max_side && info->height <= max_side) {
+        return false;
+    }
+
+    auto tiled = image::TiledImage::open(path);
+    if (!tiled) {
+        return false;
+    }
+    tiled_ = std::move(*tiled);
+    return true;
+}
+
+void ImageViewerWindow::renderTiles(ID2D1RenderTarget* rt, const D2D1_RECT_F& dest, float view_w,
+                                    float view_h) {
+    float display_w = dest.right - dest.left;
+    float display_h = dest.bottom - dest.top;
+    if (display_w <= 0.0f || display_h <= 0.0f) {
+        return;
+    }
+
+    // Pick the coarsest level with at least one level pixel per screen pixel
+    uint32_t level = tiled_->levelForScale(display_w / static_cast<float>(tiled_->width()));
+    uint32_t level_w = tiled_->levelWidth(level);
+    uint32_t level_h = tiled_->levelHeight(level);
+    uint32_t size = tiled_->tileSize();
+    float scale_x = display_w / static_cast<float>(level_w);
+    float scale_y = display_h / static_cast<float>(level_h);
+
+    // Range of tiles overlapping [begin, end) of the view along one axis
+    auto tile_range = [size](float begin, float end, float origin, float scale, uint32_t count) {
+        float span = static_cast<float>(size) * scale;
+        auto first = static_cast<uint32_t>(std::max((begin - origin) / span, 0.0f));
+        auto last = static_cast<uint32_t>(std::max(std::ceil((end - origin) / span), 1.0f));
+        return std::pair{std::min(first, count - 1), std::min(last, count)};
+    };
+    auto [col_begin, col_end] = tile_range(std::max(dest.left, 0.0f), std::min(dest.right, view_w),
+                                           dest.left, scale_x, tiled_->columns(level));
+    auto [row_begin, row_end] = tile_range(std::max(dest.top, 0.0f), std::min(dest.bottom, view_h),
+                                           dest.top, scale_y, tiled_->rows(level));
+
+    for (uint32_t row = row_begin; row < row_end; ++row) {
+        for (uint32_t col = col_begin; col < col_end; ++col) {
+            ID2D1Bitmap* bitmap = tileBitmap(rt, {.level = level, .column = col, .row = row});
+            if (!bitmap) {
+                continue;
+            }
+            // Edges come from level pixel positions, so neighbouring tiles meet exactly
+            uint32_t x0 = col * size;
+            uint32_t y0 = row * size;
+            uint32_t x1 = std::min(x0 + size, level_w);
+            uint32_t y1 = std::min(y0 + size, level_h);
+            D2D1_RECT_F tile_rect = D2D1::RectF(dest.left + static_cast<float>(x0) * scale_x,
+                                                dest.top + static_cast<float>(y0) * scale_y,
+                                                dest.left + static_cast<float>(x1) * scale_x,
+                                                dest.top + static_cast<float>(y1) * scale_y);
+            rt->DrawBitmap(bitmap, tile_rect, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
+        }
+    }
+}
+
+ID2D1Bitmap* ImageViewerWindow::tileBitmap(ID2D1RenderTarget* rt, const image::TileKey& key) {
+    if (auto cached = tile_bitmaps_.get(key.packed())) {
+        return cached->Get();
+    }
+
+    auto tile = tiled_->tile(key);
+    if (!tile) {
+        return nullptr;
+    }
+    auto bitmap = d2d::createBitmapFromDecodedImage(rt, **tile);
+    if (!bitmap) {
+        return nullptr;
+    }
+    // The budget holds several screens of tiles, so this never evicts a tile
+    // drawn earlier in the same frame
+    ID2D1Bitmap* result = bitmap.Get();
+    tile_bitmaps_.put(key.packed(), bitmap, (*tile)->sizeBytes());
+    return result;
+}
+
+bool ImageViewerWindow::startAnimation(
+    std::expected<std::unique_ptr<image::AnimationDecoder>, image::DecodeError> decoder) {
+    if (!decoder) {
+        return false;
+    }
+    // Runs on the player thread; the frame is picked up by onAnimationFrame()
+    auto on_frame = [this] {
+        HWND hwnd = notify_hwnd_.load();
+        if (hwnd && !frame_posted_.exchange(true)) {
+            if (!PostMessageW(hwnd, kWmAnimationFrame, 0, 0)) {
+                frame_posted_.store(false);
+            }
+        }
+    };
+    auto player = image::AnimationPlayer::start(std::move(*decoder), std::move(on_frame));
+    if (!player) {
+        return false;
+    }
+    animation_ = std::move(*player);
+    animation_frame_ = animation_->currentFrame().image;
+    return true;
+}
+
+void ImageViewerWindow::onAnimationFrame() {
+    frame_posted_.store(false);
+    if (!animation_) {
+        return;
+    }
+    auto frame = animation_->currentFrame().image;
+    if (!frame || frame == animation_frame_) {
+        return;
+    }
+    animation_frame_ = std::move(frame);
+
+    // Same size every frame: overwrite the bitmap rather than create another
+    if (bitmap_ && FAILED(bitmap_->CopyFromMemory(nullptr, animation_frame_->data(),
+                                                   animation_frame_->stride()))) {
+        bitmap_.Reset();
+    }
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+void ImageViewerWindow::startColorManagement(std::function<image::ColorProfile()> read_profile) {
+    if (!image_ || !image_->valid() || !hwnd_ || !read_profile ||
+        !App::instance().settings().color_management) {
+        return;
+    }
+    // The conversion reads a shared view of image_; the copy it writes is
+    // swapped in by onColorManaged()
+    auto work = [this, source = image_->share(), read_profile = std::move(read_profile),
+                 monitor_path = monitor_profile_path(hwnd_),
+                 generation = color_generation_](std::stop_token stop) {
+        ComInitializer com(COINIT_MULTITHREADED);
+        image::ColorProfile profile = read_profile();
+        image::ColorProfile target;
+        if (!monitor_path.empty()) {
+            target = image::ColorProfile::fromFile(monitor_path).value_or(image::ColorProfile());
+        }
+        if (profile == target || stop.stop_requested()) {
+            return;
+        }
+        auto converted =
+            image::ColorTransformCache::instance().convert(source, profile, target, stop);
+        if (!converted) {
+            return;
+        }
+        {
+            std::lock_guard lock(color_mutex_);
+            color_managed_ = std::make_unique<image::DecodedImage>(std::move(*converted));
+        }
+        if (HWND hwnd = notify_hwnd_.load()) {
+            PostMessageW(hwnd, kWmColorManaged, static_cast<WPARAM>(generation), 0);
+        }
+    };
+    color_worker_ = std::jthread(std::move(work));
+}
+
+void ImageViewerWindow::schedulePrefetch() {
+    // Awaited image first, then the neighbours nearest first
+    std::vector<archive::VirtualPath> wanted;
+    bool awaited = decode_pending_ || full_pending_ || reload_pending_;
+    if (awaited) {
+        wanted.push_back(current_path_);
+    }
+    if (!current_path_.empty()) {
+        const auto& state = App::instance().state();
+        auto add = [&](std::vector<archive::VirtualPath> paths) {
+            for (auto& path : paths) {
+                bool readable = !path.is_in_archive() || App::instance().archive();
+                if (readable && path != current_path_ &&
+                    std::ranges::find(wanted, path) == wanted.end()) {
+                    wanted.push_back(std::move(path));
+                }
+            }
+        };
+        bool forward = slideshow_ || prefetch_forward_;
+        add(state.viewerUpcoming(slideshow_ ? kSlideshowAhead : kPrefetchAhead, forward));
+        add(state.viewerUpcoming(kPrefetchBehind, !forward));
+    }
+    PrefetchJob job;
+    job.fit = display_mode_ != config::ViewerDisplayMode::Original;
+    job.fit_target = fitTargetSize();
+    job.float_bitmaps = device_resources_.deviceContext() != nullptr;
+    if (device_resources_.isValid()) {
+        job.max_side = device_resources_.renderTarget()->GetMaximumBitmapSize();
+    }
+
+    {
+        std::lock_guard lock(prefetch_mutex_);
+        prefetch_current_ = awaited ? current_path_ : archive::VirtualPath{};
+        std::erase_if(prefetched_, [&](const PrefetchedPage& page) {
+            if (page.interim) {
+                return page.path != prefetch_current_;
+            }
+            return std::ranges::find(wanted, page.path) == wanted.end();
+        });
+
+        // Over budget (pages kept as they were left): drop the farthest first
+        auto rank = [&](const PrefetchedPage& page) {
+            return std::ranges::find(wanted, page.path) - wanted.begin();
+        };
+        size_t used = 0;
+        for (const auto& page : prefetched_) {
+            used += page.path == prefetch_current_ ? 0 : pageBytes(page);
+        }
+        while (used > kPrefetchBytes) {
+            auto farthest = std::ranges::max_element(
+                prefetched_, {}, [&](const PrefetchedPage& page) {
+                    return page.path == prefetch_current_ ? -1 : rank(page);
+                });
+            if (farthest == prefetched_.end() || farthest->path == prefetch_current_) {
+                break;
+            }
+            used -= pageBytes(*farthest);
+            prefetched_.erase(farthest);
+        }
+
+        prefetch_queue_.clear();
+        for (const auto& path : wanted) {
+            bool ready = std::ranges::any_of(prefetched_, [&](const PrefetchedPage& page) {
+                return page.path == path && !page.interim;
+            });
+            if (!ready && path != prefetch_active_) {
+                job.path = path;
+                job.full = full_pending_ && path == current_path_;
+                job.interim = decode_pending_ && path == current_path_;
+                prefetch_queue_.push_back(job);
+            }
+        }
+        prefetch_wanted_ = std::move(wanted);
+        if (prefetch_queue_.empty()) {
+            return;
+        }
+    }
+
+    if (!prefetch_worker_.joinable()) {
+        prefetch_worker_ = std::jthread([this](std::stop_token stop) { prefetchLoop(stop); });
+    }
+    prefetch_cv_.notify_one();
+}
+
+std::optional<ImageViewerWindow::PrefetchedPage>
+ImageViewerWindow::takePrefetched(const archive::VirtualPath& path, bool interim) {
+    std::lock_guard lock(prefetch_mutex_);
+    auto it = std::ranges::find_if(prefetched_, [&](const PrefetchedPage& page) {
+        return page.path == path && page.interim == interim;
+    });
+    if (it == prefetched_.end()) {
+        return std::nullopt;
+    }
+    PrefetchedPage page = std::move(*it);
+    prefetched_.erase(it);
+    return page;
+}
+
+size_t ImageViewerWindow::pageBytes(const PrefetchedPage& page) noexcept {
+    return (page.image ? page.image->sizeBytes() : 0) +
+           (page.fit_image ? page.fit_image->sizeBytes() : 0) + (page.data ? page.data->size() : 0);
+}
+
+void ImageViewerWindow::onPrefetched() {
+    if (full_pending_ || reload_pending_) {
+        if (auto page = takePrefetched(current_path_)) {
+            bool reload = std::exchange(reload_pending_, false);
+            full_pending_ = false;
+            if (page->image && (reload || page->full_size.cx == 0)) {
+                // Same image at full size, or decoded again for the pixels
+                // dropped after upload: the conversion restarts on it
+                color_worker_ = {};
+                color_managed_.reset();
+                ++color_generation_;
+                showPage(std::move(*page), true);
+            } else if (reload) {
+                // Could not be decoded again (gone, or no memory): nothing left to draw
+                image_.reset();
+                image_dropped_ = false;
+                bitmap_.Reset();
+                mips_.clear();
+                updateTitle();
+                updateStatusBar();
+            } else if (!page->image) {
+                // No memory for the full size: settle for the reduced image
+                // as it is, rather than asking again on every paint
+                image_full_size_ = {};
+                clampScroll();
+                updateTitle();
+                updateStatusBar();
+            }
+            if (hwnd_) {
+                InvalidateRect(hwnd_, nullptr, FALSE);
+            }
+            schedulePrefetch();
+        }
+    } else if (decode_pending_) {
+        // The stand-in first, in case the decode has landed behind it too
+        if (auto interim = takePrefetched(current_path_, true)) {
+            showInterim(std::move(*interim));
+        }
+        if (auto page = takePrefetched(current_path_)) {
+            showPage(std::move(*page));
+            schedulePrefetch();
+            updateTitle();
+            updateStatusBar();
+            if (hwnd_) {
+                InvalidateRect(hwnd_, nullptr, FALSE);
+            }
+        }
+    }
+
+    if (device_resources_.isValid()) {
+        auto* rt = device_resources_.renderTarget();
+        std::lock_guard lock(prefetch_mutex_);
+        for (auto& page : prefetched_) {
+            if (!page.bitmap && page.image) {
+                const auto& shown = page.fit_image ? *page.fit_image : *page.image;
+                page.bitmap = d2d::createBitmapFromDecodedImage(rt, shown);
+            }
+        }
+    }
+
+    // Uploaded above, a slide that kept the show waiting goes straight up
+    if (slideshow_ && slide_waiting_) {
+        advanceSlide(false);
+    }
+}
+
+void ImageViewerWindow::prefetchLoop(std::stop_token stop) {
+    ComInitializer com(COINIT_MULTITHREADED);
+    const auto& decoders = App::instance().decoders();
+
+    // Sent ahead of the decode still running, unless the image is no longer awaited
+    auto send_interim = [this](PrefetchedPage page) {
+        {
+            std::lock_guard lock(prefetch_mutex_);
+            if (page.path != prefetch_current_) {
+                return;
+            }
+            prefetched_.push_back(std::move(page));
+        }
+        if (HWND hwnd = notify_hwnd_.load()) {
+            PostMessageW(hwnd, kWmPrefetched, 0, 0);
+        }
+    };
+
+    // Same steps as setImage() would take on the UI thread. Neighbours that
+    // are animated, or large enough to be tiled, are left to setImage(); the
+    // awaited image was already checked for both unless it is in an archive.
+    auto decode = [&](const PrefetchJob& job, bool current) -> std::optional<PrefetchedPage> {
+        ScopedTrace trace(current ? "viewer decode" : "viewer prefetch", "viewer");
+        PrefetchedPage page;
+        page.path = job.path;
+
+        std::optional<MappedFile> file;
+        std::span<const uint8_t> bytes;
+        std::string ext;
+        if (job.path.is_in_archive()) {
+            auto* archive_mgr = App::instance().archive();
+            if (!archive_mgr) {
+                return std::nullopt;
+            }
+            auto data = archive_mgr->extractToMemory(job.path);
+            if (!data || stop.stop_requested()) {
+                return std::nullopt;
+            }
+            page.data = std::make_shared<const std::vector<uint8_t>>(std::move(*data));
+            bytes = *page.data;
+            ext = pathToUtf8(std::filesystem::path(job.path.filename()).extension());
+        } else {
+            file = MappedFile::open(job.path.archive_path());
+            if (!file) {
+                return std::nullopt;
+            }
+            bytes = file->bytes();
+            ext = pathToUtf8(job.path.archive_path().extension());
+        }
+
+        auto choice = decoders.choose(bytes, ext);
+        image::WicDecoder wic;
+        if (is_animatable(choice) && (!current || job.path.is_in_archive())) {
+            auto info = wic.getInfoFromMemory(bytes);
+            if (current && info && info->frame_count > 1) {
+                page.animated = true;
+                return page;
+            }
+            if (!info || info->frame_count > 1) {
+                return std::nullopt;
+            }
+        }
+        auto target_width = static_cast<uint32_t>(job.fit_target.cx);
+        auto target_height = static_cast<uint32_t>(job.fit_target.cy);
+        auto target = decode_target(decoders, choice, bytes, job.float_bitmaps);
+        std::expected<image::ImageInfo, image::DecodeError> info =
+            std::unexpected(image::DecodeError::UnsupportedFormat);
+        if (choice.kind != image::DecoderKind::Plugin) {
+            info = wic.getInfoFromMemory(bytes);
+        }
+        if (info && !current && !job.path.is_in_archive() &&
+            (static_cast<uint64_t>(info->width) * info->height >= kTiledMinPixels ||
+             info->width > job.max_side || info->height > job.max_side)) {
+            return std::nullopt;
+        }
+
+        // Over a slow link the mapping is read as the decoders touch it. The
+        // first progressive pass is at the front of the file, so it shows long
+        // before the rest arrives; Original mode, which reads everything
+        // anyway, settles for a reduced decode ahead of the full one.
+        if (job.interim && !job.path.is_in_archive() &&
+            choice.kind != image::DecoderKind::Plugin && bytes.size() >= kInterimMinBytes &&
+            fs::IoScheduler::instance().volumeKind(job.path.archive_path()) ==
+                fs::VolumeKind::Network) {
+            auto interim_size = static_cast<uint32_t>(
+                (std::max)({job.fit_target.cx, job.fit_target.cy, LONG{256}}));
+            auto coarse = wic.decodeFirstPassFromMemory(bytes, interim_size, stop);
+            if (!coarse && !job.fit && !stop.stop_requested()) {
+                coarse = wic.decodePreviewFromMemory(bytes, interim_size, stop);
+            }
+            if (stop.stop_requested()) {
+                return std::nullopt;
+            }
+            if (coarse && coarse->image.valid()) {
+                PrefetchedPage interim;
+                interim.path = job.path;
+                interim.full_size = SIZE{static_cast<LONG>(coarse->source_width),
+                                         static_cast<LONG>(coarse->source_height)};
+                interim.image = std::make_unique<image::DecodedImage>(std::move(coarse->image));
+                interim.interim = true;
+                send_interim(std::move(interim));
+            }
+        }
+
+        // Fit modes: decode no more than the fitted size needs, for either
+        // EXIF orientation since the stored size is before it
+        if (info && job.fit && !job.full && info->width > 0 && info->height > 0) {
+            double w = info->width;
+            double h = info->height;
+            double scale = (std::max)((std::min)(target_width / w, target_height / h),
+                                      (std::min)(target_width / h, target_height / w));
+            auto max_size = static_cast<uint32_t>(std::ceil((std::max)(w, h) * scale));
+            if (scale < 1.0 && max_size > 0) {
+                auto reduced = wic.decodeThumbnailFromMemory(bytes, max_size, stop, target);
+                if (stop.stop_requested()) {
+                    return std::nullopt;
+                }
+                if (reduced && reduced->image.valid()) {
+                    page.full_size = SIZE{static_cast<LONG>(reduced->source_width),
+                                          static_cast<LONG>(reduced->source_height)};
+                    page.image = std::make_unique<image::DecodedImage>(std::move(reduced->image));
+                    return page;
+                }
+            }
+        }
+
+        auto decoded = decoders.decode(bytes, choice, target);
+        if (!decoded || stop.stop_requested()) {
+            return std::nullopt;
+        }
+
+        page.image = std::make_unique<image::DecodedImage>(std::move(*decoded));
+        if (job.fit &&
+            (page.image->width() > target_width || page.image->height() > target_height)) {
+            auto scaled = image::scaleImageParallel(
+                *page.image, target_width, target_height,
+                {.mode = image::ScaleMode::Area, .output_format = page.image->format()});
+            if (scaled) {
+                page.fit_image = std::make_unique<image::DecodedImage>(std::move(*scaled));
+                page.fit_target = job.fit_target;
+            }
+        }
+        return page;
+    };
+
+    for (;;) {
+        PrefetchJob job;
+        bool current = false;
+        {
+            std::unique_lock lock(prefetch_mutex_);
+            if (!prefetch_cv_.wait(lock, stop, [this] { return !prefetch_queue_.empty(); })) {
+                return;
+            }
+            job = std::move(prefetch_queue_.front());
+            prefetch_queue_.erase(prefetch_queue_.begin());
+            prefetch_active_ = job.path;
+            current = job.path == prefetch_current_;
+        }
+
+        auto page = decode(job, current);
+
+        bool added = false;
+        {
+            std::lock_guard lock(prefetch_mutex_);
+            prefetch_active_ = {};
+            if (job.path == prefetch_current_) {
+                // Awaited: delivered as is, or as a page without image if it failed
+                if (!page) {
+                    page.emplace();
+                    page->path = job.path;
+                }
+                prefetched_.push_back(std::move(*page));
+                added = true;
+            } else if (page && page->image &&
+                       std::ranges::find(prefetch_wanted_, page->path) != prefetch_wanted_.end() &&
+                       std::ranges::none_of(prefetched_, [&](const PrefetchedPage& ready) {
+                           return ready.path == page->path;
+                       })) {
+                size_t used = 0;
+                for (const auto& ready : prefetched_) {
+                    used += ready.path == prefetch_current_ ? 0 : pageBytes(ready);
+                }
+                if (used + pageBytes(*page) <= kPrefetchBytes) {
+                    prefetched_.push_back(std::move(*page));
+                    added = true;
+                }
+            }
+        }
+        if (added) {
+            if (HWND hwnd = notify_hwnd_.load()) {
+                PostMessageW(hwnd, kWmPrefetched, 0, 0);
+            }
+        }
+    }
+}
+
+void ImageViewerWindow::onColorManaged(WPARAM generation) {
+    std::unique_ptr<image::DecodedImage> converted;
+    {
+        std::lock_guard lock(color_mutex_);
+        converted = std::move(color_managed_);
+    }
+    if (!converted || generation != color_generation_ || !image_) {
+        return;
+    }
+    image_ = std::move(converted);
+    image_dropped_ = false;
+    image_color_managed_ = true;
+    bitmap_.Reset();
+    fit_image_.reset();
+    fit_image_target_ = {};
+    fit_bitmap_.Reset();
+    startMipChain();
+    InvalidateRect(hwnd_, nullptr, FALSE);
+}
+
+const image::DecodedImage* ImageViewerWindow::displayedImage() const noexcept {
+    return animation_frame_ ? animation_frame_.get() : image_.get();
+}
+
+bool ImageViewerWindow::hasImage() const noexcept {
+    const image::DecodedImage* shown = displayedImage();
+    return tiled_ || (shown && (shown->valid() || image_dropped_)) || preview_;
+}
+
+uint32_t ImageViewerWindow::imageWidth() const noexcept {
+    const image::DecodedImage* shown = displayedImage();
+    if (tiled_) {
+        return tiled_->width();
+    }
+    if (shown) {
+        return shown == image_.get() && image_full_size_.cx > 0
+                   ? static_cast<uint32_t>(image_full_size_.cx)
+                   : shown->width();
+    }
+    return static_cast<uint32_t>(preview_size_.cx);
+}
+
+uint32_t ImageViewerWindow::imageHeight() const noexcept {
+    const image::DecodedImage* shown = displayedImage();
+    if (tiled_) {
+        return tiled_->height();
+    }
+    if (shown) {
+        return shown == image_.get() && image_full_size_.cy > 0
+                   ? static_cast<uint32_t>(image_full_size_.cy)
+                   : shown->height();
+    }
+    return static_cast<uint32_t>(preview_size_.cy);
 }
 
 void ImageViewerWindow::updateTitle() {
@@ -745,10 +1989,10 @@ void ImageViewerWindow::updateTitle() {
 
     std::wstring title;
 
-    if (image_ && image_->valid()) {
+    if (hasImage()) {
         std::wstring filename = current_path_.filename();
-        int w = static_cast<int>(image_->width());
-        int h = static_cast<int>(image_->height());
+        int w = static_cast<int>(imageWidth());
+        int h = static_cast<int>(imageHeight());
 
         int zoom_percent;
         if (display_mode_ == config::ViewerDisplayMode::Original) {
@@ -764,11 +2008,12 @@ void ImageViewerWindow::updateTitle() {
         // Calculate current index and total image count
         size_t current_index = 0;
         size_t total_images = 0;
-        auto files = App::instance().state().files();
-        for (size_t i = 0; i < files.size(); ++i) {
-            if (files[i].is_image()) {
+        auto files = App::instance().state().model();
+        for (size_t i = 0; i < files->size(); ++i) {
+            auto file = (*files)[i];
+            if (file.is_image()) {
                 ++total_images;
-                if (files[i].name == filename) {
+                if (file.name() == filename) {
                     current_index = total_images;
                 }
             }
@@ -785,7 +2030,7 @@ void ImageViewerWindow::updateTitle() {
 }
 
 void ImageViewerWindow::clampScroll() {
-    if (!hwnd_ || !image_ || !image_->valid()) {
+    if (!hwnd_ || !hasImage()) {
         return;
     }
 
@@ -799,8 +2044,8 @@ void ImageViewerWindow::clampScroll() {
     int view_w = client.right - client.left;
     int view_h = client.bottom - client.top;
 
-    int img_w = static_cast<int>(image_->width() * zoom_);
-    int img_h = static_cast<int>(image_->height() * zoom_);
+    int img_w = static_cast<int>(imageWidth() * zoom_);
+    int img_h = static_cast<int>(imageHeight() * zoom_);
 
     // If image is smaller than view, no scrolling
     if (img_w <= view_w) {
@@ -822,7 +2067,7 @@ void ImageViewerWindow::centerImage() {
     scroll_x_ = 0;
     scroll_y_ = 0;
 
-    if (!hwnd_ || !image_ || !image_->valid()) {
+    if (!hwnd_ || !hasImage()) {
         return;
     }
 
@@ -834,8 +2079,8 @@ void ImageViewerWindow::centerImage() {
     int view_w = client.right - client.left;
     int view_h = client.bottom - client.top;
 
-    int img_w = static_cast<int>(image_->width() * zoom_);
-    int img_h = static_cast<int>(image_->height() * zoom_);
+    int img_w = static_cast<int>(imageWidth() * zoom_);
+    int img_h = static_cast<int>(imageHeight() * zoom_);
 
     // Center if image is larger than view
     if (img_w > view_w) {
@@ -901,6 +2146,8 @@ void ImageViewerWindow::createMenu() {
     AppendMenuW(view_menu, MF_STRING, kIdViewZoomOut, tr("viewer.menu.view.zoom_out").c_str());
     AppendMenuW(view_menu, MF_STRING, kIdViewResetZoom,
                 tr("viewer.menu.view.reset_zoom").c_str());
+    AppendMenuW(view_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(view_menu, MF_STRING, kIdViewSlideshow, tr("viewer.menu.view.slideshow").c_str());
 
     AppendMenuW(menu_, MF_POPUP, reinterpret_cast<UINT_PTR>(view_menu),
                 tr("viewer.menu.view.label").c_str());
@@ -939,6 +2186,10 @@ void ImageViewerWindow::onCommand(WORD id) {
         zoomReset();
         break;
 
+    case kIdViewSlideshow:
+        slideshow_ ? stopSlideshow() : startSlideshow();
+        break;
+
     default:
         break;
     }
@@ -952,33 +2203,26 @@ void ImageViewerWindow::deleteCurrentImage() {
     auto file_path = current_path_.archive_path();
 
     // Determine next image to show before deletion
-    auto files = App::instance().state().files();
+    auto files = App::instance().state().model();
     std::wstring filename = current_path_.filename();
-    std::optional<size_t> current_idx;
-
-    for (size_t i = 0; i < files.size(); ++i) {
-        if (files[i].name == filename) {
-            current_idx = i;
-            break;
-        }
-    }
+    std::optional<size_t> current_idx = files->find(filename);
 
     std::optional<archive::VirtualPath> next_image;
     if (current_idx) {
         // Look forward for next image
-        for (size_t i = *current_idx + 1; i < files.size(); ++i) {
-            if (files[i].is_image()) {
-                next_image =
-                    files[i].virtual_path.value_or(archive::VirtualPath(files[i].path));
+        for (size_t i = *current_idx + 1; i < files->size(); ++i) {
+            auto file = (*files)[i];
+            if (file.is_image()) {
+                next_image = file.virtual_path().value_or(archive::VirtualPath(file.path()));
                 break;
             }
         }
         // If no next, look backward for previous image
         if (!next_image) {
             for (size_t i = *current_idx; i > 0; --i) {
-                if (files[i - 1].is_image()) {
-                    next_image =
-                        files[i - 1].virtual_path.value_or(archive::VirtualPath(files[i - 1].path));
+                auto file = (*files)[i - 1];
+                if (file.is_image()) {
+                    next_image = file.virtual_path().value_or(archive::VirtualPath(file.path()));
                     break;
                 }
             }
@@ -993,11 +2237,11 @@ void ImageViewerWindow::deleteCurrentImage() {
         mw->setCursorHintSelectNext({file_path});
     }
 
-    // Delete with confirmation dialog
+    // Delete with confirmation dialog; in the foreground, as the next image depends on it
     FileOperationManager file_op(hwnd_);
-    auto result = file_op.deleteFiles({file_path});
+    auto result = file_op.deleteFiles({file_path}, {.background = false});
 
-    if (!result.succeeded() && !result.partiallySucceeded()) {
+    if (!result || (!result->succeeded() && !result->partiallySucceeded())) {
         return;
     }
 
@@ -1031,6 +2275,8 @@ void ImageViewerWindow::updateMenuCheck() {
         menu_, kIdViewShrinkToFit,
         MF_BYCOMMAND |
             (display_mode_ == config::ViewerDisplayMode::ShrinkToFit ? MF_CHECKED : MF_UNCHECKED));
+    CheckMenuItem(menu_, kIdViewSlideshow,
+                  MF_BYCOMMAND | (slideshow_ ? MF_CHECKED : MF_UNCHECKED));
 }
 
 void ImageViewerWindow::createStatusBar() {
@@ -1059,25 +2305,23 @@ void ImageViewerWindow::updateStatusBar() {
 
     // Look up file metadata from current directory listing
     std::wstring filename = current_path_.filename();
-    auto files = App::instance().state().files();
-
-    for (const auto& file : files) {
-        if (file.name == filename) {
-            // Format modified time (same format as FileListView: %Y-%m-%d %H:%M)
-            auto tt = std::chrono::system_clock::to_time_t(file.modified_time);
-            std::tm tm_buf;
-            localtime_s(&tm_buf, &tt);
-
-            wchar_t date_buf[64];
-            std::wcsftime(date_buf, sizeof(date_buf) / sizeof(wchar_t), L"%Y-%m-%d %H:%M",
-                          &tm_buf);
-
-            auto text =
-                std::vformat(i18n::tr("viewer.status.modified_date"),
-                             std::make_wformat_args(date_buf));
-            SendMessageW(status_bar_, SB_SETTEXTW, 0, reinterpret_cast<LPARAM>(text.c_str()));
-            return;
-        }
+    auto files = App::instance().state().model();
+
+    if (auto index = files->find(filename)) {
+        // Format modified time (same format as FileListView: %Y-%m-%d %H:%M)
+        auto tt = std::chrono::system_clock::to_time_t((*files)[*index].modified_time());
+        std::tm tm_buf;
+        localtime_s(&tm_buf, &tt);
+
+        wchar_t date_buf[64];
+        std::wcsftime(date_buf, sizeof(date_buf) / sizeof(wchar_t), L"%Y-%m-%d %H:%M",
+                      &tm_buf);
+
+        auto text =
+            std::vformat(i18n::tr("viewer.status.modified_date"),
+                         std::make_wformat_args(date_buf));
+        SendMessageW(status_bar_, SB_SETTEXTW, 0, reinterpret_cast<LPARAM>(text.c_str()));
+        return;
     }
 
     // File not found in listing
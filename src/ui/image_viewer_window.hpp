@@ -10,15 +10,31 @@
 
 #include <d2d1.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <expected>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <stop_token>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "core/archive/virtual_path.hpp"
 #include "core/config/settings.hpp"
+#include "core/image/animation_player.hpp"
+#include "core/image/color_management.hpp"
 #include "core/image/decoded_image.hpp"
+#include "core/image/tiled_image.hpp"
 #include "core/util/com_ptr.hpp"
+#include "core/util/lru_cache.hpp"
+#include "core/util/memory_accounting.hpp"
 #include "d2d/core/device_resources.hpp"
+#include "d2d/core/hdr_renderer.hpp"
 
 namespace nive::ui {
 
@@ -82,10 +98,53 @@ public:
     /// @brief Navigate to previous image
     void previousImage();
 
+    /// @brief Advance through the images on a timer, with a crossfade between them
+    void startSlideshow();
+
+    /// @brief Stop the slideshow, leaving the current slide up
+    void stopSlideshow();
+
+    /// @brief Check if a slideshow is running
+    [[nodiscard]] bool slideshowRunning() const noexcept { return slideshow_; }
+
     /// @brief Save window state to settings
     void saveState(config::Settings& settings) const;
 
 private:
+    /// @brief Image for prefetch_worker_ to decode
+    struct PrefetchJob {
+        archive::VirtualPath path;
+        bool fit = false;  // Scale to fit_target as well
+        SIZE fit_target{};
+        bool float_bitmaps = false;
+        uint32_t max_side = 16384;  // Larger local images are left to setImage() to tile
+        bool full = false;          // Full size even when fit (the view zoomed past it)
+        bool interim = false;       // Awaited by setImage(): may send a stand-in first
+    };
+
+    /// @brief Image decoded ahead of being shown, or kept after it was
+    ///
+    /// A page without image is the outcome for the image setImage() waits on
+    /// when it could not be decoded (or, in an archive, is animated).
+    struct PrefetchedPage {
+        archive::VirtualPath path;
+        std::unique_ptr<image::DecodedImage> image;
+        std::unique_ptr<image::DecodedImage> fit_image;  // If image is larger than fit_target
+        SIZE fit_target{};
+        SIZE full_size{};  // Size image was reduced from when decoded to fit_target; else {}
+        std::shared_ptr<const std::vector<uint8_t>> data;  // Encoded archive entry
+        ComPtr<ID2D1Bitmap> bitmap;  // Of fit_image if set, else of image
+        bool color_managed = false;  // image is already in the monitor profile
+        bool animated = false;       // Archive entry to play from data
+        bool interim = false;        // Coarse stand-in sent while the decode goes on
+    };
+
+    /// @brief Half-size copy of image_ (or of the level before it)
+    struct MipLevel {
+        std::unique_ptr<image::DecodedImage> image;
+        ComPtr<ID2D1Bitmap> bitmap;  // Uploaded when first drawn from
+    };
+
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
     LRESULT handleMessage(UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -104,9 +163,127 @@ private:
 
     void render();
     void recreateBitmap();
+
+    /// @brief Draw a bitmap of an image (float ones through hdr_renderer_)
+    /// @param peak Brightest value of the image, for float bitmaps
+    /// @param downscaled Drawn smaller than it is: averaged rather than sampled once
+    void drawBitmap(ID2D1Bitmap* bitmap, const D2D1_RECT_F& dest, float peak, bool downscaled);
+
+    /// @brief Put the next slide up once it is decoded (kSlideshowTimerId, kWmPrefetched)
+    /// @param interval_elapsed Called as the interval ran out, rather than for a decode
+    void advanceSlide(bool interval_elapsed);
+
+    /// @brief Show a slide, fading over from the frame drawn last
+    void showSlide(const archive::VirtualPath& path);
+
+    /// @brief Charge the images held: shown, fit copy, mips, preview and prefetched pages
+    void updateMemoryCharge();
+
+    /// @brief Get the bitmap to draw in the current display mode, creating it if needed
+    [[nodiscard]] ID2D1Bitmap* currentBitmap();
+
+    /// @brief Build the mip chain of image_ on mip_worker_, dropping the current one
+    void startMipChain();
+
+    /// @brief Take the levels mip_worker_ built (kWmMipsReady)
+    /// @param generation mip_generation_ when the chain was started
+    void onMipsReady(WPARAM generation);
+
+    /// @brief Get the smallest level of image_ at least as wide as it is drawn
+    /// @param display_width Drawn width in pixels
+    /// @return Level bitmap, or nullptr to draw image_ itself (no level is small enough yet)
+    [[nodiscard]] ID2D1Bitmap* mipBitmap(float display_width);
+
+    /// @brief Get the size fit-mode copies are scaled to (the window's monitor, in pixels)
+    [[nodiscard]] SIZE fitTargetSize() const;
+
+    /// @brief Open a local file as a TiledImage if it is too large to decode whole
+    /// @return true if tiled_ was set
+    bool openTiled(const std::filesystem::path& path);
+
+    /// @brief Draw the tiles of tiled_ that intersect the view
+    /// @param dest Where the whole image is drawn, in view coordinates
+    void renderTiles(ID2D1RenderTarget* rt, const D2D1_RECT_F& dest, float view_w, float view_h);
+
+    /// @brief Get the D2D bitmap for a tile, decoding and uploading it if needed
+    [[nodiscard]] ID2D1Bitmap* tileBitmap(ID2D1RenderTarget* rt, const image::TileKey& key);
+
+    /// @brief Play an animated image instead of showing a still one
+    /// @return true if animation_ was set
+    bool startAnimation(
+        std::expected<std::unique_ptr<image::AnimationDecoder>, image::DecodeError> decoder);
+
+    /// @brief Take the player's current frame (kWmAnimationFrame)
+    void onAnimationFrame();
+
+    /// @brief Convert image_ to the monitor's color profile on color_worker_
+    /// @param read_profile Reads the embedded profile of the source (called on the worker)
+    void startColorManagement(std::function<image::ColorProfile()> read_profile);
+
+    /// @brief Swap in the converted image (kWmColorManaged)
+    /// @param generation color_generation_ when the conversion started
+    void onColorManaged(WPARAM generation);
+
+    /// @brief Queue the image being loaded and its neighbours for prefetch_worker_
+    ///
+    /// Wanted are the image setImage() waits on, kPrefetchAhead images in
+    /// the browsing direction (kSlideshowAhead forward during a slideshow)
+    /// and kPrefetchBehind the other way, in that order; pages no longer
+    /// among them are dropped.
+    void schedulePrefetch();
+
+    /// @brief Remove and return the prefetched page for a path, if it is ready
+    /// @param interim Take the stand-in sent ahead of the decode instead
+    [[nodiscard]] std::optional<PrefetchedPage> takePrefetched(const archive::VirtualPath& path,
+                                                               bool interim = false);
+
+    /// @brief Keep the image being left as a page, if it is still wanted and fits the budget
+    void retainCurrent();
+
+    /// @brief Show a page decoded for the current path
+    /// @param keep_view Keep zoom and scroll (the full-size decode of a reduced image)
+    void showPage(PrefetchedPage page, bool keep_view = false);
+
+    /// @brief Have prefetch_worker_ decode the current image at full size
+    ///        (the view needs more pixels than a reduced decode holds)
+    void requestFullResolution();
+
+    /// @brief Have prefetch_worker_ decode the current image again
+    ///        (its pixels were dropped after upload and are needed once more)
+    void reloadImage();
+
+    /// @brief Show the cached thumbnail of the current path until its decode lands
+    void showPreview();
+
+    /// @brief Show a stand-in for the current image in place of a smaller preview
+    void showInterim(PrefetchedPage page);
+
+    /// @brief Bytes a page's pixels and encoded data take
+    [[nodiscard]] static size_t pageBytes(const PrefetchedPage& page) noexcept;
+
+    /// @brief Upload the bitmaps of newly prefetched pages, or show the awaited one
+    ///        (kWmPrefetched)
+    void onPrefetched();
+
+    /// @brief Extract and decode queued pages until stopped (prefetch_worker_)
+    void prefetchLoop(std::stop_token stop);
+
+    /// @brief Get the whole image shown now: the current animation frame or image_
+    [[nodiscard]] const image::DecodedImage* displayedImage() const noexcept;
+
+    /// @brief Check if an image (whole or tiled) is loaded
+    [[nodiscard]] bool hasImage() const noexcept;
+
+    /// @brief Full size of the loaded image
+    [[nodiscard]] uint32_t imageWidth() const noexcept;
+    [[nodiscard]] uint32_t imageHeight() const noexcept;
+
     void updateTitle();
     void clampScroll();
     void centerImage();
+
+    /// @brief Reset zoom and scroll for a newly shown image
+    void resetView();
     void createMenu();
     void createStatusBar();
     void updateStatusBar();
@@ -129,12 +306,100 @@ private:
     // D2D rendering
     d2d::DeviceResources device_resources_;
     ComPtr<ID2D1Bitmap> bitmap_;
+    ComPtr<ID2D1Bitmap> fit_bitmap_;  // From fit_image_
     uint32_t last_resource_epoch_ = 0;
+    d2d::HdrRenderer hdr_renderer_;  // Draws RGBA16F images
+    float hdr_peak_ = 1.0f;          // Brightest value of image_, see d2d::scrgbPeak()
 
     // Current image
     std::unique_ptr<image::DecodedImage> image_;
+    std::shared_ptr<const std::vector<uint8_t>> image_data_;  // Encoded, if from an archive
+    bool image_color_managed_ = false;  // onColorManaged() swapped image_
+
+    // In the fit modes images are decoded straight to the monitor's size
+    // (WIC scaler or JPEG DCT scaling); the full size drawn stretched until
+    // the view zooms past it and requestFullResolution() swaps in the rest
+    SIZE image_full_size_{};  // Size image_ stands for if reduced, else {}
+    bool full_pending_ = false;  // Full-size decode of current_path_ queued
+
+    // A large image_ uploaded whole to bitmap_ does not keep its pixels on
+    // the CPU as well: image_ keeps only its size and format, and
+    // reloadImage() decodes it again (fit-sized in the fit modes) once
+    // bitmap_ is lost with the device or a fit copy has to be scaled
+    bool image_dropped_ = false;
+    bool reload_pending_ = false;  // Decode of dropped pixels queued
+
+    // Mip chain of image_ for zooming out: each level half the one before,
+    // down to kMipMinSide. Built on mip_worker_ and handed over with
+    // kWmMipsReady; until then (and past the chain) image_ is drawn as is
+    std::vector<MipLevel> mips_;
+    std::mutex mip_mutex_;
+    std::vector<std::unique_ptr<image::DecodedImage>> mips_built_;  // Guarded by mip_mutex_
+    uint64_t mip_generation_ = 0;  // Bumped whenever image_ changes
+
+    // Cached thumbnail drawn at the image's size while prefetch_worker_ decodes it
+    std::unique_ptr<image::DecodedImage> preview_;
+    SIZE preview_size_{};
+    bool decode_pending_ = false;  // current_path_ waits on prefetch_worker_
+
+    // Monitor-sized copy of an image larger than the monitor, drawn in the fit modes
+    std::unique_ptr<image::DecodedImage> fit_image_;
+    SIZE fit_image_target_{};  // fitTargetSize() that fit_image_ was scaled for
+
+    // Set instead of image_ for images too large to decode whole; only the
+    // visible tiles are decoded and uploaded
+    std::unique_ptr<image::TiledImage> tiled_;
+    LruCache<uint64_t, ComPtr<ID2D1Bitmap>> tile_bitmaps_{kTileBitmapBytes};
+
+    // Set instead of image_ for animated images. The player thread posts
+    // kWmAnimationFrame (at most one pending) to notify_hwnd_ on each frame.
+    std::unique_ptr<image::AnimationPlayer> animation_;
+    std::shared_ptr<const image::DecodedImage> animation_frame_;  // Uploaded to bitmap_
+    std::atomic<HWND> notify_hwnd_{nullptr};
+    std::atomic<bool> frame_posted_{false};
     archive::VirtualPath current_path_;
 
+    // Color management: image_ shows as decoded while color_worker_ converts a
+    // copy to the monitor profile, then posts kWmColorManaged with the
+    // generation it started at; results for an earlier image are dropped
+    std::mutex color_mutex_;
+    std::unique_ptr<image::DecodedImage> color_managed_;  // Guarded by color_mutex_
+    uint64_t color_generation_ = 0;                       // Bumped by setImage()
+
+    MemoryCharge memory_charge_{MemoryCategory::Viewer};  // See updateMemoryCharge()
+
+    // Prefetch: prefetch_worker_ extracts and decodes the image being opened
+    // and its neighbours (and scales them for the fit modes), then posts
+    // kWmPrefetched so their bitmaps are uploaded on this thread, as D2D
+    // requires. A flip to a prefetched page only swaps in what is already
+    // there; the image left stays as a page while it is a wanted neighbour.
+    std::mutex prefetch_mutex_;
+    std::condition_variable_any prefetch_cv_;
+    std::vector<PrefetchJob> prefetch_queue_;            // Wanted order; guarded
+    std::vector<archive::VirtualPath> prefetch_wanted_;  // Guarded by prefetch_mutex_
+    archive::VirtualPath prefetch_current_;  // Awaited by setImage() or full size; guarded
+    std::vector<PrefetchedPage> prefetched_;             // Guarded by prefetch_mutex_
+    archive::VirtualPath prefetch_active_;               // Being decoded; guarded
+    bool prefetch_forward_ = true;                       // Direction of the last flip
+
+    // Slideshow: kSlideshowTimerId fires once per interval. A slide goes up
+    // only once prefetch_worker_ has decoded it; one still decoding when the
+    // interval runs out goes up from onPrefetched() as it lands, and after a
+    // whole interval more the show skips to the nearest slide that is ready.
+    // Each change fades the new frame in over the last one, a step per
+    // present (the swap chain presents on vertical blank).
+    bool slideshow_ = false;
+    bool slide_waiting_ = false;        // The interval ran out before the next slide was ready
+    ComPtr<ID2D1Bitmap> drawn_bitmap_;  // Drawn by the last render(), to fade from
+    D2D1_RECT_F drawn_dest_{};
+    float drawn_peak_ = 1.0f;
+    ComPtr<ID2D1Bitmap> fade_bitmap_;  // Fading out; set while a crossfade runs
+    D2D1_RECT_F fade_dest_{};
+    float fade_peak_ = 1.0f;
+    std::chrono::steady_clock::time_point fade_start_;
+    ComPtr<ID2D1Layer> fade_layer_;            // Opacity of the frame fading in
+    ComPtr<ID2D1SolidColorBrush> fade_brush_;  // Its background
+
     // Display settings
     config::ViewerDisplayMode display_mode_ = config::ViewerDisplayMode::ShrinkToFit;
     float zoom_ = 1.0f;
@@ -148,14 +413,55 @@ private:
     int drag_start_scroll_x_ = 0;
     int drag_start_scroll_y_ = 0;
 
+    // Images with more pixels than this, or a side beyond the D2D bitmap
+    // limit, are shown tiled
+    static constexpr uint64_t kTiledMinPixels = 100'000'000;
+    static constexpr size_t kTileBitmapBytes = 256ull * 1024 * 1024;
+
+    // Uploaded images at least this large drop their CPU pixels; smaller
+    // ones cost less to keep than to decode again
+    static constexpr size_t kDropPixelsMinBytes = 32ull * 1024 * 1024;
+
     // Zoom limits
     static constexpr float kMinZoom = 0.1f;    // 10%
     static constexpr float kMaxZoom = 32.0f;   // 3200%
     static constexpr float kZoomStep = 1.25f;  // 25% per step
 
+    // Posted by the animation player thread
+    static constexpr UINT kWmAnimationFrame = WM_APP + 1;
+
+    // Posted by the color management worker
+    static constexpr UINT kWmColorManaged = WM_APP + 2;
+
+    // Posted by the prefetch worker when a page is ready
+    static constexpr UINT kWmPrefetched = WM_APP + 3;
+
+    // Posted by the mip worker when the chain is built
+    static constexpr UINT kWmMipsReady = WM_APP + 4;
+
+    // Smallest level side; zooming out further scales the last level
+    static constexpr uint32_t kMipMinSide = 512;
+
+    // Images kept decoded in and against the browsing direction, and the
+    // most their pixels may take (the image being opened is not counted)
+    static constexpr size_t kPrefetchAhead = 3;
+    static constexpr size_t kPrefetchBehind = 1;
+    static constexpr size_t kPrefetchBytes = 512ull * 1024 * 1024;
+
+    // Slides kept decoded ahead during a slideshow, and how long a change fades
+    static constexpr size_t kSlideshowAhead = 6;
+    static constexpr auto kSlideFade = std::chrono::milliseconds(400);
+
+    // Awaited files at least this large on a network volume first show their
+    // coarsest progressive pass (or, in Original mode, a reduced decode)
+    static constexpr size_t kInterimMinBytes = 4ull * 1024 * 1024;
+
     // Control IDs
     static constexpr int kIdStatusBar = 200;
 
+    // Timer IDs
+    static constexpr UINT_PTR kSlideshowTimerId = 1;
+
     // Menu IDs
     static constexpr WORD kIdFileExit = 1001;
     static constexpr WORD kIdViewOriginal = 1101;
@@ -164,6 +470,12 @@ private:
     static constexpr WORD kIdViewZoomIn = 1111;
     static constexpr WORD kIdViewZoomOut = 1112;
     static constexpr WORD kIdViewResetZoom = 1113;
+    static constexpr WORD kIdViewSlideshow = 1121;
+
+    // Last members: joined before anything they use is destroyed
+    std::jthread prefetch_worker_;
+    std::jthread color_worker_;
+    std::jthread mip_worker_;
 };
 
 }  // namespace nive::ui
@@ -7,8 +7,10 @@
 
 #include <CommCtrl.h>
 #include <ShlObj.h>
+#include <dwmapi.h>
 #include <windowsx.h>
 
+#include <algorithm>
 #include <array>
 #include <format>
 
@@ -31,6 +33,25 @@ namespace nive::ui {
 namespace {
 constexpr wchar_t kWindowClass[] = L"NiveMainWindow";
 constexpr wchar_t kAppTitle[] = L"nive";
+
+// Ask for a destination directory; empty if cancelled
+std::filesystem::path browse_for_folder(HWND parent, const wchar_t* title) {
+    wchar_t path[MAX_PATH] = {};
+
+    BROWSEINFOW bi = {};
+    bi.hwndOwner = parent;
+    bi.pszDisplayName = path;
+    bi.lpszTitle = title;
+    bi.ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
+
+    LPITEMIDLIST pidl = SHBrowseForFolderW(&bi);
+    if (!pidl) {
+        return {};
+    }
+    bool ok = SHGetPathFromIDListW(pidl, path) != FALSE;
+    CoTaskMemFree(pidl);
+    return ok ? std::filesystem::path(path) : std::filesystem::path();
+}
 }  // namespace
 
 MainWindow::MainWindow() = default;
@@ -44,6 +65,10 @@ MainWindow::~MainWindow() {
     }
 }
 
+HWND MainWindow::findRunning() noexcept {
+    return FindWindowW(kWindowClass, nullptr);
+}
+
 bool MainWindow::create(HINSTANCE hInstance) {
     hinstance_ = hInstance;
 
@@ -145,6 +170,12 @@ void MainWindow::saveState(config::Settings& settings) const {
         settings.file_list_columns.path = static_cast<float>(widths[3]);
         settings.file_list_columns.dimensions = static_cast<float>(widths[4]);
     }
+
+    // Grid position in the current directory, for the next session's warm-up
+    if (grid_) {
+        settings.last_scroll_index = grid_->firstVisibleIndex();
+        settings.last_visible_count = grid_->visibleCapacity();
+    }
 }
 
 namespace {
@@ -169,20 +200,52 @@ std::wstring formatSize(uint64_t bytes) {
     }
 }
 
+// One display refresh, for updates nobody could see more often
+[[nodiscard]] UINT display_frame_interval_ms() {
+    DWM_TIMING_INFO timing = {};
+    timing.cbSize = sizeof(timing);
+    if (SUCCEEDED(DwmGetCompositionTimingInfo(nullptr, &timing)) &&
+        timing.rateRefresh.uiNumerator > 0) {
+        return (std::max)(static_cast<UINT>(1000ull * timing.rateRefresh.uiDenominator /
+                                            timing.rateRefresh.uiNumerator),
+                          static_cast<UINT>(USER_TIMER_MINIMUM));
+    }
+    return 16;
+}
+
 }  // namespace
 
+void MainWindow::requestStatusBarUpdate() {
+    if (!status_bar_ || status_bar_pending_) {
+        return;
+    }
+    status_bar_pending_ = true;
+    SetTimer(hwnd_, kStatusBarTimerId, display_frame_interval_ms(), nullptr);
+}
+
 void MainWindow::updateStatusBar() {
     if (!status_bar_) {
         return;
     }
+    if (status_bar_pending_) {
+        KillTimer(hwnd_, kStatusBarTimerId);
+        status_bar_pending_ = false;
+    }
 
     auto& state = App::instance().state();
     auto path = state.currentPath().wstring();
-    auto files = state.files();
+    auto files = state.model();
     auto sel = state.selection();
 
-    // Part 0: Path (or "Ready" if no path set)
-    if (path.empty()) {
+    // Part 0: Path (or "Ready" if no path set), or the library search
+    if (App::instance().isShowingSimilarImages()) {
+        auto text = std::wstring(i18n::tr("status.similar_images"));
+        SendMessageW(status_bar_, SB_SETTEXTW, 0, reinterpret_cast<LPARAM>(text.c_str()));
+    } else if (App::instance().isSearchingLibrary()) {
+        const auto& query = App::instance().libraryQuery();
+        auto text = std::vformat(i18n::tr("status.library_search"), std::make_wformat_args(query));
+        SendMessageW(status_bar_, SB_SETTEXTW, 0, reinterpret_cast<LPARAM>(text.c_str()));
+    } else if (path.empty()) {
         auto ready = std::wstring(i18n::tr("status.ready"));
         SendMessageW(status_bar_, SB_SETTEXTW, 0, reinterpret_cast<LPARAM>(ready.c_str()));
     } else {
@@ -194,22 +257,48 @@ void MainWindow::updateStatusBar() {
     if (!sel.empty()) {
         uint64_t total_size = 0;
         for (size_t idx : sel.indices) {
-            if (idx < files.size()) {
-                total_size += files[idx].size_bytes;
+            if (idx < files->size()) {
+                total_size += (*files)[idx].size_bytes();
             }
         }
         info_text = std::format(L"{} selected ({})  |  {} files", sel.count(),
-                                formatSize(total_size), files.size());
+                                formatSize(total_size), files->size());
     } else {
-        info_text = std::format(L"{} files", files.size());
+        info_text = std::format(L"{} files", files->size());
     }
     SendMessageW(status_bar_, SB_SETTEXTW, 1, reinterpret_cast<LPARAM>(info_text.c_str()));
 
-    // Part 2: Thumbnail count
-    size_t thumb_count = grid_ ? grid_->thumbnailCount() : 0;
-    auto thumb_text =
-        std::vformat(i18n::tr("status.thumbnail_count"), std::make_wformat_args(thumb_count));
-    SendMessageW(status_bar_, SB_SETTEXTW, 2, reinterpret_cast<LPARAM>(thumb_text.c_str()));
+    // Part 2: File operation progress, or thumbnail count when none is running
+    auto jobs = file_op_manager_ ? file_op_manager_->jobs() : std::vector<FileJobStatus>{};
+    auto active = std::ranges::find_if(
+        jobs, [](const FileJobStatus& job) { return job.state != FileJobState::Queued; });
+    std::wstring job_text;
+    if (active != jobs.end()) {
+        auto kind = jobKindLabel(active->kind);
+        auto percent = static_cast<int>(active->fraction * 100.0);
+        job_text =
+            std::vformat(i18n::tr("status.job_progress"), std::make_wformat_args(kind, percent));
+        if (active->state == FileJobState::Paused) {
+            job_text += std::wstring(i18n::tr("status.job_paused"));
+        } else if (active->bytes_per_second > 0) {
+            auto speed = formatSize(active->bytes_per_second);
+            job_text +=
+                std::vformat(i18n::tr("status.job_throughput"), std::make_wformat_args(speed));
+        }
+        if (jobs.size() > 1) {
+            auto others = jobs.size() - 1;
+            job_text +=
+                std::vformat(i18n::tr("status.jobs_pending"), std::make_wformat_args(others));
+        }
+    } else if (!jobs.empty()) {
+        auto queued = jobs.size();
+        job_text = std::vformat(i18n::tr("status.jobs_queued"), std::make_wformat_args(queued));
+    } else {
+        size_t thumb_count = grid_ ? grid_->thumbnailCount() : 0;
+        job_text =
+            std::vformat(i18n::tr("status.thumbnail_count"), std::make_wformat_args(thumb_count));
+    }
+    SendMessageW(status_bar_, SB_SETTEXTW, 2, reinterpret_cast<LPARAM>(job_text.c_str()));
 }
 
 LRESULT CALLBACK MainWindow::WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -265,9 +354,17 @@ LRESULT MainWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         return 0;
 
     case WM_SIZE:
+        App::instance().onWindowMinimized(wParam == SIZE_MINIMIZED);
         onSize(LOWORD(lParam), HIWORD(lParam));
         return 0;
 
+    case WM_POWERBROADCAST:
+        // Sent for AC/battery and battery saver changes alike
+        if (wParam == PBT_APMPOWERSTATUSCHANGE) {
+            App::instance().onPowerStatusChanged();
+        }
+        return TRUE;
+
     case WM_PAINT:
         onPaint();
         return 0;
@@ -276,6 +373,17 @@ LRESULT MainWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         onDestroy();
         return 0;
 
+    case WM_COPYDATA: {
+        const auto* data = reinterpret_cast<const COPYDATASTRUCT*>(lParam);
+        if (!data || data->dwData != kCopyDataOpenPath) {
+            break;
+        }
+        std::wstring path(static_cast<const wchar_t*>(data->lpData),
+                          data->cbData / sizeof(wchar_t));
+        App::instance().openForwarded(path);
+        return TRUE;
+    }
+
     case WM_CLOSE:
         // Save window state before destruction
         saveState(App::instance().settings());
@@ -284,6 +392,13 @@ LRESULT MainWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
 
 
     case WM_COMMAND:
+        if (LOWORD(wParam) == kIdLibrarySearch) {
+            if (HIWORD(wParam) == EN_CHANGE) {
+                search_typing_ = true;
+                SetTimer(hwnd_, kLibrarySearchTimerId, kLibrarySearchDelayMs, nullptr);
+            }
+            return 0;
+        }
         onCommand(LOWORD(wParam));
         return 0;
 
@@ -292,7 +407,7 @@ LRESULT MainWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         if (tree_ && nmhdr->hwndFrom == tree_->hwnd()) {
             return tree_->handleNotify(nmhdr);
         } else if (file_list_ && nmhdr->hwndFrom == file_list_->hwnd()) {
-            file_list_->handleNotify(nmhdr);
+            return file_list_->handleNotify(nmhdr);
         }
         return 0;
     }
@@ -378,6 +493,53 @@ LRESULT MainWindow::handleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
     case WM_THUMBNAIL_READY:
         App::instance().processThumbnailResults();
         return 0;
+
+    case WM_TIMER:
+        if (wParam == kThumbnailBatchTimerId) {
+            KillTimer(hwnd_, kThumbnailBatchTimerId);
+            App::instance().processThumbnailResults();
+            return 0;
+        }
+        if (wParam == kStatusBarTimerId) {
+            updateStatusBar();
+            return 0;
+        }
+        if (wParam == kLibrarySearchTimerId) {
+            KillTimer(hwnd_, kLibrarySearchTimerId);
+            runLibrarySearch();
+            return 0;
+        }
+        if (wParam == kPerfOverlayTimerId) {
+            App::instance().updatePerfOverlay();
+            return 0;
+        }
+        break;
+
+    case WM_DIRECTORY_SCAN_UPDATE:
+        App::instance().processDirectoryScanUpdates();
+        return 0;
+
+    case WM_DIRECTORY_CHANGED:
+        App::instance().processDirectoryChanges();
+        return 0;
+
+    case WM_RESUME_COROUTINE:
+        WindowExecutor::resume(lParam);
+        return 0;
+
+    case WM_MEMORY_LOW:
+        App::instance().releaseMemory();
+        return 0;
+
+    case WM_CACHE_RELOCATED:
+        App::instance().onCacheRelocated(wParam != 0);
+        return 0;
+
+    case FileOperationManager::kWmFileJob:
+        if (file_op_manager_) {
+            file_op_manager_->handleJobMessage();
+        }
+        return 0;
     }
 
     return DefWindowProcW(hwnd_, msg, wParam, lParam);
@@ -424,6 +586,7 @@ void MainWindow::onCommand(WORD id) {
         if (d2d::showD2DSettingsDialog(hwnd_, settings)) {
             // Settings were changed, save and apply
             App::instance().saveSettings();
+            App::instance().relocateCache();
             if (tree_) {
                 tree_->updateNetworkShares(settings.network_shares);
             }
@@ -447,6 +610,45 @@ void MainWindow::onCommand(WORD id) {
         break;
     }
 
+    case kIdFilePauseJobs:
+        if (file_op_manager_) {
+            auto jobs = file_op_manager_->jobs();
+            bool any_running = std::ranges::any_of(
+                jobs, [](const FileJobStatus& job) { return job.state == FileJobState::Running; });
+            if (any_running) {
+                file_op_manager_->pauseAll();
+            } else {
+                file_op_manager_->resumeAll();
+            }
+        }
+        break;
+
+    case kIdFileCancelJobs:
+        if (file_op_manager_) {
+            file_op_manager_->cancelAll();
+        }
+        break;
+
+    case kIdFileExportImages:
+        exportSelectedImages();
+        break;
+
+    case kIdRotateClockwise:
+        reorientSelectedImages(image::OrientationChange::RotateClockwise);
+        break;
+
+    case kIdRotateCounterClockwise:
+        reorientSelectedImages(image::OrientationChange::RotateCounterClockwise);
+        break;
+
+    case kIdFlipHorizontal:
+        reorientSelectedImages(image::OrientationChange::FlipHorizontal);
+        break;
+
+    case kIdFlipVertical:
+        reorientSelectedImages(image::OrientationChange::FlipVertical);
+        break;
+
     case kIdFileExit:
         PostMessageW(hwnd_, WM_CLOSE, 0, 0);
         break;
@@ -455,35 +657,49 @@ void MainWindow::onCommand(WORD id) {
     case kIdSortNatural:
         settings.sort.method = config::SortMethod::Natural;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
         updateSortMenu();
         break;
 
     case kIdSortLexicographic:
         settings.sort.method = config::SortMethod::Lexicographic;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
         updateSortMenu();
         break;
 
     case kIdSortDateModified:
         settings.sort.method = config::SortMethod::DateModified;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
         updateSortMenu();
         break;
 
     case kIdSortDateCreated:
         settings.sort.method = config::SortMethod::DateCreated;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
         updateSortMenu();
         break;
 
     case kIdSortSize:
         settings.sort.method = config::SortMethod::Size;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
+        updateSortMenu();
+        break;
+
+    case kIdSortDateTaken:
+        settings.sort.method = config::SortMethod::DateTaken;
+        App::instance().saveSettings();
+        App::instance().resort();
+        updateSortMenu();
+        break;
+
+    case kIdSortCameraModel:
+        settings.sort.method = config::SortMethod::CameraModel;
+        App::instance().saveSettings();
+        App::instance().resort();
         updateSortMenu();
         break;
 
@@ -491,17 +707,33 @@ void MainWindow::onCommand(WORD id) {
     case kIdSortAscending:
         settings.sort.ascending = true;
         App::instance().saveSettings();
-        App::instance().refresh();
+        App::instance().resort();
         updateSortMenu();
         break;
 
     case kIdSortDescending:
         settings.sort.ascending = false;
         App::instance().saveSettings();
+        App::instance().resort();
+        updateSortMenu();
+        break;
+
+    // Listing
+    case kIdViewFlatten:
+        settings.flatten_subfolders = !settings.flatten_subfolders;
+        App::instance().saveSettings();
         App::instance().refresh();
         updateSortMenu();
         break;
 
+    case kIdViewFindSimilar:
+        App::instance().findSimilarImages();
+        break;
+
+    case kIdViewPerfOverlay:
+        togglePerfOverlay();
+        break;
+
 #ifdef NIVE_DEBUG_D2D_TEST
     case kIdDebugD2DTest:
         d2d::showD2DTestDialog(hwnd_);
@@ -514,6 +746,57 @@ void MainWindow::onCommand(WORD id) {
     }
 }
 
+void MainWindow::exportSelectedImages() {
+    if (!file_op_manager_) {
+        return;
+    }
+
+    // Images on disk only: archive entries have no file to read in place
+    std::vector<std::filesystem::path> files;
+    auto& state = App::instance().state();
+    for (size_t idx : state.selection().indices) {
+        auto file = state.fileAt(idx);
+        if (file && file->is_image() && !file->is_in_archive()) {
+            files.push_back(file->path);
+        }
+    }
+    if (files.empty()) {
+        return;
+    }
+
+    auto dest_dir = browse_for_folder(hwnd_, i18n::tr("dialog.export.select_dest_dir").c_str());
+    if (dest_dir.empty()) {
+        return;
+    }
+
+    const auto& settings = App::instance().settings().export_images;
+    image::ExportOptions options{
+        .max_side = static_cast<uint32_t>(settings.max_side),
+        .jpeg_quality = settings.jpeg_quality,
+    };
+    file_op_manager_->exportImages(files, dest_dir, options);
+}
+
+void MainWindow::reorientSelectedImages(image::OrientationChange change) {
+    if (!file_op_manager_) {
+        return;
+    }
+
+    // JPEGs on disk only: the rotation is written into the file itself
+    std::vector<std::filesystem::path> files;
+    auto& state = App::instance().state();
+    for (size_t idx : state.selection().indices) {
+        auto file = state.fileAt(idx);
+        if (file && !file->is_in_archive() &&
+            image::canReorient(file->path.extension().native())) {
+            files.push_back(file->path);
+        }
+    }
+    if (!files.empty()) {
+        file_op_manager_->reorientImages(files, change);
+    }
+}
+
 void MainWindow::createMenu() {
     using i18n::tr;
     menu_ = CreateMenu();
@@ -522,6 +805,24 @@ void MainWindow::createMenu() {
     HMENU file_menu = CreatePopupMenu();
     AppendMenuW(file_menu, MF_STRING, kIdFileRefresh, tr("menu.file.refresh").c_str());
     AppendMenuW(file_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(file_menu, MF_STRING, kIdFileExportImages,
+                tr("menu.file.export_images").c_str());
+    HMENU orientation_menu = CreatePopupMenu();
+    AppendMenuW(orientation_menu, MF_STRING, kIdRotateClockwise,
+                tr("menu.file.orientation.rotate_clockwise").c_str());
+    AppendMenuW(orientation_menu, MF_STRING, kIdRotateCounterClockwise,
+                tr("menu.file.orientation.rotate_counter_clockwise").c_str());
+    AppendMenuW(orientation_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(orientation_menu, MF_STRING, kIdFlipHorizontal,
+                tr("menu.file.orientation.flip_horizontal").c_str());
+    AppendMenuW(orientation_menu, MF_STRING, kIdFlipVertical,
+                tr("menu.file.orientation.flip_vertical").c_str());
+    AppendMenuW(file_menu, MF_POPUP, reinterpret_cast<UINT_PTR>(orientation_menu),
+                tr("menu.file.orientation.label").c_str());
+    AppendMenuW(file_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(file_menu, MF_STRING, kIdFilePauseJobs, tr("menu.file.pause_jobs").c_str());
+    AppendMenuW(file_menu, MF_STRING, kIdFileCancelJobs, tr("menu.file.cancel_jobs").c_str());
+    AppendMenuW(file_menu, MF_SEPARATOR, 0, nullptr);
     AppendMenuW(file_menu, MF_STRING, kIdFileSettings, tr("menu.file.settings").c_str());
     AppendMenuW(file_menu, MF_SEPARATOR, 0, nullptr);
     AppendMenuW(file_menu, MF_STRING, kIdFileExit, tr("menu.file.exit").c_str());
@@ -542,6 +843,10 @@ void MainWindow::createMenu() {
                 tr("menu.view.sort_method.date_created").c_str());
     AppendMenuW(sort_method_menu, MF_STRING, kIdSortSize,
                 tr("menu.view.sort_method.size").c_str());
+    AppendMenuW(sort_method_menu, MF_STRING, kIdSortDateTaken,
+                tr("menu.view.sort_method.date_taken").c_str());
+    AppendMenuW(sort_method_menu, MF_STRING, kIdSortCameraModel,
+                tr("menu.view.sort_method.camera_model").c_str());
     AppendMenuW(view_menu, MF_POPUP, reinterpret_cast<UINT_PTR>(sort_method_menu),
                 tr("menu.view.sort_method.label").c_str());
 
@@ -553,6 +858,11 @@ void MainWindow::createMenu() {
                 tr("menu.view.sort_order.descending").c_str());
     AppendMenuW(view_menu, MF_POPUP, reinterpret_cast<UINT_PTR>(sort_order_menu),
                 tr("menu.view.sort_order.label").c_str());
+    AppendMenuW(view_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(view_menu, MF_STRING, kIdViewFlatten, tr("menu.view.flatten").c_str());
+    AppendMenuW(view_menu, MF_STRING, kIdViewFindSimilar, tr("menu.view.find_similar").c_str());
+    AppendMenuW(view_menu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(view_menu, MF_STRING, kIdViewPerfOverlay, tr("menu.view.perf_overlay").c_str());
 
     AppendMenuW(menu_, MF_POPUP, reinterpret_cast<UINT_PTR>(view_menu),
                 tr("menu.view.label").c_str());
@@ -604,6 +914,30 @@ void MainWindow::createChildControls() {
 
     tree_->onSelectionChanged(
         [](const std::filesystem::path& path) { App::instance().navigateTo(path); });
+    // An empty path means the mouse moved on
+    tree_->onHover([](const std::filesystem::path& path) {
+        if (path.empty()) {
+            App::instance().cancelDirectoryPrefetch();
+        } else {
+            App::instance().prefetchDirectory(path);
+        }
+    });
+
+    // Library search box, when the library is indexed
+    if (App::instance().library()) {
+        search_box_ = CreateWindowExW(
+            WS_EX_CLIENTEDGE, WC_EDITW, nullptr,
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | ES_AUTOHSCROLL, 0, 0, 0, 0, hwnd_, reinterpret_cast<HMENU>(static_cast<intptr_t>(kIdLibrarySearch)),
+            hinstance_, nullptr);
+        if (search_box_) {
+            if (ui_font_) {
+                SendMessageW(search_box_, WM_SETFONT, reinterpret_cast<WPARAM>(ui_font_), TRUE);
+            }
+            auto placeholder = std::wstring(i18n::tr("library.search_placeholder"));
+            SendMessageW(search_box_, EM_SETCUEBANNER, TRUE,
+                         reinterpret_cast<LPARAM>(placeholder.c_str()));
+        }
+    }
 
     // Enable drop target and set up file drop callback
     tree_->enableDropTarget(true);
@@ -615,13 +949,8 @@ void MainWindow::createChildControls() {
             } else {
                 setCursorHintRestore(files);
             }
-            auto result = file_op_manager_->handleDrop(files, dest_path, effect);
-            if (result.succeeded() || result.partiallySucceeded()) {
-                // Refresh if files were moved/copied to current directory
-                if (dest_path == App::instance().state().currentPath()) {
-                    App::instance().refresh();
-                }
-            }
+            // The completion callback refreshes once the operation has run
+            file_op_manager_->handleDrop(files, dest_path, effect);
         }
     });
 
@@ -646,7 +975,7 @@ void MainWindow::createChildControls() {
     file_list_->onItemActivated([](size_t index) {
         auto file = App::instance().state().fileAt(index);
         if (file) {
-            if (file->is_directory()) {
+            if (file->is_directory() || file->is_archive()) {
                 App::instance().navigateTo(file->path);
             } else if (file->is_image()) {
                 auto vpath = file->virtual_path.value_or(archive::VirtualPath(file->path));
@@ -655,7 +984,7 @@ void MainWindow::createChildControls() {
         }
     });
 
-    file_list_->onSelectionChanged([](const std::vector<size_t>& indices) {
+    file_list_->onSelectionChanged([](const fs::IndexSet& indices) {
         Selection sel;
         sel.indices = indices;
         App::instance().state().setSelection(sel);
@@ -711,7 +1040,7 @@ void MainWindow::createChildControls() {
     grid_->onItemActivated([](size_t index) {
         auto file = App::instance().state().fileAt(index);
         if (file) {
-            if (file->is_directory()) {
+            if (file->is_directory() || file->is_archive()) {
                 App::instance().navigateTo(file->path);
             } else if (file->is_image()) {
                 auto vpath = file->virtual_path.value_or(archive::VirtualPath(file->path));
@@ -720,17 +1049,21 @@ void MainWindow::createChildControls() {
         }
     });
 
-    grid_->onSelectionChanged([](const std::vector<size_t>& indices) {
+    grid_->onSelectionChanged([](const fs::IndexSet& indices) {
         Selection sel;
         sel.indices = indices;
         App::instance().state().setSelection(sel);
     });
 
-    grid_->onThumbnailRequest([](const archive::VirtualPath& path) {
-        App::instance().requestThumbnail(path, thumbnail::Priority::High);
+    grid_->onThumbnailRequest([](const fs::FileMetadata& file, size_t index) {
+        App::instance().requestThumbnail(file, thumbnail::Priority::High, index);
+    });
+
+    grid_->onViewportChanged([](const thumbnail::Viewport& viewport) {
+        App::instance().setThumbnailViewport(viewport);
     });
 
-    grid_->onThumbnailCancel([]() { App::instance().thumbnails()->cancelAll(); });
+    grid_->onThumbnailCancel([]() { (void)App::instance().thumbnails()->advanceEpoch(); });
 
     grid_->onDeleteRequested([this](const std::vector<std::filesystem::path>& files) {
         if (file_op_manager_) {
@@ -748,9 +1081,9 @@ void MainWindow::createChildControls() {
         if (!file) {
             return;
         }
-        auto result = fs::renameFile(file->path, new_name);
+        auto result = file_op_manager_->renameFile(file->path, new_name);
         if (result) {
-            App::instance().refresh();
+            App::instance().refreshAfterFileOperation();
         } else {
             auto msg = std::wstring(L"Failed to rename: ") +
                        std::wstring(to_string(result.error()).begin(),
@@ -766,15 +1099,18 @@ void MainWindow::createChildControls() {
     file_op_manager_->onOperationComplete([](bool success, const fs::FileOperationResult& result) {
         if (success) {
             // Refresh the current directory view
-            App::instance().refresh();
+            App::instance().refreshAfterFileOperation();
         }
     });
+    file_op_manager_->onJobsChanged([this]() { requestStatusBarUpdate(); });
 
     // Listen for state changes
-    App::instance().state().onChange([this](AppState::ChangeType type) {
+    App::instance().state().onChange([this](AppState::ChangeType type,
+                                            const ChangeDelta& delta) {
         switch (type) {
         case AppState::ChangeType::CurrentPath:
             directory_changed_ = true;
+            clearLibrarySearchBox();
             if (tree_) {
                 // Only call selectPath() when navigation originated from outside
                 // the tree (e.g. file list, address bar). When the user clicks a
@@ -791,19 +1127,64 @@ void MainWindow::createChildControls() {
         case AppState::ChangeType::DirectoryContents: {
             bool preserve_scroll = !directory_changed_;
             directory_changed_ = false;
+            clearLibrarySearchBox();
             if (file_list_) {
-                file_list_->setItems(App::instance().state().files());
+                file_list_->setItems(App::instance().state().model());
             }
             if (grid_) {
-                grid_->setItems(App::instance().state().files(), preserve_scroll);
+                grid_->setItems(App::instance().state().model(), preserve_scroll);
+            }
+            // While a scan is streaming, the hint target may not have arrived
+            // yet; it is applied once the final listing is in place
+            if (!App::instance().isLoadingDirectory()) {
+                applyCursorHint();
+                applyPendingScroll();
+            }
+            updateStatusBar();
+            break;
+        }
+
+        case AppState::ChangeType::DirectoryAppended: {
+            auto& state = App::instance().state();
+            if (file_list_) {
+                file_list_->appendItems(state.model());
+            }
+            if (grid_) {
+                grid_->appendItems(state.model());
+            }
+            requestStatusBarUpdate();
+            break;
+        }
+
+        case AppState::ChangeType::DirectoryReordered:
+            if (file_list_) {
+                file_list_->setItems(App::instance().state().model());
+            }
+            if (grid_) {
+                grid_->reorderItems(App::instance().state().model());
             }
             applyCursorHint();
+            applyPendingScroll();
             updateStatusBar();
             break;
+
+        case AppState::ChangeType::DirectoryPatched: {
+            // Views patch only the rows that changed when the state knows them
+            auto model = App::instance().state().model();
+            const fs::ModelDelta* listing = delta.full ? nullptr : &delta.listing;
+            if (file_list_) {
+                file_list_->patchItems(model, listing);
+            }
+            if (grid_) {
+                grid_->patchItems(model, listing);
+            }
+            applyCursorHint();
+            requestStatusBarUpdate();
+            break;
         }
 
         case AppState::ChangeType::Selection:
-            updateStatusBar();
+            requestStatusBarUpdate();
             break;
 
         default:
@@ -836,9 +1217,14 @@ void MainWindow::updateLayout() {
         (std::max)(kMinPaneHeight,
                    (std::min)(hsplitter_pos_, content_height - kMinPaneHeight - kSplitterWidth));
 
-    // Position directory tree (full height of content area)
+    // Position directory tree (full height of content area, below the search box)
+    int tree_y = 0;
+    if (search_box_) {
+        MoveWindow(search_box_, 0, 0, vsplitter_pos_, kSearchBoxHeight, TRUE);
+        tree_y = kSearchBoxHeight;
+    }
     if (tree_) {
-        tree_->setBounds(0, 0, vsplitter_pos_, content_height);
+        tree_->setBounds(0, tree_y, vsplitter_pos_, content_height - tree_y);
     }
 
     // Position file list (top of right pane)
@@ -861,6 +1247,27 @@ void MainWindow::updateLayout() {
     InvalidateRect(hwnd_, &hsplitter_rc, TRUE);
 }
 
+void MainWindow::runLibrarySearch() {
+    search_typing_ = false;
+    if (!search_box_) {
+        return;
+    }
+    std::wstring query(static_cast<size_t>(GetWindowTextLengthW(search_box_)) + 1, L'\0');
+    query.resize(static_cast<size_t>(
+        GetWindowTextW(search_box_, query.data(), static_cast<int>(query.size()))));
+    App::instance().searchLibrary(query);
+}
+
+void MainWindow::clearLibrarySearchBox() {
+    // Navigation ends a search; the box follows unless the user is typing
+    if (search_box_ && !search_typing_ && !App::instance().isSearchingLibrary() &&
+        GetWindowTextLengthW(search_box_) > 0) {
+        SetWindowTextW(search_box_, L"");
+        KillTimer(hwnd_, kLibrarySearchTimerId);
+        search_typing_ = false;
+    }
+}
+
 void MainWindow::applyFont() {
     // Create system UI font (Segoe UI)
     NONCLIENTMETRICSW ncm = {};
@@ -991,11 +1398,11 @@ void MainWindow::setCursorHintSelectNext(const std::vector<std::filesystem::path
         affected_names.push_back(f.filename().wstring());
     }
 
-    const auto& current_files = App::instance().state().files();
+    auto current_files = App::instance().state().model();
 
     auto isAffected = [&](size_t index) {
         for (const auto& name : affected_names) {
-            if (current_files[index].name == name) {
+            if ((*current_files)[index].name() == name) {
                 return true;
             }
         }
@@ -1004,7 +1411,7 @@ void MainWindow::setCursorHintSelectNext(const std::vector<std::filesystem::path
 
     // Find the minimum index among affected files
     size_t min_index = SIZE_MAX;
-    for (size_t i = 0; i < current_files.size(); ++i) {
+    for (size_t i = 0; i < current_files->size(); ++i) {
         if (isAffected(i)) {
             min_index = i;
             break;
@@ -1016,10 +1423,10 @@ void MainWindow::setCursorHintSelectNext(const std::vector<std::filesystem::path
     }
 
     // Try to select the first non-affected item after the first affected item
-    for (size_t i = min_index + 1; i < current_files.size(); ++i) {
+    for (size_t i = min_index + 1; i < current_files->size(); ++i) {
         if (!isAffected(i)) {
             cursor_hint_.action = CursorHint::Action::SelectByName;
-            cursor_hint_.target_names.push_back(current_files[i].name);
+            cursor_hint_.target_names.emplace_back((*current_files)[i].name());
             return;
         }
     }
@@ -1029,7 +1436,7 @@ void MainWindow::setCursorHintSelectNext(const std::vector<std::filesystem::path
     for (size_t i = min_index; i-- > 0;) {
         if (!isAffected(i)) {
             cursor_hint_.action = CursorHint::Action::SelectByName;
-            cursor_hint_.target_names.push_back(current_files[i].name);
+            cursor_hint_.target_names.emplace_back((*current_files)[i].name());
             return;
         }
     }
@@ -1037,34 +1444,57 @@ void MainWindow::setCursorHintSelectNext(const std::vector<std::filesystem::path
     // All items affected — nothing to select
 }
 
+void MainWindow::setStartupScroll(const std::filesystem::path& directory, size_t index) {
+    pending_scroll_ = PendingScroll{.directory = directory, .index = index};
+}
+
+void MainWindow::scheduleThumbnailResults(std::chrono::milliseconds delay) {
+    // Re-arming an existing timer just replaces its interval
+    SetTimer(hwnd_, kThumbnailBatchTimerId,
+             static_cast<UINT>(std::max<int64_t>(delay.count(), USER_TIMER_MINIMUM)), nullptr);
+}
+
+void MainWindow::applyPendingScroll() {
+    if (!pending_scroll_) {
+        return;
+    }
+    auto pending = std::move(*pending_scroll_);
+    pending_scroll_.reset();
+
+    if (grid_ && App::instance().state().currentPath() == pending.directory) {
+        grid_->scrollToIndex(pending.index);
+    }
+}
+
 void MainWindow::applyCursorHint() {
     if (cursor_hint_.action == CursorHint::Action::None) {
         return;
     }
 
-    const auto& current_files = App::instance().state().files();
+    auto current_files = App::instance().state().model();
     auto& state = App::instance().state();
 
     if (cursor_hint_.action == CursorHint::Action::RestoreByName) {
         // Find indices of files matching the stored names
-        std::vector<size_t> indices;
-        for (size_t i = 0; i < current_files.size(); ++i) {
+        fs::IndexSet indices;
+        for (size_t i = 0; i < current_files->size(); ++i) {
             for (const auto& name : cursor_hint_.target_names) {
-                if (current_files[i].name == name) {
-                    indices.push_back(i);
+                if ((*current_files)[i].name() == name) {
+                    indices.insert(i);
                     break;
                 }
             }
         }
 
         if (!indices.empty()) {
+            size_t first = *indices.first();
             if (grid_) {
                 grid_->setSelection(indices);
-                grid_->ensureVisible(indices.front());
+                grid_->ensureVisible(first);
             }
             if (file_list_) {
                 file_list_->setSelection(indices);
-                file_list_->ensureVisible(indices.front());
+                file_list_->ensureVisible(first);
             }
             Selection sel;
             sel.indices = indices;
@@ -1073,8 +1503,8 @@ void MainWindow::applyCursorHint() {
     } else if (cursor_hint_.action == CursorHint::Action::SelectByName) {
         // Find the single target by name
         const auto& target = cursor_hint_.target_names.front();
-        for (size_t i = 0; i < current_files.size(); ++i) {
-            if (current_files[i].name == target) {
+        for (size_t i = 0; i < current_files->size(); ++i) {
+            if ((*current_files)[i].name() == target) {
                 if (grid_) {
                     grid_->selectSingle(i);
                     grid_->ensureVisible(i);
@@ -1121,12 +1551,39 @@ void MainWindow::updateSortMenu() {
     CheckMenuItem(menu_, kIdSortSize,
                   MF_BYCOMMAND | (settings.sort.method == config::SortMethod::Size ? MF_CHECKED
                                                                                    : MF_UNCHECKED));
+    CheckMenuItem(
+        menu_, kIdSortDateTaken,
+        MF_BYCOMMAND |
+            (settings.sort.method == config::SortMethod::DateTaken ? MF_CHECKED : MF_UNCHECKED));
+    CheckMenuItem(
+        menu_, kIdSortCameraModel,
+        MF_BYCOMMAND |
+            (settings.sort.method == config::SortMethod::CameraModel ? MF_CHECKED : MF_UNCHECKED));
 
     // Update Sort Order checkmarks
     CheckMenuItem(menu_, kIdSortAscending,
                   MF_BYCOMMAND | (settings.sort.ascending ? MF_CHECKED : MF_UNCHECKED));
     CheckMenuItem(menu_, kIdSortDescending,
                   MF_BYCOMMAND | (!settings.sort.ascending ? MF_CHECKED : MF_UNCHECKED));
+
+    // Update Flatten Subfolders checkmark
+    CheckMenuItem(menu_, kIdViewFlatten,
+                  MF_BYCOMMAND | (settings.flatten_subfolders ? MF_CHECKED : MF_UNCHECKED));
+}
+
+void MainWindow::togglePerfOverlay() {
+    if (!grid_) {
+        return;
+    }
+    bool visible = !grid_->perfOverlayVisible();
+    grid_->setPerfOverlayVisible(visible);
+    if (visible) {
+        App::instance().updatePerfOverlay();
+        SetTimer(hwnd_, kPerfOverlayTimerId, kPerfOverlayIntervalMs, nullptr);
+    } else {
+        KillTimer(hwnd_, kPerfOverlayTimerId);
+    }
+    CheckMenuItem(menu_, kIdViewPerfOverlay, MF_BYCOMMAND | (visible ? MF_CHECKED : MF_UNCHECKED));
 }
 
 }  // namespace nive::ui
@@ -5,12 +5,15 @@
 
 #include <Windows.h>
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "core/config/settings.hpp"
+#include "core/image/jpeg_orientation.hpp"
 
 namespace nive::ui {
 
@@ -56,6 +59,16 @@ public:
     /// @brief Get window handle
     [[nodiscard]] HWND hwnd() const noexcept { return hwnd_; }
 
+    /// @brief WM_COPYDATA tag for a path forwarded by a later launch
+    ///
+    /// The payload is the path as UTF-16 without a terminator; empty means
+    /// only bring the window forward.
+    static constexpr ULONG_PTR kCopyDataOpenPath = 0x4E495645;  // 'NIVE'
+
+    /// @brief Find the main window of a nive process already running
+    /// @return Its handle, or nullptr if there is none
+    [[nodiscard]] static HWND findRunning() noexcept;
+
     /// @brief Save window state to settings
     void saveState(config::Settings& settings) const;
 
@@ -71,6 +84,13 @@ public:
     /// @brief Update status bar from current application state
     void updateStatusBar();
 
+    /// @brief Update the status bar on the next display frame
+    ///
+    /// Requests made before that frame share one update, so callers that fire
+    /// per thumbnail batch, scan chunk or job tick format the text once per
+    /// refresh. A direct updateStatusBar() in between takes the pending one over.
+    void requestStatusBarUpdate();
+
     /// @brief Set a cursor hint to select the next item after the given files are removed.
     /// @param files Files about to be deleted/moved
     ///
@@ -81,6 +101,15 @@ public:
     /// occurred at the end of the list.
     void setCursorHintSelectNext(const std::vector<std::filesystem::path>& files);
 
+    /// @brief Restore the grid scroll position once a directory's listing is complete
+    /// @param directory Directory the position belongs to (dropped if another loads first)
+    /// @param index Item to scroll to the top of the view
+    void setStartupScroll(const std::filesystem::path& directory, size_t index);
+
+    /// @brief Deliver pending thumbnail results after a delay
+    /// @param delay Time until App::processThumbnailResults() runs again
+    void scheduleThumbnailResults(std::chrono::milliseconds delay);
+
 private:
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
     LRESULT handleMessage(UINT msg, WPARAM wParam, LPARAM lParam);
@@ -96,7 +125,12 @@ private:
     void createChildControls();
     void updateLayout();
     void applyFont();
+    void runLibrarySearch();
+    void clearLibrarySearchBox();
     void updateSortMenu();
+    void togglePerfOverlay();
+    void exportSelectedImages();
+    void reorientSelectedImages(image::OrientationChange change);
 
     // Vertical splitter (between tree and right pane)
     void onVsplitterDragStart(int x);
@@ -121,6 +155,8 @@ private:
     std::unique_ptr<FileListView> file_list_;
     std::unique_ptr<ThumbnailGrid> grid_;
     std::unique_ptr<FileOperationManager> file_op_manager_;
+    HWND search_box_ = nullptr;   // Library search, above the tree (only with the index)
+    bool search_typing_ = false;  // Search box edited, search not yet run
 
     // Cursor hint — transient post-operation selection target
     struct CursorHint {
@@ -133,9 +169,21 @@ private:
     void setCursorHintRestore(const std::vector<std::filesystem::path>& files);
     void applyCursorHint();
 
+    // Scroll position restored from the previous session (see setStartupScroll)
+    struct PendingScroll {
+        std::filesystem::path directory;
+        size_t index = 0;
+    };
+    std::optional<PendingScroll> pending_scroll_;
+
+    void applyPendingScroll();
+
     // State change tracking
     bool directory_changed_ = false;
 
+    // requestStatusBarUpdate() armed kStatusBarTimerId
+    bool status_bar_pending_ = false;
+
     // Last child pane that held keyboard focus. MainWindow is a pure
     // container and must not hold keyboard focus itself, otherwise the
     // thumbnail grid / file list stop receiving arrow keys. When MainWindow
@@ -161,20 +209,46 @@ private:
     static constexpr int kMinPaneWidth = 100;
     static constexpr int kMinPaneHeight = 100;
     static constexpr int kStatusBarHeight = 22;
+    static constexpr int kSearchBoxHeight = 24;
+
+    static constexpr UINT_PTR kThumbnailBatchTimerId = 1;
+    static constexpr UINT_PTR kLibrarySearchTimerId = 2;
+    static constexpr UINT_PTR kPerfOverlayTimerId = 3;
+    static constexpr UINT_PTR kStatusBarTimerId = 4;
+
+    // Searches run once typing pauses this long
+    static constexpr UINT kLibrarySearchDelayMs = 150;
+
+    // Performance overlay counters are sampled this often while it is shown
+    static constexpr UINT kPerfOverlayIntervalMs = 500;
 
     // Menu IDs
     static constexpr WORD kIdFileSettings = 1001;
     static constexpr WORD kIdFileRefresh = 1002;
     static constexpr WORD kIdFileExit = 1003;
+    static constexpr WORD kIdFilePauseJobs = 1004;
+    static constexpr WORD kIdFileCancelJobs = 1005;
+    static constexpr WORD kIdFileExportImages = 1006;
+    // Rotate submenu
+    static constexpr WORD kIdRotateClockwise = 1101;
+    static constexpr WORD kIdRotateCounterClockwise = 1102;
+    static constexpr WORD kIdFlipHorizontal = 1103;
+    static constexpr WORD kIdFlipVertical = 1104;
     // Sort Method submenu
     static constexpr WORD kIdSortNatural = 1201;
     static constexpr WORD kIdSortLexicographic = 1202;
     static constexpr WORD kIdSortDateModified = 1203;
     static constexpr WORD kIdSortDateCreated = 1204;
     static constexpr WORD kIdSortSize = 1205;
+    static constexpr WORD kIdSortDateTaken = 1206;
+    static constexpr WORD kIdSortCameraModel = 1207;
     // Sort Order submenu
     static constexpr WORD kIdSortAscending = 1211;
     static constexpr WORD kIdSortDescending = 1212;
+    // Listing
+    static constexpr WORD kIdViewFlatten = 1221;
+    static constexpr WORD kIdViewFindSimilar = 1222;
+    static constexpr WORD kIdViewPerfOverlay = 1223;
 
     // Help menu
     static constexpr WORD kIdHelpAbout = 1301;
@@ -188,6 +262,7 @@ private:
     static constexpr int kIdFileList = 102;
     static constexpr int kIdThumbnailGrid = 103;
     static constexpr int kIdStatusBar = 104;
+    static constexpr int kIdLibrarySearch = 105;
 };
 
 }  // namespace nive::ui
@@ -4,9 +4,69 @@
 #include "app_state.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <unordered_set>
 
 namespace nive::ui {
 
+namespace {
+
+/// @brief Describe a patch from the rows that left and the rows that entered
+/// @param removed Ascending indices in before
+/// @param inserted Ascending indices in after
+///
+/// Kept rows keep their relative order, so the rows that left and entered
+/// between the same two kept rows are a replacement. When both runs hold the
+/// same names in the same order the rows were updated in place; otherwise
+/// the run is reported as a removal and an insertion.
+[[nodiscard]] fs::ModelDelta patch_delta(const fs::DirectoryModel& before,
+                                      const std::vector<size_t>& removed,
+                                      const fs::DirectoryModel& after,
+                                      const std::vector<size_t>& inserted) {
+    fs::ModelDelta delta;
+
+    // Kept rows before a removed (or inserted) row; equal within one run
+    auto gap = [](const std::vector<size_t>& rows, size_t i) {
+        return i < rows.size() ? rows[i] - i : SIZE_MAX;
+    };
+
+    size_t r = 0;
+    size_t n = 0;
+    while (r < removed.size() || n < inserted.size()) {
+        size_t kept = (std::min)(gap(removed, r), gap(inserted, n));
+        size_t r_end = r;
+        while (gap(removed, r_end) == kept) {
+            ++r_end;
+        }
+        size_t n_end = n;
+        while (gap(inserted, n_end) == kept) {
+            ++n_end;
+        }
+
+        bool in_place = r_end - r == n_end - n;
+        for (size_t k = 0; in_place && k < r_end - r; ++k) {
+            in_place = before[removed[r + k]].name() == after[inserted[n + k]].name();
+        }
+        if (in_place) {
+            for (size_t k = n; k < n_end; ++k) {
+                fs::ModelDelta::add(delta.updated, inserted[k]);
+            }
+        } else {
+            for (size_t k = r; k < r_end; ++k) {
+                fs::ModelDelta::add(delta.removed, removed[k]);
+            }
+            for (size_t k = n; k < n_end; ++k) {
+                fs::ModelDelta::add(delta.inserted, inserted[k]);
+            }
+        }
+        r = r_end;
+        n = n_end;
+    }
+    return delta;
+}
+
+}  // namespace
+
 AppState::AppState() = default;
 AppState::~AppState() = default;
 
@@ -26,7 +86,7 @@ void AppState::removeCallback(size_t id) {
     }
 }
 
-void AppState::notify(ChangeType type) {
+void AppState::notify(ChangeType type, const ChangeDelta& delta) {
     // Copy callbacks to avoid holding lock during invocation
     std::vector<ChangeCallback> callbacks_copy;
     {
@@ -38,10 +98,18 @@ void AppState::notify(ChangeType type) {
     }
 
     for (const auto& cb : callbacks_copy) {
-        cb(type);
+        cb(type, delta);
     }
 }
 
+void AppState::notifySelection(const Selection& before, const Selection& after) {
+    ChangeDelta delta;
+    delta.full = false;
+    delta.selected = after.indices.difference(before.indices);
+    delta.deselected = before.indices.difference(after.indices);
+    notify(ChangeType::Selection, delta);
+}
+
 // ===== Current Path =====
 
 std::filesystem::path AppState::currentPath() const {
@@ -148,37 +216,156 @@ bool AppState::canNavigateForward() const {
 
 // ===== Directory Contents =====
 
-std::vector<fs::FileMetadata> AppState::files() const {
+std::shared_ptr<const fs::DirectoryModel> AppState::model() const {
     std::lock_guard lock(mutex_);
     return files_;
 }
 
 void AppState::setFiles(std::vector<fs::FileMetadata> files) {
+    // Built outside the lock; the model is the expensive part
+    auto model = std::make_shared<const fs::DirectoryModel>(std::move(files));
     {
         std::lock_guard lock(mutex_);
-        files_ = std::move(files);
+        files_ = std::move(model);
         selection_.clear();
     }
     notify(ChangeType::DirectoryContents);
     notify(ChangeType::Selection);
 }
 
-std::optional<fs::FileMetadata> AppState::fileAt(size_t index) const {
-    std::lock_guard lock(mutex_);
-    if (index >= files_.size()) {
-        return std::nullopt;
+void AppState::appendFiles(std::vector<fs::FileMetadata> files) {
+    if (files.empty()) {
+        return;
     }
-    return files_[index];
+    ChangeDelta delta;
+    {
+        // The new model shares every existing row; only the batch is built
+        std::lock_guard lock(mutex_);
+        size_t first = files_->size();
+        files_ = files_->append(std::move(files));
+        delta.full = false;
+        delta.listing.inserted.push_back({first, files_->size() - first});
+    }
+    notify(ChangeType::DirectoryAppended, delta);
 }
 
-std::optional<size_t> AppState::findFile(const std::wstring& name) const {
-    std::lock_guard lock(mutex_);
-    for (size_t i = 0; i < files_.size(); ++i) {
-        if (files_[i].name == name) {
-            return i;
+void AppState::reorderFiles(std::vector<fs::FileMetadata> files) {
+    auto model = std::make_shared<const fs::DirectoryModel>(std::move(files));
+    {
+        std::lock_guard lock(mutex_);
+        files_ = std::move(model);
+        selection_.clear();
+    }
+    notify(ChangeType::DirectoryReordered);
+    notify(ChangeType::Selection);
+}
+
+void AppState::applyFileChanges(const std::vector<std::wstring>& removed,
+                                std::vector<fs::FileMetadata> upserted, fs::SortOrder order) {
+    if (removed.empty() && upserted.empty()) {
+        return;
+    }
+
+    // Replaced entries are dropped too and merged back in, since a new size
+    // or time can move them in the sort order
+    std::unordered_set<std::wstring_view> dropped(removed.begin(), removed.end());
+    for (const auto& entry : upserted) {
+        dropped.insert(entry.name);
+    }
+
+    auto current = model();
+    std::vector<fs::FileMetadata> entries;
+    std::vector<size_t> left;
+    entries.reserve(current->size() + upserted.size());
+    for (size_t i = 0; i < current->size(); ++i) {
+        auto row = (*current)[i];
+        if (dropped.contains(row.name())) {
+            left.push_back(i);
+        } else {
+            entries.push_back(row.metadata());
+        }
+    }
+    // The views into upserted do not survive the merge
+    std::vector<std::wstring> names;
+    names.reserve(upserted.size());
+    for (const auto& entry : upserted) {
+        names.push_back(entry.name);
+    }
+    fs::mergeEntries(entries, std::move(upserted), order);
+
+    auto model = std::make_shared<const fs::DirectoryModel>(std::move(entries));
+    std::vector<size_t> entered;
+    entered.reserve(names.size());
+    for (const auto& name : names) {
+        if (auto index = model->find(name)) {
+            entered.push_back(*index);
         }
     }
-    return std::nullopt;
+    std::ranges::sort(entered);
+    entered.erase(std::ranges::unique(entered).begin(), entered.end());
+    ChangeDelta delta;
+    delta.full = false;
+    delta.listing = patch_delta(*current, left, *model, entered);
+
+    {
+        std::lock_guard lock(mutex_);
+        // Another change got in first; the delta no longer describes the step
+        if (files_ != current) {
+            delta = {};
+        }
+        files_ = std::move(model);
+
+        // Without a delta the selection is cleared, as setFiles() does
+        Selection moved;
+        if (!delta.full) {
+            moved.indices = selection_.indices.mapped(delta.listing);
+            if (selection_.focused) {
+                moved.focused = delta.listing.map(*selection_.focused);
+            }
+        }
+        selection_ = std::move(moved);
+    }
+    notify(ChangeType::DirectoryPatched, delta);
+
+    // The selection only moved with its rows; nothing was selected or deselected
+    ChangeDelta selection;
+    selection.full = delta.full;
+    notify(ChangeType::Selection, selection);
+}
+
+void AppState::mergeFiles(std::vector<fs::FileMetadata> files, fs::SortOrder order) {
+    if (files.empty()) {
+        return;
+    }
+
+    auto current = model();
+    std::vector<fs::FileMetadata> entries;
+    entries.reserve(current->size() + files.size());
+    for (size_t i = 0; i < current->size(); ++i) {
+        entries.push_back((*current)[i].metadata());
+    }
+    fs::mergeEntries(entries, std::move(files), order);
+
+    auto model = std::make_shared<const fs::DirectoryModel>(std::move(entries));
+    {
+        std::lock_guard lock(mutex_);
+        files_ = std::move(model);
+        selection_.clear();
+    }
+    notify(ChangeType::DirectoryPatched);
+    notify(ChangeType::Selection);
+}
+
+std::optional<fs::FileMetadata> AppState::fileAt(size_t index) const {
+    auto files = model();
+    if (index >= files->size()) {
+        return std::nullopt;
+    }
+    return (*files)[index].metadata();
+}
+
+std::optional<size_t> AppState::findFile(std::wstring_view name) const {
+    return model()->find(name);
 }
 
 // ===== Selection =====
@@ -189,61 +376,89 @@ Selection AppState::selection() const {
 }
 
 void AppState::setSelection(Selection sel) {
+    Selection before;
+    Selection after;
     {
         std::lock_guard lock(mutex_);
+        before = selection_;
         selection_ = std::move(sel);
+        after = selection_;
     }
-    notify(ChangeType::Selection);
+    notifySelection(before, after);
 }
 
 void AppState::clearSelection() {
+    Selection before;
+    Selection after;
     {
         std::lock_guard lock(mutex_);
+        before = selection_;
         selection_.clear();
+        after = selection_;
     }
-    notify(ChangeType::Selection);
+    notifySelection(before, after);
 }
 
 void AppState::selectSingle(size_t index) {
+    Selection before;
+    Selection after;
     {
         std::lock_guard lock(mutex_);
+        before = selection_;
         selection_.selectSingle(index);
+        after = selection_;
     }
-    notify(ChangeType::Selection);
+    notifySelection(before, after);
 }
 
 void AppState::toggleSelection(size_t index) {
+    Selection before;
+    Selection after;
     {
         std::lock_guard lock(mutex_);
+        before = selection_;
         selection_.toggle(index);
+        after = selection_;
     }
-    notify(ChangeType::Selection);
+    notifySelection(before, after);
 }
 
 void AppState::selectAll() {
+    Selection before;
+    Selection after;
     {
         std::lock_guard lock(mutex_);
-        selection_.indices.clear();
-        selection_.indices.reserve(files_.size());
-        for (size_t i = 0; i < files_.size(); ++i) {
-            selection_.indices.push_back(i);
-        }
+        before = selection_;
+        selection_.indices = fs::IndexSet::all(files_->size());
+        after = selection_;
     }
-    notify(ChangeType::Selection);
+    notifySelection(before, after);
 }
 
 std::vector<fs::FileMetadata> AppState::selectedFiles() const {
-    std::lock_guard lock(mutex_);
     std::vector<fs::FileMetadata> result;
-    result.reserve(selection_.indices.size());
-    for (size_t index : selection_.indices) {
-        if (index < files_.size()) {
-            result.push_back(files_[index]);
-        }
-    }
+    forEachSelected([&result](const fs::DirectoryModel::Row& row) {
+        result.push_back(row.metadata());
+    });
     return result;
 }
 
+void AppState::forEachSelected(
+    const std::function<void(const fs::DirectoryModel::Row&)>& visit) const {
+    // Rows are read from the pinned snapshot after the lock is released
+    std::shared_ptr<const fs::DirectoryModel> files;
+    fs::IndexSet indices;
+    {
+        std::lock_guard lock(mutex_);
+        files = files_;
+        indices = selection_.indices;
+    }
+    indices.truncate(files->size());
+    for (size_t index : indices) {
+        visit((*files)[index]);
+    }
+}
+
 // ===== View Mode =====
 
 ViewMode AppState::viewMode() const {
@@ -300,23 +515,17 @@ bool AppState::viewerNext() {
 
         // Find current image in file list
         auto current_name = viewer_image_->filename();
-        std::optional<size_t> current_index;
-        for (size_t i = 0; i < files_.size(); ++i) {
-            if (files_[i].name == current_name) {
-                current_index = i;
-                break;
-            }
-        }
+        auto current_index = files_->find(current_name);
 
         if (!current_index) {
             return false;
         }
 
         // Find next image
-        for (size_t i = *current_index + 1; i < files_.size(); ++i) {
-            if (files_[i].is_image()) {
-                next_image = files_[i].virtual_path.value_or(
-                    archive::VirtualPath(files_[i].path));
+        for (size_t i = *current_index + 1; i < files_->size(); ++i) {
+            auto file = (*files_)[i];
+            if (file.is_image()) {
+                next_image = file.virtual_path().value_or(archive::VirtualPath(file.path()));
                 break;
             }
         }
@@ -341,13 +550,7 @@ bool AppState::viewerPrevious() {
         }
 
         auto current_name = viewer_image_->filename();
-        std::optional<size_t> current_index;
-        for (size_t i = 0; i < files_.size(); ++i) {
-            if (files_[i].name == current_name) {
-                current_index = i;
-                break;
-            }
-        }
+        auto current_index = files_->find(current_name);
 
         if (!current_index || *current_index == 0) {
             return false;
@@ -355,9 +558,9 @@ bool AppState::viewerPrevious() {
 
         // Find previous image
         for (size_t i = *current_index; i > 0; --i) {
-            if (files_[i - 1].is_image()) {
-                prev_image = files_[i - 1].virtual_path.value_or(
-                    archive::VirtualPath(files_[i - 1].path));
+            auto file = (*files_)[i - 1];
+            if (file.is_image()) {
+                prev_image = file.virtual_path().value_or(archive::VirtualPath(file.path()));
                 break;
             }
         }
@@ -373,4 +576,30 @@ bool AppState::viewerPrevious() {
     return true;
 }
 
+std::vector<archive::VirtualPath> AppState::viewerUpcoming(size_t count, bool forward) const {
+    std::vector<archive::VirtualPath> upcoming;
+    std::lock_guard lock(mutex_);
+    if (!viewer_image_ || count == 0) {
+        return upcoming;
+    }
+
+    auto current_name = viewer_image_->filename();
+    auto current_index = files_->find(current_name);
+    if (!current_index) {
+        return upcoming;
+    }
+
+    size_t index = *current_index;
+    for (size_t step = 1; upcoming.size() < count; ++step) {
+        if (forward ? index + step >= files_->size() : step > index) {
+            break;
+        }
+        auto file = (*files_)[forward ? index + step : index - step];
+        if (file.is_image()) {
+            upcoming.push_back(file.virtual_path().value_or(archive::VirtualPath(file.path())));
+        }
+    }
+    return upcoming;
+}
+
 }  // namespace nive::ui
@@ -9,10 +9,14 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "core/archive/virtual_path.hpp"
+#include "core/fs/directory.hpp"
+#include "core/fs/directory_model.hpp"
 #include "core/fs/file_metadata.hpp"
+#include "core/fs/index_set.hpp"
 
 namespace nive::ui {
 
@@ -24,17 +28,18 @@ enum class ViewMode {
 };
 
 /// @brief Selection state
+///
+/// Indices are ranges (see fs::IndexSet), so selecting every row of a large
+/// listing, copying the selection and diffing it stay O(ranges).
 struct Selection {
-    std::vector<size_t> indices;    // Selected item indices
+    fs::IndexSet indices;           // Selected item indices
     std::optional<size_t> focused;  // Focused item (may not be selected)
 
     [[nodiscard]] bool empty() const noexcept { return indices.empty(); }
 
-    [[nodiscard]] size_t count() const noexcept { return indices.size(); }
+    [[nodiscard]] size_t count() const noexcept { return indices.count(); }
 
-    [[nodiscard]] bool contains(size_t index) const noexcept {
-        return std::find(indices.begin(), indices.end(), index) != indices.end();
-    }
+    [[nodiscard]] bool contains(size_t index) const noexcept { return indices.contains(index); }
 
     void clear() {
         indices.clear();
@@ -42,18 +47,11 @@ struct Selection {
     }
 
     void select(size_t index) {
-        if (!contains(index)) {
-            indices.push_back(index);
-        }
+        indices.insert(index);
         focused = index;
     }
 
-    void deselect(size_t index) {
-        auto it = std::find(indices.begin(), indices.end(), index);
-        if (it != indices.end()) {
-            indices.erase(it);
-        }
-    }
+    void deselect(size_t index) { indices.erase(index); }
 
     void toggle(size_t index) {
         if (contains(index)) {
@@ -65,11 +63,24 @@ struct Selection {
 
     void selectSingle(size_t index) {
         indices.clear();
-        indices.push_back(index);
+        indices.insert(index);
         focused = index;
     }
 };
 
+/// @brief What a state change did, for views that patch themselves
+///
+/// Selection lists are indices in the current listing; both are empty when
+/// a patch only moved the selection along with its rows.
+struct ChangeDelta {
+    bool full = true;  // Nothing below is known; re-read the whole state
+
+    fs::ModelDelta listing;  // DirectoryAppended and DirectoryPatched
+
+    fs::IndexSet selected;    // Newly selected
+    fs::IndexSet deselected;  // No longer selected
+};
+
 /// @brief Navigation history entry
 struct HistoryEntry {
     std::filesystem::path path;
@@ -87,10 +98,15 @@ public:
         Selection,
         ViewMode,
         DirectoryContents,
+        DirectoryAppended,   // Entries appended by an in-progress scan
+        DirectoryReordered,  // Same entries, final sort order applied
+        DirectoryPatched,    // A few entries added, removed or replaced in place
         ViewerImage
     };
 
-    using ChangeCallback = std::function<void(ChangeType)>;
+    /// @brief Change callback; the delta is filled for DirectoryAppended, for
+    ///        DirectoryPatched by applyFileChanges(), and for Selection
+    using ChangeCallback = std::function<void(ChangeType, const ChangeDelta&)>;
 
     AppState();
     ~AppState();
@@ -134,17 +150,50 @@ public:
 
     // ===== Directory Contents =====
 
-    /// @brief Get current directory file list
-    [[nodiscard]] std::vector<fs::FileMetadata> files() const;
+    /// @brief Get the current listing, shared with the views
+    ///
+    /// The model never changes; a reader keeps the snapshot it pinned while
+    /// setters publish new ones, so nothing is copied to read the listing.
+    [[nodiscard]] std::shared_ptr<const fs::DirectoryModel> model() const;
 
     /// @brief Set directory file list
     void setFiles(std::vector<fs::FileMetadata> files);
 
+    /// @brief Append files to the current list without resetting selection
+    void appendFiles(std::vector<fs::FileMetadata> files);
+
+    /// @brief Replace the file list with a reordering of the same entries
+    ///
+    /// Used when an incremental scan finishes and the sorted listing replaces
+    /// the batches delivered in enumeration order. Clears the selection.
+    void reorderFiles(std::vector<fs::FileMetadata> files);
+
+    /// @brief Merge files into their sorted positions in the current list
+    /// @param files Entries to add (in any order)
+    /// @param order Sort order of the current list
+    ///
+    /// Used for batches of a flattened scan, which arrive from many
+    /// directories at once; the list stays sorted while they stream in.
+    /// Clears the selection, like applyFileChanges().
+    void mergeFiles(std::vector<fs::FileMetadata> files, fs::SortOrder order);
+
+    /// @brief Apply file system changes to the current list
+    /// @param removed Names of entries to drop
+    /// @param upserted Entries to replace by name, or add when new
+    /// @param order Sort order of the current list
+    ///
+    /// Used for change notifications on the current directory. Upserted
+    /// entries are merged into their sorted positions; the rest of the list
+    /// is not sorted again. DirectoryPatched carries the rows removed,
+    /// inserted and updated in place, and the selection follows its rows.
+    void applyFileChanges(const std::vector<std::wstring>& removed,
+                          std::vector<fs::FileMetadata> upserted, fs::SortOrder order);
+
     /// @brief Get file at index
     [[nodiscard]] std::optional<fs::FileMetadata> fileAt(size_t index) const;
 
-    /// @brief Find file index by name
-    [[nodiscard]] std::optional<size_t> findFile(const std::wstring& name) const;
+    /// @brief Find file index by name (hashed, see DirectoryModel::find)
+    [[nodiscard]] std::optional<size_t> findFile(std::wstring_view name) const;
 
     // ===== Selection =====
 
@@ -169,6 +218,13 @@ public:
     /// @brief Get selected files
     [[nodiscard]] std::vector<fs::FileMetadata> selectedFiles() const;
 
+    /// @brief Visit the selected rows without copying them
+    /// @param visit Called with each selected row, in listing order
+    ///
+    /// The rows come from a snapshot pinned under the lock and are visited
+    /// after it is released, so visit may call back into the state.
+    void forEachSelected(const std::function<void(const fs::DirectoryModel::Row&)>& visit) const;
+
     // ===== View Mode =====
 
     /// @brief Get current view mode
@@ -199,8 +255,17 @@ public:
     /// @return true if navigated
     bool viewerPrevious();
 
+    /// @brief Get the images viewerNext() (or viewerPrevious()) would go to, nearest first
+    /// @param count Images at most
+    /// @param forward Direction
+    [[nodiscard]] std::vector<archive::VirtualPath> viewerUpcoming(size_t count,
+                                                                   bool forward) const;
+
 private:
-    void notify(ChangeType type);
+    void notify(ChangeType type, const ChangeDelta& delta = {});
+
+    /// @brief Notify Selection with what changed from a previous selection
+    void notifySelection(const Selection& before, const Selection& after);
 
     mutable std::mutex mutex_;
 
@@ -209,8 +274,8 @@ private:
     std::vector<HistoryEntry> history_;
     size_t history_index_ = 0;
 
-    // Directory contents
-    std::vector<fs::FileMetadata> files_;
+    // Directory contents; replaced, never modified, so readers can hold on to it
+    std::shared_ptr<const fs::DirectoryModel> files_ = std::make_shared<fs::DirectoryModel>();
 
     // Selection
     Selection selection_;
@@ -0,0 +1,21 @@
+/// @file window_executor.cpp
+/// @brief WindowExecutor implementation
+
+#include "window_executor.hpp"
+
+#include "app.hpp"
+#include "core/util/logger.hpp"
+
+namespace nive::ui {
+
+void WindowExecutor::schedule(std::coroutine_handle<> handle) {
+    if (!PostMessageW(hwnd_, WM_RESUME_COROUTINE, 0, reinterpret_cast<LPARAM>(handle.address()))) {
+        LOG_WARN("Failed to post coroutine to window: {}", GetLastError());
+    }
+}
+
+void WindowExecutor::resume(LPARAM lParam) {
+    std::coroutine_handle<>::from_address(reinterpret_cast<void*>(lParam)).resume();
+}
+
+}  // namespace nive::ui
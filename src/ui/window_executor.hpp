@@ -0,0 +1,32 @@
+/// @file window_executor.hpp
+/// @brief Executor that resumes coroutines on a window's thread
+
+#pragma once
+
+#include <Windows.h>
+
+#include <coroutine>
+
+#include "core/util/executor.hpp"
+
+namespace nive::ui {
+
+/// @brief Resumes coroutines from a window's message loop
+///
+/// Each schedule() posts WM_RESUME_COROUTINE with the handle; the window
+/// procedure resumes it. A coroutine scheduled after the window is gone is
+/// never resumed (its frame leaks), so UI coroutines must not outlive it.
+class WindowExecutor final : public Executor {
+public:
+    explicit WindowExecutor(HWND hwnd) noexcept : hwnd_(hwnd) {}
+
+    void schedule(std::coroutine_handle<> handle) override;
+
+    /// @brief Resume the coroutine a WM_RESUME_COROUTINE carries
+    static void resume(LPARAM lParam);
+
+private:
+    HWND hwnd_;
+};
+
+}  // namespace nive::ui
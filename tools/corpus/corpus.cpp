@@ -0,0 +1,563 @@
+/// @file corpus.cpp
+/// @brief Deterministic test data generation
+
+#include "corpus.hpp"
+
+#include <Windows.h>
+
+#include <wincodec.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+#include "archive/archive_manager.hpp"
+#include "image/wic_factory.hpp"
+#include "util/com_ptr.hpp"
+#include "util/string_utils.hpp"
+
+#ifdef NIVE_HAS_BIT7Z
+    #include <bit7z/bitexception.hpp>
+    #include <bit7z/bitfilecompressor.hpp>
+#endif
+
+namespace nive::corpus {
+
+namespace {
+
+/// @brief Fixed seed: the corpus must not change between runs
+constexpr uint32_t kSeed = 0x6e697665;  // "nive"
+
+[[nodiscard]] const GUID& container_format(ImageFormat format) {
+    switch (format) {
+    case ImageFormat::Png:
+        return GUID_ContainerFormatPng;
+    case ImageFormat::Tiff:
+        return GUID_ContainerFormatTiff;
+    case ImageFormat::Bmp:
+        return GUID_ContainerFormatBmp;
+    case ImageFormat::Gif:
+        return GUID_ContainerFormatGif;
+    default:
+        return GUID_ContainerFormatJpeg;
+    }
+}
+
+[[nodiscard]] std::wstring_view extension(ImageFormat format) {
+    switch (format) {
+    case ImageFormat::Png:
+        return L".png";
+    case ImageFormat::Tiff:
+        return L".tif";
+    case ImageFormat::Bmp:
+        return L".bmp";
+    case ImageFormat::Gif:
+        return L".gif";
+    default:
+        return L".jpg";
+    }
+}
+
+/// @brief Fill a BGRA image with gradients and noise, different per index
+///
+/// Smooth areas and noise together give encoders and decoders photo-like work:
+/// neither a flat image (trivially compressible) nor pure noise.
+void fill_pixels(std::vector<uint8_t>& bgra, uint32_t width, uint32_t height, size_t index) {
+    std::minstd_rand noise(kSeed + static_cast<uint32_t>(index));
+    uint32_t phase = static_cast<uint32_t>(index * 37);
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* row = bgra.data() + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x) {
+            row[x * 4 + 0] = static_cast<uint8_t>((x * 255 / width + phase) & 0xFF);
+            row[x * 4 + 1] = static_cast<uint8_t>(y * 255 / height);
+            row[x * 4 + 2] = static_cast<uint8_t>(((x ^ y) & 0x3F) + (noise() & 0x3F));
+            row[x * 4 + 3] = 0xFF;
+        }
+    }
+}
+
+[[nodiscard]] bool encode_image(const std::filesystem::path& path, ImageFormat format,
+                                const std::vector<uint8_t>& bgra, uint32_t width,
+                                uint32_t height) {
+    auto* factory = image::wicFactory();
+    if (!factory) {
+        return false;
+    }
+
+    UINT stride = width * 4;
+    ComPtr<IWICBitmap> bitmap;
+    HRESULT hr = factory->CreateBitmapFromMemory(
+        width, height, GUID_WICPixelFormat32bppBGRA, stride, static_cast<UINT>(bgra.size()),
+        const_cast<BYTE*>(bgra.data()), &bitmap);
+
+    ComPtr<IWICStream> stream;
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateStream(&stream);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = stream->InitializeFromFilename(path.c_str(), GENERIC_WRITE);
+    }
+
+    ComPtr<IWICBitmapEncoder> encoder;
+    if (SUCCEEDED(hr)) {
+        hr = factory->CreateEncoder(container_format(format), nullptr, &encoder);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
+    }
+
+    ComPtr<IWICBitmapFrameEncode> frame;
+    ComPtr<IPropertyBag2> props;
+    if (SUCCEEDED(hr)) {
+        hr = encoder->CreateNewFrame(&frame, &props);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = frame->Initialize(props.Get());
+    }
+    if (SUCCEEDED(hr)) {
+        hr = frame->SetSize(width, height);
+    }
+
+    // Encoders without BGRA (JPEG, GIF) answer with the format they take instead
+    WICPixelFormatGUID pixel_format = GUID_WICPixelFormat32bppBGRA;
+    if (SUCCEEDED(hr)) {
+        hr = frame->SetPixelFormat(&pixel_format);
+    }
+
+    ComPtr<IWICBitmapSource> source = bitmap;
+    if (SUCCEEDED(hr) && !IsEqualGUID(pixel_format, GUID_WICPixelFormat32bppBGRA)) {
+        ComPtr<IWICFormatConverter> converter;
+        hr = factory->CreateFormatConverter(&converter);
+        // Indexed formats (GIF) get the fixed web palette; no quantizer needed
+        auto palette = IsEqualGUID(pixel_format, GUID_WICPixelFormat8bppIndexed)
+                           ? WICBitmapPaletteTypeFixedWebPalette
+                           : WICBitmapPaletteTypeCustom;
+        if (SUCCEEDED(hr)) {
+            hr = converter->Initialize(bitmap.Get(), pixel_format, WICBitmapDitherTypeNone,
+                                       nullptr, 0.0, palette);
+        }
+        if (SUCCEEDED(hr)) {
+            source = converter;
+        }
+    }
+
+    if (SUCCEEDED(hr)) {
+        hr = frame->WriteSource(source.Get(), nullptr);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = frame->Commit();
+    }
+    if (SUCCEEDED(hr)) {
+        hr = encoder->Commit();
+    }
+    return SUCCEEDED(hr);
+}
+
+/// @brief CRC-32 (ISO-HDLC), as stored in ZIP headers
+[[nodiscard]] uint32_t crc32_of(const std::vector<uint8_t>& data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint8_t byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void put16(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+// Unicode names: CJK, Cyrillic, a combining accent and a character outside the BMP
+constexpr std::array<std::wstring_view, 4> kUnicodePatterns = {
+    L"\u5199\u771F_{:04}", L"\u0444\u043E\u0442\u043E_{:04}", L"Cafe\u0301 {:04}",
+    L"\U0001F4F7 {:04}"};
+
+/// @brief Stem of about 240 characters ending in suffix (file names may hold 255)
+[[nodiscard]] std::wstring long_stem(std::wstring_view suffix) {
+    constexpr size_t kLength = 240;
+    std::wstring stem = L"long_name_";
+    while (stem.size() + suffix.size() < kLength) {
+        stem += L"0123456789";
+    }
+    stem.resize(kLength - suffix.size());
+    return stem + std::wstring(suffix);
+}
+
+[[nodiscard]] std::wstring directory_name(size_t index, NameStyle style) {
+    switch (style) {
+    case NameStyle::Unicode:
+        return std::format(L"\u30D5\u30A9\u30EB\u30C0_{:02}", index);
+    case NameStyle::Long:
+        return long_stem(std::format(L"_{:02}", index));
+    default:
+        return std::format(L"dir_{:02}", index);
+    }
+}
+
+/// @brief Create a file, empty or as a copy of source; an existing one is kept
+[[nodiscard]] bool write_file(const std::filesystem::path& path,
+                              const std::filesystem::path* source) {
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+        return true;
+    }
+    if (source) {
+        return std::filesystem::copy_file(*source, path, ec);
+    }
+    std::ofstream file(path, std::ios::binary);
+    return static_cast<bool>(file);
+}
+
+/// @brief Write one directory of a tree and the levels below it
+[[nodiscard]] bool write_level(const std::filesystem::path& directory, const TreeSpec& spec,
+                               uint32_t level, const std::filesystem::path* image,
+                               size_t& files) {
+    std::error_code ec;
+    std::filesystem::create_directories(extendedPath(directory), ec);
+    for (size_t i = 0; i < spec.files_per_directory; ++i) {
+        if (!write_file(extendedPath(directory / fileName(i, spec.names, L".jpg")), image)) {
+            return false;
+        }
+        ++files;
+    }
+    if (level < spec.depth) {
+        for (uint32_t i = 0; i < spec.fanout; ++i) {
+            if (!write_level(directory / directory_name(i, spec.names), spec, level + 1, image,
+                             files)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// @brief Write a ZIP without compression, entries named by the files' names in UTF-8
+[[nodiscard]] bool write_stored_zip(const std::filesystem::path& zip_path,
+                                    const std::vector<std::filesystem::path>& files) {
+    // DOS date 2024-01-01 00:00; the reader does not look at it
+    constexpr uint32_t kDosTime = 0;
+    constexpr uint32_t kDosDate = ((2024 - 1980) << 9) | (1 << 5) | 1;
+    constexpr uint32_t kUtf8Names = 0x0800;  // General purpose flag bit 11
+
+    std::vector<uint8_t> archive;
+    std::vector<uint8_t> central;
+    for (const auto& file_path : files) {
+        std::ifstream file(extendedPath(file_path), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+        std::string name = wideToUtf8OrEmpty(file_path.filename().native());
+        uint32_t crc = crc32_of(data);
+        auto size = static_cast<uint32_t>(data.size());
+        auto offset = static_cast<uint32_t>(archive.size());
+
+        put32(archive, 0x04034b50);  // Local file header
+        put16(archive, 20);          // Version needed
+        put16(archive, kUtf8Names);
+        put16(archive, 0);           // Method: stored
+        put16(archive, kDosTime);
+        put16(archive, kDosDate);
+        put32(archive, crc);
+        put32(archive, size);
+        put32(archive, size);
+        put16(archive, static_cast<uint32_t>(name.size()));
+        put16(archive, 0);  // Extra field length
+        archive.insert(archive.end(), name.begin(), name.end());
+        archive.insert(archive.end(), data.begin(), data.end());
+
+        put32(central, 0x02014b50);  // Central directory header
+        put16(central, 20);          // Version made by
+        put16(central, 20);          // Version needed
+        put16(central, kUtf8Names);
+        put16(central, 0);  // Method: stored
+        put16(central, kDosTime);
+        put16(central, kDosDate);
+        put32(central, crc);
+        put32(central, size);
+        put32(central, size);
+        put16(central, static_cast<uint32_t>(name.size()));
+        put16(central, 0);  // Extra field length
+        put16(central, 0);  // Comment length
+        put16(central, 0);  // Disk number
+        put16(central, 0);  // Internal attributes
+        put32(central, 0);  // External attributes
+        put32(central, offset);
+        central.insert(central.end(), name.begin(), name.end());
+    }
+
+    auto central_offset = static_cast<uint32_t>(archive.size());
+    archive.insert(archive.end(), central.begin(), central.end());
+    put32(archive, 0x06054b50);  // End of central directory
+    put16(archive, 0);
+    put16(archive, 0);
+    put16(archive, static_cast<uint32_t>(files.size()));
+    put16(archive, static_cast<uint32_t>(files.size()));
+    put32(archive, static_cast<uint32_t>(central.size()));
+    put32(archive, central_offset);
+    put16(archive, 0);  // Comment length
+
+    std::ofstream out(zip_path, std::ios::binary | std::ios::trunc);
+    return out && out.write(reinterpret_cast<const char*>(archive.data()),
+                            static_cast<std::streamsize>(archive.size()));
+}
+
+}  // namespace
+
+std::string_view to_string(ImageFormat format) noexcept {
+    switch (format) {
+    case ImageFormat::Png:
+        return "png";
+    case ImageFormat::Tiff:
+        return "tiff";
+    case ImageFormat::Bmp:
+        return "bmp";
+    case ImageFormat::Gif:
+        return "gif";
+    default:
+        return "jpeg";
+    }
+}
+
+std::optional<ImageFormat> parseImageFormat(std::string_view name) noexcept {
+    for (auto format : {ImageFormat::Jpeg, ImageFormat::Png, ImageFormat::Tiff, ImageFormat::Bmp,
+                        ImageFormat::Gif}) {
+        if (name == to_string(format)) {
+            return format;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view to_string(NameStyle style) noexcept {
+    switch (style) {
+    case NameStyle::Unicode:
+        return "unicode";
+    case NameStyle::Long:
+        return "long";
+    default:
+        return "plain";
+    }
+}
+
+std::optional<NameStyle> parseNameStyle(std::string_view name) noexcept {
+    for (auto style : {NameStyle::Plain, NameStyle::Unicode, NameStyle::Long}) {
+        if (name == to_string(style)) {
+            return style;
+        }
+    }
+    return std::nullopt;
+}
+
+std::wstring fileName(size_t index, NameStyle style, std::wstring_view extension) {
+    switch (style) {
+    case NameStyle::Unicode: {
+        auto pattern = kUnicodePatterns[index % kUnicodePatterns.size()];
+        return std::vformat(pattern, std::make_wformat_args(index)) + std::wstring(extension);
+    }
+    case NameStyle::Long:
+        return long_stem(std::format(L"_{:06}", index)) + std::wstring(extension);
+    default:
+        return std::format(L"IMG_{:07}{}", index, extension);
+    }
+}
+
+std::filesystem::path extendedPath(const std::filesystem::path& path) {
+    constexpr std::wstring_view kPrefix = L"\\\\?\\";
+    if (path.native().starts_with(kPrefix)) {
+        return path;
+    }
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(path, ec).lexically_normal();
+    return std::wstring(kPrefix) + absolute.native();
+}
+
+image::DecodedImage syntheticImage(uint32_t width, uint32_t height, size_t index) {
+    std::vector<uint8_t> bgra(static_cast<size_t>(width) * height * 4);
+    fill_pixels(bgra, width, height, index);
+    image::DecodedImage image(width, height, image::PixelFormat::BGRA32);
+    for (uint32_t y = 0; y < height; ++y) {
+        std::copy_n(bgra.data() + static_cast<size_t>(y) * width * 4, width * 4, image.row(y));
+    }
+    return image;
+}
+
+std::optional<std::vector<std::filesystem::path>>
+writeImages(const std::filesystem::path& directory, ImageFormat format, uint32_t width,
+            uint32_t height, size_t count, NameStyle names) {
+    std::error_code ec;
+    std::filesystem::create_directories(extendedPath(directory), ec);
+
+    std::vector<std::filesystem::path> paths;
+    std::vector<uint8_t> bgra;
+    for (size_t i = 0; i < count; ++i) {
+        auto stem = std::format(L"{}x{}_", width, height);
+        auto path = extendedPath(directory / (stem + fileName(i, names, extension(format))));
+        if (!std::filesystem::exists(path, ec)) {
+            bgra.resize(static_cast<size_t>(width) * height * 4);
+            fill_pixels(bgra, width, height, i);
+            if (!encode_image(path, format, bgra, width, height)) {
+                std::filesystem::remove(path, ec);
+                return std::nullopt;
+            }
+        }
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+bool writeEmptyFiles(const std::filesystem::path& directory, size_t count, NameStyle names) {
+    std::error_code ec;
+    std::filesystem::create_directories(extendedPath(directory), ec);
+    for (size_t i = 0; i < count; ++i) {
+        if (!write_file(extendedPath(directory / fileName(i, names, L".jpg")), nullptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<size_t> writeTree(const std::filesystem::path& root, const TreeSpec& spec) {
+    // One small JPEG, copied for every file of the tree
+    std::optional<std::filesystem::path> image;
+    if (spec.images) {
+        std::error_code ec;
+        auto templates = writeImages(std::filesystem::temp_directory_path(ec) / "nive_corpus",
+                                     ImageFormat::Jpeg, 160, 120, 1);
+        if (!templates) {
+            return std::nullopt;
+        }
+        image = templates->front();
+    }
+
+    size_t files = 0;
+    if (!write_level(root, spec, 0, image ? &*image : nullptr, files)) {
+        return std::nullopt;
+    }
+    return files;
+}
+
+std::string_view to_string(ArchiveKind kind) noexcept {
+    switch (kind) {
+    case ArchiveKind::Zip:
+        return "zip";
+    case ArchiveKind::SevenZip:
+        return "7z";
+    case ArchiveKind::SevenZipSolid:
+        return "7z-solid";
+    default:
+        return "zip-stored";
+    }
+}
+
+std::optional<ArchiveKind> parseArchiveKind(std::string_view name) noexcept {
+    for (auto kind : {ArchiveKind::ZipStored, ArchiveKind::Zip, ArchiveKind::SevenZip,
+                      ArchiveKind::SevenZipSolid}) {
+        if (name == to_string(kind)) {
+            return kind;
+        }
+    }
+    return std::nullopt;
+}
+
+std::wstring_view archiveExtension(ArchiveKind kind) noexcept {
+    return kind == ArchiveKind::ZipStored || kind == ArchiveKind::Zip ? L".zip" : L".7z";
+}
+
+std::optional<std::string> writeArchive(const std::filesystem::path& archive_path,
+                                        const std::vector<std::filesystem::path>& files,
+                                        ArchiveKind kind) {
+    std::error_code ec;
+    if (std::filesystem::exists(archive_path, ec)) {
+        return std::nullopt;  // Kept from an earlier run
+    }
+    if (kind == ArchiveKind::ZipStored) {
+        if (!write_stored_zip(archive_path, files)) {
+            return "could not write " + pathToUtf8(archive_path);
+        }
+        return std::nullopt;
+    }
+
+#ifdef NIVE_HAS_BIT7Z
+    archive::ArchiveManager archives;
+    auto dll = archives.getDllPath();
+    if (!dll) {
+        return "7z.dll not found";
+    }
+    try {
+        bit7z::Bit7zLibrary library(dll->wstring());
+        bit7z::BitFileCompressor compressor(library, kind == ArchiveKind::Zip
+                                                         ? bit7z::BitFormat::Zip
+                                                         : bit7z::BitFormat::SevenZip);
+        compressor.setSolidMode(kind == ArchiveKind::SevenZipSolid);
+        std::vector<bit7z::tstring> inputs;
+        inputs.reserve(files.size());
+        for (const auto& file : files) {
+            inputs.push_back(file.wstring());
+        }
+        compressor.compress(inputs, archive_path.wstring());
+    } catch (const bit7z::BitException& e) {
+        std::filesystem::remove(archive_path, ec);
+        return e.what();
+    }
+    return std::nullopt;
+#else
+    return "built without bit7z; only zip-stored archives can be written";
+#endif
+}
+
+std::vector<fs::FileMetadata> syntheticEntries(size_t count) {
+    constexpr std::array<std::wstring_view, 4> kPatterns = {
+        L"IMG_{}.jpg", L"photo ({}).jpg", L"DSC{:05}.JPG", L"scan_{}_page{}.png"};
+
+    std::mt19937 random(kSeed);
+    std::uniform_int_distribution<uint64_t> size_bytes(16 * 1024, 24 * 1024 * 1024);
+    std::uniform_int_distribution<int64_t> age_seconds(0, 10LL * 365 * 24 * 3600);
+    auto now = std::chrono::system_clock::now();
+
+    std::vector<fs::FileMetadata> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto& entry = entries[i];
+        auto pattern = kPatterns[i % kPatterns.size()];
+        size_t number = i / kPatterns.size();
+        size_t scan = number / 50;
+        size_t page = number % 50;
+        entry.name = i % kPatterns.size() == 3
+                         ? std::vformat(pattern, std::make_wformat_args(scan, page))
+                         : std::vformat(pattern, std::make_wformat_args(number));
+        entry.path = std::filesystem::path(L"C:\\bench") / entry.name;
+        entry.extension = entry.path.extension().wstring();
+        entry.type = fs::FileType::Image;
+        entry.size_bytes = size_bytes(random);
+        entry.modified_time = now - std::chrono::seconds(age_seconds(random));
+        entry.created_time = entry.modified_time;
+        entry.accessed_time = entry.modified_time;
+    }
+    std::shuffle(entries.begin(), entries.end(), random);
+    return entries;
+}
+
+}  // namespace nive::bench
@@ -0,0 +1,131 @@
+/// @file corpus.hpp
+/// @brief Deterministic test data: images, directory trees, archives, listings
+///
+/// Shared by the nive_corpus tool, nive_bench and unit tests. Everything is
+/// generated from fixed seeds, so two runs on the same toolchain produce the
+/// same bytes. Files already present from an earlier run are kept, which
+/// makes regenerating a large corpus cheap.
+///
+/// The image writers use WIC; COM must be initialised on the calling thread.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fs/file_metadata.hpp"
+#include "image/decoded_image.hpp"
+
+namespace nive::corpus {
+
+/// @brief Image formats the corpus can be written in (the built-in WIC encoders)
+///
+/// WebP and AVIF have no WIC encoder; benchmarks take such files from a
+/// directory of real images instead.
+enum class ImageFormat { Jpeg, Png, Tiff, Bmp, Gif };
+
+[[nodiscard]] std::string_view to_string(ImageFormat format) noexcept;
+
+/// @brief Parse a format name as printed by to_string ("jpeg", "png", ...)
+[[nodiscard]] std::optional<ImageFormat> parseImageFormat(std::string_view name) noexcept;
+
+/// @brief How generated file and directory names are spelled
+enum class NameStyle {
+    Plain,    // ASCII, camera style ("IMG_0001.jpg")
+    Unicode,  // CJK, Cyrillic, combining marks and characters outside the BMP
+    Long,     // Names near the 255 character limit, so full paths pass MAX_PATH
+};
+
+[[nodiscard]] std::string_view to_string(NameStyle style) noexcept;
+
+[[nodiscard]] std::optional<NameStyle> parseNameStyle(std::string_view name) noexcept;
+
+/// @brief Name of the index-th generated file
+/// @param index File number
+/// @param style Spelling
+/// @param extension Extension including the dot
+[[nodiscard]] std::wstring fileName(size_t index, NameStyle style, std::wstring_view extension);
+
+/// @brief Path usable beyond MAX_PATH (absolute, with the \\?\ prefix)
+[[nodiscard]] std::filesystem::path extendedPath(const std::filesystem::path& path);
+
+/// @brief In-memory BGRA32 image with the content writeImages encodes
+/// @param width Image width
+/// @param height Image height
+/// @param index Variant, as the file index in writeImages
+///
+/// A gradient with a little noise, so scalers and compressors see
+/// photo-like input rather than flat colour.
+[[nodiscard]] image::DecodedImage syntheticImage(uint32_t width, uint32_t height,
+                                                 size_t index = 0);
+
+/// @brief Write count distinct images of one format and size
+/// @param directory Output directory (created if missing)
+/// @param format Encoding
+/// @param width Image width
+/// @param height Image height
+/// @param count Number of images
+/// @param names Spelling of the file names
+/// @return Paths of the images, or nullopt if encoding failed
+[[nodiscard]] std::optional<std::vector<std::filesystem::path>>
+writeImages(const std::filesystem::path& directory, ImageFormat format, uint32_t width,
+            uint32_t height, size_t count, NameStyle names = NameStyle::Plain);
+
+/// @brief Create count empty .jpg files for directory scans
+/// @return false if a file could not be created
+[[nodiscard]] bool writeEmptyFiles(const std::filesystem::path& directory, size_t count,
+                                   NameStyle names = NameStyle::Plain);
+
+/// @brief Shape of a generated directory tree
+struct TreeSpec {
+    uint32_t depth = 2;                // Levels below the root
+    uint32_t fanout = 4;               // Subdirectories per directory
+    size_t files_per_directory = 100;  // At every level, the root included
+    bool images = false;               // Small real JPEGs instead of empty files
+    NameStyle names = NameStyle::Plain;
+};
+
+/// @brief Write a directory tree
+/// @param root Tree root (created if missing)
+/// @param spec Shape and contents
+/// @return Number of files in the tree, or nullopt if one could not be written
+[[nodiscard]] std::optional<size_t> writeTree(const std::filesystem::path& root,
+                                              const TreeSpec& spec);
+
+/// @brief Archive layouts
+enum class ArchiveKind {
+    ZipStored,      // ZIP without compression (written here, no dependency)
+    Zip,            // ZIP, deflate (7z.dll)
+    SevenZip,       // 7z, one block per file (7z.dll)
+    SevenZipSolid,  // 7z, solid (7z.dll)
+};
+
+[[nodiscard]] std::string_view to_string(ArchiveKind kind) noexcept;
+
+[[nodiscard]] std::optional<ArchiveKind> parseArchiveKind(std::string_view name) noexcept;
+
+/// @brief Extension for an archive kind (".zip" or ".7z")
+[[nodiscard]] std::wstring_view archiveExtension(ArchiveKind kind) noexcept;
+
+/// @brief Write an archive holding the given files under their file names
+/// @return Error message, or nullopt on success
+///
+/// An existing archive is kept. ZipStored holds at most 65535 entries of
+/// under 4 GiB each (no ZIP64).
+[[nodiscard]] std::optional<std::string>
+writeArchive(const std::filesystem::path& archive_path,
+             const std::vector<std::filesystem::path>& files, ArchiveKind kind);
+
+/// @brief Build a shuffled listing of image files with camera-style names
+///
+/// Names mix numbering styles ("IMG_1234.jpg", "photo (12).jpg", ...) so
+/// natural sort sees embedded numbers of varying width; sizes and times
+/// are spread so the other orders do real comparisons.
+[[nodiscard]] std::vector<fs::FileMetadata> syntheticEntries(size_t count);
+
+}  // namespace nive::corpus
@@ -0,0 +1,301 @@
+/// @file corpus_main.cpp
+/// @brief nive_corpus entry point: write a synthetic corpus to a directory
+///
+/// Usage:
+///   nive_corpus <out-dir> [--names plain|unicode|long]
+///               [--images <format>:<W>x<H>:<count>]... [--flat <count>]
+///               [--tree <depth>:<fanout>:<files>[:images]]
+///               [--archive <kind>:<entries>]... [--preset standard]
+///
+/// --names applies to the options after it. Output goes to fixed places
+/// under <out-dir> (images/<format>_<W>x<H>_<names>, flat_<count>_<names>,
+/// tree_<depth>_<fanout>_<files>_<names>, archives/<kind>_<entries>_<names>),
+/// so rerunning with the same options only fills in what is missing.
+
+#include <Windows.h>
+
+#include <objbase.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "corpus.hpp"
+#include "util/string_utils.hpp"
+
+namespace {
+
+using namespace nive::corpus;
+
+/// @brief One thing to generate
+struct Job {
+    enum class Kind { Images, Flat, Tree, Archive } kind;
+    NameStyle names = NameStyle::Plain;
+    ImageFormat format = ImageFormat::Jpeg;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t count = 0;  // Images, files or archive entries
+    TreeSpec tree;
+    ArchiveKind archive = ArchiveKind::ZipStored;
+};
+
+void print_usage() {
+    std::printf("Usage: nive_corpus <out-dir> [--names plain|unicode|long]\n"
+                "                   [--images <format>:<W>x<H>:<count>]... [--flat <count>]\n"
+                "                   [--tree <depth>:<fanout>:<files>[:images]]\n"
+                "                   [--archive <kind>:<entries>]... [--preset standard]\n"
+                "  formats: jpeg png tiff bmp gif\n"
+                "  archive kinds: zip-stored zip 7z 7z-solid\n");
+}
+
+/// @brief Split s at each separator
+std::vector<std::string_view> split(std::string_view s, char separator) {
+    std::vector<std::string_view> parts;
+    for (size_t start = 0;;) {
+        size_t end = s.find(separator, start);
+        parts.push_back(s.substr(start, end - start));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+template <typename T>
+std::optional<T> parse_number(std::string_view s) {
+    T value{};
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc{} || end != s.data() + s.size() || value == 0) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/// @brief Parse "<format>:<W>x<H>:<count>"
+std::optional<Job> parse_images(std::string_view spec, NameStyle names) {
+    auto parts = split(spec, ':');
+    if (parts.size() != 3) {
+        return std::nullopt;
+    }
+    auto size = split(parts[1], 'x');
+    auto format = parseImageFormat(parts[0]);
+    auto width = size.size() == 2 ? parse_number<uint32_t>(size[0]) : std::nullopt;
+    auto height = size.size() == 2 ? parse_number<uint32_t>(size[1]) : std::nullopt;
+    auto count = parse_number<size_t>(parts[2]);
+    if (!format || !width || !height || !count) {
+        return std::nullopt;
+    }
+    Job job{.kind = Job::Kind::Images, .names = names, .format = *format};
+    job.width = *width;
+    job.height = *height;
+    job.count = *count;
+    return job;
+}
+
+/// @brief Parse "<depth>:<fanout>:<files>[:images]"
+std::optional<Job> parse_tree(std::string_view spec, NameStyle names) {
+    auto parts = split(spec, ':');
+    if (parts.size() != 3 && !(parts.size() == 4 && parts[3] == "images")) {
+        return std::nullopt;
+    }
+    auto depth = parse_number<uint32_t>(parts[0]);
+    auto fanout = parse_number<uint32_t>(parts[1]);
+    auto files = parse_number<size_t>(parts[2]);
+    if (!depth || !fanout || !files) {
+        return std::nullopt;
+    }
+    Job job{.kind = Job::Kind::Tree, .names = names};
+    job.tree = {.depth = *depth,
+                .fanout = *fanout,
+                .files_per_directory = *files,
+                .images = parts.size() == 4,
+                .names = names};
+    return job;
+}
+
+/// @brief Parse "<kind>:<entries>"
+std::optional<Job> parse_archive(std::string_view spec, NameStyle names) {
+    auto parts = split(spec, ':');
+    if (parts.size() != 2) {
+        return std::nullopt;
+    }
+    auto kind = parseArchiveKind(parts[0]);
+    auto entries = parse_number<size_t>(parts[1]);
+    if (!kind || !entries) {
+        return std::nullopt;
+    }
+    Job job{.kind = Job::Kind::Archive, .names = names};
+    job.count = *entries;
+    job.archive = *kind;
+    return job;
+}
+
+/// @brief Jobs of a named preset
+std::optional<std::vector<Job>> preset(std::string_view name) {
+    if (name != "standard") {
+        return std::nullopt;
+    }
+    std::vector<Job> jobs;
+    for (auto format : {ImageFormat::Jpeg, ImageFormat::Png, ImageFormat::Tiff,
+                        ImageFormat::Bmp, ImageFormat::Gif}) {
+        jobs.push_back(*parse_images(std::format("{}:1920x1080:8", to_string(format)),
+                                     NameStyle::Plain));
+    }
+    jobs.push_back(*parse_images("jpeg:12000x8000:1", NameStyle::Plain));
+    jobs.push_back(*parse_images("jpeg:640x480:32", NameStyle::Unicode));
+    jobs.push_back(*parse_images("jpeg:640x480:32", NameStyle::Long));
+    jobs.push_back({.kind = Job::Kind::Flat, .names = NameStyle::Plain, .count = 100000});
+    jobs.push_back(*parse_tree("3:8:100", NameStyle::Plain));
+    jobs.push_back(*parse_tree("2:4:20:images", NameStyle::Unicode));
+    for (auto kind : {ArchiveKind::ZipStored, ArchiveKind::Zip, ArchiveKind::SevenZip,
+                      ArchiveKind::SevenZipSolid}) {
+        jobs.push_back(*parse_archive(std::format("{}:1000", to_string(kind)), NameStyle::Plain));
+    }
+    jobs.push_back(*parse_archive("zip-stored:200", NameStyle::Unicode));
+    return jobs;
+}
+
+/// @brief Generate one job under root
+/// @return Error message, or nullopt on success
+std::optional<std::string> run(const Job& job, const std::filesystem::path& root) {
+    auto names = std::string(to_string(job.names));
+    switch (job.kind) {
+    case Job::Kind::Images: {
+        auto dir = root / "images" /
+                   std::format("{}_{}x{}_{}", to_string(job.format), job.width, job.height, names);
+        if (!writeImages(dir, job.format, job.width, job.height, job.count, job.names)) {
+            return "failed to encode images in " + nive::pathToUtf8(dir);
+        }
+        std::printf("  %s: %zu images\n", nive::pathToUtf8(dir).c_str(), job.count);
+        return std::nullopt;
+    }
+    case Job::Kind::Flat: {
+        auto dir = root / std::format("flat_{}_{}", job.count, names);
+        if (!writeEmptyFiles(dir, job.count, job.names)) {
+            return "failed to create files in " + nive::pathToUtf8(dir);
+        }
+        std::printf("  %s: %zu files\n", nive::pathToUtf8(dir).c_str(), job.count);
+        return std::nullopt;
+    }
+    case Job::Kind::Tree: {
+        auto dir = root / std::format("tree_{}_{}_{}_{}{}", job.tree.depth, job.tree.fanout,
+                                      job.tree.files_per_directory, names,
+                                      job.tree.images ? "_images" : "");
+        auto files = writeTree(dir, job.tree);
+        if (!files) {
+            return "failed to write tree " + nive::pathToUtf8(dir);
+        }
+        std::printf("  %s: %zu files\n", nive::pathToUtf8(dir).c_str(), *files);
+        return std::nullopt;
+    }
+    case Job::Kind::Archive: {
+        // Entries are small JPEGs, shared by the archives of one name style
+        auto sources = root / "archives" / std::format("entries_{}", names);
+        auto files = writeImages(sources, ImageFormat::Jpeg, 320, 240, job.count, job.names);
+        if (!files) {
+            return "failed to encode archive entries in " + nive::pathToUtf8(sources);
+        }
+        auto path = root / "archives" /
+                    (nive::utf8ToWideOrEmpty(
+                         std::format("{}_{}_{}", to_string(job.archive), job.count, names)) +
+                     std::wstring(archiveExtension(job.archive)));
+        if (auto error = writeArchive(path, *files, job.archive)) {
+            return nive::pathToUtf8(path) + ": " + *error;
+        }
+        std::printf("  %s: %zu entries\n", nive::pathToUtf8(path).c_str(), job.count);
+        return std::nullopt;
+    }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 3) {
+        print_usage();
+        return 2;
+    }
+    std::filesystem::path root = argv[1];
+
+    std::vector<Job> jobs;
+    NameStyle names = NameStyle::Plain;
+    for (int i = 2; i < argc; ++i) {
+        std::wstring_view arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 2;
+        }
+        std::string value = nive::wideToUtf8OrEmpty(argv[++i]);
+
+        bool valid = true;
+        if (arg == L"--names") {
+            auto style = parseNameStyle(value);
+            valid = style.has_value();
+            names = style.value_or(names);
+        } else if (arg == L"--images") {
+            auto job = parse_images(value, names);
+            valid = job.has_value();
+            if (job) {
+                jobs.push_back(*job);
+            }
+        } else if (arg == L"--flat") {
+            auto count = parse_number<size_t>(value);
+            valid = count.has_value();
+            if (count) {
+                jobs.push_back({.kind = Job::Kind::Flat, .names = names, .count = *count});
+            }
+        } else if (arg == L"--tree") {
+            auto job = parse_tree(value, names);
+            valid = job.has_value();
+            if (job) {
+                jobs.push_back(*job);
+            }
+        } else if (arg == L"--archive") {
+            auto job = parse_archive(value, names);
+            valid = job.has_value();
+            if (job) {
+                jobs.push_back(*job);
+            }
+        } else if (arg == L"--preset") {
+            auto preset_jobs = preset(value);
+            valid = preset_jobs.has_value();
+            if (preset_jobs) {
+                jobs.insert(jobs.end(), preset_jobs->begin(), preset_jobs->end());
+            }
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::printf("Invalid argument: %s %s\n", nive::wideToUtf8OrEmpty(arg).c_str(),
+                        value.c_str());
+            print_usage();
+            return 2;
+        }
+    }
+
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        std::printf("COM initialization failed: 0x%08lX\n", static_cast<unsigned long>(hr));
+        return 1;
+    }
+
+    std::printf("nive_corpus: writing %zu sets to %s\n", jobs.size(),
+                nive::pathToUtf8(root).c_str());
+    int exit_code = 0;
+    for (const auto& job : jobs) {
+        if (auto error = run(job, root)) {
+            std::printf("  error: %s\n", error->c_str());
+            exit_code = 1;
+        }
+    }
+
+    CoUninitialize();
+    return exit_code;
+}